@@ -142,6 +142,10 @@ void GUIFontDrawIconSize(struct GUIFont* font, int x, int y, int w, int h, uint3
 void GUIFontDrawSubmit(struct GUIFont* font);
 #endif
 
+// GUIFontPrint keeps the layout of recently drawn strings around. Backends must clear it when a
+// font is destroyed, since a new font may end up at the same address.
+void GUIFontClearRunCache(void);
+
 void GUIFontDraw9Slice(struct GUIFont*, int x, int y, int width, int height, uint32_t color, enum GUI9SliceStyle style);
 
 CXX_GUARD_END
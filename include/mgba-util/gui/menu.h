@@ -73,6 +73,8 @@ struct GUIMenu {
 	struct GUIMenuItemList items;
 	size_t index;
 	struct GUIBackground* background;
+	// Called once per frame while the menu is shown, so it can fill itself in without blocking
+	void (*update)(struct GUIMenu*);
 };
 
 struct GUIMenuSavedState {
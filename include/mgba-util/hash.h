@@ -11,6 +11,7 @@
 CXX_GUARD_START
 
 uint32_t hash32(const void* key, size_t len, uint32_t seed);
+uint64_t hash64(const void* key, size_t len, uint64_t seed);
 
 CXX_GUARD_END
 
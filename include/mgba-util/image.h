@@ -10,6 +10,8 @@
 
 CXX_GUARD_START
 
+#include <mgba-util/geometry.h>
+
 #ifdef COLOR_16_BIT
 typedef uint16_t color_t;
 #define BYTES_PER_PIXEL 2
@@ -84,12 +86,17 @@ enum mColorFormat {
 
 #ifndef COLOR_16_BIT
 #define mCOLOR_NATIVE mCOLOR_XBGR8
+#define mCOLOR_NATIVE_SWAPPED mCOLOR_XRGB8
 #elif !defined(COLOR_5_6_5)
 #define mCOLOR_NATIVE mCOLOR_BGR5
+#define mCOLOR_NATIVE_SWAPPED mCOLOR_RGB5
 #else
 #define mCOLOR_NATIVE mCOLOR_RGB565
+#define mCOLOR_NATIVE_SWAPPED mCOLOR_BGR565
 #endif
 
+#define M_COLOR_TABLE_555_SIZE 0x8000
+
 struct mImage {
 	void* data;
 	uint32_t* palette;
@@ -99,6 +106,8 @@ struct mImage {
 	unsigned depth;
 	unsigned palSize;
 	enum mColorFormat format;
+	// Area written since the owner last cleared it; width and height are 0 when clean
+	struct mRectangle dirty;
 };
 
 struct mPainter {
@@ -127,6 +136,9 @@ uint32_t mImageGetPixelRaw(const struct mImage* image, unsigned x, unsigned y);
 void mImageSetPixel(struct mImage* image, unsigned x, unsigned y, uint32_t color);
 void mImageSetPixelRaw(struct mImage* image, unsigned x, unsigned y, uint32_t color);
 
+void mImageMarkDirty(struct mImage* image, int x, int y, int width, int height);
+void mImageClearDirty(struct mImage* image);
+
 void mImageSetPaletteSize(struct mImage* image, unsigned count);
 void mImageSetPaletteEntry(struct mImage* image, unsigned index, uint32_t color);
 
@@ -141,6 +153,13 @@ void mPainterDrawCircle(struct mPainter*, int x, int y, int diameter);
 
 uint32_t mColorConvert(uint32_t color, enum mColorFormat from, enum mColorFormat to);
 uint32_t mImageColorConvert(uint32_t color, const struct mImage* from, enum mColorFormat to);
+// Converts count pixels from a packed row of one format to another. Neither format may be mCOLOR_PAL8.
+void mColorConvertRow(void* dst, enum mColorFormat to, const void* src, enum mColorFormat from, size_t count);
+
+// Fills in a table of M_COLOR_TABLE_555_SIZE entries mapping each BGR555 color to the given format.
+// Only mCOLOR_NATIVE and mCOLOR_NATIVE_SWAPPED are supported, since those are the only formats that
+// color_t math, such as blending, works on unchanged.
+bool mColorTableFrom555(color_t* table, enum mColorFormat format);
 
 #ifndef PYCPARSE
 static inline unsigned mColorFormatBytes(enum mColorFormat format) {
@@ -222,6 +241,18 @@ static inline color_t mColorFrom555(uint16_t value) {
 	return color;
 }
 
+static inline color_t mColorSwapRedBlue(color_t color) {
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+	return ((color & 0x001F) << 11) | (color & 0x07E0) | ((color >> 11) & 0x001F);
+#else
+	return ((color & 0x001F) << 10) | (color & 0x83E0) | ((color >> 10) & 0x001F);
+#endif
+#else
+	return ((color & 0xFF) << 16) | (color & 0xFF00FF00) | ((color >> 16) & 0xFF);
+#endif
+}
+
 ATTRIBUTE_UNUSED static unsigned mColorMix5Bit(int weightA, unsigned colorA, int weightB, unsigned colorB) {
 	unsigned c = 0;
 	unsigned a, b;
@@ -260,26 +291,20 @@ ATTRIBUTE_UNUSED static unsigned mColorMix5Bit(int weightA, unsigned colorA, int
 	c = (c & 0x7C1F) | ((c >> 16) & 0x03E0);
 #endif
 #else
-	a = colorA & 0xFF;
-	b = colorB & 0xFF;
-	c |= ((a * weightA + b * weightB) / 16) & 0x1FF;
-	if (c & 0x00000100) {
-		c = 0x000000FF;
-	}
+	// Red and blue are mixed together, with room above each for the overflow bit
+	a = colorA & 0xFF00FF;
+	b = colorB & 0xFF00FF;
+	c = ((a * weightA + b * weightB) >> 4) & 0x1FF01FF;
+	unsigned overflow = c & 0x1000100;
+	c = (c | (overflow - (overflow >> 8))) & 0xFF00FF;
 
 	a = colorA & 0xFF00;
 	b = colorB & 0xFF00;
-	c |= ((a * weightA + b * weightB) / 16) & 0x1FF00;
-	if (c & 0x00010000) {
-		c = (c & 0x000000FF) | 0x0000FF00;
-	}
-
-	a = colorA & 0xFF0000;
-	b = colorB & 0xFF0000;
-	c |= ((a * weightA + b * weightB) / 16) & 0x1FF0000;
-	if (c & 0x01000000) {
-		c = (c & 0x0000FFFF) | 0x00FF0000;
+	unsigned g = ((a * weightA + b * weightB) / 16) & 0x1FF00;
+	if (g & 0x00010000) {
+		g = 0x0000FF00;
 	}
+	c |= g;
 #endif
 	return c;
 }
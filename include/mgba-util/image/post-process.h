@@ -0,0 +1,56 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_IMAGE_POST_PROCESS_H
+#define M_IMAGE_POST_PROCESS_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba-util/image.h>
+
+// How a handheld's LCD shows a color. Each channel is raised to inputGamma, mixed by the matrix
+// (rows are output red, green and blue), raised to 1 / outputGamma and scaled by brightness.
+struct mColorCorrection {
+	float matrix[9];
+	float inputGamma;
+	float outputGamma;
+	float brightness;
+};
+
+extern const struct mColorCorrection mCOLOR_CORRECTION_GBA;
+extern const struct mColorCorrection mCOLOR_CORRECTION_GBC;
+
+// Software color correction and interframe blending for frontends that can't do it in a shader.
+// Only the host's native color_t format is supported.
+struct mPostProcess {
+	unsigned width;
+	unsigned height;
+
+	// Indexed by the 15-bit color each output pixel was expanded from
+	color_t* colorTable;
+
+	bool interframeBlending;
+	bool hasLastFrame;
+	color_t* lastFrame;
+};
+
+void mPostProcessInit(struct mPostProcess*);
+void mPostProcessDeinit(struct mPostProcess*);
+
+void mPostProcessSetDimensions(struct mPostProcess*, unsigned width, unsigned height);
+// Pass NULL to turn color correction off
+void mPostProcessSetColorCorrection(struct mPostProcess*, const struct mColorCorrection*);
+void mPostProcessSetInterframeBlending(struct mPostProcess*, bool enable);
+
+bool mPostProcessIsActive(const struct mPostProcess*);
+// The output can be the same as the source. Frontends should still keep them apart, since the core
+// may not redraw all of the source before the next frame.
+void mPostProcessRun(struct mPostProcess*, color_t* output, size_t outputStride, const color_t* source, size_t sourceStride);
+
+CXX_GUARD_END
+
+#endif
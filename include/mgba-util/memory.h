@@ -12,6 +12,31 @@ CXX_GUARD_START
 
 void* anonymousMemoryMap(size_t size);
 void mappedMemoryFree(void* memory, size_t size);
+// Zeroes part of a block from anonymousMemoryMap. Where the platform allows it, whole pages are
+// handed back to the system and only come back once they're touched again.
+void mappedMemoryClear(void* memory, size_t size);
+// How much of part of a block from anonymousMemoryMap is backed by physical memory. Platforms that
+// can't tell report all of it.
+size_t mappedMemoryResident(const void* memory, size_t size);
+
+// A block of memory that can be mapped copy-on-write any number of times. A private mapping shares
+// its pages with the block until it writes to them, so only the pages that get touched are ever
+// duplicated. Not every platform supports this, in which case creating one fails.
+struct SharedMemory {
+	void* data;
+	size_t size;
+	intptr_t handle;
+};
+
+bool sharedMemoryCreate(struct SharedMemory*, size_t size);
+void sharedMemoryDestroy(struct SharedMemory*);
+void* sharedMemoryMapPrivate(const struct SharedMemory*);
+void sharedMemoryUnmapPrivate(const struct SharedMemory*, void* memory);
+
+// Named blocks can be opened by other processes by name while they exist, but can't be mapped
+// privately. On systems where the name outlives the block, it has to be removed separately.
+bool sharedMemoryCreateNamed(struct SharedMemory*, const char* name, size_t size);
+void sharedMemoryRemoveNamed(const char* name);
 
 CXX_GUARD_END
 
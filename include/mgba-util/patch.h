@@ -14,6 +14,9 @@ struct VFile;
 
 struct Patch {
 	struct VFile* vf;
+	// If set, applyPatch may be passed the same buffer for in and out, already holding the input,
+	// and will only write the bytes the patch changes
+	bool inPlace;
 
 	size_t (*outputSize)(struct Patch* patch, size_t inSize);
 	bool (*applyPatch)(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize);
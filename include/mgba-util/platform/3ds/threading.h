@@ -85,4 +85,10 @@ static inline void ThreadSetName(const char* name) {
 	// Unimplemented
 }
 
+static inline int ThreadSetAffinity(int cpu) {
+	UNUSED(cpu);
+	// Unimplemented
+	return -1;
+}
+
 #endif
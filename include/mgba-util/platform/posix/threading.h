@@ -104,6 +104,28 @@ static inline int ThreadSetName(const char* name) {
 #endif
 }
 
+// Pins the calling thread to one CPU, or lets it run on any if cpu is negative
+static inline int ThreadSetAffinity(int cpu) {
+#if defined(__linux__) && defined(HAVE_PTHREAD_SETAFFINITY_NP)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (cpu < 0) {
+		// CPUs that don't exist are ignored by the kernel
+		for (cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+			CPU_SET(cpu, &set);
+		}
+	} else if (cpu < CPU_SETSIZE) {
+		CPU_SET(cpu, &set);
+	} else {
+		return -1;
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	UNUSED(cpu);
+	return -1;
+#endif
+}
+
 #if (__STDC_VERSION__ < 201112L) || (__STDC_NO_THREADS__ == 1)
 typedef pthread_key_t ThreadLocal;
 
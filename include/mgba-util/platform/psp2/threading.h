@@ -121,7 +121,7 @@ static inline int _sceThreadEntry(SceSize args, void* argp) {
 }
 
 static inline int ThreadCreate(Thread* thread, ThreadEntry entry, void* context) {
-	Thread id = sceKernelCreateThread("SceThread", _sceThreadEntry, 0x10000100, 0x10000, 0, 0, 0);
+	Thread id = sceKernelCreateThread("SceThread", _sceThreadEntry, 0x10000100, 0x10000, 0, SCE_KERNEL_CPU_MASK_USER_ALL, 0);
 	if (id < 0) {
 		*thread = 0;
 		return id;
@@ -145,6 +145,18 @@ static inline int ThreadSetName(const char* name) {
 	return -1;
 }
 
+static inline int ThreadSetAffinity(int cpu) {
+	int mask = SCE_KERNEL_CPU_MASK_USER_ALL;
+	if (cpu > 2) {
+		// Only the first three cores run user threads
+		return -1;
+	}
+	if (cpu >= 0) {
+		mask = SCE_KERNEL_CPU_MASK_USER_0 << cpu;
+	}
+	return sceKernelChangeThreadCpuAffinityMask(sceKernelGetThreadId(), mask);
+}
+
 #if (__STDC_VERSION__ < 201112L) || (__STDC_NO_THREADS__ == 1)
 typedef int ThreadLocal;
 
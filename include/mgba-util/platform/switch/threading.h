@@ -85,4 +85,12 @@ static inline void ThreadSetName(const char* name) {
 	// Unimplemented
 }
 
+static inline int ThreadSetAffinity(int cpu) {
+	if (cpu < 0 || cpu > 2) {
+		// Applications only get the first three cores, and there's no way back to floating
+		return -1;
+	}
+	return R_FAILED(svcSetThreadCoreMask(CUR_THREAD_HANDLE, cpu, 1 << cpu)) ? -1 : 0;
+}
+
 #endif
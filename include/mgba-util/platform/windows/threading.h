@@ -89,6 +89,21 @@ static inline int ThreadSetName(const char* name) {
 	return -1;
 }
 
+static inline int ThreadSetAffinity(int cpu) {
+	DWORD_PTR mask;
+	if (cpu < 0) {
+		DWORD_PTR systemMask;
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &mask, &systemMask)) {
+			return -1;
+		}
+	} else if ((size_t) cpu < sizeof(mask) * 8) {
+		mask = (DWORD_PTR) 1 << cpu;
+	} else {
+		return -1;
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), mask) ? 0 : -1;
+}
+
 #if (__STDC_VERSION__ < 201112L) || (__STDC_NO_THREADS__ == 1)
 typedef DWORD ThreadLocal;
 
@@ -170,25 +170,26 @@ static inline void SocketCloseQuiet(Socket socket) {
 }
 
 static inline Socket SocketCreate(bool useIPv6, int protocol) {
+	int type = protocol == IPPROTO_UDP ? SOCK_DGRAM : SOCK_STREAM;
 	if (useIPv6) {
 #ifdef HAS_IPV6
-		return socket(AF_INET6, SOCK_STREAM, protocol);
+		return socket(AF_INET6, type, protocol);
 #else
 		errno = EAFNOSUPPORT;
 		return INVALID_SOCKET;
 #endif
 	} else {
 #ifdef GEKKO
-		return net_socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+		return net_socket(AF_INET, type, IPPROTO_IP);
 #else
-		return socket(AF_INET, SOCK_STREAM, protocol);
+		return socket(AF_INET, type, protocol);
 #endif
 	}
 }
 
-static inline Socket SocketOpenTCP(int port, const struct Address* bindAddress) {
+static inline Socket SocketOpen(int port, const struct Address* bindAddress, int protocol) {
 	bool useIPv6 = bindAddress && (bindAddress->version == IPV6);
-	Socket sock = SocketCreate(useIPv6, IPPROTO_TCP);
+	Socket sock = SocketCreate(useIPv6, protocol);
 	if (SOCKET_FAILED(sock)) {
 		return sock;
 	}
@@ -251,6 +252,86 @@ static inline Socket SocketOpenTCP(int port, const struct Address* bindAddress)
 	return sock;
 }
 
+static inline Socket SocketOpenTCP(int port, const struct Address* bindAddress) {
+	return SocketOpen(port, bindAddress, IPPROTO_TCP);
+}
+
+static inline Socket SocketOpenUDP(int port, const struct Address* bindAddress) {
+	return SocketOpen(port, bindAddress, IPPROTO_UDP);
+}
+
+static inline ssize_t SocketSendTo(Socket socket, const void* buffer, size_t size, const struct Address* address, int port) {
+	if (address->version == IPV4) {
+		struct sockaddr_in addrInfo;
+		memset(&addrInfo, 0, sizeof(addrInfo));
+		addrInfo.sin_family = AF_INET;
+		addrInfo.sin_port = htons(port);
+		addrInfo.sin_addr.s_addr = htonl(address->ipv4);
+#ifdef _WIN32
+		return sendto(socket, (const char*) buffer, size, 0, (const struct sockaddr*) &addrInfo, sizeof(addrInfo));
+#elif defined(GEKKO)
+		return net_sendto(socket, buffer, size, 0, (struct sockaddr*) &addrInfo, sizeof(addrInfo));
+#else
+		return sendto(socket, buffer, size, 0, (const struct sockaddr*) &addrInfo, sizeof(addrInfo));
+#endif
+	}
+#ifdef HAS_IPV6
+	struct sockaddr_in6 addrInfo;
+	memset(&addrInfo, 0, sizeof(addrInfo));
+	addrInfo.sin6_family = AF_INET6;
+	addrInfo.sin6_port = htons(port);
+	memcpy(addrInfo.sin6_addr.s6_addr, address->ipv6, sizeof(addrInfo.sin6_addr.s6_addr));
+#ifdef _WIN32
+	return sendto(socket, (const char*) buffer, size, 0, (const struct sockaddr*) &addrInfo, sizeof(addrInfo));
+#else
+	return sendto(socket, buffer, size, 0, (const struct sockaddr*) &addrInfo, sizeof(addrInfo));
+#endif
+#else
+	return -1;
+#endif
+}
+
+static inline ssize_t SocketRecvFrom(Socket socket, void* buffer, size_t size, struct Address* address, int* port) {
+	union {
+		struct sockaddr_in ipv4;
+#ifdef HAS_IPV6
+		struct sockaddr_in6 ipv6;
+#endif
+	} addrInfo;
+	memset(&addrInfo, 0, sizeof(addrInfo));
+	socklen_t len = sizeof(addrInfo);
+#ifdef _WIN32
+	ssize_t result = recvfrom(socket, (char*) buffer, size, 0, (struct sockaddr*) &addrInfo, &len);
+#elif defined(GEKKO)
+	ssize_t result = net_recvfrom(socket, buffer, size, 0, (struct sockaddr*) &addrInfo, &len);
+#else
+	ssize_t result = recvfrom(socket, buffer, size, 0, (struct sockaddr*) &addrInfo, &len);
+#endif
+	if (result < 0) {
+		return result;
+	}
+	if (addrInfo.ipv4.sin_family == AF_INET) {
+		if (address) {
+			address->version = IPV4;
+			address->ipv4 = ntohl(addrInfo.ipv4.sin_addr.s_addr);
+		}
+		if (port) {
+			*port = ntohs(addrInfo.ipv4.sin_port);
+		}
+#ifdef HAS_IPV6
+	} else if (addrInfo.ipv6.sin6_family == AF_INET6) {
+		if (address) {
+			address->version = IPV6;
+			memcpy(address->ipv6, addrInfo.ipv6.sin6_addr.s6_addr, sizeof(address->ipv6));
+		}
+		if (port) {
+			*port = ntohs(addrInfo.ipv6.sin6_port);
+		}
+#endif
+	}
+	return result;
+}
+
 static inline Socket SocketConnectTCP(int port, const struct Address* destinationAddress) {
 	bool useIPv6 = destinationAddress && (destinationAddress->version == IPV6);
 	Socket sock = SocketCreate(useIPv6, IPPROTO_TCP);
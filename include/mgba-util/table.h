@@ -10,7 +10,7 @@
 
 CXX_GUARD_START
 
-struct TableList;
+struct TableTuple;
 typedef uint32_t (*HashFunction)(const void* key, size_t len, uint32_t seed);
 
 struct TableFunctions {
@@ -22,7 +22,7 @@ struct TableFunctions {
 };
 
 struct Table {
-	struct TableList* table;
+	struct TableTuple* table;
 	size_t tableSize;
 	size_t size;
 	uint32_t seed;
@@ -30,8 +30,7 @@ struct Table {
 };
 
 struct TableIterator {
-	size_t bucket;
-	size_t entry;
+	size_t slot;
 };
 
 void TableInit(struct Table*, size_t initialSize, void (*deinitializer)(void*));
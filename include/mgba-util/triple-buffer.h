@@ -0,0 +1,39 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+// Hands off whole buffers from one producer thread to one consumer thread without locking.
+// Neither side ever waits: the producer always has a buffer to write into, and the
+// consumer always gets the most recently published one, skipping any it didn't get to.
+struct TripleBuffer {
+	void* buffers[3];
+	size_t size;
+	int back;
+	int front;
+	int middle;
+};
+
+void TripleBufferInit(struct TripleBuffer* buffer, size_t size);
+void TripleBufferDeinit(struct TripleBuffer* buffer);
+size_t TripleBufferCapacity(const struct TripleBuffer* buffer);
+void TripleBufferClear(struct TripleBuffer* buffer);
+
+// Only to be called from the producer
+void* TripleBufferBack(struct TripleBuffer* buffer);
+void TripleBufferPublish(struct TripleBuffer* buffer);
+
+// Only to be called from the consumer; the front buffer stays valid until the next acquire
+bool TripleBufferAcquire(struct TripleBuffer* buffer);
+const void* TripleBufferFront(const struct TripleBuffer* buffer);
+
+CXX_GUARD_END
+
+#endif
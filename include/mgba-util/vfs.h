@@ -47,6 +47,7 @@ struct VFile {
 	void (*unmap)(struct VFile* vf, void* memory, size_t size);
 	void (*truncate)(struct VFile* vf, size_t size);
 	ssize_t (*size)(struct VFile* vf);
+	// The buffer may be a whole mapping returned by map or any range within it
 	bool (*sync)(struct VFile* vf, void* buffer, size_t size);
 };
 
@@ -0,0 +1,57 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_AUDIO_RESAMPLER_H
+#define M_AUDIO_RESAMPLER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+struct mStereoSample;
+
+enum mAudioResamplerQuality {
+	mAUDIO_RESAMPLER_LOW = 1,
+	mAUDIO_RESAMPLER_MEDIUM = 2,
+	mAUDIO_RESAMPLER_HIGH = 3,
+};
+
+// A polyphase windowed-sinc resampler for stereo audio. Input is pushed in and output pulled out a
+// buffer at a time; output lags input by half the kernel width.
+struct mAudioResampler {
+	enum mAudioResamplerQuality quality;
+	unsigned taps;
+	unsigned phases;
+	// phases + 1 rows of taps coefficients each, in 1.15 fixed point
+	int16_t* kernel;
+	unsigned cutoff;
+
+	double inputRate;
+	double outputRate;
+	// Both in input samples, as 32.32 fixed point. The position is relative to the oldest sample in
+	// the history.
+	uint64_t step;
+	uint64_t position;
+
+	int16_t* left;
+	int16_t* right;
+	size_t size;
+	size_t capacity;
+};
+
+// capacity is the most input samples that can be buffered at once
+void mAudioResamplerInit(struct mAudioResampler*, enum mAudioResamplerQuality, size_t capacity);
+void mAudioResamplerDeinit(struct mAudioResampler*);
+void mAudioResamplerSetRates(struct mAudioResampler*, double inputRate, double outputRate);
+void mAudioResamplerClear(struct mAudioResampler*);
+
+// Returns how many samples were accepted
+size_t mAudioResamplerPush(struct mAudioResampler*, const struct mStereoSample* samples, size_t count);
+size_t mAudioResamplerAvailable(const struct mAudioResampler*);
+size_t mAudioResamplerPull(struct mAudioResampler*, struct mStereoSample* samples, size_t count);
+
+CXX_GUARD_END
+
+#endif
@@ -0,0 +1,73 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_AV_BUFFER_H
+#define M_AV_BUFFER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/interface.h>
+#include <mgba-util/threading.h>
+
+struct mAVBufferPool;
+
+// A finished video frame along with the audio generated while it was being drawn. Buffers are
+// reference counted, so consumers can hold onto them for as long as they need.
+struct mAVBuffer {
+	struct mAVBufferPool* pool;
+	unsigned refs;
+
+	color_t* pixels;
+	size_t stride;
+	unsigned width;
+	unsigned height;
+
+	struct mStereoSample* samples;
+	size_t nSamples;
+	size_t sampleCapacity;
+
+	// The core's frame counter and global cycle count at the end of the frame
+	uint32_t frame;
+	uint64_t cycles;
+};
+
+struct mAVBufferPool {
+	Mutex mutex;
+	struct mAVBuffer* buffers;
+	size_t nBuffers;
+	size_t stride;
+	unsigned height;
+	size_t next;
+	// Frames that couldn't be handed out because every buffer was still in use
+	size_t dropped;
+};
+
+// Each buffer must be large enough to hold the largest frame the core can produce
+void mAVBufferPoolInit(struct mAVBufferPool*, size_t buffers, size_t stride, unsigned height, size_t samples);
+void mAVBufferPoolDeinit(struct mAVBufferPool*);
+
+// Returns an unused buffer with a single reference held by the caller, or NULL if none are free
+struct mAVBuffer* mAVBufferPoolAcquire(struct mAVBufferPool*);
+void mAVBufferRef(struct mAVBuffer*);
+void mAVBufferUnref(struct mAVBuffer*);
+
+static inline void mAVBufferPushSample(struct mAVBuffer* buffer, int16_t left, int16_t right) {
+	if (buffer->nSamples < buffer->sampleCapacity) {
+		buffer->samples[buffer->nSamples].left = left;
+		buffer->samples[buffer->nSamples].right = right;
+		++buffer->nSamples;
+	}
+}
+
+// Used by cores once a frame has been drawn into current. The frame is tagged and passed on to the
+// stream's postVideoBuffer, and the buffer to draw the next frame into is returned. If the pool has
+// run dry the frame is dropped instead, and current is returned to be drawn over.
+struct mAVBuffer* mAVStreamSwapBuffer(struct mAVStream*, struct mAVBuffer* current, unsigned width, unsigned height, uint32_t frame, uint64_t cycles);
+
+CXX_GUARD_END
+
+#endif
@@ -0,0 +1,93 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_BATCH_H
+#define M_CORE_BATCH_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba-util/vector.h>
+#if !defined(DISABLE_THREADING) && !defined(OPAQUE_THREADING)
+#include <mgba-util/threading.h>
+#endif
+
+struct blip_t;
+struct mCore;
+struct mCoreBatch;
+
+struct mCoreBatchOutput {
+	const void* pixels;
+	size_t stride;
+	struct blip_t* audio[2];
+};
+
+DECLARE_VECTOR(mCoreBatchCores, struct mCore*);
+DECLARE_VECTOR(mCoreBatchOutputs, struct mCoreBatchOutput);
+
+// Bindings that can't see the threading primitives only get to use a batch through pointers
+#ifndef OPAQUE_THREADING
+struct mCoreBatch {
+	struct mCoreBatchCores cores;
+	struct mCoreBatchOutputs outputs;
+	unsigned frames;
+	bool resetting;
+	bool stableAffinity;
+
+#ifndef DISABLE_THREADING
+	Thread* workers;
+	size_t nWorkers;
+	Mutex mutex;
+	Condition workCond;
+	Condition doneCond;
+	unsigned generation;
+	size_t activeWorkers;
+	int nextCore;
+	int nextWorkerId;
+	int firstCpu;
+	bool quit;
+#endif
+};
+#endif
+
+void mCoreBatchInit(struct mCoreBatch*, size_t workers);
+void mCoreBatchDeinit(struct mCoreBatch*);
+
+size_t mCoreBatchAddCore(struct mCoreBatch*, struct mCore*);
+// Takes every core out of the batch without deinitializing them, so a different set of cores
+// can be run on the same workers
+void mCoreBatchClear(struct mCoreBatch*);
+size_t mCoreBatchSize(const struct mCoreBatch*);
+struct mCore* mCoreBatchGetCore(struct mCoreBatch*, size_t index);
+
+// Gives every core a fixed thread to run on, so its memory stays in that thread's caches from one
+// call to the next. The cores are split into contiguous blocks, one per thread, with the calling
+// thread taking the first. This can leave threads idle while slower cores finish, so by default
+// each core is instead taken by whichever thread is free first.
+void mCoreBatchSetStableAffinity(struct mCoreBatch*, bool stable);
+
+// Pins worker N to CPU firstCpu + N, or lets them run anywhere again if firstCpu is negative,
+// which is the default. This also turns on stable affinity. The calling thread isn't touched; it
+// runs the first block of cores, so pin it to firstCpu as well for the full effect.
+void mCoreBatchPinWorkers(struct mCoreBatch*, int firstCpu);
+
+// Resets every core on the thread that runs it. Memory is usually placed on the NUMA node of the
+// CPU that first touches it, so with pinned workers this keeps each core's memory local to the
+// CPU running it. The "slim" option releases much of a core's memory on reset, so with it this
+// also moves cores that were already reset somewhere else.
+void mCoreBatchReset(struct mCoreBatch*);
+
+// Sets the keys for every core at once; keys has one entry per core, in the order they were added
+void mCoreBatchSetKeys(struct mCoreBatch*, const uint32_t* keys);
+
+// Runs every core in the batch for the given number of frames, rendering only the last one. The
+// returned array has one entry per core, in the order they were added, and stays valid until the
+// next call.
+const struct mCoreBatchOutput* mCoreBatchRunFrames(struct mCoreBatch*, unsigned frames);
+
+CXX_GUARD_END
+
+#endif
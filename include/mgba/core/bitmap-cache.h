@@ -53,6 +53,7 @@ void mBitmapCacheDeinit(struct mBitmapCache* cache);
 void mBitmapCacheConfigure(struct mBitmapCache* cache, mBitmapCacheConfiguration config);
 void mBitmapCacheConfigureSystem(struct mBitmapCache* cache, mBitmapCacheSystemInfo config);
 void mBitmapCacheWriteVRAM(struct mBitmapCache* cache, uint32_t address);
+void mBitmapCacheWriteVRAMRange(struct mBitmapCache* cache, uint32_t address, uint32_t length);
 void mBitmapCacheWritePalette(struct mBitmapCache* cache, uint32_t entry, color_t color);
 
 void mBitmapCacheCleanRow(struct mBitmapCache* cache, struct mBitmapCacheEntry* entry, unsigned y);
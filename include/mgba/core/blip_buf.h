@@ -18,6 +18,11 @@ so that there are blip_max_ratio clocks per sample. Returns pointer to new
 buffer, or NULL if insufficient memory. */
 blip_t* blip_new( int sample_count );
 
+/** Changes how many samples the buffer can hold, keeping its rates, and clears
+it. Returns pointer to the resized buffer, or NULL if insufficient memory, in
+which case the original buffer is left unchanged. */
+blip_t* blip_resize( blip_t*, int sample_count );
+
 /** Sets approximate input clock rate and output sample rate. For every
 clock_rate input clocks, approximately sample_rate samples are generated. */
 void blip_set_rates( blip_t*, double clock_rate, double sample_rate );
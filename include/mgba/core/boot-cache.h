@@ -0,0 +1,46 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_BOOT_CACHE_H
+#define M_CORE_BOOT_CACHE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#define M_BOOT_CACHE_NAME_LENGTH 32
+
+struct mCore;
+struct VDir;
+
+// Keeps a savestate of each game once it has booted, so launching it again can skip the BIOS
+// intro and the game's own startup. Entries are keyed by the ROM, the BIOS, the config and the
+// save data, so a change to any of them makes a new entry instead of restoring a stale one.
+struct mBootCache {
+	struct mCore* core;
+	struct VDir* dir;
+	// Frames after reset to take the state at, or 0 to take it after the first input poll
+	unsigned frame;
+
+	char name[M_BOOT_CACHE_NAME_LENGTH];
+	bool pending;
+	bool keysRead;
+	bool ready;
+	unsigned framesElapsed;
+	uint32_t startFrame;
+};
+
+// Adds core callbacks that point at the cache, so it must outlive them. The cache takes
+// ownership of the directory.
+void mBootCacheInit(struct mBootCache*, struct mCore*, struct VDir* dir, unsigned frame);
+void mBootCacheDeinit(struct mBootCache*);
+
+// Call right after resetting the core. Returns true if a cached state was loaded; otherwise
+// one is stored once the game gets far enough, unless a state is loaded before then.
+bool mBootCacheRestore(struct mBootCache*);
+
+CXX_GUARD_END
+
+#endif
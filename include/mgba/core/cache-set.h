@@ -31,6 +31,7 @@ void mCacheSetDeinit(struct mCacheSet*);
 void mCacheSetAssignVRAM(struct mCacheSet*, void* vram);
 
 void mCacheSetWriteVRAM(struct mCacheSet*, uint32_t address);
+void mCacheSetWriteVRAMRange(struct mCacheSet*, uint32_t address, uint32_t length);
 void mCacheSetWritePalette(struct mCacheSet*, uint32_t entry, color_t color);
 
 CXX_GUARD_END
@@ -46,6 +46,17 @@ struct mCheat {
 	int32_t operandOffset;
 };
 
+// A single step of a compiled cheat set; short repeated codes are unrolled into one op per write
+struct mCheatOp {
+	enum mCheatType type;
+	int width;
+	uint32_t address;
+	uint32_t operand;
+	uint32_t repeat;
+	// Index of the code in the set's list this op came from
+	size_t code;
+};
+
 struct mCheatPatch {
 	uint32_t address;
 	int segment;
@@ -59,6 +70,7 @@ struct mCheatPatch {
 mLOG_DECLARE_CATEGORY(CHEATS);
 
 DECLARE_VECTOR(mCheatList, struct mCheat);
+DECLARE_VECTOR(mCheatOpList, struct mCheatOp);
 DECLARE_VECTOR(mCheatPatchList, struct mCheatPatch);
 
 struct mCheatDevice;
@@ -81,6 +93,11 @@ struct mCheatSet {
 	bool enabled;
 	struct mCheatPatchList romPatches;
 	struct StringList lines;
+
+	// Compiled from list on the next refresh after it changes
+	struct mCheatOpList ops;
+	size_t compiledCodes;
+	bool recompile;
 };
 
 DECLARE_VECTOR(mCheatSets, struct mCheatSet*);
@@ -108,6 +125,7 @@ void mCheatSetDeinit(struct mCheatSet*);
 void mCheatSetRename(struct mCheatSet*, const char* name);
 
 bool mCheatAddLine(struct mCheatSet*, const char* line, int type);
+void mCheatSetInvalidate(struct mCheatSet*);
 
 void mCheatAddSet(struct mCheatDevice*, struct mCheatSet*);
 void mCheatRemoveSet(struct mCheatDevice*, struct mCheatSet*);
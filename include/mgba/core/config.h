@@ -34,9 +34,15 @@ struct mCoreOptions {
 	bool rewindEnable;
 	int rewindBufferCapacity;
 	int rewindBufferInterval;
+	int rewindBufferMemory; // In KiB, 0 for no limit
+	int rewindSpeed; // States to go back per frame while rewinding, 0 for 1
+	int runAhead;
 	float fpsTarget;
 	size_t audioBuffers;
 	unsigned sampleRate;
+	float audioRateControl;
+	// 0 to use the blip buffers alone, or an mAudioResamplerQuality
+	unsigned audioResampler;
 
 	int fullscreen;
 	int width;
@@ -56,9 +62,13 @@ struct mCoreOptions {
 
 	int volume;
 	bool mute;
+	// Unlike mute, this stops audio from being generated at all
+	bool disableAudio;
 
 	bool videoSync;
 	bool audioSync;
+	// Start each frame as late as it can be while still being ready for the display
+	bool framePacing;
 };
 
 void mCoreConfigInit(struct mCoreConfig*, const char* port);
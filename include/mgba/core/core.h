@@ -36,6 +36,7 @@ struct mCoreConfig;
 struct mCoreSync;
 struct mDebuggerSymbols;
 struct mStateExtdata;
+struct mStateSection;
 struct mVideoLogContext;
 struct mCore {
 	void* cpu;
@@ -74,13 +75,21 @@ struct mCore {
 
 	void (*setVideoBuffer)(struct mCore*, color_t* buffer, size_t stride);
 	void (*setVideoGLTex)(struct mCore*, unsigned texid);
+	// Picks the format the video buffer is drawn in. Only mCOLOR_NATIVE and mCOLOR_NATIVE_SWAPPED
+	// are supported, and highlight colors are taken to be in the same format. Takes effect on reset.
+	bool (*setVideoFormat)(struct mCore*, enum mColorFormat format);
 
 	void (*getPixels)(struct mCore*, const void** buffer, size_t* stride);
 	void (*putPixels)(struct mCore*, const void* buffer, size_t stride);
+	// Fills in one bit per row of the current video size, rounded up to whole words, for each row
+	// that may have changed since the last call. Returns false if none did.
+	bool (*getChangedScanlines)(struct mCore*, uint32_t* scanlines);
 
 	struct blip_t* (*getAudioChannel)(struct mCore*, int ch);
 	void (*setAudioBufferSize)(struct mCore*, size_t samples);
 	size_t (*getAudioBufferSize)(struct mCore*);
+	// The rate the core generates samples at internally, before they're resampled into its buffers
+	unsigned (*audioSampleRate)(const struct mCore*);
 
 	void (*addCoreCallbacks)(struct mCore*, struct mCoreCallbacks*);
 	void (*clearCoreCallbacks)(struct mCore*);
@@ -103,10 +112,38 @@ struct mCore {
 	void (*runFrame)(struct mCore*);
 	void (*runLoop)(struct mCore*);
 	void (*step)(struct mCore*);
+	// Emulation is unaffected, but the next frames aren't rendered or posted to the sync object,
+	// or don't produce any audio, respectively. Useful for frames that will never be shown.
+	// Memory writes are still tracked, so the first frame after skipping is rendered correctly.
+	void (*skipVideoFrames)(struct mCore*, unsigned frames);
+	void (*skipAudioFrames)(struct mCore*, unsigned frames);
 
 	size_t (*stateSize)(struct mCore*);
 	bool (*loadState)(struct mCore*, const void* state);
 	bool (*saveState)(struct mCore*, void* state);
+	// Like saveState, but state must be a buffer previously filled by this core. Only memory that
+	// changed since the buffer's epoch is copied, and the epoch is updated. An epoch of 0 forces a
+	// full save. The resulting buffer is identical to what saveState would produce.
+	bool (*saveStateIncremental)(struct mCore*, void* state, uint32_t* epoch);
+	// Splits the state buffer into contiguous sections (CPU, IO, VRAM, etc.) that chunked savestates
+	// compress and hash separately. Returns 0 if the state should be treated as one section.
+	size_t (*listStateSections)(const struct mCore*, const struct mStateSection**);
+	// Creates a new core running the same game from the same point, without going through a
+	// savestate file. The ROM is shared rather than copied where possible, and save data is copied
+	// into memory, so the two cores never affect each other. The clone gets this core's config,
+	// BIOS and RTC source, but no video buffer, callbacks, AV stream, debugger or cheats, so it
+	// doesn't draw frames. It's freed like any other core. Returns NULL on failure.
+	struct mCore* (*clone)(struct mCore*);
+	// How much memory this core holds, in bytes, counting only pages that are resident where the
+	// platform can tell. Memory shared with other cores, such as a ROM image from a registry,
+	// a memory-mapped file or the built-in BIOS, isn't counted.
+	size_t (*memoryUsage)(struct mCore*);
+	// A 64-bit hash of the CPU registers and all memory the game can write, for spotting cores
+	// that have drifted apart, such as netplay peers or two runs of the same replay. It's cheap
+	// enough to take every frame: where the core tracks which RAM pages were written, only those
+	// are hashed again. Hashes only match between cores of the same version on hosts with the
+	// same byte order.
+	uint64_t (*stateHash)(struct mCore*);
 
 	void (*setKeys)(struct mCore*, uint32_t keys);
 	void (*addKeys)(struct mCore*, uint32_t keys);
@@ -141,6 +178,15 @@ struct mCore {
 
 	size_t (*listMemoryBlocks)(const struct mCore*, const struct mCoreMemoryBlock**);
 	void* (*getMemoryBlock)(struct mCore*, size_t id, size_t* sizeOut);
+	// Reports stores that land in any of the given bus address ranges (exclusive on the end) to the
+	// watcher. Only pages covering a range leave the fast path, so this costs next to nothing for
+	// accesses elsewhere. Passing a NULL watcher removes it. Returns false if unsupported.
+	bool (*setMemoryWatcher)(struct mCore*, struct mCoreMemoryWatcher*, const struct mCoreMemoryWatchRange* ranges, size_t nRanges);
+	// Counts data accesses, including DMA, per memory region. While enabled nothing takes the fast
+	// path, so emulation is noticeably slower. Enabling clears the counts. Returns false if unsupported.
+	bool (*setMemoryStatsEnabled)(struct mCore*, bool enable);
+	// Copies up to max regions into stats and returns how many there are, or 0 if disabled.
+	size_t (*memoryStats)(struct mCore*, struct mCoreMemoryStats* stats, size_t max);
 
 	size_t (*listRegisters)(const struct mCore*, const struct mCoreRegisterInfo**);
 	bool (*readRegister)(const struct mCore*, const char* name, void* out);
@@ -155,6 +201,8 @@ struct mCore {
 
 	void (*loadSymbols)(struct mCore*, struct VFile*);
 	bool (*lookupIdentifier)(struct mCore*, const char* name, int32_t* value, int* segment);
+	// The address of the instruction being executed, cheap enough to call from a timing event
+	void (*currentPC)(struct mCore*, uint32_t* address, int* segment);
 #endif
 
 	struct mCheatDevice* (*cheatDevice)(struct mCore*);
@@ -0,0 +1,52 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_DIRTY_TRACKER_H
+#define M_CORE_DIRTY_TRACKER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#define mDIRTY_TRACKER_MAX_REGIONS 8
+
+struct mDirtyTrackerRegion {
+	const void* data;
+	size_t size;
+	// Copy of data as of the last update, only kept while the region is watched
+	void* shadow;
+	int watchers;
+	int generation;
+};
+
+// Notices when regions of emulated memory, e.g. palette or OAM, change, so that viewers of them can
+// skip redrawing while they hold still. Rather than hooking every write, regions are compared
+// against a copy once per update, so it doesn't matter how a change was made. Only regions that
+// something is watching are compared.
+struct mDirtyTracker {
+	struct mDirtyTrackerRegion regions[mDIRTY_TRACKER_MAX_REGIONS];
+	size_t nRegions;
+};
+
+void mDirtyTrackerInit(struct mDirtyTracker*);
+void mDirtyTrackerDeinit(struct mDirtyTracker*);
+
+// Returns the region's index, which is also its bit in the masks below, or -1 if there's no room
+int mDirtyTrackerAddRegion(struct mDirtyTracker*, const void* data, size_t size);
+
+// Watching and unwatching may be done from any thread. They nest, so each watch needs an unwatch.
+void mDirtyTrackerWatch(struct mDirtyTracker*, int region);
+void mDirtyTrackerUnwatch(struct mDirtyTracker*, int region);
+
+// Must be called from the thread that writes to the regions, e.g. once at the end of every frame.
+// Returns a mask of the watched regions that changed since the last update. Viewers should draw once
+// when they start watching, as nothing is reported until there's a copy to compare against.
+uint32_t mDirtyTrackerUpdate(struct mDirtyTracker*);
+// Bumped whenever an update finds the region changed; may be read from any thread
+uint32_t mDirtyTrackerGeneration(struct mDirtyTracker*, int region);
+
+CXX_GUARD_END
+
+#endif
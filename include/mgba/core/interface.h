@@ -17,6 +17,8 @@ struct mCore;
 struct mStateExtdataItem;
 
 struct blip_t;
+struct mAVBuffer;
+struct mAVBufferPool;
 
 enum mCoreFeature {
 	mCORE_FEATURE_OPENGL = 1,
@@ -40,8 +42,17 @@ struct mAVStream {
 	void (*videoDimensionsChanged)(struct mAVStream*, unsigned width, unsigned height);
 	void (*audioRateChanged)(struct mAVStream*, unsigned rate);
 	void (*postVideoFrame)(struct mAVStream*, const color_t* buffer, size_t stride);
+	// Called instead of postVideoFrame, if set, when the frame is known to match the last one posted
+	void (*postVideoFrameRepeat)(struct mAVStream*, const color_t* buffer, size_t stride);
 	void (*postAudioFrame)(struct mAVStream*, int16_t left, int16_t right);
 	void (*postAudioBuffer)(struct mAVStream*, struct blip_t* left, struct blip_t* right);
+
+	// If both are set, the core draws straight into buffers taken from the pool rather than its own
+	// video buffer, and hands each one to postVideoBuffer once the frame is done, along with the
+	// audio from that frame. postVideoBuffer is passed a reference that must be released with
+	// mAVBufferUnref when the stream is done with the buffer.
+	struct mAVBufferPool* bufferPool;
+	void (*postVideoBuffer)(struct mAVStream*, struct mAVBuffer*);
 };
 
 struct mStereoSample {
@@ -99,6 +110,11 @@ struct mRTCGenericSource {
 	enum mRTCGenericType override;
 	int64_t value;
 	struct mRTCSource* custom;
+
+	// The host clock is only read once per emulated frame
+	time_t hostTime;
+	uint32_t hostTimeFrame;
+	bool hostTimeValid;
 };
 
 struct mRTCGenericState {
@@ -142,6 +158,28 @@ struct mCoreMemoryBlock {
 	uint32_t segmentStart;
 };
 
+struct mCoreMemoryWatchRange {
+	uint32_t start;
+	uint32_t end;
+};
+
+struct mCoreMemoryWatcher {
+	// Called from inside the store, so this must not run the core or touch its state
+	void (*written)(struct mCoreMemoryWatcher*, uint32_t address, int width, uint32_t value);
+};
+
+struct mCoreMemoryStats {
+	const char* name;
+	uint32_t start;
+	uint32_t end;
+	uint64_t reads;
+	uint64_t writes;
+	// Cycles the accesses added to the CPU, including stalls and less any prefetch savings
+	uint64_t waitCycles;
+	// Opcode fetches from this region that the prefetcher completed during data accesses
+	uint64_t prefetchHits;
+};
+
 struct mCoreScreenRegion {
 	size_t id;
 	const char* description;
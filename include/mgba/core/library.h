@@ -24,9 +24,20 @@ struct mLibraryEntry {
 	uint32_t crc32;
 };
 
+// An idle loop found by the runtime detector. Confidence is how many sessions in a row found the
+// same address.
+struct mLibraryIdleLoop {
+	char internalCode[9];
+	enum mPlatform platform;
+	uint32_t crc32;
+	uint32_t address;
+	unsigned confidence;
+};
+
 #ifdef USE_SQLITE3
 
 DECLARE_VECTOR(mLibraryListing, struct mLibraryEntry);
+DECLARE_VECTOR(mLibraryIdleLoopList, struct mLibraryIdleLoop);
 
 struct mLibrary;
 struct mLibrary* mLibraryCreateEmpty(void);
@@ -43,6 +54,11 @@ size_t mLibraryGetEntries(struct mLibrary* library, struct mLibraryListing* out,
 void mLibraryEntryFree(struct mLibraryEntry* entry);
 struct VFile* mLibraryOpenVFile(struct mLibrary* library, const struct mLibraryEntry* entry);
 
+// Finding the same loop again raises its confidence, while finding a different one starts over
+void mLibraryAddIdleLoop(struct mLibrary* library, const struct mLibraryIdleLoop* loop);
+bool mLibraryFindIdleLoop(struct mLibrary* library, enum mPlatform platform, uint32_t crc32, struct mLibraryIdleLoop* out);
+size_t mLibraryGetIdleLoops(struct mLibrary* library, struct mLibraryIdleLoopList* out, unsigned minConfidence);
+
 struct NoIntroDB;
 void mLibraryAttachGameDB(struct mLibrary* library, const struct NoIntroDB* db);
 
@@ -24,11 +24,22 @@ enum mLogLevel {
 	mLOG_ALL = 0x7F
 };
 
+#define mLOG_MAX_CATEGORIES 64
+
+// Levels not in this mask are compiled out of mLOG entirely, e.g. -DmLOG_COMPILED_LEVELS=0x0F
+#ifndef mLOG_COMPILED_LEVELS
+#define mLOG_COMPILED_LEVELS mLOG_ALL
+#endif
+
 struct Table;
 struct mLogFilter {
 	int defaultLevels;
 	struct Table categories;
 	struct Table levels;
+
+	// Flattened copy of the per-category overrides, rebuilt whenever they change
+	int cachedCategories;
+	uint8_t cachedLevels[mLOG_MAX_CATEGORIES];
 };
 
 struct mLogger {
@@ -63,13 +74,19 @@ void mLogFilterReset(struct mLogFilter*, const char* category);
 bool mLogFilterTest(const struct mLogFilter*, int category, enum mLogLevel level);
 int mLogFilterLevels(const struct mLogFilter*, int category);
 
+bool mLogWillLog(int category, enum mLogLevel level);
+
 ATTRIBUTE_FORMAT(printf, 3, 4)
 void mLog(int category, enum mLogLevel level, const char* format, ...);
 
 ATTRIBUTE_FORMAT(printf, 4, 5)
 void mLogExplicit(struct mLogger*, int category, enum mLogLevel level, const char* format, ...);
 
-#define mLOG(CATEGORY, LEVEL, ...) mLog(_mLOG_CAT_ ## CATEGORY, mLOG_ ## LEVEL, __VA_ARGS__)
+#define mLOG(CATEGORY, LEVEL, ...) do { \
+		if ((mLOG_ ## LEVEL & mLOG_COMPILED_LEVELS) && mLogWillLog(_mLOG_CAT_ ## CATEGORY, mLOG_ ## LEVEL)) { \
+			mLog(_mLOG_CAT_ ## CATEGORY, mLOG_ ## LEVEL, __VA_ARGS__); \
+		} \
+	} while (0)
 
 #define mLOG_DECLARE_CATEGORY(CATEGORY) extern int _mLOG_CAT_ ## CATEGORY;
 #define mLOG_DEFINE_CATEGORY(CATEGORY, NAME, ID) \
@@ -68,6 +68,7 @@ void mMapCacheConfigure(struct mMapCache* cache, mMapCacheConfiguration config);
 void mMapCacheConfigureSystem(struct mMapCache* cache, mMapCacheSystemInfo config);
 void mMapCacheConfigureMap(struct mMapCache* cache, uint32_t mapStart);
 void mMapCacheWriteVRAM(struct mMapCache* cache, uint32_t address);
+void mMapCacheWriteVRAMRange(struct mMapCache* cache, uint32_t address, uint32_t length);
 
 uint32_t mMapCacheTileId(struct mMapCache* cache, unsigned x, unsigned y);
 
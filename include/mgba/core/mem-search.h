@@ -53,10 +53,43 @@ struct mCoreMemorySearchResult {
 
 DECLARE_VECTOR(mCoreMemorySearchResults, struct mCoreMemorySearchResult);
 
+struct mCoreMemoryBlock;
+struct mCoreMemorySearchSnapshotBlock {
+	const struct mCoreMemoryBlock* block;
+	uint8_t* data;
+	uint8_t* candidates;
+	size_t size;
+};
+
+DECLARE_VECTOR(mCoreMemorySearchSnapshotBlocks, struct mCoreMemorySearchSnapshotBlock);
+
+// A copy of searchable memory for narrowing down values that aren't known up front. Every aligned
+// element starts out as a candidate; each refinement compares live memory against the copy, drops
+// the candidates that don't match, and then updates the copy.
+struct mCoreMemorySearchSnapshot {
+	struct mCoreMemorySearchSnapshotBlocks blocks;
+	int width;
+	size_t candidates;
+};
+
+// Called periodically with how much of the search is done, in arbitrary units out of total.
+// Returning false stops the search early, leaving the results incomplete.
+typedef bool (*mCoreMemorySearchProgress)(void* context, size_t done, size_t total);
+
 struct mCore;
 void mCoreMemorySearch(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* out, size_t limit);
 void mCoreMemorySearchRepeat(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* inout);
 
+bool mCoreMemorySearchWithProgress(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* out, size_t limit, mCoreMemorySearchProgress progress, void* context);
+
+bool mCoreMemorySearchRepeatWithProgress(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* inout, mCoreMemorySearchProgress progress, void* context);
+
+void mCoreMemorySearchSnapshotInit(struct mCoreMemorySearchSnapshot* snapshot);
+void mCoreMemorySearchSnapshotDeinit(struct mCoreMemorySearchSnapshot* snapshot);
+size_t mCoreMemorySearchSnapshotTake(struct mCore* core, struct mCoreMemorySearchSnapshot* snapshot, int memoryFlags, int width);
+size_t mCoreMemorySearchSnapshotRefine(struct mCore* core, struct mCoreMemorySearchSnapshot* snapshot, enum mCoreMemorySearchOp op, int32_t value);
+size_t mCoreMemorySearchSnapshotResults(const struct mCoreMemorySearchSnapshot* snapshot, struct mCoreMemorySearchResults* out, size_t limit);
+
 CXX_GUARD_END
 
 #endif
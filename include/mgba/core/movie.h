@@ -0,0 +1,71 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_MOVIE_H
+#define M_CORE_MOVIE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba-util/vector.h>
+
+#define mMOVIE_DEFAULT_KEYFRAME_INTERVAL 300
+
+enum mMovieMode {
+	mMOVIE_IDLE = 0,
+	mMOVIE_RECORDING,
+	mMOVIE_PLAYING,
+};
+
+// A chunked savestate taken before running frame, stored at offset in the movie file
+struct mMovieKeyframe {
+	uint32_t frame;
+	uint32_t offset;
+	uint32_t size;
+};
+
+DECLARE_VECTOR(mMovieKeyframeList, struct mMovieKeyframe);
+
+struct mCore;
+struct VFile;
+struct mMovie {
+	struct mCore* core;
+	struct VFile* vf;
+	enum mMovieMode mode;
+	uint32_t keyframeInterval;
+
+	// The next frame to be run
+	uint32_t frame;
+	// Keys held on each frame
+	struct UInt32List inputs;
+	struct mMovieKeyframeList keyframes;
+	// Where the next keyframe will be written while recording
+	uint32_t dataEnd;
+};
+
+void mMovieInit(struct mMovie*, struct mCore*);
+// Stops the movie first if it's still active
+void mMovieDeinit(struct mMovie*);
+
+// Both take ownership of vf. Recording starts from the core's current state, which becomes the
+// first keyframe; playback loads that keyframe.
+bool mMovieStartRecording(struct mMovie*, struct VFile* vf, uint32_t keyframeInterval);
+bool mMovieStartPlayback(struct mMovie*, struct VFile* vf);
+// Writes out the inputs and keyframe index if recording, then closes the file
+bool mMovieStop(struct mMovie*);
+
+// Runs one frame. Recording stores the keys the core currently has set; playback sets the recorded
+// ones. Returns false without running anything once playback reaches the end of the movie.
+bool mMovieRunFrame(struct mMovie*);
+// Restores the nearest keyframe at or before frame and runs up to it without rendering anything
+// but the last frame. Seeking while recording discards everything after frame, so that recording
+// continues from there. Must be called from the thread that runs the core.
+bool mMovieSeek(struct mMovie*, uint32_t frame);
+uint32_t mMovieFrameCount(const struct mMovie*);
+
+CXX_GUARD_END
+
+#endif
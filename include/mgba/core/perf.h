@@ -0,0 +1,94 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_PERF_H
+#define M_CORE_PERF_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+enum mPerfSection {
+	mPERF_OTHER = 0,
+	mPERF_CPU,
+	mPERF_VIDEO,
+	mPERF_AUDIO,
+	mPERF_DMA,
+	mPERF_TIMING,
+	mPERF_MAX
+};
+
+struct mPerfCounter {
+	uint64_t nsec;
+	uint64_t entries;
+};
+
+// Monotonic clock in nanoseconds, available regardless of build options
+uint64_t mPerfTimestamp(void);
+
+#ifdef ENABLE_PERF_TIMERS
+// Time is charged to the innermost section that's been entered, so the counters add up to the
+// wall time since the last reset. The counters are global and only meant for single-threaded runs.
+void mPerfEnter(enum mPerfSection);
+void mPerfLeave(void);
+#define mPERF_ENTER(SECTION) mPerfEnter(mPERF_ ## SECTION)
+#define mPERF_LEAVE() mPerfLeave()
+#else
+#define mPERF_ENTER(SECTION)
+#define mPERF_LEAVE()
+#endif
+
+void mPerfTimersReset(void);
+// Counters are all zero unless built with ENABLE_PERF_TIMERS
+void mPerfTimersCollect(struct mPerfCounter counters[mPERF_MAX]);
+const char* mPerfSectionName(enum mPerfSection);
+
+// Startup tracing times each phase between launch and the first frame. Marks are ignored until
+// tracing has begun, so they can stay in place unconditionally. Each mark ends the phase it names,
+// which started at the previous mark; marks may come from any thread.
+void mStartupTraceBegin(void);
+bool mStartupTraceIsActive(void);
+void mStartupTraceMark(const char* phase);
+// Prints every phase and how long it took, then stops tracing
+void mStartupTraceFinish(void);
+
+// Tracepoints mark zones on a per-thread timeline for frame pacing and contention. Zones must
+// be closed on the thread that opened them, and names must outlive the trace (e.g. literals).
+struct mTraceBackend {
+	void (*begin)(struct mTraceBackend*, const char* name, uint64_t nsec);
+	void (*end)(struct mTraceBackend*, uint64_t nsec);
+	void (*mark)(struct mTraceBackend*, const char* name, uint64_t nsec);
+	void (*threadName)(struct mTraceBackend*, const char* name);
+};
+
+#ifdef ENABLE_TRACING
+void mTraceBegin(const char* name);
+void mTraceEnd(void);
+void mTraceMark(const char* name);
+void mTraceThreadName(const char* name);
+#define mTRACE_BEGIN(NAME) mTraceBegin(NAME)
+#define mTRACE_END() mTraceEnd()
+#define mTRACE_MARK(NAME) mTraceMark(NAME)
+#define mTRACE_THREAD_NAME(NAME) mTraceThreadName(NAME)
+#else
+#define mTRACE_BEGIN(NAME)
+#define mTRACE_END()
+#define mTRACE_MARK(NAME)
+#define mTRACE_THREAD_NAME(NAME)
+#endif
+
+// The backend must stay alive until it has been replaced and no thread can still be inside it.
+// Without ENABLE_TRACING no tracepoints exist, so nothing is ever sent to it.
+void mTraceSetBackend(struct mTraceBackend*);
+
+struct VFile;
+// Writes Trace Event Format JSON, which Perfetto and chrome://tracing can open. The file stays
+// readable if the process dies before the backend is destroyed, up to the last buffered flush.
+struct mTraceBackend* mTraceJSONCreate(struct VFile* vf);
+void mTraceJSONDestroy(struct mTraceBackend*);
+
+CXX_GUARD_END
+
+#endif
@@ -10,18 +10,29 @@
 
 CXX_GUARD_START
 
+#include <mgba-util/patch/fast.h>
 #include <mgba-util/vector.h>
 #ifndef DISABLE_THREADING
 #include <mgba-util/threading.h>
 #endif
 
-DECLARE_VECTOR(mCoreRewindPatches, struct PatchFast);
+struct mCoreRewindPatch {
+	uint8_t* data;
+	size_t size;
+};
+
+DECLARE_VECTOR(mCoreRewindPatches, struct mCoreRewindPatch);
 
 struct VFile;
 struct mCoreRewindContext {
 	struct mCoreRewindPatches patchMemory;
+	struct PatchFast patch;
+	uint8_t* packBuffer;
+	size_t packCapacity;
 	size_t current;
 	size_t size;
+	size_t memoryUsed;
+	size_t memoryBudget;
 	struct VFile* previousState;
 	struct VFile* currentState;
 	int rewindFrameCounter;
@@ -37,10 +48,14 @@ struct mCoreRewindContext {
 
 void mCoreRewindContextInit(struct mCoreRewindContext*, size_t entries, bool onThread);
 void mCoreRewindContextDeinit(struct mCoreRewindContext*);
+// Limits the memory used by stored deltas, dropping the oldest ones when needed. 0 means no limit.
+void mCoreRewindContextSetMemoryBudget(struct mCoreRewindContext*, size_t bytes);
 
 struct mCore;
 void mCoreRewindAppend(struct mCoreRewindContext*, struct mCore*);
 bool mCoreRewindRestore(struct mCoreRewindContext*, struct mCore*);
+// Goes back up to count states at once, only loading the last one. Returns how many it went back.
+size_t mCoreRewindRestoreMany(struct mCoreRewindContext*, struct mCore*, size_t count);
 
 CXX_GUARD_END
 
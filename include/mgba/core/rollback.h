@@ -0,0 +1,69 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_ROLLBACK_H
+#define M_CORE_ROLLBACK_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#define mCORE_ROLLBACK_MAX_PLAYERS 4
+
+struct mCore;
+
+struct mCoreRollbackFrame {
+	void* state;
+	uint32_t epoch;
+	uint32_t used[mCORE_ROLLBACK_MAX_PLAYERS];
+};
+
+struct mCoreRollbackInput {
+	uint32_t keys[mCORE_ROLLBACK_MAX_PLAYERS];
+	unsigned confirmed;
+};
+
+struct mCoreRollback {
+	struct mCore* core;
+	unsigned players;
+	unsigned localPlayer;
+	uint32_t localKeys;
+
+	// States and the inputs they were run with for the last window frames, indexed by frame
+	struct mCoreRollbackFrame* frames;
+	// Inputs from window frames in the past to window frames in the future, indexed by frame
+	struct mCoreRollbackInput* inputs;
+	size_t window;
+
+	uint32_t frame;
+	uint32_t confirmedFrame;
+	uint32_t resimulateFrom;
+	uint32_t lastKeys[mCORE_ROLLBACK_MAX_PLAYERS];
+	uint32_t lastFrame[mCORE_ROLLBACK_MAX_PLAYERS];
+
+	size_t rollbacks;
+	size_t resimulatedFrames;
+
+	// Applies one frame's inputs to the core. Defaults to setting the core's keys to player 0's input.
+	void (*setInputs)(struct mCoreRollback*, const uint32_t* inputs);
+	// Called with each local input so it can be sent to the other peers
+	void (*localInput)(struct mCoreRollback*, uint32_t frame, uint32_t keys);
+	void* context;
+};
+
+void mCoreRollbackInit(struct mCoreRollback*, struct mCore*, unsigned players, unsigned localPlayer, size_t window);
+void mCoreRollbackDeinit(struct mCoreRollback*);
+
+void mCoreRollbackSetLocalKeys(struct mCoreRollback*, uint32_t keys);
+// Records a confirmed input. Returns false if the frame is too far ahead to be stored.
+bool mCoreRollbackAddInput(struct mCoreRollback*, unsigned player, uint32_t frame, uint32_t keys);
+
+// Runs one frame, first rolling back and resimulating if a confirmed input differed from what was
+// predicted. Returns false without running anything if the remote peers are too far behind.
+bool mCoreRollbackRunFrame(struct mCoreRollback*);
+
+CXX_GUARD_END
+
+#endif
@@ -0,0 +1,54 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_ROM_IMAGE_H
+#define M_ROM_IMAGE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba-util/memory.h>
+#include <mgba-util/table.h>
+#include <mgba-util/threading.h>
+
+struct mROMImageRegistry;
+
+// A read-only copy of a ROM that any number of cores can map at once. Cores that need to write to
+// their ROM map it privately instead, which only duplicates the pages they touch.
+struct mROMImage {
+	struct mROMImageRegistry* registry;
+	struct SharedMemory memory;
+	uint32_t crc32;
+	size_t size;
+	unsigned refs;
+};
+
+struct mROMImageRegistry {
+	Mutex mutex;
+	struct Table images;
+};
+
+void mROMImageRegistryInit(struct mROMImageRegistry*);
+// Images that are still in use stay valid until they're released
+void mROMImageRegistryDeinit(struct mROMImageRegistry*);
+
+// Returns a new reference to an image holding the first size bytes of rom, creating it if needed.
+// The image is mapSize bytes long and reads as zero past the end of the ROM. Returns NULL if the
+// image can't be shared, in which case the caller should keep its own copy.
+struct mROMImage* mROMImageRegistryAcquire(struct mROMImageRegistry*, const void* rom, size_t size, size_t mapSize, uint32_t crc32);
+// Adds a reference to an image that's already held
+void mROMImageRetain(struct mROMImage*);
+void mROMImageRelease(struct mROMImage*);
+
+void* mROMImageMapPrivate(struct mROMImage*);
+// Maps the image privately and makes its first size bytes match rom. Only the pages that differ
+// from the image get copied, so the rest stay shared.
+void* mROMImageMapPrivateCopy(struct mROMImage*, const void* rom, size_t size);
+void mROMImageUnmapPrivate(struct mROMImage*, void* memory);
+
+CXX_GUARD_END
+
+#endif
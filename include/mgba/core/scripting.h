@@ -85,6 +85,21 @@ void mScriptContextDetachLogger(struct mScriptContext*);
 typedef struct mScriptTextBuffer* (*mScriptContextBufferFactory)(void*);
 void mScriptContextSetTextBufferFactory(struct mScriptContext*, mScriptContextBufferFactory factory, void* cbContext);
 
+// Runs frame callbacks on its own thread against a copy of memory taken at each frame boundary.
+// The context must only be touched directly while no core is attached.
+struct mScriptCoreWorker;
+struct mScriptCoreWorker* mScriptCoreWorkerCreate(void);
+void mScriptCoreWorkerDestroy(struct mScriptCoreWorker*);
+
+struct mScriptContext* mScriptCoreWorkerGetContext(struct mScriptCoreWorker*);
+bool mScriptCoreWorkerLoadVF(struct mScriptCoreWorker*, const char* name, struct VFile* vf);
+
+void mScriptCoreWorkerAttachCore(struct mScriptCoreWorker*, struct mCore*);
+void mScriptCoreWorkerDetachCore(struct mScriptCoreWorker*);
+
+void mScriptCoreWorkerFrameEnded(struct mScriptCoreWorker*);
+void mScriptCoreWorkerWait(struct mScriptCoreWorker*);
+
 CXX_GUARD_END
 
 #endif
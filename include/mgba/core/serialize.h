@@ -8,6 +8,8 @@
 
 #include <mgba-util/common.h>
 
+#include <mgba-util/vector.h>
+
 CXX_GUARD_START
 
 enum mStateExtdataTag {
@@ -28,6 +30,10 @@ enum mStateExtdataTag {
 #define SAVESTATE_RTC        8
 #define SAVESTATE_METADATA   16
 #define SAVESTATE_ALL        31
+// Favor encoding speed over size, e.g. for quick-save slots
+#define SAVESTATE_QUICK      32
+// Write a chunked container instead of a raw or PNG state
+#define SAVESTATE_CHUNKED    64
 
 struct mStateExtdataItem {
 	int32_t size;
@@ -39,6 +45,23 @@ struct mStateExtdata {
 	struct mStateExtdataItem data[EXTDATA_MAX];
 };
 
+struct mStateSection {
+	const char* name;
+	uint32_t offset;
+	uint32_t size;
+};
+
+// One chunk of a chunked savestate. Chunks tagged EXTDATA_NONE hold the range of the core's
+// state starting at offset; any other tag holds that extdata item.
+struct mStateChunk {
+	uint32_t tag;
+	uint32_t offset;
+	uint32_t size;
+	uint32_t crc32;
+};
+
+DECLARE_VECTOR(mStateChunkList, struct mStateChunk);
+
 void mStateExtdataInit(struct mStateExtdata*);
 void mStateExtdataDeinit(struct mStateExtdata*);
 void mStateExtdataPut(struct mStateExtdata*, enum mStateExtdataTag, struct mStateExtdataItem*);
@@ -54,6 +77,21 @@ bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags);
 void* mCoreExtractState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata);
 bool mCoreExtractExtdata(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata);
 
+// Lists the chunks of a chunked savestate along with their hashes. Passing that list as the base
+// of mCoreSaveStateDelta writes only the chunks that differ from it; loading such a delta applies
+// it on top of the core's current state.
+bool mStateChunksRead(struct VFile* vf, struct mStateChunkList* chunks);
+bool mCoreSaveStateDelta(struct mCore* core, struct VFile* vf, int flags, const struct mStateChunkList* base);
+
+// Encodes savestates on a background thread. Saving copies the state, screenshot
+// and extdata from the core before returning; the writer then takes ownership of
+// the VFile, closes it once the state is written, and calls done from its own thread.
+struct mStateWriter;
+struct mStateWriter* mStateWriterCreate(void);
+void mStateWriterDestroy(struct mStateWriter*);
+bool mStateWriterSave(struct mStateWriter*, struct mCore* core, struct VFile* vf, int flags, void (*done)(bool success, void* context), void* context);
+void mStateWriterWait(struct mStateWriter*);
+
 CXX_GUARD_END
 
 #endif
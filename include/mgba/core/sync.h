@@ -22,8 +22,46 @@ struct mCoreSync {
 	bool audioWait;
 	Condition audioRequiredCond;
 	Mutex audioBufferMutex;
+	// If set, samples are moved out of the core's buffers into this ring of mStereoSamples as soon
+	// as they're produced, so mCoreSyncReadAudio can hand them out without waiting on the core
+	struct RingFIFO* audioRing;
+	// If set along with audioRing, samples pass through this on their way into the ring. The core's
+	// buffers should then be set to the core's native audio rate, and the resampler to convert from
+	// that to the output rate.
+	struct mAudioResampler* audioResampler;
+	// The most mCoreSyncAdjustAudioRate will stretch or squeeze the output rate by, as a fraction of
+	// it, to keep the frontend's buffers half full. 0 leaves the rate alone.
+	float audioRateControl;
 
 	float fpsTarget;
+
+	// If set, mCoreSyncPostFrame holds the core thread back after each frame so that the next one
+	// is predicted to finish just before the frontend presents it, instead of most of a frame early.
+	// Presentation is expected 1 / fpsTarget after the last one reported through
+	// mCoreSyncFramePresented, so on variable refresh displays this also sets the refresh rate.
+	bool framePacing;
+	// The predicted time to emulate a frame. It follows increases at once but only decays slowly,
+	// so a single slow frame makes the next few start earlier instead of missing their slot.
+	uint64_t frameCostNsec;
+	uint64_t framePresentedNsec;
+	bool framePresentPending;
+	uint64_t frameStartNsec;
+	uint64_t frameStartAudioWaitNsec;
+
+	// Nanoseconds the core thread has spent blocked on video and audio sync. These only grow;
+	// the core thread's owner is expected to take differences between frames.
+	uint64_t videoWaitNsec;
+	uint64_t audioWaitNsec;
+};
+
+// Picks which frames to render while fast-forwarding, so that only as many are drawn as the display
+// can show and the rest of the time goes to emulating frames that are never rendered
+struct mCoreFrameSkip {
+	// The display's refresh rate. If 0, every frame is rendered.
+	float presentFps;
+	uint64_t nextPresentNsec;
+	// The predicted time to emulate a frame that isn't rendered
+	uint64_t skippedFrameCostNsec;
 };
 
 void mCoreSyncPostFrame(struct mCoreSync* sync);
@@ -31,12 +69,26 @@ void mCoreSyncForceFrame(struct mCoreSync* sync);
 bool mCoreSyncWaitFrameStart(struct mCoreSync* sync);
 void mCoreSyncWaitFrameEnd(struct mCoreSync* sync);
 void mCoreSyncSetVideoSync(struct mCoreSync* sync, bool wait);
+// Must not be called between mCoreSyncWaitFrameStart and mCoreSyncWaitFrameEnd
+void mCoreSyncFramePresented(struct mCoreSync* sync, uint64_t nsec);
+// How long to hold off starting the next frame at the given time, per mPerfTimestamp
+uint64_t mCoreSyncFramePacingDelay(const struct mCoreSync* sync, uint64_t now);
+
+// Whether a frame starting now should be rendered. Times are per mPerfTimestamp.
+bool mCoreFrameSkipShouldRender(const struct mCoreFrameSkip* skip, uint64_t now);
+void mCoreFrameSkipFrameEnded(struct mCoreFrameSkip* skip, uint64_t start, uint64_t end, bool rendered);
 
 struct blip_t;
-bool mCoreSyncProduceAudio(struct mCoreSync* sync, const struct blip_t*, size_t samples);
+struct mStereoSample;
+struct mAudioResampler;
+struct RingFIFO;
+bool mCoreSyncProduceAudio(struct mCoreSync* sync, struct blip_t* left, struct blip_t* right, size_t samples);
 void mCoreSyncLockAudio(struct mCoreSync* sync);
 void mCoreSyncUnlockAudio(struct mCoreSync* sync);
 void mCoreSyncConsumeAudio(struct mCoreSync* sync);
+// Only one thread may read from the ring at a time
+size_t mCoreSyncReadAudio(struct mCoreSync* sync, struct mStereoSample* samples, size_t count);
+double mCoreSyncAdjustAudioRate(const struct mCoreSync* sync, double rate, size_t buffered, size_t capacity);
 
 CXX_GUARD_END
 
@@ -16,6 +16,13 @@ struct mCoreThread;
 struct mCore;
 
 typedef void (*ThreadCallback)(struct mCoreThread* threadContext);
+typedef void (*mCoreThreadCommand)(struct mCoreThread* threadContext, void* context);
+
+// Completion of a posted command. Zero-initialize it before posting; any results should be passed
+// back through the command's context.
+struct mCoreThreadFuture {
+	int done;
+};
 
 struct mCoreThread;
 struct mThreadLogger {
@@ -26,11 +33,35 @@ struct mThreadLogger {
 
 #ifdef ENABLE_SCRIPTING
 struct mScriptContext;
+struct mScriptCoreWorker;
 #endif
+// Timings are in nanoseconds. A frame's time is measured from the end of the previous one, and
+// is split into time spent blocked on video and audio sync and everything else, charged to
+// emulation. Frames after a pause or interruption aren't recorded, as they'd mostly be idle.
+struct mCoreFrameTiming {
+	uint32_t frame;
+	uint64_t frameNsec;
+	uint64_t emulationNsec;
+	uint64_t videoWaitNsec;
+	uint64_t audioWaitNsec;
+	// From the end of the frame until the frontend presented it, or 0 if it never reported it
+	uint64_t presentNsec;
+	// When the frame ended, per mPerfTimestamp
+	uint64_t timestamp;
+};
+
 struct mCoreThreadInternal;
+struct mCoreRollback;
+struct mMovie;
+struct mTraceBackend;
 struct mCoreThread {
 	// Input
 	struct mCore* core;
+	// If set, frames are run through this rollback session instead of free-running the core
+	struct mCoreRollback* rollback;
+	// If set and recording or playing, frames are run through this movie. Once playback reaches
+	// the end, the core runs freely again. Seeking must be done while the thread is interrupted.
+	struct mMovie* movie;
 
 	struct mThreadLogger logger;
 	ThreadCallback startCallback;
@@ -45,6 +76,8 @@ struct mCoreThread {
 
 #ifdef ENABLE_SCRIPTING
 	struct mScriptContext* scriptContext;
+	// Must be set before the thread starts
+	struct mScriptCoreWorker* scriptWorker;
 #endif
 
 	struct mCoreThreadInternal* impl;
@@ -54,6 +87,7 @@ struct mCoreThread {
 #include <mgba/core/rewind.h>
 #include <mgba/core/sync.h>
 #include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
 
 enum mCoreThreadState {
 	mTHREAD_INITIALIZED = -1,
@@ -80,6 +114,16 @@ enum mCoreThreadRequest {
 	mTHREAD_REQ_RUN_ON = 8,
 };
 
+#define mCORE_THREAD_FRAME_TIMINGS 256
+
+struct mCoreThreadCommandEntry {
+	mCoreThreadCommand command;
+	void* context;
+	struct mCoreThreadFuture* future;
+};
+
+DECLARE_VECTOR(mCoreThreadCommandList, struct mCoreThreadCommandEntry);
+
 struct mCoreThreadInternal {
 	Thread thread;
 	enum mCoreThreadState state;
@@ -94,6 +138,32 @@ struct mCoreThreadInternal {
 	struct mCoreSync sync;
 	struct mCoreRewindContext rewind;
 	struct mCore* core;
+
+	bool runningAhead;
+	bool speculating;
+	void* runAheadState;
+	size_t runAheadStateSize;
+	uint32_t runAheadEpoch;
+
+	struct mTraceBackend* trace;
+
+	bool fastForward;
+	struct mCoreFrameSkip frameSkip;
+
+	Mutex frameTimingMutex;
+	struct mCoreFrameTiming frameTimings[mCORE_THREAD_FRAME_TIMINGS];
+	size_t frameTimingNext;
+	size_t frameTimingCount;
+	uint64_t lastFrameEnded;
+	uint64_t lastVideoWait;
+	uint64_t lastAudioWait;
+
+	Mutex commandMutex;
+	Condition commandCond;
+	struct mCoreThreadCommandList commands;
+	struct mCoreThreadCommandList runningCommands;
+	int pendingCommands;
+	bool commandsClosed;
 };
 
 #endif
@@ -112,6 +182,15 @@ void mCoreThreadContinue(struct mCoreThread* threadContext);
 
 void mCoreThreadRunFunction(struct mCoreThread* threadContext, void (*run)(struct mCoreThread*));
 
+// Queues command to run on the core's thread without waiting for it. Commands run in the order
+// they were posted, between run loop slices while running or promptly while paused, but never
+// during an interrupt. Any remaining ones run when the thread exits. Returns false if the thread
+// has already exited, in which case the command never runs. future may be NULL.
+bool mCoreThreadPostCommand(struct mCoreThread* threadContext, mCoreThreadCommand command, void* context, struct mCoreThreadFuture* future);
+bool mCoreThreadFutureIsDone(struct mCoreThreadFuture* future);
+// Must not be called from the core's thread, or while holding an interrupt
+void mCoreThreadFutureWait(struct mCoreThread* threadContext, struct mCoreThreadFuture* future);
+
 void mCoreThreadPause(struct mCoreThread* threadContext);
 void mCoreThreadUnpause(struct mCoreThread* threadContext);
 bool mCoreThreadIsPaused(struct mCoreThread* threadContext);
@@ -126,6 +205,18 @@ void mCoreThreadClearCrashed(struct mCoreThread* threadContext);
 
 void mCoreThreadSetRewinding(struct mCoreThread* threadContext, bool);
 void mCoreThreadRewindParamsChanged(struct mCoreThread* threadContext);
+// While fast-forwarding, only as many frames are rendered as a display refreshing at presentFps can
+// show. Unless audio sync is on, the frames that aren't rendered don't produce audio either, and
+// if the core is muted no frames do.
+void mCoreThreadSetFastForward(struct mCoreThread* threadContext, bool enable, float presentFps);
+
+// Frontends should call this once a frame is actually on screen, e.g. right after a buffer swap.
+// Frame pacing schedules against these, so it must not be called while holding the video sync.
+void mCoreThreadFramePresented(struct mCoreThread* threadContext);
+// Copies out up to max of the most recently recorded frames, oldest first
+size_t mCoreThreadGetFrameTimings(struct mCoreThread* threadContext, struct mCoreFrameTiming* timings, size_t max);
+// Either output may be NULL. Present latency is only averaged over frames that reported one.
+void mCoreFrameTimingSummarize(const struct mCoreFrameTiming* timings, size_t count, struct mCoreFrameTiming* mean, struct mCoreFrameTiming* worst);
 
 struct mCoreThread* mCoreThreadGet(void);
 struct mLogger* mCoreThreadLogger(void);
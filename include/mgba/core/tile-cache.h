@@ -40,6 +40,7 @@ struct mTileCache {
 
 	uint16_t* vram;
 	color_t* palette;
+	color_t* opaquePalette;
 	color_t temporaryTile[64];
 
 	mTileCacheConfiguration config;
@@ -51,10 +52,20 @@ void mTileCacheDeinit(struct mTileCache* cache);
 void mTileCacheConfigure(struct mTileCache* cache, mTileCacheConfiguration config);
 void mTileCacheConfigureSystem(struct mTileCache* cache, mTileCacheSystemInfo config, uint32_t tileBase, uint32_t paletteBase);
 void mTileCacheWriteVRAM(struct mTileCache* cache, uint32_t address);
+void mTileCacheWriteVRAMRange(struct mTileCache* cache, uint32_t address, uint32_t length);
 void mTileCacheWritePalette(struct mTileCache* cache, uint32_t entry, color_t color);
 
 const color_t* mTileCacheGetTile(struct mTileCache* cache, unsigned tileId, unsigned paletteId);
 const color_t* mTileCacheGetTileIfDirty(struct mTileCache* cache, struct mTileCacheEntry* entry, unsigned tileId, unsigned paletteId);
+// Regenerates every stale tile in [start, start + count) for the given palette in one pass.
+// Returns how many tiles were regenerated.
+size_t mTileCacheRegenerateTiles(struct mTileCache* cache, unsigned start, unsigned count, unsigned paletteId);
+// Regenerates every tile in [start, start + count) that changed since its entries were last
+// updated, or all of them if force is set, and copies the pixels out so they stay valid however
+// the cache changes afterwards. entries holds entryStride entries per tile, starting at start.
+// Returns how many tiles were copied; their IDs go in tileIds and their pixels, 64 per tile, in
+// pixels, each of which must have room for count tiles.
+size_t mTileCacheCopyDirtyTiles(struct mTileCache* cache, struct mTileCacheEntry* entries, size_t entryStride, unsigned start, unsigned count, unsigned paletteId, bool force, unsigned* tileIds, color_t* pixels);
 const color_t* mTileCacheGetPalette(struct mTileCache* cache, unsigned paletteId);
 const uint16_t* mTileCacheGetVRAM(struct mTileCache* cache, unsigned tileId);
 
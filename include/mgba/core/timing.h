@@ -18,12 +18,25 @@ struct mTimingEvent {
 	uint32_t when;
 	unsigned priority;
 
+#ifndef ENABLE_TIMING_HEAP
 	struct mTimingEvent* next;
+#else
+	size_t index;
+	uint32_t sequence;
+#endif
 };
 
 struct mTiming {
+#ifndef ENABLE_TIMING_HEAP
 	struct mTimingEvent* root;
 	struct mTimingEvent* reroot;
+#else
+	struct mTimingEvent** heap;
+	size_t heapSize;
+	size_t heapCapacity;
+	uint32_t sequence;
+	bool interrupted;
+#endif
 
 	uint64_t globalCycles;
 	uint32_t masterCycles;
@@ -40,6 +53,7 @@ void mTimingInterrupt(struct mTiming* timing);
 void mTimingSchedule(struct mTiming* timing, struct mTimingEvent*, int32_t when);
 void mTimingScheduleAbsolute(struct mTiming* timing, struct mTimingEvent*, int32_t when);
 void mTimingDeschedule(struct mTiming* timing, struct mTimingEvent*);
+void mTimingDescheduleAll(struct mTiming* timing);
 bool mTimingIsScheduled(const struct mTiming* timing, const struct mTimingEvent*);
 
 int32_t mTimingTick(struct mTiming* timing, int32_t cycles);
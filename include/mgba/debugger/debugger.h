@@ -132,6 +132,7 @@ struct mBreakpoint {
 	int segment;
 	enum mBreakpointType type;
 	struct ParseTree* condition;
+	struct ParseProgram* compiledCondition;
 };
 
 struct mWatchpoint {
@@ -141,6 +142,7 @@ struct mWatchpoint {
 	uint32_t maxAddress;
 	enum mWatchpointType type;
 	struct ParseTree* condition;
+	struct ParseProgram* compiledCondition;
 };
 
 struct mDebuggerInstructionInfo {
@@ -151,6 +153,19 @@ struct mDebuggerInstructionInfo {
 	mDebuggerAccessLogFlagsEx flagsEx[INSN_LENGTH_MAX];
 };
 
+struct mDebuggerAccessHook {
+	void (*access)(struct mDebuggerAccessHook*, uint32_t address, int width, mDebuggerAccessLogFlags flags);
+};
+
+#define mDEBUGGER_TRACE_MAX_REGISTERS 32
+
+struct mDebuggerTraceState {
+	uint32_t address;
+	uint32_t opcode;
+	unsigned nRegisters;
+	uint32_t registers[mDEBUGGER_TRACE_MAX_REGISTERS];
+};
+
 DECLARE_VECTOR(mBreakpointList, struct mBreakpoint);
 DECLARE_VECTOR(mWatchpointList, struct mWatchpoint);
 DECLARE_VECTOR(mDebuggerModuleList, struct mDebuggerModule*);
@@ -178,6 +193,7 @@ struct mStackTrace {
 };
 
 struct mDebugger;
+struct mDebuggerHistory;
 struct ParseTree;
 struct mDebuggerPlatform {
 	struct mDebugger* p;
@@ -205,6 +221,9 @@ struct mDebuggerPlatform {
 	bool (*updateStackTrace)(struct mDebuggerPlatform* d);
 
 	void (*nextInstructionInfo)(struct mDebuggerPlatform* d, struct mDebuggerInstructionInfo* info);
+	void (*traceState)(struct mDebuggerPlatform* d, struct mDebuggerTraceState* state);
+	// Called for every load and store without entering the debugger; NULL removes it
+	bool (*setAccessHook)(struct mDebuggerPlatform* d, struct mDebuggerAccessHook* hook);
 };
 
 struct mDebugger {
@@ -217,6 +236,7 @@ struct mDebugger {
 
 	struct mDebuggerModuleList modules;
 	struct Table pointOwner;
+	struct mDebuggerHistory* history;
 };
 
 struct mDebuggerModule {
@@ -0,0 +1,89 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef FRAME_SERVER_H
+#define FRAME_SERVER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/interface.h>
+#include <mgba-util/memory.h>
+
+#define mFRAME_SERVER_MAGIC 0x5346476D // "mGFS"
+#define mFRAME_SERVER_VERSION 1
+#define mFRAME_SERVER_SLOTS 3
+#define mFRAME_SERVER_AUDIO_SAMPLES 0x4000
+
+// The layout below is shared with other processes, so it only uses fixed-size fields. Everything
+// other processes need to find frames and audio is in the header at the start of the block.
+//
+// A slot's sequence is odd while it's being written. Readers should read the sequence, read the
+// frame, and then check that the sequence hasn't changed; if it has, the slot was reused partway
+// through and the frame should be read again from the new latest slot.
+struct mFrameServerSlot {
+	uint32_t sequence;
+	uint32_t width;
+	uint32_t height;
+	// In bytes
+	uint32_t stride;
+	// Offset of the pixels from the start of the block
+	uint32_t offset;
+	uint32_t frame;
+};
+
+struct mFrameServerHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t headerSize;
+	// An mColorFormat
+	uint32_t format;
+	uint32_t maxWidth;
+	uint32_t maxHeight;
+	uint32_t nSlots;
+	// The slot holding the newest finished frame
+	uint32_t latest;
+	// Goes up by one with every frame published. On Linux this is a futex that gets woken, and on
+	// Windows an event named Local\<name>-frame is set, so readers don't have to poll it.
+	uint32_t frameSequence;
+
+	uint32_t audioRate;
+	// Stereo samples, interleaved as 16-bit left and right pairs
+	uint32_t audioOffset;
+	uint32_t audioCapacity;
+	// Total samples written so far, wrapping around. Sample n is at n % audioCapacity in the ring.
+	uint32_t audioWritten;
+	uint32_t reserved[3];
+
+	struct mFrameServerSlot slots[mFRAME_SERVER_SLOTS];
+};
+
+// Publishes frames and audio into a named shared memory block, for other processes to read in
+// place. Only the newest few frames are kept, so slow readers skip frames rather than holding up
+// emulation.
+struct mFrameServer {
+	struct mAVStream d;
+	struct SharedMemory memory;
+	struct mFrameServerHeader* header;
+	char name[64];
+	// Windows event handle, signaled on each new frame
+	intptr_t event;
+
+	unsigned width;
+	unsigned height;
+	uint32_t frame;
+	uint32_t audioWritten;
+};
+
+void mFrameServerInit(struct mFrameServer*);
+// Frames larger than the maximum dimensions are left out
+bool mFrameServerOpen(struct mFrameServer*, const char* name, unsigned maxWidth, unsigned maxHeight);
+void mFrameServerClose(struct mFrameServer*);
+bool mFrameServerIsOpen(const struct mFrameServer*);
+
+CXX_GUARD_END
+
+#endif
@@ -0,0 +1,85 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GIF_ENCODER_H
+#define GIF_ENCODER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/interface.h>
+
+#define mGIF_MAX_COLORS 256
+#define mGIF_PALETTE_HASH_SIZE 512
+#define mGIF_LZW_HASH_SIZE 5003
+
+struct VFile;
+
+struct mGIFPalette {
+	// Index 0 is always the transparent color, so there are at most 255 real colors
+	uint32_t colors[mGIF_MAX_COLORS];
+	unsigned count;
+	// Colors are looked up with the low bits masked off when there were too many to fit
+	uint32_t mask;
+	uint32_t keys[mGIF_PALETTE_HASH_SIZE];
+	uint8_t values[mGIF_PALETTE_HASH_SIZE];
+};
+
+// Writes GIFs as frames come in, instead of buffering the whole clip to build one palette. Palettes
+// are built from the colors each frame uses and reused as long as they still fit, and pixels that
+// didn't change from the last frame are left transparent.
+struct mGIFEncoder {
+	struct mAVStream d;
+	struct VFile* vf;
+	bool closeVF;
+
+	unsigned width;
+	unsigned height;
+	unsigned iwidth;
+	unsigned iheight;
+	bool loop;
+	int frameskip;
+	int skipResidue;
+	int frameCycles;
+	int cycles;
+
+	// The last frame written and the one being written, as 0xRRGGBB
+	uint32_t* previous;
+	uint32_t* current;
+	uint8_t* indices;
+	bool started;
+
+	struct mGIFPalette global;
+	struct mGIFPalette local;
+	const struct mGIFPalette* active;
+
+	// Frame delays aren't known until the next different frame, so they're filled in afterwards
+	uint64_t frame;
+	uint64_t pendingFrame;
+	int64_t delayOffset;
+
+	int32_t lzwKeys[mGIF_LZW_HASH_SIZE];
+	uint16_t lzwCodes[mGIF_LZW_HASH_SIZE];
+	uint32_t bitBuffer;
+	unsigned bitCount;
+	uint8_t block[256];
+	unsigned blockSize;
+};
+
+void mGIFEncoderInit(struct mGIFEncoder*);
+void mGIFEncoderSetDimensions(struct mGIFEncoder*, unsigned width, unsigned height);
+void mGIFEncoderSetLooping(struct mGIFEncoder*, bool loop);
+void mGIFEncoderSetFrameskip(struct mGIFEncoder*, int frameskip);
+void mGIFEncoderSetInputFrameRate(struct mGIFEncoder*, int numerator, int denominator);
+bool mGIFEncoderOpen(struct mGIFEncoder*, const char* outfile);
+// The VFile is left open when the encoder is closed
+bool mGIFEncoderOpenVF(struct mGIFEncoder*, struct VFile* vf);
+void mGIFEncoderClose(struct mGIFEncoder*);
+bool mGIFEncoderIsOpen(struct mGIFEncoder*);
+
+CXX_GUARD_END
+
+#endif
@@ -26,6 +26,7 @@ enum mVideoBackendCommandType {
 	mVB_CMD_SET_IMAGE_SIZE,
 	mVB_CMD_IMAGE_SIZE,
 	mVB_CMD_SET_IMAGE,
+	mVB_CMD_SET_IMAGE_REGION,
 	mVB_CMD_DRAW_FRAME,
 };
 
@@ -40,10 +41,16 @@ union mVideoBackendCommandData {
 		unsigned height;
 	} u;
 	const void* image;
+	struct {
+		struct mRectangle dims;
+		const void* image;
+	} region;
 };
 
 struct mVideoBackendCommand {
 	enum mVideoBackendCommandType cmd;
+	// Whether the submitter waits for this command to run and gets a reply
+	bool blocking;
 
 	union {
 		WHandle handle;
@@ -52,10 +59,37 @@ struct mVideoBackendCommand {
 	union mVideoBackendCommandData data;
 };
 
+#define mVIDEO_PROXY_BATCH_SIZE 16
+
+// Copies of layer images that the other thread can read after setImage returns. There are two per
+// layer so the next one can be filled while the last is still waiting to be uploaded.
+struct mVideoProxyStagedImage {
+	void* data;
+	size_t size;
+	// Number of the command that reads from this copy
+	uint32_t serial;
+};
+
+struct mVideoProxyLayer {
+	int width;
+	int height;
+	struct mVideoProxyStagedImage staged[2];
+	unsigned nextStaged;
+};
+
 struct mVideoProxyBackend {
 	struct VideoBackend d;
 	struct VideoBackend* backend;
-	
+
+	// Commands that don't need to wait are held here until a flush, so a whole update goes over in
+	// one go. Only one thread should submit commands at a time.
+	struct mVideoBackendCommand batch[mVIDEO_PROXY_BATCH_SIZE];
+	size_t batchSize;
+	uint32_t submitted;
+	// Commands run by the other thread, counted the same way as submitted
+	uint32_t completed;
+	struct mVideoProxyLayer layers[VIDEO_LAYER_MAX];
+
 	struct RingFIFO in;
 	struct RingFIFO out;
 
@@ -72,6 +106,7 @@ void mVideoProxyBackendInit(struct mVideoProxyBackend* proxy, struct VideoBacken
 void mVideoProxyBackendDeinit(struct mVideoProxyBackend* proxy);
 
 void mVideoProxyBackendSubmit(struct mVideoProxyBackend* proxy, const struct mVideoBackendCommand* cmd, union mVideoBackendCommandData* out);
+void mVideoProxyBackendFlush(struct mVideoProxyBackend* proxy);
 bool mVideoProxyBackendRun(struct mVideoProxyBackend* proxy, bool block);
 
 bool mVideoProxyBackendCommandIsBlocking(enum mVideoBackendCommandType);
@@ -52,7 +52,11 @@ struct VideoBackend {
 	void (*setImageSize)(struct VideoBackend*, enum VideoLayer, int w, int h);
 	void (*imageSize)(struct VideoBackend*, enum VideoLayer, int* w, int* h);
 	void (*setImage)(struct VideoBackend*, enum VideoLayer, const void* frame);
+	// Optional; uploads only the rows of frame covered by region. frame is the whole image.
+	void (*setImageRegion)(struct VideoBackend*, enum VideoLayer, const struct mRectangle* region, const void* frame);
 	void (*drawFrame)(struct VideoBackend*);
+	// Optional; called after a group of changes, for backends that hold onto them until then
+	void (*flush)(struct VideoBackend*);
 
 	void* user;
 
@@ -15,6 +15,9 @@ CXX_GUARD_START
 #include <mgba-util/circle-buffer.h>
 
 #define mVL_MAX_CHANNELS 32
+#define mVL_DEFAULT_COMPRESSION_LEVEL 9
+#define mVL_DEFAULT_COMPRESSION_THREADS 2
+#define mVL_DEFAULT_KEYFRAME_INTERVAL 600
 
 enum mVideoLoggerDirtyType {
 	DIRTY_DUMMY = 0,
@@ -37,6 +40,11 @@ enum mVideoLoggerEvent {
 	LOGGER_EVENT_GET_PIXELS,
 };
 
+enum mVideoLogChannelType {
+	mVL_CHANNEL_VIDEO = 0,
+	mVL_CHANNEL_AUDIO,
+};
+
 enum mVideoLoggerInjectionPoint {
 	LOGGER_INJECTION_IMMEDIATE = 0,
 	LOGGER_INJECTION_FIRST_SCANLINE,
@@ -94,6 +102,7 @@ void mVideoLoggerRendererReset(struct mVideoLogger* logger);
 
 void mVideoLoggerRendererWriteVideoRegister(struct mVideoLogger* logger, uint32_t address, uint16_t value);
 void mVideoLoggerRendererWriteVRAM(struct mVideoLogger* logger, uint32_t address);
+void mVideoLoggerRendererWriteVRAMRange(struct mVideoLogger* logger, uint32_t address, uint32_t length);
 void mVideoLoggerRendererWritePalette(struct mVideoLogger* logger, uint32_t address, uint16_t value);
 void mVideoLoggerRendererWriteOAM(struct mVideoLogger* logger, uint32_t address, uint16_t value);
 
@@ -114,6 +123,12 @@ struct mCore;
 struct mVideoLogContext* mVideoLogContextCreate(struct mCore* core);
 
 void mVideoLogContextSetCompression(struct mVideoLogContext*, bool enable);
+// Levels are zlib's, from 1 (fastest) to 9 (smallest)
+void mVideoLogContextSetCompressionLevel(struct mVideoLogContext*, int level);
+// Blocks are compressed on this many background threads, or as they're flushed if it's 0
+void mVideoLogContextSetCompressionThreads(struct mVideoLogContext*, unsigned threads);
+// A full snapshot is written every this many frames so playback can seek, or never if it's 0
+void mVideoLogContextSetKeyframeInterval(struct mVideoLogContext*, unsigned frames);
 void mVideoLogContextSetOutput(struct mVideoLogContext*, struct VFile*);
 void mVideoLogContextWriteHeader(struct mVideoLogContext*, struct mCore* core);
 
@@ -122,8 +137,20 @@ void mVideoLogContextDestroy(struct mCore* core, struct mVideoLogContext*, bool
 
 void mVideoLogContextRewind(struct mVideoLogContext*, struct mCore*);
 void* mVideoLogContextInitialState(struct mVideoLogContext*, size_t* size);
+// Called by recording cores at the end of every frame, where it's safe to take a keyframe
+void mVideoLogContextFrameEnded(struct mVideoLogContext*, struct mCore*);
+// Resets a video log player core to the last keyframe at or before the given frame, or to the start
+// if there isn't one, and returns the frame it ended up at
+unsigned mVideoLogPlayerSeek(struct mCore* core, unsigned frame);
 
 int mVideoLoggerAddChannel(struct mVideoLogContext*);
+int mVideoLogContextFindChannel(struct mVideoLogContext*, enum mVideoLogChannelType);
+
+// Adds a channel for audio, which is recorded from the returned stream. This must be called before
+// the header is written, and the stream must be attached to the core for samples to be recorded.
+struct mAVStream* mVideoLogContextRecordAudio(struct mVideoLogContext*);
+// Returns up to count samples from an audio channel, all at the sample rate stored in sampleRate
+size_t mVideoLogContextReadAudio(struct mVideoLogContext*, int channelId, struct mStereoSample* samples, size_t count, unsigned* sampleRate);
 
 void mVideoLoggerInjectionPoint(struct mVideoLogger* logger, enum mVideoLoggerInjectionPoint);
 void mVideoLoggerIgnoreAfterInjection(struct mVideoLogger* logger, uint32_t mask);
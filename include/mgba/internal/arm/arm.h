@@ -147,6 +147,23 @@ struct ARMInterruptHandler {
 	void (*hitStub)(struct ARMCore* cpu, uint32_t opcode);
 };
 
+#define ARM_SHADOW_STACK_DEPTH 64
+
+struct ARMShadowFrame {
+	uint32_t callAddress;
+	uint32_t entryAddress;
+	uint32_t returnAddress;
+	bool exception;
+};
+
+// Call stack maintained by the interpreter itself, cheap enough to leave enabled outside the debugger
+struct ARMShadowStack {
+	size_t depth;
+	// Frames lost off the bottom when the stack overflowed
+	size_t dropped;
+	struct ARMShadowFrame frames[ARM_SHADOW_STACK_DEPTH];
+};
+
 #define ARM_REGISTER_FILE struct { \
 	int32_t gprs[16]; \
 	union PSR cpsr; \
@@ -184,6 +201,8 @@ struct ARMCore {
 
 	size_t numComponents;
 	struct mCPUComponent** components;
+
+	struct ARMShadowStack* shadowStack;
 };
 #undef ARM_REGISTER_FILE
 
@@ -199,10 +218,21 @@ void ARMRaiseIRQ(struct ARMCore*);
 void ARMRaiseSWI(struct ARMCore*);
 void ARMRaiseUndefined(struct ARMCore*);
 
+void ARMShadowStackEnable(struct ARMCore*);
+void ARMShadowStackDisable(struct ARMCore*);
+void ARMShadowStackPush(struct ARMCore*, uint32_t callAddress, uint32_t returnAddress, bool exception);
+void ARMShadowStackReturn(struct ARMCore*);
+
 void ARMRun(struct ARMCore* cpu);
 void ARMRunLoop(struct ARMCore* cpu);
 void ARMRunFake(struct ARMCore* cpu, uint32_t opcode);
 
+#ifdef ENABLE_ARM_OPCODE_STATS
+// Execution counts per instruction table entry, shared by all cores
+extern uint64_t ARMOpcodeStats[0x1000];
+extern uint64_t ThumbOpcodeStats[0x400];
+#endif
+
 CXX_GUARD_END
 
 #endif
@@ -32,7 +32,12 @@ struct ARMDebugger {
 
 	struct ARMDebugBreakpointList breakpoints;
 	struct ARMDebugBreakpointList swBreakpoints;
+	// One bit per halfword, folded every 128 KiB. A clear bit means there's no breakpoint there.
+	uint32_t breakpointFilter[0x800];
 	struct mWatchpointList watchpoints;
+	// One bit per 4 KiB page, folded every 256 MiB. Accesses to clear pages skip the watchpoint list.
+	uint32_t watchpointFilter[0x800];
+	struct mDebuggerAccessHook* accessHook;
 	struct ARMMemory originalMemory;
 
 	ssize_t nextId;
@@ -14,6 +14,8 @@ struct ARMDebugger;
 
 void ARMDebuggerInstallMemoryShim(struct ARMDebugger* debugger);
 void ARMDebuggerRemoveMemoryShim(struct ARMDebugger* debugger);
+// Must be called whenever the watchpoint list changes
+void ARMDebuggerUpdateWatchpointFilter(struct ARMDebugger* debugger);
 
 CXX_GUARD_END
 
@@ -17,13 +17,13 @@
 
 #define DECLARE_ARM_ALU_BLOCK(EMITTER, ALU, EX1, EX2, EX3, EX4) \
 	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _LSL), \
-	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _LSL), \
-	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _LSR), \
+	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _LSLR), \
 	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _LSR), \
+	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _LSRR), \
 	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _ASR), \
-	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _ASR), \
-	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _ROR), \
+	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _ASRR), \
 	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _ROR), \
+	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _RORR), \
 	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _LSL), \
 	DECLARE_INSTRUCTION_ARM(EMITTER, EX1), \
 	DECLARE_INSTRUCTION_ARM(EMITTER, ALU ## _LSR), \
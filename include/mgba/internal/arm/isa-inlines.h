@@ -90,6 +90,18 @@ static inline int32_t ThumbWritePC(struct ARMCore* cpu) {
 	return 2 + cpu->memory.activeNonseqCycles16 + cpu->memory.activeSeqCycles16;
 }
 
+static inline void _ARMShadowCall(struct ARMCore* cpu, uint32_t callAddress, uint32_t returnAddress) {
+	if (UNLIKELY(cpu->shadowStack)) {
+		ARMShadowStackPush(cpu, callAddress, returnAddress, false);
+	}
+}
+
+static inline void _ARMShadowReturn(struct ARMCore* cpu) {
+	if (UNLIKELY(cpu->shadowStack)) {
+		ARMShadowStackReturn(cpu);
+	}
+}
+
 static inline int _ARMModeHasSPSR(enum PrivilegeMode mode) {
 	return mode != MODE_SYSTEM && mode != MODE_USER;
 }
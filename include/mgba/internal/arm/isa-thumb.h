@@ -15,6 +15,11 @@ struct ARMCore;
 typedef void (*ThumbInstruction)(struct ARMCore*, unsigned opcode);
 extern const ThumbInstruction _thumbTable[0x400];
 
+// Runs an instruction together with the one after it if they form a known pair, indexed by
+// opcode >> 11. Returns false without doing anything if they don't.
+typedef bool (*ThumbFusedInstruction)(struct ARMCore*, unsigned opcode, unsigned next);
+extern const ThumbFusedInstruction _thumbFusedTable[0x20];
+
 CXX_GUARD_END
 
 #endif
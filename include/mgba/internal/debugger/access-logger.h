@@ -33,6 +33,14 @@ struct mDebuggerAccessLogger {
 	struct VFile* backing;
 	struct mDebuggerAccessLog* mapped;
 	struct mDebuggerAccessLogRegionList regions;
+
+	// Log loads and stores straight from the memory fast path instead of using watchpoints and
+	// stepping each instruction. Execution is not logged in this mode. Set this before opening.
+	bool fastPath;
+	bool hookInstalled;
+	struct mDebuggerAccessHook hook;
+	size_t lastRegion;
+	uint32_t unflushedAccesses;
 };
 
 void mDebuggerAccessLoggerInit(struct mDebuggerAccessLogger*);
@@ -40,6 +48,7 @@ void mDebuggerAccessLoggerDeinit(struct mDebuggerAccessLogger*);
 
 bool mDebuggerAccessLoggerOpen(struct mDebuggerAccessLogger*, struct VFile*, int mode);
 bool mDebuggerAccessLoggerClose(struct mDebuggerAccessLogger*);
+bool mDebuggerAccessLoggerFlush(struct mDebuggerAccessLogger*);
 
 int mDebuggerAccessLoggerWatchMemoryBlockId(struct mDebuggerAccessLogger*, size_t id, mDebuggerAccessLogRegionFlags);
 int mDebuggerAccessLoggerWatchMemoryBlockName(struct mDebuggerAccessLogger*, const char* internalName, mDebuggerAccessLogRegionFlags);
@@ -20,6 +20,8 @@ extern const char* INFO_WATCHPOINT_ADDED;
 
 struct CLIDebugger;
 struct VFile;
+struct mDebuggerProfiler;
+struct mDebuggerTraceRecorder;
 
 struct CLIDebugVector {
 	struct CLIDebugVector* next;
@@ -89,6 +91,8 @@ struct CLIDebugger {
 
 	int traceRemaining;
 	struct VFile* traceVf;
+	struct mDebuggerTraceRecorder* traceRecorder;
+	struct mDebuggerProfiler* profiler;
 	bool skipStatus;
 };
 
@@ -14,8 +14,11 @@ CXX_GUARD_START
 
 #include <mgba-util/socket.h>
 
-#define GDB_STUB_MAX_LINE 1400
+#define GDB_STUB_MAX_LINE 0x4000
+// Largest memory transfer in one packet, which needs two characters per byte when hex encoded
+#define GDB_STUB_MAX_TRANSFER ((GDB_STUB_MAX_LINE - 0x20) / 2)
 #define GDB_STUB_INTERVAL 32
+#define GDB_HISTORY_CHECKPOINTS 60
 
 enum GDBStubAckState {
 	GDB_ACK_PENDING = 0,
@@ -34,6 +37,8 @@ struct GDBStub {
 	struct mDebuggerModule d;
 
 	char line[GDB_STUB_MAX_LINE];
+	// Length of a partial packet left at the start of line by the previous receive
+	size_t lineLength;
 	char outgoing[GDB_STUB_MAX_LINE];
 	char memoryMapXml[GDB_STUB_MAX_LINE];
 	enum GDBStubAckState lineAck;
@@ -0,0 +1,47 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef DEBUGGER_HISTORY_H
+#define DEBUGGER_HISTORY_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/debugger/debugger.h>
+#include <mgba-util/vector.h>
+
+struct mDebuggerCheckpoint {
+	uint64_t time;
+	void* state;
+};
+
+DECLARE_VECTOR(mDebuggerCheckpointList, struct mDebuggerCheckpoint);
+
+struct mDebuggerHistory {
+	struct mDebuggerModule d;
+	struct mDebuggerCheckpointList checkpoints;
+	size_t stateSize;
+	// Minimum number of cycles between checkpoints
+	uint64_t interval;
+	size_t maxCheckpoints;
+
+	bool replaying;
+	bool replayHit;
+	enum mDebuggerEntryReason hitReason;
+	struct mDebuggerEntryInfo hitInfo;
+};
+
+// Checkpoints are taken while the debugger is single-stepping, so this makes it step continuously
+void mDebuggerEnableHistory(struct mDebugger*, uint64_t interval, size_t maxCheckpoints);
+void mDebuggerDisableHistory(struct mDebugger*);
+
+bool mDebuggerReverseStep(struct mDebugger*);
+// Returns false if no breakpoint or watchpoint was hit before reaching the oldest checkpoint
+bool mDebuggerReverseContinue(struct mDebugger*, enum mDebuggerEntryReason* reason, struct mDebuggerEntryInfo* info);
+
+CXX_GUARD_END
+
+#endif
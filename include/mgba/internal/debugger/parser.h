@@ -66,6 +66,30 @@ struct ParseTree {
 	int precedence;
 };
 
+enum ParseInstructionType {
+	PARSE_INSN_CONSTANT,
+	PARSE_INSN_REGISTER,
+	PARSE_INSN_LOOKUP,
+	PARSE_INSN_PUSH,
+	PARSE_INSN_OPERATION,
+	PARSE_INSN_SEGMENT,
+};
+
+struct ParseInstruction {
+	enum ParseInstructionType type;
+	enum Operation operation;
+	int32_t value;
+	int segment;
+	char* identifier;
+};
+
+DECLARE_VECTOR(ParseInstructionList, struct ParseInstruction);
+
+// A parse tree lowered to a flat instruction list, with identifiers resolved where possible
+struct ParseProgram {
+	struct ParseInstructionList instructions;
+};
+
 size_t lexExpression(struct LexVector* lv, const char* string, size_t length, const char* eol);
 void lexFree(struct LexVector* lv);
 
@@ -76,6 +100,11 @@ bool parseLexedExpression(struct ParseTree* tree, struct LexVector* lv);
 struct mDebugger;
 bool mDebuggerEvaluateParseTree(struct mDebugger* debugger, struct ParseTree* tree, int32_t* value, int* segment);
 
+// Returns NULL if the tree can't be compiled, in which case it should be evaluated directly
+struct ParseProgram* mDebuggerCompileParseTree(struct mDebugger* debugger, const struct ParseTree* tree);
+void parseProgramFree(struct ParseProgram* program);
+bool mDebuggerEvaluateParseProgram(struct mDebugger* debugger, const struct ParseProgram* program, int32_t* value, int* segment);
+
 CXX_GUARD_END
 
 #endif
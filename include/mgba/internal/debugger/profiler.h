@@ -0,0 +1,65 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef DEBUGGER_PROFILER_H
+#define DEBUGGER_PROFILER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/timing.h>
+#include <mgba-util/table.h>
+
+#define mDEBUGGER_PROFILER_MAX_DEPTH 32
+#define mDEBUGGER_PROFILER_DEFAULT_INTERVAL 0x1000
+
+struct mCore;
+struct mDebuggerSymbols;
+struct VFile;
+
+struct mDebuggerProfilerLocation {
+	uint32_t address;
+	int32_t segment;
+};
+
+struct mDebuggerProfilerEntry {
+	char name[64];
+	uint64_t samples;
+};
+
+// Samples the PC on a timing event, so the game keeps running at close to full speed. If a
+// debugger is attached with stack tracing enabled, the shadow call stack is sampled as well.
+struct mDebuggerProfiler {
+	struct mCore* core;
+	struct mTimingEvent event;
+	int32_t interval;
+	bool running;
+
+	// Keyed on the sampled stack, outermost frame first; values are uint64_t counts
+	struct Table stacks;
+	uint64_t samples;
+};
+
+void mDebuggerProfilerInit(struct mDebuggerProfiler*, struct mCore*);
+void mDebuggerProfilerDeinit(struct mDebuggerProfiler*);
+
+// These must be called on the thread running the core, or with it interrupted
+bool mDebuggerProfilerStart(struct mDebuggerProfiler*, int32_t interval);
+void mDebuggerProfilerStop(struct mDebuggerProfiler*);
+// Resetting the core or loading a state drops the sampling event; this puts it back
+void mDebuggerProfilerUpdate(struct mDebuggerProfiler*);
+void mDebuggerProfilerClear(struct mDebuggerProfiler*);
+
+void mDebuggerProfilerAddSample(struct mDebuggerProfiler*, const struct mDebuggerProfilerLocation* stack, size_t depth);
+
+// Writes one line per stack in the folded format used by flamegraph.pl, speedscope and others
+bool mDebuggerProfilerWriteFolded(const struct mDebuggerProfiler*, const struct mDebuggerSymbols*, struct VFile*);
+// Fills entries with the functions most often seen at the top of the stack, busiest first
+size_t mDebuggerProfilerSummarize(const struct mDebuggerProfiler*, const struct mDebuggerSymbols*, struct mDebuggerProfilerEntry* entries, size_t max);
+
+CXX_GUARD_END
+
+#endif
@@ -0,0 +1,78 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef DEBUGGER_RUN_UNTIL_H
+#define DEBUGGER_RUN_UNTIL_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/timing.h>
+#include <mgba/debugger/debugger.h>
+
+#define mDEBUGGER_RUN_UNTIL_TIMEOUT -1
+#define mDEBUGGER_RUN_UNTIL_ERROR -2
+
+enum mDebuggerRunUntilType {
+	RUN_UNTIL_MEMORY_EQUALS,
+	RUN_UNTIL_MEMORY_CHANGES,
+	RUN_UNTIL_PC,
+	RUN_UNTIL_FRAMES,
+	RUN_UNTIL_INPUT_POLL,
+};
+
+struct mDebuggerRunUntilCondition {
+	enum mDebuggerRunUntilType type;
+	uint32_t address;
+	int segment;
+	// Size of the value in bytes for memory conditions: 1, 2 or 4
+	int width;
+	// The value to wait for with RUN_UNTIL_MEMORY_EQUALS, or the number of frames with RUN_UNTIL_FRAMES
+	uint32_t value;
+	// An optional debugger expression, e.g. "r0 == 3", that must also be true when the condition is met
+	const char* expression;
+};
+
+struct ParseTree;
+struct ParseProgram;
+struct mDebuggerRunUntilPoint {
+	ssize_t id;
+	uint32_t lastValue;
+	struct ParseTree* expression;
+	struct ParseProgram* program;
+};
+
+DECLARE_VECTOR(mDebuggerRunUntilPointList, struct mDebuggerRunUntilPoint);
+
+// Runs the core until one of a set of conditions is met without returning to the caller in
+// between. PC conditions become breakpoints and memory and input conditions become watchpoints,
+// so only the pages being watched are checked on each access. Memory is also checked at the end
+// of each frame, which catches values written by DMA.
+struct mDebuggerRunUntil {
+	struct mDebuggerModule d;
+	struct mTimingEvent timeout;
+	uint64_t cyclesLeft;
+	bool timedOut;
+
+	const struct mDebuggerRunUntilCondition* conditions;
+	struct mDebuggerRunUntilPointList points;
+	uint32_t startFrame;
+	ssize_t hit;
+	bool memoryDirty;
+};
+
+void mDebuggerRunUntilInit(struct mDebuggerRunUntil*);
+void mDebuggerRunUntilDeinit(struct mDebuggerRunUntil*);
+
+// The module must be attached to a debugger that is attached to a running core. Returns the index
+// of the condition that was met, mDEBUGGER_RUN_UNTIL_TIMEOUT once maxCycles have run (0 for no
+// limit) or mDEBUGGER_RUN_UNTIL_ERROR if a condition is invalid or the debugger shuts down. A
+// memory value that already matches returns without running anything.
+ssize_t mDebuggerRunUntil(struct mDebuggerRunUntil*, const struct mDebuggerRunUntilCondition* conditions, size_t nConditions, uint64_t maxCycles);
+
+CXX_GUARD_END
+
+#endif
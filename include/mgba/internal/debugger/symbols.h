@@ -17,8 +17,11 @@ void mDebuggerSymbolTableDestroy(struct mDebuggerSymbols*);
 
 bool mDebuggerSymbolLookup(const struct mDebuggerSymbols*, const char* name, int32_t* value, int* segment);
 const char* mDebuggerSymbolReverseLookup(const struct mDebuggerSymbols*, int32_t value, int segment);
+// Finds the closest symbol at or below an address, skipping symbols of known size that end before it
+const char* mDebuggerSymbolReverseLookupNearest(const struct mDebuggerSymbols*, int32_t value, int segment, uint32_t* offset);
 
 void mDebuggerSymbolAdd(struct mDebuggerSymbols*, const char* name, int32_t value, int segment);
+void mDebuggerSymbolAddSized(struct mDebuggerSymbols*, const char* name, int32_t value, int segment, uint32_t size);
 void mDebuggerSymbolRemove(struct mDebuggerSymbols*, const char* name);
 
 struct VFile;
@@ -0,0 +1,57 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/debugger/debugger.h>
+
+#define mDEBUGGER_TRACE_BUFFER_SIZE 0x10000
+
+struct VFile;
+
+struct mDebuggerTraceRecorder {
+	struct mDebuggerModule d;
+	struct VFile* vf;
+	uint8_t* buffer;
+	size_t bufferUsed;
+
+	struct mDebuggerTraceState last;
+	uint64_t lastCycle;
+	uint64_t records;
+	bool hasLast;
+};
+
+struct mDebuggerTraceReader {
+	struct VFile* vf;
+	int platform;
+	unsigned nRegisters;
+
+	struct mDebuggerTraceState state;
+	uint64_t cycle;
+	uint64_t index;
+};
+
+void mDebuggerTraceRecorderInit(struct mDebuggerTraceRecorder*);
+void mDebuggerTraceRecorderDeinit(struct mDebuggerTraceRecorder*);
+
+bool mDebuggerTraceRecorderOpen(struct mDebuggerTraceRecorder*, struct VFile*, int platform, unsigned nRegisters);
+bool mDebuggerTraceRecorderClose(struct mDebuggerTraceRecorder*);
+
+void mDebuggerTraceRecorderAppend(struct mDebuggerTraceRecorder*, const struct mDebuggerTraceState*, uint64_t cycle);
+bool mDebuggerTraceRecorderFlush(struct mDebuggerTraceRecorder*);
+
+bool mDebuggerTraceReaderOpen(struct mDebuggerTraceReader*, struct VFile*);
+void mDebuggerTraceReaderClose(struct mDebuggerTraceReader*);
+bool mDebuggerTraceReaderNext(struct mDebuggerTraceReader*);
+void mDebuggerTraceReaderFormat(const struct mDebuggerTraceReader*, char* out, size_t* length);
+
+CXX_GUARD_END
+
+#endif
@@ -207,15 +207,26 @@ struct GBAudio {
 	bool enable;
 
 	size_t samples;
+	size_t bufferCapacity;
 	bool forceDisableCh[4];
 	int masterVolume;
+	int outputSkipFrames;
+	// Stops samples from being generated at all, while keeping channel state exact
+	bool outputDisabled;
 };
 
+#define GB_AUDIO_BUFFER_CAPACITY 0x4000
+#define GB_AUDIO_BUFFER_CAPACITY_SLIM 0x800
+
 void GBAudioInit(struct GBAudio* audio, size_t samples, uint8_t* nr52, enum GBAudioStyle style);
 void GBAudioDeinit(struct GBAudio* audio);
 void GBAudioReset(struct GBAudio* audio);
 
 void GBAudioResizeBuffer(struct GBAudio* audio, size_t samples);
+// Reallocates the output buffers to hold capacity samples, keeping their rates. The buffered
+// sample count is limited to half of it. The caller must hold the audio lock, and anything
+// holding on to the buffers needs to fetch them again.
+void GBAudioSetBufferCapacity(struct GBAudio* audio, size_t capacity);
 
 void GBAudioWriteNR10(struct GBAudio* audio, uint8_t);
 void GBAudioWriteNR11(struct GBAudio* audio, uint8_t);
@@ -246,7 +257,13 @@ void GBAudioWriteNR52(struct GBAudio* audio, uint8_t);
 void GBAudioRun(struct GBAudio* audio, int32_t timestamp, int channels);
 void GBAudioUpdateFrame(struct GBAudio* audio);
 
+unsigned GBAudioSampleRate(const struct GBAudio* audio);
+
 void GBAudioSamplePSG(struct GBAudio* audio, int16_t* left, int16_t* right);
+// Runs the PSG up to each of count timestamps, interval cycles apart, and samples it at each one.
+// Produces the same output as alternating GBAudioRun and GBAudioSamplePSG. count must not exceed
+// GB_MAX_SAMPLES.
+void GBAudioSamplePSGBatch(struct GBAudio* audio, int32_t timestamp, int32_t interval, struct mStereoSample* samples, int count);
 
 struct GBSerializedPSGState;
 void GBAudioPSGSerialize(const struct GBAudio* audio, struct GBSerializedPSGState* state, uint32_t* flagsOut);
@@ -35,6 +35,12 @@ enum GBIRQ {
 	GB_IRQ_KEYPAD = 0x4,
 };
 
+enum GBIdleLoopOptimization {
+	GB_IDLE_LOOP_IGNORE = -1,
+	GB_IDLE_LOOP_REMOVE = 0,
+	GB_IDLE_LOOP_DETECT
+};
+
 enum GBIRQVector {
 	GB_VECTOR_VBLANK = 0x40,
 	GB_VECTOR_LCDSTAT = 0x48,
@@ -86,7 +92,10 @@ struct GBXMetadata {
 
 struct SM83Core;
 struct mCoreSync;
+struct mAVBuffer;
 struct mAVStream;
+struct mROMImage;
+struct mROMImageRegistry;
 struct GB {
 	struct mCPUComponent d;
 
@@ -110,6 +119,9 @@ struct GB {
 	enum GBMemoryBankControllerType yankedMbc;
 	uint32_t romCrc32;
 	struct VFile* romVf;
+	// If set, pristine ROMs are shared with every other core using the same registry
+	struct mROMImageRegistry* romRegistry;
+	struct mROMImage* romImage;
 	struct VFile* biosVf;
 	struct VFile* sramVf;
 	struct VFile* sramRealVf;
@@ -127,13 +139,25 @@ struct GB {
 
 	struct mCoreCallbacksList coreCallbacks;
 	struct mAVStream* stream;
+	struct mAVBuffer* streamBuffer;
 
 	bool cpuBlocked;
 	bool earlyExit;
 	struct mTimingEvent eiPending;
 	unsigned doubleSpeed;
 
+	enum GBIdleLoopOptimization idleOptimization;
+	// The ROM bank is kept in the upper 16 bits, since banked code can share an address
+	uint32_t idleLoop;
+	// Set when idleLoop came from the detector rather than an override
+	bool idleLoopDetected;
+	uint32_t lastJump;
+	int idleDetectionStep;
+	int idleDetectionFailures;
+
 	bool allowOpposingDirections;
+	// Keep memory use down, for hosts running many instances
+	bool slim;
 };
 
 struct GBCartridge {
@@ -171,9 +195,12 @@ void GBDetectModel(struct GB* gb);
 
 void GBUpdateIRQs(struct GB* gb);
 void GBHalt(struct SM83Core* cpu);
+void GBSetSlim(struct GB* gb, bool slim);
 
 struct VFile;
 bool GBLoadROM(struct GB* gb, struct VFile* vf);
+// Loads the ROM source is running, as it currently is, sharing it with source where possible
+bool GBCloneROM(struct GB* gb, const struct GB* source);
 bool GBLoadSave(struct GB* gb, struct VFile* vf);
 void GBUnloadROM(struct GB* gb);
 void GBSynthesizeROM(struct VFile* vf);
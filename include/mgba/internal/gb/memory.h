@@ -65,6 +65,10 @@ enum {
 	GB_SIZE_MBC6_FLASH = 0x100000,
 };
 
+#define GB_PAGE_SHIFT 8
+#define GB_PAGE_SIZE (1 << GB_PAGE_SHIFT)
+#define GB_PAGES (0x10000 >> GB_PAGE_SHIFT)
+
 struct GBMemory;
 typedef void (*GBMemoryBankControllerWrite)(struct GB*, uint16_t address, uint8_t value);
 typedef uint8_t (*GBMemoryBankControllerRead)(struct GBMemory*, uint16_t address);
@@ -340,6 +344,21 @@ struct GBMemory {
 	struct mRotationSource* rotation;
 	struct mRumble* rumble;
 	struct mImageSource* cam;
+
+	// Host memory backing each page that loads or stores can go to directly, or NULL if accesses
+	// to that page need to be fully decoded. Only ROM and WRAM banks are ever mapped here.
+	const uint8_t* readPages[GB_PAGES];
+	uint8_t* writePages[GB_PAGES];
+
+	// Stores to pages with their bit set here are never mapped, and get reported to the watcher
+	struct mCoreMemoryWatcher* watcher;
+	struct mCoreMemoryWatchRange* watchRanges;
+	size_t nWatchRanges;
+	uint32_t watchedPages[GB_PAGES / 32];
+
+	// Per-region access counts, or NULL if they're not being collected. Unlike on the GBA, opcode
+	// fetches can't be told apart from data reads, so they're counted as reads too.
+	struct mCoreMemoryStats* stats;
 };
 
 struct SM83Core;
@@ -348,6 +367,11 @@ void GBMemoryDeinit(struct GB* gb);
 
 void GBMemoryReset(struct GB* gb);
 void GBMemorySwitchWramBank(struct GBMemory* memory, int bank);
+// Must be called whenever a bank, the ROM or the MBC's read and write hooks change
+void GBMemoryUpdatePages(struct GBMemory* memory);
+void GBMemorySetWatcher(struct GBMemory* memory, struct mCoreMemoryWatcher* watcher, const struct mCoreMemoryWatchRange* ranges, size_t nRanges);
+void GBMemorySetStatsEnabled(struct GB* gb, bool enable);
+size_t GBMemoryCollectStats(const struct GBMemory* memory, struct mCoreMemoryStats* stats, size_t max);
 
 uint8_t GBLoad8(struct SM83Core* cpu, uint16_t address);
 void GBStore8(struct SM83Core* cpu, uint16_t address, int8_t value);
@@ -12,6 +12,9 @@ CXX_GUARD_START
 
 #include <mgba/gb/interface.h>
 
+// No game idles at the reset vector of bank 0, so zero can mean unset like it does for colors
+#define GB_IDLE_LOOP_NONE 0
+
 enum GBColorLookup {
 	GB_COLORS_NONE = 0,
 	GB_COLORS_CGB = 1,
@@ -25,6 +28,7 @@ struct GBCartridgeOverride {
 	enum GBMemoryBankControllerType mbc;
 
 	uint32_t gbColors[12];
+	uint32_t idleLoop;
 };
 
 struct GBColorPreset {
@@ -0,0 +1,32 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GB_RENDERER_COMMON_H
+#define GB_RENDERER_COMMON_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/internal/gb/video.h>
+
+// Marks a decoded SGB border pixel whose tile is out of range and shouldn't be drawn
+#define SGB_BORDER_SKIP 0x80
+
+struct GBVideoRendererSprite {
+	struct GBObj obj;
+	int8_t index;
+};
+
+int GBVideoRendererCleanOAM(const union GBOAM* oam, struct GBVideoRendererSprite* sprites, int y, GBRegisterLCDC lcdc, enum GBModel model);
+
+// Applies the attribute commands of an SGB packet; packet is the renderer's own copy, as PAL_SET rewrites it
+void GBVideoRendererParseSGBAttributes(struct GBVideoRenderer* renderer, uint8_t* packet);
+// Decodes the SGB border into 256x224 palette indices, marking the game area tiles that need drawing over it
+void GBVideoRendererDecodeSGBBorder(const struct GBVideoRenderer* renderer, uint8_t* indices, uint32_t* overlayMask);
+
+CXX_GUARD_END
+
+#endif
@@ -0,0 +1,131 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GB_RENDERER_GL_H
+#define GB_RENDERER_GL_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/core.h>
+#include <mgba/internal/gb/gb.h>
+#include <mgba/internal/gb/renderers/common.h>
+#include <mgba/internal/gb/video.h>
+
+#ifdef BUILD_GLES3
+
+#ifdef USE_EPOXY
+#include <epoxy/gl.h>
+#elif defined(__APPLE__)
+#include <OpenGL/gl3.h>
+#elif defined(BUILD_GL)
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#else
+#include <GLES3/gl3.h>
+#endif
+
+// Spans are queued until VRAM or the palette changes under them, then drawn with one call
+#define GB_GL_MAX_SPANS 256
+#define GB_GL_SPAN_TEXELS 9
+
+enum {
+	GB_GL_VS_SPANS = 0,
+	GB_GL_VS_ORIGIN,
+	GB_GL_VS_DIMS,
+
+	GB_GL_SPAN_VRAM = 3,
+	GB_GL_SPAN_PALETTE,
+	GB_GL_SPAN_BORDER,
+	GB_GL_SPAN_SCALE,
+
+	GB_GL_BORDER_PALETTE = 3,
+	GB_GL_BORDER_BORDER,
+	GB_GL_BORDER_SCALE,
+
+	GB_GL_UNIFORM_MAX = 7
+};
+
+struct GBVideoGLShader {
+	GLuint program;
+	GLuint vao;
+	GLuint uniforms[GB_GL_UNIFORM_MAX];
+};
+
+struct GBVideoGLRenderer {
+	struct GBVideoRenderer d;
+
+	uint32_t* temporaryBuffer;
+	size_t temporaryBufferSize;
+
+	GLuint fbo;
+	GLuint vbo;
+
+	GLuint outputTex;
+	bool outputTexDirty;
+	int scale;
+
+	GLuint vramTex;
+	// One bit per 512 bytes, which is two rows of the VRAM texture
+	uint32_t vramDirty;
+
+	GLuint paletteTex;
+	uint32_t palette[128];
+	uint8_t lookup[64];
+	bool paletteDirty;
+
+	GLuint spanTex;
+	GLint spans[GB_GL_MAX_SPANS][GB_GL_SPAN_TEXELS * 4];
+	int nSpans;
+
+	GLuint borderTex;
+	uint8_t* borderIndices;
+	bool borderActive;
+
+	struct GBVideoGLShader spanShader;
+	struct GBVideoGLShader borderShader;
+
+	// SGB transfers read the picture back, so their BG is also decoded here
+	uint8_t row[GB_VIDEO_HORIZONTAL_PIXELS + 8];
+
+	uint8_t scy;
+	uint8_t scx;
+	uint8_t wy;
+	uint8_t wx;
+	uint8_t currentWy;
+	uint8_t currentWx;
+	int lastY;
+	int lastX;
+	bool hasWindow;
+
+	GBRegisterLCDC lcdc;
+	enum GBModel model;
+
+	struct GBVideoRendererSprite obj[GB_VIDEO_MAX_LINE_OBJ];
+	int objMax;
+
+	int16_t objOffsetX;
+	int16_t objOffsetY;
+	int16_t offsetScx;
+	int16_t offsetScy;
+	int16_t offsetWx;
+	int16_t offsetWy;
+
+	int sgbTransfer;
+	uint8_t sgbPacket[128];
+	uint8_t sgbCommandHeader;
+	bool sgbBorders;
+};
+
+void GBVideoGLRendererCreate(struct GBVideoGLRenderer* renderer);
+void GBVideoGLRendererSetScale(struct GBVideoGLRenderer* renderer, int scale);
+
+#endif
+
+CXX_GUARD_END
+
+#endif
@@ -12,18 +12,16 @@ CXX_GUARD_START
 
 #include <mgba/core/core.h>
 #include <mgba/internal/gb/gb.h>
+#include <mgba/internal/gb/renderers/common.h>
 #include <mgba/internal/gb/video.h>
 
-struct GBVideoRendererSprite {
-	struct GBObj obj;
-	int8_t index;
-};
-
 struct GBVideoSoftwareRenderer {
 	struct GBVideoRenderer d;
 
 	color_t* outputBuffer;
 	int outputBufferStride;
+	// If set, converts BGR555 colors to the output format instead of mColorFrom555
+	const color_t* colorTable;
 
 	// TODO: Implement the pixel FIFO
 	uint16_t row[GB_VIDEO_HORIZONTAL_PIXELS + 8];
@@ -61,6 +59,9 @@ struct GBVideoSoftwareRenderer {
 	uint8_t sgbCommandHeader;
 	bool sgbBorders;
 	uint32_t sgbBorderMask[18];
+	// The border decoded to palette indices, so redrawing it doesn't mean decoding every tile again
+	uint8_t* sgbBorderCache;
+	bool sgbBorderCacheValid;
 
 	uint8_t lastHighlightAmount;
 };
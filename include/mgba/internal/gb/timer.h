@@ -34,6 +34,10 @@ struct GBTimer {
 
 void GBTimerReset(struct GBTimer*);
 void GBTimerDivReset(struct GBTimer*);
+// Brings DIV and TIMA up to date; they're otherwise only updated when TIMA overflows or the APU steps
+void GBTimerSync(struct GBTimer*);
+// Call after changing TIMA so the next overflow is scheduled at the right time
+void GBTimerReschedule(struct GBTimer*);
 uint8_t GBTimerUpdateTAC(struct GBTimer*, GBRegisterTAC tac);
 
 struct GBSerializedState;
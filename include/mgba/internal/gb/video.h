@@ -145,6 +145,11 @@ struct GBVideo {
 	struct mTimingEvent frameEvent;
 
 	int32_t dotClock;
+	// Mode 3 starts a fixed time after mode 2, so unless something changes in between, it's entered
+	// when something first looks instead of by its own event. modeEvent is then already set for the
+	// end of mode 3.
+	bool mode3Pending;
+	int32_t mode3Start;
 
 	uint8_t* vram;
 	uint8_t* vramBank;
@@ -169,6 +174,7 @@ struct GBVideo {
 	uint32_t frameCounter;
 	int frameskip;
 	int frameskipCounter;
+	int skipFrames;
 };
 
 void GBVideoInit(struct GBVideo* video);
@@ -180,6 +186,8 @@ void GBVideoAssociateRenderer(struct GBVideo* video, struct GBVideoRenderer* ren
 
 void GBVideoSkipBIOS(struct GBVideo* video);
 void GBVideoProcessDots(struct GBVideo* video, uint32_t cyclesLate);
+void GBVideoSyncMode(struct GBVideo* video, uint32_t cyclesLate);
+void GBVideoSyncModeExact(struct GBVideo* video, uint32_t cyclesLate);
 
 void GBVideoWriteLCDC(struct GBVideo* video, GBRegisterLCDC value);
 void GBVideoWriteSTAT(struct GBVideo* video, GBRegisterSTAT value);
@@ -93,6 +93,12 @@ struct GBAAudio {
 	bool forceDisableChA;
 	bool forceDisableChB;
 	int masterVolume;
+	int outputSkipFrames;
+	// Stops samples from being generated at all, while keeping FIFO and PSG state exact
+	bool outputDisabled;
+	// Lets timers that only drive the FIFOs skip overflow events; their overflows are handled
+	// once per sample period instead, and any DMA refills they trigger are deferred to then
+	bool bulkFifo;
 
 	struct mTimingEvent sampleEvent;
 };
@@ -284,6 +290,7 @@ void GBAAudioReset(struct GBAAudio* audio);
 void GBAAudioDeinit(struct GBAAudio* audio);
 
 void GBAAudioResizeBuffer(struct GBAAudio* audio, size_t samples);
+void GBAAudioSetBufferCapacity(struct GBAAudio* audio, size_t capacity);
 
 void GBAAudioScheduleFifoDma(struct GBAAudio* audio, int number, struct GBADMA* info);
 
@@ -306,8 +313,11 @@ void GBAAudioWriteWaveRAM(struct GBAAudio* audio, int address, uint32_t value);
 uint32_t GBAAudioReadWaveRAM(struct GBAAudio* audio, int address);
 uint32_t GBAAudioWriteFIFO(struct GBAAudio* audio, int address, uint32_t value);
 void GBAAudioSampleFIFO(struct GBAAudio* audio, int fifoId, int32_t cycles);
+// Handles a timer overflow that happened at timestamp, earlier in the current sample period
+void GBAAudioSampleFIFOBulk(struct GBAAudio* audio, int fifoId, int32_t timestamp);
 
 void GBAAudioSample(struct GBAAudio* audio, int32_t timestamp);
+unsigned GBAAudioSampleRate(const struct GBAAudio* audio);
 
 struct GBASerializedState;
 void GBAAudioSerialize(const struct GBAAudio* audio, struct GBASerializedState* state);
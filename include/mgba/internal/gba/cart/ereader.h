@@ -53,7 +53,9 @@ enum EReaderCommand {
 };
 
 struct EReaderCard {
-	void* data;
+	// Rendered when the card is queued, so scanning it doesn't have to
+	uint8_t* dots;
+	uint32_t crc;
 	size_t size;
 };
 
@@ -76,6 +78,8 @@ struct GBACartEReader {
 	int scanX;
 	int scanY;
 	uint8_t* dots;
+	uint32_t dotsCrc;
+	size_t dotsSize;
 	struct EReaderCard cards[EREADER_CARDS_MAX];
 };
 
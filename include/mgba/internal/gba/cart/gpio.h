@@ -71,6 +71,11 @@ struct GBARTC {
 	uint8_t time[7];
 	time_t lastLatch;
 	time_t offset;
+
+	// The last time broken down into a date, so polling the same second doesn't redo it
+	time_t dateTime;
+	struct tm date;
+	bool dateValid;
 };
 
 DECL_BITFIELD(GPIOPin, uint16_t);
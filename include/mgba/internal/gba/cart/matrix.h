@@ -19,6 +19,8 @@ struct GBAMatrix {
 	uint32_t size;
 
 	uint32_t mappings[GBA_MATRIX_MAPPINGS_MAX];
+	// Which pages of the window already hold the data their mapping points to
+	uint32_t loaded;
 };
 
 struct GBA;
@@ -25,13 +25,17 @@ struct GBAVFameCart {
 	int romMode;
 	int8_t writeSequence[5];
 	bool acceptingModeChange;
+
+	// Pattern values for the 64 KiB bank last read past the end of the ROM
+	int patternBank;
+	uint16_t patternCache[0x8000];
 };
 
 void GBAVFameInit(struct GBAVFameCart* cart);
 void GBAVFameDetect(struct GBAVFameCart* cart, uint32_t* rom, size_t romSize);
 void GBAVFameSramWrite(struct GBAVFameCart* cart, uint32_t address, uint8_t value, uint8_t* sramData);
 uint32_t GBAVFameModifyRomAddress(struct GBAVFameCart* cart, uint32_t address, size_t romSize);
-uint32_t GBAVFameGetPatternValue(uint32_t address, int bits);
+uint32_t GBAVFameGetPatternValue(struct GBAVFameCart* cart, uint32_t address, int bits);
 
 CXX_GUARD_END
 
@@ -51,6 +51,9 @@ enum {
 };
 
 struct ARMCore;
+struct mAVBuffer;
+struct mROMImage;
+struct mROMImageRegistry;
 struct GBA;
 struct Patch;
 struct VFile;
@@ -97,10 +100,14 @@ struct GBA {
 	size_t yankedRomSize;
 	uint32_t romCrc32;
 	struct VFile* romVf;
+	// If set, pristine ROMs are shared with every other core using the same registry
+	struct mROMImageRegistry* romRegistry;
+	struct mROMImage* romImage;
 	struct VFile* biosVf;
 	struct VFile* mbVf;
 
 	struct mAVStream* stream;
+	struct mAVBuffer* streamBuffer;
 	struct mKeyCallback* keyCallback;
 	struct mCoreCallbacksList coreCallbacks;
 
@@ -115,12 +122,18 @@ struct GBA {
 
 	int idleDetectionStep;
 	int idleDetectionFailures;
+	// Set when idleLoop came from the detector rather than an override
+	bool idleLoopDetected;
 	int32_t cachedRegisters[16];
 	bool taintedRegisters[16];
 
 	bool vbaBugCompat;
 	bool hardCrash;
 	bool allowOpposingDirections;
+	// Run CpuSet and CpuFastSet as host copies when they only touch plain memory
+	bool directCpuSet;
+	// Keep memory use down, for hosts running many instances
+	bool slim;
 
 	bool debug;
 	char debugString[0x100];
@@ -147,12 +160,14 @@ void GBADestroy(struct GBA* gba);
 
 void GBAReset(struct ARMCore* cpu);
 void GBASkipBIOS(struct GBA* gba);
+void GBASetSlim(struct GBA* gba, bool slim);
 
 void GBARaiseIRQ(struct GBA* gba, enum GBAIRQ irq, uint32_t cyclesLate);
 void GBATestIRQ(struct GBA* gba, uint32_t cyclesLate);
 void GBAHalt(struct GBA* gba);
 void GBAStop(struct GBA* gba);
 void GBADebug(struct GBA* gba, uint16_t value);
+void GBALogCallStack(struct GBA* gba, enum mLogLevel level);
 
 #ifdef USE_ELF
 struct ELF;
@@ -171,6 +186,8 @@ void GBASetBreakpoint(struct GBA* gba, struct mCPUComponent* component, uint32_t
 void GBAClearBreakpoint(struct GBA* gba, uint32_t address, enum ExecutionMode mode, uint32_t opcode);
 
 bool GBALoadROM(struct GBA* gba, struct VFile* vf);
+// Loads the ROM source is running, as it currently is, sharing it with source where possible
+bool GBACloneROM(struct GBA* gba, const struct GBA* source);
 bool GBALoadSave(struct GBA* gba, struct VFile* sav);
 void GBAYankROM(struct GBA* gba);
 void GBAUnloadROM(struct GBA* gba);
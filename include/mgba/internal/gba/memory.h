@@ -90,6 +90,11 @@ enum {
 	AGB_PRINT_FLUSH_ADDR = 0x00FE209C,
 };
 
+enum GBAPrefetchModel {
+	GBA_PREFETCH_ACCURATE = 0,
+	GBA_PREFETCH_FAST,
+};
+
 mLOG_DECLARE_CATEGORY(GBA_MEM);
 
 struct GBAPrintContext {
@@ -99,6 +104,15 @@ struct GBAPrintContext {
 	uint16_t put;
 };
 
+#define GBA_DIRTY_PAGE_SHIFT 12
+#define GBA_DIRTY_PAGES ((GBA_SIZE_EWRAM + GBA_SIZE_IWRAM) >> GBA_DIRTY_PAGE_SHIFT)
+#define GBA_DIRTY_IWRAM_BASE (GBA_SIZE_EWRAM >> GBA_DIRTY_PAGE_SHIFT)
+
+#define GBA_PAGE_SHIFT 14
+#define GBA_PAGE_SIZE (1 << GBA_PAGE_SHIFT)
+#define GBA_PAGES (0x10000000 >> GBA_PAGE_SHIFT)
+#define GBA_WRITE_PAGES (GBA_BASE_IO >> GBA_PAGE_SHIFT)
+
 struct GBAMemory {
 	uint32_t* bios;
 	uint32_t* wram;
@@ -122,6 +136,7 @@ struct GBAMemory {
 	char waitstatesNonseq16[256];
 	int activeRegion;
 	bool prefetch;
+	enum GBAPrefetchModel prefetchModel;
 	uint32_t lastPrefetchedPc;
 	uint32_t biosPrefetch;
 
@@ -140,6 +155,26 @@ struct GBAMemory {
 	uint16_t* agbPrintBufferBackup;
 
 	bool mirroring;
+
+	uint8_t dirtyPages[GBA_DIRTY_PAGES];
+	uint32_t dirtyEpochs[GBA_DIRTY_PAGES];
+	uint32_t dirtyEpoch;
+	uint64_t pageHashes[GBA_DIRTY_PAGES];
+	uint32_t hashEpoch;
+
+	// Host memory backing each page that loads or stores can go to directly, or NULL if accesses
+	// to that page need to be fully decoded. Only plain RAM and ROM are ever mapped here.
+	uint8_t* readPages[GBA_PAGES];
+	uint8_t* writePages[GBA_WRITE_PAGES];
+
+	// Stores to pages with their bit set here are never mapped, and get reported to the watcher
+	struct mCoreMemoryWatcher* watcher;
+	struct mCoreMemoryWatchRange* watchRanges;
+	size_t nWatchRanges;
+	uint32_t watchedPages[GBA_PAGES / 32];
+
+	// Per-region access counts, or NULL if they're not being collected
+	struct mCoreMemoryStats* stats;
 };
 
 struct GBA;
@@ -148,6 +183,11 @@ void GBAMemoryDeinit(struct GBA* gba);
 
 void GBAMemoryReset(struct GBA* gba);
 void GBAMemoryClearAGBPrint(struct GBA* gba);
+// Must be called whenever the ROM buffer or its size changes
+void GBAMemoryUpdatePages(struct GBA* gba);
+void GBAMemorySetWatcher(struct GBA* gba, struct mCoreMemoryWatcher* watcher, const struct mCoreMemoryWatchRange* ranges, size_t nRanges);
+void GBAMemorySetStatsEnabled(struct GBA* gba, bool enable);
+size_t GBAMemoryCollectStats(const struct GBAMemory* memory, struct mCoreMemoryStats* stats, size_t max);
 
 uint32_t GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter);
 uint32_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter);
@@ -172,11 +212,20 @@ uint32_t GBALoadMultiple(struct ARMCore*, uint32_t baseAddress, int mask, enum L
 uint32_t GBAStoreMultiple(struct ARMCore*, uint32_t baseAddress, int mask, enum LSMDirection direction,
                           int* cycleCounter);
 
+// Copy or fill plain RAM and VRAM straight through host memory, returning false if any of the range
+// needs the bus. Copies whose source and destination are less than burst bytes apart also return false.
+bool GBAMemoryCopyDirect(struct GBA* gba, uint32_t dest, uint32_t source, uint32_t size, uint32_t burst);
+bool GBAMemoryFillDirect(struct GBA* gba, uint32_t dest, uint32_t value, uint32_t size, int width);
+
 void GBAAdjustWaitstates(struct GBA* gba, uint16_t parameters);
 void GBAAdjustEWRAMWaitstates(struct GBA* gba, uint16_t parameters);
+int32_t GBAMemoryStall(struct ARMCore* cpu, int32_t wait);
 
 struct GBASerializedState;
 void GBAMemorySerialize(const struct GBAMemory* memory, struct GBASerializedState* state);
+void GBAMemorySerializeIncremental(struct GBAMemory* memory, struct GBASerializedState* state, uint32_t* epoch);
+void GBAMemoryMarkDirty(struct GBAMemory* memory);
+uint64_t GBAMemoryHashRAM(struct GBAMemory* memory, uint64_t seed);
 void GBAMemoryDeserialize(struct GBAMemory* memory, const struct GBASerializedState* state);
 
 void GBAPrintFlush(struct GBA* gba);
@@ -31,6 +31,17 @@ struct GBA;
 void GBAOverrideApply(struct GBA*, const struct GBACartridgeOverride*);
 void GBAOverrideApplyDefaults(struct GBA*, const struct Configuration*);
 
+#ifdef USE_SQLITE3
+struct mLibrary;
+// Applies an idle loop the detector found for this ROM in an earlier session, if there is one
+bool GBAOverrideLoadIdleLoop(struct GBA*, struct mLibrary*);
+// Remembers the idle loop the detector found in this session, if it found one
+void GBAOverrideSaveIdleLoop(struct GBA*, struct mLibrary*);
+// Writes out every remembered idle loop with at least minConfidence as an override. Game codes with
+// revisions that disagree on the address are skipped. Returns how many were written.
+size_t GBAOverrideExportIdleLoops(struct Configuration*, struct mLibrary*, unsigned minConfidence);
+#endif
+
 CXX_GUARD_END
 
 #endif
@@ -16,6 +16,7 @@ struct mCacheSet;
 void GBAVideoCacheInit(struct mCacheSet* cache);
 void GBAVideoCacheAssociate(struct mCacheSet* cache, struct GBAVideo* video);
 void GBAVideoCacheWriteVideoRegister(struct mCacheSet* cache, uint32_t address, uint16_t value);
+void GBAVideoCacheResync(struct mCacheSet* cache, const uint16_t* palette);
 
 CXX_GUARD_END
 
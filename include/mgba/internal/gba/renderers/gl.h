@@ -135,6 +135,7 @@ struct GBAVideoGLShader {
 	GLuint uniforms[GBA_GL_UNIFORM_MAX];
 };
 
+struct VDir;
 struct GBAVideoGLRenderer {
 	struct GBAVideoRenderer d;
 
@@ -162,6 +163,8 @@ struct GBAVideoGLRenderer {
 	bool paletteDirty;
 
 	GLuint vramTex;
+	GLuint vramBuffer;
+	size_t vramBufferOffset;
 	unsigned vramDirty;
 
 	uint16_t shadowRegs[0x30];
@@ -203,6 +206,9 @@ struct GBAVideoGLRenderer {
 	int firstY;
 
 	int scale;
+
+	// If set, linked shader programs are saved here, so later inits can skip compiling them
+	struct VDir* shaderCache;
 };
 
 void GBAVideoGLRendererCreate(struct GBAVideoGLRenderer* renderer);
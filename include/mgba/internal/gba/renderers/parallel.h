@@ -0,0 +1,52 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GBA_VIDEO_PARALLEL_H
+#define GBA_VIDEO_PARALLEL_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/feature/video-logger.h>
+#include <mgba-util/threading.h>
+
+#ifndef DISABLE_THREADING
+
+struct GBAVideoSoftwareRenderer;
+struct GBAVideoParallelWorker;
+
+// A video logger for GBAVideoProxyRenderer that replays each frame's log into several software
+// renderers at once, each one drawing its own band of scanlines into the same output buffer
+struct GBAVideoParallelProxy {
+	struct mVideoLogger d;
+
+	// Provides the output buffer. It is never drawn with directly.
+	struct GBAVideoSoftwareRenderer* renderer;
+	size_t nBands;
+
+	struct GBAVideoParallelWorker* workers;
+	size_t nWorkers;
+
+	uint8_t* frame;
+	size_t frameSize;
+	size_t frameCapacity;
+
+	Thread* threads;
+	Mutex mutex;
+	Condition workCond;
+	Condition doneCond;
+	unsigned generation;
+	size_t activeThreads;
+	bool quit;
+};
+
+void GBAVideoParallelProxyCreate(struct GBAVideoParallelProxy* proxy, struct GBAVideoSoftwareRenderer* renderer, size_t bands);
+
+#endif
+
+CXX_GUARD_END
+
+#endif
@@ -77,11 +77,20 @@ struct Window {
 	struct WindowControl control;
 };
 
+struct WindowKey {
+	int active;
+	struct GBAVideoWindowRegion h[2];
+	struct WindowControl control[2];
+	struct WindowControl winout;
+};
+
 struct GBAVideoSoftwareRenderer {
 	struct GBAVideoRenderer d;
 
 	color_t* outputBuffer;
 	int outputBufferStride;
+	// If set, converts BGR555 colors to the output format instead of mColorFrom555
+	const color_t* colorTable;
 
 	uint32_t* temporaryBuffer;
 
@@ -125,6 +134,8 @@ struct GBAVideoSoftwareRenderer {
 
 	int nWindows;
 	struct Window windows[MAX_WINDOW];
+	// What the window list was last built from, so lines that match can reuse it
+	struct WindowKey windowKey;
 
 	struct GBAVideoSoftwareBackground bg[4];
 
@@ -132,6 +143,8 @@ struct GBAVideoSoftwareRenderer {
 	bool oamDirty;
 	int oamMax;
 	struct GBAVideoRendererSprite sprites[128];
+	// Which entries of sprites intersect each scanline, in OAM order
+	uint32_t spriteLines[GBA_VIDEO_VERTICAL_PIXELS][4];
 	int16_t objOffsetX;
 	int16_t objOffsetY;
 
@@ -146,6 +159,10 @@ struct GBAVideoSoftwareRenderer {
 	int start;
 	int end;
 
+	// Scanlines outside of this range update the renderer's state but are not drawn
+	int bandStart;
+	int bandEnd;
+
 	uint8_t lastHighlightAmount;
 };
 
@@ -90,6 +90,9 @@ struct GBASavedata {
 
 	int dirty;
 	uint32_t dirtAge;
+	// Range of data that has changed since the last sync
+	uint32_t dirtStart;
+	uint32_t dirtEnd;
 
 	enum FlashStateMachine flashState;
 };
@@ -120,7 +123,10 @@ void GBASavedataWriteFlash(struct GBASavedata* savedata, uint16_t address, uint8
 
 uint16_t GBASavedataReadEEPROM(struct GBASavedata* savedata);
 void GBASavedataWriteEEPROM(struct GBASavedata* savedata, uint16_t value, uint32_t writeSize);
+// For writes serviced ahead of time, e.g. by bulk DMA: settling starts from when the write really happens
+void GBASavedataWriteEEPROMAhead(struct GBASavedata* savedata, uint16_t value, uint32_t writeSize, int32_t cyclesAhead);
 
+void GBASavedataMarkDirty(struct GBASavedata* savedata, uint32_t offset, uint32_t size);
 void GBASavedataClean(struct GBASavedata* savedata, uint32_t frameCount);
 
 void GBASavedataRTCRead(struct GBASavedata* savedata);
@@ -420,6 +420,7 @@ static_assert(sizeof(struct GBASerializedState) == 0x61000, "GBA savestate struc
 struct VDir;
 
 void GBASerialize(struct GBA* gba, struct GBASerializedState* state);
+void GBASerializeIncremental(struct GBA* gba, struct GBASerializedState* state, uint32_t* epoch);
 bool GBADeserialize(struct GBA* gba, const struct GBASerializedState* state);
 
 CXX_GUARD_END
@@ -26,8 +26,15 @@ struct GBASIODolphin {
 	Socket clock;
 
 	int32_t clockSlice;
+	// How far past the last clock Dolphin sent the core can get before it has to wait for more
+	int32_t runAhead;
 	int state;
 	bool active;
+
+	uint8_t clockBuffer[64];
+	size_t clockBufferSize;
+	uint8_t dataBuffer[64];
+	size_t dataBufferSize;
 };
 
 void GBASIODolphinCreate(struct GBASIODolphin*);
@@ -41,6 +41,18 @@ struct GBASIOLockstepNode {
 #endif
 };
 
+// Runs every linked GBA on the calling thread, letting each one catch up to the next sync point
+// in turn instead of blocking a thread per player
+struct mCore;
+struct GBASIOLockstepHub {
+	struct GBASIOLockstep d;
+	struct GBASIOLockstepNode nodes[MAX_GBAS];
+	struct mCore* cores[MAX_GBAS];
+	int32_t cyclesPosted[MAX_GBAS];
+	bool asleep[MAX_GBAS];
+	unsigned waitMask;
+};
+
 void GBASIOLockstepInit(struct GBASIOLockstep*);
 
 void GBASIOLockstepNodeCreate(struct GBASIOLockstepNode*);
@@ -48,6 +60,13 @@ void GBASIOLockstepNodeCreate(struct GBASIOLockstepNode*);
 bool GBASIOLockstepAttachNode(struct GBASIOLockstep*, struct GBASIOLockstepNode*);
 void GBASIOLockstepDetachNode(struct GBASIOLockstep*, struct GBASIOLockstepNode*);
 
+void GBASIOLockstepHubInit(struct GBASIOLockstepHub*);
+void GBASIOLockstepHubDeinit(struct GBASIOLockstepHub*);
+// Cores are given player numbers in the order they're attached
+bool GBASIOLockstepHubAttachCore(struct GBASIOLockstepHub*, struct mCore*);
+// Runs until player 1 finishes a frame, with everyone else kept in step
+bool GBASIOLockstepHubRunFrame(struct GBASIOLockstepHub*);
+
 CXX_GUARD_END
 
 #endif
@@ -0,0 +1,68 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GBA_SIO_NETWORK_H
+#define GBA_SIO_NETWORK_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/timing.h>
+#include <mgba/internal/gba/sio.h>
+
+#include <mgba-util/socket.h>
+
+#define GBA_SIO_NETWORK_QUEUE 16
+
+struct GBASIONetworkEntry {
+	uint32_t sequence;
+	// The sequence number of the transfer a reply is for
+	uint32_t transfer;
+	uint8_t type;
+	uint8_t mode;
+	uint32_t data;
+};
+
+// Links two GBAs over UDP in normal or multiplayer mode. Player 1 starts transfers and player 2
+// answers each one with whatever it has loaded to send. The emulated CPU is never held up waiting
+// on the network: a transfer just stays busy until the other side's data arrives, which games
+// already have to wait for on hardware.
+struct GBASIONetwork {
+	struct GBASIODriver d;
+	struct mTimingEvent event;
+
+	Socket socket;
+	struct Address peer;
+	int peerPort;
+	int id;
+	bool connected;
+
+	// Everything the peer hasn't acknowledged yet goes out again in each packet
+	struct GBASIONetworkEntry outbox[GBA_SIO_NETWORK_QUEUE];
+	size_t outboxSize;
+	uint32_t nextSequence;
+	uint32_t received;
+	bool dirty;
+	int32_t resendCycles;
+
+	enum GBASIOMode mode;
+	bool transferPending;
+	bool replyReceived;
+	uint32_t transferSequence;
+	int32_t transferCycles;
+	uint32_t reply;
+};
+
+void GBASIONetworkCreate(struct GBASIONetwork*);
+void GBASIONetworkDestroy(struct GBASIONetwork*);
+
+// Player 1 has an id of 0 and player 2 an id of 1
+bool GBASIONetworkOpen(struct GBASIONetwork*, int port, const struct Address* peer, int peerPort, int id);
+bool GBASIONetworkIsConnected(const struct GBASIONetwork*);
+
+CXX_GUARD_END
+
+#endif
@@ -17,6 +17,10 @@ DECL_BITS(GBATimerFlags, PrescaleBits, 0, 4);
 DECL_BIT(GBATimerFlags, CountUp, 4);
 DECL_BIT(GBATimerFlags, DoIrq, 5);
 DECL_BIT(GBATimerFlags, Enable, 6);
+// Overflows aren't scheduled as events, but are handed to the FIFOs in bulk by the audio sampler
+DECL_BIT(GBATimerFlags, Bulk, 7);
+// The scheduled event is only there to catch the timer up, not for an overflow
+DECL_BIT(GBATimerFlags, Checkpoint, 8);
 
 struct GBA;
 struct GBATimer {
@@ -27,10 +31,15 @@ struct GBATimer {
 };
 
 void GBATimerInit(struct GBA* gba);
+// Brings the counter up to date, along with any timers counting up after it
 void GBATimerUpdateRegister(struct GBA* gba, int timer, int32_t cyclesLate);
 void GBATimerWriteTMCNT_LO(struct GBA* gba, int timer, uint16_t value);
 void GBATimerWriteTMCNT_HI(struct GBA* gba, int timer, uint16_t value);
 
+// Works out again which overflows need events, for when something that observes them changes
+void GBATimerUpdateEvents(struct GBA* gba);
+void GBATimerRunBulk(struct GBA* gba, int32_t timestamp);
+
 CXX_GUARD_END
 
 #endif
@@ -173,6 +173,7 @@ DECL_BITS(GBAMosaicControl, ObjV, 12, 4);
 
 struct GBAVideoRenderer {
 	void (*init)(struct GBAVideoRenderer* renderer);
+	// Loading a state only calls this, so it has to resync everything from VRAM, OAM and palette RAM
 	void (*reset)(struct GBAVideoRenderer* renderer);
 	void (*deinit)(struct GBAVideoRenderer* renderer);
 
@@ -180,6 +181,9 @@ struct GBAVideoRenderer {
 	void (*writeVRAM)(struct GBAVideoRenderer* renderer, uint32_t address);
 	void (*writePalette)(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 	void (*writeOAM)(struct GBAVideoRenderer* renderer, uint32_t oam);
+	// Bulk transfers report everything they changed at once instead of one address at a time
+	void (*writeVRAMRange)(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t length);
+	void (*writeOAMRange)(struct GBAVideoRenderer* renderer, uint32_t oam, uint32_t count);
 	void (*drawScanline)(struct GBAVideoRenderer* renderer, int y);
 	void (*finishFrame)(struct GBAVideoRenderer* renderer);
 
@@ -200,6 +204,10 @@ struct GBAVideoRenderer {
 	bool highlightOBJ[128];
 	color_t highlightColor;
 	uint8_t highlightAmount;
+
+	// One bit per row whose output may have changed since GBAVideoCollectChangedScanlines last ran.
+	// Renderers that can't tell should mark every row each frame.
+	uint32_t changedScanlines[GBA_VIDEO_VERTICAL_PIXELS / 32];
 };
 
 struct GBAVideo {
@@ -217,6 +225,11 @@ struct GBAVideo {
 	uint32_t frameCounter;
 	int frameskip;
 	int frameskipCounter;
+	int skipFrames;
+
+	// Changed rows collected from the renderer that the AV stream and the core's users haven't seen yet
+	uint32_t streamChangedScanlines[GBA_VIDEO_VERTICAL_PIXELS / 32];
+	uint32_t coreChangedScanlines[GBA_VIDEO_VERTICAL_PIXELS / 32];
 };
 
 void GBAVideoInit(struct GBAVideo* video);
@@ -225,6 +238,8 @@ void GBAVideoDeinit(struct GBAVideo* video);
 
 void GBAVideoDummyRendererCreate(struct GBAVideoRenderer*);
 void GBAVideoAssociateRenderer(struct GBAVideo* video, struct GBAVideoRenderer* renderer);
+// Only up to date just after getPixels, since proxied renderers catch up then
+void GBAVideoCollectChangedScanlines(struct GBAVideo* video);
 
 void GBAVideoWriteDISPSTAT(struct GBAVideo* video, uint16_t value);
 
@@ -9,4 +9,8 @@
 
 extern struct mScriptEngine2* const mSCRIPT_ENGINE_LUA;
 
+#if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
+void mScriptEngineLuaGetBytecodePath(const char* script, char* out);
+#endif
+
 #endif
@@ -26,6 +26,8 @@ struct SM83Debugger {
 	struct SM83Core* cpu;
 
 	struct mBreakpointList breakpoints;
+	// One bit per address. A clear bit means there's no breakpoint there.
+	uint32_t breakpointFilter[0x800];
 	struct mWatchpointList watchpoints;
 	struct SM83Memory originalMemory;
 
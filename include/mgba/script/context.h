@@ -24,6 +24,26 @@ mLOG_DECLARE_CATEGORY(SCRIPT);
 struct mScriptFrame;
 struct mScriptFunction;
 struct mScriptEngineContext;
+struct mScriptCallbackEventInfo;
+
+// Callback events that every context interns up front, so hot paths can trigger them by ID
+enum mScriptCallbackEvent {
+	mSCRIPT_CALLBACK_NONE = 0,
+	mSCRIPT_CALLBACK_FRAME,
+	mSCRIPT_CALLBACK_CRASHED,
+	mSCRIPT_CALLBACK_SLEEP,
+	mSCRIPT_CALLBACK_STOP,
+	mSCRIPT_CALLBACK_KEYS_READ,
+	mSCRIPT_CALLBACK_SAVEDATA_UPDATED,
+	mSCRIPT_CALLBACK_ALARM,
+	mSCRIPT_CALLBACK_START,
+	mSCRIPT_CALLBACK_RESET,
+	mSCRIPT_CALLBACK_SHUTDOWN,
+	mSCRIPT_CALLBACK_MAX
+};
+
+DECLARE_VECTOR(mScriptFramePool, struct mScriptFrame*);
+DECLARE_VECTOR(mScriptCallbackEventList, struct mScriptCallbackEventInfo*);
 
 struct mScriptContext {
 	struct Table rootScope;
@@ -33,10 +53,14 @@ struct mScriptContext {
 	uint32_t nextWeakref;
 	struct Table callbacks;
 	struct Table callbackId;
+	// Indexed by event ID minus one
+	struct mScriptCallbackEventList callbackEvents;
 	uint32_t nextCallbackId;
 	struct mScriptValue* constants;
 	struct Table docstrings;
 	int threadDepth;
+	// Frames kept around for reuse by callbacks and engine thunks
+	struct mScriptFramePool framePool;
 };
 
 struct mScriptEngine2 {
@@ -75,6 +99,9 @@ struct mScriptKVPair {
 void mScriptContextInit(struct mScriptContext*);
 void mScriptContextDeinit(struct mScriptContext*);
 
+struct mScriptFrame* mScriptContextAcquireFrame(struct mScriptContext*);
+void mScriptContextReleaseFrame(struct mScriptContext*, struct mScriptFrame*);
+
 void mScriptContextFillPool(struct mScriptContext*, struct mScriptValue*);
 void mScriptContextDrainPool(struct mScriptContext*);
 
@@ -95,6 +122,8 @@ void mScriptContextDisownWeakref(struct mScriptContext*, uint32_t weakref);
 void mScriptContextExportConstants(struct mScriptContext* context, const char* nspace, struct mScriptKVPair* constants);
 void mScriptContextExportNamespace(struct mScriptContext* context, const char* nspace, struct mScriptKVPair* value);
 
+uint32_t mScriptContextGetCallbackEvent(struct mScriptContext*, const char* callback);
+void mScriptContextTriggerCallbackEvent(struct mScriptContext*, uint32_t event, struct mScriptList* args);
 void mScriptContextTriggerCallback(struct mScriptContext*, const char* callback, struct mScriptList* args);
 uint32_t mScriptContextAddCallback(struct mScriptContext*, const char* callback, struct mScriptValue* value);
 uint32_t mScriptContextAddOneshot(struct mScriptContext*, const char* callback, struct mScriptValue* value);
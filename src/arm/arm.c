@@ -5,10 +5,16 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/arm/arm.h>
 
+#include <mgba/core/perf.h>
 #include <mgba/internal/arm/isa-arm.h>
 #include <mgba/internal/arm/isa-inlines.h>
 #include <mgba/internal/arm/isa-thumb.h>
 
+#ifdef ENABLE_ARM_OPCODE_STATS
+uint64_t ARMOpcodeStats[0x1000];
+uint64_t ThumbOpcodeStats[0x400];
+#endif
+
 void ARMSetPrivilegeMode(struct ARMCore* cpu, enum PrivilegeMode mode) {
 	if (mode == cpu->privilegeMode) {
 		// Not switching modes after all
@@ -45,6 +51,7 @@ void ARMSetPrivilegeMode(struct ARMCore* cpu, enum PrivilegeMode mode) {
 }
 
 void ARMInit(struct ARMCore* cpu) {
+	cpu->shadowStack = NULL;
 	cpu->master->init(cpu, cpu->master);
 	size_t i;
 	for (i = 0; i < cpu->numComponents; ++i) {
@@ -64,6 +71,7 @@ void ARMDeinit(struct ARMCore* cpu) {
 			cpu->components[i]->deinit(cpu->components[i]);
 		}
 	}
+	ARMShadowStackDisable(cpu);
 }
 
 void ARMSetComponents(struct ARMCore* cpu, struct mCPUComponent* master, int extra, struct mCPUComponent** extras) {
@@ -117,6 +125,11 @@ void ARMReset(struct ARMCore* cpu) {
 	cpu->nextEvent = 0;
 	cpu->halted = 0;
 
+	if (cpu->shadowStack) {
+		cpu->shadowStack->depth = 0;
+		cpu->shadowStack->dropped = 0;
+	}
+
 	cpu->irqh.reset(cpu);
 }
 
@@ -137,6 +150,10 @@ void ARMRaiseIRQ(struct ARMCore* cpu) {
 	cpu->gprs[ARM_PC] = BASE_IRQ;
 	_ARMSetMode(cpu, MODE_ARM);
 	cpu->cycles += ARMWritePC(cpu);
+	if (UNLIKELY(cpu->shadowStack)) {
+		uint32_t resume = cpu->gprs[ARM_LR] - WORD_SIZE_ARM;
+		ARMShadowStackPush(cpu, resume, resume, true);
+	}
 	cpu->spsr = cpsr;
 	cpu->cpsr.i = 1;
 	cpu->halted = 0;
@@ -156,6 +173,9 @@ void ARMRaiseSWI(struct ARMCore* cpu) {
 	cpu->gprs[ARM_PC] = BASE_SWI;
 	_ARMSetMode(cpu, MODE_ARM);
 	cpu->cycles += ARMWritePC(cpu);
+	if (UNLIKELY(cpu->shadowStack)) {
+		ARMShadowStackPush(cpu, cpu->gprs[ARM_LR] - instructionWidth, cpu->gprs[ARM_LR], true);
+	}
 	cpu->spsr = cpsr;
 	cpu->cpsr.i = 1;
 }
@@ -174,10 +194,53 @@ void ARMRaiseUndefined(struct ARMCore* cpu) {
 	cpu->gprs[ARM_PC] = BASE_UNDEF;
 	_ARMSetMode(cpu, MODE_ARM);
 	cpu->cycles += ARMWritePC(cpu);
+	if (UNLIKELY(cpu->shadowStack)) {
+		ARMShadowStackPush(cpu, cpu->gprs[ARM_LR] - instructionWidth, cpu->gprs[ARM_LR], true);
+	}
 	cpu->spsr = cpsr;
 	cpu->cpsr.i = 1;
 }
 
+void ARMShadowStackEnable(struct ARMCore* cpu) {
+	if (cpu->shadowStack) {
+		return;
+	}
+	cpu->shadowStack = calloc(1, sizeof(*cpu->shadowStack));
+}
+
+void ARMShadowStackDisable(struct ARMCore* cpu) {
+	free(cpu->shadowStack);
+	cpu->shadowStack = NULL;
+}
+
+void ARMShadowStackPush(struct ARMCore* cpu, uint32_t callAddress, uint32_t returnAddress, bool exception) {
+	struct ARMShadowStack* stack = cpu->shadowStack;
+	if (stack->depth == ARM_SHADOW_STACK_DEPTH) {
+		memmove(&stack->frames[0], &stack->frames[1], sizeof(stack->frames) - sizeof(stack->frames[0]));
+		--stack->depth;
+		++stack->dropped;
+	}
+	struct ARMShadowFrame* frame = &stack->frames[stack->depth];
+	++stack->depth;
+	frame->callAddress = callAddress;
+	frame->entryAddress = cpu->gprs[ARM_PC] - (cpu->executionMode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM);
+	frame->returnAddress = returnAddress & ~1;
+	frame->exception = exception;
+}
+
+void ARMShadowStackReturn(struct ARMCore* cpu) {
+	struct ARMShadowStack* stack = cpu->shadowStack;
+	uint32_t target = cpu->gprs[ARM_PC] - (cpu->executionMode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM);
+	size_t i;
+	// Jumps that don't return to a recorded caller, like jump tables, leave the stack alone
+	for (i = stack->depth; i > 0; --i) {
+		if (stack->frames[i - 1].returnAddress == target) {
+			stack->depth = i - 1;
+			return;
+		}
+	}
+}
+
 static const uint16_t conditionLut[16] = {
 	0xF0F0, // EQ [-Z--]
 	0x0F0F, // NE [-z--]
@@ -212,7 +275,11 @@ static inline void ARMStep(struct ARMCore* cpu) {
 			return;
 		}
 	}
-	ARMInstruction instruction = _armTable[((opcode >> 16) & 0xFF0) | ((opcode >> 4) & 0x00F)];
+	unsigned index = ((opcode >> 16) & 0xFF0) | ((opcode >> 4) & 0x00F);
+#ifdef ENABLE_ARM_OPCODE_STATS
+	++ARMOpcodeStats[index];
+#endif
+	ARMInstruction instruction = _armTable[index];
 	instruction(cpu, opcode);
 }
 
@@ -221,10 +288,24 @@ static inline void ThumbStep(struct ARMCore* cpu) {
 	cpu->prefetch[0] = cpu->prefetch[1];
 	cpu->gprs[ARM_PC] += WORD_SIZE_THUMB;
 	LOAD_16(cpu->prefetch[1], cpu->gprs[ARM_PC] & cpu->memory.activeMask, cpu->memory.activeRegion);
+#ifdef ENABLE_ARM_OPCODE_STATS
+	++ThumbOpcodeStats[opcode >> 6];
+#endif
 	ThumbInstruction instruction = _thumbTable[opcode >> 6];
 	instruction(cpu, opcode);
 }
 
+static inline void ThumbStepFused(struct ARMCore* cpu) {
+#ifndef ENABLE_ARM_OPCODE_STATS
+	uint32_t opcode = cpu->prefetch[0];
+	ThumbFusedInstruction fused = _thumbFusedTable[opcode >> 11];
+	if (fused && fused(cpu, opcode, cpu->prefetch[1])) {
+		return;
+	}
+#endif
+	ThumbStep(cpu);
+}
+
 void ARMRun(struct ARMCore* cpu) {
 	while (cpu->cycles >= cpu->nextEvent) {
 		cpu->irqh.processEvents(cpu);
@@ -240,9 +321,11 @@ void ARMRun(struct ARMCore* cpu) {
 }
 
 void ARMRunLoop(struct ARMCore* cpu) {
+	mPERF_ENTER(CPU);
 	if (cpu->executionMode == MODE_THUMB) {
+		// Single steps never fuse instructions, so debuggers still see every one
 		while (cpu->cycles < cpu->nextEvent) {
-			ThumbStep(cpu);
+			ThumbStepFused(cpu);
 		}
 	} else {
 		while (cpu->cycles < cpu->nextEvent) {
@@ -250,6 +333,7 @@ void ARMRunLoop(struct ARMCore* cpu) {
 		}
 	}
 	cpu->irqh.processEvents(cpu);
+	mPERF_LEAVE();
 }
 
 void ARMRunFake(struct ARMCore* cpu, uint32_t opcode) {
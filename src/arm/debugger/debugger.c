@@ -187,10 +187,29 @@ static struct ARMDebugBreakpoint* _lookupBreakpoint(struct ARMDebugBreakpointLis
 	return 0;
 }
 
+static inline bool _checkBreakpointFilter(const struct ARMDebugger* debugger, uint32_t address) {
+	uint32_t bit = (address >> 1) & 0xFFFF;
+	return debugger->breakpointFilter[bit >> 5] & (1U << (bit & 0x1F));
+}
+
+static void _markBreakpointFilter(struct ARMDebugger* debugger, uint32_t address) {
+	uint32_t bit = (address >> 1) & 0xFFFF;
+	debugger->breakpointFilter[bit >> 5] |= 1U << (bit & 0x1F);
+}
+
+static void _updateBreakpointFilter(struct ARMDebugger* debugger) {
+	memset(debugger->breakpointFilter, 0, sizeof(debugger->breakpointFilter));
+	size_t i;
+	for (i = 0; i < ARMDebugBreakpointListSize(&debugger->breakpoints); ++i) {
+		_markBreakpointFilter(debugger, ARMDebugBreakpointListGetPointer(&debugger->breakpoints, i)->d.address);
+	}
+}
+
 static void _destroyBreakpoint(struct mDebugger* debugger, struct ARMDebugBreakpoint* breakpoint) {
 	if (breakpoint->d.condition) {
 		parseFree(breakpoint->d.condition);
 	}
+	parseProgramFree(breakpoint->d.compiledCondition);
 	TableRemove(&debugger->pointOwner, breakpoint->d.id);
 }
 
@@ -198,6 +217,7 @@ static void _destroyWatchpoint(struct mDebugger* debugger, struct mWatchpoint* w
 	if (watchpoint->condition) {
 		parseFree(watchpoint->condition);
 	}
+	parseProgramFree(watchpoint->compiledCondition);
 	TableRemove(&debugger->pointOwner, watchpoint->id);
 }
 
@@ -208,6 +228,9 @@ static void ARMDebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 	if (debugger->stackTraceMode != STACK_TRACE_DISABLED && ARMDebuggerUpdateStackTraceInternal(d, pc)) {
 		return;
 	}
+	if (!_checkBreakpointFilter(debugger, pc)) {
+		return;
+	}
 	struct ARMDebugBreakpoint* breakpoint = _lookupBreakpoint(&debugger->breakpoints, pc);
 	if (!breakpoint) {
 		return;
@@ -215,7 +238,13 @@ static void ARMDebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 	if (breakpoint->d.condition) {
 		int32_t value;
 		int segment;
-		if (!mDebuggerEvaluateParseTree(d->p, breakpoint->d.condition, &value, &segment) || !(value || segment >= 0)) {
+		bool ok;
+		if (breakpoint->d.compiledCondition) {
+			ok = mDebuggerEvaluateParseProgram(d->p, breakpoint->d.compiledCondition, &value, &segment);
+		} else {
+			ok = mDebuggerEvaluateParseTree(d->p, breakpoint->d.condition, &value, &segment);
+		}
+		if (!ok || !(value || segment >= 0)) {
 			return;
 		}
 	}
@@ -247,6 +276,8 @@ static enum mStackTraceMode ARMDebuggerGetStackTraceMode(struct mDebuggerPlatfor
 static void ARMDebuggerSetStackTraceMode(struct mDebuggerPlatform*, enum mStackTraceMode);
 static bool ARMDebuggerUpdateStackTrace(struct mDebuggerPlatform* d);
 static void ARMDebuggerNextInstructionInfo(struct mDebuggerPlatform* d, struct mDebuggerInstructionInfo*);
+static void ARMDebuggerTraceState(struct mDebuggerPlatform* d, struct mDebuggerTraceState*);
+static bool ARMDebuggerSetAccessHook(struct mDebuggerPlatform* d, struct mDebuggerAccessHook*);
 
 struct mDebuggerPlatform* ARMDebuggerPlatformCreate(void) {
 	struct mDebuggerPlatform* platform = (struct mDebuggerPlatform*) malloc(sizeof(struct ARMDebugger));
@@ -265,6 +296,8 @@ struct mDebuggerPlatform* ARMDebuggerPlatformCreate(void) {
 	platform->setStackTraceMode = ARMDebuggerSetStackTraceMode;
 	platform->updateStackTrace = ARMDebuggerUpdateStackTrace;
 	platform->nextInstructionInfo = ARMDebuggerNextInstructionInfo;
+	platform->traceState = ARMDebuggerTraceState;
+	platform->setAccessHook = ARMDebuggerSetAccessHook;
 	return platform;
 }
 
@@ -276,6 +309,9 @@ void ARMDebuggerInit(void* cpu, struct mDebuggerPlatform* platform) {
 	debugger->stackTraceMode = STACK_TRACE_DISABLED;
 	ARMDebugBreakpointListInit(&debugger->breakpoints, 0);
 	ARMDebugBreakpointListInit(&debugger->swBreakpoints, 0);
+	memset(debugger->breakpointFilter, 0, sizeof(debugger->breakpointFilter));
+	memset(debugger->watchpointFilter, 0, sizeof(debugger->watchpointFilter));
+	debugger->accessHook = NULL;
 	mWatchpointListInit(&debugger->watchpoints, 0);
 	struct mStackTrace* stack = &platform->p->stackTrace;
 	mStackTraceInit(stack, sizeof(struct ARMRegisterFile));
@@ -344,6 +380,7 @@ ssize_t ARMDebuggerSetSoftwareBreakpoint(struct mDebuggerPlatform* d, struct mDe
 	breakpoint->d.address = address & ~1; // Clear Thumb bit since it's not part of a valid address
 	breakpoint->d.segment = -1;
 	breakpoint->d.condition = NULL;
+	breakpoint->d.compiledCondition = NULL;
 	breakpoint->d.type = BREAKPOINT_SOFTWARE;
 	breakpoint->sw.opcode = opcode;
 	breakpoint->sw.mode = mode;
@@ -360,7 +397,9 @@ static ssize_t ARMDebuggerSetBreakpoint(struct mDebuggerPlatform* d, struct mDeb
 	breakpoint->d = *info;
 	breakpoint->d.address &= ~1; // Clear Thumb bit since it's not part of a valid address
 	breakpoint->d.id = id;
+	breakpoint->d.compiledCondition = info->condition ? mDebuggerCompileParseTree(d->p, info->condition) : NULL;
 	TableInsert(&debugger->d.p->pointOwner, id, owner);
+	_markBreakpointFilter(debugger, breakpoint->d.address);
 	if (info->type == BREAKPOINT_SOFTWARE) {
 		// TODO
 		abort();
@@ -377,6 +416,7 @@ static bool ARMDebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t id)
 		if (ARMDebugBreakpointListGetPointer(breakpoints, i)->d.id == id) {
 			_destroyBreakpoint(debugger->d.p, ARMDebugBreakpointListGetPointer(breakpoints, i));
 			ARMDebugBreakpointListShift(breakpoints, i, 1);
+			_updateBreakpointFilter(debugger);
 			return true;
 		}
 	}
@@ -397,7 +437,8 @@ static bool ARMDebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t id)
 		if (mWatchpointListGetPointer(watchpoints, i)->id == id) {
 			_destroyWatchpoint(debugger->d.p, mWatchpointListGetPointer(watchpoints, i));
 			mWatchpointListShift(watchpoints, i, 1);
-			if (!mWatchpointListSize(&debugger->watchpoints)) {
+			ARMDebuggerUpdateWatchpointFilter(debugger);
+			if (!mWatchpointListSize(&debugger->watchpoints) && !debugger->accessHook) {
 				ARMDebuggerRemoveMemoryShim(debugger);
 			}
 			return true;
@@ -450,12 +491,14 @@ static void ARMDebuggerListBreakpoints(struct mDebuggerPlatform* d, struct mDebu
 
 static bool ARMDebuggerHasBreakpoints(struct mDebuggerPlatform* d) {
 	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
-	return ARMDebugBreakpointListSize(&debugger->breakpoints) || mWatchpointListSize(&debugger->watchpoints) || debugger->stackTraceMode != STACK_TRACE_DISABLED;
+	// Watchpoints are caught by the memory shim, which forces the run loop to exit on a hit,
+	// so they don't need the CPU to be single-stepped
+	return ARMDebugBreakpointListSize(&debugger->breakpoints) || debugger->stackTraceMode != STACK_TRACE_DISABLED;
 }
 
 static ssize_t ARMDebuggerSetWatchpoint(struct mDebuggerPlatform* d, struct mDebuggerModule* owner, const struct mWatchpoint* info) {
 	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
-	if (!mWatchpointListSize(&debugger->watchpoints)) {
+	if (!mWatchpointListSize(&debugger->watchpoints) && !debugger->accessHook) {
 		ARMDebuggerInstallMemoryShim(debugger);
 	}
 	struct mWatchpoint* watchpoint = mWatchpointListAppend(&debugger->watchpoints);
@@ -463,6 +506,8 @@ static ssize_t ARMDebuggerSetWatchpoint(struct mDebuggerPlatform* d, struct mDeb
 	++debugger->nextId;
 	*watchpoint = *info;
 	watchpoint->id = id;
+	watchpoint->compiledCondition = info->condition ? mDebuggerCompileParseTree(d->p, info->condition) : NULL;
+	ARMDebuggerUpdateWatchpointFilter(debugger);
 	TableInsert(&debugger->d.p->pointOwner, id, owner);
 	return id;
 }
@@ -516,6 +561,31 @@ static void ARMDebuggerTrace(struct mDebuggerPlatform* d, char* out, size_t* len
 	*length = regStringLen;
 }
 
+static void ARMDebuggerTraceState(struct mDebuggerPlatform* d, struct mDebuggerTraceState* state) {
+	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
+	struct ARMCore* cpu = debugger->cpu;
+	state->address = cpu->gprs[ARM_PC] - _ARMInstructionLength(cpu);
+	state->opcode = cpu->prefetch[0];
+	if (cpu->executionMode == MODE_THUMB) {
+		state->opcode &= 0xFFFF;
+	}
+	memcpy(state->registers, cpu->gprs, sizeof(cpu->gprs));
+	state->registers[16] = cpu->cpsr.packed;
+	state->nRegisters = 17;
+}
+
+static bool ARMDebuggerSetAccessHook(struct mDebuggerPlatform* d, struct mDebuggerAccessHook* hook) {
+	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
+	bool hadShim = debugger->accessHook || mWatchpointListSize(&debugger->watchpoints);
+	debugger->accessHook = hook;
+	if (hook && !hadShim) {
+		ARMDebuggerInstallMemoryShim(debugger);
+	} else if (!hook && hadShim && !mWatchpointListSize(&debugger->watchpoints)) {
+		ARMDebuggerRemoveMemoryShim(debugger);
+	}
+	return true;
+}
+
 static void ARMDebuggerFormatRegisters(struct ARMRegisterFile* regs, char* out, size_t* length) {
 	*length = snprintf(out, *length, "%08X %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X %08X cpsr: %08X",
 		               regs->gprs[0],  regs->gprs[1],  regs->gprs[2],  regs->gprs[3],
@@ -12,12 +12,45 @@
 
 #include <string.h>
 
-static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, enum mWatchpointType type, uint32_t newValue, int width);
+#define WATCHPOINT_PAGE_SHIFT 12
+#define WATCHPOINT_PAGE_MASK (0x0FFFFFFF >> WATCHPOINT_PAGE_SHIFT)
+
+static void _scanWatchpoints(struct ARMDebugger* debugger, uint32_t address, enum mWatchpointType type, uint32_t newValue, int width);
+
+static inline void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, enum mWatchpointType type, uint32_t newValue, int width) {
+	uint32_t page = (address >> WATCHPOINT_PAGE_SHIFT) & WATCHPOINT_PAGE_MASK;
+	if (!(debugger->watchpointFilter[page >> 5] & (1U << (page & 0x1F)))) {
+		return;
+	}
+	_scanWatchpoints(debugger, address, type, newValue, width);
+}
+
+static inline void _logAccess(struct ARMDebugger* debugger, uint32_t address, mDebuggerAccessLogFlags flags, int width) {
+	if (!debugger->accessHook) {
+		return;
+	}
+	switch (width) {
+	case 1:
+		flags = mDebuggerAccessLogFlagsFillAccess8(flags);
+		break;
+	case 2:
+		flags = mDebuggerAccessLogFlagsFillAccess16(flags);
+		break;
+	case 4:
+		flags = mDebuggerAccessLogFlagsFillAccess32(flags);
+		break;
+	}
+	debugger->accessHook->access(debugger->accessHook, address, width, flags);
+}
 
 #define FIND_DEBUGGER(DEBUGGER, CPU) \
 	do { \
 		DEBUGGER = 0; \
 		size_t i; \
+		if (CPU_COMPONENT_DEBUGGER < CPU->numComponents && CPU->components[CPU_COMPONENT_DEBUGGER] && CPU->components[CPU_COMPONENT_DEBUGGER]->id == DEBUGGER_ID) { \
+			DEBUGGER = (struct ARMDebugger*) ((struct mDebugger*) cpu->components[CPU_COMPONENT_DEBUGGER])->platform; \
+			break; \
+		} \
 		for (i = 0; i < CPU->numComponents; ++i) { \
 			if (CPU->components[i]->id == DEBUGGER_ID) { \
 				DEBUGGER = (struct ARMDebugger*) ((struct mDebugger*) cpu->components[i])->platform; \
@@ -39,6 +72,7 @@ static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, en
 	static RETURN DebuggerShim_ ## NAME TYPES { \
 		struct ARMDebugger* debugger; \
 		FIND_DEBUGGER(debugger, cpu); \
+		_logAccess(debugger, address, mDebuggerAccessLogFlagsFillRead(0), WIDTH); \
 		_checkWatchpoints(debugger, address, WATCHPOINT_READ, 0, WIDTH); \
 		return debugger->originalMemory.NAME(cpu, __VA_ARGS__); \
 	}
@@ -47,11 +81,12 @@ static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, en
 	static RETURN DebuggerShim_ ## NAME TYPES { \
 		struct ARMDebugger* debugger; \
 		FIND_DEBUGGER(debugger, cpu); \
+		_logAccess(debugger, address, mDebuggerAccessLogFlagsFillWrite(0), WIDTH); \
 		_checkWatchpoints(debugger, address, WATCHPOINT_WRITE, value, WIDTH); \
 		return debugger->originalMemory.NAME(cpu, __VA_ARGS__); \
 	}
 
-#define CREATE_MULTIPLE_WATCHPOINT_SHIM(NAME, ACCESS_TYPE) \
+#define CREATE_MULTIPLE_WATCHPOINT_SHIM(NAME, ACCESS_TYPE, LOG_FLAGS) \
 	static uint32_t DebuggerShim_ ## NAME (struct ARMCore* cpu, uint32_t address, int mask, enum LSMDirection direction, int* cycleCounter) { \
 		struct ARMDebugger* debugger; \
 		FIND_DEBUGGER(debugger, cpu); \
@@ -67,6 +102,7 @@ static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, en
 		} \
 		unsigned i; \
 		for (i = 0; i < popcount; ++i) { \
+			_logAccess(debugger, base + 4 * i, LOG_FLAGS, 4); \
 			_checkWatchpoints(debugger, base + 4 * i, ACCESS_TYPE, 0, 4); \
 		} \
 		return debugger->originalMemory.NAME(cpu, address, mask, direction, cycleCounter); \
@@ -78,11 +114,11 @@ CREATE_WATCHPOINT_READ_SHIM(load8, 1, uint32_t, (struct ARMCore* cpu, uint32_t a
 CREATE_WATCHPOINT_WRITE_SHIM(store32, 4, void, (struct ARMCore* cpu, uint32_t address, int32_t value, int* cycleCounter), address, value, cycleCounter)
 CREATE_WATCHPOINT_WRITE_SHIM(store16, 2, void, (struct ARMCore* cpu, uint32_t address, int16_t value, int* cycleCounter), address, value, cycleCounter)
 CREATE_WATCHPOINT_WRITE_SHIM(store8, 1, void, (struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCounter), address, value, cycleCounter)
-CREATE_MULTIPLE_WATCHPOINT_SHIM(loadMultiple, WATCHPOINT_READ)
-CREATE_MULTIPLE_WATCHPOINT_SHIM(storeMultiple, WATCHPOINT_WRITE)
+CREATE_MULTIPLE_WATCHPOINT_SHIM(loadMultiple, WATCHPOINT_READ, mDebuggerAccessLogFlagsFillRead(0))
+CREATE_MULTIPLE_WATCHPOINT_SHIM(storeMultiple, WATCHPOINT_WRITE, mDebuggerAccessLogFlagsFillWrite(0))
 CREATE_SHIM(setActiveRegion, void, (struct ARMCore* cpu, uint32_t address), address)
 
-static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, enum mWatchpointType type, uint32_t newValue, int width) {
+static void _scanWatchpoints(struct ARMDebugger* debugger, uint32_t address, enum mWatchpointType type, uint32_t newValue, int width) {
 	struct mWatchpoint* watchpoint;
 	size_t i;
 	uint32_t minAddress = address & ~(width - 1);
@@ -93,7 +129,13 @@ static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, en
 			if (watchpoint->condition) {
 				int32_t value;
 				int segment;
-				if (!mDebuggerEvaluateParseTree(debugger->d.p, watchpoint->condition, &value, &segment) || !(value || segment >= 0)) {
+				bool ok;
+				if (watchpoint->compiledCondition) {
+					ok = mDebuggerEvaluateParseProgram(debugger->d.p, watchpoint->compiledCondition, &value, &segment);
+				} else {
+					ok = mDebuggerEvaluateParseTree(debugger->d.p, watchpoint->condition, &value, &segment);
+				}
+				if (!ok || !(value || segment >= 0)) {
 					continue;
 				}
 			}
@@ -131,6 +173,24 @@ static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, en
 	}
 }
 
+void ARMDebuggerUpdateWatchpointFilter(struct ARMDebugger* debugger) {
+	memset(debugger->watchpointFilter, 0, sizeof(debugger->watchpointFilter));
+	size_t i;
+	for (i = 0; i < mWatchpointListSize(&debugger->watchpoints); ++i) {
+		const struct mWatchpoint* watchpoint = mWatchpointListGetPointer(&debugger->watchpoints, i);
+		if (watchpoint->maxAddress <= watchpoint->minAddress || watchpoint->maxAddress - watchpoint->minAddress >= 0x10000000) {
+			memset(debugger->watchpointFilter, 0xFF, sizeof(debugger->watchpointFilter));
+			return;
+		}
+		uint32_t page = watchpoint->minAddress >> WATCHPOINT_PAGE_SHIFT;
+		uint32_t lastPage = (watchpoint->maxAddress - 1) >> WATCHPOINT_PAGE_SHIFT;
+		for (; page != lastPage + 1; ++page) {
+			uint32_t bit = page & WATCHPOINT_PAGE_MASK;
+			debugger->watchpointFilter[bit >> 5] |= 1U << (bit & 0x1F);
+		}
+	}
+}
+
 void ARMDebuggerInstallMemoryShim(struct ARMDebugger* debugger) {
 	debugger->originalMemory = debugger->cpu->memory;
 	debugger->cpu->memory.store32 = DebuggerShim_store32;
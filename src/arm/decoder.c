@@ -146,13 +146,23 @@ static int _decodePSR(int psrBits, char* buffer, int blen) {
 static int _decodePCRelative(uint32_t address, const struct mDebuggerSymbols* symbols, uint32_t pc, bool thumbBranch, char* buffer, int blen) {
 	address += pc;
 	const char* label = NULL;
+	uint32_t offset = 0;
 	if (symbols) {
 		label = mDebuggerSymbolReverseLookup(symbols, address, -1);
 		if (!label && thumbBranch) {
 			label = mDebuggerSymbolReverseLookup(symbols, address | 1, -1);
 		}
+		if (!label) {
+			label = mDebuggerSymbolReverseLookupNearest(symbols, address, -1, &offset);
+			if (label && (address - offset) & 1 && !(address & 1)) {
+				// Thumb function symbols have the low bit set
+				++offset;
+			}
+		}
 	}
-	if (label) {
+	if (label && offset) {
+		return snprintf(buffer, blen, "%s+0x%X", label, offset);
+	} else if (label) {
 		return strlcpy(buffer, label, blen);
 	} else {
 		return snprintf(buffer, blen, "0x%08X", address);
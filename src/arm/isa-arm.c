@@ -14,142 +14,148 @@
 #define PSR_STATE_MASK  0x00000020
 
 // Addressing mode 1
+// Register-specified shifts have bit 4 set, which is part of the table index,
+// so each shifter comes in an immediate and a register (R) variant
 static inline void _shiftLSL(struct ARMCore* cpu, uint32_t opcode) {
 	int rm = opcode & 0x0000000F;
-	if (opcode & 0x00000010) {
-		int rs = (opcode >> 8) & 0x0000000F;
-		++cpu->cycles;
-		int32_t shiftVal = cpu->gprs[rm];
-		if (rm == ARM_PC) {
-			shiftVal += 4;
-		}
-		int shift = cpu->gprs[rs] & 0xFF;
-		if (!shift) {
-			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = cpu->cpsr.c;
-		} else if (shift < 32) {
-			cpu->shifterOperand = shiftVal << shift;
-			cpu->shifterCarryOut = (shiftVal >> (32 - shift)) & 1;
-		} else if (shift == 32) {
-			cpu->shifterOperand = 0;
-			cpu->shifterCarryOut = shiftVal & 1;
-		} else {
-			cpu->shifterOperand = 0;
-			cpu->shifterCarryOut = 0;
-		}
+	int immediate = (opcode & 0x00000F80) >> 7;
+	if (!immediate) {
+		cpu->shifterOperand = cpu->gprs[rm];
+		cpu->shifterCarryOut = cpu->cpsr.c;
 	} else {
-		int immediate = (opcode & 0x00000F80) >> 7;
-		if (!immediate) {
-			cpu->shifterOperand = cpu->gprs[rm];
-			cpu->shifterCarryOut = cpu->cpsr.c;
-		} else {
-			cpu->shifterOperand = cpu->gprs[rm] << immediate;
-			cpu->shifterCarryOut = (cpu->gprs[rm] >> (32 - immediate)) & 1;
-		}
+		cpu->shifterOperand = cpu->gprs[rm] << immediate;
+		cpu->shifterCarryOut = (cpu->gprs[rm] >> (32 - immediate)) & 1;
+	}
+}
+
+static inline void _shiftLSLR(struct ARMCore* cpu, uint32_t opcode) {
+	int rm = opcode & 0x0000000F;
+	int rs = (opcode >> 8) & 0x0000000F;
+	++cpu->cycles;
+	int32_t shiftVal = cpu->gprs[rm];
+	if (rm == ARM_PC) {
+		shiftVal += 4;
+	}
+	int shift = cpu->gprs[rs] & 0xFF;
+	if (!shift) {
+		cpu->shifterOperand = shiftVal;
+		cpu->shifterCarryOut = cpu->cpsr.c;
+	} else if (shift < 32) {
+		cpu->shifterOperand = shiftVal << shift;
+		cpu->shifterCarryOut = (shiftVal >> (32 - shift)) & 1;
+	} else if (shift == 32) {
+		cpu->shifterOperand = 0;
+		cpu->shifterCarryOut = shiftVal & 1;
+	} else {
+		cpu->shifterOperand = 0;
+		cpu->shifterCarryOut = 0;
 	}
 }
 
 static inline void _shiftLSR(struct ARMCore* cpu, uint32_t opcode) {
 	int rm = opcode & 0x0000000F;
-	if (opcode & 0x00000010) {
-		int rs = (opcode >> 8) & 0x0000000F;
-		++cpu->cycles;
-		uint32_t shiftVal = cpu->gprs[rm];
-		if (rm == ARM_PC) {
-			shiftVal += 4;
-		}
-		int shift = cpu->gprs[rs] & 0xFF;
-		if (!shift) {
-			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = cpu->cpsr.c;
-		} else if (shift < 32) {
-			cpu->shifterOperand = shiftVal >> shift;
-			cpu->shifterCarryOut = (shiftVal >> (shift - 1)) & 1;
-		} else if (shift == 32) {
-			cpu->shifterOperand = 0;
-			cpu->shifterCarryOut = shiftVal >> 31;
-		} else {
-			cpu->shifterOperand = 0;
-			cpu->shifterCarryOut = 0;
-		}
+	int immediate = (opcode & 0x00000F80) >> 7;
+	if (immediate) {
+		cpu->shifterOperand = ((uint32_t) cpu->gprs[rm]) >> immediate;
+		cpu->shifterCarryOut = (cpu->gprs[rm] >> (immediate - 1)) & 1;
 	} else {
-		int immediate = (opcode & 0x00000F80) >> 7;
-		if (immediate) {
-			cpu->shifterOperand = ((uint32_t) cpu->gprs[rm]) >> immediate;
-			cpu->shifterCarryOut = (cpu->gprs[rm] >> (immediate - 1)) & 1;
-		} else {
-			cpu->shifterOperand = 0;
-			cpu->shifterCarryOut = ARM_SIGN(cpu->gprs[rm]);
-		}
+		cpu->shifterOperand = 0;
+		cpu->shifterCarryOut = ARM_SIGN(cpu->gprs[rm]);
+	}
+}
+
+static inline void _shiftLSRR(struct ARMCore* cpu, uint32_t opcode) {
+	int rm = opcode & 0x0000000F;
+	int rs = (opcode >> 8) & 0x0000000F;
+	++cpu->cycles;
+	uint32_t shiftVal = cpu->gprs[rm];
+	if (rm == ARM_PC) {
+		shiftVal += 4;
+	}
+	int shift = cpu->gprs[rs] & 0xFF;
+	if (!shift) {
+		cpu->shifterOperand = shiftVal;
+		cpu->shifterCarryOut = cpu->cpsr.c;
+	} else if (shift < 32) {
+		cpu->shifterOperand = shiftVal >> shift;
+		cpu->shifterCarryOut = (shiftVal >> (shift - 1)) & 1;
+	} else if (shift == 32) {
+		cpu->shifterOperand = 0;
+		cpu->shifterCarryOut = shiftVal >> 31;
+	} else {
+		cpu->shifterOperand = 0;
+		cpu->shifterCarryOut = 0;
 	}
 }
 
 static inline void _shiftASR(struct ARMCore* cpu, uint32_t opcode) {
 	int rm = opcode & 0x0000000F;
-	if (opcode & 0x00000010) {
-		int rs = (opcode >> 8) & 0x0000000F;
-		++cpu->cycles;
-		int shiftVal =  cpu->gprs[rm];
-		if (rm == ARM_PC) {
-			shiftVal += 4;
-		}
-		int shift = cpu->gprs[rs] & 0xFF;
-		if (!shift) {
-			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = cpu->cpsr.c;
-		} else if (shift < 32) {
-			cpu->shifterOperand = shiftVal >> shift;
-			cpu->shifterCarryOut = (shiftVal >> (shift - 1)) & 1;
-		} else if (cpu->gprs[rm] >> 31) {
-			cpu->shifterOperand = 0xFFFFFFFF;
-			cpu->shifterCarryOut = 1;
-		} else {
-			cpu->shifterOperand = 0;
-			cpu->shifterCarryOut = 0;
-		}
+	int immediate = (opcode & 0x00000F80) >> 7;
+	if (immediate) {
+		cpu->shifterOperand = cpu->gprs[rm] >> immediate;
+		cpu->shifterCarryOut = (cpu->gprs[rm] >> (immediate - 1)) & 1;
 	} else {
-		int immediate = (opcode & 0x00000F80) >> 7;
-		if (immediate) {
-			cpu->shifterOperand = cpu->gprs[rm] >> immediate;
-			cpu->shifterCarryOut = (cpu->gprs[rm] >> (immediate - 1)) & 1;
-		} else {
-			cpu->shifterCarryOut = ARM_SIGN(cpu->gprs[rm]);
-			cpu->shifterOperand = cpu->shifterCarryOut;
-		}
+		cpu->shifterCarryOut = ARM_SIGN(cpu->gprs[rm]);
+		cpu->shifterOperand = cpu->shifterCarryOut;
+	}
+}
+
+static inline void _shiftASRR(struct ARMCore* cpu, uint32_t opcode) {
+	int rm = opcode & 0x0000000F;
+	int rs = (opcode >> 8) & 0x0000000F;
+	++cpu->cycles;
+	int shiftVal =  cpu->gprs[rm];
+	if (rm == ARM_PC) {
+		shiftVal += 4;
+	}
+	int shift = cpu->gprs[rs] & 0xFF;
+	if (!shift) {
+		cpu->shifterOperand = shiftVal;
+		cpu->shifterCarryOut = cpu->cpsr.c;
+	} else if (shift < 32) {
+		cpu->shifterOperand = shiftVal >> shift;
+		cpu->shifterCarryOut = (shiftVal >> (shift - 1)) & 1;
+	} else if (cpu->gprs[rm] >> 31) {
+		cpu->shifterOperand = 0xFFFFFFFF;
+		cpu->shifterCarryOut = 1;
+	} else {
+		cpu->shifterOperand = 0;
+		cpu->shifterCarryOut = 0;
 	}
 }
 
 static inline void _shiftROR(struct ARMCore* cpu, uint32_t opcode) {
 	int rm = opcode & 0x0000000F;
-	if (opcode & 0x00000010) {
-		int rs = (opcode >> 8) & 0x0000000F;
-		++cpu->cycles;
-		int shiftVal =  cpu->gprs[rm];
-		if (rm == ARM_PC) {
-			shiftVal += 4;
-		}
-		int shift = cpu->gprs[rs] & 0xFF;
-		int rotate = shift & 0x1F;
-		if (!shift) {
-			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = cpu->cpsr.c;
-		} else if (rotate) {
-			cpu->shifterOperand = ROR(shiftVal, rotate);
-			cpu->shifterCarryOut = (shiftVal >> (rotate - 1)) & 1;
-		} else {
-			cpu->shifterOperand = shiftVal;
-			cpu->shifterCarryOut = ARM_SIGN(shiftVal);
-		}
+	int immediate = (opcode & 0x00000F80) >> 7;
+	if (immediate) {
+		cpu->shifterOperand = ROR(cpu->gprs[rm], immediate);
+		cpu->shifterCarryOut = (cpu->gprs[rm] >> (immediate - 1)) & 1;
 	} else {
-		int immediate = (opcode & 0x00000F80) >> 7;
-		if (immediate) {
-			cpu->shifterOperand = ROR(cpu->gprs[rm], immediate);
-			cpu->shifterCarryOut = (cpu->gprs[rm] >> (immediate - 1)) & 1;
-		} else {
-			// RRX
-			cpu->shifterOperand = (cpu->cpsr.c << 31) | (((uint32_t) cpu->gprs[rm]) >> 1);
-			cpu->shifterCarryOut = cpu->gprs[rm] & 0x00000001;
-		}
+		// RRX
+		cpu->shifterOperand = (cpu->cpsr.c << 31) | (((uint32_t) cpu->gprs[rm]) >> 1);
+		cpu->shifterCarryOut = cpu->gprs[rm] & 0x00000001;
+	}
+}
+
+static inline void _shiftRORR(struct ARMCore* cpu, uint32_t opcode) {
+	int rm = opcode & 0x0000000F;
+	int rs = (opcode >> 8) & 0x0000000F;
+	++cpu->cycles;
+	int shiftVal =  cpu->gprs[rm];
+	if (rm == ARM_PC) {
+		shiftVal += 4;
+	}
+	int shift = cpu->gprs[rs] & 0xFF;
+	int rotate = shift & 0x1F;
+	if (!shift) {
+		cpu->shifterOperand = shiftVal;
+		cpu->shifterCarryOut = cpu->cpsr.c;
+	} else if (rotate) {
+		cpu->shifterOperand = ROR(shiftVal, rotate);
+		cpu->shifterCarryOut = (shiftVal >> (rotate - 1)) & 1;
+	} else {
+		cpu->shifterOperand = shiftVal;
+		cpu->shifterCarryOut = ARM_SIGN(shiftVal);
 	}
 }
 
@@ -270,6 +276,7 @@ ATTRIBUTE_NOINLINE static void _neutralS(struct ARMCore* cpu, int32_t d) {
 	currentCycles += cpu->memory.activeNonseqCycles32 - cpu->memory.activeSeqCycles32; \
 	if (rd == ARM_PC) { \
 		currentCycles += ARMWritePC(cpu); \
+		_ARMShadowReturn(cpu); \
 	}
 
 #define ARM_STORE_POST_BODY \
@@ -282,13 +289,13 @@ ATTRIBUTE_NOINLINE static void _neutralS(struct ARMCore* cpu, int32_t d) {
 		cpu->cycles += currentCycles; \
 	}
 
-#define DEFINE_ALU_INSTRUCTION_EX_ARM(NAME, S_BODY, SHIFTER, BODY) \
+#define DEFINE_ALU_INSTRUCTION_EX_ARM(NAME, S_BODY, SHIFTER, REGISTER_SHIFT, BODY) \
 	DEFINE_INSTRUCTION_ARM(NAME, \
 		SHIFTER(cpu, opcode); \
 		int rd = (opcode >> 12) & 0xF; \
 		int rn = (opcode >> 16) & 0xF; \
 		int32_t n ATTRIBUTE_UNUSED = cpu->gprs[rn]; \
-		if (UNLIKELY(rn == ARM_PC && (opcode & 0x02000010) == 0x00000010)) { \
+		if (REGISTER_SHIFT && UNLIKELY(rn == ARM_PC)) { \
 			n += WORD_SIZE_ARM; \
 		} \
 		BODY; \
@@ -299,26 +306,39 @@ ATTRIBUTE_NOINLINE static void _neutralS(struct ARMCore* cpu, int32_t d) {
 			} else { \
 				currentCycles += ThumbWritePC(cpu); \
 			} \
+			_ARMShadowReturn(cpu); \
 		})
 
 #define DEFINE_ALU_INSTRUCTION_ARM(NAME, S_BODY, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSL, , _shiftLSL, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSL, S_BODY, _shiftLSL, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSR, , _shiftLSR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSR, S_BODY, _shiftLSR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASR, , _shiftASR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_ASR, S_BODY, _shiftASR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ROR, , _shiftROR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_ROR, S_BODY, _shiftROR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## I, , _immediate, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## SI, S_BODY, _immediate, BODY)
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSL, , _shiftLSL, 0, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSL, S_BODY, _shiftLSL, 0, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSLR, , _shiftLSLR, 1, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSLR, S_BODY, _shiftLSLR, 1, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSR, , _shiftLSR, 0, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSR, S_BODY, _shiftLSR, 0, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSRR, , _shiftLSRR, 1, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_LSRR, S_BODY, _shiftLSRR, 1, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASR, , _shiftASR, 0, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_ASR, S_BODY, _shiftASR, 0, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASRR, , _shiftASRR, 1, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_ASRR, S_BODY, _shiftASRR, 1, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ROR, , _shiftROR, 0, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_ROR, S_BODY, _shiftROR, 0, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _RORR, , _shiftRORR, 1, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## S_RORR, S_BODY, _shiftRORR, 1, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## I, , _immediate, 0, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## SI, S_BODY, _immediate, 0, BODY)
 
 #define DEFINE_ALU_INSTRUCTION_S_ONLY_ARM(NAME, S_BODY, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSL, S_BODY, _shiftLSL, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSR, S_BODY, _shiftLSR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASR, S_BODY, _shiftASR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ROR, S_BODY, _shiftROR, BODY) \
-	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## I, S_BODY, _immediate, BODY)
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSL, S_BODY, _shiftLSL, 0, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSLR, S_BODY, _shiftLSLR, 1, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSR, S_BODY, _shiftLSR, 0, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _LSRR, S_BODY, _shiftLSRR, 1, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASR, S_BODY, _shiftASR, 0, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ASRR, S_BODY, _shiftASRR, 1, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _ROR, S_BODY, _shiftROR, 0, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## _RORR, S_BODY, _shiftRORR, 1, BODY) \
+	DEFINE_ALU_INSTRUCTION_EX_ARM(NAME ## I, S_BODY, _immediate, 0, BODY)
 
 #define DEFINE_MULTIPLY_INSTRUCTION_EX_ARM(NAME, BODY, S_BODY, SIGNED) \
 	DEFINE_INSTRUCTION_ARM(NAME, \
@@ -603,6 +623,7 @@ DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_ARM(LDM,
 		} else {
 			currentCycles += ARMWritePC(cpu);
 		}
+		_ARMShadowReturn(cpu);
 	})
 
 DEFINE_LOAD_STORE_MULTIPLE_INSTRUCTION_ARM(STM,
@@ -637,18 +658,27 @@ DEFINE_INSTRUCTION_ARM(B,
 
 DEFINE_INSTRUCTION_ARM(BL,
 	int32_t immediate = (opcode & 0x00FFFFFF) << 8;
-	cpu->gprs[ARM_LR] = cpu->gprs[ARM_PC] - WORD_SIZE_ARM;
+	uint32_t pc = cpu->gprs[ARM_PC];
+	cpu->gprs[ARM_LR] = pc - WORD_SIZE_ARM;
 	cpu->gprs[ARM_PC] += immediate >> 6;
-	currentCycles += ARMWritePC(cpu);)
+	currentCycles += ARMWritePC(cpu);
+	_ARMShadowCall(cpu, pc - WORD_SIZE_ARM * 2, pc - WORD_SIZE_ARM);)
 
 DEFINE_INSTRUCTION_ARM(BX,
 	int rm = opcode & 0x0000000F;
+	uint32_t pc = cpu->gprs[ARM_PC];
 	_ARMSetMode(cpu, cpu->gprs[rm] & 0x00000001);
 	cpu->gprs[ARM_PC] = cpu->gprs[rm] & 0xFFFFFFFE;
 	if (cpu->executionMode == MODE_THUMB) {
 		currentCycles += ThumbWritePC(cpu);
 	} else {
 		currentCycles += ARMWritePC(cpu);
+	}
+	// "mov lr, pc; bx rm" is how ARMv4T calls through a register
+	if (rm != ARM_LR && (cpu->gprs[ARM_LR] & 0xFFFFFFFE) == pc - WORD_SIZE_ARM) {
+		_ARMShadowCall(cpu, pc - WORD_SIZE_ARM * 2, pc - WORD_SIZE_ARM);
+	} else {
+		_ARMShadowReturn(cpu);
 	})
 
 // End branch definitions
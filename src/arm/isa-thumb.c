@@ -259,6 +259,7 @@ DEFINE_INSTRUCTION_WITH_HIGH_THUMB(MOV3,
 	cpu->gprs[rd] = cpu->gprs[rm];
 	if (rd == ARM_PC) {
 		currentCycles += ThumbWritePC(cpu);
+		_ARMShadowReturn(cpu);
 	})
 
 #define DEFINE_IMMEDIATE_WITH_REGISTER_THUMB(NAME, BODY) \
@@ -362,7 +363,8 @@ DEFINE_LOAD_STORE_MULTIPLE_THUMB(POPR,
 	rs |= 1 << ARM_PC,
 	THUMB_LOAD_POST_BODY;
 	cpu->gprs[ARM_SP] = address;
-	currentCycles += ThumbWritePC(cpu);)
+	currentCycles += ThumbWritePC(cpu);
+	_ARMShadowReturn(cpu);)
 
 DEFINE_LOAD_STORE_MULTIPLE_THUMB(PUSH,
 	ARM_SP,
@@ -398,16 +400,23 @@ DEFINE_INSTRUCTION_THUMB(BL2,
 	uint32_t pc = cpu->gprs[ARM_PC];
 	cpu->gprs[ARM_PC] = cpu->gprs[ARM_LR] + immediate;
 	cpu->gprs[ARM_LR] = pc - 1;
-	currentCycles += ThumbWritePC(cpu);)
+	currentCycles += ThumbWritePC(cpu);
+	_ARMShadowCall(cpu, pc - WORD_SIZE_THUMB * 3, pc - 1);)
 
 DEFINE_INSTRUCTION_THUMB(BX,
 	int rm = (opcode >> 3) & 0xF;
+	uint32_t pc = cpu->gprs[ARM_PC];
 	_ARMSetMode(cpu, cpu->gprs[rm] & 0x00000001);
 	cpu->gprs[ARM_PC] = cpu->gprs[rm] & 0xFFFFFFFE;
 	if (cpu->executionMode == MODE_THUMB) {
 		currentCycles += ThumbWritePC(cpu);
 	} else {
 		currentCycles += ARMWritePC(cpu);
+	}
+	if (rm != ARM_LR && (cpu->gprs[ARM_LR] & 0xFFFFFFFE) == pc - WORD_SIZE_THUMB) {
+		_ARMShadowCall(cpu, pc - WORD_SIZE_THUMB * 2, pc - WORD_SIZE_THUMB);
+	} else {
+		_ARMShadowReturn(cpu);
 	})
 
 DEFINE_INSTRUCTION_THUMB(SWI, cpu->irqh.swi16(cpu, opcode & 0xFF))
@@ -415,3 +424,72 @@ DEFINE_INSTRUCTION_THUMB(SWI, cpu->irqh.swi16(cpu, opcode & 0xFF))
 const ThumbInstruction _thumbTable[0x400] = {
 	DECLARE_THUMB_EMITTER_BLOCK(_ThumbInstruction)
 };
+
+// Fused pairs
+// Compilers emit these back to back, and the second instruction of each pair usually branches.
+// Running the pair from one handler skips a trip through the run loop, as well as the fetches
+// that a taken branch would throw away. Cycle counts and event timing stay the same: if an
+// event is due after the first instruction, the pair is split there.
+
+static inline void _ThumbFusedStart(struct ARMCore* cpu, unsigned next) {
+	cpu->prefetch[0] = next;
+	cpu->gprs[ARM_PC] += WORD_SIZE_THUMB;
+}
+
+static inline bool _ThumbFusedSplit(struct ARMCore* cpu) {
+	// This fetch was deferred, which is safe since none of the first instructions write memory or the PC
+	LOAD_16(cpu->prefetch[1], cpu->gprs[ARM_PC] & cpu->memory.activeMask, cpu->memory.activeRegion);
+	return true;
+}
+
+static bool _ThumbFusedBL(struct ARMCore* cpu, unsigned opcode, unsigned next) {
+	if ((next & 0xF800) != 0xF800) {
+		return false;
+	}
+	_ThumbFusedStart(cpu, next);
+	_ThumbInstructionBL1(cpu, opcode);
+	if (cpu->cycles >= cpu->nextEvent) {
+		return _ThumbFusedSplit(cpu);
+	}
+	cpu->gprs[ARM_PC] += WORD_SIZE_THUMB;
+	_ThumbInstructionBL2(cpu, next);
+	return true;
+}
+
+static bool _ThumbFusedCMP(struct ARMCore* cpu, unsigned opcode, unsigned next) {
+	if ((opcode & 0xF800) != 0x2800 && (opcode & 0xFFC0) != 0x4280) {
+		return false;
+	}
+	if ((next & 0xF000) != 0xD000 || (next & 0x0F00) >= 0x0E00) {
+		return false;
+	}
+	_ThumbFusedStart(cpu, next);
+	_thumbTable[opcode >> 6](cpu, opcode);
+	if (cpu->cycles >= cpu->nextEvent || !ARMTestCondition(cpu, (next >> 8) & 0xF)) {
+		return _ThumbFusedSplit(cpu);
+	}
+	cpu->gprs[ARM_PC] += WORD_SIZE_THUMB;
+	_thumbTable[next >> 6](cpu, next);
+	return true;
+}
+
+static bool _ThumbFusedLDR3BX(struct ARMCore* cpu, unsigned opcode, unsigned next) {
+	if ((next & 0xFFF8) != (0x4700 | (opcode & 0x0700) >> 5)) {
+		return false;
+	}
+	_ThumbFusedStart(cpu, next);
+	_ThumbInstructionLDR3(cpu, opcode);
+	if (cpu->cycles >= cpu->nextEvent) {
+		return _ThumbFusedSplit(cpu);
+	}
+	cpu->gprs[ARM_PC] += WORD_SIZE_THUMB;
+	_ThumbInstructionBX(cpu, next);
+	return true;
+}
+
+const ThumbFusedInstruction _thumbFusedTable[0x20] = {
+	[0x05] = _ThumbFusedCMP,
+	[0x08] = _ThumbFusedCMP,
+	[0x09] = _ThumbFusedLDR3BX,
+	[0x1E] = _ThumbFusedBL,
+};
@@ -0,0 +1,230 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/audio-resampler.h>
+
+#include <mgba/core/interface.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RESAMPLER_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESAMPLER_NEON
+#endif
+
+#define CUTOFF_SCALE 1024
+#define MAX_TAPS 32
+
+static const struct {
+	unsigned taps;
+	unsigned phases;
+	// How much of the band below the output Nyquist frequency to keep. The rest is left for the
+	// filter to roll off in.
+	double passband;
+} _qualities[] = {
+	[mAUDIO_RESAMPLER_LOW - 1] = { 8, 32, 0.8 },
+	[mAUDIO_RESAMPLER_MEDIUM - 1] = { 16, 128, 0.9 },
+	[mAUDIO_RESAMPLER_HIGH - 1] = { 32, 256, 0.95 },
+};
+
+static void _buildKernel(struct mAudioResampler* resampler) {
+	double cutoff = resampler->cutoff / (double) CUTOFF_SCALE;
+	int half = resampler->taps / 2;
+	unsigned phase;
+	for (phase = 0; phase <= resampler->phases; ++phase) {
+		double taps[MAX_TAPS];
+		double sum = 0;
+		double fraction = phase / (double) resampler->phases;
+		int center = 0;
+		int i;
+		for (i = 0; i < (int) resampler->taps; ++i) {
+			// Blackman-windowed sinc, centered between taps half - 1 and half
+			double x = i - (half - 1) - fraction;
+			double t = x / half;
+			double window = 0;
+			if (fabs(t) < 1) {
+				window = 0.42 + 0.5 * cos(M_PI * t) + 0.08 * cos(2 * M_PI * t);
+			}
+			double sinc = 1;
+			if (x != 0) {
+				sinc = sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+			}
+			taps[i] = sinc * window;
+			sum += taps[i];
+			if (fabs(taps[i]) > fabs(taps[center])) {
+				center = i;
+			}
+		}
+
+		// Normalize each phase on its own so that there's no ripple at DC, and fold the rounding
+		// error into the largest tap so that the sum is exact
+		int16_t* row = &resampler->kernel[phase * resampler->taps];
+		int total = 0;
+		for (i = 0; i < (int) resampler->taps; ++i) {
+			row[i] = lround(taps[i] / sum * 0x8000);
+			total += row[i];
+		}
+		row[center] += 0x8000 - total;
+	}
+}
+
+static int32_t _dot(const int16_t* samples, const int16_t* kernel, unsigned taps) {
+	unsigned i;
+#if defined(RESAMPLER_SSE2)
+	__m128i sum = _mm_setzero_si128();
+	for (i = 0; i < taps; i += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i*) &samples[i]);
+		__m128i k = _mm_loadu_si128((const __m128i*) &kernel[i]);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(s, k));
+	}
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+#elif defined(RESAMPLER_NEON)
+	int32x4_t sum = vdupq_n_s32(0);
+	for (i = 0; i < taps; i += 8) {
+		int16x8_t s = vld1q_s16(&samples[i]);
+		int16x8_t k = vld1q_s16(&kernel[i]);
+		sum = vmlal_s16(sum, vget_low_s16(s), vget_low_s16(k));
+		sum = vmlal_s16(sum, vget_high_s16(s), vget_high_s16(k));
+	}
+	int32x2_t half = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+	return vget_lane_s32(vpadd_s32(half, half), 0);
+#else
+	int32_t sum = 0;
+	for (i = 0; i < taps; ++i) {
+		sum += samples[i] * kernel[i];
+	}
+	return sum;
+#endif
+}
+
+static int16_t _toSample(int32_t sum) {
+	sum = (sum + 0x4000) >> 15;
+	if (sum > INT16_MAX) {
+		return INT16_MAX;
+	}
+	if (sum < INT16_MIN) {
+		return INT16_MIN;
+	}
+	return sum;
+}
+
+void mAudioResamplerInit(struct mAudioResampler* resampler, enum mAudioResamplerQuality quality, size_t capacity) {
+	if (quality < mAUDIO_RESAMPLER_LOW || quality > mAUDIO_RESAMPLER_HIGH) {
+		quality = mAUDIO_RESAMPLER_MEDIUM;
+	}
+	resampler->quality = quality;
+	resampler->taps = _qualities[quality - 1].taps;
+	resampler->phases = _qualities[quality - 1].phases;
+	resampler->kernel = malloc((resampler->phases + 1) * resampler->taps * sizeof(*resampler->kernel));
+	resampler->cutoff = 0;
+
+	// Make sure there's always room for a full kernel's worth of history
+	resampler->capacity = capacity + resampler->taps;
+	resampler->left = calloc(resampler->capacity, sizeof(*resampler->left));
+	resampler->right = calloc(resampler->capacity, sizeof(*resampler->right));
+
+	mAudioResamplerSetRates(resampler, 1, 1);
+	mAudioResamplerClear(resampler);
+}
+
+void mAudioResamplerDeinit(struct mAudioResampler* resampler) {
+	free(resampler->kernel);
+	free(resampler->left);
+	free(resampler->right);
+	resampler->kernel = NULL;
+	resampler->left = NULL;
+	resampler->right = NULL;
+	resampler->size = 0;
+	resampler->capacity = 0;
+}
+
+void mAudioResamplerSetRates(struct mAudioResampler* resampler, double inputRate, double outputRate) {
+	resampler->inputRate = inputRate;
+	resampler->outputRate = outputRate;
+	resampler->step = inputRate / outputRate * 0x100000000ULL + 0.5;
+	if (!resampler->step) {
+		resampler->step = 1;
+	}
+
+	// Only downsampling needs the cutoff lowered. It's quantized so that small rate adjustments
+	// don't force the kernel to be rebuilt every time.
+	double ratio = outputRate < inputRate ? outputRate / inputRate : 1;
+	unsigned cutoff = lround(ratio * _qualities[resampler->quality - 1].passband * CUTOFF_SCALE);
+	if (cutoff < 1) {
+		cutoff = 1;
+	}
+	if (cutoff != resampler->cutoff) {
+		resampler->cutoff = cutoff;
+		_buildKernel(resampler);
+	}
+}
+
+void mAudioResamplerClear(struct mAudioResampler* resampler) {
+	// Start with enough silence that the first output is centered on the first input
+	resampler->size = resampler->taps / 2 - 1;
+	memset(resampler->left, 0, resampler->size * sizeof(*resampler->left));
+	memset(resampler->right, 0, resampler->size * sizeof(*resampler->right));
+	resampler->position = 0;
+}
+
+size_t mAudioResamplerPush(struct mAudioResampler* resampler, const struct mStereoSample* samples, size_t count) {
+	if (count > resampler->capacity - resampler->size) {
+		count = resampler->capacity - resampler->size;
+	}
+	// The channels are kept apart so that each one can be filtered with straight vector loads
+	int16_t* left = &resampler->left[resampler->size];
+	int16_t* right = &resampler->right[resampler->size];
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		left[i] = samples[i].left;
+		right[i] = samples[i].right;
+	}
+	resampler->size += count;
+	return count;
+}
+
+size_t mAudioResamplerAvailable(const struct mAudioResampler* resampler) {
+	if (resampler->size < resampler->taps) {
+		return 0;
+	}
+	uint64_t limit = (uint64_t) (resampler->size - resampler->taps + 1) << 32;
+	if (resampler->position >= limit) {
+		return 0;
+	}
+	return (limit - resampler->position + resampler->step - 1) / resampler->step;
+}
+
+size_t mAudioResamplerPull(struct mAudioResampler* resampler, struct mStereoSample* samples, size_t count) {
+	size_t available = mAudioResamplerAvailable(resampler);
+	if (count > available) {
+		count = available;
+	}
+	unsigned taps = resampler->taps;
+	size_t i;
+	for (i = 0; i < count; ++i, resampler->position += resampler->step) {
+		size_t index = resampler->position >> 32;
+		uint64_t phase = ((resampler->position & 0xFFFFFFFFULL) * resampler->phases + 0x80000000ULL) >> 32;
+		const int16_t* kernel = &resampler->kernel[phase * taps];
+		samples[i].left = _toSample(_dot(&resampler->left[index], kernel, taps));
+		samples[i].right = _toSample(_dot(&resampler->right[index], kernel, taps));
+	}
+
+	// Drop the history that's no longer needed
+	size_t consumed = resampler->position >> 32;
+	if (consumed > resampler->size) {
+		consumed = resampler->size;
+	}
+	if (consumed) {
+		size_t remaining = resampler->size - consumed;
+		memmove(resampler->left, &resampler->left[consumed], remaining * sizeof(*resampler->left));
+		memmove(resampler->right, &resampler->right[consumed], remaining * sizeof(*resampler->right));
+		resampler->size = remaining;
+		resampler->position -= (uint64_t) consumed << 32;
+	}
+	return count;
+}
@@ -0,0 +1,93 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/av-buffer.h>
+
+#include <mgba-util/memory.h>
+
+void mAVBufferPoolInit(struct mAVBufferPool* pool, size_t buffers, size_t stride, unsigned height, size_t samples) {
+	MutexInit(&pool->mutex);
+	pool->buffers = calloc(buffers, sizeof(*pool->buffers));
+	pool->nBuffers = buffers;
+	pool->stride = stride;
+	pool->height = height;
+	pool->next = 0;
+	pool->dropped = 0;
+	size_t i;
+	for (i = 0; i < buffers; ++i) {
+		struct mAVBuffer* buffer = &pool->buffers[i];
+		buffer->pool = pool;
+		buffer->pixels = anonymousMemoryMap(stride * height * BYTES_PER_PIXEL);
+		buffer->stride = stride;
+		buffer->samples = calloc(samples, sizeof(*buffer->samples));
+		buffer->sampleCapacity = samples;
+	}
+}
+
+void mAVBufferPoolDeinit(struct mAVBufferPool* pool) {
+	size_t i;
+	for (i = 0; i < pool->nBuffers; ++i) {
+		struct mAVBuffer* buffer = &pool->buffers[i];
+		mappedMemoryFree(buffer->pixels, pool->stride * pool->height * BYTES_PER_PIXEL);
+		free(buffer->samples);
+	}
+	free(pool->buffers);
+	pool->buffers = NULL;
+	pool->nBuffers = 0;
+	MutexDeinit(&pool->mutex);
+}
+
+struct mAVBuffer* mAVBufferPoolAcquire(struct mAVBufferPool* pool) {
+	struct mAVBuffer* buffer = NULL;
+	MutexLock(&pool->mutex);
+	size_t i;
+	// Hand them out in order, so that the one that's been free the longest gets reused first
+	for (i = 0; i < pool->nBuffers; ++i) {
+		struct mAVBuffer* candidate = &pool->buffers[(pool->next + i) % pool->nBuffers];
+		if (!candidate->refs) {
+			buffer = candidate;
+			pool->next = (pool->next + i + 1) % pool->nBuffers;
+			break;
+		}
+	}
+	if (buffer) {
+		buffer->refs = 1;
+		buffer->nSamples = 0;
+		buffer->frame = 0;
+		buffer->cycles = 0;
+	}
+	MutexUnlock(&pool->mutex);
+	return buffer;
+}
+
+void mAVBufferRef(struct mAVBuffer* buffer) {
+	MutexLock(&buffer->pool->mutex);
+	++buffer->refs;
+	MutexUnlock(&buffer->pool->mutex);
+}
+
+void mAVBufferUnref(struct mAVBuffer* buffer) {
+	MutexLock(&buffer->pool->mutex);
+	--buffer->refs;
+	MutexUnlock(&buffer->pool->mutex);
+}
+
+struct mAVBuffer* mAVStreamSwapBuffer(struct mAVStream* stream, struct mAVBuffer* current, unsigned width, unsigned height, uint32_t frame, uint64_t cycles) {
+	struct mAVBuffer* next = mAVBufferPoolAcquire(current->pool);
+	if (!next) {
+		MutexLock(&current->pool->mutex);
+		++current->pool->dropped;
+		MutexUnlock(&current->pool->mutex);
+		current->nSamples = 0;
+		return current;
+	}
+	current->width = width;
+	current->height = height;
+	current->frame = frame;
+	current->cycles = cycles;
+	// The stream takes over the core's reference
+	stream->postVideoBuffer(stream, current);
+	return next;
+}
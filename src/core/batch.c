@@ -0,0 +1,236 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/batch.h>
+
+#include <mgba/core/core.h>
+
+DEFINE_VECTOR(mCoreBatchCores, struct mCore*);
+DEFINE_VECTOR(mCoreBatchOutputs, struct mCoreBatchOutput);
+
+static void _runCore(struct mCoreBatch* batch, size_t index) {
+	struct mCore* core = *mCoreBatchCoresGetPointer(&batch->cores, index);
+	if (batch->resetting) {
+		core->reset(core);
+		return;
+	}
+	struct mCoreBatchOutput* output = mCoreBatchOutputsGetPointer(&batch->outputs, index);
+	// Only the last frame's picture is returned, so there's no need to render the others
+	if (batch->frames > 1) {
+		core->skipVideoFrames(core, batch->frames - 1);
+	}
+	unsigned frames;
+	for (frames = batch->frames; frames; --frames) {
+		core->runFrame(core);
+	}
+	core->getPixels(core, &output->pixels, &output->stride);
+	output->audio[0] = core->getAudioChannel(core, 0);
+	output->audio[1] = core->getAudioChannel(core, 1);
+}
+
+#ifndef DISABLE_THREADING
+static void _runCores(struct mCoreBatch* batch, size_t thread) {
+	size_t size = mCoreBatchCoresSize(&batch->cores);
+	if (batch->stableAffinity) {
+		size_t threads = batch->nWorkers + 1;
+		size_t index;
+		for (index = size * thread / threads; index < size * (thread + 1) / threads; ++index) {
+			_runCore(batch, index);
+		}
+		return;
+	}
+	while (true) {
+		// Cores are claimed one at a time so that workers that finish early pick up the slack
+		size_t index = ATOMIC_ADD(batch->nextCore, 1) - 1;
+		if (index >= size) {
+			break;
+		}
+		_runCore(batch, index);
+	}
+}
+
+static THREAD_ENTRY _workerThread(void* context) {
+	struct mCoreBatch* batch = context;
+	ThreadSetName("Batch Worker");
+
+	// Workers are started before any frames are run, so they begin having seen generation 0
+	unsigned generation = 0;
+	int cpu = -1;
+	MutexLock(&batch->mutex);
+	// The calling thread is thread 0
+	int id = ++batch->nextWorkerId;
+	while (true) {
+		while (generation == batch->generation && !batch->quit) {
+			ConditionWait(&batch->workCond, &batch->mutex);
+		}
+		// Some platforms only wake one waiter at a time, so pass the wakeup along
+		ConditionWake(&batch->workCond);
+		if (batch->quit) {
+			break;
+		}
+		generation = batch->generation;
+		if (cpu != batch->firstCpu) {
+			cpu = batch->firstCpu;
+			ThreadSetAffinity(cpu < 0 ? -1 : cpu + id);
+		}
+		MutexUnlock(&batch->mutex);
+
+		_runCores(batch, id);
+
+		MutexLock(&batch->mutex);
+		--batch->activeWorkers;
+		if (!batch->activeWorkers) {
+			ConditionWake(&batch->doneCond);
+		}
+	}
+	MutexUnlock(&batch->mutex);
+	THREAD_EXIT(0);
+}
+#endif
+
+void mCoreBatchInit(struct mCoreBatch* batch, size_t workers) {
+	mCoreBatchCoresInit(&batch->cores, 0);
+	mCoreBatchOutputsInit(&batch->outputs, 0);
+	batch->frames = 0;
+	batch->resetting = false;
+	batch->stableAffinity = false;
+#ifndef DISABLE_THREADING
+	MutexInit(&batch->mutex);
+	ConditionInit(&batch->workCond);
+	ConditionInit(&batch->doneCond);
+	batch->generation = 0;
+	batch->activeWorkers = 0;
+	batch->nextCore = 0;
+	batch->nextWorkerId = 0;
+	batch->firstCpu = -1;
+	batch->quit = false;
+	batch->nWorkers = workers;
+	batch->workers = NULL;
+	if (workers) {
+		batch->workers = calloc(workers, sizeof(*batch->workers));
+		size_t i;
+		for (i = 0; i < workers; ++i) {
+			ThreadCreate(&batch->workers[i], _workerThread, batch);
+		}
+	}
+#else
+	UNUSED(workers);
+#endif
+}
+
+void mCoreBatchDeinit(struct mCoreBatch* batch) {
+#ifndef DISABLE_THREADING
+	MutexLock(&batch->mutex);
+	batch->quit = true;
+	ConditionWake(&batch->workCond);
+	MutexUnlock(&batch->mutex);
+	size_t i;
+	for (i = 0; i < batch->nWorkers; ++i) {
+		ThreadJoin(&batch->workers[i]);
+	}
+	free(batch->workers);
+	batch->workers = NULL;
+	batch->nWorkers = 0;
+	MutexDeinit(&batch->mutex);
+	ConditionDeinit(&batch->workCond);
+	ConditionDeinit(&batch->doneCond);
+#endif
+	mCoreBatchCoresDeinit(&batch->cores);
+	mCoreBatchOutputsDeinit(&batch->outputs);
+}
+
+size_t mCoreBatchAddCore(struct mCoreBatch* batch, struct mCore* core) {
+	*mCoreBatchCoresAppend(&batch->cores) = core;
+	struct mCoreBatchOutput* output = mCoreBatchOutputsAppend(&batch->outputs);
+	memset(output, 0, sizeof(*output));
+	return mCoreBatchCoresSize(&batch->cores) - 1;
+}
+
+void mCoreBatchClear(struct mCoreBatch* batch) {
+	mCoreBatchCoresClear(&batch->cores);
+	mCoreBatchOutputsClear(&batch->outputs);
+}
+
+size_t mCoreBatchSize(const struct mCoreBatch* batch) {
+	return mCoreBatchCoresSize(&batch->cores);
+}
+
+struct mCore* mCoreBatchGetCore(struct mCoreBatch* batch, size_t index) {
+	if (index >= mCoreBatchCoresSize(&batch->cores)) {
+		return NULL;
+	}
+	return *mCoreBatchCoresGetPointer(&batch->cores, index);
+}
+
+void mCoreBatchSetStableAffinity(struct mCoreBatch* batch, bool stable) {
+	batch->stableAffinity = stable;
+}
+
+void mCoreBatchPinWorkers(struct mCoreBatch* batch, int firstCpu) {
+#ifndef DISABLE_THREADING
+	// Workers pick this up the next time they're woken
+	MutexLock(&batch->mutex);
+	batch->firstCpu = firstCpu;
+	MutexUnlock(&batch->mutex);
+	if (firstCpu >= 0) {
+		batch->stableAffinity = true;
+	}
+#else
+	UNUSED(firstCpu);
+#endif
+}
+
+void mCoreBatchSetKeys(struct mCoreBatch* batch, const uint32_t* keys) {
+	size_t size = mCoreBatchCoresSize(&batch->cores);
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		struct mCore* core = *mCoreBatchCoresGetPointer(&batch->cores, i);
+		core->setKeys(core, keys[i]);
+	}
+}
+
+static void _runBatch(struct mCoreBatch* batch) {
+	size_t size = mCoreBatchCoresSize(&batch->cores);
+#ifndef DISABLE_THREADING
+	// With stable affinity, a lone core still has to run on the worker it belongs to
+	if (batch->nWorkers && (size > 1 || batch->stableAffinity)) {
+		MutexLock(&batch->mutex);
+		batch->nextCore = 0;
+		batch->activeWorkers = batch->nWorkers;
+		++batch->generation;
+		ConditionWake(&batch->workCond);
+		MutexUnlock(&batch->mutex);
+
+		// The calling thread works through the batch too instead of idling
+		_runCores(batch, 0);
+
+		MutexLock(&batch->mutex);
+		while (batch->activeWorkers) {
+			ConditionWait(&batch->doneCond, &batch->mutex);
+		}
+		MutexUnlock(&batch->mutex);
+		return;
+	}
+#endif
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		_runCore(batch, i);
+	}
+}
+
+void mCoreBatchReset(struct mCoreBatch* batch) {
+	batch->resetting = true;
+	_runBatch(batch);
+	batch->resetting = false;
+}
+
+const struct mCoreBatchOutput* mCoreBatchRunFrames(struct mCoreBatch* batch, unsigned frames) {
+	if (!mCoreBatchCoresSize(&batch->cores)) {
+		return NULL;
+	}
+	batch->frames = frames;
+	_runBatch(batch);
+	return mCoreBatchOutputsGetConstPointer(&batch->outputs, 0);
+}
@@ -101,6 +101,30 @@ void mBitmapCacheWriteVRAM(struct mBitmapCache* cache, uint32_t address) {
 	}
 }
 
+void mBitmapCacheWriteVRAMRange(struct mBitmapCache* cache, uint32_t address, uint32_t length) {
+	size_t i;
+	for (i = 0; i < mBitmapCacheSystemInfoGetBuffers(cache->sysConfig); ++i) {
+		uint32_t start = address;
+		uint32_t end = address + length;
+		if (start < cache->bitsStart[i]) {
+			start = cache->bitsStart[i];
+		}
+		if (end > cache->bitsStart[i] + cache->bitsSize) {
+			end = cache->bitsStart[i] + cache->bitsSize;
+		}
+		if (start >= end) {
+			continue;
+		}
+		uint32_t row = (start - cache->bitsStart[i]) / cache->stride;
+		uint32_t last = (end - 1 - cache->bitsStart[i]) / cache->stride;
+		for (; row <= last; ++row) {
+			size_t offset = row * mBitmapCacheSystemInfoGetBuffers(cache->sysConfig) + cache->buffer;
+			cache->status[offset].vramClean = 0;
+			++cache->status[offset].vramVersion;
+		}
+	}
+}
+
 void mBitmapCacheWritePalette(struct mBitmapCache* cache, uint32_t entry, color_t color) {
 	if (!mBitmapCacheSystemInfoIsUsesPalette(cache->sysConfig)) {
 		return;
@@ -0,0 +1,162 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/boot-cache.h>
+
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/core/serialize.h>
+#include <mgba-util/crc32.h>
+#include <mgba-util/vfs.h>
+
+// Covers the GBA BIOS, and the GB boot ROM while it's mapped
+#define BIOS_HASH_SIZE 0x4000
+
+mLOG_DECLARE_CATEGORY(BOOT_CACHE);
+mLOG_DEFINE_CATEGORY(BOOT_CACHE, "Boot cache", "core.boot-cache");
+
+static void _hashConfigEntry(const char* key, const char* value, void* user) {
+	uint32_t* hash = user;
+	uint32_t crc = crc32(0, (const uint8_t*) key, strlen(key) + 1);
+	// Added up so the order the tables store entries in doesn't matter
+	*hash += crc32(crc, (const uint8_t*) value, strlen(value) + 1);
+}
+
+static uint32_t _hashConfig(const struct mCoreConfig* config) {
+	const struct Configuration* tables[] = {
+		&config->defaultsTable,
+		&config->configTable,
+		&config->overridesTable,
+	};
+	uint32_t hash = 0;
+	size_t i;
+	for (i = 0; i < sizeof(tables) / sizeof(*tables); ++i) {
+		ConfigurationEnumerate(tables[i], NULL, _hashConfigEntry, &hash);
+		if (config->port) {
+			ConfigurationEnumerate(tables[i], config->port, _hashConfigEntry, &hash);
+		}
+	}
+	return hash;
+}
+
+static uint32_t _hashKey(struct mCore* core) {
+	uint8_t bios[BIOS_HASH_SIZE];
+	uint32_t address;
+	for (address = 0; address < BIOS_HASH_SIZE; ++address) {
+		bios[address] = core->rawRead8(core, address, -1);
+	}
+	uint32_t key[4] = {
+		doCrc32(bios, sizeof(bios)),
+		_hashConfig(&core->config),
+		core->opts.skipBios | (core->opts.useBios << 1),
+		0
+	};
+
+	void* sram = NULL;
+	size_t size = core->savedataClone(core, &sram);
+	if (sram) {
+		key[3] = doCrc32(sram, size);
+		free(sram);
+	}
+	return doCrc32(key, sizeof(key));
+}
+
+static void _keysRead(void* context) {
+	struct mBootCache* cache = context;
+	cache->keysRead = true;
+}
+
+static bool _isCleanBoot(struct mBootCache* cache) {
+	// The core only counts a frame once its end callbacks have run
+	if (cache->core->frameCounter(cache->core) - cache->startFrame == cache->framesElapsed) {
+		return true;
+	}
+	// Something else loaded a state, so this is no longer a clean boot
+	cache->pending = false;
+	return false;
+}
+
+static void _frameEnded(void* context) {
+	struct mBootCache* cache = context;
+	if (!cache->pending || !_isCleanBoot(cache)) {
+		return;
+	}
+	++cache->framesElapsed;
+	if (cache->frame ? cache->framesElapsed >= cache->frame : cache->keysRead) {
+		cache->ready = true;
+	}
+}
+
+static void _frameStarted(void* context) {
+	struct mBootCache* cache = context;
+	// The start of a frame is where states are expected to be taken, as with rewind
+	if (!cache->pending || !cache->ready || !_isCleanBoot(cache)) {
+		return;
+	}
+	cache->pending = false;
+
+	struct VFile* vf = cache->dir->openFile(cache->dir, cache->name, O_CREAT | O_TRUNC | O_RDWR);
+	if (!vf) {
+		mLOG(BOOT_CACHE, WARN, "Could not create boot cache entry %s", cache->name);
+		return;
+	}
+	if (!mCoreSaveStateNamed(cache->core, vf, SAVESTATE_RTC)) {
+		mLOG(BOOT_CACHE, WARN, "Could not save boot cache entry %s", cache->name);
+		vf->truncate(vf, 0);
+	}
+	vf->close(vf);
+}
+
+void mBootCacheInit(struct mBootCache* cache, struct mCore* core, struct VDir* dir, unsigned frame) {
+	memset(cache, 0, sizeof(*cache));
+	cache->core = core;
+	cache->dir = dir;
+	cache->frame = frame;
+
+	struct mCoreCallbacks callbacks = {
+		.videoFrameStarted = _frameStarted,
+		.videoFrameEnded = _frameEnded,
+		.keysRead = _keysRead,
+		.context = cache
+	};
+	core->addCoreCallbacks(core, &callbacks);
+}
+
+void mBootCacheDeinit(struct mBootCache* cache) {
+	cache->pending = false;
+	if (cache->dir) {
+		cache->dir->close(cache->dir);
+		cache->dir = NULL;
+	}
+}
+
+bool mBootCacheRestore(struct mBootCache* cache) {
+	struct mCore* core = cache->core;
+	cache->pending = false;
+	cache->keysRead = false;
+	cache->ready = false;
+	cache->framesElapsed = 0;
+	if (!cache->dir) {
+		return false;
+	}
+
+	uint32_t crc = 0;
+	core->checksum(core, &crc, mCHECKSUM_CRC32);
+	snprintf(cache->name, sizeof(cache->name), "boot-%08X-%08X.ss", crc, _hashKey(core));
+
+	struct VFile* vf = cache->dir->openFile(cache->dir, cache->name, O_RDONLY);
+	if (vf) {
+		bool loaded = vf->size(vf) > 0 && mCoreLoadStateNamed(core, vf, SAVESTATE_RTC);
+		vf->close(vf);
+		if (loaded) {
+			return true;
+		}
+		mLOG(BOOT_CACHE, WARN, "Could not load boot cache entry %s", cache->name);
+		// A bad entry was probably cut short, so the state is taken again to replace it
+	}
+	cache->startFrame = core->frameCounter(core);
+	cache->pending = true;
+	return false;
+}
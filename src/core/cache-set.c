@@ -72,6 +72,19 @@ void mCacheSetWriteVRAM(struct mCacheSet* cache, uint32_t address) {
 	}
 }
 
+void mCacheSetWriteVRAMRange(struct mCacheSet* cache, uint32_t address, uint32_t length) {
+	size_t i;
+	for (i = 0; i < mMapCacheSetSize(&cache->maps); ++i) {
+		mMapCacheWriteVRAMRange(mMapCacheSetGetPointer(&cache->maps, i), address, length);
+	}
+	for (i = 0; i < mBitmapCacheSetSize(&cache->bitmaps); ++i) {
+		mBitmapCacheWriteVRAMRange(mBitmapCacheSetGetPointer(&cache->bitmaps, i), address, length);
+	}
+	for (i = 0; i < mTileCacheSetSize(&cache->tiles); ++i) {
+		mTileCacheWriteVRAMRange(mTileCacheSetGetPointer(&cache->tiles, i), address, length);
+	}
+}
+
 void mCacheSetWritePalette(struct mCacheSet* cache, uint32_t entry, color_t color) {
 	size_t i;
 	for (i = 0; i < mBitmapCacheSetSize(&cache->bitmaps); ++i) {
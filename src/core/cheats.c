@@ -11,15 +11,24 @@
 
 #define MAX_LINE_LENGTH 512
 #define MAX_CHEATS 1000
+#define MAX_UNROLLED_REPEAT 16
 
 const uint32_t M_CHEAT_DEVICE_ID = 0xABADC0DE;
 
 mLOG_DEFINE_CATEGORY(CHEATS, "Cheats", "core.cheats");
 
 DEFINE_VECTOR(mCheatList, struct mCheat);
+DEFINE_VECTOR(mCheatOpList, struct mCheatOp);
 DEFINE_VECTOR(mCheatSets, struct mCheatSet*);
 DEFINE_VECTOR(mCheatPatchList, struct mCheatPatch);
 
+struct mCheatReadCache {
+	uint32_t address;
+	int width;
+	int32_t value;
+	bool valid;
+};
+
 struct mCheatPatchedMem {
 	uint32_t originalValue;
 	int refs;
@@ -197,6 +206,9 @@ void mCheatSetInit(struct mCheatSet* set, const char* name) {
 	mCheatListInit(&set->list, 4);
 	StringListInit(&set->lines, 4);
 	mCheatPatchListInit(&set->romPatches, 4);
+	mCheatOpListInit(&set->ops, 4);
+	set->compiledCodes = 0;
+	set->recompile = true;
 	if (name) {
 		set->name = strdup(name);
 	} else {
@@ -216,6 +228,7 @@ void mCheatSetDeinit(struct mCheatSet* set) {
 	}
 	StringListDeinit(&set->lines);
 	mCheatPatchListDeinit(&set->romPatches);
+	mCheatOpListDeinit(&set->ops);
 	if (set->deinit) {
 		set->deinit(set);
 	}
@@ -233,6 +246,7 @@ void mCheatSetRename(struct mCheatSet* set, const char* name) {
 }
 
 bool mCheatAddLine(struct mCheatSet* set, const char* line, int type) {
+	mCheatSetInvalidate(set);
 	if (!set->addLine(set, line, type)) {
 		return false;
 	}
@@ -240,6 +254,10 @@ bool mCheatAddLine(struct mCheatSet* set, const char* line, int type) {
 	return true;
 }
 
+void mCheatSetInvalidate(struct mCheatSet* set) {
+	set->recompile = true;
+}
+
 void mCheatAddSet(struct mCheatDevice* device, struct mCheatSet* cheats) {
 	*mCheatSetsAppend(&device->cheats) = cheats;
 	if (cheats->add) {
@@ -636,6 +654,122 @@ void mCheatAutosave(struct mCheatDevice* device) {
 }
 #endif
 
+static void _compileCheats(struct mCheatSet* cheats) {
+	mCheatOpListClear(&cheats->ops);
+	size_t nCodes = mCheatListSize(&cheats->list);
+	size_t i;
+	for (i = 0; i < nCodes; ++i) {
+		const struct mCheat* cheat = mCheatListGetConstPointer(&cheats->list, i);
+		if (!cheat->repeat) {
+			continue;
+		}
+		uint32_t unroll = 1;
+		switch (cheat->type) {
+		case CHEAT_ASSIGN:
+		case CHEAT_AND:
+		case CHEAT_ADD:
+		case CHEAT_OR:
+			if (cheat->repeat <= MAX_UNROLLED_REPEAT) {
+				unroll = cheat->repeat;
+			}
+			break;
+		default:
+			break;
+		}
+		uint32_t address = cheat->address;
+		uint32_t operand = cheat->operand;
+		uint32_t j;
+		for (j = 0; j < unroll; ++j) {
+			struct mCheatOp* op = mCheatOpListAppend(&cheats->ops);
+			op->type = cheat->type;
+			op->width = cheat->width;
+			op->address = address;
+			op->operand = operand;
+			op->repeat = unroll == cheat->repeat ? 1 : cheat->repeat;
+			op->code = i;
+			address += cheat->addressOffset;
+			operand += cheat->operandOffset;
+		}
+	}
+	cheats->compiledCodes = nCodes;
+	cheats->recompile = false;
+}
+
+static int32_t _readMemCached(struct mCore* core, uint32_t address, int width, struct mCheatReadCache* cache) {
+	// Consecutive conditions usually test the same address, so only read it again after a write
+	if (cache->valid && cache->address == address && cache->width == width) {
+		return cache->value;
+	}
+	cache->address = address;
+	cache->width = width;
+	cache->value = _readMem(core, address, width);
+	cache->valid = true;
+	return cache->value;
+}
+
+static bool _testCondition(struct mCheatDevice* device, const struct mCheatOp* op, struct mCheatReadCache* cache) {
+	int32_t operand = op->operand;
+	switch (op->type) {
+	case CHEAT_IF_EQ:
+		return _readMemCached(device->p, op->address, op->width, cache) == operand;
+	case CHEAT_IF_NE:
+		return _readMemCached(device->p, op->address, op->width, cache) != operand;
+	case CHEAT_IF_LT:
+		return _readMemCached(device->p, op->address, op->width, cache) < operand;
+	case CHEAT_IF_GT:
+		return _readMemCached(device->p, op->address, op->width, cache) > operand;
+	case CHEAT_IF_ULT:
+		return (uint32_t) _readMemCached(device->p, op->address, op->width, cache) < (uint32_t) operand;
+	case CHEAT_IF_UGT:
+		return (uint32_t) _readMemCached(device->p, op->address, op->width, cache) > (uint32_t) operand;
+	case CHEAT_IF_AND:
+		return _readMemCached(device->p, op->address, op->width, cache) & operand;
+	case CHEAT_IF_LAND:
+		return _readMemCached(device->p, op->address, op->width, cache) && operand;
+	case CHEAT_IF_NAND:
+		return !(_readMemCached(device->p, op->address, op->width, cache) & operand);
+	case CHEAT_IF_BUTTON:
+		return device->buttonDown;
+	case CHEAT_NEVER:
+	default:
+		return false;
+	}
+}
+
+static void _runOp(struct mCheatDevice* device, const struct mCheat* cheat, const struct mCheatOp* op, struct mCheatReadCache* cache) {
+	int32_t value = 0;
+	int32_t operand = op->operand;
+	uint32_t address = op->address;
+	uint32_t operationsRemaining;
+	for (operationsRemaining = op->repeat; operationsRemaining; --operationsRemaining) {
+		switch (op->type) {
+		case CHEAT_ASSIGN:
+			value = operand;
+			break;
+		case CHEAT_ASSIGN_INDIRECT:
+			value = operand;
+			address = _readMem(device->p, address, 4) + cheat->addressOffset;
+			break;
+		case CHEAT_AND:
+			value = _readMem(device->p, address, op->width) & operand;
+			break;
+		case CHEAT_ADD:
+			value = _readMem(device->p, address, op->width) + operand;
+			break;
+		case CHEAT_OR:
+			value = _readMem(device->p, address, op->width) | operand;
+			break;
+		default:
+			return;
+		}
+		_writeMem(device->p, address, op->width, value);
+		cache->valid = false;
+
+		address += cheat->addressOffset;
+		operand += cheat->operandOffset;
+	}
+}
+
 void mCheatRefresh(struct mCheatDevice* device, struct mCheatSet* cheats) {
 	if (cheats->enabled) {
 		_patchROM(device, cheats);
@@ -648,121 +782,41 @@ void mCheatRefresh(struct mCheatDevice* device, struct mCheatSet* cheats) {
 		return;
 	}
 
+	if (cheats->recompile || cheats->compiledCodes != mCheatListSize(&cheats->list)) {
+		_compileCheats(cheats);
+	}
+
+	struct mCheatReadCache cache = { .valid = false };
 	size_t elseLoc = 0;
 	size_t endLoc = 0;
 	size_t nCodes = mCheatListSize(&cheats->list);
+	size_t nOps = mCheatOpListSize(&cheats->ops);
+	size_t op = 0;
 	size_t i;
 	for (i = 0; i < nCodes; ++i) {
-		struct mCheat* cheat = mCheatListGetPointer(&cheats->list, i);
-		int32_t value = 0;
-		int32_t operand = cheat->operand;
-		uint32_t operationsRemaining = cheat->repeat;
-		uint32_t address = cheat->address;
-		bool performAssignment = false;
+		const struct mCheat* cheat = mCheatListGetConstPointer(&cheats->list, i);
 		bool condition = true;
 		int conditionRemaining = 0;
 		int negativeConditionRemaining = 0;
 
-		for (; operationsRemaining; --operationsRemaining) {
-			switch (cheat->type) {
-			case CHEAT_ASSIGN:
-				value = operand;
-				performAssignment = true;
-				break;
-			case CHEAT_ASSIGN_INDIRECT:
-				value = operand;
-				address = _readMem(device->p, address, 4) + cheat->addressOffset;
-				performAssignment = true;
-				break;
-			case CHEAT_AND:
-				value = _readMem(device->p, address, cheat->width) & operand;
-				performAssignment = true;
-				break;
-			case CHEAT_ADD:
-				value = _readMem(device->p, address, cheat->width) + operand;
-				performAssignment = true;
-				break;
-			case CHEAT_OR:
-				value = _readMem(device->p, address, cheat->width) | operand;
-				performAssignment = true;
-				break;
-			case CHEAT_IF_EQ:
-				condition = _readMem(device->p, address, cheat->width) == operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			case CHEAT_IF_NE:
-				condition = _readMem(device->p, address, cheat->width) != operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			case CHEAT_IF_LT:
-				condition = _readMem(device->p, address, cheat->width) < operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			case CHEAT_IF_GT:
-				condition = _readMem(device->p, address, cheat->width) > operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			case CHEAT_IF_ULT:
-				condition = (uint32_t) _readMem(device->p, address, cheat->width) < (uint32_t) operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			case CHEAT_IF_UGT:
-				condition = (uint32_t) _readMem(device->p, address, cheat->width) > (uint32_t) operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			case CHEAT_IF_AND:
-				condition = _readMem(device->p, address, cheat->width) & operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			case CHEAT_IF_LAND:
-				condition = _readMem(device->p, address, cheat->width) && operand;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			case CHEAT_IF_NAND:
-				condition = !(_readMem(device->p, address, cheat->width) & operand);
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			case CHEAT_IF_BUTTON:
-				condition = device->buttonDown;
-				conditionRemaining = cheat->repeat;
-				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
+		// Skip the ops of any codes that were jumped over
+		while (op < nOps && mCheatOpListGetConstPointer(&cheats->ops, op)->code < i) {
+			++op;
+		}
+		for (; op < nOps; ++op) {
+			const struct mCheatOp* cheatOp = mCheatOpListGetConstPointer(&cheats->ops, op);
+			if (cheatOp->code != i) {
 				break;
-			case CHEAT_NEVER:
-				condition = false;
+			}
+			if (cheatOp->type >= CHEAT_IF_EQ) {
+				condition = _testCondition(device, cheatOp, &cache);
 				conditionRemaining = cheat->repeat;
 				negativeConditionRemaining = cheat->negativeRepeat;
-				operationsRemaining = 1;
-				break;
-			}
-
-			if (performAssignment) {
-				_writeMem(device->p, address, cheat->width, value);
+			} else {
+				_runOp(device, cheat, cheatOp, &cache);
 			}
-
-			address += cheat->addressOffset;
-			operand += cheat->operandOffset;
 		}
 
-
 		if (elseLoc && i == elseLoc) {
 			i = endLoc;
 			endLoc = 0;
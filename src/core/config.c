@@ -407,15 +407,21 @@ void mCoreConfigMap(const struct mCoreConfig* config, struct mCoreOptions* opts)
 	_lookupIntValue(config, "volume", &opts->volume);
 	_lookupIntValue(config, "rewindBufferCapacity", &opts->rewindBufferCapacity);
 	_lookupIntValue(config, "rewindBufferInterval", &opts->rewindBufferInterval);
+	_lookupIntValue(config, "rewindBufferMemory", &opts->rewindBufferMemory);
+	_lookupIntValue(config, "rewindSpeed", &opts->rewindSpeed);
+	_lookupIntValue(config, "runAhead", &opts->runAhead);
 	_lookupFloatValue(config, "fpsTarget", &opts->fpsTarget);
 	unsigned audioBuffers;
 	if (_lookupUIntValue(config, "audioBuffers", &audioBuffers)) {
 		opts->audioBuffers = audioBuffers;
 	}
 	_lookupUIntValue(config, "sampleRate", &opts->sampleRate);
+	_lookupFloatValue(config, "audioRateControl", &opts->audioRateControl);
+	_lookupUIntValue(config, "audioResampler", &opts->audioResampler);
 
 	_lookupBoolValue(config, "audioSync", &opts->audioSync);
 	_lookupBoolValue(config, "videoSync", &opts->videoSync);
+	_lookupBoolValue(config, "framePacing", &opts->framePacing);
 
 	_lookupBoolValue(config, "lockAspectRatio", &opts->lockAspectRatio);
 	_lookupBoolValue(config, "lockIntegerScaling", &opts->lockIntegerScaling);
@@ -427,6 +433,7 @@ void mCoreConfigMap(const struct mCoreConfig* config, struct mCoreOptions* opts)
 
 	_lookupBoolValue(config, "suspendScreensaver", &opts->suspendScreensaver);
 	_lookupBoolValue(config, "mute", &opts->mute);
+	_lookupBoolValue(config, "disableAudio", &opts->disableAudio);
 	_lookupBoolValue(config, "rewindEnable", &opts->rewindEnable);
 
 	_lookupIntValue(config, "fullscreen", &opts->fullscreen);
@@ -450,16 +457,23 @@ void mCoreConfigLoadDefaults(struct mCoreConfig* config, const struct mCoreOptio
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "rewindEnable", opts->rewindEnable);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "rewindBufferCapacity", opts->rewindBufferCapacity);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "rewindBufferInterval", opts->rewindBufferInterval);
+	ConfigurationSetIntValue(&config->defaultsTable, 0, "rewindBufferMemory", opts->rewindBufferMemory);
+	ConfigurationSetIntValue(&config->defaultsTable, 0, "rewindSpeed", opts->rewindSpeed);
+	ConfigurationSetIntValue(&config->defaultsTable, 0, "runAhead", opts->runAhead);
 	ConfigurationSetFloatValue(&config->defaultsTable, 0, "fpsTarget", opts->fpsTarget);
 	ConfigurationSetUIntValue(&config->defaultsTable, 0, "audioBuffers", opts->audioBuffers);
 	ConfigurationSetUIntValue(&config->defaultsTable, 0, "sampleRate", opts->sampleRate);
+	ConfigurationSetFloatValue(&config->defaultsTable, 0, "audioRateControl", opts->audioRateControl);
+	ConfigurationSetUIntValue(&config->defaultsTable, 0, "audioResampler", opts->audioResampler);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "audioSync", opts->audioSync);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "videoSync", opts->videoSync);
+	ConfigurationSetIntValue(&config->defaultsTable, 0, "framePacing", opts->framePacing);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "fullscreen", opts->fullscreen);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "width", opts->width);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "height", opts->height);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "volume", opts->volume);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "mute", opts->mute);
+	ConfigurationSetIntValue(&config->defaultsTable, 0, "disableAudio", opts->disableAudio);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "lockAspectRatio", opts->lockAspectRatio);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "lockIntegerScaling", opts->lockIntegerScaling);
 	ConfigurationSetIntValue(&config->defaultsTable, 0, "resampleVideo", opts->resampleVideo);
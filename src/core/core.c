@@ -470,9 +470,17 @@ bool mCoreLoadELF(struct mCore* core, struct ELF* elf) {
 #ifdef USE_DEBUGGERS
 void mCoreLoadELFSymbols(struct mDebuggerSymbols* symbols, struct ELF* elf) {
 	size_t symIndex = ELFFindSection(elf, ".symtab");
-	size_t names = ELFFindSection(elf, ".strtab");
+	if (!symIndex) {
+		return;
+	}
 	Elf32_Shdr* symHeader = ELFGetSectionHeader(elf, symIndex);
-	char* bytes = ELFBytes(elf, NULL);
+	// The symbol table names its own string table, so no other section needs to be looked up
+	size_t names = symHeader->sh_link;
+	size_t size;
+	char* bytes = ELFBytes(elf, &size);
+	if (symHeader->sh_offset > size || symHeader->sh_size > size - symHeader->sh_offset) {
+		return;
+	}
 
 	Elf32_Sym* syms = (Elf32_Sym*) &bytes[symHeader->sh_offset];
 	size_t i;
@@ -484,7 +492,7 @@ void mCoreLoadELFSymbols(struct mDebuggerSymbols* symbols, struct ELF* elf) {
 		if (name[0] == '$') {
 			continue;
 		}
-		mDebuggerSymbolAdd(symbols, name, syms[i].st_value, -1);
+		mDebuggerSymbolAddSized(symbols, name, syms[i].st_value, -1, syms[i].st_size);
 	}
 }
 #endif
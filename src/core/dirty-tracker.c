@@ -0,0 +1,82 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/dirty-tracker.h>
+
+void mDirtyTrackerInit(struct mDirtyTracker* tracker) {
+	memset(tracker, 0, sizeof(*tracker));
+}
+
+void mDirtyTrackerDeinit(struct mDirtyTracker* tracker) {
+	size_t i;
+	for (i = 0; i < tracker->nRegions; ++i) {
+		free(tracker->regions[i].shadow);
+	}
+	memset(tracker, 0, sizeof(*tracker));
+}
+
+int mDirtyTrackerAddRegion(struct mDirtyTracker* tracker, const void* data, size_t size) {
+	if (tracker->nRegions >= mDIRTY_TRACKER_MAX_REGIONS) {
+		return -1;
+	}
+	struct mDirtyTrackerRegion* region = &tracker->regions[tracker->nRegions];
+	memset(region, 0, sizeof(*region));
+	region->data = data;
+	region->size = size;
+	return tracker->nRegions++;
+}
+
+void mDirtyTrackerWatch(struct mDirtyTracker* tracker, int region) {
+	if (region < 0 || (size_t) region >= tracker->nRegions) {
+		return;
+	}
+	ATOMIC_ADD(tracker->regions[region].watchers, 1);
+}
+
+void mDirtyTrackerUnwatch(struct mDirtyTracker* tracker, int region) {
+	if (region < 0 || (size_t) region >= tracker->nRegions) {
+		return;
+	}
+	ATOMIC_SUB(tracker->regions[region].watchers, 1);
+}
+
+uint32_t mDirtyTrackerUpdate(struct mDirtyTracker* tracker) {
+	uint32_t changed = 0;
+	size_t i;
+	for (i = 0; i < tracker->nRegions; ++i) {
+		struct mDirtyTrackerRegion* region = &tracker->regions[i];
+		int watchers;
+		ATOMIC_LOAD(watchers, region->watchers);
+		if (!watchers) {
+			// Drop the copy so that it can't be stale when something starts watching again
+			if (region->shadow) {
+				free(region->shadow);
+				region->shadow = NULL;
+			}
+			continue;
+		}
+		if (!region->shadow) {
+			region->shadow = malloc(region->size);
+			memcpy(region->shadow, region->data, region->size);
+			continue;
+		}
+		if (memcmp(region->shadow, region->data, region->size) == 0) {
+			continue;
+		}
+		memcpy(region->shadow, region->data, region->size);
+		ATOMIC_ADD(region->generation, 1);
+		changed |= 1 << i;
+	}
+	return changed;
+}
+
+uint32_t mDirtyTrackerGeneration(struct mDirtyTracker* tracker, int region) {
+	if (region < 0 || (size_t) region >= tracker->nRegions) {
+		return 0;
+	}
+	int generation;
+	ATOMIC_LOAD(generation, tracker->regions[region].generation);
+	return generation;
+}
@@ -26,6 +26,17 @@ static void _rtcGenericSample(struct mRTCSource* source) {
 	}
 }
 
+static time_t _rtcGenericHostTime(struct mRTCGenericSource* rtc) {
+	// Games that poll the clock constantly would otherwise ask the host for the time every access
+	uint32_t frame = rtc->p->frameCounter(rtc->p);
+	if (!rtc->hostTimeValid || rtc->hostTimeFrame != frame) {
+		rtc->hostTime = time(0);
+		rtc->hostTimeFrame = frame;
+		rtc->hostTimeValid = true;
+	}
+	return rtc->hostTime;
+}
+
 static time_t _rtcGenericCallback(struct mRTCSource* source) {
 	struct mRTCGenericSource* rtc = (struct mRTCGenericSource*) source;
 	switch (rtc->override) {
@@ -35,13 +46,13 @@ static time_t _rtcGenericCallback(struct mRTCSource* source) {
 		}
 		// Fall through
 	case RTC_NO_OVERRIDE:
-		return time(0);
+		return _rtcGenericHostTime(rtc);
 	case RTC_FIXED:
 		return rtc->value / 1000LL;
 	case RTC_FAKE_EPOCH:
 		return (rtc->value + rtc->p->frameCounter(rtc->p) * (rtc->p->frameCycles(rtc->p) * 1000LL) / rtc->p->frequency(rtc->p)) / 1000LL;
 	case RTC_WALLCLOCK_OFFSET:
-		return time(0) + rtc->value / 1000LL;
+		return _rtcGenericHostTime(rtc) + rtc->value / 1000LL;
 	}
 }
 
@@ -97,6 +108,7 @@ static bool _rtcGenericDeserialize(struct mRTCSource* source, const struct mStat
 	}
 	rtc->value = state->value;
 	rtc->override = state->type;
+	rtc->hostTimeValid = false;
 	return true;
 }
 
@@ -104,6 +116,7 @@ void mRTCGenericSourceInit(struct mRTCGenericSource* rtc, struct mCore* core) {
 	rtc->p = core;
 	rtc->override = RTC_NO_OVERRIDE;
 	rtc->value = 0;
+	rtc->hostTimeValid = false;
 	rtc->d.sample = _rtcGenericSample;
 	rtc->d.unixTime = _rtcGenericCallback;
 	rtc->d.serialize = _rtcGenericSerialize;
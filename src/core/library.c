@@ -6,14 +6,64 @@
 #include <mgba/core/library.h>
 
 #include <mgba/core/core.h>
+#include <mgba-util/table.h>
 #include <mgba-util/vfs.h>
 
 #ifdef USE_SQLITE3
 
 #include <sqlite3.h>
+#include <sys/stat.h>
 #include "feature/sqlite3/no-intro.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifndef DISABLE_THREADING
+#include <mgba-util/threading.h>
+#endif
+
+// Identifying a ROM is mostly waiting on I/O, so this is deliberately not tied to the CPU count
+#define LIBRARY_SCAN_WORKERS 4
+#define LIBRARY_SCAN_MAX_IN_FLIGHT 64
+
 DEFINE_VECTOR(mLibraryListing, struct mLibraryEntry);
+DEFINE_VECTOR(mLibraryIdleLoopList, struct mLibraryIdleLoop);
+
+struct mLibraryScanJob {
+	char* base;
+	char* filename;
+	// Only set for files inside archives, which have to be read on the scanning thread
+	struct VFile* vf;
+	int64_t mtime;
+	bool tryArchive;
+
+	bool found;
+	struct mLibraryEntry entry;
+};
+
+DECLARE_VECTOR(mLibraryScanJobList, struct mLibraryScanJob*);
+DEFINE_VECTOR(mLibraryScanJobList, struct mLibraryScanJob*);
+
+struct mLibraryScan {
+	struct mLibrary* library;
+	struct mLibraryScanJobList pending;
+	struct mLibraryScanJobList done;
+	size_t inFlight;
+#ifndef DISABLE_THREADING
+	Mutex mutex;
+	Condition workCond;
+	Condition doneCond;
+	bool quit;
+	Thread workers[LIBRARY_SCAN_WORKERS];
+#endif
+};
+
+struct mLibraryKnownPath {
+	int64_t mtime;
+	int64_t size;
+	bool seen;
+};
 
 struct mLibrary {
 	sqlite3* db;
@@ -22,10 +72,15 @@ struct mLibrary {
 	sqlite3_stmt* insertRoot;
 	sqlite3_stmt* selectRom;
 	sqlite3_stmt* selectRoot;
+	sqlite3_stmt* selectPaths;
+	sqlite3_stmt* updateRootMtime;
 	sqlite3_stmt* deletePath;
 	sqlite3_stmt* deleteRoot;
 	sqlite3_stmt* count;
 	sqlite3_stmt* select;
+	sqlite3_stmt* selectIdleLoop;
+	sqlite3_stmt* insertIdleLoop;
+	sqlite3_stmt* selectIdleLoops;
 	const struct NoIntroDB* gameDB;
 };
 
@@ -40,9 +95,9 @@ struct mLibrary {
 	"CASE WHEN :useFilename THEN paths.path = :path ELSE 1 END AND " \
 	"CASE WHEN :useRoot THEN roots.path = :root ELSE 1 END"
 
-static void _mLibraryDeleteEntry(struct mLibrary* library, struct mLibraryEntry* entry);
-static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry* entry);
-static bool _mLibraryAddEntry(struct mLibrary* library, const char* filename, const char* base, struct VFile* vf);
+static void _mLibraryDeletePath(struct mLibrary* library, const char* base, const char* filename);
+static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry* entry, int64_t mtime);
+static void _mLibraryScanDirectory(struct mLibraryScan* scan, const char* base, bool recursive);
 
 static void _bindConstraints(sqlite3_stmt* statement, const struct mLibraryEntry* constraints) {
 	if (!constraints) {
@@ -137,16 +192,25 @@ struct mLibrary* mLibraryLoad(const char* path) {
 		"\n 	customTitle TEXT,"
 		"\n 	CONSTRAINT location UNIQUE (path, rootid)"
 		"\n );"
+		"\n CREATE TABLE IF NOT EXISTS idleLoops ("
+		"\n 	crc32 INTEGER NOT NULL,"
+		"\n 	platform INTEGER NOT NULL DEFAULT -1,"
+		"\n 	internalCode TEXT,"
+		"\n 	address INTEGER NOT NULL,"
+		"\n 	confidence INTEGER NOT NULL DEFAULT 1,"
+		"\n 	CONSTRAINT game UNIQUE (crc32, platform)"
+		"\n );"
 		"\n CREATE INDEX IF NOT EXISTS crc32 ON roms (crc32);"
 		"\n INSERT OR IGNORE INTO version (tname, version) VALUES ('version', 1);"
 		"\n INSERT OR IGNORE INTO version (tname, version) VALUES ('roots', 1);"
 		"\n INSERT OR IGNORE INTO version (tname, version) VALUES ('roms', 1);"
-		"\n INSERT OR IGNORE INTO version (tname, version) VALUES ('paths', 1);";
+		"\n INSERT OR IGNORE INTO version (tname, version) VALUES ('paths', 1);"
+		"\n INSERT OR IGNORE INTO version (tname, version) VALUES ('idleLoops', 1);";
 	if (sqlite3_exec(library->db, createTables, NULL, NULL, NULL)) {
 		goto error;
 	}
 
-	static const char insertPath[] = "INSERT INTO paths (romid, path, customTitle, rootid) VALUES (?, ?, ?, ?);";
+	static const char insertPath[] = "INSERT OR REPLACE INTO paths (romid, path, customTitle, rootid, mtime) VALUES (?, ?, ?, ?, ?);";
 	if (sqlite3_prepare_v2(library->db, insertPath, -1, &library->insertPath, NULL)) {
 		goto error;
 	}
@@ -166,7 +230,7 @@ struct mLibrary* mLibraryLoad(const char* path) {
 		goto error;
 	}
 
-	static const char deletePath[] = "DELETE FROM paths WHERE path = ?;";
+	static const char deletePath[] = "DELETE FROM paths WHERE path = ? AND rootid = (SELECT rootid FROM roots WHERE path = ?);";
 	if (sqlite3_prepare_v2(library->db, deletePath, -1, &library->deletePath, NULL)) {
 		goto error;
 	}
@@ -176,11 +240,21 @@ struct mLibrary* mLibraryLoad(const char* path) {
 		goto error;
 	}
 
-	static const char selectRoot[] = "SELECT rootid FROM roots WHERE path = ? AND CASE WHEN :useMtime THEN mtime <= :mtime ELSE 1 END;";
+	static const char selectRoot[] = "SELECT rootid, mtime FROM roots WHERE path = ? AND CASE WHEN :useMtime THEN mtime <= :mtime ELSE 1 END;";
 	if (sqlite3_prepare_v2(library->db, selectRoot, -1, &library->selectRoot, NULL)) {
 		goto error;
 	}
 
+	static const char selectPaths[] = "SELECT paths.path, paths.mtime, roms.size FROM paths JOIN roots USING (rootid) JOIN roms USING (romid) WHERE roots.path = ?;";
+	if (sqlite3_prepare_v2(library->db, selectPaths, -1, &library->selectPaths, NULL)) {
+		goto error;
+	}
+
+	static const char updateRootMtime[] = "UPDATE roots SET mtime = ? WHERE path = ?;";
+	if (sqlite3_prepare_v2(library->db, updateRootMtime, -1, &library->updateRootMtime, NULL)) {
+		goto error;
+	}
+
 	static const char count[] = "SELECT count(pathid) FROM paths JOIN roots USING (rootid) JOIN roms USING (romid) WHERE " CONSTRAINTS ";";
 	if (sqlite3_prepare_v2(library->db, count, -1, &library->count, NULL)) {
 		goto error;
@@ -191,6 +265,21 @@ struct mLibrary* mLibraryLoad(const char* path) {
 		goto error;
 	}
 
+	static const char selectIdleLoop[] = "SELECT internalCode, address, confidence FROM idleLoops WHERE crc32 = ? AND platform = ?;";
+	if (sqlite3_prepare_v2(library->db, selectIdleLoop, -1, &library->selectIdleLoop, NULL)) {
+		goto error;
+	}
+
+	static const char insertIdleLoop[] = "INSERT OR REPLACE INTO idleLoops (crc32, platform, internalCode, address, confidence) VALUES (?, ?, ?, ?, ?);";
+	if (sqlite3_prepare_v2(library->db, insertIdleLoop, -1, &library->insertIdleLoop, NULL)) {
+		goto error;
+	}
+
+	static const char selectIdleLoops[] = "SELECT crc32, platform, internalCode, address, confidence FROM idleLoops WHERE confidence >= ? ORDER BY internalCode, crc32;";
+	if (sqlite3_prepare_v2(library->db, selectIdleLoops, -1, &library->selectIdleLoops, NULL)) {
+		goto error;
+	}
+
 	return library;
 
 error:
@@ -210,102 +299,350 @@ void mLibraryDestroy(struct mLibrary* library) {
 	sqlite3_finalize(library->deleteRoot);
 	sqlite3_finalize(library->selectRom);
 	sqlite3_finalize(library->selectRoot);
+	sqlite3_finalize(library->selectPaths);
+	sqlite3_finalize(library->updateRootMtime);
 	sqlite3_finalize(library->select);
 	sqlite3_finalize(library->count);
+	sqlite3_finalize(library->selectIdleLoop);
+	sqlite3_finalize(library->insertIdleLoop);
+	sqlite3_finalize(library->selectIdleLoops);
 	sqlite3_close(library->db);
 	free(library);
 }
 
-void mLibraryLoadDirectory(struct mLibrary* library, const char* base, bool recursive) {
+static bool _mLibraryStat(const char* path, int64_t* mtime, int64_t* size) {
+#ifdef _WIN32
+	wchar_t wpath[PATH_MAX];
+	MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, PATH_MAX);
+	struct _stat64 info;
+	if (_wstat64(wpath, &info) < 0) {
+		return false;
+	}
+#else
+	struct stat info;
+	if (stat(path, &info) < 0) {
+		return false;
+	}
+#endif
+	*mtime = info.st_mtime;
+	if (size) {
+		*size = info.st_size;
+	}
+	return true;
+}
+
+static sqlite3_int64 _mLibraryGetRoot(struct mLibrary* library, const char* base, int64_t* mtime) {
+	sqlite3_clear_bindings(library->selectRoot);
+	sqlite3_reset(library->selectRoot);
+	sqlite3_bind_text(library->selectRoot, 1, base, -1, SQLITE_TRANSIENT);
+	if (sqlite3_step(library->selectRoot) != SQLITE_ROW) {
+		return 0;
+	}
+	if (mtime) {
+		*mtime = sqlite3_column_int64(library->selectRoot, 1);
+	}
+	return sqlite3_column_int64(library->selectRoot, 0);
+}
+
+static bool _mLibraryRootIsCurrent(struct mLibrary* library, const char* base, int64_t mtime) {
+	int64_t knownMtime = 0;
+	return mtime && _mLibraryGetRoot(library, base, &knownMtime) && knownMtime == mtime;
+}
+
+static void _mLibraryGetKnownPaths(struct mLibrary* library, const char* base, struct Table* known) {
+	sqlite3_clear_bindings(library->selectPaths);
+	sqlite3_reset(library->selectPaths);
+	sqlite3_bind_text(library->selectPaths, 1, base, -1, SQLITE_TRANSIENT);
+	while (sqlite3_step(library->selectPaths) == SQLITE_ROW) {
+		struct mLibraryKnownPath* path = calloc(1, sizeof(*path));
+		path->mtime = sqlite3_column_int64(library->selectPaths, 1);
+		path->size = sqlite3_column_int64(library->selectPaths, 2);
+		HashTableInsert(known, (const char*) sqlite3_column_text(library->selectPaths, 0), path);
+	}
+}
+
+struct mLibraryUnseenContext {
+	struct mLibrary* library;
+	const char* base;
+};
+
+static void _mLibraryDeleteUnseen(const char* key, void* value, void* user) {
+	struct mLibraryKnownPath* path = value;
+	struct mLibraryUnseenContext* context = user;
+	if (!path->seen) {
+		_mLibraryDeletePath(context->library, context->base, key);
+	}
+}
+
+static void _mLibraryIdentify(struct mLibraryScanJob* job) {
+	struct VFile* vf = job->vf;
+	job->vf = NULL;
+	if (!vf) {
+		char path[PATH_MAX];
+		snprintf(path, sizeof(path), "%s" PATH_SEP "%s", job->base, job->filename);
+		vf = VFileOpen(path, O_RDONLY);
+	}
+	if (!vf) {
+		return;
+	}
+	struct mCore* core = mCoreFindVF(vf);
+	if (!core) {
+		vf->close(vf);
+		return;
+	}
+	core->init(core);
+	core->loadROM(core, vf);
+
+	core->getGameTitle(core, job->entry.internalTitle);
+	core->getGameCode(core, job->entry.internalCode);
+	core->checksum(core, &job->entry.crc32, mCHECKSUM_CRC32);
+	job->entry.platform = core->platform(core);
+	job->entry.filesize = vf->size(vf);
+	job->found = true;
+	// Note: this destroys the VFile
+	core->deinit(core);
+}
+
+static void _mLibraryScanCommit(struct mLibraryScan* scan, struct mLibraryScanJob* job) {
+	if (job->found) {
+		job->entry.base = job->base;
+		job->entry.filename = job->filename;
+		_mLibraryInsertEntry(scan->library, &job->entry, job->mtime);
+	} else {
+		// This may have been a ROM the last time around
+		_mLibraryDeletePath(scan->library, job->base, job->filename);
+		if (job->tryArchive && job->filename[0] != '.') {
+			char newBase[PATH_MAX];
+			snprintf(newBase, sizeof(newBase), "%s" PATH_SEP "%s", job->base, job->filename);
+			_mLibraryScanDirectory(scan, newBase, true); // This will add as an archive
+		}
+	}
+	free(job->base);
+	free(job->filename);
+	free(job);
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _mLibraryScanWorker(void* context) {
+	struct mLibraryScan* scan = context;
+	ThreadSetName("Library Scanner");
+
+	MutexLock(&scan->mutex);
+	while (true) {
+		while (!mLibraryScanJobListSize(&scan->pending) && !scan->quit) {
+			ConditionWait(&scan->workCond, &scan->mutex);
+		}
+		if (!mLibraryScanJobListSize(&scan->pending)) {
+			// Some platforms only wake one waiter at a time, so pass the wakeup along
+			ConditionWake(&scan->workCond);
+			break;
+		}
+		struct mLibraryScanJob* job = *mLibraryScanJobListGetPointer(&scan->pending, mLibraryScanJobListSize(&scan->pending) - 1);
+		mLibraryScanJobListResize(&scan->pending, -1);
+		if (mLibraryScanJobListSize(&scan->pending)) {
+			ConditionWake(&scan->workCond);
+		}
+		MutexUnlock(&scan->mutex);
+
+		_mLibraryIdentify(job);
+
+		MutexLock(&scan->mutex);
+		*mLibraryScanJobListAppend(&scan->done) = job;
+		ConditionWake(&scan->doneCond);
+	}
+	MutexUnlock(&scan->mutex);
+	THREAD_EXIT(0);
+}
+
+static void _mLibraryScanDrain(struct mLibraryScan* scan, bool wait) {
+	struct mLibraryScanJobList done;
+	mLibraryScanJobListInit(&done, 0);
+	MutexLock(&scan->mutex);
+	while (wait && scan->inFlight && !mLibraryScanJobListSize(&scan->done)) {
+		ConditionWait(&scan->doneCond, &scan->mutex);
+	}
+	struct mLibraryScanJobList swap = scan->done;
+	scan->done = done;
+	done = swap;
+	scan->inFlight -= mLibraryScanJobListSize(&done);
+	MutexUnlock(&scan->mutex);
+
+	// Only this thread touches the database, so results are written as they trickle in
+	size_t i;
+	for (i = 0; i < mLibraryScanJobListSize(&done); ++i) {
+		_mLibraryScanCommit(scan, *mLibraryScanJobListGetPointer(&done, i));
+	}
+	mLibraryScanJobListDeinit(&done);
+}
+#endif
+
+static void _mLibraryScanSubmit(struct mLibraryScan* scan, struct mLibraryScanJob* job) {
+#ifndef DISABLE_THREADING
+	MutexLock(&scan->mutex);
+	*mLibraryScanJobListAppend(&scan->pending) = job;
+	++scan->inFlight;
+	bool full = scan->inFlight >= LIBRARY_SCAN_MAX_IN_FLIGHT;
+	ConditionWake(&scan->workCond);
+	MutexUnlock(&scan->mutex);
+	_mLibraryScanDrain(scan, full);
+#else
+	_mLibraryIdentify(job);
+	_mLibraryScanCommit(scan, job);
+#endif
+}
+
+static struct VFile* _mLibraryReadArchiveFile(struct VDir* dir, const char* name) {
+	struct VFile* vf = dir->openFile(dir, name, O_RDONLY);
+	if (!vf) {
+		return NULL;
+	}
+	struct VFile* vfclone = VFileMemChunk(NULL, vf->size(vf));
+	uint8_t buffer[2048];
+	ssize_t read;
+	while ((read = vf->read(vf, buffer, sizeof(buffer))) > 0) {
+		vfclone->write(vfclone, buffer, read);
+	}
+	vf->close(vf);
+	vfclone->seek(vfclone, 0, SEEK_SET);
+	return vfclone;
+}
+
+static void _mLibraryScanDirectory(struct mLibraryScan* scan, const char* base, bool recursive) {
+	struct mLibrary* library = scan->library;
 	struct VDir* dir = VDirOpenArchive(base);
+	bool isArchive = true;
 	if (!dir) {
 		dir = VDirOpen(base);
+		isArchive = false;
 	}
-	sqlite3_exec(library->db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
 	if (!dir) {
 		sqlite3_clear_bindings(library->deleteRoot);
 		sqlite3_reset(library->deleteRoot);
 		sqlite3_bind_text(library->deleteRoot, 1, base, -1, SQLITE_TRANSIENT);
 		sqlite3_step(library->deleteRoot);
-		sqlite3_exec(library->db, "COMMIT;", NULL, NULL, NULL);
 		return;
 	}
 
-	struct mLibraryEntry entry;
-	memset(&entry, 0, sizeof(entry));
-	entry.base = base;
-	struct mLibraryListing entries;
-	mLibraryListingInit(&entries, 0);
-	mLibraryGetEntries(library, &entries, 0, 0, &entry);
-	size_t i;
-	for (i = 0; i < mLibraryListingSize(&entries); ++i) {
-		struct mLibraryEntry* current = mLibraryListingGetPointer(&entries, i);
-		struct VFile* vf = dir->openFile(dir, current->filename, O_RDONLY);
-		_mLibraryDeleteEntry(library, current);
-		if (!vf) {
-			mLibraryEntryFree(current);
-			continue;
+	// Archives are rescanned as a whole, and only if the archive itself changed
+	int64_t baseMtime = 0;
+	if (isArchive) {
+		_mLibraryStat(base, &baseMtime, NULL);
+		if (_mLibraryRootIsCurrent(library, base, baseMtime)) {
+			dir->close(dir);
+			return;
 		}
-		_mLibraryAddEntry(library, current->filename, base, vf);
-		mLibraryEntryFree(current);
 	}
-	mLibraryListingDeinit(&entries);
 
-	dir->rewind(dir);
-	struct VDirEntry* dirent = dir->listNext(dir);
-	while (dirent) {
-		const char* name = dirent->name(dirent);
-		struct VFile* vf = dir->openFile(dir, name, O_RDONLY);
-		bool wasAdded = false;
+	struct Table known;
+	HashTableInit(&known, 0, free);
+	_mLibraryGetKnownPaths(library, base, &known);
 
-		if (vf) {
-			wasAdded = _mLibraryAddEntry(library, name, base, vf);
+	struct VDirEntry* dirent;
+	while ((dirent = dir->listNext(dir))) {
+		const char* name = dirent->name(dirent);
+		enum VFSType type = dirent->type(dirent);
+		struct mLibraryKnownPath* knownPath = HashTableLookup(&known, name);
+		if (knownPath) {
+			knownPath->seen = true;
+		}
+		if (type == VFS_DIRECTORY) {
+			if (recursive && name[0] != '.') {
+				char newBase[PATH_MAX];
+				snprintf(newBase, sizeof(newBase), "%s" PATH_SEP "%s", base, name);
+				_mLibraryScanDirectory(scan, newBase, recursive);
+			}
+			continue;
 		}
-		if (!wasAdded && name[0] != '.') {
-			char newBase[PATH_MAX];
-			snprintf(newBase, sizeof(newBase), "%s" PATH_SEP "%s", base, name);
 
-			if (recursive) {
-				mLibraryLoadDirectory(library, newBase, recursive);
-			} else if (dirent->type(dirent) == VFS_FILE) {
-				mLibraryLoadDirectory(library, newBase, true); // This will add as an archive
+		int64_t mtime = baseMtime;
+		int64_t size = -1;
+		if (!isArchive) {
+			char path[PATH_MAX];
+			snprintf(path, sizeof(path), "%s" PATH_SEP "%s", base, name);
+			_mLibraryStat(path, &mtime, &size);
+			if (!knownPath && _mLibraryRootIsCurrent(library, path, mtime)) {
+				continue;
 			}
 		}
-		dirent = dir->listNext(dir);
+		if (knownPath && mtime && knownPath->mtime == mtime && (size < 0 || (uint64_t) knownPath->size == (uint64_t) size)) {
+			continue;
+		}
+
+		struct mLibraryScanJob* job = calloc(1, sizeof(*job));
+		job->base = strdup(base);
+		job->filename = strdup(name);
+		job->mtime = mtime;
+		job->tryArchive = recursive || type == VFS_FILE;
+		if (isArchive) {
+			job->vf = _mLibraryReadArchiveFile(dir, name);
+		}
+		_mLibraryScanSubmit(scan, job);
 	}
 	dir->close(dir);
-	sqlite3_exec(library->db, "COMMIT;", NULL, NULL, NULL);
-}
 
-bool _mLibraryAddEntry(struct mLibrary* library, const char* filename, const char* base, struct VFile* vf) {
-	if (!vf) {
-		return false;
+	// Anything that was indexed before but is no longer here has been removed
+	struct mLibraryUnseenContext unseen = {
+		.library = library,
+		.base = base,
+	};
+	HashTableEnumerate(&known, _mLibraryDeleteUnseen, &unseen);
+	HashTableDeinit(&known);
+
+	if (isArchive && baseMtime) {
+		if (!_mLibraryGetRoot(library, base, NULL)) {
+			sqlite3_clear_bindings(library->insertRoot);
+			sqlite3_reset(library->insertRoot);
+			sqlite3_bind_text(library->insertRoot, 1, base, -1, SQLITE_TRANSIENT);
+			sqlite3_step(library->insertRoot);
+		}
+		sqlite3_clear_bindings(library->updateRootMtime);
+		sqlite3_reset(library->updateRootMtime);
+		sqlite3_bind_int64(library->updateRootMtime, 1, baseMtime);
+		sqlite3_bind_text(library->updateRootMtime, 2, base, -1, SQLITE_TRANSIENT);
+		sqlite3_step(library->updateRootMtime);
 	}
-	struct mCore* core = mCoreFindVF(vf);
-	if (!core) {
-		vf->close(vf);
-		return false;
+}
+
+void mLibraryLoadDirectory(struct mLibrary* library, const char* base, bool recursive) {
+	struct mLibraryScan scan = {
+		.library = library,
+	};
+	mLibraryScanJobListInit(&scan.pending, 0);
+	mLibraryScanJobListInit(&scan.done, 0);
+#ifndef DISABLE_THREADING
+	MutexInit(&scan.mutex);
+	ConditionInit(&scan.workCond);
+	ConditionInit(&scan.doneCond);
+	size_t i;
+	for (i = 0; i < LIBRARY_SCAN_WORKERS; ++i) {
+		ThreadCreate(&scan.workers[i], _mLibraryScanWorker, &scan);
 	}
-	struct mLibraryEntry entry;
-	memset(&entry, 0, sizeof(entry));
-	core->init(core);
-	core->loadROM(core, vf);
+#endif
 
-	core->getGameTitle(core, entry.internalTitle);
-	core->getGameCode(core, entry.internalCode);
-	core->checksum(core, &entry.crc32, mCHECKSUM_CRC32);
-	entry.platform = core->platform(core);
-	entry.title = NULL;
-	entry.base = base;
-	entry.filename = filename;
-	entry.filesize = vf->size(vf);
-	_mLibraryInsertEntry(library, &entry);
-	// Note: this destroys the VFile
-	core->deinit(core);
-	return true;
+	// The whole scan, including subdirectories and archives, is batched into one transaction
+	sqlite3_exec(library->db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+	_mLibraryScanDirectory(&scan, base, recursive);
+#ifndef DISABLE_THREADING
+	while (scan.inFlight) {
+		_mLibraryScanDrain(&scan, true);
+	}
+	MutexLock(&scan.mutex);
+	scan.quit = true;
+	ConditionWake(&scan.workCond);
+	MutexUnlock(&scan.mutex);
+	for (i = 0; i < LIBRARY_SCAN_WORKERS; ++i) {
+		ThreadJoin(&scan.workers[i]);
+	}
+	MutexDeinit(&scan.mutex);
+	ConditionDeinit(&scan.workCond);
+	ConditionDeinit(&scan.doneCond);
+#endif
+	sqlite3_exec(library->db, "COMMIT;", NULL, NULL, NULL);
+	mLibraryScanJobListDeinit(&scan.pending);
+	mLibraryScanJobListDeinit(&scan.done);
 }
 
-static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry* entry) {
+static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry* entry, int64_t mtime) {
 	sqlite3_clear_bindings(library->selectRom);
 	sqlite3_reset(library->selectRom);
 	struct mLibraryEntry constraints = *entry;
@@ -325,17 +662,13 @@ static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry*
 
 	sqlite3_int64 rootId = 0;
 	if (entry->base) {
-		sqlite3_clear_bindings(library->selectRoot);
-		sqlite3_reset(library->selectRoot);
-		sqlite3_bind_text(library->selectRoot, 1, entry->base, -1, SQLITE_TRANSIENT);
-		if (sqlite3_step(library->selectRoot) == SQLITE_DONE) {
+		rootId = _mLibraryGetRoot(library, entry->base, NULL);
+		if (!rootId) {
 			sqlite3_clear_bindings(library->insertRoot);
 			sqlite3_reset(library->insertRoot);
 			sqlite3_bind_text(library->insertRoot, 1, entry->base, -1, SQLITE_TRANSIENT);
 			sqlite3_step(library->insertRoot);
 			rootId = sqlite3_last_insert_rowid(library->db);
-		} else {
-			rootId = sqlite3_column_int64(library->selectRoot, 0);
 		}
 	}
 
@@ -347,14 +680,16 @@ static void _mLibraryInsertEntry(struct mLibrary* library, struct mLibraryEntry*
 	if (rootId > 0) {
 		sqlite3_bind_int64(library->insertPath, 4, rootId);
 	}
+	sqlite3_bind_int64(library->insertPath, 5, mtime);
 	sqlite3_step(library->insertPath);
 }
 
-static void _mLibraryDeleteEntry(struct mLibrary* library, struct mLibraryEntry* entry) {
+static void _mLibraryDeletePath(struct mLibrary* library, const char* base, const char* filename) {
 	sqlite3_clear_bindings(library->deletePath);
 	sqlite3_reset(library->deletePath);
-	sqlite3_bind_text(library->deletePath, 1, entry->filename, -1, SQLITE_TRANSIENT);
-	sqlite3_step(library->insertPath);
+	sqlite3_bind_text(library->deletePath, 1, filename, -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text(library->deletePath, 2, base, -1, SQLITE_TRANSIENT);
+	sqlite3_step(library->deletePath);
 }
 
 void mLibraryClear(struct mLibrary* library) {
@@ -377,6 +712,11 @@ size_t mLibraryCount(struct mLibrary* library, const struct mLibraryEntry* const
 	return sqlite3_column_int64(library->count, 0);
 }
 
+static void _setEntryTitle(size_t index, const struct NoIntroGame* game, void* context) {
+	struct mLibraryListing* listing = context;
+	mLibraryListingGetPointer(listing, index)->title = strdup(game->name);
+}
+
 size_t mLibraryGetEntries(struct mLibrary* library, struct mLibraryListing* out, size_t numEntries, size_t offset, const struct mLibraryEntry* constraints) {
 	mLibraryListingClear(out); // TODO: Free memory
 	sqlite3_clear_bindings(library->select);
@@ -401,10 +741,6 @@ size_t mLibraryGetEntries(struct mLibrary* library, struct mLibraryListing* out,
 			const char* colName = sqlite3_column_name(library->select, i);
 			if (strcmp(colName, "crc32") == 0) {
 				entry->crc32 = sqlite3_column_int(library->select, i);
-				struct NoIntroGame game;
-				if (NoIntroDBLookupGameByCRC(library->gameDB, entry->crc32, &game)) {
-					entry->title = strdup(game.name);
-				}
 			} else if (strcmp(colName, "platform") == 0) {
 				entry->platform = sqlite3_column_int(library->select, i);
 			} else if (strcmp(colName, "size") == 0) {
@@ -420,7 +756,18 @@ size_t mLibraryGetEntries(struct mLibrary* library, struct mLibraryListing* out,
 			}
 		}
 	}
-	return mLibraryListingSize(out);
+
+	size_t nEntries = mLibraryListingSize(out);
+	if (library->gameDB && nEntries) {
+		// Titles for the whole page come from one query instead of one per entry
+		uint32_t* crc32s = calloc(nEntries, sizeof(*crc32s));
+		for (entryIndex = 0; entryIndex < nEntries; ++entryIndex) {
+			crc32s[entryIndex] = mLibraryListingGetPointer(out, entryIndex)->crc32;
+		}
+		NoIntroDBLookupGamesByCRC(library->gameDB, crc32s, nEntries, _setEntryTitle, out);
+		free(crc32s);
+	}
+	return nEntries;
 }
 
 void mLibraryEntryFree(struct mLibraryEntry* entry) {
@@ -473,6 +820,61 @@ struct VFile* mLibraryOpenVFile(struct mLibrary* library, const struct mLibraryE
 	return vf;
 }
 
+static void _readIdleLoop(sqlite3_stmt* statement, int column, struct mLibraryIdleLoop* loop) {
+	memset(loop->internalCode, 0, sizeof(loop->internalCode));
+	if (sqlite3_column_type(statement, column) == SQLITE_TEXT) {
+		strncpy(loop->internalCode, (const char*) sqlite3_column_text(statement, column), sizeof(loop->internalCode) - 1);
+	}
+	loop->address = sqlite3_column_int64(statement, column + 1);
+	loop->confidence = sqlite3_column_int(statement, column + 2);
+}
+
+bool mLibraryFindIdleLoop(struct mLibrary* library, enum mPlatform platform, uint32_t crc32, struct mLibraryIdleLoop* out) {
+	sqlite3_clear_bindings(library->selectIdleLoop);
+	sqlite3_reset(library->selectIdleLoop);
+	sqlite3_bind_int64(library->selectIdleLoop, 1, crc32);
+	sqlite3_bind_int(library->selectIdleLoop, 2, platform);
+	if (sqlite3_step(library->selectIdleLoop) != SQLITE_ROW) {
+		return false;
+	}
+	out->crc32 = crc32;
+	out->platform = platform;
+	_readIdleLoop(library->selectIdleLoop, 0, out);
+	return true;
+}
+
+void mLibraryAddIdleLoop(struct mLibrary* library, const struct mLibraryIdleLoop* loop) {
+	unsigned confidence = 1;
+	struct mLibraryIdleLoop old;
+	if (mLibraryFindIdleLoop(library, loop->platform, loop->crc32, &old) && old.address == loop->address) {
+		confidence = old.confidence + 1;
+	}
+	sqlite3_clear_bindings(library->insertIdleLoop);
+	sqlite3_reset(library->insertIdleLoop);
+	sqlite3_bind_int64(library->insertIdleLoop, 1, loop->crc32);
+	sqlite3_bind_int(library->insertIdleLoop, 2, loop->platform);
+	if (loop->internalCode[0]) {
+		sqlite3_bind_text(library->insertIdleLoop, 3, loop->internalCode, -1, SQLITE_TRANSIENT);
+	}
+	sqlite3_bind_int64(library->insertIdleLoop, 4, loop->address);
+	sqlite3_bind_int(library->insertIdleLoop, 5, confidence);
+	sqlite3_step(library->insertIdleLoop);
+}
+
+size_t mLibraryGetIdleLoops(struct mLibrary* library, struct mLibraryIdleLoopList* out, unsigned minConfidence) {
+	mLibraryIdleLoopListClear(out);
+	sqlite3_clear_bindings(library->selectIdleLoops);
+	sqlite3_reset(library->selectIdleLoops);
+	sqlite3_bind_int(library->selectIdleLoops, 1, minConfidence);
+	while (sqlite3_step(library->selectIdleLoops) == SQLITE_ROW) {
+		struct mLibraryIdleLoop* loop = mLibraryIdleLoopListAppend(out);
+		loop->crc32 = sqlite3_column_int64(library->selectIdleLoops, 0);
+		loop->platform = sqlite3_column_int(library->selectIdleLoops, 1);
+		_readIdleLoop(library->selectIdleLoops, 2, loop);
+	}
+	return mLibraryIdleLoopListSize(out);
+}
+
 void mLibraryAttachGameDB(struct mLibrary* library, const struct NoIntroDB* db) {
 	library->gameDB = db;
 }
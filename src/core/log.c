@@ -9,7 +9,7 @@
 #include <mgba/core/thread.h>
 #include <mgba-util/vfs.h>
 
-#define MAX_CATEGORY 64
+#define MAX_CATEGORY mLOG_MAX_CATEGORIES
 #define MAX_LOG_BUF 1024
 
 static struct mLogger* _defaultLogger = NULL;
@@ -82,6 +82,14 @@ void mLog(int category, enum mLogLevel level, const char* format, ...) {
 	va_end(args);
 }
 
+bool mLogWillLog(int category, enum mLogLevel level) {
+	struct mLogger* context = mLogGetContext();
+	if (!context || !context->filter) {
+		return true;
+	}
+	return mLogFilterTest(context->filter, category, level);
+}
+
 void mLogExplicit(struct mLogger* context, int category, enum mLogLevel level, const char* format, ...) {
 	va_list args;
 	va_start(args, format);
@@ -91,9 +99,31 @@ void mLogExplicit(struct mLogger* context, int category, enum mLogLevel level, c
 	va_end(args);
 }
 
+static int _mLogFilterLookup(const struct mLogFilter* filter, int category) {
+	int value = (intptr_t) TableLookup(&filter->levels, category);
+	if (value) {
+		return value;
+	}
+	const char* cat = mLogCategoryId(category);
+	if (cat) {
+		value = (intptr_t) HashTableLookup(&filter->categories, cat);
+	}
+	return value;
+}
+
+static void _mLogFilterRebuild(struct mLogFilter* filter) {
+	int categories = _category < MAX_CATEGORY ? _category : MAX_CATEGORY;
+	int i;
+	for (i = 0; i < categories; ++i) {
+		filter->cachedLevels[i] = _mLogFilterLookup(filter, i);
+	}
+	filter->cachedCategories = categories;
+}
+
 void mLogFilterInit(struct mLogFilter* filter) {
 	HashTableInit(&filter->categories, 8, NULL);
 	TableInit(&filter->levels, 8, NULL);
+	filter->cachedCategories = 0;
 }
 
 void mLogFilterDeinit(struct mLogFilter* filter) {
@@ -130,6 +160,7 @@ void mLogFilterLoad(struct mLogFilter* filter, const struct mCoreConfig* config)
 	mCoreConfigEnumerate(config, "logLevel.", _setFilterLevel, filter);
 	filter->defaultLevels = mLOG_ALL;
 	mCoreConfigGetIntValue(config, "logLevel", &filter->defaultLevels);
+	_mLogFilterRebuild(filter);
 }
 
 void mLogFilterSave(const struct mLogFilter* filter, struct mCoreConfig* config) {
@@ -155,6 +186,7 @@ void mLogFilterSet(struct mLogFilter* filter, const char* category, int levels)
 	if (cat >= 0) {
 		TableInsert(&filter->levels, cat, (void*)(intptr_t) levels);
 	}
+	_mLogFilterRebuild(filter);
 }
 
 void mLogFilterReset(struct mLogFilter* filter, const char* category) {
@@ -164,6 +196,7 @@ void mLogFilterReset(struct mLogFilter* filter, const char* category) {
 	if (cat >= 0) {
 		TableRemove(&filter->levels, cat);
 	}
+	_mLogFilterRebuild(filter);
 }
 
 bool mLogFilterTest(const struct mLogFilter* filter, int category, enum mLogLevel level) {
@@ -175,15 +208,11 @@ bool mLogFilterTest(const struct mLogFilter* filter, int category, enum mLogLeve
 }
 
 int mLogFilterLevels(const struct mLogFilter* filter , int category) {
-	int value = (intptr_t) TableLookup(&filter->levels, category);
-	if (value) {
-		return value;
-	}
-	const char* cat = mLogCategoryId(category);
-	if (cat) {
-		value = (intptr_t) HashTableLookup(&filter->categories, cat);
+	if (category >= 0 && category < filter->cachedCategories) {
+		return filter->cachedLevels[category];
 	}
-	return value;
+	// Categories registered after the last change haven't been flattened yet
+	return _mLogFilterLookup(filter, category);
 }
 
 void _mCoreStandardLog(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args) {
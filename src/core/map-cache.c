@@ -87,6 +87,33 @@ void mMapCacheWriteVRAM(struct mMapCache* cache, uint32_t address) {
 	}
 }
 
+void mMapCacheWriteVRAMRange(struct mMapCache* cache, uint32_t address, uint32_t length) {
+	uint32_t end = address + length;
+	if (address < cache->mapStart) {
+		address = cache->mapStart;
+	}
+	if (end > cache->mapStart + cache->mapSize) {
+		end = cache->mapStart + cache->mapSize;
+	}
+	if (address >= end) {
+		return;
+	}
+	unsigned mapAlign = mMapCacheSystemInfoGetMapAlign(cache->sysConfig);
+	uint32_t align = 1 << (mMapCacheSystemInfoGetWriteAlign(cache->sysConfig) - mapAlign);
+	uint32_t entry = (address - cache->mapStart) >> mapAlign;
+	// Each write dirties a whole write-aligned group of entries, just like mMapCacheWriteVRAM
+	uint32_t last = ((end - 1 - cache->mapStart) >> mapAlign) + align;
+	if (last > cache->mapSize >> mapAlign) {
+		last = cache->mapSize >> mapAlign;
+	}
+	for (; entry < last; ++entry) {
+		struct mMapCacheEntry* status = &cache->status[entry];
+		++status->vramVersion;
+		status->flags = mMapCacheEntryFlagsClearVramClean(status->flags);
+		status->tileStatus[mMapCacheEntryFlagsGetPaletteId(status->flags)].vramClean = 0;
+	}
+}
+
 static inline void _cleanTile(struct mMapCache* cache, const color_t* tile, color_t* mapOut, const struct mMapCacheEntry* status) {
 	size_t stride = 8 << mMapCacheSystemInfoGetTilesWide(cache->sysConfig);
 	int x, y;
@@ -8,7 +8,19 @@
 #include <mgba/core/core.h>
 #include <mgba/core/interface.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SEARCH_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SEARCH_NEON
+#endif
+
+#define SEARCH_CHUNK_SIZE 0x10000
+#define SEARCH_REPEAT_BATCH 0x400
+
 DEFINE_VECTOR(mCoreMemorySearchResults, struct mCoreMemorySearchResult);
+DEFINE_VECTOR(mCoreMemorySearchSnapshotBlocks, struct mCoreMemorySearchSnapshotBlock);
 
 static bool _op(int32_t value, int32_t match, enum mCoreMemorySearchOp op) {
 	switch (op) {
@@ -31,6 +43,48 @@ static bool _op(int32_t value, int32_t match, enum mCoreMemorySearchOp op) {
 	return false;
 }
 
+#if defined(SEARCH_SSE2) || defined(SEARCH_NEON)
+#define SEARCH_VECTOR_SIZE 16
+
+// Whether any element of the given width in the 16 bytes at mem equals value. Exact-value
+// searches use this to skip past whole vectors that can't contain a match.
+static bool _vectorHasMatch(const void* mem, uint32_t value, int width) {
+#ifdef SEARCH_SSE2
+	__m128i data = _mm_loadu_si128((const __m128i*) mem);
+	__m128i match;
+	switch (width) {
+	case 1:
+		match = _mm_cmpeq_epi8(data, _mm_set1_epi8(value));
+		break;
+	case 2:
+		match = _mm_cmpeq_epi16(data, _mm_set1_epi16(value));
+		break;
+	case 4:
+	default:
+		match = _mm_cmpeq_epi32(data, _mm_set1_epi32(value));
+		break;
+	}
+	return _mm_movemask_epi8(match);
+#else
+	uint8x16_t data = vld1q_u8(mem);
+	uint64x2_t match;
+	switch (width) {
+	case 1:
+		match = vreinterpretq_u64_u8(vceqq_u8(data, vdupq_n_u8(value)));
+		break;
+	case 2:
+		match = vreinterpretq_u64_u16(vceqq_u16(vreinterpretq_u16_u8(data), vdupq_n_u16(value)));
+		break;
+	case 4:
+	default:
+		match = vreinterpretq_u64_u32(vceqq_u32(vreinterpretq_u32_u8(data), vdupq_n_u32(value)));
+		break;
+	}
+	return vgetq_lane_u64(match, 0) | vgetq_lane_u64(match, 1);
+#endif
+}
+#endif
+
 static size_t _search32(const void* mem, size_t size, const struct mCoreMemoryBlock* block, uint32_t value32, enum mCoreMemorySearchOp op, struct mCoreMemorySearchResults* out, size_t limit) {
 	const uint32_t* mem32 = mem;
 	size_t found = 0;
@@ -39,6 +93,12 @@ static size_t _search32(const void* mem, size_t size, const struct mCoreMemoryBl
 	size_t i;
 	// TODO: Big endian
 	for (i = 0; (!limit || found < limit) && i < end; i += 4) {
+#ifdef SEARCH_VECTOR_SIZE
+		if (op == mCORE_MEMORY_SEARCH_EQUAL && !(i & (SEARCH_VECTOR_SIZE - 1)) && i + SEARCH_VECTOR_SIZE <= end && !_vectorHasMatch(&mem32[i >> 2], value32, 4)) {
+			i += SEARCH_VECTOR_SIZE - 4;
+			continue;
+		}
+#endif
 		if (_op(mem32[i >> 2], value32, op)) {
 			struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsAppend(out);
 			res->address = start + i;
@@ -62,6 +122,12 @@ static size_t _search16(const void* mem, size_t size, const struct mCoreMemoryBl
 	size_t i;
 	// TODO: Big endian
 	for (i = 0; (!limit || found < limit) && i < end; i += 2) {
+#ifdef SEARCH_VECTOR_SIZE
+		if (op == mCORE_MEMORY_SEARCH_EQUAL && !(i & (SEARCH_VECTOR_SIZE - 1)) && i + SEARCH_VECTOR_SIZE <= end && !_vectorHasMatch(&mem16[i >> 1], value16, 2)) {
+			i += SEARCH_VECTOR_SIZE - 2;
+			continue;
+		}
+#endif
 		if (_op(mem16[i >> 1], value16, op)) {
 			struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsAppend(out);
 			res->address = start + i;
@@ -84,6 +150,12 @@ static size_t _search8(const void* mem, size_t size, const struct mCoreMemoryBlo
 	uint32_t end = size; // TODO: Segments
 	size_t i;
 	for (i = 0; (!limit || found < limit) && i < end; ++i) {
+#ifdef SEARCH_VECTOR_SIZE
+		if (op == mCORE_MEMORY_SEARCH_EQUAL && !(i & (SEARCH_VECTOR_SIZE - 1)) && i + SEARCH_VECTOR_SIZE <= end && !_vectorHasMatch(&mem8[i], value8, 1)) {
+			i += SEARCH_VECTOR_SIZE - 1;
+			continue;
+		}
+#endif
 		if (_op(mem8[i], value8, op)) {
 			struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsAppend(out);
 			res->address = start + i;
@@ -117,10 +189,19 @@ static size_t _searchStr(const void* mem, size_t size, const struct mCoreMemoryB
 	const char* memStr = mem;
 	size_t found = 0;
 	uint32_t start = block->start;
-	uint32_t end = size; // TODO: Segments
-	size_t i;
-	for (i = 0; (!limit || found < limit) && i < end - len; ++i) {
-		if (!memcmp(valueStr, &memStr[i], len)) {
+	size_t end = size; // TODO: Segments
+	if (len <= 0 || (size_t) len > end) {
+		return 0;
+	}
+	size_t i = 0;
+	// memchr is vectorized in any libc worth using, so let it find where the string might start
+	while ((!limit || found < limit) && i <= end - len) {
+		const char* next = memchr(&memStr[i], valueStr[0], end - len + 1 - i);
+		if (!next) {
+			break;
+		}
+		i = next - memStr;
+		if (!memcmp(valueStr, next, len)) {
 			struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsAppend(out);
 			res->address = start + i;
 			res->type = mCORE_MEMORY_SEARCH_STRING;
@@ -128,6 +209,7 @@ static size_t _searchStr(const void* mem, size_t size, const struct mCoreMemoryB
 			res->segment = -1; // TODO
 			++found;
 		}
+		++i;
 	}
 	return found;
 }
@@ -226,11 +308,25 @@ static size_t _search(const void* mem, size_t size, const struct mCoreMemoryBloc
 }
 
 void mCoreMemorySearch(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* out, size_t limit) {
+	mCoreMemorySearchWithProgress(core, params, out, limit, NULL, NULL);
+}
+
+bool mCoreMemorySearchWithProgress(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* out, size_t limit, mCoreMemorySearchProgress progress, void* context) {
 	const struct mCoreMemoryBlock* blocks;
 	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
 	size_t found = 0;
 
+	size_t total = 0;
+	size_t done = 0;
 	size_t b;
+	if (progress) {
+		for (b = 0; b < nBlocks; ++b) {
+			if (blocks[b].flags & params->memoryFlags) {
+				total += blocks[b].end - blocks[b].start;
+			}
+		}
+	}
+
 	for (b = 0; (!limit || found < limit) && b < nBlocks; ++b) {
 		size_t size;
 		const struct mCoreMemoryBlock* block = &blocks[b];
@@ -239,13 +335,41 @@ void mCoreMemorySearch(struct mCore* core, const struct mCoreMemorySearchParams*
 		}
 		void* mem = core->getMemoryBlock(core, block->id, &size);
 		if (!mem) {
+			done += block->end - block->start;
 			continue;
 		}
 		if (size > block->end - block->start) {
 			size = block->end - block->start; // TOOD: Segments
 		}
-		found += _search(mem, size, block, params, out, limit ? limit - found : 0);
+		if (!progress) {
+			found += _search(mem, size, block, params, out, limit ? limit - found : 0);
+			continue;
+		}
+
+		// Search large blocks a chunk at a time so progress can be reported within them. String
+		// matches may start at the end of one chunk and run into the next, so the chunks overlap.
+		size_t overlap = params->type == mCORE_MEMORY_SEARCH_STRING && params->width > 0 ? params->width - 1 : 0;
+		struct mCoreMemoryBlock chunk = *block;
+		size_t offset;
+		for (offset = 0; (!limit || found < limit) && offset < size; offset += SEARCH_CHUNK_SIZE) {
+			size_t chunkSize = size - offset;
+			if (chunkSize > SEARCH_CHUNK_SIZE + overlap) {
+				chunkSize = SEARCH_CHUNK_SIZE + overlap;
+			}
+			chunk.start = block->start + offset;
+			if (chunkSize > overlap) {
+				found += _search((const uint8_t*) mem + offset, chunkSize, &chunk, params, out, limit ? limit - found : 0);
+			}
+			if (!progress(context, done + offset + (chunkSize < SEARCH_CHUNK_SIZE ? chunkSize : SEARCH_CHUNK_SIZE), total)) {
+				return false;
+			}
+		}
+		done += block->end - block->start;
 	}
+	if (progress) {
+		progress(context, total, total);
+	}
+	return true;
 }
 
 bool _testSpecificGuess(struct mCore* core, struct mCoreMemorySearchResult* res, int64_t opValue, enum mCoreMemorySearchOp op) {
@@ -293,8 +417,17 @@ bool _testGuess(struct mCore* core, struct mCoreMemorySearchResult* res, const s
 }
 
 void mCoreMemorySearchRepeat(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* inout) {
+	mCoreMemorySearchRepeatWithProgress(core, params, inout, NULL, NULL);
+}
+
+bool mCoreMemorySearchRepeatWithProgress(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* inout, mCoreMemorySearchProgress progress, void* context) {
+	size_t total = mCoreMemorySearchResultsSize(inout);
+	size_t checked = 0;
 	size_t i;
-	for (i = 0; i < mCoreMemorySearchResultsSize(inout); ++i) {
+	for (i = 0; i < mCoreMemorySearchResultsSize(inout); ++i, ++checked) {
+		if (progress && !(checked & (SEARCH_REPEAT_BATCH - 1)) && !progress(context, checked, total)) {
+			return false;
+		}
 		struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsGetPointer(inout, i);
 		switch (res->type) {
 		case mCORE_MEMORY_SEARCH_INT:
@@ -339,4 +472,187 @@ void mCoreMemorySearchRepeat(struct mCore* core, const struct mCoreMemorySearchP
 			break;
 		}
 	}
+	if (progress) {
+		progress(context, total, total);
+	}
+	return true;
+}
+
+#define REFINE(WIDTH, TYPE) \
+	static size_t _refine ## WIDTH(const TYPE* current, const TYPE* old, uint8_t* candidates, size_t n, enum mCoreMemorySearchOp op, int32_t value) { \
+		size_t i; \
+		/* Keep the op out of the loops so the compiler can vectorize them */ \
+		switch (op) { \
+		case mCORE_MEMORY_SEARCH_EQUAL: \
+			for (i = 0; i < n; ++i) { \
+				candidates[i] &= (int32_t) current[i] == value; \
+			} \
+			break; \
+		case mCORE_MEMORY_SEARCH_GREATER: \
+			for (i = 0; i < n; ++i) { \
+				candidates[i] &= (int32_t) current[i] > value; \
+			} \
+			break; \
+		case mCORE_MEMORY_SEARCH_LESS: \
+			for (i = 0; i < n; ++i) { \
+				candidates[i] &= (int32_t) current[i] < value; \
+			} \
+			break; \
+		case mCORE_MEMORY_SEARCH_DELTA: \
+			for (i = 0; i < n; ++i) { \
+				candidates[i] &= (int32_t) (current[i] - old[i]) == value; \
+			} \
+			break; \
+		case mCORE_MEMORY_SEARCH_DELTA_POSITIVE: \
+			for (i = 0; i < n; ++i) { \
+				candidates[i] &= current[i] > old[i]; \
+			} \
+			break; \
+		case mCORE_MEMORY_SEARCH_DELTA_NEGATIVE: \
+			for (i = 0; i < n; ++i) { \
+				candidates[i] &= current[i] < old[i]; \
+			} \
+			break; \
+		case mCORE_MEMORY_SEARCH_DELTA_ANY: \
+			for (i = 0; i < n; ++i) { \
+				candidates[i] &= current[i] != old[i]; \
+			} \
+			break; \
+		case mCORE_MEMORY_SEARCH_ANY: \
+			break; \
+		} \
+		size_t left = 0; \
+		for (i = 0; i < n; ++i) { \
+			left += candidates[i]; \
+		} \
+		return left; \
+	}
+
+REFINE(8, uint8_t)
+REFINE(16, uint16_t)
+REFINE(32, uint32_t)
+
+void mCoreMemorySearchSnapshotInit(struct mCoreMemorySearchSnapshot* snapshot) {
+	mCoreMemorySearchSnapshotBlocksInit(&snapshot->blocks, 0);
+	snapshot->width = 1;
+	snapshot->candidates = 0;
+}
+
+static void _clearSnapshot(struct mCoreMemorySearchSnapshot* snapshot) {
+	size_t i;
+	for (i = 0; i < mCoreMemorySearchSnapshotBlocksSize(&snapshot->blocks); ++i) {
+		struct mCoreMemorySearchSnapshotBlock* block = mCoreMemorySearchSnapshotBlocksGetPointer(&snapshot->blocks, i);
+		free(block->data);
+		free(block->candidates);
+	}
+	mCoreMemorySearchSnapshotBlocksClear(&snapshot->blocks);
+	snapshot->candidates = 0;
+}
+
+void mCoreMemorySearchSnapshotDeinit(struct mCoreMemorySearchSnapshot* snapshot) {
+	_clearSnapshot(snapshot);
+	mCoreMemorySearchSnapshotBlocksDeinit(&snapshot->blocks);
+}
+
+size_t mCoreMemorySearchSnapshotTake(struct mCore* core, struct mCoreMemorySearchSnapshot* snapshot, int memoryFlags, int width) {
+	_clearSnapshot(snapshot);
+	if (width != 1 && width != 2 && width != 4) {
+		return 0;
+	}
+	snapshot->width = width;
+
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
+	size_t b;
+	for (b = 0; b < nBlocks; ++b) {
+		const struct mCoreMemoryBlock* block = &blocks[b];
+		if (!(block->flags & memoryFlags)) {
+			continue;
+		}
+		size_t size;
+		void* mem = core->getMemoryBlock(core, block->id, &size);
+		if (!mem) {
+			continue;
+		}
+		if (size > block->end - block->start) {
+			size = block->end - block->start; // TOOD: Segments
+		}
+		size &= ~(size_t) (width - 1);
+		if (!size) {
+			continue;
+		}
+		struct mCoreMemorySearchSnapshotBlock* snap = mCoreMemorySearchSnapshotBlocksAppend(&snapshot->blocks);
+		snap->block = block;
+		snap->size = size;
+		snap->data = malloc(size);
+		memcpy(snap->data, mem, size);
+		snap->candidates = malloc(size / width);
+		memset(snap->candidates, 1, size / width);
+		snapshot->candidates += size / width;
+	}
+	return snapshot->candidates;
+}
+
+size_t mCoreMemorySearchSnapshotRefine(struct mCore* core, struct mCoreMemorySearchSnapshot* snapshot, enum mCoreMemorySearchOp op, int32_t value) {
+	snapshot->candidates = 0;
+	size_t i;
+	for (i = 0; i < mCoreMemorySearchSnapshotBlocksSize(&snapshot->blocks); ++i) {
+		struct mCoreMemorySearchSnapshotBlock* snap = mCoreMemorySearchSnapshotBlocksGetPointer(&snapshot->blocks, i);
+		size_t size;
+		const void* mem = core->getMemoryBlock(core, snap->block->id, &size);
+		if (!mem || size < snap->size) {
+			// The memory went away, so nothing in it can still match
+			memset(snap->candidates, 0, snap->size / snapshot->width);
+			continue;
+		}
+		size_t n = snap->size / snapshot->width;
+		switch (snapshot->width) {
+		case 1:
+			snapshot->candidates += _refine8(mem, snap->data, snap->candidates, n, op, value);
+			break;
+		case 2:
+			snapshot->candidates += _refine16(mem, (const uint16_t*) snap->data, snap->candidates, n, op, value);
+			break;
+		case 4:
+			snapshot->candidates += _refine32(mem, (const uint32_t*) snap->data, snap->candidates, n, op, value);
+			break;
+		}
+		memcpy(snap->data, mem, snap->size);
+	}
+	return snapshot->candidates;
+}
+
+size_t mCoreMemorySearchSnapshotResults(const struct mCoreMemorySearchSnapshot* snapshot, struct mCoreMemorySearchResults* out, size_t limit) {
+	size_t found = 0;
+	size_t i;
+	for (i = 0; i < mCoreMemorySearchSnapshotBlocksSize(&snapshot->blocks) && (!limit || found < limit); ++i) {
+		const struct mCoreMemorySearchSnapshotBlock* snap = mCoreMemorySearchSnapshotBlocksGetConstPointer(&snapshot->blocks, i);
+		size_t n = snap->size / snapshot->width;
+		size_t e;
+		for (e = 0; e < n && (!limit || found < limit); ++e) {
+			if (!snap->candidates[e]) {
+				continue;
+			}
+			struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsAppend(out);
+			res->address = snap->block->start + e * snapshot->width;
+			res->type = mCORE_MEMORY_SEARCH_INT;
+			res->width = snapshot->width;
+			res->segment = -1; // TODO
+			res->guessDivisor = 1;
+			res->guessMultiplier = 1;
+			switch (snapshot->width) {
+			case 1:
+				res->oldValue = snap->data[e];
+				break;
+			case 2:
+				res->oldValue = ((const uint16_t*) snap->data)[e];
+				break;
+			case 4:
+				res->oldValue = ((const uint32_t*) snap->data)[e];
+				break;
+			}
+			++found;
+		}
+	}
+	return found;
 }
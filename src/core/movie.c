@@ -0,0 +1,330 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/movie.h>
+
+#include <mgba/core/core.h>
+#include <mgba/core/log.h>
+#include <mgba/core/serialize.h>
+#include <mgba-util/vfs.h>
+
+#define MOVIE_MAGIC 0x564F4D6D // "mMOV"
+#define MOVIE_VERSION 1
+
+// Keyframes carry savedata and RTC so that seeking never depends on what happened outside the
+// movie, but loading them must not write the savedata back to disk
+#define KEYFRAME_SAVE_FLAGS (SAVESTATE_CHUNKED | SAVESTATE_QUICK | SAVESTATE_SAVEDATA | SAVESTATE_RTC)
+#define KEYFRAME_LOAD_FLAGS SAVESTATE_RTC
+
+mLOG_DEFINE_CATEGORY(MOVIE, "Movie", "core.movie");
+
+DEFINE_VECTOR(mMovieKeyframeList, struct mMovieKeyframe);
+
+// The file starts with this header, followed by the keyframes. The inputs and the keyframe index
+// are written after the last keyframe when recording stops, and the magic is only filled in then,
+// so a recording that was never stopped can't be mistaken for a complete one.
+struct mMovieHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t platform;
+	uint32_t keyframeInterval;
+	uint32_t nFrames;
+	uint32_t nKeyframes;
+	uint32_t inputsOffset;
+	uint32_t indexOffset;
+};
+
+static bool _writeHeader(struct mMovie* movie, uint32_t magic, uint32_t inputsOffset, uint32_t indexOffset) {
+	struct mMovieHeader header;
+	STORE_32LE(magic, 0, &header.magic);
+	STORE_32LE(MOVIE_VERSION, 0, &header.version);
+	STORE_32LE(movie->core->platform(movie->core), 0, &header.platform);
+	STORE_32LE(movie->keyframeInterval, 0, &header.keyframeInterval);
+	STORE_32LE(UInt32ListSize(&movie->inputs), 0, &header.nFrames);
+	STORE_32LE(mMovieKeyframeListSize(&movie->keyframes), 0, &header.nKeyframes);
+	STORE_32LE(inputsOffset, 0, &header.inputsOffset);
+	STORE_32LE(indexOffset, 0, &header.indexOffset);
+	return movie->vf->seek(movie->vf, 0, SEEK_SET) == 0 &&
+	       movie->vf->write(movie->vf, &header, sizeof(header)) == sizeof(header);
+}
+
+static bool _saveKeyframe(struct mMovie* movie) {
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	if (!mCoreSaveStateNamed(movie->core, vf, KEYFRAME_SAVE_FLAGS)) {
+		vf->close(vf);
+		return false;
+	}
+	ssize_t size = vf->size(vf);
+	void* data = vf->map(vf, size, MAP_READ);
+	bool success = movie->vf->seek(movie->vf, movie->dataEnd, SEEK_SET) == (ssize_t) movie->dataEnd &&
+	               movie->vf->write(movie->vf, data, size) == size;
+	vf->unmap(vf, data, size);
+	vf->close(vf);
+	if (!success) {
+		mLOG(MOVIE, ERROR, "Failed to write keyframe for frame %u", movie->frame);
+		return false;
+	}
+	*mMovieKeyframeListAppend(&movie->keyframes) = (struct mMovieKeyframe) {
+		.frame = movie->frame,
+		.offset = movie->dataEnd,
+		.size = size,
+	};
+	movie->dataEnd += size;
+	return true;
+}
+
+static bool _loadKeyframe(struct mMovie* movie, const struct mMovieKeyframe* keyframe) {
+	void* data = malloc(keyframe->size);
+	bool success = data &&
+	               movie->vf->seek(movie->vf, keyframe->offset, SEEK_SET) == (ssize_t) keyframe->offset &&
+	               movie->vf->read(movie->vf, data, keyframe->size) == (ssize_t) keyframe->size;
+	if (success) {
+		struct VFile* vf = VFileFromConstMemory(data, keyframe->size);
+		success = mCoreLoadStateNamed(movie->core, vf, KEYFRAME_LOAD_FLAGS);
+		vf->close(vf);
+	}
+	free(data);
+	if (!success) {
+		mLOG(MOVIE, ERROR, "Failed to load keyframe for frame %u", keyframe->frame);
+	}
+	return success;
+}
+
+void mMovieInit(struct mMovie* movie, struct mCore* core) {
+	memset(movie, 0, sizeof(*movie));
+	movie->core = core;
+	movie->keyframeInterval = mMOVIE_DEFAULT_KEYFRAME_INTERVAL;
+	UInt32ListInit(&movie->inputs, 0);
+	mMovieKeyframeListInit(&movie->keyframes, 0);
+}
+
+void mMovieDeinit(struct mMovie* movie) {
+	mMovieStop(movie);
+	UInt32ListDeinit(&movie->inputs);
+	mMovieKeyframeListDeinit(&movie->keyframes);
+}
+
+bool mMovieStartRecording(struct mMovie* movie, struct VFile* vf, uint32_t keyframeInterval) {
+	mMovieStop(movie);
+	movie->vf = vf;
+	movie->keyframeInterval = keyframeInterval ? keyframeInterval : mMOVIE_DEFAULT_KEYFRAME_INTERVAL;
+	movie->frame = 0;
+	movie->dataEnd = sizeof(struct mMovieHeader);
+	vf->truncate(vf, 0);
+	if (!_writeHeader(movie, 0, 0, 0) || !_saveKeyframe(movie)) {
+		vf->close(vf);
+		movie->vf = NULL;
+		mMovieKeyframeListClear(&movie->keyframes);
+		return false;
+	}
+	movie->mode = mMOVIE_RECORDING;
+	return true;
+}
+
+static bool _readMovie(struct mMovie* movie) {
+	struct VFile* vf = movie->vf;
+	struct mMovieHeader header;
+	if (vf->seek(vf, 0, SEEK_SET) != 0 || vf->read(vf, &header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	uint32_t magic;
+	uint32_t version;
+	uint32_t platform;
+	uint32_t nFrames;
+	uint32_t nKeyframes;
+	uint32_t inputsOffset;
+	uint32_t indexOffset;
+	LOAD_32LE(magic, 0, &header.magic);
+	LOAD_32LE(version, 0, &header.version);
+	LOAD_32LE(platform, 0, &header.platform);
+	LOAD_32LE(movie->keyframeInterval, 0, &header.keyframeInterval);
+	LOAD_32LE(nFrames, 0, &header.nFrames);
+	LOAD_32LE(nKeyframes, 0, &header.nKeyframes);
+	LOAD_32LE(inputsOffset, 0, &header.inputsOffset);
+	LOAD_32LE(indexOffset, 0, &header.indexOffset);
+	if (magic != MOVIE_MAGIC) {
+		mLOG(MOVIE, ERROR, "Not a movie, or its recording was never finished");
+		return false;
+	}
+	if (version != MOVIE_VERSION) {
+		mLOG(MOVIE, ERROR, "Unsupported movie version %u", version);
+		return false;
+	}
+	if (platform != (uint32_t) movie->core->platform(movie->core)) {
+		mLOG(MOVIE, ERROR, "Movie was recorded on a different platform");
+		return false;
+	}
+
+	ssize_t fileSize = vf->size(vf);
+	if (!nKeyframes ||
+	    (uint64_t) inputsOffset + (uint64_t) nFrames * 4 > (uint64_t) fileSize ||
+	    (uint64_t) indexOffset + (uint64_t) nKeyframes * sizeof(struct mMovieKeyframe) > (uint64_t) fileSize) {
+		mLOG(MOVIE, ERROR, "Movie is truncated");
+		return false;
+	}
+
+	UInt32ListResize(&movie->inputs, nFrames);
+	if (vf->seek(vf, inputsOffset, SEEK_SET) != (ssize_t) inputsOffset ||
+	    vf->read(vf, movie->inputs.vector, nFrames * 4) != (ssize_t) nFrames * 4) {
+		return false;
+	}
+	uint32_t i;
+	for (i = 0; i < nFrames; ++i) {
+		uint32_t* keys = UInt32ListGetPointer(&movie->inputs, i);
+		LOAD_32LE(*keys, 0, keys);
+	}
+
+	mMovieKeyframeListResize(&movie->keyframes, nKeyframes);
+	if (vf->seek(vf, indexOffset, SEEK_SET) != (ssize_t) indexOffset ||
+	    vf->read(vf, movie->keyframes.vector, nKeyframes * sizeof(struct mMovieKeyframe)) != (ssize_t) (nKeyframes * sizeof(struct mMovieKeyframe))) {
+		return false;
+	}
+	uint32_t lastFrame = 0;
+	for (i = 0; i < nKeyframes; ++i) {
+		struct mMovieKeyframe* keyframe = mMovieKeyframeListGetPointer(&movie->keyframes, i);
+		LOAD_32LE(keyframe->frame, 0, &keyframe->frame);
+		LOAD_32LE(keyframe->offset, 0, &keyframe->offset);
+		LOAD_32LE(keyframe->size, 0, &keyframe->size);
+		// Keyframes must be in order, starting with frame 0
+		if ((i ? keyframe->frame <= lastFrame : keyframe->frame != 0) || keyframe->frame > nFrames ||
+		    (uint64_t) keyframe->offset + keyframe->size > (uint64_t) fileSize) {
+			mLOG(MOVIE, ERROR, "Movie has an invalid keyframe index");
+			return false;
+		}
+		lastFrame = keyframe->frame;
+	}
+	return true;
+}
+
+bool mMovieStartPlayback(struct mMovie* movie, struct VFile* vf) {
+	mMovieStop(movie);
+	movie->vf = vf;
+	movie->mode = mMOVIE_PLAYING;
+	if (!_readMovie(movie) || !mMovieSeek(movie, 0)) {
+		movie->mode = mMOVIE_IDLE;
+		mMovieStop(movie);
+		return false;
+	}
+	return true;
+}
+
+bool mMovieStop(struct mMovie* movie) {
+	if (!movie->vf) {
+		return true;
+	}
+	bool success = true;
+	if (movie->mode == mMOVIE_RECORDING) {
+		struct VFile* vf = movie->vf;
+		uint32_t inputsOffset = movie->dataEnd;
+		size_t nFrames = UInt32ListSize(&movie->inputs);
+		size_t nKeyframes = mMovieKeyframeListSize(&movie->keyframes);
+		uint32_t indexOffset = inputsOffset + nFrames * 4;
+
+		uint32_t* inputs = malloc(nFrames * 4 + 1);
+		size_t i;
+		for (i = 0; i < nFrames; ++i) {
+			STORE_32LE(*UInt32ListGetPointer(&movie->inputs, i), i * 4, inputs);
+		}
+		struct mMovieKeyframe* index = malloc(nKeyframes * sizeof(*index));
+		for (i = 0; i < nKeyframes; ++i) {
+			const struct mMovieKeyframe* keyframe = mMovieKeyframeListGetConstPointer(&movie->keyframes, i);
+			STORE_32LE(keyframe->frame, 0, &index[i].frame);
+			STORE_32LE(keyframe->offset, 0, &index[i].offset);
+			STORE_32LE(keyframe->size, 0, &index[i].size);
+		}
+		success = vf->seek(vf, inputsOffset, SEEK_SET) == (ssize_t) inputsOffset &&
+		          vf->write(vf, inputs, nFrames * 4) == (ssize_t) nFrames * 4 &&
+		          vf->write(vf, index, nKeyframes * sizeof(*index)) == (ssize_t) (nKeyframes * sizeof(*index)) &&
+		          _writeHeader(movie, MOVIE_MAGIC, inputsOffset, indexOffset);
+		// Rerecording can leave stale data past the new end
+		vf->truncate(vf, indexOffset + nKeyframes * sizeof(*index));
+		free(inputs);
+		free(index);
+		if (!success) {
+			mLOG(MOVIE, ERROR, "Failed to finish writing movie");
+		}
+	}
+	movie->vf->close(movie->vf);
+	movie->vf = NULL;
+	movie->mode = mMOVIE_IDLE;
+	movie->frame = 0;
+	UInt32ListClear(&movie->inputs);
+	mMovieKeyframeListClear(&movie->keyframes);
+	return success;
+}
+
+bool mMovieRunFrame(struct mMovie* movie) {
+	struct mCore* core = movie->core;
+	switch (movie->mode) {
+	case mMOVIE_IDLE:
+		return false;
+	case mMOVIE_RECORDING:
+		if (movie->frame % movie->keyframeInterval == 0) {
+			const struct mMovieKeyframe* last = mMovieKeyframeListGetConstPointer(&movie->keyframes, mMovieKeyframeListSize(&movie->keyframes) - 1);
+			// After seeking back to a keyframe, that keyframe is still valid
+			if (last->frame < movie->frame) {
+				_saveKeyframe(movie);
+			}
+		}
+		*UInt32ListAppend(&movie->inputs) = core->getKeys(core);
+		break;
+	case mMOVIE_PLAYING:
+		if (movie->frame >= UInt32ListSize(&movie->inputs)) {
+			return false;
+		}
+		core->setKeys(core, *UInt32ListGetPointer(&movie->inputs, movie->frame));
+		break;
+	}
+	core->runFrame(core);
+	++movie->frame;
+	return true;
+}
+
+bool mMovieSeek(struct mMovie* movie, uint32_t frame) {
+	if (movie->mode == mMOVIE_IDLE || frame > UInt32ListSize(&movie->inputs)) {
+		return false;
+	}
+
+	// Find the last keyframe at or before the target
+	size_t low = 0;
+	size_t high = mMovieKeyframeListSize(&movie->keyframes);
+	while (high - low > 1) {
+		size_t mid = low + (high - low) / 2;
+		if (mMovieKeyframeListGetConstPointer(&movie->keyframes, mid)->frame <= frame) {
+			low = mid;
+		} else {
+			high = mid;
+		}
+	}
+	const struct mMovieKeyframe* keyframe = mMovieKeyframeListGetConstPointer(&movie->keyframes, low);
+	if (!_loadKeyframe(movie, keyframe)) {
+		return false;
+	}
+
+	struct mCore* core = movie->core;
+	uint32_t frames = frame - keyframe->frame;
+	if (frames) {
+		// Only the last frame's picture will be seen, and none of the audio
+		core->skipVideoFrames(core, frames - 1);
+		core->skipAudioFrames(core, frames);
+	}
+	uint32_t i;
+	for (i = keyframe->frame; i < frame; ++i) {
+		core->setKeys(core, *UInt32ListGetPointer(&movie->inputs, i));
+		core->runFrame(core);
+	}
+	movie->frame = frame;
+
+	if (movie->mode == mMOVIE_RECORDING) {
+		movie->dataEnd = keyframe->offset + keyframe->size;
+		UInt32ListResize(&movie->inputs, (ssize_t) frame - (ssize_t) UInt32ListSize(&movie->inputs));
+		mMovieKeyframeListResize(&movie->keyframes, (ssize_t) (low + 1) - (ssize_t) mMovieKeyframeListSize(&movie->keyframes));
+	}
+	return true;
+}
+
+uint32_t mMovieFrameCount(const struct mMovie* movie) {
+	return UInt32ListSize(&movie->inputs);
+}
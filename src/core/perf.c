@@ -0,0 +1,320 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/perf.h>
+
+#include <mgba-util/threading.h>
+#include <mgba-util/vfs.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <time.h>
+#endif
+
+#ifdef ENABLE_PERF_TIMERS
+#define MAX_DEPTH 16
+
+static struct mPerfCounter _counters[mPERF_MAX];
+static enum mPerfSection _stack[MAX_DEPTH];
+static int _depth = 0;
+static uint64_t _lastSwitch = 0;
+#endif
+
+static const char* const _sectionNames[mPERF_MAX] = {
+	[mPERF_OTHER] = "other",
+	[mPERF_CPU] = "cpu",
+	[mPERF_VIDEO] = "video",
+	[mPERF_AUDIO] = "audio",
+	[mPERF_DMA] = "dma",
+	[mPERF_TIMING] = "timing",
+};
+
+#define TRACE_BUFFER_SIZE 0x10000
+#define TRACE_EVENT_MAX 256
+
+struct mTraceJSON {
+	struct mTraceBackend d;
+	struct VFile* vf;
+	Mutex mutex;
+	bool first;
+	size_t size;
+	char buffer[TRACE_BUFFER_SIZE];
+};
+
+// Thread IDs are shared by all traces so a thread keeps its ID between them
+static ThreadLocal _traceTid;
+static bool _traceTidInited = false;
+static intptr_t _nextTraceTid = 0;
+
+#ifdef ENABLE_TRACING
+static struct mTraceBackend* _traceBackend = NULL;
+#endif
+
+#define STARTUP_PHASE_MAX 32
+
+struct mStartupPhase {
+	const char* name;
+	uint64_t nsec;
+};
+
+static struct mStartupPhase _startupPhases[STARTUP_PHASE_MAX];
+static int _nStartupPhases = 0;
+static int _startupTraceActive = 0;
+static uint64_t _startupStart;
+
+uint64_t mPerfTimestamp(void) {
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER count;
+	if (!frequency.QuadPart) {
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&count);
+	return count.QuadPart / frequency.QuadPart * 1000000000ULL + count.QuadPart % frequency.QuadPart * 1000000000ULL / frequency.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+#endif
+}
+
+#ifdef ENABLE_PERF_TIMERS
+
+static void _charge(void) {
+	uint64_t now = mPerfTimestamp();
+	enum mPerfSection current = mPERF_OTHER;
+	if (_depth > 0) {
+		current = _stack[_depth > MAX_DEPTH ? MAX_DEPTH - 1 : _depth - 1];
+	}
+	_counters[current].nsec += now - _lastSwitch;
+	_lastSwitch = now;
+}
+
+void mPerfEnter(enum mPerfSection section) {
+	_charge();
+	// Sections nested too deeply keep charging the deepest one that fit on the stack
+	if (_depth < MAX_DEPTH) {
+		_stack[_depth] = section;
+	}
+	++_depth;
+	++_counters[section].entries;
+}
+
+void mPerfLeave(void) {
+	_charge();
+	if (_depth > 0) {
+		--_depth;
+	}
+}
+#endif
+
+void mPerfTimersReset(void) {
+#ifdef ENABLE_PERF_TIMERS
+	memset(_counters, 0, sizeof(_counters));
+	_lastSwitch = mPerfTimestamp();
+#endif
+}
+
+void mPerfTimersCollect(struct mPerfCounter counters[mPERF_MAX]) {
+#ifdef ENABLE_PERF_TIMERS
+	_charge();
+	memcpy(counters, _counters, sizeof(_counters));
+#else
+	memset(counters, 0, sizeof(*counters) * mPERF_MAX);
+#endif
+}
+
+const char* mPerfSectionName(enum mPerfSection section) {
+	if (section < 0 || section >= mPERF_MAX) {
+		return NULL;
+	}
+	return _sectionNames[section];
+}
+
+void mStartupTraceBegin(void) {
+	_startupStart = mPerfTimestamp();
+	ATOMIC_STORE(_nStartupPhases, 0);
+	ATOMIC_STORE(_startupTraceActive, 1);
+}
+
+bool mStartupTraceIsActive(void) {
+	int active;
+	ATOMIC_LOAD(active, _startupTraceActive);
+	return active;
+}
+
+void mStartupTraceMark(const char* phase) {
+	if (!mStartupTraceIsActive()) {
+		return;
+	}
+	uint64_t now = mPerfTimestamp();
+	int index = ATOMIC_ADD(_nStartupPhases, 1) - 1;
+	if (index < STARTUP_PHASE_MAX) {
+		_startupPhases[index].name = phase;
+		_startupPhases[index].nsec = now;
+	}
+}
+
+void mStartupTraceFinish(void) {
+	if (!mStartupTraceIsActive()) {
+		return;
+	}
+	ATOMIC_STORE(_startupTraceActive, 0);
+	int nPhases;
+	ATOMIC_LOAD(nPhases, _nStartupPhases);
+	if (nPhases > STARTUP_PHASE_MAX) {
+		nPhases = STARTUP_PHASE_MAX;
+	}
+
+	// Marks from different threads can land slightly out of order
+	int i;
+	for (i = 1; i < nPhases; ++i) {
+		struct mStartupPhase phase = _startupPhases[i];
+		int j;
+		for (j = i; j > 0 && _startupPhases[j - 1].nsec > phase.nsec; --j) {
+			_startupPhases[j] = _startupPhases[j - 1];
+		}
+		_startupPhases[j] = phase;
+	}
+
+	printf("Startup trace:\n");
+	uint64_t last = _startupStart;
+	for (i = 0; i < nPhases; ++i) {
+		printf("  %-28s %9.2f ms (at %9.2f ms)\n", _startupPhases[i].name,
+		       (_startupPhases[i].nsec - last) / 1e6, (_startupPhases[i].nsec - _startupStart) / 1e6);
+		last = _startupPhases[i].nsec;
+	}
+}
+
+#ifdef ENABLE_TRACING
+static struct mTraceBackend* _activeBackend(void) {
+	struct mTraceBackend* backend;
+	ATOMIC_LOAD_PTR(backend, _traceBackend);
+	return backend;
+}
+
+void mTraceBegin(const char* name) {
+	struct mTraceBackend* backend = _activeBackend();
+	if (backend) {
+		backend->begin(backend, name, mPerfTimestamp());
+	}
+}
+
+void mTraceEnd(void) {
+	struct mTraceBackend* backend = _activeBackend();
+	if (backend) {
+		backend->end(backend, mPerfTimestamp());
+	}
+}
+
+void mTraceMark(const char* name) {
+	struct mTraceBackend* backend = _activeBackend();
+	if (backend) {
+		backend->mark(backend, name, mPerfTimestamp());
+	}
+}
+
+void mTraceThreadName(const char* name) {
+	struct mTraceBackend* backend = _activeBackend();
+	if (backend) {
+		backend->threadName(backend, name);
+	}
+}
+#endif
+
+void mTraceSetBackend(struct mTraceBackend* backend) {
+#ifdef ENABLE_TRACING
+	ATOMIC_STORE_PTR(_traceBackend, backend);
+#else
+	UNUSED(backend);
+#endif
+}
+
+static void _traceFlush(struct mTraceJSON* json) {
+	if (json->size) {
+		json->vf->write(json->vf, json->buffer, json->size);
+		json->size = 0;
+	}
+}
+
+// Must be called with the mutex held
+static intptr_t _traceThreadId(void) {
+	intptr_t tid = (intptr_t) ThreadLocalGetValue(_traceTid);
+	if (!tid) {
+		tid = ++_nextTraceTid;
+		ThreadLocalSetKey(_traceTid, (void*) tid);
+	}
+	return tid;
+}
+
+static void _traceEvent(struct mTraceJSON* json, const char* name, const char* phase, uint64_t nsec, const char* extra) {
+	MutexLock(&json->mutex);
+	intptr_t tid = _traceThreadId();
+	if (json->size > TRACE_BUFFER_SIZE - TRACE_EVENT_MAX) {
+		_traceFlush(json);
+	}
+	int length = snprintf(&json->buffer[json->size], TRACE_EVENT_MAX,
+	                      "%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%" PRIu64 ".%03u,\"pid\":1,\"tid\":%i%s}",
+	                      json->first ? "" : ",\n", name ? name : "", phase, nsec / 1000, (unsigned) (nsec % 1000), (int) tid, extra);
+	if (length > 0 && length < TRACE_EVENT_MAX) {
+		json->size += length;
+		json->first = false;
+	}
+	MutexUnlock(&json->mutex);
+}
+
+static void _traceJSONBegin(struct mTraceBackend* backend, const char* name, uint64_t nsec) {
+	_traceEvent((struct mTraceJSON*) backend, name, "B", nsec, "");
+}
+
+static void _traceJSONEnd(struct mTraceBackend* backend, uint64_t nsec) {
+	_traceEvent((struct mTraceJSON*) backend, NULL, "E", nsec, "");
+}
+
+static void _traceJSONMark(struct mTraceBackend* backend, const char* name, uint64_t nsec) {
+	_traceEvent((struct mTraceJSON*) backend, name, "i", nsec, ",\"s\":\"t\"");
+}
+
+static void _traceJSONThreadName(struct mTraceBackend* backend, const char* name) {
+	struct mTraceJSON* json = (struct mTraceJSON*) backend;
+	char extra[128];
+	snprintf(extra, sizeof(extra), ",\"args\":{\"name\":\"%s\"}", name);
+	_traceEvent(json, "thread_name", "M", 0, extra);
+}
+
+struct mTraceBackend* mTraceJSONCreate(struct VFile* vf) {
+	struct mTraceJSON* json = calloc(1, sizeof(*json));
+	json->d.begin = _traceJSONBegin;
+	json->d.end = _traceJSONEnd;
+	json->d.mark = _traceJSONMark;
+	json->d.threadName = _traceJSONThreadName;
+	json->vf = vf;
+	json->first = true;
+	MutexInit(&json->mutex);
+	if (!_traceTidInited) {
+		ThreadLocalInitKey(&_traceTid);
+		_traceTidInited = true;
+	}
+	// The array may be left unterminated, which trace viewers accept
+	vf->write(vf, "[\n", 2);
+	return &json->d;
+}
+
+void mTraceJSONDestroy(struct mTraceBackend* backend) {
+	struct mTraceJSON* json = (struct mTraceJSON*) backend;
+	MutexLock(&json->mutex);
+	_traceFlush(json);
+	json->vf->write(json->vf, "\n]\n", 3);
+	MutexUnlock(&json->mutex);
+	MutexDeinit(&json->mutex);
+	json->vf->close(json->vf);
+	free(json);
+}
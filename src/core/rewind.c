@@ -6,11 +6,16 @@
 #include <mgba/core/rewind.h>
 
 #include <mgba/core/core.h>
+#include <mgba/core/perf.h>
 #include <mgba/core/serialize.h>
+#include <mgba-util/math.h>
 #include <mgba-util/patch/fast.h>
 #include <mgba-util/vfs.h>
 
-DEFINE_VECTOR(mCoreRewindPatches, struct PatchFast);
+#define PACK_RUN_FLAG 0x80
+#define PACK_MAX_RUN 0x80
+
+DEFINE_VECTOR(mCoreRewindPatches, struct mCoreRewindPatch);
 
 static void _rewindDiff(struct mCoreRewindContext* context);
 
@@ -25,11 +30,19 @@ void mCoreRewindContextInit(struct mCoreRewindContext* context, size_t entries,
 	mCoreRewindPatchesInit(&context->patchMemory, entries);
 	size_t e;
 	for (e = 0; e < entries; ++e) {
-		initPatchFast(mCoreRewindPatchesAppend(&context->patchMemory));
+		struct mCoreRewindPatch* patch = mCoreRewindPatchesAppend(&context->patchMemory);
+		patch->data = NULL;
+		patch->size = 0;
 	}
+	initPatchFast(&context->patch);
+	context->packBuffer = NULL;
+	context->packCapacity = 0;
 	context->previousState = VFileMemChunk(0, 0);
 	context->currentState = VFileMemChunk(0, 0);
+	context->current = 0;
 	context->size = 0;
+	context->memoryUsed = 0;
+	context->memoryBudget = 0;
 	context->rewindFrameCounter = 0;
 #ifndef DISABLE_THREADING
 	context->onThread = onThread;
@@ -65,15 +78,141 @@ void mCoreRewindContextDeinit(struct mCoreRewindContext* context) {
 	context->currentState = NULL;
 	size_t s;
 	for (s = 0; s < mCoreRewindPatchesSize(&context->patchMemory); ++s) {
-		deinitPatchFast(mCoreRewindPatchesGetPointer(&context->patchMemory, s));
+		free(mCoreRewindPatchesGetPointer(&context->patchMemory, s)->data);
 	}
 	mCoreRewindPatchesDeinit(&context->patchMemory);
+	deinitPatchFast(&context->patch);
+	free(context->packBuffer);
+	context->packBuffer = NULL;
+	context->packCapacity = 0;
+}
+
+static void _freePatch(struct mCoreRewindContext* context, size_t index) {
+	struct mCoreRewindPatch* patch = mCoreRewindPatchesGetPointer(&context->patchMemory, index);
+	context->memoryUsed -= patch->size;
+	free(patch->data);
+	patch->data = NULL;
+	patch->size = 0;
+}
+
+static void _enforceBudget(struct mCoreRewindContext* context) {
+	if (!context->memoryBudget) {
+		return;
+	}
+	size_t entries = mCoreRewindPatchesSize(&context->patchMemory);
+	while (context->memoryUsed > context->memoryBudget && context->size > 1) {
+		// The oldest delta is the one furthest behind the current position in the ring
+		_freePatch(context, (context->current + entries - context->size + 1) % entries);
+		--context->size;
+	}
+}
+
+void mCoreRewindContextSetMemoryBudget(struct mCoreRewindContext* context, size_t bytes) {
+	if (!context->currentState) {
+		return;
+	}
+#ifndef DISABLE_THREADING
+	if (context->onThread) {
+		MutexLock(&context->mutex);
+	}
+#endif
+	context->memoryBudget = bytes;
+	_enforceBudget(context);
+#ifndef DISABLE_THREADING
+	if (context->onThread) {
+		MutexUnlock(&context->mutex);
+	}
+#endif
+}
+
+static uint8_t* _packExtent(uint8_t* out, const uint8_t* data, size_t length) {
+	// XOR deltas are mostly zero bytes even inside changed extents, so store them as
+	// alternating literal spans and zero runs. Lone zero bytes stay in the literal span.
+	size_t i = 0;
+	while (i < length) {
+		size_t run = 0;
+		while (i + run < length && !data[i + run] && run < PACK_MAX_RUN) {
+			++run;
+		}
+		if (run) {
+			*out = PACK_RUN_FLAG | (run - 1);
+			++out;
+			i += run;
+			continue;
+		}
+		size_t literal = 1;
+		while (i + literal < length && literal < PACK_MAX_RUN &&
+		       (data[i + literal] || (i + literal + 1 < length && data[i + literal + 1]))) {
+			++literal;
+		}
+		*out = literal - 1;
+		memcpy(&out[1], &data[i], literal);
+		out += literal + 1;
+		i += literal;
+	}
+	return out;
+}
+
+static size_t _packPatch(struct mCoreRewindContext* context) {
+	size_t maxSize = 0;
+	size_t e;
+	for (e = 0; e < PatchFastExtentsSize(&context->patch.extents); ++e) {
+		size_t length = PatchFastExtentsGetPointer(&context->patch.extents, e)->length;
+		maxSize += sizeof(uint32_t) * 2 + length + length / PACK_MAX_RUN + 1;
+	}
+	if (maxSize > context->packCapacity) {
+		context->packCapacity = toPow2(maxSize);
+		context->packBuffer = realloc(context->packBuffer, context->packCapacity);
+	}
+	uint8_t* out = context->packBuffer;
+	for (e = 0; e < PatchFastExtentsSize(&context->patch.extents); ++e) {
+		struct PatchFastExtent* extent = PatchFastExtentsGetPointer(&context->patch.extents, e);
+		uint32_t header[2] = { extent->offset, extent->length };
+		memcpy(out, header, sizeof(header));
+		out = _packExtent(out + sizeof(header), (const uint8_t*) extent->extent, extent->length);
+	}
+	return out - context->packBuffer;
+}
+
+static bool _unpackPatch(const struct mCoreRewindPatch* patch, uint8_t* out, size_t size) {
+	const uint8_t* data = patch->data;
+	const uint8_t* end = data + patch->size;
+	while (data < end) {
+		uint32_t header[2];
+		memcpy(header, data, sizeof(header));
+		data += sizeof(header);
+		if (header[0] + header[1] > size) {
+			return false;
+		}
+		uint8_t* ptr = &out[header[0]];
+		uint8_t* extentEnd = ptr + header[1];
+		while (ptr < extentEnd) {
+			uint8_t op = *data;
+			++data;
+			size_t length = (op & ~PACK_RUN_FLAG) + 1;
+			if (op & PACK_RUN_FLAG) {
+				ptr += length;
+				continue;
+			}
+			size_t i;
+			for (i = 0; i < length; ++i) {
+				ptr[i] ^= data[i];
+			}
+			ptr += length;
+			data += length;
+		}
+	}
+	return true;
 }
 
 void mCoreRewindAppend(struct mCoreRewindContext* context, struct mCore* core) {
+	mTRACE_BEGIN("Rewind append");
 #ifndef DISABLE_THREADING
 	if (context->onThread) {
+		// Waiting here means the diffing thread is still busy with the last state
+		mTRACE_BEGIN("Rewind wait");
 		MutexLock(&context->mutex);
+		mTRACE_END();
 	}
 #endif
 	struct VFile* nextState = context->previousState;
@@ -85,10 +224,12 @@ void mCoreRewindAppend(struct mCoreRewindContext* context, struct mCore* core) {
 		context->ready = true;
 		ConditionWake(&context->cond);
 		MutexUnlock(&context->mutex);
+		mTRACE_END();
 		return;
 	}
 #endif
 	_rewindDiff(context);
+	mTRACE_END();
 }
 
 void _rewindDiff(struct mCoreRewindContext* context) {
@@ -99,7 +240,6 @@ void _rewindDiff(struct mCoreRewindContext* context) {
 	if (context->current >= mCoreRewindPatchesSize(&context->patchMemory)) {
 		context->current = 0;
 	}
-	struct PatchFast* patch = mCoreRewindPatchesGetPointer(&context->patchMemory, context->current);
 	size_t size2 = context->currentState->size(context->currentState);
 	size_t size = context->previousState->size(context->previousState);
 	if (size2 > size) {
@@ -110,43 +250,83 @@ void _rewindDiff(struct mCoreRewindContext* context) {
 	}
 	void* current = context->previousState->map(context->previousState, size, MAP_READ);
 	void* next = context->currentState->map(context->currentState, size, MAP_READ);
-	diffPatchFast(patch, current, next, size);
+	diffPatchFast(&context->patch, current, next, size);
 	context->previousState->unmap(context->previousState, current, size);
 	context->currentState->unmap(context->currentState, next, size);
+
+	_freePatch(context, context->current);
+	struct mCoreRewindPatch* patch = mCoreRewindPatchesGetPointer(&context->patchMemory, context->current);
+	size_t packed = _packPatch(context);
+	if (packed) {
+		patch->data = malloc(packed);
+		memcpy(patch->data, context->packBuffer, packed);
+		patch->size = packed;
+		context->memoryUsed += packed;
+	}
+	_enforceBudget(context);
 }
 
 bool mCoreRewindRestore(struct mCoreRewindContext* context, struct mCore* core) {
+	return mCoreRewindRestoreMany(context, core, 1) > 0;
+}
+
+size_t mCoreRewindRestoreMany(struct mCoreRewindContext* context, struct mCore* core, size_t count) {
 #ifndef DISABLE_THREADING
 	if (context->onThread) {
 		MutexLock(&context->mutex);
 	}
 #endif
-	if (!context->size) {
+	if (!context->size || !count) {
 #ifndef DISABLE_THREADING
 		if (context->onThread) {
 			MutexUnlock(&context->mutex);
 		}
 #endif
-		return false;
+		return 0;
+	}
+	if (count > context->size) {
+		count = context->size;
 	}
-	--context->size;
 
-	mCoreLoadStateNamed(core, context->previousState, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
+	// The newest delta is only needed to get from the current state to the previous one, which we already have
+	_freePatch(context, context->current);
+	--context->size;
 	if (context->current == 0) {
 		context->current = mCoreRewindPatchesSize(&context->patchMemory);
 	}
 	--context->current;
 
+	// Going back further, the deltas in between are XORed into the previous state one after another,
+	// so only the target state ever gets loaded
+	if (count > 1) {
+		size_t size = context->previousState->size(context->previousState);
+		void* target = context->previousState->map(context->previousState, size, MAP_WRITE);
+		size_t i;
+		for (i = 1; i < count; ++i) {
+			_unpackPatch(mCoreRewindPatchesGetPointer(&context->patchMemory, context->current), target, size);
+			_freePatch(context, context->current);
+			--context->size;
+			if (context->current == 0) {
+				context->current = mCoreRewindPatchesSize(&context->patchMemory);
+			}
+			--context->current;
+		}
+		context->previousState->unmap(context->previousState, target, size);
+	}
+
+	mCoreLoadStateNamed(core, context->previousState, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
+
 	if (context->size) {
-		struct PatchFast* patch = mCoreRewindPatchesGetPointer(&context->patchMemory, context->current);
+		struct mCoreRewindPatch* patch = mCoreRewindPatchesGetPointer(&context->patchMemory, context->current);
 		size_t size2 = context->previousState->size(context->previousState);
 		size_t size = context->currentState->size(context->currentState);
 		if (size2 < size) {
 			size = size2;
 		}
-		void* current = context->currentState->map(context->currentState, size, MAP_READ);
-		void* previous = context->previousState->map(context->previousState, size, MAP_WRITE);
-		patch->d.applyPatch(&patch->d, previous, size, current, size);
+		void* current = context->currentState->map(context->currentState, size, MAP_WRITE);
+		void* previous = context->previousState->map(context->previousState, size, MAP_READ);
+		memcpy(current, previous, size);
+		_unpackPatch(patch, current, size);
 		context->currentState->unmap(context->currentState, current, size);
 		context->previousState->unmap(context->previousState, previous, size);
 	}
@@ -158,20 +338,23 @@ bool mCoreRewindRestore(struct mCoreRewindContext* context, struct mCore* core)
 		MutexUnlock(&context->mutex);
 	}
 #endif
-	return true;
+	return count;
 }
 
 #ifndef DISABLE_THREADING
 THREAD_ENTRY _rewindThread(void* context) {
 	struct mCoreRewindContext* rewindContext = context;
 	ThreadSetName("Rewind Diffing");
+	mTRACE_THREAD_NAME("Rewind Diffing");
 	MutexLock(&rewindContext->mutex);
 	while (rewindContext->onThread) {
 		while (!rewindContext->ready && rewindContext->onThread) {
 			ConditionWait(&rewindContext->cond, &rewindContext->mutex);
 		}
 		if (rewindContext->ready) {
+			mTRACE_BEGIN("Rewind diff");
 			_rewindDiff(rewindContext);
+			mTRACE_END();
 		}
 		rewindContext->ready = false;
 	}
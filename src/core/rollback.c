@@ -0,0 +1,141 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/rollback.h>
+
+#include <mgba/core/core.h>
+#include <mgba-util/memory.h>
+
+static void _setInputs(struct mCoreRollback* rollback, const uint32_t* inputs) {
+	rollback->core->setKeys(rollback->core, inputs[0]);
+}
+
+static struct mCoreRollbackInput* _input(struct mCoreRollback* rollback, uint32_t frame) {
+	return &rollback->inputs[frame % (rollback->window * 2)];
+}
+
+void mCoreRollbackInit(struct mCoreRollback* rollback, struct mCore* core, unsigned players, unsigned localPlayer, size_t window) {
+	memset(rollback, 0, sizeof(*rollback));
+	if (players > mCORE_ROLLBACK_MAX_PLAYERS) {
+		players = mCORE_ROLLBACK_MAX_PLAYERS;
+	}
+	if (!window) {
+		window = 1;
+	}
+	rollback->core = core;
+	rollback->players = players;
+	rollback->localPlayer = localPlayer;
+	rollback->window = window;
+	rollback->setInputs = _setInputs;
+
+	size_t stateSize = core->stateSize(core);
+	rollback->frames = calloc(window, sizeof(*rollback->frames));
+	rollback->inputs = calloc(window * 2, sizeof(*rollback->inputs));
+	size_t i;
+	for (i = 0; i < window; ++i) {
+		rollback->frames[i].state = anonymousMemoryMap(stateSize);
+	}
+}
+
+void mCoreRollbackDeinit(struct mCoreRollback* rollback) {
+	size_t stateSize = rollback->core->stateSize(rollback->core);
+	size_t i;
+	for (i = 0; i < rollback->window; ++i) {
+		mappedMemoryFree(rollback->frames[i].state, stateSize);
+	}
+	free(rollback->frames);
+	free(rollback->inputs);
+	rollback->frames = NULL;
+	rollback->inputs = NULL;
+}
+
+void mCoreRollbackSetLocalKeys(struct mCoreRollback* rollback, uint32_t keys) {
+	rollback->localKeys = keys;
+}
+
+bool mCoreRollbackAddInput(struct mCoreRollback* rollback, unsigned player, uint32_t frame, uint32_t keys) {
+	if (player >= rollback->players) {
+		return false;
+	}
+	if (frame + rollback->window < rollback->frame) {
+		// Inputs this old can only be duplicates, since we don't advance past unconfirmed frames
+		return frame < rollback->confirmedFrame;
+	}
+	if (frame >= rollback->frame + rollback->window) {
+		return false;
+	}
+	struct mCoreRollbackInput* input = _input(rollback, frame);
+	if (input->confirmed & (1 << player)) {
+		return true;
+	}
+	input->keys[player] = keys;
+	input->confirmed |= 1 << player;
+	if (frame >= rollback->lastFrame[player]) {
+		rollback->lastKeys[player] = keys;
+		rollback->lastFrame[player] = frame;
+	}
+
+	if (frame < rollback->frame && frame < rollback->resimulateFrom &&
+	    rollback->frames[frame % rollback->window].used[player] != keys) {
+		rollback->resimulateFrom = frame;
+	}
+
+	unsigned allPlayers = (1 << rollback->players) - 1;
+	while (rollback->confirmedFrame < rollback->frame + rollback->window &&
+	       _input(rollback, rollback->confirmedFrame)->confirmed == allPlayers) {
+		++rollback->confirmedFrame;
+	}
+	return true;
+}
+
+static void _runFrame(struct mCoreRollback* rollback, uint32_t frame, bool save) {
+	struct mCore* core = rollback->core;
+	struct mCoreRollbackFrame* slot = &rollback->frames[frame % rollback->window];
+	struct mCoreRollbackInput* input = _input(rollback, frame);
+	if (save) {
+		core->saveStateIncremental(core, slot->state, &slot->epoch);
+	}
+	unsigned i;
+	for (i = 0; i < rollback->players; ++i) {
+		if (input->confirmed & (1 << i)) {
+			slot->used[i] = input->keys[i];
+		} else {
+			// Assume players keep holding whatever they were last known to be holding
+			slot->used[i] = rollback->lastKeys[i];
+		}
+	}
+	rollback->setInputs(rollback, slot->used);
+	core->runFrame(core);
+}
+
+bool mCoreRollbackRunFrame(struct mCoreRollback* rollback) {
+	if (rollback->frame - rollback->confirmedFrame >= rollback->window) {
+		return false;
+	}
+	mCoreRollbackAddInput(rollback, rollback->localPlayer, rollback->frame, rollback->localKeys);
+	if (rollback->localInput) {
+		rollback->localInput(rollback, rollback->frame, rollback->localKeys);
+	}
+
+	if (rollback->resimulateFrom < rollback->frame) {
+		uint32_t frame = rollback->resimulateFrom;
+		rollback->core->loadState(rollback->core, rollback->frames[frame % rollback->window].state);
+		// The state for the first frame was just loaded, so there's no need to save it again
+		_runFrame(rollback, frame, false);
+		for (++frame; frame < rollback->frame; ++frame) {
+			_runFrame(rollback, frame, true);
+		}
+		++rollback->rollbacks;
+		rollback->resimulatedFrames += rollback->frame - rollback->resimulateFrom;
+	}
+
+	_runFrame(rollback, rollback->frame, true);
+	++rollback->frame;
+	rollback->resimulateFrom = rollback->frame;
+
+	// The oldest input slot falls out of the rollback window and gets reused for the furthest future frame
+	memset(_input(rollback, rollback->frame + rollback->window - 1), 0, sizeof(struct mCoreRollbackInput));
+	return true;
+}
@@ -0,0 +1,123 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/rom-image.h>
+
+#define COMPARE_BLOCK_SIZE 0x1000
+
+static void _detachImage(uint32_t key, void* value, void* user) {
+	UNUSED(key);
+	UNUSED(user);
+	struct mROMImage* image = value;
+	image->registry = NULL;
+}
+
+void mROMImageRegistryInit(struct mROMImageRegistry* registry) {
+	MutexInit(&registry->mutex);
+	TableInit(&registry->images, 0, NULL);
+}
+
+void mROMImageRegistryDeinit(struct mROMImageRegistry* registry) {
+	MutexLock(&registry->mutex);
+	TableEnumerate(&registry->images, _detachImage, NULL);
+	TableDeinit(&registry->images);
+	MutexUnlock(&registry->mutex);
+	MutexDeinit(&registry->mutex);
+}
+
+struct mROMImage* mROMImageRegistryAcquire(struct mROMImageRegistry* registry, const void* rom, size_t size, size_t mapSize, uint32_t crc32) {
+	if (size > mapSize) {
+		return NULL;
+	}
+	MutexLock(&registry->mutex);
+	struct mROMImage* image = TableLookup(&registry->images, crc32);
+	if (image) {
+		// Different ROMs with the same CRC32 are vanishingly rare, but they don't get to share
+		if (image->size != size || image->memory.size != mapSize || memcmp(image->memory.data, rom, size) != 0) {
+			image = NULL;
+		} else {
+			++image->refs;
+		}
+		MutexUnlock(&registry->mutex);
+		return image;
+	}
+
+	image = calloc(1, sizeof(*image));
+	if (!sharedMemoryCreate(&image->memory, mapSize)) {
+		MutexUnlock(&registry->mutex);
+		free(image);
+		return NULL;
+	}
+	memcpy(image->memory.data, rom, size);
+	image->registry = registry;
+	image->crc32 = crc32;
+	image->size = size;
+	image->refs = 1;
+	TableInsert(&registry->images, crc32, image);
+	MutexUnlock(&registry->mutex);
+	return image;
+}
+
+void mROMImageRetain(struct mROMImage* image) {
+	struct mROMImageRegistry* registry = image->registry;
+	if (registry) {
+		MutexLock(&registry->mutex);
+	}
+	++image->refs;
+	if (registry) {
+		MutexUnlock(&registry->mutex);
+	}
+}
+
+void mROMImageRelease(struct mROMImage* image) {
+	struct mROMImageRegistry* registry = image->registry;
+	if (registry) {
+		MutexLock(&registry->mutex);
+	}
+	--image->refs;
+	if (image->refs) {
+		if (registry) {
+			MutexUnlock(&registry->mutex);
+		}
+		return;
+	}
+	if (registry) {
+		TableRemove(&registry->images, image->crc32);
+		MutexUnlock(&registry->mutex);
+	}
+	sharedMemoryDestroy(&image->memory);
+	free(image);
+}
+
+void* mROMImageMapPrivate(struct mROMImage* image) {
+	return sharedMemoryMapPrivate(&image->memory);
+}
+
+void* mROMImageMapPrivateCopy(struct mROMImage* image, const void* rom, size_t size) {
+	uint8_t* memory = sharedMemoryMapPrivate(&image->memory);
+	if (!memory) {
+		return NULL;
+	}
+	if (size > image->memory.size) {
+		size = image->memory.size;
+	}
+	const uint8_t* source = rom;
+	size_t offset;
+	for (offset = 0; offset < size; offset += COMPARE_BLOCK_SIZE) {
+		size_t block = size - offset;
+		if (block > COMPARE_BLOCK_SIZE) {
+			block = COMPARE_BLOCK_SIZE;
+		}
+		// Reading a page doesn't unshare it, but writing to it does
+		if (memcmp(&memory[offset], &source[offset], block) != 0) {
+			memcpy(&memory[offset], &source[offset], block);
+		}
+	}
+	return memory;
+}
+
+void mROMImageUnmapPrivate(struct mROMImage* image, void* memory) {
+	sharedMemoryUnmapPrivate(&image->memory, memory);
+}
@@ -0,0 +1,435 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/scripting.h>
+
+#include <mgba/core/core.h>
+#include <mgba/script/base.h>
+#include <mgba/script/context.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
+
+struct mScriptSnapshotDomain {
+	struct mScriptCoreWorker* worker;
+	struct mCoreMemoryBlock block;
+	size_t index;
+	uint8_t* data;
+	size_t size;
+};
+
+struct mScriptSnapshotWrite {
+	size_t domain;
+	uint32_t offset;
+	uint32_t value;
+	int width;
+};
+
+DECLARE_VECTOR(mScriptSnapshotDomainList, struct mScriptValue*);
+DEFINE_VECTOR(mScriptSnapshotDomainList, struct mScriptValue*);
+DECLARE_VECTOR(mScriptSnapshotWriteList, struct mScriptSnapshotWrite);
+DEFINE_VECTOR(mScriptSnapshotWriteList, struct mScriptSnapshotWrite);
+
+struct mScriptCoreWorker {
+	struct mScriptContext context;
+	struct mCore* core;
+	struct mScriptValue memory;
+	struct mScriptSnapshotDomainList domains;
+	// Only touched by whoever is running scripts, and applied once the worker is idle again
+	struct mScriptSnapshotWriteList writes;
+	uint32_t frame;
+
+	Thread thread;
+	Mutex mutex;
+	Condition cond;
+	bool busy;
+	bool exiting;
+};
+
+mSCRIPT_DECLARE_STRUCT(mScriptCoreWorker);
+mSCRIPT_DECLARE_STRUCT(mScriptSnapshotDomain);
+
+static uint32_t _mScriptSnapshotDomainRead(const struct mScriptSnapshotDomain* domain, uint32_t address, int width) {
+	if (!domain->data || address >= domain->size || domain->size - address < (size_t) width) {
+		return 0;
+	}
+	uint32_t value;
+	switch (width) {
+	case 1:
+		return domain->data[address];
+	case 2:
+		LOAD_16LE(value, address, domain->data);
+		return value & 0xFFFF;
+	case 4:
+		LOAD_32LE(value, address, domain->data);
+		return value;
+	}
+	return 0;
+}
+
+static uint32_t mScriptSnapshotDomainRead8(struct mScriptSnapshotDomain* domain, uint32_t address) {
+	return _mScriptSnapshotDomainRead(domain, address, 1);
+}
+
+static uint32_t mScriptSnapshotDomainRead16(struct mScriptSnapshotDomain* domain, uint32_t address) {
+	return _mScriptSnapshotDomainRead(domain, address, 2);
+}
+
+static uint32_t mScriptSnapshotDomainRead32(struct mScriptSnapshotDomain* domain, uint32_t address) {
+	return _mScriptSnapshotDomainRead(domain, address, 4);
+}
+
+static struct mScriptValue* mScriptSnapshotDomainReadRange(struct mScriptSnapshotDomain* domain, uint32_t address, uint32_t length) {
+	struct mScriptValue* value = mScriptStringCreateEmpty(length);
+	char* buffer = value->value.string->buffer;
+	if (!domain->data || address >= domain->size) {
+		memset(buffer, 0, length);
+		return value;
+	}
+	size_t available = domain->size - address;
+	if (available > length) {
+		available = length;
+	}
+	memcpy(buffer, &domain->data[address], available);
+	memset(&buffer[available], 0, length - available);
+	return value;
+}
+
+static void _mScriptSnapshotDomainWrite(struct mScriptSnapshotDomain* domain, uint32_t address, uint32_t value, int width) {
+	if (!domain->worker) {
+		return;
+	}
+	struct mScriptSnapshotWrite* write = mScriptSnapshotWriteListAppend(&domain->worker->writes);
+	write->domain = domain->index;
+	write->offset = address;
+	write->value = value;
+	write->width = width;
+}
+
+static void mScriptSnapshotDomainWrite8(struct mScriptSnapshotDomain* domain, uint32_t address, uint8_t value) {
+	_mScriptSnapshotDomainWrite(domain, address, value, 1);
+}
+
+static void mScriptSnapshotDomainWrite16(struct mScriptSnapshotDomain* domain, uint32_t address, uint16_t value) {
+	_mScriptSnapshotDomainWrite(domain, address, value, 2);
+}
+
+static void mScriptSnapshotDomainWrite32(struct mScriptSnapshotDomain* domain, uint32_t address, uint32_t value) {
+	_mScriptSnapshotDomainWrite(domain, address, value, 4);
+}
+
+static uint32_t mScriptSnapshotDomainSize(const struct mScriptSnapshotDomain* domain) {
+	return domain->size;
+}
+
+static struct mScriptValue* mScriptSnapshotDomainName(const struct mScriptSnapshotDomain* domain) {
+	return mScriptStringCreateFromUTF8(domain->block.shortName);
+}
+
+static void mScriptSnapshotDomainDeinit(struct mScriptSnapshotDomain* domain) {
+	free(domain->data);
+}
+
+static uint32_t mScriptCoreWorkerCurrentFrame(const struct mScriptCoreWorker* worker) {
+	return worker->frame;
+}
+
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSnapshotDomain, U32, read8, mScriptSnapshotDomainRead8, 1, U32, address);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSnapshotDomain, U32, read16, mScriptSnapshotDomainRead16, 1, U32, address);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSnapshotDomain, U32, read32, mScriptSnapshotDomainRead32, 1, U32, address);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSnapshotDomain, WSTR, readRange, mScriptSnapshotDomainReadRange, 2, U32, address, U32, length);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptSnapshotDomain, write8, mScriptSnapshotDomainWrite8, 2, U32, address, U8, value);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptSnapshotDomain, write16, mScriptSnapshotDomainWrite16, 2, U32, address, U16, value);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptSnapshotDomain, write32, mScriptSnapshotDomainWrite32, 2, U32, address, U32, value);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptSnapshotDomain, U32, size, mScriptSnapshotDomainSize, 0);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptSnapshotDomain, WSTR, name, mScriptSnapshotDomainName, 0);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptSnapshotDomain, _deinit, mScriptSnapshotDomainDeinit, 0);
+
+mSCRIPT_DEFINE_STRUCT(mScriptSnapshotDomain)
+	mSCRIPT_DEFINE_CLASS_DOCSTRING(
+		"A copy of a memory domain taken at the end of the last frame, for scripts running off the emulation thread. "
+		"Reads never block emulation; writes are queued and applied at the next frame boundary."
+	)
+	mSCRIPT_DEFINE_DOCSTRING("Read an 8-bit value from the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSnapshotDomain, read8)
+	mSCRIPT_DEFINE_DOCSTRING("Read a 16-bit value from the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSnapshotDomain, read16)
+	mSCRIPT_DEFINE_DOCSTRING("Read a 32-bit value from the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSnapshotDomain, read32)
+	mSCRIPT_DEFINE_DOCSTRING("Read byte range from the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSnapshotDomain, readRange)
+	mSCRIPT_DEFINE_DOCSTRING("Queue an 8-bit write to the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSnapshotDomain, write8)
+	mSCRIPT_DEFINE_DOCSTRING("Queue a 16-bit write to the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSnapshotDomain, write16)
+	mSCRIPT_DEFINE_DOCSTRING("Queue a 32-bit write to the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSnapshotDomain, write32)
+	mSCRIPT_DEFINE_DOCSTRING("Get the size of this memory domain in bytes")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSnapshotDomain, size)
+	mSCRIPT_DEFINE_DOCSTRING("Get a short, human-readable name for this memory domain")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSnapshotDomain, name)
+	mSCRIPT_DEFINE_STRUCT_DEINIT(mScriptSnapshotDomain)
+mSCRIPT_DEFINE_END;
+
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptCoreWorker, U32, currentFrame, mScriptCoreWorkerCurrentFrame, 0);
+
+mSCRIPT_DEFINE_STRUCT(mScriptCoreWorker)
+	mSCRIPT_DEFINE_CLASS_DOCSTRING(
+		"The emulator as seen from scripts running on a worker thread. "
+		"Only **frame** callbacks are delivered, and memory is accessed through per-frame snapshots."
+	)
+	mSCRIPT_DEFINE_DOCSTRING("A table containing a platform-specific set of struct::mScriptSnapshotDomain objects")
+	mSCRIPT_DEFINE_STRUCT_MEMBER(mScriptCoreWorker, TABLE, memory)
+	mSCRIPT_DEFINE_DOCSTRING("Get the number of the frame the current snapshot was taken at")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreWorker, currentFrame)
+mSCRIPT_DEFINE_END;
+
+static void _applyWrites(struct mScriptCoreWorker* worker) {
+	struct mCore* core = worker->core;
+	size_t i;
+	for (i = 0; i < mScriptSnapshotWriteListSize(&worker->writes); ++i) {
+		const struct mScriptSnapshotWrite* write = mScriptSnapshotWriteListGetConstPointer(&worker->writes, i);
+		const struct mScriptSnapshotDomain* domain = mScriptSnapshotDomainListGetConstPointer(&worker->domains, write->domain)[0]->value.opaque;
+		const struct mCoreMemoryBlock* block = &domain->block;
+		uint32_t segmentSize = block->end - block->start;
+		uint32_t segmentStart = 0;
+		if (block->segmentStart) {
+			segmentStart = block->segmentStart - block->start;
+			segmentSize -= segmentStart;
+		}
+		uint32_t address = write->offset % segmentSize + block->start;
+		int segment = write->offset / segmentSize;
+		if (block->segmentStart && segment) {
+			address += segmentStart;
+		}
+		switch (write->width) {
+		case 1:
+			core->rawWrite8(core, address, segment, write->value);
+			break;
+		case 2:
+			core->rawWrite16(core, address, segment, write->value);
+			break;
+		case 4:
+			core->rawWrite32(core, address, segment, write->value);
+			break;
+		}
+	}
+	mScriptSnapshotWriteListClear(&worker->writes);
+}
+
+static void _takeSnapshot(struct mScriptCoreWorker* worker) {
+	struct mCore* core = worker->core;
+	size_t i;
+	for (i = 0; i < mScriptSnapshotDomainListSize(&worker->domains); ++i) {
+		struct mScriptSnapshotDomain* domain = mScriptSnapshotDomainListGetPointer(&worker->domains, i)[0]->value.opaque;
+		size_t size = 0;
+		const uint8_t* live = core->getMemoryBlock(core, domain->block.id, &size);
+		if (!live) {
+			size = 0;
+		}
+		if (size > domain->size) {
+			size = domain->size;
+		}
+		memcpy(domain->data, live, size);
+		memset(&domain->data[size], 0, domain->size - size);
+	}
+	worker->frame = core->frameCounter(core);
+}
+
+static void _runFrame(struct mScriptCoreWorker* worker) {
+	mScriptContextTriggerCallbackEvent(&worker->context, mSCRIPT_CALLBACK_FRAME, NULL);
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _workerThread(void* context) {
+	struct mScriptCoreWorker* worker = context;
+	ThreadSetName("Script Worker");
+
+	MutexLock(&worker->mutex);
+	while (true) {
+		while (!worker->busy && !worker->exiting) {
+			ConditionWait(&worker->cond, &worker->mutex);
+		}
+		if (worker->exiting) {
+			break;
+		}
+		MutexUnlock(&worker->mutex);
+		_runFrame(worker);
+		MutexLock(&worker->mutex);
+		worker->busy = false;
+		ConditionWake(&worker->cond);
+	}
+	MutexUnlock(&worker->mutex);
+	THREAD_EXIT(0);
+}
+#endif
+
+struct mScriptCoreWorker* mScriptCoreWorkerCreate(void) {
+	struct mScriptCoreWorker* worker = calloc(1, sizeof(*worker));
+	mScriptContextInit(&worker->context);
+	mScriptContextAttachStdlib(&worker->context);
+	mScriptContextRegisterEngines(&worker->context);
+
+	worker->memory.refs = mSCRIPT_VALUE_UNREF;
+	worker->memory.flags = 0;
+	worker->memory.type = mSCRIPT_TYPE_MS_TABLE;
+	worker->memory.type->alloc(&worker->memory);
+	mScriptSnapshotDomainListInit(&worker->domains, 0);
+	mScriptSnapshotWriteListInit(&worker->writes, 0);
+
+	struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_S(mScriptCoreWorker));
+	value->value.opaque = worker;
+	mScriptContextSetGlobal(&worker->context, "emu", value);
+
+	MutexInit(&worker->mutex);
+	ConditionInit(&worker->cond);
+#ifndef DISABLE_THREADING
+	ThreadCreate(&worker->thread, _workerThread, worker);
+#endif
+	return worker;
+}
+
+void mScriptCoreWorkerDestroy(struct mScriptCoreWorker* worker) {
+	mScriptCoreWorkerDetachCore(worker);
+
+	MutexLock(&worker->mutex);
+	worker->exiting = true;
+	ConditionWake(&worker->cond);
+	MutexUnlock(&worker->mutex);
+#ifndef DISABLE_THREADING
+	ThreadJoin(&worker->thread);
+#endif
+	ConditionDeinit(&worker->cond);
+	MutexDeinit(&worker->mutex);
+
+	mScriptContextDeinit(&worker->context);
+	worker->memory.type->free(&worker->memory);
+	mScriptSnapshotDomainListDeinit(&worker->domains);
+	mScriptSnapshotWriteListDeinit(&worker->writes);
+	free(worker);
+}
+
+struct mScriptContext* mScriptCoreWorkerGetContext(struct mScriptCoreWorker* worker) {
+	return &worker->context;
+}
+
+struct mScriptEngineMatch {
+	const char* name;
+	struct VFile* vf;
+	struct mScriptEngineContext* context;
+};
+
+static void _findEngine(const char* key, void* value, void* user) {
+	UNUSED(key);
+	struct mScriptEngineMatch* match = user;
+	struct mScriptEngineContext* engine = value;
+	if (!match->context && engine->isScript(engine, match->name, match->vf)) {
+		match->context = engine;
+	}
+}
+
+bool mScriptCoreWorkerLoadVF(struct mScriptCoreWorker* worker, const char* name, struct VFile* vf) {
+	struct mScriptEngineMatch match = {
+		.name = name,
+		.vf = vf,
+	};
+	MutexLock(&worker->mutex);
+	while (worker->busy) {
+		ConditionWait(&worker->cond, &worker->mutex);
+	}
+	HashTableEnumerate(&worker->context.engines, _findEngine, &match);
+	bool ok = match.context && match.context->load(match.context, name, vf) && match.context->run(match.context);
+	MutexUnlock(&worker->mutex);
+	return ok;
+}
+
+void mScriptCoreWorkerAttachCore(struct mScriptCoreWorker* worker, struct mCore* core) {
+	mScriptCoreWorkerDetachCore(worker);
+
+	MutexLock(&worker->mutex);
+	worker->core = core;
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
+	size_t i;
+	for (i = 0; i < nBlocks; ++i) {
+		if (blocks[i].flags == mCORE_MEMORY_VIRTUAL || !(blocks[i].flags & mCORE_MEMORY_WRITE)) {
+			continue;
+		}
+		size_t size = 0;
+		if (!core->getMemoryBlock(core, blocks[i].id, &size) || !size) {
+			continue;
+		}
+		struct mScriptSnapshotDomain* domain = calloc(1, sizeof(*domain));
+		domain->worker = worker;
+		memcpy(&domain->block, &blocks[i], sizeof(domain->block));
+		domain->index = mScriptSnapshotDomainListSize(&worker->domains);
+		domain->size = size;
+		domain->data = calloc(1, size);
+
+		struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_S(mScriptSnapshotDomain));
+		value->flags = mSCRIPT_VALUE_FLAG_FREE_BUFFER;
+		value->value.opaque = domain;
+		*mScriptSnapshotDomainListAppend(&worker->domains) = value;
+
+		struct mScriptValue* key = mScriptStringCreateFromUTF8(blocks[i].internalName);
+		mScriptTableInsert(&worker->memory, key, value);
+		mScriptValueDeref(key);
+	}
+	_takeSnapshot(worker);
+	MutexUnlock(&worker->mutex);
+}
+
+void mScriptCoreWorkerDetachCore(struct mScriptCoreWorker* worker) {
+	MutexLock(&worker->mutex);
+	while (worker->busy) {
+		ConditionWait(&worker->cond, &worker->mutex);
+	}
+	if (worker->core) {
+		_applyWrites(worker);
+	}
+	size_t i;
+	for (i = 0; i < mScriptSnapshotDomainListSize(&worker->domains); ++i) {
+		struct mScriptValue* value = *mScriptSnapshotDomainListGetPointer(&worker->domains, i);
+		struct mScriptSnapshotDomain* domain = value->value.opaque;
+		// Scripts may still hold on to the domain, so leave it readable but empty
+		domain->worker = NULL;
+		free(domain->data);
+		domain->data = NULL;
+		domain->size = 0;
+		mScriptValueDeref(value);
+	}
+	mScriptSnapshotDomainListClear(&worker->domains);
+	mScriptTableClear(&worker->memory);
+	worker->core = NULL;
+	MutexUnlock(&worker->mutex);
+}
+
+void mScriptCoreWorkerFrameEnded(struct mScriptCoreWorker* worker) {
+	// Never hold up emulation: if the worker is loading a script or is still running the
+	// callbacks for an earlier frame, it just doesn't see this one
+	if (MutexTryLock(&worker->mutex)) {
+		return;
+	}
+	if (!worker->core || worker->busy) {
+		MutexUnlock(&worker->mutex);
+		return;
+	}
+	_applyWrites(worker);
+	_takeSnapshot(worker);
+#ifdef DISABLE_THREADING
+	_runFrame(worker);
+#else
+	worker->busy = true;
+	ConditionWake(&worker->cond);
+#endif
+	MutexUnlock(&worker->mutex);
+}
+
+void mScriptCoreWorkerWait(struct mScriptCoreWorker* worker) {
+	MutexLock(&worker->mutex);
+	while (worker->busy) {
+		ConditionWait(&worker->cond, &worker->mutex);
+	}
+	MutexUnlock(&worker->mutex);
+}
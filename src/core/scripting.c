@@ -7,6 +7,8 @@
 
 #include <mgba/core/core.h>
 #include <mgba/core/serialize.h>
+#include <mgba/core/thread.h>
+#include <mgba/core/timing.h>
 #ifdef M_CORE_GBA
 #include <mgba/gba/interface.h>
 #endif
@@ -157,6 +159,13 @@ bool mScriptBridgeLookupSymbol(struct mScriptBridge* sb, const char* name, int32
 struct mScriptMemoryDomain {
 	struct mCore* core;
 	struct mCoreMemoryBlock block;
+	struct mScriptValue* self;
+};
+
+struct mScriptMemoryView {
+	struct mScriptValue* domain;
+	uint32_t offset;
+	uint32_t size;
 };
 
 #ifdef USE_DEBUGGERS
@@ -185,10 +194,35 @@ struct mScriptDebugger {
 };
 #endif
 
+struct mScriptMemoryCallback {
+	int64_t id;
+	uint32_t base;
+	struct mCoreMemoryWatchRange range;
+	struct mScriptValue* fn;
+};
+
+struct mScriptMemoryWrite {
+	uint32_t address;
+	uint32_t value;
+	int width;
+};
+
+DECLARE_VECTOR(mScriptMemoryCallbackList, struct mScriptMemoryCallback);
+DEFINE_VECTOR(mScriptMemoryCallbackList, struct mScriptMemoryCallback);
+DECLARE_VECTOR(mScriptMemoryWriteList, struct mScriptMemoryWrite);
+DEFINE_VECTOR(mScriptMemoryWriteList, struct mScriptMemoryWrite);
+
 struct mScriptCoreAdapter {
 	struct mCore* core;
 	struct mScriptContext* context;
 	struct mScriptValue memory;
+	struct mCoreMemoryWatcher memoryWatcher;
+	struct mScriptMemoryCallbackList memoryCallbacks;
+	// Writes seen during the current instruction, delivered by memoryFlush once it finishes
+	struct mScriptMemoryWriteList memoryWrites;
+	struct mTimingEvent memoryFlush;
+	int64_t nextMemoryCallback;
+	bool flushingMemory;
 #ifdef USE_DEBUGGERS
 	struct mScriptDebugger debugger;
 #endif
@@ -210,6 +244,8 @@ struct mScriptConsole {
 	void* textBufferContext;
 };
 
+#define MAX_MEMORY_STATS 16
+
 #define CALCULATE_SEGMENT_INFO \
 	uint32_t segmentSize = adapter->block.end - adapter->block.start; \
 	uint32_t segmentStart = adapter->block.segmentStart - adapter->block.start; \
@@ -289,6 +325,183 @@ static struct mScriptValue* mScriptMemoryDomainName(struct mScriptMemoryDomain*
 	return mScriptStringCreateFromUTF8(adapter->block.shortName);
 }
 
+mSCRIPT_DECLARE_STRUCT(mScriptMemoryView);
+
+static struct mScriptValue* mScriptMemoryDomainView(struct mScriptMemoryDomain* adapter, uint32_t offset, uint32_t size) {
+	if (offset > adapter->block.size) {
+		offset = adapter->block.size;
+	}
+	if (!size || size > adapter->block.size - offset) {
+		size = adapter->block.size - offset;
+	}
+	struct mScriptMemoryView* view = calloc(1, sizeof(*view));
+	view->domain = adapter->self;
+	view->offset = offset;
+	view->size = size;
+	mScriptValueRef(adapter->self);
+
+	struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_S(mScriptMemoryView));
+	value->flags = mSCRIPT_VALUE_FLAG_FREE_BUFFER;
+	value->value.opaque = view;
+	return value;
+}
+
+static struct mScriptMemoryDomain* _mScriptMemoryViewDomain(const struct mScriptMemoryView* view, uint32_t offset, uint32_t width) {
+	struct mScriptMemoryDomain* adapter = view->domain->value.opaque;
+	if (!adapter->core) {
+		// The core this view was taken from has been detached
+		return NULL;
+	}
+	if (offset >= view->size || view->size - offset < width) {
+		return NULL;
+	}
+	return adapter;
+}
+
+static const uint8_t* _mScriptMemoryViewHost(const struct mScriptMemoryDomain* adapter, uint32_t offset, uint32_t width) {
+	// Look the block up every time, since the host buffer can move, e.g. when savedata changes type
+	size_t blockSize = 0;
+	const uint8_t* host = adapter->core->getMemoryBlock(adapter->core, adapter->block.id, &blockSize);
+	if (!host || blockSize < width || offset > blockSize - width) {
+		return NULL;
+	}
+	return &host[offset];
+}
+
+static uint32_t mScriptMemoryViewU8(const struct mScriptMemoryView* view, uint32_t offset) {
+	struct mScriptMemoryDomain* adapter = _mScriptMemoryViewDomain(view, offset, 1);
+	if (!adapter) {
+		return 0;
+	}
+	offset += view->offset;
+	const uint8_t* host = _mScriptMemoryViewHost(adapter, offset, 1);
+	if (!host) {
+		return mScriptMemoryDomainRead8(adapter, offset);
+	}
+	return host[0];
+}
+
+static uint32_t mScriptMemoryViewU16(const struct mScriptMemoryView* view, uint32_t offset) {
+	struct mScriptMemoryDomain* adapter = _mScriptMemoryViewDomain(view, offset, 2);
+	if (!adapter) {
+		return 0;
+	}
+	offset += view->offset;
+	const uint8_t* host = _mScriptMemoryViewHost(adapter, offset, 2);
+	if (!host) {
+		return mScriptMemoryDomainRead16(adapter, offset);
+	}
+	return host[0] | (host[1] << 8);
+}
+
+static uint32_t mScriptMemoryViewU32(const struct mScriptMemoryView* view, uint32_t offset) {
+	struct mScriptMemoryDomain* adapter = _mScriptMemoryViewDomain(view, offset, 4);
+	if (!adapter) {
+		return 0;
+	}
+	offset += view->offset;
+	const uint8_t* host = _mScriptMemoryViewHost(adapter, offset, 4);
+	if (!host) {
+		return mScriptMemoryDomainRead32(adapter, offset);
+	}
+	return host[0] | (host[1] << 8) | (host[2] << 16) | ((uint32_t) host[3] << 24);
+}
+
+static bool mScriptMemoryViewEquals(const struct mScriptMemoryView* view, uint32_t offset, const struct mScriptString* bytes) {
+	if (!bytes->size) {
+		return true;
+	}
+	if (bytes->size > UINT32_MAX) {
+		return false;
+	}
+	struct mScriptMemoryDomain* adapter = _mScriptMemoryViewDomain(view, offset, bytes->size);
+	if (!adapter) {
+		return false;
+	}
+	offset += view->offset;
+	const uint8_t* host = _mScriptMemoryViewHost(adapter, offset, bytes->size);
+	if (host) {
+		return memcmp(host, bytes->buffer, bytes->size) == 0;
+	}
+	size_t i;
+	for (i = 0; i < bytes->size; ++i) {
+		if (mScriptMemoryDomainRead8(adapter, offset + i) != (uint8_t) bytes->buffer[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static int64_t mScriptMemoryViewFind(const struct mScriptMemoryView* view, const struct mScriptString* bytes, uint32_t start) {
+	if (!bytes->size || bytes->size > view->size) {
+		return -1;
+	}
+	struct mScriptMemoryDomain* adapter = _mScriptMemoryViewDomain(view, start, bytes->size);
+	if (!adapter) {
+		return -1;
+	}
+	const uint8_t* host = _mScriptMemoryViewHost(adapter, view->offset, view->size);
+	uint32_t last = view->size - bytes->size;
+	uint32_t i;
+	for (i = start; i <= last; ++i) {
+		if (host) {
+			const uint8_t* match = memchr(&host[i], (uint8_t) bytes->buffer[0], last - i + 1);
+			if (!match) {
+				break;
+			}
+			i = match - host;
+			if (memcmp(match, bytes->buffer, bytes->size) == 0) {
+				return i;
+			}
+		} else if (mScriptMemoryViewEquals(view, i, bytes)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static uint32_t mScriptMemoryViewSize(const struct mScriptMemoryView* view) {
+	return view->size;
+}
+
+static void mScriptMemoryViewDeinit(struct mScriptMemoryView* view) {
+	mScriptValueDeref(view->domain);
+}
+
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryView, U32, u8, mScriptMemoryViewU8, 1, U32, offset);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryView, U32, u16, mScriptMemoryViewU16, 1, U32, offset);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryView, U32, u32, mScriptMemoryViewU32, 1, U32, offset);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryView, BOOL, equals, mScriptMemoryViewEquals, 2, U32, offset, STR, bytes);
+mSCRIPT_DECLARE_STRUCT_C_METHOD_WITH_DEFAULTS(mScriptMemoryView, S64, find, mScriptMemoryViewFind, 2, STR, bytes, U32, start);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryView, U32, size, mScriptMemoryViewSize, 0);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptMemoryView, _deinit, mScriptMemoryViewDeinit, 0);
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptMemoryView, find)
+	mSCRIPT_NO_DEFAULT,
+	mSCRIPT_U32(0)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
+mSCRIPT_DEFINE_STRUCT(mScriptMemoryView)
+	mSCRIPT_DEFINE_CLASS_DOCSTRING(
+		"A window into a struct::mScriptMemoryDomain that reads the emulated memory in place, "
+		"without copying it out into a string first. Offsets are relative to the start of the view. "
+		"Reads outside of the view, or from a view whose core has since been detached, return 0."
+	)
+	mSCRIPT_DEFINE_DOCSTRING("Read an 8-bit value from the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, u8)
+	mSCRIPT_DEFINE_DOCSTRING("Read a little-endian 16-bit value from the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, u16)
+	mSCRIPT_DEFINE_DOCSTRING("Read a little-endian 32-bit value from the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, u32)
+	mSCRIPT_DEFINE_DOCSTRING("Check if the bytes at the given offset match the given string")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, equals)
+	mSCRIPT_DEFINE_DOCSTRING("Find the first offset at or after `start` where the given string occurs, or -1 if it does not")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, find)
+	mSCRIPT_DEFINE_DOCSTRING("Get the size of this view in bytes")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryView, size)
+	mSCRIPT_DEFINE_STRUCT_DEINIT(mScriptMemoryView)
+mSCRIPT_DEFINE_END;
+
 mSCRIPT_DECLARE_STRUCT(mScriptMemoryDomain);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, read8, mScriptMemoryDomainRead8, 1, U32, address);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, read16, mScriptMemoryDomainRead16, 1, U32, address);
@@ -302,6 +515,12 @@ mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, base, mScriptMemoryDomai
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, bound, mScriptMemoryDomainEnd, 0);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, size, mScriptMemoryDomainSize, 0);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, WSTR, name, mScriptMemoryDomainName, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptMemoryDomain, W(mScriptMemoryView), view, mScriptMemoryDomainView, 2, U32, offset, U32, size);
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptMemoryDomain, view)
+	mSCRIPT_U32(0),
+	mSCRIPT_U32(0)
+mSCRIPT_DEFINE_DEFAULTS_END;
 
 mSCRIPT_DEFINE_STRUCT(mScriptMemoryDomain)
 	mSCRIPT_DEFINE_CLASS_DOCSTRING(
@@ -316,6 +535,12 @@ mSCRIPT_DEFINE_STRUCT(mScriptMemoryDomain)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, read32)
 	mSCRIPT_DEFINE_DOCSTRING("Read byte range from the given offset")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, readRange)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Get a struct::mScriptMemoryView of `size` bytes starting at the given offset. "
+		"If `size` is 0 or runs past the end of the domain, the view extends to the end of the domain. "
+		"Unlike readRange, this does not copy the memory, so it is much cheaper for scanning large regions every frame"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, view)
 	mSCRIPT_DEFINE_DOCSTRING("Write an 8-bit value from the given offset")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, write8)
 	mSCRIPT_DEFINE_DOCSTRING("Write a 16-bit value from the given offset")
@@ -404,6 +629,77 @@ static void _mScriptCoreWriteRegister(struct mCore* core, const char* regName, i
 	core->writeRegister(core, regName, &in);
 }
 
+static bool _mScriptCoreSetMemoryStatsEnabled(struct mCore* core, bool enable) {
+	if (!core->setMemoryStatsEnabled) {
+		return false;
+	}
+	return core->setMemoryStatsEnabled(core, enable);
+}
+
+static void _mScriptCoreInsertStat(struct mScriptValue* table, const char* name, uint64_t stat) {
+	struct mScriptValue* key = mScriptStringCreateFromUTF8(name);
+	struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_U64);
+	value->value.u64 = stat;
+	mScriptTableInsert(table, key, value);
+	mScriptValueDeref(key);
+	mScriptValueDeref(value);
+}
+
+static struct mScriptValue* _mScriptCoreMemoryStats(struct mCore* core) {
+	struct mCoreMemoryStats stats[MAX_MEMORY_STATS];
+	size_t count = 0;
+	if (core->memoryStats) {
+		count = core->memoryStats(core, stats, MAX_MEMORY_STATS);
+	}
+	if (!count) {
+		return &mScriptValueNull;
+	}
+	if (count > MAX_MEMORY_STATS) {
+		count = MAX_MEMORY_STATS;
+	}
+	struct mScriptValue* table = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		struct mScriptValue* region = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+		_mScriptCoreInsertStat(region, "start", stats[i].start);
+		_mScriptCoreInsertStat(region, "end", stats[i].end);
+		_mScriptCoreInsertStat(region, "reads", stats[i].reads);
+		_mScriptCoreInsertStat(region, "writes", stats[i].writes);
+		_mScriptCoreInsertStat(region, "waitCycles", stats[i].waitCycles);
+		_mScriptCoreInsertStat(region, "prefetchHits", stats[i].prefetchHits);
+		struct mScriptValue* key = mScriptStringCreateFromUTF8(stats[i].name);
+		mScriptTableInsert(table, key, region);
+		mScriptValueDeref(key);
+		mScriptValueDeref(region);
+	}
+	return table;
+}
+
+static struct mScriptValue* _mScriptCoreFrameTimings(struct mCore* core) {
+	struct mCoreThread* thread = mCoreThreadGet();
+	if (!thread || thread->core != core) {
+		return &mScriptValueNull;
+	}
+	struct mCoreFrameTiming timings[mCORE_THREAD_FRAME_TIMINGS];
+	size_t count = mCoreThreadGetFrameTimings(thread, timings, mCORE_THREAD_FRAME_TIMINGS);
+	struct mScriptValue* table = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		struct mScriptValue* frame = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+		_mScriptCoreInsertStat(frame, "frame", timings[i].frame);
+		_mScriptCoreInsertStat(frame, "frameNsec", timings[i].frameNsec);
+		_mScriptCoreInsertStat(frame, "emulationNsec", timings[i].emulationNsec);
+		_mScriptCoreInsertStat(frame, "videoWaitNsec", timings[i].videoWaitNsec);
+		_mScriptCoreInsertStat(frame, "audioWaitNsec", timings[i].audioWaitNsec);
+		_mScriptCoreInsertStat(frame, "presentNsec", timings[i].presentNsec);
+		struct mScriptValue* key = mScriptValueCreateFromUInt(i + 1);
+		mScriptTableInsert(table, key, frame);
+		mScriptValueDeref(key);
+		mScriptValueDeref(frame);
+	}
+	return table;
+}
+
 static struct mScriptValue* _mScriptCoreSaveState(struct mCore* core, int32_t flags) {
 	struct VFile* vf = VFileMemChunk(NULL, 0);
 	if (!mCoreSaveStateNamed(core, vf, flags)) {
@@ -521,6 +817,11 @@ mSCRIPT_DECLARE_STRUCT_VOID_D_METHOD(mCore, busWrite32, 2, U32, address, U32, va
 mSCRIPT_DECLARE_STRUCT_METHOD(mCore, WSTR, readRegister, _mScriptCoreReadRegister, 1, CHARP, regName);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mCore, writeRegister, _mScriptCoreWriteRegister, 2, CHARP, regName, S32, value);
 
+// Statistics functions
+mSCRIPT_DECLARE_STRUCT_METHOD(mCore, BOOL, setMemoryStatsEnabled, _mScriptCoreSetMemoryStatsEnabled, 1, BOOL, enable);
+mSCRIPT_DECLARE_STRUCT_METHOD(mCore, WTABLE, memoryStats, _mScriptCoreMemoryStats, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mCore, WTABLE, frameTimings, _mScriptCoreFrameTimings, 0);
+
 // Savestate functions
 mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mCore, BOOL, saveStateSlot, mCoreSaveState, 2, S32, slot, S32, flags);
 mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mCore, WSTR, saveStateBuffer, _mScriptCoreSaveState, 1, S32, flags);
@@ -604,6 +905,13 @@ mSCRIPT_DEFINE_STRUCT(mCore)
 	mSCRIPT_DEFINE_DOCSTRING("Write the value of the register with the given name")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, writeRegister)
 
+	mSCRIPT_DEFINE_DOCSTRING("Start or stop counting memory accesses per region. Emulation runs noticeably slower while counting. Starting clears the counts")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, setMemoryStatsEnabled)
+	mSCRIPT_DEFINE_DOCSTRING("Get a table of memory regions by name, each with `start`, `end`, `reads`, `writes`, `waitCycles` and `prefetchHits`, or nil if counting is off")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, memoryStats)
+	mSCRIPT_DEFINE_DOCSTRING("Get a list of the most recent frames' timings, oldest first, each with `frame`, `frameNsec`, `emulationNsec`, `videoWaitNsec`, `audioWaitNsec` and `presentNsec`. Returns nil unless the core is running on an emulation thread")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, frameTimings)
+
 	mSCRIPT_DEFINE_DOCSTRING("Save state to the slot number. See C.SAVESTATE for possible values for `flags`")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, saveStateSlot)
 	mSCRIPT_DEFINE_DOCSTRING("Save state and return as a buffer. See C.SAVESTATE for possible values for `flags`")
@@ -666,6 +974,11 @@ static void _clearMemoryMap(struct mScriptContext* context, struct mScriptCoreAd
 		while (true) {
 			struct mScriptValue* weakref = mScriptTableIteratorGetValue(&adapter->memory, &iter);
 			if (weakref) {
+				struct mScriptValue* domain = mScriptContextAccessWeakref(context, weakref);
+				if (domain) {
+					// Views may outlive the domain's weakref, so make sure they stop touching the core
+					((struct mScriptMemoryDomain*) domain->value.opaque)->core = NULL;
+				}
 				if (clear) {
 					mScriptContextClearWeakref(context, weakref->value.s32);
 				}
@@ -695,6 +1008,7 @@ static void _rebuildMemoryMap(struct mScriptContext* context, struct mScriptCore
 		struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_S(mScriptMemoryDomain));
 		value->flags = mSCRIPT_VALUE_FLAG_FREE_BUFFER;
 		value->value.opaque = memadapter;
+		memadapter->self = value;
 		struct mScriptValue* key = mScriptStringCreateFromUTF8(blocks[i].internalName);
 		mScriptTableInsert(&adapter->memory, key, mScriptContextMakeWeakref(context, value));
 		mScriptValueDeref(key);
@@ -926,8 +1240,162 @@ static bool _mScriptCoreAdapterClearBreakpoint(struct mScriptCoreAdapter* adapte
 }
 #endif
 
+static void _updateMemoryWatch(struct mScriptCoreAdapter* adapter) {
+	struct mCore* core = adapter->core;
+	if (!core->setMemoryWatcher) {
+		return;
+	}
+	size_t nCallbacks = mScriptMemoryCallbackListSize(&adapter->memoryCallbacks);
+	if (!nCallbacks) {
+		core->setMemoryWatcher(core, NULL, NULL, 0);
+		return;
+	}
+	struct mCoreMemoryWatchRange* ranges = malloc(nCallbacks * sizeof(*ranges));
+	size_t nRanges = 0;
+	size_t i;
+	for (i = 0; i < nCallbacks; ++i) {
+		const struct mScriptMemoryCallback* callback = mScriptMemoryCallbackListGetConstPointer(&adapter->memoryCallbacks, i);
+		if (callback->fn) {
+			ranges[nRanges] = callback->range;
+			++nRanges;
+		}
+	}
+	core->setMemoryWatcher(core, nRanges ? &adapter->memoryWatcher : NULL, ranges, nRanges);
+	free(ranges);
+}
+
+static void _compactMemoryCallbacks(struct mScriptCoreAdapter* adapter) {
+	size_t i;
+	for (i = 0; i < mScriptMemoryCallbackListSize(&adapter->memoryCallbacks);) {
+		if (mScriptMemoryCallbackListGetPointer(&adapter->memoryCallbacks, i)->fn) {
+			++i;
+		} else {
+			mScriptMemoryCallbackListShift(&adapter->memoryCallbacks, i, 1);
+		}
+	}
+}
+
+static void _memoryWritten(struct mCoreMemoryWatcher* watcher, uint32_t address, int width, uint32_t value) {
+	struct mScriptCoreAdapter* adapter = containerof(watcher, struct mScriptCoreAdapter, memoryWatcher);
+	struct mScriptMemoryWrite* write = mScriptMemoryWriteListAppend(&adapter->memoryWrites);
+	write->address = address;
+	write->value = value;
+	write->width = width;
+	// Scripts can't safely run in the middle of a store, so wait for the instruction to finish
+	if (!mTimingIsScheduled(adapter->core->timing, &adapter->memoryFlush)) {
+		mTimingSchedule(adapter->core->timing, &adapter->memoryFlush, 0);
+	}
+}
+
+static void _flushMemoryWrites(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	UNUSED(timing);
+	UNUSED(cyclesLate);
+	struct mScriptCoreAdapter* adapter = context;
+	struct mScriptMemoryWriteList writes;
+	memcpy(&writes, &adapter->memoryWrites, sizeof(writes));
+	mScriptMemoryWriteListInit(&adapter->memoryWrites, 0);
+
+	adapter->flushingMemory = true;
+	size_t i;
+	for (i = 0; i < mScriptMemoryWriteListSize(&writes); ++i) {
+		const struct mScriptMemoryWrite* write = mScriptMemoryWriteListGetConstPointer(&writes, i);
+		size_t j;
+		for (j = 0; j < mScriptMemoryCallbackListSize(&adapter->memoryCallbacks); ++j) {
+			struct mScriptMemoryCallback* callback = mScriptMemoryCallbackListGetPointer(&adapter->memoryCallbacks, j);
+			if (!callback->fn || write->address >= callback->range.end || write->address + write->width <= callback->range.start) {
+				continue;
+			}
+			struct mScriptFrame* frame = mScriptContextAcquireFrame(adapter->context);
+			mSCRIPT_PUSH(&frame->arguments, U32, write->address - callback->base);
+			mSCRIPT_PUSH(&frame->arguments, U32, write->value);
+			mSCRIPT_PUSH(&frame->arguments, S32, write->width);
+			mScriptContextInvoke(adapter->context, callback->fn, frame);
+			mScriptContextReleaseFrame(adapter->context, frame);
+		}
+	}
+	adapter->flushingMemory = false;
+	mScriptMemoryWriteListDeinit(&writes);
+	_compactMemoryCallbacks(adapter);
+}
+
+static void _clearMemoryCallbacks(struct mScriptCoreAdapter* adapter) {
+	size_t i;
+	for (i = 0; i < mScriptMemoryCallbackListSize(&adapter->memoryCallbacks); ++i) {
+		struct mScriptMemoryCallback* callback = mScriptMemoryCallbackListGetPointer(&adapter->memoryCallbacks, i);
+		if (callback->fn) {
+			mScriptValueDeref(callback->fn);
+			callback->fn = NULL;
+		}
+	}
+	mScriptMemoryCallbackListClear(&adapter->memoryCallbacks);
+	mScriptMemoryWriteListClear(&adapter->memoryWrites);
+	if (adapter->core->setMemoryWatcher) {
+		adapter->core->setMemoryWatcher(adapter->core, NULL, NULL, 0);
+	}
+	mTimingDeschedule(adapter->core->timing, &adapter->memoryFlush);
+}
+
+static int64_t _mScriptCoreAdapterAddMemoryCallback(struct mScriptCoreAdapter* adapter, struct mScriptValue* callback, const char* domain, uint32_t start, uint32_t end) {
+	if (!adapter->core->setMemoryWatcher || callback->type->base != mSCRIPT_TYPE_FUNCTION) {
+		return -1;
+	}
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = adapter->core->listMemoryBlocks(adapter->core, &blocks);
+	const struct mCoreMemoryBlock* block = NULL;
+	size_t i;
+	for (i = 0; i < nBlocks; ++i) {
+		if (strcmp(blocks[i].internalName, domain) == 0) {
+			block = &blocks[i];
+			break;
+		}
+	}
+	if (!block || block->flags == mCORE_MEMORY_VIRTUAL) {
+		return -1;
+	}
+	// Offsets are within the domain's bus mapping; banked-out segments can't be told apart
+	uint32_t size = block->end - block->start;
+	if (end > size) {
+		end = size;
+	}
+	if (start >= end) {
+		return -1;
+	}
+
+	struct mScriptMemoryCallback* memoryCallback = mScriptMemoryCallbackListAppend(&adapter->memoryCallbacks);
+	memoryCallback->id = adapter->nextMemoryCallback;
+	++adapter->nextMemoryCallback;
+	memoryCallback->base = block->start;
+	memoryCallback->range.start = block->start + start;
+	memoryCallback->range.end = block->start + end;
+	memoryCallback->fn = callback;
+	mScriptValueRef(callback);
+	_updateMemoryWatch(adapter);
+	return memoryCallback->id;
+}
+
+static bool _mScriptCoreAdapterRemoveMemoryCallback(struct mScriptCoreAdapter* adapter, int64_t cbid) {
+	size_t i;
+	for (i = 0; i < mScriptMemoryCallbackListSize(&adapter->memoryCallbacks); ++i) {
+		struct mScriptMemoryCallback* callback = mScriptMemoryCallbackListGetPointer(&adapter->memoryCallbacks, i);
+		if (callback->id != cbid || !callback->fn) {
+			continue;
+		}
+		mScriptValueDeref(callback->fn);
+		callback->fn = NULL;
+		if (!adapter->flushingMemory) {
+			_compactMemoryCallbacks(adapter);
+		}
+		_updateMemoryWatch(adapter);
+		return true;
+	}
+	return false;
+}
+
 static void _mScriptCoreAdapterDeinit(struct mScriptCoreAdapter* adapter) {
 	_clearMemoryMap(adapter->context, adapter, false);
+	_clearMemoryCallbacks(adapter);
+	mScriptMemoryCallbackListDeinit(&adapter->memoryCallbacks);
+	mScriptMemoryWriteListDeinit(&adapter->memoryWrites);
 	adapter->memory.type->free(&adapter->memory);
 #ifdef USE_DEBUGGERS
 	if (adapter->core->debugger) {
@@ -951,7 +1419,7 @@ static struct mScriptValue* _mScriptCoreAdapterGet(struct mScriptCoreAdapter* ad
 
 static void _mScriptCoreAdapterReset(struct mScriptCoreAdapter* adapter) {
 	adapter->core->reset(adapter->core);
-	mScriptContextTriggerCallback(adapter->context, "reset", NULL);
+	mScriptContextTriggerCallbackEvent(adapter->context, mSCRIPT_CALLBACK_RESET, NULL);
 }
 
 static struct mScriptValue* _mScriptCoreAdapterSetRotationCbTable(struct mScriptCoreAdapter* adapter, struct mScriptValue* cbTable) {
@@ -982,6 +1450,8 @@ mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, _deinit, _mScriptCoreAdap
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, reset, _mScriptCoreAdapterReset, 0);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, WTABLE, setRotationCallbacks, _mScriptCoreAdapterSetRotationCbTable, 1, WTABLE, cbTable);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, setSolarSensorCallback, _mScriptCoreAdapterSetLuminanceCb, 1, WRAPPER, callback);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, S64, addMemoryCallback, _mScriptCoreAdapterAddMemoryCallback, 4, WRAPPER, callback, CHARP, domain, U32, start, U32, end);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, BOOL, removeMemoryCallback, _mScriptCoreAdapterRemoveMemoryCallback, 1, S64, cbid);
 #ifdef USE_DEBUGGERS
 mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, S64, setBreakpoint, _mScriptCoreAdapterSetBreakpoint, 3, WRAPPER, callback, U32, address, S32, segment);
 mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, S64, setWatchpoint, _mScriptCoreAdapterSetWatchpoint, 4, WRAPPER, callback, U32, address, S32, type, S32, segment);
@@ -1040,6 +1510,15 @@ mSCRIPT_DEFINE_STRUCT(mScriptCoreAdapter)
 		"Note that the full range of values is not used by games, and the exact range depends on the calibration done by the game itself."
 	)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, setSolarSensorCallback)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Add a callback for writes to the given range of offsets, exclusive on the end, within the named memory domain. "
+		"This doesn't need the debugger, and only accesses to the pages around the range are slowed down. "
+		"Callbacks run after the instruction that did the write has finished, and receive the offset, value and width in bytes of each write. "
+		"Returns an id that can be passed to removeMemoryCallback, or -1 if the callback couldn't be added"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, addMemoryCallback)
+	mSCRIPT_DEFINE_DOCSTRING("Remove a memory callback for a given id returned by a previous call to addMemoryCallback")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, removeMemoryCallback)
 #ifdef USE_DEBUGGERS
 	mSCRIPT_DEFINE_DOCSTRING("Set a breakpoint at a given address")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, setBreakpoint)
@@ -1185,6 +1664,15 @@ void mScriptContextAttachCore(struct mScriptContext* context, struct mCore* core
 	adapter->memory.type = mSCRIPT_TYPE_MS_TABLE;
 	adapter->memory.type->alloc(&adapter->memory);
 
+	adapter->memoryWatcher.written = _memoryWritten;
+	mScriptMemoryCallbackListInit(&adapter->memoryCallbacks, 0);
+	mScriptMemoryWriteListInit(&adapter->memoryWrites, 0);
+	adapter->memoryFlush.context = adapter;
+	adapter->memoryFlush.name = "Script Memory Callbacks";
+	adapter->memoryFlush.callback = _flushMemoryWrites;
+	adapter->memoryFlush.priority = 0x80;
+	adapter->nextMemoryCallback = 1;
+
 	adapter->rumble.setRumble = _setRumble;
 	adapter->rotation.sample = _rotationSample;
 	adapter->rotation.readTiltX = _rotationReadTiltX;
@@ -1223,6 +1711,7 @@ void mScriptContextDetachCore(struct mScriptContext* context) {
 
 	struct mScriptCoreAdapter* adapter = value->value.opaque;
 	_clearMemoryMap(context, adapter, true);
+	_clearMemoryCallbacks(adapter);
 	struct mCore* core = adapter->core;
 	core->setPeripheral(core, mPERIPH_RUMBLE, adapter->oldRumble);
 	core->setPeripheral(core, mPERIPH_ROTATION, adapter->oldRotation);
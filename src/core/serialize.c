@@ -8,16 +8,25 @@
 #include <mgba/core/core.h>
 #include <mgba/core/cheats.h>
 #include <mgba/core/interface.h>
+#include <mgba/core/perf.h>
 #include <mgba/core/version.h>
+#include <mgba-util/crc32.h>
 #include <mgba-util/memory.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 
 #ifdef USE_PNG
 #include <mgba-util/image/png-io.h>
 #include <png.h>
+#endif
+#ifdef USE_ZLIB
 #include <zlib.h>
 #endif
 
+#define CHUNKED_MAGIC 0x4354536D // "mSTC"
+#define CHUNKED_FLAG_DELTA 1
+
 mLOG_DEFINE_CATEGORY(SAVESTATE, "Savestate", "core.serialize");
 
 struct mBundledState {
@@ -32,6 +41,24 @@ struct mStateExtdataHeader {
 	int64_t offset;
 };
 
+struct mStateChunkedHeader {
+	uint32_t magic;
+	uint32_t flags;
+	uint32_t stateSize;
+	uint32_t nChunks;
+};
+
+// Each chunk header is followed by storedSize bytes, compressed if smaller than size
+struct mStateChunkHeader {
+	uint32_t tag;
+	uint32_t offset;
+	uint32_t size;
+	uint32_t storedSize;
+	uint32_t crc32;
+};
+
+DEFINE_VECTOR(mStateChunkList, struct mStateChunk);
+
 void mStateExtdataInit(struct mStateExtdata* extdata) {
 	memset(extdata->data, 0, sizeof(extdata->data));
 }
@@ -149,16 +176,109 @@ bool mStateExtdataDeserialize(struct mStateExtdata* extdata, struct VFile* vf) {
 	return true;
 }
 
-#ifdef USE_PNG
-static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata) {
-	size_t stride;
-	const void* pixels = 0;
+#ifdef USE_ZLIB
+static int _compressionLevel(int flags) {
+	return (flags & SAVESTATE_QUICK) ? Z_BEST_SPEED : Z_DEFAULT_COMPRESSION;
+}
+#endif
 
-	core->getPixels(core, &pixels, &stride);
-	if (!pixels) {
+static bool _chunkInBase(const struct mStateChunkList* base, const struct mStateChunk* chunk) {
+	if (!base) {
 		return false;
 	}
+	size_t i;
+	for (i = 0; i < mStateChunkListSize(base); ++i) {
+		const struct mStateChunk* other = mStateChunkListGetConstPointer(base, i);
+		if (other->tag == chunk->tag && other->offset == chunk->offset && other->size == chunk->size && other->crc32 == chunk->crc32) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool _writeChunk(struct VFile* vf, const struct mStateChunk* chunk, const void* data, int flags) {
+	const void* stored = data;
+	uint32_t storedSize = chunk->size;
+	void* buffer = NULL;
+#ifdef USE_ZLIB
+	uLongf len = compressBound(chunk->size);
+	buffer = malloc(len);
+	if (buffer && compress2(buffer, &len, data, chunk->size, _compressionLevel(flags)) == Z_OK && len < chunk->size) {
+		stored = buffer;
+		storedSize = len;
+	}
+#else
+	UNUSED(flags);
+#endif
+	struct mStateChunkHeader header;
+	STORE_32LE(chunk->tag, 0, &header.tag);
+	STORE_32LE(chunk->offset, 0, &header.offset);
+	STORE_32LE(chunk->size, 0, &header.size);
+	STORE_32LE(storedSize, 0, &header.storedSize);
+	STORE_32LE(chunk->crc32, 0, &header.crc32);
+	bool success = vf->write(vf, &header, sizeof(header)) == sizeof(header) && vf->write(vf, stored, storedSize) == (ssize_t) storedSize;
+	free(buffer);
+	return success;
+}
+
+static bool _writeChunkedState(struct VFile* vf, const uint8_t* state, size_t stateSize, const struct mStateSection* sections, size_t nSections, struct mStateExtdata* extdata, int flags, const struct mStateChunkList* base) {
+	struct mStateChunkList chunks;
+	mStateChunkListInit(&chunks, nSections + 4);
+	struct mStateChunk chunk = { .tag = EXTDATA_NONE };
+	if (!nSections) {
+		chunk.offset = 0;
+		chunk.size = stateSize;
+		chunk.crc32 = doCrc32(state, stateSize);
+		if (!_chunkInBase(base, &chunk)) {
+			*mStateChunkListAppend(&chunks) = chunk;
+		}
+	}
+	size_t i;
+	for (i = 0; i < nSections; ++i) {
+		if (sections[i].offset > stateSize || sections[i].size > stateSize - sections[i].offset) {
+			continue;
+		}
+		chunk.offset = sections[i].offset;
+		chunk.size = sections[i].size;
+		chunk.crc32 = doCrc32(&state[chunk.offset], chunk.size);
+		if (!_chunkInBase(base, &chunk)) {
+			*mStateChunkListAppend(&chunks) = chunk;
+		}
+	}
+	for (i = 1; extdata && i < EXTDATA_MAX; ++i) {
+		if (!extdata->data[i].data) {
+			continue;
+		}
+		chunk.tag = i;
+		chunk.offset = 0;
+		chunk.size = extdata->data[i].size;
+		chunk.crc32 = doCrc32(extdata->data[i].data, chunk.size);
+		if (!_chunkInBase(base, &chunk)) {
+			*mStateChunkListAppend(&chunks) = chunk;
+		}
+	}
+
+	struct mStateChunkedHeader header;
+	STORE_32LE(CHUNKED_MAGIC, 0, &header.magic);
+	STORE_32LE(base ? CHUNKED_FLAG_DELTA : 0, 0, &header.flags);
+	STORE_32LE(stateSize, 0, &header.stateSize);
+	STORE_32LE(mStateChunkListSize(&chunks), 0, &header.nChunks);
+	bool success = vf->write(vf, &header, sizeof(header)) == sizeof(header);
+	for (i = 0; success && i < mStateChunkListSize(&chunks); ++i) {
+		const struct mStateChunk* next = mStateChunkListGetConstPointer(&chunks, i);
+		const void* data;
+		if (next->tag == EXTDATA_NONE) {
+			data = &state[next->offset];
+		} else {
+			data = extdata->data[next->tag].data;
+		}
+		success = _writeChunk(vf, next, data, flags);
+	}
+	mStateChunkListDeinit(&chunks);
+	return success;
+}
 
+static bool _saveChunkedState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata, int flags, const struct mStateChunkList* base) {
 	size_t stateSize = core->stateSize(core);
 	void* state = anonymousMemoryMap(stateSize);
 	if (!state) {
@@ -166,17 +286,161 @@ static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExt
 	}
 	core->saveState(core, state);
 
+	const struct mStateSection* sections = NULL;
+	size_t nSections = 0;
+	if (core->listStateSections) {
+		nSections = core->listStateSections(core, &sections);
+	}
+	bool success = _writeChunkedState(vf, state, stateSize, sections, nSections, extdata, flags, base);
+	mappedMemoryFree(state, stateSize);
+	return success;
+}
+
+static bool _isChunked(struct VFile* vf) {
+	uint32_t magic;
+	vf->seek(vf, 0, SEEK_SET);
+	if (vf->read(vf, &magic, sizeof(magic)) != sizeof(magic)) {
+		return false;
+	}
+	LOAD_32LE(magic, 0, &magic);
+	return magic == CHUNKED_MAGIC;
+}
+
+static bool _readChunkedHeader(struct VFile* vf, struct mStateChunkedHeader* header) {
+	struct mStateChunkedHeader buffer;
+	vf->seek(vf, 0, SEEK_SET);
+	if (vf->read(vf, &buffer, sizeof(buffer)) != sizeof(buffer)) {
+		return false;
+	}
+	LOAD_32LE(header->magic, 0, &buffer.magic);
+	LOAD_32LE(header->flags, 0, &buffer.flags);
+	LOAD_32LE(header->stateSize, 0, &buffer.stateSize);
+	LOAD_32LE(header->nChunks, 0, &buffer.nChunks);
+	return header->magic == CHUNKED_MAGIC;
+}
+
+static bool _readChunkData(struct VFile* vf, void* data, uint32_t size, uint32_t storedSize) {
+	if (storedSize == size) {
+		return vf->read(vf, data, size) == (ssize_t) size;
+	}
+#ifdef USE_ZLIB
+	if (storedSize > size) {
+		return false;
+	}
+	void* buffer = malloc(storedSize);
+	if (!buffer) {
+		return false;
+	}
+	bool success = vf->read(vf, buffer, storedSize) == (ssize_t) storedSize;
+	uLongf len = size;
+	success = success && uncompress(data, &len, buffer, storedSize) == Z_OK && len == size;
+	free(buffer);
+	return success;
+#else
+	return false;
+#endif
+}
+
+// Reads the chunks following the header. State chunks are only decoded if state is non-NULL, and
+// extdata chunks if extdata is; anything else is skipped, and listed in chunks if that's provided.
+static bool _readChunks(struct VFile* vf, uint32_t nChunks, uint8_t* state, uint32_t stateSize, struct mStateExtdata* extdata, struct mStateChunkList* chunks) {
+	uint32_t i;
+	for (i = 0; i < nChunks; ++i) {
+		struct mStateChunkHeader buffer;
+		if (vf->read(vf, &buffer, sizeof(buffer)) != sizeof(buffer)) {
+			return false;
+		}
+		struct mStateChunk chunk;
+		uint32_t storedSize;
+		LOAD_32LE(chunk.tag, 0, &buffer.tag);
+		LOAD_32LE(chunk.offset, 0, &buffer.offset);
+		LOAD_32LE(chunk.size, 0, &buffer.size);
+		LOAD_32LE(storedSize, 0, &buffer.storedSize);
+		LOAD_32LE(chunk.crc32, 0, &buffer.crc32);
+		if (chunks) {
+			*mStateChunkListAppend(chunks) = chunk;
+		}
+
+		void* data = NULL;
+		if (chunk.tag == EXTDATA_NONE && state) {
+			if (chunk.offset > stateSize || chunk.size > stateSize - chunk.offset) {
+				mLOG(SAVESTATE, WARN, "Chunk exceeds savestate bounds");
+				return false;
+			}
+			data = &state[chunk.offset];
+		} else if (chunk.tag != EXTDATA_NONE && chunk.tag < EXTDATA_MAX && extdata && chunk.size <= INT32_MAX) {
+			data = malloc(chunk.size ? chunk.size : 1);
+			if (!data) {
+				return false;
+			}
+		}
+		if (!data) {
+			if (vf->seek(vf, storedSize, SEEK_CUR) < 0) {
+				return false;
+			}
+			continue;
+		}
+		if (!_readChunkData(vf, data, chunk.size, storedSize) || doCrc32(data, chunk.size) != chunk.crc32) {
+			mLOG(SAVESTATE, WARN, "Savestate chunk is corrupted");
+			if (chunk.tag != EXTDATA_NONE) {
+				free(data);
+			}
+			return false;
+		}
+		if (chunk.tag != EXTDATA_NONE) {
+			struct mStateExtdataItem item = {
+				.size = chunk.size,
+				.data = data,
+				.clean = free
+			};
+			mStateExtdataPut(extdata, chunk.tag, &item);
+		}
+	}
+	return true;
+}
+
+static void* _loadChunkedState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata) {
+	struct mStateChunkedHeader header;
+	if (!_readChunkedHeader(vf, &header)) {
+		return NULL;
+	}
+	size_t stateSize = core->stateSize(core);
+	if (header.stateSize != stateSize) {
+		mLOG(SAVESTATE, WARN, "Savestate is the wrong size for this core");
+		return NULL;
+	}
+	void* state = anonymousMemoryMap(stateSize);
+	if (!state) {
+		return NULL;
+	}
+	if (header.flags & CHUNKED_FLAG_DELTA) {
+		core->saveState(core, state);
+	}
+	if (!_readChunks(vf, header.nChunks, state, stateSize, extdata, NULL)) {
+		mappedMemoryFree(state, stateSize);
+		return NULL;
+	}
+	return state;
+}
+
+bool mStateChunksRead(struct VFile* vf, struct mStateChunkList* chunks) {
+	struct mStateChunkedHeader header;
+	if (!_readChunkedHeader(vf, &header)) {
+		return false;
+	}
+	return _readChunks(vf, header.nChunks, NULL, 0, NULL, chunks);
+}
+
+#ifdef USE_PNG
+
+static bool _writePNGState(struct VFile* vf, const void* pixels, unsigned width, unsigned height, size_t stride, const void* state, size_t stateSize, struct mStateExtdata* extdata, int level) {
 	uLongf len = compressBound(stateSize);
 	void* buffer = malloc(len);
 	if (!buffer) {
-		mappedMemoryFree(state, stateSize);
 		return false;
 	}
-	compress(buffer, &len, (const Bytef*) state, stateSize);
-	mappedMemoryFree(state, stateSize);
+	compress2(buffer, &len, (const Bytef*) state, stateSize, level);
 
-	unsigned width, height;
-	core->currentVideoSize(core, &width, &height);
 	png_structp png = PNGWriteOpen(vf);
 	png_infop info = PNGWriteHeader(png, width, height, mCOLOR_NATIVE);
 	if (!png || !info) {
@@ -184,6 +448,7 @@ static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExt
 		free(buffer);
 		return false;
 	}
+	png_set_compression_level(png, level);
 	PNGWritePixels(png, width, height, stride, pixels, mCOLOR_NATIVE);
 	PNGWriteCustomChunk(png, "gbAs", len, buffer);
 	if (extdata) {
@@ -199,7 +464,7 @@ static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExt
 			}
 			STORE_32LE(i, 0, data);
 			STORE_32LE(extdata->data[i].size, sizeof(uint32_t), data);
-			compress((Bytef*) (data + 2), &len, extdata->data[i].data, extdata->data[i].size);
+			compress2((Bytef*) (data + 2), &len, extdata->data[i].data, extdata->data[i].size, level);
 			PNGWriteCustomChunk(png, "gbAx", len + sizeof(uint32_t) * 2, data);
 			free(data);
 		}
@@ -209,6 +474,29 @@ static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExt
 	return true;
 }
 
+static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata, int flags) {
+	size_t stride;
+	const void* pixels = 0;
+
+	core->getPixels(core, &pixels, &stride);
+	if (!pixels) {
+		return false;
+	}
+
+	size_t stateSize = core->stateSize(core);
+	void* state = anonymousMemoryMap(stateSize);
+	if (!state) {
+		return false;
+	}
+	core->saveState(core, state);
+
+	unsigned width, height;
+	core->currentVideoSize(core, &width, &height);
+	bool success = _writePNGState(vf, pixels, width, height, stride, state, stateSize, extdata, _compressionLevel(flags));
+	mappedMemoryFree(state, stateSize);
+	return success;
+}
+
 static int _loadPNGChunkHandler(png_structp png, png_unknown_chunkp chunk) {
 	struct mBundledState* bundle = png_get_user_chunk_ptr(png);
 	if (!bundle) {
@@ -366,11 +654,7 @@ static bool _loadPNGExtadata(struct VFile* vf, struct mStateExtdata* extdata) {
 }
 #endif
 
-bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
-	struct mStateExtdata extdata;
-	mStateExtdataInit(&extdata);
-	size_t stateSize = core->stateSize(core);
-
+static void _collectExtdata(struct mCore* core, struct mStateExtdata* extdata, int flags) {
 	if (flags & SAVESTATE_METADATA) {
 		uint64_t* creationUsec = malloc(sizeof(*creationUsec));
 		if (creationUsec) {
@@ -401,7 +685,7 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 				.data = creationUsec,
 				.clean = free
 			};
-			mStateExtdataPut(&extdata, EXTDATA_META_TIME, &item);
+			mStateExtdataPut(extdata, EXTDATA_META_TIME, &item);
 		}
 
 		char creator[256];
@@ -411,7 +695,7 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 			.data = strdup(creator),
 			.clean = free
 		};
-		mStateExtdataPut(&extdata, EXTDATA_META_CREATOR, &item);
+		mStateExtdataPut(extdata, EXTDATA_META_CREATOR, &item);
 	}
 
 	if (flags & SAVESTATE_SAVEDATA) {
@@ -423,69 +707,263 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 				.data = sram,
 				.clean = free
 			};
-			mStateExtdataPut(&extdata, EXTDATA_SAVEDATA, &item);
+			mStateExtdataPut(extdata, EXTDATA_SAVEDATA, &item);
 		}
 	}
-	struct VFile* cheatVf = 0;
 	struct mCheatDevice* device;
 	if (flags & SAVESTATE_CHEATS && (device = core->cheatDevice(core))) {
-		cheatVf = VFileMemChunk(0, 0);
+		struct VFile* cheatVf = VFileMemChunk(0, 0);
 		if (cheatVf) {
 			mCheatSaveFile(device, cheatVf);
-			struct mStateExtdataItem item = {
-				.size = cheatVf->size(cheatVf),
-				.data = cheatVf->map(cheatVf, cheatVf->size(cheatVf), MAP_READ),
-				.clean = 0
-			};
-			mStateExtdataPut(&extdata, EXTDATA_CHEATS, &item);
+			size_t size = cheatVf->size(cheatVf);
+			void* cheats = malloc(size);
+			if (cheats) {
+				cheatVf->seek(cheatVf, 0, SEEK_SET);
+				cheatVf->read(cheatVf, cheats, size);
+				struct mStateExtdataItem item = {
+					.size = size,
+					.data = cheats,
+					.clean = free
+				};
+				mStateExtdataPut(extdata, EXTDATA_CHEATS, &item);
+			}
+			cheatVf->close(cheatVf);
 		}
 	}
 	if (flags & SAVESTATE_RTC) {
 		struct mStateExtdataItem item;
 		if (core->rtc.d.serialize) {
 			core->rtc.d.serialize(&core->rtc.d, &item);
-			mStateExtdataPut(&extdata, EXTDATA_RTC, &item);
+			mStateExtdataPut(extdata, EXTDATA_RTC, &item);
 		}
 	}
+}
+
+bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
+	mTRACE_BEGIN("Save state");
+	struct mStateExtdata extdata;
+	mStateExtdataInit(&extdata);
+	_collectExtdata(core, &extdata, flags);
+
+	bool success;
+	if (flags & SAVESTATE_CHUNKED) {
+		success = _saveChunkedState(core, vf, &extdata, flags, NULL);
+	}
 #ifdef USE_PNG
-	if (!(flags & SAVESTATE_SCREENSHOT)) {
-#else
-	UNUSED(flags);
+	else if (flags & SAVESTATE_SCREENSHOT) {
+		success = _savePNGState(core, vf, &extdata, flags);
+	}
 #endif
+	else {
+		size_t stateSize = core->stateSize(core);
 		vf->truncate(vf, stateSize);
 		void* state = vf->map(vf, stateSize, MAP_WRITE);
-		if (!state) {
-			mStateExtdataDeinit(&extdata);
-			if (cheatVf) {
-				cheatVf->close(cheatVf);
-			}
-			return false;
-		}
-		core->saveState(core, state);
-		vf->unmap(vf, state, stateSize);
-		vf->seek(vf, stateSize, SEEK_SET);
-		mStateExtdataSerialize(&extdata, vf);
-		mStateExtdataDeinit(&extdata);
-		if (cheatVf) {
-			cheatVf->close(cheatVf);
+		success = state != NULL;
+		if (success) {
+			core->saveState(core, state);
+			vf->unmap(vf, state, stateSize);
+			vf->seek(vf, stateSize, SEEK_SET);
+			mStateExtdataSerialize(&extdata, vf);
 		}
-		return true;
+	}
+	mStateExtdataDeinit(&extdata);
+	mTRACE_END();
+	return success;
+}
+
+bool mCoreSaveStateDelta(struct mCore* core, struct VFile* vf, int flags, const struct mStateChunkList* base) {
+	struct mStateExtdata extdata;
+	mStateExtdataInit(&extdata);
+	_collectExtdata(core, &extdata, flags);
+	bool success = _saveChunkedState(core, vf, &extdata, flags, base);
+	mStateExtdataDeinit(&extdata);
+	return success;
+}
+
+struct mStateWriterJob {
+	struct VFile* vf;
+	int flags;
+	void* state;
+	size_t stateSize;
+	void* pixels;
+	unsigned width;
+	unsigned height;
+	const struct mStateSection* sections;
+	size_t nSections;
+	struct mStateExtdata extdata;
+	void (*done)(bool success, void* context);
+	void* context;
+};
+
+DECLARE_VECTOR(mStateWriterJobList, struct mStateWriterJob*);
+DEFINE_VECTOR(mStateWriterJobList, struct mStateWriterJob*);
+
+struct mStateWriter {
+	struct mStateWriterJobList jobs;
+	bool busy;
+	bool exiting;
+
+	Thread thread;
+	Mutex mutex;
+	Condition cond;
+};
+
+static bool _encodeJob(struct mStateWriterJob* job) {
+	struct VFile* vf = job->vf;
+	if (job->flags & SAVESTATE_CHUNKED) {
+		return _writeChunkedState(vf, job->state, job->stateSize, job->sections, job->nSections, &job->extdata, job->flags, NULL);
+	}
 #ifdef USE_PNG
+	if (job->pixels) {
+		return _writePNGState(vf, job->pixels, job->width, job->height, job->width, job->state, job->stateSize, &job->extdata, _compressionLevel(job->flags));
 	}
-	else {
-		bool success = _savePNGState(core, vf, &extdata);
-		mStateExtdataDeinit(&extdata);
-		if (cheatVf) {
-			cheatVf->close(cheatVf);
+#endif
+	vf->truncate(vf, job->stateSize);
+	vf->seek(vf, 0, SEEK_SET);
+	if (vf->write(vf, job->state, job->stateSize) != (ssize_t) job->stateSize) {
+		return false;
+	}
+	return mStateExtdataSerialize(&job->extdata, vf);
+}
+
+static void _runJob(struct mStateWriterJob* job) {
+	bool success = _encodeJob(job);
+	job->vf->close(job->vf);
+	if (job->done) {
+		job->done(success, job->context);
+	}
+	mappedMemoryFree(job->state, job->stateSize);
+	free(job->pixels);
+	mStateExtdataDeinit(&job->extdata);
+	free(job);
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _writerThread(void* context) {
+	struct mStateWriter* writer = context;
+	ThreadSetName("State Writer");
+	mTRACE_THREAD_NAME("State Writer");
+
+	MutexLock(&writer->mutex);
+	while (true) {
+		while (!mStateWriterJobListSize(&writer->jobs) && !writer->exiting) {
+			ConditionWait(&writer->cond, &writer->mutex);
 		}
-		return success;
+		if (!mStateWriterJobListSize(&writer->jobs)) {
+			break;
+		}
+		struct mStateWriterJob* job = *mStateWriterJobListGetPointer(&writer->jobs, 0);
+		mStateWriterJobListShift(&writer->jobs, 0, 1);
+		writer->busy = true;
+		MutexUnlock(&writer->mutex);
+		mTRACE_BEGIN("Write state");
+		_runJob(job);
+		mTRACE_END();
+		MutexLock(&writer->mutex);
+		writer->busy = false;
+		ConditionWake(&writer->cond);
 	}
+	MutexUnlock(&writer->mutex);
+	THREAD_EXIT(0);
+}
+#endif
+
+struct mStateWriter* mStateWriterCreate(void) {
+	struct mStateWriter* writer = calloc(1, sizeof(*writer));
+	mStateWriterJobListInit(&writer->jobs, 0);
+	MutexInit(&writer->mutex);
+	ConditionInit(&writer->cond);
+#ifndef DISABLE_THREADING
+	ThreadCreate(&writer->thread, _writerThread, writer);
+#endif
+	return writer;
+}
+
+void mStateWriterDestroy(struct mStateWriter* writer) {
+	MutexLock(&writer->mutex);
+	writer->exiting = true;
+	ConditionWake(&writer->cond);
+	MutexUnlock(&writer->mutex);
+#ifndef DISABLE_THREADING
+	ThreadJoin(&writer->thread);
+#endif
+	ConditionDeinit(&writer->cond);
+	MutexDeinit(&writer->mutex);
+	mStateWriterJobListDeinit(&writer->jobs);
+	free(writer);
+}
+
+bool mStateWriterSave(struct mStateWriter* writer, struct mCore* core, struct VFile* vf, int flags, void (*done)(bool success, void* context), void* context) {
+	struct mStateWriterJob* job = calloc(1, sizeof(*job));
+	job->vf = vf;
+	job->flags = flags;
+	job->done = done;
+	job->context = context;
+	job->stateSize = core->stateSize(core);
+	job->state = anonymousMemoryMap(job->stateSize);
+	if (!job->state) {
+		free(job);
+		vf->close(vf);
+		return false;
+	}
+	core->saveState(core, job->state);
+	if (core->listStateSections) {
+		job->nSections = core->listStateSections(core, &job->sections);
+	}
+	mStateExtdataInit(&job->extdata);
+	_collectExtdata(core, &job->extdata, flags);
+
+#ifdef USE_PNG
+	if ((flags & (SAVESTATE_SCREENSHOT | SAVESTATE_CHUNKED)) == SAVESTATE_SCREENSHOT) {
+		size_t stride;
+		const void* pixels = 0;
+		core->getPixels(core, &pixels, &stride);
+		core->currentVideoSize(core, &job->width, &job->height);
+		if (pixels) {
+			job->pixels = malloc(job->width * job->height * BYTES_PER_PIXEL);
+		}
+		if (!job->pixels) {
+			vf->close(vf);
+			mappedMemoryFree(job->state, job->stateSize);
+			mStateExtdataDeinit(&job->extdata);
+			free(job);
+			return false;
+		}
+		// Copy the screenshot now, since the core will keep drawing into its buffer
+		unsigned y;
+		for (y = 0; y < job->height; ++y) {
+			memcpy((uint8_t*) job->pixels + y * job->width * BYTES_PER_PIXEL, (const uint8_t*) pixels + y * stride * BYTES_PER_PIXEL, job->width * BYTES_PER_PIXEL);
+		}
+	}
+#endif
+
+#ifndef DISABLE_THREADING
+	MutexLock(&writer->mutex);
+	*mStateWriterJobListAppend(&writer->jobs) = job;
+	ConditionWake(&writer->cond);
+	MutexUnlock(&writer->mutex);
+#else
+	_runJob(job);
+#endif
+	return true;
+}
+
+void mStateWriterWait(struct mStateWriter* writer) {
+#ifndef DISABLE_THREADING
+	MutexLock(&writer->mutex);
+	while (mStateWriterJobListSize(&writer->jobs) || writer->busy) {
+		ConditionWait(&writer->cond, &writer->mutex);
+	}
+	MutexUnlock(&writer->mutex);
+#else
+	UNUSED(writer);
 #endif
-	mStateExtdataDeinit(&extdata);
-	return false;
 }
 
 void* mCoreExtractState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata) {
+	if (_isChunked(vf)) {
+		return _loadChunkedState(core, vf, extdata);
+	}
 #ifdef USE_PNG
 	if (isPNG(vf)) {
 		return _loadPNGState(core, vf, extdata);
@@ -505,6 +983,10 @@ void* mCoreExtractState(struct mCore* core, struct VFile* vf, struct mStateExtda
 }
 
 bool mCoreExtractExtdata(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata) {
+	if (_isChunked(vf)) {
+		struct mStateChunkedHeader header;
+		return _readChunkedHeader(vf, &header) && _readChunks(vf, header.nChunks, NULL, 0, extdata, NULL);
+	}
 #ifdef USE_PNG
 	if (isPNG(vf)) {
 		return _loadPNGExtadata(vf, extdata);
@@ -519,10 +1001,12 @@ bool mCoreExtractExtdata(struct mCore* core, struct VFile* vf, struct mStateExtd
 }
 
 bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags) {
+	mTRACE_BEGIN("Load state");
 	struct mStateExtdata extdata;
 	mStateExtdataInit(&extdata);
 	void* state = mCoreExtractState(core, vf, &extdata);
 	if (!state) {
+		mTRACE_END();
 		return false;
 	}
 	bool success = core->loadState(core, state);
@@ -567,6 +1051,7 @@ bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 		}
 	}
 	mStateExtdataDeinit(&extdata);
+	mTRACE_END();
 	return success;
 }
 
@@ -5,7 +5,17 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/core/sync.h>
 
+#include <mgba/core/audio-resampler.h>
 #include <mgba/core/blip_buf.h>
+#include <mgba/core/interface.h>
+#include <mgba/core/perf.h>
+#include <mgba-util/ring-fifo.h>
+
+#define AUDIO_PUSH_CHUNK 256
+// Covers the frontend's time to pick up and draw a frame, plus oversleeping
+#define FRAME_PACING_MARGIN_NSEC 2000000
+#define FRAME_COST_DECAY 16
+#define SKIPPED_FRAME_COST_DECAY 8
 
 static void _changeVideoSync(struct mCoreSync* sync, bool wait) {
 	// Make sure the video thread can process events while the GBA thread is paused
@@ -17,20 +27,79 @@ static void _changeVideoSync(struct mCoreSync* sync, bool wait) {
 	MutexUnlock(&sync->videoFrameMutex);
 }
 
+static uint64_t _framePeriod(const struct mCoreSync* sync) {
+	if (sync->fpsTarget <= 0) {
+		return 0;
+	}
+	return 1000000000.0 / sync->fpsTarget;
+}
+
+static void _updateFrameCost(struct mCoreSync* sync, uint64_t now) {
+	if (!sync->frameStartNsec || now < sync->frameStartNsec) {
+		return;
+	}
+	uint64_t cost = now - sync->frameStartNsec - (sync->audioWaitNsec - sync->frameStartAudioWaitNsec);
+	// A frame that spanned a pause would otherwise take ages to decay
+	uint64_t period = _framePeriod(sync);
+	if (cost > period) {
+		cost = period;
+	}
+	if (cost >= sync->frameCostNsec) {
+		sync->frameCostNsec = cost;
+	} else {
+		sync->frameCostNsec -= (sync->frameCostNsec - cost) / FRAME_COST_DECAY;
+	}
+}
+
+static void _paceFrame(struct mCoreSync* sync) {
+	uint64_t now = mPerfTimestamp();
+	uint64_t delay = mCoreSyncFramePacingDelay(sync, now);
+	if (!delay) {
+		return;
+	}
+	mTRACE_BEGIN("Frame pacing");
+	uint64_t start = now;
+	uint64_t end = now + delay;
+	// The frontend may need the mutex in the meantime, so sleep on a condition rather than outright
+	while (now < end && sync->framePacing && (sync->videoFrameWait || sync->audioWait)) {
+		int32_t ms = (end - now) / 1000000;
+		if (!ms) {
+			break;
+		}
+		ConditionWaitTimed(&sync->videoFrameRequiredCond, &sync->videoFrameMutex, ms);
+		now = mPerfTimestamp();
+	}
+	sync->videoWaitNsec += now - start;
+	mTRACE_END();
+}
+
 void mCoreSyncPostFrame(struct mCoreSync* sync) {
 	if (!sync) {
 		return;
 	}
 
+	mTRACE_BEGIN("Video sync");
 	MutexLock(&sync->videoFrameMutex);
+	_updateFrameCost(sync, mPerfTimestamp());
 	++sync->videoFramePending;
+	sync->framePresentPending = true;
+	uint64_t start = sync->videoFrameWait ? mPerfTimestamp() : 0;
 	do {
 		ConditionWake(&sync->videoFrameAvailableCond);
 		if (sync->videoFrameWait) {
 			ConditionWait(&sync->videoFrameRequiredCond, &sync->videoFrameMutex);
 		}
 	} while (sync->videoFrameWait && sync->videoFramePending);
+	if (start) {
+		sync->videoWaitNsec += mPerfTimestamp() - start;
+	}
+	if (sync->framePacing && (sync->videoFrameWait || sync->audioWait)) {
+		_paceFrame(sync);
+	}
+	sync->frameStartNsec = mPerfTimestamp();
+	sync->frameStartAudioWaitNsec = sync->audioWaitNsec;
 	MutexUnlock(&sync->videoFrameMutex);
+	mTRACE_END();
 }
 
 void mCoreSyncForceFrame(struct mCoreSync* sync) {
@@ -79,17 +148,150 @@ void mCoreSyncSetVideoSync(struct mCoreSync* sync, bool wait) {
 	_changeVideoSync(sync, wait);
 }
 
-bool mCoreSyncProduceAudio(struct mCoreSync* sync, const struct blip_t* buf, size_t samples) {
+void mCoreSyncFramePresented(struct mCoreSync* sync, uint64_t nsec) {
 	if (!sync) {
+		return;
+	}
+
+	MutexLock(&sync->videoFrameMutex);
+	sync->framePresentedNsec = nsec;
+	sync->framePresentPending = false;
+	MutexUnlock(&sync->videoFrameMutex);
+}
+
+uint64_t mCoreSyncFramePacingDelay(const struct mCoreSync* sync, uint64_t now) {
+	if (!sync->framePacing || !sync->framePresentedNsec || now < sync->framePresentedNsec) {
+		return 0;
+	}
+	uint64_t period = _framePeriod(sync);
+	uint64_t lead = sync->frameCostNsec + FRAME_PACING_MARGIN_NSEC;
+	if (lead >= period) {
+		return 0;
+	}
+	// If the last frame is still waiting to be shown, the next one goes in the slot after it
+	uint64_t present = sync->framePresentedNsec + period;
+	if (sync->framePresentPending) {
+		present += period;
+	}
+	if (present - lead <= now) {
+		return 0;
+	}
+	return present - lead - now;
+}
+
+bool mCoreFrameSkipShouldRender(const struct mCoreFrameSkip* skip, uint64_t now) {
+	if (skip->presentFps <= 0) {
 		return true;
 	}
+	// Render the last frame that can finish before the display wants a new one
+	return now + skip->skippedFrameCostNsec >= skip->nextPresentNsec;
+}
 
-	size_t produced = blip_samples_avail(buf);
+void mCoreFrameSkipFrameEnded(struct mCoreFrameSkip* skip, uint64_t start, uint64_t end, bool rendered) {
+	if (end < start) {
+		return;
+	}
+	if (!rendered) {
+		uint64_t cost = end - start;
+		if (!skip->skippedFrameCostNsec) {
+			skip->skippedFrameCostNsec = cost;
+		} else if (cost >= skip->skippedFrameCostNsec) {
+			skip->skippedFrameCostNsec += (cost - skip->skippedFrameCostNsec) / SKIPPED_FRAME_COST_DECAY;
+		} else {
+			skip->skippedFrameCostNsec -= (skip->skippedFrameCostNsec - cost) / SKIPPED_FRAME_COST_DECAY;
+		}
+		return;
+	}
+	if (skip->presentFps <= 0) {
+		return;
+	}
+	uint64_t period = 1000000000.0 / skip->presentFps;
+	skip->nextPresentNsec += period;
+	// After falling behind, or a pause, start over from here instead of rendering to catch up
+	if (skip->nextPresentNsec < end) {
+		skip->nextPresentNsec = end + period;
+	}
+}
+
+static void _pushAudio(struct mCoreSync* sync, struct blip_t* left, struct blip_t* right) {
+	struct mStereoSample samples[AUDIO_PUSH_CHUNK];
+	while (true) {
+		// Samples are written one at a time so that the reader never sees a partial one, so leave
+		// room for the slot the ring skips when it wraps around as well as the one it keeps empty
+		size_t space = (RingFIFOCapacity(sync->audioRing) - RingFIFOSize(sync->audioRing)) / sizeof(*samples);
+		if (space <= 2) {
+			break;
+		}
+		space -= 2;
+		size_t count;
+		if (sync->audioResampler) {
+			struct mAudioResampler* resampler = sync->audioResampler;
+			count = blip_samples_avail(left);
+			if (count > resampler->capacity - resampler->size) {
+				count = resampler->capacity - resampler->size;
+			}
+			if (count > AUDIO_PUSH_CHUNK) {
+				count = AUDIO_PUSH_CHUNK;
+			}
+			if (count) {
+				blip_read_samples(left, &samples[0].left, count, true);
+				blip_read_samples(right, &samples[0].right, count, true);
+				mAudioResamplerPush(resampler, samples, count);
+			}
+			count = mAudioResamplerAvailable(resampler);
+		} else {
+			count = blip_samples_avail(left);
+		}
+		if (count > space) {
+			count = space;
+		}
+		if (count > AUDIO_PUSH_CHUNK) {
+			count = AUDIO_PUSH_CHUNK;
+		}
+		if (!count) {
+			break;
+		}
+		if (sync->audioResampler) {
+			mAudioResamplerPull(sync->audioResampler, samples, count);
+		} else {
+			blip_read_samples(left, &samples[0].left, count, true);
+			blip_read_samples(right, &samples[0].right, count, true);
+		}
+		size_t i;
+		for (i = 0; i < count; ++i) {
+			RingFIFOWrite(sync->audioRing, &samples[i], sizeof(*samples));
+		}
+	}
+}
+
+bool mCoreSyncProduceAudio(struct mCoreSync* sync, struct blip_t* left, struct blip_t* right, size_t samples) {
+	if (!sync) {
+		return true;
+	}
+
+	if (sync->audioRing) {
+		_pushAudio(sync, left, right);
+	}
+	size_t produced = blip_samples_avail(left);
 	size_t producedNew = produced;
+	bool waited = false;
+	uint64_t start = 0;
 	while (sync->audioWait && producedNew >= samples) {
+		if (!waited) {
+			mTRACE_BEGIN("Audio sync");
+			start = mPerfTimestamp();
+			waited = true;
+		}
 		ConditionWait(&sync->audioRequiredCond, &sync->audioBufferMutex);
+		if (sync->audioRing) {
+			_pushAudio(sync, left, right);
+		}
 		produced = producedNew;
-		producedNew = blip_samples_avail(buf);
+		producedNew = blip_samples_avail(left);
+	}
+	if (waited) {
+		sync->audioWaitNsec += mPerfTimestamp() - start;
+		mTRACE_END();
 	}
 	MutexUnlock(&sync->audioBufferMutex);
 	return producedNew != produced;
@@ -119,3 +321,36 @@ void mCoreSyncConsumeAudio(struct mCoreSync* sync) {
 	ConditionWake(&sync->audioRequiredCond);
 	MutexUnlock(&sync->audioBufferMutex);
 }
+
+size_t mCoreSyncReadAudio(struct mCoreSync* sync, struct mStereoSample* samples, size_t count) {
+	struct RingFIFO* ring = sync->audioRing;
+	if (!ring) {
+		return 0;
+	}
+	size_t read;
+	for (read = 0; read < count; ++read) {
+		if (!RingFIFORead(ring, &samples[read], sizeof(*samples))) {
+			break;
+		}
+	}
+
+	// If the emulation thread holds the lock it isn't waiting yet, and at worst it'll be woken by
+	// the next read, so there's no need to block here
+	if (read && !MutexTryLock(&sync->audioBufferMutex)) {
+		ConditionWake(&sync->audioRequiredCond);
+		MutexUnlock(&sync->audioBufferMutex);
+	}
+	return read;
+}
+
+double mCoreSyncAdjustAudioRate(const struct mCoreSync* sync, double rate, size_t buffered, size_t capacity) {
+	if (!sync || !sync->audioRateControl || !capacity) {
+		return rate;
+	}
+	if (buffered > capacity) {
+		buffered = capacity;
+	}
+	// Running low makes for more samples per frame, running high for fewer
+	double fill = (double) buffered / capacity;
+	return rate * (1 + sync->audioRateControl * (1 - 2 * fill));
+}
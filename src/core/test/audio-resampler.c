@@ -0,0 +1,121 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/audio-resampler.h>
+#include <mgba/core/interface.h>
+
+#define INPUT_SAMPLES 0x2000
+#define OUTPUT_SAMPLES 0x4000
+
+static size_t _resample(enum mAudioResamplerQuality quality, double inputRate, double outputRate, const struct mStereoSample* input, struct mStereoSample* output) {
+	struct mAudioResampler resampler;
+	mAudioResamplerInit(&resampler, quality, 0x400);
+	mAudioResamplerSetRates(&resampler, inputRate, outputRate);
+	size_t pushed = 0;
+	size_t pulled = 0;
+	while (pushed < INPUT_SAMPLES) {
+		pushed += mAudioResamplerPush(&resampler, &input[pushed], INPUT_SAMPLES - pushed);
+		pulled += mAudioResamplerPull(&resampler, &output[pulled], OUTPUT_SAMPLES - pulled);
+	}
+	mAudioResamplerDeinit(&resampler);
+	return pulled;
+}
+
+static void _sine(struct mStereoSample* samples, double frequency, double rate, int amplitude) {
+	size_t i;
+	for (i = 0; i < INPUT_SAMPLES; ++i) {
+		samples[i].left = amplitude * sin(2 * M_PI * frequency * i / rate);
+		samples[i].right = -samples[i].left;
+	}
+}
+
+static double _amplitude(const struct mStereoSample* samples, size_t start, size_t end) {
+	double sum = 0;
+	size_t i;
+	for (i = start; i < end; ++i) {
+		sum += samples[i].left * (double) samples[i].left;
+	}
+	return sqrt(2 * sum / (end - start));
+}
+
+M_TEST_DEFINE(dcGain) {
+	struct mStereoSample* input = calloc(INPUT_SAMPLES, sizeof(*input));
+	struct mStereoSample* output = calloc(OUTPUT_SAMPLES, sizeof(*output));
+	size_t i;
+	for (i = 0; i < INPUT_SAMPLES; ++i) {
+		input[i].left = 10000;
+		input[i].right = -20000;
+	}
+	enum mAudioResamplerQuality quality;
+	for (quality = mAUDIO_RESAMPLER_LOW; quality <= mAUDIO_RESAMPLER_HIGH; ++quality) {
+		size_t count = _resample(quality, 32768, 48000, input, output);
+		assert_true(count > 100);
+		// Every phase of the kernel sums to exactly one, so once the initial silence has passed
+		// a constant input comes out unchanged
+		for (i = 64; i < count; ++i) {
+			assert_int_equal(output[i].left, 10000);
+			assert_int_equal(output[i].right, -20000);
+		}
+	}
+	free(input);
+	free(output);
+}
+
+M_TEST_DEFINE(outputCount) {
+	struct mStereoSample* input = calloc(INPUT_SAMPLES, sizeof(*input));
+	struct mStereoSample* output = calloc(OUTPUT_SAMPLES, sizeof(*output));
+	enum mAudioResamplerQuality quality;
+	for (quality = mAUDIO_RESAMPLER_LOW; quality <= mAUDIO_RESAMPLER_HIGH; ++quality) {
+		// Half a kernel of output is held back waiting for more input
+		size_t count = _resample(quality, 32768, 48000, input, output);
+		size_t expected = INPUT_SAMPLES * 48000 / 32768;
+		assert_true(count >= expected - 24 && count <= expected);
+
+		count = _resample(quality, 131072, 48000, input, output);
+		expected = INPUT_SAMPLES * 48000 / 131072;
+		assert_true(count >= expected - 8 && count <= expected);
+	}
+	free(input);
+	free(output);
+}
+
+M_TEST_DEFINE(passband) {
+	struct mStereoSample* input = calloc(INPUT_SAMPLES, sizeof(*input));
+	struct mStereoSample* output = calloc(OUTPUT_SAMPLES, sizeof(*output));
+	_sine(input, 1000, 32768, 16000);
+	enum mAudioResamplerQuality quality;
+	for (quality = mAUDIO_RESAMPLER_LOW; quality <= mAUDIO_RESAMPLER_HIGH; ++quality) {
+		size_t count = _resample(quality, 32768, 48000, input, output);
+		assert_float_equal(_amplitude(output, 64, count), 16000, 16000 * 0.02);
+		assert_int_equal(output[100].right, -output[100].left);
+	}
+	free(input);
+	free(output);
+}
+
+M_TEST_DEFINE(stopband) {
+	struct mStereoSample* input = calloc(INPUT_SAMPLES, sizeof(*input));
+	struct mStereoSample* output = calloc(OUTPUT_SAMPLES, sizeof(*output));
+	// A 40 kHz tone is above the 24 kHz output Nyquist frequency, so it would alias down to 8 kHz
+	// if it weren't filtered out first
+	_sine(input, 40000, 131072, 16000);
+	size_t count = _resample(mAUDIO_RESAMPLER_LOW, 131072, 48000, input, output);
+	assert_true(_amplitude(output, 64, count) < 16000 * 0.15);
+	count = _resample(mAUDIO_RESAMPLER_MEDIUM, 131072, 48000, input, output);
+	assert_true(_amplitude(output, 64, count) < 16000 * 0.01);
+	count = _resample(mAUDIO_RESAMPLER_HIGH, 131072, 48000, input, output);
+	assert_true(_amplitude(output, 64, count) < 16000 * 0.001);
+	free(input);
+	free(output);
+}
+
+M_TEST_SUITE_DEFINE(mAudioResampler,
+	cmocka_unit_test(dcGain),
+	cmocka_unit_test(outputCount),
+	cmocka_unit_test(passband),
+	cmocka_unit_test(stopband),
+)
@@ -0,0 +1,266 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/batch.h>
+#include <mgba/core/core.h>
+
+#define N_CORES 13
+
+#ifndef DISABLE_THREADING
+static ThreadLocal _threadTag;
+static int _nextThreadTag = 0;
+#endif
+
+struct TestCore {
+	struct mCore d;
+	unsigned frames;
+	unsigned skipFrames;
+	unsigned renderedFrames;
+	uint32_t pixels[4];
+	uint32_t keys;
+	unsigned resets;
+	uintptr_t thread;
+	bool migrated;
+};
+
+static void _noteThread(struct TestCore* test) {
+	uintptr_t thread = 0;
+#ifndef DISABLE_THREADING
+	thread = (uintptr_t) ThreadLocalGetValue(_threadTag);
+	if (!thread) {
+		thread = ATOMIC_ADD(_nextThreadTag, 1);
+		ThreadLocalSetKey(_threadTag, (void*) thread);
+	}
+#endif
+	if (test->thread && test->thread != thread) {
+		test->migrated = true;
+	}
+	test->thread = thread;
+}
+
+static void _runFrame(struct mCore* core) {
+	struct TestCore* test = (struct TestCore*) core;
+	++test->frames;
+	_noteThread(test);
+	if (test->skipFrames) {
+		--test->skipFrames;
+	} else {
+		++test->renderedFrames;
+	}
+}
+
+static void _skipVideoFrames(struct mCore* core, unsigned frames) {
+	struct TestCore* test = (struct TestCore*) core;
+	test->skipFrames = frames;
+}
+
+static void _getPixels(struct mCore* core, const void** buffer, size_t* stride) {
+	struct TestCore* test = (struct TestCore*) core;
+	*buffer = test->pixels;
+	*stride = test->frames;
+}
+
+static struct blip_t* _getAudioChannel(struct mCore* core, int ch) {
+	struct TestCore* test = (struct TestCore*) core;
+	return (struct blip_t*) &test->pixels[ch];
+}
+
+static void _setKeys(struct mCore* core, uint32_t keys) {
+	struct TestCore* test = (struct TestCore*) core;
+	test->keys = keys;
+}
+
+static void _reset(struct mCore* core) {
+	struct TestCore* test = (struct TestCore*) core;
+	++test->resets;
+	_noteThread(test);
+}
+
+static void _initCores(struct TestCore* cores, size_t n) {
+	memset(cores, 0, sizeof(*cores) * n);
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		cores[i].d.runFrame = _runFrame;
+		cores[i].d.skipVideoFrames = _skipVideoFrames;
+		cores[i].d.getPixels = _getPixels;
+		cores[i].d.getAudioChannel = _getAudioChannel;
+		cores[i].d.setKeys = _setKeys;
+		cores[i].d.reset = _reset;
+	}
+}
+
+static void _runBatch(size_t workers) {
+	struct TestCore cores[N_CORES];
+	_initCores(cores, N_CORES);
+
+	struct mCoreBatch batch;
+	mCoreBatchInit(&batch, workers);
+	assert_null(mCoreBatchRunFrames(&batch, 1));
+
+	size_t i;
+	for (i = 0; i < N_CORES; ++i) {
+		assert_int_equal(mCoreBatchAddCore(&batch, &cores[i].d), i);
+	}
+	assert_int_equal(mCoreBatchSize(&batch), N_CORES);
+	assert_ptr_equal(mCoreBatchGetCore(&batch, 3), &cores[3].d);
+	assert_null(mCoreBatchGetCore(&batch, N_CORES));
+
+	unsigned round;
+	unsigned expected = 0;
+	for (round = 1; round <= 20; ++round) {
+		const struct mCoreBatchOutput* outputs = mCoreBatchRunFrames(&batch, round);
+		assert_non_null(outputs);
+		expected += round;
+		for (i = 0; i < N_CORES; ++i) {
+			assert_int_equal(cores[i].frames, expected);
+			assert_int_equal(cores[i].renderedFrames, round);
+			assert_ptr_equal(outputs[i].pixels, cores[i].pixels);
+			assert_int_equal(outputs[i].stride, expected);
+			assert_ptr_equal(outputs[i].audio[0], &cores[i].pixels[0]);
+			assert_ptr_equal(outputs[i].audio[1], &cores[i].pixels[1]);
+		}
+	}
+
+	mCoreBatchDeinit(&batch);
+}
+
+M_TEST_DEFINE(runInline) {
+	_runBatch(0);
+}
+
+M_TEST_DEFINE(runOneWorker) {
+	_runBatch(1);
+}
+
+M_TEST_DEFINE(runManyWorkers) {
+	_runBatch(4);
+}
+
+M_TEST_DEFINE(runMoreWorkersThanCores) {
+	_runBatch(N_CORES * 2);
+}
+
+M_TEST_DEFINE(setKeys) {
+	struct TestCore cores[N_CORES];
+	_initCores(cores, N_CORES);
+
+	struct mCoreBatch batch;
+	mCoreBatchInit(&batch, 0);
+	uint32_t keys[N_CORES];
+	size_t i;
+	for (i = 0; i < N_CORES; ++i) {
+		mCoreBatchAddCore(&batch, &cores[i].d);
+		keys[i] = i * 3 + 1;
+	}
+	mCoreBatchSetKeys(&batch, keys);
+	for (i = 0; i < N_CORES; ++i) {
+		assert_int_equal(cores[i].keys, i * 3 + 1);
+	}
+	mCoreBatchDeinit(&batch);
+}
+
+M_TEST_DEFINE(clearCores) {
+	struct TestCore cores[N_CORES];
+	_initCores(cores, N_CORES);
+
+	struct mCoreBatch batch;
+	mCoreBatchInit(&batch, 2);
+	size_t i;
+	for (i = 0; i < N_CORES; ++i) {
+		mCoreBatchAddCore(&batch, &cores[i].d);
+	}
+	assert_non_null(mCoreBatchRunFrames(&batch, 1));
+
+	mCoreBatchClear(&batch);
+	assert_int_equal(mCoreBatchSize(&batch), 0);
+	assert_null(mCoreBatchRunFrames(&batch, 1));
+
+	// Only the cores added since the batch was cleared run
+	for (i = 0; i < N_CORES; i += 2) {
+		assert_int_equal(mCoreBatchAddCore(&batch, &cores[i].d), i / 2);
+	}
+	const struct mCoreBatchOutput* outputs = mCoreBatchRunFrames(&batch, 2);
+	assert_non_null(outputs);
+	for (i = 0; i < N_CORES; ++i) {
+		assert_int_equal(cores[i].frames, i & 1 ? 1 : 3);
+	}
+	assert_int_equal(outputs[1].stride, 3);
+	mCoreBatchDeinit(&batch);
+}
+
+#ifndef DISABLE_THREADING
+M_TEST_DEFINE(stableAffinity) {
+	struct TestCore cores[N_CORES];
+	_initCores(cores, N_CORES);
+	ThreadLocalInitKey(&_threadTag);
+
+	struct mCoreBatch batch;
+	mCoreBatchInit(&batch, 4);
+	mCoreBatchSetStableAffinity(&batch, true);
+	size_t i;
+	for (i = 0; i < N_CORES; ++i) {
+		mCoreBatchAddCore(&batch, &cores[i].d);
+	}
+
+	mCoreBatchReset(&batch);
+	unsigned round;
+	for (round = 1; round <= 20; ++round) {
+		assert_non_null(mCoreBatchRunFrames(&batch, 1));
+	}
+
+	size_t threads = 1;
+	for (i = 0; i < N_CORES; ++i) {
+		assert_int_equal(cores[i].resets, 1);
+		assert_int_equal(cores[i].frames, 20);
+		// Every core stays on the thread that reset it
+		assert_false(cores[i].migrated);
+		if (i && cores[i].thread != cores[i - 1].thread) {
+			++threads;
+		}
+	}
+	// The calling thread and all four workers get a contiguous block each
+	assert_int_equal(threads, 5);
+
+	mCoreBatchDeinit(&batch);
+}
+
+M_TEST_DEFINE(stableAffinityOneCore) {
+	struct TestCore cores[1];
+	_initCores(cores, 1);
+	ThreadLocalInitKey(&_threadTag);
+
+	struct mCoreBatch batch;
+	mCoreBatchInit(&batch, 2);
+	mCoreBatchPinWorkers(&batch, 0);
+	mCoreBatchAddCore(&batch, &cores[0].d);
+	mCoreBatchReset(&batch);
+	unsigned round;
+	for (round = 1; round <= 5; ++round) {
+		assert_non_null(mCoreBatchRunFrames(&batch, 2));
+	}
+	assert_int_equal(cores[0].resets, 1);
+	assert_int_equal(cores[0].frames, 10);
+	assert_false(cores[0].migrated);
+
+	mCoreBatchPinWorkers(&batch, -1);
+	assert_non_null(mCoreBatchRunFrames(&batch, 1));
+	mCoreBatchDeinit(&batch);
+}
+#endif
+
+M_TEST_SUITE_DEFINE(mCoreBatch,
+	cmocka_unit_test(runInline),
+	cmocka_unit_test(runOneWorker),
+	cmocka_unit_test(runManyWorkers),
+	cmocka_unit_test(runMoreWorkersThanCores),
+	cmocka_unit_test(setKeys),
+	cmocka_unit_test(clearCores),
+#ifndef DISABLE_THREADING
+	cmocka_unit_test(stableAffinity),
+	cmocka_unit_test(stableAffinityOneCore),
+#endif
+)
@@ -0,0 +1,71 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/blip_buf.h>
+#include <mgba-util/hash.h>
+
+#define CLOCK_RATE 0x400000
+#define SAMPLE_RATE 48000
+#define FRAME_CLOCKS 0x4000
+#define FRAMES 32
+
+static uint32_t _resample(int range) {
+	blip_t* blip = blip_new(0x1000);
+	blip_set_rates(blip, CLOCK_RATE, SAMPLE_RATE);
+	short out[0x1000];
+	uint32_t hash = 0;
+	uint32_t seed = 0x12345678;
+	int last = 0;
+	int frame;
+	for (frame = 0; frame < FRAMES; ++frame) {
+		unsigned clock;
+		for (clock = 0; clock < FRAME_CLOCKS; clock += 1 + (seed >> 24)) {
+			seed = seed * 1103515245 + 12345;
+			int sample = (int) (seed % (2 * range + 1)) - range;
+			blip_add_delta(blip, clock, sample - last);
+			last = sample;
+		}
+		blip_end_frame(blip, FRAME_CLOCKS);
+		int count = blip_read_samples(blip, out, blip_samples_avail(blip), false);
+		assert_int_not_equal(count, 0);
+		hash = hash32(out, count * sizeof(*out), hash);
+	}
+	blip_delete(blip);
+	return hash;
+}
+
+M_TEST_DEFINE(smallDeltas) {
+	// Every delta fits in 16 bits
+	assert_int_equal(_resample(0x3FFF), 0xC76112F9);
+}
+
+M_TEST_DEFINE(largeDeltas) {
+	// Deltas between full-scale samples, and the clamping that comes with them
+	assert_int_equal(_resample(0x7FFF * 4), 0x510F1444);
+}
+
+M_TEST_DEFINE(resize) {
+	blip_t* blip = blip_new(0x1000);
+	blip_set_rates(blip, CLOCK_RATE, SAMPLE_RATE);
+	blip_end_frame(blip, FRAME_CLOCKS);
+	int avail = blip_samples_avail(blip);
+	assert_int_not_equal(avail, 0);
+
+	// The rates carry over, and the buffer starts out empty
+	blip = blip_resize(blip, 0x400);
+	assert_non_null(blip);
+	assert_int_equal(blip_samples_avail(blip), 0);
+	blip_end_frame(blip, FRAME_CLOCKS);
+	assert_int_equal(blip_samples_avail(blip), avail);
+	blip_delete(blip);
+}
+
+M_TEST_SUITE_DEFINE(BlipBuf,
+	cmocka_unit_test(smallDeltas),
+	cmocka_unit_test(largeDeltas),
+	cmocka_unit_test(resize),
+)
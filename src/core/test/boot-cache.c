@@ -0,0 +1,143 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/boot-cache.h>
+#include <mgba/core/core.h>
+#include <mgba/core/serialize.h>
+#include <mgba-util/vfs.h>
+
+#include "core/test/test-core.h"
+
+#ifdef M_CORE_GBA
+#include <mgba/internal/gba/memory.h>
+#define TEST_PLATFORM mPLATFORM_GBA
+#define RAM_BASE GBA_BASE_IWRAM
+#elif defined(M_CORE_GB)
+#include <mgba/internal/gb/memory.h>
+#define TEST_PLATFORM mPLATFORM_GB
+#define RAM_BASE GB_BASE_WORKING_RAM_BANK0
+#else
+#error "Need a valid platform for testing"
+#endif
+
+#define TEST_DIR "boot-cache-test"
+#define TEST_FRAME 3
+#define MAX_FRAMES 8
+
+M_TEST_SUITE_SETUP(mBootCache) {
+	struct mCore* core = mTestCoreCreate(TEST_PLATFORM);
+	assert_true(VDirCreate(TEST_DIR));
+	*state = core;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(mBootCache) {
+	struct mCore* core = *state;
+	struct VDir* dir = VDirOpen(TEST_DIR);
+	if (dir) {
+		struct VDirEntry* entry;
+		while ((entry = dir->listNext(dir))) {
+			if (entry->type(entry) == VFS_FILE) {
+				dir->deleteFile(dir, entry->name(entry));
+			}
+		}
+		dir->close(dir);
+	}
+	rmdir(TEST_DIR);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	return 0;
+}
+
+static void _boot(struct mCore* core, struct mBootCache* cache) {
+	size_t i;
+	for (i = 0; cache->pending && i < MAX_FRAMES; ++i) {
+		core->runFrame(core);
+	}
+	assert_false(cache->pending);
+}
+
+M_TEST_DEFINE(storeAndRestore) {
+	struct mCore* core = *state;
+	struct mBootCache cache;
+	mBootCacheInit(&cache, core, VDirOpen(TEST_DIR), TEST_FRAME);
+
+	core->reset(core);
+	assert_false(mBootCacheRestore(&cache));
+	core->rawWrite8(core, RAM_BASE, -1, 0x5A);
+	_boot(core, &cache);
+	assert_true(core->frameCounter(core) >= TEST_FRAME);
+
+	// Running on past the cached frame shouldn't touch the entry
+	core->runFrame(core);
+	core->rawWrite8(core, RAM_BASE, -1, 0);
+	core->reset(core);
+	assert_true(mBootCacheRestore(&cache));
+	assert_false(cache.pending);
+	assert_int_equal(core->rawRead8(core, RAM_BASE, -1), 0x5A);
+	assert_int_equal(core->frameCounter(core), TEST_FRAME);
+
+	core->clearCoreCallbacks(core);
+	mBootCacheDeinit(&cache);
+}
+
+M_TEST_DEFINE(configChange) {
+	struct mCore* core = *state;
+	struct mBootCache cache;
+	mBootCacheInit(&cache, core, VDirOpen(TEST_DIR), TEST_FRAME);
+
+	core->reset(core);
+	if (!mBootCacheRestore(&cache)) {
+		_boot(core, &cache);
+	}
+
+	mCoreConfigSetValue(&core->config, "bootCacheTest", "1");
+	core->reset(core);
+	assert_false(mBootCacheRestore(&cache));
+	assert_true(cache.pending);
+
+	mCoreConfigSetValue(&core->config, "bootCacheTest", NULL);
+	core->reset(core);
+	assert_true(mBootCacheRestore(&cache));
+
+	core->clearCoreCallbacks(core);
+	mBootCacheDeinit(&cache);
+}
+
+M_TEST_DEFINE(interrupted) {
+	struct mCore* core = *state;
+	struct mBootCache cache;
+	mBootCacheInit(&cache, core, VDirOpen(TEST_DIR), TEST_FRAME);
+
+	mCoreConfigSetValue(&core->config, "bootCacheTest", "2");
+	core->reset(core);
+	core->runFrame(core);
+	core->runFrame(core);
+	struct VFile* later = VFileMemChunk(NULL, 0);
+	assert_true(mCoreSaveStateNamed(core, later, SAVESTATE_RTC));
+
+	core->reset(core);
+	assert_false(mBootCacheRestore(&cache));
+	core->runFrame(core);
+	later->seek(later, 0, SEEK_SET);
+	assert_true(mCoreLoadStateNamed(core, later, SAVESTATE_RTC));
+	_boot(core, &cache);
+
+	// Nothing should have been stored, since the state was loaded partway through booting
+	core->reset(core);
+	assert_false(mBootCacheRestore(&cache));
+
+	later->close(later);
+	mCoreConfigSetValue(&core->config, "bootCacheTest", NULL);
+	core->clearCoreCallbacks(core);
+	mBootCacheDeinit(&cache);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mBootCache,
+	cmocka_unit_test(storeAndRestore),
+	cmocka_unit_test(configChange),
+	cmocka_unit_test(interrupted))
@@ -0,0 +1,98 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/dirty-tracker.h>
+
+M_TEST_DEFINE(onlyWatchedChanges) {
+	uint16_t palette[256] = {0};
+	uint8_t oam[64] = {0};
+	struct mDirtyTracker tracker;
+	mDirtyTrackerInit(&tracker);
+	int paletteId = mDirtyTrackerAddRegion(&tracker, palette, sizeof(palette));
+	int oamId = mDirtyTrackerAddRegion(&tracker, oam, sizeof(oam));
+	assert_int_equal(paletteId, 0);
+	assert_int_equal(oamId, 1);
+
+	// Nothing is compared until something is watching
+	palette[3] = 0x7FFF;
+	assert_int_equal(mDirtyTrackerUpdate(&tracker), 0);
+
+	mDirtyTrackerWatch(&tracker, paletteId);
+	assert_int_equal(mDirtyTrackerUpdate(&tracker), 0);
+	assert_int_equal(mDirtyTrackerUpdate(&tracker), 0);
+	assert_int_equal(mDirtyTrackerGeneration(&tracker, paletteId), 0);
+
+	palette[255] = 0x1234;
+	oam[5] = 1;
+	assert_int_equal(mDirtyTrackerUpdate(&tracker), 1 << paletteId);
+	assert_int_equal(mDirtyTrackerGeneration(&tracker, paletteId), 1);
+	assert_int_equal(mDirtyTrackerGeneration(&tracker, oamId), 0);
+
+	// Writing the same value back isn't a change
+	palette[255] = 0x1234;
+	assert_int_equal(mDirtyTrackerUpdate(&tracker), 0);
+
+	mDirtyTrackerWatch(&tracker, oamId);
+	assert_int_equal(mDirtyTrackerUpdate(&tracker), 0);
+	// Changes within one update are coalesced
+	palette[0] = 1;
+	palette[1] = 2;
+	oam[0] = 2;
+	assert_int_equal(mDirtyTrackerUpdate(&tracker), (1 << paletteId) | (1 << oamId));
+	assert_int_equal(mDirtyTrackerGeneration(&tracker, paletteId), 2);
+	assert_int_equal(mDirtyTrackerGeneration(&tracker, oamId), 1);
+
+	mDirtyTrackerDeinit(&tracker);
+}
+
+M_TEST_DEFINE(rewatch) {
+	uint8_t io[16] = {0};
+	struct mDirtyTracker tracker;
+	mDirtyTrackerInit(&tracker);
+	int ioId = mDirtyTrackerAddRegion(&tracker, io, sizeof(io));
+
+	mDirtyTrackerWatch(&tracker, ioId);
+	mDirtyTrackerWatch(&tracker, ioId);
+	assert_int_equal(mDirtyTrackerUpdate(&tracker), 0);
+	mDirtyTrackerUnwatch(&tracker, ioId);
+	io[2] = 1;
+	assert_int_equal(mDirtyTrackerUpdate(&tracker), 1 << ioId);
+
+	// Once nobody's watching, changes go unnoticed and the next watcher starts from scratch
+	mDirtyTrackerUnwatch(&tracker, ioId);
+	assert_int_equal(mDirtyTrackerUpdate(&tracker), 0);
+	assert_null(tracker.regions[ioId].shadow);
+	io[3] = 1;
+	assert_int_equal(mDirtyTrackerUpdate(&tracker), 0);
+	mDirtyTrackerWatch(&tracker, ioId);
+	assert_int_equal(mDirtyTrackerUpdate(&tracker), 0);
+	io[3] = 2;
+	assert_int_equal(mDirtyTrackerUpdate(&tracker), 1 << ioId);
+
+	mDirtyTrackerDeinit(&tracker);
+}
+
+M_TEST_DEFINE(tooManyRegions) {
+	uint8_t data[mDIRTY_TRACKER_MAX_REGIONS + 1];
+	struct mDirtyTracker tracker;
+	mDirtyTrackerInit(&tracker);
+	int i;
+	for (i = 0; i < mDIRTY_TRACKER_MAX_REGIONS; ++i) {
+		assert_int_equal(mDirtyTrackerAddRegion(&tracker, &data[i], 1), i);
+	}
+	assert_int_equal(mDirtyTrackerAddRegion(&tracker, &data[i], 1), -1);
+	// Out of range regions are ignored
+	mDirtyTrackerWatch(&tracker, -1);
+	mDirtyTrackerWatch(&tracker, mDIRTY_TRACKER_MAX_REGIONS);
+	assert_int_equal(mDirtyTrackerGeneration(&tracker, -1), 0);
+	mDirtyTrackerDeinit(&tracker);
+}
+
+M_TEST_SUITE_DEFINE(mDirtyTracker,
+	cmocka_unit_test(onlyWatchedChanges),
+	cmocka_unit_test(rewatch),
+	cmocka_unit_test(tooManyRegions))
@@ -0,0 +1,85 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/library.h>
+
+M_TEST_SUITE_SETUP(mLibrary) {
+	struct mLibrary* library = mLibraryCreateEmpty();
+	if (!library) {
+		return -1;
+	}
+	*state = library;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(mLibrary) {
+	mLibraryDestroy(*state);
+	return 0;
+}
+
+M_TEST_DEFINE(idleLoopMissing) {
+	struct mLibrary* library = *state;
+	struct mLibraryIdleLoop loop;
+	assert_false(mLibraryFindIdleLoop(library, mPLATFORM_GBA, 0x12345678, &loop));
+}
+
+M_TEST_DEFINE(idleLoopConfidence) {
+	struct mLibrary* library = *state;
+	struct mLibraryIdleLoop loop = {
+		.internalCode = "AGB-TEST",
+		.platform = mPLATFORM_GBA,
+		.crc32 = 0x89ABCDEF,
+		.address = 0x08000100,
+	};
+	struct mLibraryIdleLoop found;
+
+	mLibraryAddIdleLoop(library, &loop);
+	assert_true(mLibraryFindIdleLoop(library, mPLATFORM_GBA, 0x89ABCDEF, &found));
+	assert_string_equal(found.internalCode, "AGB-TEST");
+	assert_int_equal(found.address, 0x08000100);
+	assert_int_equal(found.confidence, 1);
+	assert_false(mLibraryFindIdleLoop(library, mPLATFORM_GB, 0x89ABCDEF, &found));
+
+	mLibraryAddIdleLoop(library, &loop);
+	mLibraryAddIdleLoop(library, &loop);
+	assert_true(mLibraryFindIdleLoop(library, mPLATFORM_GBA, 0x89ABCDEF, &found));
+	assert_int_equal(found.confidence, 3);
+
+	// A different loop replaces the old one and starts over
+	loop.address = 0x08000200;
+	mLibraryAddIdleLoop(library, &loop);
+	assert_true(mLibraryFindIdleLoop(library, mPLATFORM_GBA, 0x89ABCDEF, &found));
+	assert_int_equal(found.address, 0x08000200);
+	assert_int_equal(found.confidence, 1);
+}
+
+M_TEST_DEFINE(idleLoopList) {
+	struct mLibrary* library = *state;
+	struct mLibraryIdleLoop loop = {
+		.internalCode = "AGB-LIST",
+		.platform = mPLATFORM_GBA,
+		.crc32 = 0x11111111,
+		.address = 0x08000300,
+	};
+	mLibraryAddIdleLoop(library, &loop);
+	mLibraryAddIdleLoop(library, &loop);
+	loop.crc32 = 0x22222222;
+	mLibraryAddIdleLoop(library, &loop);
+
+	struct mLibraryIdleLoopList loops;
+	mLibraryIdleLoopListInit(&loops, 0);
+	assert_int_equal(mLibraryGetIdleLoops(library, &loops, 2), 1);
+	assert_int_equal(mLibraryIdleLoopListGetPointer(&loops, 0)->crc32, 0x11111111);
+	assert_int_equal(mLibraryIdleLoopListGetPointer(&loops, 0)->confidence, 2);
+	assert_true(mLibraryGetIdleLoops(library, &loops, 1) >= 2);
+	mLibraryIdleLoopListDeinit(&loops);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mLibrary,
+	cmocka_unit_test(idleLoopMissing),
+	cmocka_unit_test(idleLoopConfidence),
+	cmocka_unit_test(idleLoopList))
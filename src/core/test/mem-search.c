@@ -0,0 +1,291 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/mem-search.h>
+
+#define RAM_SIZE 0x28000
+
+struct TestCore {
+	struct mCore d;
+	uint8_t ram[RAM_SIZE];
+};
+
+struct TestProgress {
+	size_t calls;
+	size_t lastDone;
+	size_t total;
+	size_t stopAfter;
+};
+
+static const struct mCoreMemoryBlock _blocks[] = {
+	{ 0, "ram", "RAM", "RAM", 0x02000000, 0x02000000 + RAM_SIZE, RAM_SIZE, mCORE_MEMORY_RW, 0, 0 },
+};
+
+static size_t _listMemoryBlocks(const struct mCore* core, const struct mCoreMemoryBlock** blocks) {
+	UNUSED(core);
+	*blocks = _blocks;
+	return sizeof(_blocks) / sizeof(*_blocks);
+}
+
+static void* _getMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
+	struct TestCore* test = (struct TestCore*) core;
+	UNUSED(id);
+	*sizeOut = RAM_SIZE;
+	return test->ram;
+}
+
+static uint32_t _rawRead8(struct mCore* core, uint32_t address, int segment) {
+	struct TestCore* test = (struct TestCore*) core;
+	UNUSED(segment);
+	return test->ram[address - 0x02000000];
+}
+
+static uint32_t _rawRead16(struct mCore* core, uint32_t address, int segment) {
+	return _rawRead8(core, address, segment) | (_rawRead8(core, address + 1, segment) << 8);
+}
+
+static uint32_t _rawRead32(struct mCore* core, uint32_t address, int segment) {
+	return _rawRead16(core, address, segment) | (_rawRead16(core, address + 2, segment) << 16);
+}
+
+static bool _progress(void* context, size_t done, size_t total) {
+	struct TestProgress* progress = context;
+	assert_true(done >= progress->lastDone);
+	assert_true(done <= total);
+	++progress->calls;
+	progress->lastDone = done;
+	progress->total = total;
+	return !progress->stopAfter || progress->calls < progress->stopAfter;
+}
+
+static struct TestCore* _createCore(void) {
+	struct TestCore* test = calloc(1, sizeof(*test));
+	test->d.listMemoryBlocks = _listMemoryBlocks;
+	test->d.getMemoryBlock = _getMemoryBlock;
+	test->d.rawRead8 = _rawRead8;
+	test->d.rawRead16 = _rawRead16;
+	test->d.rawRead32 = _rawRead32;
+	return test;
+}
+
+M_TEST_DEFINE(searchProgress) {
+	struct TestCore* test = _createCore();
+	test->ram[0x10] = 0x5A;
+	test->ram[0x10010] = 0x5A;
+	test->ram[RAM_SIZE - 1] = 0x5A;
+
+	struct mCoreMemorySearchParams params = {
+		.memoryFlags = mCORE_MEMORY_RW,
+		.type = mCORE_MEMORY_SEARCH_INT,
+		.op = mCORE_MEMORY_SEARCH_EQUAL,
+		.align = 1,
+		.width = 1,
+		.valueInt = 0x5A,
+	};
+	struct mCoreMemorySearchResults results;
+	mCoreMemorySearchResultsInit(&results, 0);
+
+	struct TestProgress progress = {0};
+	assert_true(mCoreMemorySearchWithProgress(&test->d, &params, &results, 0, _progress, &progress));
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 3);
+	assert_int_equal(mCoreMemorySearchResultsGetPointer(&results, 1)->address, 0x02010010);
+	assert_int_equal(mCoreMemorySearchResultsGetPointer(&results, 2)->address, 0x02000000 + RAM_SIZE - 1);
+	assert_true(progress.calls > 2);
+	assert_int_equal(progress.lastDone, RAM_SIZE);
+	assert_int_equal(progress.total, RAM_SIZE);
+
+	mCoreMemorySearchResultsClear(&results);
+	mCoreMemorySearch(&test->d, &params, &results, 0);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 3);
+
+	mCoreMemorySearchResultsDeinit(&results);
+	free(test);
+}
+
+M_TEST_DEFINE(searchStringAcrossChunks) {
+	struct TestCore* test = _createCore();
+	memcpy(&test->ram[0xFFFE], "mGBA", 4);
+
+	struct mCoreMemorySearchParams params = {
+		.memoryFlags = mCORE_MEMORY_RW,
+		.type = mCORE_MEMORY_SEARCH_STRING,
+		.width = 4,
+		.valueStr = "mGBA",
+	};
+	struct mCoreMemorySearchResults results;
+	mCoreMemorySearchResultsInit(&results, 0);
+
+	struct TestProgress progress = {0};
+	assert_true(mCoreMemorySearchWithProgress(&test->d, &params, &results, 0, _progress, &progress));
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 1);
+	assert_int_equal(mCoreMemorySearchResultsGetPointer(&results, 0)->address, 0x0200FFFE);
+
+	mCoreMemorySearchResultsDeinit(&results);
+	free(test);
+}
+
+M_TEST_DEFINE(searchCancel) {
+	struct TestCore* test = _createCore();
+	test->ram[0x10] = 0x5A;
+	test->ram[RAM_SIZE - 1] = 0x5A;
+
+	struct mCoreMemorySearchParams params = {
+		.memoryFlags = mCORE_MEMORY_RW,
+		.type = mCORE_MEMORY_SEARCH_INT,
+		.op = mCORE_MEMORY_SEARCH_EQUAL,
+		.align = 1,
+		.width = 1,
+		.valueInt = 0x5A,
+	};
+	struct mCoreMemorySearchResults results;
+	mCoreMemorySearchResultsInit(&results, 0);
+
+	struct TestProgress progress = { .stopAfter = 1 };
+	assert_false(mCoreMemorySearchWithProgress(&test->d, &params, &results, 0, _progress, &progress));
+	assert_int_equal(progress.calls, 1);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 1);
+
+	mCoreMemorySearchResultsDeinit(&results);
+	free(test);
+}
+
+M_TEST_DEFINE(repeatProgress) {
+	struct TestCore* test = _createCore();
+	size_t i;
+	for (i = 0; i < 0x1000; ++i) {
+		test->ram[i] = 7;
+	}
+
+	struct mCoreMemorySearchParams params = {
+		.memoryFlags = mCORE_MEMORY_RW,
+		.type = mCORE_MEMORY_SEARCH_INT,
+		.op = mCORE_MEMORY_SEARCH_EQUAL,
+		.align = 1,
+		.width = 1,
+		.valueInt = 7,
+	};
+	struct mCoreMemorySearchResults results;
+	mCoreMemorySearchResultsInit(&results, 0);
+	mCoreMemorySearch(&test->d, &params, &results, 0);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 0x1000);
+
+	for (i = 0; i < 0x1000; i += 2) {
+		test->ram[i] = 8;
+	}
+	struct TestProgress progress = {0};
+	assert_true(mCoreMemorySearchRepeatWithProgress(&test->d, &params, &results, _progress, &progress));
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 0x800);
+	assert_true(progress.calls > 2);
+	assert_int_equal(progress.lastDone, 0x1000);
+	assert_int_equal(progress.total, 0x1000);
+
+	mCoreMemorySearchResultsDeinit(&results);
+	free(test);
+}
+
+M_TEST_DEFINE(searchWidths) {
+	struct TestCore* test = _createCore();
+	// Put matches both on and off vector boundaries, and a near miss in between
+	test->ram[0x100] = 0x34;
+	test->ram[0x101] = 0x12;
+	test->ram[0x10A] = 0x34;
+	test->ram[0x10B] = 0x12;
+	test->ram[0x200] = 0x34;
+	test->ram[0x201] = 0x13;
+	test->ram[0x1FFFC] = 0x78;
+	test->ram[0x1FFFD] = 0x56;
+	test->ram[0x1FFFE] = 0x34;
+	test->ram[0x1FFFF] = 0x12;
+
+	struct mCoreMemorySearchParams params = {
+		.memoryFlags = mCORE_MEMORY_RW,
+		.type = mCORE_MEMORY_SEARCH_INT,
+		.op = mCORE_MEMORY_SEARCH_EQUAL,
+		.align = 2,
+		.width = 2,
+		.valueInt = 0x1234,
+	};
+	struct mCoreMemorySearchResults results;
+	mCoreMemorySearchResultsInit(&results, 0);
+	mCoreMemorySearch(&test->d, &params, &results, 0);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 3);
+	assert_int_equal(mCoreMemorySearchResultsGetPointer(&results, 0)->address, 0x02000100);
+	assert_int_equal(mCoreMemorySearchResultsGetPointer(&results, 1)->address, 0x0200010A);
+	assert_int_equal(mCoreMemorySearchResultsGetPointer(&results, 2)->address, 0x0201FFFE);
+
+	mCoreMemorySearchResultsClear(&results);
+	params.align = 4;
+	params.width = 4;
+	params.valueInt = 0x12345678;
+	mCoreMemorySearch(&test->d, &params, &results, 0);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 1);
+	assert_int_equal(mCoreMemorySearchResultsGetPointer(&results, 0)->address, 0x0201FFFC);
+
+	mCoreMemorySearchResultsClear(&results);
+	params.type = mCORE_MEMORY_SEARCH_STRING;
+	params.valueStr = "\x34\x12";
+	params.width = 2;
+	mCoreMemorySearch(&test->d, &params, &results, 0);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 3);
+	assert_int_equal(mCoreMemorySearchResultsGetPointer(&results, 2)->address, 0x0201FFFE);
+
+	mCoreMemorySearchResultsDeinit(&results);
+	free(test);
+}
+
+M_TEST_DEFINE(snapshotRefine) {
+	struct TestCore* test = _createCore();
+	struct mCoreMemorySearchSnapshot snapshot;
+	mCoreMemorySearchSnapshotInit(&snapshot);
+	assert_int_equal(mCoreMemorySearchSnapshotTake(&test->d, &snapshot, mCORE_MEMORY_RW, 2), RAM_SIZE / 2);
+
+	test->ram[0x40] = 5;
+	test->ram[0x80] = 9;
+	test->ram[0x1000] = 3;
+	assert_int_equal(mCoreMemorySearchSnapshotRefine(&test->d, &snapshot, mCORE_MEMORY_SEARCH_DELTA_ANY, 0), 3);
+
+	test->ram[0x40] = 4;
+	test->ram[0x80] = 10;
+	assert_int_equal(mCoreMemorySearchSnapshotRefine(&test->d, &snapshot, mCORE_MEMORY_SEARCH_DELTA_NEGATIVE, 0), 1);
+
+	struct mCoreMemorySearchResults results;
+	mCoreMemorySearchResultsInit(&results, 0);
+	assert_int_equal(mCoreMemorySearchSnapshotResults(&snapshot, &results, 0), 1);
+	struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsGetPointer(&results, 0);
+	assert_int_equal(res->address, 0x02000040);
+	assert_int_equal(res->width, 2);
+	assert_int_equal(res->oldValue, 4);
+
+	// Results pick up where the snapshot left off
+	test->ram[0x40] = 6;
+	struct mCoreMemorySearchParams params = {
+		.memoryFlags = mCORE_MEMORY_RW,
+		.type = mCORE_MEMORY_SEARCH_INT,
+		.op = mCORE_MEMORY_SEARCH_DELTA,
+		.align = 2,
+		.width = 2,
+		.valueInt = 2,
+	};
+	mCoreMemorySearchRepeat(&test->d, &params, &results);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 1);
+
+	assert_int_equal(mCoreMemorySearchSnapshotRefine(&test->d, &snapshot, mCORE_MEMORY_SEARCH_DELTA, 2), 1);
+	assert_int_equal(mCoreMemorySearchSnapshotRefine(&test->d, &snapshot, mCORE_MEMORY_SEARCH_EQUAL, 7), 0);
+
+	mCoreMemorySearchResultsDeinit(&results);
+	mCoreMemorySearchSnapshotDeinit(&snapshot);
+	free(test);
+}
+
+M_TEST_SUITE_DEFINE(MemorySearch,
+	cmocka_unit_test(searchProgress),
+	cmocka_unit_test(searchStringAcrossChunks),
+	cmocka_unit_test(searchCancel),
+	cmocka_unit_test(repeatProgress),
+	cmocka_unit_test(searchWidths),
+	cmocka_unit_test(snapshotRefine))
@@ -0,0 +1,173 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/movie.h>
+#include <mgba-util/vfs.h>
+
+#include "core/test/test-core.h"
+
+#ifdef M_CORE_GBA
+#define TEST_PLATFORM mPLATFORM_GBA
+#elif defined(M_CORE_GB)
+#define TEST_PLATFORM mPLATFORM_GB
+#else
+#error "Need a valid platform for testing"
+#endif
+
+#define MOVIE_PATH "movie-test.mmv"
+#define FRAMES 100
+#define INTERVAL 16
+
+struct MovieTest {
+	struct mCore* core;
+	size_t stateSize;
+	void* reference[FRAMES + 1];
+};
+
+static uint32_t _keys(uint32_t frame, uint32_t seed) {
+	return ((frame / 3) * seed) & 0x3FF;
+}
+
+M_TEST_SUITE_SETUP(mMovie) {
+	struct MovieTest* test = calloc(1, sizeof(*test));
+	struct mCore* core = mTestCoreCreate(TEST_PLATFORM);
+	core->reset(core);
+	// Freshly reset state doesn't survive a round trip exactly, so start from a running one
+	core->runFrame(core);
+	test->core = core;
+	test->stateSize = core->stateSize(core);
+	*state = test;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(mMovie) {
+	struct MovieTest* test = *state;
+	size_t i;
+	for (i = 0; i <= FRAMES; ++i) {
+		free(test->reference[i]);
+	}
+	mCoreConfigDeinit(&test->core->config);
+	test->core->deinit(test->core);
+	free(test);
+	remove(MOVIE_PATH);
+	return 0;
+}
+
+// Runs until frame end, saving the state before every frame so playback can be checked against it
+static void _record(struct MovieTest* test, struct mMovie* movie, uint32_t end, uint32_t seed) {
+	struct mCore* core = test->core;
+	while (true) {
+		uint32_t frame = movie->frame;
+		if (!test->reference[frame]) {
+			test->reference[frame] = calloc(1, test->stateSize);
+		}
+		assert_true(core->saveState(core, test->reference[frame]));
+		if (frame == end) {
+			break;
+		}
+		core->setKeys(core, _keys(frame, seed));
+		assert_true(mMovieRunFrame(movie));
+	}
+}
+
+static void _assertReference(struct MovieTest* test, uint32_t frame) {
+	void* current = calloc(1, test->stateSize);
+	assert_true(test->core->saveState(test->core, current));
+	assert_memory_equal(current, test->reference[frame], test->stateSize);
+	free(current);
+}
+
+M_TEST_DEFINE(seekPlayback) {
+	struct MovieTest* test = *state;
+	struct mMovie movie;
+	mMovieInit(&movie, test->core);
+	assert_true(mMovieStartRecording(&movie, VFileOpen(MOVIE_PATH, O_CREAT | O_TRUNC | O_RDWR), INTERVAL));
+	_record(test, &movie, FRAMES, 5);
+	assert_int_equal(mMovieKeyframeListSize(&movie.keyframes), (FRAMES + INTERVAL - 1) / INTERVAL);
+	assert_true(mMovieStop(&movie));
+
+	assert_true(mMovieStartPlayback(&movie, VFileOpen(MOVIE_PATH, O_RDONLY)));
+	assert_int_equal(mMovieFrameCount(&movie), FRAMES);
+	assert_int_equal(movie.keyframeInterval, INTERVAL);
+	_assertReference(test, 0);
+
+	static const uint32_t targets[] = { 37, FRAMES, INTERVAL, 0, INTERVAL * 2 - 1, 1 };
+	size_t i;
+	for (i = 0; i < sizeof(targets) / sizeof(*targets); ++i) {
+		assert_true(mMovieSeek(&movie, targets[i]));
+		assert_int_equal(movie.frame, targets[i]);
+		_assertReference(test, targets[i]);
+	}
+	assert_false(mMovieSeek(&movie, FRAMES + 1));
+
+	// Playing on from a seek follows the recording to its end
+	assert_true(mMovieSeek(&movie, FRAMES - 10));
+	for (i = FRAMES - 10; i < FRAMES; ++i) {
+		assert_true(mMovieRunFrame(&movie));
+		assert_int_equal(test->core->getKeys(test->core), _keys(i, 5));
+	}
+	assert_false(mMovieRunFrame(&movie));
+	_assertReference(test, FRAMES);
+	mMovieDeinit(&movie);
+}
+
+M_TEST_DEFINE(rerecord) {
+	struct MovieTest* test = *state;
+	struct mMovie movie;
+	mMovieInit(&movie, test->core);
+	assert_false(mMovieSeek(&movie, 0));
+	assert_true(mMovieStartRecording(&movie, VFileOpen(MOVIE_PATH, O_CREAT | O_TRUNC | O_RDWR), INTERVAL));
+	_record(test, &movie, 60, 5);
+
+	// Going back discards what came after, and recording picks up from there with new input
+	assert_true(mMovieSeek(&movie, INTERVAL * 2));
+	assert_int_equal(mMovieFrameCount(&movie), INTERVAL * 2);
+	assert_int_equal(mMovieKeyframeListSize(&movie.keyframes), 3);
+	_record(test, &movie, FRAMES, 7);
+	assert_true(mMovieStop(&movie));
+
+	assert_true(mMovieStartPlayback(&movie, VFileOpen(MOVIE_PATH, O_RDONLY)));
+	assert_int_equal(mMovieFrameCount(&movie), FRAMES);
+	assert_int_equal(mMovieKeyframeListSize(&movie.keyframes), (FRAMES + INTERVAL - 1) / INTERVAL);
+	assert_true(mMovieSeek(&movie, FRAMES));
+	_assertReference(test, FRAMES);
+	assert_true(mMovieSeek(&movie, INTERVAL * 2 + 5));
+	_assertReference(test, INTERVAL * 2 + 5);
+	mMovieDeinit(&movie);
+}
+
+M_TEST_DEFINE(rejectIncomplete) {
+	struct MovieTest* test = *state;
+	struct mMovie movie;
+	struct mMovie reader;
+	mMovieInit(&movie, test->core);
+	mMovieInit(&reader, test->core);
+	assert_true(mMovieStartRecording(&movie, VFileOpen(MOVIE_PATH, O_CREAT | O_TRUNC | O_RDWR), INTERVAL));
+	_record(test, &movie, 20, 5);
+
+	// The recording hasn't been stopped, so there's no index yet
+	assert_false(mMovieStartPlayback(&reader, VFileOpen(MOVIE_PATH, O_RDONLY)));
+	assert_int_equal(reader.mode, mMOVIE_IDLE);
+	assert_true(mMovieStop(&movie));
+	assert_true(mMovieStartPlayback(&reader, VFileOpen(MOVIE_PATH, O_RDONLY)));
+	assert_true(mMovieStop(&reader));
+
+	struct VFile* vf = VFileOpen(MOVIE_PATH, O_RDWR);
+	assert_non_null(vf);
+	vf->truncate(vf, vf->size(vf) - 8);
+	vf->close(vf);
+	assert_false(mMovieStartPlayback(&reader, VFileOpen(MOVIE_PATH, O_RDONLY)));
+	assert_int_equal(reader.mode, mMOVIE_IDLE);
+	mMovieDeinit(&movie);
+	mMovieDeinit(&reader);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mMovie,
+	cmocka_unit_test(seekPlayback),
+	cmocka_unit_test(rerecord),
+	cmocka_unit_test(rejectIncomplete))
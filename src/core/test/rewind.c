@@ -0,0 +1,186 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/rewind.h>
+#include <mgba/core/serialize.h>
+#include <mgba-util/vfs.h>
+
+#include "core/test/test-core.h"
+
+#ifdef M_CORE_GBA
+#include <mgba/internal/gba/memory.h>
+#define TEST_PLATFORM mPLATFORM_GBA
+#define RAM_BASE GBA_BASE_IWRAM
+#elif defined(M_CORE_GB)
+#include <mgba/internal/gb/memory.h>
+#define TEST_PLATFORM mPLATFORM_GB
+#define RAM_BASE GB_BASE_WORKING_RAM_BANK0
+#else
+#error "Need a valid platform for testing"
+#endif
+
+#define STATES 8
+
+struct RewindTest {
+	struct mCore* core;
+	struct VFile* states[STATES];
+};
+
+M_TEST_SUITE_SETUP(mCoreRewind) {
+	struct RewindTest* test = calloc(1, sizeof(*test));
+	test->core = mTestCoreCreate(TEST_PLATFORM);
+	test->core->reset(test->core);
+	*state = test;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(mCoreRewind) {
+	struct RewindTest* test = *state;
+	size_t i;
+	for (i = 0; i < STATES; ++i) {
+		if (test->states[i]) {
+			test->states[i]->close(test->states[i]);
+		}
+	}
+	mCoreConfigDeinit(&test->core->config);
+	test->core->deinit(test->core);
+	free(test);
+	return 0;
+}
+
+static void _step(struct RewindTest* test, struct mCoreRewindContext* rewind, size_t i) {
+	size_t j;
+	for (j = 0; j < 0x100; ++j) {
+		test->core->rawWrite8(test->core, RAM_BASE + j * 7, -1, i * 31 + j);
+	}
+	test->core->runFrame(test->core);
+	mCoreRewindAppend(rewind, test->core);
+	if (test->states[i]) {
+		test->states[i]->close(test->states[i]);
+	}
+	test->states[i] = VFileMemChunk(NULL, 0);
+	assert_true(mCoreSaveStateNamed(test->core, test->states[i], SAVESTATE_SAVEDATA | SAVESTATE_RTC));
+}
+
+static void _assertState(struct RewindTest* test, size_t i) {
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mCoreSaveStateNamed(test->core, vf, SAVESTATE_SAVEDATA | SAVESTATE_RTC));
+	size_t size = vf->size(vf);
+	assert_int_equal(size, test->states[i]->size(test->states[i]));
+	void* expected = test->states[i]->map(test->states[i], size, MAP_READ);
+	void* actual = vf->map(vf, size, MAP_READ);
+	assert_memory_equal(actual, expected, size);
+	test->states[i]->unmap(test->states[i], expected, size);
+	vf->unmap(vf, actual, size);
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(restoreAll) {
+	struct RewindTest* test = *state;
+	struct mCoreRewindContext rewind = {0};
+	mCoreRewindContextInit(&rewind, STATES, false);
+	size_t i;
+	for (i = 0; i < STATES; ++i) {
+		_step(test, &rewind, i);
+	}
+	assert_true(rewind.memoryUsed > 0);
+	for (i = STATES - 1; i > 0; --i) {
+		assert_true(mCoreRewindRestore(&rewind, test->core));
+		_assertState(test, i - 1);
+	}
+	assert_true(mCoreRewindRestore(&rewind, test->core));
+	assert_false(mCoreRewindRestore(&rewind, test->core));
+	mCoreRewindContextDeinit(&rewind);
+}
+
+M_TEST_DEFINE(wrapAround) {
+	struct RewindTest* test = *state;
+	struct mCoreRewindContext rewind = {0};
+	mCoreRewindContextInit(&rewind, 4, false);
+	size_t i;
+	for (i = 0; i < STATES; ++i) {
+		_step(test, &rewind, i);
+	}
+	assert_int_equal(rewind.size, 4);
+	for (i = STATES - 1; i > STATES - 4; --i) {
+		assert_true(mCoreRewindRestore(&rewind, test->core));
+		_assertState(test, i - 1);
+	}
+
+	// Rewinding partway then continuing should pick up from the restored state
+	_step(test, &rewind, STATES - 3);
+	assert_true(mCoreRewindRestore(&rewind, test->core));
+	_assertState(test, STATES - 4);
+	mCoreRewindContextDeinit(&rewind);
+}
+
+M_TEST_DEFINE(restoreMany) {
+	struct RewindTest* test = *state;
+	struct mCoreRewindContext rewind = {0};
+	mCoreRewindContextInit(&rewind, STATES, false);
+	size_t i;
+	for (i = 0; i < STATES; ++i) {
+		_step(test, &rewind, i);
+	}
+	assert_int_equal(mCoreRewindRestoreMany(&rewind, test->core, 3), 3);
+	_assertState(test, STATES - 4);
+	assert_int_equal(mCoreRewindRestoreMany(&rewind, test->core, 2), 2);
+	_assertState(test, STATES - 6);
+	assert_true(mCoreRewindRestore(&rewind, test->core));
+	_assertState(test, STATES - 7);
+
+	// Jumping back should leave things the same as stepping back one at a time would
+	_step(test, &rewind, STATES - 6);
+	_step(test, &rewind, STATES - 5);
+	assert_int_equal(mCoreRewindRestoreMany(&rewind, test->core, 2), 2);
+	_assertState(test, STATES - 7);
+	assert_int_equal(mCoreRewindRestoreMany(&rewind, test->core, 0), 0);
+
+	// Asking for more than there is stops at the oldest state
+	size_t remaining = rewind.size;
+	assert_int_equal(mCoreRewindRestoreMany(&rewind, test->core, STATES), remaining);
+	assert_false(mCoreRewindRestore(&rewind, test->core));
+	mCoreRewindContextDeinit(&rewind);
+}
+
+M_TEST_DEFINE(memoryBudget) {
+	struct RewindTest* test = *state;
+	struct mCoreRewindContext rewind = {0};
+	mCoreRewindContextInit(&rewind, STATES, false);
+	size_t i;
+	for (i = 0; i < STATES; ++i) {
+		_step(test, &rewind, i);
+	}
+	assert_int_equal(rewind.size, STATES);
+	size_t perState = rewind.memoryUsed / STATES;
+
+	mCoreRewindContextSetMemoryBudget(&rewind, perState * 3);
+	assert_true(rewind.size < STATES);
+	assert_true(rewind.size > 1);
+	assert_true(rewind.memoryUsed <= perState * 3);
+	size_t remaining = rewind.size;
+	for (i = STATES - 1; i > STATES - remaining; --i) {
+		assert_true(mCoreRewindRestore(&rewind, test->core));
+		_assertState(test, i - 1);
+	}
+	assert_true(mCoreRewindRestore(&rewind, test->core));
+	assert_false(mCoreRewindRestore(&rewind, test->core));
+
+	mCoreRewindContextSetMemoryBudget(&rewind, 1);
+	for (i = 0; i < STATES; ++i) {
+		_step(test, &rewind, i);
+	}
+	assert_int_equal(rewind.size, 1);
+	mCoreRewindContextDeinit(&rewind);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mCoreRewind,
+	cmocka_unit_test(restoreAll),
+	cmocka_unit_test(wrapAround),
+	cmocka_unit_test(restoreMany),
+	cmocka_unit_test(memoryBudget))
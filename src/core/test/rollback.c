@@ -0,0 +1,151 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/rollback.h>
+#include <mgba-util/vfs.h>
+
+#include "core/test/test-core.h"
+
+#ifdef M_CORE_GBA
+#include <mgba/internal/gba/memory.h>
+#define TEST_PLATFORM mPLATFORM_GBA
+#define RAM_BASE GBA_BASE_IWRAM
+#elif defined(M_CORE_GB)
+#include <mgba/internal/gb/memory.h>
+#define TEST_PLATFORM mPLATFORM_GB
+#define RAM_BASE GB_BASE_WORKING_RAM_BANK0
+#else
+#error "Need a valid platform for testing"
+#endif
+
+#define FRAMES 24
+
+static struct mCore* _createCore(void) {
+	struct mCore* core = mTestCoreCreate(TEST_PLATFORM);
+	core->reset(core);
+	return core;
+}
+
+static void _destroyCore(struct mCore* core) {
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+// Fold every player's input into RAM so that the state depends on the full input history
+static void _setInputs(struct mCoreRollback* rollback, const uint32_t* inputs) {
+	struct mCore* core = rollback->core;
+	unsigned i;
+	for (i = 0; i < rollback->players; ++i) {
+		uint8_t value = core->rawRead8(core, RAM_BASE + i, -1);
+		core->rawWrite8(core, RAM_BASE + i, -1, value * 3 + inputs[i]);
+	}
+	core->setKeys(core, inputs[0]);
+}
+
+static uint32_t _keys(unsigned player, uint32_t frame) {
+	return ((frame / 3) * (player + 5)) & 0x3FF;
+}
+
+static void _assertSameState(struct mCore* a, struct mCore* b) {
+	size_t size = a->stateSize(a);
+	void* stateA = calloc(1, size);
+	void* stateB = calloc(1, size);
+	assert_true(a->saveState(a, stateA));
+	assert_true(b->saveState(b, stateB));
+	assert_memory_equal(stateA, stateB, size);
+	free(stateA);
+	free(stateB);
+}
+
+static void _runReference(struct mCoreRollback* rollback) {
+	uint32_t frame;
+	for (frame = 0; frame < FRAMES; ++frame) {
+		mCoreRollbackSetLocalKeys(rollback, _keys(0, frame));
+		assert_true(mCoreRollbackAddInput(rollback, 1, frame, _keys(1, frame)));
+		assert_true(mCoreRollbackRunFrame(rollback));
+	}
+	assert_int_equal(rollback->rollbacks, 0);
+}
+
+M_TEST_DEFINE(noMisprediction) {
+	struct mCore* core = _createCore();
+	struct mCoreRollback rollback;
+	mCoreRollbackInit(&rollback, core, 2, 0, 8);
+	rollback.setInputs = _setInputs;
+	_runReference(&rollback);
+	assert_int_equal(rollback.frame, FRAMES);
+	assert_int_equal(rollback.confirmedFrame, FRAMES);
+	mCoreRollbackDeinit(&rollback);
+	_destroyCore(core);
+}
+
+M_TEST_DEFINE(lateInput) {
+	struct mCore* core = _createCore();
+	struct mCore* reference = _createCore();
+	struct mCoreRollback rollback;
+	struct mCoreRollback referenceRollback;
+	mCoreRollbackInit(&rollback, core, 2, 0, 8);
+	mCoreRollbackInit(&referenceRollback, reference, 2, 0, 8);
+	rollback.setInputs = _setInputs;
+	referenceRollback.setInputs = _setInputs;
+	_runReference(&referenceRollback);
+
+	// The remote player's input arrives five frames late
+	uint32_t frame;
+	for (frame = 0; frame < FRAMES + 5; ++frame) {
+		if (frame >= 5) {
+			assert_true(mCoreRollbackAddInput(&rollback, 1, frame - 5, _keys(1, frame - 5)));
+		}
+		if (frame < FRAMES) {
+			mCoreRollbackSetLocalKeys(&rollback, _keys(0, frame));
+			assert_true(mCoreRollbackRunFrame(&rollback));
+		}
+	}
+	assert_int_equal(rollback.confirmedFrame, FRAMES);
+	assert_true(rollback.rollbacks > 0);
+	assert_true(rollback.resimulatedFrames >= rollback.rollbacks);
+
+	// Resimulation is done at the start of the next frame, so run one more with known input
+	mCoreRollbackSetLocalKeys(&rollback, _keys(0, FRAMES));
+	assert_true(mCoreRollbackAddInput(&rollback, 1, FRAMES, _keys(1, FRAMES)));
+	assert_true(mCoreRollbackRunFrame(&rollback));
+	mCoreRollbackSetLocalKeys(&referenceRollback, _keys(0, FRAMES));
+	assert_true(mCoreRollbackAddInput(&referenceRollback, 1, FRAMES, _keys(1, FRAMES)));
+	assert_true(mCoreRollbackRunFrame(&referenceRollback));
+	_assertSameState(core, reference);
+
+	mCoreRollbackDeinit(&rollback);
+	mCoreRollbackDeinit(&referenceRollback);
+	_destroyCore(core);
+	_destroyCore(reference);
+}
+
+M_TEST_DEFINE(stall) {
+	struct mCore* core = _createCore();
+	struct mCoreRollback rollback;
+	mCoreRollbackInit(&rollback, core, 2, 0, 4);
+	rollback.setInputs = _setInputs;
+	uint32_t frame;
+	for (frame = 0; frame < 4; ++frame) {
+		assert_true(mCoreRollbackRunFrame(&rollback));
+	}
+	// Player 1 hasn't sent anything, so we can't get any further ahead
+	assert_false(mCoreRollbackRunFrame(&rollback));
+	assert_int_equal(rollback.frame, 4);
+	assert_false(mCoreRollbackAddInput(&rollback, 1, 8, 0));
+	assert_true(mCoreRollbackAddInput(&rollback, 1, 0, 0));
+	assert_true(mCoreRollbackRunFrame(&rollback));
+	assert_false(mCoreRollbackRunFrame(&rollback));
+	mCoreRollbackDeinit(&rollback);
+	_destroyCore(core);
+}
+
+M_TEST_SUITE_DEFINE(mCoreRollback,
+	cmocka_unit_test(noMisprediction),
+	cmocka_unit_test(lateInput),
+	cmocka_unit_test(stall))
@@ -12,15 +12,18 @@
 #include <mgba/script.h>
 
 #include "script/test.h"
+#include "core/test/test-core.h"
 
 #ifdef M_CORE_GBA
 #include <mgba/internal/gba/memory.h>
 #define TEST_PLATFORM mPLATFORM_GBA
 #define RAM_BASE GBA_BASE_IWRAM
+#define RAM_DOMAIN "iwram"
 #elif defined(M_CORE_GB)
 #include <mgba/internal/gb/memory.h>
 #define TEST_PLATFORM mPLATFORM_GB
 #define RAM_BASE GB_BASE_WORKING_RAM_BANK0
+#define RAM_DOMAIN "wram"
 #else
 #error "Need a valid platform for testing"
 #endif
@@ -32,35 +35,13 @@ struct mScriptTestLogger {
 	char* error;
 };
 
-static const uint8_t _fakeGBROM[0x4000] = {
-	[0x100] = 0x18, // Loop forever
-	[0x101] = 0xFE, // jr, $-2
-	[0x102] = 0xCE, // Enough of the header to fool the core
-	[0x103] = 0xED,
-	[0x104] = 0x66,
-	[0x105] = 0x66,
-};
-
 #define SETUP_LUA \
 	struct mScriptContext context; \
 	mScriptContextInit(&context); \
 	struct mScriptEngineContext* lua = mScriptContextRegisterEngine(&context, mSCRIPT_ENGINE_LUA)
 
 #define CREATE_CORE \
-	struct mCore* core = mCoreCreate(TEST_PLATFORM); \
-	assert_non_null(core); \
-	assert_true(core->init(core)); \
-	switch (core->platform(core)) { \
-	case mPLATFORM_GBA: \
-		core->busWrite32(core, 0x020000C0, 0xEAFFFFFE); \
-		break; \
-	case mPLATFORM_GB: \
-		assert_true(core->loadROM(core, VFileFromConstMemory(_fakeGBROM, sizeof(_fakeGBROM)))); \
-		break; \
-	case mPLATFORM_NONE: \
-		break; \
-	} \
-	mCoreInitConfig(core, NULL); \
+	struct mCore* core = mTestCoreCreate(TEST_PLATFORM); \
 	mScriptContextAttachCore(&context, core)
 
 #define TEARDOWN_CORE \
@@ -253,6 +234,95 @@ M_TEST_DEFINE(memoryRead) {
 	TEARDOWN_CORE;
 }
 
+M_TEST_DEFINE(memoryView) {
+	SETUP_LUA;
+	CREATE_CORE;
+	core->reset(core);
+
+	LOAD_PROGRAM(
+		"view = emu.memory." RAM_DOMAIN ":view(4, 8)\n"
+		"size = view:size()\n"
+		"a8 = view:u8(0)\n"
+		"a16 = view:u16(1)\n"
+		"a32 = view:u32(4)\n"
+		"past = view:u32(6)\n"
+		"match = view:equals(2, \"\\7\\8\\9\")\n"
+		"mismatch = view:equals(2, \"\\7\\9\")\n"
+		"found = view:find(\"\\9\\10\")\n"
+		"notFound = view:find(\"\\5\", 2)\n"
+	);
+
+	int i;
+	for (i = 0; i < 16; ++i) {
+		core->busWrite8(core, RAM_BASE + i, i + 1);
+	}
+	assert_true(lua->run(lua));
+
+	TEST_VALUE(S32, "size", 8);
+	TEST_VALUE(S32, "a8", 5);
+	TEST_VALUE(S32, "a16", 0x0706);
+	TEST_VALUE(S32, "a32", 0x0C0B0A09);
+	TEST_VALUE(S32, "past", 0);
+	TEST_VALUE(BOOL, "match", true);
+	TEST_VALUE(BOOL, "mismatch", false);
+	TEST_VALUE(S32, "found", 4);
+	TEST_VALUE(S32, "notFound", -1);
+
+	core->busWrite8(core, RAM_BASE + 4, 0x55);
+	LOAD_PROGRAM("a8 = view:u8(0)\n");
+	assert_true(lua->run(lua));
+	TEST_VALUE(S32, "a8", 0x55);
+
+	mScriptContextDetachCore(&context);
+	LOAD_PROGRAM("a8 = view:u8(0)\n");
+	assert_true(lua->run(lua));
+	TEST_VALUE(S32, "a8", 0);
+
+	mScriptContextDeinit(&context);
+	TEARDOWN_CORE;
+}
+
+M_TEST_DEFINE(memoryCallback) {
+	SETUP_LUA;
+	CREATE_CORE;
+	core->reset(core);
+
+	LOAD_PROGRAM(
+		"hits = 0\n"
+		"function cb(offset, value, width)\n"
+		"	hits = hits + 1\n"
+		"	lastOffset = offset\n"
+		"	lastValue = value\n"
+		"	lastWidth = width\n"
+		"end\n"
+		"cbid = emu:addMemoryCallback(cb, \"" RAM_DOMAIN "\", 4, 8)\n"
+		"bad = emu:addMemoryCallback(cb, \"nonexistent\", 4, 8)\n"
+	);
+	assert_true(lua->run(lua));
+	TEST_VALUE(S32, "cbid", 1);
+	TEST_VALUE(S32, "bad", -1);
+
+	core->busWrite8(core, RAM_BASE + 12, 0x12);
+	core->busWrite8(core, RAM_BASE + 5, 0x34);
+	core->runFrame(core);
+	TEST_VALUE(S32, "hits", 1);
+	TEST_VALUE(S32, "lastOffset", 5);
+	TEST_VALUE(S32, "lastValue", 0x34);
+	TEST_VALUE(S32, "lastWidth", 1);
+	assert_int_equal(core->busRead8(core, RAM_BASE + 5), 0x34);
+
+	LOAD_PROGRAM("removed = emu:removeMemoryCallback(cbid)\n");
+	assert_true(lua->run(lua));
+	TEST_VALUE(BOOL, "removed", true);
+
+	core->busWrite8(core, RAM_BASE + 5, 0x56);
+	core->runFrame(core);
+	TEST_VALUE(S32, "hits", 1);
+
+	mScriptContextDeinit(&context);
+	TEARDOWN_CORE;
+}
+
 M_TEST_DEFINE(memoryWrite) {
 	SETUP_LUA;
 	CREATE_CORE;
@@ -281,6 +351,75 @@ M_TEST_DEFINE(memoryWrite) {
 	TEARDOWN_CORE;
 }
 
+M_TEST_DEFINE(memoryStats) {
+	SETUP_LUA;
+	CREATE_CORE;
+	core->reset(core);
+
+	LOAD_PROGRAM(
+		"before = emu:memoryStats()\n"
+		"enabled = emu:setMemoryStatsEnabled(true)\n"
+		"emu:write8(base, 1)\n"
+		"emu:read8(base)\n"
+		"emu:read8(base + 1)\n"
+		"for _, region in pairs(emu:memoryStats()) do\n"
+		"  if base >= region.start and base < region[\"end\"] then\n"
+		"    reads = region.reads\n"
+		"    writes = region.writes\n"
+		"  end\n"
+		"end\n"
+		"emu:setMemoryStatsEnabled(false)\n"
+		"after = emu:memoryStats()\n"
+	);
+
+	struct mScriptValue base = mSCRIPT_MAKE_S32(RAM_BASE);
+	lua->setGlobal(lua, "base", &base);
+	assert_true(lua->run(lua));
+
+	TEST_PROGRAM("assert(before == nil)");
+	TEST_VALUE(BOOL, "enabled", true);
+	TEST_VALUE(S32, "reads", 2);
+	TEST_VALUE(S32, "writes", 1);
+	TEST_PROGRAM("assert(after == nil)");
+
+	mScriptContextDeinit(&context);
+	TEARDOWN_CORE;
+}
+
+M_TEST_DEFINE(scriptWorker) {
+	SETUP_LUA;
+	CREATE_CORE;
+	core->reset(core);
+
+	static const char program[] =
+		"callbacks:add(\"frame\", function()\n"
+		"	local value = emu.memory." RAM_DOMAIN ":read8(4)\n"
+		"	emu.memory." RAM_DOMAIN ":write8(8, value + 1)\n"
+		"end)\n";
+	struct mScriptCoreWorker* worker = mScriptCoreWorkerCreate();
+	struct VFile* vf = VFileFromConstMemory(program, strlen(program));
+	assert_true(mScriptCoreWorkerLoadVF(worker, "worker.lua", vf));
+	vf->close(vf);
+	mScriptCoreWorkerAttachCore(worker, core);
+
+	core->busWrite8(core, RAM_BASE + 4, 0x12);
+	core->runFrame(core);
+	mScriptCoreWorkerFrameEnded(worker);
+	mScriptCoreWorkerWait(worker);
+	// Writes from the worker land at the next frame boundary
+	assert_int_equal(core->busRead8(core, RAM_BASE + 8), 0);
+
+	core->runFrame(core);
+	mScriptCoreWorkerFrameEnded(worker);
+	mScriptCoreWorkerWait(worker);
+	assert_int_equal(core->busRead8(core, RAM_BASE + 8), 0x13);
+
+	mScriptCoreWorkerDetachCore(worker);
+	mScriptCoreWorkerDestroy(worker);
+	mScriptContextDeinit(&context);
+	TEARDOWN_CORE;
+}
+
 M_TEST_DEFINE(logging) {
 	SETUP_LUA;
 	struct mScriptTestLogger logger;
@@ -724,7 +863,11 @@ M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptCore,
 	cmocka_unit_test(detach),
 	cmocka_unit_test(runFrame),
 	cmocka_unit_test(memoryRead),
+	cmocka_unit_test(memoryView),
+	cmocka_unit_test(memoryCallback),
 	cmocka_unit_test(memoryWrite),
+	cmocka_unit_test(memoryStats),
+	cmocka_unit_test(scriptWorker),
 	cmocka_unit_test(logging),
 	cmocka_unit_test(screenshot),
 #ifdef USE_DEBUGGERS
@@ -0,0 +1,238 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/serialize.h>
+#include <mgba-util/image.h>
+#include <mgba-util/vfs.h>
+
+#include "core/test/test-core.h"
+
+#ifdef M_CORE_GBA
+#include <mgba/internal/gba/memory.h>
+#define TEST_PLATFORM mPLATFORM_GBA
+#define RAM_BASE GBA_BASE_IWRAM
+#elif defined(M_CORE_GB)
+#include <mgba/internal/gb/memory.h>
+#define TEST_PLATFORM mPLATFORM_GB
+#define RAM_BASE GB_BASE_WORKING_RAM_BANK0
+#else
+#error "Need a valid platform for testing"
+#endif
+
+#define STATE_PATH "serialize-test.ss0"
+
+struct SerializeTest {
+	struct mCore* core;
+	color_t* video;
+	int saved;
+	int failed;
+};
+
+M_TEST_SUITE_SETUP(mCoreSerialize) {
+	struct SerializeTest* test = calloc(1, sizeof(*test));
+	test->core = mTestCoreCreate(TEST_PLATFORM);
+	unsigned width, height;
+	test->core->baseVideoSize(test->core, &width, &height);
+	test->video = calloc(width * height, BYTES_PER_PIXEL);
+	test->core->setVideoBuffer(test->core, test->video, width);
+	test->core->reset(test->core);
+	*state = test;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(mCoreSerialize) {
+	struct SerializeTest* test = *state;
+	mCoreConfigDeinit(&test->core->config);
+	test->core->deinit(test->core);
+	free(test->video);
+	free(test);
+	remove(STATE_PATH);
+	return 0;
+}
+
+static void _done(bool success, void* context) {
+	struct SerializeTest* test = context;
+	if (success) {
+		++test->saved;
+	} else {
+		++test->failed;
+	}
+}
+
+static void _roundTrip(struct SerializeTest* test, int flags) {
+	struct mCore* core = test->core;
+	size_t i;
+	for (i = 0; i < 0x100; ++i) {
+		core->rawWrite8(core, RAM_BASE + i * 7, -1, i * 31);
+	}
+
+	struct mStateWriter* writer = mStateWriterCreate();
+	test->saved = 0;
+	test->failed = 0;
+	assert_true(mStateWriterSave(writer, core, VFileOpen(STATE_PATH, O_CREAT | O_TRUNC | O_RDWR), flags, _done, test));
+
+	// The state was captured when saving, so later changes must not leak into it
+	for (i = 0; i < 0x100; ++i) {
+		core->rawWrite8(core, RAM_BASE + i * 7, -1, 0);
+	}
+	mStateWriterWait(writer);
+	assert_int_equal(test->saved, 1);
+	assert_int_equal(test->failed, 0);
+	mStateWriterDestroy(writer);
+
+	struct VFile* vf = VFileOpen(STATE_PATH, O_RDONLY);
+	assert_non_null(vf);
+	assert_true(mCoreLoadStateNamed(core, vf, flags));
+	vf->close(vf);
+	for (i = 0; i < 0x100; ++i) {
+		assert_int_equal(core->rawRead8(core, RAM_BASE + i * 7, -1), (uint8_t) (i * 31));
+	}
+}
+
+M_TEST_DEFINE(writerRaw) {
+	_roundTrip(*state, SAVESTATE_SAVEDATA | SAVESTATE_RTC | SAVESTATE_METADATA);
+}
+
+#ifdef USE_PNG
+M_TEST_DEFINE(writerPNG) {
+	_roundTrip(*state, SAVESTATE_SCREENSHOT | SAVESTATE_SAVEDATA | SAVESTATE_RTC | SAVESTATE_METADATA);
+}
+
+M_TEST_DEFINE(writerPNGQuick) {
+	_roundTrip(*state, SAVESTATE_SCREENSHOT | SAVESTATE_SAVEDATA | SAVESTATE_QUICK);
+}
+#endif
+
+M_TEST_DEFINE(writerDrainOnDestroy) {
+	struct SerializeTest* test = *state;
+	struct mStateWriter* writer = mStateWriterCreate();
+	test->saved = 0;
+	test->failed = 0;
+	int i;
+	for (i = 0; i < 4; ++i) {
+		assert_true(mStateWriterSave(writer, test->core, VFileMemChunk(NULL, 0), SAVESTATE_ALL, _done, test));
+	}
+	mStateWriterDestroy(writer);
+	assert_int_equal(test->saved, 4);
+	assert_int_equal(test->failed, 0);
+}
+
+static void _fillRAM(struct mCore* core, uint8_t seed) {
+	size_t i;
+	for (i = 0; i < 0x100; ++i) {
+		core->rawWrite8(core, RAM_BASE + i * 7, -1, i * 31 + seed);
+	}
+}
+
+static void _checkRAM(struct mCore* core, uint8_t seed) {
+	size_t i;
+	for (i = 0; i < 0x100; ++i) {
+		assert_int_equal(core->rawRead8(core, RAM_BASE + i * 7, -1), (uint8_t) (i * 31 + seed));
+	}
+}
+
+M_TEST_DEFINE(chunkedRoundTrip) {
+	struct SerializeTest* test = *state;
+	struct mCore* core = test->core;
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	_fillRAM(core, 1);
+	assert_true(mCoreSaveStateNamed(core, vf, SAVESTATE_CHUNKED | SAVESTATE_SAVEDATA | SAVESTATE_RTC | SAVESTATE_METADATA));
+	assert_true(vf->size(vf) < (ssize_t) core->stateSize(core));
+
+	// State chunks should tile the whole state, followed by extdata
+	struct mStateChunkList chunks;
+	mStateChunkListInit(&chunks, 0);
+	assert_true(mStateChunksRead(vf, &chunks));
+	assert_true(mStateChunkListSize(&chunks) > 2);
+	uint32_t covered = 0;
+	size_t i;
+	for (i = 0; i < mStateChunkListSize(&chunks); ++i) {
+		const struct mStateChunk* chunk = mStateChunkListGetConstPointer(&chunks, i);
+		if (chunk->tag == EXTDATA_NONE) {
+			assert_int_equal(chunk->offset, covered);
+			covered += chunk->size;
+		}
+	}
+	assert_int_equal(covered, core->stateSize(core));
+	mStateChunkListDeinit(&chunks);
+
+	struct mStateExtdata extdata;
+	struct mStateExtdataItem item;
+	mStateExtdataInit(&extdata);
+	assert_true(mCoreExtractExtdata(core, vf, &extdata));
+	assert_true(mStateExtdataGet(&extdata, EXTDATA_META_CREATOR, &item));
+	assert_non_null(item.data);
+	mStateExtdataDeinit(&extdata);
+
+	_fillRAM(core, 0);
+	assert_true(mCoreLoadStateNamed(core, vf, SAVESTATE_SAVEDATA | SAVESTATE_RTC));
+	_checkRAM(core, 1);
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(chunkedDelta) {
+	struct SerializeTest* test = *state;
+	struct mCore* core = test->core;
+	struct VFile* full = VFileMemChunk(NULL, 0);
+	struct VFile* delta = VFileMemChunk(NULL, 0);
+	_fillRAM(core, 2);
+	assert_true(mCoreSaveStateNamed(core, full, SAVESTATE_CHUNKED));
+
+	struct mStateChunkList base;
+	struct mStateChunkList changed;
+	mStateChunkListInit(&base, 0);
+	mStateChunkListInit(&changed, 0);
+	assert_true(mStateChunksRead(full, &base));
+
+	core->rawWrite8(core, RAM_BASE, -1, 0x55);
+	assert_true(mCoreSaveStateDelta(core, delta, 0, &base));
+	assert_true(mStateChunksRead(delta, &changed));
+	assert_true(mStateChunkListSize(&changed) >= 1);
+	assert_true(mStateChunkListSize(&changed) < mStateChunkListSize(&base));
+	assert_true(delta->size(delta) < full->size(full));
+
+	// Applying the delta on top of the base reproduces the newer state
+	assert_true(mCoreLoadStateNamed(core, full, 0));
+	assert_int_equal(core->rawRead8(core, RAM_BASE, -1), 2);
+	assert_true(mCoreLoadStateNamed(core, delta, 0));
+	assert_int_equal(core->rawRead8(core, RAM_BASE, -1), 0x55);
+	core->rawWrite8(core, RAM_BASE, -1, 2);
+	_checkRAM(core, 2);
+
+	mStateChunkListDeinit(&base);
+	mStateChunkListDeinit(&changed);
+	full->close(full);
+	delta->close(delta);
+}
+
+M_TEST_DEFINE(chunkedCorrupt) {
+	struct SerializeTest* test = *state;
+	struct mCore* core = test->core;
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	_fillRAM(core, 3);
+	assert_true(mCoreSaveStateNamed(core, vf, SAVESTATE_CHUNKED));
+	uint8_t* data = vf->map(vf, vf->size(vf), MAP_WRITE);
+	data[vf->size(vf) - 1] ^= 0xFF;
+	vf->unmap(vf, data, vf->size(vf));
+
+	_fillRAM(core, 0);
+	assert_false(mCoreLoadStateNamed(core, vf, 0));
+	_checkRAM(core, 0);
+	vf->close(vf);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mCoreSerialize,
+	cmocka_unit_test(writerRaw),
+#ifdef USE_PNG
+	cmocka_unit_test(writerPNG),
+	cmocka_unit_test(writerPNGQuick),
+#endif
+	cmocka_unit_test(writerDrainOnDestroy),
+	cmocka_unit_test(chunkedRoundTrip),
+	cmocka_unit_test(chunkedDelta),
+	cmocka_unit_test(chunkedCorrupt))
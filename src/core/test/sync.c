@@ -0,0 +1,244 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/audio-resampler.h>
+#include <mgba/core/blip_buf.h>
+#include <mgba/core/interface.h>
+#include <mgba/core/sync.h>
+#include <mgba-util/ring-fifo.h>
+
+#define RING_SAMPLES 64
+#define FRAME_SAMPLES 512
+
+struct SyncTest {
+	struct mCoreSync sync;
+	struct RingFIFO ring;
+	blip_t* left;
+	blip_t* right;
+};
+
+static int _setup(void** state) {
+	struct SyncTest* test = calloc(1, sizeof(*test));
+	MutexInit(&test->sync.audioBufferMutex);
+	ConditionInit(&test->sync.audioRequiredCond);
+	RingFIFOInit(&test->ring, RING_SAMPLES * sizeof(struct mStereoSample));
+	test->left = blip_new(FRAME_SAMPLES * 2);
+	test->right = blip_new(FRAME_SAMPLES * 2);
+	blip_set_rates(test->left, FRAME_SAMPLES, FRAME_SAMPLES);
+	blip_set_rates(test->right, FRAME_SAMPLES, FRAME_SAMPLES);
+	blip_add_delta(test->left, 0, 0x1000);
+	blip_add_delta(test->right, 0, -0x1000);
+	blip_end_frame(test->left, FRAME_SAMPLES);
+	blip_end_frame(test->right, FRAME_SAMPLES);
+	*state = test;
+	return 0;
+}
+
+static int _teardown(void** state) {
+	struct SyncTest* test = *state;
+	blip_delete(test->left);
+	blip_delete(test->right);
+	RingFIFODeinit(&test->ring);
+	MutexDeinit(&test->sync.audioBufferMutex);
+	ConditionDeinit(&test->sync.audioRequiredCond);
+	free(test);
+	return 0;
+}
+
+M_TEST_DEFINE(readWithoutRing) {
+	struct SyncTest* test = *state;
+	struct mStereoSample samples[RING_SAMPLES];
+	mCoreSyncLockAudio(&test->sync);
+	mCoreSyncProduceAudio(&test->sync, test->left, test->right, FRAME_SAMPLES);
+	assert_int_equal(mCoreSyncReadAudio(&test->sync, samples, RING_SAMPLES), 0);
+	assert_int_equal(blip_samples_avail(test->left), FRAME_SAMPLES);
+}
+
+M_TEST_DEFINE(readThroughRing) {
+	struct SyncTest* test = *state;
+	struct mStereoSample samples[RING_SAMPLES];
+	test->sync.audioRing = &test->ring;
+
+	// The ring never fills its last two slots
+	mCoreSyncLockAudio(&test->sync);
+	mCoreSyncProduceAudio(&test->sync, test->left, test->right, FRAME_SAMPLES);
+	assert_int_equal(blip_samples_avail(test->left), FRAME_SAMPLES - RING_SAMPLES + 2);
+	assert_int_equal(mCoreSyncReadAudio(&test->sync, samples, RING_SAMPLES), RING_SAMPLES - 2);
+	assert_true(samples[RING_SAMPLES - 3].left > 0);
+	assert_true(samples[RING_SAMPLES - 3].right < 0);
+	assert_int_equal(mCoreSyncReadAudio(&test->sync, samples, RING_SAMPLES), 0);
+
+	// Reads can be smaller than writes, and don't have to line up with where the ring wraps
+	size_t total = RING_SAMPLES - 2;
+	while (blip_samples_avail(test->left)) {
+		mCoreSyncLockAudio(&test->sync);
+		mCoreSyncProduceAudio(&test->sync, test->left, test->right, FRAME_SAMPLES);
+		size_t read;
+		while ((read = mCoreSyncReadAudio(&test->sync, samples, 5))) {
+			total += read;
+			assert_true(samples[read - 1].left > 0);
+			assert_true(samples[read - 1].right < 0);
+		}
+	}
+	assert_int_equal(total, FRAME_SAMPLES);
+}
+
+M_TEST_DEFINE(readThroughResampler) {
+	struct SyncTest* test = *state;
+	struct mStereoSample samples[RING_SAMPLES];
+	struct mAudioResampler resampler;
+	mAudioResamplerInit(&resampler, mAUDIO_RESAMPLER_MEDIUM, RING_SAMPLES);
+	mAudioResamplerSetRates(&resampler, 1, 2);
+	test->sync.audioRing = &test->ring;
+	test->sync.audioResampler = &resampler;
+
+	size_t total = 0;
+	do {
+		mCoreSyncLockAudio(&test->sync);
+		mCoreSyncProduceAudio(&test->sync, test->left, test->right, FRAME_SAMPLES);
+		size_t read;
+		while ((read = mCoreSyncReadAudio(&test->sync, samples, 5))) {
+			total += read;
+			assert_true(samples[read - 1].left > 0);
+			assert_true(samples[read - 1].right < 0);
+		}
+	} while (blip_samples_avail(test->left) || mAudioResamplerAvailable(&resampler));
+
+	// Everything but the last half a kernel comes out at twice the rate it went in
+	assert_true(total <= FRAME_SAMPLES * 2);
+	assert_true(total >= FRAME_SAMPLES * 2 - resampler.taps);
+	mAudioResamplerDeinit(&resampler);
+}
+
+M_TEST_DEFINE(adjustRate) {
+	struct mCoreSync sync = {0};
+	assert_true(mCoreSyncAdjustAudioRate(&sync, 48000, 0, 1024) == 48000);
+
+	sync.audioRateControl = 0.005f;
+	assert_true(mCoreSyncAdjustAudioRate(&sync, 48000, 512, 1024) == 48000);
+	assert_float_equal(mCoreSyncAdjustAudioRate(&sync, 48000, 0, 1024), 48240, 0.01);
+	assert_float_equal(mCoreSyncAdjustAudioRate(&sync, 48000, 1024, 1024), 47760, 0.01);
+	assert_float_equal(mCoreSyncAdjustAudioRate(&sync, 48000, 4096, 1024), 47760, 0.01);
+	assert_true(mCoreSyncAdjustAudioRate(&sync, 48000, 256, 1024) > 48000);
+	assert_true(mCoreSyncAdjustAudioRate(&sync, 48000, 768, 1024) < 48000);
+}
+
+M_TEST_DEFINE(framePacingDelay) {
+	struct mCoreSync sync = {
+		.fpsTarget = 50,
+		.frameCostNsec = 5000000,
+		.framePresentedNsec = 100000000,
+	};
+	// Pacing off, or no frames presented yet
+	assert_int_equal(mCoreSyncFramePacingDelay(&sync, 101000000), 0);
+	sync.framePacing = true;
+	sync.framePresentedNsec = 0;
+	assert_int_equal(mCoreSyncFramePacingDelay(&sync, 101000000), 0);
+
+	// Presented at 100ms, so the next present is at 120ms, and 5ms of emulation needs to start before
+	// that with some margin to spare
+	sync.framePresentedNsec = 100000000;
+	uint64_t delay = mCoreSyncFramePacingDelay(&sync, 101000000);
+	assert_true(delay > 0);
+	assert_true(101000000 + delay + sync.frameCostNsec < 120000000);
+	assert_true(101000000 + delay + sync.frameCostNsec > 115000000);
+
+	// A frame still waiting to be shown pushes the next one to the following slot
+	sync.framePresentPending = true;
+	assert_int_equal(mCoreSyncFramePacingDelay(&sync, 101000000), delay + 20000000);
+	sync.framePresentPending = false;
+
+	// Too late to wait, or too slow to wait at all
+	assert_int_equal(mCoreSyncFramePacingDelay(&sync, 119000000), 0);
+	sync.frameCostNsec = 19000000;
+	assert_int_equal(mCoreSyncFramePacingDelay(&sync, 101000000), 0);
+}
+
+M_TEST_DEFINE(framePacingCost) {
+	struct mCoreSync sync = {
+		.fpsTarget = 60,
+		.framePacing = true,
+	};
+	MutexInit(&sync.videoFrameMutex);
+	ConditionInit(&sync.videoFrameAvailableCond);
+	ConditionInit(&sync.videoFrameRequiredCond);
+
+	mCoreSyncPostFrame(&sync);
+	assert_int_equal(sync.frameCostNsec, 0);
+	assert_true(sync.frameStartNsec > 0);
+
+	// Without a presented frame there's nothing to pace against, so frames run back to back
+	sync.frameStartNsec -= 4000000;
+	mCoreSyncPostFrame(&sync);
+	assert_true(sync.frameCostNsec >= 4000000);
+
+	// Cheaper frames only bring the prediction down gradually
+	uint64_t cost = sync.frameCostNsec;
+	mCoreSyncPostFrame(&sync);
+	assert_true(sync.frameCostNsec < cost);
+	assert_true(sync.frameCostNsec > cost / 2);
+
+	mCoreSyncFramePresented(&sync, 1234);
+	assert_int_equal(sync.framePresentedNsec, 1234);
+	assert_false(sync.framePresentPending);
+
+	MutexDeinit(&sync.videoFrameMutex);
+	ConditionDeinit(&sync.videoFrameAvailableCond);
+	ConditionDeinit(&sync.videoFrameRequiredCond);
+}
+
+M_TEST_DEFINE(frameSkip) {
+	struct mCoreFrameSkip skip = { 0 };
+	// With no display rate, everything is rendered
+	assert_true(mCoreFrameSkipShouldRender(&skip, 0));
+
+	// The display shows a frame every 20ms, and unrendered frames take 2ms
+	skip.presentFps = 50;
+	uint64_t now = 100000000;
+	assert_true(mCoreFrameSkipShouldRender(&skip, now));
+	mCoreFrameSkipFrameEnded(&skip, now, now + 4000000, true);
+	now += 4000000;
+	assert_int_equal(skip.nextPresentNsec, now + 20000000);
+	assert_false(mCoreFrameSkipShouldRender(&skip, now));
+	mCoreFrameSkipFrameEnded(&skip, now, now + 2000000, false);
+	assert_int_equal(skip.skippedFrameCostNsec, 2000000);
+
+	// Frames are skipped until the next one would finish after the display wants a new one
+	unsigned skipped = 1;
+	now += 2000000;
+	while (!mCoreFrameSkipShouldRender(&skip, now)) {
+		mCoreFrameSkipFrameEnded(&skip, now, now + 2000000, false);
+		now += 2000000;
+		++skipped;
+	}
+	assert_int_equal(skipped, 9);
+	assert_true(now + 2000000 >= skip.nextPresentNsec);
+	assert_true(now < skip.nextPresentNsec);
+
+	// Rendering lands on the following slot, unless it's already missed
+	uint64_t next = skip.nextPresentNsec;
+	mCoreFrameSkipFrameEnded(&skip, now, now + 4000000, true);
+	assert_int_equal(skip.nextPresentNsec, next + 20000000);
+	now = skip.nextPresentNsec + 50000000;
+	mCoreFrameSkipFrameEnded(&skip, now, now + 4000000, true);
+	assert_int_equal(skip.nextPresentNsec, now + 24000000);
+
+	// Slower frames raise the prediction gradually
+	mCoreFrameSkipFrameEnded(&skip, now, now + 10000000, false);
+	assert_true(skip.skippedFrameCostNsec > 2000000);
+	assert_true(skip.skippedFrameCostNsec < 10000000);
+}
+
+M_TEST_SUITE_DEFINE(mCoreSync,
+	cmocka_unit_test_setup_teardown(readWithoutRing, _setup, _teardown),
+	cmocka_unit_test_setup_teardown(readThroughRing, _setup, _teardown),
+	cmocka_unit_test_setup_teardown(readThroughResampler, _setup, _teardown),
+	cmocka_unit_test(adjustRate),
+	cmocka_unit_test(framePacingDelay),
+	cmocka_unit_test(framePacingCost),
+	cmocka_unit_test(frameSkip),
+)
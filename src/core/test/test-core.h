@@ -0,0 +1,42 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_TEST_CORE_H
+#define M_CORE_TEST_CORE_H
+
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba-util/vfs.h>
+
+static const uint8_t _fakeGBROM[0x4000] = {
+	[0x100] = 0x18, // Loop forever
+	[0x101] = 0xFE, // jr, $-2
+	[0x102] = 0xCE, // Enough of the header to fool the core
+	[0x103] = 0xED,
+	[0x104] = 0x66,
+	[0x105] = 0x66,
+};
+
+// Creates a core with a config that runs a program looping forever
+static inline struct mCore* mTestCoreCreate(enum mPlatform platform) {
+	struct mCore* core = mCoreCreate(platform);
+	assert_non_null(core);
+	assert_true(core->init(core));
+	switch (core->platform(core)) {
+	case mPLATFORM_GBA:
+		core->busWrite32(core, 0x020000C0, 0xEAFFFFFE);
+		break;
+	case mPLATFORM_GB:
+		assert_true(core->loadROM(core, VFileFromConstMemory(_fakeGBROM, sizeof(_fakeGBROM))));
+		break;
+	case mPLATFORM_NONE:
+		break;
+	}
+	mCoreInitConfig(core, NULL);
+	return core;
+}
+
+#endif
@@ -0,0 +1,150 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/thread.h>
+
+#include "core/test/test-core.h"
+
+#ifdef M_CORE_GBA
+#define TEST_PLATFORM mPLATFORM_GBA
+#elif defined(M_CORE_GB)
+#define TEST_PLATFORM mPLATFORM_GB
+#else
+#error "Need a valid platform for testing"
+#endif
+
+#define PRODUCERS 4
+#define COMMANDS 250
+
+struct CommandTest {
+	struct mCoreThread thread;
+	unsigned count;
+	unsigned last[PRODUCERS];
+	bool outOfOrder;
+	bool wrongThread;
+};
+
+struct CommandProducer {
+	struct CommandTest* test;
+	unsigned id;
+};
+
+static void _command(struct mCoreThread* thread, void* context) {
+	struct CommandProducer* producer = context;
+	struct CommandTest* test = producer->test;
+	if (mCoreThreadGet() != thread) {
+		test->wrongThread = true;
+	}
+	++test->count;
+	++test->last[producer->id];
+}
+
+static void _orderedCommand(struct mCoreThread* thread, void* context) {
+	unsigned* sequence = context;
+	struct CommandTest* test = (struct CommandTest*) thread->userData;
+	if (*sequence != test->count) {
+		test->outOfOrder = true;
+	}
+	++test->count;
+}
+
+static THREAD_ENTRY _produce(void* context) {
+	struct CommandProducer* producer = context;
+	struct mCoreThreadFuture future = {0};
+	unsigned i;
+	for (i = 0; i < COMMANDS; ++i) {
+		mCoreThreadPostCommand(&producer->test->thread, _command, producer, i == COMMANDS - 1 ? &future : NULL);
+	}
+	mCoreThreadFutureWait(&producer->test->thread, &future);
+	THREAD_EXIT(0);
+}
+
+static int _setup(void** state) {
+	struct CommandTest* test = calloc(1, sizeof(*test));
+	struct mCore* core = mTestCoreCreate(TEST_PLATFORM);
+	test->thread.core = core;
+	test->thread.userData = test;
+	assert_true(mCoreThreadStart(&test->thread));
+	*state = test;
+	return 0;
+}
+
+static int _teardown(void** state) {
+	struct CommandTest* test = *state;
+	struct mCore* core = test->thread.core;
+	if (test->thread.impl) {
+		mCoreThreadEnd(&test->thread);
+		mCoreThreadJoin(&test->thread);
+	}
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(test);
+	return 0;
+}
+
+M_TEST_DEFINE(concurrentProducers) {
+	struct CommandTest* test = *state;
+	struct CommandProducer producers[PRODUCERS];
+	Thread threads[PRODUCERS];
+	unsigned i;
+	for (i = 0; i < PRODUCERS; ++i) {
+		producers[i].test = test;
+		producers[i].id = i;
+		ThreadCreate(&threads[i], _produce, &producers[i]);
+	}
+	for (i = 0; i < PRODUCERS; ++i) {
+		ThreadJoin(&threads[i]);
+		// Waiting on the last command means all of this producer's have run
+		assert_int_equal(test->last[i], COMMANDS);
+	}
+	assert_int_equal(test->count, PRODUCERS * COMMANDS);
+	assert_false(test->wrongThread);
+}
+
+M_TEST_DEFINE(runWhilePaused) {
+	struct CommandTest* test = *state;
+	unsigned sequence[COMMANDS];
+	struct mCoreThreadFuture future = {0};
+	unsigned i;
+	mCoreThreadPause(&test->thread);
+	for (i = 0; i < COMMANDS; ++i) {
+		sequence[i] = i;
+		assert_true(mCoreThreadPostCommand(&test->thread, _orderedCommand, &sequence[i], i == COMMANDS - 1 ? &future : NULL));
+	}
+	mCoreThreadFutureWait(&test->thread, &future);
+	assert_true(mCoreThreadFutureIsDone(&future));
+	assert_int_equal(test->count, COMMANDS);
+	assert_false(test->outOfOrder);
+	assert_true(mCoreThreadIsPaused(&test->thread));
+	mCoreThreadUnpause(&test->thread);
+}
+
+M_TEST_DEFINE(noneLostOnExit) {
+	struct CommandTest* test = *state;
+	unsigned sequence[COMMANDS];
+	unsigned i;
+	mCoreThreadPause(&test->thread);
+	mCoreThreadInterrupt(&test->thread);
+	// Nothing can run during the interrupt. Afterwards they may run while paused or on exit, but
+	// they all have to run.
+	for (i = 0; i < COMMANDS; ++i) {
+		sequence[i] = i;
+		assert_true(mCoreThreadPostCommand(&test->thread, _orderedCommand, &sequence[i], NULL));
+	}
+	assert_int_equal(test->count, 0);
+	mCoreThreadContinue(&test->thread);
+	mCoreThreadEnd(&test->thread);
+	mCoreThreadJoin(&test->thread);
+	assert_int_equal(test->count, COMMANDS);
+	assert_false(test->outOfOrder);
+}
+
+M_TEST_SUITE_DEFINE(mCoreThread,
+	cmocka_unit_test_setup_teardown(concurrentProducers, _setup, _teardown),
+	cmocka_unit_test_setup_teardown(runWhilePaused, _setup, _teardown),
+	cmocka_unit_test_setup_teardown(noneLostOnExit, _setup, _teardown))
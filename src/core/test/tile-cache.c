@@ -0,0 +1,134 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/tile-cache.h>
+
+#define TILES 64
+
+static void _setup(struct mTileCache* cache, uint16_t* vram) {
+	mTileCacheInit(cache);
+	mTileCacheSystemInfo sysconfig = 0;
+	sysconfig = mTileCacheSystemInfoSetPaletteBPP(sysconfig, 2); // 4bpp
+	sysconfig = mTileCacheSystemInfoSetPaletteCount(sysconfig, 4); // 16 palettes
+	sysconfig = mTileCacheSystemInfoSetMaxTiles(sysconfig, TILES);
+	mTileCacheConfigureSystem(cache, sysconfig, 0, 0);
+	cache->vram = vram;
+	unsigned i;
+	for (i = 0; i < 16; ++i) {
+		mTileCacheWritePalette(cache, i, (color_t) (0x010101 * i));
+	}
+}
+
+M_TEST_DEFINE(copyDirtyTiles) {
+	struct mTileCache cache;
+	uint16_t vram[TILES * 16] = {0};
+	struct mTileCacheEntry entries[TILES * 16] = {0};
+	unsigned tileIds[TILES];
+	color_t pixels[TILES * 64];
+	_setup(&cache, vram);
+
+	// Nothing has been seen yet, so everything is dirty
+	assert_int_equal(mTileCacheCopyDirtyTiles(&cache, entries, 16, 0, TILES, 0, false, tileIds, pixels), TILES);
+	assert_int_equal(mTileCacheCopyDirtyTiles(&cache, entries, 16, 0, TILES, 0, false, tileIds, pixels), 0);
+
+	// Pixel 1 of row 0 of tile 5 becomes color 3
+	vram[5 * 16] = 0x0030;
+	mTileCacheWriteVRAM(&cache, 5 * 32);
+	assert_int_equal(mTileCacheCopyDirtyTiles(&cache, entries, 16, 0, TILES, 0, false, tileIds, pixels), 1);
+	assert_int_equal(tileIds[0], 5);
+	assert_int_equal(pixels[0] & 0xFFFFFF, 0);
+	assert_int_equal(pixels[1], (color_t) 0xFF030303);
+
+	// Copies stay put when the cache changes underneath them
+	vram[5 * 16] = 0x0040;
+	mTileCacheWriteVRAM(&cache, 5 * 32);
+	mTileCacheGetTile(&cache, 5, 0);
+	assert_int_equal(pixels[1], (color_t) 0xFF030303);
+
+	// Ranges that don't start at zero still index entries from the start of the range
+	assert_int_equal(mTileCacheCopyDirtyTiles(&cache, &entries[4 * 16], 16, 4, 4, 0, false, tileIds, pixels), 1);
+	assert_int_equal(tileIds[0], 5);
+	assert_int_equal(pixels[1], (color_t) 0xFF040404);
+
+	assert_int_equal(mTileCacheCopyDirtyTiles(&cache, &entries[4 * 16], 16, 4, 4, 0, true, tileIds, pixels), 4);
+	assert_int_equal(tileIds[3], 7);
+
+	// A range dirties every tile it touches, even partly
+	mTileCacheWriteVRAMRange(&cache, 10 * 32 + 30, 34);
+	assert_int_equal(mTileCacheCopyDirtyTiles(&cache, entries, 16, 0, TILES, 0, false, tileIds, pixels), 2);
+	assert_int_equal(tileIds[0], 10);
+	assert_int_equal(tileIds[1], 11);
+	mTileCacheWriteVRAMRange(&cache, (TILES - 1) * 32, 0x1000);
+	assert_int_equal(mTileCacheCopyDirtyTiles(&cache, entries, 16, 0, TILES, 0, false, tileIds, pixels), 1);
+	assert_int_equal(tileIds[0], TILES - 1);
+
+	mTileCacheDeinit(&cache);
+}
+
+static unsigned _referencePixel(const uint16_t* vram, unsigned bpp, unsigned tileId, unsigned x, unsigned y) {
+	const uint8_t* bytes = (const uint8_t*) vram;
+	switch (bpp) {
+	case 1:
+		bytes += tileId * 16 + y * 2;
+		return (((bytes[1] >> (7 - x)) & 1) << 1) | ((bytes[0] >> (7 - x)) & 1);
+	case 2:
+		return (bytes[tileId * 32 + y * 4 + x / 2] >> ((x & 1) * 4)) & 0xF;
+	case 3:
+		return bytes[tileId * 64 + y * 8 + x];
+	}
+	return 0;
+}
+
+M_TEST_DEFINE(regenerateTiles) {
+	uint16_t vram[TILES * 32];
+	unsigned i;
+	uint32_t seed = 1;
+	for (i = 0; i < TILES * 32; ++i) {
+		seed = seed * 1103515245 + 12345;
+		vram[i] = seed >> 16;
+	}
+
+	unsigned bpp;
+	for (bpp = 1; bpp <= 3; ++bpp) {
+		struct mTileCache cache;
+		mTileCacheInit(&cache);
+		mTileCacheSystemInfo sysconfig = 0;
+		sysconfig = mTileCacheSystemInfoSetPaletteBPP(sysconfig, bpp);
+		sysconfig = mTileCacheSystemInfoSetPaletteCount(sysconfig, 1);
+		sysconfig = mTileCacheSystemInfoSetMaxTiles(sysconfig, TILES);
+		mTileCacheConfigureSystem(&cache, sysconfig, 0, 0);
+		cache.vram = vram;
+		unsigned colors = 1 << (1 << bpp);
+		for (i = 0; i < colors * 2; ++i) {
+			mTileCacheWritePalette(&cache, i, (color_t) (0x10101 * (i & 0xFF)));
+		}
+
+		assert_int_equal(mTileCacheRegenerateTiles(&cache, 0, TILES, 1), TILES);
+		assert_int_equal(mTileCacheRegenerateTiles(&cache, 0, TILES, 1), 0);
+		mTileCacheWriteVRAM(&cache, 3 << (bpp + 3));
+		assert_int_equal(mTileCacheRegenerateTiles(&cache, 0, TILES, 1), 1);
+
+		unsigned tileId;
+		for (tileId = 0; tileId < TILES; ++tileId) {
+			const color_t* tile = mTileCacheGetTile(&cache, tileId, 1);
+			unsigned p;
+			for (p = 0; p < 64; ++p) {
+				unsigned pixel = _referencePixel(vram, bpp, tileId, p & 7, p >> 3);
+				color_t expected = (color_t) (0x10101 * ((pixel + colors) & 0xFF));
+				if (pixel) {
+					expected = (color_t) (expected | 0xFF000000);
+				}
+				assert_int_equal(tile[p], expected);
+			}
+		}
+		mTileCacheDeinit(&cache);
+	}
+}
+
+M_TEST_SUITE_DEFINE(TileCache,
+	cmocka_unit_test(copyDirtyTiles),
+	cmocka_unit_test(regenerateTiles))
@@ -0,0 +1,227 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/timing.h>
+
+struct TimingTest {
+	struct mTiming timing;
+	int32_t relativeCycles;
+	int32_t nextEvent;
+	struct mTimingEvent events[8];
+	int order[16];
+	size_t fired;
+};
+
+static void _record(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	UNUSED(timing);
+	UNUSED(cyclesLate);
+	struct mTimingEvent* event = context;
+	struct TimingTest* test = (struct TimingTest*) event->name;
+	test->order[test->fired] = event - test->events;
+	++test->fired;
+}
+
+static void _interrupt(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	_record(timing, context, cyclesLate);
+	mTimingInterrupt(timing);
+}
+
+M_TEST_SUITE_SETUP(mTiming) {
+	struct TimingTest* test = calloc(1, sizeof(*test));
+	mTimingInit(&test->timing, &test->relativeCycles, &test->nextEvent);
+	test->nextEvent = INT_MAX;
+	size_t i;
+	for (i = 0; i < sizeof(test->events) / sizeof(*test->events); ++i) {
+		test->events[i].context = &test->events[i];
+		test->events[i].callback = _record;
+		test->events[i].name = (const char*) test;
+		test->events[i].priority = 0;
+	}
+	*state = test;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(mTiming) {
+	struct TimingTest* test = *state;
+	mTimingDeinit(&test->timing);
+	free(test);
+	return 0;
+}
+
+static void _reset(struct TimingTest* test) {
+	mTimingClear(&test->timing);
+	test->relativeCycles = 0;
+	test->nextEvent = INT_MAX;
+	test->fired = 0;
+	size_t i;
+	for (i = 0; i < sizeof(test->events) / sizeof(*test->events); ++i) {
+		test->events[i].callback = _record;
+		test->events[i].priority = 0;
+	}
+}
+
+M_TEST_DEFINE(orderByTime) {
+	struct TimingTest* test = *state;
+	_reset(test);
+	mTimingSchedule(&test->timing, &test->events[0], 30);
+	mTimingSchedule(&test->timing, &test->events[1], 10);
+	mTimingSchedule(&test->timing, &test->events[2], 20);
+	assert_int_equal(test->nextEvent, 10);
+	assert_int_equal(mTimingNextEvent(&test->timing), 10);
+
+	assert_int_equal(mTimingTick(&test->timing, 5), 5);
+	assert_int_equal(test->fired, 0);
+	mTimingTick(&test->timing, 25);
+	assert_int_equal(test->fired, 3);
+	assert_int_equal(mTimingNextEvent(&test->timing), INT_MAX);
+	assert_int_equal(test->order[0], 1);
+	assert_int_equal(test->order[1], 2);
+	assert_int_equal(test->order[2], 0);
+}
+
+M_TEST_DEFINE(orderByPriority) {
+	struct TimingTest* test = *state;
+	_reset(test);
+	test->events[0].priority = 3;
+	test->events[1].priority = 1;
+	test->events[2].priority = 2;
+	mTimingSchedule(&test->timing, &test->events[0], 10);
+	mTimingSchedule(&test->timing, &test->events[1], 10);
+	mTimingSchedule(&test->timing, &test->events[2], 10);
+	mTimingTick(&test->timing, 10);
+	assert_int_equal(test->fired, 3);
+	assert_int_equal(test->order[0], 1);
+	assert_int_equal(test->order[1], 2);
+	assert_int_equal(test->order[2], 0);
+}
+
+M_TEST_DEFINE(orderByInsertion) {
+	struct TimingTest* test = *state;
+	_reset(test);
+	size_t i;
+	for (i = 0; i < 8; ++i) {
+		mTimingSchedule(&test->timing, &test->events[i], 10);
+	}
+	mTimingTick(&test->timing, 10);
+	assert_int_equal(test->fired, 8);
+	for (i = 0; i < 8; ++i) {
+		assert_int_equal(test->order[i], i);
+	}
+}
+
+M_TEST_DEFINE(deschedule) {
+	struct TimingTest* test = *state;
+	_reset(test);
+	mTimingSchedule(&test->timing, &test->events[0], 10);
+	mTimingSchedule(&test->timing, &test->events[1], 20);
+	mTimingSchedule(&test->timing, &test->events[2], 30);
+	assert_true(mTimingIsScheduled(&test->timing, &test->events[1]));
+	assert_false(mTimingIsScheduled(&test->timing, &test->events[3]));
+
+	mTimingDeschedule(&test->timing, &test->events[1]);
+	mTimingDeschedule(&test->timing, &test->events[3]);
+	assert_false(mTimingIsScheduled(&test->timing, &test->events[1]));
+	assert_true(mTimingIsScheduled(&test->timing, &test->events[0]));
+	assert_true(mTimingIsScheduled(&test->timing, &test->events[2]));
+
+	mTimingTick(&test->timing, 30);
+	assert_int_equal(test->fired, 2);
+	assert_int_equal(test->order[0], 0);
+	assert_int_equal(test->order[1], 2);
+	assert_false(mTimingIsScheduled(&test->timing, &test->events[0]));
+
+	mTimingSchedule(&test->timing, &test->events[0], 10);
+	mTimingDescheduleAll(&test->timing);
+	assert_false(mTimingIsScheduled(&test->timing, &test->events[0]));
+	assert_int_equal(mTimingNextEvent(&test->timing), INT_MAX);
+}
+
+M_TEST_DEFINE(relativeCycles) {
+	struct TimingTest* test = *state;
+	_reset(test);
+	test->relativeCycles = 4;
+	mTimingSchedule(&test->timing, &test->events[0], 10);
+	assert_int_equal(mTimingUntil(&test->timing, &test->events[0]), 10);
+	assert_int_equal(mTimingCurrentTime(&test->timing), 4);
+	assert_int_equal(test->nextEvent, 14);
+
+	test->relativeCycles = 0;
+	assert_int_equal(mTimingTick(&test->timing, 8), 6);
+	mTimingTick(&test->timing, 8);
+	assert_int_equal(test->fired, 1);
+}
+
+M_TEST_DEFINE(interrupt) {
+	struct TimingTest* test = *state;
+	_reset(test);
+	test->events[1].callback = _interrupt;
+	mTimingSchedule(&test->timing, &test->events[0], 10);
+	mTimingSchedule(&test->timing, &test->events[1], 10);
+	mTimingSchedule(&test->timing, &test->events[2], 10);
+	mTimingSchedule(&test->timing, &test->events[3], 20);
+
+	// Interrupting stops the current pass, but events that are still due get run by the rescheduling tick
+	assert_int_equal(mTimingTick(&test->timing, 10), 10);
+	assert_int_equal(test->fired, 3);
+	assert_int_equal(test->order[0], 0);
+	assert_int_equal(test->order[1], 1);
+	assert_int_equal(test->order[2], 2);
+	assert_true(mTimingIsScheduled(&test->timing, &test->events[3]));
+
+	mTimingInterrupt(&test->timing);
+	assert_true(mTimingIsScheduled(&test->timing, &test->events[3]));
+	mTimingTick(&test->timing, 10);
+	assert_int_equal(test->fired, 4);
+	assert_int_equal(mTimingNextEvent(&test->timing), INT_MAX);
+}
+
+M_TEST_DEFINE(manyEvents) {
+	struct TimingTest* test = *state;
+	_reset(test);
+	struct mTimingEvent events[100];
+	size_t i;
+	for (i = 0; i < 100; ++i) {
+		events[i] = test->events[0];
+		events[i].context = &events[i];
+		events[i].callback = NULL;
+		mTimingSchedule(&test->timing, &events[i], (i * 37) % 101 + 1);
+	}
+	int32_t last = 0;
+	for (i = 0; i < 100; ++i) {
+		int32_t next = mTimingNextEvent(&test->timing);
+		assert_true(next > 0);
+		assert_true(next + last <= 101);
+		size_t j;
+		size_t scheduled = 0;
+		struct mTimingEvent* event = NULL;
+		for (j = 0; j < 100; ++j) {
+			if (!mTimingIsScheduled(&test->timing, &events[j])) {
+				continue;
+			}
+			++scheduled;
+			assert_true(mTimingUntil(&test->timing, &events[j]) >= next);
+			if (mTimingUntil(&test->timing, &events[j]) == next) {
+				event = &events[j];
+			}
+		}
+		assert_int_equal(scheduled, 100 - i);
+		assert_non_null(event);
+		mTimingDeschedule(&test->timing, event);
+		mTimingTick(&test->timing, next);
+		last += next;
+	}
+	assert_int_equal(mTimingNextEvent(&test->timing), INT_MAX);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mTiming,
+	cmocka_unit_test(orderByTime),
+	cmocka_unit_test(orderByPriority),
+	cmocka_unit_test(orderByInsertion),
+	cmocka_unit_test(deschedule),
+	cmocka_unit_test(relativeCycles),
+	cmocka_unit_test(interrupt),
+	cmocka_unit_test(manyEvents))
@@ -6,12 +6,17 @@
 #include <mgba/core/thread.h>
 
 #include <mgba/core/blip_buf.h>
+#include <mgba/core/boot-cache.h>
 #include <mgba/core/core.h>
+#include <mgba/core/movie.h>
+#include <mgba/core/perf.h>
+#include <mgba/core/rollback.h>
 #ifdef ENABLE_SCRIPTING
 #include <mgba/script/context.h>
 #include <mgba/core/scripting.h>
 #endif
 #include <mgba/core/serialize.h>
+#include <mgba-util/memory.h>
 #include <mgba-util/patch.h>
 #include <mgba-util/vfs.h>
 
@@ -19,6 +24,8 @@
 
 #ifndef DISABLE_THREADING
 
+DEFINE_VECTOR(mCoreThreadCommandList, struct mCoreThreadCommandEntry);
+
 static const float _defaultFPSTarget = 60.f;
 static ThreadLocal _contextKey;
 
@@ -147,13 +154,54 @@ static void _cancelRequest(struct mCoreThreadInternal* threadContext, enum mCore
 	ConditionWake(&threadContext->stateCond);
 }
 
+static void _runCommands(struct mCoreThread* threadContext) {
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	int pending;
+	ATOMIC_LOAD(pending, impl->pendingCommands);
+	if (!pending) {
+		return;
+	}
+
+	// Swap the queue out so that new commands can be posted while these run
+	MutexLock(&impl->commandMutex);
+	struct mCoreThreadCommandList swap = impl->commands;
+	impl->commands = impl->runningCommands;
+	impl->runningCommands = swap;
+	ATOMIC_STORE(impl->pendingCommands, 0);
+	MutexUnlock(&impl->commandMutex);
+
+	bool hasFutures = false;
+	size_t i;
+	for (i = 0; i < mCoreThreadCommandListSize(&impl->runningCommands); ++i) {
+		struct mCoreThreadCommandEntry* entry = mCoreThreadCommandListGetPointer(&impl->runningCommands, i);
+		entry->command(threadContext, entry->context);
+		if (entry->future) {
+			hasFutures = true;
+		}
+	}
+
+	if (hasFutures) {
+		MutexLock(&impl->commandMutex);
+		for (i = 0; i < mCoreThreadCommandListSize(&impl->runningCommands); ++i) {
+			struct mCoreThreadCommandEntry* entry = mCoreThreadCommandListGetPointer(&impl->runningCommands, i);
+			if (entry->future) {
+				ATOMIC_STORE(entry->future->done, 1);
+			}
+		}
+		ConditionWake(&impl->commandCond);
+		MutexUnlock(&impl->commandMutex);
+	}
+	mCoreThreadCommandListClear(&impl->runningCommands);
+}
+
 void _frameStarted(void* context) {
 	struct mCoreThread* thread = context;
-	if (!thread) {
+	if (!thread || thread->impl->speculating) {
 		return;
 	}
 	if (thread->core->opts.rewindEnable && thread->core->opts.rewindBufferCapacity > 0) {
-		if (!thread->impl->rewinding || !mCoreRewindRestore(&thread->impl->rewind, thread->core)) {
+		int speed = thread->core->opts.rewindSpeed > 1 ? thread->core->opts.rewindSpeed : 1;
+		if (!thread->impl->rewinding || !mCoreRewindRestoreMany(&thread->impl->rewind, thread->core, speed)) {
 			if (thread->impl->rewind.rewindFrameCounter == 0) {
 				mCoreRewindAppend(&thread->impl->rewind, thread->core);
 				thread->impl->rewind.rewindFrameCounter = thread->core->opts.rewindBufferInterval;
@@ -163,14 +211,61 @@ void _frameStarted(void* context) {
 	}
 }
 
+static void _recordFrameTiming(struct mCoreThread* thread) {
+	struct mCoreThreadInternal* impl = thread->impl;
+	uint64_t now = mPerfTimestamp();
+	uint64_t videoWait = impl->sync.videoWaitNsec - impl->lastVideoWait;
+	uint64_t audioWait = impl->sync.audioWaitNsec - impl->lastAudioWait;
+	impl->lastVideoWait = impl->sync.videoWaitNsec;
+	impl->lastAudioWait = impl->sync.audioWaitNsec;
+	if (!impl->lastFrameEnded) {
+		impl->lastFrameEnded = now;
+		return;
+	}
+
+	struct mCoreFrameTiming timing = {
+		.frame = thread->core->frameCounter(thread->core),
+		.frameNsec = now - impl->lastFrameEnded,
+		.videoWaitNsec = videoWait,
+		.audioWaitNsec = audioWait,
+		.timestamp = now,
+	};
+	if (timing.frameNsec > videoWait + audioWait) {
+		timing.emulationNsec = timing.frameNsec - videoWait - audioWait;
+	}
+	impl->lastFrameEnded = now;
+
+	MutexLock(&impl->frameTimingMutex);
+	impl->frameTimings[impl->frameTimingNext] = timing;
+	impl->frameTimingNext = (impl->frameTimingNext + 1) % mCORE_THREAD_FRAME_TIMINGS;
+	if (impl->frameTimingCount < mCORE_THREAD_FRAME_TIMINGS) {
+		++impl->frameTimingCount;
+	}
+	MutexUnlock(&impl->frameTimingMutex);
+}
+
 void _frameEnded(void* context) {
 	struct mCoreThread* thread = context;
 	if (!thread) {
 		return;
 	}
-	if (thread->frameCallback) {
+	mTRACE_MARK(thread->impl->speculating ? "Speculative frame" : "Frame");
+	if (!thread->impl->speculating) {
+		_recordFrameTiming(thread);
+	}
+	// When running ahead, the frame callback is deferred until the picture is ready
+	if (thread->frameCallback && !thread->impl->runningAhead) {
 		thread->frameCallback(thread);
 	}
+	if (!thread->impl->speculating && mStartupTraceIsActive()) {
+		mStartupTraceMark("First frame");
+		mStartupTraceFinish();
+	}
+#ifdef ENABLE_SCRIPTING
+	if (thread->scriptWorker && !thread->impl->runningAhead && !thread->impl->speculating) {
+		mScriptCoreWorkerFrameEnded(thread->scriptWorker);
+	}
+#endif
 }
 
 void _crashed(void* context) {
@@ -200,22 +295,22 @@ void _coreShutdown(void* context) {
 }
 
 #ifdef ENABLE_SCRIPTING
-#define ADD_CALLBACK(NAME) \
+#define ADD_CALLBACK(NAME, EVENT) \
 void _script_ ## NAME(void* context) { \
 	struct mCoreThread* threadContext = context; \
-	if (!threadContext->scriptContext) { \
+	if (!threadContext->scriptContext || threadContext->impl->speculating) { \
 		return; \
 	} \
-	mScriptContextTriggerCallback(threadContext->scriptContext, #NAME, NULL); \
+	mScriptContextTriggerCallbackEvent(threadContext->scriptContext, mSCRIPT_CALLBACK_ ## EVENT, NULL); \
 }
 
-ADD_CALLBACK(frame)
-ADD_CALLBACK(crashed)
-ADD_CALLBACK(sleep)
-ADD_CALLBACK(stop)
-ADD_CALLBACK(keysRead)
-ADD_CALLBACK(savedataUpdated)
-ADD_CALLBACK(alarm)
+ADD_CALLBACK(frame, FRAME)
+ADD_CALLBACK(crashed, CRASHED)
+ADD_CALLBACK(sleep, SLEEP)
+ADD_CALLBACK(stop, STOP)
+ADD_CALLBACK(keysRead, KEYS_READ)
+ADD_CALLBACK(savedataUpdated, SAVEDATA_UPDATED)
+ADD_CALLBACK(alarm, ALARM)
 
 #undef ADD_CALLBACK
 #define CALLBACK(NAME) _script_ ## NAME
@@ -235,6 +330,61 @@ static void _mCoreThreadAddCallbacks(struct mCoreThread* threadContext) {
 }
 #endif
 
+static void _runAhead(struct mCoreThread* threadContext) {
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCore* core = threadContext->core;
+	size_t stateSize = core->stateSize(core);
+	if (stateSize != impl->runAheadStateSize) {
+		if (impl->runAheadState) {
+			mappedMemoryFree(impl->runAheadState, impl->runAheadStateSize);
+		}
+		impl->runAheadState = anonymousMemoryMap(stateSize);
+		impl->runAheadStateSize = stateSize;
+		impl->runAheadEpoch = 0;
+	}
+
+	// The real frame produces the audio and drives the rest of the frontend as usual, but its
+	// picture is never shown: the last speculative frame draws over it instead
+	impl->runningAhead = true;
+	core->skipVideoFrames(core, 1);
+	core->runFrame(core);
+	core->saveStateIncremental(core, impl->runAheadState, &impl->runAheadEpoch);
+
+	// Speculative frames reuse the latest input and are thrown away afterwards
+	unsigned frames = core->opts.runAhead;
+	impl->speculating = true;
+	core->skipAudioFrames(core, frames);
+	core->skipVideoFrames(core, frames - 1);
+	unsigned i;
+	for (i = 0; i < frames; ++i) {
+		core->runFrame(core);
+	}
+	core->loadState(core, impl->runAheadState);
+	impl->speculating = false;
+	impl->runningAhead = false;
+
+	if (threadContext->frameCallback) {
+		threadContext->frameCallback(threadContext);
+	}
+}
+
+static void _fastForward(struct mCoreThread* threadContext) {
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCore* core = threadContext->core;
+	uint64_t start = mPerfTimestamp();
+	bool render = mCoreFrameSkipShouldRender(&impl->frameSkip, start);
+	// Audio sync paces emulation off the audio, so audio can only be dropped without it
+	bool dropAudio = !impl->sync.audioWait && (!render || core->opts.mute);
+	if (!render) {
+		core->skipVideoFrames(core, 1);
+	}
+	if (dropAudio) {
+		core->skipAudioFrames(core, 1);
+	}
+	core->runFrame(core);
+	mCoreFrameSkipFrameEnded(&impl->frameSkip, start, mPerfTimestamp(), render);
+}
+
 static THREAD_ENTRY _mCoreThreadRun(void* context) {
 	struct mCoreThread* threadContext = context;
 #ifdef USE_PTHREADS
@@ -245,6 +395,7 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 
 	ThreadLocalSetKey(_contextKey, threadContext);
 	ThreadSetName("CPU Thread");
+	mTRACE_THREAD_NAME("CPU Thread");
 
 #if !defined(_WIN32) && defined(USE_PTHREADS)
 	sigset_t signals;
@@ -264,6 +415,17 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 	core->addCoreCallbacks(core, &callbacks);
 	core->setSync(core, &threadContext->impl->sync);
 
+	// Rollback replays frames against remote input, so a state taken partway through isn't a clean boot
+	struct mBootCache bootCache;
+	const char* bootCachePath = mCoreConfigGetValue(&core->config, "bootCachePath");
+	bool useBootCache = bootCachePath && !threadContext->rollback;
+	if (useBootCache) {
+		unsigned bootCacheFrame = 0;
+		mCoreConfigGetUIntValue(&core->config, "bootCacheFrame", &bootCacheFrame);
+		VDirCreate(bootCachePath);
+		mBootCacheInit(&bootCache, core, VDirOpen(bootCachePath), bootCacheFrame);
+	}
+
 	struct mLogFilter filter;
 	struct mLogger* logger = &threadContext->logger.d;
 	if (threadContext->logger.logger) {
@@ -280,6 +442,9 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 		mScriptContextAttachCore(scriptContext, core);
 		_mCoreThreadAddCallbacks(threadContext);
 	}
+	if (threadContext->scriptWorker) {
+		mScriptCoreWorkerAttachCore(threadContext->scriptWorker, core);
+	}
 #endif
 
 	mCoreThreadRewindParamsChanged(threadContext);
@@ -295,11 +460,15 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 		}
 	}
 	if (scriptContext) {
-		mScriptContextTriggerCallback(scriptContext, "start", NULL);
+		mScriptContextTriggerCallbackEvent(scriptContext, mSCRIPT_CALLBACK_START, NULL);
 	}
 #endif
 
 	core->reset(core);
+	if (useBootCache) {
+		mBootCacheRestore(&bootCache);
+	}
+	mStartupTraceMark("Reset core");
 	threadContext->impl->core = core;
 	_changeState(threadContext->impl, mTHREAD_RUNNING, true);
 
@@ -316,7 +485,7 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 		}
 	}
 	if (scriptContext) {
-		mScriptContextTriggerCallback(scriptContext, "reset", NULL);
+		mScriptContextTriggerCallbackEvent(scriptContext, mSCRIPT_CALLBACK_RESET, NULL);
 	}
 #endif
 
@@ -336,7 +505,26 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 #endif
 		{
 			while (impl->state == mTHREAD_RUNNING) {
-				core->runLoop(core);
+				_runCommands(threadContext);
+				if (threadContext->rollback) {
+					if (!mCoreRollbackRunFrame(threadContext->rollback)) {
+						// Waiting on remote input; give the sleep callback a chance to block
+						if (threadContext->sleepCallback) {
+							threadContext->sleepCallback(threadContext);
+						}
+						break;
+					}
+				} else if (threadContext->movie && mMovieRunFrame(threadContext->movie)) {
+					// The movie ran the frame
+				} else if (impl->fastForward && !impl->rewinding) {
+					_fastForward(threadContext);
+				} else if (core->opts.runAhead > 0 && !impl->rewinding) {
+					mTRACE_BEGIN("Run ahead");
+					_runAhead(threadContext);
+					mTRACE_END();
+				} else {
+					core->runLoop(core);
+				}
 			}
 		}
 
@@ -348,6 +536,15 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 			}
 
 			while (impl->state >= mTHREAD_MIN_WAITING && impl->state <= mTHREAD_MAX_WAITING) {
+				// Checked under the state mutex so that a wakeup from a new command can't be missed
+				int pendingCommands;
+				ATOMIC_LOAD(pendingCommands, impl->pendingCommands);
+				if (impl->state == mTHREAD_PAUSED && pendingCommands) {
+					MutexUnlock(&impl->stateMutex);
+					_runCommands(threadContext);
+					MutexLock(&impl->stateMutex);
+					continue;
+				}
 #ifdef USE_DEBUGGERS
 				if (debugger && debugger->state != DEBUGGER_SHUTDOWN) {
 					mDebuggerUpdate(debugger);
@@ -361,7 +558,7 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 				if (impl->sync.audioWait) {
 					MutexUnlock(&impl->stateMutex);
 					mCoreSyncLockAudio(&impl->sync);
-					mCoreSyncProduceAudio(&impl->sync, core->getAudioChannel(core, 0), core->getAudioBufferSize(core));
+					mCoreSyncProduceAudio(&impl->sync, core->getAudioChannel(core, 0), core->getAudioChannel(core, 1), core->getAudioBufferSize(core));
 					MutexLock(&impl->stateMutex);
 				}
 			}
@@ -378,6 +575,9 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 			}
 		}
 
+		// Don't charge the time spent stopped to the next frame
+		impl->lastFrameEnded = 0;
+
 		impl->requested &= ~pendingRequests | mTHREAD_REQ_PAUSE | mTHREAD_REQ_WAIT;
 		pendingRequests = impl->requested;
 
@@ -411,12 +611,15 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 		}
 		if (pendingRequests & mTHREAD_REQ_RESET) {
 			core->reset(core);
+			if (useBootCache) {
+				mBootCacheRestore(&bootCache);
+			}
 			if (threadContext->resetCallback) {
 				threadContext->resetCallback(threadContext);
 			}
 #ifdef ENABLE_SCRIPTING
 			if (scriptContext) {
-				mScriptContextTriggerCallback(scriptContext, "reset", NULL);
+				mScriptContextTriggerCallbackEvent(scriptContext, mSCRIPT_CALLBACK_RESET, NULL);
 			}
 #endif
 		}
@@ -431,20 +634,36 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 		_changeState(impl, mTHREAD_SHUTDOWN, false);
 	}
 
+	MutexLock(&impl->commandMutex);
+	impl->commandsClosed = true;
+	MutexUnlock(&impl->commandMutex);
+	_runCommands(threadContext);
+
 	if (core->opts.rewindEnable) {
 		 mCoreRewindContextDeinit(&impl->rewind);
 	}
+	if (impl->runAheadState) {
+		mappedMemoryFree(impl->runAheadState, impl->runAheadStateSize);
+		impl->runAheadState = NULL;
+		impl->runAheadStateSize = 0;
+	}
 
 	if (threadContext->cleanCallback) {
 		threadContext->cleanCallback(threadContext);
 	}
 #ifdef ENABLE_SCRIPTING
 	if (scriptContext) {
-		mScriptContextTriggerCallback(scriptContext, "shutdown", NULL);
+		mScriptContextTriggerCallbackEvent(scriptContext, mSCRIPT_CALLBACK_SHUTDOWN, NULL);
 		mScriptContextDetachCore(scriptContext);
 	}
+	if (threadContext->scriptWorker) {
+		mScriptCoreWorkerDetachCore(threadContext->scriptWorker);
+	}
 #endif
 	core->clearCoreCallbacks(core);
+	if (useBootCache) {
+		mBootCacheDeinit(&bootCache);
+	}
 
 	if (logger->filter == &filter) {
 		mLogFilterDeinit(&filter);
@@ -468,6 +687,11 @@ bool mCoreThreadStart(struct mCoreThread* threadContext) {
 
 	MutexInit(&threadContext->impl->stateMutex);
 	ConditionInit(&threadContext->impl->stateCond);
+	MutexInit(&threadContext->impl->frameTimingMutex);
+	MutexInit(&threadContext->impl->commandMutex);
+	ConditionInit(&threadContext->impl->commandCond);
+	mCoreThreadCommandListInit(&threadContext->impl->commands, 0);
+	mCoreThreadCommandListInit(&threadContext->impl->runningCommands, 0);
 
 	MutexInit(&threadContext->impl->sync.videoFrameMutex);
 	ConditionInit(&threadContext->impl->sync.videoFrameAvailableCond);
@@ -477,6 +701,17 @@ bool mCoreThreadStart(struct mCoreThread* threadContext) {
 
 	threadContext->impl->interruptDepth = 0;
 
+#ifdef ENABLE_TRACING
+	const char* traceFile = mCoreConfigGetValue(&threadContext->core->config, "traceFile");
+	if (traceFile) {
+		struct VFile* vf = VFileOpen(traceFile, O_CREAT | O_TRUNC | O_WRONLY);
+		if (vf) {
+			threadContext->impl->trace = mTraceJSONCreate(vf);
+			mTraceSetBackend(threadContext->impl->trace);
+		}
+	}
+#endif
+
 #ifdef USE_PTHREADS
 	sigset_t signals;
 	sigemptyset(&signals);
@@ -487,7 +722,9 @@ bool mCoreThreadStart(struct mCoreThread* threadContext) {
 
 	threadContext->impl->sync.audioWait = threadContext->core->opts.audioSync;
 	threadContext->impl->sync.videoFrameWait = threadContext->core->opts.videoSync;
+	threadContext->impl->sync.framePacing = threadContext->core->opts.framePacing;
 	threadContext->impl->sync.fpsTarget = threadContext->core->opts.fpsTarget;
+	threadContext->impl->sync.audioRateControl = threadContext->core->opts.audioRateControl;
 
 	MutexLock(&threadContext->impl->stateMutex);
 	ThreadCreate(&threadContext->impl->thread, _mCoreThreadRun, threadContext);
@@ -579,8 +816,18 @@ void mCoreThreadJoin(struct mCoreThread* threadContext) {
 	}
 	ThreadJoin(&threadContext->impl->thread);
 
+	if (threadContext->impl->trace) {
+		mTraceSetBackend(NULL);
+		mTraceJSONDestroy(threadContext->impl->trace);
+	}
+
 	MutexDeinit(&threadContext->impl->stateMutex);
 	ConditionDeinit(&threadContext->impl->stateCond);
+	MutexDeinit(&threadContext->impl->frameTimingMutex);
+	MutexDeinit(&threadContext->impl->commandMutex);
+	ConditionDeinit(&threadContext->impl->commandCond);
+	mCoreThreadCommandListDeinit(&threadContext->impl->commands);
+	mCoreThreadCommandListDeinit(&threadContext->impl->runningCommands);
 
 	MutexDeinit(&threadContext->impl->sync.videoFrameMutex);
 	ConditionWake(&threadContext->impl->sync.videoFrameAvailableCond);
@@ -662,6 +909,45 @@ void mCoreThreadRunFunction(struct mCoreThread* threadContext, void (*run)(struc
 	MutexUnlock(&threadContext->impl->stateMutex);
 }
 
+bool mCoreThreadPostCommand(struct mCoreThread* threadContext, mCoreThreadCommand command, void* context, struct mCoreThreadFuture* future) {
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	MutexLock(&impl->commandMutex);
+	if (impl->commandsClosed) {
+		MutexUnlock(&impl->commandMutex);
+		return false;
+	}
+	*mCoreThreadCommandListAppend(&impl->commands) = (struct mCoreThreadCommandEntry) {
+		.command = command,
+		.context = context,
+		.future = future,
+	};
+	ATOMIC_ADD(impl->pendingCommands, 1);
+	MutexUnlock(&impl->commandMutex);
+
+	// A paused thread needs waking up to notice, but a running one picks it up on its own
+	MutexLock(&impl->stateMutex);
+	if (impl->state == mTHREAD_PAUSED) {
+		ConditionWake(&impl->stateCond);
+	}
+	MutexUnlock(&impl->stateMutex);
+	return true;
+}
+
+bool mCoreThreadFutureIsDone(struct mCoreThreadFuture* future) {
+	int done;
+	ATOMIC_LOAD(done, future->done);
+	return done;
+}
+
+void mCoreThreadFutureWait(struct mCoreThread* threadContext, struct mCoreThreadFuture* future) {
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	MutexLock(&impl->commandMutex);
+	while (!mCoreThreadFutureIsDone(future)) {
+		ConditionWait(&impl->commandCond, &impl->commandMutex);
+	}
+	MutexUnlock(&impl->commandMutex);
+}
+
 void mCoreThreadPause(struct mCoreThread* threadContext) {
 	MutexLock(&threadContext->impl->stateMutex);
 	_waitOnInterrupt(threadContext->impl);
@@ -713,10 +999,19 @@ void mCoreThreadSetRewinding(struct mCoreThread* threadContext, bool rewinding)
 	MutexUnlock(&threadContext->impl->stateMutex);
 }
 
+void mCoreThreadSetFastForward(struct mCoreThread* threadContext, bool enable, float presentFps) {
+	MutexLock(&threadContext->impl->stateMutex);
+	threadContext->impl->fastForward = enable;
+	threadContext->impl->frameSkip.presentFps = presentFps;
+	MutexUnlock(&threadContext->impl->stateMutex);
+}
+
 void mCoreThreadRewindParamsChanged(struct mCoreThread* threadContext) {
 	struct mCore* core = threadContext->core;
 	if (core->opts.rewindEnable && core->opts.rewindBufferCapacity > 0) {
 		 mCoreRewindContextInit(&threadContext->impl->rewind, core->opts.rewindBufferCapacity, true);
+		size_t budget = core->opts.rewindBufferMemory > 0 ? core->opts.rewindBufferMemory * 1024ULL : 0;
+		mCoreRewindContextSetMemoryBudget(&threadContext->impl->rewind, budget);
 	} else {
 		 mCoreRewindContextDeinit(&threadContext->impl->rewind);
 	}
@@ -734,6 +1029,43 @@ void mCoreThreadStopWaiting(struct mCoreThread* threadContext) {
 	MutexUnlock(&threadContext->impl->stateMutex);
 }
 
+void mCoreThreadFramePresented(struct mCoreThread* threadContext) {
+	if (!threadContext->impl) {
+		return;
+	}
+	uint64_t now = mPerfTimestamp();
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	mCoreSyncFramePresented(&impl->sync, now);
+	MutexLock(&impl->frameTimingMutex);
+	if (impl->frameTimingCount) {
+		struct mCoreFrameTiming* timing = &impl->frameTimings[(impl->frameTimingNext + mCORE_THREAD_FRAME_TIMINGS - 1) % mCORE_THREAD_FRAME_TIMINGS];
+		// A frame can be presented more than once if the frontend redraws, so only the first counts
+		if (!timing->presentNsec && now > timing->timestamp) {
+			timing->presentNsec = now - timing->timestamp;
+		}
+	}
+	MutexUnlock(&impl->frameTimingMutex);
+}
+
+size_t mCoreThreadGetFrameTimings(struct mCoreThread* threadContext, struct mCoreFrameTiming* timings, size_t max) {
+	if (!threadContext->impl) {
+		return 0;
+	}
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	MutexLock(&impl->frameTimingMutex);
+	size_t count = impl->frameTimingCount;
+	if (count > max) {
+		count = max;
+	}
+	size_t start = (impl->frameTimingNext + mCORE_THREAD_FRAME_TIMINGS - count) % mCORE_THREAD_FRAME_TIMINGS;
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		timings[i] = impl->frameTimings[(start + i) % mCORE_THREAD_FRAME_TIMINGS];
+	}
+	MutexUnlock(&impl->frameTimingMutex);
+	return count;
+}
+
 struct mCoreThread* mCoreThreadGet(void) {
 #ifdef USE_PTHREADS
 	pthread_once(&_contextOnce, _createTLS);
@@ -758,11 +1090,74 @@ static void _mCoreLog(struct mLogger* logger, int category, enum mLogLevel level
 	}
 }
 #else
+void mCoreThreadFramePresented(struct mCoreThread* threadContext) {
+	UNUSED(threadContext);
+}
+
+size_t mCoreThreadGetFrameTimings(struct mCoreThread* threadContext, struct mCoreFrameTiming* timings, size_t max) {
+	UNUSED(threadContext);
+	UNUSED(timings);
+	UNUSED(max);
+	return 0;
+}
+
 struct mCoreThread* mCoreThreadGet(void) {
 	return NULL;
 }
 #endif
 
+void mCoreFrameTimingSummarize(const struct mCoreFrameTiming* timings, size_t count, struct mCoreFrameTiming* mean, struct mCoreFrameTiming* worst) {
+	struct mCoreFrameTiming sum = {0};
+	struct mCoreFrameTiming max = {0};
+	size_t presented = 0;
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		const struct mCoreFrameTiming* timing = &timings[i];
+		sum.frameNsec += timing->frameNsec;
+		sum.emulationNsec += timing->emulationNsec;
+		sum.videoWaitNsec += timing->videoWaitNsec;
+		sum.audioWaitNsec += timing->audioWaitNsec;
+		if (timing->presentNsec) {
+			sum.presentNsec += timing->presentNsec;
+			++presented;
+		}
+		if (timing->frameNsec > max.frameNsec) {
+			max.frameNsec = timing->frameNsec;
+			max.frame = timing->frame;
+			max.timestamp = timing->timestamp;
+		}
+		if (timing->emulationNsec > max.emulationNsec) {
+			max.emulationNsec = timing->emulationNsec;
+		}
+		if (timing->videoWaitNsec > max.videoWaitNsec) {
+			max.videoWaitNsec = timing->videoWaitNsec;
+		}
+		if (timing->audioWaitNsec > max.audioWaitNsec) {
+			max.audioWaitNsec = timing->audioWaitNsec;
+		}
+		if (timing->presentNsec > max.presentNsec) {
+			max.presentNsec = timing->presentNsec;
+		}
+	}
+	if (mean) {
+		memset(mean, 0, sizeof(*mean));
+		if (count) {
+			mean->frame = timings[count - 1].frame;
+			mean->timestamp = timings[count - 1].timestamp;
+			mean->frameNsec = sum.frameNsec / count;
+			mean->emulationNsec = sum.emulationNsec / count;
+			mean->videoWaitNsec = sum.videoWaitNsec / count;
+			mean->audioWaitNsec = sum.audioWaitNsec / count;
+		}
+		if (presented) {
+			mean->presentNsec = sum.presentNsec / presented;
+		}
+	}
+	if (worst) {
+		*worst = max;
+	}
+}
+
 struct mLogger* mCoreThreadLogger(void) {
 	struct mCoreThread* thread = mCoreThreadGet();
 	if (thread) {
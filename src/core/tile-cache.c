@@ -7,6 +7,14 @@
 
 #include <mgba-util/memory.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TILE_CACHE_SSE2
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(__BIG_ENDIAN__) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_neon.h>
+#define TILE_CACHE_NEON
+#endif
+
 void mTileCacheInit(struct mTileCache* cache) {
 	// TODO: Reconfigurable cache for space savings
 	cache->cache = NULL;
@@ -14,6 +22,7 @@ void mTileCacheInit(struct mTileCache* cache) {
 	cache->status = NULL;
 	cache->globalPaletteVersion = NULL;
 	cache->palette = NULL;
+	cache->opaquePalette = NULL;
 }
 
 static void _freeCache(struct mTileCache* cache) {
@@ -31,6 +40,8 @@ static void _freeCache(struct mTileCache* cache) {
 	cache->globalPaletteVersion = NULL;
 	free(cache->palette);
 	cache->palette = NULL;
+	free(cache->opaquePalette);
+	cache->opaquePalette = NULL;
 }
 
 static void _redoCacheSize(struct mTileCache* cache) {
@@ -48,6 +59,13 @@ static void _redoCacheSize(struct mTileCache* cache) {
 	cache->status = anonymousMemoryMap(tiles * size * sizeof(*cache->status));
 	cache->globalPaletteVersion = calloc(size, sizeof(*cache->globalPaletteVersion));
 	cache->palette = calloc(size * bpp, sizeof(*cache->palette));
+	cache->opaquePalette = calloc(size * bpp, sizeof(*cache->opaquePalette));
+	unsigned i;
+	for (i = 0; i < size * bpp; ++i) {
+		if (i & (bpp - 1)) {
+			cache->opaquePalette[i] = (color_t) 0xFF000000;
+		}
+	}
 }
 
 void mTileCacheConfigure(struct mTileCache* cache, mTileCacheConfiguration config) {
@@ -89,6 +107,27 @@ void mTileCacheWriteVRAM(struct mTileCache* cache, uint32_t address) {
 	}
 }
 
+void mTileCacheWriteVRAMRange(struct mTileCache* cache, uint32_t address, uint32_t length) {
+	uint32_t end = address + length;
+	if (end <= cache->tileBase) {
+		return;
+	}
+	address = address < cache->tileBase ? 0 : address - cache->tileBase;
+	end -= cache->tileBase;
+	unsigned bpp = cache->bpp + 3;
+	unsigned count = cache->entriesPerTile;
+	uint32_t tile = address >> bpp;
+	uint32_t last = ((end - 1) >> bpp) + 1;
+	if (last > mTileCacheSystemInfoGetMaxTiles(cache->sysConfig)) {
+		last = mTileCacheSystemInfoGetMaxTiles(cache->sysConfig);
+	}
+	size_t i;
+	for (i = tile * count; i < last * count; ++i) {
+		cache->status[i].vramClean = 0;
+		++cache->status[i].vramVersion;
+	}
+}
+
 void mTileCacheWritePalette(struct mTileCache* cache, uint32_t entry, color_t color) {
 	if (entry < cache->paletteBase) {
 		return;
@@ -99,98 +138,95 @@ void mTileCacheWritePalette(struct mTileCache* cache, uint32_t entry, color_t co
 		return;
 	}
 	cache->palette[entry] = color;
+	// Color 0 is transparent, so only the others get forced opaque
+	cache->opaquePalette[entry] = entry & ((1 << (1 << cache->bpp)) - 1) ? color | 0xFF000000 : color;
 	entry >>= (1 << mTileCacheSystemInfoGetPaletteBPP(cache->sysConfig));
 	++cache->globalPaletteVersion[entry];
 }
 
-static void _regenerateTile4(struct mTileCache* cache, color_t* tile, unsigned tileId, unsigned paletteId) {
+static void _regenerateTile4(struct mTileCache* cache, color_t* tile, unsigned tileId, const color_t* palette) {
 	uint8_t* start = (uint8_t*) &cache->vram[tileId << 3];
-	paletteId <<= 2;
-	color_t* palette = &cache->palette[paletteId];
 	int i;
 	for (i = 0; i < 8; ++i) {
-		uint8_t tileDataLower = start[0];
-		uint8_t tileDataUpper = start[1];
+		unsigned tileDataLower = start[0];
+		unsigned tileDataUpper = start[1] << 1;
 		start += 2;
-		int pixel;
-		pixel = ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
-		tile[0] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-		tile[1] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-		tile[2] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-		tile[3] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-		tile[4] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-		tile[5] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-		tile[6] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-		tile[7] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
+		int x;
+		for (x = 0; x < 8; ++x) {
+			tile[x] = palette[((tileDataUpper >> (7 - x)) & 2) | ((tileDataLower >> (7 - x)) & 1)];
+		}
 		tile += 8;
 	}
 }
 
-static void _regenerateTile16(struct mTileCache* cache, color_t* tile, unsigned tileId, unsigned paletteId) {
+static void _regenerateTile16(struct mTileCache* cache, color_t* tile, unsigned tileId, const color_t* palette) {
+#if defined(TILE_CACHE_SSE2) || defined(TILE_CACHE_NEON)
+	// Unpack all 64 nibbles at once, low nibble first, then look them up
+	uint8_t indices[64];
+	const uint8_t* start = (const uint8_t*) &cache->vram[tileId << 4];
+	int i;
+	for (i = 0; i < 2; ++i) {
+#ifdef TILE_CACHE_SSE2
+		__m128i mask = _mm_set1_epi8(0xF);
+		__m128i bytes = _mm_loadu_si128((const __m128i*) &start[i * 16]);
+		__m128i low = _mm_and_si128(bytes, mask);
+		__m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+		_mm_storeu_si128((__m128i*) &indices[i * 32], _mm_unpacklo_epi8(low, high));
+		_mm_storeu_si128((__m128i*) &indices[i * 32 + 16], _mm_unpackhi_epi8(low, high));
+#else
+		uint8x16_t bytes = vld1q_u8(&start[i * 16]);
+		uint8x16x2_t unpacked = vzipq_u8(vandq_u8(bytes, vdupq_n_u8(0xF)), vshrq_n_u8(bytes, 4));
+		vst1q_u8(&indices[i * 32], unpacked.val[0]);
+		vst1q_u8(&indices[i * 32 + 16], unpacked.val[1]);
+#endif
+	}
+	for (i = 0; i < 64; ++i) {
+		tile[i] = palette[indices[i]];
+	}
+#else
 	uint32_t* start = (uint32_t*) &cache->vram[tileId << 4];
-	paletteId <<= 4;
-	color_t* palette = &cache->palette[paletteId];
 	int i;
 	for (i = 0; i < 8; ++i) {
 		uint32_t line = *start;
 		++start;
-		int pixel;
-		pixel = line & 0xF;
-		tile[0] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 4) & 0xF;
-		tile[1] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 8) & 0xF;
-		tile[2] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 12) & 0xF;
-		tile[3] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 16) & 0xF;
-		tile[4] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 20) & 0xF;
-		tile[5] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 24) & 0xF;
-		tile[6] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 28) & 0xF;
-		tile[7] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
+		int x;
+		for (x = 0; x < 8; ++x) {
+			tile[x] = palette[(line >> (x * 4)) & 0xF];
+		}
 		tile += 8;
 	}
+#endif
 }
 
-static void _regenerateTile256(struct mTileCache* cache, color_t* tile, unsigned tileId, unsigned paletteId) {
+static void _regenerateTile256(struct mTileCache* cache, color_t* tile, unsigned tileId, const color_t* palette) {
 	uint32_t* start = (uint32_t*) &cache->vram[tileId << 5];
-	paletteId <<= 8;
-	color_t* palette = &cache->palette[paletteId];
 	int i;
-	for (i = 0; i < 8; ++i) {
+	for (i = 0; i < 16; ++i) {
 		uint32_t line = *start;
 		++start;
-		int pixel;
-		pixel = line & 0xFF;
-		tile[0] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 8) & 0xFF;
-		tile[1] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 16) & 0xFF;
-		tile[2] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 24) & 0xFF;
-		tile[3] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
+		tile[0] = palette[line & 0xFF];
+		tile[1] = palette[(line >> 8) & 0xFF];
+		tile[2] = palette[(line >> 16) & 0xFF];
+		tile[3] = palette[line >> 24];
+		tile += 4;
+	}
+}
 
-		line = *start;
-		++start;
-		pixel = line & 0xFF;
-		tile[4] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 8) & 0xFF;
-		tile[5] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 16) & 0xFF;
-		tile[6] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		pixel = (line >> 24) & 0xFF;
-		tile[7] = pixel ? palette[pixel] | 0xFF000000 : palette[pixel];
-		tile += 8;
+static bool _regenerateTile(struct mTileCache* cache, color_t* tile, unsigned tileId, unsigned paletteId) {
+	// Lookups go through the opaque copy of the palette so the inner loops don't need to branch
+	const color_t* palette = &cache->opaquePalette[paletteId << (1 << cache->bpp)];
+	switch (cache->bpp) {
+	case 1:
+		_regenerateTile4(cache, tile, tileId, palette);
+		return true;
+	case 2:
+		_regenerateTile16(cache, tile, tileId, palette);
+		return true;
+	case 3:
+		_regenerateTile256(cache, tile, tileId, palette);
+		return true;
+	default:
+		return false;
 	}
 }
 
@@ -211,63 +247,48 @@ static inline color_t* _tileLookup(struct mTileCache* cache, unsigned tileId, un
 	}
 }
 
-const color_t* mTileCacheGetTile(struct mTileCache* cache, unsigned tileId, unsigned paletteId) {
-	unsigned count = cache->entriesPerTile;
-	unsigned bpp = cache->bpp;
-	struct mTileCacheEntry* status = &cache->status[tileId * count + paletteId];
+// Brings a tile's cached pixels up to date, returning whether they had to be regenerated
+static inline bool _updateTile(struct mTileCache* cache, struct mTileCacheEntry* status, unsigned tileId, unsigned paletteId, uint32_t paletteVersion) {
 	struct mTileCacheEntry desiredStatus = {
-		.paletteVersion = cache->globalPaletteVersion[paletteId],
+		.paletteVersion = paletteVersion,
 		.vramVersion = status->vramVersion,
 		.vramClean = 1,
 		.paletteId = paletteId
 	};
+	if (!memcmp(status, &desiredStatus, sizeof(*status))) {
+		return false;
+	}
+	if (!_regenerateTile(cache, _tileLookup(cache, tileId, paletteId), tileId, paletteId)) {
+		return false;
+	}
+	*status = desiredStatus;
+	return true;
+}
+
+const color_t* mTileCacheGetTile(struct mTileCache* cache, unsigned tileId, unsigned paletteId) {
 	color_t* tile = _tileLookup(cache, tileId, paletteId);
-	if (!mTileCacheConfigurationIsShouldStore(cache->config) || memcmp(status, &desiredStatus, sizeof(*status))) {
-		switch (bpp) {
-		case 0:
+	if (!mTileCacheConfigurationIsShouldStore(cache->config)) {
+		if (!_regenerateTile(cache, tile, tileId, paletteId)) {
 			return NULL;
-		case 1:
-			_regenerateTile4(cache, tile, tileId, paletteId);
-			break;
-		case 2:
-			_regenerateTile16(cache, tile, tileId, paletteId);
-			break;
-		case 3:
-			_regenerateTile256(cache, tile, tileId, paletteId);
-			break;
 		}
-		*status = desiredStatus;
+		return tile;
+	}
+	if (!cache->bpp) {
+		return NULL;
 	}
+	struct mTileCacheEntry* status = &cache->status[tileId * cache->entriesPerTile + paletteId];
+	_updateTile(cache, status, tileId, paletteId, cache->globalPaletteVersion[paletteId]);
 	return tile;
 }
 
 const color_t* mTileCacheGetTileIfDirty(struct mTileCache* cache, struct mTileCacheEntry* entry, unsigned tileId, unsigned paletteId) {
-	unsigned count = cache->entriesPerTile;
-	unsigned bpp = cache->bpp;
-	struct mTileCacheEntry* status = &cache->status[tileId * count + paletteId];
-	struct mTileCacheEntry desiredStatus = {
-		.paletteVersion = cache->globalPaletteVersion[paletteId],
-		.vramVersion = status->vramVersion,
-		.vramClean = 1,
-		.paletteId = paletteId
-	};
+	if (!cache->bpp) {
+		return NULL;
+	}
+	struct mTileCacheEntry* status = &cache->status[tileId * cache->entriesPerTile + paletteId];
 	color_t* tile = NULL;
-	if (memcmp(status, &desiredStatus, sizeof(*status))) {
+	if (_updateTile(cache, status, tileId, paletteId, cache->globalPaletteVersion[paletteId])) {
 		tile = _tileLookup(cache, tileId, paletteId);
-		switch (bpp) {
-		case 0:
-			return NULL;
-		case 1:
-			_regenerateTile4(cache, tile, tileId, paletteId);
-			break;
-		case 2:
-			_regenerateTile16(cache, tile, tileId, paletteId);
-			break;
-		case 3:
-			_regenerateTile256(cache, tile, tileId, paletteId);
-			break;
-		}
-		*status = desiredStatus;
 	}
 	if (memcmp(status, &entry[paletteId], sizeof(*status))) {
 		tile = _tileLookup(cache, tileId, paletteId);
@@ -276,6 +297,45 @@ const color_t* mTileCacheGetTileIfDirty(struct mTileCache* cache, struct mTileCa
 	return tile;
 }
 
+size_t mTileCacheRegenerateTiles(struct mTileCache* cache, unsigned start, unsigned count, unsigned paletteId) {
+	if (!mTileCacheConfigurationIsShouldStore(cache->config) || !cache->bpp) {
+		return 0;
+	}
+	unsigned stride = cache->entriesPerTile;
+	uint32_t paletteVersion = cache->globalPaletteVersion[paletteId];
+	struct mTileCacheEntry* status = &cache->status[start * stride + paletteId];
+	size_t regenerated = 0;
+	unsigned i;
+	for (i = 0; i < count; ++i, status += stride) {
+		if (_updateTile(cache, status, start + i, paletteId, paletteVersion)) {
+			++regenerated;
+		}
+	}
+	return regenerated;
+}
+
+size_t mTileCacheCopyDirtyTiles(struct mTileCache* cache, struct mTileCacheEntry* entries, size_t entryStride, unsigned start, unsigned count, unsigned paletteId, bool force, unsigned* tileIds, color_t* pixels) {
+	if (!cache->bpp) {
+		return 0;
+	}
+	mTileCacheRegenerateTiles(cache, start, count, paletteId);
+	size_t copied = 0;
+	unsigned i;
+	for (i = 0; i < count; ++i) {
+		const struct mTileCacheEntry* status = &cache->status[(start + i) * cache->entriesPerTile + paletteId];
+		struct mTileCacheEntry* entry = &entries[i * entryStride + paletteId];
+		if (memcmp(status, entry, sizeof(*status))) {
+			*entry = *status;
+		} else if (!force) {
+			continue;
+		}
+		tileIds[copied] = start + i;
+		memcpy(&pixels[copied * 64], _tileLookup(cache, start + i, paletteId), 64 * sizeof(*pixels));
+		++copied;
+	}
+	return copied;
+}
+
 const color_t* mTileCacheGetPalette(struct mTileCache* cache, unsigned paletteId) {
 	return &cache->palette[paletteId << (1 << cache->bpp)];
 }
@@ -5,9 +5,91 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/core/timing.h>
 
+#include <mgba/core/perf.h>
+
+#ifdef ENABLE_TIMING_HEAP
+#define HEAP_INITIAL_CAPACITY 32
+
+static bool _eventBefore(const struct mTiming* timing, const struct mTimingEvent* a, const struct mTimingEvent* b) {
+	int32_t aWhen = a->when - timing->masterCycles;
+	int32_t bWhen = b->when - timing->masterCycles;
+	if (aWhen != bWhen) {
+		return aWhen < bWhen;
+	}
+	if (a->priority != b->priority) {
+		return a->priority < b->priority;
+	}
+	// Events with equal time and priority run in the order they were scheduled
+	return (int32_t) (a->sequence - b->sequence) < 0;
+}
+
+static void _heapPlace(struct mTiming* timing, struct mTimingEvent* event, size_t index) {
+	timing->heap[index] = event;
+	event->index = index;
+}
+
+static void _heapSiftUp(struct mTiming* timing, size_t index) {
+	struct mTimingEvent* event = timing->heap[index];
+	while (index) {
+		size_t parent = (index - 1) >> 1;
+		if (!_eventBefore(timing, event, timing->heap[parent])) {
+			break;
+		}
+		_heapPlace(timing, timing->heap[parent], index);
+		index = parent;
+	}
+	_heapPlace(timing, event, index);
+}
+
+static void _heapSiftDown(struct mTiming* timing, size_t index) {
+	struct mTimingEvent* event = timing->heap[index];
+	size_t size = timing->heapSize;
+	while (true) {
+		size_t child = index * 2 + 1;
+		if (child >= size) {
+			break;
+		}
+		if (child + 1 < size && _eventBefore(timing, timing->heap[child + 1], timing->heap[child])) {
+			++child;
+		}
+		if (!_eventBefore(timing, timing->heap[child], event)) {
+			break;
+		}
+		_heapPlace(timing, timing->heap[child], index);
+		index = child;
+	}
+	_heapPlace(timing, event, index);
+}
+
+static bool _heapContains(const struct mTiming* timing, const struct mTimingEvent* event) {
+	return event->index < timing->heapSize && timing->heap[event->index] == event;
+}
+
+static void _heapRemove(struct mTiming* timing, size_t index) {
+	--timing->heapSize;
+	if (index == timing->heapSize) {
+		return;
+	}
+	_heapPlace(timing, timing->heap[timing->heapSize], index);
+	if (index && _eventBefore(timing, timing->heap[index], timing->heap[(index - 1) >> 1])) {
+		_heapSiftUp(timing, index);
+	} else {
+		_heapSiftDown(timing, index);
+	}
+}
+#endif
+
 void mTimingInit(struct mTiming* timing, int32_t* relativeCycles, int32_t* nextEvent) {
+#ifndef ENABLE_TIMING_HEAP
 	timing->root = NULL;
 	timing->reroot = NULL;
+#else
+	timing->heapCapacity = HEAP_INITIAL_CAPACITY;
+	timing->heap = calloc(timing->heapCapacity, sizeof(*timing->heap));
+	timing->heapSize = 0;
+	timing->sequence = 0;
+	timing->interrupted = false;
+#endif
 	timing->globalCycles = 0;
 	timing->masterCycles = 0;
 	timing->relativeCycles = relativeCycles;
@@ -15,22 +97,35 @@ void mTimingInit(struct mTiming* timing, int32_t* relativeCycles, int32_t* nextE
 }
 
 void mTimingDeinit(struct mTiming* timing) {
+#ifndef ENABLE_TIMING_HEAP
 	UNUSED(timing);
+#else
+	free(timing->heap);
+	timing->heap = NULL;
+	timing->heapSize = 0;
+	timing->heapCapacity = 0;
+#endif
 }
 
 void mTimingClear(struct mTiming* timing) {
-	timing->root = NULL;
-	timing->reroot = NULL;
+	mTimingDescheduleAll(timing);
 	timing->globalCycles = 0;
 	timing->masterCycles = 0;
 }
 
 void mTimingInterrupt(struct mTiming* timing) {
+#ifndef ENABLE_TIMING_HEAP
 	if (!timing->root) {
 		return;
 	}
 	timing->reroot = timing->root;
 	timing->root = NULL;
+#else
+	if (!timing->heapSize) {
+		return;
+	}
+	timing->interrupted = true;
+#endif
 }
 
 void mTimingSchedule(struct mTiming* timing, struct mTimingEvent* event, int32_t when) {
@@ -39,6 +134,7 @@ void mTimingSchedule(struct mTiming* timing, struct mTimingEvent* event, int32_t
 	if (nextEvent < *timing->nextEvent) {
 		*timing->nextEvent = nextEvent;
 	}
+#ifndef ENABLE_TIMING_HEAP
 	if (timing->reroot) {
 		timing->root = timing->reroot;
 		timing->reroot = NULL;
@@ -56,6 +152,21 @@ void mTimingSchedule(struct mTiming* timing, struct mTimingEvent* event, int32_t
 	}
 	event->next = next;
 	*previous = event;
+#else
+	timing->interrupted = false;
+	event->sequence = timing->sequence;
+	++timing->sequence;
+	if (_heapContains(timing, event)) {
+		_heapRemove(timing, event->index);
+	}
+	if (timing->heapSize == timing->heapCapacity) {
+		timing->heapCapacity *= 2;
+		timing->heap = realloc(timing->heap, timing->heapCapacity * sizeof(*timing->heap));
+	}
+	_heapPlace(timing, event, timing->heapSize);
+	++timing->heapSize;
+	_heapSiftUp(timing, event->index);
+#endif
 }
 
 void mTimingScheduleAbsolute(struct mTiming* timing, struct mTimingEvent* event, int32_t when) {
@@ -63,6 +174,7 @@ void mTimingScheduleAbsolute(struct mTiming* timing, struct mTimingEvent* event,
 }
 
 void mTimingDeschedule(struct mTiming* timing, struct mTimingEvent* event) {
+#ifndef ENABLE_TIMING_HEAP
 	if (timing->reroot) {
 		timing->root = timing->reroot;
 		timing->reroot = NULL;
@@ -77,9 +189,26 @@ void mTimingDeschedule(struct mTiming* timing, struct mTimingEvent* event) {
 		previous = &next->next;
 		next = next->next;
 	}
+#else
+	timing->interrupted = false;
+	if (_heapContains(timing, event)) {
+		_heapRemove(timing, event->index);
+	}
+#endif
+}
+
+void mTimingDescheduleAll(struct mTiming* timing) {
+#ifndef ENABLE_TIMING_HEAP
+	timing->root = NULL;
+	timing->reroot = NULL;
+#else
+	timing->heapSize = 0;
+	timing->interrupted = false;
+#endif
 }
 
 bool mTimingIsScheduled(const struct mTiming* timing, const struct mTimingEvent* event) {
+#ifndef ENABLE_TIMING_HEAP
 	const struct mTimingEvent* next = timing->root;
 	if (!next) {
 		next = timing->reroot;
@@ -91,11 +220,15 @@ bool mTimingIsScheduled(const struct mTiming* timing, const struct mTimingEvent*
 		next = next->next;
 	}
 	return false;
+#else
+	return _heapContains(timing, event);
+#endif
 }
 
-int32_t mTimingTick(struct mTiming* timing, int32_t cycles) {
+static int32_t _mTimingTick(struct mTiming* timing, int32_t cycles) {
 	timing->masterCycles += cycles;
 	uint32_t masterCycles = timing->masterCycles;
+#ifndef ENABLE_TIMING_HEAP
 	while (timing->root) {
 		struct mTimingEvent* next = timing->root;
 		int32_t nextWhen = next->when - masterCycles;
@@ -105,17 +238,40 @@ int32_t mTimingTick(struct mTiming* timing, int32_t cycles) {
 		timing->root = next->next;
 		next->callback(timing, next->context, -nextWhen);
 	}
-	if (timing->reroot) {
-		timing->root = timing->reroot;
-		timing->reroot = NULL;
-		*timing->nextEvent = mTimingNextEvent(timing);
-		if (*timing->nextEvent <= 0) {
-			return mTimingTick(timing, 0);
+	if (!timing->reroot) {
+		return *timing->nextEvent;
+	}
+	timing->root = timing->reroot;
+	timing->reroot = NULL;
+#else
+	while (timing->heapSize && !timing->interrupted) {
+		struct mTimingEvent* next = timing->heap[0];
+		int32_t nextWhen = next->when - masterCycles;
+		if (nextWhen > 0) {
+			return nextWhen;
 		}
+		_heapRemove(timing, 0);
+		next->callback(timing, next->context, -nextWhen);
+	}
+	if (!timing->interrupted) {
+		return *timing->nextEvent;
+	}
+	timing->interrupted = false;
+#endif
+	*timing->nextEvent = mTimingNextEvent(timing);
+	if (*timing->nextEvent <= 0) {
+		return _mTimingTick(timing, 0);
 	}
 	return *timing->nextEvent;
 }
 
+int32_t mTimingTick(struct mTiming* timing, int32_t cycles) {
+	mPERF_ENTER(TIMING);
+	int32_t nextEvent = _mTimingTick(timing, cycles);
+	mPERF_LEAVE();
+	return nextEvent;
+}
+
 int32_t mTimingCurrentTime(const struct mTiming* timing) {
 	return timing->masterCycles + *timing->relativeCycles;
 }
@@ -125,7 +281,14 @@ uint64_t mTimingGlobalTime(const struct mTiming* timing) {
 }
 
 int32_t mTimingNextEvent(struct mTiming* timing) {
+#ifndef ENABLE_TIMING_HEAP
 	struct mTimingEvent* next = timing->root;
+#else
+	struct mTimingEvent* next = NULL;
+	if (timing->heapSize && !timing->interrupted) {
+		next = timing->heap[0];
+	}
+#endif
 	if (!next) {
 		return INT_MAX;
 	}
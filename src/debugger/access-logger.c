@@ -9,6 +9,7 @@
 #include <mgba-util/vfs.h>
 
 #define DEFAULT_MAX_REGIONS 20
+#define FAST_PATH_FLUSH_INTERVAL 0x1000000
 
 const char mAL_MAGIC[] = "mAL\1";
 
@@ -45,6 +46,13 @@ struct mDebuggerAccessLog {
 	struct mDebuggerAccessLogRegionInfo regionInfo[];
 };
 
+static inline void _markAccess(struct mDebuggerAccessLogRegion* region, size_t offset, int width, mDebuggerAccessLogFlags flags) {
+	int i;
+	for (i = 0; i < width; ++i) {
+		region->block[offset + i] |= flags;
+	}
+}
+
 static void _mDebuggerAccessLoggerEntered(struct mDebuggerModule* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
 	struct mDebuggerAccessLogger* logger = (struct mDebuggerAccessLogger*) debugger;
 	logger->d.isPaused = false;
@@ -81,42 +89,30 @@ static void _mDebuggerAccessLoggerEntered(struct mDebuggerModule* debugger, enum
 
 		offset &= -info->width;
 
-		int j;
+		mDebuggerAccessLogFlags flags = 0;
 		switch (reason) {
 		case DEBUGGER_ENTER_WATCHPOINT:
-			for (j = 0; j < info->width; ++j) {
-				if (info->type.wp.accessType & WATCHPOINT_WRITE) {
-					region->block[offset + j] = mDebuggerAccessLogFlagsFillWrite(region->block[offset + j]);
-				}
-				if (info->type.wp.accessType & WATCHPOINT_READ) {
-					region->block[offset + j] = mDebuggerAccessLogFlagsFillRead(region->block[offset + j]);
-				}
+			if (info->type.wp.accessType & WATCHPOINT_WRITE) {
+				flags = mDebuggerAccessLogFlagsFillWrite(flags);
+			}
+			if (info->type.wp.accessType & WATCHPOINT_READ) {
+				flags = mDebuggerAccessLogFlagsFillRead(flags);
 			}
 			switch (info->width) {
 			case 1:
-				region->block[offset] = mDebuggerAccessLogFlagsFillAccess8(region->block[offset]);
+				flags = mDebuggerAccessLogFlagsFillAccess8(flags);
 				break;
 			case 2:
-				region->block[offset] = mDebuggerAccessLogFlagsFillAccess16(region->block[offset]);
-				region->block[offset + 1] = mDebuggerAccessLogFlagsFillAccess16(region->block[offset + 1]);
+				flags = mDebuggerAccessLogFlagsFillAccess16(flags);
 				break;
 			case 4:
-				region->block[offset] = mDebuggerAccessLogFlagsFillAccess32(region->block[offset]);
-				region->block[offset + 1] = mDebuggerAccessLogFlagsFillAccess32(region->block[offset + 1]);
-				region->block[offset + 2] = mDebuggerAccessLogFlagsFillAccess32(region->block[offset + 2]);
-				region->block[offset + 3] = mDebuggerAccessLogFlagsFillAccess32(region->block[offset + 3]);
+				flags = mDebuggerAccessLogFlagsFillAccess32(flags);
 				break;
 			case 8:
-				region->block[offset] = mDebuggerAccessLogFlagsFillAccess64(region->block[offset]);
-				region->block[offset + 1] = mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 1]);
-				region->block[offset + 2] = mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 2]);
-				region->block[offset + 3] = mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 3]);
-				region->block[offset + 4] = mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 4]);
-				region->block[offset + 5] = mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 5]);
-				region->block[offset + 6] = mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 6]);
-				region->block[offset + 7] = mDebuggerAccessLogFlagsFillAccess64(region->block[offset + 7]);
+				flags = mDebuggerAccessLogFlagsFillAccess64(flags);
 				break;
 			}
+			_markAccess(region, offset, info->width, flags);
 			break;
 		case DEBUGGER_ENTER_ILLEGAL_OP:
 			region->block[offset] = mDebuggerAccessLogFlagsFillExecute(region->block[offset]);
@@ -171,6 +167,35 @@ static void _mDebuggerAccessLoggerCallback(struct mDebuggerModule* debugger) {
 	}
 }
 
+static void _mDebuggerAccessLoggerHook(struct mDebuggerAccessHook* hook, uint32_t address, int width, mDebuggerAccessLogFlags flags) {
+	struct mDebuggerAccessLogger* logger = (struct mDebuggerAccessLogger*) ((uintptr_t) hook - offsetof(struct mDebuggerAccessLogger, hook));
+	size_t nRegions = mDebuggerAccessLogRegionListSize(&logger->regions);
+	size_t r = logger->lastRegion;
+	size_t i;
+	// Consecutive accesses usually hit the same region, so start looking where the last one was
+	for (i = 0; i < nRegions; ++i, ++r) {
+		if (r >= nRegions) {
+			r = 0;
+		}
+		struct mDebuggerAccessLogRegion* region = mDebuggerAccessLogRegionListGetPointer(&logger->regions, r);
+		if (address < region->start || address >= region->end) {
+			continue;
+		}
+		size_t offset = (address - region->start) & -width;
+		if (offset + width > region->size) {
+			continue;
+		}
+		logger->lastRegion = r;
+		_markAccess(region, offset, width, flags);
+		break;
+	}
+
+	++logger->unflushedAccesses;
+	if (logger->unflushedAccesses >= FAST_PATH_FLUSH_INTERVAL) {
+		mDebuggerAccessLoggerFlush(logger);
+	}
+}
+
 void mDebuggerAccessLoggerInit(struct mDebuggerAccessLogger* logger) {
 	memset(logger, 0, sizeof(*logger));
 	mDebuggerAccessLogRegionListInit(&logger->regions, 1);
@@ -178,6 +203,7 @@ void mDebuggerAccessLoggerInit(struct mDebuggerAccessLogger* logger) {
 	logger->d.type = DEBUGGER_ACCESS_LOGGER;
 	logger->d.entered = _mDebuggerAccessLoggerEntered;
 	logger->d.custom = _mDebuggerAccessLoggerCallback;
+	logger->hook.access = _mDebuggerAccessLoggerHook;
 }
 
 void mDebuggerAccessLoggerDeinit(struct mDebuggerAccessLogger* logger) {
@@ -240,6 +266,16 @@ static bool _setupRegion(struct mDebuggerAccessLogger* logger, struct mDebuggerA
 		return false;
 	}
 
+	struct mDebuggerPlatform* platform = logger->d.p->platform;
+	if (logger->fastPath && platform->setAccessHook) {
+		if (!logger->hookInstalled) {
+			logger->hookInstalled = platform->setAccessHook(platform, &logger->hook);
+		}
+		if (logger->hookInstalled) {
+			return true;
+		}
+	}
+
 	struct mWatchpoint wp = {
 		.segment = -1,
 		.minAddress = region->start,
@@ -434,7 +470,12 @@ bool mDebuggerAccessLoggerClose(struct mDebuggerAccessLogger* logger) {
 	if (!logger->backing) {
 		return true;
 	}
+	if (logger->hookInstalled) {
+		logger->d.p->platform->setAccessHook(logger->d.p->platform, NULL);
+		logger->hookInstalled = false;
+	}
 	mDebuggerAccessLogRegionListClear(&logger->regions);
+	logger->lastRegion = 0;
 	logger->backing->unmap(logger->backing, logger->mapped, logger->backing->size(logger->backing));
 	logger->mapped = NULL;
 	logger->backing->close(logger->backing);
@@ -442,6 +483,18 @@ bool mDebuggerAccessLoggerClose(struct mDebuggerAccessLogger* logger) {
 	return true;
 }
 
+bool mDebuggerAccessLoggerFlush(struct mDebuggerAccessLogger* logger) {
+	logger->unflushedAccesses = 0;
+	if (!logger->backing) {
+		return false;
+	}
+	ssize_t size = logger->backing->size(logger->backing);
+	if (size < 0) {
+		return false;
+	}
+	return logger->backing->sync(logger->backing, logger->mapped, size);
+}
+
 int mDebuggerAccessLoggerWatchMemoryBlockId(struct mDebuggerAccessLogger* logger, size_t id, mDebuggerAccessLogRegionFlags flags) {
 	struct mCore* core = logger->d.p->core;
 	const struct mCoreMemoryBlock* blocks;
@@ -13,8 +13,11 @@
 #endif
 #include <mgba/core/timing.h>
 #include <mgba/core/version.h>
+#include <mgba/internal/debugger/history.h>
 #include <mgba/internal/debugger/parser.h>
+#include <mgba/internal/debugger/profiler.h>
 #include <mgba/internal/debugger/stack-trace.h>
+#include <mgba/internal/debugger/trace-recorder.h>
 #ifdef USE_ELF
 #include <mgba-util/elf-read.h>
 #endif
@@ -29,6 +32,9 @@
 #include <pthread.h>
 #endif
 
+#define CLI_HISTORY_DEFAULT_CHECKPOINTS 60
+#define CLI_PROFILE_DEFAULT_ENTRIES 20
+
 const char* ERROR_MISSING_ARGS = "Arguments missing"; // TODO: share
 const char* ERROR_OVERFLOW = "Arguments overflow";
 const char* ERROR_INVALID_ARGS = "Invalid arguments";
@@ -37,6 +43,7 @@ const char* INFO_WATCHPOINT_ADDED = "Added watchpoint #%" PRIz "i\n";
 
 static struct ParseTree* _parseTree(const char** string);
 static bool _doTrace(struct CLIDebugger* debugger);
+static void _reportEntry(struct mDebuggerModule* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info);
 
 #if !defined(NDEBUG) && !defined(_WIN32)
 static void _breakInto(struct CLIDebugger*, struct CLIDebugVector*);
@@ -44,10 +51,16 @@ static void _breakInto(struct CLIDebugger*, struct CLIDebugVector*);
 static void _continue(struct CLIDebugger*, struct CLIDebugVector*);
 static void _disassemble(struct CLIDebugger*, struct CLIDebugVector*);
 static void _next(struct CLIDebugger*, struct CLIDebugVector*);
+static void _history(struct CLIDebugger*, struct CLIDebugVector*);
+static void _reverseContinue(struct CLIDebugger*, struct CLIDebugVector*);
+static void _reverseStep(struct CLIDebugger*, struct CLIDebugVector*);
 static void _print(struct CLIDebugger*, struct CLIDebugVector*);
 static void _printBin(struct CLIDebugger*, struct CLIDebugVector*);
 static void _printHex(struct CLIDebugger*, struct CLIDebugVector*);
 static void _printStatus(struct CLIDebugger*, struct CLIDebugVector*);
+static void _profile(struct CLIDebugger*, struct CLIDebugVector*);
+static void _profileReport(struct CLIDebugger*, struct CLIDebugVector*);
+static void _profileSave(struct CLIDebugger*, struct CLIDebugVector*);
 static void _printHelp(struct CLIDebugger*, struct CLIDebugVector*);
 static void _quit(struct CLIDebugger*, struct CLIDebugVector*);
 static void _readByte(struct CLIDebugger*, struct CLIDebugVector*);
@@ -67,6 +80,7 @@ static void _setWriteRangeWatchpoint(struct CLIDebugger*, struct CLIDebugVector*
 static void _setWriteChangedRangeWatchpoint(struct CLIDebugger*, struct CLIDebugVector*);
 static void _listWatchpoints(struct CLIDebugger*, struct CLIDebugVector*);
 static void _trace(struct CLIDebugger*, struct CLIDebugVector*);
+static void _recordTrace(struct CLIDebugger*, struct CLIDebugVector*);
 static void _writeByte(struct CLIDebugger*, struct CLIDebugVector*);
 static void _writeHalfword(struct CLIDebugger*, struct CLIDebugVector*);
 static void _writeRegister(struct CLIDebugger*, struct CLIDebugVector*);
@@ -94,21 +108,28 @@ static struct CLIDebuggerCommandSummary _debuggerCommands[] = {
 	{ "events", _events, "", "Print list of scheduled events" },
 	{ "finish", _finish, "", "Execute until current stack frame returns" },
 	{ "help", _printHelp, "S", "Print help" },
+	{ "history", _history, "ii", "Record checkpoints for reverse execution every N cycles, keeping M; 0 to stop" },
 	{ "listb", _listBreakpoints, "", "List breakpoints" },
 	{ "listw", _listWatchpoints, "", "List watchpoints" },
 	{ "next", _next, "", "Execute next instruction" },
 	{ "print", _print, "S+", "Print a value" },
 	{ "print/t", _printBin, "S+", "Print a value as binary" },
 	{ "print/x", _printHex, "S+", "Print a value as hexadecimal" },
+	{ "profile", _profile, "i", "Sample the PC every N cycles while running; 0 to stop" },
+	{ "profile-report", _profileReport, "i", "Print the functions where the most samples landed" },
+	{ "profile-save", _profileSave, "S", "Save sampled stacks in folded format for flame graph tools" },
 	{ "quit", _quit, "", "Quit the emulator" },
+	{ "record-trace", _recordTrace, "s", "Record a binary instruction trace to a file, or stop recording" },
 	{ "reset", _reset, "", "Reset the emulation" },
+	{ "reverse-continue", _reverseContinue, "", "Execute backwards until the previous breakpoint or watchpoint" },
+	{ "reverse-step", _reverseStep, "", "Execute backwards by one instruction" },
 	{ "r/1", _readByte, "I", "Read a byte from a specified offset" },
 	{ "r/2", _readHalfword, "I", "Read a halfword from a specified offset" },
 	{ "r/4", _readWord, "I", "Read a word from a specified offset" },
 	{ "set", _setSymbol, "SI", "Assign a symbol to an address" },
 	{ "stack", _setStackTraceMode, "S", "Change the stack tracing mode" },
 	{ "status", _printStatus, "", "Print the current status" },
-	{ "symbol", _findSymbol, "I", "Find the symbol name for an address" },
+	{ "symbol", _findSymbol, "I", "Find the symbol name for an address, or the closest one before it" },
 	{ "load-symbols", _loadSymbols, "S", "Load symbols from an external file" },
 	{ "trace", _trace, "Is", "Trace a number of instructions" },
 	{ "w/1", _writeByte, "II", "Write a byte at a specified offset" },
@@ -154,6 +175,8 @@ static struct CLIDebuggerCommandAlias _debuggerCommandAliases[] = {
 	{ "p/t", "print/t" },
 	{ "p/x", "print/x" },
 	{ "q", "quit" },
+	{ "rc", "reverse-continue" },
+	{ "rs", "reverse-step" },
 	{ "w", "watch" },
 	{ "watchr", "watch-range" },
 	{ "wr", "watch-range" },
@@ -219,6 +242,64 @@ static void _next(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 	_printStatus(debugger, 0);
 }
 
+static void _history(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	struct mDebugger* parent = debugger->d.p;
+	if (dv && dv->type != CLIDV_INT_TYPE) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+		return;
+	}
+	if (dv && dv->intValue <= 0) {
+		mDebuggerDisableHistory(parent);
+		return;
+	}
+	uint64_t interval = 0;
+	size_t count = CLI_HISTORY_DEFAULT_CHECKPOINTS;
+	if (dv) {
+		interval = dv->intValue;
+		if (dv->next) {
+			if (dv->next->type != CLIDV_INT_TYPE || dv->next->intValue <= 0) {
+				debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+				return;
+			}
+			count = dv->next->intValue;
+		}
+	} else if (parent->history) {
+		interval = parent->history->interval;
+		count = parent->history->maxCheckpoints;
+	}
+	mDebuggerEnableHistory(parent, interval, count);
+	debugger->backend->printf(debugger->backend, "Keeping %" PRIz "u of up to %" PRIz "u checkpoints, every %" PRIu64 " cycles\n",
+	                          mDebuggerCheckpointListSize(&parent->history->checkpoints), parent->history->maxCheckpoints, parent->history->interval);
+}
+
+static void _reverseStep(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	UNUSED(dv);
+	if (!debugger->d.p->history) {
+		debugger->backend->printf(debugger->backend, "History is not being recorded.\n");
+		return;
+	}
+	if (!mDebuggerReverseStep(debugger->d.p)) {
+		debugger->backend->printf(debugger->backend, "Reached the beginning of recorded history\n");
+	}
+	_printStatus(debugger, 0);
+}
+
+static void _reverseContinue(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	UNUSED(dv);
+	if (!debugger->d.p->history) {
+		debugger->backend->printf(debugger->backend, "History is not being recorded.\n");
+		return;
+	}
+	enum mDebuggerEntryReason reason;
+	struct mDebuggerEntryInfo info;
+	if (mDebuggerReverseContinue(debugger->d.p, &reason, &info)) {
+		_reportEntry(&debugger->d, reason, &info);
+	} else {
+		debugger->backend->printf(debugger->backend, "Reached the beginning of recorded history\n");
+	}
+	_printStatus(debugger, 0);
+}
+
 static void _disassemble(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 	debugger->system->disassemble(debugger->system, dv);
 }
@@ -390,6 +471,9 @@ static void _reset(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 	UNUSED(dv);
 	mStackTraceClear(&debugger->d.p->stackTrace);
 	debugger->d.p->core->reset(debugger->d.p->core);
+	if (debugger->profiler) {
+		mDebuggerProfilerUpdate(debugger->profiler);
+	}
 	_printStatus(debugger, 0);
 }
 
@@ -840,6 +924,111 @@ static void _trace(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 	}
 }
 
+static void _stopRecordingTrace(struct CLIDebugger* debugger) {
+	if (!debugger->traceRecorder) {
+		return;
+	}
+	mDebuggerDetachModule(debugger->d.p, &debugger->traceRecorder->d);
+	mDebuggerTraceRecorderDeinit(debugger->traceRecorder);
+	free(debugger->traceRecorder);
+	debugger->traceRecorder = NULL;
+}
+
+static void _recordTrace(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	struct mDebuggerPlatform* platform = debugger->d.p->platform;
+	if (!dv || !dv->charValue) {
+		if (debugger->traceRecorder) {
+			debugger->backend->printf(debugger->backend, "Recorded %" PRIu64 " instructions\n", debugger->traceRecorder->records);
+		}
+		_stopRecordingTrace(debugger);
+		return;
+	}
+	if (!platform->traceState) {
+		debugger->backend->printf(debugger->backend, "Trace recording is not supported by this platform.\n");
+		return;
+	}
+	_stopRecordingTrace(debugger);
+
+	struct VFile* vf = VFileOpen(dv->charValue, O_CREAT | O_TRUNC | O_RDWR);
+	if (!vf) {
+		debugger->backend->printf(debugger->backend, "Could not open file %s\n", dv->charValue);
+		return;
+	}
+	struct mDebuggerTraceState state;
+	platform->traceState(platform, &state);
+
+	debugger->traceRecorder = malloc(sizeof(*debugger->traceRecorder));
+	mDebuggerTraceRecorderInit(debugger->traceRecorder);
+	mDebuggerAttachModule(debugger->d.p, &debugger->traceRecorder->d);
+	if (!mDebuggerTraceRecorderOpen(debugger->traceRecorder, vf, debugger->d.p->core->platform(debugger->d.p->core), state.nRegisters)) {
+		vf->close(vf);
+		debugger->backend->printf(debugger->backend, "Could not write to file %s\n", dv->charValue);
+		_stopRecordingTrace(debugger);
+	}
+}
+
+static void _profile(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (dv && dv->type != CLIDV_INT_TYPE) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+		return;
+	}
+	if (dv && dv->intValue <= 0) {
+		if (debugger->profiler && debugger->profiler->running) {
+			mDebuggerProfilerStop(debugger->profiler);
+			debugger->backend->printf(debugger->backend, "Collected %" PRIu64 " samples\n", debugger->profiler->samples);
+		}
+		return;
+	}
+	if (!debugger->profiler) {
+		debugger->profiler = malloc(sizeof(*debugger->profiler));
+		mDebuggerProfilerInit(debugger->profiler, debugger->d.p->core);
+	}
+	mDebuggerProfilerClear(debugger->profiler);
+	if (!mDebuggerProfilerStart(debugger->profiler, dv ? dv->intValue : mDEBUGGER_PROFILER_DEFAULT_INTERVAL)) {
+		debugger->backend->printf(debugger->backend, "Profiling is not supported by this platform.\n");
+	}
+}
+
+static void _profileReport(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (dv && (dv->type != CLIDV_INT_TYPE || dv->intValue <= 0)) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+		return;
+	}
+	if (!debugger->profiler || !debugger->profiler->samples) {
+		debugger->backend->printf(debugger->backend, "No samples collected\n");
+		return;
+	}
+	size_t max = dv ? dv->intValue : CLI_PROFILE_DEFAULT_ENTRIES;
+	struct mDebuggerProfilerEntry* entries = calloc(max, sizeof(*entries));
+	size_t count = mDebuggerProfilerSummarize(debugger->profiler, debugger->d.p->core->symbolTable, entries, max);
+	uint64_t total = debugger->profiler->samples;
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		debugger->backend->printf(debugger->backend, "%5.1f%% %10" PRIu64 "  %s\n", entries[i].samples * 100.0 / total, entries[i].samples, entries[i].name);
+	}
+	free(entries);
+}
+
+static void _profileSave(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (!dv || dv->type != CLIDV_CHAR_TYPE) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_MISSING_ARGS);
+		return;
+	}
+	if (!debugger->profiler) {
+		debugger->backend->printf(debugger->backend, "No samples collected\n");
+		return;
+	}
+	struct VFile* vf = VFileOpen(dv->charValue, O_CREAT | O_TRUNC | O_WRONLY);
+	if (!vf) {
+		debugger->backend->printf(debugger->backend, "Could not open file %s\n", dv->charValue);
+		return;
+	}
+	if (!mDebuggerProfilerWriteFolded(debugger->profiler, debugger->d.p->core->symbolTable, vf)) {
+		debugger->backend->printf(debugger->backend, "Could not write to file %s\n", dv->charValue);
+	}
+	vf->close(vf);
+}
+
 static bool _doTrace(struct CLIDebugger* debugger) {
 	char trace[1024];
 	trace[sizeof(trace) - 1] = '\0';
@@ -876,10 +1065,18 @@ static void _printStatus(struct CLIDebugger* debugger, struct CLIDebugVector* dv
 static void _events(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 	UNUSED(dv);
 	struct mTiming* timing = debugger->d.p->core->timing;
+#ifndef ENABLE_TIMING_HEAP
 	struct mTimingEvent* next = timing->root;
 	for (; next; next = next->next) {
 		debugger->backend->printf(debugger->backend, "%s in %i cycles\n", next->name, mTimingUntil(timing, next));
 	}
+#else
+	size_t i;
+	for (i = 0; i < timing->heapSize; ++i) {
+		struct mTimingEvent* next = timing->heap[i];
+		debugger->backend->printf(debugger->backend, "%s in %i cycles\n", next->name, mTimingUntil(timing, next));
+	}
+#endif
 }
 
 struct CLIDebugVector* CLIDVParse(struct CLIDebugger* debugger, const char* string, size_t length) {
@@ -1211,6 +1408,12 @@ static void _cliDebuggerDeinit(struct mDebuggerModule* debugger) {
 		cliDebugger->traceVf->close(cliDebugger->traceVf);
 		cliDebugger->traceVf = NULL;
 	}
+	_stopRecordingTrace(cliDebugger);
+	if (cliDebugger->profiler) {
+		mDebuggerProfilerDeinit(cliDebugger->profiler);
+		free(cliDebugger->profiler);
+		cliDebugger->profiler = NULL;
+	}
 
 	if (cliDebugger->system) {
 		if (cliDebugger->system->deinit) {
@@ -1259,6 +1462,8 @@ void CLIDebuggerCreate(struct CLIDebugger* debugger) {
 
 	debugger->system = NULL;
 	debugger->backend = NULL;
+	debugger->profiler = NULL;
+	debugger->traceRecorder = NULL;
 }
 
 void CLIDebuggerAttachSystem(struct CLIDebugger* debugger, struct CLIDebuggerSystem* system) {
@@ -1463,13 +1668,18 @@ static void _findSymbol(struct CLIDebugger* debugger, struct CLIDebugVector* dv)
 		debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
 		return;
 	}
-	const char* name = mDebuggerSymbolReverseLookup(symbolTable, dv->intValue, dv->segmentValue);
+	uint32_t offset;
+	const char* name = mDebuggerSymbolReverseLookupNearest(symbolTable, dv->intValue, dv->segmentValue, &offset);
 	if (name) {
 		if (dv->segmentValue >= 0) {
-			debugger->backend->printf(debugger->backend, " 0x%02X:%08X = %s\n", dv->segmentValue, dv->intValue, name);
+			debugger->backend->printf(debugger->backend, " 0x%02X:%08X = %s", dv->segmentValue, dv->intValue, name);
 		} else {
-			debugger->backend->printf(debugger->backend, " 0x%08X = %s\n", dv->intValue, name);
+			debugger->backend->printf(debugger->backend, " 0x%08X = %s", dv->intValue, name);
 		}
+		if (offset) {
+			debugger->backend->printf(debugger->backend, "+0x%X", offset);
+		}
+		debugger->backend->printf(debugger->backend, "\n");
 	} else {
 		debugger->backend->printf(debugger->backend, "Not found.\n");
 	}
@@ -8,6 +8,7 @@
 #include <mgba/core/core.h>
 
 #include <mgba/internal/debugger/cli-debugger.h>
+#include <mgba/internal/debugger/history.h>
 #include <mgba/internal/debugger/symbols.h>
 
 #ifdef USE_GDB_STUB
@@ -75,6 +76,7 @@ void mDebuggerInit(struct mDebugger* debugger) {
 }
 
 void mDebuggerDeinit(struct mDebugger* debugger) {
+	mDebuggerDisableHistory(debugger);
 	mDebuggerModuleListDeinit(&debugger->modules);
 	TableDeinit(&debugger->pointOwner);
 }
@@ -179,6 +181,18 @@ void mDebuggerRunFrame(struct mDebugger* debugger) {
 }
 
 void mDebuggerEnter(struct mDebugger* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
+	if (debugger->history && debugger->history->replaying) {
+		// Hits while replaying from a checkpoint are only recorded, not reported
+		debugger->history->replayHit = true;
+		debugger->history->hitReason = reason;
+		if (info) {
+			debugger->history->hitInfo = *info;
+		} else {
+			memset(&debugger->history->hitInfo, 0, sizeof(debugger->history->hitInfo));
+		}
+		return;
+	}
+
 	if (debugger->platform->entered) {
 		debugger->platform->entered(debugger->platform, reason, info);
 	}
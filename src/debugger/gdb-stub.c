@@ -7,6 +7,7 @@
 
 #include <mgba/core/core.h>
 #include <mgba/internal/arm/debugger/debugger.h>
+#include <mgba/internal/debugger/history.h>
 #include <mgba/internal/arm/isa-inlines.h>
 #include <mgba/internal/gba/memory.h>
 #include <mgba-util/string.h>
@@ -63,6 +64,8 @@ static const char* TARGET_XML = "<target version=\"1.0\">"
                                 "</target>";
 
 static void _sendMessage(struct GDBStub* stub);
+static void _sendStopReply(struct GDBStub* stub, int signal, const char* reason);
+static int32_t _readPC(struct ARMCore* cpu);
 
 static void _gdbStubDeinit(struct mDebuggerModule* debugger) {
 	struct GDBStub* stub = (struct GDBStub*) debugger;
@@ -73,13 +76,16 @@ static void _gdbStubDeinit(struct mDebuggerModule* debugger) {
 
 static void _gdbStubEntered(struct mDebuggerModule* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
 	struct GDBStub* stub = (struct GDBStub*) debugger;
+	char stopReason[32];
 	switch (reason) {
 	case DEBUGGER_ENTER_MANUAL:
-		snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "S%02x", SIGINT);
-		break;
+		_sendStopReply(stub, SIGINT, "");
+		return;
 	case DEBUGGER_ENTER_BREAKPOINT:
 		if (stub->supportsHwbreak && stub->supportsSwbreak && info) {
-			snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "T%02x%cwbreak:;", SIGTRAP, info->type.bp.breakType == BREAKPOINT_SOFTWARE ? 's' : 'h');
+			snprintf(stopReason, sizeof(stopReason), "%cwbreak:;", info->type.bp.breakType == BREAKPOINT_SOFTWARE ? 's' : 'h');
+			_sendStopReply(stub, SIGTRAP, stopReason);
+			return;
 		} else {
 			snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "S%02xk", SIGTRAP);
 		}
@@ -111,14 +117,16 @@ static void _gdbStubEntered(struct mDebuggerModule* debugger, enum mDebuggerEntr
 			case WATCHPOINT_CHANGE:
 				break;
 			}
-			snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "T%02x%s:%08x;", SIGTRAP, type, info->address);
+			snprintf(stopReason, sizeof(stopReason), "%s:%08x;", type, info->address);
+			_sendStopReply(stub, SIGTRAP, stopReason);
+			return;
 		} else {
 			snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "S%02x", SIGTRAP);
 		}
 		break;
 	case DEBUGGER_ENTER_ILLEGAL_OP:
-		snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "S%02x", SIGILL);
-		break;
+		_sendStopReply(stub, SIGILL, "");
+		return;
 	case DEBUGGER_ENTER_ATTACHED:
 	case DEBUGGER_ENTER_STACK:
 		return;
@@ -147,6 +155,9 @@ static void _gdbStubUpdate(struct mDebuggerModule* debugger) {
 }
 
 static void _ack(struct GDBStub* stub) {
+	if (stub->lineAck == GDB_ACK_OFF) {
+		return;
+	}
 	char ack = '+';
 	SocketSend(stub->connection, &ack, 1);
 }
@@ -154,6 +165,9 @@ static void _ack(struct GDBStub* stub) {
 static void _nak(struct GDBStub* stub) {
 	char nak = '-';
 	mLOG(DEBUGGER, WARN, "Packet error");
+	if (stub->lineAck == GDB_ACK_OFF) {
+		return;
+	}
 	SocketSend(stub->connection, &nak, 1);
 }
 
@@ -208,34 +222,48 @@ static uint32_t _readHex(const char* in, unsigned* out) {
 	return _hex2int(in, i);
 }
 
-static void _sendMessage(struct GDBStub* stub) {
+static void _sendPacket(struct GDBStub* stub, size_t length) {
 	if (stub->lineAck != GDB_ACK_OFF) {
 		stub->lineAck = GDB_ACK_PENDING;
 	}
-	uint8_t checksum = 0;
-	int i = 1;
-	char buffer = stub->outgoing[0];
-	char swap;
+	if (length > GDB_STUB_MAX_LINE - 4) {
+		length = GDB_STUB_MAX_LINE - 4;
+	}
+	memmove(&stub->outgoing[1], stub->outgoing, length);
 	stub->outgoing[0] = '$';
-	if (buffer) {
-		for (; i < GDB_STUB_MAX_LINE - 5; ++i) {
-			checksum += buffer;
-			swap = stub->outgoing[i];
-			stub->outgoing[i] = buffer;
-			buffer = swap;
-			if (!buffer) {
-				++i;
-				break;
-			}
-		}
+	uint8_t checksum = 0;
+	size_t i;
+	for (i = 1; i <= length; ++i) {
+		checksum += stub->outgoing[i];
 	}
 	stub->outgoing[i] = '#';
 	_int2hex8(checksum, &stub->outgoing[i + 1]);
 	stub->outgoing[i + 3] = 0;
-	mLOG(DEBUGGER, DEBUG, "> %s", stub->outgoing);
+	mLOG(DEBUGGER, DEBUG, "> %.*s", (int) (i + 3), stub->outgoing);
 	SocketSend(stub->connection, stub->outgoing, i + 3);
 }
 
+static void _sendMessage(struct GDBStub* stub) {
+	_sendPacket(stub, strlen(stub->outgoing));
+}
+
+static void _sendStopReply(struct GDBStub* stub, int signal, const char* reason) {
+	// Include the registers so the client doesn't need another round trip to read them after stopping
+	struct ARMCore* cpu = stub->d.p->core->cpu;
+	size_t i = snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "T%02x%s", signal, reason);
+	int r;
+	for (r = 0; r <= ARM_PC; ++r) {
+		i += snprintf(&stub->outgoing[i], GDB_STUB_MAX_LINE - 4 - i, "%x:", r);
+		_int2hex32(r == ARM_PC ? _readPC(cpu) : cpu->gprs[r], &stub->outgoing[i]);
+		stub->outgoing[i + 8] = ';';
+		i += 9;
+	}
+	i += snprintf(&stub->outgoing[i], GDB_STUB_MAX_LINE - 4 - i, "19:");
+	_int2hex32(cpu->cpsr.packed, &stub->outgoing[i]);
+	stub->outgoing[i + 8] = ';';
+	_sendPacket(stub, i + 9);
+}
+
 static void _error(struct GDBStub* stub, enum GDBError error) {
 	snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "E%02x", error);
 	_sendMessage(stub);
@@ -256,12 +284,41 @@ static void _continue(struct GDBStub* stub, const char* message) {
 
 static void _step(struct GDBStub* stub, const char* message) {
 	stub->d.p->core->step(stub->d.p->core);
-	snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "S%02x", SIGTRAP);
-	_sendMessage(stub);
+	_sendStopReply(stub, SIGTRAP, "");
 	// TODO: parse message
 	UNUSED(message);
 }
 
+static void _reverse(struct GDBStub* stub, const char* message) {
+	struct mDebugger* debugger = stub->d.p;
+	bool ok = false;
+	switch (message[0]) {
+	case 's':
+		ok = mDebuggerReverseStep(debugger);
+		if (ok) {
+			_sendStopReply(stub, SIGTRAP, "");
+		}
+		break;
+	case 'c':
+		if (debugger->history) {
+			enum mDebuggerEntryReason reason;
+			struct mDebuggerEntryInfo info;
+			ok = mDebuggerReverseContinue(debugger, &reason, &info);
+			if (ok) {
+				_gdbStubEntered(&stub->d, reason, &info);
+			}
+		}
+		break;
+	default:
+		_error(stub, GDB_UNSUPPORTED_COMMAND);
+		return;
+	}
+	if (!ok) {
+		snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "T%02xreplaylog:begin;", SIGTRAP);
+		_sendMessage(stub);
+	}
+}
+
 static void _writeMemoryBinary(struct GDBStub* stub, const char* message) {
 	const char* readAddress = message;
 	unsigned i = 0;
@@ -272,7 +329,7 @@ static void _writeMemoryBinary(struct GDBStub* stub, const char* message) {
 	uint32_t size = _readHex(readAddress, &i);
 	readAddress += i + 1;
 
-	if (size > 512) {
+	if (size > GDB_STUB_MAX_TRANSFER) {
 		_error(stub, GDB_BAD_ARGUMENTS);
 		return;
 	}
@@ -306,7 +363,7 @@ static void _writeMemory(struct GDBStub* stub, const char* message) {
 	uint32_t size = _readHex(readAddress, &i);
 	readAddress += i + 1;
 
-	if (size > 512) {
+	if (size > GDB_STUB_MAX_TRANSFER) {
 		_error(stub, GDB_BAD_ARGUMENTS);
 		return;
 	}
@@ -327,7 +384,7 @@ static void _readMemory(struct GDBStub* stub, const char* message) {
 	uint32_t address = _readHex(readAddress, &i);
 	readAddress += i + 1;
 	uint32_t size = _readHex(readAddress, &i);
-	if (size > 512) {
+	if (size > GDB_STUB_MAX_TRANSFER) {
 		_error(stub, GDB_BAD_ARGUMENTS);
 		return;
 	}
@@ -341,6 +398,38 @@ static void _readMemory(struct GDBStub* stub, const char* message) {
 	_sendMessage(stub);
 }
 
+static void _readMemoryBinary(struct GDBStub* stub, const char* message) {
+	const char* readAddress = message;
+	unsigned i = 0;
+	uint32_t address = _readHex(readAddress, &i);
+	readAddress += i + 1;
+	uint32_t size = _readHex(readAddress, &i);
+	if (size > GDB_STUB_MAX_TRANSFER) {
+		// Escaping can double the size of the data, so a short read is expected here
+		size = GDB_STUB_MAX_TRANSFER;
+	}
+	struct ARMCore* cpu = stub->d.p->core->cpu;
+	size_t writeAddress = 0;
+	stub->outgoing[writeAddress] = 'b';
+	++writeAddress;
+	for (i = 0; i < size; ++i) {
+		uint8_t byte = cpu->memory.load8(cpu, address + i, 0);
+		switch (byte) {
+		case '#':
+		case '$':
+		case '*':
+		case '}':
+			stub->outgoing[writeAddress] = '}';
+			++writeAddress;
+			byte ^= 0x20;
+			break;
+		}
+		stub->outgoing[writeAddress] = byte;
+		++writeAddress;
+	}
+	_sendPacket(stub, writeAddress);
+}
+
 static void _writeGPRs(struct GDBStub* stub, const char* message) {
 	struct ARMCore* cpu = stub->d.p->core->cpu;
 	const char* readAddress = message;
@@ -469,7 +558,10 @@ static void _processQSupportedCommand(struct GDBStub* stub, const char* message)
 		}
 		message = end + 1;
 	}
-	strncpy(stub->outgoing, "swbreak+;hwbreak+;qXfer:features:read+;qXfer:memory-map:read+;QStartNoAckMode+", GDB_STUB_MAX_LINE - 4);
+	if (!stub->d.p->history) {
+		mDebuggerEnableHistory(stub->d.p, 0, GDB_HISTORY_CHECKPOINTS);
+	}
+	snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "PacketSize=%x;swbreak+;hwbreak+;qXfer:features:read+;qXfer:memory-map:read+;QStartNoAckMode+;ReverseStep+;ReverseContinue+;binary-upload+", GDB_STUB_MAX_LINE - 8);
 }
 
 static void _processQXferCommand(struct GDBStub* stub, const char* params, const char* data) {
@@ -663,6 +755,11 @@ static void _clearBreakpoint(struct GDBStub* stub, const char* message) {
 	_sendMessage(stub);
 }
 
+static bool _isPacketComplete(const char* message, size_t length) {
+	const char* terminator = memchr(message, '#', length);
+	return terminator && terminator + 3 <= message + length;
+}
+
 size_t _parseGDBMessage(struct GDBStub* stub, const char* message) {
 	uint8_t checksum = 0;
 	int parsed = 1;
@@ -671,10 +768,15 @@ size_t _parseGDBMessage(struct GDBStub* stub, const char* message) {
 	};
 	switch (*message) {
 	case '+':
-		stub->lineAck = GDB_ACK_RECEIVED;
+		// The reply to QStartNoAckMode is still acknowledged, so don't let that turn acks back on
+		if (stub->lineAck != GDB_ACK_OFF) {
+			stub->lineAck = GDB_ACK_RECEIVED;
+		}
 		return parsed;
 	case '-':
-		stub->lineAck = GDB_NAK_RECEIVED;
+		if (stub->lineAck != GDB_ACK_OFF) {
+			stub->lineAck = GDB_NAK_RECEIVED;
+		}
 		return parsed;
 	case '$':
 		++message;
@@ -719,8 +821,10 @@ size_t _parseGDBMessage(struct GDBStub* stub, const char* message) {
 	++message;
 	switch (messageType) {
 	case '?':
-		snprintf(stub->outgoing, GDB_STUB_MAX_LINE - 4, "S%02x", SIGINT);
-		_sendMessage(stub);
+		_sendStopReply(stub, SIGINT, "");
+		break;
+	case 'b':
+		_reverse(stub, message);
 		break;
 	case 'c':
 		_continue(stub, message);
@@ -767,6 +871,9 @@ size_t _parseGDBMessage(struct GDBStub* stub, const char* message) {
 	case 'X':
 		_writeMemoryBinary(stub, message);
 		break;
+	case 'x':
+		_readMemoryBinary(stub, message);
+		break;
 	case 'Z':
 		_setBreakpoint(stub, message);
 		break;
@@ -793,6 +900,7 @@ void GDBStubCreate(struct GDBStub* stub) {
 	stub->d.type = DEBUGGER_GDB;
 	stub->untilPoll = GDB_STUB_INTERVAL;
 	stub->lineAck = GDB_ACK_PENDING;
+	stub->lineLength = 0;
 }
 
 bool GDBStubListen(struct GDBStub* stub, int port, const struct Address* bindAddress, enum GDBWatchpointsBehvaior watchpointsBehavior) {
@@ -829,6 +937,7 @@ void GDBStubHangup(struct GDBStub* stub) {
 		SocketClose(stub->connection);
 		stub->connection = INVALID_SOCKET;
 	}
+	stub->lineLength = 0;
 	stub->d.needsCallback = false;
 	stub->d.isPaused = false;
 	mDebuggerUpdatePaused(stub->d.p);
@@ -872,7 +981,7 @@ bool GDBStubUpdate(struct GDBStub* stub, int32_t timeoutMs) {
 		Socket reads = stub->connection;
 		SocketPoll(1, &reads, 0, 0, timeoutMs);
 	}
-	ssize_t messageLen = SocketRecv(stub->connection, stub->line, GDB_STUB_MAX_LINE - 1);
+	ssize_t messageLen = SocketRecv(stub->connection, &stub->line[stub->lineLength], GDB_STUB_MAX_LINE - 1 - stub->lineLength);
 	if (messageLen == 0) {
 		goto connectionLost;
 	}
@@ -883,10 +992,23 @@ bool GDBStubUpdate(struct GDBStub* stub, int32_t timeoutMs) {
 		goto connectionLost;
 	}
 
+	messageLen += stub->lineLength;
+	stub->lineLength = 0;
 	stub->line[messageLen] = '\0';
 	mLOG(DEBUGGER, DEBUG, "< %s", stub->line);
 	ssize_t position = 0;
 	while (position < messageLen) {
+		if (stub->line[position] == '$' && !_isPacketComplete(&stub->line[position], messageLen - position)) {
+			// Large packets can be split across receives, so keep this one until the rest arrives
+			stub->lineLength = messageLen - position;
+			if (stub->lineLength >= GDB_STUB_MAX_LINE - 1) {
+				stub->lineLength = 0;
+				_nak(stub);
+			} else {
+				memmove(stub->line, &stub->line[position], stub->lineLength);
+			}
+			break;
+		}
 		position += _parseGDBMessage(stub, &stub->line[position]);
 	}
 	return true;
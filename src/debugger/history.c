@@ -0,0 +1,220 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/debugger/history.h>
+
+#include <mgba/core/core.h>
+#include <mgba/core/timing.h>
+
+DEFINE_VECTOR(mDebuggerCheckpointList, struct mDebuggerCheckpoint);
+
+static void _historyInit(struct mDebuggerModule* debugger) {
+	debugger->p->history = (struct mDebuggerHistory*) debugger;
+	mDebuggerModuleSetNeedsCallback(debugger);
+}
+
+static void _historyDeinit(struct mDebuggerModule* debugger) {
+	if (debugger->p->history == (struct mDebuggerHistory*) debugger) {
+		debugger->p->history = NULL;
+	}
+}
+
+static void _historyEntered(struct mDebuggerModule* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
+	UNUSED(reason);
+	UNUSED(info);
+	debugger->isPaused = false;
+}
+
+static void _dropCheckpoints(struct mDebuggerHistory* history, size_t start, size_t count) {
+	size_t i;
+	for (i = start; i < start + count; ++i) {
+		free(mDebuggerCheckpointListGetPointer(&history->checkpoints, i)->state);
+	}
+	mDebuggerCheckpointListShift(&history->checkpoints, start, count);
+}
+
+static void _historyCallback(struct mDebuggerModule* debugger) {
+	struct mDebuggerHistory* history = (struct mDebuggerHistory*) debugger;
+	struct mCore* core = debugger->p->core;
+	if (history->replaying) {
+		return;
+	}
+	uint64_t now = mTimingGlobalTime(core->timing);
+	size_t size = mDebuggerCheckpointListSize(&history->checkpoints);
+	if (size) {
+		uint64_t last = mDebuggerCheckpointListGetPointer(&history->checkpoints, size - 1)->time;
+		if (now < last) {
+			// Time went backwards, e.g. because a savestate was loaded
+			_dropCheckpoints(history, 0, size);
+			size = 0;
+		} else if (now - last < history->interval) {
+			return;
+		}
+	}
+	if (size >= history->maxCheckpoints) {
+		_dropCheckpoints(history, 0, size - history->maxCheckpoints + 1);
+	}
+
+	void* state = malloc(history->stateSize);
+	if (!core->saveState(core, state)) {
+		free(state);
+		return;
+	}
+	struct mDebuggerCheckpoint* checkpoint = mDebuggerCheckpointListAppend(&history->checkpoints);
+	checkpoint->time = now;
+	checkpoint->state = state;
+}
+
+void mDebuggerEnableHistory(struct mDebugger* debugger, uint64_t interval, size_t maxCheckpoints) {
+	if (!interval) {
+		interval = debugger->core->frameCycles(debugger->core);
+	}
+	if (!maxCheckpoints) {
+		maxCheckpoints = 1;
+	}
+	struct mDebuggerHistory* history = debugger->history;
+	if (history) {
+		history->interval = interval;
+		history->maxCheckpoints = maxCheckpoints;
+		size_t size = mDebuggerCheckpointListSize(&history->checkpoints);
+		if (size > maxCheckpoints) {
+			_dropCheckpoints(history, 0, size - maxCheckpoints);
+		}
+		return;
+	}
+
+	history = calloc(1, sizeof(*history));
+	history->d.type = DEBUGGER_CUSTOM;
+	history->d.init = _historyInit;
+	history->d.deinit = _historyDeinit;
+	history->d.entered = _historyEntered;
+	history->d.custom = _historyCallback;
+	history->stateSize = debugger->core->stateSize(debugger->core);
+	history->interval = interval;
+	history->maxCheckpoints = maxCheckpoints;
+	mDebuggerCheckpointListInit(&history->checkpoints, maxCheckpoints);
+	debugger->history = history;
+	mDebuggerAttachModule(debugger, &history->d);
+}
+
+void mDebuggerDisableHistory(struct mDebugger* debugger) {
+	struct mDebuggerHistory* history = debugger->history;
+	if (!history) {
+		return;
+	}
+	mDebuggerDetachModule(debugger, &history->d);
+	debugger->history = NULL;
+	_dropCheckpoints(history, 0, mDebuggerCheckpointListSize(&history->checkpoints));
+	mDebuggerCheckpointListDeinit(&history->checkpoints);
+	free(history);
+	mDebuggerUpdatePaused(debugger);
+}
+
+static ssize_t _findCheckpoint(struct mDebuggerHistory* history, uint64_t target) {
+	ssize_t i;
+	for (i = mDebuggerCheckpointListSize(&history->checkpoints) - 1; i >= 0; --i) {
+		if (mDebuggerCheckpointListGetPointer(&history->checkpoints, i)->time < target) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void _restore(struct mDebuggerHistory* history, size_t index) {
+	struct mCore* core = history->d.p->core;
+	core->loadState(core, mDebuggerCheckpointListGetPointer(&history->checkpoints, index)->state);
+}
+
+static void _finishReplay(struct mDebuggerHistory* history, size_t checkpoint) {
+	// Anything recorded after where we ended up is in the future now
+	size_t size = mDebuggerCheckpointListSize(&history->checkpoints);
+	if (checkpoint + 1 < size) {
+		_dropCheckpoints(history, checkpoint + 1, size - checkpoint - 1);
+	}
+	history->replaying = false;
+}
+
+bool mDebuggerReverseStep(struct mDebugger* debugger) {
+	struct mDebuggerHistory* history = debugger->history;
+	if (!history) {
+		return false;
+	}
+	struct mCore* core = debugger->core;
+	uint64_t target = mTimingGlobalTime(core->timing);
+	ssize_t checkpoint = _findCheckpoint(history, target);
+	if (checkpoint < 0) {
+		return false;
+	}
+
+	// Count the instructions between the checkpoint and now, then replay all but the last one
+	history->replaying = true;
+	_restore(history, checkpoint);
+	size_t steps = 0;
+	while (mTimingGlobalTime(core->timing) < target) {
+		core->step(core);
+		++steps;
+	}
+	_restore(history, checkpoint);
+	for (; steps > 1; --steps) {
+		core->step(core);
+	}
+	_finishReplay(history, checkpoint);
+	return true;
+}
+
+bool mDebuggerReverseContinue(struct mDebugger* debugger, enum mDebuggerEntryReason* reason, struct mDebuggerEntryInfo* info) {
+	struct mDebuggerHistory* history = debugger->history;
+	if (!history) {
+		return false;
+	}
+	struct mCore* core = debugger->core;
+	uint64_t target = mTimingGlobalTime(core->timing);
+	ssize_t checkpoint = _findCheckpoint(history, target);
+	if (checkpoint < 0) {
+		return false;
+	}
+
+	history->replaying = true;
+	for (; checkpoint >= 0; --checkpoint) {
+		// Replay each segment looking for the last breakpoint or watchpoint hit before the target
+		uint64_t end = target;
+		if ((size_t) checkpoint + 1 < mDebuggerCheckpointListSize(&history->checkpoints)) {
+			end = mDebuggerCheckpointListGetPointer(&history->checkpoints, checkpoint + 1)->time;
+			if (end > target) {
+				end = target;
+			}
+		}
+		_restore(history, checkpoint);
+		size_t steps = 0;
+		size_t lastHit = 0;
+		bool found = false;
+		while (mTimingGlobalTime(core->timing) < end) {
+			history->replayHit = false;
+			core->step(core);
+			debugger->platform->checkBreakpoints(debugger->platform);
+			++steps;
+			if (history->replayHit && mTimingGlobalTime(core->timing) < target) {
+				lastHit = steps;
+				found = true;
+				*reason = history->hitReason;
+				*info = history->hitInfo;
+			}
+		}
+		if (!found) {
+			continue;
+		}
+		_restore(history, checkpoint);
+		for (; lastHit; --lastHit) {
+			core->step(core);
+		}
+		_finishReplay(history, checkpoint);
+		return true;
+	}
+
+	// Nothing was hit, so stop at the beginning of recorded history
+	_restore(history, 0);
+	_finishReplay(history, 0);
+	return false;
+}
@@ -7,9 +7,17 @@
 
 #include <mgba/core/core.h>
 #include <mgba/debugger/debugger.h>
+#include <mgba/internal/debugger/symbols.h>
 #include <mgba-util/string.h>
 
+#ifdef ENABLE_SCRIPTING
+#include <mgba/core/scripting.h>
+#endif
+
+#define PARSE_PROGRAM_MAX_DEPTH 32
+
 DEFINE_VECTOR(LexVector, struct Token);
+DEFINE_VECTOR(ParseInstructionList, struct ParseInstruction);
 
 enum LexState {
 	LEX_ERROR = -1,
@@ -774,6 +782,33 @@ static bool _performOperation(struct mDebugger* debugger, enum Operation operati
 	return true;
 }
 
+static bool _isBinaryOperation(enum Operation operation) {
+	switch (operation) {
+	case OP_ASSIGN:
+	case OP_ADD:
+	case OP_SUBTRACT:
+	case OP_MULTIPLY:
+	case OP_DIVIDE:
+	case OP_MODULO:
+	case OP_AND:
+	case OP_OR:
+	case OP_XOR:
+	case OP_LESS:
+	case OP_GREATER:
+	case OP_EQUAL:
+	case OP_NOT_EQUAL:
+	case OP_LOGICAL_AND:
+	case OP_LOGICAL_OR:
+	case OP_LE:
+	case OP_GE:
+	case OP_SHIFT_L:
+	case OP_SHIFT_R:
+		return true;
+	default:
+		return false;
+	}
+}
+
 bool mDebuggerEvaluateParseTree(struct mDebugger* debugger, struct ParseTree* tree, int32_t* value, int* segment) {
 	if (!value) {
 		return false;
@@ -796,32 +831,7 @@ bool mDebuggerEvaluateParseTree(struct mDebugger* debugger, struct ParseTree* tr
 			nextBranch = 0;
 			break;
 		case TOKEN_OPERATOR_TYPE:
-			switch (tree->token.operatorValue) {
-			case OP_ASSIGN:
-			case OP_ADD:
-			case OP_SUBTRACT:
-			case OP_MULTIPLY:
-			case OP_DIVIDE:
-			case OP_MODULO:
-			case OP_AND:
-			case OP_OR:
-			case OP_XOR:
-			case OP_LESS:
-			case OP_GREATER:
-			case OP_EQUAL:
-			case OP_NOT_EQUAL:
-			case OP_LOGICAL_AND:
-			case OP_LOGICAL_OR:
-			case OP_LE:
-			case OP_GE:
-			case OP_SHIFT_L:
-			case OP_SHIFT_R:
-				nextBranch = 0;
-				break;
-			default:
-				nextBranch = 1;
-				break;
-			}
+			nextBranch = _isBinaryOperation(tree->token.operatorValue) ? 0 : 1;
 			break;
 		case TOKEN_IDENTIFIER_TYPE:
 			if (!mDebuggerLookupIdentifier(debugger, tree->token.identifierValue, &tmpVal, &tmpSegment)) {
@@ -900,3 +910,157 @@ bool mDebuggerEvaluateParseTree(struct mDebugger* debugger, struct ParseTree* tr
 	}
 	return ok;
 }
+
+static void _compileIdentifier(struct mDebugger* debugger, const char* name, struct ParseInstruction* insn) {
+	// Anything that can't be pinned down now is looked up by name when evaluated, same as the tree
+	insn->type = PARSE_INSN_LOOKUP;
+	insn->identifier = strdup(name);
+	if (!debugger) {
+		return;
+	}
+	int32_t value;
+#ifdef ENABLE_SCRIPTING
+	if (debugger->bridge && mScriptBridgeLookupSymbol(debugger->bridge, name, &value)) {
+		return;
+	}
+#endif
+	insn->segment = -1;
+	if (debugger->core->symbolTable && mDebuggerSymbolLookup(debugger->core->symbolTable, name, &insn->value, &insn->segment)) {
+		insn->type = PARSE_INSN_CONSTANT;
+		return;
+	}
+	if (debugger->core->lookupIdentifier(debugger->core, name, &insn->value, &insn->segment)) {
+		insn->type = PARSE_INSN_CONSTANT;
+		return;
+	}
+	if (debugger->platform && debugger->core->readRegister(debugger->core, name, &value)) {
+		insn->type = PARSE_INSN_REGISTER;
+	}
+}
+
+static struct ParseInstruction* _appendInstruction(struct ParseProgram* program, enum ParseInstructionType type) {
+	struct ParseInstruction* insn = ParseInstructionListAppend(&program->instructions);
+	memset(insn, 0, sizeof(*insn));
+	insn->type = type;
+	insn->segment = -1;
+	return insn;
+}
+
+// Emits code that leaves the value of the tree in the accumulator. Operands are saved on the
+// stack in the same order the tree walker saves them, so the results match it exactly.
+static bool _compileTree(struct mDebugger* debugger, const struct ParseTree* tree, struct ParseProgram* program, int depth) {
+	if (!tree || depth >= PARSE_PROGRAM_MAX_DEPTH) {
+		return false;
+	}
+	struct ParseInstruction* insn;
+	switch (tree->token.type) {
+	case TOKEN_UINT_TYPE:
+		insn = _appendInstruction(program, PARSE_INSN_CONSTANT);
+		insn->value = tree->token.uintValue;
+		return true;
+	case TOKEN_IDENTIFIER_TYPE:
+		insn = _appendInstruction(program, PARSE_INSN_LOOKUP);
+		_compileIdentifier(debugger, tree->token.identifierValue, insn);
+		return insn->identifier != NULL;
+	case TOKEN_SEGMENT_TYPE:
+		if (!_compileTree(debugger, tree->lhs, program, depth)) {
+			return false;
+		}
+		_appendInstruction(program, PARSE_INSN_PUSH);
+		if (!_compileTree(debugger, tree->rhs, program, depth + 1)) {
+			return false;
+		}
+		_appendInstruction(program, PARSE_INSN_SEGMENT);
+		return true;
+	case TOKEN_OPERATOR_TYPE:
+		// Unary operators still take a left-hand value, which is whatever was evaluated last
+		if (_isBinaryOperation(tree->token.operatorValue) && !_compileTree(debugger, tree->lhs, program, depth)) {
+			return false;
+		}
+		_appendInstruction(program, PARSE_INSN_PUSH);
+		if (!_compileTree(debugger, tree->rhs, program, depth + 1)) {
+			return false;
+		}
+		insn = _appendInstruction(program, PARSE_INSN_OPERATION);
+		insn->operation = tree->token.operatorValue;
+		return true;
+	default:
+		return false;
+	}
+}
+
+struct ParseProgram* mDebuggerCompileParseTree(struct mDebugger* debugger, const struct ParseTree* tree) {
+	struct ParseProgram* program = malloc(sizeof(*program));
+	ParseInstructionListInit(&program->instructions, 0);
+	if (!_compileTree(debugger, tree, program, 0)) {
+		parseProgramFree(program);
+		return NULL;
+	}
+	return program;
+}
+
+void parseProgramFree(struct ParseProgram* program) {
+	if (!program) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < ParseInstructionListSize(&program->instructions); ++i) {
+		free(ParseInstructionListGetPointer(&program->instructions, i)->identifier);
+	}
+	ParseInstructionListDeinit(&program->instructions);
+	free(program);
+}
+
+bool mDebuggerEvaluateParseProgram(struct mDebugger* debugger, const struct ParseProgram* program, int32_t* value, int* segment) {
+	if (!value) {
+		return false;
+	}
+	int32_t values[PARSE_PROGRAM_MAX_DEPTH];
+	int segments[PARSE_PROGRAM_MAX_DEPTH];
+	size_t depth = 0;
+	int32_t tmpVal = 0;
+	int tmpSegment = -1;
+
+	size_t i;
+	for (i = 0; i < ParseInstructionListSize(&program->instructions); ++i) {
+		const struct ParseInstruction* insn = ParseInstructionListGetConstPointer(&program->instructions, i);
+		switch (insn->type) {
+		case PARSE_INSN_CONSTANT:
+			tmpVal = insn->value;
+			tmpSegment = insn->segment;
+			break;
+		case PARSE_INSN_REGISTER:
+			if (!debugger->core->readRegister(debugger->core, insn->identifier, &tmpVal)) {
+				return false;
+			}
+			tmpSegment = -1;
+			break;
+		case PARSE_INSN_LOOKUP:
+			if (!mDebuggerLookupIdentifier(debugger, insn->identifier, &tmpVal, &tmpSegment)) {
+				return false;
+			}
+			break;
+		case PARSE_INSN_PUSH:
+			values[depth] = tmpVal;
+			segments[depth] = tmpSegment;
+			++depth;
+			break;
+		case PARSE_INSN_OPERATION:
+			--depth;
+			tmpSegment = segments[depth];
+			if (!_performOperation(debugger, insn->operation, values[depth], tmpVal, &tmpVal, &tmpSegment)) {
+				return false;
+			}
+			break;
+		case PARSE_INSN_SEGMENT:
+			--depth;
+			tmpSegment = values[depth];
+			break;
+		}
+	}
+	*value = tmpVal;
+	if (segment) {
+		*segment = tmpSegment;
+	}
+	return true;
+}
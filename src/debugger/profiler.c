@@ -0,0 +1,207 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/debugger/profiler.h>
+
+#include <mgba/core/core.h>
+#include <mgba/debugger/debugger.h>
+#include <mgba/internal/debugger/stack-trace.h>
+#include <mgba/internal/debugger/symbols.h>
+#include <mgba-util/string.h>
+#include <mgba-util/vfs.h>
+
+#define NAME_LENGTH 64
+
+static void _sample(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	struct mDebuggerProfiler* profiler = context;
+	struct mCore* core = profiler->core;
+	struct mDebuggerProfilerLocation stack[mDEBUGGER_PROFILER_MAX_DEPTH];
+	size_t depth = 0;
+
+	struct mDebugger* debugger = core->debugger;
+	if (debugger && debugger->platform && debugger->platform->getStackTraceMode &&
+	    debugger->platform->getStackTraceMode(debugger->platform) != STACK_TRACE_DISABLED) {
+		size_t frames = mStackTraceGetDepth(&debugger->stackTrace);
+		size_t i = 0;
+		// Keep the innermost frames of a stack that's too deep, as they're where the time goes
+		if (frames > mDEBUGGER_PROFILER_MAX_DEPTH - 1) {
+			i = frames - (mDEBUGGER_PROFILER_MAX_DEPTH - 1);
+		}
+		for (; i < frames; ++i) {
+			const struct mStackFrame* frame = mStackFramesGetConstPointer(&debugger->stackTrace.stack, i);
+			stack[depth].address = frame->entryAddress;
+			stack[depth].segment = frame->entrySegment;
+			++depth;
+		}
+	}
+
+	int segment;
+	core->currentPC(core, &stack[depth].address, &segment);
+	stack[depth].segment = segment;
+	++depth;
+	mDebuggerProfilerAddSample(profiler, stack, depth);
+
+	int32_t next = profiler->interval - (int32_t) cyclesLate;
+	if (next < 1) {
+		next = 1;
+	}
+	mTimingSchedule(timing, &profiler->event, next);
+}
+
+void mDebuggerProfilerInit(struct mDebuggerProfiler* profiler, struct mCore* core) {
+	memset(profiler, 0, sizeof(*profiler));
+	profiler->core = core;
+	profiler->interval = mDEBUGGER_PROFILER_DEFAULT_INTERVAL;
+	profiler->event.context = profiler;
+	profiler->event.name = "Profiler";
+	profiler->event.callback = _sample;
+	profiler->event.priority = 0x90;
+	HashTableInit(&profiler->stacks, 0, free);
+}
+
+void mDebuggerProfilerDeinit(struct mDebuggerProfiler* profiler) {
+	mDebuggerProfilerStop(profiler);
+	HashTableDeinit(&profiler->stacks);
+}
+
+bool mDebuggerProfilerStart(struct mDebuggerProfiler* profiler, int32_t interval) {
+	struct mCore* core = profiler->core;
+	if (!core || !core->currentPC || interval <= 0) {
+		return false;
+	}
+	profiler->interval = interval;
+	profiler->running = true;
+	mTimingDeschedule(core->timing, &profiler->event);
+	mTimingSchedule(core->timing, &profiler->event, interval);
+	return true;
+}
+
+void mDebuggerProfilerStop(struct mDebuggerProfiler* profiler) {
+	if (!profiler->running) {
+		return;
+	}
+	profiler->running = false;
+	mTimingDeschedule(profiler->core->timing, &profiler->event);
+}
+
+void mDebuggerProfilerUpdate(struct mDebuggerProfiler* profiler) {
+	if (!profiler->running || mTimingIsScheduled(profiler->core->timing, &profiler->event)) {
+		return;
+	}
+	mTimingSchedule(profiler->core->timing, &profiler->event, profiler->interval);
+}
+
+void mDebuggerProfilerClear(struct mDebuggerProfiler* profiler) {
+	HashTableClear(&profiler->stacks);
+	profiler->samples = 0;
+}
+
+void mDebuggerProfilerAddSample(struct mDebuggerProfiler* profiler, const struct mDebuggerProfilerLocation* stack, size_t depth) {
+	if (!depth) {
+		return;
+	}
+	size_t keylen = depth * sizeof(*stack);
+	uint64_t* count = HashTableLookupBinary(&profiler->stacks, stack, keylen);
+	if (!count) {
+		count = calloc(1, sizeof(*count));
+		HashTableInsertBinary(&profiler->stacks, stack, keylen, count);
+	}
+	++*count;
+	++profiler->samples;
+}
+
+static void _formatLocation(const struct mDebuggerSymbols* symbols, const struct mDebuggerProfilerLocation* location, char* out, size_t size) {
+	const char* name = NULL;
+	if (symbols) {
+		uint32_t offset;
+		name = mDebuggerSymbolReverseLookupNearest(symbols, location->address, location->segment, &offset);
+	}
+	if (name) {
+		strlcpy(out, name, size);
+	} else if (location->segment >= 0) {
+		snprintf(out, size, "%02X:%04X", location->segment, location->address);
+	} else {
+		snprintf(out, size, "0x%08X", location->address);
+	}
+}
+
+bool mDebuggerProfilerWriteFolded(const struct mDebuggerProfiler* profiler, const struct mDebuggerSymbols* symbols, struct VFile* vf) {
+	char line[(NAME_LENGTH + 1) * mDEBUGGER_PROFILER_MAX_DEPTH + 24];
+	struct TableIterator iter;
+	if (!HashTableIteratorStart(&profiler->stacks, &iter)) {
+		return true;
+	}
+	do {
+		const struct mDebuggerProfilerLocation* stack = HashTableIteratorGetBinaryKey(&profiler->stacks, &iter);
+		size_t depth = HashTableIteratorGetBinaryKeyLen(&profiler->stacks, &iter) / sizeof(*stack);
+		const uint64_t* count = HashTableIteratorGetValue(&profiler->stacks, &iter);
+		size_t length = 0;
+		size_t i;
+		for (i = 0; i < depth; ++i) {
+			if (i) {
+				line[length] = ';';
+				++length;
+			}
+			_formatLocation(symbols, &stack[i], &line[length], NAME_LENGTH);
+			length += strlen(&line[length]);
+		}
+		length += snprintf(&line[length], sizeof(line) - length, " %" PRIu64 "\n", *count);
+		if (vf->write(vf, line, length) != (ssize_t) length) {
+			return false;
+		}
+	} while (HashTableIteratorNext(&profiler->stacks, &iter));
+	return true;
+}
+
+static int _compareEntries(const void* a, const void* b) {
+	const struct mDebuggerProfilerEntry* entryA = a;
+	const struct mDebuggerProfilerEntry* entryB = b;
+	if (entryA->samples != entryB->samples) {
+		return entryA->samples > entryB->samples ? -1 : 1;
+	}
+	return strcmp(entryA->name, entryB->name);
+}
+
+size_t mDebuggerProfilerSummarize(const struct mDebuggerProfiler* profiler, const struct mDebuggerSymbols* symbols, struct mDebuggerProfilerEntry* entries, size_t max) {
+	// Different addresses in one function all count towards it, so merge by name first
+	struct Table functions;
+	HashTableInit(&functions, 0, free);
+	struct TableIterator iter;
+	if (HashTableIteratorStart(&profiler->stacks, &iter)) {
+		do {
+			const struct mDebuggerProfilerLocation* stack = HashTableIteratorGetBinaryKey(&profiler->stacks, &iter);
+			size_t depth = HashTableIteratorGetBinaryKeyLen(&profiler->stacks, &iter) / sizeof(*stack);
+			const uint64_t* count = HashTableIteratorGetValue(&profiler->stacks, &iter);
+			char name[NAME_LENGTH];
+			_formatLocation(symbols, &stack[depth - 1], name, sizeof(name));
+			uint64_t* total = HashTableLookup(&functions, name);
+			if (!total) {
+				total = calloc(1, sizeof(*total));
+				HashTableInsert(&functions, name, total);
+			}
+			*total += *count;
+		} while (HashTableIteratorNext(&profiler->stacks, &iter));
+	}
+
+	size_t nFunctions = HashTableSize(&functions);
+	struct mDebuggerProfilerEntry* sorted = calloc(nFunctions ? nFunctions : 1, sizeof(*sorted));
+	size_t i = 0;
+	if (HashTableIteratorStart(&functions, &iter)) {
+		do {
+			strlcpy(sorted[i].name, HashTableIteratorGetKey(&functions, &iter), sizeof(sorted[i].name));
+			sorted[i].samples = *(uint64_t*) HashTableIteratorGetValue(&functions, &iter);
+			++i;
+		} while (HashTableIteratorNext(&functions, &iter));
+	}
+	HashTableDeinit(&functions);
+
+	qsort(sorted, nFunctions, sizeof(*sorted), _compareEntries);
+	if (max > nFunctions) {
+		max = nFunctions;
+	}
+	memcpy(entries, sorted, max * sizeof(*entries));
+	free(sorted);
+	return max;
+}
@@ -0,0 +1,321 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/debugger/run-until.h>
+
+#include <mgba/core/core.h>
+#include <mgba/internal/debugger/parser.h>
+
+DEFINE_VECTOR(mDebuggerRunUntilPointList, struct mDebuggerRunUntilPoint);
+
+static const struct {
+	const char* name;
+	int width;
+} _inputRegisters[] = {
+	{ "KEYINPUT", 2 },
+	{ "JOYP", 1 },
+};
+
+static struct ParseTree* _parseExpression(const char* expression) {
+	struct LexVector lv;
+	LexVectorInit(&lv, 0);
+	bool error = false;
+	// The lexer stops at spaces, so lex each word on its own like the CLI does with its arguments
+	while (true) {
+		expression += strspn(expression, " \t");
+		if (!expression[0]) {
+			break;
+		}
+		size_t length = strcspn(expression, " \t");
+		size_t adjusted = lexExpression(&lv, expression, length, NULL);
+		if (!adjusted || adjusted > length) {
+			error = true;
+		}
+		expression += length;
+	}
+	struct ParseTree* tree = NULL;
+	if (!error && LexVectorSize(&lv)) {
+		tree = parseTreeCreate();
+		if (!parseLexedExpression(tree, &lv)) {
+			parseFree(tree);
+			tree = NULL;
+		}
+	}
+	lexFree(&lv);
+	LexVectorClear(&lv);
+	LexVectorDeinit(&lv);
+	return tree;
+}
+
+static bool _expressionHolds(struct mDebuggerRunUntil* runUntil, const struct mDebuggerRunUntilPoint* point) {
+	if (!point->expression) {
+		return true;
+	}
+	int32_t value;
+	int segment;
+	bool ok;
+	if (point->program) {
+		ok = mDebuggerEvaluateParseProgram(runUntil->d.p, point->program, &value, &segment);
+	} else {
+		ok = mDebuggerEvaluateParseTree(runUntil->d.p, point->expression, &value, &segment);
+	}
+	return ok && (value || segment >= 0);
+}
+
+static void _setHit(struct mDebuggerRunUntil* runUntil, size_t index) {
+	if (runUntil->hit < 0 && _expressionHolds(runUntil, mDebuggerRunUntilPointListGetPointer(&runUntil->points, index))) {
+		runUntil->hit = index;
+	}
+}
+
+static uint32_t _readValue(struct mCore* core, const struct mDebuggerRunUntilCondition* condition) {
+	switch (condition->width) {
+	case 1:
+		return core->rawRead8(core, condition->address, condition->segment);
+	case 2:
+		return core->rawRead16(core, condition->address, condition->segment);
+	case 4:
+		return core->rawRead32(core, condition->address, condition->segment);
+	}
+	return 0;
+}
+
+static void _checkMemory(struct mDebuggerRunUntil* runUntil, struct mCore* core) {
+	size_t i;
+	for (i = 0; i < mDebuggerRunUntilPointListSize(&runUntil->points); ++i) {
+		const struct mDebuggerRunUntilCondition* condition = &runUntil->conditions[i];
+		struct mDebuggerRunUntilPoint* point = mDebuggerRunUntilPointListGetPointer(&runUntil->points, i);
+		uint32_t value;
+		switch (condition->type) {
+		case RUN_UNTIL_MEMORY_EQUALS:
+			if (_readValue(core, condition) == condition->value) {
+				_setHit(runUntil, i);
+			}
+			break;
+		case RUN_UNTIL_MEMORY_CHANGES:
+			value = _readValue(core, condition);
+			if (value != point->lastValue) {
+				point->lastValue = value;
+				_setHit(runUntil, i);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void _checkFrames(struct mDebuggerRunUntil* runUntil, uint32_t frames) {
+	size_t i;
+	for (i = 0; i < mDebuggerRunUntilPointListSize(&runUntil->points); ++i) {
+		const struct mDebuggerRunUntilCondition* condition = &runUntil->conditions[i];
+		if (condition->type == RUN_UNTIL_FRAMES && frames >= condition->value) {
+			_setHit(runUntil, i);
+		}
+	}
+}
+
+static void _entered(struct mDebuggerModule* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
+	struct mDebuggerRunUntil* runUntil = (struct mDebuggerRunUntil*) debugger;
+	debugger->isPaused = false;
+	if (!info || !runUntil->conditions) {
+		return;
+	}
+	if (reason != DEBUGGER_ENTER_BREAKPOINT && reason != DEBUGGER_ENTER_WATCHPOINT) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < mDebuggerRunUntilPointListSize(&runUntil->points); ++i) {
+		ssize_t id = mDebuggerRunUntilPointListGetPointer(&runUntil->points, i)->id;
+		if (id < 0 || id != info->pointId) {
+			continue;
+		}
+		switch (runUntil->conditions[i].type) {
+		case RUN_UNTIL_MEMORY_EQUALS:
+		case RUN_UNTIL_MEMORY_CHANGES:
+			// Watchpoints fire before the store lands, so look at the value once the run loop exits
+			runUntil->memoryDirty = true;
+			break;
+		case RUN_UNTIL_PC:
+			// The platform already checked the breakpoint's condition
+			if (runUntil->hit < 0) {
+				runUntil->hit = i;
+			}
+			break;
+		case RUN_UNTIL_INPUT_POLL:
+			_setHit(runUntil, i);
+			break;
+		case RUN_UNTIL_FRAMES:
+			break;
+		}
+	}
+}
+
+static void _scheduleTimeout(struct mDebuggerRunUntil* runUntil, struct mTiming* timing, int32_t cyclesLate) {
+	int32_t when = runUntil->cyclesLeft > INT32_MAX ? INT32_MAX : (int32_t) runUntil->cyclesLeft;
+	runUntil->cyclesLeft -= when;
+	when -= cyclesLate;
+	mTimingSchedule(timing, &runUntil->timeout, when > 0 ? when : 0);
+}
+
+static void _timeout(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	struct mDebuggerRunUntil* runUntil = context;
+	if (runUntil->cyclesLeft) {
+		_scheduleTimeout(runUntil, timing, cyclesLate);
+		return;
+	}
+	runUntil->timedOut = true;
+}
+
+static bool _addPoint(struct mDebuggerRunUntil* runUntil, const struct mDebuggerRunUntilCondition* condition) {
+	struct mDebugger* debugger = runUntil->d.p;
+	struct mCore* core = debugger->core;
+	struct mDebuggerRunUntilPoint* point = mDebuggerRunUntilPointListAppend(&runUntil->points);
+	memset(point, 0, sizeof(*point));
+	point->id = -1;
+
+	struct ParseTree* expression = NULL;
+	if (condition->expression) {
+		expression = _parseExpression(condition->expression);
+		if (!expression) {
+			return false;
+		}
+	}
+
+	struct mWatchpoint watchpoint = {
+		.segment = condition->segment,
+		.minAddress = condition->address,
+		.maxAddress = condition->address + condition->width,
+		.type = WATCHPOINT_WRITE,
+	};
+	size_t i;
+	switch (condition->type) {
+	case RUN_UNTIL_MEMORY_EQUALS:
+	case RUN_UNTIL_MEMORY_CHANGES:
+		if (condition->width != 1 && condition->width != 2 && condition->width != 4) {
+			break;
+		}
+		point->lastValue = _readValue(core, condition);
+		point->id = debugger->platform->setWatchpoint(debugger->platform, &runUntil->d, &watchpoint);
+		break;
+	case RUN_UNTIL_PC: {
+		struct mBreakpoint breakpoint = {
+			.address = condition->address,
+			.segment = condition->segment,
+			.type = BREAKPOINT_HARDWARE,
+			.condition = expression,
+		};
+		// The platform takes ownership of the expression
+		point->id = debugger->platform->setBreakpoint(debugger->platform, &runUntil->d, &breakpoint);
+		return true;
+	}
+	case RUN_UNTIL_INPUT_POLL:
+		for (i = 0; i < sizeof(_inputRegisters) / sizeof(*_inputRegisters); ++i) {
+			int32_t address;
+			if (!core->lookupIdentifier(core, _inputRegisters[i].name, &address, &watchpoint.segment)) {
+				continue;
+			}
+			watchpoint.minAddress = address;
+			watchpoint.maxAddress = address + _inputRegisters[i].width;
+			watchpoint.type = WATCHPOINT_READ;
+			point->id = debugger->platform->setWatchpoint(debugger->platform, &runUntil->d, &watchpoint);
+			break;
+		}
+		break;
+	case RUN_UNTIL_FRAMES:
+		break;
+	}
+
+	point->expression = expression;
+	point->program = expression ? mDebuggerCompileParseTree(debugger, expression) : NULL;
+	return point->id >= 0 || condition->type == RUN_UNTIL_FRAMES;
+}
+
+static void _clearPoints(struct mDebuggerRunUntil* runUntil) {
+	struct mDebugger* debugger = runUntil->d.p;
+	size_t i;
+	for (i = 0; i < mDebuggerRunUntilPointListSize(&runUntil->points); ++i) {
+		struct mDebuggerRunUntilPoint* point = mDebuggerRunUntilPointListGetPointer(&runUntil->points, i);
+		if (point->id >= 0) {
+			debugger->platform->clearBreakpoint(debugger->platform, point->id);
+		}
+		if (point->expression) {
+			parseFree(point->expression);
+		}
+		parseProgramFree(point->program);
+	}
+	mDebuggerRunUntilPointListClear(&runUntil->points);
+	runUntil->conditions = NULL;
+}
+
+void mDebuggerRunUntilInit(struct mDebuggerRunUntil* runUntil) {
+	memset(runUntil, 0, sizeof(*runUntil));
+	runUntil->d.type = DEBUGGER_CUSTOM;
+	runUntil->d.entered = _entered;
+	runUntil->timeout.context = runUntil;
+	runUntil->timeout.name = "Run until";
+	runUntil->timeout.callback = _timeout;
+	runUntil->timeout.priority = 0x90;
+	runUntil->hit = mDEBUGGER_RUN_UNTIL_TIMEOUT;
+	mDebuggerRunUntilPointListInit(&runUntil->points, 0);
+}
+
+void mDebuggerRunUntilDeinit(struct mDebuggerRunUntil* runUntil) {
+	mDebuggerRunUntilPointListDeinit(&runUntil->points);
+}
+
+ssize_t mDebuggerRunUntil(struct mDebuggerRunUntil* runUntil, const struct mDebuggerRunUntilCondition* conditions, size_t nConditions, uint64_t maxCycles) {
+	struct mDebugger* debugger = runUntil->d.p;
+	if (!debugger || !debugger->core || !nConditions) {
+		return mDEBUGGER_RUN_UNTIL_ERROR;
+	}
+	if (debugger->state == DEBUGGER_CREATED || debugger->state == DEBUGGER_SHUTDOWN) {
+		return mDEBUGGER_RUN_UNTIL_ERROR;
+	}
+	struct mCore* core = debugger->core;
+
+	runUntil->conditions = conditions;
+	runUntil->hit = mDEBUGGER_RUN_UNTIL_TIMEOUT;
+	runUntil->timedOut = false;
+	size_t i;
+	for (i = 0; i < nConditions; ++i) {
+		if (!_addPoint(runUntil, &conditions[i])) {
+			_clearPoints(runUntil);
+			return mDEBUGGER_RUN_UNTIL_ERROR;
+		}
+	}
+
+	if (maxCycles) {
+		runUntil->cyclesLeft = maxCycles;
+		_scheduleTimeout(runUntil, core->timing, 0);
+	}
+	runUntil->startFrame = core->frameCounter(core);
+	uint32_t frame = runUntil->startFrame;
+	runUntil->memoryDirty = true;
+	while (true) {
+		if (runUntil->memoryDirty) {
+			runUntil->memoryDirty = false;
+			_checkMemory(runUntil, core);
+		}
+		if (runUntil->hit >= 0 || runUntil->timedOut) {
+			break;
+		}
+		if (debugger->state == DEBUGGER_SHUTDOWN) {
+			runUntil->hit = mDEBUGGER_RUN_UNTIL_ERROR;
+			break;
+		}
+		mDebuggerRun(debugger);
+		uint32_t newFrame = core->frameCounter(core);
+		if (newFrame != frame) {
+			frame = newFrame;
+			runUntil->memoryDirty = true;
+			_checkFrames(runUntil, frame - runUntil->startFrame);
+		}
+	}
+
+	mTimingDeschedule(core->timing, &runUntil->timeout);
+	_clearPoints(runUntil);
+	return runUntil->hit;
+}
@@ -7,6 +7,7 @@
 
 #include <mgba-util/string.h>
 #include <mgba-util/table.h>
+#include <mgba-util/vector.h>
 #include <mgba-util/hash.h>
 #include <mgba-util/vfs.h>
 
@@ -15,53 +16,204 @@ struct mDebuggerSymbol {
 	int segment;
 };
 
+struct mDebuggerSymbolInfo {
+	struct mDebuggerSymbol sym;
+	uint32_t size;
+};
+
+struct mDebuggerSymbolRange {
+	int segment;
+	uint32_t start;
+	uint32_t size;
+	const char* name;
+};
+
+struct mDebuggerSymbolPending {
+	char* name;
+	struct mDebuggerSymbolInfo info;
+};
+
+DECLARE_VECTOR(mDebuggerSymbolRangeList, struct mDebuggerSymbolRange);
+DEFINE_VECTOR(mDebuggerSymbolRangeList, struct mDebuggerSymbolRange);
+DECLARE_VECTOR(mDebuggerSymbolPendingList, struct mDebuggerSymbolPending);
+DEFINE_VECTOR(mDebuggerSymbolPendingList, struct mDebuggerSymbolPending);
+
 struct mDebuggerSymbols {
 	struct Table names;
 	struct Table reverse;
+
+	// Sorted by segment and address, rebuilt lazily after symbols change
+	struct mDebuggerSymbolRangeList ranges;
+	bool rangesDirty;
+
+	// Added symbols are only hashed once something looks them up, since symbol
+	// files can hold tens of thousands of entries that never get used
+	struct mDebuggerSymbolPendingList pending;
 };
 
 struct mDebuggerSymbols* mDebuggerSymbolTableCreate(void) {
 	struct mDebuggerSymbols* st = malloc(sizeof(*st));
 	HashTableInit(&st->names, 0, free);
 	HashTableInit(&st->reverse, 0, free);
+	mDebuggerSymbolRangeListInit(&st->ranges, 0);
+	st->rangesDirty = false;
+	mDebuggerSymbolPendingListInit(&st->pending, 0);
 	return st;
 }
 
 void mDebuggerSymbolTableDestroy(struct mDebuggerSymbols* st) {
 	HashTableDeinit(&st->names);
 	HashTableDeinit(&st->reverse);
+	mDebuggerSymbolRangeListDeinit(&st->ranges);
+	size_t i;
+	for (i = 0; i < mDebuggerSymbolPendingListSize(&st->pending); ++i) {
+		free(mDebuggerSymbolPendingListGetPointer(&st->pending, i)->name);
+	}
+	mDebuggerSymbolPendingListDeinit(&st->pending);
 	free(st);
 }
 
+static void _remove(struct mDebuggerSymbols* st, const char* name) {
+	struct mDebuggerSymbolInfo* info = HashTableLookup(&st->names, name);
+	if (info) {
+		// Another symbol at the same address may have taken over the reverse entry
+		const char* reverse = HashTableLookupBinary(&st->reverse, &info->sym, sizeof(info->sym));
+		if (reverse && strcmp(reverse, name) == 0) {
+			HashTableRemoveBinary(&st->reverse, &info->sym, sizeof(info->sym));
+		}
+		HashTableRemove(&st->names, name);
+		st->rangesDirty = true;
+	}
+}
+
+static void _flushPending(struct mDebuggerSymbols* st) {
+	size_t size = mDebuggerSymbolPendingListSize(&st->pending);
+	if (!size) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		struct mDebuggerSymbolPending* pending = mDebuggerSymbolPendingListGetPointer(&st->pending, i);
+		_remove(st, pending->name);
+		struct mDebuggerSymbolInfo* info = malloc(sizeof(*info));
+		*info = pending->info;
+		HashTableInsert(&st->names, pending->name, info);
+		HashTableInsertBinary(&st->reverse, &info->sym, sizeof(info->sym), pending->name);
+	}
+	mDebuggerSymbolPendingListClear(&st->pending);
+	st->rangesDirty = true;
+}
+
+static int _rangeCompare(const void* a, const void* b) {
+	const struct mDebuggerSymbolRange* ra = a;
+	const struct mDebuggerSymbolRange* rb = b;
+	if (ra->segment != rb->segment) {
+		return ra->segment < rb->segment ? -1 : 1;
+	}
+	if (ra->start != rb->start) {
+		return ra->start < rb->start ? -1 : 1;
+	}
+	return 0;
+}
+
+static void _addRange(const char* name, void* value, void* user) {
+	struct mDebuggerSymbols* st = user;
+	struct mDebuggerSymbolInfo* info = value;
+	// Only the name the reverse table resolves to is indexed, so aliases don't show up twice
+	const char* canonical = HashTableLookupBinary(&st->reverse, &info->sym, sizeof(info->sym));
+	if (!canonical || strcmp(canonical, name) != 0) {
+		return;
+	}
+	struct mDebuggerSymbolRange* range = mDebuggerSymbolRangeListAppend(&st->ranges);
+	range->segment = info->sym.segment;
+	range->start = info->sym.value;
+	range->size = info->size;
+	range->name = canonical;
+}
+
+static void _updateRanges(struct mDebuggerSymbols* st) {
+	_flushPending(st);
+	if (!st->rangesDirty) {
+		return;
+	}
+	mDebuggerSymbolRangeListClear(&st->ranges);
+	HashTableEnumerate(&st->names, _addRange, st);
+	size_t size = mDebuggerSymbolRangeListSize(&st->ranges);
+	if (size > 1) {
+		qsort(mDebuggerSymbolRangeListGetPointer(&st->ranges, 0), size, sizeof(struct mDebuggerSymbolRange), _rangeCompare);
+	}
+	st->rangesDirty = false;
+}
+
 bool mDebuggerSymbolLookup(const struct mDebuggerSymbols* st, const char* name, int32_t* value, int* segment) {
-	struct mDebuggerSymbol* sym = HashTableLookup(&st->names, name);
-	if (!sym) {
+	// Pending symbols are a cache miss, so they can be flushed even through a const table
+	_flushPending((struct mDebuggerSymbols*) st);
+	struct mDebuggerSymbolInfo* info = HashTableLookup(&st->names, name);
+	if (!info) {
 		return false;
 	}
-	*value = sym->value;
-	*segment = sym->segment;
+	*value = info->sym.value;
+	*segment = info->sym.segment;
 	return true;
 }
 
 const char* mDebuggerSymbolReverseLookup(const struct mDebuggerSymbols* st, int32_t value, int segment) {
+	_flushPending((struct mDebuggerSymbols*) st);
 	struct mDebuggerSymbol sym = { value, segment };
 	return HashTableLookupBinary(&st->reverse, &sym, sizeof(sym));
 }
 
+const char* mDebuggerSymbolReverseLookupNearest(const struct mDebuggerSymbols* st, int32_t value, int segment, uint32_t* offset) {
+	const char* name = mDebuggerSymbolReverseLookup(st, value, segment);
+	if (name) {
+		*offset = 0;
+		return name;
+	}
+
+	// The range index is a cache, so it can be rebuilt even through a const table
+	_updateRanges((struct mDebuggerSymbols*) st);
+	struct mDebuggerSymbolRange key = { .segment = segment, .start = value };
+	size_t low = 0;
+	size_t high = mDebuggerSymbolRangeListSize(&st->ranges);
+	// Find the first range that starts after the address; the one before it is the closest
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (_rangeCompare(mDebuggerSymbolRangeListGetConstPointer(&st->ranges, mid), &key) <= 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	if (!low) {
+		return NULL;
+	}
+	const struct mDebuggerSymbolRange* range = mDebuggerSymbolRangeListGetConstPointer(&st->ranges, low - 1);
+	if (range->segment != segment) {
+		return NULL;
+	}
+	uint32_t delta = (uint32_t) value - range->start;
+	if (range->size && delta >= range->size) {
+		return NULL;
+	}
+	*offset = delta;
+	return range->name;
+}
+
 void mDebuggerSymbolAdd(struct mDebuggerSymbols* st, const char* name, int32_t value, int segment) {
-	struct mDebuggerSymbol* sym = malloc(sizeof(*sym));
-	sym->value = value;
-	sym->segment = segment;
-	HashTableInsert(&st->names, name, sym);
-	HashTableInsertBinary(&st->reverse, sym, sizeof(*sym), strdup(name));
+	mDebuggerSymbolAddSized(st, name, value, segment, 0);
+}
+
+void mDebuggerSymbolAddSized(struct mDebuggerSymbols* st, const char* name, int32_t value, int segment, uint32_t size) {
+	struct mDebuggerSymbolPending* pending = mDebuggerSymbolPendingListAppend(&st->pending);
+	pending->name = strdup(name);
+	pending->info.sym.value = value;
+	pending->info.sym.segment = segment;
+	pending->info.size = size;
 }
 
 void mDebuggerSymbolRemove(struct mDebuggerSymbols* st, const char* name) {
-	struct mDebuggerSymbol* sym = HashTableLookup(&st->names, name);
-	if (sym) {
-		HashTableRemoveBinary(&st->reverse, sym, sizeof(*sym));
-		HashTableRemove(&st->names, name);
-	}
+	_flushPending(st);
+	_remove(st, name);
 }
 
 void mDebuggerLoadARMIPSSymbols(struct mDebuggerSymbols* st, struct VFile* vf) {
@@ -98,12 +250,14 @@ void mDebuggerLoadARMIPSSymbols(struct mDebuggerSymbols* st, struct VFile* vf) {
 		}
 
 		char* buf2 = strchr(buf, ',');
+		uint32_t size = 0;
 
 		if (buf2 != NULL) {
 			// Commas separate names from function sizes
 			*buf2 = '\0';
+			size = strtoul(&buf2[1], NULL, 16);
 		}
 
-		mDebuggerSymbolAdd(st, buf, address, -1);
+		mDebuggerSymbolAddSized(st, buf, address, -1, size);
 	}
 }
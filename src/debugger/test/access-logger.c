@@ -0,0 +1,56 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/internal/debugger/access-logger.h>
+
+#include "debugger/test/test-gba.h"
+
+M_TEST_DEFINE(fastPath) {
+	static const uint32_t code[] = {
+		0xE3A09402, // mov r9, #0x02000000
+		0xE5C90001, // strb r0, [r9, #1]
+		0xE1D910B4, // ldrh r1, [r9, #4]
+		0xE8990003, // ldmia r9, {r0, r1}
+		0xEAFFFFFE, // b .
+	};
+	mDebuggerAccessLogFlags blocks[2][12];
+	int fastPath;
+	for (fastPath = 0; fastPath < 2; ++fastPath) {
+		struct mCore* core = mTestGBACoreCreate(code, sizeof(code));
+
+		struct mDebugger debugger;
+		mDebuggerInit(&debugger);
+		mDebuggerAttach(&debugger, core);
+		struct mDebuggerAccessLogger logger;
+		mDebuggerAccessLoggerInit(&logger);
+		logger.fastPath = fastPath;
+		mDebuggerAttachModule(&debugger, &logger.d);
+		assert_true(mDebuggerAccessLoggerOpen(&logger, VFileMemChunk(NULL, 0), O_CREAT | O_RDWR));
+		assert_int_equal(mDebuggerAccessLoggerWatchMemoryBlockName(&logger, "wram", 0), 0);
+		// The fast path doesn't need the debugger to step
+		assert_int_equal(debugger.state, fastPath ? DEBUGGER_RUNNING : DEBUGGER_CALLBACK);
+
+		size_t i;
+		for (i = 0; i < 16; ++i) {
+			mDebuggerRun(&debugger);
+		}
+		memcpy(blocks[fastPath], mDebuggerAccessLogRegionListGetPointer(&logger.regions, 0)->block, sizeof(blocks[fastPath]));
+
+		mDebuggerAccessLoggerDeinit(&logger);
+		mCoreConfigDeinit(&core->config);
+		core->deinit(core);
+		mDebuggerDeinit(&debugger);
+	}
+	assert_int_equal(blocks[1][0], mDebuggerAccessLogFlagsFillAccess32(mDebuggerAccessLogFlagsFillRead(0)));
+	assert_int_equal(blocks[1][1], blocks[1][0] | mDebuggerAccessLogFlagsFillWrite(0) | mDebuggerAccessLogFlagsFillAccess8(0));
+	assert_int_equal(blocks[1][4], mDebuggerAccessLogFlagsFillAccess16(blocks[1][0]));
+	assert_int_equal(blocks[1][8], 0);
+	assert_memory_equal(blocks[0], blocks[1], sizeof(blocks[0]));
+}
+
+M_TEST_SUITE_DEFINE(AccessLogger,
+	cmocka_unit_test(fastPath))
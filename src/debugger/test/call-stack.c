@@ -0,0 +1,71 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/internal/arm/arm.h>
+#include <mgba/internal/gba/memory.h>
+
+#include "debugger/test/test-gba.h"
+
+M_TEST_DEFINE(shadowStack) {
+	static const uint32_t code[] = {
+		0xEB000002, // bl 0x10
+		0xEAFFFFFE, // b .
+		0xE1A00000, // nop
+		0xE1A00000, // nop
+		0xE92D4000, // push {lr}
+		0xE28F0009, // add r0, pc, #9
+		0xE1A0E00F, // mov lr, pc
+		0xE12FFF10, // bx r0
+		0xE8BD8000, // pop {pc}
+		0xF000B500, // push {lr}; bl 0x30
+		0xBC01F803, // ...; pop {r0}
+		0x46C04700, // bx r0; nop
+		0x46C04770, // bx lr; nop
+	};
+	struct mCore* core = mTestGBACoreCreate(code, sizeof(code));
+	mCoreConfigSetIntValue(&core->config, "gba.shadowCallStack", 1);
+	core->reloadConfigOption(core, "gba.shadowCallStack", NULL);
+	struct ARMCore* cpu = core->cpu;
+	struct ARMShadowStack* stack = cpu->shadowStack;
+	assert_non_null(stack);
+	assert_int_equal(stack->depth, 0);
+
+	size_t i;
+	for (i = 0; i < 8; ++i) {
+		ARMRun(cpu);
+	}
+	assert_int_equal(stack->depth, 3);
+	assert_int_equal(stack->frames[0].callAddress, GBA_BASE_ROM0);
+	assert_int_equal(stack->frames[0].entryAddress, GBA_BASE_ROM0 + 0x10);
+	assert_int_equal(stack->frames[0].returnAddress, GBA_BASE_ROM0 + 0x04);
+	// Called through "mov lr, pc; bx r0"
+	assert_int_equal(stack->frames[1].callAddress, GBA_BASE_ROM0 + 0x1C);
+	assert_int_equal(stack->frames[1].entryAddress, GBA_BASE_ROM0 + 0x24);
+	assert_int_equal(stack->frames[1].returnAddress, GBA_BASE_ROM0 + 0x20);
+	assert_int_equal(stack->frames[2].callAddress, GBA_BASE_ROM0 + 0x26);
+	assert_int_equal(stack->frames[2].entryAddress, GBA_BASE_ROM0 + 0x30);
+	assert_int_equal(stack->frames[2].returnAddress, GBA_BASE_ROM0 + 0x2A);
+
+	ARMRun(cpu);
+	assert_int_equal(stack->depth, 2);
+	ARMRun(cpu);
+	ARMRun(cpu);
+	assert_int_equal(stack->depth, 1);
+	ARMRun(cpu);
+	assert_int_equal(stack->depth, 0);
+	assert_int_equal(cpu->gprs[ARM_PC], GBA_BASE_ROM0 + 0x04 + WORD_SIZE_ARM);
+
+	mCoreConfigSetIntValue(&core->config, "gba.shadowCallStack", 0);
+	core->reloadConfigOption(core, "gba.shadowCallStack", NULL);
+	assert_null(cpu->shadowStack);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_SUITE_DEFINE(CallStack,
+	cmocka_unit_test(shadowStack))
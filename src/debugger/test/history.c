@@ -0,0 +1,77 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/timing.h>
+#include <mgba/internal/arm/arm.h>
+#include <mgba/internal/debugger/history.h>
+#include <mgba/internal/gba/memory.h>
+
+#include "debugger/test/test-gba.h"
+
+struct CountingModule {
+	struct mDebuggerModule d;
+	int hits;
+};
+
+static void _countEntry(struct mDebuggerModule* module, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
+	UNUSED(reason);
+	UNUSED(info);
+	++((struct CountingModule*) module)->hits;
+	module->isPaused = false;
+}
+
+M_TEST_DEFINE(reverseExecution) {
+	static const uint32_t code[] = {
+		0xE3A09402, // mov r9, #0x02000000
+		0xE5890000, // str r0, [r9]
+		0xE2800001, // add r0, r0, #1
+		0xE5991000, // ldr r1, [r9]
+		0xEAFFFFFB, // b 0x08000004
+	};
+	struct mCore* core = mTestGBACoreCreate(code, sizeof(code));
+	struct ARMCore* cpu = core->cpu;
+
+	struct mDebugger debugger;
+	mDebuggerInit(&debugger);
+	mDebuggerAttach(&debugger, core);
+	struct CountingModule module = { .d = { .type = DEBUGGER_CUSTOM, .entered = _countEntry } };
+	mDebuggerAttachModule(&debugger, &module.d);
+	mDebuggerEnableHistory(&debugger, 2000, 4);
+
+	uint64_t times[512];
+	uint32_t r0[512];
+	size_t i;
+	for (i = 0; i < 512; ++i) {
+		mDebuggerRun(&debugger);
+		times[i] = mTimingGlobalTime(core->timing);
+		r0[i] = cpu->gprs[0];
+	}
+	for (i = 511; i > 400; --i) {
+		assert_true(mDebuggerReverseStep(&debugger));
+		assert_int_equal(mTimingGlobalTime(core->timing), times[i - 1]);
+		assert_int_equal(cpu->gprs[0], r0[i - 1]);
+	}
+
+	struct mBreakpoint breakpoint = { .address = GBA_BASE_ROM0 + 8, .segment = -1, .type = BREAKPOINT_HARDWARE };
+	debugger.platform->setBreakpoint(debugger.platform, &module.d, &breakpoint);
+	uint32_t value = cpu->gprs[0];
+	enum mDebuggerEntryReason reason;
+	struct mDebuggerEntryInfo info;
+	assert_true(mDebuggerReverseContinue(&debugger, &reason, &info));
+	assert_int_equal(reason, DEBUGGER_ENTER_BREAKPOINT);
+	assert_int_equal(info.address, GBA_BASE_ROM0 + 8);
+	assert_int_equal(cpu->gprs[0], value - 1);
+	assert_int_equal(module.hits, 0);
+
+	mDebuggerDisableHistory(&debugger);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	mDebuggerDeinit(&debugger);
+}
+
+M_TEST_SUITE_DEFINE(DebuggerHistory,
+	cmocka_unit_test(reverseExecution))
@@ -136,6 +136,43 @@ M_TEST_DEFINE(parseUnaryChainedOperator) {
 	assert_int_equal(tree->rhs->rhs->token.uintValue, 2);
 }
 
+#define COMPILE_AND_COMPARE(STR, OK) \
+	do { \
+		PARSE(STR); \
+		int32_t treeValue = 0; \
+		int treeSegment = -1; \
+		int32_t programValue = 0; \
+		int programSegment = -1; \
+		struct ParseProgram* program = mDebuggerCompileParseTree(NULL, tree); \
+		assert_non_null(program); \
+		assert_int_equal(mDebuggerEvaluateParseTree(NULL, tree, &treeValue, &treeSegment), OK); \
+		assert_int_equal(mDebuggerEvaluateParseProgram(NULL, program, &programValue, &programSegment), OK); \
+		assert_int_equal(treeValue, programValue); \
+		assert_int_equal(treeSegment, programSegment); \
+		parseProgramFree(program); \
+		parseFree(lp->tree); \
+	} while (0)
+
+M_TEST_DEFINE(compileExpressions) {
+	COMPILE_AND_COMPARE("1+2*3", true);
+	COMPILE_AND_COMPARE("(1+2)*3", true);
+	COMPILE_AND_COMPARE("1+-2", true);
+	COMPILE_AND_COMPARE("~0>>4", true);
+	COMPILE_AND_COMPARE("5==5&&3<2", true);
+	COMPILE_AND_COMPARE("!(4-4)||0", true);
+	COMPILE_AND_COMPARE("$02:0100", true);
+	COMPILE_AND_COMPARE("$02:0100+4", true);
+	COMPILE_AND_COMPARE("-$02:0100", true);
+	COMPILE_AND_COMPARE("7%0", false);
+	PARSE("0");
+}
+
+M_TEST_DEFINE(compileError) {
+	PARSE("+");
+
+	assert_null(mDebuggerCompileParseTree(NULL, tree));
+}
+
 M_TEST_SUITE_DEFINE(Parser,
 	cmocka_unit_test_setup_teardown(parseEmpty, parseSetup, parseTeardown),
 	cmocka_unit_test_setup_teardown(parseInt, parseSetup, parseTeardown),
@@ -146,4 +183,6 @@ M_TEST_SUITE_DEFINE(Parser,
 	cmocka_unit_test_setup_teardown(parseParentheticalExpression, parseSetup, parseTeardown),
 	cmocka_unit_test_setup_teardown(parseParentheticalAddMultplyExpression, parseSetup, parseTeardown),
 	cmocka_unit_test_setup_teardown(parseIsolatedOperator, parseSetup, parseTeardown),
-	cmocka_unit_test_setup_teardown(parseUnaryChainedOperator, parseSetup, parseTeardown))
+	cmocka_unit_test_setup_teardown(parseUnaryChainedOperator, parseSetup, parseTeardown),
+	cmocka_unit_test_setup_teardown(compileExpressions, parseSetup, parseTeardown),
+	cmocka_unit_test_setup_teardown(compileError, parseSetup, parseTeardown))
@@ -0,0 +1,99 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/internal/debugger/profiler.h>
+#include <mgba/internal/debugger/symbols.h>
+#include <mgba-util/vfs.h>
+
+static const struct mDebuggerProfilerLocation mainLoop[] = {
+	{ 0x08000100, -1 },
+};
+
+static const struct mDebuggerProfilerLocation drawSprites[] = {
+	{ 0x08000100, -1 },
+	{ 0x08000210, -1 },
+};
+
+static const struct mDebuggerProfilerLocation drawSpritesLater[] = {
+	{ 0x08000100, -1 },
+	{ 0x08000240, -1 },
+};
+
+M_TEST_DEFINE(folded) {
+	struct mDebuggerProfiler profiler;
+	mDebuggerProfilerInit(&profiler, NULL);
+	mDebuggerProfilerAddSample(&profiler, drawSprites, 2);
+	mDebuggerProfilerAddSample(&profiler, drawSprites, 2);
+	mDebuggerProfilerAddSample(&profiler, mainLoop, 1);
+	assert_int_equal(profiler.samples, 3);
+
+	struct mDebuggerSymbols* symbols = mDebuggerSymbolTableCreate();
+	mDebuggerSymbolAdd(symbols, "main", 0x08000100, -1);
+	mDebuggerSymbolAdd(symbols, "drawSprites", 0x08000200, -1);
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mDebuggerProfilerWriteFolded(&profiler, symbols, vf));
+	char buffer[128] = {0};
+	vf->seek(vf, 0, SEEK_SET);
+	vf->read(vf, buffer, sizeof(buffer) - 1);
+	assert_non_null(strstr(buffer, "main;drawSprites 2\n"));
+	assert_non_null(strstr(buffer, "main 1\n"));
+	vf->close(vf);
+
+	vf = VFileMemChunk(NULL, 0);
+	assert_true(mDebuggerProfilerWriteFolded(&profiler, NULL, vf));
+	memset(buffer, 0, sizeof(buffer));
+	vf->seek(vf, 0, SEEK_SET);
+	vf->read(vf, buffer, sizeof(buffer) - 1);
+	assert_non_null(strstr(buffer, "0x08000100;0x08000210 2\n"));
+	vf->close(vf);
+
+	mDebuggerSymbolTableDestroy(symbols);
+	mDebuggerProfilerDeinit(&profiler);
+}
+
+M_TEST_DEFINE(summarize) {
+	struct mDebuggerProfiler profiler;
+	mDebuggerProfilerInit(&profiler, NULL);
+	mDebuggerProfilerAddSample(&profiler, mainLoop, 1);
+	mDebuggerProfilerAddSample(&profiler, drawSprites, 2);
+	mDebuggerProfilerAddSample(&profiler, drawSpritesLater, 2);
+
+	struct mDebuggerSymbols* symbols = mDebuggerSymbolTableCreate();
+	mDebuggerSymbolAdd(symbols, "main", 0x08000100, -1);
+	mDebuggerSymbolAdd(symbols, "drawSprites", 0x08000200, -1);
+
+	struct mDebuggerProfilerEntry entries[4];
+	assert_int_equal(mDebuggerProfilerSummarize(&profiler, symbols, entries, 4), 2);
+	assert_string_equal(entries[0].name, "drawSprites");
+	assert_int_equal(entries[0].samples, 2);
+	assert_string_equal(entries[1].name, "main");
+	assert_int_equal(entries[1].samples, 1);
+
+	assert_int_equal(mDebuggerProfilerSummarize(&profiler, symbols, entries, 1), 1);
+	assert_string_equal(entries[0].name, "drawSprites");
+
+	mDebuggerProfilerClear(&profiler);
+	assert_int_equal(profiler.samples, 0);
+	assert_int_equal(mDebuggerProfilerSummarize(&profiler, symbols, entries, 4), 0);
+
+	mDebuggerSymbolTableDestroy(symbols);
+	mDebuggerProfilerDeinit(&profiler);
+}
+
+M_TEST_DEFINE(startWithoutCore) {
+	struct mDebuggerProfiler profiler;
+	mDebuggerProfilerInit(&profiler, NULL);
+	assert_false(mDebuggerProfilerStart(&profiler, mDEBUGGER_PROFILER_DEFAULT_INTERVAL));
+	assert_false(profiler.running);
+	mDebuggerProfilerDeinit(&profiler);
+}
+
+M_TEST_SUITE_DEFINE(Profiler,
+	cmocka_unit_test(folded),
+	cmocka_unit_test(summarize),
+	cmocka_unit_test(startWithoutCore))
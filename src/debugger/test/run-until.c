@@ -0,0 +1,86 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/timing.h>
+#include <mgba/internal/arm/arm.h>
+#include <mgba/internal/debugger/run-until.h>
+#include <mgba/internal/gba/memory.h>
+
+#include "debugger/test/test-gba.h"
+
+M_TEST_DEFINE(conditions) {
+	static const uint32_t code[] = {
+		0xE3A09402, // mov r9, #0x02000000
+		0xE3A08301, // mov r8, #0x04000000
+		0xE2888E13, // add r8, r8, #0x130
+		0xE3A00000, // mov r0, #0
+		0xE2800001, // add r0, r0, #1
+		0xE5890000, // str r0, [r9]
+		0xE31000FF, // tst r0, #0xFF
+		0x1AFFFFFB, // bne 0x08000010
+		0xE1D810B0, // ldrh r1, [r8]
+		0xEAFFFFF9, // b 0x08000010
+	};
+	struct mCore* core = mTestGBACoreCreate(code, sizeof(code));
+	struct ARMCore* cpu = core->cpu;
+
+	struct mDebugger debugger;
+	mDebuggerInit(&debugger);
+	mDebuggerAttach(&debugger, core);
+	struct mDebuggerRunUntil runUntil;
+	mDebuggerRunUntilInit(&runUntil);
+	mDebuggerAttachModule(&debugger, &runUntil.d);
+
+	struct mDebuggerRunUntilCondition conditions[2] = {
+		{ .type = RUN_UNTIL_MEMORY_EQUALS, .address = GBA_BASE_EWRAM, .segment = -1, .width = 4, .value = 50 },
+	};
+	assert_int_equal(mDebuggerRunUntil(&runUntil, conditions, 1, 0), 0);
+	assert_int_equal(core->rawRead32(core, GBA_BASE_EWRAM, -1), 50);
+
+	// Already met, so nothing runs
+	uint64_t start = mTimingGlobalTime(core->timing);
+	assert_int_equal(mDebuggerRunUntil(&runUntil, conditions, 1, 0), 0);
+	assert_int_equal(mTimingGlobalTime(core->timing), start);
+
+	conditions[0] = (struct mDebuggerRunUntilCondition) { .type = RUN_UNTIL_PC, .address = GBA_BASE_ROM0 + 0x14, .segment = -1, .expression = "r0 == 80" };
+	assert_int_equal(mDebuggerRunUntil(&runUntil, conditions, 1, 0), 0);
+	assert_int_equal(cpu->gprs[0], 80);
+	assert_int_equal(core->rawRead32(core, GBA_BASE_EWRAM, -1), 79);
+
+	conditions[0] = (struct mDebuggerRunUntilCondition) { .type = RUN_UNTIL_MEMORY_EQUALS, .address = GBA_BASE_EWRAM, .segment = -1, .width = 4, .value = 1000 };
+	conditions[1] = (struct mDebuggerRunUntilCondition) { .type = RUN_UNTIL_MEMORY_CHANGES, .address = GBA_BASE_EWRAM, .segment = -1, .width = 2 };
+	assert_int_equal(mDebuggerRunUntil(&runUntil, conditions, 2, 0), 1);
+	assert_int_equal(core->rawRead32(core, GBA_BASE_EWRAM, -1), 80);
+
+	conditions[1] = (struct mDebuggerRunUntilCondition) { .type = RUN_UNTIL_INPUT_POLL };
+	assert_int_equal(mDebuggerRunUntil(&runUntil, conditions, 2, 0), 1);
+	assert_int_equal(cpu->gprs[0], 256);
+
+	conditions[0].value = 0xFFFFFFFF;
+	conditions[1] = (struct mDebuggerRunUntilCondition) { .type = RUN_UNTIL_FRAMES, .value = 2 };
+	uint32_t frame = core->frameCounter(core);
+	assert_int_equal(mDebuggerRunUntil(&runUntil, conditions, 2, 0), 1);
+	assert_int_equal(core->frameCounter(core), frame + 2);
+
+	start = mTimingGlobalTime(core->timing);
+	assert_int_equal(mDebuggerRunUntil(&runUntil, conditions, 1, 1000), mDEBUGGER_RUN_UNTIL_TIMEOUT);
+	assert_in_range(mTimingGlobalTime(core->timing) - start, 1000, 1016);
+
+	conditions[0].width = 3;
+	assert_int_equal(mDebuggerRunUntil(&runUntil, conditions, 1, 0), mDEBUGGER_RUN_UNTIL_ERROR);
+	conditions[0] = (struct mDebuggerRunUntilCondition) { .type = RUN_UNTIL_PC, .address = GBA_BASE_ROM0 + 0x14, .segment = -1, .expression = "(r0 == 80" };
+	assert_int_equal(mDebuggerRunUntil(&runUntil, conditions, 1, 0), mDEBUGGER_RUN_UNTIL_ERROR);
+	assert_false(debugger.platform->hasBreakpoints(debugger.platform));
+
+	mDebuggerRunUntilDeinit(&runUntil);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	mDebuggerDeinit(&debugger);
+}
+
+M_TEST_SUITE_DEFINE(RunUntil,
+	cmocka_unit_test(conditions))
@@ -0,0 +1,125 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/internal/debugger/symbols.h>
+#include <mgba-util/vfs.h>
+
+static int symbolsSetup(void** state) {
+	*state = mDebuggerSymbolTableCreate();
+	return 0;
+}
+
+static int symbolsTeardown(void** state) {
+	mDebuggerSymbolTableDestroy(*state);
+	return 0;
+}
+
+M_TEST_DEFINE(nearestExact) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset = 1;
+	mDebuggerSymbolAdd(st, "main", 0x08000100, -1);
+	assert_string_equal(mDebuggerSymbolReverseLookupNearest(st, 0x08000100, -1, &offset), "main");
+	assert_int_equal(offset, 0);
+}
+
+M_TEST_DEFINE(nearestOffset) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset;
+	mDebuggerSymbolAdd(st, "first", 0x08000100, -1);
+	mDebuggerSymbolAdd(st, "second", 0x08000200, -1);
+	mDebuggerSymbolAdd(st, "third", 0x08000300, -1);
+	assert_string_equal(mDebuggerSymbolReverseLookupNearest(st, 0x0800011C, -1, &offset), "first");
+	assert_int_equal(offset, 0x1C);
+	assert_string_equal(mDebuggerSymbolReverseLookupNearest(st, 0x080002FF, -1, &offset), "second");
+	assert_int_equal(offset, 0xFF);
+	assert_string_equal(mDebuggerSymbolReverseLookupNearest(st, 0x08001000, -1, &offset), "third");
+	assert_int_equal(offset, 0xD00);
+	assert_null(mDebuggerSymbolReverseLookupNearest(st, 0x080000FF, -1, &offset));
+}
+
+M_TEST_DEFINE(nearestSized) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset;
+	mDebuggerSymbolAddSized(st, "func", 0x08000100, -1, 0x20);
+	assert_string_equal(mDebuggerSymbolReverseLookupNearest(st, 0x0800011F, -1, &offset), "func");
+	assert_int_equal(offset, 0x1F);
+	assert_null(mDebuggerSymbolReverseLookupNearest(st, 0x08000120, -1, &offset));
+}
+
+M_TEST_DEFINE(nearestSegment) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset;
+	mDebuggerSymbolAdd(st, "bank1", 0x4000, 1);
+	mDebuggerSymbolAdd(st, "bank2", 0x4000, 2);
+	mDebuggerSymbolAdd(st, "home", 0x0100, -1);
+	assert_string_equal(mDebuggerSymbolReverseLookupNearest(st, 0x4010, 2, &offset), "bank2");
+	assert_int_equal(offset, 0x10);
+	assert_string_equal(mDebuggerSymbolReverseLookupNearest(st, 0x4010, -1, &offset), "home");
+	assert_null(mDebuggerSymbolReverseLookupNearest(st, 0x4010, 3, &offset));
+}
+
+M_TEST_DEFINE(nearestAfterChanges) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset;
+	mDebuggerSymbolAdd(st, "low", 0x1000, -1);
+	assert_string_equal(mDebuggerSymbolReverseLookupNearest(st, 0x1800, -1, &offset), "low");
+	mDebuggerSymbolAdd(st, "high", 0x1400, -1);
+	assert_string_equal(mDebuggerSymbolReverseLookupNearest(st, 0x1800, -1, &offset), "high");
+	assert_int_equal(offset, 0x400);
+	mDebuggerSymbolAdd(st, "high", 0x1200, -1);
+	assert_null(mDebuggerSymbolReverseLookup(st, 0x1400, -1));
+	assert_string_equal(mDebuggerSymbolReverseLookupNearest(st, 0x1800, -1, &offset), "high");
+	assert_int_equal(offset, 0x600);
+	mDebuggerSymbolRemove(st, "high");
+	assert_string_equal(mDebuggerSymbolReverseLookupNearest(st, 0x1800, -1, &offset), "low");
+	assert_int_equal(offset, 0x800);
+}
+
+M_TEST_DEFINE(loadARMIPSSizes) {
+	struct mDebuggerSymbols* st = *state;
+	uint32_t offset;
+	static const char file[] =
+		"08000000 .arm\n"
+		"08000100 func,00000010\n"
+		"08000200 data\n";
+	struct VFile* vf = VFileFromConstMemory(file, sizeof(file) - 1);
+	mDebuggerLoadARMIPSSymbols(st, vf);
+	vf->close(vf);
+	assert_string_equal(mDebuggerSymbolReverseLookupNearest(st, 0x08000104, -1, &offset), "func");
+	assert_int_equal(offset, 4);
+	assert_null(mDebuggerSymbolReverseLookupNearest(st, 0x08000110, -1, &offset));
+	assert_string_equal(mDebuggerSymbolReverseLookupNearest(st, 0x08000210, -1, &offset), "data");
+}
+
+M_TEST_DEFINE(deferredOrder) {
+	struct mDebuggerSymbols* st = *state;
+	int32_t value;
+	int segment;
+	mDebuggerSymbolAdd(st, "dup", 0x100, -1);
+	mDebuggerSymbolAdd(st, "alias", 0x200, -1);
+	mDebuggerSymbolAdd(st, "dup", 0x200, 1);
+	assert_true(mDebuggerSymbolLookup(st, "dup", &value, &segment));
+	assert_int_equal(value, 0x200);
+	assert_int_equal(segment, 1);
+	assert_null(mDebuggerSymbolReverseLookup(st, 0x100, -1));
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x200, 1), "dup");
+	assert_string_equal(mDebuggerSymbolReverseLookup(st, 0x200, -1), "alias");
+
+	mDebuggerSymbolAdd(st, "gone", 0x300, -1);
+	mDebuggerSymbolRemove(st, "gone");
+	assert_false(mDebuggerSymbolLookup(st, "gone", &value, &segment));
+	assert_null(mDebuggerSymbolReverseLookup(st, 0x300, -1));
+}
+
+M_TEST_SUITE_DEFINE(Symbols,
+	cmocka_unit_test_setup_teardown(nearestExact, symbolsSetup, symbolsTeardown),
+	cmocka_unit_test_setup_teardown(nearestOffset, symbolsSetup, symbolsTeardown),
+	cmocka_unit_test_setup_teardown(nearestSized, symbolsSetup, symbolsTeardown),
+	cmocka_unit_test_setup_teardown(nearestSegment, symbolsSetup, symbolsTeardown),
+	cmocka_unit_test_setup_teardown(nearestAfterChanges, symbolsSetup, symbolsTeardown),
+	cmocka_unit_test_setup_teardown(loadARMIPSSizes, symbolsSetup, symbolsTeardown),
+	cmocka_unit_test_setup_teardown(deferredOrder, symbolsSetup, symbolsTeardown))
@@ -0,0 +1,30 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_DEBUGGER_TEST_GBA_H
+#define M_DEBUGGER_TEST_GBA_H
+
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/gba/core.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba-util/vfs.h>
+
+// Creates a GBA core that starts running code from the beginning of ROM, past the BIOS
+static inline struct mCore* mTestGBACoreCreate(const uint32_t* code, size_t size) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	vf->write(vf, code, size);
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+	GBASkipBIOS(core->board);
+	return core;
+}
+
+#endif
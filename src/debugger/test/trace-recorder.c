@@ -0,0 +1,54 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/internal/debugger/trace-recorder.h>
+#include <mgba-util/vfs.h>
+
+M_TEST_DEFINE(roundTrip) {
+	struct mDebuggerTraceRecorder recorder;
+	mDebuggerTraceRecorderInit(&recorder);
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mDebuggerTraceRecorderOpen(&recorder, vf, 0, 4));
+
+	struct mDebuggerTraceState states[3] = {
+		{ .address = 0x08000000, .opcode = 0xE3A00001, .nRegisters = 4, .registers = { 1, 2, 3, 4 } },
+		{ .address = 0x08000004, .opcode = 0xE2800001, .nRegisters = 4, .registers = { 1, 2, 3, 4 } },
+		{ .address = 0x08000008, .opcode = 0xEAFFFFFC, .nRegisters = 4, .registers = { 2, 2, 5, 4 } },
+	};
+	uint64_t cycles[3] = { 100, 103, 0x100000010ULL };
+	size_t i;
+	for (i = 0; i < 3; ++i) {
+		mDebuggerTraceRecorderAppend(&recorder, &states[i], cycles[i]);
+	}
+	assert_true(mDebuggerTraceRecorderFlush(&recorder));
+	assert_int_equal(recorder.records, 3);
+
+	struct mDebuggerTraceReader reader;
+	assert_true(mDebuggerTraceReaderOpen(&reader, vf));
+	assert_int_equal(reader.nRegisters, 4);
+	for (i = 0; i < 3; ++i) {
+		assert_true(mDebuggerTraceReaderNext(&reader));
+		assert_int_equal(reader.cycle, cycles[i]);
+		assert_int_equal(reader.state.address, states[i].address);
+		assert_int_equal(reader.state.opcode, states[i].opcode);
+		assert_memory_equal(reader.state.registers, states[i].registers, 4 * sizeof(uint32_t));
+	}
+	assert_false(mDebuggerTraceReaderNext(&reader));
+
+	mDebuggerTraceRecorderDeinit(&recorder);
+}
+
+M_TEST_DEFINE(badMagic) {
+	struct VFile* vf = VFileMemChunk("mAL\1\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 0x20);
+	struct mDebuggerTraceReader reader;
+	assert_false(mDebuggerTraceReaderOpen(&reader, vf));
+	vf->close(vf);
+}
+
+M_TEST_SUITE_DEFINE(TraceRecorder,
+	cmocka_unit_test(roundTrip),
+	cmocka_unit_test(badMagic))
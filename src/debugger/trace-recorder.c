@@ -0,0 +1,248 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/debugger/trace-recorder.h>
+
+#include <mgba/core/core.h>
+#include <mgba/core/timing.h>
+#include <mgba-util/math.h>
+#include <mgba-util/vfs.h>
+
+#define TRACE_RECORD_MAX_SIZE (4 * (5 + mDEBUGGER_TRACE_MAX_REGISTERS))
+#define TRACE_CYCLE_ESCAPE 0xFFFFFFFF
+
+const char mTR_MAGIC[] = "mTR\1";
+
+// All fields are little endian. Each record is the address, opcode, changed register mask and
+// cycles elapsed since the previous record, followed by the new value of each changed register.
+// A cycle count that doesn't fit in 32 bits is escaped and followed by the full 64-bit count.
+struct mDebuggerTraceHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t platform;
+	uint32_t nRegisters;
+	uint8_t reserved[0x10];
+};
+static_assert(sizeof(struct mDebuggerTraceHeader) == 0x20, "mDebuggerTraceHeader struct sized wrong");
+
+static void _mDebuggerTraceRecorderCallback(struct mDebuggerModule* debugger) {
+	struct mDebuggerTraceRecorder* recorder = (struct mDebuggerTraceRecorder*) debugger;
+	struct mDebugger* parent = recorder->d.p;
+	if (!recorder->vf || !parent->platform->traceState) {
+		return;
+	}
+
+	struct mDebuggerTraceState state;
+	parent->platform->traceState(parent->platform, &state);
+	uint64_t cycle = mTimingGlobalTime(parent->core->timing);
+	if (recorder->hasLast && cycle == recorder->lastCycle && state.address == recorder->last.address) {
+		// Nothing has run since the last record, e.g. because another module has the debugger paused
+		return;
+	}
+	mDebuggerTraceRecorderAppend(recorder, &state, cycle);
+}
+
+static void _mDebuggerTraceRecorderEntered(struct mDebuggerModule* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
+	UNUSED(reason);
+	UNUSED(info);
+	debugger->isPaused = false;
+}
+
+void mDebuggerTraceRecorderInit(struct mDebuggerTraceRecorder* recorder) {
+	memset(recorder, 0, sizeof(*recorder));
+	recorder->d.type = DEBUGGER_CUSTOM;
+	recorder->d.entered = _mDebuggerTraceRecorderEntered;
+	recorder->d.custom = _mDebuggerTraceRecorderCallback;
+}
+
+void mDebuggerTraceRecorderDeinit(struct mDebuggerTraceRecorder* recorder) {
+	mDebuggerTraceRecorderClose(recorder);
+}
+
+bool mDebuggerTraceRecorderOpen(struct mDebuggerTraceRecorder* recorder, struct VFile* vf, int platform, unsigned nRegisters) {
+	if (recorder->vf || nRegisters > mDEBUGGER_TRACE_MAX_REGISTERS) {
+		return false;
+	}
+
+	struct mDebuggerTraceHeader header = {0};
+	memcpy(header.magic, mTR_MAGIC, sizeof(header.magic));
+	STORE_32LE(0, 0, &header.version);
+	STORE_32LE(platform, 0, &header.platform);
+	STORE_32LE(nRegisters, 0, &header.nRegisters);
+	vf->seek(vf, 0, SEEK_SET);
+	vf->truncate(vf, 0);
+	if (vf->write(vf, &header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+
+	recorder->vf = vf;
+	recorder->buffer = malloc(mDEBUGGER_TRACE_BUFFER_SIZE);
+	recorder->bufferUsed = 0;
+	recorder->records = 0;
+	recorder->hasLast = false;
+	memset(&recorder->last, 0, sizeof(recorder->last));
+	recorder->last.nRegisters = nRegisters;
+	if (recorder->d.p) {
+		mDebuggerModuleSetNeedsCallback(&recorder->d);
+	}
+	return true;
+}
+
+bool mDebuggerTraceRecorderClose(struct mDebuggerTraceRecorder* recorder) {
+	if (!recorder->vf) {
+		return false;
+	}
+	bool ok = mDebuggerTraceRecorderFlush(recorder);
+	recorder->vf->close(recorder->vf);
+	recorder->vf = NULL;
+	free(recorder->buffer);
+	recorder->buffer = NULL;
+	recorder->d.needsCallback = false;
+	return ok;
+}
+
+bool mDebuggerTraceRecorderFlush(struct mDebuggerTraceRecorder* recorder) {
+	if (!recorder->vf || !recorder->bufferUsed) {
+		return true;
+	}
+	ssize_t written = recorder->vf->write(recorder->vf, recorder->buffer, recorder->bufferUsed);
+	bool ok = written == (ssize_t) recorder->bufferUsed;
+	recorder->bufferUsed = 0;
+	return ok;
+}
+
+void mDebuggerTraceRecorderAppend(struct mDebuggerTraceRecorder* recorder, const struct mDebuggerTraceState* state, uint64_t cycle) {
+	if (!recorder->vf) {
+		return;
+	}
+	if (recorder->bufferUsed + TRACE_RECORD_MAX_SIZE > mDEBUGGER_TRACE_BUFFER_SIZE) {
+		mDebuggerTraceRecorderFlush(recorder);
+	}
+
+	uint32_t changed = 0;
+	unsigned i;
+	for (i = 0; i < recorder->last.nRegisters; ++i) {
+		if (!recorder->hasLast || state->registers[i] != recorder->last.registers[i]) {
+			changed |= 1U << i;
+		}
+	}
+	uint64_t delta = recorder->hasLast ? cycle - recorder->lastCycle : cycle;
+
+	uint8_t* out = &recorder->buffer[recorder->bufferUsed];
+	STORE_32LE(state->address, 0, out);
+	STORE_32LE(state->opcode, 4, out);
+	STORE_32LE(changed, 8, out);
+	out += 12;
+	if (delta < TRACE_CYCLE_ESCAPE) {
+		STORE_32LE(delta, 0, out);
+		out += 4;
+	} else {
+		STORE_32LE(TRACE_CYCLE_ESCAPE, 0, out);
+		STORE_32LE(delta, 4, out);
+		STORE_32LE(delta >> 32, 8, out);
+		out += 12;
+	}
+	for (i = 0; i < recorder->last.nRegisters; ++i) {
+		if (changed & (1U << i)) {
+			STORE_32LE(state->registers[i], 0, out);
+			out += 4;
+			recorder->last.registers[i] = state->registers[i];
+		}
+	}
+	recorder->bufferUsed = out - recorder->buffer;
+	recorder->last.address = state->address;
+	recorder->last.opcode = state->opcode;
+	recorder->lastCycle = cycle;
+	recorder->hasLast = true;
+	++recorder->records;
+}
+
+bool mDebuggerTraceReaderOpen(struct mDebuggerTraceReader* reader, struct VFile* vf) {
+	memset(reader, 0, sizeof(*reader));
+	struct mDebuggerTraceHeader header;
+	vf->seek(vf, 0, SEEK_SET);
+	if (vf->read(vf, &header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	if (memcmp(header.magic, mTR_MAGIC, sizeof(header.magic)) != 0) {
+		return false;
+	}
+	uint32_t version;
+	uint32_t platform;
+	uint32_t nRegisters;
+	LOAD_32LE(version, 0, &header.version);
+	LOAD_32LE(platform, 0, &header.platform);
+	LOAD_32LE(nRegisters, 0, &header.nRegisters);
+	if (version != 0 || nRegisters > mDEBUGGER_TRACE_MAX_REGISTERS) {
+		return false;
+	}
+	reader->vf = vf;
+	reader->platform = platform;
+	reader->nRegisters = nRegisters;
+	reader->state.nRegisters = nRegisters;
+	return true;
+}
+
+void mDebuggerTraceReaderClose(struct mDebuggerTraceReader* reader) {
+	if (reader->vf) {
+		reader->vf->close(reader->vf);
+		reader->vf = NULL;
+	}
+}
+
+bool mDebuggerTraceReaderNext(struct mDebuggerTraceReader* reader) {
+	uint8_t buffer[TRACE_RECORD_MAX_SIZE];
+	if (!reader->vf || reader->vf->read(reader->vf, buffer, 16) != 16) {
+		return false;
+	}
+	uint32_t changed;
+	uint32_t delta32;
+	uint64_t delta;
+	LOAD_32LE(reader->state.address, 0, buffer);
+	LOAD_32LE(reader->state.opcode, 4, buffer);
+	LOAD_32LE(changed, 8, buffer);
+	LOAD_32LE(delta32, 12, buffer);
+	delta = delta32;
+	if (delta32 == TRACE_CYCLE_ESCAPE) {
+		if (reader->vf->read(reader->vf, buffer, 8) != 8) {
+			return false;
+		}
+		LOAD_32LE(delta32, 0, buffer);
+		delta = delta32;
+		LOAD_32LE(delta32, 4, buffer);
+		delta |= (uint64_t) delta32 << 32;
+	}
+
+	if (reader->nRegisters < 32) {
+		changed &= (1U << reader->nRegisters) - 1;
+	}
+	ssize_t size = popcount32(changed) * 4;
+	if (reader->vf->read(reader->vf, buffer, size) != size) {
+		return false;
+	}
+	unsigned i;
+	uint8_t* in = buffer;
+	for (i = 0; i < reader->nRegisters; ++i) {
+		if (changed & (1U << i)) {
+			LOAD_32LE(reader->state.registers[i], 0, in);
+			in += 4;
+		}
+	}
+	reader->cycle += delta;
+	++reader->index;
+	return true;
+}
+
+void mDebuggerTraceReaderFormat(const struct mDebuggerTraceReader* reader, char* out, size_t* length) {
+	size_t used = snprintf(out, *length, "%" PRIu64 " %08X %08X |", reader->cycle, reader->state.address, reader->state.opcode);
+	unsigned i;
+	for (i = 0; i < reader->nRegisters && used < *length; ++i) {
+		used += snprintf(out + used, *length - used, " %08X", reader->state.registers[i]);
+	}
+	if (used > *length) {
+		used = *length;
+	}
+	*length = used;
+}
@@ -8,6 +8,7 @@
 #include <mgba/core/cheats.h>
 #include <mgba/core/config.h>
 #include <mgba/core/core.h>
+#include <mgba/core/perf.h>
 #include <mgba/core/version.h>
 #include <mgba-util/string.h>
 #include <mgba-util/vfs.h>
@@ -47,6 +48,7 @@ static const struct option _options[] = {
 	{ "log-level", required_argument, 0, 'l' },
 	{ "savestate", required_argument, 0, 't' },
 	{ "patch",     required_argument, 0, 'p' },
+	{ "startup-trace", no_argument, 0, '\0' },
 	{ "version",   no_argument, 0, '\0' },
 	{ 0, 0, 0, 0 }
 };
@@ -125,6 +127,8 @@ bool mArgumentsParse(struct mArguments* args, int argc, char* const* argv, struc
 		case '\0':
 			if (strcmp(opt->name, "version") == 0) {
 				args->showVersion = true;
+			} else if (strcmp(opt->name, "startup-trace") == 0) {
+				mStartupTraceBegin();
 			} else {
 				for (i = 0; i < nSubparsers; ++i) {
 					if (subparsers[i].parseLong) {
@@ -184,6 +188,7 @@ bool mArgumentsParse(struct mArguments* args, int argc, char* const* argv, struc
 			break;
 		}
 	}
+	mStartupTraceMark("Parse arguments");
 	argc -= optind;
 	argv += optind;
 	if (argc > 1) {
@@ -362,6 +367,7 @@ void usage(const char* arg0, const char* prologue, const char* epilogue, const s
 	     "  -t, --savestate FILE       Load savestate when starting\n"
 	     "  -p, --patch FILE           Apply a specified patch file when running\n"
 	     "  -s, --frameskip N          Skip every N frames\n"
+	     "  --startup-trace            Print how long each startup phase takes once the first frame is done\n"
 	     "  --version                  Print version and exit"
 	);
 	int i;
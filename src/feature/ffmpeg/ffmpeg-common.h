@@ -14,6 +14,7 @@ CXX_GUARD_START
 
 #include <libavformat/avformat.h>
 #include <libavcodec/version.h>
+#include <libswscale/version.h>
 
 // Version 57.16 in FFmpeg
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 37, 100)
@@ -38,6 +39,16 @@ CXX_GUARD_START
 #define FFMPEG_USE_NEW_CH_LAYOUT
 #endif
 
+// Version 58.18 in FFmpeg, needed for avcodec_get_hw_config
+#if !defined(USE_LIBAV) && defined(FFMPEG_USE_CODECPAR) && LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 18, 100)
+#define FFMPEG_USE_HW_ENCODE
+#endif
+
+// Version 6.1 in FFmpeg, the first that can split frames between threads itself
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+#define FFMPEG_USE_SWS_THREADS
+#endif
+
 static inline enum AVPixelFormat mColorFormatToFFmpegPixFmt(enum mColorFormat format) {
 	switch (format) {
 #ifndef USE_LIBAV
@@ -4,6 +4,7 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "ffmpeg-encoder.h"
+#include "ffmpeg-scale.h"
 
 #include <mgba/core/core.h>
 #include <mgba/gba/interface.h>
@@ -26,6 +27,10 @@
 #include <libavutil/imgutils.h>
 #include <libavutil/mathematics.h>
 #include <libavutil/opt.h>
+#ifdef FFMPEG_USE_HW_ENCODE
+#include <libavutil/hwcontext.h>
+#include <libavutil/pixdesc.h>
+#endif
 
 #ifdef USE_LIBAVRESAMPLE
 #include <libavresample/avresample.h>
@@ -35,6 +40,7 @@
 #include <libswscale/swscale.h>
 
 static void _ffmpegPostVideoFrame(struct mAVStream*, const color_t* pixels, size_t stride);
+static void _ffmpegPostVideoFrameRepeat(struct mAVStream*, const color_t* pixels, size_t stride);
 static void _ffmpegPostAudioFrame(struct mAVStream*, int16_t left, int16_t right);
 static void _ffmpegSetVideoDimensions(struct mAVStream*, unsigned width, unsigned height);
 static void _ffmpegSetAudioRate(struct mAVStream*, unsigned rate);
@@ -44,8 +50,42 @@ static bool _ffmpegWriteVideoFrame(struct FFmpegEncoder* encoder, struct AVFrame
 
 static void _ffmpegOpenResampleContext(struct FFmpegEncoder* encoder);
 
+static void _ffmpegStartQueue(struct FFmpegEncoder* encoder);
+static void _ffmpegStopQueue(struct FFmpegEncoder* encoder);
+static void _ffmpegFlushQueue(struct FFmpegEncoder* encoder);
+
 enum {
-	PREFERRED_SAMPLE_RATE = 0x10000
+	PREFERRED_SAMPLE_RATE = 0x10000,
+	QUEUE_AUDIO_SAMPLES = 0x400,
+	HW_FRAME_POOL_SIZE = 20,
+};
+
+#ifdef FFMPEG_USE_HW_ENCODE
+// Tried in order when hardware acceleration is enabled, e.g. h264_nvenc
+static const char* const _hardwareEncoderSuffixes[] = {
+	"nvenc",
+	"qsv",
+	"vaapi",
+	"videotoolbox",
+	"amf",
+};
+#endif
+
+enum FFmpegEncoderItemType {
+	FFMPEG_ITEM_VIDEO,
+	FFMPEG_ITEM_AUDIO,
+};
+
+struct FFmpegEncoderItem {
+	struct FFmpegEncoderItem* next;
+	enum FFmpegEncoderItemType type;
+	// Video frames dropped right before this one, which still take up time in the output
+	unsigned dropped;
+	bool changed;
+	// Pixels per row for video, or stereo samples for audio
+	size_t length;
+	size_t capacity;
+	void* data;
 };
 
 void FFmpegEncoderInit(struct FFmpegEncoder* encoder) {
@@ -56,8 +96,11 @@ void FFmpegEncoderInit(struct FFmpegEncoder* encoder) {
 	encoder->d.videoDimensionsChanged = _ffmpegSetVideoDimensions;
 	encoder->d.audioRateChanged = _ffmpegSetAudioRate;
 	encoder->d.postVideoFrame = _ffmpegPostVideoFrame;
+	encoder->d.postVideoFrameRepeat = _ffmpegPostVideoFrameRepeat;
 	encoder->d.postAudioFrame = _ffmpegPostAudioFrame;
 	encoder->d.postAudioBuffer = NULL;
+	encoder->d.bufferPool = NULL;
+	encoder->d.postVideoBuffer = NULL;
 
 	encoder->audioCodec = NULL;
 	encoder->videoCodec = NULL;
@@ -90,6 +133,7 @@ void FFmpegEncoderInit(struct FFmpegEncoder* encoder) {
 	encoder->absf = NULL;
 	encoder->context = NULL;
 	encoder->scaleContext = NULL;
+	encoder->scaleBuffer = NULL;
 	encoder->audio = NULL;
 	encoder->audioStream = NULL;
 	encoder->audioFrame = NULL;
@@ -97,16 +141,38 @@ void FFmpegEncoderInit(struct FFmpegEncoder* encoder) {
 	encoder->video = NULL;
 	encoder->videoStream = NULL;
 	encoder->videoFrame = NULL;
+	encoder->videoFrameStale = true;
 	encoder->graph = NULL;
 	encoder->source = NULL;
 	encoder->sink = NULL;
 	encoder->sinkFrame = NULL;
+	encoder->hardwareAcceleration = false;
+	encoder->hardwareActive = false;
+	encoder->lowLatency = false;
+	encoder->network = false;
+	encoder->headerWritten = false;
+	encoder->hwDevice = NULL;
+	encoder->hwFrames = NULL;
+	encoder->hwFrame = NULL;
 	FFmpegEncoderSetInputFrameRate(encoder, VIDEO_TOTAL_LENGTH, GBA_ARM7TDMI_FREQUENCY);
 
 	int i;
 	for (i = 0; i < FFMPEG_FILTERS_MAX; ++i) {
 		encoder->filters[i] = NULL;
 	}
+
+	encoder->queueCapacity = FFMPEG_QUEUE_DEFAULT_CAPACITY;
+	encoder->queuePolicy = FFMPEG_QUEUE_BLOCK;
+	encoder->queueRunning = false;
+	encoder->queueHead = NULL;
+	encoder->queueTail = NULL;
+	encoder->queueFree = NULL;
+	encoder->audioItem = NULL;
+	encoder->queuedFrames = 0;
+	encoder->queuedItems = 0;
+	encoder->droppedFrames = 0;
+	encoder->queueStale = true;
+	memset(&encoder->queueStats, 0, sizeof(encoder->queueStats));
 }
 
 bool FFmpegEncoderSetAudio(struct FFmpegEncoder* encoder, const char* acodec, unsigned abr) {
@@ -214,6 +280,7 @@ bool FFmpegEncoderSetVideo(struct FFmpegEncoder* encoder, const char* vcodec, in
 		{ AV_PIX_FMT_YUV444P, 5 },
 		{ AV_PIX_FMT_YUV422P, 6 },
 		{ AV_PIX_FMT_YUV420P, 7 },
+		{ AV_PIX_FMT_NV12, 7 },
 		{ AV_PIX_FMT_PAL8, 8 },
 	};
 
@@ -239,11 +306,28 @@ bool FFmpegEncoderSetVideo(struct FFmpegEncoder* encoder, const char* vcodec, in
 			}
 		}
 	}
+	bool hardware = false;
+#ifdef FFMPEG_USE_HW_ENCODE
+	const AVCodecHWConfig* config;
+	for (i = 0; (config = avcodec_get_hw_config(codec, i)); ++i) {
+		if (config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_FRAMES_CTX) {
+			hardware = true;
+			break;
+		}
+	}
+	if (hardware && encoder->pixFormat == AV_PIX_FMT_NONE) {
+		// Encoders like VA-API only take hardware frames, which are uploaded from NV12
+		encoder->pixFormat = AV_PIX_FMT_NV12;
+	}
+#endif
 	if (encoder->pixFormat == AV_PIX_FMT_NONE) {
 		return false;
 	}
 	if (vbr < 0 && !av_opt_find((void*) &codec->priv_class, "crf", NULL, 0, 0)) {
-		return false;
+		// Hardware encoders generally have a constant quantizer mode instead
+		if (!hardware || !av_opt_find((void*) &codec->priv_class, "qp", NULL, 0, 0)) {
+			return false;
+		}
 	}
 	encoder->videoCodec = vcodec;
 	encoder->videoBitrate = vbr;
@@ -269,6 +353,49 @@ void FFmpegEncoderSetLooping(struct FFmpegEncoder* encoder, bool loop) {
 	encoder->loop = loop;
 }
 
+void FFmpegEncoderSetHardwareAcceleration(struct FFmpegEncoder* encoder, bool enable) {
+	encoder->hardwareAcceleration = enable;
+}
+
+void FFmpegEncoderSetLowLatency(struct FFmpegEncoder* encoder, bool enable) {
+	encoder->lowLatency = enable;
+}
+
+static void _ffmpegSetLowLatency(struct FFmpegEncoder* encoder) {
+	// B-frames and lookahead both hold frames back until later ones arrive
+	encoder->video->max_b_frames = 0;
+	encoder->video->flags |= AV_CODEC_FLAG_LOW_DELAY;
+	// Keyframes once a second let viewers join or recover from loss quickly
+	encoder->video->gop_size = encoder->cycles / (encoder->frameCycles * encoder->frameskip);
+	if (encoder->video->gop_size < 1) {
+		encoder->video->gop_size = 1;
+	}
+	// Not every encoder has these, in which case setting them just fails
+	av_opt_set(encoder->video->priv_data, "tune", "zerolatency", 0);
+	av_opt_set_int(encoder->video->priv_data, "zerolatency", 1, 0);
+	av_opt_set_int(encoder->video->priv_data, "delay", 0, 0);
+	av_opt_set_int(encoder->video->priv_data, "lag-in-frames", 0, 0);
+	av_opt_set_int(encoder->video->priv_data, "rc-lookahead", 0, 0);
+	av_opt_set_int(encoder->video->priv_data, "async_depth", 1, 0);
+}
+
+void FFmpegEncoderSetQueue(struct FFmpegEncoder* encoder, size_t capacity, enum FFmpegEncoderQueuePolicy policy) {
+	encoder->queueCapacity = capacity;
+	encoder->queuePolicy = policy;
+}
+
+void FFmpegEncoderGetQueueStats(struct FFmpegEncoder* encoder, struct FFmpegEncoderQueueStats* stats) {
+#ifndef DISABLE_THREADING
+	if (encoder->queueRunning) {
+		MutexLock(&encoder->queueMutex);
+		*stats = encoder->queueStats;
+		MutexUnlock(&encoder->queueMutex);
+		return;
+	}
+#endif
+	*stats = encoder->queueStats;
+}
+
 bool FFmpegEncoderVerifyContainer(struct FFmpegEncoder* encoder) {
 	const AVOutputFormat* oformat = av_guess_format(encoder->containerFormat, 0, 0);
 	const AVCodec* acodec = avcodec_find_encoder_by_name(encoder->audioCodec);
@@ -285,6 +412,275 @@ bool FFmpegEncoderVerifyContainer(struct FFmpegEncoder* encoder) {
 	return true;
 }
 
+#ifdef FFMPEG_USE_HW_ENCODE
+static bool _ffmpegOpenHardwareCodec(struct FFmpegEncoder* encoder, const AVCodec* codec) {
+	encoder->video = avcodec_alloc_context3(codec);
+	if (!encoder->video) {
+		return false;
+	}
+	encoder->video->width = encoder->width;
+	encoder->video->height = encoder->height;
+	encoder->video->time_base = (AVRational) { encoder->frameCycles * encoder->frameskip, encoder->cycles };
+	encoder->video->framerate = (AVRational) { encoder->cycles, encoder->frameCycles * encoder->frameskip };
+	encoder->videoStream->time_base = encoder->video->time_base;
+	encoder->videoStream->avg_frame_rate = encoder->video->framerate;
+	encoder->video->gop_size = 60;
+	if (encoder->context->oformat->flags & AVFMT_GLOBALHEADER) {
+		encoder->video->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+	}
+	if (encoder->lowLatency) {
+		_ffmpegSetLowLatency(encoder);
+	}
+
+	const AVCodecHWConfig* config = NULL;
+	int i;
+	for (i = 0; (config = avcodec_get_hw_config(codec, i)); ++i) {
+		if (config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_FRAMES_CTX) {
+			break;
+		}
+	}
+	if (config) {
+		// Frames have to be uploaded to the device before the encoder can see them
+		if (av_hwdevice_ctx_create(&encoder->hwDevice, config->device_type, NULL, NULL, 0) < 0) {
+			goto fail;
+		}
+		encoder->hwFrames = av_hwframe_ctx_alloc(encoder->hwDevice);
+		if (!encoder->hwFrames) {
+			goto fail;
+		}
+		AVHWFramesContext* frames = (AVHWFramesContext*) encoder->hwFrames->data;
+		frames->format = config->pix_fmt;
+		frames->sw_format = AV_PIX_FMT_NV12;
+		frames->width = encoder->width;
+		frames->height = encoder->height;
+		frames->initial_pool_size = HW_FRAME_POOL_SIZE;
+		if (av_hwframe_ctx_init(encoder->hwFrames) < 0) {
+			goto fail;
+		}
+		encoder->video->pix_fmt = config->pix_fmt;
+		encoder->video->hw_frames_ctx = av_buffer_ref(encoder->hwFrames);
+	} else {
+		// Encoders like NVENC take system memory frames and upload them internally
+		encoder->video->pix_fmt = AV_PIX_FMT_NONE;
+		for (i = 0; codec->pix_fmts && codec->pix_fmts[i] != AV_PIX_FMT_NONE; ++i) {
+			const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(codec->pix_fmts[i]);
+			if (!desc || desc->flags & AV_PIX_FMT_FLAG_HWACCEL) {
+				continue;
+			}
+			if (codec->pix_fmts[i] == AV_PIX_FMT_NV12 || codec->pix_fmts[i] == AV_PIX_FMT_YUV420P) {
+				encoder->video->pix_fmt = codec->pix_fmts[i];
+				break;
+			}
+		}
+		if (encoder->video->pix_fmt == AV_PIX_FMT_NONE) {
+			goto fail;
+		}
+	}
+
+	if (encoder->videoBitrate > 0) {
+		encoder->video->bit_rate = encoder->videoBitrate;
+	} else if (av_opt_find(encoder->video->priv_data, "qp", NULL, 0, 0)) {
+		// There's no CRF, so map it onto a constant quantizer
+		av_opt_set_int(encoder->video->priv_data, "qp", -encoder->videoBitrate, 0);
+	}
+
+	if (avcodec_open2(encoder->video, codec, NULL) < 0) {
+		goto fail;
+	}
+	return true;
+
+fail:
+	avcodec_free_context(&encoder->video);
+	av_buffer_unref(&encoder->hwFrames);
+	av_buffer_unref(&encoder->hwDevice);
+	return false;
+}
+
+static bool _ffmpegOpenHardwareVideo(struct FFmpegEncoder* encoder, const AVCodec* vcodec) {
+	const char* prefix;
+	switch (vcodec->id) {
+	case AV_CODEC_ID_H264:
+		prefix = "h264";
+		break;
+	case AV_CODEC_ID_HEVC:
+		prefix = "hevc";
+		break;
+	default:
+		return false;
+	}
+
+	size_t i;
+	for (i = 0; i < sizeof(_hardwareEncoderSuffixes) / sizeof(*_hardwareEncoderSuffixes); ++i) {
+		char name[32];
+		snprintf(name, sizeof(name), "%s_%s", prefix, _hardwareEncoderSuffixes[i]);
+		if (strcmp(vcodec->name, name) == 0) {
+			// A hardware encoder was asked for by name, so it's the only one worth trying
+			return _ffmpegOpenHardwareCodec(encoder, vcodec);
+		}
+	}
+	if (!encoder->hardwareAcceleration) {
+		return false;
+	}
+	for (i = 0; i < sizeof(_hardwareEncoderSuffixes) / sizeof(*_hardwareEncoderSuffixes); ++i) {
+		char name[32];
+		snprintf(name, sizeof(name), "%s_%s", prefix, _hardwareEncoderSuffixes[i]);
+		const AVCodec* codec = avcodec_find_encoder_by_name(name);
+		if (!codec || !avformat_query_codec(encoder->context->oformat, codec->id, FF_COMPLIANCE_EXPERIMENTAL)) {
+			continue;
+		}
+		// Having the encoder compiled in doesn't mean the device exists, so fall through on failure
+		if (_ffmpegOpenHardwareCodec(encoder, codec)) {
+			return true;
+		}
+	}
+	return false;
+}
+#endif
+
+static bool _ffmpegOpenSoftwareVideo(struct FFmpegEncoder* encoder, const AVCodec* vcodec) {
+#ifdef FFMPEG_USE_CODECPAR
+	encoder->video = avcodec_alloc_context3(vcodec);
+#else
+	encoder->video = encoder->videoStream->codec;
+#endif
+	encoder->video->bit_rate = encoder->videoBitrate;
+	encoder->video->width = encoder->width;
+	encoder->video->height = encoder->height;
+	encoder->video->time_base = (AVRational) { encoder->frameCycles * encoder->frameskip, encoder->cycles };
+	encoder->video->framerate = (AVRational) { encoder->cycles, encoder->frameCycles * encoder->frameskip };
+	encoder->videoStream->time_base = encoder->video->time_base;
+	encoder->videoStream->avg_frame_rate = encoder->video->framerate;
+	encoder->video->pix_fmt = encoder->pixFormat;
+	encoder->video->gop_size = 60;
+	encoder->video->max_b_frames = 3;
+	if (encoder->context->oformat->flags & AVFMT_GLOBALHEADER) {
+#ifdef AV_CODEC_FLAG_GLOBAL_HEADER
+		encoder->video->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+#else
+		encoder->video->flags |= CODEC_FLAG_GLOBAL_HEADER;
+#endif
+	}
+
+	if (encoder->video->codec->id == AV_CODEC_ID_H264 &&
+	    (strcasecmp(encoder->containerFormat, "mp4") == 0 ||
+	        strcasecmp(encoder->containerFormat, "m4v") == 0 ||
+	        strcasecmp(encoder->containerFormat, "mov") == 0)) {
+		// QuickTime and a few other things require YUV420
+		encoder->video->pix_fmt = AV_PIX_FMT_YUV420P;
+	}
+	if (encoder->video->codec->id == AV_CODEC_ID_FFV1) {
+#if LIBAVCODEC_VERSION_MAJOR >= 57
+		av_opt_set(encoder->video->priv_data, "coder", "range_tab", 0);
+		av_opt_set_int(encoder->video->priv_data, "context", 1, 0);
+#endif
+		encoder->video->gop_size = 128;
+		encoder->video->level = 3;
+	}
+
+	if (encoder->video->codec->id == AV_CODEC_ID_PNG) {
+		encoder->video->compression_level = 8;
+	}
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 48, 100)
+	if (encoder->video->codec->id == AV_CODEC_ID_ZMBV) {
+		encoder->video->compression_level = 5;
+		encoder->video->pix_fmt = AV_PIX_FMT_BGR0;
+	}
+#endif
+	if (strcmp(vcodec->name, "libx264") == 0 || strcmp(vcodec->name, "libx264rgb") == 0) {
+		// Try to adaptively figure out when you can use a slower encoder
+		if (encoder->width * encoder->height > 1000000) {
+			av_opt_set(encoder->video->priv_data, "preset", "superfast", 0);
+		} else if (encoder->width * encoder->height > 500000) {
+			av_opt_set(encoder->video->priv_data, "preset", "veryfast", 0);
+		} else {
+			av_opt_set(encoder->video->priv_data, "preset", "faster", 0);
+		}
+		av_opt_set(encoder->video->priv_data, "tune", "zerolatency", 0);
+		if (encoder->videoBitrate == 0) {
+			av_opt_set(encoder->video->priv_data, "qp", "0", 0);
+			if (strcmp(vcodec->name, "libx264") == 0) {
+				encoder->video->pix_fmt = AV_PIX_FMT_YUV444P;
+			}
+		} else if (encoder->videoBitrate < 0) {
+			av_opt_set_int(encoder->video->priv_data, "crf", -encoder->videoBitrate, 0);
+		}
+	} else if (encoder->videoBitrate < 0) {
+		if (strcmp(vcodec->name, "libvpx") == 0 || strcmp(vcodec->name, "libvpx-vp9") == 0 || strcmp(vcodec->name, "libx265") == 0) {
+			av_opt_set_int(encoder->video->priv_data, "crf", -encoder->videoBitrate, 0);
+		} else {
+			return false;
+		}
+	}
+	if (strncmp(vcodec->name, "libvpx", 6) == 0) {
+		av_opt_set_int(encoder->video->priv_data, "cpu-used", 2, 0);
+		av_opt_set(encoder->video->priv_data, "deadline", "realtime", 0);
+	}
+	if (strcmp(vcodec->name, "libvpx-vp9") == 0 && encoder->videoBitrate == 0) {
+		av_opt_set_int(encoder->video->priv_data, "lossless", 1, 0);
+		av_opt_set_int(encoder->video->priv_data, "crf", 0, 0);
+		encoder->video->gop_size = 120;
+		encoder->video->pix_fmt = AV_PIX_FMT_GBRP;
+	}
+	if (strcmp(vcodec->name, "libwebp_anim") == 0 && encoder->videoBitrate == 0) {
+		av_opt_set(encoder->video->priv_data, "lossless", "1", 0);
+		encoder->video->pix_fmt = AV_PIX_FMT_RGB32;
+	}
+	if (encoder->lowLatency) {
+		_ffmpegSetLowLatency(encoder);
+		if (strcmp(vcodec->name, "libx264") == 0 || strcmp(vcodec->name, "libx264rgb") == 0) {
+			av_opt_set(encoder->video->priv_data, "preset", "ultrafast", 0);
+		} else if (strncmp(vcodec->name, "libvpx", 6) == 0) {
+			av_opt_set_int(encoder->video->priv_data, "cpu-used", 8, 0);
+		}
+	}
+
+	if (encoder->pixFormat == AV_PIX_FMT_PAL8) {
+		encoder->graph = avfilter_graph_alloc();
+
+		const struct AVFilter* source = avfilter_get_by_name("buffer");
+		const struct AVFilter* sink = avfilter_get_by_name("buffersink");
+		const struct AVFilter* split = avfilter_get_by_name("split");
+		const struct AVFilter* palettegen = avfilter_get_by_name("palettegen");
+		const struct AVFilter* paletteuse = avfilter_get_by_name("paletteuse");
+
+		if (!source || !sink || !split || !palettegen || !paletteuse || !encoder->graph) {
+			return false;
+		}
+
+		char args[256];
+		snprintf(args, sizeof(args), "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d",
+		         encoder->video->width, encoder->video->height, encoder->ipixFormat,
+		         encoder->video->time_base.num, encoder->video->time_base.den);
+
+		int res = 0;
+		res |= avfilter_graph_create_filter(&encoder->source, source, NULL, args, NULL, encoder->graph);
+		res |= avfilter_graph_create_filter(&encoder->sink, sink, NULL, NULL, NULL, encoder->graph);
+		res |= avfilter_graph_create_filter(&encoder->filters[0], split, NULL, NULL, NULL, encoder->graph);
+		res |= avfilter_graph_create_filter(&encoder->filters[1], palettegen, NULL, "reserve_transparent=off", NULL, encoder->graph);
+		res |= avfilter_graph_create_filter(&encoder->filters[2], paletteuse, NULL, "dither=none", NULL, encoder->graph);
+		if (res < 0) {
+			return false;
+		}
+
+		res = 0;
+		res |= avfilter_link(encoder->source, 0, encoder->filters[0], 0);
+		res |= avfilter_link(encoder->filters[0], 0, encoder->filters[1], 0);
+		res |= avfilter_link(encoder->filters[0], 1, encoder->filters[2], 0);
+		res |= avfilter_link(encoder->filters[1], 0, encoder->filters[2], 1);
+		res |= avfilter_link(encoder->filters[2], 0, encoder->sink, 0);
+		if (res < 0 || avfilter_graph_config(encoder->graph, NULL) < 0) {
+			return false;
+		}
+
+		encoder->sinkFrame = av_frame_alloc();
+	}
+	AVDictionary* opts = 0;
+	av_dict_set(&opts, "strict", "-2", 0);
+	int res = avcodec_open2(encoder->video, vcodec, &opts);
+	av_dict_free(&opts);
+	return res >= 0;
+}
+
 bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 	const AVCodec* acodec = avcodec_find_encoder_by_name(encoder->audioCodec);
 	const AVCodec* vcodec = avcodec_find_encoder_by_name(encoder->videoCodec);
@@ -300,8 +696,16 @@ bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 	encoder->currentAudioFrame = 0;
 	encoder->currentVideoFrame = 0;
 	encoder->skipResidue = 0;
+	encoder->hardwareActive = false;
+	encoder->headerWritten = false;
+	memset(&encoder->queueStats, 0, sizeof(encoder->queueStats));
 
 	const AVOutputFormat* oformat = av_guess_format(encoder->containerFormat, 0, 0);
+	if (strstr(outfile, "://")) {
+		// Things like RTMP and SRT URLs need the network brought up first
+		avformat_network_init();
+		encoder->network = true;
+	}
 #ifndef USE_LIBAV
 	avformat_alloc_output_context2(&encoder->context, (AVOutputFormat*) oformat, 0, outfile);
 #else
@@ -379,148 +783,24 @@ bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 	if (vcodec) {
 #ifdef FFMPEG_USE_CODECPAR
 		encoder->videoStream = avformat_new_stream(encoder->context, NULL);
-		encoder->video = avcodec_alloc_context3(vcodec);
 #else
 		encoder->videoStream = avformat_new_stream(encoder->context, vcodec);
-		encoder->video = encoder->videoStream->codec;
-#endif
-		encoder->video->bit_rate = encoder->videoBitrate;
-		encoder->video->width = encoder->width;
-		encoder->video->height = encoder->height;
-		encoder->video->time_base = (AVRational) { encoder->frameCycles * encoder->frameskip, encoder->cycles };
-		encoder->video->framerate = (AVRational) { encoder->cycles, encoder->frameCycles * encoder->frameskip };
-		encoder->videoStream->time_base = encoder->video->time_base;
-		encoder->videoStream->avg_frame_rate = encoder->video->framerate;
-		encoder->video->pix_fmt = encoder->pixFormat;
-		encoder->video->gop_size = 60;
-		encoder->video->max_b_frames = 3;
-		if (encoder->context->oformat->flags & AVFMT_GLOBALHEADER) {
-#ifdef AV_CODEC_FLAG_GLOBAL_HEADER
-			encoder->video->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
-#else
-			encoder->video->flags |= CODEC_FLAG_GLOBAL_HEADER;
-#endif
-		}
-
-		if (encoder->video->codec->id == AV_CODEC_ID_H264 &&
-		    (strcasecmp(encoder->containerFormat, "mp4") == 0 ||
-		        strcasecmp(encoder->containerFormat, "m4v") == 0 ||
-		        strcasecmp(encoder->containerFormat, "mov") == 0)) {
-			// QuickTime and a few other things require YUV420
-			encoder->video->pix_fmt = AV_PIX_FMT_YUV420P;
-		}
-		if (encoder->video->codec->id == AV_CODEC_ID_FFV1) {
-#if LIBAVCODEC_VERSION_MAJOR >= 57
-			av_opt_set(encoder->video->priv_data, "coder", "range_tab", 0);
-			av_opt_set_int(encoder->video->priv_data, "context", 1, 0);
 #endif
-			encoder->video->gop_size = 128;
-			encoder->video->level = 3;
-		}
-
-		if (encoder->video->codec->id == AV_CODEC_ID_PNG) {
-			encoder->video->compression_level = 8;
-		}
-#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 48, 100)
-		if (encoder->video->codec->id == AV_CODEC_ID_ZMBV) {
-			encoder->video->compression_level = 5;
-			encoder->video->pix_fmt = AV_PIX_FMT_BGR0;
-		}
+#ifdef FFMPEG_USE_HW_ENCODE
+		encoder->hardwareActive = _ffmpegOpenHardwareVideo(encoder, vcodec);
 #endif
-		if (strcmp(vcodec->name, "libx264") == 0 || strcmp(vcodec->name, "libx264rgb") == 0) {
-			// Try to adaptively figure out when you can use a slower encoder
-			if (encoder->width * encoder->height > 1000000) {
-				av_opt_set(encoder->video->priv_data, "preset", "superfast", 0);
-			} else if (encoder->width * encoder->height > 500000) {
-				av_opt_set(encoder->video->priv_data, "preset", "veryfast", 0);
-			} else {
-				av_opt_set(encoder->video->priv_data, "preset", "faster", 0);
-			}
-			av_opt_set(encoder->video->priv_data, "tune", "zerolatency", 0);
-			if (encoder->videoBitrate == 0) {
-				av_opt_set(encoder->video->priv_data, "qp", "0", 0);
-				if (strcmp(vcodec->name, "libx264") == 0) {
-					encoder->video->pix_fmt = AV_PIX_FMT_YUV444P;
-				}
-			} else if (encoder->videoBitrate < 0) {
-				av_opt_set_int(encoder->video->priv_data, "crf", -encoder->videoBitrate, 0);
-			}
-		} else if (encoder->videoBitrate < 0) {
-			if (strcmp(vcodec->name, "libvpx") == 0 || strcmp(vcodec->name, "libvpx-vp9") == 0 || strcmp(vcodec->name, "libx265") == 0) {
-				av_opt_set_int(encoder->video->priv_data, "crf", -encoder->videoBitrate, 0);
-			} else {
-				FFmpegEncoderClose(encoder);
-				return false;
-			}
-		}
-		if (strncmp(vcodec->name, "libvpx", 6) == 0) {
-			av_opt_set_int(encoder->video->priv_data, "cpu-used", 2, 0);
-			av_opt_set(encoder->video->priv_data, "deadline", "realtime", 0);
-		}
-		if (strcmp(vcodec->name, "libvpx-vp9") == 0 && encoder->videoBitrate == 0) {
-			av_opt_set_int(encoder->video->priv_data, "lossless", 1, 0);
-			av_opt_set_int(encoder->video->priv_data, "crf", 0, 0);
-			encoder->video->gop_size = 120;
-			encoder->video->pix_fmt = AV_PIX_FMT_GBRP;
-		}
-		if (strcmp(vcodec->name, "libwebp_anim") == 0 && encoder->videoBitrate == 0) {
-			av_opt_set(encoder->video->priv_data, "lossless", "1", 0);
-			encoder->video->pix_fmt = AV_PIX_FMT_RGB32;
-		}
-
-		if (encoder->pixFormat == AV_PIX_FMT_PAL8) {
-			encoder->graph = avfilter_graph_alloc();
-
-			const struct AVFilter* source = avfilter_get_by_name("buffer");
-			const struct AVFilter* sink = avfilter_get_by_name("buffersink");
-			const struct AVFilter* split = avfilter_get_by_name("split");
-			const struct AVFilter* palettegen = avfilter_get_by_name("palettegen");
-			const struct AVFilter* paletteuse = avfilter_get_by_name("paletteuse");
-
-			if (!source || !sink || !split || !palettegen || !paletteuse || !encoder->graph) {
-				FFmpegEncoderClose(encoder);
-				return false;
-			}
-
-			char args[256];
-			snprintf(args, sizeof(args), "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d",
-			         encoder->video->width, encoder->video->height, encoder->ipixFormat,
-			         encoder->video->time_base.num, encoder->video->time_base.den);
-
-			int res = 0;
-			res |= avfilter_graph_create_filter(&encoder->source, source, NULL, args, NULL, encoder->graph);
-			res |= avfilter_graph_create_filter(&encoder->sink, sink, NULL, NULL, NULL, encoder->graph);
-			res |= avfilter_graph_create_filter(&encoder->filters[0], split, NULL, NULL, NULL, encoder->graph);
-			res |= avfilter_graph_create_filter(&encoder->filters[1], palettegen, NULL, "reserve_transparent=off", NULL, encoder->graph);
-			res |= avfilter_graph_create_filter(&encoder->filters[2], paletteuse, NULL, "dither=none", NULL, encoder->graph);
-			if (res < 0) {
-				FFmpegEncoderClose(encoder);
-				return false;
-			}
-
-			res = 0;
-			res |= avfilter_link(encoder->source, 0, encoder->filters[0], 0);
-			res |= avfilter_link(encoder->filters[0], 0, encoder->filters[1], 0);
-			res |= avfilter_link(encoder->filters[0], 1, encoder->filters[2], 0);
-			res |= avfilter_link(encoder->filters[1], 0, encoder->filters[2], 1);
-			res |= avfilter_link(encoder->filters[2], 0, encoder->sink, 0);
-			if (res < 0 || avfilter_graph_config(encoder->graph, NULL) < 0) {
-				FFmpegEncoderClose(encoder);
-				return false;
-			}
-
-			encoder->sinkFrame = av_frame_alloc();
-		}
-		AVDictionary* opts = 0;
-		av_dict_set(&opts, "strict", "-2", 0);
-		int res = avcodec_open2(encoder->video, vcodec, &opts);
-		av_dict_free(&opts);
-		if (res < 0) {
+		if (!encoder->hardwareActive && !_ffmpegOpenSoftwareVideo(encoder, vcodec)) {
 			FFmpegEncoderClose(encoder);
 			return false;
 		}
 		encoder->videoFrame = av_frame_alloc();
 		encoder->videoFrame->format = encoder->video->pix_fmt != AV_PIX_FMT_PAL8 ? encoder->video->pix_fmt : encoder->ipixFormat;
+#ifdef FFMPEG_USE_HW_ENCODE
+		if (encoder->hwFrames) {
+			encoder->videoFrame->format = ((AVHWFramesContext*) encoder->hwFrames->data)->sw_format;
+			encoder->hwFrame = av_frame_alloc();
+		}
+#endif
 		encoder->videoFrame->width = encoder->video->width;
 		encoder->videoFrame->height = encoder->video->height;
 		encoder->videoFrame->pts = 0;
@@ -539,18 +819,36 @@ bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 		av_opt_set(encoder->context->priv_data, "loop", encoder->loop ? "0" : "1", 0);
 	}
 
+	if (encoder->lowLatency) {
+		// Packets go out as soon as they're written instead of waiting to be interleaved
+		encoder->context->flags |= AVFMT_FLAG_FLUSH_PACKETS;
+		encoder->context->max_interleave_delta = 0;
+	}
+
 	AVDictionary* opts = 0;
 	av_dict_set(&opts, "strict", "-2", 0);
-	bool res = avio_open(&encoder->context->pb, outfile, AVIO_FLAG_WRITE) < 0 || avformat_write_header(encoder->context, &opts) < 0;
+	bool res = false;
+	// Some muxers, like RTSP, do their own I/O
+	if (!(encoder->context->oformat->flags & AVFMT_NOFILE)) {
+		res = avio_open(&encoder->context->pb, outfile, AVIO_FLAG_WRITE) < 0;
+	}
+	if (!res) {
+		res = avformat_write_header(encoder->context, &opts) < 0;
+		encoder->headerWritten = !res;
+	}
 	av_dict_free(&opts);
 	if (res) {
 		FFmpegEncoderClose(encoder);
 		return false;
 	}
+	_ffmpegStartQueue(encoder);
 	return true;
 }
 
 void FFmpegEncoderClose(struct FFmpegEncoder* encoder) {
+	// Everything already posted still gets encoded
+	_ffmpegStopQueue(encoder);
+
 	if (encoder->audio) {
 		while (true) {
 			if (!_ffmpegWriteAudioFrame(encoder, NULL)) {
@@ -578,10 +876,13 @@ void FFmpegEncoderClose(struct FFmpegEncoder* encoder) {
 		}
 	}
 
-	if (encoder->context && encoder->context->pb) {
+	if (encoder->context && encoder->headerWritten) {
 		av_write_trailer(encoder->context);
-		avio_close(encoder->context->pb);
 	}
+	if (encoder->context && encoder->context->pb) {
+		avio_closep(&encoder->context->pb);
+	}
+	encoder->headerWritten = false;
 
 	if (encoder->audioBuffer) {
 		av_free(encoder->audioBuffer);
@@ -627,6 +928,12 @@ void FFmpegEncoderClose(struct FFmpegEncoder* encoder) {
 		encoder->sinkFrame = NULL;
 	}
 
+#ifdef FFMPEG_USE_HW_ENCODE
+	if (encoder->hwFrame) {
+		av_frame_free(&encoder->hwFrame);
+	}
+#endif
+
 	if (encoder->video) {
 #ifdef FFMPEG_USE_CODECPAR
 		avcodec_free_context(&encoder->video);
@@ -636,10 +943,16 @@ void FFmpegEncoderClose(struct FFmpegEncoder* encoder) {
 #endif
 	}
 
+#ifdef FFMPEG_USE_HW_ENCODE
+	av_buffer_unref(&encoder->hwFrames);
+	av_buffer_unref(&encoder->hwDevice);
+#endif
+
 	if (encoder->scaleContext) {
 		sws_freeContext(encoder->scaleContext);
 		encoder->scaleContext = NULL;
 	}
+	av_freep(&encoder->scaleBuffer);
 
 	if (encoder->graph) {
 		avfilter_graph_free(&encoder->graph);
@@ -657,18 +970,22 @@ void FFmpegEncoderClose(struct FFmpegEncoder* encoder) {
 		avformat_free_context(encoder->context);
 		encoder->context = NULL;
 	}
+
+	if (encoder->network) {
+		avformat_network_deinit();
+		encoder->network = false;
+	}
 }
 
 bool FFmpegEncoderIsOpen(struct FFmpegEncoder* encoder) {
 	return !!encoder->context;
 }
 
-void _ffmpegPostAudioFrame(struct mAVStream* stream, int16_t left, int16_t right) {
-	struct FFmpegEncoder* encoder = (struct FFmpegEncoder*) stream;
-	if (!encoder->context || !encoder->audioCodec) {
-		return;
-	}
+bool FFmpegEncoderIsHardwareAccelerated(struct FFmpegEncoder* encoder) {
+	return encoder->hardwareActive;
+}
 
+static void _ffmpegEncodeAudioSample(struct FFmpegEncoder* encoder, int16_t left, int16_t right) {
 	if (encoder->absf && !left) {
 		// XXX: AVBSF doesn't like silence. Figure out why.
 		left = 1;
@@ -784,15 +1101,24 @@ bool _ffmpegWriteAudioFrame(struct FFmpegEncoder* encoder, struct AVFrame* audio
 	return gotData;
 }
 
-void _ffmpegPostVideoFrame(struct mAVStream* stream, const color_t* pixels, size_t stride) {
-	struct FFmpegEncoder* encoder = (struct FFmpegEncoder*) stream;
-	if (!encoder->context || !encoder->videoCodec) {
+static void _ffmpegScaleVideoFrame(struct FFmpegEncoder* encoder, const color_t* pixels, size_t stride) {
+	AVFrame* frame = encoder->videoFrame;
+	if (!encoder->scaleIntegral) {
+		sws_scale(encoder->scaleContext, (const uint8_t* const*) &pixels, (const int*) &stride, 0, encoder->iheight, frame->data, frame->linesize);
 		return;
 	}
-	encoder->skipResidue = (encoder->skipResidue + 1) % encoder->frameskip;
-	if (encoder->skipResidue) {
+	if (!encoder->scaleContext) {
+		// The output is in the same format, so swscale isn't needed at all
+		FFmpegScaleInteger(pixels, encoder->iwidth, encoder->iheight, stride, frame->data[0], frame->width, frame->height, frame->linesize[0], BYTES_PER_PIXEL);
 		return;
 	}
+	// Scaling up first leaves swscale only the colorspace conversion, which it has much faster paths for
+	int scaledStride = frame->width * BYTES_PER_PIXEL;
+	FFmpegScaleInteger(pixels, encoder->iwidth, encoder->iheight, stride, encoder->scaleBuffer, frame->width, frame->height, scaledStride, BYTES_PER_PIXEL);
+	sws_scale(encoder->scaleContext, (const uint8_t* const*) &encoder->scaleBuffer, &scaledStride, 0, frame->height, frame->data, frame->linesize);
+}
+
+static void _ffmpegEncodeVideoFrame(struct FFmpegEncoder* encoder, const color_t* pixels, size_t stride) {
 	stride *= BYTES_PER_PIXEL;
 
 	av_frame_make_writable(encoder->videoFrame);
@@ -804,7 +1130,11 @@ void _ffmpegPostVideoFrame(struct mAVStream* stream, const color_t* pixels, size
 	}
 	++encoder->currentVideoFrame;
 
-	sws_scale(encoder->scaleContext, (const uint8_t* const*) &pixels, (const int*) &stride, 0, encoder->iheight, encoder->videoFrame->data, encoder->videoFrame->linesize);
+	// Repeated frames reuse the last conversion, since making the frame writable keeps its contents
+	if (encoder->videoFrameStale) {
+		_ffmpegScaleVideoFrame(encoder, pixels, stride);
+		encoder->videoFrameStale = false;
+	}
 
 	if (encoder->graph) {
 		if (av_buffersrc_write_frame(encoder->source, encoder->videoFrame) < 0) {
@@ -819,10 +1149,280 @@ void _ffmpegPostVideoFrame(struct mAVStream* stream, const color_t* pixels, size
 			av_frame_unref(encoder->sinkFrame);
 		}
 	} else {
+#ifdef FFMPEG_USE_HW_ENCODE
+		if (encoder->hwFrames) {
+			if (av_hwframe_get_buffer(encoder->hwFrames, encoder->hwFrame, 0) < 0) {
+				return;
+			}
+			if (av_hwframe_transfer_data(encoder->hwFrame, encoder->videoFrame, 0) < 0) {
+				av_frame_unref(encoder->hwFrame);
+				return;
+			}
+			encoder->hwFrame->pts = encoder->videoFrame->pts;
+			_ffmpegWriteVideoFrame(encoder, encoder->hwFrame);
+			av_frame_unref(encoder->hwFrame);
+			return;
+		}
+#endif
 		_ffmpegWriteVideoFrame(encoder, encoder->videoFrame);
 	}
 }
 
+#ifndef DISABLE_THREADING
+static struct FFmpegEncoderItem* _ffmpegTakeItem(struct FFmpegEncoder* encoder, size_t size) {
+	struct FFmpegEncoderItem* item = encoder->queueFree;
+	if (item) {
+		encoder->queueFree = item->next;
+	} else {
+		item = calloc(1, sizeof(*item));
+	}
+	if (item->capacity < size) {
+		free(item->data);
+		item->data = malloc(size);
+		item->capacity = size;
+	}
+	item->next = NULL;
+	item->dropped = 0;
+	item->changed = false;
+	item->length = 0;
+	return item;
+}
+
+static void _ffmpegQueueItem(struct FFmpegEncoder* encoder, struct FFmpegEncoderItem* item) {
+	if (encoder->queueTail) {
+		encoder->queueTail->next = item;
+	} else {
+		encoder->queueHead = item;
+	}
+	encoder->queueTail = item;
+	++encoder->queuedItems;
+	if (item->type == FFMPEG_ITEM_VIDEO) {
+		++encoder->queuedFrames;
+		encoder->queueStats.depth = encoder->queuedFrames;
+		if (encoder->queueStats.depth > encoder->queueStats.maxDepth) {
+			encoder->queueStats.maxDepth = encoder->queueStats.depth;
+		}
+	}
+	ConditionWake(&encoder->queueCond);
+}
+
+static void _ffmpegProcessItem(struct FFmpegEncoder* encoder, struct FFmpegEncoderItem* item) {
+	switch (item->type) {
+	case FFMPEG_ITEM_VIDEO:
+		encoder->currentVideoFrame += item->dropped;
+		if (item->changed) {
+			encoder->videoFrameStale = true;
+		}
+		_ffmpegEncodeVideoFrame(encoder, item->data, item->length);
+		break;
+	case FFMPEG_ITEM_AUDIO: {
+		const int16_t* samples = item->data;
+		size_t i;
+		for (i = 0; i < item->length; ++i) {
+			_ffmpegEncodeAudioSample(encoder, samples[i * 2], samples[i * 2 + 1]);
+		}
+		break;
+	}
+	}
+}
+
+static THREAD_ENTRY _ffmpegEncoderThread(void* context) {
+	struct FFmpegEncoder* encoder = context;
+	ThreadSetName("FFmpeg Encoder");
+
+	MutexLock(&encoder->queueMutex);
+	while (true) {
+		while (!encoder->queueHead && !encoder->queueQuit) {
+			ConditionWait(&encoder->queueCond, &encoder->queueMutex);
+		}
+		struct FFmpegEncoderItem* item = encoder->queueHead;
+		if (!item) {
+			break;
+		}
+		encoder->queueHead = item->next;
+		if (!encoder->queueHead) {
+			encoder->queueTail = NULL;
+		}
+		MutexUnlock(&encoder->queueMutex);
+
+		_ffmpegProcessItem(encoder, item);
+
+		MutexLock(&encoder->queueMutex);
+		--encoder->queuedItems;
+		if (item->type == FFMPEG_ITEM_VIDEO) {
+			--encoder->queuedFrames;
+			encoder->queueStats.depth = encoder->queuedFrames;
+		}
+		item->next = encoder->queueFree;
+		encoder->queueFree = item;
+		ConditionWake(&encoder->queueSpaceCond);
+	}
+	MutexUnlock(&encoder->queueMutex);
+	THREAD_EXIT(0);
+}
+#endif
+
+static void _ffmpegStartQueue(struct FFmpegEncoder* encoder) {
+	encoder->queueStale = true;
+	encoder->droppedFrames = 0;
+#ifndef DISABLE_THREADING
+	if (!encoder->queueCapacity) {
+		return;
+	}
+	MutexInit(&encoder->queueMutex);
+	ConditionInit(&encoder->queueCond);
+	ConditionInit(&encoder->queueSpaceCond);
+	encoder->queueQuit = false;
+	encoder->queueRunning = true;
+	ThreadCreate(&encoder->queueThread, _ffmpegEncoderThread, encoder);
+#endif
+}
+
+static void _ffmpegStopQueue(struct FFmpegEncoder* encoder) {
+#ifndef DISABLE_THREADING
+	if (!encoder->queueRunning) {
+		return;
+	}
+	MutexLock(&encoder->queueMutex);
+	if (encoder->audioItem) {
+		_ffmpegQueueItem(encoder, encoder->audioItem);
+		encoder->audioItem = NULL;
+	}
+	encoder->queueQuit = true;
+	ConditionWake(&encoder->queueCond);
+	MutexUnlock(&encoder->queueMutex);
+	ThreadJoin(&encoder->queueThread);
+	encoder->queueRunning = false;
+
+	while (encoder->queueFree) {
+		struct FFmpegEncoderItem* item = encoder->queueFree;
+		encoder->queueFree = item->next;
+		free(item->data);
+		free(item);
+	}
+	MutexDeinit(&encoder->queueMutex);
+	ConditionDeinit(&encoder->queueCond);
+	ConditionDeinit(&encoder->queueSpaceCond);
+#else
+	UNUSED(encoder);
+#endif
+}
+
+// Waits for everything posted so far to be encoded, so the encoder's state can be changed safely
+static void _ffmpegFlushQueue(struct FFmpegEncoder* encoder) {
+#ifndef DISABLE_THREADING
+	if (!encoder->queueRunning) {
+		return;
+	}
+	MutexLock(&encoder->queueMutex);
+	if (encoder->audioItem) {
+		_ffmpegQueueItem(encoder, encoder->audioItem);
+		encoder->audioItem = NULL;
+	}
+	while (encoder->queuedItems) {
+		ConditionWait(&encoder->queueSpaceCond, &encoder->queueMutex);
+	}
+	MutexUnlock(&encoder->queueMutex);
+#else
+	UNUSED(encoder);
+#endif
+}
+
+static void _ffmpegPostVideo(struct FFmpegEncoder* encoder, const color_t* pixels, size_t stride, bool changed) {
+	if (!encoder->context || !encoder->videoCodec) {
+		return;
+	}
+	if (changed) {
+		// The encoding thread owns videoFrameStale while the queue is running
+		if (encoder->queueRunning) {
+			encoder->queueStale = true;
+		} else {
+			encoder->videoFrameStale = true;
+		}
+	}
+	encoder->skipResidue = (encoder->skipResidue + 1) % encoder->frameskip;
+	if (encoder->skipResidue) {
+		return;
+	}
+
+#ifndef DISABLE_THREADING
+	if (encoder->queueRunning) {
+		MutexLock(&encoder->queueMutex);
+		while (encoder->queuedFrames >= encoder->queueCapacity && encoder->queuePolicy != FFMPEG_QUEUE_GROW) {
+			if (encoder->queuePolicy == FFMPEG_QUEUE_DROP) {
+				++encoder->droppedFrames;
+				++encoder->queueStats.dropped;
+				MutexUnlock(&encoder->queueMutex);
+				return;
+			}
+			ConditionWait(&encoder->queueSpaceCond, &encoder->queueMutex);
+		}
+		// Repeated frames only need their pixels if the frame they repeat never made it out
+		size_t size = encoder->queueStale ? encoder->iwidth * encoder->iheight * BYTES_PER_PIXEL : 0;
+		struct FFmpegEncoderItem* item = _ffmpegTakeItem(encoder, size);
+		MutexUnlock(&encoder->queueMutex);
+
+		item->type = FFMPEG_ITEM_VIDEO;
+		item->dropped = encoder->droppedFrames;
+		item->changed = encoder->queueStale;
+		item->length = encoder->iwidth;
+		if (item->changed) {
+			size_t y;
+			for (y = 0; y < (size_t) encoder->iheight; ++y) {
+				memcpy((color_t*) item->data + y * encoder->iwidth, &pixels[y * stride], encoder->iwidth * BYTES_PER_PIXEL);
+			}
+		}
+		encoder->droppedFrames = 0;
+		encoder->queueStale = false;
+
+		MutexLock(&encoder->queueMutex);
+		_ffmpegQueueItem(encoder, item);
+		MutexUnlock(&encoder->queueMutex);
+		return;
+	}
+#endif
+	_ffmpegEncodeVideoFrame(encoder, pixels, stride);
+}
+
+void _ffmpegPostVideoFrame(struct mAVStream* stream, const color_t* pixels, size_t stride) {
+	_ffmpegPostVideo((struct FFmpegEncoder*) stream, pixels, stride, true);
+}
+
+void _ffmpegPostVideoFrameRepeat(struct mAVStream* stream, const color_t* pixels, size_t stride) {
+	_ffmpegPostVideo((struct FFmpegEncoder*) stream, pixels, stride, false);
+}
+
+void _ffmpegPostAudioFrame(struct mAVStream* stream, int16_t left, int16_t right) {
+	struct FFmpegEncoder* encoder = (struct FFmpegEncoder*) stream;
+	if (!encoder->context || !encoder->audioCodec) {
+		return;
+	}
+#ifndef DISABLE_THREADING
+	if (encoder->queueRunning) {
+		// Samples are batched up so the queue isn't hit once per sample
+		if (!encoder->audioItem) {
+			MutexLock(&encoder->queueMutex);
+			encoder->audioItem = _ffmpegTakeItem(encoder, QUEUE_AUDIO_SAMPLES * 2 * sizeof(int16_t));
+			MutexUnlock(&encoder->queueMutex);
+			encoder->audioItem->type = FFMPEG_ITEM_AUDIO;
+		}
+		struct FFmpegEncoderItem* item = encoder->audioItem;
+		int16_t* samples = item->data;
+		samples[item->length * 2] = left;
+		samples[item->length * 2 + 1] = right;
+		++item->length;
+		if (item->length == QUEUE_AUDIO_SAMPLES) {
+			MutexLock(&encoder->queueMutex);
+			_ffmpegQueueItem(encoder, item);
+			encoder->audioItem = NULL;
+			MutexUnlock(&encoder->queueMutex);
+		}
+		return;
+	}
+#endif
+	_ffmpegEncodeAudioSample(encoder, left, right);
+}
+
 bool _ffmpegWriteVideoFrame(struct FFmpegEncoder* encoder, struct AVFrame* videoFrame) {
 	AVPacket* packet;
 
@@ -867,14 +1467,28 @@ static void _ffmpegSetVideoDimensions(struct mAVStream* stream, unsigned width,
 	if (!encoder->context || !encoder->videoCodec) {
 		return;
 	}
+	_ffmpegFlushQueue(encoder);
 	encoder->iwidth = width;
 	encoder->iheight = height;
+	encoder->videoFrameStale = true;
+	encoder->queueStale = true;
 	if (encoder->scaleContext) {
 		sws_freeContext(encoder->scaleContext);
+		encoder->scaleContext = NULL;
+	}
+	av_freep(&encoder->scaleBuffer);
+
+	int owidth = encoder->videoFrame->width;
+	int oheight = encoder->videoFrame->height;
+	encoder->scaleIntegral = encoder->iwidth > 0 && encoder->iheight > 0 && owidth >= encoder->iwidth && oheight >= encoder->iheight && !(owidth % encoder->iwidth) && !(oheight % encoder->iheight);
+	if (!encoder->scaleIntegral) {
+		encoder->scaleContext = FFmpegScaleCreateContext(encoder->iwidth, encoder->iheight, encoder->ipixFormat,
+		    owidth, oheight, encoder->videoFrame->format, SWS_POINT);
+	} else if (encoder->videoFrame->format != encoder->ipixFormat) {
+		encoder->scaleBuffer = av_malloc((size_t) owidth * oheight * BYTES_PER_PIXEL);
+		encoder->scaleContext = FFmpegScaleCreateContext(owidth, oheight, encoder->ipixFormat,
+		    owidth, oheight, encoder->videoFrame->format, SWS_POINT);
 	}
-	encoder->scaleContext = sws_getContext(encoder->iwidth, encoder->iheight, encoder->ipixFormat,
-	    encoder->videoFrame->width, encoder->videoFrame->height, encoder->videoFrame->format,
-	    SWS_POINT, 0, 0, 0);
 }
 
 static void _ffmpegSetAudioRate(struct mAVStream* stream, unsigned rate) {
@@ -892,6 +1506,7 @@ void FFmpegEncoderSetInputFrameRate(struct FFmpegEncoder* encoder, int numerator
 }
 
 void FFmpegEncoderSetInputSampleRate(struct FFmpegEncoder* encoder, int sampleRate) {
+	_ffmpegFlushQueue(encoder);
 	encoder->isampleRate = sampleRate;
 	if (encoder->resampleContext) {	
 		av_freep(&encoder->audioBuffer);
@@ -11,10 +11,29 @@
 CXX_GUARD_START
 
 #include <mgba/core/interface.h>
+#include <mgba-util/threading.h>
 
 #include "feature/ffmpeg/ffmpeg-common.h"
 
 #define FFMPEG_FILTERS_MAX 4
+#define FFMPEG_QUEUE_DEFAULT_CAPACITY 8
+
+enum FFmpegEncoderQueuePolicy {
+	// Wait for the encoder to catch up, slowing down emulation
+	FFMPEG_QUEUE_BLOCK = 0,
+	// Skip frames, which stretches the previous frame in the output
+	FFMPEG_QUEUE_DROP,
+	// Keep queueing frames, using as much memory as it takes
+	FFMPEG_QUEUE_GROW,
+};
+
+struct FFmpegEncoderQueueStats {
+	size_t depth;
+	size_t maxDepth;
+	uint64_t dropped;
+};
+
+struct FFmpegEncoderItem;
 
 struct FFmpegEncoder {
 	struct mAVStream d;
@@ -52,6 +71,8 @@ struct FFmpegEncoder {
 	enum AVPixelFormat pixFormat;
 	enum AVPixelFormat ipixFormat;
 	AVFrame* videoFrame;
+	// Whether videoFrame no longer holds the most recent frame posted
+	bool videoFrameStale;
 	int width;
 	int height;
 	int iwidth;
@@ -62,15 +83,52 @@ struct FFmpegEncoder {
 	int frameskip;
 	int skipResidue;
 	bool loop;
+	// Trade compression for getting each frame out as soon as it's encoded, for live streaming
+	bool lowLatency;
+	// Whether outfile was a network URL, so the network has to be shut down again afterwards
+	bool network;
+	bool headerWritten;
 	int64_t currentVideoFrame;
 	struct SwsContext* scaleContext;
+	// Whole-number scales are done without swscale, which then only converts the result if needed
+	bool scaleIntegral;
+	uint8_t* scaleBuffer;
 	struct AVStream* videoStream;
 
+	// Whether to try hardware encoders for H.264 and HEVC before the software ones
+	bool hardwareAcceleration;
+	bool hardwareActive;
+	struct AVBufferRef* hwDevice;
+	struct AVBufferRef* hwFrames;
+	struct AVFrame* hwFrame;
+
 	struct AVFilterGraph* graph;
 	struct AVFilterContext* source;
 	struct AVFilterContext* sink;
 	struct AVFilterContext* filters[FFMPEG_FILTERS_MAX];
 	struct AVFrame* sinkFrame;
+
+	// Frames are handed to an encoding thread through this queue, unless queueCapacity is 0
+	size_t queueCapacity;
+	enum FFmpegEncoderQueuePolicy queuePolicy;
+	bool queueRunning;
+#ifndef DISABLE_THREADING
+	Thread queueThread;
+	Mutex queueMutex;
+	Condition queueCond;
+	Condition queueSpaceCond;
+	bool queueQuit;
+#endif
+	struct FFmpegEncoderItem* queueHead;
+	struct FFmpegEncoderItem* queueTail;
+	struct FFmpegEncoderItem* queueFree;
+	struct FFmpegEncoderItem* audioItem;
+	size_t queuedFrames;
+	size_t queuedItems;
+	unsigned droppedFrames;
+	// Whether the next queued frame has to carry its pixels, even if it's a repeat
+	bool queueStale;
+	struct FFmpegEncoderQueueStats queueStats;
 };
 
 void FFmpegEncoderInit(struct FFmpegEncoder*);
@@ -81,10 +139,15 @@ void FFmpegEncoderSetDimensions(struct FFmpegEncoder*, int width, int height);
 void FFmpegEncoderSetInputFrameRate(struct FFmpegEncoder*, int numerator, int denominator);
 void FFmpegEncoderSetInputSampleRate(struct FFmpegEncoder*, int sampleRate);
 void FFmpegEncoderSetLooping(struct FFmpegEncoder*, bool loop);
+void FFmpegEncoderSetHardwareAcceleration(struct FFmpegEncoder*, bool enable);
+void FFmpegEncoderSetLowLatency(struct FFmpegEncoder*, bool enable);
+void FFmpegEncoderSetQueue(struct FFmpegEncoder*, size_t capacity, enum FFmpegEncoderQueuePolicy policy);
+void FFmpegEncoderGetQueueStats(struct FFmpegEncoder*, struct FFmpegEncoderQueueStats*);
 bool FFmpegEncoderVerifyContainer(struct FFmpegEncoder*);
 bool FFmpegEncoderOpen(struct FFmpegEncoder*, const char* outfile);
 void FFmpegEncoderClose(struct FFmpegEncoder*);
 bool FFmpegEncoderIsOpen(struct FFmpegEncoder*);
+bool FFmpegEncoderIsHardwareAccelerated(struct FFmpegEncoder*);
 
 CXX_GUARD_END
 
@@ -5,6 +5,9 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "ffmpeg-scale.h"
 
+#include <mgba-util/image.h>
+
+#include <libavutil/opt.h>
 #include <libswscale/swscale.h>
 
 static const int _qualityToFlags[] = {
@@ -28,9 +31,88 @@ void FFmpegScale(const void* input, int iwidth, int iheight, unsigned istride,
 	}
 	flags = _qualityToFlags[quality];
 
-	struct SwsContext* scaleContext = sws_getContext(iwidth, iheight, pixFormat,
-	    owidth, oheight, pixFormat,
-	    flags, 0, 0, 0);
+	if (flags == SWS_POINT && FFmpegScaleInteger(input, iwidth, iheight, istride, output, owidth, oheight, ostride, mColorFormatBytes(format))) {
+		return;
+	}
+
+	struct SwsContext* scaleContext = FFmpegScaleCreateContext(iwidth, iheight, pixFormat,
+	    owidth, oheight, pixFormat, flags);
+	if (!scaleContext) {
+		return;
+	}
 	sws_scale(scaleContext, (const uint8_t* const*) &input, (const int*) &istride, 0, iheight, (uint8_t* const*) &output, (const int*) &ostride);
 	sws_freeContext(scaleContext);
 }
+
+bool FFmpegScaleInteger(const void* input, int iwidth, int iheight, unsigned istride,
+                        void* output, int owidth, int oheight, unsigned ostride,
+                        unsigned bytesPerPixel) {
+	if (iwidth <= 0 || iheight <= 0 || owidth < iwidth || oheight < iheight || owidth % iwidth || oheight % iheight) {
+		return false;
+	}
+	int xScale = owidth / iwidth;
+	int yScale = oheight / iheight;
+	size_t rowSize = (size_t) owidth * bytesPerPixel;
+	const uint8_t* src = input;
+	uint8_t* dst = output;
+
+	int y;
+	for (y = 0; y < iheight; ++y) {
+		uint8_t* row = dst;
+		int x;
+		int i;
+		if (bytesPerPixel == 4) {
+			const uint32_t* in = (const uint32_t*) src;
+			uint32_t* out = (uint32_t*) row;
+			for (x = 0; x < iwidth; ++x) {
+				uint32_t pixel = in[x];
+				for (i = 0; i < xScale; ++i) {
+					*out++ = pixel;
+				}
+			}
+		} else {
+			uint8_t* out = row;
+			for (x = 0; x < iwidth; ++x) {
+				for (i = 0; i < xScale; ++i) {
+					memcpy(out, &src[x * bytesPerPixel], bytesPerPixel);
+					out += bytesPerPixel;
+				}
+			}
+		}
+		// The rest of the rows this one turns into are the same, so just copy them
+		for (i = 1; i < yScale; ++i) {
+			dst += ostride;
+			memcpy(dst, row, rowSize);
+		}
+		dst += ostride;
+		src += istride;
+	}
+	return true;
+}
+
+struct SwsContext* FFmpegScaleCreateContext(int iwidth, int iheight, enum AVPixelFormat iformat,
+                                            int owidth, int oheight, enum AVPixelFormat oformat,
+                                            int flags) {
+#ifdef FFMPEG_USE_SWS_THREADS
+	struct SwsContext* context = sws_alloc_context();
+	if (!context) {
+		return NULL;
+	}
+	av_opt_set_int(context, "srcw", iwidth, 0);
+	av_opt_set_int(context, "srch", iheight, 0);
+	av_opt_set_int(context, "src_format", iformat, 0);
+	av_opt_set_int(context, "dstw", owidth, 0);
+	av_opt_set_int(context, "dsth", oheight, 0);
+	av_opt_set_int(context, "dst_format", oformat, 0);
+	av_opt_set_int(context, "sws_flags", flags, 0);
+	// Zero picks a thread count based on the number of CPUs
+	av_opt_set_int(context, "threads", 0, 0);
+	if (sws_init_context(context, NULL, NULL) < 0) {
+		sws_freeContext(context);
+		return NULL;
+	}
+	return context;
+#else
+	return sws_getContext(iwidth, iheight, iformat, owidth, oheight, oformat, flags, 0, 0, 0);
+#endif
+}
@@ -12,10 +12,23 @@ CXX_GUARD_START
 
 #include "feature/ffmpeg/ffmpeg-common.h"
 
+struct SwsContext;
+
 void FFmpegScale(const void* input, int iwidth, int iheight, unsigned istride,
                  void* output, int owidth, int oheight, unsigned ostride,
                  enum mColorFormat format, int quality);
 
+// Nearest-neighbor scaling by whole multiples, without going through swscale. Returns false if the
+// output size isn't a whole multiple of the input size.
+bool FFmpegScaleInteger(const void* input, int iwidth, int iheight, unsigned istride,
+                        void* output, int owidth, int oheight, unsigned ostride,
+                        unsigned bytesPerPixel);
+
+// Like sws_getContext, but split across threads where swscale supports it
+struct SwsContext* FFmpegScaleCreateContext(int iwidth, int iheight, enum AVPixelFormat iformat,
+                                            int owidth, int oheight, enum AVPixelFormat oformat,
+                                            int flags);
+
 CXX_GUARD_END
 
 #endif
@@ -0,0 +1,211 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/feature/frame-server.h>
+
+#include <mgba-util/image.h>
+#include <mgba-util/string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__) && !defined(__ANDROID__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define USE_FUTEX
+#endif
+
+// Readers only see the audio written count move this often, besides once per frame
+#define AUDIO_PUBLISH_INTERVAL 0x100
+
+static void _frameServerSetVideoDimensions(struct mAVStream*, unsigned width, unsigned height);
+static void _frameServerSetAudioRate(struct mAVStream*, unsigned rate);
+static void _frameServerPostVideoFrame(struct mAVStream*, const color_t* pixels, size_t stride);
+static void _frameServerPostVideoFrameRepeat(struct mAVStream*, const color_t* pixels, size_t stride);
+static void _frameServerPostAudioFrame(struct mAVStream*, int16_t left, int16_t right);
+
+void mFrameServerInit(struct mFrameServer* server) {
+	memset(server, 0, sizeof(*server));
+	server->d.videoDimensionsChanged = _frameServerSetVideoDimensions;
+	server->d.audioRateChanged = _frameServerSetAudioRate;
+	server->d.postVideoFrame = _frameServerPostVideoFrame;
+	server->d.postVideoFrameRepeat = _frameServerPostVideoFrameRepeat;
+	server->d.postAudioFrame = _frameServerPostAudioFrame;
+}
+
+bool mFrameServerOpen(struct mFrameServer* server, const char* name, unsigned maxWidth, unsigned maxHeight) {
+	if (server->header || !maxWidth || !maxHeight) {
+		return false;
+	}
+	size_t stride = maxWidth * BYTES_PER_PIXEL;
+	size_t slotSize = stride * maxHeight;
+	size_t headerSize = (sizeof(struct mFrameServerHeader) + 63) & ~63;
+	size_t audioOffset = headerSize + slotSize * mFRAME_SERVER_SLOTS;
+	size_t size = audioOffset + mFRAME_SERVER_AUDIO_SAMPLES * sizeof(struct mStereoSample);
+	if (size > UINT32_MAX) {
+		return false;
+	}
+	// Anything left over from a process that didn't shut down cleanly would have the wrong size
+	sharedMemoryRemoveNamed(name);
+	if (!sharedMemoryCreateNamed(&server->memory, name, size)) {
+		return false;
+	}
+	strlcpy(server->name, name, sizeof(server->name));
+
+	struct mFrameServerHeader* header = server->memory.data;
+	memset(header, 0, headerSize);
+	header->headerSize = headerSize;
+	header->format = mCOLOR_NATIVE;
+	header->maxWidth = maxWidth;
+	header->maxHeight = maxHeight;
+	header->nSlots = mFRAME_SERVER_SLOTS;
+	header->audioOffset = audioOffset;
+	header->audioCapacity = mFRAME_SERVER_AUDIO_SAMPLES;
+	size_t i;
+	for (i = 0; i < mFRAME_SERVER_SLOTS; ++i) {
+		header->slots[i].stride = stride;
+		header->slots[i].offset = headerSize + slotSize * i;
+	}
+	header->version = mFRAME_SERVER_VERSION;
+	// Readers can tell the block is ready once the magic shows up
+	ATOMIC_STORE(header->magic, mFRAME_SERVER_MAGIC);
+
+#ifdef _WIN32
+	char eventName[MAX_PATH];
+	snprintf(eventName, sizeof(eventName), "Local\\%s-frame", name);
+	server->event = (intptr_t) CreateEventA(NULL, TRUE, FALSE, eventName);
+#endif
+
+	server->header = header;
+	server->frame = 0;
+	server->audioWritten = 0;
+	return true;
+}
+
+void mFrameServerClose(struct mFrameServer* server) {
+	if (!server->header) {
+		return;
+	}
+	ATOMIC_STORE(server->header->magic, 0);
+#ifdef _WIN32
+	if (server->event) {
+		// Let anyone still waiting see that it's gone
+		SetEvent((HANDLE) server->event);
+		CloseHandle((HANDLE) server->event);
+		server->event = 0;
+	}
+#endif
+	sharedMemoryDestroy(&server->memory);
+	sharedMemoryRemoveNamed(server->name);
+	server->header = NULL;
+}
+
+bool mFrameServerIsOpen(const struct mFrameServer* server) {
+	return !!server->header;
+}
+
+static void _wake(struct mFrameServer* server) {
+	ATOMIC_ADD(server->header->frameSequence, 1);
+#ifdef USE_FUTEX
+	syscall(SYS_futex, &server->header->frameSequence, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#elif defined(_WIN32)
+	// Readers woken by the last frame wait again once the next one is underway
+	SetEvent((HANDLE) server->event);
+#endif
+}
+
+static uint32_t _beginSlotWrite(struct mFrameServerSlot* slot) {
+	// This has to be a full barrier, or the writes to the slot could be seen before it's marked
+	uint32_t sequence = slot->sequence;
+	while (!ATOMIC_CMPXCHG(slot->sequence, sequence, sequence + 1));
+	return sequence + 1;
+}
+
+static void _publishAudio(struct mFrameServer* server) {
+	ATOMIC_STORE(server->header->audioWritten, server->audioWritten);
+}
+
+static void _frameServerSetVideoDimensions(struct mAVStream* stream, unsigned width, unsigned height) {
+	struct mFrameServer* server = (struct mFrameServer*) stream;
+	server->width = width;
+	server->height = height;
+}
+
+static void _frameServerSetAudioRate(struct mAVStream* stream, unsigned rate) {
+	struct mFrameServer* server = (struct mFrameServer*) stream;
+	if (!server->header) {
+		return;
+	}
+	ATOMIC_STORE(server->header->audioRate, rate);
+}
+
+static void _frameServerPostVideoFrame(struct mAVStream* stream, const color_t* pixels, size_t stride) {
+	struct mFrameServer* server = (struct mFrameServer*) stream;
+	struct mFrameServerHeader* header = server->header;
+	++server->frame;
+	if (!header || server->width > header->maxWidth || server->height > header->maxHeight) {
+		return;
+	}
+#ifdef _WIN32
+	ResetEvent((HANDLE) server->event);
+#endif
+
+	// The slot after the newest one is the one readers are least likely to still be using
+	uint32_t index = (header->latest + 1) % mFRAME_SERVER_SLOTS;
+	struct mFrameServerSlot* slot = &header->slots[index];
+	uint32_t sequence = _beginSlotWrite(slot);
+
+	uint8_t* out = (uint8_t*) header + slot->offset;
+	size_t rowSize = server->width * BYTES_PER_PIXEL;
+	unsigned y;
+	for (y = 0; y < server->height; ++y) {
+		memcpy(&out[y * slot->stride], &pixels[y * stride], rowSize);
+	}
+	slot->width = server->width;
+	slot->height = server->height;
+	slot->frame = server->frame;
+
+	ATOMIC_STORE(slot->sequence, sequence + 1);
+	ATOMIC_STORE(header->latest, index);
+	_publishAudio(server);
+	_wake(server);
+}
+
+static void _frameServerPostVideoFrameRepeat(struct mAVStream* stream, const color_t* pixels, size_t stride) {
+	UNUSED(pixels);
+	UNUSED(stride);
+	struct mFrameServer* server = (struct mFrameServer*) stream;
+	struct mFrameServerHeader* header = server->header;
+	++server->frame;
+	if (!header) {
+		return;
+	}
+#ifdef _WIN32
+	ResetEvent((HANDLE) server->event);
+#endif
+	// The pixels are already there, so only the frame number needs updating
+	struct mFrameServerSlot* slot = &header->slots[header->latest];
+	uint32_t sequence = _beginSlotWrite(slot);
+	slot->frame = server->frame;
+	ATOMIC_STORE(slot->sequence, sequence + 1);
+	_publishAudio(server);
+	_wake(server);
+}
+
+static void _frameServerPostAudioFrame(struct mAVStream* stream, int16_t left, int16_t right) {
+	struct mFrameServer* server = (struct mFrameServer*) stream;
+	struct mFrameServerHeader* header = server->header;
+	if (!header) {
+		return;
+	}
+	struct mStereoSample* ring = (struct mStereoSample*) ((uint8_t*) header + header->audioOffset);
+	struct mStereoSample* sample = &ring[server->audioWritten % mFRAME_SERVER_AUDIO_SAMPLES];
+	sample->left = left;
+	sample->right = right;
+	++server->audioWritten;
+	if (!(server->audioWritten % AUDIO_PUBLISH_INTERVAL)) {
+		_publishAudio(server);
+	}
+}
@@ -0,0 +1,496 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/feature/gif-encoder.h>
+
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/video.h>
+#include <mgba-util/image.h>
+#include <mgba-util/vfs.h>
+
+#define LZW_MAX_BITS 12
+#define LZW_MAX_CODES (1 << LZW_MAX_BITS)
+
+static void _gifSetVideoDimensions(struct mAVStream*, unsigned width, unsigned height);
+static void _gifPostVideoFrame(struct mAVStream*, const color_t* pixels, size_t stride);
+static void _gifPostVideoFrameRepeat(struct mAVStream*, const color_t* pixels, size_t stride);
+
+void mGIFEncoderInit(struct mGIFEncoder* encoder) {
+	memset(encoder, 0, sizeof(*encoder));
+	encoder->d.videoDimensionsChanged = _gifSetVideoDimensions;
+	encoder->d.postVideoFrame = _gifPostVideoFrame;
+	encoder->d.postVideoFrameRepeat = _gifPostVideoFrameRepeat;
+	encoder->width = GBA_VIDEO_HORIZONTAL_PIXELS;
+	encoder->height = GBA_VIDEO_VERTICAL_PIXELS;
+	encoder->loop = true;
+	encoder->frameskip = 1;
+	encoder->delayOffset = -1;
+	mGIFEncoderSetInputFrameRate(encoder, VIDEO_TOTAL_LENGTH, GBA_ARM7TDMI_FREQUENCY);
+}
+
+void mGIFEncoderSetDimensions(struct mGIFEncoder* encoder, unsigned width, unsigned height) {
+	if (encoder->vf) {
+		return;
+	}
+	encoder->width = width;
+	encoder->height = height;
+}
+
+void mGIFEncoderSetLooping(struct mGIFEncoder* encoder, bool loop) {
+	encoder->loop = loop;
+}
+
+void mGIFEncoderSetFrameskip(struct mGIFEncoder* encoder, int frameskip) {
+	if (frameskip < 0) {
+		frameskip = 0;
+	}
+	encoder->frameskip = frameskip + 1;
+}
+
+void mGIFEncoderSetInputFrameRate(struct mGIFEncoder* encoder, int numerator, int denominator) {
+	encoder->frameCycles = numerator;
+	encoder->cycles = denominator;
+}
+
+bool mGIFEncoderOpen(struct mGIFEncoder* encoder, const char* outfile) {
+	struct VFile* vf = VFileOpen(outfile, O_WRONLY | O_CREAT | O_TRUNC);
+	if (!vf) {
+		return false;
+	}
+	if (!mGIFEncoderOpenVF(encoder, vf)) {
+		vf->close(vf);
+		return false;
+	}
+	encoder->closeVF = true;
+	return true;
+}
+
+bool mGIFEncoderOpenVF(struct mGIFEncoder* encoder, struct VFile* vf) {
+	if (encoder->vf || !encoder->width || !encoder->height || encoder->width > 0xFFFF || encoder->height > 0xFFFF) {
+		return false;
+	}
+	size_t size = encoder->width * encoder->height;
+	encoder->previous = calloc(size, sizeof(*encoder->previous));
+	encoder->current = calloc(size, sizeof(*encoder->current));
+	encoder->indices = calloc(size, sizeof(*encoder->indices));
+	encoder->iwidth = encoder->width;
+	encoder->iheight = encoder->height;
+	encoder->vf = vf;
+	encoder->closeVF = false;
+	encoder->started = false;
+	encoder->active = NULL;
+	encoder->frame = 0;
+	encoder->pendingFrame = 0;
+	encoder->delayOffset = -1;
+	encoder->skipResidue = 0;
+	return true;
+}
+
+bool mGIFEncoderIsOpen(struct mGIFEncoder* encoder) {
+	return !!encoder->vf;
+}
+
+static void _writeByte(struct mGIFEncoder* encoder, uint8_t value) {
+	encoder->vf->write(encoder->vf, &value, 1);
+}
+
+static void _writeShort(struct mGIFEncoder* encoder, uint16_t value) {
+	uint8_t buffer[2];
+	STORE_16LE(value, 0, buffer);
+	encoder->vf->write(encoder->vf, buffer, sizeof(buffer));
+}
+
+static unsigned _paletteBits(const struct mGIFPalette* palette) {
+	// Tables have to be a power of two in size, and include the transparent color
+	unsigned bits = 1;
+	while ((1U << bits) < palette->count + 1) {
+		++bits;
+	}
+	return bits;
+}
+
+static void _writePalette(struct mGIFEncoder* encoder, const struct mGIFPalette* palette) {
+	uint8_t table[mGIF_MAX_COLORS * 3] = {0};
+	unsigned i;
+	for (i = 0; i < palette->count; ++i) {
+		table[(i + 1) * 3] = palette->colors[i] >> 16;
+		table[(i + 1) * 3 + 1] = palette->colors[i] >> 8;
+		table[(i + 1) * 3 + 2] = palette->colors[i];
+	}
+	encoder->vf->write(encoder->vf, table, (1 << _paletteBits(palette)) * 3);
+}
+
+static unsigned _paletteHash(uint32_t key) {
+	return (key * 0x9E3779B1U) >> (32 - 9);
+}
+
+static int _paletteLookup(const struct mGIFPalette* palette, uint32_t color) {
+	uint32_t key = (color & palette->mask) | 0x1000000;
+	unsigned hash = _paletteHash(key);
+	while (palette->keys[hash]) {
+		if (palette->keys[hash] == key) {
+			return palette->values[hash];
+		}
+		hash = (hash + 1) & (mGIF_PALETTE_HASH_SIZE - 1);
+	}
+	return -1;
+}
+
+static bool _paletteAdd(struct mGIFPalette* palette, uint32_t color) {
+	// Empty slots are zero, so keys get a bit set that no color has
+	uint32_t key = (color & palette->mask) | 0x1000000;
+	unsigned hash = _paletteHash(key);
+	while (palette->keys[hash]) {
+		if (palette->keys[hash] == key) {
+			return true;
+		}
+		hash = (hash + 1) & (mGIF_PALETTE_HASH_SIZE - 1);
+	}
+	if (palette->count >= mGIF_MAX_COLORS - 1) {
+		return false;
+	}
+	// Fill the bits that were masked off with the middle of their range
+	uint32_t dropped = ~palette->mask & 0xFFFFFF;
+	uint32_t fill = ((dropped >> 1) & dropped) + (dropped & 0x010101);
+	palette->keys[hash] = key;
+	palette->colors[palette->count] = (color & palette->mask) | fill;
+	++palette->count;
+	palette->values[hash] = palette->count;
+	return true;
+}
+
+static void _paletteReset(struct mGIFPalette* palette, uint32_t mask) {
+	memset(palette->keys, 0, sizeof(palette->keys));
+	palette->count = 0;
+	palette->mask = mask;
+}
+
+static void _buildPalette(struct mGIFEncoder* encoder, struct mGIFPalette* palette, unsigned x0, unsigned y0, unsigned x1, unsigned y1) {
+	// Too many colors are handled by dropping bits from each channel until they fit
+	static const uint32_t masks[] = { 0xFFFFFF, 0xFEFEFE, 0xFCFCFC, 0xF8F8F8, 0xF0F0F0, 0xE0E0E0, 0xE0E0C0, 0xC0C0C0 };
+	size_t m;
+	for (m = 0; m < sizeof(masks) / sizeof(*masks); ++m) {
+		_paletteReset(palette, masks[m]);
+		bool fits = true;
+		unsigned x, y;
+		for (y = y0; y < y1 && fits; ++y) {
+			const uint32_t* row = &encoder->current[y * encoder->width];
+			const uint32_t* previousRow = &encoder->previous[y * encoder->width];
+			for (x = x0; x < x1; ++x) {
+				if (encoder->started && row[x] == previousRow[x]) {
+					continue;
+				}
+				if (!_paletteAdd(palette, row[x])) {
+					fits = false;
+					break;
+				}
+			}
+		}
+		if (fits) {
+			return;
+		}
+	}
+}
+
+static bool _mapFrame(struct mGIFEncoder* encoder, const struct mGIFPalette* palette, unsigned x0, unsigned y0, unsigned x1, unsigned y1) {
+	uint8_t* indices = encoder->indices;
+	unsigned x, y;
+	for (y = y0; y < y1; ++y) {
+		const uint32_t* row = &encoder->current[y * encoder->width];
+		const uint32_t* previousRow = &encoder->previous[y * encoder->width];
+		for (x = x0; x < x1; ++x) {
+			if (encoder->started && row[x] == previousRow[x]) {
+				// Unchanged pixels show the last frame through
+				*indices = 0;
+			} else {
+				int index = _paletteLookup(palette, row[x]);
+				if (index < 0) {
+					return false;
+				}
+				*indices = index;
+			}
+			++indices;
+		}
+	}
+	return true;
+}
+
+static void _flushBlock(struct mGIFEncoder* encoder) {
+	if (!encoder->blockSize) {
+		return;
+	}
+	_writeByte(encoder, encoder->blockSize);
+	encoder->vf->write(encoder->vf, encoder->block, encoder->blockSize);
+	encoder->blockSize = 0;
+}
+
+static void _writeCode(struct mGIFEncoder* encoder, unsigned code, unsigned bits) {
+	encoder->bitBuffer |= code << encoder->bitCount;
+	encoder->bitCount += bits;
+	while (encoder->bitCount >= 8) {
+		encoder->block[encoder->blockSize] = encoder->bitBuffer;
+		++encoder->blockSize;
+		if (encoder->blockSize == 255) {
+			_flushBlock(encoder);
+		}
+		encoder->bitBuffer >>= 8;
+		encoder->bitCount -= 8;
+	}
+}
+
+static void _writeImageData(struct mGIFEncoder* encoder, size_t length, unsigned minBits) {
+	if (minBits < 2) {
+		minBits = 2;
+	}
+	unsigned clearCode = 1 << minBits;
+	unsigned nextCode = clearCode + 2;
+	unsigned bits = minBits + 1;
+	encoder->bitBuffer = 0;
+	encoder->bitCount = 0;
+	encoder->blockSize = 0;
+	memset(encoder->lzwKeys, 0xFF, sizeof(encoder->lzwKeys));
+
+	_writeByte(encoder, minBits);
+	_writeCode(encoder, clearCode, bits);
+
+	const uint8_t* indices = encoder->indices;
+	unsigned prefix = indices[0];
+	size_t i;
+	for (i = 1; i < length; ++i) {
+		uint8_t next = indices[i];
+		int32_t key = (prefix << 8) | next;
+		unsigned hash = ((unsigned) next << 4 ^ prefix) % mGIF_LZW_HASH_SIZE;
+		while (encoder->lzwKeys[hash] >= 0 && encoder->lzwKeys[hash] != key) {
+			hash = (hash + 1) % mGIF_LZW_HASH_SIZE;
+		}
+		if (encoder->lzwKeys[hash] == key) {
+			prefix = encoder->lzwCodes[hash];
+			continue;
+		}
+		_writeCode(encoder, prefix, bits);
+		prefix = next;
+		if (nextCode < LZW_MAX_CODES - 1) {
+			encoder->lzwKeys[hash] = key;
+			encoder->lzwCodes[hash] = nextCode;
+			// Decoders widen codes as soon as the table reaches the next power of two
+			if (nextCode == (1U << bits) && bits < LZW_MAX_BITS) {
+				++bits;
+			}
+			++nextCode;
+		} else {
+			_writeCode(encoder, clearCode, bits);
+			memset(encoder->lzwKeys, 0xFF, sizeof(encoder->lzwKeys));
+			nextCode = clearCode + 2;
+			bits = minBits + 1;
+		}
+	}
+	_writeCode(encoder, prefix, bits);
+	// The decoder still widens its codes after the last one, even though it doesn't add an entry
+	if (nextCode == (1U << bits) && bits < LZW_MAX_BITS) {
+		++bits;
+	}
+	_writeCode(encoder, clearCode + 1, bits);
+	if (encoder->bitCount) {
+		_writeCode(encoder, 0, 8 - encoder->bitCount);
+	}
+	_flushBlock(encoder);
+	_writeByte(encoder, 0);
+}
+
+static uint64_t _frameTime(const struct mGIFEncoder* encoder, uint64_t frame) {
+	// Delays are rounded from the start of the clip, so the rounding doesn't drift
+	return (frame * encoder->frameCycles * 100 + encoder->cycles / 2) / encoder->cycles;
+}
+
+static void _finishPendingFrame(struct mGIFEncoder* encoder) {
+	if (encoder->delayOffset < 0) {
+		return;
+	}
+	uint64_t delay = _frameTime(encoder, encoder->frame) - _frameTime(encoder, encoder->pendingFrame);
+	if (delay > 0xFFFF) {
+		delay = 0xFFFF;
+	}
+	off_t position = encoder->vf->seek(encoder->vf, 0, SEEK_CUR);
+	encoder->vf->seek(encoder->vf, encoder->delayOffset, SEEK_SET);
+	_writeShort(encoder, delay);
+	encoder->vf->seek(encoder->vf, position, SEEK_SET);
+	encoder->delayOffset = -1;
+}
+
+static void _writeHeader(struct mGIFEncoder* encoder) {
+	encoder->vf->write(encoder->vf, "GIF89a", 6);
+	_writeShort(encoder, encoder->width);
+	_writeShort(encoder, encoder->height);
+	unsigned bits = _paletteBits(&encoder->global);
+	_writeByte(encoder, 0x80 | ((bits - 1) << 4) | (bits - 1));
+	_writeByte(encoder, 0);
+	_writeByte(encoder, 0);
+	_writePalette(encoder, &encoder->global);
+
+	if (encoder->loop) {
+		_writeByte(encoder, 0x21);
+		_writeByte(encoder, 0xFF);
+		_writeByte(encoder, 11);
+		encoder->vf->write(encoder->vf, "NETSCAPE2.0", 11);
+		_writeByte(encoder, 3);
+		_writeByte(encoder, 1);
+		_writeShort(encoder, 0);
+		_writeByte(encoder, 0);
+	}
+}
+
+static void _writeFrame(struct mGIFEncoder* encoder) {
+	unsigned width = encoder->width;
+	unsigned height = encoder->height;
+	unsigned x0 = 0;
+	unsigned y0 = 0;
+	unsigned x1 = width;
+	unsigned y1 = height;
+	if (encoder->started) {
+		// Only the area that changed needs to be written
+		x0 = width;
+		y0 = height;
+		x1 = 0;
+		y1 = 0;
+		unsigned x, y;
+		for (y = 0; y < height; ++y) {
+			const uint32_t* row = &encoder->current[y * width];
+			const uint32_t* previousRow = &encoder->previous[y * width];
+			if (!memcmp(row, previousRow, width * sizeof(*row))) {
+				continue;
+			}
+			if (y < y0) {
+				y0 = y;
+			}
+			y1 = y + 1;
+			for (x = 0; x < x0 && row[x] == previousRow[x]; ++x);
+			x0 = x;
+			for (x = width; x > x1 && row[x - 1] == previousRow[x - 1]; --x);
+			x1 = x;
+		}
+		if (y1 <= y0) {
+			return;
+		}
+	}
+
+	// Try the palettes already written before making a new one
+	if (!encoder->active || !_mapFrame(encoder, encoder->active, x0, y0, x1, y1)) {
+		if (encoder->started && encoder->active != &encoder->global && _mapFrame(encoder, &encoder->global, x0, y0, x1, y1)) {
+			encoder->active = &encoder->global;
+		} else {
+			struct mGIFPalette* palette = encoder->started ? &encoder->local : &encoder->global;
+			_buildPalette(encoder, palette, x0, y0, x1, y1);
+			_mapFrame(encoder, palette, x0, y0, x1, y1);
+			encoder->active = palette;
+		}
+	}
+
+	if (!encoder->started) {
+		_writeHeader(encoder);
+		encoder->started = true;
+	}
+	_finishPendingFrame(encoder);
+
+	_writeByte(encoder, 0x21);
+	_writeByte(encoder, 0xF9);
+	_writeByte(encoder, 4);
+	// Leave the frame in place for the next one to draw over, with index 0 as transparent
+	_writeByte(encoder, (1 << 2) | 1);
+	encoder->delayOffset = encoder->vf->seek(encoder->vf, 0, SEEK_CUR);
+	encoder->pendingFrame = encoder->frame;
+	_writeShort(encoder, 0);
+	_writeByte(encoder, 0);
+	_writeByte(encoder, 0);
+
+	_writeByte(encoder, 0x2C);
+	_writeShort(encoder, x0);
+	_writeShort(encoder, y0);
+	_writeShort(encoder, x1 - x0);
+	_writeShort(encoder, y1 - y0);
+	unsigned bits = _paletteBits(encoder->active);
+	if (encoder->active == &encoder->global) {
+		_writeByte(encoder, 0);
+	} else {
+		_writeByte(encoder, 0x80 | (bits - 1));
+		_writePalette(encoder, encoder->active);
+	}
+	_writeImageData(encoder, (x1 - x0) * (y1 - y0), bits);
+
+	uint32_t* previous = encoder->previous;
+	encoder->previous = encoder->current;
+	encoder->current = previous;
+}
+
+static void _gifSetVideoDimensions(struct mAVStream* stream, unsigned width, unsigned height) {
+	struct mGIFEncoder* encoder = (struct mGIFEncoder*) stream;
+	encoder->iwidth = width;
+	encoder->iheight = height;
+	// GIFs can't change size once the header is written, so frames of other sizes get left out
+	if (!encoder->vf || encoder->started || (width == encoder->width && height == encoder->height)) {
+		return;
+	}
+	free(encoder->previous);
+	free(encoder->current);
+	free(encoder->indices);
+	encoder->width = width;
+	encoder->height = height;
+	size_t size = width * height;
+	encoder->previous = calloc(size, sizeof(*encoder->previous));
+	encoder->current = calloc(size, sizeof(*encoder->current));
+	encoder->indices = calloc(size, sizeof(*encoder->indices));
+}
+
+static void _gifPostVideoFrame(struct mAVStream* stream, const color_t* pixels, size_t stride) {
+	struct mGIFEncoder* encoder = (struct mGIFEncoder*) stream;
+	if (!encoder->vf) {
+		return;
+	}
+	encoder->skipResidue = (encoder->skipResidue + 1) % encoder->frameskip;
+	if (!encoder->skipResidue && encoder->iwidth == encoder->width && encoder->iheight == encoder->height) {
+		unsigned y;
+		for (y = 0; y < encoder->height; ++y) {
+			uint32_t* row = &encoder->current[y * encoder->width];
+			mColorConvertRow(row, mCOLOR_XRGB8, &pixels[y * stride], mCOLOR_NATIVE, encoder->width);
+			unsigned x;
+			for (x = 0; x < encoder->width; ++x) {
+				row[x] &= 0xFFFFFF;
+			}
+		}
+		_writeFrame(encoder);
+	}
+	++encoder->frame;
+}
+
+static void _gifPostVideoFrameRepeat(struct mAVStream* stream, const color_t* pixels, size_t stride) {
+	UNUSED(pixels);
+	UNUSED(stride);
+	struct mGIFEncoder* encoder = (struct mGIFEncoder*) stream;
+	if (!encoder->vf) {
+		return;
+	}
+	// The frame on screen just stays there for longer
+	encoder->skipResidue = (encoder->skipResidue + 1) % encoder->frameskip;
+	++encoder->frame;
+}
+
+void mGIFEncoderClose(struct mGIFEncoder* encoder) {
+	if (!encoder->vf) {
+		return;
+	}
+	if (encoder->started) {
+		_finishPendingFrame(encoder);
+		_writeByte(encoder, 0x3B);
+	}
+	if (encoder->closeVF) {
+		encoder->vf->close(encoder->vf);
+	}
+	encoder->vf = NULL;
+	free(encoder->previous);
+	free(encoder->current);
+	free(encoder->indices);
+	encoder->previous = NULL;
+	encoder->current = NULL;
+	encoder->indices = NULL;
+}
@@ -6,7 +6,9 @@
 #include "gui-runner.h"
 
 #include <mgba/core/core.h>
+#include <mgba/core/perf.h>
 #include <mgba/core/serialize.h>
+#include <mgba/core/sync.h>
 #include "feature/gui/gui-config.h"
 #include "feature/gui/cheats.h"
 #include <mgba/internal/gba/gba.h>
@@ -33,6 +35,7 @@ mLOG_DEFINE_CATEGORY(GUI_RUNNER, "GUI Runner", "gui.runner");
 #define AUTOSAVE_GRANULARITY 600
 #define FPS_GRANULARITY 30
 #define FPS_BUFFER_SIZE 4
+#define FAST_FORWARD_PRESENT_FPS 60
 
 enum {
 	RUNNER_CONTINUE = 1,
@@ -501,6 +504,7 @@ void mGUIRun(struct mGUIRunner* runner, const char* path) {
 	mLOG(GUI_RUNNER, INFO, "Game starting");
 	runner->fps = 0;
 	bool fastForward = false;
+	struct mCoreFrameSkip frameSkip = { .presentFps = FAST_FORWARD_PRESENT_FPS };
 	while (running) {
 		CircleBufferClear(&runner->fpsBuffer);
 		runner->totalDelta = 0;
@@ -570,8 +574,21 @@ void mGUIRun(struct mGUIRunner* runner, const char* path) {
 				runner->prepareForFrame(runner);
 			}
 			runner->core->setKeys(runner->core, keys);
+			// Without the frame limiter, only draw as many frames as the screen can show
+			bool skipping = fastForwarding && runner->setFrameLimiter;
+			uint64_t frameStart = mPerfTimestamp();
+			bool render = !skipping || mCoreFrameSkipShouldRender(&frameSkip, frameStart);
+			if (!render) {
+				runner->core->skipVideoFrames(runner->core, 1);
+			}
+			if (skipping && (!render || runner->core->opts.mute)) {
+				runner->core->skipAudioFrames(runner->core, 1);
+			}
 			runner->core->runFrame(runner->core);
-			if (runner->drawFrame) {
+			if (skipping) {
+				mCoreFrameSkipFrameEnded(&frameSkip, frameStart, mPerfTimestamp(), render);
+			}
+			if (runner->drawFrame && render) {
 				runner->params.drawStart();
 				runner->drawFrame(runner, false);
 				if (showOSD || drawFps) {
@@ -5,6 +5,11 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/feature/proxy-backend.h>
 
+#include <mgba-util/image.h>
+
+static void _mVideoProxyBackendQueue(struct mVideoProxyBackend* proxy, const struct mVideoBackendCommand* cmd, union mVideoBackendCommandData* out);
+static const void* _mVideoProxyBackendStageImage(struct mVideoProxyBackend* proxy, enum VideoLayer layer, const struct mRectangle* region, const void* frame);
+
 static void _mVideoProxyBackendInit(struct VideoBackend* v, WHandle handle) {
 	struct mVideoProxyBackend* proxy = (struct mVideoProxyBackend*) v;
 	struct mVideoBackendCommand cmd = {
@@ -77,6 +82,10 @@ static void _mVideoProxyBackendContextResized(struct VideoBackend* v, unsigned w
 
 static void _mVideoProxyBackendSetImageSize(struct VideoBackend* v, enum VideoLayer layer, int w, int h) {
 	struct mVideoProxyBackend* proxy = (struct mVideoProxyBackend*) v;
+	if (layer < VIDEO_LAYER_MAX) {
+		proxy->layers[layer].width = w;
+		proxy->layers[layer].height = h;
+	}
 	struct mVideoBackendCommand cmd = {
 		.cmd = mVB_CMD_SET_IMAGE_SIZE,
 		.layer = layer,
@@ -108,10 +117,35 @@ static void _mVideoProxyBackendSetImage(struct VideoBackend* v, enum VideoLayer
 		.cmd = mVB_CMD_SET_IMAGE,
 		.layer = layer,
 		.data = {
-			.image = frame
+			.image = _mVideoProxyBackendStageImage(proxy, layer, NULL, frame)
 		}
 	};
-	mVideoProxyBackendSubmit(proxy, &cmd, NULL);
+	if (cmd.data.image) {
+		_mVideoProxyBackendQueue(proxy, &cmd, NULL);
+	} else {
+		cmd.data.image = frame;
+		mVideoProxyBackendSubmit(proxy, &cmd, NULL);
+	}
+}
+
+static void _mVideoProxyBackendSetImageRegion(struct VideoBackend* v, enum VideoLayer layer, const struct mRectangle* region, const void* frame) {
+	struct mVideoProxyBackend* proxy = (struct mVideoProxyBackend*) v;
+	struct mVideoBackendCommand cmd = {
+		.cmd = mVB_CMD_SET_IMAGE_REGION,
+		.layer = layer,
+		.data = {
+			.region = {
+				.dims = *region,
+				.image = _mVideoProxyBackendStageImage(proxy, layer, region, frame)
+			}
+		}
+	};
+	if (cmd.data.region.image) {
+		_mVideoProxyBackendQueue(proxy, &cmd, NULL);
+	} else {
+		cmd.data.region.image = frame;
+		mVideoProxyBackendSubmit(proxy, &cmd, NULL);
+	}
 }
 
 static void _mVideoProxyBackendDrawFrame(struct VideoBackend* v) {
@@ -120,6 +154,12 @@ static void _mVideoProxyBackendDrawFrame(struct VideoBackend* v) {
 		.cmd = mVB_CMD_DRAW_FRAME,
 	};
 	mVideoProxyBackendSubmit(proxy, &cmd, NULL);
+	mVideoProxyBackendFlush(proxy);
+}
+
+static void _mVideoProxyBackendFlush(struct VideoBackend* v) {
+	struct mVideoProxyBackend* proxy = (struct mVideoProxyBackend*) v;
+	mVideoProxyBackendFlush(proxy);
 }
 
 static bool mVideoProxyBackendReadIn(struct mVideoProxyBackend* proxy, struct mVideoBackendCommand* cmd, bool block);
@@ -136,9 +176,16 @@ void mVideoProxyBackendInit(struct mVideoProxyBackend* proxy, struct VideoBacken
 	proxy->d.setImageSize = _mVideoProxyBackendSetImageSize;
 	proxy->d.imageSize = _mVideoProxyBackendImageSize;
 	proxy->d.setImage = _mVideoProxyBackendSetImage;
+	proxy->d.setImageRegion = _mVideoProxyBackendSetImageRegion;
 	proxy->d.drawFrame = _mVideoProxyBackendDrawFrame;
+	proxy->d.flush = _mVideoProxyBackendFlush;
 	proxy->backend = backend;
 
+	proxy->batchSize = 0;
+	proxy->submitted = 0;
+	proxy->completed = 0;
+	memset(proxy->layers, 0, sizeof(proxy->layers));
+
 	RingFIFOInit(&proxy->in, 0x400);
 	RingFIFOInit(&proxy->out, 0x400);
 	MutexInit(&proxy->inLock);
@@ -157,93 +204,200 @@ void mVideoProxyBackendDeinit(struct mVideoProxyBackend* proxy) {
 	MutexDeinit(&proxy->outLock);
 	RingFIFODeinit(&proxy->in);
 	RingFIFODeinit(&proxy->out);
+
+	size_t i;
+	for (i = 0; i < VIDEO_LAYER_MAX; ++i) {
+		free(proxy->layers[i].staged[0].data);
+		free(proxy->layers[i].staged[1].data);
+	}
 }
 
 void mVideoProxyBackendSubmit(struct mVideoProxyBackend* proxy, const struct mVideoBackendCommand* cmd, union mVideoBackendCommandData* out) {
+	struct mVideoBackendCommand queued = *cmd;
+	queued.blocking = mVideoProxyBackendCommandIsBlocking(cmd->cmd);
+	_mVideoProxyBackendQueue(proxy, &queued, out);
+}
+
+static void _mVideoProxyBackendQueue(struct mVideoProxyBackend* proxy, const struct mVideoBackendCommand* cmd, union mVideoBackendCommandData* out) {
+	if (proxy->batchSize == mVIDEO_PROXY_BATCH_SIZE) {
+		mVideoProxyBackendFlush(proxy);
+	}
+	proxy->batch[proxy->batchSize] = *cmd;
+	++proxy->batchSize;
+	if (!cmd->blocking) {
+		return;
+	}
+
+	mVideoProxyBackendFlush(proxy);
+	MutexLock(&proxy->outLock);
+	while (!RingFIFORead(&proxy->out, out, sizeof(*out))) {
+		ConditionWait(&proxy->outWait, &proxy->outLock);
+	}
+	MutexUnlock(&proxy->outLock);
+}
+
+void mVideoProxyBackendFlush(struct mVideoProxyBackend* proxy) {
+	if (!proxy->batchSize) {
+		return;
+	}
+	size_t i;
 	MutexLock(&proxy->inLock);
-	while (!RingFIFOWrite(&proxy->in, cmd, sizeof(*cmd))) {
-		mLOG(VIDEO, DEBUG, "Can't write command. Proxy thread asleep?");
-		ConditionWait(&proxy->inWait, &proxy->inLock);
+	for (i = 0; i < proxy->batchSize; ++i) {
+		while (!RingFIFOWrite(&proxy->in, &proxy->batch[i], sizeof(proxy->batch[i]))) {
+			mLOG(VIDEO, DEBUG, "Can't write command. Proxy thread asleep?");
+			if (proxy->wakeupCb) {
+				proxy->wakeupCb(proxy, proxy->context);
+			}
+			ConditionWake(&proxy->inWait);
+			ConditionWait(&proxy->inWait, &proxy->inLock);
+		}
 	}
+	ConditionWake(&proxy->inWait);
 	MutexUnlock(&proxy->inLock);
+	proxy->submitted += proxy->batchSize;
+	proxy->batchSize = 0;
 	if (proxy->wakeupCb) {
 		proxy->wakeupCb(proxy, proxy->context);
 	}
+}
 
-	if (!mVideoProxyBackendCommandIsBlocking(cmd->cmd)) {
-		return;
-	}
-
+static void _mVideoProxyBackendWaitFor(struct mVideoProxyBackend* proxy, uint32_t serial) {
+	mVideoProxyBackendFlush(proxy);
 	MutexLock(&proxy->outLock);
-	while (!RingFIFORead(&proxy->out, out, sizeof(*out))) {
+	while (true) {
+		uint32_t completed;
+		ATOMIC_LOAD(completed, proxy->completed);
+		if ((int32_t) (completed - serial) >= 0) {
+			break;
+		}
 		ConditionWait(&proxy->outWait, &proxy->outLock);
 	}
 	MutexUnlock(&proxy->outLock);
 }
 
+static const void* _mVideoProxyBackendStageImage(struct mVideoProxyBackend* proxy, enum VideoLayer layer, const struct mRectangle* region, const void* frame) {
+	if (layer >= VIDEO_LAYER_MAX) {
+		return NULL;
+	}
+	struct mVideoProxyLayer* state = &proxy->layers[layer];
+	if (state->width <= 0 || state->height <= 0) {
+		// Without knowing how big the image is, it can't be copied, so the caller has to wait instead
+		return NULL;
+	}
+	size_t stride = state->width * BYTES_PER_PIXEL;
+	size_t size = stride * state->height;
+	int y = 0;
+	int height = state->height;
+	if (region) {
+		y = region->y;
+		height = region->height;
+		if (y < 0) {
+			height += y;
+			y = 0;
+		}
+		if (y + height > state->height) {
+			height = state->height - y;
+		}
+		if (height <= 0) {
+			return NULL;
+		}
+	}
+
+	struct mVideoProxyStagedImage* staged = &state->staged[state->nextStaged];
+	// This copy could still be in use if the other thread has fallen two updates behind
+	_mVideoProxyBackendWaitFor(proxy, staged->serial);
+	if (staged->size != size) {
+		free(staged->data);
+		staged->data = malloc(size);
+		staged->size = size;
+	}
+	memcpy((uint8_t*) staged->data + stride * y, (const uint8_t*) frame + stride * y, stride * height);
+	// The command reading from it goes at the end of the batch
+	staged->serial = proxy->submitted + proxy->batchSize + 1;
+	state->nextStaged ^= 1;
+	return staged->data;
+}
+
 bool mVideoProxyBackendRun(struct mVideoProxyBackend* proxy, bool block) {
 	bool ok = false;
-	do {
-		struct mVideoBackendCommand cmd;
+	struct mVideoBackendCommand cmd;
+	// Everything queued so far gets run, so a whole batch only needs one wakeup
+	while (mVideoProxyBackendReadIn(proxy, &cmd, block)) {
 		union mVideoBackendCommandData out;
-		if (mVideoProxyBackendReadIn(proxy, &cmd, block)) {
-			switch (cmd.cmd) {
-			case mVB_CMD_DUMMY:
-				break;
-			case mVB_CMD_INIT:
-				proxy->backend->init(proxy->backend, cmd.handle);
-				break;
-			case mVB_CMD_DEINIT:
-				proxy->backend->deinit(proxy->backend);
-				break;
-			case mVB_CMD_SET_LAYER_DIMENSIONS:
-				proxy->backend->setLayerDimensions(proxy->backend, cmd.layer, &cmd.data.dims);
-				break;
-			case mVB_CMD_LAYER_DIMENSIONS:
-				proxy->backend->layerDimensions(proxy->backend, cmd.layer, &out.dims);
-				break;
-			case mVB_CMD_SWAP:
-				proxy->backend->swap(proxy->backend);
-				break;
-			case mVB_CMD_CLEAR:
-				proxy->backend->clear(proxy->backend);
-				break;
-			case mVB_CMD_CONTEXT_RESIZED:
-				proxy->backend->contextResized(proxy->backend, cmd.data.u.width, cmd.data.u.height);
-				break;
-			case mVB_CMD_SET_IMAGE_SIZE:
-				proxy->backend->setImageSize(proxy->backend, cmd.layer, cmd.data.s.width, cmd.data.s.height);
-				break;
-			case mVB_CMD_IMAGE_SIZE:
-				proxy->backend->imageSize(proxy->backend, cmd.layer, &out.s.width, &out.s.height);
-				break;
-			case mVB_CMD_SET_IMAGE:
-				proxy->backend->setImage(proxy->backend, cmd.layer, cmd.data.image);
-				break;
-			case mVB_CMD_DRAW_FRAME:
-				proxy->backend->drawFrame(proxy->backend);
-				break;
+		switch (cmd.cmd) {
+		case mVB_CMD_DUMMY:
+			break;
+		case mVB_CMD_INIT:
+			proxy->backend->init(proxy->backend, cmd.handle);
+			break;
+		case mVB_CMD_DEINIT:
+			proxy->backend->deinit(proxy->backend);
+			break;
+		case mVB_CMD_SET_LAYER_DIMENSIONS:
+			proxy->backend->setLayerDimensions(proxy->backend, cmd.layer, &cmd.data.dims);
+			break;
+		case mVB_CMD_LAYER_DIMENSIONS:
+			proxy->backend->layerDimensions(proxy->backend, cmd.layer, &out.dims);
+			break;
+		case mVB_CMD_SWAP:
+			proxy->backend->swap(proxy->backend);
+			break;
+		case mVB_CMD_CLEAR:
+			proxy->backend->clear(proxy->backend);
+			break;
+		case mVB_CMD_CONTEXT_RESIZED:
+			proxy->backend->contextResized(proxy->backend, cmd.data.u.width, cmd.data.u.height);
+			break;
+		case mVB_CMD_SET_IMAGE_SIZE:
+			proxy->backend->setImageSize(proxy->backend, cmd.layer, cmd.data.s.width, cmd.data.s.height);
+			break;
+		case mVB_CMD_IMAGE_SIZE:
+			proxy->backend->imageSize(proxy->backend, cmd.layer, &out.s.width, &out.s.height);
+			break;
+		case mVB_CMD_SET_IMAGE:
+			proxy->backend->setImage(proxy->backend, cmd.layer, cmd.data.image);
+			break;
+		case mVB_CMD_SET_IMAGE_REGION:
+			if (proxy->backend->setImageRegion) {
+				proxy->backend->setImageRegion(proxy->backend, cmd.layer, &cmd.data.region.dims, cmd.data.region.image);
+			} else {
+				proxy->backend->setImage(proxy->backend, cmd.layer, cmd.data.region.image);
 			}
-			if (mVideoProxyBackendCommandIsBlocking(cmd.cmd)) {
-				mVideoProxyBackendWriteOut(proxy, &out);
-			}
-			ok = true;
+			break;
+		case mVB_CMD_DRAW_FRAME:
+			proxy->backend->drawFrame(proxy->backend);
+			break;
+		}
+		ATOMIC_ADD(proxy->completed, 1);
+		if (cmd.blocking) {
+			mVideoProxyBackendWriteOut(proxy, &out);
 		}
-	} while (block);
+		ok = true;
+	}
+	if (ok) {
+		// Let the submitter know if it was waiting on a staged image
+		MutexLock(&proxy->outLock);
+		ConditionWake(&proxy->outWait);
+		MutexUnlock(&proxy->outLock);
+	}
 	return ok;
 }
 
 bool mVideoProxyBackendReadIn(struct mVideoProxyBackend* proxy, struct mVideoBackendCommand* cmd, bool block) {
 	bool gotCmd = false;
 	MutexLock(&proxy->inLock);
-	do {
+	while (true) {
 		gotCmd = RingFIFORead(&proxy->in, cmd, sizeof(*cmd));
-		ConditionWake(&proxy->inWait);
-		// TODO: interlock?
-		if (block && !gotCmd) {
-			mLOG(VIDEO, DEBUG, "Can't read command. Runner thread asleep?");
+		if (gotCmd || !block) {
+			break;
 		}
-	} while (block && !gotCmd);
+		MutexLock(&proxy->outLock);
+		ConditionWake(&proxy->outWait);
+		MutexUnlock(&proxy->outLock);
+		ConditionWait(&proxy->inWait, &proxy->inLock);
+	}
+	// Make room for a submitter waiting for space
+	ConditionWake(&proxy->inWait);
 	MutexUnlock(&proxy->inLock);
 	return gotCmd;
 }
@@ -270,13 +424,14 @@ bool mVideoProxyBackendCommandIsBlocking(enum mVideoBackendCommandType cmd) {
 	case mVB_CMD_CLEAR:
 	case mVB_CMD_SET_IMAGE_SIZE:
 	case mVB_CMD_DRAW_FRAME:
+	case mVB_CMD_SWAP:
 		return false;
 	case mVB_CMD_INIT:
 	case mVB_CMD_DEINIT:
 	case mVB_CMD_LAYER_DIMENSIONS:
-	case mVB_CMD_SWAP:
 	case mVB_CMD_IMAGE_SIZE:
 	case mVB_CMD_SET_IMAGE:
+	case mVB_CMD_SET_IMAGE_REGION:
 		return true;
 	}
 
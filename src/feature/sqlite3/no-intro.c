@@ -6,6 +6,7 @@
 #include "no-intro.h"
 
 #include <mgba-util/string.h>
+#include <mgba-util/table.h>
 #include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 
@@ -14,6 +15,14 @@
 struct NoIntroDB {
 	sqlite3* db;
 	sqlite3_stmt* crc32;
+	sqlite3_stmt* insertLookup;
+	sqlite3_stmt* selectLookup;
+};
+
+struct NoIntroDBSnapshot {
+	struct Table games;
+	struct NoIntroGame* entries;
+	char* strings;
 };
 
 struct NoIntroDB* NoIntroDBLoad(const char* path) {
@@ -47,7 +56,11 @@ struct NoIntroDB* NoIntroDBLoad(const char* path) {
 			"flags INTEGER DEFAULT 0,"
 			"gid INTEGER NOT NULL REFERENCES games(gid) ON DELETE CASCADE"
 		");\n"
-		"CREATE INDEX IF NOT EXISTS crc32 ON roms (crc32);";
+		"CREATE INDEX IF NOT EXISTS crc32 ON roms (crc32);\n"
+		"CREATE TEMP TABLE crcLookup ("
+			"idx INTEGER NOT NULL PRIMARY KEY ASC,"
+			"crc32 INTEGER"
+		");";
 	if (sqlite3_exec(db->db, createTables, NULL, NULL, NULL)) {
 		goto error;
 	}
@@ -57,6 +70,20 @@ struct NoIntroDB* NoIntroDBLoad(const char* path) {
 		goto error;
 	}
 
+	static const char insertLookup[] = "INSERT INTO crcLookup (idx, crc32) VALUES (?, ?);";
+	if (sqlite3_prepare_v2(db->db, insertLookup, -1, &db->insertLookup, NULL)) {
+		goto error;
+	}
+
+	static const char selectLookup[] =
+		"SELECT crcLookup.idx, games.name, roms.name, roms.size, roms.crc32, roms.flags FROM crcLookup "
+		"JOIN roms ON roms.crc32 = crcLookup.crc32 "
+		"JOIN games ON games.gid = roms.gid "
+		"ORDER BY crcLookup.idx;";
+	if (sqlite3_prepare_v2(db->db, selectLookup, -1, &db->selectLookup, NULL)) {
+		goto error;
+	}
+
 	return db;
 
 error:
@@ -285,6 +312,12 @@ void NoIntroDBDestroy(struct NoIntroDB* db) {
 	if (db->crc32) {
 		sqlite3_finalize(db->crc32);
 	}
+	if (db->insertLookup) {
+		sqlite3_finalize(db->insertLookup);
+	}
+	if (db->selectLookup) {
+		sqlite3_finalize(db->selectLookup);
+	}
 	if (db->db) {
 		sqlite3_close(db->db);
 	}
@@ -309,3 +342,131 @@ bool NoIntroDBLookupGameByCRC(const struct NoIntroDB* db, uint32_t crc32, struct
 	game->verified = sqlite3_column_int(db->crc32, 8);
 	return true;
 }
+
+size_t NoIntroDBLookupGamesByCRC(const struct NoIntroDB* db, const uint32_t* crc32s, size_t count,
+	void (*found)(size_t index, const struct NoIntroGame* game, void* context), void* context) {
+	if (!db || !count) {
+		return 0;
+	}
+	// The lookup table belongs to the whole connection, so nothing else may touch it until this is done.
+	// A savepoint rather than a transaction, since an import may already have one open.
+	sqlite3_mutex* mutex = sqlite3_db_mutex(db->db);
+	sqlite3_mutex_enter(mutex);
+	sqlite3_exec(db->db, "SAVEPOINT crcLookup;", NULL, NULL, NULL);
+
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		sqlite3_reset(db->insertLookup);
+		sqlite3_bind_int64(db->insertLookup, 1, i);
+		sqlite3_bind_int(db->insertLookup, 2, crc32s[i]);
+		sqlite3_step(db->insertLookup);
+	}
+
+	size_t nFound = 0;
+	sqlite3_int64 lastIndex = -1;
+	sqlite3_reset(db->selectLookup);
+	while (sqlite3_step(db->selectLookup) == SQLITE_ROW) {
+		sqlite3_int64 index = sqlite3_column_int64(db->selectLookup, 0);
+		if (index == lastIndex) {
+			// The same ROM can be in more than one database
+			continue;
+		}
+		lastIndex = index;
+		struct NoIntroGame game = {
+			.name = (const char*) sqlite3_column_text(db->selectLookup, 1),
+			.romName = (const char*) sqlite3_column_text(db->selectLookup, 2),
+			.size = sqlite3_column_int(db->selectLookup, 3),
+			.crc32 = sqlite3_column_int(db->selectLookup, 4),
+			.verified = sqlite3_column_int(db->selectLookup, 5),
+		};
+		found(index, &game, context);
+		++nFound;
+	}
+	sqlite3_reset(db->selectLookup);
+
+	sqlite3_exec(db->db, "DELETE FROM crcLookup; RELEASE crcLookup;", NULL, NULL, NULL);
+	sqlite3_mutex_leave(mutex);
+	return nFound;
+}
+
+static char* _snapshotString(struct NoIntroDBSnapshot* snapshot, size_t* offset, const unsigned char* text, size_t size) {
+	char* string = &snapshot->strings[*offset];
+	if (text) {
+		memcpy(string, text, size - 1);
+	}
+	string[size - 1] = '\0';
+	*offset += size;
+	return string;
+}
+
+struct NoIntroDBSnapshot* NoIntroDBSnapshotCreate(const struct NoIntroDB* db) {
+	if (!db) {
+		return NULL;
+	}
+	static const char selectAll[] = "SELECT games.name, roms.name, roms.size, roms.crc32, roms.flags FROM roms JOIN games USING (gid);";
+	sqlite3_stmt* select;
+	if (sqlite3_prepare_v2(db->db, selectAll, -1, &select, NULL)) {
+		return NULL;
+	}
+	sqlite3_mutex* mutex = sqlite3_db_mutex(db->db);
+	sqlite3_mutex_enter(mutex);
+
+	// Everything is sized up front so the strings can all go in one allocation
+	size_t nEntries = 0;
+	size_t stringsSize = 0;
+	while (sqlite3_step(select) == SQLITE_ROW) {
+		++nEntries;
+		stringsSize += sqlite3_column_bytes(select, 0) + sqlite3_column_bytes(select, 1) + 2;
+	}
+
+	struct NoIntroDBSnapshot* snapshot = calloc(1, sizeof(*snapshot));
+	TableInit(&snapshot->games, nEntries, NULL);
+	snapshot->entries = calloc(nEntries ? nEntries : 1, sizeof(*snapshot->entries));
+	snapshot->strings = malloc(stringsSize ? stringsSize : 1);
+
+	size_t entry = 0;
+	size_t offset = 0;
+	sqlite3_reset(select);
+	while (entry < nEntries && sqlite3_step(select) == SQLITE_ROW) {
+		const unsigned char* nameText = sqlite3_column_text(select, 0);
+		size_t nameSize = sqlite3_column_bytes(select, 0) + 1;
+		const unsigned char* romNameText = sqlite3_column_text(select, 1);
+		size_t romNameSize = sqlite3_column_bytes(select, 1) + 1;
+		if (offset + nameSize + romNameSize > stringsSize) {
+			break;
+		}
+		uint32_t crc32 = sqlite3_column_int(select, 3);
+		if (TableLookup(&snapshot->games, crc32)) {
+			continue;
+		}
+		struct NoIntroGame* game = &snapshot->entries[entry];
+		char* name = _snapshotString(snapshot, &offset, nameText, nameSize);
+		char* romName = _snapshotString(snapshot, &offset, romNameText, romNameSize);
+
+		game->name = name;
+		game->romName = romName;
+		game->size = sqlite3_column_int(select, 2);
+		game->crc32 = crc32;
+		game->verified = sqlite3_column_int(select, 4);
+		TableInsert(&snapshot->games, crc32, game);
+		++entry;
+	}
+
+	sqlite3_finalize(select);
+	sqlite3_mutex_leave(mutex);
+	return snapshot;
+}
+
+void NoIntroDBSnapshotDestroy(struct NoIntroDBSnapshot* snapshot) {
+	TableDeinit(&snapshot->games);
+	free(snapshot->entries);
+	free(snapshot->strings);
+	free(snapshot);
+}
+
+const struct NoIntroGame* NoIntroDBSnapshotLookupGameByCRC(const struct NoIntroDBSnapshot* snapshot, uint32_t crc32) {
+	if (!snapshot) {
+		return NULL;
+	}
+	return TableLookup(&snapshot->games, crc32);
+}
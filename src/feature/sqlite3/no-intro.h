@@ -28,6 +28,18 @@ bool NoIntroDBLoadClrMamePro(struct NoIntroDB* db, struct VFile* vf);
 void NoIntroDBDestroy(struct NoIntroDB* db);
 bool NoIntroDBLookupGameByCRC(const struct NoIntroDB* db, uint32_t crc32, struct NoIntroGame* game);
 
+// Looks up many CRCs with a single query. The callback gets the index into crc32s of each one that's
+// found; the strings in game are only valid until it returns. Returns how many were found.
+size_t NoIntroDBLookupGamesByCRC(const struct NoIntroDB* db, const uint32_t* crc32s, size_t count,
+	void (*found)(size_t index, const struct NoIntroGame* game, void* context), void* context);
+
+// A copy of every game in the database, for frontends that look up many games and don't want to go
+// through SQLite for each one. It doesn't track later changes to the database.
+struct NoIntroDBSnapshot;
+struct NoIntroDBSnapshot* NoIntroDBSnapshotCreate(const struct NoIntroDB* db);
+void NoIntroDBSnapshotDestroy(struct NoIntroDBSnapshot* snapshot);
+const struct NoIntroGame* NoIntroDBSnapshotLookupGameByCRC(const struct NoIntroDBSnapshot* snapshot, uint32_t crc32);
+
 CXX_GUARD_END
 
 #endif
@@ -0,0 +1,156 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/feature/frame-server.h>
+
+#define WIDTH 16
+#define HEIGHT 8
+
+struct FrameServerTest {
+	struct mFrameServer server;
+	char name[32];
+	// A second mapping of the block, the way another process would see it
+	struct SharedMemory reader;
+};
+
+M_TEST_SUITE_SETUP(FrameServer) {
+	struct FrameServerTest* test = calloc(1, sizeof(*test));
+	mFrameServerInit(&test->server);
+	snprintf(test->name, sizeof(test->name), "mgba-test-%p", (void*) test);
+	if (!mFrameServerOpen(&test->server, test->name, WIDTH, HEIGHT)) {
+		free(test);
+		*state = NULL;
+		return 0;
+	}
+	test->server.d.videoDimensionsChanged(&test->server.d, WIDTH, HEIGHT);
+	if (!sharedMemoryCreateNamed(&test->reader, test->name, test->server.memory.size)) {
+		mFrameServerClose(&test->server);
+		free(test);
+		return -1;
+	}
+	*state = test;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(FrameServer) {
+	struct FrameServerTest* test = *state;
+	if (!test) {
+		return 0;
+	}
+	sharedMemoryDestroy(&test->reader);
+	mFrameServerClose(&test->server);
+	free(test);
+	return 0;
+}
+
+static void _postFrame(struct FrameServerTest* test, color_t value) {
+	color_t pixels[WIDTH * HEIGHT];
+	size_t i;
+	for (i = 0; i < WIDTH * HEIGHT; ++i) {
+		pixels[i] = value + i;
+	}
+	test->server.d.postVideoFrame(&test->server.d, pixels, WIDTH);
+}
+
+static const struct mFrameServerSlot* _latest(const struct mFrameServerHeader* header) {
+	return &header->slots[header->latest];
+}
+
+M_TEST_DEFINE(header) {
+	struct FrameServerTest* test = *state;
+	if (!test) {
+		skip();
+	}
+	const struct mFrameServerHeader* header = test->reader.data;
+	assert_int_equal(header->magic, mFRAME_SERVER_MAGIC);
+	assert_int_equal(header->version, mFRAME_SERVER_VERSION);
+	assert_int_equal(header->format, mCOLOR_NATIVE);
+	assert_int_equal(header->maxWidth, WIDTH);
+	assert_int_equal(header->maxHeight, HEIGHT);
+	assert_int_equal(header->nSlots, mFRAME_SERVER_SLOTS);
+	assert_int_equal(header->frameSequence, 0);
+	assert_true(header->audioOffset + header->audioCapacity * sizeof(struct mStereoSample) <= test->reader.size);
+}
+
+M_TEST_DEFINE(frames) {
+	struct FrameServerTest* test = *state;
+	if (!test) {
+		skip();
+	}
+	const struct mFrameServerHeader* header = test->reader.data;
+	_postFrame(test, 0x100);
+	assert_int_equal(header->frameSequence, 1);
+	const struct mFrameServerSlot* slot = _latest(header);
+	assert_int_equal(slot->frame, 1);
+	assert_int_equal(slot->width, WIDTH);
+	assert_int_equal(slot->height, HEIGHT);
+	assert_int_equal(slot->sequence & 1, 0);
+	const color_t* pixels = (const color_t*) ((const uint8_t*) header + slot->offset);
+	assert_int_equal(pixels[0], 0x100);
+	assert_int_equal(pixels[slot->stride / sizeof(color_t) * (HEIGHT - 1) + WIDTH - 1], 0x100 + WIDTH * HEIGHT - 1);
+
+	// A new frame goes into a different slot, leaving the last one alone for readers still using it
+	uint32_t first = header->latest;
+	_postFrame(test, 0x200);
+	assert_int_not_equal(header->latest, first);
+	assert_int_equal(pixels[0], 0x100);
+	slot = _latest(header);
+	pixels = (const color_t*) ((const uint8_t*) header + slot->offset);
+	assert_int_equal(pixels[0], 0x200);
+	assert_int_equal(slot->frame, 2);
+
+	// Repeats just bump the frame number
+	uint32_t second = header->latest;
+	test->server.d.postVideoFrameRepeat(&test->server.d, NULL, 0);
+	assert_int_equal(header->latest, second);
+	assert_int_equal(_latest(header)->frame, 3);
+	assert_int_equal(header->frameSequence, 3);
+}
+
+M_TEST_DEFINE(audio) {
+	struct FrameServerTest* test = *state;
+	if (!test) {
+		skip();
+	}
+	const struct mFrameServerHeader* header = test->reader.data;
+	test->server.d.audioRateChanged(&test->server.d, 32768);
+	assert_int_equal(header->audioRate, 32768);
+
+	uint32_t start = header->audioWritten;
+	int i;
+	for (i = 0; i < 10; ++i) {
+		test->server.d.postAudioFrame(&test->server.d, i, -i);
+	}
+	_postFrame(test, 0);
+	assert_int_equal(header->audioWritten - start, 10);
+	const struct mStereoSample* ring = (const struct mStereoSample*) ((const uint8_t*) header + header->audioOffset);
+	for (i = 0; i < 10; ++i) {
+		const struct mStereoSample* sample = &ring[(start + i) % header->audioCapacity];
+		assert_int_equal(sample->left, i);
+		assert_int_equal(sample->right, -i);
+	}
+}
+
+M_TEST_DEFINE(oversized) {
+	struct FrameServerTest* test = *state;
+	if (!test) {
+		skip();
+	}
+	const struct mFrameServerHeader* header = test->reader.data;
+	uint32_t sequence = header->frameSequence;
+	test->server.d.videoDimensionsChanged(&test->server.d, WIDTH * 2, HEIGHT);
+	color_t pixels[WIDTH * 2 * HEIGHT] = {0};
+	test->server.d.postVideoFrame(&test->server.d, pixels, WIDTH * 2);
+	assert_int_equal(header->frameSequence, sequence);
+	test->server.d.videoDimensionsChanged(&test->server.d, WIDTH, HEIGHT);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(FrameServer,
+	cmocka_unit_test(header),
+	cmocka_unit_test(frames),
+	cmocka_unit_test(audio),
+	cmocka_unit_test(oversized))
@@ -0,0 +1,335 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/feature/gif-encoder.h>
+#include <mgba-util/image.h>
+#include <mgba-util/vfs.h>
+
+#define WIDTH 128
+#define HEIGHT 64
+#define MAX_FRAMES 8
+
+struct GIFFrame {
+	unsigned x;
+	unsigned y;
+	unsigned width;
+	unsigned height;
+	unsigned delay;
+	bool localPalette;
+};
+
+struct GIFDecoded {
+	unsigned width;
+	unsigned height;
+	bool loop;
+	unsigned nFrames;
+	struct GIFFrame frames[MAX_FRAMES];
+	uint32_t canvas[WIDTH * HEIGHT];
+};
+
+static void _postFrame(struct mGIFEncoder* encoder, const uint32_t* rgb) {
+	color_t pixels[WIDTH * HEIGHT];
+	mColorConvertRow(pixels, mCOLOR_NATIVE, rgb, mCOLOR_XRGB8, WIDTH * HEIGHT);
+	encoder->d.postVideoFrame(&encoder->d, pixels, WIDTH);
+}
+
+static uint32_t _nativeRGB(uint32_t color) {
+	// Colors come out the way the native format stores them
+	color_t native;
+	uint32_t out;
+	mColorConvertRow(&native, mCOLOR_NATIVE, &color, mCOLOR_XRGB8, 1);
+	mColorConvertRow(&out, mCOLOR_XRGB8, &native, mCOLOR_NATIVE, 1);
+	return out & 0xFFFFFF;
+}
+
+static size_t _readSubBlocks(const uint8_t* data, size_t offset, uint8_t* out, size_t* outSize) {
+	size_t size = 0;
+	while (data[offset]) {
+		unsigned length = data[offset];
+		if (out) {
+			memcpy(&out[size], &data[offset + 1], length);
+		}
+		size += length;
+		offset += length + 1;
+	}
+	if (outSize) {
+		*outSize = size;
+	}
+	return offset + 1;
+}
+
+static size_t _decodeLZW(const uint8_t* data, size_t size, unsigned minBits, uint8_t* out, size_t outSize) {
+	uint16_t prefixes[4096];
+	uint8_t suffixes[4096];
+	uint8_t stack[4096];
+	unsigned clearCode = 1 << minBits;
+	unsigned bits = minBits + 1;
+	unsigned nextCode = clearCode + 2;
+	int previous = -1;
+	uint8_t first = 0;
+	size_t written = 0;
+	size_t bit = 0;
+	while (bit + bits <= size * 8) {
+		unsigned code = 0;
+		unsigned i;
+		for (i = 0; i < bits; ++i, ++bit) {
+			code |= ((data[bit / 8] >> (bit % 8)) & 1) << i;
+		}
+		if (code == clearCode) {
+			bits = minBits + 1;
+			nextCode = clearCode + 2;
+			previous = -1;
+			continue;
+		}
+		if (code == clearCode + 1) {
+			break;
+		}
+		unsigned current = code;
+		size_t depth = 0;
+		if (code >= nextCode) {
+			assert_int_equal(code, nextCode);
+			assert_true(previous >= 0);
+			stack[depth++] = first;
+			current = previous;
+		}
+		while (current > clearCode) {
+			stack[depth++] = suffixes[current];
+			current = prefixes[current];
+		}
+		stack[depth++] = current;
+		first = current;
+		while (depth && written < outSize) {
+			out[written++] = stack[--depth];
+		}
+		if (previous >= 0 && nextCode < 4096) {
+			prefixes[nextCode] = previous;
+			suffixes[nextCode] = first;
+			++nextCode;
+		}
+		if (nextCode == (1U << bits) && bits < 12) {
+			++bits;
+		}
+		previous = code;
+	}
+	return written;
+}
+
+static void _readPalette(const uint8_t* data, unsigned bits, uint32_t* palette) {
+	unsigned i;
+	for (i = 0; i < (1U << bits); ++i) {
+		palette[i] = (data[i * 3] << 16) | (data[i * 3 + 1] << 8) | data[i * 3 + 2];
+	}
+}
+
+static void _decodeGIF(struct VFile* vf, struct GIFDecoded* gif) {
+	memset(gif, 0, sizeof(*gif));
+	size_t size = vf->size(vf);
+	uint8_t* data = vf->map(vf, size, MAP_READ);
+	assert_non_null(data);
+	assert_memory_equal(data, "GIF89a", 6);
+	assert_int_equal(data[size - 1], 0x3B);
+	gif->width = data[6] | (data[7] << 8);
+	gif->height = data[8] | (data[9] << 8);
+	assert_int_equal(gif->width, WIDTH);
+	assert_int_equal(gif->height, HEIGHT);
+
+	uint32_t globalPalette[256] = {0};
+	uint32_t localPalette[256];
+	size_t offset = 13;
+	if (data[10] & 0x80) {
+		_readPalette(&data[offset], (data[10] & 7) + 1, globalPalette);
+		offset += 3 << ((data[10] & 7) + 1);
+	}
+
+	int transparent = -1;
+	unsigned delay = 0;
+	while (data[offset] != 0x3B) {
+		assert_true(offset < size);
+		if (data[offset] == 0x21) {
+			if (data[offset + 1] == 0xF9) {
+				delay = data[offset + 4] | (data[offset + 5] << 8);
+				transparent = (data[offset + 3] & 1) ? data[offset + 6] : -1;
+			} else if (data[offset + 1] == 0xFF && !memcmp(&data[offset + 3], "NETSCAPE2.0", 11)) {
+				gif->loop = true;
+			}
+			offset = _readSubBlocks(data, offset + 2, NULL, NULL);
+			continue;
+		}
+		assert_int_equal(data[offset], 0x2C);
+		assert_true(gif->nFrames < MAX_FRAMES);
+		struct GIFFrame* frame = &gif->frames[gif->nFrames];
+		++gif->nFrames;
+		frame->x = data[offset + 1] | (data[offset + 2] << 8);
+		frame->y = data[offset + 3] | (data[offset + 4] << 8);
+		frame->width = data[offset + 5] | (data[offset + 6] << 8);
+		frame->height = data[offset + 7] | (data[offset + 8] << 8);
+		frame->delay = delay;
+		assert_true(frame->x + frame->width <= WIDTH);
+		assert_true(frame->y + frame->height <= HEIGHT);
+		const uint32_t* palette = globalPalette;
+		uint8_t flags = data[offset + 9];
+		offset += 10;
+		if (flags & 0x80) {
+			frame->localPalette = true;
+			_readPalette(&data[offset], (flags & 7) + 1, localPalette);
+			offset += 3 << ((flags & 7) + 1);
+			palette = localPalette;
+		}
+		unsigned minBits = data[offset];
+		size_t lzwSize;
+		_readSubBlocks(data, offset + 1, NULL, &lzwSize);
+		uint8_t* lzw = malloc(lzwSize);
+		offset = _readSubBlocks(data, offset + 1, lzw, NULL);
+		uint8_t indices[WIDTH * HEIGHT];
+		size_t count = frame->width * frame->height;
+		assert_int_equal(_decodeLZW(lzw, lzwSize, minBits, indices, count), count);
+		free(lzw);
+
+		unsigned x, y;
+		for (y = 0; y < frame->height; ++y) {
+			for (x = 0; x < frame->width; ++x) {
+				uint8_t index = indices[y * frame->width + x];
+				if (index == transparent) {
+					continue;
+				}
+				gif->canvas[(frame->y + y) * WIDTH + frame->x + x] = palette[index];
+			}
+		}
+	}
+	vf->unmap(vf, data, size);
+}
+
+static struct VFile* _openEncoder(struct mGIFEncoder* encoder) {
+	mGIFEncoderInit(encoder);
+	mGIFEncoderSetDimensions(encoder, WIDTH, HEIGHT);
+	// One centisecond per frame keeps the delays easy to check
+	mGIFEncoderSetInputFrameRate(encoder, 1, 100);
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mGIFEncoderOpenVF(encoder, vf));
+	return vf;
+}
+
+M_TEST_DEFINE(singleFrame) {
+	struct mGIFEncoder encoder;
+	struct VFile* vf = _openEncoder(&encoder);
+	uint32_t frame[WIDTH * HEIGHT];
+	size_t i;
+	for (i = 0; i < WIDTH * HEIGHT; ++i) {
+		frame[i] = (i & 3) * 0x400000 | (i & 12) * 0x1000;
+	}
+	_postFrame(&encoder, frame);
+	mGIFEncoderClose(&encoder);
+	assert_false(mGIFEncoderIsOpen(&encoder));
+
+	struct GIFDecoded gif;
+	_decodeGIF(vf, &gif);
+	assert_true(gif.loop);
+	assert_int_equal(gif.nFrames, 1);
+	assert_int_equal(gif.frames[0].width, WIDTH);
+	assert_int_equal(gif.frames[0].height, HEIGHT);
+	assert_false(gif.frames[0].localPalette);
+	assert_int_equal(gif.frames[0].delay, 1);
+	for (i = 0; i < WIDTH * HEIGHT; ++i) {
+		assert_int_equal(gif.canvas[i], _nativeRGB(frame[i]));
+	}
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(repeatedFrames) {
+	struct mGIFEncoder encoder;
+	struct VFile* vf = _openEncoder(&encoder);
+	mGIFEncoderSetLooping(&encoder, false);
+	uint32_t frame[WIDTH * HEIGHT] = {0};
+	_postFrame(&encoder, frame);
+	_postFrame(&encoder, frame);
+	encoder.d.postVideoFrameRepeat(&encoder.d, NULL, 0);
+	frame[WIDTH * 3 + 5] = 0xFFFFFF;
+	_postFrame(&encoder, frame);
+	_postFrame(&encoder, frame);
+	mGIFEncoderClose(&encoder);
+
+	struct GIFDecoded gif;
+	_decodeGIF(vf, &gif);
+	assert_false(gif.loop);
+	assert_int_equal(gif.nFrames, 2);
+	assert_int_equal(gif.frames[0].delay, 3);
+	assert_int_equal(gif.frames[1].delay, 2);
+	// Only the pixel that changed gets written
+	assert_int_equal(gif.frames[1].x, 5);
+	assert_int_equal(gif.frames[1].y, 3);
+	assert_int_equal(gif.frames[1].width, 1);
+	assert_int_equal(gif.frames[1].height, 1);
+	assert_int_equal(gif.canvas[WIDTH * 3 + 5], _nativeRGB(0xFFFFFF));
+	assert_int_equal(gif.canvas[WIDTH * 3 + 4], 0);
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(paletteReuse) {
+	struct mGIFEncoder encoder;
+	struct VFile* vf = _openEncoder(&encoder);
+	uint32_t frame[WIDTH * HEIGHT];
+	size_t i;
+	for (i = 0; i < WIDTH * HEIGHT; ++i) {
+		frame[i] = (i & 1) ? 0xFF0000 : 0x0000FF;
+	}
+	_postFrame(&encoder, frame);
+	// Colors from the first frame are still in the global palette
+	frame[0] = 0xFF0000;
+	_postFrame(&encoder, frame);
+	// New colors need a palette of their own
+	frame[1] = 0x00FF00;
+	_postFrame(&encoder, frame);
+	mGIFEncoderClose(&encoder);
+
+	struct GIFDecoded gif;
+	_decodeGIF(vf, &gif);
+	assert_int_equal(gif.nFrames, 3);
+	assert_false(gif.frames[1].localPalette);
+	assert_true(gif.frames[2].localPalette);
+	for (i = 0; i < WIDTH * HEIGHT; ++i) {
+		assert_int_equal(gif.canvas[i], _nativeRGB(frame[i]));
+	}
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(manyColors) {
+	struct mGIFEncoder encoder;
+	struct VFile* vf = _openEncoder(&encoder);
+	uint32_t frame[WIDTH * HEIGHT];
+	size_t i;
+	// Noise has far more colors than fit in a palette, and runs the LZW table past its size limit
+	uint32_t seed = 1;
+	unsigned f;
+	for (f = 0; f < 3; ++f) {
+		for (i = 0; i < WIDTH * HEIGHT; ++i) {
+			seed = seed * 1103515245 + 12345;
+			frame[i] = seed >> 8;
+		}
+		_postFrame(&encoder, frame);
+	}
+	mGIFEncoderClose(&encoder);
+
+	struct GIFDecoded gif;
+	_decodeGIF(vf, &gif);
+	assert_int_equal(gif.nFrames, 3);
+	// Colors are allowed to be off by the bits dropped to fit them into one palette
+	for (i = 0; i < WIDTH * HEIGHT; ++i) {
+		uint32_t expected = _nativeRGB(frame[i]);
+		int shift;
+		for (shift = 0; shift < 24; shift += 8) {
+			int difference = (int) ((gif.canvas[i] >> shift) & 0xFF) - (int) ((expected >> shift) & 0xFF);
+			assert_in_range(difference, -0x20, 0x20);
+		}
+	}
+	vf->close(vf);
+}
+
+M_TEST_SUITE_DEFINE(GIFEncoder,
+	cmocka_unit_test(singleFrame),
+	cmocka_unit_test(repeatedFrames),
+	cmocka_unit_test(paletteReuse),
+	cmocka_unit_test(manyColors))
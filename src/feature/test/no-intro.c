@@ -0,0 +1,114 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include "feature/sqlite3/no-intro.h"
+
+#include <mgba-util/string.h>
+#include <mgba-util/vfs.h>
+
+static const char _dat[] =
+	"clrmamepro (\n"
+	"\tname \"Nintendo - Game Boy\"\n"
+	"\tversion 20260101\n"
+	")\n"
+	"\n"
+	"game (\n"
+	"\tname \"Alpha (World)\"\n"
+	"\trom ( name \"Alpha (World).gb\" size 32768 crc 0BADF00D )\n"
+	")\n"
+	"\n"
+	"game (\n"
+	"\tname \"Beta (Japan)\"\n"
+	"\trom ( name \"Beta (Japan).gb\" size 65536 crc DEADBEEF )\n"
+	")\n"
+	"\n"
+	"game (\n"
+	"\tname \"Gamma (USA)\"\n"
+	"\trom ( name \"Gamma (USA).gb\" size 131072 crc 00C0FFEE )\n"
+	")\n";
+
+struct LookupResults {
+	size_t calls;
+	char names[4][32];
+};
+
+static void _found(size_t index, const struct NoIntroGame* game, void* context) {
+	struct LookupResults* results = context;
+	++results->calls;
+	strlcpy(results->names[index], game->name, sizeof(results->names[index]));
+}
+
+M_TEST_SUITE_SETUP(NoIntroDB) {
+	struct NoIntroDB* db = NoIntroDBLoad(":memory:");
+	if (!db) {
+		return -1;
+	}
+	struct VFile* vf = VFileFromConstMemory(_dat, sizeof(_dat) - 1);
+	bool loaded = NoIntroDBLoadClrMamePro(db, vf);
+	vf->close(vf);
+	if (!loaded) {
+		NoIntroDBDestroy(db);
+		return -1;
+	}
+	*state = db;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(NoIntroDB) {
+	NoIntroDBDestroy(*state);
+	return 0;
+}
+
+M_TEST_DEFINE(lookupSingle) {
+	struct NoIntroDB* db = *state;
+	struct NoIntroGame game;
+	assert_true(NoIntroDBLookupGameByCRC(db, 0xDEADBEEF, &game));
+	assert_string_equal(game.name, "Beta (Japan)");
+	assert_false(NoIntroDBLookupGameByCRC(db, 0x12345678, &game));
+}
+
+M_TEST_DEFINE(lookupBatch) {
+	struct NoIntroDB* db = *state;
+	static const uint32_t crc32s[] = { 0x00C0FFEE, 0x12345678, 0x0BADF00D, 0xDEADBEEF };
+	struct LookupResults results = { 0 };
+	assert_int_equal(NoIntroDBLookupGamesByCRC(db, crc32s, 4, _found, &results), 3);
+	assert_int_equal(results.calls, 3);
+	assert_string_equal(results.names[0], "Gamma (USA)");
+	assert_string_equal(results.names[1], "");
+	assert_string_equal(results.names[2], "Alpha (World)");
+	assert_string_equal(results.names[3], "Beta (Japan)");
+
+	// Nothing from the last batch may leak into the next one
+	memset(&results, 0, sizeof(results));
+	assert_int_equal(NoIntroDBLookupGamesByCRC(db, &crc32s[1], 1, _found, &results), 0);
+	assert_int_equal(results.calls, 0);
+}
+
+M_TEST_DEFINE(snapshot) {
+	struct NoIntroDB* db = *state;
+	struct NoIntroDBSnapshot* snapshot = NoIntroDBSnapshotCreate(db);
+	assert_non_null(snapshot);
+
+	const struct NoIntroGame* game = NoIntroDBSnapshotLookupGameByCRC(snapshot, 0x0BADF00D);
+	assert_non_null(game);
+	assert_string_equal(game->name, "Alpha (World)");
+	assert_string_equal(game->romName, "Alpha (World).gb");
+	assert_int_equal(game->size, 32768);
+	assert_int_equal(game->crc32, 0x0BADF00D);
+
+	game = NoIntroDBSnapshotLookupGameByCRC(snapshot, 0x00C0FFEE);
+	assert_non_null(game);
+	assert_string_equal(game->name, "Gamma (USA)");
+	assert_null(NoIntroDBSnapshotLookupGameByCRC(snapshot, 0x12345678));
+
+	NoIntroDBSnapshotDestroy(snapshot);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(NoIntroDB,
+	cmocka_unit_test(lookupSingle),
+	cmocka_unit_test(lookupBatch),
+	cmocka_unit_test(snapshot))
@@ -0,0 +1,193 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/feature/proxy-backend.h>
+#include <mgba-util/image.h>
+
+#define WIDTH 4
+#define HEIGHT 3
+
+struct TestBackend {
+	struct VideoBackend d;
+	enum mVideoBackendCommandType calls[64];
+	size_t nCalls;
+	uint8_t image[WIDTH * HEIGHT * BYTES_PER_PIXEL];
+	const void* lastImage;
+};
+
+struct ProxyTest {
+	struct mVideoProxyBackend proxy;
+	struct TestBackend backend;
+	int wakeups;
+};
+
+static void _record(struct VideoBackend* v, enum mVideoBackendCommandType cmd) {
+	struct TestBackend* backend = (struct TestBackend*) v;
+	if (backend->nCalls < sizeof(backend->calls) / sizeof(*backend->calls)) {
+		backend->calls[backend->nCalls] = cmd;
+	}
+	++backend->nCalls;
+}
+
+static void _setLayerDimensions(struct VideoBackend* v, enum VideoLayer layer, const struct mRectangle* dims) {
+	UNUSED(layer);
+	UNUSED(dims);
+	_record(v, mVB_CMD_SET_LAYER_DIMENSIONS);
+}
+
+static void _swap(struct VideoBackend* v) {
+	_record(v, mVB_CMD_SWAP);
+}
+
+static void _clear(struct VideoBackend* v) {
+	_record(v, mVB_CMD_CLEAR);
+}
+
+static void _contextResized(struct VideoBackend* v, unsigned w, unsigned h) {
+	UNUSED(w);
+	UNUSED(h);
+	_record(v, mVB_CMD_CONTEXT_RESIZED);
+}
+
+static void _setImageSize(struct VideoBackend* v, enum VideoLayer layer, int w, int h) {
+	UNUSED(layer);
+	UNUSED(w);
+	UNUSED(h);
+	_record(v, mVB_CMD_SET_IMAGE_SIZE);
+}
+
+static void _setImage(struct VideoBackend* v, enum VideoLayer layer, const void* frame) {
+	UNUSED(layer);
+	struct TestBackend* backend = (struct TestBackend*) v;
+	_record(v, mVB_CMD_SET_IMAGE);
+	memcpy(backend->image, frame, sizeof(backend->image));
+	backend->lastImage = frame;
+}
+
+static void _setImageRegion(struct VideoBackend* v, enum VideoLayer layer, const struct mRectangle* region, const void* frame) {
+	UNUSED(layer);
+	struct TestBackend* backend = (struct TestBackend*) v;
+	_record(v, mVB_CMD_SET_IMAGE_REGION);
+	size_t stride = WIDTH * BYTES_PER_PIXEL;
+	memcpy(&backend->image[stride * region->y], (const uint8_t*) frame + stride * region->y, stride * region->height);
+	backend->lastImage = frame;
+}
+
+static void _wakeup(struct mVideoProxyBackend* proxy, void* context) {
+	UNUSED(proxy);
+	struct ProxyTest* test = context;
+	++test->wakeups;
+}
+
+M_TEST_SUITE_SETUP(ProxyBackend) {
+	struct ProxyTest* test = calloc(1, sizeof(*test));
+	test->backend.d.setLayerDimensions = _setLayerDimensions;
+	test->backend.d.swap = _swap;
+	test->backend.d.clear = _clear;
+	test->backend.d.contextResized = _contextResized;
+	test->backend.d.setImageSize = _setImageSize;
+	test->backend.d.setImage = _setImage;
+	test->backend.d.setImageRegion = _setImageRegion;
+	mVideoProxyBackendInit(&test->proxy, &test->backend.d);
+	test->proxy.wakeupCb = _wakeup;
+	test->proxy.context = test;
+	*state = test;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(ProxyBackend) {
+	struct ProxyTest* test = *state;
+	mVideoProxyBackendDeinit(&test->proxy);
+	free(test);
+	return 0;
+}
+
+static void _reset(struct ProxyTest* test) {
+	mVideoProxyBackendFlush(&test->proxy);
+	mVideoProxyBackendRun(&test->proxy, false);
+	test->backend.nCalls = 0;
+	test->wakeups = 0;
+}
+
+M_TEST_DEFINE(batch) {
+	struct ProxyTest* test = *state;
+	struct VideoBackend* v = &test->proxy.d;
+	_reset(test);
+
+	struct mRectangle dims = { 0, 0, WIDTH, HEIGHT };
+	v->setLayerDimensions(v, VIDEO_LAYER_OVERLAY0, &dims);
+	v->clear(v);
+	v->contextResized(v, WIDTH, HEIGHT);
+	v->swap(v);
+	assert_int_equal(test->wakeups, 0);
+	assert_false(mVideoProxyBackendRun(&test->proxy, false));
+
+	v->flush(v);
+	assert_int_equal(test->wakeups, 1);
+	assert_true(mVideoProxyBackendRun(&test->proxy, false));
+	assert_int_equal(test->backend.nCalls, 4);
+	assert_int_equal(test->backend.calls[0], mVB_CMD_SET_LAYER_DIMENSIONS);
+	assert_int_equal(test->backend.calls[1], mVB_CMD_CLEAR);
+	assert_int_equal(test->backend.calls[2], mVB_CMD_CONTEXT_RESIZED);
+	assert_int_equal(test->backend.calls[3], mVB_CMD_SWAP);
+	assert_int_equal(test->proxy.completed, test->proxy.submitted);
+}
+
+M_TEST_DEFINE(batchOverflow) {
+	struct ProxyTest* test = *state;
+	struct VideoBackend* v = &test->proxy.d;
+	_reset(test);
+
+	int i;
+	for (i = 0; i < mVIDEO_PROXY_BATCH_SIZE + 1; ++i) {
+		v->clear(v);
+	}
+	assert_int_equal(test->wakeups, 1);
+	v->flush(v);
+	assert_int_equal(test->wakeups, 2);
+	mVideoProxyBackendRun(&test->proxy, false);
+	assert_int_equal(test->backend.nCalls, mVIDEO_PROXY_BATCH_SIZE + 1);
+}
+
+M_TEST_DEFINE(stagedImage) {
+	struct ProxyTest* test = *state;
+	struct VideoBackend* v = &test->proxy.d;
+	_reset(test);
+
+	uint8_t image[WIDTH * HEIGHT * BYTES_PER_PIXEL];
+	memset(image, 0x11, sizeof(image));
+	v->setImageSize(v, VIDEO_LAYER_OVERLAY0, WIDTH, HEIGHT);
+	v->setImage(v, VIDEO_LAYER_OVERLAY0, image);
+	// The caller is free to change the image as soon as setImage returns
+	memset(image, 0x22, sizeof(image));
+	assert_int_equal(test->backend.nCalls, 0);
+
+	v->flush(v);
+	mVideoProxyBackendRun(&test->proxy, false);
+	assert_int_equal(test->backend.nCalls, 2);
+	assert_int_equal(test->backend.calls[1], mVB_CMD_SET_IMAGE);
+	assert_ptr_not_equal(test->backend.lastImage, image);
+	assert_int_equal(test->backend.image[0], 0x11);
+	assert_int_equal(test->backend.image[sizeof(image) - 1], 0x11);
+
+	struct mRectangle region = { 0, 1, WIDTH, 1 };
+	v->setImageRegion(v, VIDEO_LAYER_OVERLAY0, &region, image);
+	memset(image, 0x33, sizeof(image));
+	v->flush(v);
+	mVideoProxyBackendRun(&test->proxy, false);
+	assert_int_equal(test->backend.calls[2], mVB_CMD_SET_IMAGE_REGION);
+	size_t stride = WIDTH * BYTES_PER_PIXEL;
+	assert_int_equal(test->backend.image[0], 0x11);
+	assert_int_equal(test->backend.image[stride], 0x22);
+	assert_int_equal(test->backend.image[stride * 2 - 1], 0x22);
+	assert_int_equal(test->backend.image[stride * 2], 0x11);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(ProxyBackend,
+	cmocka_unit_test(batch),
+	cmocka_unit_test(batchOverflow),
+	cmocka_unit_test(stagedImage))
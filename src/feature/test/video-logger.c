@@ -0,0 +1,306 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/feature/video-logger.h>
+
+#ifdef M_CORE_GBA
+#include <mgba/core/core.h>
+#include <mgba/gba/core.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/video.h>
+#include <mgba-util/hash.h>
+#include <mgba-util/vfs.h>
+#endif
+
+#define VRAM_SIZE 0x18000
+
+struct LoggerTest {
+	struct mVideoLogger logger;
+	uint16_t vram[VRAM_SIZE / 2];
+	struct mVideoLoggerDirtyInfo packets[64];
+	size_t nPackets;
+	size_t dataSize;
+};
+
+static bool _recordData(struct mVideoLogger* logger, const void* data, size_t length) {
+	struct LoggerTest* test = logger->context;
+	// Packet headers are all the same size, so anything else is the VRAM that follows one
+	if (length != sizeof(struct mVideoLoggerDirtyInfo)) {
+		test->dataSize += length;
+		return true;
+	}
+	if (test->nPackets < sizeof(test->packets) / sizeof(*test->packets)) {
+		memcpy(&test->packets[test->nPackets], data, length);
+		++test->nPackets;
+	}
+	return true;
+}
+
+static uint16_t* _vramBlock(struct mVideoLogger* logger, uint32_t address) {
+	struct LoggerTest* test = logger->context;
+	return &test->vram[address >> 1];
+}
+
+M_TEST_SUITE_SETUP(VideoLogger) {
+	struct LoggerTest* test = calloc(1, sizeof(*test));
+	mVideoLoggerRendererCreate(&test->logger, false);
+	test->logger.writeData = _recordData;
+	test->logger.vramBlock = _vramBlock;
+	test->logger.context = test;
+	test->logger.vramSize = VRAM_SIZE;
+	test->logger.oamSize = 0x400;
+	test->logger.paletteSize = 0x400;
+	mVideoLoggerRendererInit(&test->logger);
+	*state = test;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(VideoLogger) {
+	struct LoggerTest* test = *state;
+	mVideoLoggerRendererDeinit(&test->logger);
+	free(test);
+	return 0;
+}
+
+M_TEST_DEFINE(vramChunks) {
+	struct LoggerTest* test = *state;
+	mVideoLoggerRendererWriteVRAM(&test->logger, 0x10);
+	mVideoLoggerRendererWriteVRAM(&test->logger, 0x12);
+	mVideoLoggerRendererWriteVRAM(&test->logger, 0x17FFE);
+	mVideoLoggerRendererDrawScanline(&test->logger, 0);
+
+	assert_int_equal(test->nPackets, 3);
+	assert_int_equal(test->packets[0].type, DIRTY_VRAM);
+	assert_int_equal(test->packets[0].address, 0);
+	assert_int_equal(test->packets[0].value, 0x100);
+	assert_int_equal(test->packets[1].type, DIRTY_VRAM);
+	assert_int_equal(test->packets[1].address, 0x17F00);
+	assert_int_equal(test->packets[1].value, 0x100);
+	assert_int_equal(test->packets[2].type, DIRTY_SCANLINE);
+	assert_int_equal(test->dataSize, 0x200);
+
+	// Nothing is shipped again until it's written again
+	test->nPackets = 0;
+	mVideoLoggerRendererDrawScanline(&test->logger, 1);
+	assert_int_equal(test->nPackets, 1);
+	assert_int_equal(test->packets[0].type, DIRTY_SCANLINE);
+}
+
+M_TEST_DEFINE(vramRuns) {
+	struct LoggerTest* test = *state;
+	test->nPackets = 0;
+	test->dataSize = 0;
+	uint32_t address;
+	// Runs of dirty chunks share a packet, up to 4 KiB each, including across bitmap words
+	for (address = 0x1F00; address < 0x3400; address += 0x80) {
+		mVideoLoggerRendererWriteVRAM(&test->logger, address);
+	}
+	mVideoLoggerRendererDrawScanline(&test->logger, 0);
+
+	assert_int_equal(test->nPackets, 3);
+	assert_int_equal(test->packets[0].address, 0x1F00);
+	assert_int_equal(test->packets[0].value, 0x1000);
+	assert_int_equal(test->packets[1].address, 0x2F00);
+	assert_int_equal(test->packets[1].value, 0x500);
+	assert_int_equal(test->packets[2].type, DIRTY_SCANLINE);
+	assert_int_equal(test->dataSize, 0x1500);
+}
+
+#ifdef M_CORE_GBA
+struct AudioHashStream {
+	struct mAVStream d;
+	int samples;
+	uint32_t hash;
+};
+
+static void _hashAudioFrame(struct mAVStream* stream, int16_t left, int16_t right) {
+	struct AudioHashStream* hashing = (struct AudioHashStream*) stream;
+	int16_t sample[2] = { left, right };
+	hashing->hash = hash32(sample, sizeof(sample), hashing->hash);
+	++hashing->samples;
+}
+
+static struct mCore* _createCore(color_t* buffer) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	core->setVideoBuffer(core, buffer, GBA_VIDEO_HORIZONTAL_PIXELS);
+	core->busWrite32(core, GBA_BASE_EWRAM + 0xC0, 0xEAFFFFFE); // Loop forever
+	core->reset(core);
+	core->runFrame(core);
+	return core;
+}
+
+static void _startAudio(struct mCore* core) {
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_SOUNDCNT_X, 0x0080);
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_SOUNDCNT_LO, 0xCC77);
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_SOUNDCNT_HI, 0x0002);
+	// Square with an envelope, and some noise
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_SOUND2CNT_LO, 0xF380);
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_SOUND2CNT_HI, 0x8740);
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_SOUND4CNT_LO, 0xF100);
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_SOUND4CNT_HI, 0x804D);
+}
+
+static void _drawTestPattern(struct mCore* core, uint16_t color) {
+	core->busWrite16(core, GBA_BASE_PALETTE_RAM + 2, color);
+	unsigned i;
+	for (i = 0; i < 8; ++i) {
+		core->busWrite32(core, GBA_BASE_VRAM + 0x20 + i * 4, 0x01101001 << (i & 3));
+	}
+	for (i = 0; i < 0x400; ++i) {
+		core->busWrite16(core, GBA_BASE_VRAM + 0xF800 + i * 2, (i & 1) + 1);
+	}
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_BG0CNT, 0x1F00);
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_DISPCNT, 0x0100);
+}
+
+static void _testContextAudio(bool compression, int level, unsigned threads) {
+	color_t* buffer = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	struct mCore* reference = _createCore(buffer);
+	struct mCore* core = _createCore(buffer);
+	struct AudioHashStream expected = {
+		.d = {
+			.postAudioFrame = _hashAudioFrame,
+		}
+	};
+	reference->setAVStream(reference, &expected.d);
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	struct mVideoLogContext* context = mVideoLogContextCreate(core);
+	mVideoLogContextSetOutput(context, vf);
+	mVideoLogContextSetCompression(context, compression);
+	mVideoLogContextSetCompressionLevel(context, level);
+	mVideoLogContextSetCompressionThreads(context, threads);
+	struct mAVStream* stream = mVideoLogContextRecordAudio(context);
+	assert_non_null(stream);
+	mVideoLogContextWriteHeader(context, core);
+	core->setAVStream(core, stream);
+
+	_startAudio(reference);
+	_startAudio(core);
+	size_t i;
+	for (i = 0; i < 20; ++i) {
+		reference->runFrame(reference);
+		core->runFrame(core);
+	}
+	assert_true(expected.samples > 0);
+	core->setAVStream(core, NULL);
+	mVideoLogContextDestroy(core, context, false);
+
+	context = mVideoLogContextCreate(NULL);
+	assert_true(mVideoLogContextLoad(context, vf));
+	assert_int_equal(mVideoLogContextFindChannel(context, mVL_CHANNEL_VIDEO), 0);
+	int channelId = mVideoLogContextFindChannel(context, mVL_CHANNEL_AUDIO);
+	assert_int_equal(channelId, 1);
+
+	struct AudioHashStream actual = { .hash = 0 };
+	struct mStereoSample samples[0x300];
+	unsigned sampleRate = 0;
+	size_t read;
+	while ((read = mVideoLogContextReadAudio(context, channelId, samples, 0x300, &sampleRate))) {
+		assert_int_equal(sampleRate, GBA_ARM7TDMI_FREQUENCY / 0x200);
+		for (i = 0; i < read; ++i) {
+			_hashAudioFrame(&actual.d, samples[i].left, samples[i].right);
+		}
+	}
+	assert_int_equal(actual.samples, expected.samples);
+	assert_int_equal(actual.hash, expected.hash);
+	mVideoLogContextDestroy(NULL, context, true);
+
+	reference->setAVStream(reference, NULL);
+	mCoreConfigDeinit(&reference->config);
+	reference->deinit(reference);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(buffer);
+}
+
+M_TEST_DEFINE(contextAudio) {
+	_testContextAudio(false, mVL_DEFAULT_COMPRESSION_LEVEL, 0);
+#ifdef USE_ZLIB
+	_testContextAudio(true, 1, 0);
+	_testContextAudio(true, mVL_DEFAULT_COMPRESSION_LEVEL, mVL_DEFAULT_COMPRESSION_THREADS);
+	_testContextAudio(true, 6, 5);
+#endif
+}
+
+static uint32_t _hashPlayerFrame(struct mCore* player) {
+	const void* pixels;
+	size_t stride;
+	player->getPixels(player, &pixels, &stride);
+	return hash32(pixels, stride * GBA_VIDEO_VERTICAL_PIXELS * BYTES_PER_PIXEL, 0);
+}
+
+M_TEST_DEFINE(playerSeek) {
+	color_t* buffer = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	struct mCore* core = _createCore(buffer);
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	struct mVideoLogContext* context = mVideoLogContextCreate(core);
+	mVideoLogContextSetOutput(context, vf);
+	mVideoLogContextSetKeyframeInterval(context, 4);
+	mVideoLogContextWriteHeader(context, core);
+
+	_drawTestPattern(core, 0x001F);
+	size_t i;
+	for (i = 0; i < 20; ++i) {
+		// Change the picture every frame so each one is distinct
+		core->busWrite16(core, GBA_BASE_PALETTE_RAM + 2, i * 0x421);
+		core->busWrite16(core, GBA_BASE_IO | GBA_REG_BG0HOFS, i);
+		core->runFrame(core);
+	}
+	mVideoLogContextDestroy(core, context, false);
+
+	color_t* playerBuffer = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	struct mCore* player = GBAVideoLogPlayerCreate();
+	assert_non_null(player);
+	assert_true(player->init(player));
+	mCoreInitConfig(player, NULL);
+	player->setVideoBuffer(player, playerBuffer, GBA_VIDEO_HORIZONTAL_PIXELS);
+	assert_true(player->loadROM(player, vf));
+	player->reset(player);
+
+	uint32_t hashes[18];
+	for (i = 0; i < 18; ++i) {
+		player->runFrame(player);
+		hashes[i] = _hashPlayerFrame(player);
+	}
+
+	assert_int_equal(mVideoLogPlayerSeek(player, 3), 0);
+	player->runFrame(player);
+	assert_int_equal(_hashPlayerFrame(player), hashes[0]);
+
+	assert_int_equal(mVideoLogPlayerSeek(player, 13), 12);
+	player->runFrame(player);
+	assert_int_equal(_hashPlayerFrame(player), hashes[12]);
+	player->runFrame(player);
+	assert_int_equal(_hashPlayerFrame(player), hashes[13]);
+
+	assert_int_equal(mVideoLogPlayerSeek(player, 8), 8);
+	player->runFrame(player);
+	assert_int_equal(_hashPlayerFrame(player), hashes[8]);
+
+	mCoreConfigDeinit(&player->config);
+	player->deinit(player);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(playerBuffer);
+	free(buffer);
+}
+#endif
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(VideoLogger,
+	cmocka_unit_test(vramChunks),
+	cmocka_unit_test(vramRuns),
+#ifdef M_CORE_GBA
+	cmocka_unit_test(contextAudio),
+	cmocka_unit_test(playerSeek),
+#endif
+)
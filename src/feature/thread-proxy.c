@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/feature/thread-proxy.h>
 
+#include <mgba/core/perf.h>
 #include <mgba/core/tile-cache.h>
 #include <mgba/internal/gba/gba.h>
 
@@ -110,9 +111,11 @@ static bool _writeData(struct mVideoLogger* logger, const void* data, size_t len
 			MutexUnlock(&proxyRenderer->mutex);
 			return false;
 		}
+		mTRACE_BEGIN("Proxy queue full");
 		ConditionWake(&proxyRenderer->toThreadCond);
 		ConditionWait(&proxyRenderer->fromThreadCond, &proxyRenderer->mutex);
 		MutexUnlock(&proxyRenderer->mutex);
+		mTRACE_END();
 	}
 	return true;
 }
@@ -136,6 +139,7 @@ static bool _readData(struct mVideoLogger* logger, void* data, size_t length, bo
 
 static void _postEvent(struct mVideoLogger* logger, enum mVideoLoggerEvent event) {
 	struct mVideoThreadProxy* proxyRenderer = (struct mVideoThreadProxy*) logger;
+	mTRACE_BEGIN("Proxy event");
 	MutexLock(&proxyRenderer->mutex);
 	proxyRenderer->event = event;
 	while (proxyRenderer->event) {
@@ -143,6 +147,7 @@ static void _postEvent(struct mVideoLogger* logger, enum mVideoLoggerEvent event
 		ConditionWait(&proxyRenderer->fromThreadCond, &proxyRenderer->mutex);
 	}
 	MutexUnlock(&proxyRenderer->mutex);
+	mTRACE_END();
 }
 
 static void _lock(struct mVideoLogger* logger) {
@@ -157,12 +162,14 @@ static void _wait(struct mVideoLogger* logger) {
 		_proxyThreadRecover(proxyRenderer);
 		return;
 	}
+	mTRACE_BEGIN("Proxy wait");
 	MutexLock(&proxyRenderer->mutex);
 	while (RingFIFOSize(&proxyRenderer->dirtyQueue)) {
 		ConditionWake(&proxyRenderer->toThreadCond);
 		ConditionWait(&proxyRenderer->fromThreadCond, &proxyRenderer->mutex);
 	}
 	MutexUnlock(&proxyRenderer->mutex);
+	mTRACE_END();
 }
 
 static void _unlock(struct mVideoLogger* logger) {
@@ -180,6 +187,7 @@ static void _wake(struct mVideoLogger* logger, int y) {
 static THREAD_ENTRY _proxyThread(void* logger) {
 	struct mVideoThreadProxy* proxyRenderer = logger;
 	ThreadSetName("Proxy Rendering");
+	mTRACE_THREAD_NAME("Proxy Rendering");
 
 	MutexLock(&proxyRenderer->mutex);
 	ConditionWake(&proxyRenderer->fromThreadCond);
@@ -190,15 +198,19 @@ static THREAD_ENTRY _proxyThread(void* logger) {
 		}
 		proxyRenderer->threadState = PROXY_THREAD_BUSY;
 		if (proxyRenderer->event) {
+			mTRACE_BEGIN("Proxy handle event");
 			proxyRenderer->d.handleEvent(&proxyRenderer->d, proxyRenderer->event);
 			proxyRenderer->event = 0;
+			mTRACE_END();
 		} else {
 			MutexUnlock(&proxyRenderer->mutex);
+			mTRACE_BEGIN("Proxy render");
 			if (!mVideoLoggerRendererRun(&proxyRenderer->d, false)) {
 				// FIFO was corrupted
 				proxyRenderer->threadState = PROXY_THREAD_STOPPED;
 				mLOG(GBA_VIDEO, ERROR, "Proxy thread queue got corrupted!");
 			}
+			mTRACE_END();
 			MutexLock(&proxyRenderer->mutex);
 		}
 		ConditionWake(&proxyRenderer->fromThreadCond);
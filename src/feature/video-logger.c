@@ -6,6 +6,8 @@
 #include <mgba/feature/video-logger.h>
 
 #include <mgba-util/memory.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 #include <mgba-util/math.h>
 
@@ -22,6 +24,10 @@
 
 #define BUFFER_BASE_SIZE 0x20000
 #define MAX_BLOCK_SIZE 0x800000
+#define AUDIO_CHUNK_SAMPLES 0x2000
+#define INFLATE_BUFFER_SIZE 0x4000
+// Blocks waiting to be compressed or written, per compression thread, before flushing blocks
+#define MAX_PENDING_BLOCKS 2
 
 const char mVL_MAGIC[] = "mVL\0";
 
@@ -43,6 +49,8 @@ enum mVLBlockType {
 	mVL_BLOCK_INITIAL_STATE,
 	mVL_BLOCK_CHANNEL_HEADER,
 	mVL_BLOCK_DATA,
+	mVL_BLOCK_KEYFRAME,
+	mVL_BLOCK_KEYFRAME_INDEX,
 	mVL_BLOCK_FOOTER = 0x784C566D
 };
 
@@ -50,6 +58,11 @@ enum mVLHeaderFlag {
 	mVL_FLAG_HAS_INITIAL_STATE = 1
 };
 
+enum mVLFooterFlag {
+	// The footer's length is that of the keyframe index block right before it
+	mVL_FLAG_FOOTER_HAS_INDEX = 1
+};
+
 struct mVLBlockHeader {
 	uint32_t blockType;
 	uint32_t length;
@@ -68,6 +81,27 @@ struct mVideoLogHeader {
 	uint32_t nChannels;
 };
 
+// Audio channels are a series of chunks, each made of this header and nSamples stereo samples
+struct mVLAudioChunk {
+	uint32_t sampleRate;
+	uint32_t nSamples;
+};
+
+// Keyframe blocks hold a savestate of the recording core, and are listed in the index as these
+struct mVLKeyframeEntry {
+	uint32_t frame;
+	uint32_t reserved;
+	uint64_t offset;
+};
+
+struct mVLKeyframe {
+	uint32_t frame;
+	off_t offset;
+};
+
+DECLARE_VECTOR(mVLKeyframeList, struct mVLKeyframe);
+DEFINE_VECTOR(mVLKeyframeList, struct mVLKeyframe);
+
 struct mVideoLogContext;
 struct mVideoLogChannel {
 	struct mVideoLogContext* p;
@@ -89,6 +123,33 @@ struct mVideoLogChannel {
 
 	struct CircleBuffer injectedBuffer;
 	struct CircleBuffer buffer;
+
+	unsigned audioRate;
+	size_t audioRemaining;
+};
+
+struct mVideoLogAudio {
+	struct mAVStream d;
+	struct mVideoLogContext* p;
+	int channelId;
+	unsigned sampleRate;
+	size_t nSamples;
+	// Samples are batched so the channels don't have to be switched for every sample
+	struct mStereoSample samples[AUDIO_CHUNK_SAMPLES];
+};
+
+// A block of channel data on its way to the file, compressed first if needed
+struct mVLBlockJob {
+	struct mVLBlockJob* next;
+	uint32_t blockType;
+	uint32_t channelId;
+	uint32_t frame;
+	bool compress;
+	bool done;
+	void* data;
+	size_t size;
+	void* output;
+	size_t outputSize;
 };
 
 struct mVideoLogContext {
@@ -99,8 +160,34 @@ struct mVideoLogContext {
 
 	bool write;
 	bool compression;
+	int compressionLevel;
 	uint32_t activeChannel;
 	struct VFile* backing;
+
+	struct mVideoLogAudio* audio;
+
+	unsigned keyframeInterval;
+	// Frames finished so far, counted while recording and set by seeking while playing back
+	uint32_t frame;
+	bool keyframePending;
+	uint32_t seekFrame;
+	struct mVLKeyframeList keyframes;
+
+	unsigned compressionThreads;
+#ifndef DISABLE_THREADING
+	Thread* workers;
+	unsigned nWorkers;
+	Mutex jobMutex;
+	Condition jobCond;
+	Condition doneCond;
+	// Every block not written yet, in the order they go in the file
+	struct mVLBlockJob* jobHead;
+	struct mVLBlockJob* jobTail;
+	// The first block no thread has started on yet
+	struct mVLBlockJob* nextJob;
+	size_t pendingJobs;
+	bool quit;
+#endif
 };
 
 
@@ -110,6 +197,11 @@ static bool _readData(struct mVideoLogger* logger, void* data, size_t length, bo
 
 static ssize_t mVideoLoggerReadChannel(struct mVideoLogChannel* channel, void* data, size_t length);
 static ssize_t mVideoLoggerWriteChannel(struct mVideoLogChannel* channel, const void* data, size_t length);
+static void _flushAudio(struct mVideoLogAudio* audio);
+
+// VRAM is tracked in chunks this size, and runs of dirty chunks are shipped as one packet of at most VRAM_MAX_PACKET bytes
+#define VRAM_CHUNK_SHIFT 8
+#define VRAM_MAX_PACKET 0x1000
 
 static inline size_t _roundUp(size_t value, int shift) {
 	value += (1 << shift) - 1;
@@ -143,7 +235,7 @@ void mVideoLoggerRendererInit(struct mVideoLogger* logger) {
 	logger->vram = anonymousMemoryMap(logger->vramSize);
 	logger->oam = anonymousMemoryMap(logger->oamSize);
 
-	logger->vramDirtyBitmap = calloc(_roundUp(logger->vramSize, 17), sizeof(uint32_t));
+	logger->vramDirtyBitmap = calloc(_roundUp(logger->vramSize, VRAM_CHUNK_SHIFT + 5), sizeof(uint32_t));
 	logger->oamDirtyBitmap = calloc(_roundUp(logger->oamSize, 6), sizeof(uint32_t));
 
 	if (logger->init) {
@@ -165,7 +257,7 @@ void mVideoLoggerRendererDeinit(struct mVideoLogger* logger) {
 }
 
 void mVideoLoggerRendererReset(struct mVideoLogger* logger) {
-	memset(logger->vramDirtyBitmap, 0, sizeof(uint32_t) * _roundUp(logger->vramSize, 17));
+	memset(logger->vramDirtyBitmap, 0, sizeof(uint32_t) * _roundUp(logger->vramSize, VRAM_CHUNK_SHIFT + 5));
 	memset(logger->oamDirtyBitmap, 0, sizeof(uint32_t) * _roundUp(logger->oamSize, 6));
 
 	if (logger->reset) {
@@ -184,11 +276,15 @@ void mVideoLoggerRendererWriteVideoRegister(struct mVideoLogger* logger, uint32_
 }
 
 void mVideoLoggerRendererWriteVRAM(struct mVideoLogger* logger, uint32_t address) {
-	int bit = 1U << (address >> 12);
-	if (logger->vramDirtyBitmap[address >> 17] & bit) {
-		return;
+	uint32_t chunk = address >> VRAM_CHUNK_SHIFT;
+	logger->vramDirtyBitmap[chunk >> 5] |= 1U << (chunk & 31);
+}
+
+void mVideoLoggerRendererWriteVRAMRange(struct mVideoLogger* logger, uint32_t address, uint32_t length) {
+	uint32_t chunk;
+	for (chunk = address >> VRAM_CHUNK_SHIFT; chunk <= (address + length - 1) >> VRAM_CHUNK_SHIFT; ++chunk) {
+		logger->vramDirtyBitmap[chunk >> 5] |= 1U << (chunk & 31);
 	}
-	logger->vramDirtyBitmap[address >> 17] |= bit;
 }
 
 void mVideoLoggerRendererWritePalette(struct mVideoLogger* logger, uint32_t address, uint16_t value) {
@@ -211,28 +307,47 @@ void mVideoLoggerRendererWriteOAM(struct mVideoLogger* logger, uint32_t address,
 	logger->writeData(logger, &dirty, sizeof(dirty));
 }
 
+static void _writeVRAMRange(struct mVideoLogger* logger, uint32_t address, uint32_t length) {
+	struct mVideoLoggerDirtyInfo dirty = {
+		DIRTY_VRAM,
+		address,
+		length,
+		0xDEADBEEF,
+	};
+	logger->writeData(logger, &dirty, sizeof(dirty));
+	logger->writeData(logger, logger->vramBlock(logger, address), length);
+}
+
 static void _flushVRAM(struct mVideoLogger* logger) {
+	uint32_t start = 0;
+	uint32_t length = 0;
 	size_t i;
-	for (i = 0; i < _roundUp(logger->vramSize, 17); ++i) {
-		if (logger->vramDirtyBitmap[i]) {
-			uint32_t bitmap = logger->vramDirtyBitmap[i];
-			logger->vramDirtyBitmap[i] = 0;
-			int j;
-			for (j = 0; j < mVL_MAX_CHANNELS; ++j) {
-				if (!(bitmap & (1 << j))) {
+	for (i = 0; i < _roundUp(logger->vramSize, VRAM_CHUNK_SHIFT + 5); ++i) {
+		uint32_t bitmap = logger->vramDirtyBitmap[i];
+		if (!bitmap && !length) {
+			continue;
+		}
+		logger->vramDirtyBitmap[i] = 0;
+		int j;
+		for (j = 0; j < 32; ++j) {
+			if (bitmap & (1U << j)) {
+				if (!length) {
+					start = (i * 32 + j) << VRAM_CHUNK_SHIFT;
+				}
+				length += 1 << VRAM_CHUNK_SHIFT;
+				if (length < VRAM_MAX_PACKET) {
 					continue;
 				}
-				struct mVideoLoggerDirtyInfo dirty = {
-					DIRTY_VRAM,
-					j * 0x1000,
-					0x1000,
-					0xDEADBEEF,
-				};
-				logger->writeData(logger, &dirty, sizeof(dirty));
-				logger->writeData(logger, logger->vramBlock(logger, j * 0x1000), 0x1000);
+			}
+			if (length) {
+				_writeVRAMRange(logger, start, length);
+				length = 0;
 			}
 		}
 	}
+	if (length) {
+		_writeVRAMRange(logger, start, length);
+	}
 }
 
 void mVideoLoggerRendererDrawScanline(struct mVideoLogger* logger, int y) {
@@ -278,6 +393,16 @@ void mVideoLoggerRendererFinishFrame(struct mVideoLogger* logger) {
 		0xDEADBEEF,
 	};
 	logger->writeData(logger, &dirty, sizeof(dirty));
+
+	struct mVideoLogChannel* channel = logger->dataContext;
+	if (channel && channel->p->write) {
+		struct mVideoLogContext* context = channel->p;
+		++context->frame;
+		// The core can't be saved in the middle of drawing, so wait for the end of the frame
+		if (context->keyframeInterval && !(context->frame % context->keyframeInterval)) {
+			context->keyframePending = true;
+		}
+	}
 }
 
 void mVideoLoggerWriteBuffer(struct mVideoLogger* logger, uint32_t bufferId, uint32_t offset, uint32_t length, const void* data) {
@@ -372,56 +497,31 @@ static bool _readData(struct mVideoLogger* logger, void* data, size_t length, bo
 }
 
 #ifdef USE_ZLIB
-static void _copyVf(struct VFile* dest, struct VFile* src) {
-	size_t size = src->size(src);
-	void* mem = src->map(src, size, MAP_READ);
-	dest->write(dest, mem, size);
-	src->unmap(src, mem, size);
-}
-
-static void _compress(struct VFile* dest, struct VFile* src) {
-	uint8_t writeBuffer[0x800];
-	uint8_t compressBuffer[0x400];
+static void* _compress(const void* data, size_t size, int level, size_t* outputSize) {
 	z_stream zstr = {0};
-	zstr.avail_in = 0;
-	zstr.avail_out = sizeof(compressBuffer);
-	zstr.next_out = (Bytef*) compressBuffer;
-	if (deflateInit(&zstr, 9) != Z_OK) {
-		return;
+	if (deflateInit(&zstr, level) != Z_OK) {
+		return NULL;
 	}
-
-	while (true) {
-		size_t read = src->read(src, writeBuffer, sizeof(writeBuffer));
-		if (!read) {
-			break;
-		}
-		zstr.avail_in = read;
-		zstr.next_in = (Bytef*) writeBuffer;
-		while (zstr.avail_in) {
-			if (deflate(&zstr, Z_NO_FLUSH) == Z_STREAM_ERROR) {
-				break;
-			}
-			dest->write(dest, compressBuffer, sizeof(compressBuffer) - zstr.avail_out);
-			zstr.avail_out = sizeof(compressBuffer);
-			zstr.next_out = (Bytef*) compressBuffer;
-		}
+	// Compressing in one go avoids shuffling the data through small intermediate buffers
+	size_t bound = deflateBound(&zstr, size);
+	void* output = malloc(bound);
+	zstr.next_in = (Bytef*) data;
+	zstr.avail_in = size;
+	zstr.next_out = (Bytef*) output;
+	zstr.avail_out = bound;
+	if (deflate(&zstr, Z_FINISH) != Z_STREAM_END) {
+		deflateEnd(&zstr);
+		free(output);
+		return NULL;
 	}
-
-	do {
-		zstr.avail_out = sizeof(compressBuffer);
-		zstr.next_out = (Bytef*) compressBuffer;
-		zstr.avail_in = 0;
-		int ret = deflate(&zstr, Z_FINISH);
-		if (ret == Z_STREAM_ERROR) {
-			break;
-		}
-		dest->write(dest, compressBuffer, sizeof(compressBuffer) - zstr.avail_out);
-	} while (sizeof(compressBuffer) - zstr.avail_out);
+	*outputSize = zstr.total_out;
+	deflateEnd(&zstr);
+	return output;
 }
 
 static bool _decompress(struct VFile* dest, struct VFile* src, size_t compressedLength) {
-	uint8_t fbuffer[0x400];
-	uint8_t zbuffer[0x800];
+	uint8_t fbuffer[INFLATE_BUFFER_SIZE];
+	uint8_t zbuffer[INFLATE_BUFFER_SIZE * 2];
 	z_stream zstr = {0};
 	zstr.avail_in = 0;
 	zstr.avail_out = sizeof(zbuffer);
@@ -509,6 +609,10 @@ struct mVideoLogContext* mVideoLogContextCreate(struct mCore* core) {
 #else
 	context->compression = false;
 #endif
+	context->compressionLevel = mVL_DEFAULT_COMPRESSION_LEVEL;
+	context->compressionThreads = mVL_DEFAULT_COMPRESSION_THREADS;
+	context->keyframeInterval = mVL_DEFAULT_KEYFRAME_INTERVAL;
+	mVLKeyframeListInit(&context->keyframes, 0);
 
 	if (core) {
 		context->initialStateSize = core->stateSize(core);
@@ -527,10 +631,33 @@ void mVideoLogContextSetOutput(struct mVideoLogContext* context, struct VFile* v
 	vf->seek(vf, 0, SEEK_SET);
 }
 
+void mVideoLogContextSetKeyframeInterval(struct mVideoLogContext* context, unsigned frames) {
+	context->keyframeInterval = frames;
+}
+
 void mVideoLogContextSetCompression(struct mVideoLogContext* context, bool compression) {
 	context->compression = compression;
 }
 
+void mVideoLogContextSetCompressionLevel(struct mVideoLogContext* context, int level) {
+	if (level < 1) {
+		level = 1;
+	} else if (level > 9) {
+		level = 9;
+	}
+	context->compressionLevel = level;
+}
+
+void mVideoLogContextSetCompressionThreads(struct mVideoLogContext* context, unsigned threads) {
+#ifndef DISABLE_THREADING
+	if (context->nWorkers) {
+		// Threads can't be changed once blocks are being handed to them
+		return;
+	}
+#endif
+	context->compressionThreads = threads;
+}
+
 void mVideoLogContextWriteHeader(struct mVideoLogContext* context, struct mCore* core) {
 	struct mVideoLogHeader header = { { 0 } };
 	memcpy(header.magic, mVL_MAGIC, sizeof(header.magic));
@@ -548,17 +675,17 @@ void mVideoLogContextWriteHeader(struct mVideoLogContext* context, struct mCore*
 		struct mVLBlockHeader chheader = { 0 };
 		STORE_32LE(mVL_BLOCK_INITIAL_STATE, 0, &chheader.blockType);
 #ifdef USE_ZLIB
+		size_t compressedSize;
+		void* compressed = NULL;
 		if (context->compression) {
+			compressed = _compress(context->initialState, context->initialStateSize, context->compressionLevel, &compressedSize);
+		}
+		if (compressed) {
 			STORE_32LE(mVL_FLAG_BLOCK_COMPRESSED, 0, &chheader.flags);
-
-			struct VFile* vfm = VFileMemChunk(NULL, 0);
-			struct VFile* src = VFileFromConstMemory(context->initialState, context->initialStateSize);
-			_compress(vfm, src);
-			src->close(src);
-			STORE_32LE(vfm->size(vfm), 0, &chheader.length);
+			STORE_32LE(compressedSize, 0, &chheader.length);
 			context->backing->write(context->backing, &chheader, sizeof(chheader));
-			_copyVf(context->backing, vfm);
-			vfm->close(vfm);
+			context->backing->write(context->backing, compressed, compressedSize);
+			free(compressed);
 		} else
 #endif
 		{
@@ -573,6 +700,8 @@ void mVideoLogContextWriteHeader(struct mVideoLogContext* context, struct mCore*
 		struct mVLBlockHeader chheader = { 0 };
 		STORE_32LE(mVL_BLOCK_CHANNEL_HEADER, 0, &chheader.blockType);
 		STORE_32LE(i, 0, &chheader.channelId);
+		// Channel headers have no contents, so the channel type is kept in the flags
+		STORE_32LE(context->channels[i].type, 0, &chheader.flags);
 		context->backing->write(context->backing, &chheader, sizeof(chheader));
 	}
 }
@@ -595,6 +724,32 @@ bool _readBlockHeader(struct mVideoLogContext* context, struct mVLBlockHeader* h
 	return true;
 }
 
+static void* _readState(struct mVideoLogContext* context, const struct mVLBlockHeader* header, size_t* size) {
+	void* state;
+	if (header->flags & mVL_FLAG_BLOCK_COMPRESSED) {
+#ifdef USE_ZLIB
+		struct VFile* vfm = VFileMemChunk(NULL, 0);
+		if (!_decompress(vfm, context->backing, header->length)) {
+			vfm->close(vfm);
+			return NULL;
+		}
+		*size = vfm->size(vfm);
+		state = anonymousMemoryMap(*size);
+		void* mem = vfm->map(vfm, *size, MAP_READ);
+		memcpy(state, mem, *size);
+		vfm->unmap(vfm, mem, *size);
+		vfm->close(vfm);
+#else
+		return NULL;
+#endif
+	} else {
+		*size = header->length;
+		state = anonymousMemoryMap(header->length);
+		context->backing->read(context->backing, state, *size);
+	}
+	return state;
+}
+
 bool _readHeader(struct mVideoLogContext* context) {
 	struct mVideoLogHeader header;
 	context->backing->seek(context->backing, 0, SEEK_SET);
@@ -626,31 +781,69 @@ bool _readHeader(struct mVideoLogContext* context) {
 			context->initialState = NULL;
 			context->initialStateSize = 0;
 		}
-		if (header.flags & mVL_FLAG_BLOCK_COMPRESSED) {
-#ifdef USE_ZLIB
-			struct VFile* vfm = VFileMemChunk(NULL, 0);
-			if (!_decompress(vfm, context->backing, header.length)) {
-				vfm->close(vfm);
-				return false;
-			}
-			context->initialStateSize = vfm->size(vfm);
-			context->initialState = anonymousMemoryMap(context->initialStateSize);
-			void* mem = vfm->map(vfm, context->initialStateSize, MAP_READ);
-			memcpy(context->initialState, mem, context->initialStateSize);
-			vfm->unmap(vfm, mem, context->initialStateSize);
-			vfm->close(vfm);
-#else
+		context->initialState = _readState(context, &header, &context->initialStateSize);
+		if (!context->initialState) {
+			context->initialStateSize = 0;
 			return false;
-#endif
-		} else {
-			context->initialStateSize = header.length;
-			context->initialState = anonymousMemoryMap(header.length);
-			context->backing->read(context->backing, context->initialState, context->initialStateSize);
 		}
 	}
+
+	size_t i;
+	for (i = 0; i < context->nChannels; ++i) {
+		context->channels[i].type = mVL_CHANNEL_VIDEO;
+	}
+	for (i = 0; i < context->nChannels; ++i) {
+		off_t pointer = context->backing->seek(context->backing, 0, SEEK_CUR);
+		struct mVLBlockHeader header;
+		if (!_readBlockHeader(context, &header) || header.blockType != mVL_BLOCK_CHANNEL_HEADER) {
+			context->backing->seek(context->backing, pointer, SEEK_SET);
+			break;
+		}
+		if (header.channelId < context->nChannels) {
+			context->channels[header.channelId].type = header.flags;
+		}
+		context->backing->seek(context->backing, header.length, SEEK_CUR);
+	}
 	return true;
 }
 
+static void _readKeyframeIndex(struct mVideoLogContext* context) {
+	struct VFile* vf = context->backing;
+	mVLKeyframeListClear(&context->keyframes);
+
+	ssize_t size = vf->size(vf);
+	struct mVLBlockHeader header;
+	if (size < (ssize_t) (sizeof(struct mVideoLogHeader) + sizeof(header) * 2)) {
+		return;
+	}
+	vf->seek(vf, size - sizeof(header), SEEK_SET);
+	if (!_readBlockHeader(context, &header) || header.blockType != mVL_BLOCK_FOOTER || !(header.flags & mVL_FLAG_FOOTER_HAS_INDEX)) {
+		return;
+	}
+	size_t length = header.length;
+	if (length % sizeof(struct mVLKeyframeEntry) || (ssize_t) (length + sizeof(header) * 2) > size) {
+		return;
+	}
+	vf->seek(vf, size - sizeof(header) * 2 - length, SEEK_SET);
+	if (!_readBlockHeader(context, &header) || header.blockType != mVL_BLOCK_KEYFRAME_INDEX || header.length != length) {
+		return;
+	}
+
+	size_t i;
+	for (i = 0; i < length / sizeof(struct mVLKeyframeEntry); ++i) {
+		struct mVLKeyframeEntry entry;
+		if (vf->read(vf, &entry, sizeof(entry)) != sizeof(entry)) {
+			mVLKeyframeListClear(&context->keyframes);
+			return;
+		}
+		struct mVLKeyframe* keyframe = mVLKeyframeListAppend(&context->keyframes);
+		uint64_t offset;
+		LOAD_32LE(keyframe->frame, 0, &entry.frame);
+		LOAD_64LE(offset, 0, &entry.offset);
+		keyframe->offset = offset;
+	}
+}
+
 bool mVideoLogContextLoad(struct mVideoLogContext* context, struct VFile* vf) {
 	context->backing = vf;
 
@@ -659,6 +852,8 @@ bool mVideoLogContextLoad(struct mVideoLogContext* context, struct VFile* vf) {
 	}
 
 	off_t pointer = context->backing->seek(context->backing, 0, SEEK_CUR);
+	_readKeyframeIndex(context);
+	context->frame = 0;
 
 	size_t i;
 	for (i = 0; i < context->nChannels; ++i) {
@@ -667,6 +862,7 @@ bool mVideoLogContextLoad(struct mVideoLogContext* context, struct VFile* vf) {
 		context->channels[i].bufferRemaining = 0;
 		context->channels[i].currentPointer = pointer;
 		context->channels[i].p = context;
+		context->channels[i].audioRemaining = 0;
 #ifdef USE_ZLIB
 		context->channels[i].inflating = false;
 #endif
@@ -674,63 +870,238 @@ bool mVideoLogContextLoad(struct mVideoLogContext* context, struct VFile* vf) {
 	return true;
 }
 
+static void _compressBlock(struct mVideoLogContext* context, struct mVLBlockJob* job) {
+	job->output = job->data;
+	job->outputSize = job->size;
 #ifdef USE_ZLIB
-static void _flushBufferCompressed(struct mVideoLogContext* context) {
-	struct CircleBuffer* buffer = &context->channels[context->activeChannel].buffer;
-	if (!CircleBufferSize(buffer)) {
-		return;
+	if (job->compress) {
+		size_t size;
+		void* output = _compress(job->data, job->size, context->compressionLevel, &size);
+		if (output) {
+			job->output = output;
+			job->outputSize = size;
+		} else {
+			job->compress = false;
+		}
 	}
-	struct VFile* vfm = VFileMemChunk(NULL, 0);
-	struct VFile* src = VFileFIFO(buffer);
-	_compress(vfm, src);
-	src->close(src);
+#else
+	UNUSED(context);
+	job->compress = false;
+#endif
+}
 
-	size_t size = vfm->size(vfm);
+static void _writeBlock(struct mVideoLogContext* context, struct mVLBlockJob* job) {
+	if (job->blockType == mVL_BLOCK_KEYFRAME) {
+		// Where blocks land is only known once they're written, so the index is built here
+		struct mVLKeyframe* keyframe = mVLKeyframeListAppend(&context->keyframes);
+		keyframe->frame = job->frame;
+		keyframe->offset = context->backing->seek(context->backing, 0, SEEK_CUR);
+	}
 
 	struct mVLBlockHeader header = { 0 };
-	STORE_32LE(mVL_BLOCK_DATA, 0, &header.blockType);
-	STORE_32LE(context->activeChannel, 0, &header.channelId);
-	STORE_32LE(mVL_FLAG_BLOCK_COMPRESSED, 0, &header.flags);
-	STORE_32LE(size, 0, &header.length);
+	STORE_32LE(job->blockType, 0, &header.blockType);
+	STORE_32LE(job->outputSize, 0, &header.length);
+	STORE_32LE(job->channelId, 0, &header.channelId);
+	if (job->compress) {
+		STORE_32LE(mVL_FLAG_BLOCK_COMPRESSED, 0, &header.flags);
+	}
 
 	context->backing->write(context->backing, &header, sizeof(header));
-	_copyVf(context->backing, vfm);
-	vfm->close(vfm);
+	context->backing->write(context->backing, job->output, job->outputSize);
+	if (job->output != job->data) {
+		free(job->output);
+	}
+	free(job->data);
+	free(job);
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _compressionThread(void* user) {
+	struct mVideoLogContext* context = user;
+	ThreadSetName("Video Log Compression");
+
+	MutexLock(&context->jobMutex);
+	while (true) {
+		while (!context->nextJob && !context->quit) {
+			ConditionWait(&context->jobCond, &context->jobMutex);
+		}
+		struct mVLBlockJob* job = context->nextJob;
+		if (!job) {
+			break;
+		}
+		context->nextJob = job->next;
+		MutexUnlock(&context->jobMutex);
+
+		_compressBlock(context, job);
+
+		MutexLock(&context->jobMutex);
+		job->done = true;
+		// Blocks can finish out of order, so only write out the ones at the front
+		while (context->jobHead && context->jobHead->done) {
+			struct mVLBlockJob* head = context->jobHead;
+			context->jobHead = head->next;
+			if (!context->jobHead) {
+				context->jobTail = NULL;
+			}
+			--context->pendingJobs;
+			_writeBlock(context, head);
+		}
+		ConditionWake(&context->doneCond);
+	}
+	MutexUnlock(&context->jobMutex);
+	THREAD_EXIT(0);
+}
+
+static void _startCompressionThreads(struct mVideoLogContext* context) {
+	MutexInit(&context->jobMutex);
+	ConditionInit(&context->jobCond);
+	ConditionInit(&context->doneCond);
+	context->jobHead = NULL;
+	context->jobTail = NULL;
+	context->nextJob = NULL;
+	context->pendingJobs = 0;
+	context->quit = false;
+	context->nWorkers = context->compressionThreads;
+	context->workers = calloc(context->nWorkers, sizeof(*context->workers));
+	size_t i;
+	for (i = 0; i < context->nWorkers; ++i) {
+		ThreadCreate(&context->workers[i], _compressionThread, context);
+	}
+}
+
+static void _stopCompressionThreads(struct mVideoLogContext* context) {
+	if (!context->nWorkers) {
+		return;
+	}
+	// Every block is written before the threads exit
+	MutexLock(&context->jobMutex);
+	context->quit = true;
+	ConditionWake(&context->jobCond);
+	MutexUnlock(&context->jobMutex);
+	size_t i;
+	for (i = 0; i < context->nWorkers; ++i) {
+		ThreadJoin(&context->workers[i]);
+	}
+	free(context->workers);
+	context->workers = NULL;
+	context->nWorkers = 0;
+	MutexDeinit(&context->jobMutex);
+	ConditionDeinit(&context->jobCond);
+	ConditionDeinit(&context->doneCond);
 }
 #endif
 
-static void _flushBuffer(struct mVideoLogContext* context) {
-#ifdef USE_ZLIB
-	if (context->compression) {
-		_flushBufferCompressed(context);
+static void _submitBlock(struct mVideoLogContext* context, struct mVLBlockJob* job) {
+#ifndef DISABLE_THREADING
+	if (!context->nWorkers && job->compress && context->compressionThreads) {
+		_startCompressionThreads(context);
+	}
+	if (context->nWorkers) {
+		MutexLock(&context->jobMutex);
+		while (context->pendingJobs >= context->nWorkers * MAX_PENDING_BLOCKS) {
+			ConditionWait(&context->doneCond, &context->jobMutex);
+		}
+		if (context->jobTail) {
+			context->jobTail->next = job;
+		} else {
+			context->jobHead = job;
+		}
+		context->jobTail = job;
+		if (!context->nextJob) {
+			context->nextJob = job;
+		}
+		++context->pendingJobs;
+		ConditionWake(&context->jobCond);
+		MutexUnlock(&context->jobMutex);
 		return;
 	}
 #endif
+	_compressBlock(context, job);
+	_writeBlock(context, job);
+}
 
+static void _flushBuffer(struct mVideoLogContext* context) {
 	struct CircleBuffer* buffer = &context->channels[context->activeChannel].buffer;
-	if (!CircleBufferSize(buffer)) {
+	size_t size = CircleBufferSize(buffer);
+	if (!size) {
 		return;
 	}
-	struct mVLBlockHeader header = { 0 };
-	STORE_32LE(mVL_BLOCK_DATA, 0, &header.blockType);
-	STORE_32LE(CircleBufferSize(buffer), 0, &header.length);
-	STORE_32LE(context->activeChannel, 0, &header.channelId);
+	struct mVLBlockJob* job = calloc(1, sizeof(*job));
+	job->blockType = mVL_BLOCK_DATA;
+	job->channelId = context->activeChannel;
+	job->compress = context->compression;
+	job->data = malloc(size);
+	job->size = CircleBufferRead(buffer, job->data, size);
+	_submitBlock(context, job);
+}
 
-	context->backing->write(context->backing, &header, sizeof(header));
+void mVideoLogContextFrameEnded(struct mVideoLogContext* context, struct mCore* core) {
+	if (!context->write || !context->keyframePending) {
+		return;
+	}
+	context->keyframePending = false;
 
-	uint8_t writeBuffer[0x800];
-	while (CircleBufferSize(buffer)) {
-		size_t read = CircleBufferRead(buffer, writeBuffer, sizeof(writeBuffer));
-		context->backing->write(context->backing, writeBuffer, read);
+	// Everything logged so far has to come before the keyframe, so it all gets skipped when seeking
+	if (context->audio) {
+		_flushAudio(context->audio);
 	}
+	_flushBuffer(context);
+
+	struct mVLBlockJob* job = calloc(1, sizeof(*job));
+	job->blockType = mVL_BLOCK_KEYFRAME;
+	job->frame = context->frame;
+	job->compress = context->compression;
+	job->size = core->stateSize(core);
+	job->data = malloc(job->size);
+	if (!core->saveState(core, job->data)) {
+		free(job->data);
+		free(job);
+		return;
+	}
+	_submitBlock(context, job);
+}
+
+static void _writeKeyframeIndex(struct mVideoLogContext* context, struct mVLBlockHeader* footer) {
+	size_t nKeyframes = mVLKeyframeListSize(&context->keyframes);
+	if (!nKeyframes) {
+		return;
+	}
+	size_t length = nKeyframes * sizeof(struct mVLKeyframeEntry);
+	if (length > MAX_BLOCK_SIZE) {
+		return;
+	}
+	struct mVLKeyframeEntry* entries = calloc(nKeyframes, sizeof(*entries));
+	size_t i;
+	for (i = 0; i < nKeyframes; ++i) {
+		const struct mVLKeyframe* keyframe = mVLKeyframeListGetConstPointer(&context->keyframes, i);
+		STORE_32LE(keyframe->frame, 0, &entries[i].frame);
+		STORE_64LE((uint64_t) keyframe->offset, 0, &entries[i].offset);
+	}
+
+	struct mVLBlockHeader header = { 0 };
+	STORE_32LE(mVL_BLOCK_KEYFRAME_INDEX, 0, &header.blockType);
+	STORE_32LE(length, 0, &header.length);
+	context->backing->write(context->backing, &header, sizeof(header));
+	context->backing->write(context->backing, entries, length);
+	free(entries);
+
+	STORE_32LE(length, 0, &footer->length);
+	STORE_32LE(mVL_FLAG_FOOTER_HAS_INDEX, 0, &footer->flags);
 }
 
 void mVideoLogContextDestroy(struct mCore* core, struct mVideoLogContext* context, bool closeVF) {
 	if (context->write) {
+		if (context->audio) {
+			_flushAudio(context->audio);
+		}
 		_flushBuffer(context);
+#ifndef DISABLE_THREADING
+		_stopCompressionThreads(context);
+#endif
 
 		struct mVLBlockHeader header = { 0 };
 		STORE_32LE(mVL_BLOCK_FOOTER, 0, &header.blockType);
+		_writeKeyframeIndex(context, &header);
 		context->backing->write(context->backing, &header, sizeof(header));
 	}
 
@@ -757,31 +1128,86 @@ void mVideoLogContextDestroy(struct mCore* core, struct mVideoLogContext* contex
 		context->backing->close(context->backing);
 	}
 
+	mVLKeyframeListDeinit(&context->keyframes);
+	free(context->audio);
 	free(context);
 }
 
-void mVideoLogContextRewind(struct mVideoLogContext* context, struct mCore* core) {
-	_readHeader(context);
-	if (core) {
-		size_t size = core->stateSize(core);
-		if (size <= context->initialStateSize) {
-			core->loadState(core, context->initialState);
+static void _loadState(struct mCore* core, void* state, size_t stateSize) {
+	size_t size = core->stateSize(core);
+	if (size <= stateSize) {
+		core->loadState(core, state);
+	} else {
+		void* extendedState = anonymousMemoryMap(size);
+		memcpy(extendedState, state, stateSize);
+		core->loadState(core, extendedState);
+		mappedMemoryFree(extendedState, size);
+	}
+}
+
+static const struct mVLKeyframe* _findKeyframe(struct mVideoLogContext* context, uint32_t frame) {
+	// Keyframes are written in order, so find the last one at or before the frame
+	size_t low = 0;
+	size_t high = mVLKeyframeListSize(&context->keyframes);
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (mVLKeyframeListGetConstPointer(&context->keyframes, mid)->frame <= frame) {
+			low = mid + 1;
 		} else {
-			void* extendedState = anonymousMemoryMap(size);
-			memcpy(extendedState, context->initialState, context->initialStateSize);
-			core->loadState(core, extendedState);
-			mappedMemoryFree(extendedState, size);
+			high = mid;
 		}
 	}
+	if (!low) {
+		return NULL;
+	}
+	return mVLKeyframeListGetConstPointer(&context->keyframes, low - 1);
+}
+
+static void* _readKeyframe(struct mVideoLogContext* context, const struct mVLKeyframe* keyframe, size_t* size, off_t* end) {
+	struct mVLBlockHeader header;
+	context->backing->seek(context->backing, keyframe->offset, SEEK_SET);
+	if (!_readBlockHeader(context, &header) || header.blockType != mVL_BLOCK_KEYFRAME || !header.length) {
+		return NULL;
+	}
+	*end = keyframe->offset + sizeof(header) + header.length;
+	return _readState(context, &header, size);
+}
 
+void mVideoLogContextRewind(struct mVideoLogContext* context, struct mCore* core) {
+	_readHeader(context);
 	off_t pointer = context->backing->seek(context->backing, 0, SEEK_CUR);
 
+	void* keyframe = NULL;
+	size_t keyframeSize = 0;
+	context->frame = 0;
+	if (context->seekFrame && core) {
+		const struct mVLKeyframe* entry = _findKeyframe(context, context->seekFrame);
+		off_t end;
+		if (entry) {
+			keyframe = _readKeyframe(context, entry, &keyframeSize, &end);
+		}
+		if (keyframe) {
+			context->frame = entry->frame;
+			pointer = end;
+		}
+	}
+	// Seeking is a one-off, so reaching the end of the log still goes back to the start
+	context->seekFrame = 0;
+
+	if (keyframe) {
+		_loadState(core, keyframe, keyframeSize);
+		mappedMemoryFree(keyframe, keyframeSize);
+	} else if (core) {
+		_loadState(core, context->initialState, context->initialStateSize);
+	}
+
 	size_t i;
 	for (i = 0; i < context->nChannels; ++i) {
 		CircleBufferClear(&context->channels[i].injectedBuffer);
 		CircleBufferClear(&context->channels[i].buffer);
 		context->channels[i].bufferRemaining = 0;
 		context->channels[i].currentPointer = pointer;
+		context->channels[i].audioRemaining = 0;
 #ifdef USE_ZLIB
 		if (context->channels[i].inflating) {
 			inflateEnd(&context->channels[i].inflateStream);
@@ -791,6 +1217,21 @@ void mVideoLogContextRewind(struct mVideoLogContext* context, struct mCore* core
 	}
 }
 
+unsigned mVideoLogPlayerSeek(struct mCore* core, unsigned frame) {
+	if (!core->videoLogger || !core->videoLogger->dataContext) {
+		return 0;
+	}
+	struct mVideoLogChannel* channel = core->videoLogger->dataContext;
+	struct mVideoLogContext* context = channel->p;
+	if (context->write) {
+		return 0;
+	}
+	// Player cores rewind their logs when reset, and the rewind picks up the keyframe from here
+	context->seekFrame = frame;
+	core->reset(core);
+	return context->frame;
+}
+
 void* mVideoLogContextInitialState(struct mVideoLogContext* context, size_t* size) {
 	if (size) {
 		*size = context->initialStateSize;
@@ -807,12 +1248,115 @@ int mVideoLoggerAddChannel(struct mVideoLogContext* context) {
 	context->channels[chid].p = context;
 	CircleBufferInit(&context->channels[chid].injectedBuffer, BUFFER_BASE_SIZE);
 	CircleBufferInit(&context->channels[chid].buffer, BUFFER_BASE_SIZE);
+	context->channels[chid].type = mVL_CHANNEL_VIDEO;
 	context->channels[chid].injecting = false;
 	context->channels[chid].injectionPoint = LOGGER_INJECTION_IMMEDIATE;
 	context->channels[chid].ignorePackets = 0;
 	return chid;
 }
 
+int mVideoLogContextFindChannel(struct mVideoLogContext* context, enum mVideoLogChannelType type) {
+	size_t i;
+	for (i = 0; i < context->nChannels; ++i) {
+		if (context->channels[i].type == type) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void _flushAudio(struct mVideoLogAudio* audio) {
+	if (!audio->nSamples) {
+		return;
+	}
+	struct mVideoLogChannel* channel = &audio->p->channels[audio->channelId];
+	struct mVLAudioChunk chunk;
+	STORE_32LE(audio->sampleRate, 0, &chunk.sampleRate);
+	STORE_32LE(audio->nSamples, 0, &chunk.nSamples);
+	mVideoLoggerWriteChannel(channel, &chunk, sizeof(chunk));
+	mVideoLoggerWriteChannel(channel, audio->samples, audio->nSamples * sizeof(*audio->samples));
+	audio->nSamples = 0;
+}
+
+static void _audioRateChanged(struct mAVStream* stream, unsigned rate) {
+	struct mVideoLogAudio* audio = (struct mVideoLogAudio*) stream;
+	if (rate == audio->sampleRate) {
+		return;
+	}
+	_flushAudio(audio);
+	audio->sampleRate = rate;
+}
+
+static void _postAudioFrame(struct mAVStream* stream, int16_t left, int16_t right) {
+	struct mVideoLogAudio* audio = (struct mVideoLogAudio*) stream;
+	STORE_16LE(left, 0, &audio->samples[audio->nSamples].left);
+	STORE_16LE(right, 0, &audio->samples[audio->nSamples].right);
+	++audio->nSamples;
+	if (audio->nSamples == AUDIO_CHUNK_SAMPLES) {
+		_flushAudio(audio);
+	}
+}
+
+struct mAVStream* mVideoLogContextRecordAudio(struct mVideoLogContext* context) {
+	if (!context->write) {
+		return NULL;
+	}
+	if (context->audio) {
+		return &context->audio->d;
+	}
+	int channelId = mVideoLoggerAddChannel(context);
+	if (channelId < 0) {
+		return NULL;
+	}
+	context->channels[channelId].type = mVL_CHANNEL_AUDIO;
+
+	struct mVideoLogAudio* audio = calloc(1, sizeof(*audio));
+	audio->d.audioRateChanged = _audioRateChanged;
+	audio->d.postAudioFrame = _postAudioFrame;
+	audio->p = context;
+	audio->channelId = channelId;
+	context->audio = audio;
+	return &audio->d;
+}
+
+size_t mVideoLogContextReadAudio(struct mVideoLogContext* context, int channelId, struct mStereoSample* samples, size_t count, unsigned* sampleRate) {
+	if (channelId < 0 || (uint32_t) channelId >= context->nChannels || context->channels[channelId].type != mVL_CHANNEL_AUDIO) {
+		return 0;
+	}
+	struct mVideoLogChannel* channel = &context->channels[channelId];
+	while (!channel->audioRemaining) {
+		struct mVLAudioChunk chunk;
+		if (mVideoLoggerReadChannel(channel, &chunk, sizeof(chunk)) != sizeof(chunk)) {
+			return 0;
+		}
+		LOAD_32LE(channel->audioRate, 0, &chunk.sampleRate);
+		LOAD_32LE(channel->audioRemaining, 0, &chunk.nSamples);
+	}
+	if (count > channel->audioRemaining) {
+		count = channel->audioRemaining;
+	}
+
+	size_t read = 0;
+	while (read < count * sizeof(*samples)) {
+		ssize_t thisRead = mVideoLoggerReadChannel(channel, (uint8_t*) samples + read, count * sizeof(*samples) - read);
+		if (thisRead <= 0) {
+			break;
+		}
+		read += thisRead;
+	}
+	count = read / sizeof(*samples);
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		LOAD_16LE(samples[i].left, 0, &samples[i].left);
+		LOAD_16LE(samples[i].right, 0, &samples[i].right);
+	}
+	channel->audioRemaining -= count;
+	if (sampleRate) {
+		*sampleRate = channel->audioRate;
+	}
+	return count;
+}
+
 void mVideoLoggerInjectVideoRegister(struct mVideoLogger* logger, uint32_t address, uint16_t value) {
 	struct mVideoLogChannel* channel = logger->dataContext;
 	channel->injecting = true;
@@ -836,8 +1380,8 @@ void mVideoLoggerInjectOAM(struct mVideoLogger* logger, uint32_t address, uint16
 
 #ifdef USE_ZLIB
 static size_t _readBufferCompressed(struct VFile* vf, struct mVideoLogChannel* channel, size_t length) {
-	uint8_t fbuffer[0x400];
-	uint8_t zbuffer[0x800];
+	uint8_t fbuffer[INFLATE_BUFFER_SIZE];
+	uint8_t zbuffer[INFLATE_BUFFER_SIZE * 2];
 	size_t read = 0;
 
 	// TODO: Share with _decompress
@@ -5,8 +5,10 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gb/audio.h>
 
+#include <mgba/core/av-buffer.h>
 #include <mgba/core/blip_buf.h>
 #include <mgba/core/interface.h>
+#include <mgba/core/perf.h>
 #include <mgba/core/sync.h>
 #include <mgba/internal/gb/gb.h>
 #include <mgba/internal/gb/serialize.h>
@@ -23,7 +25,6 @@
 
 const uint32_t DMG_SM83_FREQUENCY = 0x400000;
 static const int CLOCKS_PER_BLIP_FRAME = 0x1000;
-static const unsigned BLIP_BUFFER_SIZE = 0x4000;
 static const int SAMPLE_INTERVAL = 32;
 static const int FILTER = 65368;
 const int GB_AUDIO_VOLUME_MAX = 0x100;
@@ -57,8 +58,9 @@ static const int _squareChannelDuty[4][8] = {
 
 void GBAudioInit(struct GBAudio* audio, size_t samples, uint8_t* nr52, enum GBAudioStyle style) {
 	audio->samples = samples;
-	audio->left = blip_new(BLIP_BUFFER_SIZE);
-	audio->right = blip_new(BLIP_BUFFER_SIZE);
+	audio->bufferCapacity = GB_AUDIO_BUFFER_CAPACITY;
+	audio->left = blip_new(audio->bufferCapacity);
+	audio->right = blip_new(audio->bufferCapacity);
 	audio->clockRate = DMG_SM83_FREQUENCY;
 	// Guess too large; we hang producing extra samples if we guess too low
 	blip_set_rates(audio->left, DMG_SM83_FREQUENCY, 96000);
@@ -68,6 +70,7 @@ void GBAudioInit(struct GBAudio* audio, size_t samples, uint8_t* nr52, enum GBAu
 	audio->forceDisableCh[2] = false;
 	audio->forceDisableCh[3] = false;
 	audio->masterVolume = GB_AUDIO_VOLUME_MAX;
+	audio->outputDisabled = false;
 	audio->nr52 = nr52;
 	audio->style = style;
 	if (style == GB_AUDIO_GBA) {
@@ -128,6 +131,7 @@ void GBAudioReset(struct GBAudio* audio) {
 	audio->capLeft = 0;
 	audio->capRight = 0;
 	audio->clock = 0;
+	audio->outputSkipFrames = 0;
 	audio->playingCh1 = false;
 	audio->playingCh2 = false;
 	audio->playingCh3 = false;
@@ -140,8 +144,8 @@ void GBAudioReset(struct GBAudio* audio) {
 }
 
 void GBAudioResizeBuffer(struct GBAudio* audio, size_t samples) {
-	if (samples > BLIP_BUFFER_SIZE / 2) {
-		samples = BLIP_BUFFER_SIZE / 2;
+	if (samples > audio->bufferCapacity / 2) {
+		samples = audio->bufferCapacity / 2;
 	}
 	mCoreSyncLockAudio(audio->p->sync);
 	audio->samples = samples;
@@ -151,6 +155,30 @@ void GBAudioResizeBuffer(struct GBAudio* audio, size_t samples) {
 	mCoreSyncConsumeAudio(audio->p->sync);
 }
 
+void GBAudioSetBufferCapacity(struct GBAudio* audio, size_t capacity) {
+	if (capacity == audio->bufferCapacity) {
+		return;
+	}
+	blip_t* left = blip_resize(audio->left, capacity);
+	if (left) {
+		audio->left = left;
+	}
+	blip_t* right = blip_resize(audio->right, capacity);
+	if (right) {
+		audio->right = right;
+	}
+	// If only one buffer could be resized, both still hold at least the smaller size
+	if ((left && right) || capacity < audio->bufferCapacity) {
+		audio->bufferCapacity = capacity;
+	}
+	blip_clear(audio->left);
+	blip_clear(audio->right);
+	if (audio->samples > audio->bufferCapacity / 2) {
+		audio->samples = audio->bufferCapacity / 2;
+	}
+	audio->clock = 0;
+}
+
 void GBAudioWriteNR10(struct GBAudio* audio, uint8_t value) {
 	GBAudioRun(audio, mTimingCurrentTime(audio->timing), 0x1);
 	if (!_writeSweep(&audio->ch1.sweep, value)) {
@@ -481,6 +509,9 @@ void GBAudioWriteNR52(struct GBAudio* audio, uint8_t value) {
 		audio->skipFrame = false;
 		audio->frame = 7;
 
+		if (audio->p) {
+			GBTimerSync(&audio->p->timer);
+		}
 		if (audio->p && audio->p->timer.internalDiv & (0x100 << audio->p->doubleSpeed)) {
 			audio->skipFrame = true;
 		}
@@ -496,6 +527,158 @@ void _updateFrame(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 #endif
 }
 
+static const uint16_t _noiseMaskTable[0x40] = {
+	0x3f, 0x3e, 0x3c, 0x3d, 0x39, 0x38, 0x3a, 0x3b,
+	0x33, 0x32, 0x30, 0x31, 0x35, 0x34, 0x36, 0x37,
+	0x27, 0x26, 0x24, 0x25, 0x21, 0x20, 0x22, 0x23,
+	0x2b, 0x2a, 0x28, 0x29, 0x2d, 0x2c, 0x2e, 0x2f,
+	0x0f, 0x0e, 0x0c, 0x0d, 0x09, 0x08, 0x0a, 0x0b,
+	0x03, 0x02, 0x00, 0x01, 0x05, 0x04, 0x06, 0x07,
+	0x17, 0x16, 0x14, 0x15, 0x11, 0x10, 0x12, 0x13,
+	0x1b, 0x1a, 0x18, 0x19, 0x1d, 0x1c, 0x1e, 0x1f
+};
+static const uint16_t _noisePopulationTable[0x40] = {
+	6, 5, 4, 5, 4, 3, 4, 5, 4, 3, 2, 3, 4, 3, 4, 5,
+	4, 3, 2, 3, 2, 1, 2, 3, 4, 3, 2, 3, 4, 3, 4, 5,
+	4, 3, 2, 3, 2, 1, 2, 3, 2, 1, 0, 1, 2, 1, 2, 3,
+	4, 3, 2, 3, 2, 1, 2, 3, 4, 3, 2, 3, 4, 3, 4, 5
+};
+
+static void _runSquare(struct GBAudioSquareChannel* ch, int32_t timestamp, unsigned timingFactor) {
+	int period = 4 * (2048 - ch->control.frequency) * timingFactor;
+	int32_t diff = timestamp - ch->lastUpdate;
+	if (diff >= period) {
+		diff /= period;
+		ch->index = (ch->index + diff) & 7;
+		ch->lastUpdate += diff * period;
+		_updateSquareSample(ch);
+	}
+}
+
+static void _runWave(struct GBAudio* audio, int32_t timestamp) {
+	int cycles = 2 * (2048 - audio->ch3.rate) * audio->timingFactor;
+	int32_t diff = timestamp - audio->ch3.nextUpdate;
+	if (diff >= 0) {
+		diff = (diff / cycles) + 1;
+		int volume;
+		switch (audio->ch3.volume) {
+		case 0:
+			volume = 4;
+			break;
+		case 1:
+			volume = 0;
+			break;
+		case 2:
+			volume = 1;
+			break;
+		default:
+		case 3:
+			volume = 2;
+			break;
+		}
+		int start = 7;
+		int end = 0;
+		int mask = 0x1F;
+		int iter;
+		switch (audio->style) {
+		case GB_AUDIO_DMG:
+		default:
+			audio->ch3.window += diff;
+			audio->ch3.window &= 0x1F;
+			audio->ch3.sample = audio->ch3.wavedata8[audio->ch3.window >> 1];
+			if (!(audio->ch3.window & 1)) {
+				audio->ch3.sample >>= 4;
+			}
+			audio->ch3.sample &= 0xF;
+			break;
+		case GB_AUDIO_GBA:
+			if (audio->ch3.size) {
+				mask = 0x3F;
+			} else if (audio->ch3.bank) {
+				end = 4;
+			} else {
+				start = 3;
+			}
+			for (iter = 0; iter < (diff & mask); ++iter) {
+				uint32_t bitsCarry = audio->ch3.wavedata32[end] & 0x000000F0;
+				uint32_t bits;
+				int i;
+				for (i = start; i >= end; --i) {
+					bits = audio->ch3.wavedata32[i] & 0x000000F0;
+					audio->ch3.wavedata32[i] = ((audio->ch3.wavedata32[i] & 0x0F0F0F0F) << 4) | ((audio->ch3.wavedata32[i] & 0xF0F0F000) >> 12);
+					audio->ch3.wavedata32[i] |= bitsCarry << 20;
+					bitsCarry = bits;
+				}
+				audio->ch3.sample = bitsCarry >> 4;
+			}
+			break;
+		}
+		if (audio->ch3.volume > 3) {
+			audio->ch3.sample += audio->ch3.sample << 1;
+		}
+		audio->ch3.sample >>= volume;
+		audio->ch3.nextUpdate += diff * cycles;
+		audio->ch3.readable = true;
+	}
+	if (audio->style == GB_AUDIO_DMG && audio->ch3.readable) {
+		diff = timestamp - audio->ch3.nextUpdate + cycles;
+		if (diff >= 4) {
+			audio->ch3.readable = false;
+		}
+	}
+}
+
+static void _runNoise(struct GBAudio* audio, int32_t timestamp) {
+	int32_t cycles = audio->ch4.ratio ? 2 * audio->ch4.ratio : 1;
+	cycles <<= audio->ch4.frequency;
+	cycles *= 8 * audio->timingFactor;
+
+	int32_t diff = timestamp - audio->ch4.lastEvent;
+	if (diff >= cycles) {
+		int32_t last = 0;
+		int samples = 0;
+		int positiveSamples = 0;
+		int lsb;
+		int coeff;
+		if (audio->ch4.power) {
+			// TODO: Can this be batched too?
+			coeff = 0x4040;
+		} else {
+			int bits = 0;
+			// Batch 5 steps at a time when possible
+			for (; last + cycles * 5 <= diff; last += cycles * 5) {
+				bits = audio->ch4.lfsr & 0x3F;
+				audio->ch4.lfsr >>= 5;
+				audio->ch4.lfsr |= 0x4000 * _noiseMaskTable[bits] >> 4;
+				audio->ch4.lfsr &= 0x7FFF;
+				samples += 5;
+				positiveSamples += _noisePopulationTable[bits];
+			}
+			lsb = _noiseMaskTable[bits] & 1;
+			coeff = 0x4000;
+		}
+		for (; last + cycles <= diff; last += cycles) {
+			lsb = (audio->ch4.lfsr ^ (audio->ch4.lfsr >> 1) ^ 1) & 1;
+			audio->ch4.lfsr >>= 1;
+			if (lsb) {
+				audio->ch4.lfsr |= coeff;
+			} else {
+				audio->ch4.lfsr &= ~coeff;
+			}
+			++samples;
+			positiveSamples += lsb;
+		}
+		audio->ch4.sample = lsb * audio->ch4.envelope.currentVolume;
+		audio->ch4.nSamples += samples;
+		audio->ch4.samples += positiveSamples * audio->ch4.envelope.currentVolume;
+		audio->ch4.lastEvent += last;
+	}
+}
+
+static inline bool _squareNeedsRun(const struct GBAudioSquareChannel* ch, bool playing, int32_t timestamp) {
+	return (playing && ch->envelope.dead != 2) || timestamp - ch->lastUpdate > 0x40000000;
+}
+
 void GBAudioRun(struct GBAudio* audio, int32_t timestamp, int channels) {
 	if (!audio->enable) {
 		return;
@@ -504,159 +687,17 @@ void GBAudioRun(struct GBAudio* audio, int32_t timestamp, int channels) {
 		GBAudioSample(audio, timestamp);
 	}
 
-	if ((channels & 0x1) && ((audio->playingCh1 && audio->ch1.envelope.dead != 2) || timestamp - audio->ch1.lastUpdate > 0x40000000 || (channels == 0x1))) {
-		int period = 4 * (2048 - audio->ch1.control.frequency) * audio->timingFactor;
-		int32_t diff = timestamp - audio->ch1.lastUpdate;
-		if (diff >= period) {
-			diff /= period;
-			audio->ch1.index = (audio->ch1.index + diff) & 7;
-			audio->ch1.lastUpdate += diff * period;
-			_updateSquareSample(&audio->ch1);
-		}
+	if ((channels & 0x1) && (_squareNeedsRun(&audio->ch1, audio->playingCh1, timestamp) || channels == 0x1)) {
+		_runSquare(&audio->ch1, timestamp, audio->timingFactor);
 	}
-	if ((channels & 0x2) && ((audio->playingCh2 && audio->ch2.envelope.dead != 2) || timestamp - audio->ch2.lastUpdate > 0x40000000 || (channels == 0x2))) {
-		int period = 4 * (2048 - audio->ch2.control.frequency) * audio->timingFactor;
-		int32_t diff = timestamp - audio->ch2.lastUpdate;
-		if (diff >= period) {
-			diff /= period;
-			audio->ch2.index = (audio->ch2.index + diff) & 7;
-			audio->ch2.lastUpdate += diff * period;
-			_updateSquareSample(&audio->ch2);
-		}
+	if ((channels & 0x2) && (_squareNeedsRun(&audio->ch2, audio->playingCh2, timestamp) || channels == 0x2)) {
+		_runSquare(&audio->ch2, timestamp, audio->timingFactor);
 	}
 	if (audio->playingCh3 && (channels & 0x4)) {
-		int cycles = 2 * (2048 - audio->ch3.rate) * audio->timingFactor;
-		int32_t diff = timestamp - audio->ch3.nextUpdate;
-		if (diff >= 0) {
-			diff = (diff / cycles) + 1;
-			int volume;
-			switch (audio->ch3.volume) {
-			case 0:
-				volume = 4;
-				break;
-			case 1:
-				volume = 0;
-				break;
-			case 2:
-				volume = 1;
-				break;
-			default:
-			case 3:
-				volume = 2;
-				break;
-			}
-			int start = 7;
-			int end = 0;
-			int mask = 0x1F;
-			int iter;
-			switch (audio->style) {
-			case GB_AUDIO_DMG:
-			default:
-				audio->ch3.window += diff;
-				audio->ch3.window &= 0x1F;
-				audio->ch3.sample = audio->ch3.wavedata8[audio->ch3.window >> 1];
-				if (!(audio->ch3.window & 1)) {
-					audio->ch3.sample >>= 4;
-				}
-				audio->ch3.sample &= 0xF;
-				break;
-			case GB_AUDIO_GBA:
-				if (audio->ch3.size) {
-					mask = 0x3F;
-				} else if (audio->ch3.bank) {
-					end = 4;
-				} else {
-					start = 3;
-				}
-				for (iter = 0; iter < (diff & mask); ++iter) {
-					uint32_t bitsCarry = audio->ch3.wavedata32[end] & 0x000000F0;
-					uint32_t bits;
-					int i;
-					for (i = start; i >= end; --i) {
-						bits = audio->ch3.wavedata32[i] & 0x000000F0;
-						audio->ch3.wavedata32[i] = ((audio->ch3.wavedata32[i] & 0x0F0F0F0F) << 4) | ((audio->ch3.wavedata32[i] & 0xF0F0F000) >> 12);
-						audio->ch3.wavedata32[i] |= bitsCarry << 20;
-						bitsCarry = bits;
-					}
-					audio->ch3.sample = bitsCarry >> 4;
-				}
-				break;
-			}
-			if (audio->ch3.volume > 3) {
-				audio->ch3.sample += audio->ch3.sample << 1;
-			}
-			audio->ch3.sample >>= volume;
-			audio->ch3.nextUpdate += diff * cycles;
-			audio->ch3.readable = true;
-		}
-		if (audio->style == GB_AUDIO_DMG && audio->ch3.readable) {
-			diff = timestamp - audio->ch3.nextUpdate + cycles;
-			if (diff >= 4) {
-				audio->ch3.readable = false;
-			}
-		}
+		_runWave(audio, timestamp);
 	}
 	if (audio->playingCh4 && (channels & 0x8)) {
-		const uint16_t noiseMaskTable[0x40] = {
-			0x3f, 0x3e, 0x3c, 0x3d, 0x39, 0x38, 0x3a, 0x3b,
-			0x33, 0x32, 0x30, 0x31, 0x35, 0x34, 0x36, 0x37,
-			0x27, 0x26, 0x24, 0x25, 0x21, 0x20, 0x22, 0x23,
-			0x2b, 0x2a, 0x28, 0x29, 0x2d, 0x2c, 0x2e, 0x2f,
-			0x0f, 0x0e, 0x0c, 0x0d, 0x09, 0x08, 0x0a, 0x0b,
-			0x03, 0x02, 0x00, 0x01, 0x05, 0x04, 0x06, 0x07,
-			0x17, 0x16, 0x14, 0x15, 0x11, 0x10, 0x12, 0x13,
-			0x1b, 0x1a, 0x18, 0x19, 0x1d, 0x1c, 0x1e, 0x1f
-		};
-		const uint16_t noisePopulationTable[0x40] = {
-			6, 5, 4, 5, 4, 3, 4, 5, 4, 3, 2, 3, 4, 3, 4, 5,
-			4, 3, 2, 3, 2, 1, 2, 3, 4, 3, 2, 3, 4, 3, 4, 5,
-			4, 3, 2, 3, 2, 1, 2, 3, 2, 1, 0, 1, 2, 1, 2, 3,
-			4, 3, 2, 3, 2, 1, 2, 3, 4, 3, 2, 3, 4, 3, 4, 5
-		};
-		int32_t cycles = audio->ch4.ratio ? 2 * audio->ch4.ratio : 1;
-		cycles <<= audio->ch4.frequency;
-		cycles *= 8 * audio->timingFactor;
-
-		int32_t diff = timestamp - audio->ch4.lastEvent;
-		if (diff >= cycles) {
-			int32_t last = 0;
-			int samples = 0;
-			int positiveSamples = 0;
-			int lsb;
-			int coeff;
-			if (audio->ch4.power) {
-				// TODO: Can this be batched too?
-				coeff = 0x4040;
-			} else {
-				int bits = 0;
-				// Batch 5 steps at a time when possible
-				for (; last + cycles * 5 <= diff; last += cycles * 5) {
-					bits = audio->ch4.lfsr & 0x3F;
-					audio->ch4.lfsr >>= 5;
-					audio->ch4.lfsr |= 0x4000 * noiseMaskTable[bits] >> 4;
-					audio->ch4.lfsr &= 0x7FFF;
-					samples += 5;
-					positiveSamples += noisePopulationTable[bits];
-				}
-				lsb = noiseMaskTable[bits] & 1;
-				coeff = 0x4000;
-			}
-			for (; last + cycles <= diff; last += cycles) {
-				lsb = (audio->ch4.lfsr ^ (audio->ch4.lfsr >> 1) ^ 1) & 1;
-				audio->ch4.lfsr >>= 1;
-				if (lsb) {
-					audio->ch4.lfsr |= coeff;
-				} else {
-					audio->ch4.lfsr &= ~coeff;
-				}
-				++samples;
-				positiveSamples += lsb;
-			}
-			audio->ch4.sample = lsb * audio->ch4.envelope.currentVolume;
-			audio->ch4.nSamples += samples;
-			audio->ch4.samples += positiveSamples * audio->ch4.envelope.currentVolume;
-			audio->ch4.lastEvent += last;
-		}
+		_runNoise(audio, timestamp);
 	}
 }
 
@@ -807,17 +848,97 @@ void GBAudioSamplePSG(struct GBAudio* audio, int16_t* left, int16_t* right) {
 	*right = sampleRight * (1 + audio->volumeRight);
 }
 
+static void _batchSquare(struct GBAudio* audio, struct GBAudioSquareChannel* ch, bool playing, bool toLeft, bool toRight, int32_t timestamp, int32_t interval, int* left, int* right, int count) {
+	int i;
+	for (i = 0; i < count; ++i) {
+		int32_t when = timestamp + i * interval;
+		if (audio->enable && _squareNeedsRun(ch, playing, when)) {
+			_runSquare(ch, when, audio->timingFactor);
+		}
+		if (toLeft) {
+			left[i] += ch->sample;
+		}
+		if (toRight) {
+			right[i] += ch->sample;
+		}
+	}
+}
+
+void GBAudioSamplePSGBatch(struct GBAudio* audio, int32_t timestamp, int32_t interval, struct mStereoSample* samples, int count) {
+	int left[GB_MAX_SAMPLES];
+	int right[GB_MAX_SAMPLES];
+	int dcOffset = audio->style == GB_AUDIO_GBA ? 0 : -0x8;
+	int i;
+	for (i = 0; i < count; ++i) {
+		left[i] = dcOffset;
+		right[i] = dcOffset;
+	}
+
+	// Each channel is stepped through the whole batch before moving on to the next one, which
+	// keeps its state hot instead of cycling through all four channels for every sample
+	_batchSquare(audio, &audio->ch1, audio->playingCh1, !audio->forceDisableCh[0] && audio->ch1Left, !audio->forceDisableCh[0] && audio->ch1Right, timestamp, interval, left, right, count);
+	_batchSquare(audio, &audio->ch2, audio->playingCh2, !audio->forceDisableCh[1] && audio->ch2Left, !audio->forceDisableCh[1] && audio->ch2Right, timestamp, interval, left, right, count);
+
+	bool toLeft = !audio->forceDisableCh[2] && audio->ch3Left;
+	bool toRight = !audio->forceDisableCh[2] && audio->ch3Right;
+	for (i = 0; i < count; ++i) {
+		if (audio->enable && audio->playingCh3) {
+			_runWave(audio, timestamp + i * interval);
+		}
+		if (toLeft) {
+			left[i] += audio->ch3.sample;
+		}
+		if (toRight) {
+			right[i] += audio->ch3.sample;
+		}
+		left[i] <<= 3;
+		right[i] <<= 3;
+	}
+
+	bool enabled = !audio->forceDisableCh[3];
+	toLeft = enabled && audio->ch4Left;
+	toRight = enabled && audio->ch4Right;
+	for (i = 0; i < count; ++i) {
+		if (audio->enable && audio->playingCh4) {
+			_runNoise(audio, timestamp + i * interval);
+		}
+		if (enabled) {
+			// Coalescing consumes the accumulated noise, so it has to happen even if neither side hears it
+			int16_t sample = audio->style == GB_AUDIO_GBA ? (audio->ch4.sample << 3) : _coalesceNoiseChannel(&audio->ch4);
+			if (toLeft) {
+				left[i] += sample;
+			}
+			if (toRight) {
+				right[i] += sample;
+			}
+		}
+		samples[i].left = left[i] * (1 + audio->volumeLeft);
+		samples[i].right = right[i] * (1 + audio->volumeRight);
+	}
+}
+
+unsigned GBAudioSampleRate(const struct GBAudio* audio) {
+	UNUSED(audio);
+	return DMG_SM83_FREQUENCY / SAMPLE_INTERVAL;
+}
+
 void GBAudioSample(struct GBAudio* audio, int32_t timestamp) {
+	if (audio->outputDisabled) {
+		return;
+	}
 	int interval = SAMPLE_INTERVAL * audio->timingFactor;
 	timestamp -= audio->lastSample;
 	timestamp -= audio->sampleIndex * interval;
 
+	int start = audio->sampleIndex;
+	int end;
+	for (end = start; timestamp >= interval && end < GB_MAX_SAMPLES; ++end, timestamp -= interval);
+	GBAudioSamplePSGBatch(audio, start * interval + audio->lastSample, interval, &audio->currentSamples[start], end - start);
+
 	int sample;
-	for (sample = audio->sampleIndex; timestamp >= interval && sample < GB_MAX_SAMPLES; ++sample, timestamp -= interval) {
-		int16_t sampleLeft = 0;
-		int16_t sampleRight = 0;
-		GBAudioRun(audio, sample * interval + audio->lastSample, 0x1F);
-		GBAudioSamplePSG(audio, &sampleLeft, &sampleRight);
+	for (sample = start; sample < end; ++sample) {
+		int16_t sampleLeft = audio->currentSamples[sample].left;
+		int16_t sampleRight = audio->currentSamples[sample].right;
 		sampleLeft = (sampleLeft * audio->masterVolume * 6) >> 7;
 		sampleRight = (sampleRight * audio->masterVolume * 6) >> 7;
 
@@ -839,8 +960,27 @@ void GBAudioSample(struct GBAudio* audio, int32_t timestamp) {
 
 static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 	struct GBAudio* audio = user;
+	mPERF_ENTER(AUDIO);
+	if (audio->outputDisabled) {
+		// Keep the channels from going stale, and drain the noise channel's accumulator the way
+		// sampling would, but don't mix anything
+		GBAudioRun(audio, mTimingCurrentTime(audio->timing), 0x1F);
+		_coalesceNoiseChannel(&audio->ch4);
+		audio->lastSample += audio->sampleInterval * audio->timingFactor;
+		audio->sampleIndex = 0;
+		mTimingSchedule(timing, &audio->sampleEvent, audio->sampleInterval * audio->timingFactor - cyclesLate);
+		mPERF_LEAVE();
+		return;
+	}
 	GBAudioSample(audio, mTimingCurrentTime(audio->timing));
 
+	if (audio->outputSkipFrames) {
+		// Nobody will hear these samples, so don't resample them or wait for them to be consumed
+		mTimingSchedule(timing, &audio->sampleEvent, audio->sampleInterval * audio->timingFactor - cyclesLate);
+		mPERF_LEAVE();
+		return;
+	}
+
 	mCoreSyncLockAudio(audio->p->sync);
 	unsigned produced;
 	int i;
@@ -862,11 +1002,14 @@ static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 		if (audio->p->stream && audio->p->stream->postAudioFrame) {
 			audio->p->stream->postAudioFrame(audio->p->stream, sampleLeft, sampleRight);
 		}
+		if (audio->p->streamBuffer) {
+			mAVBufferPushSample(audio->p->streamBuffer, sampleLeft, sampleRight);
+		}
 	}
 
 	produced = blip_samples_avail(audio->left);
 	bool wait = produced >= audio->samples;
-	if (!mCoreSyncProduceAudio(audio->p->sync, audio->left, audio->samples)) {
+	if (!mCoreSyncProduceAudio(audio->p->sync, audio->left, audio->right, audio->samples)) {
 		// Interrupted
 		audio->p->earlyExit = true;
 	}
@@ -875,6 +1018,7 @@ static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 		audio->p->stream->postAudioBuffer(audio->p->stream, audio->left, audio->right);
 	}
 	mTimingSchedule(timing, &audio->sampleEvent, audio->sampleInterval * audio->timingFactor - cyclesLate);
+	mPERF_LEAVE();
 }
 
 bool _resetEnvelope(struct GBAudioEnvelope* envelope) {
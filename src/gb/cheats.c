@@ -127,6 +127,7 @@ static bool GBCheatAddVBALine(struct mCheatSet* cheats, const char* line) {
 }
 
 bool GBCheatAddLine(struct mCheatSet* cheats, const char* line, int type) {
+	mCheatSetInvalidate(cheats);
 	switch (type) {
 	case GB_CHEAT_AUTODETECT:
 		break;
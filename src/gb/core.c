@@ -5,7 +5,9 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/gb/core.h>
 
+#include <mgba/core/av-buffer.h>
 #include <mgba/core/core.h>
+#include <mgba/core/serialize.h>
 #include <mgba/internal/debugger/symbols.h>
 #include <mgba/internal/gb/cheats.h>
 #include <mgba/internal/gb/debugger/cli.h>
@@ -15,12 +17,16 @@
 #include <mgba/internal/gb/gb.h>
 #include <mgba/internal/gb/mbc.h>
 #include <mgba/internal/gb/overrides.h>
+#ifdef BUILD_GLES3
+#include <mgba/internal/gb/renderers/gl.h>
+#endif
 #include <mgba/internal/gb/renderers/software.h>
 #include <mgba/internal/gb/renderers/proxy.h>
 #include <mgba/internal/gb/serialize.h>
 #include <mgba/internal/sm83/sm83.h>
 #include <mgba/internal/sm83/debugger/debugger.h>
 #include <mgba-util/crc32.h>
+#include <mgba-util/hash.h>
 #include <mgba-util/memory.h>
 #include <mgba-util/patch.h>
 #include <mgba-util/vfs.h>
@@ -91,11 +97,17 @@ struct GBCore {
 	struct mCore d;
 	struct GBVideoRenderer dummyRenderer;
 	struct GBVideoSoftwareRenderer renderer;
+#ifdef BUILD_GLES3
+	struct GBVideoGLRenderer glRenderer;
+#endif
 #ifndef MINIMAL_CORE
 	struct GBVideoProxyRenderer proxyRenderer;
 	struct mVideoLogContext* logContext;
 #endif
 	struct mCoreCallbacks logCallbacks;
+	struct mCoreCallbacks streamCallbacks;
+	color_t* streamSavedBuffer;
+	size_t streamSavedStride;
 	uint8_t keys;
 	struct mCPUComponent* components[CPU_COMPONENT_MAX];
 	const struct Configuration* overrides;
@@ -103,6 +115,7 @@ struct GBCore {
 	bool hasOverride;
 	struct mDebuggerPlatform* debuggerPlatform;
 	struct mCheatDevice* cheatDevice;
+	color_t* colorTable;
 	struct mCoreMemoryBlock memoryBlocks[8];
 };
 
@@ -122,6 +135,7 @@ static bool _GBCoreInit(struct mCore* core) {
 	gbcore->overrides = NULL;
 	gbcore->debuggerPlatform = NULL;
 	gbcore->cheatDevice = NULL;
+	gbcore->colorTable = NULL;
 #ifndef MINIMAL_CORE
 	gbcore->logContext = NULL;
 #endif
@@ -140,6 +154,10 @@ static bool _GBCoreInit(struct mCore* core) {
 	GBVideoAssociateRenderer(&gb->video, &gbcore->dummyRenderer);
 
 	GBVideoSoftwareRendererCreate(&gbcore->renderer);
+#ifdef BUILD_GLES3
+	GBVideoGLRendererCreate(&gbcore->glRenderer);
+	gbcore->glRenderer.outputTex = -1;
+#endif
 	gbcore->renderer.outputBuffer = NULL;
 
 #ifndef MINIMAL_CORE
@@ -156,7 +174,10 @@ static bool _GBCoreInit(struct mCore* core) {
 	return true;
 }
 
+static void _GBCoreDetachBufferPool(struct mCore* core);
+
 static void _GBCoreDeinit(struct mCore* core) {
+	_GBCoreDetachBufferPool(core);
 	SM83Deinit(core->cpu);
 	GBDestroy(core->board);
 	mappedMemoryFree(core->cpu, sizeof(struct SM83Core));
@@ -175,6 +196,7 @@ static void _GBCoreDeinit(struct mCore* core) {
 	if (gbcore->cheatDevice) {
 		mCheatDeviceDestroy(gbcore->cheatDevice);
 	}
+	free(gbcore->colorTable);
 	mCoreConfigFreeOpts(&core->opts);
 	free(core);
 }
@@ -187,6 +209,12 @@ static enum mPlatform _GBCorePlatform(const struct mCore* core) {
 static bool _GBCoreSupportsFeature(const struct mCore* core, enum mCoreFeature feature) {
 	UNUSED(core);
 	switch (feature) {
+	case mCORE_FEATURE_OPENGL:
+#ifdef BUILD_GLES3
+		return true;
+#else
+		return false;
+#endif
 	default:
 		return false;
 	}
@@ -197,6 +225,13 @@ static void _GBCoreSetSync(struct mCore* core, struct mCoreSync* sync) {
 	gb->sync = sync;
 }
 
+static void _GBCoreLoadSlim(struct GB* gb, const struct mCoreConfig* config) {
+	bool slim;
+	if (mCoreConfigGetBoolValue(config, "slim", &slim) && slim != gb->slim) {
+		GBSetSlim(gb, slim);
+	}
+}
+
 static void _GBCoreLoadConfig(struct mCore* core, const struct mCoreConfig* config) {
 	UNUSED(config);
 
@@ -206,6 +241,7 @@ static void _GBCoreLoadConfig(struct mCore* core, const struct mCoreConfig* conf
 	} else {
 		gb->audio.masterVolume = core->opts.volume;
 	}
+	gb->audio.outputDisabled = core->opts.disableAudio;
 	gb->video.frameskip = core->opts.frameskip;
 
 	int color;
@@ -257,8 +293,25 @@ static void _GBCoreLoadConfig(struct mCore* core, const struct mCoreConfig* conf
 	mCoreConfigCopyValue(&core->config, config, "gb.colors");
 	mCoreConfigCopyValue(&core->config, config, "useCgbColors");
 	mCoreConfigCopyValue(&core->config, config, "allowOpposingDirections");
+	mCoreConfigCopyValue(&core->config, config, "slim");
+
+	const char* idleOptimization = mCoreConfigGetValue(config, "idleOptimization");
+	if (idleOptimization) {
+		if (strcasecmp(idleOptimization, "ignore") == 0) {
+			gb->idleOptimization = GB_IDLE_LOOP_IGNORE;
+		} else if (strcasecmp(idleOptimization, "remove") == 0) {
+			gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+		} else if (strcasecmp(idleOptimization, "detect") == 0) {
+			if (gb->idleLoop == GB_IDLE_LOOP_NONE) {
+				gb->idleOptimization = GB_IDLE_LOOP_DETECT;
+			} else {
+				gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+			}
+		}
+	}
 
 	mCoreConfigGetBoolValue(config, "allowOpposingDirections", &gb->allowOpposingDirections);
+	_GBCoreLoadSlim(gb, config);
 
 	if (mCoreConfigGetBoolValue(config, "sgb.borders", &gb->video.sgbBorders)) {
 		gb->video.renderer->enableSGBBorder(gb->video.renderer, gb->video.sgbBorders);
@@ -283,6 +336,7 @@ static void _GBCoreReloadConfigOption(struct mCore* core, const char* option, co
 		} else {
 			gb->audio.masterVolume = core->opts.volume;
 		}
+		gb->audio.outputDisabled = core->opts.disableAudio;
 		gb->video.frameskip = core->opts.frameskip;
 		return;
 	}
@@ -297,6 +351,12 @@ static void _GBCoreReloadConfigOption(struct mCore* core, const char* option, co
 		}
 		return;
 	}
+	if (strcmp("disableAudio", option) == 0) {
+		if (mCoreConfigGetBoolValue(config, "disableAudio", &core->opts.disableAudio)) {
+			gb->audio.outputDisabled = core->opts.disableAudio;
+		}
+		return;
+	}
 	if (strcmp("volume", option) == 0) {
 		if (mCoreConfigGetIntValue(config, "volume", &core->opts.volume) && !core->opts.mute) {
 			gb->audio.masterVolume = core->opts.volume;
@@ -316,12 +376,54 @@ static void _GBCoreReloadConfigOption(struct mCore* core, const char* option, co
 		mCoreConfigGetBoolValue(config, "allowOpposingDirections", &gb->allowOpposingDirections);
 		return;
 	}
+	if (strcmp("slim", option) == 0) {
+		if (config != &core->config) {
+			mCoreConfigCopyValue(&core->config, config, "slim");
+		}
+		_GBCoreLoadSlim(gb, config);
+		return;
+	}
 	if (strcmp("sgb.borders", option) == 0) {
 		if (mCoreConfigGetBoolValue(config, "sgb.borders", &gb->video.sgbBorders)) {
 			gb->video.renderer->enableSGBBorder(gb->video.renderer, gb->video.sgbBorders);
 		}
 	}
 
+	struct GBCore* gbcore = (struct GBCore*) core;
+#ifdef BUILD_GLES3
+	if (strcmp("videoScale", option) == 0) {
+		if (config != &core->config) {
+			mCoreConfigCopyValue(&core->config, config, "videoScale");
+		}
+		bool value;
+		if (gbcore->glRenderer.outputTex != (unsigned) -1 && mCoreConfigGetBoolValue(&core->config, "hwaccelVideo", &value) && value) {
+			int scale;
+			mCoreConfigGetIntValue(config, "videoScale", &scale);
+			GBVideoGLRendererSetScale(&gbcore->glRenderer, scale);
+		}
+		return;
+	}
+#endif
+	if (strcmp("hwaccelVideo", option) == 0) {
+		struct GBVideoRenderer* renderer = NULL;
+		if (gbcore->renderer.outputBuffer) {
+			renderer = &gbcore->renderer.d;
+		}
+#ifdef BUILD_GLES3
+		bool value;
+		if (gbcore->glRenderer.outputTex != (unsigned) -1 && mCoreConfigGetBoolValue(&core->config, "hwaccelVideo", &value) && value) {
+			mCoreConfigGetIntValue(&core->config, "videoScale", &gbcore->glRenderer.scale);
+			renderer = &gbcore->glRenderer.d;
+		} else {
+			gbcore->glRenderer.scale = 1;
+		}
+#endif
+		if (renderer) {
+			GBVideoAssociateRenderer(&gb->video, renderer);
+		}
+		return;
+	}
+
 	if (strcmp("gb.pal", option) == 0) {
 		int color;
 		if (mCoreConfigGetIntValue(config, "gb.pal[0]", &color)) {
@@ -389,10 +491,24 @@ static void _GBCoreCurrentVideoSize(const struct mCore* core, unsigned* width, u
 		*width = SGB_VIDEO_HORIZONTAL_PIXELS;
 		*height = SGB_VIDEO_VERTICAL_PIXELS;
 	}
+#ifdef BUILD_GLES3
+	const struct GBCore* gbcore = (const struct GBCore*) core;
+	if (gbcore->glRenderer.outputTex != (unsigned) -1) {
+		*width *= gbcore->glRenderer.scale;
+		*height *= gbcore->glRenderer.scale;
+	}
+#endif
 }
 
 static unsigned _GBCoreVideoScale(const struct mCore* core) {
+#ifdef BUILD_GLES3
+	const struct GBCore* gbcore = (const struct GBCore*) core;
+	if (gbcore->glRenderer.outputTex != (unsigned) -1) {
+		return gbcore->glRenderer.scale;
+	}
+#else
 	UNUSED(core);
+#endif
 	return 1;
 }
 
@@ -413,19 +529,64 @@ static void _GBCoreSetVideoBuffer(struct mCore* core, color_t* buffer, size_t st
 	gbcore->renderer.outputBufferStride = stride;
 }
 
+static bool _GBCoreSetVideoFormat(struct mCore* core, enum mColorFormat format) {
+	struct GBCore* gbcore = (struct GBCore*) core;
+	if (format == mCOLOR_NATIVE) {
+		gbcore->renderer.colorTable = NULL;
+		return true;
+	}
+	if (format != mCOLOR_NATIVE_SWAPPED) {
+		return false;
+	}
+	if (!gbcore->colorTable) {
+		gbcore->colorTable = malloc(M_COLOR_TABLE_555_SIZE * sizeof(color_t));
+		mColorTableFrom555(gbcore->colorTable, format);
+	}
+	gbcore->renderer.colorTable = gbcore->colorTable;
+	return true;
+}
+
 static void _GBCoreSetVideoGLTex(struct mCore* core, unsigned texid) {
+#ifdef BUILD_GLES3
+	struct GBCore* gbcore = (struct GBCore*) core;
+	gbcore->glRenderer.outputTex = texid;
+	gbcore->glRenderer.outputTexDirty = true;
+#else
 	UNUSED(core);
 	UNUSED(texid);
+#endif
 }
 
-static void _GBCoreGetPixels(struct mCore* core, const void** buffer, size_t* stride) {
+static struct GBVideoRenderer* _GBCoreOutputRenderer(struct mCore* core) {
 	struct GBCore* gbcore = (struct GBCore*) core;
-	gbcore->renderer.d.getPixels(&gbcore->renderer.d, stride, buffer);
+#ifdef BUILD_GLES3
+	struct GB* gb = core->board;
+	if (gb->video.renderer == &gbcore->glRenderer.d) {
+		return &gbcore->glRenderer.d;
+	}
+#endif
+	return &gbcore->renderer.d;
+}
+
+static void _GBCoreGetPixels(struct mCore* core, const void** buffer, size_t* stride) {
+	struct GBVideoRenderer* renderer = _GBCoreOutputRenderer(core);
+	renderer->getPixels(renderer, stride, buffer);
 }
 
 static void _GBCorePutPixels(struct mCore* core, const void* buffer, size_t stride) {
-	struct GBCore* gbcore = (struct GBCore*) core;
-	gbcore->renderer.d.putPixels(&gbcore->renderer.d, stride, buffer);
+	struct GBVideoRenderer* renderer = _GBCoreOutputRenderer(core);
+	renderer->putPixels(renderer, stride, buffer);
+}
+
+static bool _GBCoreGetChangedScanlines(struct mCore* core, uint32_t* scanlines) {
+	// The renderer redraws every row of every frame, so they all count as changed
+	unsigned width, height;
+	core->currentVideoSize(core, &width, &height);
+	memset(scanlines, 0xFF, (height >> 5) * sizeof(*scanlines));
+	if (height & 0x1F) {
+		scanlines[height >> 5] = (1U << (height & 0x1F)) - 1;
+	}
+	return true;
 }
 
 static struct blip_t* _GBCoreGetAudioChannel(struct mCore* core, int ch) {
@@ -450,6 +611,11 @@ static size_t _GBCoreGetAudioBufferSize(struct mCore* core) {
 	return gb->audio.samples;
 }
 
+static unsigned _GBCoreAudioSampleRate(const struct mCore* core) {
+	const struct GB* gb = core->board;
+	return GBAudioSampleRate(&gb->audio);
+}
+
 static void _GBCoreAddCoreCallbacks(struct mCore* core, struct mCoreCallbacks* coreCallbacks) {
 	struct GB* gb = core->board;
 	*mCoreCallbacksListAppend(&gb->coreCallbacks) = *coreCallbacks;
@@ -458,11 +624,78 @@ static void _GBCoreAddCoreCallbacks(struct mCore* core, struct mCoreCallbacks* c
 static void _GBCoreClearCoreCallbacks(struct mCore* core) {
 	struct GB* gb = core->board;
 	mCoreCallbacksListClear(&gb->coreCallbacks);
+	struct GBCore* gbcore = (struct GBCore*) core;
+	if (gb->streamBuffer) {
+		// This one is internal, so it has to outlive whatever the frontend added
+		*mCoreCallbacksListAppend(&gb->coreCallbacks) = gbcore->streamCallbacks;
+	}
+#ifndef MINIMAL_CORE
+	if (gbcore->logContext && gbcore->logCallbacks.videoFrameEnded) {
+		// As is the one that takes video log keyframes
+		*mCoreCallbacksListAppend(&gb->coreCallbacks) = gbcore->logCallbacks;
+	}
+#endif
+}
+
+static void _GBCoreStreamFrameEnded(void* context) {
+	struct mCore* core = context;
+	struct GB* gb = core->board;
+	if (!gb->streamBuffer || !gb->stream || gb->video.skipFrames) {
+		return;
+	}
+	unsigned width, height;
+	core->currentVideoSize(core, &width, &height);
+	struct mAVBuffer* next = mAVStreamSwapBuffer(gb->stream, gb->streamBuffer, width, height, gb->video.frameCounter, mTimingGlobalTime(&gb->timing));
+	if (next != gb->streamBuffer) {
+		gb->streamBuffer = next;
+		core->setVideoBuffer(core, next->pixels, next->stride);
+	}
+}
+
+static void _GBCoreDetachBufferPool(struct mCore* core) {
+	struct GBCore* gbcore = (struct GBCore*) core;
+	struct GB* gb = core->board;
+	if (!gb->streamBuffer) {
+		return;
+	}
+	mAVBufferUnref(gb->streamBuffer);
+	gb->streamBuffer = NULL;
+	core->setVideoBuffer(core, gbcore->streamSavedBuffer, gbcore->streamSavedStride);
+
+	size_t i;
+	for (i = 0; i < mCoreCallbacksListSize(&gb->coreCallbacks); ++i) {
+		if (mCoreCallbacksListGetPointer(&gb->coreCallbacks, i)->videoFrameEnded == _GBCoreStreamFrameEnded) {
+			mCoreCallbacksListShift(&gb->coreCallbacks, i, 1);
+			break;
+		}
+	}
+}
+
+static void _GBCoreAttachBufferPool(struct mCore* core, struct mAVStream* stream) {
+	struct GBCore* gbcore = (struct GBCore*) core;
+	struct GB* gb = core->board;
+	struct mAVBuffer* buffer = mAVBufferPoolAcquire(stream->bufferPool);
+	if (!buffer) {
+		return;
+	}
+	gb->streamBuffer = buffer;
+	gbcore->streamSavedBuffer = gbcore->renderer.outputBuffer;
+	gbcore->streamSavedStride = gbcore->renderer.outputBufferStride;
+	core->setVideoBuffer(core, buffer->pixels, buffer->stride);
+
+	memset(&gbcore->streamCallbacks, 0, sizeof(gbcore->streamCallbacks));
+	gbcore->streamCallbacks.videoFrameEnded = _GBCoreStreamFrameEnded;
+	gbcore->streamCallbacks.context = core;
+	core->addCoreCallbacks(core, &gbcore->streamCallbacks);
 }
 
 static void _GBCoreSetAVStream(struct mCore* core, struct mAVStream* stream) {
 	struct GB* gb = core->board;
+	_GBCoreDetachBufferPool(core);
 	gb->stream = stream;
+	if (stream && stream->bufferPool && stream->postVideoBuffer) {
+		_GBCoreAttachBufferPool(core, stream);
+	}
 	if (stream && stream->videoDimensionsChanged) {
 		unsigned width, height;
 		core->currentVideoSize(core, &width, &height);
@@ -538,8 +771,23 @@ static void _GBCoreChecksum(const struct mCore* core, void* data, enum mCoreChec
 static void _GBCoreReset(struct mCore* core) {
 	struct GBCore* gbcore = (struct GBCore*) core;
 	struct GB* gb = (struct GB*) core->board;
+	// The frame counter starts over, so a cached host time could otherwise be reused
+	core->rtc.hostTimeValid = false;
+	struct GBVideoRenderer* renderer = NULL;
 	if (gbcore->renderer.outputBuffer) {
-		GBVideoAssociateRenderer(&gb->video, &gbcore->renderer.d);
+		renderer = &gbcore->renderer.d;
+	}
+#ifdef BUILD_GLES3
+	bool value;
+	if (gbcore->glRenderer.outputTex != (unsigned) -1 && mCoreConfigGetBoolValue(&core->config, "hwaccelVideo", &value) && value) {
+		mCoreConfigGetIntValue(&core->config, "videoScale", &gbcore->glRenderer.scale);
+		renderer = &gbcore->glRenderer.d;
+	} else {
+		gbcore->glRenderer.scale = 1;
+	}
+#endif
+	if (renderer) {
+		GBVideoAssociateRenderer(&gb->video, renderer);
 	}
 
 	if (gb->memory.rom) {
@@ -727,6 +975,16 @@ static void _GBCoreStep(struct mCore* core) {
 	} while (cpu->executionState != SM83_CORE_FETCH);
 }
 
+static void _GBCoreSkipVideoFrames(struct mCore* core, unsigned frames) {
+	struct GB* gb = core->board;
+	gb->video.skipFrames = frames;
+}
+
+static void _GBCoreSkipAudioFrames(struct mCore* core, unsigned frames) {
+	struct GB* gb = core->board;
+	gb->audio.outputSkipFrames = frames;
+}
+
 static size_t _GBCoreStateSize(struct mCore* core) {
 	UNUSED(core);
 	return sizeof(struct GBSerializedState);
@@ -745,6 +1003,135 @@ static bool _GBCoreSaveState(struct mCore* core, void* state) {
 	return true;
 }
 
+static bool _GBCoreSaveStateIncremental(struct mCore* core, void* state, uint32_t* epoch) {
+	// GB states are small enough that tracking dirty memory wouldn't save much over a full copy
+	*epoch = 1;
+	return _GBCoreSaveState(core, state);
+}
+
+static const struct mStateSection _GBStateSections[] = {
+	{ "header", offsetof(struct GBSerializedState, versionMagic), offsetof(struct GBSerializedState, cpu) - offsetof(struct GBSerializedState, versionMagic) },
+	{ "cpu", offsetof(struct GBSerializedState, cpu), offsetof(struct GBSerializedState, audio) - offsetof(struct GBSerializedState, cpu) },
+	{ "audio", offsetof(struct GBSerializedState, audio), offsetof(struct GBSerializedState, video) - offsetof(struct GBSerializedState, audio) },
+	{ "system", offsetof(struct GBSerializedState, video), offsetof(struct GBSerializedState, audio2) - offsetof(struct GBSerializedState, video) },
+	{ "samples", offsetof(struct GBSerializedState, audio2), offsetof(struct GBSerializedState, oam) - offsetof(struct GBSerializedState, audio2) },
+	{ "oam", offsetof(struct GBSerializedState, oam), offsetof(struct GBSerializedState, io) - offsetof(struct GBSerializedState, oam) },
+	{ "io", offsetof(struct GBSerializedState, io), offsetof(struct GBSerializedState, vram) - offsetof(struct GBSerializedState, io) },
+	{ "vram", offsetof(struct GBSerializedState, vram), offsetof(struct GBSerializedState, wram) - offsetof(struct GBSerializedState, vram) },
+	{ "wram", offsetof(struct GBSerializedState, wram), offsetof(struct GBSerializedState, reserved2) - offsetof(struct GBSerializedState, wram) },
+	{ "cart", offsetof(struct GBSerializedState, reserved2), sizeof(struct GBSerializedState) - offsetof(struct GBSerializedState, reserved2) },
+};
+
+static size_t _GBCoreListStateSections(const struct mCore* core, const struct mStateSection** sections) {
+	UNUSED(core);
+	*sections = _GBStateSections;
+	return sizeof(_GBStateSections) / sizeof(*_GBStateSections);
+}
+
+static struct mCore* _GBCoreClone(struct mCore* core) {
+	struct GBCore* gbcore = (struct GBCore*) core;
+	struct GB* gb = core->board;
+	struct mCore* clone = GBCoreCreate();
+	if (!clone) {
+		return NULL;
+	}
+	if (!clone->init(clone)) {
+		free(clone);
+		return NULL;
+	}
+	mCoreInitConfig(clone, core->config.port);
+	mCoreLoadForeignConfig(clone, &core->config);
+	// The clone runs with whatever BIOS this core has, rather than looking for one on disk
+	clone->opts.useBios = false;
+
+	struct GBCore* clonecore = (struct GBCore*) clone;
+	struct GB* cloneGb = clone->board;
+	clonecore->override = gbcore->override;
+	clonecore->hasOverride = gbcore->hasOverride;
+	cloneGb->romRegistry = gb->romRegistry;
+	if (!GBCloneROM(cloneGb, gb)) {
+		mCoreConfigDeinit(&clone->config);
+		clone->deinit(clone);
+		return NULL;
+	}
+	if (gb->biosVf) {
+		ssize_t biosSize = gb->biosVf->size(gb->biosVf);
+		void* bios = gb->biosVf->map(gb->biosVf, biosSize, MAP_READ);
+		if (bios) {
+			GBLoadBIOS(cloneGb, VFileMemChunk(bios, biosSize));
+			gb->biosVf->unmap(gb->biosVf, bios, biosSize);
+		}
+	}
+	void* sram = NULL;
+	size_t sramSize = core->savedataClone(core, &sram);
+	GBLoadSave(cloneGb, VFileMemChunk(sram, sramSize));
+	free(sram);
+	cloneGb->model = gb->model;
+	clone->rtc.override = core->rtc.override;
+	clone->rtc.value = core->rtc.value;
+	clone->rtc.custom = core->rtc.custom;
+	clone->reset(clone);
+
+	size_t stateSize = core->stateSize(core);
+	void* state = anonymousMemoryMap(stateSize);
+	bool success = state && core->saveState(core, state) && clone->loadState(clone, state);
+	if (state) {
+		mappedMemoryFree(state, stateSize);
+	}
+	if (!success) {
+		mCoreConfigDeinit(&clone->config);
+		clone->deinit(clone);
+		return NULL;
+	}
+	clonecore->keys = gbcore->keys;
+	cloneGb->idleLoop = gb->idleLoop;
+	cloneGb->idleOptimization = gb->idleOptimization;
+	cloneGb->idleLoopDetected = gb->idleLoopDetected;
+	return clone;
+}
+
+static size_t _GBCoreMemoryUsage(struct mCore* core) {
+	struct GBCore* gbcore = (struct GBCore*) core;
+	struct GB* gb = core->board;
+	size_t usage = sizeof(*gbcore);
+	usage += mappedMemoryResident(gb, sizeof(*gb));
+	usage += mappedMemoryResident(core->cpu, sizeof(struct SM83Core));
+	usage += mappedMemoryResident(gb->memory.wram, GB_SIZE_WORKING_RAM);
+	usage += mappedMemoryResident(gb->video.vram, GB_SIZE_VRAM);
+	if (gb->memory.rom && !gb->isPristine && !gb->romImage) {
+		usage += mappedMemoryResident(gb->memory.rom, GB_SIZE_CART_MAX);
+	}
+	if (gb->memory.sram && !gb->sramVf) {
+		usage += mappedMemoryResident(gb->memory.sram, gb->sramSize);
+	}
+	// Each sample in the output buffers is a 32-bit accumulator
+	usage += gb->audio.bufferCapacity * sizeof(int32_t) * 2;
+	if (gbcore->colorTable) {
+		usage += M_COLOR_TABLE_555_SIZE * sizeof(color_t);
+	}
+	return usage;
+}
+
+static uint64_t _GBCoreStateHash(struct mCore* core) {
+	struct GB* gb = core->board;
+	struct SM83Core* cpu = core->cpu;
+	// DIV is only brought up to date when something looks at it, as a savestate does
+	GBTimerSync(&gb->timer);
+	// Everything here is small enough that tracking written pages wouldn't pay for itself
+	uint64_t hash = hash64(&cpu->regs, sizeof(cpu->regs), 0);
+	hash = hash64(&cpu->cycles, sizeof(cpu->cycles), hash);
+	hash = hash64(gb->memory.wram, GB_SIZE_WORKING_RAM, hash);
+	hash = hash64(gb->memory.hram, sizeof(gb->memory.hram), hash);
+	hash = hash64(gb->memory.io, sizeof(gb->memory.io), hash);
+	hash = hash64(gb->video.palette, sizeof(gb->video.palette), hash);
+	hash = hash64(gb->video.oam.raw, sizeof(gb->video.oam.raw), hash);
+	hash = hash64(gb->video.vram, GB_SIZE_VRAM, hash);
+	if (gb->memory.sram) {
+		hash = hash64(gb->memory.sram, gb->sramSize, hash);
+	}
+	return hash;
+}
+
 static void _GBCoreSetKeys(struct mCore* core, uint32_t keys) {
 	struct GBCore* gbcore = (struct GBCore*) core;
 	gbcore->keys = keys;
@@ -925,6 +1312,20 @@ void* _GBGetMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
 	}
 }
 
+static bool _GBCoreSetMemoryWatcher(struct mCore* core, struct mCoreMemoryWatcher* watcher, const struct mCoreMemoryWatchRange* ranges, size_t nRanges) {
+	GBMemorySetWatcher(&((struct GB*) core->board)->memory, watcher, ranges, nRanges);
+	return true;
+}
+
+static bool _GBCoreSetMemoryStatsEnabled(struct mCore* core, bool enable) {
+	GBMemorySetStatsEnabled(core->board, enable);
+	return true;
+}
+
+static size_t _GBCoreMemoryStats(struct mCore* core, struct mCoreMemoryStats* stats, size_t max) {
+	return GBMemoryCollectStats(&((struct GB*) core->board)->memory, stats, max);
+}
+
 static size_t _GBCoreListRegisters(const struct mCore* core, const struct mCoreRegisterInfo** list) {
 	UNUSED(core);
 	*list = _GBRegisters;
@@ -1134,6 +1535,12 @@ static bool _GBCoreLookupIdentifier(struct mCore* core, const char* name, int32_
 	}
 	return false;
 }
+
+static void _GBCoreCurrentPC(struct mCore* core, uint32_t* address, int* segment) {
+	struct SM83Core* cpu = core->cpu;
+	*address = cpu->pc;
+	*segment = cpu->memory.currentSegment(cpu, cpu->pc);
+}
 #endif
 
 static struct mCheatDevice* _GBCoreCheatDevice(struct mCore* core) {
@@ -1237,14 +1644,26 @@ static void _GBCoreAdjustVideoLayer(struct mCore* core, size_t id, int32_t x, in
 	case GB_LAYER_BACKGROUND:
 		gbcore->renderer.offsetScx = x;
 		gbcore->renderer.offsetScy = y;
+#ifdef BUILD_GLES3
+		gbcore->glRenderer.offsetScx = x;
+		gbcore->glRenderer.offsetScy = y;
+#endif
 		break;
 	case GB_LAYER_WINDOW:
 		gbcore->renderer.offsetWx = x;
 		gbcore->renderer.offsetWy = y;
+#ifdef BUILD_GLES3
+		gbcore->glRenderer.offsetWx = x;
+		gbcore->glRenderer.offsetWy = y;
+#endif
 		break;
 	case GB_LAYER_OBJ:
 		gbcore->renderer.objOffsetX = x;
 		gbcore->renderer.objOffsetY = y;
+#ifdef BUILD_GLES3
+		gbcore->glRenderer.objOffsetX = x;
+		gbcore->glRenderer.objOffsetY = y;
+#endif
 		break;
 	default:
 		return;
@@ -1252,6 +1671,12 @@ static void _GBCoreAdjustVideoLayer(struct mCore* core, size_t id, int32_t x, in
 }
 
 #ifndef MINIMAL_CORE
+static void _GBCoreVideoLogFrameEnded(void* context) {
+	struct mCore* core = context;
+	struct GBCore* gbcore = (struct GBCore*) core;
+	mVideoLogContextFrameEnded(gbcore->logContext, core);
+}
+
 static void _GBCoreStartVideoLog(struct mCore* core, struct mVideoLogContext* context) {
 	struct GBCore* gbcore = (struct GBCore*) core;
 	struct GB* gb = core->board;
@@ -1265,6 +1690,11 @@ static void _GBCoreStartVideoLog(struct mCore* core, struct mVideoLogContext* co
 
 	GBVideoProxyRendererCreate(&gbcore->proxyRenderer, &gbcore->renderer.d);
 	GBVideoProxyRendererShim(&gb->video, &gbcore->proxyRenderer);
+
+	memset(&gbcore->logCallbacks, 0, sizeof(gbcore->logCallbacks));
+	gbcore->logCallbacks.videoFrameEnded = _GBCoreVideoLogFrameEnded;
+	gbcore->logCallbacks.context = core;
+	core->addCoreCallbacks(core, &gbcore->logCallbacks);
 }
 
 static void _GBCoreEndVideoLog(struct mCore* core) {
@@ -1275,6 +1705,16 @@ static void _GBCoreEndVideoLog(struct mCore* core) {
 		free(gbcore->proxyRenderer.logger);
 		gbcore->proxyRenderer.logger = NULL;
 	}
+
+	size_t i;
+	for (i = 0; i < mCoreCallbacksListSize(&gb->coreCallbacks); ++i) {
+		if (mCoreCallbacksListGetPointer(&gb->coreCallbacks, i)->videoFrameEnded == _GBCoreVideoLogFrameEnded) {
+			mCoreCallbacksListShift(&gb->coreCallbacks, i, 1);
+			break;
+		}
+	}
+	memset(&gbcore->logCallbacks, 0, sizeof(gbcore->logCallbacks));
+	gbcore->logContext = NULL;
 }
 #endif
 
@@ -1300,11 +1740,14 @@ struct mCore* GBCoreCreate(void) {
 	core->screenRegions = _GBCoreScreenRegions;
 	core->setVideoBuffer = _GBCoreSetVideoBuffer;
 	core->setVideoGLTex = _GBCoreSetVideoGLTex;
+	core->setVideoFormat = _GBCoreSetVideoFormat;
 	core->getPixels = _GBCoreGetPixels;
 	core->putPixels = _GBCorePutPixels;
+	core->getChangedScanlines = _GBCoreGetChangedScanlines;
 	core->getAudioChannel = _GBCoreGetAudioChannel;
 	core->setAudioBufferSize = _GBCoreSetAudioBufferSize;
 	core->getAudioBufferSize = _GBCoreGetAudioBufferSize;
+	core->audioSampleRate = _GBCoreAudioSampleRate;
 	core->setAVStream = _GBCoreSetAVStream;
 	core->addCoreCallbacks = _GBCoreAddCoreCallbacks;
 	core->clearCoreCallbacks = _GBCoreClearCoreCallbacks;
@@ -1321,9 +1764,16 @@ struct mCore* GBCoreCreate(void) {
 	core->runFrame = _GBCoreRunFrame;
 	core->runLoop = _GBCoreRunLoop;
 	core->step = _GBCoreStep;
+	core->skipVideoFrames = _GBCoreSkipVideoFrames;
+	core->skipAudioFrames = _GBCoreSkipAudioFrames;
 	core->stateSize = _GBCoreStateSize;
 	core->loadState = _GBCoreLoadState;
 	core->saveState = _GBCoreSaveState;
+	core->saveStateIncremental = _GBCoreSaveStateIncremental;
+	core->listStateSections = _GBCoreListStateSections;
+	core->clone = _GBCoreClone;
+	core->memoryUsage = _GBCoreMemoryUsage;
+	core->stateHash = _GBCoreStateHash;
 	core->setKeys = _GBCoreSetKeys;
 	core->addKeys = _GBCoreAddKeys;
 	core->clearKeys = _GBCoreClearKeys;
@@ -1349,6 +1799,9 @@ struct mCore* GBCoreCreate(void) {
 	core->rawWrite32 = _GBCoreRawWrite32;
 	core->listMemoryBlocks = _GBListMemoryBlocks;
 	core->getMemoryBlock = _GBGetMemoryBlock;
+	core->setMemoryWatcher = _GBCoreSetMemoryWatcher;
+	core->setMemoryStatsEnabled = _GBCoreSetMemoryStatsEnabled;
+	core->memoryStats = _GBCoreMemoryStats;
 	core->listRegisters = _GBCoreListRegisters;
 	core->readRegister = _GBCoreReadRegister;
 	core->writeRegister = _GBCoreWriteRegister;
@@ -1360,6 +1813,7 @@ struct mCore* GBCoreCreate(void) {
 	core->detachDebugger = _GBCoreDetachDebugger;
 	core->loadSymbols = _GBCoreLoadSymbols;
 	core->lookupIdentifier = _GBCoreLookupIdentifier;
+	core->currentPC = _GBCoreCurrentPC;
 #endif
 	core->cheatDevice = _GBCoreCheatDevice;
 	core->savedataClone = _GBCoreSavedataClone;
@@ -1450,7 +1904,7 @@ static bool _GBVLPLoadState(struct mCore* core, const void* buffer) {
 	struct GB* gb = (struct GB*) core->board;
 	const struct GBSerializedState* state = buffer;
 
-	gb->timing.root = NULL;
+	mTimingDescheduleAll(&gb->timing);
 	gb->model = state->model;
 
 	gb->cpu->pc = GB_BASE_HRAM;
@@ -163,8 +163,11 @@ static bool _parsePacket(struct mVideoLogger* logger, const struct mVideoLoggerD
 		}
 		break;
 	case DIRTY_VRAM:
-		if (item->address <= GB_SIZE_VRAM - 0x1000) {
-			logger->readData(logger, &logger->vram[item->address >> 1], 0x1000, true);
+		if (item->value > 0x1000) {
+			return false;
+		}
+		if (item->address <= GB_SIZE_VRAM - item->value) {
+			logger->readData(logger, &logger->vram[item->address >> 1], item->value, true);
 			proxyRenderer->backend->writeVRAM(proxyRenderer->backend, item->address);
 		}
 		break;
@@ -8,10 +8,13 @@
 #include <mgba/internal/defines.h>
 #include <mgba/internal/gb/io.h>
 #include <mgba/internal/gb/mbc.h>
+#include <mgba/internal/gb/overrides.h>
 #include <mgba/internal/sm83/sm83.h>
 
 #include <mgba/core/core.h>
 #include <mgba/core/cheats.h>
+#include <mgba/core/rom-image.h>
+#include <mgba/core/sync.h>
 #include <mgba-util/crc32.h>
 #include <mgba-util/memory.h>
 #include <mgba-util/math.h>
@@ -78,6 +81,8 @@ static void GBInit(void* cpu, struct mCPUComponent* component) {
 
 	gb->biosVf = NULL;
 	gb->romVf = NULL;
+	gb->romRegistry = NULL;
+	gb->romImage = NULL;
 	gb->sramVf = NULL;
 	gb->sramRealVf = NULL;
 
@@ -87,6 +92,10 @@ static void GBInit(void* cpu, struct mCPUComponent* component) {
 
 	memset(&gb->gbx, 0, sizeof(gb->gbx));
 
+	gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+	gb->idleLoop = GB_IDLE_LOOP_NONE;
+	gb->idleLoopDetected = false;
+
 	mCoreCallbacksListInit(&gb->coreCallbacks, 0);
 	gb->stream = NULL;
 
@@ -186,6 +195,16 @@ bool GBLoadROM(struct GB* gb, struct VFile* vf) {
 	gb->yankedRomSize = 0;
 	gb->memory.romSize = gb->pristineRomSize;
 	gb->romCrc32 = doCrc32(gb->memory.rom, gb->memory.romSize);
+#ifndef FIXED_ROM_BUFFER
+	if (gb->romRegistry) {
+		struct mROMImage* image = mROMImageRegistryAcquire(gb->romRegistry, gb->memory.rom, gb->pristineRomSize, GB_SIZE_CART_MAX, gb->romCrc32);
+		if (image) {
+			vf->unmap(vf, gb->memory.rom, gb->pristineRomSize);
+			gb->memory.rom = image->memory.data;
+			gb->romImage = image;
+		}
+	}
+#endif
 	GBMBCReset(gb);
 
 	if (gb->cpu) {
@@ -200,6 +219,56 @@ bool GBLoadROM(struct GB* gb, struct VFile* vf) {
 	return true;
 }
 
+bool GBCloneROM(struct GB* gb, const struct GB* source) {
+	GBUnloadROM(gb);
+	if (!source->memory.rom) {
+		return true;
+	}
+#ifdef FIXED_ROM_BUFFER
+	// There's only the one ROM buffer to go around
+	return false;
+#else
+	size_t size = source->yankedRomSize ? source->yankedRomSize : source->memory.romSize;
+	if (source->romImage && source->isPristine) {
+		mROMImageRetain(source->romImage);
+		gb->romImage = source->romImage;
+		gb->memory.rom = source->memory.rom;
+		gb->isPristine = true;
+	} else {
+		void* rom = NULL;
+		if (source->romImage) {
+			rom = mROMImageMapPrivateCopy(source->romImage, source->memory.rom, size);
+			if (rom) {
+				mROMImageRetain(source->romImage);
+				gb->romImage = source->romImage;
+			}
+		}
+		if (!rom) {
+			rom = anonymousMemoryMap(GB_SIZE_CART_MAX);
+			memcpy(rom, source->memory.rom, size);
+		}
+		gb->memory.rom = rom;
+		gb->isPristine = false;
+	}
+	gb->gbx = source->gbx;
+	gb->pristineRomSize = source->pristineRomSize;
+	gb->yankedRomSize = source->yankedRomSize;
+	gb->yankedMbc = source->yankedMbc;
+	gb->memory.romSize = source->memory.romSize;
+	gb->romCrc32 = source->romCrc32;
+	GBMBCReset(gb);
+
+	if (gb->cpu) {
+		struct SM83Core* cpu = gb->cpu;
+		if (!gb->memory.romBase) {
+			GBMBCSwitchBank0(gb, 0);
+		}
+		cpu->memory.setActiveRegion(cpu, cpu->pc);
+	}
+	return true;
+#endif
+}
+
 void GBYankROM(struct GB* gb) {
 	gb->yankedRomSize = gb->memory.romSize;
 	gb->yankedMbc = gb->memory.mbcType;
@@ -396,6 +465,15 @@ void GBUnloadROM(struct GB* gb) {
 	if (romBase >= 0 && ((size_t) romBase < gb->memory.romSize || (size_t) romBase < gb->yankedRomSize)) {
 		gb->memory.romBase = NULL;
 	}
+	if (gb->romImage) {
+		if (gb->memory.rom && !gb->isPristine) {
+			mROMImageUnmapPrivate(gb->romImage, gb->memory.rom);
+		}
+		mROMImageRelease(gb->romImage);
+		gb->romImage = NULL;
+		gb->memory.rom = NULL;
+		gb->yankedRomSize = 0;
+	}
 	if (gb->memory.rom && !gb->isPristine) {
 		if (gb->yankedRomSize) {
 			gb->yankedRomSize = 0;
@@ -415,6 +493,9 @@ void GBUnloadROM(struct GB* gb) {
 	gb->memory.rom = NULL;
 	gb->memory.mbcType = GB_MBC_AUTODETECT;
 	gb->isPristine = false;
+	gb->idleLoop = GB_IDLE_LOOP_NONE;
+	gb->idleLoopDetected = false;
+	GBMemoryUpdatePages(&gb->memory);
 
 	if (!gb->sramDirty) {
 		gb->sramMaskWriteback = false;
@@ -458,15 +539,44 @@ void GBApplyPatch(struct GB* gb, struct Patch* patch) {
 
 	const struct GBCartridge* cart = (const struct GBCartridge*) &gb->memory.rom[0x100];
 	uint8_t type = cart->type;
-	void* newRom = anonymousMemoryMap(GB_SIZE_CART_MAX);
-	if (!patch->applyPatch(patch, gb->memory.rom, gb->pristineRomSize, newRom, patchedSize)) {
-		mappedMemoryFree(newRom, GB_SIZE_CART_MAX);
+	void* newRom = NULL;
+	bool inPlace = false;
+#ifndef FIXED_ROM_BUFFER
+	if (gb->romImage && gb->isPristine && patch->inPlace) {
+		// Only the pages the patch actually changes stop being shared
+		newRom = mROMImageMapPrivate(gb->romImage);
+		inPlace = newRom;
+	}
+#endif
+	if (!newRom) {
+		newRom = anonymousMemoryMap(GB_SIZE_CART_MAX);
+	}
+	if (!patch->applyPatch(patch, inPlace ? newRom : gb->memory.rom, gb->pristineRomSize, newRom, patchedSize)) {
+		if (inPlace) {
+			mROMImageUnmapPrivate(gb->romImage, newRom);
+		} else {
+			mappedMemoryFree(newRom, GB_SIZE_CART_MAX);
+		}
 		return;
 	}
-	if (gb->romVf) {
+	if (gb->romImage) {
+		if (!gb->isPristine) {
+			mROMImageUnmapPrivate(gb->romImage, gb->memory.rom);
+		}
+		if (!inPlace) {
+			mROMImageRelease(gb->romImage);
+			gb->romImage = NULL;
+		}
+	} else if (gb->isPristine) {
 #ifndef FIXED_ROM_BUFFER
-		gb->romVf->unmap(gb->romVf, gb->memory.rom, gb->pristineRomSize);
+		if (gb->romVf) {
+			gb->romVf->unmap(gb->romVf, gb->memory.rom, gb->pristineRomSize);
+		}
 #endif
+	} else {
+		mappedMemoryFree(gb->memory.rom, GB_SIZE_CART_MAX);
+	}
+	if (gb->romVf) {
 		gb->romVf->close(gb->romVf);
 		gb->romVf = NULL;
 	}
@@ -483,6 +593,7 @@ void GBApplyPatch(struct GB* gb, struct Patch* patch) {
 		GBMBCInit(gb);
 	}
 	gb->romCrc32 = doCrc32(gb->memory.rom, gb->memory.romSize);
+	GBMemoryUpdatePages(&gb->memory);
 	gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 }
 
@@ -570,6 +681,10 @@ void GBReset(struct SM83Core* cpu) {
 	gb->earlyExit = false;
 	gb->doubleSpeed = 0;
 
+	gb->lastJump = GB_IDLE_LOOP_NONE;
+	gb->idleDetectionStep = 0;
+	gb->idleDetectionFailures = 0;
+
 	if (gb->yankedRomSize) {
 		gb->memory.romSize = gb->yankedRomSize;
 		gb->memory.mbcType = gb->yankedMbc;
@@ -806,6 +921,7 @@ void GBMapBIOS(struct GB* gb) {
 			memcpy(&gb->memory.romBase[0x100], &gb->memory.rom[0x100], 0x100);
 		}
 	}
+	GBMemoryUpdatePages(&gb->memory);
 }
 
 void GBUnmapBIOS(struct GB* gb) {
@@ -1017,8 +1133,11 @@ void GBHalt(struct SM83Core* cpu) {
 void GBStop(struct SM83Core* cpu) {
 	struct GB* gb = (struct GB*) cpu->master;
 	if (gb->model >= GB_MODEL_CGB && gb->memory.io[GB_REG_KEY1] & 1) {
+		// The timer's next event was scheduled for the old speed
+		GBTimerSync(&gb->timer);
 		gb->doubleSpeed ^= 1;
 		gb->cpu->tMultiplier = 2 - gb->doubleSpeed;
+		GBTimerReschedule(&gb->timer);
 		gb->memory.io[GB_REG_KEY1] = 0;
 		gb->memory.io[GB_REG_KEY1] |= gb->doubleSpeed << 7;
 	} else {
@@ -1035,6 +1154,13 @@ void GBStop(struct SM83Core* cpu) {
 	}
 }
 
+void GBSetSlim(struct GB* gb, bool slim) {
+	gb->slim = slim;
+	mCoreSyncLockAudio(gb->sync);
+	GBAudioSetBufferCapacity(&gb->audio, slim ? GB_AUDIO_BUFFER_CAPACITY_SLIM : GB_AUDIO_BUFFER_CAPACITY);
+	mCoreSyncConsumeAudio(gb->sync);
+}
+
 void GBIllegal(struct SM83Core* cpu) {
 	struct GB* gb = (struct GB*) cpu->master;
 	mLOG(GB, GAME_ERROR, "Hit illegal opcode at address %04X:%02X", cpu->pc, cpu->bus);
@@ -1156,12 +1282,15 @@ void GBFrameEnded(struct GB* gb) {
 	}
 
 	// TODO: Move to common code
-	if (gb->stream && gb->stream->postVideoFrame) {
+	if (gb->stream && gb->stream->postVideoFrame && !gb->video.skipFrames) {
 		const color_t* pixels;
 		size_t stride;
 		gb->video.renderer->getPixels(gb->video.renderer, &stride, (const void**) &pixels);
 		gb->stream->postVideoFrame(gb->stream, pixels, stride);
 	}
+	if (gb->audio.outputSkipFrames) {
+		--gb->audio.outputSkipFrames;
+	}
 
 	size_t c;
 	for (c = 0; c < mCoreCallbacksListSize(&gb->coreCallbacks); ++c) {
@@ -390,16 +390,21 @@ void GBIOWrite(struct GB* gb, unsigned address, uint8_t value) {
 		}
 		return;
 	case GB_REG_TIMA:
+		GBTimerSync(&gb->timer);
 		if (value && mTimingUntil(&gb->timing, &gb->timer.irq) > 2 - (int) gb->doubleSpeed) {
 			mTimingDeschedule(&gb->timing, &gb->timer.irq);
 		}
 		if (mTimingUntil(&gb->timing, &gb->timer.irq) == (int) gb->doubleSpeed - 2) {
 			return;
 		}
-		break;
+		gb->memory.io[GB_REG_TIMA] = value;
+		GBTimerReschedule(&gb->timer);
+		return;
 	case GB_REG_TMA:
 		if (mTimingUntil(&gb->timing, &gb->timer.irq) == (int) gb->doubleSpeed - 2) {
+			GBTimerSync(&gb->timer);
 			gb->memory.io[GB_REG_TIMA] = value;
+			GBTimerReschedule(&gb->timer);
 		}
 		break;
 	case GB_REG_TAC:
@@ -606,6 +611,13 @@ uint8_t GBIORead(struct GB* gb, unsigned address) {
 			return (gb->audio.ch3.sample) | (gb->audio.ch4.sample << 4);
 		}
 		break;
+	case GB_REG_STAT:
+		GBVideoSyncMode(&gb->video, 0);
+		break;
+	case GB_REG_DIV:
+	case GB_REG_TIMA:
+		GBTimerSync(&gb->timer);
+		break;
 	case GB_REG_SB:
 	case GB_REG_SC:
 	case GB_REG_IF:
@@ -626,11 +638,8 @@ uint8_t GBIORead(struct GB* gb, unsigned address) {
 	case GB_REG_NR50:
 	case GB_REG_NR51:
 	case GB_REG_NR52:
-	case GB_REG_DIV:
-	case GB_REG_TIMA:
 	case GB_REG_TMA:
 	case GB_REG_TAC:
-	case GB_REG_STAT:
 	case GB_REG_LCDC:
 	case GB_REG_SCY:
 	case GB_REG_SCX:
@@ -32,6 +32,7 @@ void GBMBCSwitchBank(struct GB* gb, int bank) {
 	}
 	gb->memory.romBank = &gb->memory.rom[bankStart];
 	gb->memory.currentBank = bank;
+	GBMemoryUpdatePages(&gb->memory);
 	if (gb->cpu->pc < GB_BASE_VRAM) {
 		gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 	}
@@ -45,6 +46,7 @@ void GBMBCSwitchBank0(struct GB* gb, int bank) {
 	}
 	gb->memory.romBase = &gb->memory.rom[bankStart];
 	gb->memory.currentBank0 = bank;
+	GBMemoryUpdatePages(&gb->memory);
 	if (gb->cpu->pc < GB_SIZE_CART_BANK0) {
 		gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 	}
@@ -88,6 +90,7 @@ void GBMBCSwitchHalfBank(struct GB* gb, int half, int bank) {
 		}
 		gb->memory.currentBank1 = bank;
 	}
+	GBMemoryUpdatePages(&gb->memory);
 	if (gb->cpu->pc < GB_BASE_VRAM) {
 		gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
 	}
@@ -532,6 +535,7 @@ void GBMBCInit(struct GB* gb) {
 	} else if (gb->memory.mbcType == GB_TAMA5) {
 		GBMBCTAMA5Read(gb);
 	}
+	GBMemoryUpdatePages(&gb->memory);
 }
 
 void GBMBCReset(struct GB* gb) {
@@ -562,6 +566,7 @@ void GBMBCReset(struct GB* gb) {
 		break;
 	}
 	gb->memory.sramBank = gb->memory.sram;
+	GBMemoryUpdatePages(&gb->memory);
 }
 
 void _GBMBCAppendSaveSuffix(struct GB* gb, const void* buffer, size_t size) {
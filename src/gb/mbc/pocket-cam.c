@@ -72,6 +72,58 @@ uint8_t _GBPocketCamRead(struct GBMemory* memory, uint16_t address) {
 	return memory->sramBank[address & (GB_SIZE_EXTERNAL_RAM - 1)];
 }
 
+static bool _GBPocketCamConvertRow(const void* row, enum mColorFormat format, uint32_t* gray) {
+	const uint32_t* row32 = row;
+	const uint16_t* row16 = row;
+	size_t x;
+	switch (format) {
+	case mCOLOR_XBGR8:
+	case mCOLOR_XRGB8:
+	case mCOLOR_ARGB8:
+	case mCOLOR_ABGR8:
+		for (x = 0; x < GBCAM_WIDTH; ++x) {
+			uint32_t color = row32[x];
+			gray[x] = (color & 0xFF) + ((color >> 8) & 0xFF) + ((color >> 16) & 0xFF);
+		}
+		break;
+	case mCOLOR_BGRX8:
+	case mCOLOR_RGBX8:
+	case mCOLOR_RGBA8:
+	case mCOLOR_BGRA8:
+		for (x = 0; x < GBCAM_WIDTH; ++x) {
+			uint32_t color = row32[x];
+			gray[x] = ((color >> 8) & 0xFF) + ((color >> 16) & 0xFF) + ((color >> 24) & 0xFF);
+		}
+		break;
+	case mCOLOR_BGR5:
+	case mCOLOR_RGB5:
+	case mCOLOR_ARGB5:
+	case mCOLOR_ABGR5:
+		for (x = 0; x < GBCAM_WIDTH; ++x) {
+			uint32_t color = row16[x];
+			gray[x] = ((color << 3) & 0xF8) + ((color >> 2) & 0xF8) + ((color >> 7) & 0xF8);
+		}
+		break;
+	case mCOLOR_BGR565:
+	case mCOLOR_RGB565:
+		for (x = 0; x < GBCAM_WIDTH; ++x) {
+			uint32_t color = row16[x];
+			gray[x] = ((color << 3) & 0xF8) + ((color >> 3) & 0xFC) + ((color >> 8) & 0xF8);
+		}
+		break;
+	case mCOLOR_BGRA5:
+	case mCOLOR_RGBA5:
+		for (x = 0; x < GBCAM_WIDTH; ++x) {
+			uint32_t color = row16[x];
+			gray[x] = ((color << 2) & 0xF8) + ((color >> 3) & 0xF8) + ((color >> 8) & 0xF8);
+		}
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
 void _GBPocketCamCapture(struct GBMemory* memory) {
 	if (!memory->cam) {
 		return;
@@ -83,67 +135,41 @@ void _GBPocketCamCapture(struct GBMemory* memory) {
 	if (!image) {
 		return;
 	}
-	memset(&memory->sram[0x100], 0, GBCAM_HEIGHT * GBCAM_WIDTH / 4);
 	struct GBPocketCamState* pocketCam = &memory->mbcState.pocketCam;
+	size_t bytesPerPixel = mColorFormatBytes(format);
+	uint32_t exposure = (pocketCam->registers[2] << 8) | (pocketCam->registers[3]);
+	uint32_t gray[GBCAM_WIDTH];
 	size_t x, y;
 	for (y = 0; y < GBCAM_HEIGHT; ++y) {
-		for (x = 0; x < GBCAM_WIDTH; ++x) {
-			uint32_t gray;
-			uint32_t color;
-			switch (format) {
-			case mCOLOR_XBGR8:
-			case mCOLOR_XRGB8:
-			case mCOLOR_ARGB8:
-			case mCOLOR_ABGR8:
-				color = ((const uint32_t*) image)[y * stride + x];
-				gray = (color & 0xFF) + ((color >> 8) & 0xFF) + ((color >> 16) & 0xFF);
-				break;
-			case mCOLOR_BGRX8:
-			case mCOLOR_RGBX8:
-			case mCOLOR_RGBA8:
-			case mCOLOR_BGRA8:
-				color = ((const uint32_t*) image)[y * stride + x];
-				gray = ((color >> 8) & 0xFF) + ((color >> 16) & 0xFF) + ((color >> 24) & 0xFF);
-				break;
-			case mCOLOR_BGR5:
-			case mCOLOR_RGB5:
-			case mCOLOR_ARGB5:
-			case mCOLOR_ABGR5:
-				color = ((const uint16_t*) image)[y * stride + x];
-				gray = ((color << 3) & 0xF8) + ((color >> 2) & 0xF8) + ((color >> 7) & 0xF8);
-				break;
-			case mCOLOR_BGR565:
-			case mCOLOR_RGB565:
-				color = ((const uint16_t*) image)[y * stride + x];
-				gray = ((color << 3) & 0xF8) + ((color >> 3) & 0xFC) + ((color >> 8) & 0xF8);
-				break;
-			case mCOLOR_BGRA5:
-			case mCOLOR_RGBA5:
-				color = ((const uint16_t*) image)[y * stride + x];
-				gray = ((color << 2) & 0xF8) + ((color >> 3) & 0xF8) + ((color >> 8) & 0xF8);
-				break;
-			default:
-				mLOG(GB_MBC, WARN, "Unsupported pixel format: %X", format);
-				return;
-			}
-			uint16_t exposure = (pocketCam->registers[2] << 8) | (pocketCam->registers[3]);
-			gray = (gray + 1) * exposure / 0x300;
-			// TODO: Additional processing
-			int matrixEntry = 3 * ((x & 3) + 4 * (y & 3));
-			if (gray < pocketCam->registers[matrixEntry + 6]) {
-				gray = 0x101;
-			} else if (gray < pocketCam->registers[matrixEntry + 7]) {
-				gray = 0x100;
-			} else if (gray < pocketCam->registers[matrixEntry + 8]) {
-				gray = 0x001;
-			} else {
-				gray = 0;
+		// Convert a whole row at once so the format is only looked at once per row
+		if (!_GBPocketCamConvertRow((const uint8_t*) image + y * stride * bytesPerPixel, format, gray)) {
+			memset(&memory->sram[0x100], 0, GBCAM_HEIGHT * GBCAM_WIDTH / 4);
+			mLOG(GB_MBC, WARN, "Unsupported pixel format: %X", format);
+			return;
+		}
+		const uint8_t* matrix = &pocketCam->registers[6 + 12 * (y & 3)];
+		uint8_t* tileRow = &memory->sram[0x100 + (y & 7) * 2 + (y & ~7) * 0x20];
+		for (x = 0; x < GBCAM_WIDTH; x += 8) {
+			// Each run of 8 pixels becomes one row of a tile, so both bitplanes can be written in one go
+			unsigned lo = 0;
+			unsigned hi = 0;
+			size_t i;
+			for (i = 0; i < 8; ++i) {
+				uint32_t value = (gray[x + i] + 1) * exposure / 0x300;
+				// TODO: Additional processing
+				const uint8_t* thresholds = &matrix[3 * (i & 3)];
+				unsigned bit = 0x80 >> i;
+				if (value < thresholds[0]) {
+					lo |= bit;
+					hi |= bit;
+				} else if (value < thresholds[1]) {
+					hi |= bit;
+				} else if (value < thresholds[2]) {
+					lo |= bit;
+				}
 			}
-			int coord = (((x >> 3) & 0xF) * 8 + (y & 0x7)) * 2 + (y & ~0x7) * 0x20;
-			uint16_t existing;
-			LOAD_16LE(existing, coord + 0x100, memory->sram);
-			existing |= gray << (7 - (x & 7));
-			STORE_16LE(existing, coord + 0x100, memory->sram);
+			tileRow[x * 2] = lo;
+			tileRow[x * 2 + 1] = hi;
 		}
 	}
 }
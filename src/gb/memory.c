@@ -6,10 +6,13 @@
 #include <mgba/internal/gb/memory.h>
 
 #include <mgba/core/interface.h>
+#include <mgba/core/perf.h>
+#include <mgba/core/rom-image.h>
 #include <mgba/internal/defines.h>
 #include <mgba/internal/gb/gb.h>
 #include <mgba/internal/gb/io.h>
 #include <mgba/internal/gb/mbc.h>
+#include <mgba/internal/gb/overrides.h>
 #include <mgba/internal/gb/serialize.h>
 #include <mgba/internal/sm83/sm83.h>
 
@@ -51,6 +54,29 @@ static const enum GBBus _oamBlockCGB[] = {
 
 static const uint8_t _blockedRegion[1] = { 0xFF };
 
+static const struct mCoreMemoryStats _statsRegions[] = {
+	{ "cart0", GB_BASE_CART_BANK0, GB_BASE_CART_BANK1 },
+	{ "cart1", GB_BASE_CART_BANK1, GB_BASE_VRAM },
+	{ "vram", GB_BASE_VRAM, GB_BASE_EXTERNAL_RAM },
+	{ "sram", GB_BASE_EXTERNAL_RAM, GB_BASE_WORKING_RAM_BANK0 },
+	{ "wram0", GB_BASE_WORKING_RAM_BANK0, GB_BASE_WORKING_RAM_BANK1 },
+	{ "wram1", GB_BASE_WORKING_RAM_BANK1, 0xE000 },
+	{ "echo", 0xE000, GB_BASE_OAM },
+	{ "oam", GB_BASE_OAM, GB_BASE_UNUSABLE },
+	{ "unusable", GB_BASE_UNUSABLE, GB_BASE_IO },
+	{ "io", GB_BASE_IO, GB_BASE_HRAM },
+	{ "hram", GB_BASE_HRAM, GB_BASE_IE },
+	{ "ie", GB_BASE_IE, 0x10000 },
+};
+
+// Maps the top nybble of addresses below OAM to an entry in _statsRegions
+static const uint8_t _statsRegionIndex[16] = {
+	0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 4, 5, 6, 6
+};
+
+#define IDLE_LOOP_THRESHOLD 10000
+#define IDLE_LOOP_MAX_SIZE 16
+
 static void _pristineCow(struct GB* gba);
 
 static uint8_t GBCartLoad8(struct SM83Core* cpu, uint16_t address) {
@@ -66,6 +92,161 @@ static uint8_t GBCartLoad8(struct SM83Core* cpu, uint16_t address) {
 	return value;
 }
 
+static bool _isIdleRegister(uint16_t address) {
+	// These only change from timing events, so nothing is missed by skipping to the next one
+	switch (address) {
+	case GB_BASE_IO | GB_REG_IF:
+	case GB_BASE_IO | GB_REG_STAT:
+	case GB_BASE_IO | GB_REG_LY:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static uint32_t _idleLoopKey(const struct GBMemory* memory, uint16_t address) {
+	if (address < GB_BASE_CART_BANK1) {
+		return (memory->currentBank0 << 16) | address;
+	}
+	return (memory->currentBank << 16) | address;
+}
+
+static bool _isIdleLoop(struct SM83Core* cpu, uint16_t address) {
+	if (cpu->memory.cpuLoad8 != GBCartLoad8 || cpu->memory.activeRegion == _blockedRegion) {
+		return false;
+	}
+	// The loop may only read a polled register into A, test it and branch back. Every iteration
+	// then leaves A and F the same until that register changes.
+	bool loaded = false;
+	uint16_t nextAddress = address;
+	while (nextAddress - address < IDLE_LOOP_MAX_SIZE && nextAddress + 3 <= cpu->memory.activeRegionEnd) {
+		const uint8_t* op = &cpu->memory.activeRegion[nextAddress & cpu->memory.activeMask];
+		uint16_t target;
+		switch (op[0]) {
+		case 0xF0: // LDH A, [n]
+			if (!_isIdleRegister(GB_BASE_IO | op[1])) {
+				return false;
+			}
+			loaded = true;
+			nextAddress += 2;
+			continue;
+		case 0xFA: // LD A, [nn]
+			if (!_isIdleRegister(op[1] | (op[2] << 8))) {
+				return false;
+			}
+			loaded = true;
+			nextAddress += 3;
+			continue;
+		case 0xF2: // LD A, [C]
+			if (!_isIdleRegister(GB_BASE_IO | cpu->c)) {
+				return false;
+			}
+			loaded = true;
+			++nextAddress;
+			continue;
+		case 0x7E: // LD A, [HL]
+			if (!_isIdleRegister(cpu->hl)) {
+				return false;
+			}
+			loaded = true;
+			++nextAddress;
+			continue;
+		case 0xA7: // AND A
+		case 0xB7: // OR A
+			++nextAddress;
+			continue;
+		case 0xFE: // CP n
+			nextAddress += 2;
+			continue;
+		case 0xE6: // AND n
+		case 0xEE: // XOR n
+		case 0xF6: // OR n
+			if (!loaded) {
+				return false;
+			}
+			nextAddress += 2;
+			continue;
+		case 0xCB:
+			if ((op[1] & 0xC7) == 0x47) { // BIT b, A
+				nextAddress += 2;
+				continue;
+			}
+			if ((op[1] & 0xC7) == 0x46 && _isIdleRegister(cpu->hl)) { // BIT b, [HL]
+				nextAddress += 2;
+				continue;
+			}
+			return false;
+		case 0x18: // JR
+		case 0x20: // JR NZ
+		case 0x28: // JR Z
+		case 0x30: // JR NC
+		case 0x38: // JR C
+			target = nextAddress + 2 + (int8_t) op[1];
+			return target == address;
+		case 0xC2: // JP NZ
+		case 0xC3: // JP
+		case 0xCA: // JP Z
+		case 0xD2: // JP NC
+		case 0xDA: // JP C
+			target = op[1] | (op[2] << 8);
+			return target == address;
+		default:
+			return false;
+		}
+	}
+	return false;
+}
+
+static void _analyzeForIdleLoop(struct GB* gb, struct SM83Core* cpu, uint16_t address, uint32_t key) {
+	gb->idleDetectionStep = -1;
+	if (_isIdleLoop(cpu, address)) {
+		gb->idleLoop = key;
+		gb->idleLoopDetected = true;
+		gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+		return;
+	}
+	++gb->idleDetectionFailures;
+	if (gb->idleDetectionFailures > IDLE_LOOP_THRESHOLD) {
+		gb->idleOptimization = GB_IDLE_LOOP_IGNORE;
+	}
+}
+
+static void _skipIdleLoop(struct SM83Core* cpu) {
+	if (cpu->irqPending) {
+		return;
+	}
+	// Skip whole M-cycles so the execution state stays in phase with the timing
+	int32_t mCycle = 4 * cpu->tMultiplier;
+	int32_t skip = (cpu->nextEvent - cpu->cycles) / mCycle * mCycle;
+	if (skip > 0) {
+		cpu->cycles += skip;
+	}
+}
+
+static void _checkIdleLoop(struct GB* gb, struct SM83Core* cpu, uint16_t address) {
+	// The boot ROM shares addresses with the cartridge, so nothing is done until it's unmapped
+	if (address >= GB_BASE_VRAM || gb->memory.io[GB_REG_BANK] == 0xFF) {
+		return;
+	}
+	uint32_t key = _idleLoopKey(&gb->memory, address);
+	if (key == GB_IDLE_LOOP_NONE) {
+		return;
+	}
+	if (key == gb->idleLoop) {
+		// Registers the detector relied on may have changed since, but overrides are taken on faith
+		if (!gb->idleLoopDetected || _isIdleLoop(cpu, address)) {
+			_skipIdleLoop(cpu);
+		}
+	} else if (gb->idleOptimization >= GB_IDLE_LOOP_DETECT) {
+		if (key != gb->lastJump) {
+			gb->idleDetectionStep = 0;
+		} else if (gb->idleDetectionStep == 0) {
+			_analyzeForIdleLoop(gb, cpu, address, key);
+		}
+	}
+	gb->lastJump = key;
+}
+
 static void GBSetActiveRegion(struct SM83Core* cpu, uint16_t address) {
 	struct GB* gb = (struct GB*) cpu->master;
 	struct GBMemory* memory = &gb->memory;
@@ -74,7 +255,7 @@ static void GBSetActiveRegion(struct SM83Core* cpu, uint16_t address) {
 	case GB_REGION_CART_BANK0 + 1:
 	case GB_REGION_CART_BANK0 + 2:
 	case GB_REGION_CART_BANK0 + 3:
-		if (gb->memory.mbcReadBank0) {
+		if (gb->memory.mbcReadBank0 || UNLIKELY(memory->stats)) {
 			cpu->memory.cpuLoad8 = GBLoad8;
 			break;
 		}
@@ -95,7 +276,7 @@ static void GBSetActiveRegion(struct SM83Core* cpu, uint16_t address) {
 	case GB_REGION_CART_BANK1 + 1:
 	case GB_REGION_CART_BANK1 + 2:
 	case GB_REGION_CART_BANK1 + 3:
-		if (gb->memory.mbcReadBank1) {
+		if (gb->memory.mbcReadBank1 || UNLIKELY(memory->stats)) {
 			cpu->memory.cpuLoad8 = GBLoad8;
 			break;
 		}
@@ -136,6 +317,9 @@ static void GBSetActiveRegion(struct SM83Core* cpu, uint16_t address) {
 			cpu->memory.activeMask = 0;
 		}
 	}
+	if (gb->idleOptimization >= GB_IDLE_LOOP_REMOVE) {
+		_checkIdleLoop(gb, cpu, address);
+	}
 }
 
 static void _GBMemoryDMAService(struct mTiming* timing, void* context, uint32_t cyclesLate);
@@ -163,6 +347,12 @@ void GBMemoryInit(struct GB* gb) {
 	gb->memory.rotation = NULL;
 	gb->memory.rumble = NULL;
 	gb->memory.cam = NULL;
+	gb->memory.watcher = NULL;
+	gb->memory.watchRanges = NULL;
+	gb->memory.nWatchRanges = 0;
+	memset(gb->memory.watchedPages, 0, sizeof(gb->memory.watchedPages));
+	gb->memory.stats = NULL;
+	GBMemoryUpdatePages(&gb->memory);
 
 	GBIOInit(gb);
 }
@@ -172,6 +362,8 @@ void GBMemoryDeinit(struct GB* gb) {
 	if (gb->memory.rom) {
 		mappedMemoryFree(gb->memory.rom, gb->memory.romSize);
 	}
+	free(gb->memory.watchRanges);
+	free(gb->memory.stats);
 }
 
 void GBMemoryReset(struct GB* gb) {
@@ -227,6 +419,144 @@ void GBMemorySwitchWramBank(struct GBMemory* memory, int bank) {
 	}
 	memory->wramBank = &memory->wram[GB_SIZE_WORKING_RAM_BANK0 * bank];
 	memory->wramCurrentBank = bank;
+	GBMemoryUpdatePages(memory);
+}
+
+static uint16_t _watchAddress(uint16_t address) {
+	// Echo RAM is kept in terms of the WRAM it mirrors
+	if (address >= 0xE000 && address < GB_BASE_OAM) {
+		return address - 0x2000;
+	}
+	return address;
+}
+
+static bool _isWatched(const struct GBMemory* memory, uint16_t address) {
+	unsigned page = address >> GB_PAGE_SHIFT;
+	return memory->watchedPages[page >> 5] & (1U << (page & 0x1F));
+}
+
+static void _reportStore(struct GBMemory* memory, uint16_t address, uint8_t value) {
+	address = _watchAddress(address);
+	if (!_isWatched(memory, address)) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < memory->nWatchRanges; ++i) {
+		const struct mCoreMemoryWatchRange* range = &memory->watchRanges[i];
+		if (address >= range->start && address < range->end) {
+			memory->watcher->written(memory->watcher, address, 1, value);
+			return;
+		}
+	}
+}
+
+void GBMemorySetWatcher(struct GBMemory* memory, struct mCoreMemoryWatcher* watcher, const struct mCoreMemoryWatchRange* ranges, size_t nRanges) {
+	free(memory->watchRanges);
+	memory->watchRanges = NULL;
+	memory->nWatchRanges = 0;
+	memset(memory->watchedPages, 0, sizeof(memory->watchedPages));
+	memory->watcher = watcher;
+	if (watcher && nRanges) {
+		memory->watchRanges = malloc(nRanges * sizeof(*ranges));
+		memcpy(memory->watchRanges, ranges, nRanges * sizeof(*ranges));
+		memory->nWatchRanges = nRanges;
+		size_t i;
+		for (i = 0; i < nRanges; ++i) {
+			if (ranges[i].end <= ranges[i].start) {
+				continue;
+			}
+			unsigned page = ranges[i].start >> GB_PAGE_SHIFT;
+			unsigned lastPage = (ranges[i].end - 1) >> GB_PAGE_SHIFT;
+			for (; page <= lastPage && page < GB_PAGES; ++page) {
+				memory->watchedPages[page >> 5] |= 1U << (page & 0x1F);
+			}
+		}
+	} else {
+		memory->watcher = NULL;
+	}
+	GBMemoryUpdatePages(memory);
+}
+
+void GBMemorySetStatsEnabled(struct GB* gb, bool enable) {
+	struct GBMemory* memory = &gb->memory;
+	free(memory->stats);
+	memory->stats = NULL;
+	if (enable) {
+		memory->stats = malloc(sizeof(_statsRegions));
+		memcpy(memory->stats, _statsRegions, sizeof(_statsRegions));
+	}
+	GBMemoryUpdatePages(memory);
+	// Opcode fetches from ROM need to stop bypassing GBLoad8 too
+	gb->cpu->memory.setActiveRegion(gb->cpu, gb->cpu->pc);
+}
+
+size_t GBMemoryCollectStats(const struct GBMemory* memory, struct mCoreMemoryStats* stats, size_t max) {
+	if (!memory->stats) {
+		return 0;
+	}
+	size_t count = sizeof(_statsRegions) / sizeof(*_statsRegions);
+	memcpy(stats, memory->stats, (max < count ? max : count) * sizeof(*stats));
+	return count;
+}
+
+static struct mCoreMemoryStats* _statsFor(struct GBMemory* memory, uint16_t address) {
+	if (address < GB_BASE_OAM) {
+		return &memory->stats[_statsRegionIndex[address >> 12]];
+	}
+	if (address < GB_BASE_UNUSABLE) {
+		return &memory->stats[7];
+	}
+	if (address < GB_BASE_IO) {
+		return &memory->stats[8];
+	}
+	if (address < GB_BASE_HRAM) {
+		return &memory->stats[9];
+	}
+	if (address < GB_BASE_IE) {
+		return &memory->stats[10];
+	}
+	return &memory->stats[11];
+}
+
+void GBMemoryUpdatePages(struct GBMemory* memory) {
+	memset(memory->readPages, 0, sizeof(memory->readPages));
+	memset(memory->writePages, 0, sizeof(memory->writePages));
+	if (memory->stats) {
+		// Everything has to go through the slow path to get counted
+		return;
+	}
+
+	unsigned page;
+	if (memory->romBase && !memory->mbcReadBank0) {
+		for (page = GB_BASE_CART_BANK0 >> GB_PAGE_SHIFT; page < GB_BASE_CART_BANK1 >> GB_PAGE_SHIFT; ++page) {
+			if (((page + 1) << GB_PAGE_SHIFT) <= memory->romSize) {
+				memory->readPages[page] = &memory->romBase[(page << GB_PAGE_SHIFT) & (GB_SIZE_CART_BANK0 - 1)];
+			}
+		}
+	}
+	// These mappers can split the switchable bank in two, so it's simpler to always decode it
+	if (memory->rom && !memory->mbcReadBank1 && memory->mbcType != GB_MBC6 && memory->mbcType != GB_UNL_NT_NEW) {
+		for (page = GB_BASE_CART_BANK1 >> GB_PAGE_SHIFT; page < GB_BASE_VRAM >> GB_PAGE_SHIFT; ++page) {
+			if (((page + 1) << GB_PAGE_SHIFT) <= memory->romSize) {
+				memory->readPages[page] = &memory->romBank[(page << GB_PAGE_SHIFT) & (GB_SIZE_CART_BANK0 - 1)];
+			}
+		}
+	}
+	if (memory->wram && memory->wramBank) {
+		for (page = GB_BASE_WORKING_RAM_BANK0 >> GB_PAGE_SHIFT; page < GB_BASE_OAM >> GB_PAGE_SHIFT; ++page) {
+			unsigned address = page << GB_PAGE_SHIFT;
+			uint8_t* bank = address & GB_SIZE_WORKING_RAM_BANK0 ? memory->wramBank : memory->wram;
+			uint8_t* host = &bank[address & (GB_SIZE_WORKING_RAM_BANK0 - 1)];
+			// The top of echo RAM isn't visible to MBCs that watch WRAM
+			bool echoTop = address >= 0xF000;
+			if (!memory->mbcReadHigh || echoTop) {
+				memory->readPages[page] = host;
+			}
+			if ((!memory->mbcWriteHigh || echoTop) && !_isWatched(memory, _watchAddress(address))) {
+				memory->writePages[page] = host;
+			}
+		}
+	}
 }
 
 uint8_t GBLoad8(struct SM83Core* cpu, uint16_t address) {
@@ -243,6 +573,18 @@ uint8_t GBLoad8(struct SM83Core* cpu, uint16_t address) {
 			return 0xFF;
 		}
 	}
+	const uint8_t* page = memory->readPages[address >> GB_PAGE_SHIFT];
+	if (page) {
+		uint8_t value = page[address & (GB_PAGE_SIZE - 1)];
+		if (address < GB_BASE_VRAM) {
+			memory->cartBus = value;
+			memory->cartBusPc = cpu->pc;
+		}
+		return value;
+	}
+	if (UNLIKELY(memory->stats)) {
+		++_statsFor(memory, address)->reads;
+	}
 	switch (address >> 12) {
 	case GB_REGION_CART_BANK0:
 	case GB_REGION_CART_BANK0 + 1:
@@ -278,6 +620,7 @@ uint8_t GBLoad8(struct SM83Core* cpu, uint16_t address) {
 		return memory->cartBus;
 	case GB_REGION_VRAM:
 	case GB_REGION_VRAM + 1:
+		GBVideoSyncMode(&gb->video, 0);
 		if (gb->video.mode != 3) {
 			return gb->video.vramBank[address & (GB_SIZE_VRAM_BANK0 - 1)];
 		}
@@ -346,6 +689,17 @@ void GBStore8(struct SM83Core* cpu, uint16_t address, int8_t value) {
 			return;
 		}
 	}
+	uint8_t* page = memory->writePages[address >> GB_PAGE_SHIFT];
+	if (page) {
+		page[address & (GB_PAGE_SIZE - 1)] = value;
+		return;
+	}
+	if (UNLIKELY(memory->stats)) {
+		++_statsFor(memory, address)->writes;
+	}
+	if (UNLIKELY(memory->watcher)) {
+		_reportStore(memory, address, value);
+	}
 	switch (address >> 12) {
 	case GB_REGION_CART_BANK0:
 	case GB_REGION_CART_BANK0 + 1:
@@ -360,6 +714,7 @@ void GBStore8(struct SM83Core* cpu, uint16_t address, int8_t value) {
 		return;
 	case GB_REGION_VRAM:
 	case GB_REGION_VRAM + 1:
+		GBVideoSyncMode(&gb->video, 0);
 		if (gb->video.mode != 3) {
 			gb->video.renderer->writeVRAM(gb->video.renderer, (address & (GB_SIZE_VRAM_BANK0 - 1)) | (GB_SIZE_VRAM_BANK0 * gb->video.vramCurrentBank));
 			gb->video.vramBank[address & (GB_SIZE_VRAM_BANK0 - 1)] = value;
@@ -574,6 +929,9 @@ uint8_t GBMemoryWriteHDMA5(struct GB* gb, uint8_t value) {
 
 void _GBMemoryDMAService(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	struct GB* gb = context;
+	mPERF_ENTER(DMA);
+	// Changing OAM during mode 2 can change how long mode 3 is
+	GBVideoSyncModeExact(&gb->video, cyclesLate);
 	int dmaRemaining = gb->memory.dmaRemaining;
 	gb->memory.dmaRemaining = 0;
 	uint8_t b = GBLoad8(gb->cpu, gb->memory.dmaSource);
@@ -584,12 +942,37 @@ void _GBMemoryDMAService(struct mTiming* timing, void* context, uint32_t cyclesL
 	++gb->memory.dmaDest;
 	gb->memory.dmaRemaining = dmaRemaining - 1;
 	if (gb->memory.dmaRemaining) {
-		mTimingSchedule(timing, &gb->memory.dmaEvent, 4 * (2 - gb->doubleSpeed) - cyclesLate);
+		int32_t step = 4 * (2 - gb->doubleSpeed);
+		int32_t when = step - (int32_t) cyclesLate;
+		// The CPU is locked out of OAM and the source bus until the last byte lands, so only
+		// other events can see the transfer. Bytes due before the next one are copied now,
+		// leaving the last for its own event so the CPU is released at the right time.
+		int32_t nextEvent = mTimingNextEvent(timing);
+		const uint8_t* page = gb->memory.readPages[gb->memory.dmaSource >> GB_PAGE_SHIFT];
+		if (gb->model >= GB_MODEL_CGB && gb->memory.dmaSource >= GB_BASE_WORKING_RAM_BANK1) {
+			// SVBK is still writable, so the source bank can change underneath us
+			page = NULL;
+		}
+		// The whole transfer lies within one page, since it starts on a page boundary
+		while (gb->memory.dmaRemaining > 1 && when < nextEvent && page) {
+			b = page[gb->memory.dmaSource & (GB_PAGE_SIZE - 1)];
+			gb->video.oam.raw[gb->memory.dmaDest] = b;
+			gb->video.renderer->writeOAM(gb->video.renderer, gb->memory.dmaDest);
+			++gb->memory.dmaSource;
+			++gb->memory.dmaDest;
+			--gb->memory.dmaRemaining;
+			when += step;
+		}
+		mTimingSchedule(timing, &gb->memory.dmaEvent, when);
 	}
+	mPERF_LEAVE();
 }
 
 void _GBMemoryHDMAService(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	struct GB* gb = context;
+	mPERF_ENTER(DMA);
+	// VRAM has to lock at the right time if this runs into mode 3
+	GBVideoSyncModeExact(&gb->video, cyclesLate);
 	gb->cpuBlocked = true;
 	uint8_t b = gb->cpu->memory.load8(gb->cpu, gb->memory.hdmaSource);
 	gb->cpu->memory.store8(gb->cpu, gb->memory.hdmaDest, b);
@@ -597,8 +980,32 @@ void _GBMemoryHDMAService(struct mTiming* timing, void* context, uint32_t cycles
 	++gb->memory.hdmaDest;
 	--gb->memory.hdmaRemaining;
 	if (gb->memory.hdmaRemaining) {
+		int32_t when = 4 - (int32_t) cyclesLate;
+		// The CPU is blocked for the whole transfer, so bytes due before the next event can be
+		// copied now. The last byte keeps its own event so the CPU resumes at the right time.
+		if (gb->cpu->memory.load8 == GBLoad8 && gb->cpu->memory.store8 == GBStore8 && !gb->memory.dmaRemaining && gb->video.mode != 3) {
+			int32_t nextEvent = mTimingNextEvent(timing);
+			while (gb->memory.hdmaRemaining > 1 && when < nextEvent && gb->memory.hdmaDest < GB_BASE_EXTERNAL_RAM) {
+				const uint8_t* page = gb->memory.readPages[gb->memory.hdmaSource >> GB_PAGE_SHIFT];
+				if (!page) {
+					break;
+				}
+				b = page[gb->memory.hdmaSource & (GB_PAGE_SIZE - 1)];
+				if (gb->memory.hdmaSource < GB_BASE_VRAM) {
+					gb->memory.cartBus = b;
+					gb->memory.cartBusPc = gb->cpu->pc;
+				}
+				uint16_t vramAddress = gb->memory.hdmaDest & (GB_SIZE_VRAM_BANK0 - 1);
+				gb->video.renderer->writeVRAM(gb->video.renderer, vramAddress | (GB_SIZE_VRAM_BANK0 * gb->video.vramCurrentBank));
+				gb->video.vramBank[vramAddress] = b;
+				++gb->memory.hdmaSource;
+				++gb->memory.hdmaDest;
+				--gb->memory.hdmaRemaining;
+				when += 4;
+			}
+		}
 		mTimingDeschedule(timing, &gb->memory.hdmaEvent);
-		mTimingSchedule(timing, &gb->memory.hdmaEvent, 4 - cyclesLate);
+		mTimingSchedule(timing, &gb->memory.hdmaEvent, when);
 	} else {
 		gb->cpuBlocked = false;
 		gb->memory.io[GB_REG_HDMA1] = gb->memory.hdmaSource >> 8;
@@ -614,6 +1021,7 @@ void _GBMemoryHDMAService(struct mTiming* timing, void* context, uint32_t cycles
 			gb->memory.io[GB_REG_HDMA5] = 0xFF;
 		}
 	}
+	mPERF_LEAVE();
 }
 
 void GBPatch8(struct SM83Core* cpu, uint16_t address, int8_t value, int8_t* old, int segment) {
@@ -1009,14 +1417,29 @@ void _pristineCow(struct GB* gb) {
 	if (!gb->isPristine) {
 		return;
 	}
-	void* newRom = anonymousMemoryMap(GB_SIZE_CART_MAX);
-	memcpy(newRom, gb->memory.rom, gb->memory.romSize);
+	void* newRom = NULL;
+	if (gb->romImage) {
+		// Only the pages that actually get written to end up being copied
+		newRom = mROMImageMapPrivate(gb->romImage);
+	}
+	bool shared = newRom;
+	if (!shared) {
+		newRom = anonymousMemoryMap(GB_SIZE_CART_MAX);
+		memcpy(newRom, gb->memory.rom, gb->memory.romSize);
+	}
 	memset(((uint8_t*) newRom) + gb->memory.romSize, 0xFF, GB_SIZE_CART_MAX - gb->memory.romSize);
 	if (gb->memory.rom == gb->memory.romBase) {
 		gb->memory.romBase = newRom;
 	}
-	if (gb->romVf) {
+	if (gb->romImage) {
+		if (!shared) {
+			mROMImageRelease(gb->romImage);
+			gb->romImage = NULL;
+		}
+	} else if (gb->romVf) {
 		gb->romVf->unmap(gb->romVf, gb->memory.rom, gb->memory.romSize);
+	}
+	if (gb->romVf) {
 		gb->romVf->close(gb->romVf);
 		gb->romVf = NULL;
 	}
@@ -776,6 +776,7 @@ bool GBOverrideFind(const struct Configuration* config, struct GBCartridgeOverri
 	override->model = GB_MODEL_AUTODETECT;
 	override->mbc = GB_MBC_AUTODETECT;
 	memset(override->gbColors, 0, sizeof(override->gbColors));
+	override->idleLoop = GB_IDLE_LOOP_NONE;
 	bool found = false;
 
 	int i;
@@ -792,6 +793,7 @@ bool GBOverrideFind(const struct Configuration* config, struct GBCartridgeOverri
 		snprintf(sectionName, sizeof(sectionName), "gb.override.%08X", override->headerCrc32);
 		const char* model = ConfigurationGetValue(config, sectionName, "model");
 		const char* mbc = ConfigurationGetValue(config, sectionName, "mbc");
+		const char* idleLoop = ConfigurationGetValue(config, sectionName, "idleLoop");
 		const char* pal[12] = {
 			ConfigurationGetValue(config, sectionName, "pal[0]"),
 			ConfigurationGetValue(config, sectionName, "pal[1]"),
@@ -821,6 +823,15 @@ bool GBOverrideFind(const struct Configuration* config, struct GBCartridgeOverri
 			}
 		}
 
+		if (idleLoop) {
+			char* end;
+			uint32_t address = strtoul(idleLoop, &end, 16);
+			if (end && !*end) {
+				override->idleLoop = address;
+				found = true;
+			}
+		}
+
 		for (i = 0; i < 12; ++i) {
 			if (!pal[i]) {
 				continue;
@@ -894,6 +905,14 @@ void GBOverrideSave(struct Configuration* config, const struct GBCartridgeOverri
 	} else {
 		ConfigurationClearValue(config, sectionName, "mbc");
 	}
+
+	if (override->idleLoop != GB_IDLE_LOOP_NONE) {
+		char idleLoop[9];
+		snprintf(idleLoop, sizeof(idleLoop), "%X", override->idleLoop);
+		ConfigurationSetValue(config, sectionName, "idleLoop", idleLoop);
+	} else {
+		ConfigurationClearValue(config, sectionName, "idleLoop");
+	}
 }
 
 size_t GBColorPresetList(const struct GBColorPreset** presets) {
@@ -926,6 +945,14 @@ void GBOverrideApply(struct GB* gb, const struct GBCartridgeOverride* override)
 			GBVideoSetPalette(&gb->video, i + 8, override->gbColors[i]);
 		}
 	}
+
+	if (override->idleLoop != GB_IDLE_LOOP_NONE) {
+		gb->idleLoop = override->idleLoop;
+		gb->idleLoopDetected = false;
+		if (gb->idleOptimization == GB_IDLE_LOOP_DETECT) {
+			gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+		}
+	}
 }
 
 void GBOverrideApplyDefaults(struct GB* gb) {
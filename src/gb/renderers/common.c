@@ -0,0 +1,298 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gb/renderers/common.h>
+
+#include <mgba/internal/gb/gb.h>
+
+static inline void _setAttribute(uint8_t* sgbAttributes, unsigned x, unsigned y, int palette) {
+	int p = sgbAttributes[(x >> 2) + 5 * y];
+	p &= ~(3 << (2 * (3 - (x & 3))));
+	p |= palette << (2 * (3 - (x & 3)));
+	sgbAttributes[(x >> 2) + 5 * y] = p;
+}
+
+static void _parseAttrBlock(uint8_t* sgbAttributes, const uint8_t* packet, int start) {
+	uint8_t block[6];
+	memcpy(block, &packet[start], 6);
+	unsigned x0 = block[2];
+	unsigned x1 = block[4];
+	unsigned y0 = block[3];
+	unsigned y1 = block[5];
+	unsigned x, y;
+	int pIn = block[1] & 3;
+	int pPerim = (block[1] >> 2) & 3;
+	int pOut = (block[1] >> 4) & 3;
+
+	for (y = 0; y < GB_VIDEO_VERTICAL_PIXELS / 8; ++y) {
+		for (x = 0; x < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++x) {
+			if (y > y0 && y < y1 && x > x0 && x < x1) {
+				if (block[0] & 1) {
+					_setAttribute(sgbAttributes, x, y, pIn);
+				}
+			} else if (y < y0 || y > y1 || x < x0 || x > x1) {
+				if (block[0] & 4) {
+					_setAttribute(sgbAttributes, x, y, pOut);
+				}
+			} else {
+				if (block[0] & 2) {
+					_setAttribute(sgbAttributes, x, y, pPerim);
+				} else if (block[0] & 1) {
+					_setAttribute(sgbAttributes, x, y, pIn);
+				} else if (block[0] & 4) {
+					_setAttribute(sgbAttributes, x, y, pOut);
+				}
+			}
+		}
+	}
+}
+
+static void _parseAttrLine(uint8_t* sgbAttributes, const uint8_t* packet, int start) {
+	uint8_t byte = packet[start];
+	unsigned line = byte & 0x1F;
+	int pal = (byte >> 5) & 3;
+
+	if (byte & 0x80) {
+		if (line > GB_VIDEO_VERTICAL_PIXELS / 8) {
+			return;
+		}
+		int x;
+		for (x = 0; x < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++x) {
+			_setAttribute(sgbAttributes, x, line, pal);
+		}
+	} else {
+		if (line > GB_VIDEO_HORIZONTAL_PIXELS / 8) {
+			return;
+		}
+		int y;
+		for (y = 0; y < GB_VIDEO_VERTICAL_PIXELS / 8; ++y) {
+			_setAttribute(sgbAttributes, line, y, pal);
+		}
+	}
+}
+
+int GBVideoRendererCleanOAM(const union GBOAM* oam, struct GBVideoRendererSprite* sprites, int y, GBRegisterLCDC lcdc, enum GBModel model) {
+	// TODO: GBC differences
+	// TODO: Optimize
+	int spriteHeight = 8;
+	if (GBRegisterLCDCIsObjSize(lcdc)) {
+		spriteHeight = 16;
+	}
+	int o = 0;
+	int i;
+	int16_t ids[GB_VIDEO_MAX_LINE_OBJ];
+	for (i = 0; i < GB_VIDEO_MAX_OBJ && o < GB_VIDEO_MAX_LINE_OBJ; ++i) {
+		uint8_t oy = oam->obj[i].y;
+		if (y < oy - 16 || y >= oy - 16 + spriteHeight) {
+			continue;
+		}
+		ids[o] = (oam->obj[i].x << 7) | i;
+		++o;
+	}
+	if (model < GB_MODEL_CGB) {
+		// Terrble n^2 sort, but it's only 10 elements so it shouldn't be that bad
+		int16_t ids2[GB_VIDEO_MAX_LINE_OBJ];
+		int min = -1;
+		int j;
+		for (i = 0; i < o; ++i) {
+			int min2 = 0xFFFF;
+			for (j = 0; j < o; ++j) {
+				if (ids[j] > min && ids[j] < min2) {
+					min2 = ids[j];
+				}
+			}
+			min = min2;
+			ids2[i] = min;
+		}
+		memcpy(ids, ids2, sizeof(ids));
+	}
+	for (i = 0; i < o; ++i) {
+		int id = ids[i] & 0x7F;
+		sprites[i].obj = oam->obj[id];
+		sprites[i].index = id;
+	}
+	return o;
+}
+
+void GBVideoRendererParseSGBAttributes(struct GBVideoRenderer* renderer, uint8_t* packet) {
+	int i;
+	int set;
+	int sets;
+	int attrX;
+	int attrY;
+	int attrDirection;
+	int pBefore;
+	int pAfter;
+	int pDiv;
+	switch (packet[0] >> 3) {
+	case SGB_PAL_SET:
+		packet[1] = packet[9];
+		if (!(packet[9] & 0x80)) {
+			break;
+		}
+		// Fall through
+	case SGB_ATTR_SET:
+		set = packet[1] & 0x3F;
+		if (set <= 0x2C) {
+			memcpy(renderer->sgbAttributes, &renderer->sgbAttributeFiles[set * 90], 90);
+		}
+		break;
+	case SGB_ATTR_BLK:
+		sets = packet[1];
+		i = 2;
+		for (; i < (packet[0] & 7) << 4 && sets; i += 6, --sets) {
+			_parseAttrBlock(renderer->sgbAttributes, packet, i);
+		}
+		break;
+	case SGB_ATTR_LIN:
+		sets = packet[1];
+		i = 2;
+		for (; i < (packet[0] & 7) << 4 && sets; ++i, --sets) {
+			_parseAttrLine(renderer->sgbAttributes, packet, i);
+		}
+		break;
+	case SGB_ATTR_DIV:
+		pAfter = packet[1] & 3;
+		pBefore = (packet[1] >> 2) & 3;
+		pDiv = (packet[1] >> 4) & 3;
+		attrX = packet[2];
+		if (packet[1] & 0x40) {
+			if (attrX > GB_VIDEO_VERTICAL_PIXELS / 8) {
+				attrX = GB_VIDEO_VERTICAL_PIXELS / 8;
+			}
+			int j;
+			for (j = 0; j < attrX; ++j) {
+				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
+					_setAttribute(renderer->sgbAttributes, i, j, pBefore);
+				}
+			}
+			if (attrX < GB_VIDEO_VERTICAL_PIXELS / 8) {
+				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
+					_setAttribute(renderer->sgbAttributes, i, attrX, pDiv);
+				}
+
+			}
+			for (; j < GB_VIDEO_VERTICAL_PIXELS / 8; ++j) {
+				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
+					_setAttribute(renderer->sgbAttributes, i, j, pAfter);
+				}
+			}
+		} else {
+			if (attrX > GB_VIDEO_HORIZONTAL_PIXELS / 8) {
+				attrX = GB_VIDEO_HORIZONTAL_PIXELS / 8;
+			}
+			int j;
+			for (j = 0; j < attrX; ++j) {
+				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
+					_setAttribute(renderer->sgbAttributes, j, i, pBefore);
+				}
+			}
+			if (attrX < GB_VIDEO_HORIZONTAL_PIXELS / 8) {
+				for (i = 0; i < GB_VIDEO_VERTICAL_PIXELS / 8; ++i) {
+					_setAttribute(renderer->sgbAttributes, attrX, i, pDiv);
+				}
+
+			}
+			for (; j < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++j) {
+				for (i = 0; i < GB_VIDEO_VERTICAL_PIXELS / 8; ++i) {
+					_setAttribute(renderer->sgbAttributes, j, i, pAfter);
+				}
+			}
+		}
+		break;
+	case SGB_ATTR_CHR:
+		attrX = packet[1];
+		attrY = packet[2];
+		if (attrX >= GB_VIDEO_HORIZONTAL_PIXELS / 8) {
+			attrX = 0;
+		}
+		if (attrY >= GB_VIDEO_VERTICAL_PIXELS / 8) {
+			attrY = 0;
+		}
+		sets = packet[3];
+		sets |= packet[4] << 8;
+		attrDirection = packet[5];
+		i = 6;
+		for (; i < (packet[0] & 7) << 4 && sets; ++i) {
+			int j;
+			for (j = 0; j < 4 && sets; ++j, --sets) {
+				uint8_t p = packet[i] >> (6 - j * 2);
+				_setAttribute(renderer->sgbAttributes, attrX, attrY, p & 3);
+				if (attrDirection) {
+					++attrY;
+					if (attrY >= GB_VIDEO_VERTICAL_PIXELS / 8) {
+						attrY = 0;
+						++attrX;
+					}
+					if (attrX >= GB_VIDEO_HORIZONTAL_PIXELS / 8) {
+						attrX = 0;
+					}
+				} else {
+					++attrX;
+					if (attrX >= GB_VIDEO_HORIZONTAL_PIXELS / 8) {
+						attrX = 0;
+						++attrY;
+					}
+					if (attrY >= GB_VIDEO_VERTICAL_PIXELS / 8) {
+						attrY = 0;
+					}
+				}
+			}
+		}
+
+		break;
+	default:
+		break;
+	}
+}
+
+void GBVideoRendererDecodeSGBBorder(const struct GBVideoRenderer* renderer, uint8_t* indices, uint32_t* overlayMask) {
+	memset(overlayMask, 0, sizeof(*overlayMask) * GB_VIDEO_VERTICAL_PIXELS / 8);
+	int x, y;
+	for (y = 0; y < SGB_VIDEO_VERTICAL_PIXELS; ++y) {
+		int localY = y & 0x7;
+		uint8_t* row = &indices[y * SGB_VIDEO_HORIZONTAL_PIXELS];
+		for (x = 0; x < SGB_VIDEO_HORIZONTAL_PIXELS; x += 8) {
+			uint16_t mapData;
+			LOAD_16LE(mapData, (x >> 2) + (y & ~7) * 8, renderer->sgbMapRam);
+			if (UNLIKELY(SGBBgAttributesGetTile(mapData) >= 0x100)) {
+				memset(&row[x], SGB_BORDER_SKIP, 8);
+				continue;
+			}
+
+			int yFlip = 0;
+			if (SGBBgAttributesIsYFlip(mapData)) {
+				yFlip = 7;
+			}
+			unsigned tileBase = (SGBBgAttributesGetTile(mapData) * 16 + (localY ^ yFlip)) * 2;
+			uint8_t tileData[4];
+			tileData[0] = renderer->sgbCharRam[tileBase + 0x00];
+			tileData[1] = renderer->sgbCharRam[tileBase + 0x01];
+			tileData[2] = renderer->sgbCharRam[tileBase + 0x10];
+			tileData[3] = renderer->sgbCharRam[tileBase + 0x11];
+
+			int paletteBase = SGBBgAttributesGetPalette(mapData) * 0x10;
+			int colorSelector;
+			int colors = 0;
+
+			int xFlip = 0;
+			if (SGBBgAttributesIsXFlip(mapData)) {
+				xFlip = 7;
+			}
+			int i;
+			for (i = 7; i >= 0; --i) {
+				colorSelector = (tileData[0] >> i & 0x1) << 0 | (tileData[1] >> i & 0x1) << 1 | (tileData[2] >> i & 0x1) << 2 | (tileData[3] >> i & 0x1) << 3;
+				row[(x + 7 - i) ^ xFlip] = paletteBase | colorSelector;
+				colors |= colorSelector;
+			}
+
+			// Non-transparent tiles over the game area get drawn on top of it each scanline
+			if (colors && x >= 48 && x < 208 && y >= 40 && y < 184) {
+				overlayMask[(y - 40) >> 3] |= 1 << ((x - 48) >> 3);
+			}
+		}
+	}
+}
+
@@ -0,0 +1,1091 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gb/renderers/gl.h>
+
+#ifdef BUILD_GLES3
+
+#include <mgba/core/cache-set.h>
+#include <mgba/internal/gb/io.h>
+#include <mgba/internal/gb/renderers/cache-set.h>
+#include <mgba-util/math.h>
+#include <mgba-util/memory.h>
+
+#define PAL_OBJ 0x20
+#define PAL_SGB_BORDER 0x40
+#define OBJ_PRIORITY 0x100
+
+// Span flags, which sit above the LCDC value in the low byte
+#define SPAN_CGB 0x100
+#define SPAN_BG 0x200
+#define SPAN_SGB_PALETTES 0x400
+#define SPAN_BORDER 0x800
+#define SPAN_BLACK 0x1000
+#define SPAN_BACKDROP 0x2000
+
+#define OBJ_XFLIP 0x1000000
+#define OBJ_BEHIND 0x2000000
+
+// Where the picture sits inside an SGB border
+#define SGB_ORIGIN_X 48
+#define SGB_ORIGIN_Y 40
+
+static void GBVideoGLRendererInit(struct GBVideoRenderer* renderer, enum GBModel model, bool borders);
+static void GBVideoGLRendererDeinit(struct GBVideoRenderer* renderer);
+static uint8_t GBVideoGLRendererWriteVideoRegister(struct GBVideoRenderer* renderer, uint16_t address, uint8_t value);
+static void GBVideoGLRendererWriteSGBPacket(struct GBVideoRenderer* renderer, uint8_t* data);
+static void GBVideoGLRendererWritePalette(struct GBVideoRenderer* renderer, int index, uint16_t value);
+static void GBVideoGLRendererWriteVRAM(struct GBVideoRenderer* renderer, uint16_t address);
+static void GBVideoGLRendererWriteOAM(struct GBVideoRenderer* renderer, uint16_t oam);
+static void GBVideoGLRendererDrawRange(struct GBVideoRenderer* renderer, int startX, int endX, int y);
+static void GBVideoGLRendererFinishScanline(struct GBVideoRenderer* renderer, int y);
+static void GBVideoGLRendererFinishFrame(struct GBVideoRenderer* renderer);
+static void GBVideoGLRendererEnableSGBBorder(struct GBVideoRenderer* renderer, bool enable);
+static void GBVideoGLRendererGetPixels(struct GBVideoRenderer* renderer, size_t* stride, const void** pixels);
+static void GBVideoGLRendererPutPixels(struct GBVideoRenderer* renderer, size_t stride, const void* pixels);
+
+static void _drawSpans(struct GBVideoGLRenderer* renderer);
+static void _regenerateSGBBorder(struct GBVideoGLRenderer* renderer);
+
+struct GBVideoGLUniform {
+	const char* name;
+	int type;
+};
+
+static const GLchar* const _gles3Header =
+	"#version 300 es\n"
+	"#define OUT(n) layout(location = n)\n"
+	"precision highp float;\n"
+	"precision highp int;\n"
+	"precision highp sampler2D;\n"
+	"precision highp isampler2D;\n"
+	"precision highp usampler2D;\n";
+
+static const GLchar* const _gl3Header =
+	"#version 330 core\n"
+	"#define OUT(n) layout(location = n)\n"
+	"precision highp float;\n";
+
+static const char* const _spanVertexShader =
+	"in vec2 position;\n"
+	"uniform isampler2D spans;\n"
+	"uniform ivec2 origin;\n"
+	"uniform ivec2 dims;\n"
+	"flat out int span;\n"
+
+	"void main() {\n"
+	"	ivec4 header = texelFetch(spans, ivec2(0, gl_InstanceID), 0);\n"
+	"	vec2 local = vec2(mix(float(header.y), float(header.z), position.x), float(header.x) + position.y) + vec2(origin);\n"
+	"	gl_Position = vec4(local / vec2(dims) * 2. - 1., 0., 1.);\n"
+	"	span = gl_InstanceID;\n"
+	"}";
+
+static const struct GBVideoGLUniform _uniformsSpan[] = {
+	{ "spans", GB_GL_VS_SPANS, },
+	{ "origin", GB_GL_VS_ORIGIN, },
+	{ "dims", GB_GL_VS_DIMS, },
+	{ "vram", GB_GL_SPAN_VRAM, },
+	{ "palette", GB_GL_SPAN_PALETTE, },
+	{ "border", GB_GL_SPAN_BORDER, },
+	{ "scale", GB_GL_SPAN_SCALE, },
+	{ 0 }
+};
+
+static const char* const _renderSpan =
+	"uniform isampler2D spans;\n"
+	"uniform usampler2D vram;\n"
+	"uniform sampler2D palette;\n"
+	"uniform usampler2D border;\n"
+	"uniform ivec2 origin;\n"
+	"uniform int scale;\n"
+	"flat in int span;\n"
+	"OUT(0) out vec4 color;\n"
+
+	"int fetchVram(int address) {\n"
+	"	return int(texelFetch(vram, ivec2(address & 255, address >> 8), 0).r);\n"
+	"}\n"
+
+	"int renderBackground(int lcdc, int map, int x, int y, bool cgb) {\n"
+	"	int entry = map + ((x >> 3) & 31) + ((y >> 3) & 31) * 32;\n"
+	"	int tile = fetchVram(entry);\n"
+	"	int data = tile * 16;\n"
+	"	if ((lcdc & 0x10) == 0) {\n"
+	"		data = 0x1000 + ((tile ^ 0x80) - 0x80) * 16;\n"
+	"	}\n"
+	"	int localX = 7 - (x & 7);\n"
+	"	int localY = y & 7;\n"
+	"	int pixel = 0;\n"
+	"	if (cgb) {\n"
+	"		int attributes = fetchVram(entry + 0x2000);\n"
+	"		pixel = (attributes & 7) * 4;\n"
+	"		if ((attributes & 0x80) != 0 && (lcdc & 1) != 0) {\n"
+	"			pixel |= 0x100;\n"
+	"		}\n"
+	"		if ((attributes & 8) != 0) {\n"
+	"			data += 0x2000;\n"
+	"		}\n"
+	"		if ((attributes & 0x40) != 0) {\n"
+	"			localY = 7 - localY;\n"
+	"		}\n"
+	"		if ((attributes & 0x20) != 0) {\n"
+	"			localX = 7 - localX;\n"
+	"		}\n"
+	"	}\n"
+	"	int lower = fetchVram(data + localY * 2) >> localX;\n"
+	"	int upper = fetchVram(data + localY * 2 + 1) >> localX;\n"
+	"	return pixel | ((upper & 1) << 1) | (lower & 1);\n"
+	"}\n"
+
+	"void main() {\n"
+	"	ivec4 header = texelFetch(spans, ivec2(0, span), 0);\n"
+	"	int flags = header.w;\n"
+	"	if ((flags & 0x1000) != 0) {\n"
+	"		color = vec4(0., 0., 0., 1.);\n"
+	"		return;\n"
+	"	}\n"
+	"	if ((flags & 0x2000) != 0) {\n"
+	"		color = texelFetch(palette, ivec2(0, 0), 0);\n"
+	"		return;\n"
+	"	}\n"
+	"	ivec4 scroll = texelFetch(spans, ivec2(1, span), 0);\n"
+	"	ivec4 extra = texelFetch(spans, ivec2(2, span), 0);\n"
+	"	ivec4 lookup = texelFetch(spans, ivec2(3, span), 0);\n"
+	"	int x = int(gl_FragCoord.x) / scale - origin.x;\n"
+	"	bool cgb = (flags & 0x100) != 0;\n"
+	"	int pixel = 0;\n"
+	"	if (x >= scroll.z) {\n"
+	"		pixel = renderBackground(flags, (flags & 0x40) != 0 ? 0x1C00 : 0x1800, x + scroll.w, extra.x, cgb);\n"
+	"	} else if ((flags & 0x200) != 0) {\n"
+	"		pixel = renderBackground(flags, (flags & 0x8) != 0 ? 0x1C00 : 0x1800, x + scroll.x, scroll.y, cgb);\n"
+	"	}\n"
+	"	for (int i = 0; i < extra.y; ++i) {\n"
+	"		ivec4 pair = texelFetch(spans, ivec2(4 + (i >> 1), span), 0);\n"
+	"		ivec2 obj = (i & 1) != 0 ? pair.zw : pair.xy;\n"
+	"		if (x < obj.x - 8 || x >= obj.x) {\n"
+	"			continue;\n"
+	"		}\n"
+	"		int localX = (obj.y & 0x1000000) != 0 ? (x - obj.x) & 7 : 7 - ((x - obj.x) & 7);\n"
+	"		int objPixel = (((obj.y >> (8 + localX)) & 1) << 1) | ((obj.y >> localX) & 1);\n"
+	"		if (objPixel == 0) {\n"
+	"			continue;\n"
+	"		}\n"
+	"		if ((obj.y & 0x2000000) != 0) {\n"
+	"			if ((pixel & 0x63) != 0) {\n"
+	"				continue;\n"
+	"			}\n"
+	"		} else if ((pixel & 0x60) != 0 || (pixel & 0x103) > 0x100) {\n"
+	"			continue;\n"
+	"		}\n"
+	"		pixel = ((obj.y >> 16) & 0xFF) | objPixel;\n"
+	"	}\n"
+	"	int index = pixel & 0xFF;\n"
+	"	if (index < 4) {\n"
+	"		index = (lookup.x >> (index * 8)) & 0xFF;\n"
+	"	} else if (index >= 0x20 && index < 0x24) {\n"
+	"		index = (lookup.y >> ((index - 0x20) * 8)) & 0xFF;\n"
+	"	} else if (index >= 0x24 && index < 0x28) {\n"
+	"		index = (lookup.z >> ((index - 0x24) * 8)) & 0xFF;\n"
+	"	}\n"
+	"	if ((flags & 0x400) != 0) {\n"
+	"		int cell = x >> 5;\n"
+	"		int attributes = cell < 4 ? extra.z >> (cell * 8) : extra.w;\n"
+	"		index |= ((attributes >> (6 - ((x >> 2) & 6))) & 3) << 2;\n"
+	"	}\n"
+	"	color = texelFetch(palette, ivec2(index, 0), 0);\n"
+	"	if ((flags & 0x800) != 0) {\n"
+	"		int overlay = int(texelFetch(border, ivec2(x, header.x) + origin, 0).r);\n"
+	"		if ((overlay & 15) != 0) {\n"
+	"			color = texelFetch(palette, ivec2(overlay, 0), 0);\n"
+	"		}\n"
+	"	}\n"
+	"}";
+
+static const char* const _borderVertexShader =
+	"in vec2 position;\n"
+
+	"void main() {\n"
+	"	gl_Position = vec4(position * 2. - 1., 0., 1.);\n"
+	"}";
+
+static const struct GBVideoGLUniform _uniformsBorder[] = {
+	{ "palette", GB_GL_BORDER_PALETTE, },
+	{ "border", GB_GL_BORDER_BORDER, },
+	{ "scale", GB_GL_BORDER_SCALE, },
+	{ 0 }
+};
+
+static const char* const _renderBorder =
+	"uniform sampler2D palette;\n"
+	"uniform usampler2D border;\n"
+	"uniform int scale;\n"
+	"OUT(0) out vec4 color;\n"
+
+	"void main() {\n"
+	"	ivec2 coord = ivec2(gl_FragCoord.xy) / scale;\n"
+	"	if (coord.x >= 48 && coord.x < 208 && coord.y >= 40 && coord.y < 184) {\n"
+	"		discard;\n"
+	"	}\n"
+	"	int index = int(texelFetch(border, coord, 0).r);\n"
+	"	if ((index & 0x80) != 0) {\n"
+	"		discard;\n"
+	"	}\n"
+	"	color = texelFetch(palette, ivec2(index, 0), 0);\n"
+	"}";
+
+static const GLint _vertices[] = {
+	0, 0,
+	0, 1,
+	1, 1,
+	1, 0,
+};
+
+void GBVideoGLRendererCreate(struct GBVideoGLRenderer* renderer) {
+	renderer->d.init = GBVideoGLRendererInit;
+	renderer->d.deinit = GBVideoGLRendererDeinit;
+	renderer->d.writeVideoRegister = GBVideoGLRendererWriteVideoRegister;
+	renderer->d.writeSGBPacket = GBVideoGLRendererWriteSGBPacket;
+	renderer->d.writePalette = GBVideoGLRendererWritePalette;
+	renderer->d.writeVRAM = GBVideoGLRendererWriteVRAM;
+	renderer->d.writeOAM = GBVideoGLRendererWriteOAM;
+	renderer->d.drawRange = GBVideoGLRendererDrawRange;
+	renderer->d.finishScanline = GBVideoGLRendererFinishScanline;
+	renderer->d.finishFrame = GBVideoGLRendererFinishFrame;
+	renderer->d.enableSGBBorder = GBVideoGLRendererEnableSGBBorder;
+	renderer->d.getPixels = GBVideoGLRendererGetPixels;
+	renderer->d.putPixels = GBVideoGLRendererPutPixels;
+
+	renderer->d.disableBG = false;
+	renderer->d.disableOBJ = false;
+	renderer->d.disableWIN = false;
+
+	renderer->d.highlightBG = false;
+	renderer->d.highlightWIN = false;
+	int i;
+	for (i = 0; i < GB_VIDEO_MAX_OBJ; ++i) {
+		renderer->d.highlightOBJ[i] = false;
+	}
+	renderer->d.highlightColor = M_COLOR_WHITE;
+	renderer->d.highlightAmount = 0;
+
+	renderer->scale = 1;
+	renderer->temporaryBuffer = NULL;
+	renderer->temporaryBufferSize = 0;
+	renderer->borderIndices = NULL;
+	renderer->objOffsetX = 0;
+	renderer->objOffsetY = 0;
+	renderer->offsetScx = 0;
+	renderer->offsetScy = 0;
+	renderer->offsetWx = 0;
+	renderer->offsetWy = 0;
+}
+
+static void _compileShader(struct GBVideoGLRenderer* glRenderer, struct GBVideoGLShader* shader, const char** shaderBuffer, const char* vertexShader, const char* fragmentShader, const struct GBVideoGLUniform* uniforms, char* log) {
+	GLuint program = glCreateProgram();
+	shader->program = program;
+
+	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+	shaderBuffer[1] = vertexShader;
+	glShaderSource(vs, 2, shaderBuffer, 0);
+	glCompileShader(vs);
+	glGetShaderInfoLog(vs, 2048, 0, log);
+	if (log[0]) {
+		mLOG(GB_VIDEO, ERROR, "Vertex shader compilation failure: %s", log);
+	}
+
+	GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+	shaderBuffer[1] = fragmentShader;
+	glShaderSource(fs, 2, shaderBuffer, 0);
+	glCompileShader(fs);
+	glGetShaderInfoLog(fs, 2048, 0, log);
+	if (log[0]) {
+		mLOG(GB_VIDEO, ERROR, "Fragment shader compilation failure: %s", log);
+	}
+
+	glAttachShader(program, vs);
+	glAttachShader(program, fs);
+	glLinkProgram(program);
+	glGetProgramInfoLog(program, 2048, 0, log);
+	if (log[0]) {
+		mLOG(GB_VIDEO, ERROR, "Program link failure: %s", log);
+	}
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+
+	glGenVertexArrays(1, &shader->vao);
+	glBindVertexArray(shader->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, glRenderer->vbo);
+	GLuint positionLocation = glGetAttribLocation(program, "position");
+	glEnableVertexAttribArray(positionLocation);
+	glVertexAttribPointer(positionLocation, 2, GL_INT, GL_FALSE, 0, NULL);
+
+	size_t i;
+	for (i = 0; uniforms[i].name; ++i) {
+		shader->uniforms[uniforms[i].type] = glGetUniformLocation(program, uniforms[i].name);
+	}
+}
+
+static void _deleteShader(struct GBVideoGLShader* shader) {
+	glDeleteProgram(shader->program);
+	glDeleteVertexArrays(1, &shader->vao);
+}
+
+static void _initTexture(GLuint tex, GLenum internalFormat, GLsizei width, GLsizei height, GLenum format, GLenum type) {
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, 0);
+}
+
+static bool _hasBorder(const struct GBVideoGLRenderer* renderer) {
+	return (renderer->model & GB_MODEL_SGB) && renderer->sgbBorders;
+}
+
+static void _outputSize(const struct GBVideoGLRenderer* renderer, int* width, int* height) {
+	if (_hasBorder(renderer)) {
+		*width = SGB_VIDEO_HORIZONTAL_PIXELS;
+		*height = SGB_VIDEO_VERTICAL_PIXELS;
+	} else {
+		*width = GB_VIDEO_HORIZONTAL_PIXELS;
+		*height = GB_VIDEO_VERTICAL_PIXELS;
+	}
+}
+
+static void _initFramebuffer(struct GBVideoGLRenderer* renderer) {
+	int width, height;
+	_outputSize(renderer, &width, &height);
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer->fbo);
+	_initTexture(renderer->outputTex, GL_RGB, width * renderer->scale, height * renderer->scale, GL_RGB, GL_UNSIGNED_BYTE);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->outputTex, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	renderer->outputTexDirty = false;
+}
+
+static void _setPaletteEntry(struct GBVideoGLRenderer* renderer, int index, uint32_t color) {
+	renderer->palette[index] = color;
+	renderer->paletteDirty = true;
+}
+
+static uint32_t _convertColor(const struct GBVideoGLRenderer* renderer, uint16_t value) {
+	unsigned r = M_R5(value);
+	unsigned g = M_G5(value);
+	unsigned b = M_B5(value);
+	if (renderer->model == GB_MODEL_AGB) {
+		r *= r;
+		g *= g;
+		b *= b;
+		r >>= 2;
+		r += r >> 4;
+		g >>= 2;
+		g += g >> 4;
+		b >>= 2;
+		b += b >> 4;
+	} else {
+		r = (r << 3) | (r >> 2);
+		g = (g << 3) | (g >> 2);
+		b = (b << 3) | (b >> 2);
+	}
+	// The palette is uploaded as bytes, so it's kept in that order whatever the host is
+	uint32_t color;
+	STORE_32LE(r | (g << 8) | (b << 16) | 0xFF000000, 0, &color);
+	return color;
+}
+
+static void GBVideoGLRendererInit(struct GBVideoRenderer* renderer, enum GBModel model, bool sgbBorders) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	glRenderer->lcdc = 0;
+	glRenderer->scy = 0;
+	glRenderer->scx = 0;
+	glRenderer->wy = 0;
+	glRenderer->currentWy = 0;
+	glRenderer->currentWx = 0;
+	glRenderer->lastY = GB_VIDEO_VERTICAL_PIXELS;
+	glRenderer->lastX = 0;
+	glRenderer->hasWindow = false;
+	glRenderer->wx = 0;
+	glRenderer->model = model;
+	glRenderer->objMax = 0;
+	glRenderer->sgbTransfer = 0;
+	glRenderer->sgbCommandHeader = 0;
+	glRenderer->sgbBorders = sgbBorders;
+	glRenderer->borderActive = false;
+	glRenderer->nSpans = 0;
+	glRenderer->vramDirty = 0xFFFFFFFF;
+	glRenderer->paletteDirty = true;
+
+	size_t i;
+	for (i = 0; i < sizeof(glRenderer->lookup); ++i) {
+		glRenderer->lookup[i] = i;
+	}
+	memset(glRenderer->palette, 0, sizeof(glRenderer->palette));
+
+	glGenFramebuffers(1, &glRenderer->fbo);
+
+	glGenTextures(1, &glRenderer->vramTex);
+	_initTexture(glRenderer->vramTex, GL_R8UI, 256, GB_SIZE_VRAM / 256, GL_RED_INTEGER, GL_UNSIGNED_BYTE);
+
+	glGenTextures(1, &glRenderer->paletteTex);
+	_initTexture(glRenderer->paletteTex, GL_RGBA8, 128, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+
+	glGenTextures(1, &glRenderer->spanTex);
+	_initTexture(glRenderer->spanTex, GL_RGBA32I, GB_GL_SPAN_TEXELS, GB_GL_MAX_SPANS, GL_RGBA_INTEGER, GL_INT);
+
+	glGenTextures(1, &glRenderer->borderTex);
+	_initTexture(glRenderer->borderTex, GL_R8UI, SGB_VIDEO_HORIZONTAL_PIXELS, SGB_VIDEO_VERTICAL_PIXELS, GL_RED_INTEGER, GL_UNSIGNED_BYTE);
+
+	glGenBuffers(1, &glRenderer->vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, glRenderer->vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(_vertices), _vertices, GL_STATIC_DRAW);
+
+	if (glRenderer->outputTex != (GLuint) -1) {
+		_initFramebuffer(glRenderer);
+	}
+
+	char log[2048];
+	const GLchar* shaderBuffer[2];
+	const GLubyte* version = glGetString(GL_VERSION);
+	if (strncmp((const char*) version, "OpenGL ES ", strlen("OpenGL ES ")) != 0) {
+		shaderBuffer[0] = _gl3Header;
+	} else {
+		shaderBuffer[0] = _gles3Header;
+	}
+	_compileShader(glRenderer, &glRenderer->spanShader, shaderBuffer, _spanVertexShader, _renderSpan, _uniformsSpan, log);
+	_compileShader(glRenderer, &glRenderer->borderShader, shaderBuffer, _borderVertexShader, _renderBorder, _uniformsBorder, log);
+	glBindVertexArray(0);
+}
+
+static void GBVideoGLRendererDeinit(struct GBVideoRenderer* renderer) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (glRenderer->temporaryBuffer) {
+		mappedMemoryFree(glRenderer->temporaryBuffer, glRenderer->temporaryBufferSize);
+		glRenderer->temporaryBuffer = NULL;
+	}
+	if (glRenderer->borderIndices) {
+		mappedMemoryFree(glRenderer->borderIndices, SGB_VIDEO_HORIZONTAL_PIXELS * SGB_VIDEO_VERTICAL_PIXELS);
+		glRenderer->borderIndices = NULL;
+	}
+	glDeleteFramebuffers(1, &glRenderer->fbo);
+	glDeleteTextures(1, &glRenderer->vramTex);
+	glDeleteTextures(1, &glRenderer->paletteTex);
+	glDeleteTextures(1, &glRenderer->spanTex);
+	glDeleteTextures(1, &glRenderer->borderTex);
+	glDeleteBuffers(1, &glRenderer->vbo);
+
+	_deleteShader(&glRenderer->spanShader);
+	_deleteShader(&glRenderer->borderShader);
+}
+
+static bool _inWindow(struct GBVideoGLRenderer* renderer) {
+	return GBRegisterLCDCIsWindow(renderer->lcdc) && GB_VIDEO_HORIZONTAL_PIXELS + 7 > renderer->wx;
+}
+
+static void GBVideoGLRendererUpdateWindow(struct GBVideoGLRenderer* renderer, bool before, bool after, uint8_t oldWy) {
+	if (renderer->lastY >= GB_VIDEO_VERTICAL_PIXELS || !(after || before)) {
+		return;
+	}
+	if (!renderer->hasWindow && renderer->lastX == GB_VIDEO_HORIZONTAL_PIXELS) {
+		return;
+	}
+	if (renderer->lastY >= oldWy) {
+		if (!after) {
+			renderer->currentWy -= renderer->lastY;
+			renderer->hasWindow = true;
+		} else if (!before) {
+			if (!renderer->hasWindow) {
+				renderer->currentWy = renderer->lastY - renderer->wy;
+				if (renderer->lastY >= renderer->wy && renderer->lastX > renderer->wx) {
+					++renderer->currentWy;
+				}
+			} else {
+				renderer->currentWy += renderer->lastY;
+			}
+		} else if (renderer->wy != oldWy) {
+			renderer->currentWy += oldWy - renderer->wy;
+			renderer->hasWindow = true;
+		}
+	}
+}
+
+static uint8_t GBVideoGLRendererWriteVideoRegister(struct GBVideoRenderer* renderer, uint16_t address, uint8_t value) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (renderer->cache) {
+		GBVideoCacheWriteVideoRegister(renderer->cache, address, value);
+	}
+	bool wasWindow = _inWindow(glRenderer);
+	uint8_t wy = glRenderer->wy;
+	switch (address) {
+	case GB_REG_LCDC:
+		glRenderer->lcdc = value;
+		GBVideoGLRendererUpdateWindow(glRenderer, wasWindow, _inWindow(glRenderer), wy);
+		break;
+	case GB_REG_SCY:
+		glRenderer->scy = value;
+		break;
+	case GB_REG_SCX:
+		glRenderer->scx = value;
+		break;
+	case GB_REG_WY:
+		glRenderer->wy = value;
+		GBVideoGLRendererUpdateWindow(glRenderer, wasWindow, _inWindow(glRenderer), wy);
+		break;
+	case GB_REG_WX:
+		glRenderer->wx = value;
+		GBVideoGLRendererUpdateWindow(glRenderer, wasWindow, _inWindow(glRenderer), wy);
+		break;
+	// Only the SGB sends these here; every other model turns them into palette writes
+	case GB_REG_BGP:
+		glRenderer->lookup[0] = value & 3;
+		glRenderer->lookup[1] = (value >> 2) & 3;
+		glRenderer->lookup[2] = (value >> 4) & 3;
+		glRenderer->lookup[3] = (value >> 6) & 3;
+		break;
+	case GB_REG_OBP0:
+		glRenderer->lookup[PAL_OBJ + 0] = value & 3;
+		glRenderer->lookup[PAL_OBJ + 1] = (value >> 2) & 3;
+		glRenderer->lookup[PAL_OBJ + 2] = (value >> 4) & 3;
+		glRenderer->lookup[PAL_OBJ + 3] = (value >> 6) & 3;
+		break;
+	case GB_REG_OBP1:
+		glRenderer->lookup[PAL_OBJ + 4] = value & 3;
+		glRenderer->lookup[PAL_OBJ + 5] = (value >> 2) & 3;
+		glRenderer->lookup[PAL_OBJ + 6] = (value >> 4) & 3;
+		glRenderer->lookup[PAL_OBJ + 7] = (value >> 6) & 3;
+		break;
+	}
+	return value;
+}
+
+static void GBVideoGLRendererWriteSGBPacket(struct GBVideoRenderer* renderer, uint8_t* data) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	memcpy(glRenderer->sgbPacket, data, sizeof(glRenderer->sgbPacket));
+	glRenderer->sgbCommandHeader = data[0];
+	glRenderer->sgbTransfer = 0;
+	GBVideoRendererParseSGBAttributes(renderer, glRenderer->sgbPacket);
+	switch (glRenderer->sgbCommandHeader >> 3) {
+	case SGB_ATRC_EN:
+	case SGB_MASK_EN:
+		if (glRenderer->sgbBorders && !renderer->sgbRenderMode) {
+			_regenerateSGBBorder(glRenderer);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void GBVideoGLRendererWritePalette(struct GBVideoRenderer* renderer, int index, uint16_t value) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	// Spans already queued were drawn with the old color
+	_drawSpans(glRenderer);
+	uint32_t color = _convertColor(glRenderer, value);
+	if (glRenderer->model & GB_MODEL_SGB) {
+		if (index >= PAL_SGB_BORDER && !(index & 0xF)) {
+			color = glRenderer->palette[0];
+		} else if (!(glRenderer->model & GB_MODEL_CGB) && index < 0x10 && index && !(index & 3)) {
+			color = glRenderer->palette[0];
+		}
+	}
+	if (renderer->cache) {
+		mCacheSetWritePalette(renderer->cache, index, mColorFrom555(value));
+	}
+	bool backdropChanged = !index && glRenderer->palette[0] != color;
+	_setPaletteEntry(glRenderer, index, color);
+
+	if (glRenderer->model & GB_MODEL_SGB && !index && GBRegisterLCDCIsEnable(glRenderer->lcdc)) {
+		if (!(glRenderer->model & GB_MODEL_CGB)) {
+			renderer->writePalette(renderer, 0x04, value);
+			renderer->writePalette(renderer, 0x08, value);
+			renderer->writePalette(renderer, 0x0C, value);
+			renderer->writePalette(renderer, 0x40, value);
+			renderer->writePalette(renderer, 0x50, value);
+			renderer->writePalette(renderer, 0x60, value);
+			renderer->writePalette(renderer, 0x70, value);
+		}
+		if (backdropChanged && glRenderer->sgbBorders && !renderer->sgbRenderMode) {
+			_regenerateSGBBorder(glRenderer);
+		}
+	}
+}
+
+static void GBVideoGLRendererWriteVRAM(struct GBVideoRenderer* renderer, uint16_t address) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (renderer->cache) {
+		mCacheSetWriteVRAM(renderer->cache, address);
+	}
+	// This comes before the store, so queued spans still see the VRAM they were drawn with
+	_drawSpans(glRenderer);
+	glRenderer->vramDirty |= 1 << (address >> 9);
+}
+
+static void GBVideoGLRendererWriteOAM(struct GBVideoRenderer* renderer, uint16_t oam) {
+	UNUSED(renderer);
+	UNUSED(oam);
+	// Objects are copied into each span, so there's nothing to do
+}
+
+static void _decodeBackground(struct GBVideoGLRenderer* renderer, const uint8_t* maps, int startX, int endX, int sx, int sy) {
+	const uint8_t* data = renderer->d.vram;
+	if (!GBRegisterLCDCIsTileData(renderer->lcdc)) {
+		data += 0x1000;
+	}
+	int topY = ((sy >> 3) & 0x1F) * 0x20;
+	int localY = sy & 7;
+	int x;
+	for (x = startX < 0 ? 0 : startX; x < endX; ++x) {
+		int topX = ((x + sx) >> 3) & 0x1F;
+		int bottomX = 7 - ((x + sx) & 7);
+		int bgTile;
+		if (GBRegisterLCDCIsTileData(renderer->lcdc)) {
+			bgTile = maps[topX + topY];
+		} else {
+			bgTile = ((const int8_t*) maps)[topX + topY];
+		}
+		uint8_t tileDataLower = data[(bgTile * 8 + localY) * 2] >> bottomX;
+		uint8_t tileDataUpper = data[(bgTile * 8 + localY) * 2 + 1] >> bottomX;
+		renderer->row[x] = ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
+	}
+}
+
+static void _queueObjects(struct GBVideoGLRenderer* renderer, GLint* span, int startX, int endX, int y) {
+	int count = 0;
+	int i;
+	for (i = 0; i < renderer->objMax; ++i) {
+		struct GBObj* obj = &renderer->obj[i].obj;
+		int objX = obj->x + renderer->objOffsetX;
+		if (endX < objX - 8 || startX >= objX) {
+			continue;
+		}
+		const uint8_t* data = renderer->d.vram;
+		int tileOffset = 0;
+		int bottomY;
+		int objY = obj->y + renderer->objOffsetY;
+		if (GBObjAttributesIsYFlip(obj->attr)) {
+			bottomY = 7 - ((y - objY - 16) & 7);
+			if (GBRegisterLCDCIsObjSize(renderer->lcdc) && y - objY < -8) {
+				++tileOffset;
+			}
+		} else {
+			bottomY = (y - objY - 16) & 7;
+			if (GBRegisterLCDCIsObjSize(renderer->lcdc) && y - objY >= -8) {
+				++tileOffset;
+			}
+		}
+		if (GBRegisterLCDCIsObjSize(renderer->lcdc) && obj->tile & 1) {
+			--tileOffset;
+		}
+		bool behind = GBObjAttributesIsPriority(obj->attr);
+		int p = PAL_OBJ;
+		if (renderer->model >= GB_MODEL_CGB) {
+			p |= GBObjAttributesGetCGBPalette(obj->attr) * 4;
+			if (GBObjAttributesIsBank(obj->attr)) {
+				data += GB_SIZE_VRAM_BANK0;
+			}
+			if (!GBRegisterLCDCIsBgEnable(renderer->lcdc)) {
+				behind = false;
+			}
+		} else {
+			p |= (GBObjAttributesGetPalette(obj->attr) + 8) * 4;
+		}
+		int objTile = obj->tile + tileOffset;
+		GLint packed = data[(objTile * 8 + bottomY) * 2];
+		packed |= data[(objTile * 8 + bottomY) * 2 + 1] << 8;
+		packed |= p << 16;
+		if (GBObjAttributesIsXFlip(obj->attr)) {
+			packed |= OBJ_XFLIP;
+		}
+		if (behind) {
+			packed |= OBJ_BEHIND;
+		}
+		span[16 + count * 2] = objX;
+		span[17 + count * 2] = packed;
+		++count;
+	}
+	span[9] = count;
+}
+
+static void GBVideoGLRendererDrawRange(struct GBVideoRenderer* renderer, int startX, int endX, int y) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	glRenderer->lastY = y;
+	glRenderer->lastX = endX;
+	if (startX == 0) {
+		glRenderer->objMax = GBVideoRendererCleanOAM(renderer->oam, glRenderer->obj, y, glRenderer->lcdc, glRenderer->model);
+	}
+	if (startX >= endX) {
+		return;
+	}
+
+	int flags = glRenderer->lcdc;
+	int winX = GB_VIDEO_HORIZONTAL_PIXELS;
+	int wy = glRenderer->wy + glRenderer->currentWy;
+	if (GBRegisterLCDCIsBgEnable(glRenderer->lcdc) || glRenderer->model >= GB_MODEL_CGB) {
+		int wx = glRenderer->wx + glRenderer->currentWx - 7;
+		if (GBRegisterLCDCIsWindow(glRenderer->lcdc) && wy == y && wx <= endX) {
+			glRenderer->hasWindow = true;
+		}
+		if (GBRegisterLCDCIsWindow(glRenderer->lcdc) && glRenderer->hasWindow && wx <= endX && !renderer->disableWIN) {
+			winX = wx;
+		}
+		if (!renderer->disableBG) {
+			flags |= SPAN_BG;
+		}
+	}
+	if (glRenderer->sgbTransfer == 1) {
+		const uint8_t* maps = &renderer->vram[GBRegisterLCDCIsTileMap(glRenderer->lcdc) ? GB_BASE_MAP + GB_SIZE_MAP : GB_BASE_MAP];
+		if (flags & SPAN_BG) {
+			_decodeBackground(glRenderer, maps, startX, endX, glRenderer->scx - glRenderer->offsetScx, glRenderer->scy + y - glRenderer->offsetScy);
+		} else {
+			memset(&glRenderer->row[startX], 0, endX - startX);
+		}
+	}
+
+	switch (renderer->sgbRenderMode) {
+	case 0:
+		break;
+	case 1:
+		// The picture is frozen, so this span keeps whatever was there
+		return;
+	case 2:
+		flags |= SPAN_BLACK;
+		break;
+	case 3:
+		flags |= SPAN_BACKDROP;
+		break;
+	}
+
+	if (glRenderer->nSpans == GB_GL_MAX_SPANS) {
+		_drawSpans(glRenderer);
+	}
+	GLint* span = glRenderer->spans[glRenderer->nSpans];
+	++glRenderer->nSpans;
+	memset(span, 0, sizeof(glRenderer->spans[0]));
+	if (glRenderer->model >= GB_MODEL_CGB) {
+		flags |= SPAN_CGB;
+	}
+	if ((glRenderer->model & (GB_MODEL_SGB | GB_MODEL_CGB)) == GB_MODEL_SGB) {
+		flags |= SPAN_SGB_PALETTES;
+		const uint8_t* attributes = &renderer->sgbAttributes[5 * (y >> 3)];
+		span[10] = attributes[0] | (attributes[1] << 8) | (attributes[2] << 16) | ((GLint) attributes[3] << 24);
+		span[11] = attributes[4];
+	}
+	if (glRenderer->borderActive && !renderer->sgbRenderMode) {
+		flags |= SPAN_BORDER;
+	}
+
+	span[0] = y;
+	span[1] = startX;
+	span[2] = endX;
+	span[3] = flags;
+	span[4] = glRenderer->scx - glRenderer->offsetScx;
+	span[5] = glRenderer->scy + y - glRenderer->offsetScy;
+	span[6] = winX;
+	span[7] = -(glRenderer->wx + glRenderer->currentWx - 7) - glRenderer->offsetWx;
+	span[8] = y - wy - glRenderer->offsetWy;
+
+	const uint8_t* lookup = glRenderer->lookup;
+	span[12] = lookup[0] | (lookup[1] << 8) | (lookup[2] << 16) | ((GLint) lookup[3] << 24);
+	span[13] = lookup[PAL_OBJ + 0] | (lookup[PAL_OBJ + 1] << 8) | (lookup[PAL_OBJ + 2] << 16) | ((GLint) lookup[PAL_OBJ + 3] << 24);
+	span[14] = lookup[PAL_OBJ + 4] | (lookup[PAL_OBJ + 5] << 8) | (lookup[PAL_OBJ + 6] << 16) | ((GLint) lookup[PAL_OBJ + 7] << 24);
+
+	if (GBRegisterLCDCIsObjEnable(glRenderer->lcdc) && !renderer->disableOBJ) {
+		_queueObjects(glRenderer, span, startX, endX, y);
+	}
+}
+
+static void GBVideoGLRendererFinishScanline(struct GBVideoRenderer* renderer, int y) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+
+	glRenderer->lastX = 0;
+	glRenderer->currentWx = 0;
+
+	if (glRenderer->sgbTransfer != 1) {
+		return;
+	}
+	size_t offset = 2 * ((y & 7) + (y >> 3) * GB_VIDEO_HORIZONTAL_PIXELS);
+	if (offset >= 0x1000) {
+		return;
+	}
+	uint8_t* buffer = NULL;
+	switch (glRenderer->sgbCommandHeader >> 3) {
+	case SGB_PAL_TRN:
+		buffer = renderer->sgbPalRam;
+		break;
+	case SGB_CHR_TRN:
+		buffer = &renderer->sgbCharRam[SGB_SIZE_CHAR_RAM / 2 * (glRenderer->sgbPacket[1] & 1)];
+		break;
+	case SGB_PCT_TRN:
+		buffer = renderer->sgbMapRam;
+		break;
+	case SGB_ATTR_TRN:
+		buffer = renderer->sgbAttributeFiles;
+		break;
+	default:
+		return;
+	}
+	int i;
+	for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS; i += 8) {
+		if (UNLIKELY(offset + (i << 1) + 1 >= 0x1000)) {
+			break;
+		}
+		uint8_t hi = 0;
+		uint8_t lo = 0;
+		int j;
+		for (j = 0; j < 8; ++j) {
+			hi |= ((glRenderer->row[i + j] >> 1) & 1) << (7 - j);
+			lo |= (glRenderer->row[i + j] & 1) << (7 - j);
+		}
+		buffer[offset + (i << 1) + 0] = lo;
+		buffer[offset + (i << 1) + 1] = hi;
+	}
+}
+
+static void GBVideoGLRendererFinishFrame(struct GBVideoRenderer* renderer) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	_drawSpans(glRenderer);
+
+	if (!GBRegisterLCDCIsEnable(glRenderer->lcdc) && !(glRenderer->model & GB_MODEL_SGB) && glRenderer->outputTex != (GLuint) -1) {
+		uint8_t backdrop[4];
+		memcpy(backdrop, &glRenderer->palette[0], sizeof(backdrop));
+		glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo);
+		glDisable(GL_SCISSOR_TEST);
+		glClearColor(backdrop[0] / 255.f, backdrop[1] / 255.f, backdrop[2] / 255.f, 1.f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+	if (glRenderer->model & GB_MODEL_SGB) {
+		switch (glRenderer->sgbCommandHeader >> 3) {
+		case SGB_PAL_SET:
+		case SGB_ATTR_SET:
+			if (glRenderer->sgbPacket[1] & 0x40) {
+				renderer->sgbRenderMode = 0;
+				if (glRenderer->sgbBorders) {
+					_regenerateSGBBorder(glRenderer);
+				}
+			}
+			break;
+		case SGB_PAL_TRN:
+		case SGB_CHR_TRN:
+		case SGB_PCT_TRN:
+		case SGB_ATRC_EN:
+		case SGB_MASK_EN:
+			if (glRenderer->sgbBorders && !renderer->sgbRenderMode) {
+				_regenerateSGBBorder(glRenderer);
+			}
+			// Fall through
+		case SGB_ATTR_TRN:
+			++glRenderer->sgbTransfer;
+			if (glRenderer->sgbTransfer == 5) {
+				glRenderer->sgbCommandHeader = 0;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	glRenderer->lastY = GB_VIDEO_VERTICAL_PIXELS;
+	glRenderer->lastX = 0;
+	glRenderer->currentWy = 0;
+	glRenderer->currentWx = 0;
+	glRenderer->hasWindow = false;
+}
+
+static void GBVideoGLRendererEnableSGBBorder(struct GBVideoRenderer* renderer, bool enable) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (!(glRenderer->model & GB_MODEL_SGB) || enable == glRenderer->sgbBorders) {
+		return;
+	}
+	_drawSpans(glRenderer);
+	glRenderer->sgbBorders = enable;
+	glRenderer->borderActive = false;
+	if (glRenderer->temporaryBuffer) {
+		mappedMemoryFree(glRenderer->temporaryBuffer, glRenderer->temporaryBufferSize);
+		glRenderer->temporaryBuffer = NULL;
+	}
+	if (glRenderer->outputTex != (GLuint) -1) {
+		_initFramebuffer(glRenderer);
+	}
+	if (glRenderer->sgbBorders && !renderer->sgbRenderMode) {
+		_regenerateSGBBorder(glRenderer);
+	}
+}
+
+static void _uploadVram(struct GBVideoGLRenderer* renderer) {
+	// Everything from the first to the last dirty block goes up at once, as VRAM is only 16 KiB
+	int first = ctz32(renderer->vramDirty);
+	int last = 31 - clz32(renderer->vramDirty);
+	renderer->vramDirty = 0;
+	glBindTexture(GL_TEXTURE_2D, renderer->vramTex);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first * 2, 256, (last + 1 - first) * 2, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &renderer->d.vram[first * 512]);
+}
+
+static void _prepareFramebuffer(struct GBVideoGLRenderer* renderer) {
+	if (renderer->outputTexDirty) {
+		_initFramebuffer(renderer);
+	}
+	int width, height;
+	_outputSize(renderer, &width, &height);
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer->fbo);
+	glViewport(0, 0, width * renderer->scale, height * renderer->scale);
+	glDisable(GL_SCISSOR_TEST);
+	glDisable(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_STENCIL_TEST);
+	if (renderer->paletteDirty) {
+		glBindTexture(GL_TEXTURE_2D, renderer->paletteTex);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 128, 1, GL_RGBA, GL_UNSIGNED_BYTE, renderer->palette);
+		renderer->paletteDirty = false;
+	}
+}
+
+static void _drawSpans(struct GBVideoGLRenderer* renderer) {
+	if (!renderer->nSpans) {
+		return;
+	}
+	if (renderer->outputTex == (GLuint) -1) {
+		renderer->nSpans = 0;
+		return;
+	}
+	_prepareFramebuffer(renderer);
+	if (renderer->vramDirty) {
+		glActiveTexture(GL_TEXTURE0);
+		_uploadVram(renderer);
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, renderer->spanTex);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GB_GL_SPAN_TEXELS, renderer->nSpans, GL_RGBA_INTEGER, GL_INT, renderer->spans);
+	glActiveTexture(GL_TEXTURE0 + 1);
+	glBindTexture(GL_TEXTURE_2D, renderer->vramTex);
+	glActiveTexture(GL_TEXTURE0 + 2);
+	glBindTexture(GL_TEXTURE_2D, renderer->paletteTex);
+	glActiveTexture(GL_TEXTURE0 + 3);
+	glBindTexture(GL_TEXTURE_2D, renderer->borderTex);
+
+	int width, height;
+	_outputSize(renderer, &width, &height);
+	const struct GBVideoGLShader* shader = &renderer->spanShader;
+	const GLuint* uniforms = shader->uniforms;
+	glUseProgram(shader->program);
+	glBindVertexArray(shader->vao);
+	glUniform1i(uniforms[GB_GL_VS_SPANS], 0);
+	glUniform1i(uniforms[GB_GL_SPAN_VRAM], 1);
+	glUniform1i(uniforms[GB_GL_SPAN_PALETTE], 2);
+	glUniform1i(uniforms[GB_GL_SPAN_BORDER], 3);
+	glUniform1i(uniforms[GB_GL_SPAN_SCALE], renderer->scale);
+	glUniform2i(uniforms[GB_GL_VS_DIMS], width, height);
+	if (_hasBorder(renderer)) {
+		glUniform2i(uniforms[GB_GL_VS_ORIGIN], SGB_ORIGIN_X, SGB_ORIGIN_Y);
+	} else {
+		glUniform2i(uniforms[GB_GL_VS_ORIGIN], 0, 0);
+	}
+	glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, renderer->nSpans);
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	renderer->nSpans = 0;
+}
+
+static void _regenerateSGBBorder(struct GBVideoGLRenderer* renderer) {
+	_drawSpans(renderer);
+	int i;
+	for (i = 0; i < 0x40; ++i) {
+		uint16_t color;
+		LOAD_16LE(color, 0x800 + i * 2, renderer->d.sgbMapRam);
+		renderer->d.writePalette(&renderer->d, i + PAL_SGB_BORDER, color);
+	}
+
+	if (!renderer->borderIndices) {
+		renderer->borderIndices = anonymousMemoryMap(SGB_VIDEO_HORIZONTAL_PIXELS * SGB_VIDEO_VERTICAL_PIXELS);
+	}
+	uint32_t overlayMask[GB_VIDEO_VERTICAL_PIXELS / 8];
+	GBVideoRendererDecodeSGBBorder(&renderer->d, renderer->borderIndices, overlayMask);
+	renderer->borderActive = true;
+	if (renderer->outputTex == (GLuint) -1) {
+		return;
+	}
+	_prepareFramebuffer(renderer);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, renderer->borderTex);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, SGB_VIDEO_HORIZONTAL_PIXELS, SGB_VIDEO_VERTICAL_PIXELS, GL_RED_INTEGER, GL_UNSIGNED_BYTE, renderer->borderIndices);
+	glActiveTexture(GL_TEXTURE0 + 1);
+	glBindTexture(GL_TEXTURE_2D, renderer->paletteTex);
+
+	const struct GBVideoGLShader* shader = &renderer->borderShader;
+	const GLuint* uniforms = shader->uniforms;
+	glUseProgram(shader->program);
+	glBindVertexArray(shader->vao);
+	glUniform1i(uniforms[GB_GL_BORDER_BORDER], 0);
+	glUniform1i(uniforms[GB_GL_BORDER_PALETTE], 1);
+	glUniform1i(uniforms[GB_GL_BORDER_SCALE], renderer->scale);
+	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static void GBVideoGLRendererGetPixels(struct GBVideoRenderer* renderer, size_t* stride, const void** pixels) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	int width, height;
+	_outputSize(glRenderer, &width, &height);
+	width *= glRenderer->scale;
+	height *= glRenderer->scale;
+	*stride = width;
+	if (!glRenderer->temporaryBuffer) {
+		glRenderer->temporaryBufferSize = width * height * BYTES_PER_PIXEL;
+		glRenderer->temporaryBuffer = anonymousMemoryMap(glRenderer->temporaryBufferSize);
+	}
+	_drawSpans(glRenderer);
+	glFinish();
+	glBindFramebuffer(GL_FRAMEBUFFER, glRenderer->fbo);
+	glPixelStorei(GL_PACK_ROW_LENGTH, width);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*) glRenderer->temporaryBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	*pixels = glRenderer->temporaryBuffer;
+}
+
+static void GBVideoGLRendererPutPixels(struct GBVideoRenderer* renderer, size_t stride, const void* pixels) {
+	struct GBVideoGLRenderer* glRenderer = (struct GBVideoGLRenderer*) renderer;
+	if (glRenderer->outputTex == (GLuint) -1) {
+		return;
+	}
+	if (glRenderer->outputTexDirty) {
+		_initFramebuffer(glRenderer);
+	}
+	int width, height;
+	_outputSize(glRenderer, &width, &height);
+	glBindTexture(GL_TEXTURE_2D, glRenderer->outputTex);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width * glRenderer->scale, height * glRenderer->scale, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+void GBVideoGLRendererSetScale(struct GBVideoGLRenderer* renderer, int scale) {
+	if (scale == renderer->scale) {
+		return;
+	}
+	_drawSpans(renderer);
+	if (renderer->temporaryBuffer) {
+		mappedMemoryFree(renderer->temporaryBuffer, renderer->temporaryBufferSize);
+		renderer->temporaryBuffer = NULL;
+	}
+	renderer->scale = scale;
+	if (renderer->outputTex != (GLuint) -1) {
+		_initFramebuffer(renderer);
+	}
+	if (renderer->borderActive && !renderer->d.sgbRenderMode) {
+		_regenerateSGBBorder(renderer);
+	}
+}
+
+#endif
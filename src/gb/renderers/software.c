@@ -20,6 +20,13 @@
 #define OBJ_PRIORITY 0x100
 #define OBJ_PRIO_MASK 0x0FF
 
+#define SGB_BORDER_WIDTH 256
+#define SGB_BORDER_HEIGHT 224
+// Only the first 32x28 entries of map RAM are tiles; the rest is palettes, which are reloaded on each redraw
+#define SGB_BORDER_MAP_SIZE (32 * 28 * 2)
+// Decoded indices, followed by copies of the char and map RAM they were decoded from
+#define SGB_BORDER_CACHE_SIZE (SGB_BORDER_WIDTH * SGB_BORDER_HEIGHT + SGB_SIZE_CHAR_RAM + SGB_BORDER_MAP_SIZE)
+
 static void GBVideoSoftwareRendererInit(struct GBVideoRenderer* renderer, enum GBModel model, bool borders);
 static void GBVideoSoftwareRendererDeinit(struct GBVideoRenderer* renderer);
 static uint8_t GBVideoSoftwareRendererWriteVideoRegister(struct GBVideoRenderer* renderer, uint16_t address, uint8_t value);
@@ -37,6 +44,44 @@ static void GBVideoSoftwareRendererPutPixels(struct GBVideoRenderer* renderer, s
 static void GBVideoSoftwareRendererDrawBackground(struct GBVideoSoftwareRenderer* renderer, uint8_t* maps, int startX, int endX, int sx, int sy, bool highlight);
 static void GBVideoSoftwareRendererDrawObj(struct GBVideoSoftwareRenderer* renderer, struct GBVideoRendererSprite* obj, int startX, int endX, int y);
 
+#define EXPAND(N) { ((N) >> 3) & 1, ((N) >> 2) & 1, ((N) >> 1) & 1, (N) & 1 }
+#define EXPAND_FLIP(N) { (N) & 1, ((N) >> 1) & 1, ((N) >> 2) & 1, ((N) >> 3) & 1 }
+
+// Four pixels of one bitplane, one bit per pixel, leftmost pixel first
+static const uint16_t _tileRowExpand[16][4] = {
+	EXPAND(0x0), EXPAND(0x1), EXPAND(0x2), EXPAND(0x3), EXPAND(0x4), EXPAND(0x5), EXPAND(0x6), EXPAND(0x7),
+	EXPAND(0x8), EXPAND(0x9), EXPAND(0xA), EXPAND(0xB), EXPAND(0xC), EXPAND(0xD), EXPAND(0xE), EXPAND(0xF),
+};
+
+static const uint16_t _tileRowExpandFlip[16][4] = {
+	EXPAND_FLIP(0x0), EXPAND_FLIP(0x1), EXPAND_FLIP(0x2), EXPAND_FLIP(0x3), EXPAND_FLIP(0x4), EXPAND_FLIP(0x5), EXPAND_FLIP(0x6), EXPAND_FLIP(0x7),
+	EXPAND_FLIP(0x8), EXPAND_FLIP(0x9), EXPAND_FLIP(0xA), EXPAND_FLIP(0xB), EXPAND_FLIP(0xC), EXPAND_FLIP(0xD), EXPAND_FLIP(0xE), EXPAND_FLIP(0xF),
+};
+
+#undef EXPAND
+#undef EXPAND_FLIP
+
+// Decodes a whole 2bpp tile row four pixels at a time. Each lane only ever holds a bit from each
+// plane plus the attributes, so planes can be shifted and merged across all four lanes at once.
+static inline void _expandTileRow(uint16_t* row, uint8_t lower, uint8_t upper, uint16_t attributes, bool flip) {
+	const uint16_t (*table)[4] = flip ? _tileRowExpandFlip : _tileRowExpand;
+	unsigned leftShift = flip ? 0 : 4;
+	unsigned rightShift = flip ? 4 : 0;
+	uint64_t fill = attributes * 0x0001000100010001ULL;
+	uint64_t pixels;
+	uint64_t plane;
+
+	memcpy(&pixels, table[(lower >> leftShift) & 0xF], sizeof(pixels));
+	memcpy(&plane, table[(upper >> leftShift) & 0xF], sizeof(plane));
+	pixels |= (plane << 1) | fill;
+	memcpy(&row[0], &pixels, sizeof(pixels));
+
+	memcpy(&pixels, table[(lower >> rightShift) & 0xF], sizeof(pixels));
+	memcpy(&plane, table[(upper >> rightShift) & 0xF], sizeof(plane));
+	pixels |= (plane << 1) | fill;
+	memcpy(&row[4], &pixels, sizeof(pixels));
+}
+
 static void _clearScreen(struct GBVideoSoftwareRenderer* renderer) {
 	size_t sgbOffset = 0;
 	if (renderer->model & GB_MODEL_SGB) {
@@ -55,6 +100,15 @@ static void _clearScreen(struct GBVideoSoftwareRenderer* renderer) {
 	}
 }
 
+static void _drawSGBBorderSpan(struct GBVideoSoftwareRenderer* renderer, color_t* output, const uint8_t* indices, int width) {
+	int x;
+	for (x = 0; x < width; ++x) {
+		if (!(indices[x] & SGB_BORDER_SKIP)) {
+			output[x] = renderer->palette[indices[x]];
+		}
+	}
+}
+
 static void _regenerateSGBBorder(struct GBVideoSoftwareRenderer* renderer) {
 	int i;
 	for (i = 0; i < 0x40; ++i) {
@@ -62,127 +116,32 @@ static void _regenerateSGBBorder(struct GBVideoSoftwareRenderer* renderer) {
 		LOAD_16LE(color, 0x800 + i * 2, renderer->d.sgbMapRam);
 		renderer->d.writePalette(&renderer->d, i + PAL_SGB_BORDER, color);
 	}
-	int x, y;
-	for (y = 0; y < 224; ++y) {
-		int localY = y & 0x7;
-		if (!localY && y >= 40 && y < 184) {
-			renderer->sgbBorderMask[(y - 40) >> 3] = 0;
-		}
-		for (x = 0; x < 256; x += 8) {
-			uint16_t mapData;
-			LOAD_16LE(mapData, (x >> 2) + (y & ~7) * 8, renderer->d.sgbMapRam);
-			if (UNLIKELY(SGBBgAttributesGetTile(mapData) >= 0x100)) {
-				continue;
-			}
-
-			if (x >= 48 && x < 208 && y >= 40 && y < 184) {
-				if (!localY) {
-					unsigned tileBase = SGBBgAttributesGetTile(mapData) * 8;
-					uint32_t bits = 0;
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 0];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 1];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 2];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 3];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 4];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 5];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 6];
-					bits |= ((uint32_t*) renderer->d.sgbCharRam)[tileBase + 7];
-					if (bits) {
-						renderer->sgbBorderMask[(y - 40) >> 3] |= 1 << ((x - 48) >> 3);
-					}
-				}
-				continue;
-			}
-
-			int yFlip = 0;
-			if (SGBBgAttributesIsYFlip(mapData)) {
-				yFlip = 7;
-			}
-			unsigned tileBase = (SGBBgAttributesGetTile(mapData) * 16 + (localY ^ yFlip)) * 2;
-			uint8_t tileData[4];
-			tileData[0] = renderer->d.sgbCharRam[tileBase + 0x00];
-			tileData[1] = renderer->d.sgbCharRam[tileBase + 0x01];
-			tileData[2] = renderer->d.sgbCharRam[tileBase + 0x10];
-			tileData[3] = renderer->d.sgbCharRam[tileBase + 0x11];
 
-			size_t base = y * renderer->outputBufferStride + x;
-			int paletteBase = SGBBgAttributesGetPalette(mapData) * 0x10;
-			int colorSelector;
-
-			int xFlip = 0;
-			if (SGBBgAttributesIsXFlip(mapData)) {
-				xFlip = 7;
-			}
-			for (i = 7; i >= 0; --i) {
-				colorSelector = (tileData[0] >> i & 0x1) << 0 | (tileData[1] >> i & 0x1) << 1 | (tileData[2] >> i & 0x1) << 2 | (tileData[3] >> i & 0x1) << 3;
-				renderer->outputBuffer[(base + 7 - i) ^ xFlip] = renderer->palette[paletteBase | colorSelector];
-			}
-		}
+	// Decoding the tiles is most of the work, and they rarely change between redraws
+	if (!renderer->sgbBorderCache) {
+		renderer->sgbBorderCache = anonymousMemoryMap(SGB_BORDER_CACHE_SIZE);
+		renderer->sgbBorderCacheValid = false;
 	}
-}
-
-static inline void _setAttribute(uint8_t* sgbAttributes, unsigned x, unsigned y, int palette) {
-	int p = sgbAttributes[(x >> 2) + 5 * y];
-	p &= ~(3 << (2 * (3 - (x & 3))));
-	p |= palette << (2 * (3 - (x & 3)));
-	sgbAttributes[(x >> 2) + 5 * y] = p;
-}
-
-static void _parseAttrBlock(struct GBVideoSoftwareRenderer* renderer, int start) {
-	uint8_t block[6];
-	memcpy(block, &renderer->sgbPacket[start], 6);
-	unsigned x0 = block[2];
-	unsigned x1 = block[4];
-	unsigned y0 = block[3];
-	unsigned y1 = block[5];
-	unsigned x, y;
-	int pIn = block[1] & 3;
-	int pPerim = (block[1] >> 2) & 3;
-	int pOut = (block[1] >> 4) & 3;
-
-	for (y = 0; y < GB_VIDEO_VERTICAL_PIXELS / 8; ++y) {
-		for (x = 0; x < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++x) {
-			if (y > y0 && y < y1 && x > x0 && x < x1) {
-				if (block[0] & 1) {
-					_setAttribute(renderer->d.sgbAttributes, x, y, pIn);
-				}
-			} else if (y < y0 || y > y1 || x < x0 || x > x1) {
-				if (block[0] & 4) {
-					_setAttribute(renderer->d.sgbAttributes, x, y, pOut);
-				}
-			} else {
-				if (block[0] & 2) {
-					_setAttribute(renderer->d.sgbAttributes, x, y, pPerim);
-				} else if (block[0] & 1) {
-					_setAttribute(renderer->d.sgbAttributes, x, y, pIn);
-				} else if (block[0] & 4) {
-					_setAttribute(renderer->d.sgbAttributes, x, y, pOut);
-				}
-			}
-		}
+	uint8_t* charRam = &renderer->sgbBorderCache[SGB_BORDER_WIDTH * SGB_BORDER_HEIGHT];
+	uint8_t* mapRam = &charRam[SGB_SIZE_CHAR_RAM];
+	if (!renderer->sgbBorderCacheValid ||
+	    memcmp(charRam, renderer->d.sgbCharRam, SGB_SIZE_CHAR_RAM) != 0 ||
+	    memcmp(mapRam, renderer->d.sgbMapRam, SGB_BORDER_MAP_SIZE) != 0) {
+		memcpy(charRam, renderer->d.sgbCharRam, SGB_SIZE_CHAR_RAM);
+		memcpy(mapRam, renderer->d.sgbMapRam, SGB_BORDER_MAP_SIZE);
+		GBVideoRendererDecodeSGBBorder(&renderer->d, renderer->sgbBorderCache, renderer->sgbBorderMask);
+		renderer->sgbBorderCacheValid = true;
 	}
-}
 
-static void _parseAttrLine(struct GBVideoSoftwareRenderer* renderer, int start) {
-	uint8_t byte = renderer->sgbPacket[start];
-	unsigned line = byte & 0x1F;
-	int pal = (byte >> 5) & 3;
-
-	if (byte & 0x80) {
-		if (line > GB_VIDEO_VERTICAL_PIXELS / 8) {
-			return;
-		}
-		int x;
-		for (x = 0; x < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++x) {
-			_setAttribute(renderer->d.sgbAttributes, x, line, pal);
-		}
-	} else {
-		if (line > GB_VIDEO_HORIZONTAL_PIXELS / 8) {
-			return;
-		}
-		int y;
-		for (y = 0; y < GB_VIDEO_VERTICAL_PIXELS / 8; ++y) {
-			_setAttribute(renderer->d.sgbAttributes, line, y, pal);
+	int y;
+	for (y = 0; y < SGB_BORDER_HEIGHT; ++y) {
+		color_t* output = &renderer->outputBuffer[y * renderer->outputBufferStride];
+		const uint8_t* indices = &renderer->sgbBorderCache[y * SGB_BORDER_WIDTH];
+		if (y >= 40 && y < 184) {
+			_drawSGBBorderSpan(renderer, output, indices, 48);
+			_drawSGBBorderSpan(renderer, &output[208], &indices[208], 48);
+		} else {
+			_drawSGBBorderSpan(renderer, output, indices, SGB_BORDER_WIDTH);
 		}
 	}
 }
@@ -219,7 +178,9 @@ void GBVideoSoftwareRendererCreate(struct GBVideoSoftwareRenderer* renderer) {
 	renderer->d.highlightColor = M_COLOR_WHITE;
 	renderer->d.highlightAmount = 0;
 
+	renderer->colorTable = NULL;
 	renderer->temporaryBuffer = 0;
+	renderer->sgbBorderCache = NULL;
 }
 
 static void GBVideoSoftwareRendererInit(struct GBVideoRenderer* renderer, enum GBModel model, bool sgbBorders) {
@@ -255,13 +216,17 @@ static void GBVideoSoftwareRendererInit(struct GBVideoRenderer* renderer, enum G
 
 	memset(softwareRenderer->palette, 0, sizeof(softwareRenderer->palette));
 	memset(softwareRenderer->sgbBorderMask, 0, sizeof(softwareRenderer->sgbBorderMask));
+	softwareRenderer->sgbBorderCacheValid = false;
 
 	softwareRenderer->lastHighlightAmount = 0;
 }
 
 static void GBVideoSoftwareRendererDeinit(struct GBVideoRenderer* renderer) {
 	struct GBVideoSoftwareRenderer* softwareRenderer = (struct GBVideoSoftwareRenderer*) renderer;
-	UNUSED(softwareRenderer);
+	if (softwareRenderer->sgbBorderCache) {
+		mappedMemoryFree(softwareRenderer->sgbBorderCache, SGB_BORDER_CACHE_SIZE);
+		softwareRenderer->sgbBorderCache = NULL;
+	}
 }
 
 static void GBVideoSoftwareRendererUpdateWindow(struct GBVideoSoftwareRenderer* renderer, bool before, bool after, uint8_t oldWy) {
@@ -354,145 +319,24 @@ static uint8_t GBVideoSoftwareRendererWriteVideoRegister(struct GBVideoRenderer*
 static void GBVideoSoftwareRendererWriteSGBPacket(struct GBVideoRenderer* renderer, uint8_t* data) {
 	struct GBVideoSoftwareRenderer* softwareRenderer = (struct GBVideoSoftwareRenderer*) renderer;
 	memcpy(softwareRenderer->sgbPacket, data, sizeof(softwareRenderer->sgbPacket));
-	int i;
 	softwareRenderer->sgbCommandHeader = data[0];
 	softwareRenderer->sgbTransfer = 0;
-	int set;
-	int sets;
-	int attrX;
-	int attrY;
-	int attrDirection;
-	int pBefore;
-	int pAfter;
-	int pDiv;
+	GBVideoRendererParseSGBAttributes(renderer, softwareRenderer->sgbPacket);
 	switch (softwareRenderer->sgbCommandHeader >> 3) {
-	case SGB_PAL_SET:
-		softwareRenderer->sgbPacket[1] = data[9];
-		if (!(data[9] & 0x80)) {
-			break;
-		}
-		// Fall through
-	case SGB_ATTR_SET:
-		set = softwareRenderer->sgbPacket[1] & 0x3F;
-		if (set <= 0x2C) {
-			memcpy(renderer->sgbAttributes, &renderer->sgbAttributeFiles[set * 90], 90);
-		}
-		break;
-	case SGB_ATTR_BLK:
-		sets = softwareRenderer->sgbPacket[1];
-		i = 2;
-		for (; i < (softwareRenderer->sgbCommandHeader & 7) << 4 && sets; i += 6, --sets) {
-			_parseAttrBlock(softwareRenderer, i);
-		}
-		break;
-	case SGB_ATTR_LIN:
-		sets = softwareRenderer->sgbPacket[1];
-		i = 2;
-		for (; i < (softwareRenderer->sgbCommandHeader & 7) << 4 && sets; ++i, --sets) {
-			_parseAttrLine(softwareRenderer, i);
-		}
-		break;
-	case SGB_ATTR_DIV:
-		pAfter = softwareRenderer->sgbPacket[1] & 3;
-		pBefore = (softwareRenderer->sgbPacket[1] >> 2) & 3;
-		pDiv = (softwareRenderer->sgbPacket[1] >> 4) & 3;
-		attrX = softwareRenderer->sgbPacket[2];
-		if (softwareRenderer->sgbPacket[1] & 0x40) {
-			if (attrX > GB_VIDEO_VERTICAL_PIXELS / 8) {
-				attrX = GB_VIDEO_VERTICAL_PIXELS / 8;
-			}
-			int j;
-			for (j = 0; j < attrX; ++j) {
-				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
-					_setAttribute(renderer->sgbAttributes, i, j, pBefore);
-				}
-			}
-			if (attrX < GB_VIDEO_VERTICAL_PIXELS / 8) {
-				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
-					_setAttribute(renderer->sgbAttributes, i, attrX, pDiv);
-				}
-
-			}
-			for (; j < GB_VIDEO_VERTICAL_PIXELS / 8; ++j) {
-				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
-					_setAttribute(renderer->sgbAttributes, i, j, pAfter);
-				}
-			}
-		} else {
-			if (attrX > GB_VIDEO_HORIZONTAL_PIXELS / 8) {
-				attrX = GB_VIDEO_HORIZONTAL_PIXELS / 8;
-			}
-			int j;
-			for (j = 0; j < attrX; ++j) {
-				for (i = 0; i < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++i) {
-					_setAttribute(renderer->sgbAttributes, j, i, pBefore);
-				}
-			}
-			if (attrX < GB_VIDEO_HORIZONTAL_PIXELS / 8) {
-				for (i = 0; i < GB_VIDEO_VERTICAL_PIXELS / 8; ++i) {
-					_setAttribute(renderer->sgbAttributes, attrX, i, pDiv);
-				}
-
-			}
-			for (; j < GB_VIDEO_HORIZONTAL_PIXELS / 8; ++j) {
-				for (i = 0; i < GB_VIDEO_VERTICAL_PIXELS / 8; ++i) {
-					_setAttribute(renderer->sgbAttributes, j, i, pAfter);
-				}
-			}
-		}
-		break;
-	case SGB_ATTR_CHR:
-		attrX = softwareRenderer->sgbPacket[1];
-		attrY = softwareRenderer->sgbPacket[2];
-		if (attrX >= GB_VIDEO_HORIZONTAL_PIXELS / 8) {
-			attrX = 0;
-		}
-		if (attrY >= GB_VIDEO_VERTICAL_PIXELS / 8) {
-			attrY = 0;
-		}
-		sets = softwareRenderer->sgbPacket[3];
-		sets |= softwareRenderer->sgbPacket[4] << 8;
-		attrDirection = softwareRenderer->sgbPacket[5];
-		i = 6;
-		for (; i < (softwareRenderer->sgbCommandHeader & 7) << 4 && sets; ++i) {
-			int j;
-			for (j = 0; j < 4 && sets; ++j, --sets) {
-				uint8_t p = softwareRenderer->sgbPacket[i] >> (6 - j * 2);
-				_setAttribute(renderer->sgbAttributes, attrX, attrY, p & 3);
-				if (attrDirection) {
-					++attrY;
-					if (attrY >= GB_VIDEO_VERTICAL_PIXELS / 8) {
-						attrY = 0;
-						++attrX;
-					}
-					if (attrX >= GB_VIDEO_HORIZONTAL_PIXELS / 8) {
-						attrX = 0;
-					}
-				} else {
-					++attrX;
-					if (attrX >= GB_VIDEO_HORIZONTAL_PIXELS / 8) {
-						attrX = 0;
-						++attrY;
-					}
-					if (attrY >= GB_VIDEO_VERTICAL_PIXELS / 8) {
-						attrY = 0;
-					}
-				}
-			}
-		}
-
-		break;
 	case SGB_ATRC_EN:
 	case SGB_MASK_EN:
 		if (softwareRenderer->sgbBorders && !renderer->sgbRenderMode) {
 			_regenerateSGBBorder(softwareRenderer);
 		}
+		break;
+	default:
+		break;
 	}
 }
 
 static void GBVideoSoftwareRendererWritePalette(struct GBVideoRenderer* renderer, int index, uint16_t value) {
 	struct GBVideoSoftwareRenderer* softwareRenderer = (struct GBVideoSoftwareRenderer*) renderer;
-	color_t color = mColorFrom555(value);
+	color_t color = softwareRenderer->colorTable ? softwareRenderer->colorTable[value & 0x7FFF] : mColorFrom555(value);
 	if (softwareRenderer->model & GB_MODEL_SGB) {
 		if (index >= PAL_SGB_BORDER && !(index & 0xF)) {
 			color = softwareRenderer->palette[0];
@@ -518,7 +362,7 @@ static void GBVideoSoftwareRendererWritePalette(struct GBVideoRenderer* renderer
 		r /= 31;
 		g /= 31;
 		b /= 31;
-		color = mColorFrom555(r | (g << 5) | (b << 10));
+		color = softwareRenderer->colorTable ? softwareRenderer->colorTable[r | (g << 5) | (b << 10)] : mColorFrom555(r | (g << 5) | (b << 10));
 #else
 		r >>= 2;
 		r += r >> 4;
@@ -527,8 +371,13 @@ static void GBVideoSoftwareRendererWritePalette(struct GBVideoRenderer* renderer
 		b >>= 2;
 		b += b >> 4;
 		color = r | (g << 8) | (b << 16);
+		if (softwareRenderer->colorTable) {
+			// Tables only ever differ from the native format by having red and blue swapped
+			color = mColorSwapRedBlue(color);
+		}
 #endif
 	}
+	bool backdropChanged = !index && softwareRenderer->palette[0] != color;
 	softwareRenderer->palette[index] = color;
 	if (index < PAL_SGB_BORDER && (index < PAL_OBJ || (index & 3))) {
 		softwareRenderer->palette[index + PAL_HIGHLIGHT] = mColorMix5Bit(0x10 - softwareRenderer->lastHighlightAmount, color, softwareRenderer->lastHighlightAmount, renderer->highlightColor);
@@ -544,7 +393,8 @@ static void GBVideoSoftwareRendererWritePalette(struct GBVideoRenderer* renderer
 			renderer->writePalette(renderer, 0x60, value);
 			renderer->writePalette(renderer, 0x70, value);
 		}
-		if (softwareRenderer->sgbBorders && !renderer->sgbRenderMode) {
+		// The border only uses the backdrop color, so there's nothing to redraw if it's the same
+		if (backdropChanged && softwareRenderer->sgbBorders && !renderer->sgbRenderMode) {
 			_regenerateSGBBorder(softwareRenderer);
 		}
 	}
@@ -562,49 +412,6 @@ static void GBVideoSoftwareRendererWriteOAM(struct GBVideoRenderer* renderer, ui
 	// Nothing to do
 }
 
-static void _cleanOAM(struct GBVideoSoftwareRenderer* renderer, int y) {
-	// TODO: GBC differences
-	// TODO: Optimize
-	int spriteHeight = 8;
-	if (GBRegisterLCDCIsObjSize(renderer->lcdc)) {
-		spriteHeight = 16;
-	}
-	int o = 0;
-	int i;
-	int16_t ids[GB_VIDEO_MAX_LINE_OBJ];
-	for (i = 0; i < GB_VIDEO_MAX_OBJ && o < GB_VIDEO_MAX_LINE_OBJ; ++i) {
-		uint8_t oy = renderer->d.oam->obj[i].y;
-		if (y < oy - 16 || y >= oy - 16 + spriteHeight) {
-			continue;
-		}
-		ids[o] = (renderer->d.oam->obj[i].x << 7) | i;
-		++o;
-	}
-	renderer->objMax = o;
-	if (renderer->model < GB_MODEL_CGB) {
-		// Terrble n^2 sort, but it's only 10 elements so it shouldn't be that bad
-		int16_t ids2[GB_VIDEO_MAX_LINE_OBJ];
-		int min = -1;
-		int j;
-		for (i = 0; i < o; ++i) {
-			int min2 = 0xFFFF;
-			for (j = 0; j < o; ++j) {
-				if (ids[j] > min && ids[j] < min2) {
-					min2 = ids[j];
-				}
-			}
-			min = min2;
-			ids2[i] = min;
-		}
-		memcpy(ids, ids2, sizeof(ids));
-	}
-	for (i = 0; i < o; ++i) {
-		int id = ids[i] & 0x7F;
-		renderer->obj[i].obj = renderer->d.oam->obj[id];
-		renderer->obj[i].index = id;
-	}
-}
-
 static void GBVideoSoftwareRendererDrawRange(struct GBVideoRenderer* renderer, int startX, int endX, int y) {
 	struct GBVideoSoftwareRenderer* softwareRenderer = (struct GBVideoSoftwareRenderer*) renderer;
 	softwareRenderer->lastY = y;
@@ -643,7 +450,7 @@ static void GBVideoSoftwareRendererDrawRange(struct GBVideoRenderer* renderer, i
 	}
 
 	if (startX == 0) {
-		_cleanOAM(softwareRenderer, y);
+		softwareRenderer->objMax = GBVideoRendererCleanOAM(softwareRenderer->d.oam, softwareRenderer->obj, y, softwareRenderer->lcdc, softwareRenderer->model);
 	}
 	if (GBRegisterLCDCIsObjEnable(softwareRenderer->lcdc) && !softwareRenderer->d.disableOBJ) {
 		int i;
@@ -709,41 +516,14 @@ static void GBVideoSoftwareRendererDrawRange(struct GBVideoRenderer* renderer, i
 		}
 		if (softwareRenderer->sgbBorderMask[y >> 3]) {
 			uint32_t borderMask = softwareRenderer->sgbBorderMask[y >> 3];
-			int localY = y & 0x7;
-			for (x = startX; x < endX; x += 8) {
+			const uint8_t* indices = &softwareRenderer->sgbBorderCache[(y + 40) * SGB_BORDER_WIDTH + 48];
+			for (x = startX; x < endX; ++x) {
 				if (!(borderMask & (1 << (x >> 3)))) {
+					x |= 7;
 					continue;
 				}
-				uint16_t mapData;
-				LOAD_16LE(mapData, (x >> 2) + 12 + (y & ~7) * 8 + 320, softwareRenderer->d.sgbMapRam);
-				if (UNLIKELY(SGBBgAttributesGetTile(mapData) >= 0x100)) {
-					continue;
-				}
-
-				int yFlip = 0;
-				if (SGBBgAttributesIsYFlip(mapData)) {
-					yFlip = 7;
-				}
-				unsigned tileBase = (SGBBgAttributesGetTile(mapData) * 16 + (localY ^ yFlip)) * 2;
-				uint8_t tileData[4];
-				tileData[0] = softwareRenderer->d.sgbCharRam[tileBase + 0x00];
-				tileData[1] = softwareRenderer->d.sgbCharRam[tileBase + 0x01];
-				tileData[2] = softwareRenderer->d.sgbCharRam[tileBase + 0x10];
-				tileData[3] = softwareRenderer->d.sgbCharRam[tileBase + 0x11];
-
-				int paletteBase = SGBBgAttributesGetPalette(mapData) * 0x10;
-				int colorSelector;
-
-				int flip = 0;
-				if (SGBBgAttributesIsXFlip(mapData)) {
-					flip = 7;
-				}
-				int i;
-				for (i = 7; i >= 0; --i) {
-					colorSelector = (tileData[0] >> i & 0x1) << 0 | (tileData[1] >> i & 0x1) << 1 | (tileData[2] >> i & 0x1) << 2 | (tileData[3] >> i & 0x1) << 3;
-					if (colorSelector) {
-						row[(x + 7 - i) ^ flip] = softwareRenderer->palette[paletteBase | colorSelector];
-					}
+				if (indices[x] & 0xF) {
+					row[x] = softwareRenderer->palette[indices[x]];
 				}
 			}
 		}
@@ -970,6 +750,7 @@ static void GBVideoSoftwareRendererDrawBackground(struct GBVideoSoftwareRenderer
 			bgTile = ((int8_t*) maps)[topX + topY];
 		}
 		int p = highlight ? PAL_HIGHLIGHT_BG : PAL_BG;
+		bool xFlip = false;
 		if (renderer->model >= GB_MODEL_CGB) {
 			GBObjAttributes attrs = attr[topX + topY];
 			p |= GBObjAttributesGetCGBPalette(attrs) * 4;
@@ -982,30 +763,11 @@ static void GBVideoSoftwareRendererDrawBackground(struct GBVideoSoftwareRenderer
 			if (GBObjAttributesIsYFlip(attrs)) {
 				localY = 7 - bottomY;
 			}
-			if (GBObjAttributesIsXFlip(attrs)) {
-				uint8_t tileDataLower = localData[(bgTile * 8 + localY) * 2];
-				uint8_t tileDataUpper = localData[(bgTile * 8 + localY) * 2 + 1];
-				renderer->row[x + 0] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-				renderer->row[x + 1] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-				renderer->row[x + 2] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-				renderer->row[x + 3] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-				renderer->row[x + 4] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-				renderer->row[x + 5] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-				renderer->row[x + 6] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-				renderer->row[x + 7] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
-				continue;
-			}
+			xFlip = GBObjAttributesIsXFlip(attrs);
 		}
 		uint8_t tileDataLower = localData[(bgTile * 8 + localY) * 2];
 		uint8_t tileDataUpper = localData[(bgTile * 8 + localY) * 2 + 1];
-		renderer->row[x + 7] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-		renderer->row[x + 6] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-		renderer->row[x + 5] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-		renderer->row[x + 4] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-		renderer->row[x + 3] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-		renderer->row[x + 2] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-		renderer->row[x + 1] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-		renderer->row[x + 0] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
+		_expandTileRow(&renderer->row[x], tileDataLower, tileDataUpper, p, xFlip);
 	}
 }
 
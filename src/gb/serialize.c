@@ -17,6 +17,8 @@ MGBA_EXPORT const uint32_t GBSavestateMagic = 0x00400000;
 MGBA_EXPORT const uint32_t GBSavestateVersion = 0x00000003;
 
 void GBSerialize(struct GB* gb, struct GBSerializedState* state) {
+	// Bring the video mode up to date so STAT gets saved with the right mode
+	GBVideoSyncMode(&gb->video, 0);
 	STORE_32LE(GBSavestateMagic + GBSavestateVersion, 0, &state->versionMagic);
 	STORE_32LE(gb->romCrc32, 0, &state->romCrc32);
 	STORE_32LE(gb->timing.masterCycles, 0, &state->masterCycles);
@@ -58,6 +60,7 @@ void GBSerialize(struct GB* gb, struct GBSerializedState* state) {
 	STORE_32LE(flags, 0, &state->cpu.flags);
 	STORE_32LE(gb->eiPending.when - mTimingCurrentTime(&gb->timing), 0, &state->cpu.eiPending);
 
+	GBTimerSync(&gb->timer);
 	GBMemorySerialize(gb, state);
 	GBIOSerialize(gb, state);
 	GBVideoSerialize(&gb->video, state);
@@ -178,7 +181,7 @@ bool GBDeserialize(struct GB* gb, const struct GBSerializedState* state) {
 
 	LOAD_32LE(gb->cpu->cycles, 0, &state->cpu.cycles);
 	LOAD_32LE(gb->cpu->nextEvent, 0, &state->cpu.nextEvent);
-	gb->timing.root = NULL;
+	mTimingDescheduleAll(&gb->timing);
 
 	uint32_t when;
 	LOAD_32LE(when, 0, &state->cpu.eiPending);
@@ -66,6 +66,14 @@ static void _processByte(struct GBPrinter* printer) {
 	}
 }
 
+static inline uint16_t _spreadBits(uint8_t byte) {
+	uint16_t bits = byte;
+	bits = (bits | (bits << 4)) & 0x0F0F;
+	bits = (bits | (bits << 2)) & 0x3333;
+	bits = (bits | (bits << 1)) & 0x5555;
+	return bits;
+}
+
 static uint8_t GBPrinterWriteSC(struct GBSIODriver* driver, uint8_t value) {
 	struct GBPrinter* printer = (struct GBPrinter*) driver;
 	if ((value & 0x81) == 0x81) {
@@ -202,20 +210,10 @@ static uint8_t GBPrinterWriteSC(struct GBSIODriver* driver, uint8_t value) {
 					uint8_t* buffer = &printer->buffer[sizeof(lineBuffer) * y];
 					size_t i;
 					for (i = 0; i < sizeof(lineBuffer); i += 2) {
-						uint8_t ilo = buffer[i + 0x0];
-						uint8_t ihi = buffer[i + 0x1];
-						uint8_t olo = 0;
-						uint8_t ohi = 0;
-						olo |= ((ihi & 0x80) >> 0) | ((ilo & 0x80) >> 1);
-						olo |= ((ihi & 0x40) >> 1) | ((ilo & 0x40) >> 2);
-						olo |= ((ihi & 0x20) >> 2) | ((ilo & 0x20) >> 3);
-						olo |= ((ihi & 0x10) >> 3) | ((ilo & 0x10) >> 4);
-						ohi |= ((ihi & 0x08) << 4) | ((ilo & 0x08) << 3);
-						ohi |= ((ihi & 0x04) << 3) | ((ilo & 0x04) << 2);
-						ohi |= ((ihi & 0x02) << 2) | ((ilo & 0x02) << 1);
-						ohi |= ((ihi & 0x01) << 1) | ((ilo & 0x01) << 0);
-						lineBuffer[(((i >> 1) & 0x7) * GB_VIDEO_HORIZONTAL_PIXELS / 4) + ((i >> 3) & ~1)] = olo;
-						lineBuffer[(((i >> 1) & 0x7) * GB_VIDEO_HORIZONTAL_PIXELS / 4) + ((i >> 3) |  1)] = ohi;
+						// Interleave the two bitplanes so each pixel's two bits end up next to each other
+						uint16_t pixels = (_spreadBits(buffer[i + 0x1]) << 1) | _spreadBits(buffer[i + 0x0]);
+						lineBuffer[(((i >> 1) & 0x7) * GB_VIDEO_HORIZONTAL_PIXELS / 4) + ((i >> 3) & ~1)] = pixels >> 8;
+						lineBuffer[(((i >> 1) & 0x7) * GB_VIDEO_HORIZONTAL_PIXELS / 4) + ((i >> 3) |  1)] = pixels;
 					}
 					memcpy(buffer, lineBuffer, sizeof(lineBuffer));
 				}
@@ -0,0 +1,127 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/interface.h>
+#include <mgba/gb/core.h>
+#include <mgba/internal/gb/gb.h>
+#include <mgba/internal/gb/io.h>
+#include <mgba/internal/gb/memory.h>
+#include <mgba-util/hash.h>
+#include <mgba-util/vfs.h>
+
+struct HashingStream {
+	struct mAVStream d;
+	uint32_t hash;
+	unsigned samples;
+};
+
+static void _hashAudioFrame(struct mAVStream* stream, int16_t left, int16_t right) {
+	struct HashingStream* hashing = (struct HashingStream*) stream;
+	int16_t sample[2] = { left, right };
+	hashing->hash = hash32(sample, sizeof(sample), hashing->hash);
+	++hashing->samples;
+}
+
+static void _writeIO(struct mCore* core, const uint8_t* writes, size_t nWrites) {
+	size_t i;
+	for (i = 0; i < nWrites; i += 2) {
+		core->busWrite8(core, GB_BASE_IO | writes[i], writes[i + 1]);
+	}
+}
+
+static uint32_t _hashAudio(const char* model) {
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	GBSynthesizeROM(vf);
+	// Spin forever at the entry point
+	vf->seek(vf, 0x100, SEEK_SET);
+	vf->write(vf, "\x18\xFE", 2);
+
+	struct mCore* core = mCoreFindVF(vf);
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	mCoreConfigSetIntValue(&core->config, "useBios", 0);
+	mCoreConfigSetValue(&core->config, "gb.model", model);
+	assert_true(core->loadROM(core, vf));
+	struct HashingStream stream = {
+		.d = {
+			.postAudioFrame = _hashAudioFrame,
+		}
+	};
+	core->setAVStream(core, &stream.d);
+	core->reset(core);
+
+	static const uint8_t start[] = {
+		GB_REG_NR52, 0x80,
+		GB_REG_NR50, 0x77,
+		GB_REG_NR51, 0xED,
+		// Sweeping square with an envelope
+		GB_REG_NR10, 0x37,
+		GB_REG_NR11, 0x80,
+		GB_REG_NR12, 0xF3,
+		GB_REG_NR13, 0x40,
+		GB_REG_NR14, 0x87,
+		// High-pitched square
+		GB_REG_NR21, 0x40,
+		GB_REG_NR22, 0xA0,
+		GB_REG_NR23, 0xF0,
+		GB_REG_NR24, 0x87,
+		// Sawtooth wave
+		GB_REG_WAVE_0, 0x01, GB_REG_WAVE_1, 0x23, GB_REG_WAVE_2, 0x45, GB_REG_WAVE_3, 0x67,
+		GB_REG_WAVE_4, 0x89, GB_REG_WAVE_5, 0xAB, GB_REG_WAVE_6, 0xCD, GB_REG_WAVE_7, 0xEF,
+		GB_REG_WAVE_8, 0xFE, GB_REG_WAVE_9, 0xDC, GB_REG_WAVE_A, 0xBA, GB_REG_WAVE_B, 0x98,
+		GB_REG_WAVE_C, 0x76, GB_REG_WAVE_D, 0x54, GB_REG_WAVE_E, 0x32, GB_REG_WAVE_F, 0x10,
+		GB_REG_NR30, 0x80,
+		GB_REG_NR32, 0x20,
+		GB_REG_NR33, 0x00,
+		GB_REG_NR34, 0x86,
+		// Fast, long noise
+		GB_REG_NR42, 0xF1,
+		GB_REG_NR43, 0x10,
+		GB_REG_NR44, 0x80,
+	};
+	static const uint8_t change[] = {
+		GB_REG_NR51, 0xFF,
+		GB_REG_NR12, 0x8F,
+		GB_REG_NR14, 0x86,
+		GB_REG_NR32, 0x60,
+		GB_REG_NR33, 0xE0,
+		// Slower, short noise
+		GB_REG_NR42, 0xC0,
+		GB_REG_NR43, 0x4D,
+		GB_REG_NR44, 0x80,
+	};
+	_writeIO(core, start, sizeof(start));
+	int i;
+	for (i = 0; i < 20; ++i) {
+		core->runFrame(core);
+	}
+	_writeIO(core, change, sizeof(change));
+	for (i = 0; i < 20; ++i) {
+		core->runFrame(core);
+	}
+	assert_true(stream.samples > 0);
+
+	core->setAVStream(core, NULL);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	return stream.hash;
+}
+
+M_TEST_DEFINE(hashDMG) {
+	assert_int_equal(_hashAudio("DMG"), 0x4ED52DA7);
+}
+
+M_TEST_DEFINE(hashCGB) {
+	assert_int_equal(_hashAudio("CGB"), 0x5DF791DB);
+}
+
+M_TEST_SUITE_DEFINE(GBAudio,
+	cmocka_unit_test(hashDMG),
+	cmocka_unit_test(hashCGB),
+)
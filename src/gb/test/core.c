@@ -6,8 +6,11 @@
 #include "util/test/suite.h"
 
 #include <mgba/core/core.h>
+#include <mgba/core/rom-image.h>
+#include <mgba/core/timing.h>
 #include <mgba/gb/core.h>
 #include <mgba/internal/gb/gb.h>
+#include <mgba/internal/sm83/sm83.h>
 #include <mgba-util/vfs.h>
 
 M_TEST_DEFINE(create) {
@@ -59,9 +62,195 @@ M_TEST_DEFINE(isROM) {
 	core->deinit(core);
 }
 
+M_TEST_DEFINE(romRegistry) {
+	struct mROMImageRegistry registry;
+	mROMImageRegistryInit(&registry);
+
+	struct mCore* cores[2];
+	struct GB* gbs[2];
+	size_t i;
+	for (i = 0; i < 2; ++i) {
+		cores[i] = GBCoreCreate();
+		assert_non_null(cores[i]);
+		assert_true(cores[i]->init(cores[i]));
+		mCoreInitConfig(cores[i], NULL);
+		gbs[i] = cores[i]->board;
+		gbs[i]->romRegistry = &registry;
+
+		struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+		uint32_t j;
+		for (j = 0; j < 0x8000; ++j) {
+			uint8_t byte = j >> 8;
+			vf->write(vf, &byte, 1);
+		}
+		GBSynthesizeROM(vf);
+		assert_true(cores[i]->loadROM(cores[i], vf));
+		cores[i]->reset(cores[i]);
+	}
+	if (!gbs[0]->romImage) {
+		// Shared memory isn't available on this platform
+		for (i = 0; i < 2; ++i) {
+			mCoreConfigDeinit(&cores[i]->config);
+			cores[i]->deinit(cores[i]);
+		}
+		mROMImageRegistryDeinit(&registry);
+		skip();
+	}
+	assert_ptr_equal(gbs[0]->romImage, gbs[1]->romImage);
+	assert_ptr_equal(gbs[0]->memory.rom, gbs[1]->memory.rom);
+	assert_int_equal(gbs[0]->romImage->refs, 2);
+
+	// IPS patches are applied to a private mapping of the image instead of a full copy
+	static const uint8_t ips[] = { 'P', 'A', 'T', 'C', 'H', 0x00, 0x40, 0x00, 0x00, 0x02, 0x12, 0x34, 'E', 'O', 'F' };
+	struct VFile* patch = VFileFromConstMemory(ips, sizeof(ips));
+	assert_true(cores[0]->loadPatch(cores[0], patch));
+	patch->close(patch);
+	assert_false(gbs[0]->isPristine);
+	assert_ptr_equal(gbs[0]->romImage, gbs[1]->romImage);
+	assert_ptr_not_equal(gbs[0]->memory.rom, gbs[1]->memory.rom);
+	assert_int_equal(gbs[0]->memory.rom[0x4000], 0x12);
+	assert_int_equal(gbs[0]->memory.rom[0x4001], 0x34);
+	assert_int_equal(gbs[0]->memory.rom[0x4002], 0x40);
+	assert_int_equal(gbs[0]->memory.rom[0x7FFF], 0x7F);
+	assert_int_equal(gbs[1]->memory.rom[0x4000], 0x40);
+
+	// Poking the other core's ROM leaves the first one alone
+	int8_t old;
+	GBPatch8(cores[1]->cpu, 0x0200, 0x55, &old, 0);
+	assert_int_equal(old, 0x02);
+	assert_false(gbs[1]->isPristine);
+	assert_int_equal(gbs[1]->memory.rom[0x200], 0x55);
+	assert_int_equal(gbs[0]->memory.rom[0x200], 0x02);
+	assert_int_equal(gbs[0]->romImage->refs, 2);
+
+	mCoreConfigDeinit(&cores[0]->config);
+	cores[0]->deinit(cores[0]);
+	assert_int_equal(TableSize(&registry.images), 1);
+	mCoreConfigDeinit(&cores[1]->config);
+	cores[1]->deinit(cores[1]);
+	assert_int_equal(TableSize(&registry.images), 0);
+	mROMImageRegistryDeinit(&registry);
+}
+
+M_TEST_DEFINE(cloneCore) {
+	static const uint8_t entry[] = {
+		0xC3, 0x50, 0x01, // jp $150
+	};
+	static const uint8_t code[] = {
+		0x3C, // inc a
+		0xEA, 0x00, 0xC0, // ld [$C000], a
+		0x18, 0xFA, // jr $150
+	};
+	struct mCore* core = GBCoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	GBSynthesizeROM(vf);
+	vf->seek(vf, 0x100, SEEK_SET);
+	vf->write(vf, entry, sizeof(entry));
+	vf->seek(vf, 0x147, SEEK_SET);
+	vf->write(vf, "\x03\x00\x02", 3); // MBC1 with 8 KiB of battery-backed RAM
+	vf->seek(vf, 0x150, SEEK_SET);
+	vf->write(vf, code, sizeof(code));
+	assert_true(core->loadROM(core, vf));
+	core->loadSave(core, VFileMemChunk(NULL, 0));
+	core->reset(core);
+	core->runFrame(core);
+	core->busWrite8(core, 0x0000, 0x0A);
+	core->busWrite8(core, 0xA000, 0x5A);
+
+	struct mCore* clone = core->clone(core);
+	assert_non_null(clone);
+	assert_int_equal(clone->frameCounter(clone), core->frameCounter(core));
+	assert_int_equal(((struct SM83Core*) clone->cpu)->a, ((struct SM83Core*) core->cpu)->a);
+	assert_int_equal(clone->busRead8(clone, 0xA000), 0x5A);
+
+	// Both run exactly the same from here on
+	core->runFrame(core);
+	clone->runFrame(clone);
+	assert_int_equal(((struct SM83Core*) clone->cpu)->a, ((struct SM83Core*) core->cpu)->a);
+	assert_int_equal(clone->busRead8(clone, 0xC000), core->busRead8(core, 0xC000));
+	assert_int_equal(mTimingCurrentTime(clone->timing), mTimingCurrentTime(core->timing));
+
+	// But they don't share any state
+	clone->busWrite8(clone, 0xA000, 0xA5);
+	clone->busWrite8(clone, 0xD000, 0x12);
+	assert_int_equal(core->busRead8(core, 0xA000), 0x5A);
+	assert_int_not_equal(core->busRead8(core, 0xD000), 0x12);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	mCoreConfigDeinit(&clone->config);
+	clone->deinit(clone);
+}
+
+M_TEST_DEFINE(slim) {
+	struct mCore* core = GBCoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	core->setAudioBufferSize(core, 0x1000);
+	size_t usage = core->memoryUsage(core);
+	assert_true(usage > 0);
+
+	mCoreConfigSetValue(&core->config, "slim", "1");
+	mCoreLoadConfig(core);
+	assert_true(((struct GB*) core->board)->slim);
+	assert_true(core->getAudioBufferSize(core) < 0x1000);
+	assert_true(core->memoryUsage(core) < usage);
+
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	GBSynthesizeROM(vf);
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+	core->rawWrite8(core, 0x8123, 0, 0x5A);
+	core->reset(core);
+	assert_int_equal(core->rawRead8(core, 0x8123, 0), 0);
+	core->runFrame(core);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_DEFINE(stateHash) {
+	struct mCore* core = GBCoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	GBSynthesizeROM(vf);
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+	core->runFrame(core);
+
+	uint64_t hash = core->stateHash(core);
+	assert_true(core->stateHash(core) == hash);
+	core->rawWrite8(core, 0xC123, 0, 0x5A);
+	assert_true(core->stateHash(core) != hash);
+	core->rawWrite8(core, 0xC123, 0, 0);
+	assert_true(core->stateHash(core) == hash);
+
+	struct mCore* clone = core->clone(core);
+	assert_non_null(clone);
+	assert_true(clone->stateHash(clone) == hash);
+	core->runFrame(core);
+	clone->runFrame(clone);
+	assert_true(clone->stateHash(clone) == core->stateHash(core));
+
+	mCoreConfigDeinit(&clone->config);
+	clone->deinit(clone);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
 M_TEST_SUITE_DEFINE(GBCore,
 	cmocka_unit_test(create),
 	cmocka_unit_test(platform),
 	cmocka_unit_test(reset),
 	cmocka_unit_test(loadNullROM),
-	cmocka_unit_test(isROM))
+	cmocka_unit_test(isROM),
+	cmocka_unit_test(romRegistry),
+	cmocka_unit_test(cloneCore),
+	cmocka_unit_test(slim),
+	cmocka_unit_test(stateHash))
@@ -8,7 +8,10 @@
 #include <mgba/core/core.h>
 #include <mgba/gb/core.h>
 #include <mgba/internal/gb/gb.h>
+#include <mgba/internal/gb/io.h>
 #include <mgba/internal/gb/mbc.h>
+#include <mgba/internal/gb/overrides.h>
+#include <mgba/internal/sm83/sm83.h>
 #include <mgba-util/vfs.h>
 
 M_TEST_SUITE_SETUP(GBMemory) {
@@ -74,7 +77,126 @@ M_TEST_DEFINE(patchROMBank2) {
 	assert_int_equal(GBView8(gb->cpu, GB_SIZE_CART_BANK0, 2), newExpected);
 }
 
+M_TEST_DEFINE(pageTable) {
+	struct mCore* core = *state;
+	struct GB* gb = core->board;
+
+	core->reset(core);
+	gb->memory.rom[GB_SIZE_CART_BANK0 * 2 + 0x10] = 0x5A;
+	GBMBCSwitchBank(gb, 2);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_CART_BANK1 + 0x10), 0x5A);
+	GBMBCSwitchBank(gb, 1);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_CART_BANK1 + 0x10), gb->memory.rom[GB_SIZE_CART_BANK0 + 0x10]);
+
+	GBStore8(gb->cpu, GB_BASE_WORKING_RAM_BANK0 + 0x20, 0x12);
+	GBStore8(gb->cpu, GB_BASE_WORKING_RAM_BANK1 + 0x20, 0x34);
+	assert_int_equal(gb->memory.wram[0x20], 0x12);
+	assert_int_equal(gb->memory.wramBank[0x20], 0x34);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_WORKING_RAM_BANK0 + 0x20), 0x12);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_WORKING_RAM_BANK1 + 0x20), 0x34);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_WORKING_RAM_BANK0 + GB_SIZE_WORKING_RAM_BANK0 * 2 + 0x20), 0x12);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_WORKING_RAM_BANK1 + GB_SIZE_WORKING_RAM_BANK0 * 2 + 0x20), 0x34);
+
+	GBMemorySwitchWramBank(&gb->memory, 2);
+	GBStore8(gb->cpu, GB_BASE_WORKING_RAM_BANK1 + 0x20, 0x56);
+	assert_int_equal(gb->memory.wram[GB_SIZE_WORKING_RAM_BANK0 * 2 + 0x20], 0x56);
+	GBMemorySwitchWramBank(&gb->memory, 1);
+	assert_int_equal(GBLoad8(gb->cpu, GB_BASE_WORKING_RAM_BANK1 + 0x20), 0x34);
+}
+
+M_TEST_DEFINE(idleLoopDetect) {
+	struct mCore* core = *state;
+	struct GB* gb = core->board;
+	static const uint8_t entry[] = {
+		0xC3, 0x50, 0x01, // JP 0x0150
+	};
+	static const uint8_t loop[] = {
+		0xF0, 0x44, // LDH A, [LY]
+		0xFE, 0x90, // CP 0x90
+		0x20, 0xFA, // JR NZ, 0x0150
+		0x18, 0xFE, // JR 0x0156
+	};
+	int8_t old;
+	size_t i;
+	for (i = 0; i < sizeof(entry); ++i) {
+		GBPatch8(gb->cpu, 0x100 + i, entry[i], &old, 0);
+	}
+	for (i = 0; i < sizeof(loop); ++i) {
+		GBPatch8(gb->cpu, 0x150 + i, loop[i], &old, 0);
+	}
+
+	core->reset(core);
+	gb->idleOptimization = GB_IDLE_LOOP_DETECT;
+	core->runFrame(core);
+	assert_int_equal(gb->idleLoop, 0x150);
+	assert_true(gb->idleLoopDetected);
+	assert_int_equal(gb->idleOptimization, GB_IDLE_LOOP_REMOVE);
+
+	// Skipping ahead must still let the loop see LY reach vblank
+	core->runFrame(core);
+	assert_in_range(gb->cpu->pc, 0x156, 0x158);
+}
+
+static void _shimStore8(struct SM83Core* cpu, uint16_t address, int8_t value) {
+	GBStore8(cpu, address, value);
+}
+
+M_TEST_DEFINE(generalDMA) {
+	struct mCore* core = *state;
+	struct GB* gb = core->board;
+	int32_t elapsed[2];
+	size_t i;
+	for (i = 0; i < 2; ++i) {
+		core->reset(core);
+		if (i) {
+			// Hooking stores forces every byte through its own event
+			gb->cpu->memory.store8 = _shimStore8;
+		}
+		memset(gb->video.vram, 0, GB_SIZE_VRAM);
+		gb->memory.io[GB_REG_HDMA1] = GB_BASE_CART_BANK1 >> 8;
+		gb->memory.io[GB_REG_HDMA2] = 0;
+		gb->memory.io[GB_REG_HDMA3] = 0;
+		gb->memory.io[GB_REG_HDMA4] = 0;
+		int32_t start = mTimingCurrentTime(&gb->timing);
+		GBMemoryWriteHDMA5(gb, 0x7F);
+		while (gb->memory.hdmaRemaining) {
+			mTimingTick(&gb->timing, 4);
+		}
+		elapsed[i] = mTimingCurrentTime(&gb->timing) - start;
+		assert_false(gb->cpuBlocked);
+		assert_int_equal(gb->memory.io[GB_REG_HDMA5], 0xFF);
+		assert_memory_equal(gb->video.vram, &gb->memory.romBank[0], 0x800);
+	}
+	// Copying ahead can't change when the transfer ends
+	assert_int_equal(elapsed[0], elapsed[1]);
+}
+
+M_TEST_DEFINE(oamDMA) {
+	struct mCore* core = *state;
+	struct GB* gb = core->board;
+	size_t i;
+	core->reset(core);
+	for (i = 0; i < 0xA0; ++i) {
+		GBStore8(gb->cpu, GB_BASE_WORKING_RAM_BANK0 + 0x100 + i, i ^ 0x5A);
+	}
+	GBMemoryDMA(gb, GB_BASE_WORKING_RAM_BANK0 + 0x100);
+	int32_t start = mTimingCurrentTime(&gb->timing);
+	while (gb->memory.dmaRemaining) {
+		// The CPU must stay locked out of OAM until the last byte is copied
+		assert_int_equal(GBLoad8(gb->cpu, GB_BASE_OAM), 0xFF);
+		mTimingTick(&gb->timing, 4);
+	}
+	assert_true(mTimingCurrentTime(&gb->timing) - start >= 0xA0 * 8);
+	for (i = 0; i < 0xA0; ++i) {
+		assert_int_equal(gb->video.oam.raw[i], i ^ 0x5A);
+	}
+}
+
 M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(GBMemory,
 	cmocka_unit_test(patchROMBank0),
 	cmocka_unit_test(patchROMBank1),
-	cmocka_unit_test(patchROMBank2))
+	cmocka_unit_test(patchROMBank2),
+	cmocka_unit_test(pageTable),
+	cmocka_unit_test(idleLoopDetect),
+	cmocka_unit_test(generalDMA),
+	cmocka_unit_test(oamDMA))
@@ -0,0 +1,60 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/rom-image.h>
+#include <mgba/gb/core.h>
+#include <mgba/internal/gb/gb.h>
+#include <mgba-util/vfs.h>
+
+// Starts TIMA at 16 cycles per tick, busy-waits, then writes stopTimer to TAC (or somewhere
+// harmless) before reading TIMA back into $C000
+static uint8_t _measureTIMA(bool stopTimer) {
+	static const uint8_t entry[] = {
+		0xC3, 0x50, 0x01, // jp $150
+	};
+	uint8_t code[] = {
+		0xAF, // xor a
+		0xE0, 0x05, // ldh [TIMA], a
+		0x3E, 0x05, // ld a, $05
+		0xE0, 0x07, // ldh [TAC], a
+		0x06, 0x14, // ld b, 20
+		0x05, // dec b
+		0x20, 0xFD, // jr nz, $-3
+		0xAF, // xor a
+		0xE0, stopTimer ? 0x07 : 0x80, // ldh [TAC], a / ldh [$FF80], a
+		0xF0, 0x05, // ldh a, [TIMA]
+		0xEA, 0x00, 0xC0, // ld [$C000], a
+		0x18, 0xFE, // jr $
+	};
+	struct mCore* core = GBCoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	GBSynthesizeROM(vf);
+	vf->seek(vf, 0x100, SEEK_SET);
+	vf->write(vf, entry, sizeof(entry));
+	vf->seek(vf, 0x150, SEEK_SET);
+	vf->write(vf, code, sizeof(code));
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+	core->runFrame(core);
+	uint8_t tima = core->busRead8(core, 0xC000);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	return tima;
+}
+
+M_TEST_DEFINE(stopKeepsCount) {
+	uint8_t running = _measureTIMA(false);
+	assert_in_range(running, 19, 21);
+	assert_int_equal(_measureTIMA(true), running);
+}
+
+M_TEST_SUITE_DEFINE(GBTimer,
+	cmocka_unit_test(stopKeepsCount))
@@ -0,0 +1,73 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/timing.h>
+#include <mgba/gb/core.h>
+#include <mgba/internal/gb/gb.h>
+#include <mgba/internal/gb/io.h>
+#include <mgba-util/vfs.h>
+
+// Creates a CGB core that spins in place, stopped on a line between when mode 3 should have started
+// and when anything has noticed
+static struct mCore* _createLateMode2Core(void) {
+	static const uint8_t entry[] = {
+		0x18, 0xFE, // jr $
+	};
+	static const uint8_t cgbOnly = 0xC0;
+	struct mCore* core = GBCoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	GBSynthesizeROM(vf);
+	vf->seek(vf, 0x100, SEEK_SET);
+	vf->write(vf, entry, sizeof(entry));
+	vf->seek(vf, 0x143, SEEK_SET);
+	vf->write(vf, &cgbOnly, sizeof(cgbOnly));
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+	struct GB* gb = core->board;
+	assert_true(gb->model >= GB_MODEL_CGB);
+
+	while (!gb->video.mode3Pending) {
+		core->step(core);
+	}
+	while ((int32_t) (mTimingCurrentTime(&gb->timing) - gb->video.mode3Start) < 0) {
+		core->step(core);
+	}
+	assert_true(gb->video.mode3Pending);
+	assert_int_equal(gb->video.mode, 2);
+	return core;
+}
+
+M_TEST_DEFINE(paletteWriteInMode3) {
+	struct mCore* core = _createLateMode2Core();
+	struct GB* gb = core->board;
+	uint16_t background = gb->video.palette[0];
+	core->busWrite8(core, GB_BASE_IO | GB_REG_BCPS, 0x80);
+	core->busWrite8(core, GB_BASE_IO | GB_REG_BCPD, ~background);
+	// Mode 3 has already started, so the write has to be dropped
+	assert_int_equal(gb->video.mode, 3);
+	assert_int_equal(gb->video.palette[0], background);
+	assert_int_equal(gb->memory.io[GB_REG_BCPS] & 0x3F, 1);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+
+	core = _createLateMode2Core();
+	gb = core->board;
+	uint16_t object = gb->video.palette[8 * 4];
+	core->busWrite8(core, GB_BASE_IO | GB_REG_OCPS, 0x80);
+	core->busWrite8(core, GB_BASE_IO | GB_REG_OCPD, ~object);
+	assert_int_equal(gb->video.mode, 3);
+	assert_int_equal(gb->video.palette[8 * 4], object);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_SUITE_DEFINE(GBVideo,
+	cmocka_unit_test(paletteWriteInMode3))
@@ -17,6 +17,8 @@ void _GBTimerIRQ(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	timer->p->memory.io[GB_REG_TIMA] = timer->p->memory.io[GB_REG_TMA];
 	timer->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_TIMER);
 	GBUpdateIRQs(timer->p);
+	// The next overflow is sooner now that TIMA has been reloaded
+	GBTimerReschedule(timer);
 }
 
 static void _GBTimerDivIncrement(struct GBTimer* timer, uint32_t cyclesLate) {
@@ -40,21 +42,53 @@ static void _GBTimerDivIncrement(struct GBTimer* timer, uint32_t cyclesLate) {
 	}
 }
 
+static void _GBTimerScheduleNext(struct GBTimer* timer, int32_t elapsed) {
+	// DIV is worked out when it's read, so the only ticks that need an event are the ones where
+	// TIMA overflows or the APU frame sequencer steps
+	unsigned frameTicks = 0x200 << timer->p->doubleSpeed;
+	uint32_t divsToGo = frameTicks - (timer->internalDiv & (frameTicks - 1));
+	if (timer->timaPeriod) {
+		uint32_t timaToGo = timer->timaPeriod - (timer->internalDiv & (timer->timaPeriod - 1));
+		timaToGo += (0xFF - timer->p->memory.io[GB_REG_TIMA]) * timer->timaPeriod;
+		if (timaToGo < divsToGo) {
+			divsToGo = timaToGo;
+		}
+	}
+	timer->nextDiv = GB_DMG_DIV_PERIOD * divsToGo * (2 - timer->p->doubleSpeed);
+	mTimingSchedule(&timer->p->timing, &timer->event, timer->nextDiv - elapsed);
+}
+
 void _GBTimerUpdate(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	UNUSED(timing);
 	struct GBTimer* timer = context;
 	timer->nextDiv += cyclesLate;
 	_GBTimerDivIncrement(timer, cyclesLate);
-	// Batch div increments
-	int divsToGo = 16 - (timer->internalDiv & 15);
-	int timaToGo = INT_MAX;
-	if (timer->timaPeriod) {
-		timaToGo = timer->timaPeriod - (timer->internalDiv & (timer->timaPeriod - 1));
+	_GBTimerScheduleNext(timer, cyclesLate);
+}
+
+// Catches DIV and TIMA up on the ticks that are due before now - lead
+static void _GBTimerSyncBefore(struct GBTimer* timer, int32_t lead) {
+	if (!mTimingIsScheduled(&timer->p->timing, &timer->event)) {
+		return;
 	}
-	if (timaToGo < divsToGo) {
-		divsToGo = timaToGo;
+	int32_t until = mTimingUntil(&timer->p->timing, &timer->event) + lead;
+	timer->nextDiv -= until;
+	_GBTimerDivIncrement(timer, until < 0 ? -until : 0);
+	timer->nextDiv += until;
+}
+
+void GBTimerSync(struct GBTimer* timer) {
+	_GBTimerSyncBefore(timer, 0);
+}
+
+void GBTimerReschedule(struct GBTimer* timer) {
+	if (!mTimingIsScheduled(&timer->p->timing, &timer->event)) {
+		return;
 	}
-	timer->nextDiv = GB_DMG_DIV_PERIOD * divsToGo * (2 - timer->p->doubleSpeed);
-	mTimingSchedule(timing, &timer->event, timer->nextDiv - cyclesLate);
+	GBTimerSync(timer);
+	int32_t elapsed = timer->nextDiv - mTimingUntil(&timer->p->timing, &timer->event);
+	mTimingDeschedule(&timer->p->timing, &timer->event);
+	_GBTimerScheduleNext(timer, elapsed);
 }
 
 void GBTimerReset(struct GBTimer* timer) {
@@ -115,7 +149,11 @@ uint8_t GBTimerUpdateTAC(struct GBTimer* timer, GBRegisterTAC tac) {
 		timer->nextDiv += GB_DMG_DIV_PERIOD * (2 - timer->p->doubleSpeed);
 		mTimingSchedule(&timer->p->timing, &timer->event, timer->nextDiv);
 	} else {
+		// Catch TIMA up on any ticks from before the timer was stopped. The CPU has already
+		// counted the cycle doing the write, and ticks due during it land after the write.
+		_GBTimerSyncBefore(timer, timer->p->cpu->tMultiplier);
 		timer->timaPeriod = 0;
+		GBTimerReschedule(timer);
 	}
 	return tac;
 }
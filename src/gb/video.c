@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gb/video.h>
 
+#include <mgba/core/perf.h>
 #include <mgba/core/sync.h>
 #include <mgba/core/thread.h>
 #include <mgba/core/cache-set.h>
@@ -39,6 +40,8 @@ static void _endMode1(struct mTiming* timing, void* context, uint32_t cyclesLate
 static void _endMode2(struct mTiming* timing, void* context, uint32_t cyclesLate);
 static void _endMode3(struct mTiming* timing, void* context, uint32_t cyclesLate);
 static void _updateFrameCount(struct mTiming* timing, void* context, uint32_t cyclesLate);
+static void _startMode2(struct GBVideo* video, int32_t when);
+static int32_t _enterMode3(struct GBVideo* video);
 
 static const uint16_t _defaultBorderPalette[16] = {
 	0x0000,
@@ -315,12 +318,18 @@ void GBVideoReset(struct GBVideo* video) {
 	video->x = 0;
 	video->mode = 1;
 	video->stat = 1;
+	video->mode3Pending = false;
 
 	video->frameCounter = 0;
 	video->frameskipCounter = 0;
+	video->skipFrames = 0;
 
 	GBVideoSwitchBank(video, 0);
-	memset(video->vram, 0, GB_SIZE_VRAM);
+	if (video->p->slim) {
+		mappedMemoryClear(video->vram, GB_SIZE_VRAM);
+	} else {
+		memset(video->vram, 0, GB_SIZE_VRAM);
+	}
 	video->renderer->vram = video->vram;
 	memset(&video->oam, 0, sizeof(video->oam));
 	video->renderer->oam = &video->oam;
@@ -488,6 +497,11 @@ void GBVideoAssociateRenderer(struct GBVideo* video, struct GBVideoRenderer* ren
 	video->renderer->init(video->renderer, video->p->model, video->sgbBorders);
 }
 
+static bool _isSkipping(struct GBVideo* video) {
+	// SGB transfers read back the rendered picture, so skipping it would lose their data
+	return video->skipFrames && !(video->p->model & GB_MODEL_SGB);
+}
+
 static bool _statIRQAsserted(GBRegisterSTAT stat) {
 	// TODO: variable for the IRQ line value?
 	if (GBRegisterSTATIsLYCIRQ(stat) && GBRegisterSTATIsLYC(stat)) {
@@ -546,7 +560,7 @@ void GBVideoSkipBIOS(struct GBVideo* video) {
 
 void _endMode0(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	struct GBVideo* video = context;
-	if (video->frameskipCounter <= 0) {
+	if (video->frameskipCounter <= 0 && !_isSkipping(video)) {
 		video->renderer->finishScanline(video->renderer, video->ly);
 	}
 	int lyc = video->p->memory.io[GB_REG_LYC];
@@ -585,7 +599,11 @@ void _endMode0(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 
 	GBUpdateIRQs(video->p);
 	video->p->memory.io[GB_REG_STAT] = video->stat;
-	mTimingSchedule(timing, &video->modeEvent, (next << 1) - cyclesLate);
+	if (video->mode == 2) {
+		_startMode2(video, (next << 1) - cyclesLate);
+	} else {
+		mTimingSchedule(timing, &video->modeEvent, (next << 1) - cyclesLate);
+	}
 }
 
 void _endMode1(struct mTiming* timing, void* context, uint32_t cyclesLate) {
@@ -622,7 +640,11 @@ void _endMode1(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 		GBUpdateIRQs(video->p);
 	}
 	video->p->memory.io[GB_REG_STAT] = video->stat;
-	mTimingSchedule(timing, &video->modeEvent, (next << 1) - cyclesLate);
+	if (video->mode == 2) {
+		_startMode2(video, (next << 1) - cyclesLate);
+	} else {
+		mTimingSchedule(timing, &video->modeEvent, (next << 1) - cyclesLate);
+	}
 }
 
 void _endMode2(struct mTiming* timing, void* context, uint32_t cyclesLate) {
@@ -645,6 +667,16 @@ void _endMode2(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 
 void _endMode3(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	struct GBVideo* video = context;
+	if (video->mode3Pending) {
+		// Nothing looked at mode 3 while it was happening, so enter it now, on time
+		int32_t end = _enterMode3(video);
+		int32_t late = mTimingCurrentTime(timing) - end;
+		if (late < 0) {
+			mTimingSchedule(timing, &video->modeEvent, -late);
+			return;
+		}
+		cyclesLate = late;
+	}
 	GBVideoProcessDots(video, cyclesLate);
 	if (video->ly < GB_VIDEO_VERTICAL_PIXELS && video->p->memory.isHdma && video->p->memory.io[GB_REG_HDMA5] != 0xFF) {
 		video->p->memory.hdmaRemaining = 0x10;
@@ -679,17 +711,82 @@ void _updateFrameCount(struct mTiming* timing, void* context, uint32_t cyclesLat
 
 	--video->frameskipCounter;
 	if (video->frameskipCounter < 0) {
-		video->renderer->finishFrame(video->renderer);
+		if (!_isSkipping(video)) {
+			mTRACE_BEGIN("Finish frame");
+			video->renderer->finishFrame(video->renderer);
+			mTRACE_END();
+		}
 		video->frameskipCounter = video->frameskip;
 	}
 	GBFrameEnded(video->p);
-	mCoreSyncPostFrame(video->p->sync);
+	if (video->skipFrames) {
+		--video->skipFrames;
+	} else {
+		mCoreSyncPostFrame(video->p->sync);
+	}
 	++video->frameCounter;
 	video->p->earlyExit = true;
 
 	GBFrameStarted(video->p);
 }
 
+static void _startMode2(struct GBVideo* video, int32_t when) {
+	// Mode 3 will start with the objects and SCX as they are now unless they're changed during mode
+	// 2, and anything that changes them goes back to a separate event first
+	video->mode3Pending = true;
+	video->mode3Start = mTimingCurrentTime(&video->p->timing) + when;
+	_cleanOAM(video, video->ly);
+	int x = -(video->p->memory.io[GB_REG_SCX] & 7);
+	int32_t length = GB_VIDEO_MODE_3_LENGTH_BASE + video->objMax * 6 - x;
+	video->modeEvent.callback = _endMode3;
+	mTimingSchedule(&video->p->timing, &video->modeEvent, when + (length << 1));
+}
+
+static int32_t _enterMode3(struct GBVideo* video) {
+	video->mode3Pending = false;
+	_cleanOAM(video, video->ly);
+	video->x = -(video->p->memory.io[GB_REG_SCX] & 7);
+	video->dotClock = video->mode3Start + 10 - (video->x << 1);
+	int32_t length = GB_VIDEO_MODE_3_LENGTH_BASE + video->objMax * 6 - video->x;
+	video->mode = 3;
+	GBRegisterSTAT oldStat = video->stat;
+	video->stat = GBRegisterSTATSetMode(video->stat, video->mode);
+	if (!_statIRQAsserted(oldStat) && _statIRQAsserted(video->stat)) {
+		video->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_LCDSTAT);
+		GBUpdateIRQs(video->p);
+	}
+	video->p->memory.io[GB_REG_STAT] = video->stat;
+	return video->mode3Start + (length << 1);
+}
+
+void GBVideoSyncMode(struct GBVideo* video, uint32_t cyclesLate) {
+	if (!video->mode3Pending) {
+		return;
+	}
+	struct mTiming* timing = &video->p->timing;
+	if ((int32_t) (mTimingCurrentTime(timing) - cyclesLate - video->mode3Start) < 0) {
+		return;
+	}
+	int32_t end = _enterMode3(video);
+	if (end != (int32_t) video->modeEvent.when) {
+		// The objects changed without going through GBVideoSyncModeExact, e.g. from the debugger
+		mTimingDeschedule(timing, &video->modeEvent);
+		mTimingScheduleAbsolute(timing, &video->modeEvent, end);
+	}
+}
+
+void GBVideoSyncModeExact(struct GBVideo* video, uint32_t cyclesLate) {
+	GBVideoSyncMode(video, cyclesLate);
+	if (!video->mode3Pending) {
+		return;
+	}
+	// Something is about to change how mode 3 starts, so it needs to happen at the right time
+	video->mode3Pending = false;
+	video->modeEvent.callback = _endMode2;
+	mTimingDeschedule(&video->p->timing, &video->modeEvent);
+	mTimingScheduleAbsolute(&video->p->timing, &video->modeEvent, video->mode3Start);
+}
+
 static void _cleanOAM(struct GBVideo* video, int y) {
 	int spriteHeight = 8;
 	if (GBRegisterLCDCIsObjSize(video->p->memory.io[GB_REG_LCDC])) {
@@ -708,6 +805,7 @@ static void _cleanOAM(struct GBVideo* video, int y) {
 }
 
 void GBVideoProcessDots(struct GBVideo* video, uint32_t cyclesLate) {
+	GBVideoSyncModeExact(video, cyclesLate);
 	if (video->mode != 3) {
 		return;
 	}
@@ -721,8 +819,10 @@ void GBVideoProcessDots(struct GBVideo* video, uint32_t cyclesLate) {
 	if (oldX < 0) {
 		oldX = 0;
 	}
-	if (video->frameskipCounter <= 0) {
+	if (video->frameskipCounter <= 0 && !_isSkipping(video)) {
+		mPERF_ENTER(VIDEO);
 		video->renderer->drawRange(video->renderer, oldX, video->x, video->ly);
+		mPERF_LEAVE();
 	}
 }
 
@@ -756,6 +856,7 @@ void GBVideoWriteLCDC(struct GBVideo* video, GBRegisterLCDC value) {
 		video->ly = 0;
 		video->p->memory.io[GB_REG_LY] = 0;
 		video->renderer->writePalette(video->renderer, 0, video->dmgPalette[0]);
+		video->mode3Pending = false;
 	
 		mTimingDeschedule(&video->p->timing, &video->modeEvent);
 		mTimingDeschedule(&video->p->timing, &video->frameEvent);
@@ -765,6 +866,7 @@ void GBVideoWriteLCDC(struct GBVideo* video, GBRegisterLCDC value) {
 }
 
 void GBVideoWriteSTAT(struct GBVideo* video, GBRegisterSTAT value) {
+	GBVideoSyncMode(video, 0);
 	GBRegisterSTAT oldStat = video->stat;
 	video->stat = (video->stat & 0x7) | (value & 0x78);
 	if (!GBRegisterLCDCIsEnable(video->p->memory.io[GB_REG_LCDC]) || video->p->model >= GB_MODEL_CGB) {
@@ -781,6 +883,7 @@ void GBVideoWriteSTAT(struct GBVideo* video, GBRegisterSTAT value) {
 }
 
 void GBVideoWriteLYC(struct GBVideo* video, uint8_t value) {
+	GBVideoSyncMode(video, 0);
 	GBRegisterSTAT oldStat = video->stat;
 	if (GBRegisterLCDCIsEnable(video->p->memory.io[GB_REG_LCDC])) {
 		video->stat = GBRegisterSTATSetLYC(video->stat, value == video->ly);
@@ -827,6 +930,8 @@ void GBVideoWritePalette(struct GBVideo* video, uint16_t address, uint8_t value)
 			break;
 		}
 	} else if (video->p->model >= GB_MODEL_CGB) {
+		// Palette RAM is locked during mode 3, which may have started without anything noticing yet
+		GBVideoSyncMode(video, 0);
 		switch (address) {
 		case GB_REG_BCPD:
 			if (video->mode != 3) {
@@ -1125,6 +1230,13 @@ static void GBVideoDummyRendererPutPixels(struct GBVideoRenderer* renderer, size
 }
 
 void GBVideoSerialize(const struct GBVideo* video, struct GBSerializedState* state) {
+	int32_t nextMode = video->modeEvent.when - mTimingCurrentTime(&video->p->timing);
+	if (video->mode3Pending) {
+		// This has already been synced, so mode 3 hasn't started yet. Save it as though it had its
+		// own event, the way it's loaded.
+		nextMode = video->mode3Start - mTimingCurrentTime(&video->p->timing);
+	}
+
 	STORE_16LE(video->x, 0, &state->video.x);
 	STORE_16LE(video->ly, 0, &state->video.ly);
 	STORE_32LE(video->frameCounter, 0, &state->video.frameCounter);
@@ -1146,7 +1258,7 @@ void GBVideoSerialize(const struct GBVideo* video, struct GBSerializedState* sta
 		STORE_16LE(video->palette[i], i * 2, state->video.palette);
 	}
 
-	STORE_32LE(video->modeEvent.when - mTimingCurrentTime(&video->p->timing), 0, &state->video.nextMode);
+	STORE_32LE(nextMode, 0, &state->video.nextMode);
 	STORE_32LE(video->frameEvent.when - mTimingCurrentTime(&video->p->timing), 0, &state->video.nextFrame);
 
 	memcpy(state->vram, video->vram, GB_SIZE_VRAM);
@@ -1166,6 +1278,7 @@ void GBVideoDeserialize(struct GBVideo* video, const struct GBSerializedState* s
 	video->bcpIncrement = GBSerializedVideoFlagsGetBcpIncrement(flags);
 	video->ocpIncrement = GBSerializedVideoFlagsGetOcpIncrement(flags);
 	video->mode = GBSerializedVideoFlagsGetMode(flags);
+	video->mode3Pending = false;
 	LOAD_16LE(video->bcpIndex, 0, &state->video.bcpIndex);
 	video->bcpIndex &= 0x3F;
 	LOAD_16LE(video->ocpIndex, 0, &state->video.ocpIndex);
@@ -6,7 +6,9 @@
 #include <mgba/internal/gba/audio.h>
 
 #include <mgba/internal/arm/macros.h>
+#include <mgba/core/av-buffer.h>
 #include <mgba/core/blip_buf.h>
+#include <mgba/core/perf.h>
 #include <mgba/core/sync.h>
 #include <mgba/internal/gba/dma.h>
 #include <mgba/internal/gba/gba.h>
@@ -30,6 +32,7 @@ static const int CLOCKS_PER_FRAME = 0x800;
 
 static int _applyBias(struct GBAAudio* audio, int sample);
 static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate);
+static void _runBulkFIFO(struct GBAAudio* audio, int32_t timestamp);
 
 void GBAAudioInit(struct GBAAudio* audio, size_t samples) {
 	audio->sampleEvent.context = audio;
@@ -54,6 +57,8 @@ void GBAAudioInit(struct GBAAudio* audio, size_t samples) {
 	audio->forceDisableChA = false;
 	audio->forceDisableChB = false;
 	audio->masterVolume = GBA_AUDIO_VOLUME_MAX;
+	audio->outputDisabled = false;
+	audio->bulkFifo = false;
 	audio->mixer = NULL;
 }
 
@@ -99,6 +104,7 @@ void GBAAudioReset(struct GBAAudio* audio) {
 	blip_clear(audio->psg.left);
 	blip_clear(audio->psg.right);
 	audio->clock = 0;
+	audio->outputSkipFrames = 0;
 }
 
 void GBAAudioDeinit(struct GBAAudio* audio) {
@@ -106,8 +112,8 @@ void GBAAudioDeinit(struct GBAAudio* audio) {
 }
 
 void GBAAudioResizeBuffer(struct GBAAudio* audio, size_t samples) {
-	if (samples > 0x2000) {
-		samples = 0x2000;
+	if (samples > audio->psg.bufferCapacity / 2) {
+		samples = audio->psg.bufferCapacity / 2;
 	}
 	mCoreSyncLockAudio(audio->p->sync);
 	audio->samples = samples;
@@ -117,6 +123,16 @@ void GBAAudioResizeBuffer(struct GBAAudio* audio, size_t samples) {
 	mCoreSyncConsumeAudio(audio->p->sync);
 }
 
+void GBAAudioSetBufferCapacity(struct GBAAudio* audio, size_t capacity) {
+	mCoreSyncLockAudio(audio->p->sync);
+	GBAudioSetBufferCapacity(&audio->psg, capacity);
+	if (audio->samples > audio->psg.bufferCapacity / 2) {
+		audio->samples = audio->psg.bufferCapacity / 2;
+	}
+	audio->clock = 0;
+	mCoreSyncConsumeAudio(audio->p->sync);
+}
+
 void GBAAudioScheduleFifoDma(struct GBAAudio* audio, int number, struct GBADMA* info) {
 	info->reg = GBADMARegisterSetDestControl(info->reg, GBA_DMA_FIXED);
 	info->reg = GBADMARegisterSetWidth(info->reg, 1);
@@ -221,6 +237,7 @@ void GBAAudioWriteSOUNDCNT_LO(struct GBAAudio* audio, uint16_t value) {
 }
 
 void GBAAudioWriteSOUNDCNT_HI(struct GBAAudio* audio, uint16_t value) {
+	_runBulkFIFO(audio, mTimingCurrentTime(&audio->p->timing));
 	audio->volume = GBARegisterSOUNDCNT_HIGetVolume(value);
 	audio->volumeChA = GBARegisterSOUNDCNT_HIGetVolumeChA(value);
 	audio->volumeChB = GBARegisterSOUNDCNT_HIGetVolumeChB(value);
@@ -230,6 +247,8 @@ void GBAAudioWriteSOUNDCNT_HI(struct GBAAudio* audio, uint16_t value) {
 	audio->chBRight = GBARegisterSOUNDCNT_HIGetChBRight(value);
 	audio->chBLeft = GBARegisterSOUNDCNT_HIGetChBLeft(value);
 	audio->chBTimer = GBARegisterSOUNDCNT_HIGetChBTimer(value);
+	// Timers that only feed a FIFO don't schedule their overflows unless it's listening
+	GBATimerUpdateEvents(audio->p);
 	if (GBARegisterSOUNDCNT_HIIsChAReset(value)) {
 		audio->chA.fifoWrite = 0;
 		audio->chA.fifoRead = 0;
@@ -244,6 +263,7 @@ void GBAAudioWriteSOUNDCNT_X(struct GBAAudio* audio, uint16_t value) {
 	GBAAudioSample(audio, mTimingCurrentTime(&audio->p->timing));
 	audio->enable = GBAudioEnableGetEnable(value);
 	GBAudioWriteNR52(&audio->psg, value);
+	GBATimerUpdateEvents(audio->p);
 	if (!audio->enable) {
 		int i;
 		for (i = GBA_REG_SOUND1CNT_LO; i < GBA_REG_SOUNDCNT_HI; i += 2) {
@@ -313,6 +333,10 @@ uint32_t GBAAudioWriteFIFO(struct GBAAudio* audio, int address, uint32_t value)
 		mLOG(GBA_AUDIO, ERROR, "Bad FIFO write to address 0x%03x", address);
 		return value;
 	}
+	if (!audio->p->performingDMA) {
+		// Refills from DMA were already accounted for, but anything else needs to land in order
+		_runBulkFIFO(audio, mTimingCurrentTime(&audio->p->timing));
+	}
 	channel->fifo[channel->fifoWrite] = value;
 	++channel->fifoWrite;
 	if (channel->fifoWrite == GBA_AUDIO_FIFO_SIZE) {
@@ -321,16 +345,7 @@ uint32_t GBAAudioWriteFIFO(struct GBAAudio* audio, int address, uint32_t value)
 	return channel->fifo[channel->fifoWrite];
 }
 
-void GBAAudioSampleFIFO(struct GBAAudio* audio, int fifoId, int32_t cycles) {
-	struct GBAAudioFIFO* channel;
-	if (fifoId == 0) {
-		channel = &audio->chA;
-	} else if (fifoId == 1) {
-		channel = &audio->chB;
-	} else {
-		mLOG(GBA_AUDIO, ERROR, "Bad FIFO write to address 0x%03x", fifoId);
-		return;
-	}
+static void _sampleFIFO(struct GBAAudio* audio, struct GBAAudioFIFO* channel, int32_t dmaWhen, int32_t until) {
 	int fifoSize;
 	if (channel->fifoWrite >= channel->fifoRead) {
 		fifoSize = channel->fifoWrite - channel->fifoRead;
@@ -340,7 +355,7 @@ void GBAAudioSampleFIFO(struct GBAAudio* audio, int fifoId, int32_t cycles) {
 	if (GBA_AUDIO_FIFO_SIZE - fifoSize > 4 && channel->dmaSource > 0) {
 		struct GBADMA* dma = &audio->p->memory.dma[channel->dmaSource];
 		if (GBADMARegisterGetTiming(dma->reg) == GBA_DMA_TIMING_CUSTOM) {
-			dma->when = mTimingCurrentTime(&audio->p->timing) - cycles;
+			dma->when = dmaWhen;
 			dma->nextCount = 4;
 			GBADMASchedule(audio->p, channel->dmaSource, dma);
 		}
@@ -353,7 +368,7 @@ void GBAAudioSampleFIFO(struct GBAAudio* audio, int fifoId, int32_t cycles) {
 			channel->fifoRead = 0;
 		}
 	}
-	int32_t until = mTimingUntil(&audio->p->timing, &audio->sampleEvent) - 1;
+	until -= 1;
 	int bits = 2 << GBARegisterSOUNDBIASGetResolution(audio->soundbias);
 	until += 1 << (9 - GBARegisterSOUNDBIASGetResolution(audio->soundbias));
 	until >>= 9 - GBARegisterSOUNDBIASGetResolution(audio->soundbias);
@@ -367,6 +382,46 @@ void GBAAudioSampleFIFO(struct GBAAudio* audio, int fifoId, int32_t cycles) {
 	}
 }
 
+static struct GBAAudioFIFO* _getFIFO(struct GBAAudio* audio, int fifoId) {
+	if (fifoId == 0) {
+		return &audio->chA;
+	} else if (fifoId == 1) {
+		return &audio->chB;
+	}
+	mLOG(GBA_AUDIO, ERROR, "Bad FIFO write to address 0x%03x", fifoId);
+	return NULL;
+}
+
+void GBAAudioSampleFIFO(struct GBAAudio* audio, int fifoId, int32_t cycles) {
+	struct GBAAudioFIFO* channel = _getFIFO(audio, fifoId);
+	if (!channel) {
+		return;
+	}
+	_sampleFIFO(audio, channel, mTimingCurrentTime(&audio->p->timing) - cycles, mTimingUntil(&audio->p->timing, &audio->sampleEvent));
+}
+
+void GBAAudioSampleFIFOBulk(struct GBAAudio* audio, int fifoId, int32_t timestamp) {
+	struct GBAAudioFIFO* channel = _getFIFO(audio, fifoId);
+	if (!channel) {
+		return;
+	}
+	int32_t until = audio->lastSample + SAMPLE_INTERVAL - timestamp;
+	if (until > SAMPLE_INTERVAL) {
+		until = SAMPLE_INTERVAL;
+	}
+	// The overflow is already in the past, so the refill can't start any earlier than now
+	_sampleFIFO(audio, channel, mTimingCurrentTime(&audio->p->timing), until);
+}
+
+static void _runBulkFIFO(struct GBAAudio* audio, int32_t timestamp) {
+	// Overflows at the very end of the sample period can only be placed once the next one starts
+	int32_t periodEnd = audio->lastSample + SAMPLE_INTERVAL;
+	if (timestamp - periodEnd >= 0) {
+		timestamp = periodEnd - 1;
+	}
+	GBATimerRunBulk(audio->p, timestamp);
+}
+
 static int _applyBias(struct GBAAudio* audio, int sample) {
 	sample += GBARegisterSOUNDBIASGetBias(audio->soundbias);
 	if (sample >= 0x400) {
@@ -378,17 +433,24 @@ static int _applyBias(struct GBAAudio* audio, int sample) {
 }
 
 void GBAAudioSample(struct GBAAudio* audio, int32_t timestamp) {
+	_runBulkFIFO(audio, timestamp);
+	if (audio->outputDisabled) {
+		return;
+	}
 	timestamp -= audio->lastSample;
 	timestamp -= audio->sampleIndex * audio->sampleInterval; // TODO: This can break if the interval changes between samples
 
 	int maxSample = 2 << GBARegisterSOUNDBIASGetResolution(audio->soundbias);
+	int start = audio->sampleIndex;
+	int end;
+	for (end = start; timestamp >= audio->sampleInterval && end < maxSample; ++end, timestamp -= audio->sampleInterval);
+	GBAudioSamplePSGBatch(&audio->psg, start * audio->sampleInterval + audio->lastSample, audio->sampleInterval, &audio->currentSamples[start], end - start);
+
 	int sample;
-	for (sample = audio->sampleIndex; timestamp >= audio->sampleInterval && sample < maxSample; ++sample, timestamp -= audio->sampleInterval) {
-		int16_t sampleLeft = 0;
-		int16_t sampleRight = 0;
+	for (sample = start; sample < end; ++sample) {
+		int16_t sampleLeft = audio->currentSamples[sample].left;
+		int16_t sampleRight = audio->currentSamples[sample].right;
 		int psgShift = 4 - audio->volume;
-		GBAudioRun(&audio->psg, sample * audio->sampleInterval + audio->lastSample, 0xF);
-		GBAudioSamplePSG(&audio->psg, &sampleLeft, &sampleRight);
 		sampleLeft >>= psgShift;
 		sampleRight >>= psgShift;
 
@@ -432,12 +494,32 @@ void GBAAudioSample(struct GBAAudio* audio, int32_t timestamp) {
 
 static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 	struct GBAAudio* audio = user;
+	mPERF_ENTER(AUDIO);
+	if (audio->outputDisabled) {
+		// The channels are only run to keep their state from going stale; they're stepped in closed
+		// form, so doing it once per period ends up in the same place as doing it every sample.
+		// Games can't observe the mixed samples, so skip making them.
+		_runBulkFIFO(audio, mTimingCurrentTime(&audio->p->timing) - cyclesLate);
+		GBAudioRun(&audio->psg, mTimingCurrentTime(&audio->p->timing) - cyclesLate, 0xF);
+		audio->lastSample += SAMPLE_INTERVAL;
+		audio->sampleIndex = 0;
+		mTimingSchedule(timing, &audio->sampleEvent, SAMPLE_INTERVAL - cyclesLate);
+		mPERF_LEAVE();
+		return;
+	}
 	GBAAudioSample(audio, mTimingCurrentTime(&audio->p->timing) - cyclesLate);
 
 	int samples = 2 << GBARegisterSOUNDBIASGetResolution(audio->soundbias);
 	memset(audio->chA.samples, audio->chA.samples[samples - 1], sizeof(audio->chA.samples));
 	memset(audio->chB.samples, audio->chB.samples[samples - 1], sizeof(audio->chB.samples));
 
+	if (audio->outputSkipFrames) {
+		// Nobody will hear these samples, so don't resample them or wait for them to be consumed
+		mTimingSchedule(timing, &audio->sampleEvent, SAMPLE_INTERVAL - cyclesLate);
+		mPERF_LEAVE();
+		return;
+	}
+
 	mCoreSyncLockAudio(audio->p->sync);
 	unsigned produced;
 	int i;
@@ -460,10 +542,13 @@ static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 		if (audio->p->stream && audio->p->stream->postAudioFrame) {
 			audio->p->stream->postAudioFrame(audio->p->stream, sampleLeft, sampleRight);
 		}
+		if (audio->p->streamBuffer) {
+			mAVBufferPushSample(audio->p->streamBuffer, sampleLeft, sampleRight);
+		}
 	}
 	produced = blip_samples_avail(audio->psg.left);
 	bool wait = produced >= audio->samples;
-	if (!mCoreSyncProduceAudio(audio->p->sync, audio->psg.left, audio->samples)) {
+	if (!mCoreSyncProduceAudio(audio->p->sync, audio->psg.left, audio->psg.right, audio->samples)) {
 		// Interrupted
 		audio->p->earlyExit = true;
 	}
@@ -473,6 +558,7 @@ static void _sample(struct mTiming* timing, void* user, uint32_t cyclesLate) {
 	}
 
 	mTimingSchedule(timing, &audio->sampleEvent, SAMPLE_INTERVAL - cyclesLate);
+	mPERF_LEAVE();
 }
 
 void GBAAudioSerialize(const struct GBAAudio* audio, struct GBASerializedState* state) {
@@ -588,6 +674,10 @@ void GBAAudioDeserialize(struct GBAAudio* audio, const struct GBASerializedState
 	mTimingSchedule(&audio->p->timing, &audio->sampleEvent, when);
 }
 
+unsigned GBAAudioSampleRate(const struct GBAAudio* audio) {
+	return GBA_ARM7TDMI_FREQUENCY / audio->sampleInterval;
+}
+
 float GBAAudioCalculateRatio(float inputSampleRate, float desiredFPS, float desiredSampleRate) {
 	return desiredSampleRate * GBA_ARM7TDMI_FREQUENCY / (VIDEO_TOTAL_LENGTH * desiredFPS * inputSampleRate);
 }
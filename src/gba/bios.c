@@ -23,6 +23,163 @@ static void _unRl(struct GBA* gba, int width);
 static void _unFilter(struct GBA* gba, int inwidth, int outwidth);
 static void _unBitPack(struct GBA* gba);
 
+// The decompressors spend nearly all of their time on plain RAM, ROM and VRAM, so those accesses go
+// straight to host memory with the same cycle accounting as the bus. Anything else, or any access
+// while the bus is hooked (e.g. by watchpoints), takes the normal path.
+static inline void _biosWait(struct ARMCore* cpu, uint32_t address, int wait, int* cycleCounter) {
+	if (cycleCounter) {
+		if (address < GBA_BASE_ROM0) {
+			wait = GBAMemoryStall(cpu, wait);
+		}
+		*cycleCounter += wait;
+	}
+}
+
+static inline const uint8_t* _biosReadPage(struct GBA* gba, uint32_t address) {
+	uint32_t page = address >> GBA_PAGE_SHIFT;
+	return page < GBA_PAGES ? gba->memory.readPages[page] : NULL;
+}
+
+static inline uint8_t* _biosWritePage(struct GBA* gba, uint32_t address) {
+	uint32_t page = address >> GBA_PAGE_SHIFT;
+	return page < GBA_WRITE_PAGES ? gba->memory.writePages[page] : NULL;
+}
+
+static inline bool _biosIsPlainVRAM(struct GBA* gba, uint32_t address) {
+	// Watched stores and counted accesses have to go through the bus, just like pages do
+	if (gba->memory.watcher || gba->memory.stats) {
+		return false;
+	}
+	return (address >> BASE_OFFSET) == GBA_REGION_VRAM && (address & 0x0001FFFF) < GBA_SIZE_VRAM && !gba->video.shouldStall;
+}
+
+static inline uint32_t _biosLoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	struct GBA* gba = (struct GBA*) cpu->master;
+	const uint8_t* page = _biosReadPage(gba, address);
+	if (page && cpu->memory.load8 == GBALoad8) {
+		_biosWait(cpu, address, gba->memory.waitstatesNonseq16[address >> BASE_OFFSET] + 2, cycleCounter);
+		return page[address & (GBA_PAGE_SIZE - 1)];
+	}
+	return cpu->memory.load8(cpu, address, cycleCounter);
+}
+
+static inline uint32_t _biosLoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	struct GBA* gba = (struct GBA*) cpu->master;
+	if (cpu->memory.load16 == GBALoad16) {
+		uint32_t value;
+		const uint8_t* page = _biosReadPage(gba, address);
+		if (page) {
+			LOAD_16(value, address & (GBA_PAGE_SIZE - 2), page);
+			_biosWait(cpu, address, gba->memory.waitstatesNonseq16[address >> BASE_OFFSET] + 2, cycleCounter);
+			int rotate = (address & 1) << 3;
+			return ROR(value, rotate);
+		}
+		if (_biosIsPlainVRAM(gba, address)) {
+			LOAD_16(value, address & 0x0001FFFE, gba->video.vram);
+			_biosWait(cpu, address, 2, cycleCounter);
+			int rotate = (address & 1) << 3;
+			return ROR(value, rotate);
+		}
+	}
+	return cpu->memory.load16(cpu, address, cycleCounter);
+}
+
+static inline uint32_t _biosLoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	struct GBA* gba = (struct GBA*) cpu->master;
+	const uint8_t* page = _biosReadPage(gba, address);
+	if (page && cpu->memory.load32 == GBALoad32) {
+		uint32_t value;
+		LOAD_32(value, address & (GBA_PAGE_SIZE - 4), page);
+		_biosWait(cpu, address, gba->memory.waitstatesNonseq32[address >> BASE_OFFSET] + 2, cycleCounter);
+		int rotate = (address & 3) << 3;
+		return ROR(value, rotate);
+	}
+	return cpu->memory.load32(cpu, address, cycleCounter);
+}
+
+static inline void _biosStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCounter) {
+	struct GBA* gba = (struct GBA*) cpu->master;
+	uint8_t* page = _biosWritePage(gba, address);
+	if (page && cpu->memory.store8 == GBAStore8) {
+		uint32_t offset = address & (GBA_PAGE_SIZE - 1);
+		page[offset] = value;
+		gba->memory.dirtyPages[(page + offset - (uint8_t*) gba->memory.wram) >> GBA_DIRTY_PAGE_SHIFT] = 1;
+		_biosWait(cpu, address, gba->memory.waitstatesNonseq16[address >> BASE_OFFSET] + 1, cycleCounter);
+		return;
+	}
+	cpu->memory.store8(cpu, address, value, cycleCounter);
+}
+
+static inline void _biosStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycleCounter) {
+	struct GBA* gba = (struct GBA*) cpu->master;
+	if (cpu->memory.store16 == GBAStore16) {
+		uint8_t* page = _biosWritePage(gba, address);
+		if (page) {
+			uint32_t offset = address & (GBA_PAGE_SIZE - 2);
+			STORE_16(value, offset, page);
+			gba->memory.dirtyPages[(page + offset - (uint8_t*) gba->memory.wram) >> GBA_DIRTY_PAGE_SHIFT] = 1;
+			_biosWait(cpu, address, gba->memory.waitstatesNonseq16[address >> BASE_OFFSET] + 1, cycleCounter);
+			return;
+		}
+		if (_biosIsPlainVRAM(gba, address)) {
+			int16_t oldValue;
+			LOAD_16(oldValue, address & 0x0001FFFE, gba->video.vram);
+			if (value != oldValue) {
+				STORE_16(value, address & 0x0001FFFE, gba->video.vram);
+				gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
+			}
+			_biosWait(cpu, address, 1, cycleCounter);
+			return;
+		}
+	}
+	cpu->memory.store16(cpu, address, value, cycleCounter);
+}
+
+// Copies a short run of bytes entirely within one page of each side, charging what the byte-by-byte
+// loop would have. This is only exact when stalls don't depend on the prefetcher's state.
+static bool _biosCopyBytes(struct ARMCore* cpu, uint32_t dest, uint32_t source, int bytes, int overhead, int* cycleCounter) {
+	struct GBA* gba = (struct GBA*) cpu->master;
+	struct GBAMemory* memory = &gba->memory;
+	if (cpu->memory.load8 != GBALoad8 || cpu->memory.store8 != GBAStore8) {
+		return false;
+	}
+	if (memory->activeRegion >= GBA_REGION_ROM0 && memory->prefetch) {
+		return false;
+	}
+	if ((source >> GBA_PAGE_SHIFT) != ((source + bytes - 1) >> GBA_PAGE_SHIFT) || (dest >> GBA_PAGE_SHIFT) != ((dest + bytes - 1) >> GBA_PAGE_SHIFT)) {
+		return false;
+	}
+	const uint8_t* sourcePage = _biosReadPage(gba, source);
+	uint8_t* destPage = _biosWritePage(gba, dest);
+	if (!sourcePage || !destPage) {
+		return false;
+	}
+	const uint8_t* from = &sourcePage[source & (GBA_PAGE_SIZE - 1)];
+	uint8_t* to = &destPage[dest & (GBA_PAGE_SIZE - 1)];
+	int i;
+	// Overlapping runs repeat earlier output, so this must stay a forward byte copy
+	for (i = 0; i < bytes; ++i) {
+		to[i] = from[i];
+	}
+	memory->dirtyPages[(to - (uint8_t*) memory->wram) >> GBA_DIRTY_PAGE_SHIFT] = 1;
+	memory->dirtyPages[(to + bytes - 1 - (uint8_t*) memory->wram) >> GBA_DIRTY_PAGE_SHIFT] = 1;
+	*cycleCounter += bytes * (overhead + memory->waitstatesNonseq16[source >> BASE_OFFSET] + 2 + memory->waitstatesNonseq16[dest >> BASE_OFFSET] + 1);
+	return true;
+}
+
+static inline void _biosStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycleCounter) {
+	struct GBA* gba = (struct GBA*) cpu->master;
+	uint8_t* page = _biosWritePage(gba, address);
+	if (page && cpu->memory.store32 == GBAStore32) {
+		uint32_t offset = address & (GBA_PAGE_SIZE - 4);
+		STORE_32(value, offset, page);
+		gba->memory.dirtyPages[(page + offset - (uint8_t*) gba->memory.wram) >> GBA_DIRTY_PAGE_SHIFT] = 1;
+		_biosWait(cpu, address, gba->memory.waitstatesNonseq32[address >> BASE_OFFSET] + 1, cycleCounter);
+		return;
+	}
+	cpu->memory.store32(cpu, address, value, cycleCounter);
+}
+
 static int _mulWait(int32_t r) {
 	if ((r & 0xFFFFFF00) == 0xFFFFFF00 || !(r & 0xFFFFFF00)) {
 		return 1;
@@ -50,6 +207,7 @@ static void _SoftReset(struct GBA* gba) {
 	cpu->gprs[ARM_SP] = GBA_SP_BASE_SYSTEM;
 	int8_t flag = ((int8_t*) gba->memory.iwram)[0x7FFA];
 	memset(((int8_t*) gba->memory.iwram) + GBA_SIZE_IWRAM - 0x200, 0, 0x200);
+	GBAMemoryMarkDirty(&gba->memory);
 	if (flag) {
 		cpu->gprs[ARM_PC] = GBA_BASE_EWRAM;
 	} else {
@@ -69,6 +227,9 @@ static void _RegisterRamReset(struct GBA* gba) {
 	if (registers & 0x02) {
 		memset(gba->memory.iwram, 0, GBA_SIZE_IWRAM - 0x200);
 	}
+	if (registers & 0x03) {
+		GBAMemoryMarkDirty(&gba->memory);
+	}
 	if (registers & 0x04) {
 		memset(gba->video.palette, 0, GBA_SIZE_PALETTE_RAM);
 	}
@@ -423,6 +584,85 @@ static int32_t _Sqrt(uint32_t x, uint32_t* cycles) {
 	return bound;
 }
 
+static int32_t _burstCycles(const struct GBAMemory* memory, int region, int words) {
+	// Matches how GBALoadMultiple and GBAStoreMultiple charge a burst
+	return memory->waitstatesSeq32[region] - memory->waitstatesNonseq32[region] + words * (1 + memory->waitstatesSeq32[region]);
+}
+
+static bool _cpuSetDirect(struct GBA* gba, bool fast) {
+	struct ARMCore* cpu = gba->cpu;
+	struct GBAMemory* memory = &gba->memory;
+	uint32_t source = cpu->gprs[0];
+	uint32_t dest = cpu->gprs[1];
+	uint32_t control = cpu->gprs[2];
+	bool fill = control & (1 << 24);
+	int width = fast || (control & (1 << 26)) ? 4 : 2;
+	uint32_t count = control & 0xFFFFF;
+	if (fast) {
+		// CpuFastSet always works in bursts of 8 words
+		count = (count + 7) & ~7;
+	}
+	uint32_t size = count * width;
+	if ((source | dest) & (width - 1)) {
+		return false;
+	}
+
+	uint32_t value = 0;
+	if (fill) {
+		value = width == 4 ? cpu->memory.load32(cpu, source, NULL) : cpu->memory.load16(cpu, source, NULL);
+		if (!GBAMemoryFillDirect(gba, dest, value, size, width)) {
+			return false;
+		}
+	} else if (!GBAMemoryCopyDirect(gba, dest, source, size, fast ? 32 : 0)) {
+		return false;
+	}
+
+	// Charge what the BIOS loops would have taken: the same bus accesses, plus the loop instructions
+	int sourceRegion = source >> BASE_OFFSET;
+	int destRegion = dest >> BASE_OFFSET;
+	int32_t cycles;
+	if (fast) {
+		cycles = 5 + _burstCycles(memory, destRegion, 8);
+		if (!fill) {
+			cycles += 2 + _burstCycles(memory, sourceRegion, 8);
+		}
+		cycles = (fill ? 58 : 48) + cycles * (count >> 3);
+	} else {
+		if (width == 4) {
+			cycles = 5 + _burstCycles(memory, destRegion, 1);
+			if (!fill) {
+				cycles += 2 + _burstCycles(memory, sourceRegion, 1);
+			}
+		} else {
+			cycles = 5 + 1 + memory->waitstatesNonseq16[destRegion];
+			if (!fill) {
+				cycles += 2 + 1 + memory->waitstatesNonseq16[sourceRegion];
+			}
+		}
+		// The halfword fill has to align its pointers first
+		cycles = (width == 2 && fill ? 50 : 46) + cycles * count;
+	}
+	cpu->cycles += cycles;
+
+	// Leave the registers the way the BIOS routines do
+	if (fast) {
+		if (fill) {
+			cpu->gprs[3] = value;
+		} else {
+			cpu->gprs[3] = count ? cpu->memory.load32(cpu, source + size - 32, NULL) : control << 12;
+			cpu->gprs[0] += size;
+		}
+		cpu->gprs[1] += size;
+	} else {
+		if (width == 4) {
+			cpu->gprs[0] += fill ? 4 : size;
+			cpu->gprs[1] += size;
+		}
+		cpu->gprs[3] = 0x170;
+	}
+	return true;
+}
+
 void GBASwi16(struct ARMCore* cpu, int immediate) {
 	struct GBA* gba = (struct GBA*) cpu->master;
 	mLOG(GBA_BIOS, DEBUG, "SWI: %02X r0: %08X r1: %08X r2: %08X r3: %08X",
@@ -496,6 +736,9 @@ void GBASwi16(struct ARMCore* cpu, int immediate) {
 		if (cpu->gprs[1] & (cpu->gprs[2] & (1 << 26) ? 3 : 1)) {
 			mLOG(GBA_BIOS, GAME_ERROR, "Misaligned CpuSet destination");
 		}
+		if (gba->directCpuSet && _cpuSetDirect(gba, immediate == GBA_SWI_CPU_FAST_SET)) {
+			break;
+		}
 		ARMRaiseSWI(cpu);
 		return;
 	case GBA_SWI_GET_BIOS_CHECKSUM:
@@ -648,7 +891,7 @@ static void _unLz77(struct GBA* gba, int width) {
 	uint32_t source = cpu->gprs[0];
 	uint32_t dest = cpu->gprs[1];
 	int cycles = 20;
-	int remaining = (cpu->memory.load32(cpu, source, &cycles) & 0xFFFFFF00) >> 8;
+	int remaining = (_biosLoad32(cpu, source, &cycles) & 0xFFFFFF00) >> 8;
 	// We assume the signature byte (0x10) is correct
 	int blockheader = 0; // Some compilers warn if this isn't set, even though it's trivially provably always set
 	source += 4;
@@ -663,10 +906,15 @@ static void _unLz77(struct GBA* gba, int width) {
 			cycles += 18;
 			if (blockheader & 0x80) {
 				// Compressed
-				int block = cpu->memory.load8(cpu, source + 1, &cycles) | (cpu->memory.load8(cpu, source, &cycles) << 8);
+				int block = _biosLoad8(cpu, source + 1, &cycles) | (_biosLoad8(cpu, source, &cycles) << 8);
 				source += 2;
 				disp = dest - (block & 0x0FFF) - 1;
 				bytes = (block >> 12) + 3;
+				if (width == 1 && bytes <= remaining && _biosCopyBytes(cpu, dest, disp, bytes, 10, &cycles)) {
+					remaining -= bytes;
+					dest += bytes;
+					bytes = 0;
+				}
 				while (bytes--) {
 					cycles += 10;
 					if (remaining) {
@@ -680,36 +928,36 @@ static void _unLz77(struct GBA* gba, int width) {
 						}
 					}
 					if (width == 2) {
-						byte = (int16_t) cpu->memory.load16(cpu, disp & ~1, &cycles);
+						byte = (int16_t) _biosLoad16(cpu, disp & ~1, &cycles);
 						if (dest & 1) {
 							byte >>= (disp & 1) * 8;
 							halfword |= byte << 8;
-							cpu->memory.store16(cpu, dest ^ 1, halfword, &cycles);
+							_biosStore16(cpu, dest ^ 1, halfword, &cycles);
 						} else {
 							byte >>= (disp & 1) * 8;
 							halfword = byte & 0xFF;
 						}
 						cycles += 4;
 					} else {
-						byte = cpu->memory.load8(cpu, disp, &cycles);
-						cpu->memory.store8(cpu, dest, byte, &cycles);
+						byte = _biosLoad8(cpu, disp, &cycles);
+						_biosStore8(cpu, dest, byte, &cycles);
 					}
 					++disp;
 					++dest;
 				}
 			} else {
 				// Uncompressed
-				byte = cpu->memory.load8(cpu, source, &cycles);
+				byte = _biosLoad8(cpu, source, &cycles);
 				++source;
 				if (width == 2) {
 					if (dest & 1) {
 						halfword |= byte << 8;
-						cpu->memory.store16(cpu, dest ^ 1, halfword, &cycles);
+						_biosStore16(cpu, dest ^ 1, halfword, &cycles);
 					} else {
 						halfword = byte;
 					}
 				} else {
-					cpu->memory.store8(cpu, dest, byte, &cycles);
+					_biosStore8(cpu, dest, byte, &cycles);
 				}
 				++dest;
 				--remaining;
@@ -717,7 +965,7 @@ static void _unLz77(struct GBA* gba, int width) {
 			blockheader <<= 1;
 			--blocksRemaining;
 		} else {
-			blockheader = cpu->memory.load8(cpu, source, &cycles);
+			blockheader = _biosLoad8(cpu, source, &cycles);
 			++source;
 			blocksRemaining = 8;
 		}
@@ -737,7 +985,7 @@ static void _unHuffman(struct GBA* gba) {
 	struct ARMCore* cpu = gba->cpu;
 	uint32_t source = cpu->gprs[0] & 0xFFFFFFFC;
 	uint32_t dest = cpu->gprs[1];
-	uint32_t header = cpu->memory.load32(cpu, source, 0);
+	uint32_t header = _biosLoad32(cpu, source, 0);
 	int remaining = header >> 8;
 	unsigned bits = header & 0xF;
 	if (bits == 0) {
@@ -749,7 +997,7 @@ static void _unHuffman(struct GBA* gba) {
 		return;
 	}
 	// We assume the signature byte (0x20) is correct
-	int treesize = (cpu->memory.load8(cpu, source + 4, 0) << 1) + 1;
+	int treesize = (_biosLoad8(cpu, source + 4, 0) << 1) + 1;
 	int block = 0;
 	uint32_t treeBase = source + 5;
 	source += 5 + treesize;
@@ -758,28 +1006,28 @@ static void _unHuffman(struct GBA* gba) {
 	int bitsRemaining;
 	int readBits;
 	int bitsSeen = 0;
-	node = cpu->memory.load8(cpu, nPointer, 0);
+	node = _biosLoad8(cpu, nPointer, 0);
 	while (remaining > 0) {
-		uint32_t bitstream = cpu->memory.load32(cpu, source, 0);
+		uint32_t bitstream = _biosLoad32(cpu, source, 0);
 		source += 4;
 		for (bitsRemaining = 32; bitsRemaining > 0 && remaining > 0; --bitsRemaining, bitstream <<= 1) {
 			uint32_t next = (nPointer & ~1) + HuffmanNodeGetOffset(node) * 2 + 2;
 			if (bitstream & 0x80000000) {
 				// Go right
 				if (HuffmanNodeIsRTerm(node)) {
-					readBits = cpu->memory.load8(cpu, next + 1, 0);
+					readBits = _biosLoad8(cpu, next + 1, 0);
 				} else {
 					nPointer = next + 1;
-					node = cpu->memory.load8(cpu, nPointer, 0);
+					node = _biosLoad8(cpu, nPointer, 0);
 					continue;
 				}
 			} else {
 				// Go left
 				if (HuffmanNodeIsLTerm(node)) {
-					readBits = cpu->memory.load8(cpu, next, 0);
+					readBits = _biosLoad8(cpu, next, 0);
 				} else {
 					nPointer = next;
-					node = cpu->memory.load8(cpu, nPointer, 0);
+					node = _biosLoad8(cpu, nPointer, 0);
 					continue;
 				}
 			}
@@ -787,10 +1035,10 @@ static void _unHuffman(struct GBA* gba) {
 			block |= (readBits & ((1 << bits) - 1)) << bitsSeen;
 			bitsSeen += bits;
 			nPointer = treeBase;
-			node = cpu->memory.load8(cpu, nPointer, 0);
+			node = _biosLoad8(cpu, nPointer, 0);
 			if (bitsSeen == 32) {
 				bitsSeen = 0;
-				cpu->memory.store32(cpu, dest, block, 0);
+				_biosStore32(cpu, dest, block, 0);
 				dest += 4;
 				remaining -= 4;
 				block = 0;
@@ -804,7 +1052,7 @@ static void _unHuffman(struct GBA* gba) {
 static void _unRl(struct GBA* gba, int width) {
 	struct ARMCore* cpu = gba->cpu;
 	uint32_t source = cpu->gprs[0];
-	int remaining = (cpu->memory.load32(cpu, source & 0xFFFFFFFC, 0) & 0xFFFFFF00) >> 8;
+	int remaining = (_biosLoad32(cpu, source & 0xFFFFFFFC, 0) & 0xFFFFFF00) >> 8;
 	int padding = (4 - remaining) & 0x3;
 	// We assume the signature byte (0x30) is correct
 	int blockheader;
@@ -813,25 +1061,25 @@ static void _unRl(struct GBA* gba, int width) {
 	uint32_t dest = cpu->gprs[1];
 	int halfword = 0;
 	while (remaining > 0) {
-		blockheader = cpu->memory.load8(cpu, source, 0);
+		blockheader = _biosLoad8(cpu, source, 0);
 		++source;
 		if (blockheader & 0x80) {
 			// Compressed
 			blockheader &= 0x7F;
 			blockheader += 3;
-			block = cpu->memory.load8(cpu, source, 0);
+			block = _biosLoad8(cpu, source, 0);
 			++source;
 			while (blockheader-- && remaining) {
 				--remaining;
 				if (width == 2) {
 					if (dest & 1) {
 						halfword |= block << 8;
-						cpu->memory.store16(cpu, dest ^ 1, halfword, 0);
+						_biosStore16(cpu, dest ^ 1, halfword, 0);
 					} else {
 						halfword = block;
 					}
 				} else {
-					cpu->memory.store8(cpu, dest, block, 0);
+					_biosStore8(cpu, dest, block, 0);
 				}
 				++dest;
 			}
@@ -840,17 +1088,17 @@ static void _unRl(struct GBA* gba, int width) {
 			blockheader++;
 			while (blockheader-- && remaining) {
 				--remaining;
-				int byte = cpu->memory.load8(cpu, source, 0);
+				int byte = _biosLoad8(cpu, source, 0);
 				++source;
 				if (width == 2) {
 					if (dest & 1) {
 						halfword |= byte << 8;
-						cpu->memory.store16(cpu, dest ^ 1, halfword, 0);
+						_biosStore16(cpu, dest ^ 1, halfword, 0);
 					} else {
 						halfword = byte;
 					}
 				} else {
-					cpu->memory.store8(cpu, dest, byte, 0);
+					_biosStore8(cpu, dest, byte, 0);
 				}
 				++dest;
 			}
@@ -862,11 +1110,11 @@ static void _unRl(struct GBA* gba, int width) {
 			++dest;
 		}
 		for (; padding > 0; padding -= 2, dest += 2) {
-			cpu->memory.store16(cpu, dest, 0, 0);
+			_biosStore16(cpu, dest, 0, 0);
 		}
 	} else {
 		while (padding--) {
-			cpu->memory.store8(cpu, dest, 0, 0);
+			_biosStore8(cpu, dest, 0, 0);
 			++dest;
 		}
 	}
@@ -878,7 +1126,7 @@ static void _unFilter(struct GBA* gba, int inwidth, int outwidth) {
 	struct ARMCore* cpu = gba->cpu;
 	uint32_t source = cpu->gprs[0] & 0xFFFFFFFC;
 	uint32_t dest = cpu->gprs[1];
-	uint32_t header = cpu->memory.load32(cpu, source, 0);
+	uint32_t header = _biosLoad32(cpu, source, 0);
 	int remaining = header >> 8;
 	// We assume the signature nybble (0x8) is correct
 	uint16_t halfword = 0;
@@ -887,25 +1135,25 @@ static void _unFilter(struct GBA* gba, int inwidth, int outwidth) {
 	while (remaining > 0) {
 		uint16_t new;
 		if (inwidth == 1) {
-			new = cpu->memory.load8(cpu, source, 0);
+			new = _biosLoad8(cpu, source, 0);
 		} else {
-			new = cpu->memory.load16(cpu, source, 0);
+			new = _biosLoad16(cpu, source, 0);
 		}
 		new += old;
 		if (outwidth > inwidth) {
 			halfword >>= 8;
 			halfword |= (new << 8);
 			if (source & 1) {
-				cpu->memory.store16(cpu, dest, halfword, 0);
+				_biosStore16(cpu, dest, halfword, 0);
 				dest += outwidth;
 				remaining -= outwidth;
 			}
 		} else if (outwidth == 1) {
-			cpu->memory.store8(cpu, dest, new, 0);
+			_biosStore8(cpu, dest, new, 0);
 			dest += outwidth;
 			remaining -= outwidth;
 		} else {
-			cpu->memory.store16(cpu, dest, new, 0);
+			_biosStore16(cpu, dest, new, 0);
 			dest += outwidth;
 			remaining -= outwidth;
 		}
@@ -921,9 +1169,9 @@ static void _unBitPack(struct GBA* gba) {
 	uint32_t source = cpu->gprs[0];
 	uint32_t dest = cpu->gprs[1];
 	uint32_t info = cpu->gprs[2];
-	unsigned sourceLen = cpu->memory.load16(cpu, info, 0);
-	unsigned sourceWidth = cpu->memory.load8(cpu, info + 2, 0);
-	unsigned destWidth = cpu->memory.load8(cpu, info + 3, 0);
+	unsigned sourceLen = _biosLoad16(cpu, info, 0);
+	unsigned sourceWidth = _biosLoad8(cpu, info + 2, 0);
+	unsigned destWidth = _biosLoad8(cpu, info + 3, 0);
 	switch (sourceWidth) {
 	case 1:
 	case 2:
@@ -946,14 +1194,14 @@ static void _unBitPack(struct GBA* gba) {
 		mLOG(GBA_BIOS, GAME_ERROR, "Bad BitUnPack destination width: %u", destWidth);
 		return;
 	}
-	uint32_t bias = cpu->memory.load32(cpu, info + 4, 0);
+	uint32_t bias = _biosLoad32(cpu, info + 4, 0);
 	uint8_t in = 0;
 	uint32_t out = 0;
 	int bitsRemaining = 0;
 	int bitsEaten = 0;
 	while (sourceLen > 0 || bitsRemaining) {
 		if (!bitsRemaining) {
-			in = cpu->memory.load8(cpu, source, 0);
+			in = _biosLoad8(cpu, source, 0);
 			bitsRemaining = 8;
 			++source;
 			--sourceLen;
@@ -967,7 +1215,7 @@ static void _unBitPack(struct GBA* gba) {
 		out |= scaled << bitsEaten;
 		bitsEaten += destWidth;
 		if (bitsEaten == 32) {
-			cpu->memory.store32(cpu, dest, out, 0);
+			_biosStore32(cpu, dest, out, 0);
 			bitsEaten = 0;
 			out = 0;
 			dest += 4;
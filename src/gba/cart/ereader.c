@@ -8,6 +8,7 @@
 
 #include <mgba/internal/arm/macros.h>
 #include <mgba/internal/gba/gba.h>
+#include <mgba-util/crc32.h>
 #include <mgba-util/memory.h>
 
 #ifdef USE_FFMPEG
@@ -28,6 +29,7 @@ static void _eReaderWriteControl1(struct GBACartEReader* ereader, uint8_t value)
 static void _eReaderReadData(struct GBACartEReader* ereader);
 static void _eReaderReedSolomon(const uint8_t* input, uint8_t* output);
 static void _eReaderScanCard(struct GBACartEReader* ereader);
+static void _eReaderRenderDots(uint8_t* dots, const void* data, size_t size);
 
 const int EREADER_NYBBLE_5BIT[16][5] = {
 	{ 0, 0, 0, 0, 0 },
@@ -198,13 +200,16 @@ void GBACartEReaderDeinit(struct GBACartEReader* ereader) {
 		mappedMemoryFree(ereader->dots, EREADER_DOTCODE_SIZE);
 		ereader->dots = NULL;
 	}
+	ereader->dotsCrc = 0;
+	ereader->dotsSize = 0;
 	int i;
 	for (i = 0; i < EREADER_CARDS_MAX; ++i) {
-		if (!ereader->cards[i].data) {
+		if (!ereader->cards[i].dots) {
 			continue;
 		}
-		free(ereader->cards[i].data);
-		ereader->cards[i].data = NULL;
+		mappedMemoryFree(ereader->cards[i].dots, EREADER_DOTCODE_SIZE);
+		ereader->cards[i].dots = NULL;
+		ereader->cards[i].crc = 0;
 		ereader->cards[i].size = 0;
 	}
 }
@@ -368,7 +373,13 @@ void GBACartEReaderScan(struct GBACartEReader* ereader, const void* data, size_t
 		ereader->dots = anonymousMemoryMap(EREADER_DOTCODE_SIZE);
 	}
 	ereader->scanX = -24;
-	memset(ereader->dots, 0, EREADER_DOTCODE_SIZE);
+	ereader->dotsCrc = crc32(0, data, size);
+	ereader->dotsSize = size;
+	_eReaderRenderDots(ereader->dots, data, size);
+}
+
+static void _eReaderRenderDots(uint8_t* dots, const void* data, size_t size) {
+	memset(dots, 0, EREADER_DOTCODE_SIZE);
 
 	uint8_t blockRS[44][0x10];
 	uint8_t block0[0x30];
@@ -420,7 +431,7 @@ void GBACartEReaderScan(struct GBACartEReader* ereader, const void* data, size_t
 		size_t x;
 		for (i = 0; i < 40; ++i) {
 			const uint8_t* line = &cdata[(i + 2) * blocks];
-			uint8_t* origin = &ereader->dots[EREADER_DOTCODE_STRIDE * i + 200];
+			uint8_t* origin = &dots[EREADER_DOTCODE_STRIDE * i + 200];
 			for (x = 0; x < blocks; ++x) {
 				uint8_t byte = line[x];
 				if (x == 123) {
@@ -440,7 +451,7 @@ void GBACartEReaderScan(struct GBACartEReader* ereader, const void* data, size_t
 	}
 
 	for (i = 0; i < blocks + 1; ++i) {
-		uint8_t* origin = &ereader->dots[35 * i + 200];
+		uint8_t* origin = &dots[35 * i + 200];
 		_eReaderAnchor(&origin[EREADER_DOTCODE_STRIDE * 0]);
 		_eReaderAnchor(&origin[EREADER_DOTCODE_STRIDE * 35]);
 		_eReaderAddress(origin, base + i);
@@ -495,7 +506,7 @@ void GBACartEReaderScan(struct GBACartEReader* ereader, const void* data, size_t
 	size_t byteOffset = 0;
 	for (i = 0; i < blocks; ++i) {
 		uint8_t block[1040];
-		uint8_t* origin = &ereader->dots[35 * i + 200];
+		uint8_t* origin = &dots[35 * i + 200];
 		_eReaderAlignment(&origin[EREADER_DOTCODE_STRIDE * 2]);
 		_eReaderAlignment(&origin[EREADER_DOTCODE_STRIDE * 37]);
 
@@ -724,32 +735,63 @@ void _eReaderReadData(struct GBACartEReader* ereader) {
 
 
 void _eReaderScanCard(struct GBACartEReader* ereader) {
+	int i;
+	for (i = 0; i < EREADER_CARDS_MAX; ++i) {
+		struct EReaderCard* card = &ereader->cards[i];
+		if (!card->dots) {
+			continue;
+		}
+		// The dots were rendered when the card was queued, so swapping them in is all that's left
+		if (ereader->dots) {
+			mappedMemoryFree(ereader->dots, EREADER_DOTCODE_SIZE);
+		}
+		ereader->dots = card->dots;
+		ereader->dotsCrc = card->crc;
+		ereader->dotsSize = card->size;
+		ereader->scanX = -24;
+		card->dots = NULL;
+		card->crc = 0;
+		card->size = 0;
+		return;
+	}
 	if (ereader->dots) {
 		memset(ereader->dots, 0, EREADER_DOTCODE_SIZE);
 	}
+	ereader->dotsCrc = 0;
+	ereader->dotsSize = 0;
+}
+
+static const uint8_t* _eReaderFindDots(const struct GBACartEReader* ereader, uint32_t crc, size_t size) {
+	if (ereader->dots && ereader->dotsSize == size && ereader->dotsCrc == crc) {
+		return ereader->dots;
+	}
 	int i;
 	for (i = 0; i < EREADER_CARDS_MAX; ++i) {
-		if (!ereader->cards[i].data) {
-			continue;
+		const struct EReaderCard* card = &ereader->cards[i];
+		if (card->dots && card->size == size && card->crc == crc) {
+			return card->dots;
 		}
-		GBACartEReaderScan(ereader, ereader->cards[i].data, ereader->cards[i].size);
-		free(ereader->cards[i].data);
-		ereader->cards[i].data = NULL;
-		ereader->cards[i].size = 0;
-		break;
 	}
+	return NULL;
 }
 
 void GBACartEReaderQueueCard(struct GBA* gba, const void* data, size_t size) {
 	struct GBACartEReader* ereader = &gba->memory.ereader;
 	int i;
 	for (i = 0; i < EREADER_CARDS_MAX; ++i) {
-		if (ereader->cards[i].data) {
+		struct EReaderCard* card = &ereader->cards[i];
+		if (card->dots) {
 			continue;
 		}
-		ereader->cards[i].data = malloc(size);
-		memcpy(ereader->cards[i].data, data, size);
-		ereader->cards[i].size = size;
+		card->crc = crc32(0, data, size);
+		card->size = size;
+		card->dots = anonymousMemoryMap(EREADER_DOTCODE_SIZE);
+		const uint8_t* cached = _eReaderFindDots(ereader, card->crc, size);
+		if (cached && cached != card->dots) {
+			memcpy(card->dots, cached, EREADER_DOTCODE_SIZE);
+		} else {
+			_eReaderRenderDots(card->dots, data, size);
+		}
 		return;
 	}
 }
@@ -103,6 +103,7 @@ void GBAHardwareInitRTC(struct GBACartridgeHardware* hw) {
 
 	hw->rtc.lastLatch = 0;
 	hw->rtc.offset = 0;
+	hw->rtc.dateValid = false;
 }
 
 void _readPins(struct GBACartridgeHardware* hw) {
@@ -284,8 +285,12 @@ void _rtcUpdateClock(struct GBACartridgeHardware* hw) {
 	hw->rtc.lastLatch = t;
 	t -= hw->rtc.offset;
 
-	struct tm date;
-	localtime_r(&t, &date);
+	if (!hw->rtc.dateValid || hw->rtc.dateTime != t) {
+		localtime_r(&t, &hw->rtc.date);
+		hw->rtc.dateTime = t;
+		hw->rtc.dateValid = true;
+	}
+	const struct tm date = hw->rtc.date;
 	hw->rtc.time[0] = _rtcBCD(date.tm_year - 100);
 	hw->rtc.time[1] = _rtcBCD(date.tm_mon + 1);
 	hw->rtc.time[2] = _rtcBCD(date.tm_mday);
@@ -13,6 +13,11 @@
 
 #define MAPPING_MASK (GBA_MATRIX_MAPPINGS_MAX - 1)
 
+static void _loadPages(struct GBA* gba, int page, uint32_t paddr, int count) {
+	gba->romVf->seek(gba->romVf, paddr, SEEK_SET);
+	gba->romVf->read(gba->romVf, &gba->memory.rom[page << 7], count << 9);
+}
+
 static void _remapMatrix(struct GBA* gba) {
 	if (gba->memory.matrix.vaddr & 0xFFFFE1FF) {
 		mLOG(GBA_MEM, ERROR, "Invalid Matrix mapping: %08X", gba->memory.matrix.vaddr);
@@ -27,18 +32,29 @@ static void _remapMatrix(struct GBA* gba) {
 		return;
 	}
 	int start = gba->memory.matrix.vaddr >> 9;
-	int size = (gba->memory.matrix.size >> 9) & MAPPING_MASK;
+	int size = gba->memory.matrix.size >> 9;
+	int run = 0;
 	int i;
-	for (i = 0; i < size; ++i) {
-		gba->memory.matrix.mappings[(start + i) & MAPPING_MASK] = gba->memory.matrix.paddr + (i << 9);
+	for (i = 0; i <= size; ++i) {
+		int page = (start + i) & MAPPING_MASK;
+		uint32_t paddr = gba->memory.matrix.paddr + (i << 9);
+		// Pages that are already mapped to the same place don't need to be read again
+		if (i < size && !((gba->memory.matrix.loaded & (1 << page)) && gba->memory.matrix.mappings[page] == paddr)) {
+			gba->memory.matrix.mappings[page] = paddr;
+			gba->memory.matrix.loaded |= 1 << page;
+			++run;
+			continue;
+		}
+		if (run) {
+			_loadPages(gba, start + i - run, gba->memory.matrix.paddr + ((i - run) << 9), run);
+			run = 0;
+		}
 	}
-
-	gba->romVf->seek(gba->romVf, gba->memory.matrix.paddr, SEEK_SET);
-	gba->romVf->read(gba->romVf, &gba->memory.rom[gba->memory.matrix.vaddr >> 2], gba->memory.matrix.size);
 }
 
 void GBAMatrixReset(struct GBA* gba) {
 	memset(gba->memory.matrix.mappings, 0, sizeof(gba->memory.matrix.mappings));
+	gba->memory.matrix.loaded = 0;
 	gba->memory.matrix.size = 0x1000;
 
 	gba->memory.matrix.paddr = 0;
@@ -118,6 +134,7 @@ void GBAMatrixDeserialize(struct GBA* gba, const struct GBASerializedState* stat
 		mLOG(GBA_MEM, ERROR, "Matrix memory deserialization is broken!");
 	}
 	gba->memory.matrix.size = 0x200;
+	gba->memory.matrix.loaded = 0;
 
 	int i;
 	for (i = 0; i < 16; ++i) {
@@ -37,6 +37,7 @@ static const char INIT_SEQUENCE[16] = { 0xB4, 0x00, 0x9F, 0xE5, 0x99, 0x10, 0xA0
 
 static bool _isInMirroredArea(uint32_t address, size_t romSize);
 static uint32_t _getPatternValue(uint32_t addr);
+static uint32_t _getCachedPatternValue(struct GBAVFameCart* cart, uint32_t addr);
 static uint32_t _patternRightShift2(uint32_t addr);
 static int8_t _modifySramValue(enum GBAVFameCartType type, uint8_t value, int mode);
 static uint32_t _modifySramAddress(enum GBAVFameCartType type, uint32_t address, int mode);
@@ -47,6 +48,7 @@ void GBAVFameInit(struct GBAVFameCart* cart) {
 	cart->sramMode = -1;
 	cart->romMode = -1;
 	cart->acceptingModeChange = false;
+	cart->patternBank = -1;
 }
 
 void GBAVFameDetect(struct GBAVFameCart* cart, uint32_t* rom, size_t romSize) {
@@ -103,22 +105,39 @@ static bool _isInMirroredArea(uint32_t address, size_t romSize) {
 }
 
 // Looks like only 16-bit reads are done by games but others are possible...
-uint32_t GBAVFameGetPatternValue(uint32_t address, int bits) {
+uint32_t GBAVFameGetPatternValue(struct GBAVFameCart* cart, uint32_t address, int bits) {
 	switch (bits) {
 	case 8:
 		if (address & 1) {
 			return _getPatternValue(address) & 0xFF;
 		} else {
-			return (_getPatternValue(address) & 0xFF00) >> 8;
+			return (_getCachedPatternValue(cart, address) & 0xFF00) >> 8;
 		}
 	case 16:
-		return _getPatternValue(address);
+		return _getCachedPatternValue(cart, address);
 	case 32:
-		return (_getPatternValue(address) << 2) + _getPatternValue(address + 2);
+		return (_getCachedPatternValue(cart, address) << 2) + _getCachedPatternValue(cart, address + 2);
 	}
 	return 0;
 }
 
+// Games read these a whole bank at a time, so work out the bank's values once instead of for every read
+static uint32_t _getCachedPatternValue(struct GBAVFameCart* cart, uint32_t addr) {
+	if (addr & 1) {
+		return _getPatternValue(addr);
+	}
+	int bank = (addr & 0x1F0000) >> 16;
+	if (cart->patternBank != bank) {
+		uint32_t base = addr & 0x1F0000;
+		size_t i;
+		for (i = 0; i < sizeof(cart->patternCache) / sizeof(*cart->patternCache); ++i) {
+			cart->patternCache[i] = _getPatternValue(base + i * 2);
+		}
+		cart->patternBank = bank;
+	}
+	return cart->patternCache[(addr & 0xFFFF) >> 1];
+}
+
 // when you read from a ROM location outside the actual ROM data or its mirror, it returns a value based on some 16-bit transformation of the address
 // which the game relies on to run
 static uint32_t _getPatternValue(uint32_t addr) {
@@ -193,6 +193,7 @@ bool GBACheatAddVBALine(struct GBACheatSet* cheats, const char* line) {
 
 bool GBACheatAddLine(struct mCheatSet* set, const char* line, int type) {
 	struct GBACheatSet* cheats = (struct GBACheatSet*) set;
+	mCheatSetInvalidate(set);
 	switch (type) {
 	case GBA_CHEAT_AUTODETECT:
 		break;
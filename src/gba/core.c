@@ -5,8 +5,11 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/gba/core.h>
 
+#include <mgba/core/av-buffer.h>
 #include <mgba/core/core.h>
+#include <mgba/core/library.h>
 #include <mgba/core/log.h>
+#include <mgba/core/serialize.h>
 #include <mgba/internal/arm/debugger/debugger.h>
 #include <mgba/internal/arm/isa-inlines.h>
 #include <mgba/internal/debugger/symbols.h>
@@ -18,6 +21,7 @@
 #include <mgba/internal/gba/overrides.h>
 #ifndef DISABLE_THREADING
 #include <mgba/feature/thread-proxy.h>
+#include <mgba/internal/gba/renderers/parallel.h>
 #endif
 #ifdef BUILD_GLES3
 #include <mgba/internal/gba/renderers/gl.h>
@@ -30,6 +34,7 @@
 #ifdef USE_ELF
 #include <mgba-util/elf-read.h>
 #endif
+#include <mgba-util/hash.h>
 #include <mgba-util/memory.h>
 #include <mgba-util/patch.h>
 #include <mgba-util/vfs.h>
@@ -207,16 +212,24 @@ struct GBACore {
 	struct mVideoLogContext* logContext;
 #endif
 	struct mCoreCallbacks logCallbacks;
+	struct mCoreCallbacks streamCallbacks;
+	color_t* streamSavedBuffer;
+	size_t streamSavedStride;
 #ifndef DISABLE_THREADING
 	struct mVideoThreadProxy threadProxy;
+	struct GBAVideoParallelProxy parallelProxy;
 #endif
 	struct mCPUComponent* components[CPU_COMPONENT_MAX];
 	const struct Configuration* overrides;
 	struct GBACartridgeOverride override;
 	bool hasOverride;
+#ifdef USE_SQLITE3
+	struct mLibrary* idleLoopDatabase;
+#endif
 	struct mDebuggerPlatform* debuggerPlatform;
 	struct mCheatDevice* cheatDevice;
 	struct GBAAudioMixer* audioMixer;
+	color_t* colorTable;
 	struct mCoreMemoryBlock memoryBlocks[12];
 	size_t nMemoryBlocks;
 	int memoryBlockType;
@@ -264,12 +277,16 @@ static bool _GBACoreInit(struct mCore* core) {
 	core->videoLogger = NULL;
 	gbacore->hasOverride = false;
 	gbacore->overrides = NULL;
+#ifdef USE_SQLITE3
+	gbacore->idleLoopDatabase = NULL;
+#endif
 	gbacore->debuggerPlatform = NULL;
 	gbacore->cheatDevice = NULL;
 #ifndef MINIMAL_CORE
 	gbacore->logContext = NULL;
 #endif
 	gbacore->audioMixer = NULL;
+	gbacore->colorTable = NULL;
 
 	GBACreate(gba);
 	// TODO: Restore cheats
@@ -292,6 +309,7 @@ static bool _GBACoreInit(struct mCore* core) {
 
 #ifndef DISABLE_THREADING
 	mVideoThreadProxyCreate(&gbacore->threadProxy);
+	GBAVideoParallelProxyCreate(&gbacore->parallelProxy, &gbacore->renderer, 1);
 #endif
 #ifndef MINIMAL_CORE
 	gbacore->vlProxy.logger = NULL;
@@ -305,7 +323,22 @@ static bool _GBACoreInit(struct mCore* core) {
 	return true;
 }
 
+static void _GBACoreDetachBufferPool(struct mCore* core);
+
 static void _GBACoreDeinit(struct mCore* core) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	_GBACoreDetachBufferPool(core);
+#ifdef USE_SQLITE3
+	if (gbacore->idleLoopDatabase) {
+		GBAOverrideSaveIdleLoop(core->board, gbacore->idleLoopDatabase);
+		mLibraryDestroy(gbacore->idleLoopDatabase);
+	}
+#endif
+#ifdef BUILD_GLES3
+	if (gbacore->glRenderer.shaderCache) {
+		gbacore->glRenderer.shaderCache->close(gbacore->glRenderer.shaderCache);
+	}
+#endif
 	ARMDeinit(core->cpu);
 	GBADestroy(core->board);
 	mappedMemoryFree(core->cpu, sizeof(struct ARMCore));
@@ -319,12 +352,12 @@ static void _GBACoreDeinit(struct mCore* core) {
 	}
 #endif
 
-	struct GBACore* gbacore = (struct GBACore*) core;
 	free(gbacore->debuggerPlatform);
 	if (gbacore->cheatDevice) {
 		mCheatDeviceDestroy(gbacore->cheatDevice);
 	}
 	free(gbacore->audioMixer);
+	free(gbacore->colorTable);
 	mCoreConfigFreeOpts(&core->opts);
 	free(core);
 }
@@ -353,6 +386,37 @@ static void _GBACoreSetSync(struct mCore* core, struct mCoreSync* sync) {
 	gba->sync = sync;
 }
 
+static void _GBACoreLoadPrefetchModel(struct GBA* gba, const struct mCoreConfig* config) {
+	const char* prefetchModel = mCoreConfigGetValue(config, "gba.prefetchModel");
+	if (!prefetchModel) {
+		return;
+	}
+	if (strcasecmp(prefetchModel, "accurate") == 0) {
+		gba->memory.prefetchModel = GBA_PREFETCH_ACCURATE;
+	} else if (strcasecmp(prefetchModel, "fast") == 0) {
+		gba->memory.prefetchModel = GBA_PREFETCH_FAST;
+	}
+}
+
+static void _GBACoreLoadShadowCallStack(struct GBA* gba, const struct mCoreConfig* config) {
+	bool shadowCallStack;
+	if (!mCoreConfigGetBoolValue(config, "gba.shadowCallStack", &shadowCallStack)) {
+		return;
+	}
+	if (shadowCallStack) {
+		ARMShadowStackEnable(gba->cpu);
+	} else {
+		ARMShadowStackDisable(gba->cpu);
+	}
+}
+
+static void _GBACoreLoadSlim(struct GBA* gba, const struct mCoreConfig* config) {
+	bool slim;
+	if (mCoreConfigGetBoolValue(config, "slim", &slim) && slim != gba->slim) {
+		GBASetSlim(gba, slim);
+	}
+}
+
 static void _GBACoreLoadConfig(struct mCore* core, const struct mCoreConfig* config) {
 	struct GBA* gba = core->board;
 	if (core->opts.mute) {
@@ -360,6 +424,7 @@ static void _GBACoreLoadConfig(struct mCore* core, const struct mCoreConfig* con
 	} else {
 		gba->audio.masterVolume = core->opts.volume;
 	}
+	gba->audio.outputDisabled = core->opts.disableAudio;
 	gba->video.frameskip = core->opts.frameskip;
 
 #if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
@@ -367,6 +432,18 @@ static void _GBACoreLoadConfig(struct mCore* core, const struct mCoreConfig* con
 	gbacore->overrides = mCoreConfigGetOverridesConst(config);
 #endif
 
+#ifdef USE_SQLITE3
+	const char* idleLoopDatabase = mCoreConfigGetValue(config, "idleLoopDatabase");
+	if (idleLoopDatabase) {
+		struct GBACore* gbacore = (struct GBACore*) core;
+		if (gbacore->idleLoopDatabase) {
+			GBAOverrideSaveIdleLoop(gba, gbacore->idleLoopDatabase);
+			mLibraryDestroy(gbacore->idleLoopDatabase);
+		}
+		gbacore->idleLoopDatabase = mLibraryLoad(idleLoopDatabase);
+	}
+#endif
+
 	const char* idleOptimization = mCoreConfigGetValue(config, "idleOptimization");
 	if (idleOptimization) {
 		if (strcasecmp(idleOptimization, "ignore") == 0) {
@@ -383,8 +460,20 @@ static void _GBACoreLoadConfig(struct mCore* core, const struct mCoreConfig* con
 	}
 
 	mCoreConfigGetBoolValue(config, "allowOpposingDirections", &gba->allowOpposingDirections);
+	if (mCoreConfigGetBoolValue(config, "gba.bulkFifo", &gba->audio.bulkFifo)) {
+		GBATimerUpdateEvents(gba);
+	}
+	mCoreConfigGetBoolValue(config, "gba.directCpuSet", &gba->directCpuSet);
+	_GBACoreLoadPrefetchModel(gba, config);
+	_GBACoreLoadShadowCallStack(gba, config);
+	_GBACoreLoadSlim(gba, config);
 
 	mCoreConfigCopyValue(&core->config, config, "allowOpposingDirections");
+	mCoreConfigCopyValue(&core->config, config, "slim");
+	mCoreConfigCopyValue(&core->config, config, "gba.bulkFifo");
+	mCoreConfigCopyValue(&core->config, config, "gba.directCpuSet");
+	mCoreConfigCopyValue(&core->config, config, "gba.prefetchModel");
+	mCoreConfigCopyValue(&core->config, config, "gba.shadowCallStack");
 	mCoreConfigCopyValue(&core->config, config, "gba.bios");
 	mCoreConfigCopyValue(&core->config, config, "gba.forceGbp");
 	mCoreConfigCopyValue(&core->config, config, "gba.audioHle");
@@ -392,9 +481,11 @@ static void _GBACoreLoadConfig(struct mCore* core, const struct mCoreConfig* con
 
 #ifndef DISABLE_THREADING
 	mCoreConfigCopyValue(&core->config, config, "threadedVideo");
+	mCoreConfigCopyValue(&core->config, config, "gba.videoBands");
 #endif
 	mCoreConfigCopyValue(&core->config, config, "hwaccelVideo");
 	mCoreConfigCopyValue(&core->config, config, "videoScale");
+	mCoreConfigCopyValue(&core->config, config, "glShaderCachePath");
 }
 
 static void _GBACoreReloadConfigOption(struct mCore* core, const char* option, const struct mCoreConfig* config) {
@@ -410,6 +501,7 @@ static void _GBACoreReloadConfigOption(struct mCore* core, const char* option, c
 		} else {
 			gba->audio.masterVolume = core->opts.volume;
 		}
+		gba->audio.outputDisabled = core->opts.disableAudio;
 		gba->video.frameskip = core->opts.frameskip;
 		return;
 	}
@@ -424,6 +516,12 @@ static void _GBACoreReloadConfigOption(struct mCore* core, const char* option, c
 		}
 		return;
 	}
+	if (strcmp("disableAudio", option) == 0) {
+		if (mCoreConfigGetBoolValue(config, "disableAudio", &core->opts.disableAudio)) {
+			gba->audio.outputDisabled = core->opts.disableAudio;
+		}
+		return;
+	}
 	if (strcmp("volume", option) == 0) {
 		if (mCoreConfigGetIntValue(config, "volume", &core->opts.volume) && !core->opts.mute) {
 			gba->audio.masterVolume = core->opts.volume;
@@ -443,6 +541,43 @@ static void _GBACoreReloadConfigOption(struct mCore* core, const char* option, c
 		mCoreConfigGetBoolValue(config, "allowOpposingDirections", &gba->allowOpposingDirections);
 		return;
 	}
+	if (strcmp("gba.bulkFifo", option) == 0) {
+		if (config != &core->config) {
+			mCoreConfigCopyValue(&core->config, config, "gba.bulkFifo");
+		}
+		if (mCoreConfigGetBoolValue(config, "gba.bulkFifo", &gba->audio.bulkFifo)) {
+			GBATimerUpdateEvents(gba);
+		}
+		return;
+	}
+	if (strcmp("gba.directCpuSet", option) == 0) {
+		if (config != &core->config) {
+			mCoreConfigCopyValue(&core->config, config, "gba.directCpuSet");
+		}
+		mCoreConfigGetBoolValue(config, "gba.directCpuSet", &gba->directCpuSet);
+		return;
+	}
+	if (strcmp("gba.prefetchModel", option) == 0) {
+		if (config != &core->config) {
+			mCoreConfigCopyValue(&core->config, config, "gba.prefetchModel");
+		}
+		_GBACoreLoadPrefetchModel(gba, config);
+		return;
+	}
+	if (strcmp("gba.shadowCallStack", option) == 0) {
+		if (config != &core->config) {
+			mCoreConfigCopyValue(&core->config, config, "gba.shadowCallStack");
+		}
+		_GBACoreLoadShadowCallStack(gba, config);
+		return;
+	}
+	if (strcmp("slim", option) == 0) {
+		if (config != &core->config) {
+			mCoreConfigCopyValue(&core->config, config, "slim");
+		}
+		_GBACoreLoadSlim(gba, config);
+		return;
+	}
 
 	struct GBACore* gbacore = (struct GBACore*) core;
 #ifdef BUILD_GLES3
@@ -538,6 +673,23 @@ static void _GBACoreSetVideoBuffer(struct mCore* core, color_t* buffer, size_t s
 	memset(gbacore->renderer.scanlineDirty, 0xFFFFFFFF, sizeof(gbacore->renderer.scanlineDirty));
 }
 
+static bool _GBACoreSetVideoFormat(struct mCore* core, enum mColorFormat format) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	if (format == mCOLOR_NATIVE) {
+		gbacore->renderer.colorTable = NULL;
+		return true;
+	}
+	if (format != mCOLOR_NATIVE_SWAPPED) {
+		return false;
+	}
+	if (!gbacore->colorTable) {
+		gbacore->colorTable = malloc(M_COLOR_TABLE_555_SIZE * sizeof(color_t));
+		mColorTableFrom555(gbacore->colorTable, format);
+	}
+	gbacore->renderer.colorTable = gbacore->colorTable;
+	return true;
+}
+
 static void _GBACoreSetVideoGLTex(struct mCore* core, unsigned texid) {
 #ifdef BUILD_GLES3
 	struct GBACore* gbacore = (struct GBACore*) core;
@@ -559,6 +711,23 @@ static void _GBACorePutPixels(struct mCore* core, const void* buffer, size_t str
 	gba->video.renderer->putPixels(gba->video.renderer, stride, buffer);
 }
 
+static bool _GBACoreGetChangedScanlines(struct mCore* core, uint32_t* scanlines) {
+	struct GBA* gba = core->board;
+	const void* pixels;
+	size_t stride;
+	// Proxied renderers only hand over which rows changed once they've caught up
+	gba->video.renderer->getPixels(gba->video.renderer, &stride, &pixels);
+	GBAVideoCollectChangedScanlines(&gba->video);
+	bool changed = false;
+	size_t i;
+	for (i = 0; i < sizeof(gba->video.coreChangedScanlines) / sizeof(*gba->video.coreChangedScanlines); ++i) {
+		scanlines[i] = gba->video.coreChangedScanlines[i];
+		changed = changed || scanlines[i];
+		gba->video.coreChangedScanlines[i] = 0;
+	}
+	return changed;
+}
+
 static struct blip_t* _GBACoreGetAudioChannel(struct mCore* core, int ch) {
 	struct GBA* gba = core->board;
 	switch (ch) {
@@ -581,6 +750,11 @@ static size_t _GBACoreGetAudioBufferSize(struct mCore* core) {
 	return gba->audio.samples;
 }
 
+static unsigned _GBACoreAudioSampleRate(const struct mCore* core) {
+	const struct GBA* gba = core->board;
+	return GBAAudioSampleRate(&gba->audio);
+}
+
 static void _GBACoreAddCoreCallbacks(struct mCore* core, struct mCoreCallbacks* coreCallbacks) {
 	struct GBA* gba = core->board;
 	*mCoreCallbacksListAppend(&gba->coreCallbacks) = *coreCallbacks;
@@ -589,11 +763,80 @@ static void _GBACoreAddCoreCallbacks(struct mCore* core, struct mCoreCallbacks*
 static void _GBACoreClearCoreCallbacks(struct mCore* core) {
 	struct GBA* gba = core->board;
 	mCoreCallbacksListClear(&gba->coreCallbacks);
+	struct GBACore* gbacore = (struct GBACore*) core;
+	if (gba->streamBuffer) {
+		// This one is internal, so it has to outlive whatever the frontend added
+		*mCoreCallbacksListAppend(&gba->coreCallbacks) = gbacore->streamCallbacks;
+	}
+#ifndef MINIMAL_CORE
+	if (gbacore->logContext && gbacore->logCallbacks.videoFrameEnded) {
+		// As is the one that takes video log keyframes
+		*mCoreCallbacksListAppend(&gba->coreCallbacks) = gbacore->logCallbacks;
+	}
+#endif
+}
+
+static void _GBACoreStreamFrameEnded(void* context) {
+	struct mCore* core = context;
+	struct GBA* gba = core->board;
+	if (!gba->streamBuffer || !gba->stream || gba->video.skipFrames) {
+		return;
+	}
+	unsigned width, height;
+	core->currentVideoSize(core, &width, &height);
+	struct mAVBuffer* next = mAVStreamSwapBuffer(gba->stream, gba->streamBuffer, width, height, gba->video.frameCounter, mTimingGlobalTime(&gba->timing));
+	if (next != gba->streamBuffer) {
+		gba->streamBuffer = next;
+		core->setVideoBuffer(core, next->pixels, next->stride);
+	}
+}
+
+static void _GBACoreDetachBufferPool(struct mCore* core) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	struct GBA* gba = core->board;
+	if (!gba->streamBuffer) {
+		return;
+	}
+	mAVBufferUnref(gba->streamBuffer);
+	gba->streamBuffer = NULL;
+	core->setVideoBuffer(core, gbacore->streamSavedBuffer, gbacore->streamSavedStride);
+
+	size_t i;
+	for (i = 0; i < mCoreCallbacksListSize(&gba->coreCallbacks); ++i) {
+		if (mCoreCallbacksListGetPointer(&gba->coreCallbacks, i)->videoFrameEnded == _GBACoreStreamFrameEnded) {
+			mCoreCallbacksListShift(&gba->coreCallbacks, i, 1);
+			break;
+		}
+	}
+}
+
+static void _GBACoreAttachBufferPool(struct mCore* core, struct mAVStream* stream) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	struct GBA* gba = core->board;
+	struct mAVBuffer* buffer = mAVBufferPoolAcquire(stream->bufferPool);
+	if (!buffer) {
+		return;
+	}
+	gba->streamBuffer = buffer;
+	gbacore->streamSavedBuffer = gbacore->renderer.outputBuffer;
+	gbacore->streamSavedStride = gbacore->renderer.outputBufferStride;
+	core->setVideoBuffer(core, buffer->pixels, buffer->stride);
+
+	memset(&gbacore->streamCallbacks, 0, sizeof(gbacore->streamCallbacks));
+	gbacore->streamCallbacks.videoFrameEnded = _GBACoreStreamFrameEnded;
+	gbacore->streamCallbacks.context = core;
+	core->addCoreCallbacks(core, &gbacore->streamCallbacks);
 }
 
 static void _GBACoreSetAVStream(struct mCore* core, struct mAVStream* stream) {
 	struct GBA* gba = core->board;
+	_GBACoreDetachBufferPool(core);
 	gba->stream = stream;
+	if (stream && stream->bufferPool && stream->postVideoBuffer) {
+		_GBACoreAttachBufferPool(core, stream);
+	}
+	// A new stream hasn't seen any frames that later ones could repeat
+	memset(gba->video.streamChangedScanlines, 0xFF, sizeof(gba->video.streamChangedScanlines));
 	if (stream && stream->videoDimensionsChanged) {
 		unsigned width, height;
 		core->currentVideoSize(core, &width, &height);
@@ -667,6 +910,11 @@ static void _GBACoreUnloadROM(struct mCore* core) {
 		mCheatDeviceDestroy(gbacore->cheatDevice);
 		gbacore->cheatDevice = NULL;
 	}
+#ifdef USE_SQLITE3
+	if (gbacore->idleLoopDatabase) {
+		GBAOverrideSaveIdleLoop(core->board, gbacore->idleLoopDatabase);
+	}
+#endif
 	GBAUnloadROM(core->board);
 }
 
@@ -693,6 +941,8 @@ static void _GBACoreReset(struct mCore* core) {
 	struct GBA* gba = (struct GBA*) core->board;
 	bool value;
 	UNUSED(value);
+	// The frame counter starts over, so a cached host time could otherwise be reused
+	core->rtc.hostTimeValid = false;
 	if (gbacore->renderer.outputBuffer
 #ifdef BUILD_GLES3
 	    || gbacore->glRenderer.outputTex != (unsigned) -1
@@ -705,16 +955,27 @@ static void _GBACoreReset(struct mCore* core) {
 #ifdef BUILD_GLES3
 		if (gbacore->glRenderer.outputTex != (unsigned) -1 && mCoreConfigGetBoolValue(&core->config, "hwaccelVideo", &value) && value) {
 			mCoreConfigGetIntValue(&core->config, "videoScale", &gbacore->glRenderer.scale);
+			const char* shaderCachePath = mCoreConfigGetValue(&core->config, "glShaderCachePath");
+			if (shaderCachePath && !gbacore->glRenderer.shaderCache) {
+				VDirCreate(shaderCachePath);
+				gbacore->glRenderer.shaderCache = VDirOpen(shaderCachePath);
+			}
 			renderer = &gbacore->glRenderer.d;
 		} else {
 			gbacore->glRenderer.scale = 1;
 		}
 #endif
 #ifndef DISABLE_THREADING
+		int bands;
 		if (mCoreConfigGetBoolValue(&core->config, "threadedVideo", &value) && value) {
 			if (!core->videoLogger) {
 				core->videoLogger = &gbacore->threadProxy.d;
 			}
+		} else if (renderer == &gbacore->renderer.d && mCoreConfigGetIntValue(&core->config, "gba.videoBands", &bands) && bands > 1) {
+			gbacore->parallelProxy.nBands = bands;
+			if (!core->videoLogger) {
+				core->videoLogger = &gbacore->parallelProxy.d;
+			}
 		}
 #endif
 #ifndef MINIMAL_CORE
@@ -751,6 +1012,11 @@ static void _GBACoreReset(struct mCore* core) {
 	} else {
 		GBAOverrideApplyDefaults(gba, gbacore->overrides);
 	}
+#ifdef USE_SQLITE3
+	if (gbacore->idleLoopDatabase) {
+		GBAOverrideLoadIdleLoop(gba, gbacore->idleLoopDatabase);
+	}
+#endif
 	if (forceGbp) {
 		gba->memory.hw.devices |= HW_GB_PLAYER_DETECTION;
 	}
@@ -836,6 +1102,16 @@ static void _GBACoreStep(struct mCore* core) {
 	ARMRun(core->cpu);
 }
 
+static void _GBACoreSkipVideoFrames(struct mCore* core, unsigned frames) {
+	struct GBA* gba = core->board;
+	gba->video.skipFrames = frames;
+}
+
+static void _GBACoreSkipAudioFrames(struct mCore* core, unsigned frames) {
+	struct GBA* gba = core->board;
+	gba->audio.outputSkipFrames = frames;
+}
+
 static size_t _GBACoreStateSize(struct mCore* core) {
 	UNUSED(core);
 	return sizeof(struct GBASerializedState);
@@ -850,6 +1126,137 @@ static bool _GBACoreSaveState(struct mCore* core, void* state) {
 	return true;
 }
 
+static bool _GBACoreSaveStateIncremental(struct mCore* core, void* state, uint32_t* epoch) {
+	GBASerializeIncremental(core->board, state, epoch);
+	return true;
+}
+
+static const struct mStateSection _GBAStateSections[] = {
+	{ "header", offsetof(struct GBASerializedState, versionMagic), offsetof(struct GBASerializedState, cpu) - offsetof(struct GBASerializedState, versionMagic) },
+	{ "cpu", offsetof(struct GBASerializedState, cpu), offsetof(struct GBASerializedState, audio) - offsetof(struct GBASerializedState, cpu) },
+	{ "audio", offsetof(struct GBASerializedState, audio), offsetof(struct GBASerializedState, video) - offsetof(struct GBASerializedState, audio) },
+	{ "system", offsetof(struct GBASerializedState, video), offsetof(struct GBASerializedState, samples) - offsetof(struct GBASerializedState, video) },
+	{ "samples", offsetof(struct GBASerializedState, samples), offsetof(struct GBASerializedState, io) - offsetof(struct GBASerializedState, samples) },
+	{ "io", offsetof(struct GBASerializedState, io), offsetof(struct GBASerializedState, pram) - offsetof(struct GBASerializedState, io) },
+	{ "pram", offsetof(struct GBASerializedState, pram), offsetof(struct GBASerializedState, oam) - offsetof(struct GBASerializedState, pram) },
+	{ "oam", offsetof(struct GBASerializedState, oam), offsetof(struct GBASerializedState, vram) - offsetof(struct GBASerializedState, oam) },
+	{ "vram", offsetof(struct GBASerializedState, vram), offsetof(struct GBASerializedState, iwram) - offsetof(struct GBASerializedState, vram) },
+	{ "iwram", offsetof(struct GBASerializedState, iwram), offsetof(struct GBASerializedState, wram) - offsetof(struct GBASerializedState, iwram) },
+	{ "wram", offsetof(struct GBASerializedState, wram), sizeof(struct GBASerializedState) - offsetof(struct GBASerializedState, wram) },
+};
+
+static size_t _GBACoreListStateSections(const struct mCore* core, const struct mStateSection** sections) {
+	UNUSED(core);
+	*sections = _GBAStateSections;
+	return sizeof(_GBAStateSections) / sizeof(*_GBAStateSections);
+}
+
+static struct mCore* _GBACoreClone(struct mCore* core) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	struct GBA* gba = core->board;
+	struct mCore* clone = GBACoreCreate();
+	if (!clone) {
+		return NULL;
+	}
+	if (!clone->init(clone)) {
+		free(clone);
+		return NULL;
+	}
+	mCoreInitConfig(clone, core->config.port);
+	mCoreLoadForeignConfig(clone, &core->config);
+	// The clone runs with whatever BIOS this core has, rather than looking for one on disk
+	clone->opts.useBios = false;
+
+	struct GBACore* clonecore = (struct GBACore*) clone;
+	struct GBA* cloneGba = clone->board;
+	clonecore->override = gbacore->override;
+	clonecore->hasOverride = gbacore->hasOverride;
+	cloneGba->romRegistry = gba->romRegistry;
+	if (!GBACloneROM(cloneGba, gba)) {
+		mCoreConfigDeinit(&clone->config);
+		clone->deinit(clone);
+		return NULL;
+	}
+	if (gba->biosVf) {
+		GBALoadBIOS(cloneGba, VFileMemChunk(gba->memory.bios, GBA_SIZE_BIOS));
+	}
+	void* sram = NULL;
+	size_t sramSize = core->savedataClone(core, &sram);
+	GBALoadSave(cloneGba, VFileMemChunk(sram, sramSize));
+	free(sram);
+	clone->rtc.override = core->rtc.override;
+	clone->rtc.value = core->rtc.value;
+	clone->rtc.custom = core->rtc.custom;
+	clone->reset(clone);
+
+	size_t stateSize = core->stateSize(core);
+	void* state = anonymousMemoryMap(stateSize);
+	bool success = state && core->saveState(core, state) && clone->loadState(clone, state);
+	if (state) {
+		mappedMemoryFree(state, stateSize);
+	}
+	if (!success) {
+		mCoreConfigDeinit(&clone->config);
+		clone->deinit(clone);
+		return NULL;
+	}
+	cloneGba->keysActive = gba->keysActive;
+	cloneGba->idleLoop = gba->idleLoop;
+	cloneGba->idleOptimization = gba->idleOptimization;
+	return clone;
+}
+
+static size_t _GBACoreMemoryUsage(struct mCore* core) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	struct GBA* gba = core->board;
+	size_t usage = sizeof(*gbacore);
+	usage += mappedMemoryResident(gba, sizeof(*gba));
+	usage += mappedMemoryResident(core->cpu, sizeof(struct ARMCore));
+	usage += mappedMemoryResident(gba->memory.wram, GBA_SIZE_EWRAM + GBA_SIZE_IWRAM);
+	usage += mappedMemoryResident(gba->video.vram, GBA_SIZE_VRAM);
+#ifndef FIXED_ROM_BUFFER
+	if (gba->memory.rom && !gba->isPristine && !gba->romImage) {
+		usage += mappedMemoryResident(gba->memory.rom, GBA_SIZE_ROM0);
+	}
+#endif
+	if (gba->memory.savedata.data && !gba->memory.savedata.vf) {
+		usage += mappedMemoryResident(gba->memory.savedata.data, GBASavedataSize(&gba->memory.savedata));
+	}
+	// Each sample in the output buffers is a 32-bit accumulator
+	usage += gba->audio.psg.bufferCapacity * sizeof(int32_t) * 2;
+	if (gbacore->audioMixer) {
+		usage += sizeof(*gbacore->audioMixer);
+	}
+	if (gbacore->colorTable) {
+		usage += M_COLOR_TABLE_555_SIZE * sizeof(color_t);
+	}
+	return usage;
+}
+
+static uint64_t _GBACoreStateHash(struct mCore* core) {
+	struct GBA* gba = core->board;
+	struct ARMCore* cpu = core->cpu;
+	int32_t registers[16 + 2 + 6 * 7 + 6 + 1];
+	memcpy(registers, cpu->gprs, sizeof(cpu->gprs));
+	registers[16] = cpu->cpsr.packed;
+	registers[17] = cpu->spsr.packed;
+	memcpy(&registers[18], cpu->bankedRegisters, sizeof(cpu->bankedRegisters));
+	memcpy(&registers[18 + 6 * 7], cpu->bankedSPSRs, sizeof(cpu->bankedSPSRs));
+	registers[18 + 6 * 7 + 6] = cpu->cycles;
+
+	// EWRAM and IWRAM are tracked per page, so only pages written since the last hash are rehashed
+	uint64_t hash = hash64(registers, sizeof(registers), 0);
+	hash = GBAMemoryHashRAM(&gba->memory, hash);
+	hash = hash64(gba->memory.io, sizeof(gba->memory.io), hash);
+	hash = hash64(gba->video.palette, sizeof(gba->video.palette), hash);
+	hash = hash64(gba->video.oam.raw, sizeof(gba->video.oam.raw), hash);
+	hash = hash64(gba->video.vram, GBA_SIZE_VRAM, hash);
+	if (gba->memory.savedata.data) {
+		hash = hash64(gba->memory.savedata.data, GBASavedataSize(&gba->memory.savedata), hash);
+	}
+	return hash;
+}
+
 static void _GBACoreSetKeys(struct mCore* core, uint32_t keys) {
 	struct GBA* gba = core->board;
 	gba->keysActive = keys;
@@ -1056,9 +1463,12 @@ void* _GBACoreGetMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
 		*sizeOut = GBA_SIZE_BIOS;
 		return gba->memory.bios;
 	case GBA_REGION_EWRAM:
+		// The caller may write through this pointer, which incremental savestates can't see
+		GBAMemoryMarkDirty(&gba->memory);
 		*sizeOut = GBA_SIZE_EWRAM;
 		return gba->memory.wram;
 	case GBA_REGION_IWRAM:
+		GBAMemoryMarkDirty(&gba->memory);
 		*sizeOut = GBA_SIZE_IWRAM;
 		return gba->memory.iwram;
 	case GBA_REGION_PALETTE_RAM:
@@ -1087,6 +1497,21 @@ void* _GBACoreGetMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
 	}
 }
 
+static bool _GBACoreSetMemoryWatcher(struct mCore* core, struct mCoreMemoryWatcher* watcher, const struct mCoreMemoryWatchRange* ranges, size_t nRanges) {
+	GBAMemorySetWatcher(core->board, watcher, ranges, nRanges);
+	return true;
+}
+
+static bool _GBACoreSetMemoryStatsEnabled(struct mCore* core, bool enable) {
+	GBAMemorySetStatsEnabled(core->board, enable);
+	return true;
+}
+
+static size_t _GBACoreMemoryStats(struct mCore* core, struct mCoreMemoryStats* stats, size_t max) {
+	struct GBA* gba = core->board;
+	return GBAMemoryCollectStats(&gba->memory, stats, max);
+}
+
 static size_t _GBACoreListRegisters(const struct mCore* core, const struct mCoreRegisterInfo** list) {
 	UNUSED(core);
 	*list = _GBARegisters;
@@ -1307,6 +1732,12 @@ static bool _GBACoreLookupIdentifier(struct mCore* core, const char* name, int32
 	}
 	return false;
 }
+
+static void _GBACoreCurrentPC(struct mCore* core, uint32_t* address, int* segment) {
+	struct ARMCore* cpu = core->cpu;
+	*address = cpu->gprs[ARM_PC] - (cpu->executionMode == MODE_THUMB ? WORD_SIZE_THUMB : WORD_SIZE_ARM);
+	*segment = -1;
+}
 #endif
 
 static struct mCheatDevice* _GBACoreCheatDevice(struct mCore* core) {
@@ -1462,6 +1893,12 @@ static void _GBACoreAdjustVideoLayer(struct mCore* core, size_t id, int32_t x, i
 }
 
 #ifndef MINIMAL_CORE
+static void _GBACoreVideoLogFrameEnded(void* context) {
+	struct mCore* core = context;
+	struct GBACore* gbacore = (struct GBACore*) core;
+	mVideoLogContextFrameEnded(gbacore->logContext, core);
+}
+
 static void _GBACoreStartVideoLog(struct mCore* core, struct mVideoLogContext* context) {
 	struct GBACore* gbacore = (struct GBACore*) core;
 	struct GBA* gba = core->board;
@@ -1479,6 +1916,11 @@ static void _GBACoreStartVideoLog(struct mCore* core, struct mVideoLogContext* c
 
 	GBAVideoProxyRendererCreate(&gbacore->vlProxy, gba->video.renderer);
 	GBAVideoProxyRendererShim(&gba->video, &gbacore->vlProxy);
+
+	memset(&gbacore->logCallbacks, 0, sizeof(gbacore->logCallbacks));
+	gbacore->logCallbacks.videoFrameEnded = _GBACoreVideoLogFrameEnded;
+	gbacore->logCallbacks.context = core;
+	core->addCoreCallbacks(core, &gbacore->logCallbacks);
 }
 
 static void _GBACoreEndVideoLog(struct mCore* core) {
@@ -1489,6 +1931,16 @@ static void _GBACoreEndVideoLog(struct mCore* core) {
 		free(gbacore->vlProxy.logger);
 		gbacore->vlProxy.logger = NULL;
 	}
+
+	size_t i;
+	for (i = 0; i < mCoreCallbacksListSize(&gba->coreCallbacks); ++i) {
+		if (mCoreCallbacksListGetPointer(&gba->coreCallbacks, i)->videoFrameEnded == _GBACoreVideoLogFrameEnded) {
+			mCoreCallbacksListShift(&gba->coreCallbacks, i, 1);
+			break;
+		}
+	}
+	memset(&gbacore->logCallbacks, 0, sizeof(gbacore->logCallbacks));
+	gbacore->logContext = NULL;
 }
 #endif
 
@@ -1513,11 +1965,14 @@ struct mCore* GBACoreCreate(void) {
 	core->screenRegions = _GBACoreScreenRegions;
 	core->setVideoBuffer = _GBACoreSetVideoBuffer;
 	core->setVideoGLTex = _GBACoreSetVideoGLTex;
+	core->setVideoFormat = _GBACoreSetVideoFormat;
 	core->getPixels = _GBACoreGetPixels;
 	core->putPixels = _GBACorePutPixels;
+	core->getChangedScanlines = _GBACoreGetChangedScanlines;
 	core->getAudioChannel = _GBACoreGetAudioChannel;
 	core->setAudioBufferSize = _GBACoreSetAudioBufferSize;
 	core->getAudioBufferSize = _GBACoreGetAudioBufferSize;
+	core->audioSampleRate = _GBACoreAudioSampleRate;
 	core->addCoreCallbacks = _GBACoreAddCoreCallbacks;
 	core->clearCoreCallbacks = _GBACoreClearCoreCallbacks;
 	core->setAVStream = _GBACoreSetAVStream;
@@ -1534,9 +1989,16 @@ struct mCore* GBACoreCreate(void) {
 	core->runFrame = _GBACoreRunFrame;
 	core->runLoop = _GBACoreRunLoop;
 	core->step = _GBACoreStep;
+	core->skipVideoFrames = _GBACoreSkipVideoFrames;
+	core->skipAudioFrames = _GBACoreSkipAudioFrames;
 	core->stateSize = _GBACoreStateSize;
 	core->loadState = _GBACoreLoadState;
 	core->saveState = _GBACoreSaveState;
+	core->saveStateIncremental = _GBACoreSaveStateIncremental;
+	core->listStateSections = _GBACoreListStateSections;
+	core->clone = _GBACoreClone;
+	core->memoryUsage = _GBACoreMemoryUsage;
+	core->stateHash = _GBACoreStateHash;
 	core->setKeys = _GBACoreSetKeys;
 	core->addKeys = _GBACoreAddKeys;
 	core->clearKeys = _GBACoreClearKeys;
@@ -1562,6 +2024,9 @@ struct mCore* GBACoreCreate(void) {
 	core->rawWrite32 = _GBACoreRawWrite32;
 	core->listMemoryBlocks = _GBACoreListMemoryBlocks;
 	core->getMemoryBlock = _GBACoreGetMemoryBlock;
+	core->setMemoryWatcher = _GBACoreSetMemoryWatcher;
+	core->setMemoryStatsEnabled = _GBACoreSetMemoryStatsEnabled;
+	core->memoryStats = _GBACoreMemoryStats;
 	core->listRegisters = _GBACoreListRegisters;
 	core->readRegister = _GBACoreReadRegister;
 	core->writeRegister = _GBACoreWriteRegister;
@@ -1573,6 +2038,7 @@ struct mCore* GBACoreCreate(void) {
 	core->detachDebugger = _GBACoreDetachDebugger;
 	core->loadSymbols = _GBACoreLoadSymbols;
 	core->lookupIdentifier = _GBACoreLookupIdentifier;
+	core->currentPC = _GBACoreCurrentPC;
 #endif
 	core->cheatDevice = _GBACoreCheatDevice;
 	core->savedataClone = _GBACoreSavedataClone;
@@ -1662,7 +2128,7 @@ static bool _GBAVLPLoadROM(struct mCore* core, struct VFile* vf) {
 static bool _GBAVLPLoadState(struct mCore* core, const void* state) {
 	struct GBA* gba = (struct GBA*) core->board;
 
-	gba->timing.root = NULL;
+	mTimingDescheduleAll(&gba->timing);
 	gba->cpu->gprs[ARM_PC] = GBA_BASE_EWRAM;
 	gba->cpu->memory.setActiveRegion(gba->cpu, gba->cpu->gprs[ARM_PC]);
 
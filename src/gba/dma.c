@@ -5,6 +5,8 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gba/dma.h>
 
+#include <mgba/core/perf.h>
+#include <mgba/internal/arm/macros.h>
 #include <mgba/internal/gba/gba.h>
 #include <mgba/internal/gba/io.h>
 
@@ -13,6 +15,8 @@ mLOG_DEFINE_CATEGORY(GBA_DMA, "GBA DMA", "gba.dma");
 static void _dmaEvent(struct mTiming* timing, void* context, uint32_t cyclesLate);
 
 static void GBADMAService(struct GBA* gba, int number, struct GBADMA* info);
+static void _bulkTransfer(struct GBA* gba, int number, struct GBADMA* info, int sourceOffset, int destOffset);
+static void _bulkTransferEEPROM(struct GBA* gba, int number, struct GBADMA* info, int sourceOffset, int destOffset);
 
 static const int DMA_OFFSET[] = { 1, -1, 0, 1 };
 
@@ -249,6 +253,7 @@ void GBADMAService(struct GBA* gba, int number, struct GBADMA* info) {
 	uint32_t sourceRegion = source >> BASE_OFFSET;
 	uint32_t destRegion = dest >> BASE_OFFSET;
 	int32_t cycles = 2;
+	mPERF_ENTER(DMA);
 
 	gba->cpuBlocked = true;
 	gba->performingDMA = 1 | (number << 1);
@@ -308,6 +313,15 @@ void GBADMAService(struct GBA* gba, int number, struct GBADMA* info) {
 	info->nextDest += destOffset;
 	--info->nextCount;
 
+	if (info->nextCount && source) {
+		if (width == 2 && (sourceRegion == GBA_REGION_ROM2_EX || destRegion == GBA_REGION_ROM2_EX) &&
+		    (memory->savedata.type == SAVEDATA_EEPROM || memory->savedata.type == SAVEDATA_EEPROM512)) {
+			_bulkTransferEEPROM(gba, number, info, sourceOffset, destOffset);
+		} else {
+			_bulkTransfer(gba, number, info, sourceOffset, destOffset);
+		}
+	}
+
 	gba->performingDMA = 0;
 
 	int i;
@@ -326,4 +340,168 @@ void GBADMAService(struct GBA* gba, int number, struct GBADMA* info) {
 		}
 	}
 	GBADMAUpdate(gba);
+	mPERF_LEAVE();
+}
+
+static bool _canBulkTransfer(struct GBA* gba, int number) {
+	struct GBAMemory* memory = &gba->memory;
+	struct ARMCore* cpu = gba->cpu;
+	if (cpu->memory.load32 != GBALoad32 || cpu->memory.store32 != GBAStore32 || cpu->memory.load16 != GBALoad16 || cpu->memory.store16 != GBAStore16) {
+		// Something like a watchpoint is hooked in, and needs to see every access
+		return false;
+	}
+	if (memory->watcher || memory->stats) {
+		// Watched stores have to be reported and accesses counted one unit at a time
+		return false;
+	}
+	int i;
+	for (i = 0; i < 4; ++i) {
+		if (i != number && GBADMARegisterIsEnable(memory->dma[i].reg) && memory->dma[i].nextCount) {
+			// Another DMA may need to take over between units
+			return false;
+		}
+	}
+	return true;
+}
+
+static void _bulkTransfer(struct GBA* gba, int number, struct GBADMA* info, int sourceOffset, int destOffset) {
+	struct GBAMemory* memory = &gba->memory;
+	if (!_canBulkTransfer(gba, number)) {
+		return;
+	}
+
+	// Nothing can observe units that start before the next event, so those can all be done now
+	uint32_t width = 2 << GBADMARegisterGetWidth(info->reg);
+	uint32_t currentTime = mTimingCurrentTime(&gba->timing);
+	int32_t nextEvent = mTimingNextEvent(&gba->timing);
+	// Video memory changes are collected and handed to the renderer once, after the run
+	uint32_t vramStart = GBA_SIZE_VRAM;
+	uint32_t vramEnd = 0;
+	uint32_t oamStart = GBA_SIZE_OAM;
+	uint32_t oamEnd = 0;
+	while (info->nextCount && (int32_t) (info->when - currentTime) < nextEvent) {
+		uint32_t source = info->nextSource;
+		uint32_t dest = info->nextDest;
+		uint32_t destRegion = dest >> BASE_OFFSET;
+		// Only plain RAM, ROM and unstalled VRAM and OAM are handled here, so anything else is left to GBADMAService
+		const uint8_t* sourcePage = memory->readPages[source >> GBA_PAGE_SHIFT];
+		uint8_t* destMemory;
+		uint32_t offset;
+		switch (destRegion) {
+		case GBA_REGION_VRAM:
+			offset = dest & 0x0001FFFF;
+			destMemory = gba->video.shouldStall || offset >= GBA_SIZE_VRAM ? NULL : (uint8_t*) gba->video.vram;
+			break;
+		case GBA_REGION_OAM:
+			offset = dest & (GBA_SIZE_OAM - 1);
+			destMemory = (uint8_t*) gba->video.oam.raw;
+			break;
+		default:
+			offset = dest & (GBA_PAGE_SIZE - 1);
+			destMemory = dest < GBA_BASE_IO ? memory->writePages[dest >> GBA_PAGE_SHIFT] : NULL;
+			break;
+		}
+		if (!sourcePage || !destMemory) {
+			break;
+		}
+		bool changed;
+		if (width == 4) {
+			uint32_t oldValue;
+			LOAD_32(memory->dmaTransferRegister, source & (GBA_PAGE_SIZE - 4), sourcePage);
+			offset &= ~3;
+			LOAD_32(oldValue, offset, destMemory);
+			changed = oldValue != memory->dmaTransferRegister;
+			STORE_32(memory->dmaTransferRegister, offset, destMemory);
+			info->when += 2 + memory->waitstatesSeq32[source >> BASE_OFFSET] + memory->waitstatesSeq32[destRegion];
+		} else {
+			uint16_t value;
+			uint16_t oldValue;
+			LOAD_16(value, source & (GBA_PAGE_SIZE - 2), sourcePage);
+			offset &= ~1;
+			LOAD_16(oldValue, offset, destMemory);
+			changed = oldValue != value;
+			STORE_16(value, offset, destMemory);
+			memory->dmaTransferRegister = value | (value << 16);
+			info->when += 2 + memory->waitstatesSeq16[source >> BASE_OFFSET] + memory->waitstatesSeq16[destRegion];
+		}
+		switch (destRegion) {
+		case GBA_REGION_VRAM:
+			if (changed) {
+				vramStart = offset < vramStart ? offset : vramStart;
+				vramEnd = offset + width > vramEnd ? offset + width : vramEnd;
+			}
+			break;
+		case GBA_REGION_OAM:
+			if (changed) {
+				oamStart = offset < oamStart ? offset : oamStart;
+				oamEnd = offset + width > oamEnd ? offset + width : oamEnd;
+			}
+			break;
+		default:
+			memory->dirtyPages[(destMemory + offset - (uint8_t*) memory->wram) >> GBA_DIRTY_PAGE_SHIFT] = 1;
+			break;
+		}
+		info->nextSource += sourceOffset;
+		info->nextDest += destOffset;
+		--info->nextCount;
+	}
+	if (vramStart < vramEnd) {
+		gba->video.renderer->writeVRAMRange(gba->video.renderer, vramStart, vramEnd - vramStart);
+	}
+	if (oamStart < oamEnd) {
+		gba->video.renderer->writeOAMRange(gba->video.renderer, oamStart >> 1, (oamEnd - oamStart) >> 1);
+	}
+	gba->bus = memory->dmaTransferRegister;
+}
+
+// EEPROM is accessed one bit per 16-bit unit, so reading or writing a 64-bit block takes a DMA of 68
+// to 81 units. Like _bulkTransfer, this does every unit that starts before the next event at once.
+static void _bulkTransferEEPROM(struct GBA* gba, int number, struct GBADMA* info, int sourceOffset, int destOffset) {
+	struct GBAMemory* memory = &gba->memory;
+	if (!_canBulkTransfer(gba, number)) {
+		return;
+	}
+
+	uint32_t currentTime = mTimingCurrentTime(&gba->timing);
+	int32_t nextEvent = mTimingNextEvent(&gba->timing);
+	while (info->nextCount && (int32_t) (info->when - currentTime) < nextEvent) {
+		uint32_t source = info->nextSource;
+		uint32_t dest = info->nextDest;
+		uint32_t sourceRegion = source >> BASE_OFFSET;
+		uint32_t destRegion = dest >> BASE_OFFSET;
+		const uint8_t* sourcePage = NULL;
+		uint8_t* destPage = NULL;
+		// Only transfers between EEPROM and plain RAM are handled here
+		if (sourceRegion != GBA_REGION_ROM2_EX) {
+			sourcePage = memory->readPages[source >> GBA_PAGE_SHIFT];
+			if (!sourcePage) {
+				break;
+			}
+		}
+		if (destRegion != GBA_REGION_ROM2_EX) {
+			destPage = dest < GBA_BASE_IO ? memory->writePages[dest >> GBA_PAGE_SHIFT] : NULL;
+			if (!destPage) {
+				break;
+			}
+		}
+
+		uint16_t value;
+		if (sourcePage) {
+			LOAD_16(value, source & (GBA_PAGE_SIZE - 2), sourcePage);
+		} else {
+			value = GBASavedataReadEEPROM(&memory->savedata);
+		}
+		memory->dmaTransferRegister = value | (value << 16);
+		if (destPage) {
+			STORE_16(value, dest & (GBA_PAGE_SIZE - 2), destPage);
+			memory->dirtyPages[(destPage + (dest & (GBA_PAGE_SIZE - 2)) - (uint8_t*) memory->wram) >> GBA_DIRTY_PAGE_SHIFT] = 1;
+		} else {
+			GBASavedataWriteEEPROMAhead(&memory->savedata, value, info->nextCount, info->when - currentTime);
+		}
+		info->when += 2 + memory->waitstatesSeq16[sourceRegion] + memory->waitstatesSeq16[destRegion];
+		info->nextSource += sourceOffset;
+		info->nextDest += destOffset;
+		--info->nextCount;
+	}
+	gba->bus = memory->dmaTransferRegister;
 }
@@ -0,0 +1,327 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gba/renderers/parallel.h>
+
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/renderers/proxy.h>
+#include <mgba/internal/gba/renderers/video-software.h>
+
+#ifndef DISABLE_THREADING
+
+#define FRAME_BASE_SIZE 0x10000
+
+struct GBAVideoParallelWorker {
+	// The logger callbacks only get this, so it must come first
+	struct mVideoLogger logger;
+	struct GBAVideoParallelProxy* p;
+	struct GBAVideoProxyRenderer proxy;
+	struct GBAVideoSoftwareRenderer renderer;
+	size_t offset;
+};
+
+static void GBAVideoParallelProxyInit(struct mVideoLogger* logger);
+static void GBAVideoParallelProxyReset(struct mVideoLogger* logger);
+static void GBAVideoParallelProxyDeinit(struct mVideoLogger* logger);
+
+static THREAD_ENTRY _workerThread(void* context);
+
+static bool _writeData(struct mVideoLogger* logger, const void* data, size_t length);
+static bool _readData(struct mVideoLogger* logger, void* data, size_t length, bool block);
+static void _postEvent(struct mVideoLogger* logger, enum mVideoLoggerEvent);
+
+static void _lock(struct mVideoLogger* logger);
+static void _unlock(struct mVideoLogger* logger);
+static void _wait(struct mVideoLogger* logger);
+
+void GBAVideoParallelProxyCreate(struct GBAVideoParallelProxy* proxy, struct GBAVideoSoftwareRenderer* renderer, size_t bands) {
+	mVideoLoggerRendererCreate(&proxy->d, false);
+	proxy->d.block = true;
+
+	proxy->d.init = GBAVideoParallelProxyInit;
+	proxy->d.reset = GBAVideoParallelProxyReset;
+	proxy->d.deinit = GBAVideoParallelProxyDeinit;
+	proxy->d.lock = _lock;
+	proxy->d.unlock = _unlock;
+	proxy->d.wait = _wait;
+
+	proxy->d.writeData = _writeData;
+	proxy->d.postEvent = _postEvent;
+
+	proxy->renderer = renderer;
+	proxy->nBands = bands;
+	proxy->workers = NULL;
+	proxy->nWorkers = 0;
+	proxy->threads = NULL;
+	proxy->frame = NULL;
+	proxy->frameSize = 0;
+	proxy->frameCapacity = 0;
+}
+
+static void GBAVideoParallelProxyInit(struct mVideoLogger* logger) {
+	struct GBAVideoParallelProxy* proxy = (struct GBAVideoParallelProxy*) logger;
+	proxy->nWorkers = proxy->nBands;
+	if (proxy->nWorkers < 1) {
+		proxy->nWorkers = 1;
+	} else if (proxy->nWorkers > GBA_VIDEO_VERTICAL_PIXELS) {
+		proxy->nWorkers = GBA_VIDEO_VERTICAL_PIXELS;
+	}
+
+	proxy->workers = calloc(proxy->nWorkers, sizeof(*proxy->workers));
+	size_t i;
+	for (i = 0; i < proxy->nWorkers; ++i) {
+		struct GBAVideoParallelWorker* worker = &proxy->workers[i];
+		worker->p = proxy;
+		mVideoLoggerRendererCreate(&worker->logger, true);
+		worker->logger.readData = _readData;
+
+		GBAVideoSoftwareRendererCreate(&worker->renderer);
+		worker->renderer.bandStart = GBA_VIDEO_VERTICAL_PIXELS * i / proxy->nWorkers;
+		worker->renderer.bandEnd = GBA_VIDEO_VERTICAL_PIXELS * (i + 1) / proxy->nWorkers;
+		worker->renderer.colorTable = proxy->renderer->colorTable;
+
+		worker->proxy.logger = &worker->logger;
+		GBAVideoProxyRendererCreate(&worker->proxy, &worker->renderer.d);
+		mVideoLoggerRendererInit(&worker->logger);
+		worker->renderer.d.palette = worker->logger.palette;
+		worker->renderer.d.vram = worker->logger.vram;
+		worker->renderer.d.oam = (union GBAOAM*) worker->logger.oam;
+		worker->renderer.d.cache = NULL;
+	}
+
+	proxy->frameCapacity = FRAME_BASE_SIZE;
+	proxy->frame = malloc(proxy->frameCapacity);
+	proxy->frameSize = 0;
+
+	MutexInit(&proxy->mutex);
+	ConditionInit(&proxy->workCond);
+	ConditionInit(&proxy->doneCond);
+	proxy->generation = 0;
+	proxy->activeThreads = 0;
+	proxy->quit = false;
+
+	// The thread driving the proxy renders the first band itself
+	proxy->threads = calloc(proxy->nWorkers, sizeof(*proxy->threads));
+	for (i = 1; i < proxy->nWorkers; ++i) {
+		ThreadCreate(&proxy->threads[i - 1], _workerThread, &proxy->workers[i]);
+	}
+}
+
+static void GBAVideoParallelProxyReset(struct mVideoLogger* logger) {
+	struct GBAVideoParallelProxy* proxy = (struct GBAVideoParallelProxy*) logger;
+	// Anything still queued predates the state being reset to
+	proxy->frameSize = 0;
+	size_t i;
+	for (i = 0; i < proxy->nWorkers; ++i) {
+		struct GBAVideoParallelWorker* worker = &proxy->workers[i];
+		memcpy(worker->logger.vram, logger->vram, logger->vramSize);
+		memcpy(worker->logger.oam, logger->oam, logger->oamSize);
+		memcpy(worker->logger.palette, logger->palette, logger->paletteSize);
+	}
+}
+
+static void GBAVideoParallelProxyDeinit(struct mVideoLogger* logger) {
+	struct GBAVideoParallelProxy* proxy = (struct GBAVideoParallelProxy*) logger;
+	MutexLock(&proxy->mutex);
+	proxy->quit = true;
+	ConditionWake(&proxy->workCond);
+	MutexUnlock(&proxy->mutex);
+	size_t i;
+	for (i = 1; i < proxy->nWorkers; ++i) {
+		ThreadJoin(&proxy->threads[i - 1]);
+	}
+	free(proxy->threads);
+	proxy->threads = NULL;
+
+	for (i = 0; i < proxy->nWorkers; ++i) {
+		mVideoLoggerRendererDeinit(&proxy->workers[i].logger);
+	}
+	free(proxy->workers);
+	proxy->workers = NULL;
+	proxy->nWorkers = 0;
+
+	free(proxy->frame);
+	proxy->frame = NULL;
+	proxy->frameSize = 0;
+	proxy->frameCapacity = 0;
+
+	MutexDeinit(&proxy->mutex);
+	ConditionDeinit(&proxy->workCond);
+	ConditionDeinit(&proxy->doneCond);
+}
+
+static void _copyExtraState(struct GBAVideoRenderer* dest, const struct GBAVideoRenderer* src) {
+	memcpy(dest->disableBG, src->disableBG, sizeof(dest->disableBG));
+	dest->disableOBJ = src->disableOBJ;
+	memcpy(dest->disableWIN, src->disableWIN, sizeof(dest->disableWIN));
+	dest->disableOBJWIN = src->disableOBJWIN;
+	memcpy(dest->highlightBG, src->highlightBG, sizeof(dest->highlightBG));
+	memcpy(dest->highlightOBJ, src->highlightOBJ, sizeof(dest->highlightOBJ));
+	dest->highlightAmount = src->highlightAmount;
+	dest->highlightColor = src->highlightColor;
+}
+
+static void _runWorker(struct GBAVideoParallelWorker* worker) {
+	worker->offset = 0;
+	while (worker->offset < worker->p->frameSize) {
+		if (!mVideoLoggerRendererRun(&worker->logger, false)) {
+			mLOG(GBA_VIDEO, ERROR, "Parallel video log got corrupted!");
+			break;
+		}
+	}
+}
+
+static THREAD_ENTRY _workerThread(void* context) {
+	struct GBAVideoParallelWorker* worker = context;
+	struct GBAVideoParallelProxy* proxy = worker->p;
+	ThreadSetName("Video Band Worker");
+
+	// Workers are started before any frames are queued, so they begin having seen generation 0
+	unsigned generation = 0;
+	MutexLock(&proxy->mutex);
+	while (true) {
+		while (generation == proxy->generation && !proxy->quit) {
+			ConditionWait(&proxy->workCond, &proxy->mutex);
+		}
+		// Some platforms only wake one waiter at a time, so pass the wakeup along
+		ConditionWake(&proxy->workCond);
+		if (proxy->quit) {
+			break;
+		}
+		generation = proxy->generation;
+		MutexUnlock(&proxy->mutex);
+
+		_runWorker(worker);
+
+		MutexLock(&proxy->mutex);
+		--proxy->activeThreads;
+		if (!proxy->activeThreads) {
+			ConditionWake(&proxy->doneCond);
+		}
+	}
+	MutexUnlock(&proxy->mutex);
+	THREAD_EXIT(0);
+}
+
+static bool _writeData(struct mVideoLogger* logger, const void* data, size_t length) {
+	struct GBAVideoParallelProxy* proxy = (struct GBAVideoParallelProxy*) logger;
+	if (proxy->frameSize + length > proxy->frameCapacity) {
+		while (proxy->frameSize + length > proxy->frameCapacity) {
+			proxy->frameCapacity *= 2;
+		}
+		proxy->frame = realloc(proxy->frame, proxy->frameCapacity);
+	}
+	memcpy(&proxy->frame[proxy->frameSize], data, length);
+	proxy->frameSize += length;
+	return true;
+}
+
+static bool _readData(struct mVideoLogger* logger, void* data, size_t length, bool block) {
+	UNUSED(block);
+	struct GBAVideoParallelWorker* worker = (struct GBAVideoParallelWorker*) logger;
+	if (worker->offset + length > worker->p->frameSize) {
+		return false;
+	}
+	if (data) {
+		memcpy(data, &worker->p->frame[worker->offset], length);
+	}
+	worker->offset += length;
+	return true;
+}
+
+static void _postEvent(struct mVideoLogger* logger, enum mVideoLoggerEvent event) {
+	struct GBAVideoParallelProxy* proxy = (struct GBAVideoParallelProxy*) logger;
+	size_t i;
+	switch (event) {
+	default:
+		break;
+	case LOGGER_EVENT_INIT:
+		for (i = 0; i < proxy->nWorkers; ++i) {
+			struct GBAVideoParallelWorker* worker = &proxy->workers[i];
+			worker->renderer.outputBuffer = proxy->renderer->outputBuffer;
+			worker->renderer.outputBufferStride = proxy->renderer->outputBufferStride;
+			worker->renderer.d.init(&worker->renderer.d);
+		}
+		break;
+	case LOGGER_EVENT_DEINIT:
+		for (i = 0; i < proxy->nWorkers; ++i) {
+			proxy->workers[i].renderer.d.deinit(&proxy->workers[i].renderer.d);
+		}
+		break;
+	case LOGGER_EVENT_RESET:
+		for (i = 0; i < proxy->nWorkers; ++i) {
+			proxy->workers[i].renderer.d.reset(&proxy->workers[i].renderer.d);
+		}
+		break;
+	case LOGGER_EVENT_GET_PIXELS:
+		logger->pixelBuffer = proxy->renderer->outputBuffer;
+		logger->pixelStride = proxy->renderer->outputBufferStride;
+		break;
+	}
+}
+
+static void _lock(struct mVideoLogger* logger) {
+	struct GBAVideoParallelProxy* proxy = (struct GBAVideoParallelProxy*) logger;
+	MutexLock(&proxy->mutex);
+	while (proxy->activeThreads) {
+		ConditionWait(&proxy->doneCond, &proxy->mutex);
+	}
+}
+
+static void _unlock(struct mVideoLogger* logger) {
+	struct GBAVideoParallelProxy* proxy = (struct GBAVideoParallelProxy*) logger;
+	MutexUnlock(&proxy->mutex);
+}
+
+static void _wait(struct mVideoLogger* logger) {
+	struct GBAVideoParallelProxy* proxy = (struct GBAVideoParallelProxy*) logger;
+	if (!proxy->frameSize) {
+		return;
+	}
+	struct GBAVideoProxyRenderer* front = logger->context;
+	struct GBAVideoSoftwareRenderer* renderer = proxy->renderer;
+	size_t i;
+	for (i = 0; i < proxy->nWorkers; ++i) {
+		struct GBAVideoParallelWorker* worker = &proxy->workers[i];
+		worker->renderer.outputBuffer = renderer->outputBuffer;
+		worker->renderer.outputBufferStride = renderer->outputBufferStride;
+		// Lines marked dirty on the output renderer, e.g. by changing the video buffer, need to be redrawn
+		size_t j;
+		for (j = 0; j < sizeof(renderer->scanlineDirty) / sizeof(*renderer->scanlineDirty); ++j) {
+			worker->renderer.scanlineDirty[j] |= renderer->scanlineDirty[j];
+		}
+		// Each worker's proxy passes these along to its renderer before every scanline
+		_copyExtraState(&worker->proxy.d, &front->d);
+	}
+	memset(renderer->scanlineDirty, 0, sizeof(renderer->scanlineDirty));
+
+	MutexLock(&proxy->mutex);
+	proxy->activeThreads = proxy->nWorkers;
+	++proxy->generation;
+	ConditionWake(&proxy->workCond);
+	MutexUnlock(&proxy->mutex);
+
+	_runWorker(&proxy->workers[0]);
+
+	MutexLock(&proxy->mutex);
+	--proxy->activeThreads;
+	while (proxy->activeThreads) {
+		ConditionWait(&proxy->doneCond, &proxy->mutex);
+	}
+	ConditionWake(&proxy->doneCond);
+	MutexUnlock(&proxy->mutex);
+	proxy->frameSize = 0;
+
+	for (i = 0; i < proxy->nWorkers; ++i) {
+		struct GBAVideoParallelWorker* worker = &proxy->workers[i];
+		size_t j;
+		for (j = 0; j < sizeof(renderer->d.changedScanlines) / sizeof(*renderer->d.changedScanlines); ++j) {
+			renderer->d.changedScanlines[j] |= worker->renderer.d.changedScanlines[j];
+			worker->renderer.d.changedScanlines[j] = 0;
+		}
+	}
+}
+
+#endif
@@ -17,6 +17,8 @@ static uint16_t GBAVideoProxyRendererWriteVideoRegister(struct GBAVideoRenderer*
 static void GBAVideoProxyRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address);
 static void GBAVideoProxyRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 static void GBAVideoProxyRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam);
+static void GBAVideoProxyRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t length);
+static void GBAVideoProxyRendererWriteOAMRange(struct GBAVideoRenderer* renderer, uint32_t oam, uint32_t count);
 static void GBAVideoProxyRendererDrawScanline(struct GBAVideoRenderer* renderer, int y);
 static void GBAVideoProxyRendererFinishFrame(struct GBAVideoRenderer* renderer);
 static void GBAVideoProxyRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels);
@@ -33,6 +35,8 @@ void GBAVideoProxyRendererCreate(struct GBAVideoProxyRenderer* renderer, struct
 	renderer->d.writeVideoRegister = GBAVideoProxyRendererWriteVideoRegister;
 	renderer->d.writeVRAM = GBAVideoProxyRendererWriteVRAM;
 	renderer->d.writeOAM = GBAVideoProxyRendererWriteOAM;
+	renderer->d.writeVRAMRange = GBAVideoProxyRendererWriteVRAMRange;
+	renderer->d.writeOAMRange = GBAVideoProxyRendererWriteOAMRange;
 	renderer->d.writePalette = GBAVideoProxyRendererWritePalette;
 	renderer->d.drawScanline = GBAVideoProxyRendererDrawScanline;
 	renderer->d.finishFrame = GBAVideoProxyRendererFinishFrame;
@@ -157,6 +161,9 @@ void GBAVideoProxyRendererReset(struct GBAVideoRenderer* renderer) {
 	} else {
 		proxyRenderer->logger->postEvent(proxyRenderer->logger, LOGGER_EVENT_RESET);
 	}
+	if (renderer->cache) {
+		GBAVideoCacheResync(renderer->cache, renderer->palette);
+	}
 }
 
 void GBAVideoProxyRendererDeinit(struct GBAVideoRenderer* renderer) {
@@ -211,11 +218,14 @@ static bool _parsePacket(struct mVideoLogger* logger, const struct mVideoLoggerD
 		}
 		break;
 	case DIRTY_VRAM:
-		if (item->address <= GBA_SIZE_VRAM - 0x1000) {
-			logger->readData(logger, &logger->vram[item->address >> 1], 0x1000, true);
-			proxyRenderer->backend->writeVRAM(proxyRenderer->backend, item->address);
+		if (item->value > 0x1000) {
+			return false;
+		}
+		if (item->address <= GBA_SIZE_VRAM - item->value) {
+			logger->readData(logger, &logger->vram[item->address >> 1], item->value, true);
+			proxyRenderer->backend->writeVRAMRange(proxyRenderer->backend, item->address, item->value);
 		} else {
-			logger->readData(logger, NULL, 0x1000, true);
+			logger->readData(logger, NULL, item->value, true);
 		}
 		break;
 	case DIRTY_SCANLINE:
@@ -309,6 +319,29 @@ void GBAVideoProxyRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t o
 	mVideoLoggerRendererWriteOAM(proxyRenderer->logger, oam, proxyRenderer->d.oam->raw[oam]);
 }
 
+void GBAVideoProxyRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t length) {
+	struct GBAVideoProxyRenderer* proxyRenderer = (struct GBAVideoProxyRenderer*) renderer;
+	mVideoLoggerRendererWriteVRAMRange(proxyRenderer->logger, address, length);
+	if (!proxyRenderer->logger->block) {
+		proxyRenderer->backend->writeVRAMRange(proxyRenderer->backend, address, length);
+	}
+	if (renderer->cache) {
+		mCacheSetWriteVRAMRange(renderer->cache, address, length);
+	}
+}
+
+void GBAVideoProxyRendererWriteOAMRange(struct GBAVideoRenderer* renderer, uint32_t oam, uint32_t count) {
+	struct GBAVideoProxyRenderer* proxyRenderer = (struct GBAVideoProxyRenderer*) renderer;
+	if (!proxyRenderer->logger->block) {
+		proxyRenderer->backend->writeOAMRange(proxyRenderer->backend, oam, count);
+	}
+	// Each entry still goes into the log on its own, since the packets carry the values
+	uint32_t i;
+	for (i = oam; i < oam + count; ++i) {
+		mVideoLoggerRendererWriteOAM(proxyRenderer->logger, i, proxyRenderer->d.oam->raw[i]);
+	}
+}
+
 void GBAVideoProxyRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
 	struct GBAVideoProxyRenderer* proxyRenderer = (struct GBAVideoProxyRenderer*) renderer;
 	if (!proxyRenderer->logger->block) {
@@ -340,6 +373,12 @@ static void GBAVideoProxyRendererGetPixels(struct GBAVideoRenderer* renderer, si
 	} else {
 		proxyRenderer->backend->getPixels(proxyRenderer->backend, stride, pixels);
 	}
+	// The backend is idle here, so the rows it changed can be handed over safely
+	size_t i;
+	for (i = 0; i < sizeof(renderer->changedScanlines) / sizeof(*renderer->changedScanlines); ++i) {
+		renderer->changedScanlines[i] |= proxyRenderer->backend->changedScanlines[i];
+		proxyRenderer->backend->changedScanlines[i] = 0;
+	}
 }
 
 static void GBAVideoProxyRendererPutPixels(struct GBAVideoRenderer* renderer, size_t stride, const void* pixels) {
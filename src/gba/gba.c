@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gba/gba.h>
 
+#include <mgba/core/rom-image.h>
 #include <mgba/internal/arm/isa-inlines.h>
 #include <mgba/internal/arm/debugger/debugger.h>
 #include <mgba/internal/arm/decoder.h>
@@ -101,6 +102,8 @@ static void GBAInit(void* cpu, struct mCPUComponent* component) {
 	gba->rumble = NULL;
 
 	gba->romVf = NULL;
+	gba->romRegistry = NULL;
+	gba->romImage = NULL;
 	gba->mbVf = NULL;
 	gba->biosVf = NULL;
 
@@ -112,10 +115,12 @@ static void GBAInit(void* cpu, struct mCPUComponent* component) {
 
 	gba->idleOptimization = IDLE_LOOP_REMOVE;
 	gba->idleLoop = IDLE_LOOP_NONE;
+	gba->idleLoopDetected = false;
 
 	gba->vbaBugCompat = false;
 	gba->hardCrash = true;
 	gba->allowOpposingDirections = true;
+	gba->directCpuSet = false;
 
 	gba->performingDMA = false;
 
@@ -133,6 +138,15 @@ static void GBAInit(void* cpu, struct mCPUComponent* component) {
 
 void GBAUnloadROM(struct GBA* gba) {
 	GBAMemoryClearAGBPrint(gba);
+	if (gba->romImage) {
+		if (gba->memory.rom && !gba->isPristine) {
+			mROMImageUnmapPrivate(gba->romImage, gba->memory.rom);
+		}
+		mROMImageRelease(gba->romImage);
+		gba->romImage = NULL;
+		gba->memory.rom = NULL;
+		gba->yankedRomSize = 0;
+	}
 	if (gba->memory.rom && !gba->isPristine) {
 		if (gba->yankedRomSize) {
 			gba->yankedRomSize = 0;
@@ -155,6 +169,7 @@ void GBAUnloadROM(struct GBA* gba) {
 	gba->memory.romSize = 0;
 	gba->memory.romMask = 0;
 	gba->isPristine = false;
+	GBAMemoryUpdatePages(gba);
 
 	if (!gba->memory.savedata.dirty) {
 		gba->memory.savedata.maskWriteback = false;
@@ -166,6 +181,7 @@ void GBAUnloadROM(struct GBA* gba) {
 		gba->memory.savedata.realVf = 0;
 	}
 	gba->idleLoop = IDLE_LOOP_NONE;
+	gba->idleLoopDetected = false;
 }
 
 void GBADestroy(struct GBA* gba) {
@@ -249,6 +265,7 @@ void GBAReset(struct ARMCore* cpu) {
 	if (GBAIsMB(gba->mbVf) && !isELF) {
 		gba->mbVf->seek(gba->mbVf, 0, SEEK_SET);
 		gba->mbVf->read(gba->mbVf, gba->memory.wram, GBA_SIZE_EWRAM);
+		GBAMemoryMarkDirty(&gba->memory);
 	}
 
 	gba->lastJump = 0;
@@ -290,6 +307,11 @@ void GBASkipBIOS(struct GBA* gba) {
 	}
 }
 
+void GBASetSlim(struct GBA* gba, bool slim) {
+	gba->slim = slim;
+	GBAAudioSetBufferCapacity(&gba->audio, slim ? GB_AUDIO_BUFFER_CAPACITY_SLIM : GB_AUDIO_BUFFER_CAPACITY);
+}
+
 static void GBAProcessEvents(struct ARMCore* cpu) {
 	struct GBA* gba = (struct GBA*) cpu->master;
 
@@ -370,6 +392,7 @@ bool GBALoadNull(struct GBA* gba) {
 	gba->memory.romSize = GBA_SIZE_ROM0;
 	gba->memory.romMask = GBA_SIZE_ROM0 - 1;
 	gba->romCrc32 = 0;
+	GBAMemoryUpdatePages(gba);
 
 	if (gba->cpu) {
 		gba->cpu->memory.setActiveRegion(gba->cpu, gba->cpu->gprs[ARM_PC]);
@@ -384,6 +407,7 @@ bool GBALoadMB(struct GBA* gba, struct VFile* vf) {
 	vf->seek(vf, 0, SEEK_SET);
 	memset(gba->memory.wram, 0, GBA_SIZE_EWRAM);
 	vf->read(vf, gba->memory.wram, GBA_SIZE_EWRAM);
+	GBAMemoryMarkDirty(&gba->memory);
 	if (gba->cpu && gba->memory.activeRegion == GBA_REGION_IWRAM) {
 		gba->cpu->memory.setActiveRegion(gba->cpu, gba->cpu->gprs[ARM_PC]);
 	}
@@ -448,17 +472,41 @@ bool GBALoadROM(struct GBA* gba, struct VFile* vf) {
 	gba->yankedRomSize = 0;
 	gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
 	gba->romCrc32 = doCrc32(gba->memory.rom, gba->pristineRomSize);
+#ifndef FIXED_ROM_BUFFER
+	if (gba->isPristine && gba->romRegistry) {
+		struct mROMImage* image = mROMImageRegistryAcquire(gba->romRegistry, gba->memory.rom, gba->pristineRomSize, GBA_SIZE_ROM0, gba->romCrc32);
+		if (image) {
+			vf->unmap(vf, gba->memory.rom, gba->pristineRomSize);
+			gba->memory.rom = image->memory.data;
+			gba->romImage = image;
+		}
+	}
+#endif
 	if (popcount32(gba->memory.romSize) != 1) {
 		// This ROM is either a bad dump or homebrew. Emulate flash cart behavior.
 #ifndef FIXED_ROM_BUFFER
-		void* newRom = anonymousMemoryMap(GBA_SIZE_ROM0);
-		memcpy(newRom, gba->memory.rom, gba->pristineRomSize);
+		void* newRom = NULL;
+		if (gba->romImage) {
+			// The image already reads as zero past the end of the ROM, so a private mapping is enough
+			newRom = mROMImageMapPrivate(gba->romImage);
+		}
+		if (!newRom) {
+			newRom = anonymousMemoryMap(GBA_SIZE_ROM0);
+			memcpy(newRom, gba->memory.rom, gba->pristineRomSize);
+			if (gba->romImage) {
+				mROMImageRelease(gba->romImage);
+				gba->romImage = NULL;
+			} else {
+				vf->unmap(vf, gba->memory.rom, gba->pristineRomSize);
+			}
+		}
 		gba->memory.rom = newRom;
 #endif
 		gba->memory.romSize = GBA_SIZE_ROM0;
 		gba->memory.romMask = GBA_SIZE_ROM0 - 1;
 		gba->isPristine = false;
 	}
+	GBAMemoryUpdatePages(gba);
 	if (gba->cpu && gba->memory.activeRegion >= GBA_REGION_ROM0) {
 		gba->cpu->memory.setActiveRegion(gba->cpu, gba->cpu->gprs[ARM_PC]);
 	}
@@ -468,6 +516,57 @@ bool GBALoadROM(struct GBA* gba, struct VFile* vf) {
 	return true;
 }
 
+bool GBACloneROM(struct GBA* gba, const struct GBA* source) {
+	GBAUnloadROM(gba);
+	if (!source->memory.rom) {
+		return true;
+	}
+#ifdef FIXED_ROM_BUFFER
+	// There's only the one ROM buffer to go around
+	return false;
+#else
+	size_t size = source->yankedRomSize ? source->yankedRomSize : source->memory.romSize;
+	// GPIO registers are stored in the ROM itself, so games that use them can't share that page
+	bool hasGpio = source->memory.hw.devices & (HW_RTC | HW_RUMBLE | HW_LIGHT_SENSOR | HW_GYRO);
+	if (source->romImage && source->isPristine && !hasGpio) {
+		mROMImageRetain(source->romImage);
+		gba->romImage = source->romImage;
+		gba->memory.rom = source->memory.rom;
+		gba->isPristine = true;
+	} else {
+		void* rom = NULL;
+		if (source->romImage) {
+			rom = mROMImageMapPrivateCopy(source->romImage, source->memory.rom, size);
+			if (rom) {
+				mROMImageRetain(source->romImage);
+				gba->romImage = source->romImage;
+			}
+		}
+		if (!rom) {
+			rom = anonymousMemoryMap(GBA_SIZE_ROM0);
+			memcpy(rom, source->memory.rom, size);
+		}
+		gba->memory.rom = rom;
+		gba->isPristine = false;
+		if (hasGpio) {
+			memcpy(&((uint8_t*) gba->memory.rom)[GPIO_REG_DATA], &((uint8_t*) source->memory.rom)[GPIO_REG_DATA], 6);
+		}
+	}
+	gba->pristineRomSize = source->pristineRomSize;
+	gba->yankedRomSize = source->yankedRomSize;
+	gba->memory.romSize = source->memory.romSize;
+	gba->memory.romMask = source->memory.romMask;
+	gba->romCrc32 = source->romCrc32;
+	GBAMemoryUpdatePages(gba);
+	if (gba->cpu && gba->memory.activeRegion >= GBA_REGION_ROM0) {
+		gba->cpu->memory.setActiveRegion(gba->cpu, gba->cpu->gprs[ARM_PC]);
+	}
+	GBAHardwareInit(&gba->memory.hw, &((uint16_t*) gba->memory.rom)[GPIO_REG_DATA >> 1]);
+	GBAVFameDetect(&gba->memory.vfame, gba->memory.rom, gba->memory.romSize);
+	return true;
+#endif
+}
+
 bool GBALoadSave(struct GBA* gba, struct VFile* sav) {
 	enum SavedataType type = gba->memory.savedata.type;
 	GBASavedataDeinit(&gba->memory.savedata);
@@ -482,6 +581,7 @@ void GBAYankROM(struct GBA* gba) {
 	gba->yankedRomSize = gba->memory.romSize;
 	gba->memory.romSize = 0;
 	gba->memory.romMask = 0;
+	GBAMemoryUpdatePages(gba);
 	GBARaiseIRQ(gba, GBA_IRQ_GAMEPAK, 0);
 }
 
@@ -523,11 +623,39 @@ void GBAApplyPatch(struct GBA* gba, struct Patch* patch) {
 	if (!patchedSize || patchedSize > GBA_SIZE_ROM0) {
 		return;
 	}
-	void* newRom = anonymousMemoryMap(GBA_SIZE_ROM0);
-	if (!patch->applyPatch(patch, gba->memory.rom, gba->pristineRomSize, newRom, patchedSize)) {
-		mappedMemoryFree(newRom, GBA_SIZE_ROM0);
+	void* newRom = NULL;
+	bool inPlace = false;
+#ifndef FIXED_ROM_BUFFER
+	if (gba->romImage && gba->isPristine && patch->inPlace) {
+		// Only the pages the patch actually changes stop being shared
+		newRom = mROMImageMapPrivate(gba->romImage);
+		inPlace = newRom;
+	}
+#endif
+	if (!newRom) {
+		newRom = anonymousMemoryMap(GBA_SIZE_ROM0);
+	}
+	if (!patch->applyPatch(patch, inPlace ? newRom : gba->memory.rom, gba->pristineRomSize, newRom, patchedSize)) {
+		if (inPlace) {
+			mROMImageUnmapPrivate(gba->romImage, newRom);
+		} else {
+			mappedMemoryFree(newRom, GBA_SIZE_ROM0);
+		}
 		return;
 	}
+	if (gba->romImage) {
+		if (!gba->isPristine) {
+			mROMImageUnmapPrivate(gba->romImage, gba->memory.rom);
+		}
+		if (!inPlace) {
+			mROMImageRelease(gba->romImage);
+			gba->romImage = NULL;
+		}
+		if (gba->romVf) {
+			gba->romVf->close(gba->romVf);
+			gba->romVf = NULL;
+		}
+	}
 	if (gba->romVf) {
 #ifndef FIXED_ROM_BUFFER
 		if (!gba->isPristine) {
@@ -545,6 +673,7 @@ void GBAApplyPatch(struct GBA* gba, struct Patch* patch) {
 	gba->memory.romSize = patchedSize;
 	gba->memory.romMask = toPow2(patchedSize) - 1;
 	gba->romCrc32 = doCrc32(gba->memory.rom, gba->memory.romSize);
+	GBAMemoryUpdatePages(gba);
 }
 
 void GBARaiseIRQ(struct GBA* gba, enum GBAIRQ irq, uint32_t cyclesLate) {
@@ -863,6 +992,23 @@ void GBAHitStub(struct ARMCore* cpu, uint32_t opcode) {
 	mLOG(GBA, ERROR, "Stub opcode: %08x", opcode);
 }
 
+void GBALogCallStack(struct GBA* gba, enum mLogLevel level) {
+	const struct ARMShadowStack* stack = gba->cpu->shadowStack;
+	if (!stack) {
+		return;
+	}
+	mLog(_mLOG_CAT_GBA, level, "Call stack:");
+	size_t i;
+	for (i = stack->depth; i > 0; --i) {
+		const struct ARMShadowFrame* frame = &stack->frames[i - 1];
+		mLog(_mLOG_CAT_GBA, level, "#%" PRIz "u  0x%08X %s from 0x%08X", stack->depth - i, frame->entryAddress,
+		     frame->exception ? "entered" : "called", frame->callAddress);
+	}
+	if (stack->dropped) {
+		mLog(_mLOG_CAT_GBA, level, "(%" PRIz "u older frames dropped)", stack->dropped);
+	}
+}
+
 void GBAIllegal(struct ARMCore* cpu, uint32_t opcode) {
 	struct GBA* gba = (struct GBA*) cpu->master;
 	if (cpu->executionMode == MODE_THUMB && (opcode & 0xFFC0) == 0xE800) {
@@ -872,6 +1018,7 @@ void GBAIllegal(struct ARMCore* cpu, uint32_t opcode) {
 	if (!gba->yankedRomSize) {
 		// TODO: More sensible category?
 		mLOG(GBA, WARN, "Illegal opcode: %08x", opcode);
+		GBALogCallStack(gba, mLOG_WARN);
 	}
 #ifdef USE_DEBUGGERS
 	if (gba->debugger) {
@@ -956,11 +1103,25 @@ void GBAFrameEnded(struct GBA* gba) {
 		}
 	}
 
-	if (gba->stream && gba->stream->postVideoFrame) {
+	if (gba->stream && gba->stream->postVideoFrame && !gba->video.skipFrames) {
 		const color_t* pixels;
 		size_t stride;
 		gba->video.renderer->getPixels(gba->video.renderer, &stride, (const void**) &pixels);
-		gba->stream->postVideoFrame(gba->stream, pixels, stride);
+		GBAVideoCollectChangedScanlines(&gba->video);
+		bool changed = false;
+		size_t i;
+		for (i = 0; i < sizeof(gba->video.streamChangedScanlines) / sizeof(*gba->video.streamChangedScanlines); ++i) {
+			changed = changed || gba->video.streamChangedScanlines[i];
+			gba->video.streamChangedScanlines[i] = 0;
+		}
+		if (!changed && gba->stream->postVideoFrameRepeat) {
+			gba->stream->postVideoFrameRepeat(gba->stream, pixels, stride);
+		} else {
+			gba->stream->postVideoFrame(gba->stream, pixels, stride);
+		}
+	}
+	if (gba->audio.outputSkipFrames) {
+		--gba->audio.outputSkipFrames;
 	}
 
 	if (gba->memory.hw.devices & (HW_GB_PLAYER | HW_GB_PLAYER_DETECTION)) {
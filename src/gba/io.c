@@ -279,6 +279,57 @@ static const int _isWSpecialRegister[GBA_REG(INTERNAL_MAX)] = {
 	1, 1
 };
 
+// Reads from registers marked plain are served straight from the backing store, skipping the
+// switch in GBAIORead. Reads from constant registers can't change until the CPU writes to
+// something, so they don't need to disable idle loop removal.
+enum {
+	IO_READ_PLAIN = 1,
+	IO_READ_CONSTANT = 2,
+};
+
+static const uint8_t _ioReadFlags[GBA_REG(MAX)] = {
+	/*      0  2  4  6  8  A  C  E */
+	/*    Video */
+	/* 00 */ 1, 1, 1, 1, 3, 3, 3, 3,
+	/* 01 */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 02 */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 03 */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 04 */ 0, 0, 0, 0, 3, 3, 0, 0,
+	/* 05 */ 3, 3, 0, 0, 0, 0, 0, 0,
+	/*    Audio */
+	/* 06 */ 2, 2, 2, 0, 2, 0, 2, 0,
+	/* 07 */ 2, 2, 2, 0, 2, 0, 2, 0,
+	/* 08 */ 2, 3, 1, 0, 1, 0, 0, 0,
+	/* 09 */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0A */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/*    DMA */
+	/* 0B */ 0, 0, 0, 0, 0, 1, 0, 0,
+	/* 0C */ 0, 0, 0, 1, 0, 0, 0, 0,
+	/* 0D */ 0, 1, 0, 0, 0, 0, 0, 1,
+	/* 0E */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 0F */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/*    Timers */
+	/* 10 */ 0, 3, 0, 3, 0, 3, 0, 3,
+	/* 11 */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/*    SIO */
+	/* 12 */ 1, 1, 1, 1, 0, 1, 0, 0,
+	/* 13 */ 2, 3, 0, 0, 0, 0, 0, 0,
+	/* 14 */ 1, 0, 0, 0, 0, 0, 0, 0,
+	/* 15 */ 0, 0, 1, 1, 1, 0, 0, 0,
+	/* 16 */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 17 */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 18 */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 19 */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 1A */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 1B */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 1C */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 1D */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 1E */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/* 1F */ 0, 0, 0, 0, 0, 0, 0, 0,
+	/*    Interrupts */
+	/* 20 */ 3, 1, 1, 0, 1
+};
+
 void GBAIOInit(struct GBA* gba) {
 	gba->memory.io[GBA_REG(DISPCNT)] = 0x0080;
 	gba->memory.io[GBA_REG(RCNT)] = RCNT_INITIAL;
@@ -649,45 +700,21 @@ void GBAIOWrite32(struct GBA* gba, uint32_t address, uint32_t value) {
 }
 
 bool GBAIOIsReadConstant(uint32_t address) {
-	switch (address) {
-	default:
+	if (address >= GBA_REG_MAX) {
 		return false;
-	case GBA_REG_BG0CNT:
-	case GBA_REG_BG1CNT:
-	case GBA_REG_BG2CNT:
-	case GBA_REG_BG3CNT:
-	case GBA_REG_WININ:
-	case GBA_REG_WINOUT:
-	case GBA_REG_BLDCNT:
-	case GBA_REG_BLDALPHA:
-	case GBA_REG_SOUND1CNT_LO:
-	case GBA_REG_SOUND1CNT_HI:
-	case GBA_REG_SOUND1CNT_X:
-	case GBA_REG_SOUND2CNT_LO:
-	case GBA_REG_SOUND2CNT_HI:
-	case GBA_REG_SOUND3CNT_LO:
-	case GBA_REG_SOUND3CNT_HI:
-	case GBA_REG_SOUND3CNT_X:
-	case GBA_REG_SOUND4CNT_LO:
-	case GBA_REG_SOUND4CNT_HI:
-	case GBA_REG_SOUNDCNT_LO:
-	case GBA_REG_SOUNDCNT_HI:
-	case GBA_REG_TM0CNT_HI:
-	case GBA_REG_TM1CNT_HI:
-	case GBA_REG_TM2CNT_HI:
-	case GBA_REG_TM3CNT_HI:
-	case GBA_REG_KEYINPUT:
-	case GBA_REG_KEYCNT:
-	case GBA_REG_IE:
-		return true;
 	}
+	return _ioReadFlags[address >> 1] & IO_READ_CONSTANT;
 }
 
 uint16_t GBAIORead(struct GBA* gba, uint32_t address) {
-	if (!GBAIOIsReadConstant(address)) {
+	unsigned flags = address < GBA_REG_MAX ? _ioReadFlags[address >> 1] : 0;
+	if (!(flags & IO_READ_CONSTANT)) {
 		// Most IO reads need to disable idle removal
 		gba->haltPending = false;
 	}
+	if (flags & IO_READ_PLAIN) {
+		return gba->memory.io[address >> 1];
+	}
 
 	switch (address) {
 	// Reading this takes two cycles (1N+1I), so let's remove them preemptively
@@ -843,46 +870,9 @@ uint16_t GBAIORead(struct GBA* gba, uint32_t address) {
 			// TODO: Is writing allowed when the circuit is disabled?
 			return 0;
 		}
-		// Fall through
-	case GBA_REG_DISPCNT:
-	case GBA_REG_GREENSWP:
-	case GBA_REG_DISPSTAT:
-	case GBA_REG_VCOUNT:
-	case GBA_REG_BG0CNT:
-	case GBA_REG_BG1CNT:
-	case GBA_REG_BG2CNT:
-	case GBA_REG_BG3CNT:
-	case GBA_REG_WININ:
-	case GBA_REG_WINOUT:
-	case GBA_REG_BLDCNT:
-	case GBA_REG_BLDALPHA:
-	case GBA_REG_SOUNDCNT_HI:
-	case GBA_REG_SOUNDCNT_X:
-	case GBA_REG_SOUNDBIAS:
-	case GBA_REG_DMA0CNT_HI:
-	case GBA_REG_DMA1CNT_HI:
-	case GBA_REG_DMA2CNT_HI:
-	case GBA_REG_DMA3CNT_HI:
-	case GBA_REG_TM0CNT_HI:
-	case GBA_REG_TM1CNT_HI:
-	case GBA_REG_TM2CNT_HI:
-	case GBA_REG_TM3CNT_HI:
-	case GBA_REG_KEYCNT:
-	case GBA_REG_SIOMULTI0:
-	case GBA_REG_SIOMULTI1:
-	case GBA_REG_SIOMULTI2:
-	case GBA_REG_SIOMULTI3:
-	case GBA_REG_SIOMLT_SEND:
-	case GBA_REG_JOYCNT:
-	case GBA_REG_JOY_TRANS_LO:
-	case GBA_REG_JOY_TRANS_HI:
-	case GBA_REG_JOYSTAT:
-	case GBA_REG_IE:
-	case GBA_REG_IF:
-	case GBA_REG_WAITCNT:
-	case GBA_REG_IME:
+		break;
 	case GBA_REG_POSTFLG:
-		// Handled transparently by registers
+		// Handled transparently by registers, like the plain registers in _ioReadFlags
 		break;
 	case 0x066:
 	case 0x06A:
@@ -931,8 +921,13 @@ void GBAIOSerialize(struct GBA* gba, struct GBASerializedState* state) {
 		STORE_16(gba->memory.io[(GBA_REG_DMA0CNT_LO + i * 12) >> 1], (GBA_REG_DMA0CNT_LO + i * 12), state->io);
 		STORE_16(gba->timers[i].reload, 0, &state->timers[i].reload);
 		STORE_32(gba->timers[i].lastEvent - mTimingCurrentTime(&gba->timing), 0, &state->timers[i].lastEvent);
-		STORE_32(gba->timers[i].event.when - mTimingCurrentTime(&gba->timing), 0, &state->timers[i].nextEvent);
-		STORE_32(gba->timers[i].flags, 0, &state->timers[i].flags);
+		int32_t nextEvent = gba->timers[i].event.when;
+		if (GBATimerFlagsIsCheckpoint(gba->timers[i].flags) && !GBATimerFlagsIsCountUp(gba->timers[i].flags)) {
+			// Savestates always hold the next overflow here
+			nextEvent = gba->timers[i].lastEvent + ((0x10000 - gba->memory.io[(GBA_REG_TM0CNT_LO + i * 4) >> 1]) << GBATimerFlagsGetPrescaleBits(gba->timers[i].flags));
+		}
+		STORE_32(nextEvent - mTimingCurrentTime(&gba->timing), 0, &state->timers[i].nextEvent);
+		STORE_32(GBATimerFlagsClearCheckpoint(GBATimerFlagsClearBulk(gba->timers[i].flags)), 0, &state->timers[i].flags);
 		STORE_32(gba->memory.dma[i].nextSource, 0, &state->dma[i].nextSource);
 		STORE_32(gba->memory.dma[i].nextDest, 0, &state->dma[i].nextDest);
 		STORE_32(gba->memory.dma[i].nextCount, 0, &state->dma[i].nextCount);
@@ -946,10 +941,16 @@ void GBAIOSerialize(struct GBA* gba, struct GBASerializedState* state) {
 }
 
 void GBAIODeserialize(struct GBA* gba, const struct GBASerializedState* state) {
+	int i;
+	for (i = 0; i < 4; ++i) {
+		// Any overflows still pending from before the load are about to be replaced, so keep the
+		// old timers from being scheduled while the audio registers are loaded
+		gba->timers[i].flags = 0;
+	}
+
 	LOAD_16(gba->memory.io[GBA_REG(SOUNDCNT_X)], GBA_REG_SOUNDCNT_X, state->io);
 	GBAAudioWriteSOUNDCNT_X(&gba->audio, gba->memory.io[GBA_REG(SOUNDCNT_X)]);
 
-	int i;
 	for (i = 0; i < GBA_REG_MAX; i += 2) {
 		if (_isWSpecialRegister[i >> 1]) {
 			LOAD_16(gba->memory.io[i >> 1], i, state->io);
@@ -967,6 +968,7 @@ void GBAIODeserialize(struct GBA* gba, const struct GBASerializedState* state) {
 	for (i = 0; i < 4; ++i) {
 		LOAD_16(gba->timers[i].reload, 0, &state->timers[i].reload);
 		LOAD_32(gba->timers[i].flags, 0, &state->timers[i].flags);
+		gba->timers[i].flags = GBATimerFlagsClearCheckpoint(GBATimerFlagsClearBulk(gba->timers[i].flags));
 		LOAD_32(when, 0, &state->timers[i].lastEvent);
 		gba->timers[i].lastEvent = when + mTimingCurrentTime(&gba->timing);
 		LOAD_32(when, 0, &state->timers[i].nextEvent);
@@ -988,6 +990,7 @@ void GBAIODeserialize(struct GBA* gba, const struct GBASerializedState* state) {
 	LOAD_32(gba->memory.dmaTransferRegister, 0, &state->dmaTransferRegister);
 	LOAD_32(gba->dmaPC, 0, &state->dmaBlockPC);
 
+	GBATimerUpdateEvents(gba);
 	GBADMAUpdate(gba);
 	GBAHardwareDeserialize(&gba->memory.hw, state);
 }
@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gba/memory.h>
 
+#include <mgba/core/rom-image.h>
 #include <mgba/internal/arm/decoder.h>
 #include <mgba/internal/arm/macros.h>
 #include <mgba/internal/defines.h>
@@ -14,22 +15,26 @@
 #include <mgba/internal/gba/serialize.h>
 #include "gba/hle-bios.h"
 
+#include <mgba-util/hash.h>
 #include <mgba-util/math.h>
 #include <mgba-util/memory.h>
 #include <mgba-util/vfs.h>
 
 #define IDLE_LOOP_THRESHOLD 10000
 
+#define MARK_EWRAM_DIRTY(ADDR) memory->dirtyPages[((ADDR) & (GBA_SIZE_EWRAM - 1)) >> GBA_DIRTY_PAGE_SHIFT] = 1
+#define MARK_IWRAM_DIRTY(ADDR) memory->dirtyPages[GBA_DIRTY_IWRAM_BASE + (((ADDR) & (GBA_SIZE_IWRAM - 1)) >> GBA_DIRTY_PAGE_SHIFT)] = 1
+
 mLOG_DEFINE_CATEGORY(GBA_MEM, "GBA Memory", "gba.memory");
 
 static void _pristineCow(struct GBA* gba);
+static void _extendRom(struct GBA* gba, size_t romSize);
 static void _agbPrintStore(struct GBA* gba, uint32_t address, int16_t value);
 static int16_t  _agbPrintLoad(struct GBA* gba, uint32_t address);
 static uint8_t _deadbeef[4] = { 0x10, 0xB7, 0x10, 0xE7 }; // Illegal instruction on both ARM and Thumb
 static const uint32_t _agbPrintFunc = 0x4770DFFA; // swi 0xFA; bx lr
 
 static void GBASetActiveRegion(struct ARMCore* cpu, uint32_t region);
-static int32_t GBAMemoryStall(struct ARMCore* cpu, int32_t wait);
 static int32_t GBAMemoryStallVRAM(struct GBA* gba, int32_t wait, int extra);
 
 static const char GBA_BASE_WAITSTATES[16] = { 0, 0, 2, 0, 0, 0, 0, 0, 4, 4, 4, 4, 4, 4, 4 };
@@ -39,6 +44,28 @@ static const char GBA_BASE_WAITSTATES_SEQ_32[16] = { 0, 0, 5, 0, 0, 1, 1, 0, 5,
 static const char GBA_ROM_WAITSTATES[] = { 4, 3, 2, 8 };
 static const char GBA_ROM_WAITSTATES_SEQ[] = { 2, 1, 4, 1, 8, 1 };
 
+#define GBA_STATS_UNMAPPED 11
+
+static const struct mCoreMemoryStats _statsRegions[] = {
+	{ "bios", GBA_BASE_BIOS, GBA_BASE_EWRAM },
+	{ "wram", GBA_BASE_EWRAM, GBA_BASE_IWRAM },
+	{ "iwram", GBA_BASE_IWRAM, GBA_BASE_IO },
+	{ "io", GBA_BASE_IO, GBA_BASE_PALETTE_RAM },
+	{ "palette", GBA_BASE_PALETTE_RAM, GBA_BASE_VRAM },
+	{ "vram", GBA_BASE_VRAM, GBA_BASE_OAM },
+	{ "oam", GBA_BASE_OAM, GBA_BASE_ROM0 },
+	{ "cart0", GBA_BASE_ROM0, GBA_BASE_ROM1 },
+	{ "cart1", GBA_BASE_ROM1, GBA_BASE_ROM2 },
+	{ "cart2", GBA_BASE_ROM2, GBA_BASE_SRAM },
+	{ "sram", GBA_BASE_SRAM, 0x10000000 },
+	{ "unmapped", 0x10000000, 0xFFFFFFFF },
+};
+
+// Maps the top byte of the address to an entry in _statsRegions
+static const uint8_t _statsRegionIndex[16] = {
+	0, 0, 1, 2, 3, 4, 5, 6, 7, 7, 8, 8, 9, 9, 10, 10
+};
+
 void GBAMemoryInit(struct GBA* gba) {
 	struct ARMCore* cpu = gba->cpu;
 	cpu->memory.load32 = GBALoad32;
@@ -83,20 +110,33 @@ void GBAMemoryInit(struct GBA* gba) {
 	cpu->memory.activeNonseqCycles32 = 0;
 	cpu->memory.activeNonseqCycles16 = 0;
 	gba->memory.biosPrefetch = 0;
+	gba->memory.prefetchModel = GBA_PREFETCH_ACCURATE;
 
 	gba->memory.agbPrintProtect = 0;
 	memset(&gba->memory.agbPrintCtx, 0, sizeof(gba->memory.agbPrintCtx));
 	gba->memory.agbPrintBuffer = NULL;
 	gba->memory.agbPrintBufferBackup = NULL;
+	gba->memory.watcher = NULL;
+	gba->memory.watchRanges = NULL;
+	gba->memory.nWatchRanges = 0;
+	memset(gba->memory.watchedPages, 0, sizeof(gba->memory.watchedPages));
+	gba->memory.stats = NULL;
 
 	gba->memory.wram = anonymousMemoryMap(GBA_SIZE_EWRAM + GBA_SIZE_IWRAM);
 	gba->memory.iwram = &gba->memory.wram[GBA_SIZE_EWRAM >> 2];
+	memset(gba->memory.dirtyEpochs, 0, sizeof(gba->memory.dirtyEpochs));
+	gba->memory.dirtyEpoch = 0;
+	gba->memory.hashEpoch = 0;
+	GBAMemoryMarkDirty(&gba->memory);
+	GBAMemoryUpdatePages(gba);
 
 	GBADMAInit(gba);
 	GBAVFameInit(&gba->memory.vfame);
 
 	gba->memory.ereader.p = gba;
 	gba->memory.ereader.dots = NULL;
+	gba->memory.ereader.dotsCrc = 0;
+	gba->memory.ereader.dotsSize = 0;
 	memset(gba->memory.ereader.cards, 0, sizeof(gba->memory.ereader.cards));
 }
 
@@ -113,16 +153,28 @@ void GBAMemoryDeinit(struct GBA* gba) {
 	}
 
 	GBACartEReaderDeinit(&gba->memory.ereader);
+	free(gba->memory.watchRanges);
+	free(gba->memory.stats);
+}
+
+static void _clearRAM(struct GBA* gba, uint32_t* ram, size_t size) {
+	if (gba->slim) {
+		// Handing the pages back means RAM a game never touches doesn't take up space
+		mappedMemoryClear(ram, size);
+	} else {
+		memset(ram, 0, size);
+	}
 }
 
 void GBAMemoryReset(struct GBA* gba) {
 	if (gba->memory.wram && gba->memory.rom) {
-		memset(gba->memory.wram, 0, GBA_SIZE_EWRAM);
+		_clearRAM(gba, gba->memory.wram, GBA_SIZE_EWRAM);
 	}
 
 	if (gba->memory.iwram) {
-		memset(gba->memory.iwram, 0, GBA_SIZE_IWRAM);
+		_clearRAM(gba, gba->memory.iwram, GBA_SIZE_IWRAM);
 	}
+	GBAMemoryMarkDirty(&gba->memory);
 
 	memset(gba->memory.io, 0, sizeof(gba->memory.io));
 	GBAAdjustWaitstates(gba, 0);
@@ -140,6 +192,7 @@ void GBAMemoryReset(struct GBA* gba) {
 
 	GBADMAReset(gba);
 	memset(&gba->memory.matrix, 0, sizeof(gba->memory.matrix));
+	GBAMemoryUpdatePages(gba);
 }
 
 void GBAMemoryClearAGBPrint(struct GBA* gba) {
@@ -157,6 +210,163 @@ void GBAMemoryClearAGBPrint(struct GBA* gba) {
 	}
 }
 
+static uint32_t _watchAddress(uint32_t address);
+static bool _isWatched(const struct GBAMemory* memory, uint32_t address);
+
+void GBAMemoryUpdatePages(struct GBA* gba) {
+	struct GBAMemory* memory = &gba->memory;
+	memset(memory->readPages, 0, sizeof(memory->readPages));
+	memset(memory->writePages, 0, sizeof(memory->writePages));
+	if (memory->stats) {
+		// Everything has to go through the slow path to get counted
+		return;
+	}
+
+	uint32_t address;
+	if (memory->wram) {
+		for (address = GBA_BASE_EWRAM; address < GBA_BASE_IO; address += GBA_PAGE_SIZE) {
+			uint8_t* page;
+			if (address < GBA_BASE_IWRAM) {
+				page = &((uint8_t*) memory->wram)[address & (GBA_SIZE_EWRAM - 1)];
+			} else {
+				page = &((uint8_t*) memory->iwram)[address & (GBA_SIZE_IWRAM - 1)];
+			}
+			memory->readPages[address >> GBA_PAGE_SHIFT] = page;
+			if (!_isWatched(memory, _watchAddress(address))) {
+				memory->writePages[address >> GBA_PAGE_SHIFT] = page;
+			}
+		}
+	}
+	if (memory->rom) {
+		// The last ROM region is left out, since EEPROM and the e-Reader can show up anywhere in it
+		for (address = GBA_BASE_ROM0; address < GBA_BASE_ROM2_EX; address += GBA_PAGE_SIZE) {
+			uint32_t offset = address & (GBA_SIZE_ROM0 - 1);
+			if (offset + GBA_PAGE_SIZE <= memory->romSize) {
+				memory->readPages[address >> GBA_PAGE_SHIFT] = &((uint8_t*) memory->rom)[offset];
+			}
+		}
+	}
+}
+
+static inline const uint8_t* _readPage(const struct GBAMemory* memory, uint32_t address) {
+	uint32_t page = address >> GBA_PAGE_SHIFT;
+	return page < GBA_PAGES ? memory->readPages[page] : NULL;
+}
+
+static inline uint8_t* _writePage(const struct GBAMemory* memory, uint32_t address) {
+	uint32_t page = address >> GBA_PAGE_SHIFT;
+	return page < GBA_WRITE_PAGES ? memory->writePages[page] : NULL;
+}
+
+static uint32_t _watchAddress(uint32_t address) {
+	// RAM is mirrored throughout its region, so watches are kept in terms of the first mirror
+	switch (address >> BASE_OFFSET) {
+	case GBA_REGION_EWRAM:
+		return GBA_BASE_EWRAM | (address & (GBA_SIZE_EWRAM - 1));
+	case GBA_REGION_IWRAM:
+		return GBA_BASE_IWRAM | (address & (GBA_SIZE_IWRAM - 1));
+	default:
+		return address;
+	}
+}
+
+static bool _isWatched(const struct GBAMemory* memory, uint32_t address) {
+	uint32_t page = address >> GBA_PAGE_SHIFT;
+	return page < GBA_PAGES && (memory->watchedPages[page >> 5] & (1U << (page & 0x1F)));
+}
+
+static void _reportStore(struct GBAMemory* memory, uint32_t address, int width, uint32_t value) {
+	address = _watchAddress(address);
+	if (!_isWatched(memory, address)) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < memory->nWatchRanges; ++i) {
+		const struct mCoreMemoryWatchRange* range = &memory->watchRanges[i];
+		if (address < range->end && address + width > range->start) {
+			memory->watcher->written(memory->watcher, address, width, value);
+			return;
+		}
+	}
+}
+
+static void _reportStoreMultiple(struct ARMCore* cpu, struct GBAMemory* memory, uint32_t address, int mask) {
+	if (!mask) {
+		_reportStore(memory, address, 4, cpu->gprs[ARM_PC] + (cpu->executionMode == MODE_ARM ? WORD_SIZE_ARM : WORD_SIZE_THUMB));
+		return;
+	}
+	int bits;
+	for (bits = mask; bits; bits &= bits - 1, address += 4) {
+		int i = ctz32(bits);
+		uint32_t value = cpu->gprs[i];
+		if (i == ARM_PC) {
+			value += WORD_SIZE_ARM;
+		}
+		_reportStore(memory, address, 4, value);
+	}
+}
+
+void GBAMemorySetWatcher(struct GBA* gba, struct mCoreMemoryWatcher* watcher, const struct mCoreMemoryWatchRange* ranges, size_t nRanges) {
+	struct GBAMemory* memory = &gba->memory;
+	free(memory->watchRanges);
+	memory->watchRanges = NULL;
+	memory->nWatchRanges = 0;
+	memset(memory->watchedPages, 0, sizeof(memory->watchedPages));
+	memory->watcher = watcher;
+	if (watcher && nRanges) {
+		memory->watchRanges = malloc(nRanges * sizeof(*ranges));
+		memcpy(memory->watchRanges, ranges, nRanges * sizeof(*ranges));
+		memory->nWatchRanges = nRanges;
+		size_t i;
+		for (i = 0; i < nRanges; ++i) {
+			if (ranges[i].end <= ranges[i].start) {
+				continue;
+			}
+			uint32_t page = ranges[i].start >> GBA_PAGE_SHIFT;
+			uint32_t lastPage = (ranges[i].end - 1) >> GBA_PAGE_SHIFT;
+			for (; page <= lastPage && page < GBA_PAGES; ++page) {
+				memory->watchedPages[page >> 5] |= 1U << (page & 0x1F);
+			}
+		}
+	} else {
+		memory->watcher = NULL;
+	}
+	GBAMemoryUpdatePages(gba);
+}
+
+void GBAMemorySetStatsEnabled(struct GBA* gba, bool enable) {
+	struct GBAMemory* memory = &gba->memory;
+	free(memory->stats);
+	memory->stats = NULL;
+	if (enable) {
+		memory->stats = malloc(sizeof(_statsRegions));
+		memcpy(memory->stats, _statsRegions, sizeof(_statsRegions));
+	}
+	GBAMemoryUpdatePages(gba);
+}
+
+size_t GBAMemoryCollectStats(const struct GBAMemory* memory, struct mCoreMemoryStats* stats, size_t max) {
+	if (!memory->stats) {
+		return 0;
+	}
+	size_t count = sizeof(_statsRegions) / sizeof(*_statsRegions);
+	memcpy(stats, memory->stats, (max < count ? max : count) * sizeof(*stats));
+	return count;
+}
+
+static inline struct mCoreMemoryStats* _statsFor(struct GBAMemory* memory, uint32_t region) {
+	return &memory->stats[region < 16 ? _statsRegionIndex[region] : GBA_STATS_UNMAPPED];
+}
+
+static void _countAccess(struct GBAMemory* memory, uint32_t region, int reads, int writes, int* cycleCounter, int32_t wait) {
+	struct mCoreMemoryStats* stats = _statsFor(memory, region);
+	stats->reads += reads;
+	stats->writes += writes;
+	if (cycleCounter) {
+		stats->waitCycles += wait;
+	}
+}
+
 static void _analyzeForIdleLoop(struct GBA* gba, struct ARMCore* cpu, uint32_t address) {
 	struct ARMInstructionInfo info;
 	uint32_t nextAddress = address;
@@ -217,6 +427,7 @@ static void _analyzeForIdleLoop(struct GBA* gba, struct ARMCore* cpu, uint32_t a
 			case ARM_BRANCH:
 				if ((uint32_t) info.op1.immediate + nextAddress + WORD_SIZE_THUMB * 2 == address) {
 					gba->idleLoop = address;
+					gba->idleLoopDetected = true;
 					gba->idleOptimization = IDLE_LOOP_REMOVE;
 				}
 				gba->idleDetectionStep = -1;
@@ -350,7 +561,9 @@ static void GBASetActiveRegion(struct ARMCore* cpu, uint32_t address) {
 
 		if (gba->yankedRomSize || !gba->hardCrash) {
 			mLOG(GBA_MEM, GAME_ERROR, "Jumped to invalid address: %08X", address);
+			GBALogCallStack(gba, mLOG_GAME_ERROR);
 		} else {
+			GBALogCallStack(gba, mLOG_FATAL);
 			mLOG(GBA_MEM, FATAL, "Jumped to invalid address: %08X", address);
 		}
 		return;
@@ -412,7 +625,7 @@ static void GBASetActiveRegion(struct ARMCore* cpu, uint32_t address) {
 	if ((address & (GBA_SIZE_ROM0 - 4)) < memory->romSize) { \
 		LOAD_32(value, address & (GBA_SIZE_ROM0 - 4), memory->rom); \
 	} else if (memory->vfame.cartType) { \
-		value = GBAVFameGetPatternValue(address, 32); \
+		value = GBAVFameGetPatternValue(&memory->vfame, address, 32); \
 	} else { \
 		mLOG(GBA_MEM, GAME_ERROR, "Out of bounds ROM Load32: 0x%08X", address); \
 		value = ((address & ~3) >> 1) & 0xFFFF; \
@@ -465,6 +678,21 @@ uint32_t GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	int wait = 0;
 	char* waitstatesRegion = memory->waitstatesNonseq32;
 
+	// Plain RAM and ROM make up most accesses, and can skip decoding the address entirely
+	const uint8_t* page = _readPage(memory, address);
+	if (page) {
+		LOAD_32(value, address & (GBA_PAGE_SIZE - 4), page);
+		if (cycleCounter) {
+			wait = waitstatesRegion[address >> BASE_OFFSET] + 2;
+			if (address < GBA_BASE_ROM0) {
+				wait = GBAMemoryStall(cpu, wait);
+			}
+			*cycleCounter += wait;
+		}
+		int rotate = (address & 3) << 3;
+		return ROR(value, rotate);
+	}
+
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_BIOS:
 		LOAD_BIOS;
@@ -512,6 +740,9 @@ uint32_t GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 		}
 		*cycleCounter += wait;
 	}
+	if (UNLIKELY(memory->stats)) {
+		_countAccess(memory, address >> BASE_OFFSET, 1, 0, cycleCounter, wait);
+	}
 	// Unaligned 32-bit loads are "rotated" so they make some semblance of sense
 	int rotate = (address & 3) << 3;
 	return ROR(value, rotate);
@@ -523,6 +754,20 @@ uint32_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	uint32_t value = 0;
 	int wait = 0;
 
+	const uint8_t* page = _readPage(memory, address);
+	if (page) {
+		LOAD_16(value, address & (GBA_PAGE_SIZE - 2), page);
+		if (cycleCounter) {
+			wait = memory->waitstatesNonseq16[address >> BASE_OFFSET] + 2;
+			if (address < GBA_BASE_ROM0) {
+				wait = GBAMemoryStall(cpu, wait);
+			}
+			*cycleCounter += wait;
+		}
+		int rotate = (address & 1) << 3;
+		return ROR(value, rotate);
+	}
+
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_BIOS:
 		if (address < GBA_SIZE_BIOS) {
@@ -577,7 +822,7 @@ uint32_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 		if ((address & (GBA_SIZE_ROM0 - 2)) < memory->romSize) {
 			LOAD_16(value, address & (GBA_SIZE_ROM0 - 2), memory->rom);
 		} else if (memory->vfame.cartType) {
-			value = GBAVFameGetPatternValue(address, 16);
+			value = GBAVFameGetPatternValue(&memory->vfame, address, 16);
 		} else if ((address & (GBA_SIZE_ROM0 - 2)) >= AGB_PRINT_BASE) {
 			uint32_t agbPrintAddr = address & 0x00FFFFFF;
 			if (agbPrintAddr == AGB_PRINT_PROTECT) {
@@ -602,7 +847,7 @@ uint32_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 		} else if ((address & (GBA_SIZE_ROM0 - 2)) < memory->romSize) {
 			LOAD_16(value, address & (GBA_SIZE_ROM0 - 2), memory->rom);
 		} else if (memory->vfame.cartType) {
-			value = GBAVFameGetPatternValue(address, 16);
+			value = GBAVFameGetPatternValue(&memory->vfame, address, 16);
 		} else {
 			mLOG(GBA_MEM, GAME_ERROR, "Out of bounds ROM Load16: 0x%08X", address);
 			value = (address >> 1) & 0xFFFF;
@@ -627,6 +872,9 @@ uint32_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 		}
 		*cycleCounter += wait;
 	}
+	if (UNLIKELY(memory->stats)) {
+		_countAccess(memory, address >> BASE_OFFSET, 1, 0, cycleCounter, wait);
+	}
 	// Unaligned 16-bit loads are "unpredictable", but the GBA rotates them, so we have to, too.
 	int rotate = (address & 1) << 3;
 	return ROR(value, rotate);
@@ -638,6 +886,19 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	uint32_t value = 0;
 	int wait = 0;
 
+	const uint8_t* page = _readPage(memory, address);
+	if (page) {
+		value = page[address & (GBA_PAGE_SIZE - 1)];
+		if (cycleCounter) {
+			wait = memory->waitstatesNonseq16[address >> BASE_OFFSET] + 2;
+			if (address < GBA_BASE_ROM0) {
+				wait = GBAMemoryStall(cpu, wait);
+			}
+			*cycleCounter += wait;
+		}
+		return value;
+	}
+
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_BIOS:
 		if (address < GBA_SIZE_BIOS) {
@@ -693,7 +954,7 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 		if ((address & (GBA_SIZE_ROM0 - 1)) < memory->romSize) {
 			value = ((uint8_t*) memory->rom)[address & (GBA_SIZE_ROM0 - 1)];
 		} else if (memory->vfame.cartType) {
-			value = GBAVFameGetPatternValue(address, 8);
+			value = GBAVFameGetPatternValue(&memory->vfame, address, 8);
 		} else {
 			mLOG(GBA_MEM, GAME_ERROR, "Out of bounds ROM Load8: 0x%08X", address);
 			value = ((address >> 1) >> ((address & 1) * 8)) & 0xFF;
@@ -738,15 +999,20 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 		}
 		*cycleCounter += wait;
 	}
+	if (UNLIKELY(memory->stats)) {
+		_countAccess(memory, address >> BASE_OFFSET, 1, 0, cycleCounter, wait);
+	}
 	return value;
 }
 
 #define STORE_EWRAM \
 	STORE_32(value, address & (GBA_SIZE_EWRAM - 4), memory->wram); \
+	MARK_EWRAM_DIRTY(address); \
 	wait += waitstatesRegion[GBA_REGION_EWRAM];
 
 #define STORE_IWRAM \
-	STORE_32(value, address & (GBA_SIZE_IWRAM - 4), memory->iwram);
+	STORE_32(value, address & (GBA_SIZE_IWRAM - 4), memory->iwram); \
+	MARK_IWRAM_DIRTY(address);
 
 #define STORE_IO \
 	GBAIOWrite32(gba, address & (OFFSET_MASK - 3), value);
@@ -821,6 +1087,18 @@ void GBAStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycle
 	int32_t oldValue;
 	char* waitstatesRegion = memory->waitstatesNonseq32;
 
+	uint8_t* page = _writePage(memory, address);
+	if (page) {
+		uint32_t offset = address & (GBA_PAGE_SIZE - 4);
+		STORE_32(value, offset, page);
+		// Both RAM regions come from the same mapping, so this finds the right dirty page for either
+		memory->dirtyPages[(page + offset - (uint8_t*) memory->wram) >> GBA_DIRTY_PAGE_SHIFT] = 1;
+		if (cycleCounter) {
+			*cycleCounter += GBAMemoryStall(cpu, waitstatesRegion[address >> BASE_OFFSET] + 1);
+		}
+		return;
+	}
+
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_EWRAM:
 		STORE_EWRAM;
@@ -857,6 +1135,10 @@ void GBAStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycle
 		break;
 	}
 
+	if (UNLIKELY(memory->watcher)) {
+		_reportStore(memory, address & ~3, 4, value);
+	}
+
 	if (cycleCounter) {
 		++wait;
 		if (address < GBA_BASE_ROM0) {
@@ -864,6 +1146,9 @@ void GBAStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycle
 		}
 		*cycleCounter += wait;
 	}
+	if (UNLIKELY(memory->stats)) {
+		_countAccess(memory, address >> BASE_OFFSET, 0, 1, cycleCounter, wait);
+	}
 }
 
 void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycleCounter) {
@@ -872,13 +1157,27 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 	int wait = 0;
 	int16_t oldValue;
 
+	uint8_t* page = _writePage(memory, address);
+	if (page) {
+		uint32_t offset = address & (GBA_PAGE_SIZE - 2);
+		STORE_16(value, offset, page);
+		// Both RAM regions come from the same mapping, so this finds the right dirty page for either
+		memory->dirtyPages[(page + offset - (uint8_t*) memory->wram) >> GBA_DIRTY_PAGE_SHIFT] = 1;
+		if (cycleCounter) {
+			*cycleCounter += GBAMemoryStall(cpu, memory->waitstatesNonseq16[address >> BASE_OFFSET] + 1);
+		}
+		return;
+	}
+
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_EWRAM:
 		STORE_16(value, address & (GBA_SIZE_EWRAM - 2), memory->wram);
+		MARK_EWRAM_DIRTY(address);
 		wait = memory->waitstatesNonseq16[GBA_REGION_EWRAM];
 		break;
 	case GBA_REGION_IWRAM:
 		STORE_16(value, address & (GBA_SIZE_IWRAM - 2), memory->iwram);
+		MARK_IWRAM_DIRTY(address);
 		break;
 	case GBA_REGION_IO:
 		GBAIOWrite(gba, address & (OFFSET_MASK - 1), value);
@@ -925,6 +1224,10 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 				mLOG(GBA_HW, WARN, "Write to GPIO address %08X on cartridge without GPIO", address);
 				break;
 			}
+			if (gba->romImage) {
+				// GPIO state is mirrored into ROM, which mustn't leak into other cores sharing it
+				_pristineCow(gba);
+			}
 			uint32_t reg = address & 0xFFFFFE;
 			GBAHardwareGPIOWrite(&memory->hw, reg, value);
 			break;
@@ -999,6 +1302,10 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 		break;
 	}
 
+	if (UNLIKELY(memory->watcher)) {
+		_reportStore(memory, address & ~1, 2, (uint16_t) value);
+	}
+
 	if (cycleCounter) {
 		++wait;
 		if (address < GBA_BASE_ROM0) {
@@ -1006,6 +1313,9 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 		}
 		*cycleCounter += wait;
 	}
+	if (UNLIKELY(memory->stats)) {
+		_countAccess(memory, address >> BASE_OFFSET, 0, 1, cycleCounter, wait);
+	}
 }
 
 void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCounter) {
@@ -1014,13 +1324,27 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 	int wait = 0;
 	uint16_t oldValue;
 
+	uint8_t* page = _writePage(memory, address);
+	if (page) {
+		uint32_t offset = address & (GBA_PAGE_SIZE - 1);
+		page[offset] = value;
+		// Both RAM regions come from the same mapping, so this finds the right dirty page for either
+		memory->dirtyPages[(page + offset - (uint8_t*) memory->wram) >> GBA_DIRTY_PAGE_SHIFT] = 1;
+		if (cycleCounter) {
+			*cycleCounter += GBAMemoryStall(cpu, memory->waitstatesNonseq16[address >> BASE_OFFSET] + 1);
+		}
+		return;
+	}
+
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_EWRAM:
 		((int8_t*) memory->wram)[address & (GBA_SIZE_EWRAM - 1)] = value;
+		MARK_EWRAM_DIRTY(address);
 		wait = memory->waitstatesNonseq16[GBA_REGION_EWRAM];
 		break;
 	case GBA_REGION_IWRAM:
 		((int8_t*) memory->iwram)[address & (GBA_SIZE_IWRAM - 1)] = value;
+		MARK_IWRAM_DIRTY(address);
 		break;
 	case GBA_REGION_IO:
 		GBAIOWrite8(gba, address & OFFSET_MASK, value);
@@ -1066,15 +1390,16 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 		} else if (memory->savedata.type == SAVEDATA_SRAM) {
 			if (memory->vfame.cartType) {
 				GBAVFameSramWrite(&memory->vfame, address, value, memory->savedata.data);
+				GBASavedataMarkDirty(&memory->savedata, 0, GBA_SIZE_SRAM);
 			} else {
 				memory->savedata.data[address & (GBA_SIZE_SRAM - 1)] = value;
+				GBASavedataMarkDirty(&memory->savedata, address & (GBA_SIZE_SRAM - 1), 1);
 			}
-			memory->savedata.dirty |= mSAVEDATA_DIRT_NEW;
 		} else if (memory->hw.devices & HW_TILT) {
 			GBAHardwareTiltWrite(&memory->hw, address & OFFSET_MASK, value);
 		} else if (memory->savedata.type == SAVEDATA_SRAM512) {
 			memory->savedata.data[address & (GBA_SIZE_SRAM512 - 1)] = value;
-			memory->savedata.dirty |= mSAVEDATA_DIRT_NEW;
+			GBASavedataMarkDirty(&memory->savedata, address & (GBA_SIZE_SRAM512 - 1), 1);
 		} else {
 			mLOG(GBA_MEM, GAME_ERROR, "Writing to non-existent SRAM: 0x%08X", address);
 		}
@@ -1085,6 +1410,10 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 		break;
 	}
 
+	if (UNLIKELY(memory->watcher)) {
+		_reportStore(memory, address, 1, (uint8_t) value);
+	}
+
 	if (cycleCounter) {
 		++wait;
 		if (address < GBA_BASE_ROM0) {
@@ -1092,6 +1421,9 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 		}
 		*cycleCounter += wait;
 	}
+	if (UNLIKELY(memory->stats)) {
+		_countAccess(memory, address >> BASE_OFFSET, 0, 1, cycleCounter, wait);
+	}
 }
 
 uint32_t GBAView32(struct ARMCore* cpu, uint32_t address) {
@@ -1214,10 +1546,12 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 	case GBA_REGION_EWRAM:
 		LOAD_32(oldValue, address & (GBA_SIZE_EWRAM - 4), memory->wram);
 		STORE_32(value, address & (GBA_SIZE_EWRAM - 4), memory->wram);
+		MARK_EWRAM_DIRTY(address);
 		break;
 	case GBA_REGION_IWRAM:
 		LOAD_32(oldValue, address & (GBA_SIZE_IWRAM - 4), memory->iwram);
 		STORE_32(value, address & (GBA_SIZE_IWRAM - 4), memory->iwram);
+		MARK_IWRAM_DIRTY(address);
 		break;
 	case GBA_REGION_IO:
 		mLOG(GBA_MEM, STUB, "Unimplemented memory Patch32: 0x%08X", address);
@@ -1255,8 +1589,7 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 	case GBA_REGION_ROM2_EX:
 		_pristineCow(gba);
 		if ((address & (GBA_SIZE_ROM0 - 4)) >= gba->memory.romSize) {
-			gba->memory.romSize = (address & (GBA_SIZE_ROM0 - 4)) + 4;
-			gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
+			_extendRom(gba, (address & (GBA_SIZE_ROM0 - 4)) + 4);
 		}
 		LOAD_32(oldValue, address & (GBA_SIZE_ROM0 - 4), gba->memory.rom);
 		STORE_32(value, address & (GBA_SIZE_ROM0 - 4), gba->memory.rom);
@@ -1288,10 +1621,12 @@ void GBAPatch16(struct ARMCore* cpu, uint32_t address, int16_t value, int16_t* o
 	case GBA_REGION_EWRAM:
 		LOAD_16(oldValue, address & (GBA_SIZE_EWRAM - 2), memory->wram);
 		STORE_16(value, address & (GBA_SIZE_EWRAM - 2), memory->wram);
+		MARK_EWRAM_DIRTY(address);
 		break;
 	case GBA_REGION_IWRAM:
 		LOAD_16(oldValue, address & (GBA_SIZE_IWRAM - 2), memory->iwram);
 		STORE_16(value, address & (GBA_SIZE_IWRAM - 2), memory->iwram);
+		MARK_IWRAM_DIRTY(address);
 		break;
 	case GBA_REGION_IO:
 		mLOG(GBA_MEM, STUB, "Unimplemented memory Patch16: 0x%08X", address);
@@ -1325,8 +1660,7 @@ void GBAPatch16(struct ARMCore* cpu, uint32_t address, int16_t value, int16_t* o
 	case GBA_REGION_ROM2_EX:
 		_pristineCow(gba);
 		if ((address & (GBA_SIZE_ROM0 - 2)) >= gba->memory.romSize) {
-			gba->memory.romSize = (address & (GBA_SIZE_ROM0 - 2)) + 2;
-			gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
+			_extendRom(gba, (address & (GBA_SIZE_ROM0 - 2)) + 2);
 		}
 		LOAD_16(oldValue, address & (GBA_SIZE_ROM0 - 2), gba->memory.rom);
 		STORE_16(value, address & (GBA_SIZE_ROM0 - 2), gba->memory.rom);
@@ -1358,10 +1692,12 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 	case GBA_REGION_EWRAM:
 		oldValue = ((int8_t*) memory->wram)[address & (GBA_SIZE_EWRAM - 1)];
 		((int8_t*) memory->wram)[address & (GBA_SIZE_EWRAM - 1)] = value;
+		MARK_EWRAM_DIRTY(address);
 		break;
 	case GBA_REGION_IWRAM:
 		oldValue = ((int8_t*) memory->iwram)[address & (GBA_SIZE_IWRAM - 1)];
 		((int8_t*) memory->iwram)[address & (GBA_SIZE_IWRAM - 1)] = value;
+		MARK_IWRAM_DIRTY(address);
 		break;
 	case GBA_REGION_IO:
 		mLOG(GBA_MEM, STUB, "Unimplemented memory Patch8: 0x%08X", address);
@@ -1383,8 +1719,7 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 	case GBA_REGION_ROM2_EX:
 		_pristineCow(gba);
 		if ((address & (GBA_SIZE_ROM0 - 1)) >= gba->memory.romSize) {
-			gba->memory.romSize = (address & (GBA_SIZE_ROM0 - 2)) + 2;
-			gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
+			_extendRom(gba, (address & (GBA_SIZE_ROM0 - 2)) + 2);
 		}
 		oldValue = ((int8_t*) memory->rom)[address & (GBA_SIZE_ROM0 - 1)];
 		((int8_t*) memory->rom)[address & (GBA_SIZE_ROM0 - 1)] = value;
@@ -1467,7 +1802,22 @@ uint32_t GBALoadMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum L
 	}
 	int wait = memory->waitstatesSeq32[region] - memory->waitstatesNonseq32[region];
 
-	switch (region) {
+	// Bursts within a single page of plain RAM or ROM can be copied straight out of it
+	const uint8_t* page = NULL;
+	int count = popcount32(mask);
+	if (mask && (address >> GBA_PAGE_SHIFT) == ((address + (count << 2) - 4) >> GBA_PAGE_SHIFT)) {
+		page = _readPage(memory, address);
+	}
+	if (page) {
+		const uint8_t* base = &page[address & (GBA_PAGE_SIZE - 4)];
+		int bits;
+		for (bits = mask; bits; bits &= bits - 1, base += 4) {
+			LOAD_32(value, 0, base);
+			cpu->gprs[ctz32(bits)] = value;
+		}
+		wait += count * (waitstatesRegion[region] + 1);
+		address += count << 2;
+	} else switch (region) {
 	case GBA_REGION_BIOS:
 		LDM_LOOP(LOAD_BIOS);
 		break;
@@ -1513,6 +1863,9 @@ uint32_t GBALoadMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum L
 		}
 		*cycleCounter += wait;
 	}
+	if (UNLIKELY(memory->stats)) {
+		_countAccess(memory, region, mask ? count : 1, 0, cycleCounter, wait);
+	}
 
 	if (direction & LSM_B) {
 		address -= offset;
@@ -1589,7 +1942,29 @@ uint32_t GBAStoreMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum
 	}
 	int wait = memory->waitstatesSeq32[region] - memory->waitstatesNonseq32[region];
 
-	switch (region) {
+	// Bursts within a single page of plain RAM can be copied straight into it
+	uint8_t* page = NULL;
+	int count = popcount32(mask);
+	if (mask && (address >> GBA_PAGE_SHIFT) == ((address + (count << 2) - 4) >> GBA_PAGE_SHIFT)) {
+		page = _writePage(memory, address);
+	}
+	uint32_t start = address;
+	if (page) {
+		uint8_t* base = &page[address & (GBA_PAGE_SIZE - 4)];
+		memory->dirtyPages[(base - (uint8_t*) memory->wram) >> GBA_DIRTY_PAGE_SHIFT] = 1;
+		memory->dirtyPages[(base + (count << 2) - 4 - (uint8_t*) memory->wram) >> GBA_DIRTY_PAGE_SHIFT] = 1;
+		int bits;
+		for (bits = mask; bits; bits &= bits - 1, base += 4) {
+			i = ctz32(bits);
+			value = cpu->gprs[i];
+			if (i == ARM_PC) {
+				value += WORD_SIZE_ARM;
+			}
+			STORE_32(value, 0, base);
+		}
+		wait += count * (waitstatesRegion[region] + 1);
+		address += count << 2;
+	} else switch (region) {
 	case GBA_REGION_EWRAM:
 		STM_LOOP(STORE_EWRAM);
 		break;
@@ -1625,12 +2000,19 @@ uint32_t GBAStoreMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum
 		break;
 	}
 
+	if (UNLIKELY(memory->watcher) && !page) {
+		_reportStoreMultiple(cpu, memory, start, mask);
+	}
+
 	if (cycleCounter) {
 		if (address < GBA_BASE_ROM0) {
 			wait = GBAMemoryStall(cpu, wait);
 		}
 		*cycleCounter += wait;
 	}
+	if (UNLIKELY(memory->stats)) {
+		_countAccess(memory, region, 0, mask ? count : 1, cycleCounter, wait);
+	}
 
 	if (direction & LSM_B) {
 		address -= offset;
@@ -1643,6 +2025,136 @@ uint32_t GBAStoreMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum
 	return address | addressMisalign;
 }
 
+static const uint8_t* _directSource(struct GBA* gba, uint32_t address) {
+	const uint8_t* page = _readPage(&gba->memory, address);
+	if (page) {
+		return &page[address & (GBA_PAGE_SIZE - 1)];
+	}
+	// VRAM has no pages, so it gets the same restrictions GBAMemoryUpdatePages puts on them here
+	if (address >> BASE_OFFSET == GBA_REGION_VRAM && (address & 0x0001FFFF) < GBA_SIZE_VRAM && !gba->video.shouldStall && !gba->memory.stats) {
+		return &((const uint8_t*) gba->video.vram)[address & 0x0001FFFF];
+	}
+	return NULL;
+}
+
+static uint8_t* _directDest(struct GBA* gba, uint32_t address) {
+	uint8_t* page = _writePage(&gba->memory, address);
+	if (page) {
+		return &page[address & (GBA_PAGE_SIZE - 1)];
+	}
+	if (address >> BASE_OFFSET == GBA_REGION_VRAM && (address & 0x0001FFFF) < GBA_SIZE_VRAM && !gba->video.shouldStall && !gba->memory.stats && !_isWatched(&gba->memory, address)) {
+		return &((uint8_t*) gba->video.vram)[address & 0x0001FFFF];
+	}
+	return NULL;
+}
+
+static uint32_t _directSpan(uint32_t address, uint32_t size) {
+	// VRAM starts on a page boundary too, so its pages split the same way
+	uint32_t span = GBA_PAGE_SIZE - (address & (GBA_PAGE_SIZE - 1));
+	return span < size ? span : size;
+}
+
+// Copies halfword by halfword from the pattern, or from source if there's no pattern
+static void _storeDirect(struct GBA* gba, uint32_t address, uint8_t* dest, const uint8_t* source, const uint8_t* pattern, uint32_t size) {
+	struct GBAMemory* memory = &gba->memory;
+	uint32_t i;
+	if (address >> BASE_OFFSET == GBA_REGION_VRAM) {
+		uint32_t start = size;
+		uint32_t end = 0;
+		for (i = 0; i < size; i += 2) {
+			uint16_t value;
+			uint16_t oldValue;
+			if (pattern) {
+				LOAD_16(value, i & 2, pattern);
+			} else {
+				LOAD_16(value, i, source);
+			}
+			LOAD_16(oldValue, i, dest);
+			if (value != oldValue) {
+				STORE_16(value, i, dest);
+				if (start > i) {
+					start = i;
+				}
+				end = i + 2;
+			}
+		}
+		if (start < end) {
+			gba->video.renderer->writeVRAMRange(gba->video.renderer, (address & 0x0001FFFE) + start, end - start);
+		}
+		return;
+	}
+	if (pattern) {
+		for (i = 0; i < size; i += 2) {
+			memcpy(&dest[i], &pattern[i & 2], 2);
+		}
+	} else if (dest > source && dest < source + size) {
+		// An overlapping copy has to run forward, just like the BIOS loop does
+		for (i = 0; i < size; i += 2) {
+			memcpy(&dest[i], &source[i], 2);
+		}
+	} else {
+		memmove(dest, source, size);
+	}
+	// Both RAM regions come from the same mapping, so this finds the right dirty page for either
+	size_t page = (dest - (uint8_t*) memory->wram) >> GBA_DIRTY_PAGE_SHIFT;
+	size_t lastPage = (dest + size - 1 - (uint8_t*) memory->wram) >> GBA_DIRTY_PAGE_SHIFT;
+	for (; page <= lastPage; ++page) {
+		memory->dirtyPages[page] = 1;
+	}
+}
+
+bool GBAMemoryCopyDirect(struct GBA* gba, uint32_t dest, uint32_t source, uint32_t size, uint32_t burst) {
+	if (gba->debugger || (dest | source | size) & 1) {
+		return false;
+	}
+	uint32_t offset;
+	uint32_t span;
+	// Nothing gets written unless the whole range can be done this way
+	for (offset = 0; offset < size; offset += span) {
+		span = _directSpan(source + offset, _directSpan(dest + offset, size - offset));
+		const uint8_t* from = _directSource(gba, source + offset);
+		const uint8_t* to = _directDest(gba, dest + offset);
+		if (!from || !to) {
+			return false;
+		}
+		if (to + burst > from && to < from + burst) {
+			// The BIOS reads a whole burst before writing it, which a forward copy can't mimic this close
+			return false;
+		}
+	}
+	for (offset = 0; offset < size; offset += span) {
+		span = _directSpan(source + offset, _directSpan(dest + offset, size - offset));
+		_storeDirect(gba, dest + offset, _directDest(gba, dest + offset), _directSource(gba, source + offset), NULL, span);
+	}
+	return true;
+}
+
+bool GBAMemoryFillDirect(struct GBA* gba, uint32_t dest, uint32_t value, uint32_t size, int width) {
+	if (gba->debugger || (dest | size) & 1) {
+		return false;
+	}
+	uint8_t pattern[4];
+	if (width == 4) {
+		STORE_32LE(value, 0, pattern);
+	} else {
+		STORE_16LE(value, 0, pattern);
+		STORE_16LE(value, 2, pattern);
+	}
+	uint32_t offset;
+	uint32_t span;
+	for (offset = 0; offset < size; offset += span) {
+		span = _directSpan(dest + offset, size - offset);
+		if (!_directDest(gba, dest + offset)) {
+			return false;
+		}
+	}
+	for (offset = 0; offset < size; offset += span) {
+		span = _directSpan(dest + offset, size - offset);
+		_storeDirect(gba, dest + offset, _directDest(gba, dest + offset), NULL, pattern, span);
+	}
+	return true;
+}
+
 void GBAAdjustWaitstates(struct GBA* gba, uint16_t parameters) {
 	struct GBAMemory* memory = &gba->memory;
 	struct ARMCore* cpu = gba->cpu;
@@ -1741,6 +2253,19 @@ int32_t GBAMemoryStall(struct ARMCore* cpu, int32_t wait) {
 		return wait;
 	}
 
+	if (memory->prefetchModel == GBA_PREFETCH_FAST) {
+		// Assume the prefetcher starts empty on every access instead of tracking what it already
+		// fetched. Then a full window of eight loads is either enough to cover the wait, or the
+		// wait runs past it, and the instruction's N cycle still turns into an S.
+		int32_t s = cpu->memory.activeSeqCycles16;
+		int32_t window = (s + 1) * 8;
+		if (UNLIKELY(memory->stats)) {
+			_statsFor(memory, memory->activeRegion)->prefetchHits += wait > window ? 8 : (wait + s) / (s + 1);
+		}
+		wait = wait > window ? wait - window : 0;
+		return wait - (cpu->memory.activeNonseqCycles16 - s);
+	}
+
 	int32_t previousLoads = 0;
 
 	// Don't prefetch too much if we're overlapping with a previous prefetch
@@ -1761,6 +2286,9 @@ int32_t GBAMemoryStall(struct ARMCore* cpu, int32_t wait) {
 		++loads;
 	}
 	memory->lastPrefetchedPc = cpu->gprs[ARM_PC] + WORD_SIZE_THUMB * (loads + previousLoads - 1);
+	if (UNLIKELY(memory->stats)) {
+		_statsFor(memory, memory->activeRegion)->prefetchHits += loads;
+	}
 
 	if (stall > wait) {
 		// The wait cannot take less time than the prefetch stalls
@@ -1803,9 +2331,76 @@ void GBAMemorySerialize(const struct GBAMemory* memory, struct GBASerializedStat
 	memcpy(state->iwram, memory->iwram, GBA_SIZE_IWRAM);
 }
 
+static void _stampDirtyPages(struct GBAMemory* memory) {
+	// Pages written since the last stamp get a new epoch, so any number of consumers can each be
+	// brought up to date by handling pages newer than their own epoch
+	++memory->dirtyEpoch;
+	size_t i;
+	for (i = 0; i < GBA_DIRTY_PAGES; ++i) {
+		if (memory->dirtyPages[i]) {
+			memory->dirtyPages[i] = 0;
+			memory->dirtyEpochs[i] = memory->dirtyEpoch;
+		}
+	}
+}
+
+void GBAMemorySerializeIncremental(struct GBAMemory* memory, struct GBASerializedState* state, uint32_t* epoch) {
+	_stampDirtyPages(memory);
+	size_t i;
+	for (i = 0; i < GBA_DIRTY_PAGES; ++i) {
+		if (*epoch && memory->dirtyEpochs[i] <= *epoch) {
+			continue;
+		}
+		size_t offset = i << GBA_DIRTY_PAGE_SHIFT;
+		if (i < GBA_DIRTY_IWRAM_BASE) {
+			memcpy(&state->wram[offset], &((uint8_t*) memory->wram)[offset], 1 << GBA_DIRTY_PAGE_SHIFT);
+		} else {
+			offset -= GBA_SIZE_EWRAM;
+			memcpy(&state->iwram[offset], &((uint8_t*) memory->iwram)[offset], 1 << GBA_DIRTY_PAGE_SHIFT);
+		}
+	}
+	*epoch = memory->dirtyEpoch;
+}
+
+void GBAMemoryMarkDirty(struct GBAMemory* memory) {
+	memset(memory->dirtyPages, 1, sizeof(memory->dirtyPages));
+}
+
+uint64_t GBAMemoryHashRAM(struct GBAMemory* memory, uint64_t seed) {
+	_stampDirtyPages(memory);
+	size_t i;
+	for (i = 0; i < GBA_DIRTY_PAGES; ++i) {
+		if (memory->hashEpoch && memory->dirtyEpochs[i] <= memory->hashEpoch) {
+			continue;
+		}
+		// Both RAM regions come from the same mapping, so pages can be found the same way for either
+		memory->pageHashes[i] = hash64(&((uint8_t*) memory->wram)[i << GBA_DIRTY_PAGE_SHIFT], 1 << GBA_DIRTY_PAGE_SHIFT, 0);
+	}
+	memory->hashEpoch = memory->dirtyEpoch;
+	return hash64(memory->pageHashes, sizeof(memory->pageHashes), seed);
+}
+
 void GBAMemoryDeserialize(struct GBAMemory* memory, const struct GBASerializedState* state) {
-	memcpy(memory->wram, state->wram, GBA_SIZE_EWRAM);
-	memcpy(memory->iwram, state->iwram, GBA_SIZE_IWRAM);
+	// States are often loaded over nearly identical memory, e.g. for rewind or run-ahead, so only
+	// the pages that actually differ are copied and marked dirty
+	size_t i;
+	for (i = 0; i < GBA_DIRTY_PAGES; ++i) {
+		size_t offset = i << GBA_DIRTY_PAGE_SHIFT;
+		uint8_t* page;
+		const uint8_t* saved;
+		if (i < GBA_DIRTY_IWRAM_BASE) {
+			page = &((uint8_t*) memory->wram)[offset];
+			saved = &state->wram[offset];
+		} else {
+			offset -= GBA_SIZE_EWRAM;
+			page = &((uint8_t*) memory->iwram)[offset];
+			saved = &state->iwram[offset];
+		}
+		if (memcmp(page, saved, 1 << GBA_DIRTY_PAGE_SHIFT) != 0) {
+			memcpy(page, saved, 1 << GBA_DIRTY_PAGE_SHIFT);
+			memory->dirtyPages[i] = 1;
+		}
+	}
 }
 
 void _pristineCow(struct GBA* gba) {
@@ -1813,23 +2408,49 @@ void _pristineCow(struct GBA* gba) {
 		return;
 	}
 #if !defined(FIXED_ROM_BUFFER) && !defined(__wii__)
-	void* newRom = anonymousMemoryMap(GBA_SIZE_ROM0);
-	memcpy(newRom, gba->memory.rom, gba->memory.romSize);
-	memset(((uint8_t*) newRom) + gba->memory.romSize, 0xFF, GBA_SIZE_ROM0 - gba->memory.romSize);
+	void* newRom = NULL;
+	if (gba->romImage) {
+		// Only the pages that actually get written to end up being copied
+		newRom = mROMImageMapPrivate(gba->romImage);
+	}
+	bool shared = newRom;
+	if (!shared) {
+		newRom = anonymousMemoryMap(GBA_SIZE_ROM0);
+		memcpy(newRom, gba->memory.rom, gba->memory.romSize);
+		memset(((uint8_t*) newRom) + gba->memory.romSize, 0xFF, GBA_SIZE_ROM0 - gba->memory.romSize);
+	}
 	if (gba->cpu->memory.activeRegion == gba->memory.rom) {
 		gba->cpu->memory.activeRegion = newRom;
 	}
-	if (gba->romVf) {
+	if (gba->romImage) {
+		if (!shared) {
+			mROMImageRelease(gba->romImage);
+			gba->romImage = NULL;
+		}
+	} else if (gba->romVf) {
 		gba->romVf->unmap(gba->romVf, gba->memory.rom, gba->memory.romSize);
+	}
+	if (gba->romVf) {
 		gba->romVf->close(gba->romVf);
 		gba->romVf = NULL;
 	}
 	gba->memory.rom = newRom;
 	gba->memory.hw.gpioBase = &((uint16_t*) gba->memory.rom)[GPIO_REG_DATA >> 1];
+	GBAMemoryUpdatePages(gba);
 #endif
 	gba->isPristine = false;
 }
 
+void _extendRom(struct GBA* gba, size_t romSize) {
+	if (gba->romImage) {
+		// Private mappings of a shared image read as zero past the end of the ROM
+		memset(&((uint8_t*) gba->memory.rom)[gba->memory.romSize], 0xFF, romSize - gba->memory.romSize);
+	}
+	gba->memory.romSize = romSize;
+	gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
+	GBAMemoryUpdatePages(gba);
+}
+
 void GBAPrintFlush(struct GBA* gba) {
 	if (!gba->memory.agbPrintBuffer) {
 		return;
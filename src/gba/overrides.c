@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gba/overrides.h>
 
+#include <mgba/core/library.h>
 #include <mgba/internal/gba/gba.h>
 #include <mgba/internal/gba/cart/ereader.h>
 #include <mgba/internal/gba/cart/gpio.h>
@@ -438,3 +439,70 @@ void GBAOverrideApplyDefaults(struct GBA* gba, const struct Configuration* overr
 		}
 	}
 }
+
+#ifdef USE_SQLITE3
+bool GBAOverrideLoadIdleLoop(struct GBA* gba, struct mLibrary* library) {
+	if (!gba->memory.rom || gba->idleLoop != IDLE_LOOP_NONE || gba->idleOptimization == IDLE_LOOP_IGNORE) {
+		return false;
+	}
+	struct mLibraryIdleLoop loop;
+	if (!mLibraryFindIdleLoop(library, mPLATFORM_GBA, gba->romCrc32, &loop)) {
+		return false;
+	}
+	gba->idleLoop = loop.address;
+	if (gba->idleOptimization == IDLE_LOOP_DETECT) {
+		gba->idleOptimization = IDLE_LOOP_REMOVE;
+	}
+	return true;
+}
+
+void GBAOverrideSaveIdleLoop(struct GBA* gba, struct mLibrary* library) {
+	if (!gba->idleLoopDetected || gba->idleLoop == IDLE_LOOP_NONE) {
+		return;
+	}
+	struct mLibraryIdleLoop loop = {
+		.platform = mPLATFORM_GBA,
+		.crc32 = gba->romCrc32,
+		.address = gba->idleLoop,
+	};
+	GBAGetGameCode(gba, loop.internalCode);
+	mLibraryAddIdleLoop(library, &loop);
+	// Only count each session once
+	gba->idleLoopDetected = false;
+}
+
+size_t GBAOverrideExportIdleLoops(struct Configuration* config, struct mLibrary* library, unsigned minConfidence) {
+	struct mLibraryIdleLoopList loops;
+	mLibraryIdleLoopListInit(&loops, 0);
+	mLibraryGetIdleLoops(library, &loops, minConfidence);
+
+	size_t written = 0;
+	size_t i = 0;
+	while (i < mLibraryIdleLoopListSize(&loops)) {
+		const struct mLibraryIdleLoop* loop = mLibraryIdleLoopListGetConstPointer(&loops, i);
+		bool agree = true;
+		size_t j;
+		// Loops come back sorted by game code, so revisions of the same game are next to each other
+		for (j = i + 1; j < mLibraryIdleLoopListSize(&loops); ++j) {
+			const struct mLibraryIdleLoop* next = mLibraryIdleLoopListGetConstPointer(&loops, j);
+			if (strcmp(next->internalCode, loop->internalCode) != 0) {
+				break;
+			}
+			if (next->platform == mPLATFORM_GBA && next->address != loop->address) {
+				agree = false;
+			}
+		}
+		if (agree && loop->platform == mPLATFORM_GBA && strncmp(loop->internalCode, "AGB-", 4) == 0 && loop->internalCode[4]) {
+			char sectionName[16];
+			char address[9];
+			snprintf(sectionName, sizeof(sectionName), "override.%.4s", &loop->internalCode[4]);
+			snprintf(address, sizeof(address), "%08X", loop->address);
+			ConfigurationSetValue(config, sectionName, "idleLoop", address);
+			++written;
+		}
+		i = j;
+	}
+	mLibraryIdleLoopListDeinit(&loops);
+	return written;
+}
+#endif
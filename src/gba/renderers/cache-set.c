@@ -71,6 +71,14 @@ void GBAVideoCacheAssociate(struct mCacheSet* cache, struct GBAVideo* video) {
 	GBAVideoCacheWriteVideoRegister(cache, GBA_REG_BG3CNT, video->p->memory.io[GBA_REG(BG3CNT)]);
 }
 
+void GBAVideoCacheResync(struct mCacheSet* cache, const uint16_t* palette) {
+	mCacheSetWriteVRAMRange(cache, 0, GBA_SIZE_VRAM);
+	size_t i;
+	for (i = 0; i < GBA_SIZE_PALETTE_RAM / 2; ++i) {
+		mCacheSetWritePalette(cache, i, mColorFrom555(palette[i]));
+	}
+}
+
 static void mapParser0(struct mMapCache* cache, struct mMapCacheEntry* entry, void* vram) {
 	uint16_t map = *(uint16_t*) vram;
 	entry->tileId = GBA_TEXT_MAP_TILE(map);
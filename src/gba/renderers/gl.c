@@ -8,16 +8,23 @@
 #ifdef BUILD_GLES3
 
 #include <mgba/core/cache-set.h>
+#include <mgba/core/perf.h>
 #include <mgba/internal/arm/macros.h>
 #include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/memory.h>
 #include <mgba/internal/gba/renderers/cache-set.h>
+#include <mgba-util/crc32.h>
+#include <mgba-util/math.h>
 #include <mgba-util/memory.h>
+#include <mgba-util/vfs.h>
 
 static void GBAVideoGLRendererInit(struct GBAVideoRenderer* renderer);
 static void GBAVideoGLRendererDeinit(struct GBAVideoRenderer* renderer);
 static void GBAVideoGLRendererReset(struct GBAVideoRenderer* renderer);
 static void GBAVideoGLRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address);
 static void GBAVideoGLRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam);
+static void GBAVideoGLRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t length);
+static void GBAVideoGLRendererWriteOAMRange(struct GBAVideoRenderer* renderer, uint32_t oam, uint32_t count);
 static void GBAVideoGLRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 static uint16_t GBAVideoGLRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 static void GBAVideoGLRendererDrawScanline(struct GBAVideoRenderer* renderer, int y);
@@ -47,6 +54,9 @@ static void _finalizeLayers(struct GBAVideoGLRenderer* renderer);
 
 #define TEST_LAYER_ENABLED(X) !glRenderer->d.disableBG[X] && glRenderer->bg[X].enabled == 4
 
+// VRAM uploads are staged through a ring this large before being orphaned
+#define VRAM_BUFFER_SIZE (GBA_SIZE_VRAM * 4)
+
 struct GBAVideoGLUniform {
 	const char* name;
 	int type;
@@ -651,6 +661,8 @@ void GBAVideoGLRendererCreate(struct GBAVideoGLRenderer* renderer) {
 	renderer->d.writeVideoRegister = GBAVideoGLRendererWriteVideoRegister;
 	renderer->d.writeVRAM = GBAVideoGLRendererWriteVRAM;
 	renderer->d.writeOAM = GBAVideoGLRendererWriteOAM;
+	renderer->d.writeVRAMRange = GBAVideoGLRendererWriteVRAMRange;
+	renderer->d.writeOAMRange = GBAVideoGLRendererWriteOAMRange;
 	renderer->d.writePalette = GBAVideoGLRendererWritePalette;
 	renderer->d.drawScanline = GBAVideoGLRendererDrawScanline;
 	renderer->d.finishFrame = GBAVideoGLRendererFinishFrame;
@@ -675,27 +687,122 @@ void GBAVideoGLRendererCreate(struct GBAVideoGLRenderer* renderer) {
 	renderer->d.highlightAmount = 0;
 
 	renderer->scale = 1;
+	renderer->shaderCache = NULL;
+}
+
+struct GBAVideoGLProgramCache {
+	struct VDir* dir;
+	// Covers the driver and everything shared by all programs; each program adds its own source
+	uint32_t seed;
+};
+
+static bool _loadProgramBinary(const struct GBAVideoGLProgramCache* cache, GLuint program, uint32_t key) {
+	if (!cache->dir) {
+		return false;
+	}
+	char name[16];
+	snprintf(name, sizeof(name), "%08X.bin", key);
+	struct VFile* vf = cache->dir->openFile(cache->dir, name, O_RDONLY);
+	if (!vf) {
+		return false;
+	}
+	ssize_t size = vf->size(vf) - (ssize_t) sizeof(uint32_t);
+	uint32_t format;
+	void* binary = NULL;
+	if (size > 0 && vf->read(vf, &format, sizeof(format)) == sizeof(format)) {
+		binary = malloc(size);
+		if (vf->read(vf, binary, size) != size) {
+			free(binary);
+			binary = NULL;
+		}
+	}
+	vf->close(vf);
+	if (!binary) {
+		return false;
+	}
+	glProgramBinary(program, format, binary, size);
+	free(binary);
+
+	// Drivers reject binaries from other versions of themselves, in which case this is a cache miss
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	return linked == GL_TRUE;
+}
+
+static void _saveProgramBinary(const struct GBAVideoGLProgramCache* cache, GLuint program, uint32_t key) {
+	GLint size = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size <= 0) {
+		return;
+	}
+	void* binary = malloc(size);
+	GLsizei length = 0;
+	GLenum format = 0;
+	glGetProgramBinary(program, size, &length, &format, binary);
+	if (length > 0) {
+		char name[16];
+		snprintf(name, sizeof(name), "%08X.bin", key);
+		struct VFile* vf = cache->dir->openFile(cache->dir, name, O_CREAT | O_TRUNC | O_WRONLY);
+		if (vf) {
+			uint32_t format32 = format;
+			vf->write(vf, &format32, sizeof(format32));
+			vf->write(vf, binary, length);
+			vf->close(vf);
+		}
+	}
+	free(binary);
 }
 
-static void _compileShader(struct GBAVideoGLRenderer* glRenderer, struct GBAVideoGLShader* shader, const char** shaderBuffer, int shaderBufferLines, GLuint vs, const struct GBAVideoGLUniform* uniforms, char* log) {
+static GLuint _compileVertexShader(const GLchar* header, char* log) {
+	const GLchar* shaderBuffer[] = { header, _vertexShader };
+	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vs, 2, shaderBuffer, 0);
+	glCompileShader(vs);
+	glGetShaderInfoLog(vs, 2048, 0, log);
+	if (log[0]) {
+		mLOG(GBA_VIDEO, ERROR, "Vertex shader compilation failure: %s", log);
+	}
+	return vs;
+}
+
+static void _compileShader(struct GBAVideoGLRenderer* glRenderer, struct GBAVideoGLShader* shader, const char** shaderBuffer, int shaderBufferLines, GLuint* vs, const struct GBAVideoGLProgramCache* cache, const struct GBAVideoGLUniform* uniforms, char* log) {
 	GLuint program = glCreateProgram();
 	shader->program = program;
 
-	GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-	glAttachShader(program, vs);
-	glAttachShader(program, fs);
-	glShaderSource(fs, shaderBufferLines, shaderBuffer, 0);
-	glCompileShader(fs);
-	glGetShaderInfoLog(fs, 2048, 0, log);
-	if (log[0]) {
-		mLOG(GBA_VIDEO, ERROR, "Fragment shader compilation failure: %s", log);
+	uint32_t key = cache->seed;
+	int i;
+	for (i = 0; i < shaderBufferLines; ++i) {
+		key = crc32(key, (const uint8_t*) shaderBuffer[i], strlen(shaderBuffer[i]));
 	}
-	glLinkProgram(program);
-	glGetProgramInfoLog(program, 2048, 0, log);
-	if (log[0]) {
-		mLOG(GBA_VIDEO, ERROR, "Program link failure: %s", log);
+	if (!_loadProgramBinary(cache, program, key)) {
+		// The vertex shader is only needed if something has to be compiled
+		if (!*vs) {
+			*vs = _compileVertexShader(shaderBuffer[0], log);
+		}
+		GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+		glAttachShader(program, *vs);
+		glAttachShader(program, fs);
+		glShaderSource(fs, shaderBufferLines, shaderBuffer, 0);
+		glCompileShader(fs);
+		glGetShaderInfoLog(fs, 2048, 0, log);
+		if (log[0]) {
+			mLOG(GBA_VIDEO, ERROR, "Fragment shader compilation failure: %s", log);
+		}
+		if (cache->dir) {
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+		glLinkProgram(program);
+		glGetProgramInfoLog(program, 2048, 0, log);
+		if (log[0]) {
+			mLOG(GBA_VIDEO, ERROR, "Program link failure: %s", log);
+		}
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (linked == GL_TRUE && cache->dir) {
+			_saveProgramBinary(cache, program, key);
+		}
+		glDeleteShader(fs);
 	}
-	glDeleteShader(fs);
 
 	glGenVertexArrays(1, &shader->vao);
 	glBindVertexArray(shader->vao);
@@ -704,7 +811,6 @@ static void _compileShader(struct GBAVideoGLRenderer* glRenderer, struct GBAVide
 	glEnableVertexAttribArray(positionLocation);
 	glVertexAttribPointer(positionLocation, 2, GL_INT, GL_FALSE, 0, NULL);
 
-	size_t i;
 	for (i = 0; uniforms[i].name; ++i) {
 		shader->uniforms[uniforms[i].type] = glGetUniformLocation(program, uniforms[i].name);
 	}
@@ -768,6 +874,12 @@ void GBAVideoGLRendererInit(struct GBAVideoRenderer* renderer) {
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, 256, 192, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, 0);
 
+	glGenBuffers(1, &glRenderer->vramBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, glRenderer->vramBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, VRAM_BUFFER_SIZE, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glRenderer->vramBufferOffset = 0;
+
 	glGenTextures(1, &glRenderer->paletteTex);
 	glBindTexture(GL_TEXTURE_2D, glRenderer->paletteTex);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -797,58 +909,72 @@ void GBAVideoGLRendererInit(struct GBAVideoRenderer* renderer) {
 		shaderBuffer[0] = _gles3Header;
 	}
 
-	GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-	shaderBuffer[1] = _vertexShader;
-	glShaderSource(vs, 2, shaderBuffer, 0);
-	glCompileShader(vs);
-	glGetShaderInfoLog(vs, 2048, 0, log);
-	if (log[0]) {
-		mLOG(GBA_VIDEO, ERROR, "Vertex shader compilation failure: %s", log);
+	GLuint vs = 0;
+	struct GBAVideoGLProgramCache cache = {
+		.dir = glRenderer->shaderCache,
+	};
+	GLint binaryFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+	if (binaryFormats <= 0) {
+		cache.dir = NULL;
+	}
+	if (cache.dir) {
+		static const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+		for (i = 0; i < 3; ++i) {
+			const char* string = (const char*) glGetString(strings[i]);
+			if (string) {
+				cache.seed = crc32(cache.seed, (const uint8_t*) string, strlen(string));
+			}
+		}
+		cache.seed = crc32(cache.seed, (const uint8_t*) _vertexShader, strlen(_vertexShader));
 	}
 	shaderBuffer[1] = _renderMode0;
 
 	shaderBuffer[2] = _renderTile16;
-	_compileShader(glRenderer, &glRenderer->bgShader[0], shaderBuffer, 3, vs, _uniformsMode0, log);
+	_compileShader(glRenderer, &glRenderer->bgShader[0], shaderBuffer, 3, &vs, &cache, _uniformsMode0, log);
 
 	shaderBuffer[2] = _renderTile256;
-	_compileShader(glRenderer, &glRenderer->bgShader[1], shaderBuffer, 3, vs, _uniformsMode0, log);
+	_compileShader(glRenderer, &glRenderer->bgShader[1], shaderBuffer, 3, &vs, &cache, _uniformsMode0, log);
 
 	shaderBuffer[1] = _renderMode2;
 	shaderBuffer[2] = _interpolate;
 
 	shaderBuffer[3] = _fetchTileOverflow;
-	_compileShader(glRenderer, &glRenderer->bgShader[2], shaderBuffer, 4, vs, _uniformsMode2, log);
+	_compileShader(glRenderer, &glRenderer->bgShader[2], shaderBuffer, 4, &vs, &cache, _uniformsMode2, log);
 
 	shaderBuffer[3] = _fetchTileNoOverflow;
-	_compileShader(glRenderer, &glRenderer->bgShader[3], shaderBuffer, 4, vs, _uniformsMode2, log);
+	_compileShader(glRenderer, &glRenderer->bgShader[3], shaderBuffer, 4, &vs, &cache, _uniformsMode2, log);
 
 	shaderBuffer[1] = _renderMode4;
 	shaderBuffer[2] = _interpolate;
-	_compileShader(glRenderer, &glRenderer->bgShader[4], shaderBuffer, 3, vs, _uniformsMode4, log);
+	_compileShader(glRenderer, &glRenderer->bgShader[4], shaderBuffer, 3, &vs, &cache, _uniformsMode4, log);
 
 	shaderBuffer[1] = _renderMode35;
 	shaderBuffer[2] = _interpolate;
-	_compileShader(glRenderer, &glRenderer->bgShader[5], shaderBuffer, 3, vs, _uniformsMode35, log);
+	_compileShader(glRenderer, &glRenderer->bgShader[5], shaderBuffer, 3, &vs, &cache, _uniformsMode35, log);
 
 	shaderBuffer[1] = _renderObj;
 
 	shaderBuffer[2] = _renderTile16;
-	_compileShader(glRenderer, &glRenderer->objShader[0], shaderBuffer, 3, vs, _uniformsObj, log);
+	_compileShader(glRenderer, &glRenderer->objShader[0], shaderBuffer, 3, &vs, &cache, _uniformsObj, log);
 
 	shaderBuffer[2] = _renderTile256;
-	_compileShader(glRenderer, &glRenderer->objShader[1], shaderBuffer, 3, vs, _uniformsObj, log);
+	_compileShader(glRenderer, &glRenderer->objShader[1], shaderBuffer, 3, &vs, &cache, _uniformsObj, log);
 
 	shaderBuffer[1] = _renderObjPriority;
-	_compileShader(glRenderer, &glRenderer->objShader[2], shaderBuffer, 2, vs, _uniformsObjPriority, log);
+	_compileShader(glRenderer, &glRenderer->objShader[2], shaderBuffer, 2, &vs, &cache, _uniformsObjPriority, log);
 
 	shaderBuffer[1] = _renderWindow;
-	_compileShader(glRenderer, &glRenderer->windowShader, shaderBuffer, 2, vs, _uniformsWindow, log);
+	_compileShader(glRenderer, &glRenderer->windowShader, shaderBuffer, 2, &vs, &cache, _uniformsWindow, log);
 
 	shaderBuffer[1] = _finalize;
-	_compileShader(glRenderer, &glRenderer->finalizeShader, shaderBuffer, 2, vs, _uniformsFinalize, log);
+	_compileShader(glRenderer, &glRenderer->finalizeShader, shaderBuffer, 2, &vs, &cache, _uniformsFinalize, log);
 
 	glBindVertexArray(0);
-	glDeleteShader(vs);
+	if (vs) {
+		glDeleteShader(vs);
+	}
+	mStartupTraceMark("Initialize GL renderer");
 
 	GBAVideoGLRendererReset(renderer);
 }
@@ -861,6 +987,7 @@ void GBAVideoGLRendererDeinit(struct GBAVideoRenderer* renderer) {
 	glDeleteFramebuffers(GBA_GL_FBO_MAX, glRenderer->fbo);
 	glDeleteTextures(GBA_GL_TEX_MAX, glRenderer->layers);
 	glDeleteTextures(1, &glRenderer->vramTex);
+	glDeleteBuffers(1, &glRenderer->vramBuffer);
 	glDeleteTextures(1, &glRenderer->paletteTex);
 	glDeleteBuffers(1, &glRenderer->vbo);
 
@@ -940,6 +1067,9 @@ void GBAVideoGLRendererReset(struct GBAVideoRenderer* renderer) {
 		int b = M_B5(glRenderer->d.palette[i]);
 		glRenderer->shadowPalette[0][i] = (r << 11) | (g << 5) | b;
 	}
+	if (renderer->cache) {
+		GBAVideoCacheResync(renderer->cache, renderer->palette);
+	}
 }
 
 void GBAVideoGLRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address) {
@@ -956,6 +1086,24 @@ void GBAVideoGLRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam)
 	glRenderer->oamDirty = true;
 }
 
+void GBAVideoGLRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t length) {
+	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
+	if (renderer->cache) {
+		mCacheSetWriteVRAMRange(renderer->cache, address, length);
+	}
+	uint32_t block;
+	for (block = address >> 12; block <= (address + length - 1) >> 12; ++block) {
+		glRenderer->vramDirty |= 1 << block;
+	}
+}
+
+void GBAVideoGLRendererWriteOAMRange(struct GBAVideoRenderer* renderer, uint32_t oam, uint32_t count) {
+	UNUSED(oam);
+	UNUSED(count);
+	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
+	glRenderer->oamDirty = true;
+}
+
 void GBAVideoGLRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
 	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
 	if (renderer->cache) {
@@ -1260,6 +1408,35 @@ static bool _dirtyMode45(struct GBAVideoGLRenderer* renderer, struct GBAVideoGLB
 	return false;
 }
 
+static void _uploadVram(struct GBAVideoGLRenderer* renderer) {
+	// Everything between the first and last dirty blocks goes up in one call, since copying the
+	// clean blocks in between is cheaper than issuing separate uploads for each run
+	int first = ctz32(renderer->vramDirty);
+	int last = 31 - clz32(renderer->vramDirty);
+	size_t size = (last + 1 - first) * 0x1000;
+	const uint16_t* vram = &renderer->d.vram[2048 * first];
+	renderer->vramDirty = 0;
+
+	glBindTexture(GL_TEXTURE_2D, renderer->vramTex);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, renderer->vramBuffer);
+	if (renderer->vramBufferOffset + size > VRAM_BUFFER_SIZE) {
+		// Orphaning the buffer lets the driver hand back fresh storage instead of waiting for pending uploads
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, VRAM_BUFFER_SIZE, NULL, GL_STREAM_DRAW);
+		renderer->vramBufferOffset = 0;
+	}
+	void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, renderer->vramBufferOffset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (staging) {
+		memcpy(staging, vram, size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 8 * first, 256, 8 * (last + 1 - first), GL_RED_INTEGER, GL_UNSIGNED_SHORT, (const GLvoid*) (uintptr_t) renderer->vramBufferOffset);
+		renderer->vramBufferOffset += size;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	} else {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 8 * first, 256, 8 * (last + 1 - first), GL_RED_INTEGER, GL_UNSIGNED_SHORT, vram);
+	}
+}
+
 static bool _needsVramUpload(struct GBAVideoGLRenderer* renderer, int y) {
 	if (!renderer->vramDirty) {
 		return false;
@@ -1378,19 +1555,7 @@ void GBAVideoGLRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
 	}
 
 	if (_needsVramUpload(glRenderer, y)) {
-		int first = -1;
-		glBindTexture(GL_TEXTURE_2D, glRenderer->vramTex);
-		for (i = 0; i < 25; ++i) {
-			if (!(glRenderer->vramDirty & (1 << i))) {
-				if (first >= 0) {
-					glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 8 * first, 256, 8 * (i - first), GL_RED_INTEGER, GL_UNSIGNED_SHORT, &glRenderer->d.vram[2048 * first]);
-					first = -1;
-				}
-			} else if (first < 0) {
-				first = i;
-			}
-		}
-		glRenderer->vramDirty = 0;
+		_uploadVram(glRenderer);
 	}
 
 	if (glRenderer->oamDirty) {
@@ -1536,6 +1701,7 @@ void GBAVideoGLRendererFinishFrame(struct GBAVideoRenderer* renderer) {
 	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
 	_drawScanlines(glRenderer, GBA_VIDEO_VERTICAL_PIXELS - 1);
 	_finalizeLayers(glRenderer);
+	memset(glRenderer->d.changedScanlines, 0xFF, sizeof(glRenderer->d.changedScanlines));
 	glDisable(GL_SCISSOR_TEST);
 	glBindVertexArray(0);
 	glRenderer->firstAffine = -1;
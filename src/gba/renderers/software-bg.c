@@ -17,6 +17,57 @@
 	localX = x; \
 	localY = y;
 
+#define BACKGROUND_BITMAP_IS_ROW (background->dx == 0x100 && !background->dy && !mosaicH)
+
+// Unrotated, unscaled lines without horizontal mosaic read one row of the bitmap from left to right,
+// so the visible span can be clipped once instead of checking each pixel
+#define BACKGROUND_BITMAP_ROW(W, H) \
+	int rowX = (x >> 8) + 1; \
+	int rowY = y >> 8; \
+	int rowStart = renderer->start; \
+	int rowEnd = renderer->end; \
+	if (y < 0 || rowY >= H) { \
+		return; \
+	} \
+	if (rowX < 0) { \
+		rowStart -= rowX; \
+		rowX = 0; \
+	} \
+	if (rowEnd - rowStart > W - rowX) { \
+		rowEnd = rowStart + W - rowX; \
+	}
+
+#define COMPOSITE_BITMAP_555(COLOR) \
+	uint32_t current = *pixel; \
+	if (!objwinSlowPath || (!(current & FLAG_OBJWIN)) != objwinOnly) { \
+		unsigned mergedFlags = flags; \
+		if (current & FLAG_OBJWIN) { \
+			mergedFlags = objwinFlags; \
+		} \
+		if (!variant) { \
+			_compositeBlendObjwin(renderer, pixel, (COLOR) | mergedFlags, current); \
+		} else if (renderer->blendEffect == BLEND_BRIGHTEN) { \
+			_compositeBlendObjwin(renderer, pixel, _brighten((COLOR), renderer->bldy) | mergedFlags, current); \
+		} else if (renderer->blendEffect == BLEND_DARKEN) { \
+			_compositeBlendObjwin(renderer, pixel, _darken((COLOR), renderer->bldy) | mergedFlags, current); \
+		} \
+	}
+
+#define COMPOSITE_BITMAP_256(COLOR) \
+	uint32_t current = *pixel; \
+	if ((COLOR) && IS_WRITABLE(current)) { \
+		if (!objwinSlowPath) { \
+			_compositeBlendNoObjwin(renderer, pixel, palette[(COLOR)] | flags, current); \
+		} else if (objwinForceEnable || (!(current & FLAG_OBJWIN)) == objwinOnly) { \
+			color_t* currentPalette = (current & FLAG_OBJWIN) ? objwinPalette : palette; \
+			unsigned mergedFlags = flags; \
+			if (current & FLAG_OBJWIN) { \
+				mergedFlags = objwinFlags; \
+			} \
+			_compositeBlendObjwin(renderer, pixel, currentPalette[(COLOR)] | mergedFlags, current); \
+		} \
+	}
+
 #define MODE_2_COORD_OVERFLOW \
 	localX = x & (sizeAdjusted - 1); \
 	localY = y & (sizeAdjusted - 1); \
@@ -28,11 +79,25 @@
 	localX = x; \
 	localY = y;
 
+#define MODE_2_COORD_X_OVERFLOW \
+	localX = x & (sizeAdjusted - 1);
+
+#define MODE_2_COORD_X_NO_OVERFLOW \
+	if (x & ~(sizeAdjusted - 1)) { \
+		continue; \
+	} \
+	localX = x;
+
 #define MODE_2_NO_MOSAIC(COORD) \
 	COORD \
 	mapData = screenBase[(localX >> 11) + (((localY >> 7) & 0x7F0) << background->size)]; \
 	pixelData = charBase[(mapData << 6) + ((localY & 0x700) >> 5) + ((localX & 0x700) >> 8)];
 
+#define MODE_2_ROW(COORD) \
+	COORD \
+	mapData = screenRow[localX >> 11]; \
+	pixelData = charRow[(mapData << 6) + ((localX & 0x700) >> 8)];
+
 #define MODE_2_MOSAIC(COORD) \
 		if (!mosaicWait) { \
 			MODE_2_NO_MOSAIC(COORD) \
@@ -54,7 +119,22 @@
 	}
 
 #define DRAW_BACKGROUND_MODE_2(BLEND, OBJWIN) \
-	if (background->overflow) { \
+	if (!background->dy && mosaicH <= 1) { \
+		/* Unrotated lines stay on one row of the map, so only the X coordinate needs to be stepped */ \
+		localY = y; \
+		if (background->overflow) { \
+			localY &= sizeAdjusted - 1; \
+		} \
+		if (!(localY & ~(sizeAdjusted - 1))) { \
+			const uint8_t* screenRow = &screenBase[((localY >> 7) & 0x7F0) << background->size]; \
+			const uint8_t* charRow = &charBase[(localY & 0x700) >> 5]; \
+			if (background->overflow) { \
+				MODE_2_LOOP(MODE_2_ROW, MODE_2_COORD_X_OVERFLOW, BLEND, OBJWIN); \
+			} else { \
+				MODE_2_LOOP(MODE_2_ROW, MODE_2_COORD_X_NO_OVERFLOW, BLEND, OBJWIN); \
+			} \
+		} \
+	} else if (background->overflow) { \
 		if (mosaicH > 1) { \
 			localX &= sizeAdjusted - 1; \
 			localY &= sizeAdjusted - 1; \
@@ -107,39 +187,43 @@ void GBAVideoSoftwareRendererDrawBackgroundMode2(struct GBAVideoSoftwareRenderer
 void GBAVideoSoftwareRendererDrawBackgroundMode3(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background, int inY) {
 	BACKGROUND_BITMAP_INIT;
 
+	int outX;
+	uint32_t* pixel;
+	if (BACKGROUND_BITMAP_IS_ROW) {
+		BACKGROUND_BITMAP_ROW(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
+		// Convert the whole span first, so the conversion loop can be vectorized
+		color_t colors[GBA_VIDEO_HORIZONTAL_PIXELS];
+		const uint16_t* row = &renderer->d.vram[rowX + rowY * GBA_VIDEO_HORIZONTAL_PIXELS];
+		int i;
+		for (i = 0; i < rowEnd - rowStart; ++i) {
+			uint16_t color;
+			LOAD_16(color, i << 1, row);
+			colors[i] = _colorFrom555(renderer, color);
+		}
+		for (outX = rowStart, pixel = &renderer->row[outX]; outX < rowEnd; ++outX, ++pixel) {
+			COMPOSITE_BITMAP_555(colors[outX - rowStart]);
+		}
+		return;
+	}
+
 	uint32_t color = renderer->normalPalette[0];
 	if (mosaicWait && localX >= 0 && localY >= 0 && (localX >> 8) < GBA_VIDEO_HORIZONTAL_PIXELS && (localY >> 8) < GBA_VIDEO_VERTICAL_PIXELS) {
 		LOAD_16(color, ((localX >> 8) + (localY >> 8) * GBA_VIDEO_HORIZONTAL_PIXELS) << 1, renderer->d.vram);
-		color = mColorFrom555(color);
+		color = _colorFrom555(renderer, color);
 	}
 
-	int outX;
-	uint32_t* pixel;
 	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) {
 		BACKGROUND_BITMAP_ITERATE(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
 
 		if (!mosaicWait) {
 			LOAD_16(color, ((localX >> 8) + (localY >> 8) * GBA_VIDEO_HORIZONTAL_PIXELS) << 1, renderer->d.vram);
-			color = mColorFrom555(color);
+			color = _colorFrom555(renderer, color);
 			mosaicWait = mosaicH;
 		} else {
 			--mosaicWait;
 		}
 
-		uint32_t current = *pixel;
-		if (!objwinSlowPath || (!(current & FLAG_OBJWIN)) != objwinOnly) {
-			unsigned mergedFlags = flags;
-			if (current & FLAG_OBJWIN) {
-				mergedFlags = objwinFlags;
-			}
-			if (!variant) {
-				_compositeBlendObjwin(renderer, pixel, color | mergedFlags, current);
-			} else if (renderer->blendEffect == BLEND_BRIGHTEN) {
-				_compositeBlendObjwin(renderer, pixel, _brighten(color, renderer->bldy) | mergedFlags, current);
-			} else if (renderer->blendEffect == BLEND_DARKEN) {
-				_compositeBlendObjwin(renderer, pixel, _darken(color, renderer->bldy) | mergedFlags, current);
-			}
-		}
+		COMPOSITE_BITMAP_555(color);
 	}
 }
 
@@ -151,12 +235,23 @@ void GBAVideoSoftwareRendererDrawBackgroundMode4(struct GBAVideoSoftwareRenderer
 	if (GBARegisterDISPCNTIsFrameSelect(renderer->dispcnt)) {
 		offset = 0xA000;
 	}
+
+	int outX;
+	uint32_t* pixel;
+	if (BACKGROUND_BITMAP_IS_ROW) {
+		BACKGROUND_BITMAP_ROW(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
+		const uint8_t* row = &((uint8_t*) renderer->d.vram)[offset + rowX + rowY * GBA_VIDEO_HORIZONTAL_PIXELS];
+		for (outX = rowStart, pixel = &renderer->row[outX]; outX < rowEnd; ++outX, ++pixel) {
+			color = row[outX - rowStart];
+			COMPOSITE_BITMAP_256(color);
+		}
+		return;
+	}
+
 	if (mosaicWait && localX >= 0 && localY >= 0 && (localX >> 8) < GBA_VIDEO_HORIZONTAL_PIXELS && (localY >> 8) < GBA_VIDEO_VERTICAL_PIXELS) {
 		color = ((uint8_t*)renderer->d.vram)[offset + (localX >> 8) + (localY >> 8) * GBA_VIDEO_HORIZONTAL_PIXELS];
 	}
 
-	int outX;
-	uint32_t* pixel;
 	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) {
 		BACKGROUND_BITMAP_ITERATE(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
 
@@ -168,61 +263,53 @@ void GBAVideoSoftwareRendererDrawBackgroundMode4(struct GBAVideoSoftwareRenderer
 			--mosaicWait;
 		}
 
-		uint32_t current = *pixel;
-		if (color && IS_WRITABLE(current)) {
-			if (!objwinSlowPath) {
-				_compositeBlendNoObjwin(renderer, pixel, palette[color] | flags, current);
-			} else if (objwinForceEnable || (!(current & FLAG_OBJWIN)) == objwinOnly) {
-				color_t* currentPalette = (current & FLAG_OBJWIN) ? objwinPalette : palette;
-				unsigned mergedFlags = flags;
-				if (current & FLAG_OBJWIN) {
-					mergedFlags = objwinFlags;
-				}
-				_compositeBlendObjwin(renderer, pixel, currentPalette[color] | mergedFlags, current);
-			}
-		}
+		COMPOSITE_BITMAP_256(color);
 	}
 }
 
 void GBAVideoSoftwareRendererDrawBackgroundMode5(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background, int inY) {
 	BACKGROUND_BITMAP_INIT;
 
-	uint32_t color = renderer->normalPalette[0];
 	uint32_t offset = 0;
 	if (GBARegisterDISPCNTIsFrameSelect(renderer->dispcnt)) {
 		offset = 0xA000;
 	}
+
+	int outX;
+	uint32_t* pixel;
+	if (BACKGROUND_BITMAP_IS_ROW) {
+		BACKGROUND_BITMAP_ROW(160, 128);
+		color_t colors[160];
+		const uint16_t* row = &renderer->d.vram[(offset >> 1) + rowX + rowY * 160];
+		int i;
+		for (i = 0; i < rowEnd - rowStart; ++i) {
+			uint16_t color;
+			LOAD_16(color, i << 1, row);
+			colors[i] = _colorFrom555(renderer, color);
+		}
+		for (outX = rowStart, pixel = &renderer->row[outX]; outX < rowEnd; ++outX, ++pixel) {
+			COMPOSITE_BITMAP_555(colors[outX - rowStart]);
+		}
+		return;
+	}
+
+	uint32_t color = renderer->normalPalette[0];
 	if (mosaicWait && localX >= 0 && localY >= 0 && (localX >> 8) < 160 && (localY >> 8) < 128) {
 		LOAD_16(color, offset + (localX >> 8) * 2 + (localY >> 8) * 320, renderer->d.vram);
-		color = mColorFrom555(color);
+		color = _colorFrom555(renderer, color);
 	}
 
-	int outX;
-	uint32_t* pixel;
 	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) {
 		BACKGROUND_BITMAP_ITERATE(160, 128);
 
 		if (!mosaicWait) {
 			LOAD_16(color, offset + (localX >> 8) * 2 + (localY >> 8) * 320, renderer->d.vram);
-			color = mColorFrom555(color);
+			color = _colorFrom555(renderer, color);
 			mosaicWait = mosaicH;
 		} else {
 			--mosaicWait;
 		}
 
-		uint32_t current = *pixel;
-		if (!objwinSlowPath || (!(current & FLAG_OBJWIN)) != objwinOnly) {
-			unsigned mergedFlags = flags;
-			if (current & FLAG_OBJWIN) {
-				mergedFlags = objwinFlags;
-			}
-			if (!variant) {
-				_compositeBlendObjwin(renderer, pixel, color | mergedFlags, current);
-			} else if (renderer->blendEffect == BLEND_BRIGHTEN) {
-				_compositeBlendObjwin(renderer, pixel, _brighten(color, renderer->bldy) | mergedFlags, current);
-			} else if (renderer->blendEffect == BLEND_DARKEN) {
-				_compositeBlendObjwin(renderer, pixel, _darken(color, renderer->bldy) | mergedFlags, current);
-			}
-		}
+		COMPOSITE_BITMAP_555(color);
 	}
 }
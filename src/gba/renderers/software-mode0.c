@@ -280,41 +280,29 @@
 			pixel += 8; \
 			continue; \
 		} \
+		uint32_t tileData2; \
 		if (!GBA_TEXT_MAP_HFLIP(mapData)) { \
 			LOAD_32(tileData, charBase, vram); \
-			if (tileData) { \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
-			} \
-			pixel += 4; \
-			LOAD_32(tileData, charBase + 4, vram); \
-			if (tileData) { \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
-					BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
-			} \
-			pixel += 4; \
+			LOAD_32(tileData2, charBase + 4, vram); \
 		} else { \
-			LOAD_32(tileData, charBase + 4, vram); \
-			if (tileData) { \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-			} \
-			pixel += 4; \
-			LOAD_32(tileData, charBase, vram); \
-			if (tileData) { \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
-				BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
-			} \
-			pixel += 4; \
+			/* Swapping the bytes lets flipped tiles share the unflipped path */ \
+			LOAD_32BE(tileData, charBase + 4, vram); \
+			LOAD_32BE(tileData2, charBase, vram); \
+		} \
+		if (tileData) { \
+			BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 0); \
+			BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 1); \
+			BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 2); \
+			BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 3); \
+		} \
+		tileData = tileData2; \
+		if (tileData) { \
+			BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 4); \
+			BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 5); \
+			BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 6); \
+			BACKGROUND_DRAW_PIXEL_256(BLEND, OBJWIN, 7); \
 		} \
+		pixel += 8; \
 	}
 
 #define DRAW_BACKGROUND_MODE_0_MOSAIC_256(BLEND, OBJWIN) \
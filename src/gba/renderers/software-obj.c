@@ -5,6 +5,16 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "gba/renderers/software-private.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPRITE_SSE2
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(__BIG_ENDIAN__) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_neon.h>
+#define SPRITE_NEON
+#endif
+
+#define FLAG_SPRITE_MERGE (FLAG_ORDER_MASK | FLAG_REBLEND | FLAG_TARGET_1)
+
 #define SPRITE_NORMAL_LOOP(DEPTH, TYPE) \
 	SPRITE_YBASE_ ## DEPTH(inY); \
 	unsigned tileData; \
@@ -70,6 +80,75 @@
 		SPRITE_DRAW_PIXEL_ ## DEPTH ## _ ## TYPE(localX); \
 	}
 
+// The span loops decode a whole run of pixels first and then merge them into the sprite layer
+// together. They're equivalent to the loops above with the NORMAL pixel type.
+#define SPRITE_NORMAL_SPAN(DEPTH) \
+	SPRITE_YBASE_ ## DEPTH(inY); \
+	uint8_t indices[GBA_VIDEO_HORIZONTAL_PIXELS]; \
+	int spanStart = outX; \
+	int lastTile = -1; \
+	uint32_t rowLo = 0; \
+	uint32_t rowHi = 0; \
+	for (; outX < condition; ++outX, inX += xOffset) { \
+		if (inX >> 3 != lastTile) { \
+			lastTile = inX >> 3; \
+			SPRITE_LOAD_ROW_ ## DEPTH(lastTile << 3); \
+		} \
+		indices[outX - spanStart] = SPRITE_ROW_PIXEL_ ## DEPTH(inX & 7); \
+	} \
+	_mergeSpriteSpan(&renderer->spriteLayer[spanStart], indices, outX - spanStart, palette, flags);
+
+#define SPRITE_TRANSFORMED_SPAN(DEPTH) \
+	unsigned tileData; \
+	unsigned widthMask = ~(width - 1); \
+	unsigned heightMask = ~(height - 1); \
+	uint8_t indices[GBA_VIDEO_HORIZONTAL_PIXELS]; \
+	int spanStart = outX; \
+	for (; outX < condition; ++outX, ++inX) { \
+		xAccum += mat.a; \
+		yAccum += mat.c; \
+		int localX = xAccum >> 8; \
+		int localY = yAccum >> 8; \
+		\
+		if (localX & widthMask || localY & heightMask) { \
+			break; \
+		} \
+		\
+		SPRITE_YBASE_ ## DEPTH(localY); \
+		SPRITE_XBASE_ ## DEPTH(localX); \
+		LOAD_16(tileData, (yBase + ((xBase + charBase) & maskLo)) & 0x7FFE, vramBase); \
+		indices[outX - spanStart] = SPRITE_PIXEL_ ## DEPTH(localX); \
+	} \
+	_mergeSpriteSpan(&renderer->spriteLayer[spanStart], indices, outX - spanStart, palette, flags);
+
+#define SPRITE_LOAD_HALF(DEPTH, localX, OUT) { \
+		SPRITE_XBASE_ ## DEPTH(localX); \
+		uint16_t half; \
+		LOAD_16(half, (yBase + ((xBase + charBase) & maskLo)) & 0x7FFE, vramBase); \
+		OUT = half; \
+	}
+
+#define SPRITE_LOAD_ROW_16(tileX) \
+	SPRITE_LOAD_HALF(16, (tileX), rowLo); \
+	SPRITE_LOAD_HALF(16, ((tileX) + 4), rowHi); \
+	rowLo |= rowHi << 16;
+
+#define SPRITE_LOAD_ROW_256(tileX) { \
+		uint32_t high; \
+		SPRITE_LOAD_HALF(256, (tileX), rowLo); \
+		SPRITE_LOAD_HALF(256, ((tileX) + 2), high); \
+		rowLo |= high << 16; \
+		SPRITE_LOAD_HALF(256, ((tileX) + 4), rowHi); \
+		SPRITE_LOAD_HALF(256, ((tileX) + 6), high); \
+		rowHi |= high << 16; \
+	}
+
+#define SPRITE_ROW_PIXEL_16(x) ((rowLo >> ((x) << 2)) & 0xF)
+#define SPRITE_ROW_PIXEL_256(x) (((((x) & 4) ? rowHi : rowLo) >> (((x) & 3) << 3)) & 0xFF)
+
+#define SPRITE_PIXEL_16(localX) ((tileData >> ((localX & 3) << 2)) & 0xF)
+#define SPRITE_PIXEL_256(localX) ((tileData >> ((localX & 1) << 3)) & 0xFF)
+
 #define SPRITE_XBASE_16(localX) unsigned xBase = (localX & ~0x7) * 4 + ((localX >> 1) & 2);
 #define SPRITE_YBASE_16(localY) unsigned yBase = (localY & ~0x7) * stride + (localY & 0x7) * 4 + maskHi;
 
@@ -140,6 +219,67 @@
 		renderer->row[outX] |= FLAG_OBJWIN; \
 	}
 
+// Same as SPRITE_DRAW_PIXEL_*_NORMAL, for count pixels at once. The palette lookups stay scalar, since
+// there's no gather on the SSE2 or NEON baseline, but the layer compare and select are vectorized.
+static void _mergeSpriteSpan(uint32_t* layer, const uint8_t* indices, int count, const color_t* palette, uint32_t flags) {
+	int x = 0;
+#ifdef SPRITE_SSE2
+	const __m128i bias = _mm_set1_epi32(0x80000000);
+	const __m128i order = _mm_set1_epi32(FLAG_ORDER_MASK);
+	const __m128i biasedFlags = _mm_set1_epi32(flags ^ 0x80000000);
+	const __m128i keep = _mm_set1_epi32(~FLAG_SPRITE_MERGE);
+	const __m128i newFlags = _mm_set1_epi32(flags & FLAG_SPRITE_MERGE);
+	const __m128i unwritten = _mm_set1_epi32(FLAG_UNWRITTEN);
+	const __m128i zero = _mm_setzero_si128();
+	for (; x + 4 <= count; x += 4) {
+		__m128i current = _mm_loadu_si128((const __m128i*) &layer[x]);
+		__m128i color = _mm_set_epi32(palette[indices[x + 3]] | flags, palette[indices[x + 2]] | flags,
+		                              palette[indices[x + 1]] | flags, palette[indices[x]] | flags);
+		uint32_t packed;
+		memcpy(&packed, &indices[x], sizeof(packed));
+		__m128i index = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+		__m128i transparent = _mm_cmpeq_epi32(index, zero);
+		__m128i closer = _mm_cmpgt_epi32(_mm_xor_si128(_mm_and_si128(current, order), bias), biasedFlags);
+		__m128i isUnwritten = _mm_cmpeq_epi32(current, unwritten);
+		__m128i reordered = _mm_or_si128(_mm_and_si128(current, keep), newFlags);
+		reordered = _mm_or_si128(_mm_and_si128(isUnwritten, current), _mm_andnot_si128(isUnwritten, reordered));
+		__m128i pixel = _mm_or_si128(_mm_and_si128(transparent, reordered), _mm_andnot_si128(transparent, color));
+		pixel = _mm_or_si128(_mm_and_si128(closer, pixel), _mm_andnot_si128(closer, current));
+		_mm_storeu_si128((__m128i*) &layer[x], pixel);
+	}
+#elif defined(SPRITE_NEON)
+	const uint32x4_t order = vdupq_n_u32(FLAG_ORDER_MASK);
+	const uint32x4_t flagsVec = vdupq_n_u32(flags);
+	const uint32x4_t keep = vdupq_n_u32(~FLAG_SPRITE_MERGE);
+	const uint32x4_t newFlags = vdupq_n_u32(flags & FLAG_SPRITE_MERGE);
+	const uint32x4_t unwritten = vdupq_n_u32(FLAG_UNWRITTEN);
+	for (; x + 4 <= count; x += 4) {
+		uint32x4_t current = vld1q_u32(&layer[x]);
+		uint32_t colors[4] = {
+			palette[indices[x]] | flags, palette[indices[x + 1]] | flags,
+			palette[indices[x + 2]] | flags, palette[indices[x + 3]] | flags
+		};
+		uint32_t opaque[4] = { indices[x], indices[x + 1], indices[x + 2], indices[x + 3] };
+		uint32x4_t transparent = vceqq_u32(vld1q_u32(opaque), vdupq_n_u32(0));
+		uint32x4_t closer = vcgtq_u32(vandq_u32(current, order), flagsVec);
+		uint32x4_t reordered = vorrq_u32(vandq_u32(current, keep), newFlags);
+		reordered = vbslq_u32(vceqq_u32(current, unwritten), current, reordered);
+		uint32x4_t pixel = vbslq_u32(transparent, reordered, vld1q_u32(colors));
+		vst1q_u32(&layer[x], vbslq_u32(closer, pixel, current));
+	}
+#endif
+	for (; x < count; ++x) {
+		uint32_t current = layer[x];
+		if ((current & FLAG_ORDER_MASK) > flags) {
+			if (indices[x]) {
+				layer[x] = palette[indices[x]] | flags;
+			} else if (current != FLAG_UNWRITTEN) {
+				layer[x] = (current & ~FLAG_SPRITE_MERGE) | (flags & FLAG_SPRITE_MERGE);
+			}
+		}
+	}
+}
+
 int GBAVideoSoftwareRendererPreprocessSprite(struct GBAVideoSoftwareRenderer* renderer, struct GBAObj* sprite, int index, int y) {
 	int width = GBAVideoObjSizes[GBAObjAttributesAGetShape(sprite->a) * 4 + GBAObjAttributesBGetSize(sprite->b)][0];
 	int height = GBAVideoObjSizes[GBAObjAttributesAGetShape(sprite->a) * 4 + GBAObjAttributesBGetSize(sprite->b)][1];
@@ -287,7 +427,7 @@ int GBAVideoSoftwareRendererPreprocessSprite(struct GBAVideoSoftwareRenderer* re
 				objwinPalette = &objwinPalette[GBAObjAttributesCGetPalette(sprite->c) << 4];
 				SPRITE_TRANSFORMED_LOOP(16, NORMAL_OBJWIN);
 			} else {
-				SPRITE_TRANSFORMED_LOOP(16, NORMAL);
+				SPRITE_TRANSFORMED_SPAN(16);
 			}
 		} else {
 			if (flags & FLAG_OBJWIN) {
@@ -301,7 +441,7 @@ int GBAVideoSoftwareRendererPreprocessSprite(struct GBAVideoSoftwareRenderer* re
 			} else if (objwinSlowPath) {
 				SPRITE_TRANSFORMED_LOOP(256, NORMAL_OBJWIN);
 			} else {
-				SPRITE_TRANSFORMED_LOOP(256, NORMAL);
+				SPRITE_TRANSFORMED_SPAN(256);
 			}
 		}
 	} else {
@@ -344,7 +484,7 @@ int GBAVideoSoftwareRendererPreprocessSprite(struct GBAVideoSoftwareRenderer* re
 				objwinPalette = &objwinPalette[GBAObjAttributesCGetPalette(sprite->c) << 4];
 				SPRITE_NORMAL_LOOP(16, NORMAL_OBJWIN);
 			} else {
-				SPRITE_NORMAL_LOOP(16, NORMAL);
+				SPRITE_NORMAL_SPAN(16);
 			}
 		} else {
 			if (flags & FLAG_OBJWIN) {
@@ -358,7 +498,7 @@ int GBAVideoSoftwareRendererPreprocessSprite(struct GBAVideoSoftwareRenderer* re
 			} else if (objwinSlowPath) {
 				SPRITE_NORMAL_LOOP(256, NORMAL_OBJWIN);
 			} else {
-				SPRITE_NORMAL_LOOP(256, NORMAL);
+				SPRITE_NORMAL_SPAN(256);
 			}
 		}
 	}
@@ -200,8 +200,8 @@ static inline void _compositeNoBlendNoObjwin(struct GBAVideoSoftwareRenderer* re
 	int32_t y = background->sy + (renderer->start - 1) * background->dy;                                              \
 	int mosaicH = 0;                                                                                                  \
 	int mosaicWait = 0;                                                                                               \
-	int32_t localX;                                                                                                   \
-	int32_t localY;                                                                                                   \
+	int32_t localX = 0;                                                                                               \
+	int32_t localY = 0;                                                                                               \
 	if (background->mosaic) {                                                                                         \
 		int mosaicV = GBAMosaicControlGetBgV(renderer->mosaic) + 1;                                                   \
 		mosaicH = GBAMosaicControlGetBgH(renderer->mosaic) + 1;                                                       \
@@ -239,6 +239,13 @@ static inline void _compositeNoBlendNoObjwin(struct GBAVideoSoftwareRenderer* re
 	(GBARegisterDISPCNTIsObjwinEnable(softwareRenderer->dispcnt) && GBAWindowControlIsBg ## X ## Enable (softwareRenderer->objwin.packed))) && \
 	softwareRenderer->bg[X].priority == priority)
 
+static inline color_t _colorFrom555(const struct GBAVideoSoftwareRenderer* renderer, uint16_t value) {
+	if (renderer->colorTable) {
+		return renderer->colorTable[value & 0x7FFF];
+	}
+	return mColorFrom555(value);
+}
+
 static inline unsigned _brighten(unsigned color, int y) {
 	unsigned c = 0;
 	unsigned a;
@@ -260,14 +267,12 @@ static inline unsigned _brighten(unsigned color, int y) {
 	c |= (a + ((0x7C00 - a) * y) / 16) & 0x7C00;
 #endif
 #else
-	a = color & 0xFF;
-	c |= (a + ((0xFF - a) * y) / 16) & 0xFF;
+	// Red and blue are far enough apart to be scaled together without overlapping
+	a = color & 0xFF00FF;
+	c |= (a + (((0xFF00FF - a) * y) >> 4)) & 0xFF00FF;
 
 	a = color & 0xFF00;
 	c |= (a + ((0xFF00 - a) * y) / 16) & 0xFF00;
-
-	a = color & 0xFF0000;
-	c |= (a + ((0xFF0000 - a) * y) / 16) & 0xFF0000;
 #endif
 	return c;
 }
@@ -293,14 +298,12 @@ static inline unsigned _darken(unsigned color, int y) {
 	c |= (a - (a * y) / 16) & 0x7C00;
 #endif
 #else
-	a = color & 0xFF;
-	c |= (a - (a * y) / 16) & 0xFF;
+	// Red and blue are far enough apart to be scaled together without overlapping
+	a = color & 0xFF00FF;
+	c |= (a - ((a * y) >> 4)) & 0xFF00FF;
 
 	a = color & 0xFF00;
 	c |= (a - (a * y) / 16) & 0xFF00;
-
-	a = color & 0xFF0000;
-	c |= (a - (a * y) / 16) & 0xFF0000;
 #endif
 	return c;
 }
@@ -8,8 +8,10 @@
 #include <mgba/core/cache-set.h>
 #include <mgba/internal/arm/macros.h>
 #include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/memory.h>
 #include <mgba/internal/gba/renderers/cache-set.h>
 
+#include <mgba-util/math.h>
 #include <mgba-util/memory.h>
 
 #define DIRTY_SCANLINE(R, Y) R->scanlineDirty[Y >> 5] |= (1U << (Y & 0x1F))
@@ -20,6 +22,8 @@ static void GBAVideoSoftwareRendererDeinit(struct GBAVideoRenderer* renderer);
 static void GBAVideoSoftwareRendererReset(struct GBAVideoRenderer* renderer);
 static void GBAVideoSoftwareRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address);
 static void GBAVideoSoftwareRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam);
+static void GBAVideoSoftwareRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t length);
+static void GBAVideoSoftwareRendererWriteOAMRange(struct GBAVideoRenderer* renderer, uint32_t oam, uint32_t count);
 static void GBAVideoSoftwareRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 static uint16_t GBAVideoSoftwareRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* renderer, int y);
@@ -42,7 +46,8 @@ static int GBAVideoSoftwareRendererPreprocessSpriteLayer(struct GBAVideoSoftware
 static void _updatePalettes(struct GBAVideoSoftwareRenderer* renderer);
 static void _updateFlags(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* bg);
 
-static void _breakWindow(struct GBAVideoSoftwareRenderer* softwareRenderer, struct WindowN* win, int y);
+static bool _windowCoversLine(const struct WindowN* win, int y);
+static void _breakWindow(struct GBAVideoSoftwareRenderer* softwareRenderer, struct WindowN* win);
 static void _breakWindowInner(struct GBAVideoSoftwareRenderer* softwareRenderer, struct WindowN* win);
 
 void GBAVideoSoftwareRendererCreate(struct GBAVideoSoftwareRenderer* renderer) {
@@ -52,6 +57,8 @@ void GBAVideoSoftwareRendererCreate(struct GBAVideoSoftwareRenderer* renderer) {
 	renderer->d.writeVideoRegister = GBAVideoSoftwareRendererWriteVideoRegister;
 	renderer->d.writeVRAM = GBAVideoSoftwareRendererWriteVRAM;
 	renderer->d.writeOAM = GBAVideoSoftwareRendererWriteOAM;
+	renderer->d.writeVRAMRange = GBAVideoSoftwareRendererWriteVRAMRange;
+	renderer->d.writeOAMRange = GBAVideoSoftwareRendererWriteOAMRange;
 	renderer->d.writePalette = GBAVideoSoftwareRendererWritePalette;
 	renderer->d.drawScanline = GBAVideoSoftwareRendererDrawScanline;
 	renderer->d.finishFrame = GBAVideoSoftwareRendererFinishFrame;
@@ -78,7 +85,10 @@ void GBAVideoSoftwareRendererCreate(struct GBAVideoSoftwareRenderer* renderer) {
 	renderer->d.highlightColor = M_COLOR_WHITE;
 	renderer->d.highlightAmount = 0;
 
+	renderer->colorTable = NULL;
 	renderer->temporaryBuffer = 0;
+	renderer->bandStart = 0;
+	renderer->bandEnd = GBA_VIDEO_VERTICAL_PIXELS;
 }
 
 static void GBAVideoSoftwareRendererInit(struct GBAVideoRenderer* renderer) {
@@ -114,6 +124,9 @@ static void GBAVideoSoftwareRendererReset(struct GBAVideoRenderer* renderer) {
 	}
 	softwareRenderer->blendDirty = false;
 	_updatePalettes(softwareRenderer);
+	if (renderer->cache) {
+		mCacheSetWriteVRAMRange(renderer->cache, 0, GBA_SIZE_VRAM);
+	}
 
 	softwareRenderer->blda = 0;
 	softwareRenderer->bldb = 0;
@@ -123,6 +136,7 @@ static void GBAVideoSoftwareRendererReset(struct GBAVideoRenderer* renderer) {
 	softwareRenderer->winN[1] = (struct WindowN) { .control = { .priority = 1 } };
 	softwareRenderer->objwin = (struct WindowControl) { .priority = 2 };
 	softwareRenderer->winout = (struct WindowControl) { .priority = 3 };
+	softwareRenderer->windowKey.active = -1;
 	softwareRenderer->oamDirty = 1;
 	softwareRenderer->oamMax = 0;
 
@@ -409,9 +423,26 @@ static void GBAVideoSoftwareRendererWriteOAM(struct GBAVideoRenderer* renderer,
 	memset(softwareRenderer->scanlineDirty, 0xFFFFFFFF, sizeof(softwareRenderer->scanlineDirty));
 }
 
+static void GBAVideoSoftwareRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t length) {
+	struct GBAVideoSoftwareRenderer* softwareRenderer = (struct GBAVideoSoftwareRenderer*) renderer;
+	if (renderer->cache) {
+		mCacheSetWriteVRAMRange(renderer->cache, address, length);
+	}
+	memset(softwareRenderer->scanlineDirty, 0xFFFFFFFF, sizeof(softwareRenderer->scanlineDirty));
+	softwareRenderer->bg[0].yCache = -1;
+	softwareRenderer->bg[1].yCache = -1;
+	softwareRenderer->bg[2].yCache = -1;
+	softwareRenderer->bg[3].yCache = -1;
+}
+
+static void GBAVideoSoftwareRendererWriteOAMRange(struct GBAVideoRenderer* renderer, uint32_t oam, uint32_t count) {
+	UNUSED(count);
+	GBAVideoSoftwareRendererWriteOAM(renderer, oam);
+}
+
 static void GBAVideoSoftwareRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
 	struct GBAVideoSoftwareRenderer* softwareRenderer = (struct GBAVideoSoftwareRenderer*) renderer;
-	color_t color = mColorFrom555(value);
+	color_t color = _colorFrom555(softwareRenderer, value);
 	softwareRenderer->normalPalette[address >> 1] = color;
 	if (softwareRenderer->blendEffect == BLEND_BRIGHTEN) {
 		softwareRenderer->variantPalette[address >> 1] = _brighten(color, softwareRenderer->bldy);
@@ -427,22 +458,19 @@ static void GBAVideoSoftwareRendererWritePalette(struct GBAVideoRenderer* render
 		softwareRenderer->highlightVariantPalette[address >> 1] = softwareRenderer->variantPalette[address >> 1];
 	}
 	if (renderer->cache) {
-		mCacheSetWritePalette(renderer->cache, address >> 1, color);
+		mCacheSetWritePalette(renderer->cache, address >> 1, mColorFrom555(value));
 	}
 	memset(softwareRenderer->scanlineDirty, 0xFFFFFFFF, sizeof(softwareRenderer->scanlineDirty));
 }
 
-static void _breakWindow(struct GBAVideoSoftwareRenderer* softwareRenderer, struct WindowN* win, int y) {
+static bool _windowCoversLine(const struct WindowN* win, int y) {
 	if (win->v.end >= win->v.start) {
-		if (y >= win->v.end + win->offsetY) {
-			return;
-		}
-		if (y < win->v.start + win->offsetY) {
-			return;
-		}
-	} else if (y >= win->v.end + win->offsetY && y < win->v.start + win->offsetY) {
-		return;
+		return y < win->v.end + win->offsetY && y >= win->v.start + win->offsetY;
 	}
+	return y < win->v.end + win->offsetY || y >= win->v.start + win->offsetY;
+}
+
+static void _breakWindow(struct GBAVideoSoftwareRenderer* softwareRenderer, struct WindowN* win) {
 	if (win->h.end > GBA_VIDEO_HORIZONTAL_PIXELS || win->h.end < win->h.start) {
 		struct WindowN splits[2] = { *win, *win };
 		splits[0].h.start = 0;
@@ -505,6 +533,48 @@ static void _breakWindowInner(struct GBAVideoSoftwareRenderer* softwareRenderer,
 #endif
 }
 
+static bool _spanOccluded(const struct GBAVideoSoftwareRenderer* softwareRenderer) {
+	// Layers are composited front to back, so a pixel that's been drawn and isn't waiting to blend is final
+	int x;
+	for (x = softwareRenderer->start; x < softwareRenderer->end; ++x) {
+		uint32_t color = softwareRenderer->row[x];
+		if ((color & FLAG_UNWRITTEN) == FLAG_UNWRITTEN || (color & FLAG_TARGET_1)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void _finishScanline(struct GBAVideoSoftwareRenderer* softwareRenderer, int y) {
+	if (GBARegisterDISPCNTGetMode(softwareRenderer->dispcnt) != 0) {
+		if (softwareRenderer->bg[2].enabled == ENABLED_MAX) {
+			softwareRenderer->bg[2].sx += softwareRenderer->bg[2].dmx;
+			softwareRenderer->bg[2].sy += softwareRenderer->bg[2].dmy;
+		}
+		if (softwareRenderer->bg[3].enabled == ENABLED_MAX) {
+			softwareRenderer->bg[3].sx += softwareRenderer->bg[3].dmx;
+			softwareRenderer->bg[3].sy += softwareRenderer->bg[3].dmy;
+		}
+	}
+
+	if (softwareRenderer->bg[0].enabled != 0 && softwareRenderer->bg[0].enabled < ENABLED_MAX) {
+		++softwareRenderer->bg[0].enabled;
+		DIRTY_SCANLINE(softwareRenderer, y);
+	}
+	if (softwareRenderer->bg[1].enabled != 0 && softwareRenderer->bg[1].enabled < ENABLED_MAX) {
+		++softwareRenderer->bg[1].enabled;
+		DIRTY_SCANLINE(softwareRenderer, y);
+	}
+	if (softwareRenderer->bg[2].enabled != 0 && softwareRenderer->bg[2].enabled < ENABLED_MAX) {
+		++softwareRenderer->bg[2].enabled;
+		DIRTY_SCANLINE(softwareRenderer, y);
+	}
+	if (softwareRenderer->bg[3].enabled != 0 && softwareRenderer->bg[3].enabled < ENABLED_MAX) {
+		++softwareRenderer->bg[3].enabled;
+		DIRTY_SCANLINE(softwareRenderer, y);
+	}
+}
+
 static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
 	struct GBAVideoSoftwareRenderer* softwareRenderer = (struct GBAVideoSoftwareRenderer*) renderer;
 
@@ -548,6 +618,7 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 	}
 
 	CLEAN_SCANLINE(softwareRenderer, y);
+	softwareRenderer->d.changedScanlines[y >> 5] |= 1U << (y & 0x1F);
 
 	color_t* row = &softwareRenderer->outputBuffer[softwareRenderer->outputBufferStride * y];
 	if (GBARegisterDISPCNTIsForcedBlank(softwareRenderer->dispcnt)) {
@@ -558,10 +629,26 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 		return;
 	}
 
+	if (y < softwareRenderer->bandStart || y >= softwareRenderer->bandEnd) {
+		// Another renderer draws this scanline, but background enables still have to advance the same way
+		GBAVideoSoftwareRendererUpdateDISPCNT(softwareRenderer);
+		_finishScanline(softwareRenderer, y);
+		return;
+	}
+
 	GBAVideoSoftwareRendererPreprocessBuffer(softwareRenderer, y);
 	softwareRenderer->spriteCyclesRemaining = GBARegisterDISPCNTIsHblankIntervalFree(softwareRenderer->dispcnt) ? OBJ_HBLANK_FREE_LENGTH : OBJ_LENGTH;
 	int spriteLayers = GBAVideoSoftwareRendererPreprocessSpriteLayer(softwareRenderer, y);
 
+	// Which priorities have anything on them, so the occlusion check only runs when it could save a layer
+	int layerPriorities = spriteLayers;
+	int i;
+	for (i = 0; i < 4; ++i) {
+		if (softwareRenderer->bg[i].enabled == ENABLED_MAX && !softwareRenderer->d.disableBG[i]) {
+			layerPriorities |= 1 << softwareRenderer->bg[i].priority;
+		}
+	}
+
 	int w;
 	unsigned priority;
 	softwareRenderer->end = 0;
@@ -643,38 +730,15 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 					break;
 				}
 			}
+			if ((layerPriorities >> (priority + 1)) && _spanOccluded(softwareRenderer)) {
+				// Nothing further back can show through
+				break;
+			}
 		}
 	}
 
 	GBAVideoSoftwareRendererPostprocessBuffer(softwareRenderer);
-
-	if (GBARegisterDISPCNTGetMode(softwareRenderer->dispcnt) != 0) {
-		if (softwareRenderer->bg[2].enabled == ENABLED_MAX) {
-			softwareRenderer->bg[2].sx += softwareRenderer->bg[2].dmx;
-			softwareRenderer->bg[2].sy += softwareRenderer->bg[2].dmy;
-		}
-		if (softwareRenderer->bg[3].enabled == ENABLED_MAX) {
-			softwareRenderer->bg[3].sx += softwareRenderer->bg[3].dmx;
-			softwareRenderer->bg[3].sy += softwareRenderer->bg[3].dmy;
-		}
-	}
-
-	if (softwareRenderer->bg[0].enabled != 0 && softwareRenderer->bg[0].enabled < ENABLED_MAX) {
-		++softwareRenderer->bg[0].enabled;
-		DIRTY_SCANLINE(softwareRenderer, y);
-	}
-	if (softwareRenderer->bg[1].enabled != 0 && softwareRenderer->bg[1].enabled < ENABLED_MAX) {
-		++softwareRenderer->bg[1].enabled;
-		DIRTY_SCANLINE(softwareRenderer, y);
-	}
-	if (softwareRenderer->bg[2].enabled != 0 && softwareRenderer->bg[2].enabled < ENABLED_MAX) {
-		++softwareRenderer->bg[2].enabled;
-		DIRTY_SCANLINE(softwareRenderer, y);
-	}
-	if (softwareRenderer->bg[3].enabled != 0 && softwareRenderer->bg[3].enabled < ENABLED_MAX) {
-		++softwareRenderer->bg[3].enabled;
-		DIRTY_SCANLINE(softwareRenderer, y);
-	}
+	_finishScanline(softwareRenderer, y);
 
 	int x;
 	if (softwareRenderer->greenswap) {
@@ -744,6 +808,7 @@ static void GBAVideoSoftwareRendererPutPixels(struct GBAVideoRenderer* renderer,
 	for (i = 0; i < GBA_VIDEO_VERTICAL_PIXELS; ++i) {
 		memmove(&softwareRenderer->outputBuffer[softwareRenderer->outputBufferStride * i], &colorPixels[stride * i], GBA_VIDEO_HORIZONTAL_PIXELS * BYTES_PER_PIXEL);
 	}
+	memset(softwareRenderer->d.changedScanlines, 0xFF, sizeof(softwareRenderer->d.changedScanlines));
 }
 
 static void _enableBg(struct GBAVideoSoftwareRenderer* renderer, int bg, bool active) {
@@ -845,18 +910,36 @@ void GBAVideoSoftwareRendererPreprocessBuffer(struct GBAVideoSoftwareRenderer* s
 		softwareRenderer->spriteLayer[x + 3] = FLAG_UNWRITTEN;
 	}
 
-	softwareRenderer->windows[0].endX = GBA_VIDEO_HORIZONTAL_PIXELS;
-	softwareRenderer->nWindows = 1;
+	struct WindowKey key;
+	memset(&key, 0, sizeof(key));
 	if (GBARegisterDISPCNTIsWin0Enable(softwareRenderer->dispcnt) || GBARegisterDISPCNTIsWin1Enable(softwareRenderer->dispcnt) || GBARegisterDISPCNTIsObjwinEnable(softwareRenderer->dispcnt)) {
-		softwareRenderer->windows[0].control = softwareRenderer->winout;
-		if (GBARegisterDISPCNTIsWin1Enable(softwareRenderer->dispcnt) && !softwareRenderer->d.disableWIN[1]) {
-			_breakWindow(softwareRenderer, &softwareRenderer->winN[1], y);
+		key.active = 4;
+		key.winout = softwareRenderer->winout;
+		int i;
+		for (i = 0; i < 2; ++i) {
+			bool enabled = i ? GBARegisterDISPCNTIsWin1Enable(softwareRenderer->dispcnt) : GBARegisterDISPCNTIsWin0Enable(softwareRenderer->dispcnt);
+			if (enabled && !softwareRenderer->d.disableWIN[i] && _windowCoversLine(&softwareRenderer->winN[i], y)) {
+				key.active |= 1 << i;
+				key.h[i] = softwareRenderer->winN[i].h;
+				key.control[i] = softwareRenderer->winN[i].control;
+			}
 		}
-		if (GBARegisterDISPCNTIsWin0Enable(softwareRenderer->dispcnt) && !softwareRenderer->d.disableWIN[0]) {
-			_breakWindow(softwareRenderer, &softwareRenderer->winN[0], y);
+	}
+	if (memcmp(&key, &softwareRenderer->windowKey, sizeof(key))) {
+		softwareRenderer->windowKey = key;
+		softwareRenderer->windows[0].endX = GBA_VIDEO_HORIZONTAL_PIXELS;
+		softwareRenderer->nWindows = 1;
+		if (key.active) {
+			softwareRenderer->windows[0].control = softwareRenderer->winout;
+			if (key.active & 2) {
+				_breakWindow(softwareRenderer, &softwareRenderer->winN[1]);
+			}
+			if (key.active & 1) {
+				_breakWindow(softwareRenderer, &softwareRenderer->winN[0]);
+			}
+		} else {
+			softwareRenderer->windows[0].control.packed = 0xFF;
 		}
-	} else {
-		softwareRenderer->windows[0].control.packed = 0xFF;
 	}
 
 	GBAVideoSoftwareRendererUpdateDISPCNT(softwareRenderer);
@@ -907,6 +990,11 @@ void GBAVideoSoftwareRendererPreprocessBuffer(struct GBAVideoSoftwareRenderer* s
 
 void GBAVideoSoftwareRendererPostprocessBuffer(struct GBAVideoSoftwareRenderer* softwareRenderer) {
 	int x, w;
+	// Writes to the row could otherwise alias these, forcing them to be reloaded every pixel
+	uint32_t* row = softwareRenderer->row;
+	int blda = softwareRenderer->blda;
+	int bldb = softwareRenderer->bldb;
+	int bldy = softwareRenderer->bldy;
 	if ((softwareRenderer->forceTarget1 || softwareRenderer->bg[0].target1 || softwareRenderer->bg[1].target1 || softwareRenderer->bg[2].target1 || softwareRenderer->bg[3].target1) && softwareRenderer->target2Bd) {
 		x = 0;
 		for (w = 0; w < softwareRenderer->nWindows; ++w) {
@@ -918,9 +1006,9 @@ void GBAVideoSoftwareRendererPostprocessBuffer(struct GBAVideoSoftwareRenderer*
 			}
 			int end = softwareRenderer->windows[w].endX;
 			for (; x < end; ++x) {
-				uint32_t color = softwareRenderer->row[x];
+				uint32_t color = row[x];
 				if (color & FLAG_TARGET_1) {
-					softwareRenderer->row[x] = mColorMix5Bit(softwareRenderer->bldb, backdrop, softwareRenderer->blda, color);
+					row[x] = mColorMix5Bit(bldb, backdrop, blda, color);
 				}
 			}
 		}
@@ -944,16 +1032,16 @@ void GBAVideoSoftwareRendererPostprocessBuffer(struct GBAVideoSoftwareRenderer*
 			}
 			if (softwareRenderer->blendEffect == BLEND_DARKEN) {
 				for (; x < end; ++x) {
-					uint32_t color = softwareRenderer->row[x];
+					uint32_t color = row[x];
 					if ((color & mask) == match) {
-						softwareRenderer->row[x] = _darken(color, softwareRenderer->bldy);
+						row[x] = _darken(color, bldy);
 					}
 				}
 			} else if (softwareRenderer->blendEffect == BLEND_BRIGHTEN) {
 				for (; x < end; ++x) {
-					uint32_t color = softwareRenderer->row[x];
+					uint32_t color = row[x];
 					if ((color & mask) == match) {
-						softwareRenderer->row[x] = _brighten(color, softwareRenderer->bldy);
+						row[x] = _brighten(color, bldy);
 					}
 				}
 			}
@@ -961,48 +1049,70 @@ void GBAVideoSoftwareRendererPostprocessBuffer(struct GBAVideoSoftwareRenderer*
 	}
 }
 
+static void _bucketSprites(struct GBAVideoSoftwareRenderer* renderer) {
+	memset(renderer->spriteLines, 0, sizeof(renderer->spriteLines));
+	int i;
+	for (i = 0; i < renderer->oamMax; ++i) {
+		const struct GBAVideoRendererSprite* sprite = &renderer->sprites[i];
+		uint32_t bit = 1U << (i & 0x1F);
+		int word = i >> 5;
+		int y = sprite->y < 0 ? 0 : sprite->y;
+		int endY = sprite->endY < GBA_VIDEO_VERTICAL_PIXELS ? sprite->endY : GBA_VIDEO_VERTICAL_PIXELS;
+		for (; y < endY; ++y) {
+			renderer->spriteLines[y][word] |= bit;
+		}
+		// Sprites hanging off the bottom of the screen wrap around to the top
+		endY = sprite->endY - 256;
+		if (endY > GBA_VIDEO_VERTICAL_PIXELS) {
+			endY = GBA_VIDEO_VERTICAL_PIXELS;
+		}
+		for (y = 0; y < endY; ++y) {
+			renderer->spriteLines[y][word] |= bit;
+		}
+	}
+}
+
 int GBAVideoSoftwareRendererPreprocessSpriteLayer(struct GBAVideoSoftwareRenderer* renderer, int y) {
 	int w;
 	int spriteLayers = 0;
 	if (GBARegisterDISPCNTIsObjEnable(renderer->dispcnt) && !renderer->d.disableOBJ) {
 		if (renderer->oamDirty) {
 			renderer->oamMax = GBAVideoRendererCleanOAM(renderer->d.oam->obj, renderer->sprites, renderer->objOffsetY);
+			_bucketSprites(renderer);
 			renderer->oamDirty = false;
 		}
 		int mosaicV = GBAMosaicControlGetObjV(renderer->mosaic) + 1;
 		int mosaicY = y - (y % mosaicV);
-		int i;
-		for (i = 0; i < renderer->oamMax; ++i) {
-			struct GBAVideoRendererSprite* sprite = &renderer->sprites[i];
-			int localY = y;
-			renderer->end = 0;
-			if ((y < sprite->y && (sprite->endY - 256 < 0 || y >= sprite->endY - 256)) || y >= sprite->endY) {
-				continue;
-			}
-			if (GBAObjAttributesAIsMosaic(sprite->obj.a) && mosaicV > 1) {
-				localY = mosaicY;
-				if (localY < sprite->y && sprite->y < GBA_VIDEO_VERTICAL_PIXELS) {
-					localY = sprite->y;
-				}
-				if (localY >= (sprite->endY & 0xFF)) {
-					localY = sprite->endY - 1;
-				}
-			}
-			for (w = 0; w < renderer->nWindows; ++w) {
-				renderer->currentWindow = renderer->windows[w].control;
-				renderer->start = renderer->end;
-				renderer->end = renderer->windows[w].endX;
-				// TODO: partial sprite drawing
-				if (!GBAWindowControlIsObjEnable(renderer->currentWindow.packed) && !GBARegisterDISPCNTIsObjwinEnable(renderer->dispcnt)) {
-					continue;
+		int word;
+		for (word = 0; word < 4 && renderer->spriteCyclesRemaining > 0; ++word) {
+			uint32_t bits = renderer->spriteLines[y][word];
+			while (bits && renderer->spriteCyclesRemaining > 0) {
+				struct GBAVideoRendererSprite* sprite = &renderer->sprites[(word << 5) | ctz32(bits)];
+				bits &= bits - 1;
+				int localY = y;
+				renderer->end = 0;
+				if (GBAObjAttributesAIsMosaic(sprite->obj.a) && mosaicV > 1) {
+					localY = mosaicY;
+					if (localY < sprite->y && sprite->y < GBA_VIDEO_VERTICAL_PIXELS) {
+						localY = sprite->y;
+					}
+					if (localY >= (sprite->endY & 0xFF)) {
+						localY = sprite->endY - 1;
+					}
 				}
+				for (w = 0; w < renderer->nWindows; ++w) {
+					renderer->currentWindow = renderer->windows[w].control;
+					renderer->start = renderer->end;
+					renderer->end = renderer->windows[w].endX;
+					// TODO: partial sprite drawing
+					if (!GBAWindowControlIsObjEnable(renderer->currentWindow.packed) && !GBARegisterDISPCNTIsObjwinEnable(renderer->dispcnt)) {
+						continue;
+					}
 
-				int drawn = GBAVideoSoftwareRendererPreprocessSprite(renderer, &sprite->obj, sprite->index, localY);
-				spriteLayers |= drawn << GBAObjAttributesCGetPriority(sprite->obj.c);
-			}
-			renderer->spriteCyclesRemaining -= sprite->cycles;
-			if (renderer->spriteCyclesRemaining <= 0) {
-				break;
+					int drawn = GBAVideoSoftwareRendererPreprocessSprite(renderer, &sprite->obj, sprite->index, localY);
+					spriteLayers |= drawn << GBAObjAttributesCGetPriority(sprite->obj.c);
+				}
+				renderer->spriteCyclesRemaining -= sprite->cycles;
 			}
 		}
 	}
@@ -43,6 +43,20 @@ static void _ashesToAshes(struct mTiming* timing, void* user, uint32_t cyclesLat
 	// Funk to funky
 }
 
+static void _extendDirt(struct GBASavedata* savedata, uint32_t offset, uint32_t size) {
+	if (savedata->dirtStart >= savedata->dirtEnd) {
+		savedata->dirtStart = offset;
+		savedata->dirtEnd = offset + size;
+		return;
+	}
+	if (offset < savedata->dirtStart) {
+		savedata->dirtStart = offset;
+	}
+	if (offset + size > savedata->dirtEnd) {
+		savedata->dirtEnd = offset + size;
+	}
+}
+
 void GBASavedataInit(struct GBASavedata* savedata, struct VFile* vf) {
 	savedata->type = SAVEDATA_AUTODETECT;
 	savedata->data = 0;
@@ -57,6 +71,8 @@ void GBASavedataInit(struct GBASavedata* savedata, struct VFile* vf) {
 	savedata->maskWriteback = false;
 	savedata->dirty = 0;
 	savedata->dirtAge = 0;
+	savedata->dirtStart = 0;
+	savedata->dirtEnd = 0;
 	savedata->dust.name = "GBA Savedata Settling";
 	savedata->dust.priority = 0x70;
 	savedata->dust.context = savedata;
@@ -193,6 +209,7 @@ bool GBASavedataLoad(struct GBASavedata* savedata, struct VFile* in) {
 		}
 		ssize_t size = GBASavedataSize(savedata);
 		in->seek(in, 0, SEEK_SET);
+		_extendDirt(savedata, 0, size);
 		return in->read(in, savedata->data, size) == size;
 	} else if (savedata->vf) {
 		off_t read = 0;
@@ -285,6 +302,7 @@ void GBASavedataInitFlash(struct GBASavedata* savedata) {
 	savedata->currentBank = savedata->data;
 	if (end < GBA_SIZE_FLASH512) {
 		memset(&savedata->data[end], 0xFF, flashSize - end);
+		_extendDirt(savedata, end, flashSize - end);
 	}
 }
 
@@ -312,6 +330,7 @@ void GBASavedataInitEEPROM(struct GBASavedata* savedata) {
 	}
 	if (end < GBA_SIZE_EEPROM512) {
 		memset(&savedata->data[end], 0xFF, GBA_SIZE_EEPROM512 - end);
+		_extendDirt(savedata, end, GBA_SIZE_EEPROM512 - end);
 	}
 }
 
@@ -336,6 +355,7 @@ void GBASavedataInitSRAM(struct GBASavedata* savedata) {
 
 	if (end < GBA_SIZE_SRAM) {
 		memset(&savedata->data[end], 0xFF, GBA_SIZE_SRAM - end);
+		_extendDirt(savedata, end, GBA_SIZE_SRAM - end);
 	}
 }
 
@@ -360,6 +380,7 @@ void GBASavedataInitSRAM512(struct GBASavedata* savedata) {
 
 	if (end < GBA_SIZE_SRAM512) {
 		memset(&savedata->data[end], 0xFF, GBA_SIZE_SRAM512 - end);
+		_extendDirt(savedata, end, GBA_SIZE_SRAM512 - end);
 	}
 }
 
@@ -386,7 +407,7 @@ void GBASavedataWriteFlash(struct GBASavedata* savedata, uint16_t address, uint8
 	case FLASH_STATE_RAW:
 		switch (savedata->command) {
 		case FLASH_COMMAND_PROGRAM:
-			savedata->dirty |= mSAVEDATA_DIRT_NEW;
+			GBASavedataMarkDirty(savedata, savedata->currentBank - savedata->data + address, 1);
 			savedata->currentBank[address] = value;
 			savedata->command = FLASH_COMMAND_NONE;
 			mTimingDeschedule(savedata->timing, &savedata->dust);
@@ -484,12 +505,17 @@ static void _ensureEeprom(struct GBASavedata* savedata, uint32_t size) {
 		savedata->vf->truncate(savedata->vf, GBA_SIZE_EEPROM);
 		savedata->data = savedata->vf->map(savedata->vf, GBA_SIZE_EEPROM, savedata->mapMode);
 		memset(&savedata->data[GBA_SIZE_EEPROM512], 0xFF, GBA_SIZE_EEPROM - GBA_SIZE_EEPROM512);
+		_extendDirt(savedata, GBA_SIZE_EEPROM512, GBA_SIZE_EEPROM - GBA_SIZE_EEPROM512);
 	} else {
 		savedata->data = savedata->vf->map(savedata->vf, GBA_SIZE_EEPROM, savedata->mapMode);
 	}
 }
 
 void GBASavedataWriteEEPROM(struct GBASavedata* savedata, uint16_t value, uint32_t writeSize) {
+	GBASavedataWriteEEPROMAhead(savedata, value, writeSize, 0);
+}
+
+void GBASavedataWriteEEPROMAhead(struct GBASavedata* savedata, uint16_t value, uint32_t writeSize, int32_t cyclesAhead) {
 	switch (savedata->command) {
 	// Read header
 	case EEPROM_COMMAND_NULL:
@@ -518,10 +544,10 @@ void GBASavedataWriteEEPROM(struct GBASavedata* savedata, uint16_t value, uint32
 			uint8_t current = savedata->data[savedata->writeAddress >> 3];
 			current &= ~(1 << (0x7 - (savedata->writeAddress & 0x7)));
 			current |= (value & 0x1) << (0x7 - (savedata->writeAddress & 0x7));
-			savedata->dirty |= mSAVEDATA_DIRT_NEW;
+			GBASavedataMarkDirty(savedata, savedata->writeAddress >> 3, 1);
 			savedata->data[savedata->writeAddress >> 3] = current;
 			mTimingDeschedule(savedata->timing, &savedata->dust);
-			mTimingSchedule(savedata->timing, &savedata->dust, EEPROM_SETTLE_CYCLES);
+			mTimingSchedule(savedata->timing, &savedata->dust, EEPROM_SETTLE_CYCLES + cyclesAhead);
 			++savedata->writeAddress;
 		} else {
 			mLOG(GBA_SAVE, GAME_ERROR, "Writing beyond end of EEPROM: %08X", (savedata->writeAddress >> 3));
@@ -568,6 +594,11 @@ uint16_t GBASavedataReadEEPROM(struct GBASavedata* savedata) {
 	return 0;
 }
 
+void GBASavedataMarkDirty(struct GBASavedata* savedata, uint32_t offset, uint32_t size) {
+	savedata->dirty |= mSAVEDATA_DIRT_NEW;
+	_extendDirt(savedata, offset, size);
+}
+
 void GBASavedataClean(struct GBASavedata* savedata, uint32_t frameCount) {
 	if (!savedata->vf) {
 		return;
@@ -578,7 +609,15 @@ void GBASavedataClean(struct GBASavedata* savedata, uint32_t frameCount) {
 		}
 		if (savedata->mapMode & MAP_WRITE) {
 			size_t size = GBASavedataSize(savedata);
-			if (savedata->data && savedata->vf->sync(savedata->vf, savedata->data, size)) {
+			size_t start = 0;
+			if (savedata->dirtStart < savedata->dirtEnd && savedata->dirtEnd <= size) {
+				// Only write back what changed, which matters on platforms where syncing rewrites the file
+				start = savedata->dirtStart;
+				size = savedata->dirtEnd - start;
+			}
+			if (savedata->data && savedata->vf->sync(savedata->vf, &savedata->data[start], size)) {
+				savedata->dirtStart = 0;
+				savedata->dirtEnd = 0;
 				GBASavedataRTCWrite(savedata);
 				mLOG(GBA_SAVE, INFO, "Savedata synced");
 			} else {
@@ -752,6 +791,7 @@ void _flashSwitchBank(struct GBASavedata* savedata, int bank) {
 				savedata->vf->truncate(savedata->vf, GBA_SIZE_FLASH1M);
 				savedata->data = savedata->vf->map(savedata->vf, GBA_SIZE_FLASH1M, MAP_WRITE);
 				memset(&savedata->data[GBA_SIZE_FLASH512], 0xFF, GBA_SIZE_FLASH512);
+				_extendDirt(savedata, GBA_SIZE_FLASH512, GBA_SIZE_FLASH512);
 			} else {
 				savedata->data = savedata->vf->map(savedata->vf, GBA_SIZE_FLASH1M, MAP_WRITE);
 			}
@@ -762,17 +802,16 @@ void _flashSwitchBank(struct GBASavedata* savedata, int bank) {
 
 void _flashErase(struct GBASavedata* savedata) {
 	mLOG(GBA_SAVE, DEBUG, "Performing flash chip erase");
-	savedata->dirty |= mSAVEDATA_DIRT_NEW;
 	size_t size = GBA_SIZE_FLASH512;
 	if (savedata->type == SAVEDATA_FLASH1M) {
 		size = GBA_SIZE_FLASH1M;
 	}
+	GBASavedataMarkDirty(savedata, 0, size);
 	memset(savedata->data, 0xFF, size);
 }
 
 void _flashEraseSector(struct GBASavedata* savedata, uint16_t sectorStart) {
 	mLOG(GBA_SAVE, DEBUG, "Performing flash sector erase at 0x%04x", sectorStart);
-	savedata->dirty |= mSAVEDATA_DIRT_NEW;
 	size_t size = 0x1000;
 	if (savedata->type == SAVEDATA_FLASH1M) {
 		mLOG(GBA_SAVE, DEBUG, "Performing unknown sector-size erase at 0x%04x", sectorStart);
@@ -780,5 +819,6 @@ void _flashEraseSector(struct GBASavedata* savedata, uint16_t sectorStart) {
 	savedata->settling = sectorStart >> 12;
 	mTimingDeschedule(savedata->timing, &savedata->dust);
 	mTimingSchedule(savedata->timing, &savedata->dust, FLASH_ERASE_CYCLES);
+	GBASavedataMarkDirty(savedata, savedata->currentBank - savedata->data + (sectorStart & ~(size - 1)), size);
 	memset(&savedata->currentBank[sectorStart & ~(size - 1)], 0xFF, size);
 }
@@ -24,7 +24,7 @@ struct GBABundledState {
 	struct mStateExtdata* extdata;
 };
 
-void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
+static void _serialize(struct GBA* gba, struct GBASerializedState* state, uint32_t* epoch) {
 	STORE_32(GBASavestateMagic + GBASavestateVersion, 0, &state->versionMagic);
 	STORE_32(gba->biosChecksum, 0, &state->biosChecksum);
 	STORE_32(gba->romCrc32, 0, &state->romCrc32);
@@ -72,7 +72,11 @@ void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
 	STORE_32(miscFlags, 0, &state->miscFlags);
 	STORE_32(gba->biosStall, 0, &state->biosStall);
 
-	GBAMemorySerialize(&gba->memory, state);
+	if (epoch) {
+		GBAMemorySerializeIncremental(&gba->memory, state, epoch);
+	} else {
+		GBAMemorySerialize(&gba->memory, state);
+	}
 	GBAIOSerialize(gba, state);
 	GBAVideoSerialize(&gba->video, state);
 	GBAAudioSerialize(&gba->audio, state);
@@ -83,6 +87,14 @@ void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
 	}
 }
 
+void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
+	_serialize(gba, state, NULL);
+}
+
+void GBASerializeIncremental(struct GBA* gba, struct GBASerializedState* state, uint32_t* epoch) {
+	_serialize(gba, state, epoch);
+}
+
 bool GBADeserialize(struct GBA* gba, const struct GBASerializedState* state) {
 	bool error = false;
 	int32_t check;
@@ -12,6 +12,7 @@
 #define CYCLES_PER_BIT (GBA_ARM7TDMI_FREQUENCY / BITS_PER_SECOND)
 #define CLOCK_GRAIN (CYCLES_PER_BIT * 8)
 #define CLOCK_WAIT 500
+#define DEFAULT_RUN_AHEAD (CLOCK_GRAIN * 16)
 
 const uint16_t DOLPHIN_CLOCK_PORT = 49420;
 const uint16_t DOLPHIN_DATA_PORT = 54970;
@@ -43,6 +44,9 @@ void GBASIODolphinCreate(struct GBASIODolphin* dol) {
 	dol->data = INVALID_SOCKET;
 	dol->clock = INVALID_SOCKET;
 	dol->active = false;
+	dol->runAhead = DEFAULT_RUN_AHEAD;
+	dol->clockBufferSize = 0;
+	dol->dataBufferSize = 0;
 }
 
 void GBASIODolphinDestroy(struct GBASIODolphin* dol) {
@@ -89,6 +93,9 @@ bool GBASIODolphinConnect(struct GBASIODolphin* dol, const struct Address* addre
 	SocketSetBlocking(dol->data, false);
 	SocketSetBlocking(dol->clock, false);
 	SocketSetTCPPush(dol->data, true);
+	SocketSetTCPPush(dol->clock, true);
+	dol->clockBufferSize = 0;
+	dol->dataBufferSize = 0;
 	return true;
 }
 
@@ -116,6 +123,23 @@ static bool GBASIODolphinUnload(struct GBASIODriver* driver) {
 	return true;
 }
 
+// Pulls in everything that's arrived with a single read, so commands and clocks can be picked out of
+// the buffer without going back to the socket for each piece
+static void _fill(Socket socket, uint8_t* buffer, size_t* size, size_t capacity) {
+	if (*size == capacity) {
+		return;
+	}
+	ssize_t gotten = SocketRecv(socket, &buffer[*size], capacity - *size);
+	if (gotten > 0) {
+		*size += gotten;
+	}
+}
+
+static void _consume(uint8_t* buffer, size_t* size, size_t length) {
+	*size -= length;
+	memmove(buffer, &buffer[length], *size);
+}
+
 void GBASIODolphinProcessEvents(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	struct GBASIODolphin* dol = context;
 	if (SOCKET_FAILED(dol->data)) {
@@ -124,19 +148,24 @@ void GBASIODolphinProcessEvents(struct mTiming* timing, void* context, uint32_t
 
 	dol->clockSlice -= cyclesLate;
 
-	int32_t clockSlice;
-
 	int32_t nextEvent = CLOCK_GRAIN;
 	switch (dol->state) {
 	case WAIT_FOR_FIRST_CLOCK:
 		dol->clockSlice = 0;
 		// Fall through
 	case WAIT_FOR_CLOCK:
-		if (dol->clockSlice < 0) {
-			Socket r = dol->clock;
-			SocketPoll(1, &r, 0, 0, CLOCK_WAIT);
+		if (dol->clockBufferSize < 4) {
+			// Only stop and wait once the core has gotten too far ahead of Dolphin
+			if (dol->clockSlice < -dol->runAhead) {
+				Socket r = dol->clock;
+				SocketPoll(1, &r, 0, 0, CLOCK_WAIT);
+			}
+			_fill(dol->clock, dol->clockBuffer, &dol->clockBufferSize, sizeof(dol->clockBuffer));
 		}
-		if (SocketRecv(dol->clock, &clockSlice, 4) == 4) {
+		if (dol->clockBufferSize >= 4) {
+			int32_t clockSlice;
+			memcpy(&clockSlice, dol->clockBuffer, 4);
+			_consume(dol->clockBuffer, &dol->clockBufferSize, 4);
 			clockSlice = ntohl(clockSlice);
 			dol->clockSlice += clockSlice;
 			dol->state = WAIT_FOR_COMMAND;
@@ -163,33 +192,40 @@ void _flush(struct GBASIODolphin* dol) {
 	uint8_t buffer[32];
 	while (SocketRecv(dol->clock, buffer, sizeof(buffer)) == sizeof(buffer));
 	while (SocketRecv(dol->data, buffer, sizeof(buffer)) == sizeof(buffer));
+	dol->clockBufferSize = 0;
+	dol->dataBufferSize = 0;
 }
 
 int32_t _processCommand(struct GBASIODolphin* dol, uint32_t cyclesLate) {
 	// This does not include the stop bits due to compatibility reasons
 	int bitsOnLine = 8;
-	uint8_t buffer[6];
-	int gotten = SocketRecv(dol->data, buffer, 1);
-	if (gotten < 1) {
+	_fill(dol->data, dol->dataBuffer, &dol->dataBufferSize, sizeof(dol->dataBuffer));
+	if (dol->dataBufferSize < 1) {
 		return -1;
 	}
 
+	uint8_t buffer[6];
+	size_t length = 1;
+	buffer[0] = dol->dataBuffer[0];
 	switch (buffer[0]) {
 	case JOY_RESET:
 	case JOY_POLL:
 		bitsOnLine += 24;
 		break;
 	case JOY_RECV:
-		gotten = SocketRecv(dol->data, &buffer[1], 4);
-		if (gotten < 4) {
+		// Leave a partial command where it is until the rest of it shows up
+		if (dol->dataBufferSize < 5) {
 			return -1;
 		}
+		memcpy(&buffer[1], &dol->dataBuffer[1], 4);
+		length = 5;
 		mLOG(GBA_SIO, DEBUG, "DOL recv: %02X%02X%02X%02X", buffer[1], buffer[2], buffer[3], buffer[4]);
 		// Fall through
 	case JOY_TRANS:
 		bitsOnLine += 40;
 		break;
 	}
+	_consume(dol->dataBuffer, &dol->dataBufferSize, length);
 
 	if (!dol->active) {
 		return 0;
@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gba/sio/lockstep.h>
 
+#include <mgba/core/core.h>
 #include <mgba/internal/gba/gba.h>
 #include <mgba/internal/gba/io.h>
 
@@ -574,3 +575,157 @@ static uint16_t GBASIOLockstepNodeNormalWriteRegister(struct GBASIODriver* drive
 
 	return value;
 }
+
+static bool _hubSignal(struct mLockstep* lockstep, unsigned mask) {
+	struct GBASIOLockstepHub* hub = lockstep->context;
+	hub->waitMask &= ~mask;
+	if (!hub->waitMask && hub->asleep[0]) {
+		hub->asleep[0] = false;
+		return true;
+	}
+	return false;
+}
+
+static bool _hubWait(struct mLockstep* lockstep, unsigned mask) {
+	struct GBASIOLockstepHub* hub = lockstep->context;
+	hub->waitMask |= mask;
+	if (!hub->asleep[0]) {
+		hub->asleep[0] = true;
+		return true;
+	}
+	return false;
+}
+
+static void _hubAddCycles(struct mLockstep* lockstep, int id, int32_t cycles) {
+	struct GBASIOLockstepHub* hub = lockstep->context;
+	if (id) {
+		hub->cyclesPosted[id] += cycles;
+		return;
+	}
+	int i;
+	for (i = 1; i < lockstep->attached; ++i) {
+		struct GBASIOLockstepNode* node = hub->d.players[i];
+		if (node->d.p->mode > SIO_MULTI) {
+			continue;
+		}
+		hub->cyclesPosted[i] += cycles;
+		if (hub->asleep[i]) {
+			node->nextEvent += hub->cyclesPosted[i];
+			hub->asleep[i] = false;
+		}
+	}
+}
+
+static int32_t _hubUseCycles(struct mLockstep* lockstep, int id, int32_t cycles) {
+	struct GBASIOLockstepHub* hub = lockstep->context;
+	hub->cyclesPosted[id] -= cycles;
+	if (hub->cyclesPosted[id] <= 0) {
+		hub->asleep[id] = true;
+	}
+	return hub->cyclesPosted[id];
+}
+
+static int32_t _hubUnusedCycles(struct mLockstep* lockstep, int id) {
+	struct GBASIOLockstepHub* hub = lockstep->context;
+	return hub->cyclesPosted[id];
+}
+
+static void _hubUnload(struct mLockstep* lockstep, int id) {
+	struct GBASIOLockstepHub* hub = lockstep->context;
+	if (id) {
+		hub->cyclesPosted[id] = 0;
+		// Don't leave player 1 waiting on a player that's gone
+		_hubSignal(lockstep, 1 << id);
+		return;
+	}
+	int i;
+	for (i = 1; i < lockstep->attached; ++i) {
+		hub->cyclesPosted[i] += hub->d.players[0]->eventDiff;
+		if (hub->asleep[i]) {
+			hub->d.players[i]->nextEvent += hub->cyclesPosted[i];
+			hub->asleep[i] = false;
+		}
+	}
+}
+
+void GBASIOLockstepHubInit(struct GBASIOLockstepHub* hub) {
+	memset(hub, 0, sizeof(*hub));
+	GBASIOLockstepInit(&hub->d);
+	mLockstepInit(&hub->d.d);
+	hub->d.d.signal = _hubSignal;
+	hub->d.d.wait = _hubWait;
+	hub->d.d.addCycles = _hubAddCycles;
+	hub->d.d.useCycles = _hubUseCycles;
+	hub->d.d.unusedCycles = _hubUnusedCycles;
+	hub->d.d.unload = _hubUnload;
+	hub->d.d.context = hub;
+}
+
+void GBASIOLockstepHubDeinit(struct GBASIOLockstepHub* hub) {
+	int i;
+	for (i = hub->d.d.attached - 1; i >= 0; --i) {
+		struct GBA* gba = hub->cores[i]->board;
+		GBASIOSetDriver(&gba->sio, NULL, SIO_MULTI);
+		GBASIOSetDriver(&gba->sio, NULL, SIO_NORMAL_32);
+		GBASIOLockstepDetachNode(&hub->d, &hub->nodes[i]);
+		hub->cores[i] = NULL;
+	}
+	mLockstepDeinit(&hub->d.d);
+}
+
+bool GBASIOLockstepHubAttachCore(struct GBASIOLockstepHub* hub, struct mCore* core) {
+	if (core->platform(core) != mPLATFORM_GBA) {
+		return false;
+	}
+	int id = hub->d.d.attached;
+	if (id == MAX_GBAS) {
+		return false;
+	}
+	struct GBASIOLockstepNode* node = &hub->nodes[id];
+	GBASIOLockstepNodeCreate(node);
+	if (!GBASIOLockstepAttachNode(&hub->d, node)) {
+		return false;
+	}
+	hub->cores[id] = core;
+	hub->cyclesPosted[id] = 0;
+	hub->asleep[id] = false;
+
+	struct GBA* gba = core->board;
+	GBASIOSetDriver(&gba->sio, &node->d, SIO_MULTI);
+	GBASIOSetDriver(&gba->sio, &node->d, SIO_NORMAL_32);
+	return true;
+}
+
+static void _hubRunPlayer(struct GBASIOLockstepHub* hub, int id) {
+	struct mCore* core = hub->cores[id];
+	uint32_t frame = core->frameCounter(core);
+	// A player that falls asleep exits its run loop early, so it gets no further than its sync point
+	while (!hub->asleep[id] && core->frameCounter(core) == frame) {
+		core->runLoop(core);
+	}
+}
+
+bool GBASIOLockstepHubRunFrame(struct GBASIOLockstepHub* hub) {
+	int attached = hub->d.d.attached;
+	if (!attached) {
+		return false;
+	}
+	struct mCore* master = hub->cores[0];
+	uint32_t frame = master->frameCounter(master);
+	while (master->frameCounter(master) == frame) {
+		bool ran = false;
+		int i;
+		for (i = 0; i < attached; ++i) {
+			if (hub->asleep[i]) {
+				continue;
+			}
+			_hubRunPlayer(hub, i);
+			ran = true;
+		}
+		if (!ran) {
+			mLOG(GBA_SIO, ERROR, "Lockstep hub: Every player is waiting on another");
+			return false;
+		}
+	}
+	return true;
+}
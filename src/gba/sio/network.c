@@ -0,0 +1,378 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gba/sio/network.h>
+
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/io.h>
+
+#define NETWORK_MAGIC 0x4E53476D // "mGSN"
+#define POLL_INTERVAL 2048
+// Unacknowledged entries get sent again this often, and so does an empty packet to keep the link alive
+#define RESEND_INTERVAL 0x10000
+
+#define HEADER_SIZE 12
+#define ENTRY_SIZE 16
+#define PACKET_SIZE (HEADER_SIZE + ENTRY_SIZE * GBA_SIO_NETWORK_QUEUE)
+
+enum {
+	NETWORK_TRANSFER = 1,
+	NETWORK_REPLY = 2,
+};
+
+static bool GBASIONetworkInit(struct GBASIODriver* driver);
+static bool GBASIONetworkLoad(struct GBASIODriver* driver);
+static bool GBASIONetworkUnload(struct GBASIODriver* driver);
+static uint16_t GBASIONetworkWriteRegister(struct GBASIODriver* driver, uint32_t address, uint16_t value);
+static void _GBASIONetworkProcessEvents(struct mTiming* timing, void* context, uint32_t cyclesLate);
+
+void GBASIONetworkCreate(struct GBASIONetwork* net) {
+	memset(net, 0, sizeof(*net));
+	net->d.init = GBASIONetworkInit;
+	net->d.load = GBASIONetworkLoad;
+	net->d.unload = GBASIONetworkUnload;
+	net->d.writeRegister = GBASIONetworkWriteRegister;
+
+	net->event.context = net;
+	net->event.name = "GBA SIO Network";
+	net->event.callback = _GBASIONetworkProcessEvents;
+	net->event.priority = 0x80;
+
+	net->socket = INVALID_SOCKET;
+}
+
+void GBASIONetworkDestroy(struct GBASIONetwork* net) {
+	if (!SOCKET_FAILED(net->socket)) {
+		SocketClose(net->socket);
+		net->socket = INVALID_SOCKET;
+	}
+}
+
+bool GBASIONetworkOpen(struct GBASIONetwork* net, int port, const struct Address* peer, int peerPort, int id) {
+	if (id < 0 || id > 1) {
+		return false;
+	}
+	GBASIONetworkDestroy(net);
+	net->socket = SocketOpenUDP(port, NULL);
+	if (SOCKET_FAILED(net->socket)) {
+		return false;
+	}
+	SocketSetBlocking(net->socket, false);
+	net->peer = *peer;
+	net->peerPort = peerPort;
+	net->id = id;
+	net->connected = false;
+	net->outboxSize = 0;
+	net->nextSequence = 1;
+	net->received = 0;
+	net->dirty = true;
+	return true;
+}
+
+bool GBASIONetworkIsConnected(const struct GBASIONetwork* net) {
+	return net->connected;
+}
+
+static void _queue(struct GBASIONetwork* net, int type, enum GBASIOMode mode, uint32_t transfer, uint32_t data) {
+	if (net->outboxSize == GBA_SIO_NETWORK_QUEUE) {
+		// The peer has stopped acknowledging anything, so the oldest entry is as good as lost
+		mLOG(GBA_SIO, WARN, "Network: Outgoing queue is full");
+		memmove(&net->outbox[0], &net->outbox[1], sizeof(net->outbox[0]) * (GBA_SIO_NETWORK_QUEUE - 1));
+		--net->outboxSize;
+	}
+	struct GBASIONetworkEntry* entry = &net->outbox[net->outboxSize];
+	entry->sequence = net->nextSequence;
+	entry->transfer = transfer;
+	entry->type = type;
+	entry->mode = mode;
+	entry->data = data;
+	++net->nextSequence;
+	++net->outboxSize;
+	net->dirty = true;
+}
+
+static void _send(struct GBASIONetwork* net) {
+	uint8_t packet[PACKET_SIZE];
+	STORE_32LE(NETWORK_MAGIC, 0, packet);
+	STORE_32LE(net->received, 4, packet);
+	STORE_32LE(net->outboxSize, 8, packet);
+	size_t i;
+	for (i = 0; i < net->outboxSize; ++i) {
+		const struct GBASIONetworkEntry* entry = &net->outbox[i];
+		uint8_t* out = &packet[HEADER_SIZE + ENTRY_SIZE * i];
+		STORE_32LE(entry->sequence, 0, out);
+		STORE_32LE(entry->transfer, 4, out);
+		out[8] = entry->type;
+		out[9] = entry->mode;
+		out[10] = 0;
+		out[11] = 0;
+		STORE_32LE(entry->data, 12, out);
+	}
+	SocketSendTo(net->socket, packet, HEADER_SIZE + ENTRY_SIZE * net->outboxSize, &net->peer, net->peerPort);
+	net->dirty = false;
+	net->resendCycles = RESEND_INTERVAL;
+}
+
+static uint32_t _outgoingData(struct GBASIONetwork* net, enum GBASIOMode mode) {
+	uint16_t* io = net->d.p->p->memory.io;
+	switch (mode) {
+	case SIO_MULTI:
+		return io[GBA_REG(SIOMLT_SEND)];
+	case SIO_NORMAL_8:
+		return io[GBA_REG(SIODATA8)] & 0xFF;
+	case SIO_NORMAL_32:
+		return io[GBA_REG(SIODATA32_LO)] | (io[GBA_REG(SIODATA32_HI)] << 16);
+	default:
+		return 0xFFFFFFFF;
+	}
+}
+
+static void _finishTransfer(struct GBASIONetwork* net, enum GBASIOMode mode, uint32_t master, uint32_t slave) {
+	struct GBASIO* sio = net->d.p;
+	uint16_t* io = sio->p->memory.io;
+	uint32_t other = net->id ? master : slave;
+	switch (mode) {
+	case SIO_MULTI:
+		io[GBA_REG(SIOMULTI0)] = master;
+		io[GBA_REG(SIOMULTI1)] = slave;
+		io[GBA_REG(SIOMULTI2)] = 0xFFFF;
+		io[GBA_REG(SIOMULTI3)] = 0xFFFF;
+		sio->rcnt |= 1;
+		sio->siocnt = GBASIOMultiplayerClearBusy(sio->siocnt);
+		sio->siocnt = GBASIOMultiplayerSetId(sio->siocnt, net->id);
+		if (GBASIOMultiplayerIsIrq(sio->siocnt)) {
+			GBARaiseIRQ(sio->p, GBA_IRQ_SIO, 0);
+		}
+		break;
+	case SIO_NORMAL_8:
+		sio->siocnt = GBASIONormalClearStart(sio->siocnt);
+		io[GBA_REG(SIODATA8)] = other & 0xFF;
+		if (GBASIONormalIsIrq(sio->siocnt)) {
+			GBARaiseIRQ(sio->p, GBA_IRQ_SIO, 0);
+		}
+		break;
+	case SIO_NORMAL_32:
+		sio->siocnt = GBASIONormalClearStart(sio->siocnt);
+		io[GBA_REG(SIODATA32_LO)] = other;
+		io[GBA_REG(SIODATA32_HI)] = other >> 16;
+		if (GBASIONormalIsIrq(sio->siocnt)) {
+			GBARaiseIRQ(sio->p, GBA_IRQ_SIO, 0);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void _handleEntry(struct GBASIONetwork* net, const struct GBASIONetworkEntry* entry) {
+	switch (entry->type) {
+	case NETWORK_TRANSFER:
+		if (!net->id) {
+			break;
+		}
+		if (entry->mode != net->mode) {
+			// Nothing's listening on this end, which looks like an unplugged cable from the other end
+			_queue(net, NETWORK_REPLY, entry->mode, entry->sequence, 0xFFFFFFFF);
+		} else {
+			uint32_t data = _outgoingData(net, net->mode);
+			_queue(net, NETWORK_REPLY, entry->mode, entry->sequence, data);
+			_finishTransfer(net, net->mode, entry->data, data);
+		}
+		break;
+	case NETWORK_REPLY:
+		if (net->transferPending && entry->transfer == net->transferSequence) {
+			net->replyReceived = true;
+			net->reply = entry->data;
+		}
+		break;
+	default:
+		mLOG(GBA_SIO, GAME_ERROR, "Network: Unknown entry type %i", entry->type);
+		break;
+	}
+}
+
+static bool _isPeer(const struct GBASIONetwork* net, const struct Address* address) {
+	if (address->version != net->peer.version) {
+		return false;
+	}
+	if (address->version == IPV4) {
+		return address->ipv4 == net->peer.ipv4;
+	}
+	return memcmp(address->ipv6, net->peer.ipv6, sizeof(address->ipv6)) == 0;
+}
+
+static void _receive(struct GBASIONetwork* net) {
+	uint8_t packet[PACKET_SIZE];
+	struct Address address;
+	int port = -1;
+	ssize_t size;
+	memset(&address, 0, sizeof(address));
+	while ((size = SocketRecvFrom(net->socket, packet, sizeof(packet), &address, &port)) >= HEADER_SIZE) {
+		uint32_t magic;
+		uint32_t ack;
+		uint32_t count;
+		LOAD_32LE(magic, 0, packet);
+		LOAD_32LE(ack, 4, packet);
+		LOAD_32LE(count, 8, packet);
+		if (magic != NETWORK_MAGIC || count > GBA_SIO_NETWORK_QUEUE || (size_t) size < HEADER_SIZE + ENTRY_SIZE * count) {
+			continue;
+		}
+		if (port != net->peerPort || !_isPeer(net, &address)) {
+			continue;
+		}
+		net->connected = true;
+
+		size_t acked = 0;
+		while (acked < net->outboxSize && (int32_t) (net->outbox[acked].sequence - ack) <= 0) {
+			++acked;
+		}
+		if (acked) {
+			memmove(&net->outbox[0], &net->outbox[acked], sizeof(net->outbox[0]) * (net->outboxSize - acked));
+			net->outboxSize -= acked;
+		}
+
+		uint32_t i;
+		for (i = 0; i < count; ++i) {
+			const uint8_t* in = &packet[HEADER_SIZE + ENTRY_SIZE * i];
+			struct GBASIONetworkEntry entry;
+			LOAD_32LE(entry.sequence, 0, in);
+			// Entries always go out in order, so anything after a gap will be sent again
+			if (entry.sequence != net->received + 1) {
+				continue;
+			}
+			LOAD_32LE(entry.transfer, 4, in);
+			entry.type = in[8];
+			entry.mode = in[9];
+			LOAD_32LE(entry.data, 12, in);
+			net->received = entry.sequence;
+			net->dirty = true;
+			_handleEntry(net, &entry);
+		}
+	}
+}
+
+static void _startTransfer(struct GBASIONetwork* net, int32_t cycles) {
+	net->transferPending = true;
+	net->replyReceived = false;
+	net->transferCycles = cycles;
+	net->transferSequence = net->nextSequence;
+	_queue(net, NETWORK_TRANSFER, net->mode, 0, _outgoingData(net, net->mode));
+	// Get it out right away rather than waiting for the next poll
+	_send(net);
+}
+
+static void _updateMultiplayer(struct GBASIONetwork* net) {
+	struct GBASIO* sio = net->d.p;
+	sio->siocnt = GBASIOMultiplayerSetSlave(sio->siocnt, net->id > 0);
+	sio->siocnt = GBASIOMultiplayerSetReady(sio->siocnt, net->connected);
+}
+
+static bool GBASIONetworkInit(struct GBASIODriver* driver) {
+	struct GBASIONetwork* net = (struct GBASIONetwork*) driver;
+	net->transferPending = false;
+	return true;
+}
+
+static bool GBASIONetworkLoad(struct GBASIODriver* driver) {
+	struct GBASIONetwork* net = (struct GBASIONetwork*) driver;
+	net->mode = driver->p->mode;
+	net->transferPending = false;
+	if (net->mode == SIO_MULTI) {
+		driver->p->rcnt |= 3;
+		if (net->id) {
+			driver->p->rcnt |= 4;
+		} else {
+			driver->p->rcnt &= ~4;
+		}
+		_updateMultiplayer(net);
+	}
+	mTimingDeschedule(&driver->p->p->timing, &net->event);
+	mTimingSchedule(&driver->p->p->timing, &net->event, 0);
+	return true;
+}
+
+static bool GBASIONetworkUnload(struct GBASIODriver* driver) {
+	struct GBASIONetwork* net = (struct GBASIONetwork*) driver;
+	mTimingDeschedule(&driver->p->p->timing, &net->event);
+	net->transferPending = false;
+	net->mode = SIO_GPIO;
+	return true;
+}
+
+static uint16_t GBASIONetworkWriteRegister(struct GBASIODriver* driver, uint32_t address, uint16_t value) {
+	struct GBASIONetwork* net = (struct GBASIONetwork*) driver;
+	if (address != GBA_REG_SIOCNT) {
+		return value;
+	}
+	switch (net->mode) {
+	case SIO_MULTI:
+		_updateMultiplayer(net);
+		if (value & 0x0080 && !net->transferPending) {
+			if (!net->id) {
+				mLOG(GBA_SIO, DEBUG, "Network: Transfer initiated");
+				_startTransfer(net, GBASIOCyclesPerTransfer[GBASIOMultiplayerGetBaud(value)][1]);
+			} else {
+				value &= ~0x0080;
+			}
+		}
+		value &= 0xFF83;
+		value |= driver->p->siocnt & 0x00FC;
+		break;
+	case SIO_NORMAL_8:
+	case SIO_NORMAL_32:
+		value &= 0xFF8B;
+		// Player 2 runs off player 1's clock, so its transfers finish whenever player 1's arrive
+		if ((value & 0x0081) == 0x0081 && !net->id && !net->transferPending) {
+			int32_t cycles;
+			if (value & 2) {
+				cycles = 8 * 8;
+			} else {
+				cycles = 64 * 8;
+			}
+			if (value & 0x1000) {
+				cycles *= 4;
+			}
+			mLOG(GBA_SIO, DEBUG, "Network: Transfer initiated");
+			_startTransfer(net, cycles);
+		}
+		break;
+	default:
+		break;
+	}
+	return value;
+}
+
+static void _GBASIONetworkProcessEvents(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	struct GBASIONetwork* net = context;
+	if (SOCKET_FAILED(net->socket)) {
+		return;
+	}
+	net->resendCycles -= POLL_INTERVAL;
+
+	_receive(net);
+	if (net->mode == SIO_MULTI) {
+		_updateMultiplayer(net);
+	}
+
+	if (net->transferPending) {
+		net->transferCycles -= POLL_INTERVAL;
+		if (net->transferCycles <= 0) {
+			uint32_t data = _outgoingData(net, net->mode);
+			if (net->replyReceived) {
+				net->transferPending = false;
+				_finishTransfer(net, net->mode, data, net->reply);
+			} else if (!net->connected) {
+				// No one's on the other end, so it finishes the way it would with nothing plugged in
+				net->transferPending = false;
+				_finishTransfer(net, net->mode, data, 0xFFFFFFFF);
+			}
+		}
+	}
+
+	if (net->dirty || net->resendCycles <= 0) {
+		_send(net);
+	}
+	mTimingSchedule(timing, &net->event, POLL_INTERVAL - cyclesLate);
+}
@@ -0,0 +1,231 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/internal/arm/isa-inlines.h>
+#include <mgba/internal/gba/bios.h>
+
+#include "gba/test/test-gba.h"
+
+static uint32_t _shimLoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	return GBALoad8(cpu, address, cycleCounter);
+}
+
+M_TEST_DEFINE(hleLz77) {
+	static const uint8_t compressed[] = {
+		0x10, 0x20, 0x00, 0x00,
+		0x40, 'a', 0xF0, 0x00, 'b', 'c', 'd', 'e', 'f', 'g',
+		0x00, 'h', 'i', 'j', 'k', 'l', 'm', 'n',
+	};
+	static const char expected[] = "aaaaaaaaaaaaaaaaaaabcdefghijklmn";
+	uint32_t rom[0x2000] = {
+		0xEAFFFFFE, // b .
+	};
+	memcpy(&rom[0x40], compressed, sizeof(compressed));
+	struct mCore* cores[2] = {
+		mTestGBACoreLoad(rom, sizeof(rom), NULL),
+		mTestGBACoreLoad(rom, sizeof(rom), NULL),
+	};
+	// Hooking loads forces every byte through the bus
+	((struct ARMCore*) cores[1]->cpu)->memory.load8 = _shimLoad8;
+	uint32_t stall[2];
+	size_t i;
+	for (i = 0; i < 2; ++i) {
+		struct GBA* gba = cores[i]->board;
+		struct ARMCore* cpu = cores[i]->cpu;
+
+		cpu->gprs[0] = GBA_BASE_ROM0 + 0x100;
+		cpu->gprs[1] = GBA_BASE_EWRAM + 0x400;
+		GBASwi16(cpu, GBA_SWI_LZ77_UNCOMP_WRAM);
+		assert_int_equal(cpu->gprs[1], GBA_BASE_EWRAM + 0x420);
+		size_t j;
+		for (j = 0; j < sizeof(expected) - 1; ++j) {
+			assert_int_equal(cores[i]->busRead8(cores[i], GBA_BASE_EWRAM + 0x400 + j), expected[j]);
+		}
+		stall[i] = gba->biosStall;
+	}
+	// Copying runs directly must charge the same cycles as going byte by byte
+	assert_int_equal(stall[0], stall[1]);
+
+	mTestGBACoresDestroy(cores, 2);
+}
+
+struct CpuSetCase {
+	int swi;
+	uint32_t source;
+	uint32_t dest;
+	uint32_t control;
+	uint32_t size;
+};
+
+static int32_t _runCpuSet(struct mCore* core, const struct CpuSetCase* test) {
+	struct GBA* gba = core->board;
+	struct ARMCore* cpu = core->cpu;
+	core->reset(core);
+	GBASkipBIOS(gba);
+	uint32_t i;
+	for (i = 0; i < 0x400; i += 4) {
+		core->busWrite32(core, GBA_BASE_EWRAM + i, i * 0x01010101 + 0x12345678);
+		core->busWrite32(core, GBA_BASE_IWRAM + i, ~i);
+	}
+	cpu->gprs[0] = test->source;
+	cpu->gprs[1] = test->dest;
+	cpu->gprs[2] = test->control;
+	uint32_t entry = GBA_BASE_ROM0 + (test->swi == GBA_SWI_CPU_FAST_SET ? 8 : 0);
+	cpu->gprs[ARM_PC] = entry;
+	ARMWritePC(cpu);
+	int32_t start = mTimingCurrentTime(&gba->timing);
+	for (i = 0; i < 0x10000 && cpu->gprs[ARM_PC] != entry + 4 + WORD_SIZE_ARM; ++i) {
+		ARMRun(cpu);
+	}
+	assert_int_not_equal(i, 0x10000);
+	return mTimingCurrentTime(&gba->timing) - start;
+}
+
+M_TEST_DEFINE(directCpuSet) {
+	static const struct CpuSetCase cases[] = {
+		{ GBA_SWI_CPU_SET, GBA_BASE_ROM0 + 0x100, GBA_BASE_EWRAM + 0x800, 0x04000040, 0x100 },
+		{ GBA_SWI_CPU_SET, GBA_BASE_IWRAM + 0x10, GBA_BASE_VRAM + 0x10002, 0x01000065, 0xCA },
+		{ GBA_SWI_CPU_SET, GBA_BASE_EWRAM + 0x40, GBA_BASE_IWRAM + 0x800, 0x00000031, 0x62 },
+		{ GBA_SWI_CPU_SET, GBA_BASE_EWRAM + 0x40, GBA_BASE_EWRAM + 0x42, 0x00000031, 0x62 },
+		{ GBA_SWI_CPU_FAST_SET, GBA_BASE_EWRAM, GBA_BASE_VRAM + 0x3FE0, 0x0000003C, 0x100 },
+		{ GBA_SWI_CPU_FAST_SET, GBA_BASE_IWRAM + 0x20, GBA_BASE_IWRAM + 0x1000, 0x01000011, 0x60 },
+		// Too close together to copy directly, so these still go through the BIOS
+		{ GBA_SWI_CPU_FAST_SET, GBA_BASE_EWRAM, GBA_BASE_EWRAM + 0x10, 0x00000020, 0x80 },
+		{ GBA_SWI_CPU_SET, GBA_BASE_EWRAM, GBA_BASE_SRAM, 0x04000010, 0 },
+	};
+	static const uint32_t code[] = {
+		0xEF0B0000, // swi 0xB0000
+		0xEAFFFFFE, // b .
+		0xEF0C0000, // swi 0xC0000
+		0xEAFFFFFE, // b .
+	};
+	uint32_t rom[0x2000] = { 0 };
+	memcpy(rom, code, sizeof(code));
+	size_t i;
+	for (i = 0; i < 0x40; ++i) {
+		rom[0x40 + i] = i * 0x11111111;
+	}
+	struct mCore* cores[2] = {
+		mTestGBACoreLoad(rom, sizeof(rom), NULL),
+		mTestGBACoreLoad(rom, sizeof(rom), NULL),
+	};
+	mCoreConfigSetIntValue(&cores[1]->config, "gba.directCpuSet", 1);
+	cores[1]->reloadConfigOption(cores[1], "gba.directCpuSet", NULL);
+	assert_true(((struct GBA*) cores[1]->board)->directCpuSet);
+
+	for (i = 0; i < sizeof(cases) / sizeof(*cases); ++i) {
+		int32_t cycles[2];
+		cycles[0] = _runCpuSet(cores[0], &cases[i]);
+		cycles[1] = _runCpuSet(cores[1], &cases[i]);
+		struct ARMCore* cpus[2] = { cores[0]->cpu, cores[1]->cpu };
+		int r;
+		for (r = 0; r < 4; ++r) {
+			assert_int_equal(cpus[1]->gprs[r], cpus[0]->gprs[r]);
+		}
+		uint32_t j;
+		for (j = 0; j < cases[i].size; j += 2) {
+			assert_int_equal(cores[1]->busRead16(cores[1], cases[i].dest + j), cores[0]->busRead16(cores[0], cases[i].dest + j));
+		}
+		// The cycles are worked out rather than counted, so they can be off by a little
+		assert_true(cycles[1] >= cycles[0] - 4);
+		assert_true(cycles[1] <= cycles[0] + 4);
+	}
+
+	mTestGBACoresDestroy(cores, 2);
+}
+
+struct CountingWatcher {
+	struct mCoreMemoryWatcher d;
+	int writes;
+};
+
+static void _countWrite(struct mCoreMemoryWatcher* watcher, uint32_t address, int width, uint32_t value) {
+	UNUSED(address);
+	UNUSED(width);
+	UNUSED(value);
+	++((struct CountingWatcher*) watcher)->writes;
+}
+
+static uint64_t _vramWrites(struct mCore* core) {
+	struct mCoreMemoryStats stats[16];
+	size_t nStats = core->memoryStats(core, stats, 16);
+	size_t i;
+	for (i = 0; i < nStats; ++i) {
+		if (strcmp(stats[i].name, "vram") == 0) {
+			return stats[i].writes;
+		}
+	}
+	fail();
+	return 0;
+}
+
+M_TEST_DEFINE(hleLz77Observed) {
+	static const uint8_t compressed[] = {
+		0x10, 0x20, 0x00, 0x00,
+		0x40, 'a', 0xF0, 0x00, 'b', 'c', 'd', 'e', 'f', 'g',
+		0x00, 'h', 'i', 'j', 'k', 'l', 'm', 'n',
+	};
+	uint32_t rom[0x2000] = {
+		0xEAFFFFFE, // b .
+	};
+	memcpy(&rom[0x40], compressed, sizeof(compressed));
+	struct mCore* core = mTestGBACoreLoad(rom, sizeof(rom), NULL);
+	struct ARMCore* cpu = core->cpu;
+	// Forced blank keeps VRAM from stalling, so only the watcher or stats can hold back the direct path
+	GBAIOWrite(core->board, GBA_REG_DISPCNT, 0x0080);
+
+	struct CountingWatcher watcher = { .d = { .written = _countWrite } };
+	static const struct mCoreMemoryWatchRange range = { GBA_BASE_VRAM, GBA_BASE_VRAM + 0x100 };
+	assert_true(core->setMemoryWatcher(core, &watcher.d, &range, 1));
+	cpu->gprs[0] = GBA_BASE_ROM0 + 0x100;
+	cpu->gprs[1] = GBA_BASE_VRAM;
+	GBASwi16(cpu, GBA_SWI_LZ77_UNCOMP_VRAM);
+	assert_int_equal(watcher.writes, 0x10);
+	core->setMemoryWatcher(core, NULL, NULL, 0);
+
+	assert_true(core->setMemoryStatsEnabled(core, true));
+	cpu->gprs[0] = GBA_BASE_ROM0 + 0x100;
+	cpu->gprs[1] = GBA_BASE_VRAM;
+	GBASwi16(cpu, GBA_SWI_LZ77_UNCOMP_VRAM);
+	assert_int_equal(_vramWrites(core), 0x10);
+	core->setMemoryStatsEnabled(core, false);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_DEFINE(directCpuSetObserved) {
+	static const struct CpuSetCase test = { GBA_SWI_CPU_SET, GBA_BASE_IWRAM + 0x10, GBA_BASE_VRAM + 0x2, 0x00000040, 0x80 };
+	uint32_t rom[0x2000] = {
+		0xEF0B0000, // swi 0xB0000
+		0xEAFFFFFE, // b .
+	};
+	struct mCore* core = mTestGBACoreLoad(rom, sizeof(rom), NULL);
+	mCoreConfigSetIntValue(&core->config, "gba.directCpuSet", 1);
+	core->reloadConfigOption(core, "gba.directCpuSet", NULL);
+
+	struct CountingWatcher watcher = { .d = { .written = _countWrite } };
+	static const struct mCoreMemoryWatchRange range = { GBA_BASE_VRAM, GBA_BASE_VRAM + 0x100 };
+	assert_true(core->setMemoryWatcher(core, &watcher.d, &range, 1));
+	_runCpuSet(core, &test);
+	assert_int_equal(watcher.writes, test.size / 2);
+	core->setMemoryWatcher(core, NULL, NULL, 0);
+
+	assert_true(core->setMemoryStatsEnabled(core, true));
+	_runCpuSet(core, &test);
+	assert_int_equal(_vramWrites(core), test.size / 2);
+	core->setMemoryStatsEnabled(core, false);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_SUITE_DEFINE(GBABIOS,
+	cmocka_unit_test(hleLz77),
+	cmocka_unit_test(directCpuSet),
+	cmocka_unit_test(hleLz77Observed),
+	cmocka_unit_test(directCpuSetObserved))
@@ -193,6 +193,36 @@ M_TEST_DEFINE(doPARv3If1) {
 	mCheatSetDeinit(set);
 }
 
+M_TEST_DEFINE(doPARv3IfAfterWrite) {
+	struct mCore* core = *state;
+	struct mCheatDevice* device = core->cheatDevice(core);
+	assert_non_null(device);
+	struct mCheatSet* set = device->createSet(device, NULL);
+	assert_non_null(set);
+	GBACheatSetGameSharkVersion((struct GBACheatSet*) set, GBA_GS_PARV3_RAW);
+	assert_true(set->addLine(set, "08300000 00000000", GBA_CHEAT_PRO_ACTION_REPLAY));
+	assert_true(set->addLine(set, "00300000 00000001", GBA_CHEAT_PRO_ACTION_REPLAY));
+	// The same address must be read again after the write above
+	assert_true(set->addLine(set, "08300000 00000000", GBA_CHEAT_PRO_ACTION_REPLAY));
+	assert_true(set->addLine(set, "00300001 00000012", GBA_CHEAT_PRO_ACTION_REPLAY));
+	assert_true(set->addLine(set, "08300001 00000000", GBA_CHEAT_PRO_ACTION_REPLAY));
+	assert_true(set->addLine(set, "00300002 00000033", GBA_CHEAT_PRO_ACTION_REPLAY));
+
+	core->reset(core);
+	mCheatRefresh(device, set);
+	assert_int_equal(core->rawRead8(core, 0x03000000, -1), 0x1);
+	assert_int_equal(core->rawRead8(core, 0x03000001, -1), 0);
+	assert_int_equal(core->rawRead8(core, 0x03000002, -1), 0x33);
+	assert_int_equal(core->rawRead8(core, 0x03000003, -1), 0);
+
+	// Lines added after the set has been compiled still take effect
+	assert_true(set->addLine(set, "00300003 00000044", GBA_CHEAT_PRO_ACTION_REPLAY));
+	mCheatRefresh(device, set);
+	assert_int_equal(core->rawRead8(core, 0x03000003, -1), 0x44);
+
+	mCheatSetDeinit(set);
+}
+
 M_TEST_DEFINE(doPARv3If1x1) {
 	struct mCore* core = *state;
 	struct mCheatDevice* device = core->cheatDevice(core);
@@ -1186,6 +1216,7 @@ M_TEST_SUITE_DEFINE(GBACheats,
 	cmocka_unit_test_setup_teardown(doPARv3Slide2, cheatsSetup, cheatsTeardown),
 	cmocka_unit_test_setup_teardown(doPARv3Slide4, cheatsSetup, cheatsTeardown),
 	cmocka_unit_test_setup_teardown(doPARv3If1, cheatsSetup, cheatsTeardown),
+	cmocka_unit_test_setup_teardown(doPARv3IfAfterWrite, cheatsSetup, cheatsTeardown),
 	cmocka_unit_test_setup_teardown(doPARv3If1x1, cheatsSetup, cheatsTeardown),
 	cmocka_unit_test_setup_teardown(doPARv3If2, cheatsSetup, cheatsTeardown),
 	cmocka_unit_test_setup_teardown(doPARv3If2x2, cheatsSetup, cheatsTeardown),
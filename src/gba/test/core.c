@@ -5,9 +5,12 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "util/test/suite.h"
 
+#include <mgba/core/blip_buf.h>
 #include <mgba/core/core.h>
 #include <mgba/gba/core.h>
 
+#include "gba/test/test-gba.h"
+
 M_TEST_DEFINE(create) {
 	struct mCore* core = GBACoreCreate();
 	assert_non_null(core);
@@ -44,8 +47,270 @@ M_TEST_DEFINE(loadNullROM) {
 	core->deinit(core);
 }
 
+M_TEST_DEFINE(romRegistry) {
+	struct mROMImageRegistry registry;
+	mROMImageRegistryInit(&registry);
+
+	uint32_t rom[0x2000];
+	mTestGBAFillROM(rom, sizeof(rom), 0x20000000);
+	struct mCore* cores[2] = {
+		mTestGBACoreLoad(rom, sizeof(rom), &registry),
+		mTestGBACoreLoad(rom, sizeof(rom), &registry),
+	};
+	struct GBA* gbas[2] = { cores[0]->board, cores[1]->board };
+	if (!gbas[0]->romImage) {
+		// Shared memory isn't available on this platform
+		mTestGBACoresDestroy(cores, 2);
+		mROMImageRegistryDeinit(&registry);
+		skip();
+	}
+	assert_ptr_equal(gbas[0]->romImage, gbas[1]->romImage);
+	assert_ptr_equal(gbas[0]->memory.rom, gbas[1]->memory.rom);
+	assert_int_equal(gbas[0]->romImage->refs, 2);
+
+	// Writing to one core's ROM leaves the other alone
+	int32_t old;
+	GBAPatch32(cores[0]->cpu, GBA_BASE_ROM0 + 0x100, 0x12345678, &old);
+	assert_int_equal(old, 0x20000100);
+	assert_false(gbas[0]->isPristine);
+	assert_ptr_not_equal(gbas[0]->memory.rom, gbas[1]->memory.rom);
+	assert_int_equal(cores[0]->busRead32(cores[0], GBA_BASE_ROM0 + 0x100), 0x12345678);
+	assert_int_equal(cores[1]->busRead32(cores[1], GBA_BASE_ROM0 + 0x100), 0x20000100);
+	assert_int_equal(cores[0]->busRead32(cores[0], GBA_BASE_ROM0 + 0x7FFC), 0x20007FFC);
+
+	// Growing the ROM fills the gap the same way an unshared copy would
+	GBAPatch32(cores[0]->cpu, GBA_BASE_ROM0 + 0x9000, 0x55AA55AA, &old);
+	assert_int_equal(gbas[0]->memory.romSize, 0x9004);
+	assert_int_equal(cores[0]->busRead32(cores[0], GBA_BASE_ROM0 + 0x8000), 0xFFFFFFFF);
+	assert_int_equal(cores[0]->busRead32(cores[0], GBA_BASE_ROM0 + 0x9000), 0x55AA55AA);
+	assert_int_equal(gbas[1]->memory.romSize, 0x8000);
+
+	struct mROMImage* image = gbas[1]->romImage;
+	mTestGBACoresDestroy(&cores[0], 1);
+	assert_int_equal(image->refs, 1);
+	assert_int_equal(TableSize(&registry.images), 1);
+	mTestGBACoresDestroy(&cores[1], 1);
+	assert_int_equal(TableSize(&registry.images), 0);
+	mROMImageRegistryDeinit(&registry);
+}
+
+M_TEST_DEFINE(romRegistryPatch) {
+	struct mROMImageRegistry registry;
+	mROMImageRegistryInit(&registry);
+
+	uint32_t rom[0x2000];
+	mTestGBAFillROM(rom, sizeof(rom), 0x20000000);
+	// Not a power of two, so both cores run it from a private mapping like a flash cart
+	struct mCore* cores[2] = {
+		mTestGBACoreLoad(rom, 0x6000, &registry),
+		mTestGBACoreLoad(rom, 0x6000, &registry),
+	};
+	struct GBA* gbas[2] = { cores[0]->board, cores[1]->board };
+	if (!gbas[0]->romImage) {
+		// Shared memory isn't available on this platform
+		mTestGBACoresDestroy(cores, 2);
+		mROMImageRegistryDeinit(&registry);
+		skip();
+	}
+	assert_ptr_equal(gbas[0]->romImage, gbas[1]->romImage);
+	assert_ptr_not_equal(gbas[0]->memory.rom, gbas[1]->memory.rom);
+	assert_false(gbas[0]->isPristine);
+	assert_int_equal(gbas[0]->memory.romSize, GBA_SIZE_ROM0);
+	assert_int_equal(cores[0]->busRead32(cores[0], GBA_BASE_ROM0 + 0x5FFC), 0x20005FFC);
+	assert_int_equal(cores[0]->busRead32(cores[0], GBA_BASE_ROM0 + 0x6000), 0);
+	mTestGBACoresDestroy(&cores[1], 1);
+
+	cores[1] = mTestGBACoreLoad(rom, sizeof(rom), &registry);
+	gbas[1] = cores[1]->board;
+	assert_true(gbas[1]->isPristine);
+	struct mROMImage* image = gbas[1]->romImage;
+	assert_non_null(image);
+
+	// IPS patches are applied to a private mapping of the image instead of a full copy
+	static const uint8_t ips[] = { 'P', 'A', 'T', 'C', 'H', 0x00, 0x01, 0x00, 0x00, 0x04, 0x78, 0x56, 0x34, 0x12, 'E', 'O', 'F' };
+	struct VFile* patch = VFileFromConstMemory(ips, sizeof(ips));
+	assert_true(cores[1]->loadPatch(cores[1], patch));
+	patch->close(patch);
+	assert_false(gbas[1]->isPristine);
+	assert_ptr_equal(gbas[1]->romImage, image);
+	assert_ptr_not_equal(gbas[1]->memory.rom, image->memory.data);
+	assert_int_equal(cores[1]->busRead32(cores[1], GBA_BASE_ROM0 + 0x100), 0x12345678);
+	assert_int_equal(cores[1]->busRead32(cores[1], GBA_BASE_ROM0 + 0x104), 0x20000104);
+	assert_int_equal(cores[1]->busRead32(cores[1], GBA_BASE_ROM0 + 0x7FFC), 0x20007FFC);
+	assert_int_equal(((uint32_t*) image->memory.data)[0x40], 0x20000100);
+
+	mTestGBACoresDestroy(cores, 2);
+	assert_int_equal(TableSize(&registry.images), 0);
+	mROMImageRegistryDeinit(&registry);
+}
+
+M_TEST_DEFINE(cloneCore) {
+	static const uint32_t code[] = {
+		0xE3A01403, // mov r1, #0x03000000
+		0xE2800001, // add r0, r0, #1
+		0xE5810000, // str r0, [r1]
+		0xEAFFFFFC, // b . - 8
+	};
+	struct mROMImageRegistry registry;
+	mROMImageRegistryInit(&registry);
+
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	struct GBA* gba = core->board;
+	gba->romRegistry = &registry;
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	vf->write(vf, code, sizeof(code));
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+	core->runFrame(core);
+	core->busWrite8(core, GBA_BASE_SRAM, 0x5A);
+
+	struct mCore* clone = core->clone(core);
+	assert_non_null(clone);
+	struct GBA* cloneGba = clone->board;
+	if (gba->romImage) {
+		assert_ptr_equal(cloneGba->romImage, gba->romImage);
+		assert_ptr_equal(cloneGba->memory.rom, gba->memory.rom);
+		assert_int_equal(gba->romImage->refs, 2);
+	}
+	assert_null(cloneGba->romVf);
+	assert_int_equal(clone->frameCounter(clone), core->frameCounter(core));
+	assert_int_equal(mTimingCurrentTime(clone->timing), mTimingCurrentTime(core->timing));
+	assert_int_equal(((struct ARMCore*) clone->cpu)->gprs[0], ((struct ARMCore*) core->cpu)->gprs[0]);
+	assert_int_equal(clone->busRead8(clone, GBA_BASE_SRAM), 0x5A);
+
+	// Both run exactly the same from here on
+	core->runFrame(core);
+	clone->runFrame(clone);
+	assert_int_equal(((struct ARMCore*) clone->cpu)->gprs[0], ((struct ARMCore*) core->cpu)->gprs[0]);
+	assert_int_equal(clone->busRead32(clone, GBA_BASE_IWRAM), core->busRead32(core, GBA_BASE_IWRAM));
+	assert_int_equal(mTimingCurrentTime(clone->timing), mTimingCurrentTime(core->timing));
+
+	// But they don't share any state
+	clone->busWrite8(clone, GBA_BASE_SRAM, 0xA5);
+	clone->busWrite32(clone, GBA_BASE_EWRAM, 0x12345678);
+	assert_int_equal(core->busRead8(core, GBA_BASE_SRAM), 0x5A);
+	assert_int_equal(core->busRead32(core, GBA_BASE_EWRAM), 0);
+
+	// The clone keeps working after the original is gone
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	uint32_t counter = ((struct ARMCore*) clone->cpu)->gprs[0];
+	clone->runFrame(clone);
+	assert_true(((struct ARMCore*) clone->cpu)->gprs[0] > counter);
+	mCoreConfigDeinit(&clone->config);
+	clone->deinit(clone);
+	assert_int_equal(TableSize(&registry.images), 0);
+	mROMImageRegistryDeinit(&registry);
+}
+
+M_TEST_DEFINE(slim) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	core->setAudioBufferSize(core, 0x1000);
+	assert_int_equal(core->getAudioBufferSize(core), 0x1000);
+	size_t usage = core->memoryUsage(core);
+	assert_true(usage > 0);
+
+	mCoreConfigSetValue(&core->config, "slim", "1");
+	mCoreLoadConfig(core);
+	struct GBA* gba = core->board;
+	assert_true(gba->slim);
+	assert_true(core->getAudioBufferSize(core) < 0x1000);
+	assert_true(core->memoryUsage(core) < usage);
+
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+	core->busWrite32(core, GBA_BASE_EWRAM + 0x1234, 0x12345678);
+	core->busWrite32(core, GBA_BASE_IWRAM + 0x5678, 0x9ABCDEF0);
+	core->reset(core);
+	assert_int_equal(core->busRead32(core, GBA_BASE_EWRAM + 0x1234), 0);
+	assert_int_equal(core->busRead32(core, GBA_BASE_IWRAM + 0x5678), 0);
+
+	// The audio buffers keep working at their new size
+	size_t i;
+	for (i = 0; i < 4; ++i) {
+		core->runFrame(core);
+	}
+	assert_true(blip_samples_avail(core->getAudioChannel(core, 0)) > 0);
+
+	mCoreConfigSetValue(&core->config, "slim", "0");
+	core->reloadConfigOption(core, "slim", NULL);
+	assert_false(gba->slim);
+	core->setAudioBufferSize(core, 0x1000);
+	assert_int_equal(core->getAudioBufferSize(core), 0x1000);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_DEFINE(stateHash) {
+	static const uint32_t code[] = {
+		0xE3A01403, // mov r1, #0x03000000
+		0xE2800001, // add r0, r0, #1
+		0xE5810000, // str r0, [r1]
+		0xEAFFFFFC, // b . - 8
+	};
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	vf->write(vf, code, sizeof(code));
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+	core->runFrame(core);
+
+	uint64_t hash = core->stateHash(core);
+	assert_true(core->stateHash(core) == hash);
+	void* buffer = malloc(core->stateSize(core));
+	assert_true(core->saveState(core, buffer));
+
+	// Pages that were written get rehashed, whichever path the write took
+	core->busWrite8(core, GBA_BASE_EWRAM + 0x2345, 0x5A);
+	assert_true(core->stateHash(core) != hash);
+	core->busWrite8(core, GBA_BASE_EWRAM + 0x2345, 0);
+	assert_true(core->stateHash(core) == hash);
+	core->rawWrite8(core, GBA_BASE_IWRAM + 0x6789, -1, 0x5A);
+	assert_true(core->stateHash(core) != hash);
+	core->rawWrite8(core, GBA_BASE_IWRAM + 0x6789, -1, 0);
+	assert_true(core->stateHash(core) == hash);
+	core->busWrite16(core, GBA_BASE_VRAM + 0x100, 0x1234);
+	assert_true(core->stateHash(core) != hash);
+
+	assert_true(core->loadState(core, buffer));
+	assert_true(core->stateHash(core) == hash);
+
+	// Cores running in lockstep agree, until they don't
+	struct mCore* clone = core->clone(core);
+	assert_non_null(clone);
+	assert_true(clone->stateHash(clone) == hash);
+	core->runFrame(core);
+	clone->runFrame(clone);
+	assert_true(core->stateHash(core) != hash);
+	assert_true(clone->stateHash(clone) == core->stateHash(core));
+	((struct ARMCore*) clone->cpu)->gprs[2] ^= 1;
+	assert_true(clone->stateHash(clone) != core->stateHash(core));
+
+	free(buffer);
+	mCoreConfigDeinit(&clone->config);
+	clone->deinit(clone);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
 M_TEST_SUITE_DEFINE(GBACore,
 	cmocka_unit_test(create),
 	cmocka_unit_test(platform),
 	cmocka_unit_test(reset),
-	cmocka_unit_test(loadNullROM))
+	cmocka_unit_test(loadNullROM),
+	cmocka_unit_test(romRegistry),
+	cmocka_unit_test(romRegistryPatch),
+	cmocka_unit_test(cloneCore),
+	cmocka_unit_test(slim),
+	cmocka_unit_test(stateHash))
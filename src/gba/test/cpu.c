@@ -0,0 +1,48 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include "gba/test/test-gba.h"
+
+M_TEST_DEFINE(aluShifts) {
+	static const uint32_t code[] = {
+		0xE3A01003, // mov r1, #3
+		0xE3A02106, // mov r2, #0x80000001
+		0xE1A03112, // mov r3, r2, lsl r1
+		0xE1B04172, // movs r4, r2, ror r1
+		0xE08F5111, // add r5, pc, r1, lsl r1
+		0xE08F6181, // add r6, pc, r1, lsl #3
+		0xE1A07042, // mov r7, r2, asr #32
+		0xEAFFFFFE, // b .
+	};
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	vf->write(vf, code, sizeof(code));
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+	GBASkipBIOS(core->board);
+	struct ARMCore* cpu = core->cpu;
+	size_t i;
+	for (i = 0; i < 7; ++i) {
+		ARMRun(cpu);
+	}
+	assert_int_equal(cpu->gprs[3], 0x00000008);
+	assert_int_equal(cpu->gprs[4], 0x30000000);
+	assert_false(cpu->cpsr.c);
+	// A register-specified shift reads PC one word further ahead
+	assert_int_equal(cpu->gprs[5], GBA_BASE_ROM0 + 0x10 + 12 + 24);
+	assert_int_equal(cpu->gprs[6], GBA_BASE_ROM0 + 0x14 + 8 + 24);
+	assert_int_equal(cpu->gprs[7], -1);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_SUITE_DEFINE(GBACPU,
+	cmocka_unit_test(aluShifts))
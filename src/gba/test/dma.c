@@ -0,0 +1,285 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include "gba/test/test-gba.h"
+
+static void _shimStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycleCounter) {
+	GBAStore32(cpu, address, value, cycleCounter);
+}
+
+static void _shimStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycleCounter) {
+	GBAStore16(cpu, address, value, cycleCounter);
+}
+
+// Creates two cores running the same ROM. Hooking stores on the second one forces every unit
+// through GBADMAService, so it can be checked against the bulk path on the first.
+static void _createShimmedCorePair(struct mCore* cores[2], const void* rom, size_t size) {
+	cores[0] = mTestGBACoreLoad(rom, size, NULL);
+	cores[1] = mTestGBACoreLoad(rom, size, NULL);
+	struct ARMCore* cpu = cores[1]->cpu;
+	cpu->memory.store16 = _shimStore16;
+	cpu->memory.store32 = _shimStore32;
+}
+
+M_TEST_DEFINE(dmaBulk) {
+	uint32_t rom[0x2000];
+	mTestGBAFillROM(rom, sizeof(rom), 0x30000000);
+	rom[0] = 0xEAFFFFFE; // b .
+	struct mCore* cores[2];
+	_createShimmedCorePair(cores, rom, sizeof(rom));
+	uint32_t endTime[2];
+	size_t i;
+	for (i = 0; i < 2; ++i) {
+		struct GBA* gba = cores[i]->board;
+		GBAIOWrite32(gba, GBA_REG_DMA3SAD_LO, GBA_BASE_ROM0 + 0x100);
+		GBAIOWrite32(gba, GBA_REG_DMA3DAD_LO, GBA_BASE_EWRAM + 0x200);
+		GBAIOWrite(gba, GBA_REG_DMA3CNT_LO, 0x1000);
+		GBAIOWrite(gba, GBA_REG_DMA3CNT_HI, 0x8400);
+		cores[i]->step(cores[i]);
+		assert_false(GBADMARegisterIsEnable(gba->memory.dma[3].reg));
+		endTime[i] = mTimingCurrentTime(&gba->timing);
+		assert_int_equal(gba->bus, 0x300040FC);
+		assert_int_equal(cores[i]->busRead32(cores[i], GBA_BASE_EWRAM + 0x200), 0x30000100);
+		assert_int_equal(cores[i]->busRead32(cores[i], GBA_BASE_EWRAM + 0x41FC), 0x300040FC);
+	}
+	// Taking the bulk path can't change when the transfer ends
+	assert_int_equal(endTime[0], endTime[1]);
+
+	mTestGBACoresDestroy(cores, 2);
+}
+
+static uint8_t _vramNotified[GBA_SIZE_VRAM / 2];
+static uint8_t _oamNotified[GBA_SIZE_OAM / 2];
+static int _rangeNotifications;
+
+static void _notifyVRAM(struct GBAVideoRenderer* renderer, uint32_t address) {
+	UNUSED(renderer);
+	_vramNotified[address >> 1] = 1;
+}
+
+static void _notifyVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t length) {
+	UNUSED(renderer);
+	memset(&_vramNotified[address >> 1], 1, length >> 1);
+	++_rangeNotifications;
+}
+
+static void _notifyOAM(struct GBAVideoRenderer* renderer, uint32_t oam) {
+	UNUSED(renderer);
+	_oamNotified[oam] = 1;
+}
+
+static void _notifyOAMRange(struct GBAVideoRenderer* renderer, uint32_t oam, uint32_t count) {
+	UNUSED(renderer);
+	memset(&_oamNotified[oam], 1, count);
+	++_rangeNotifications;
+}
+
+M_TEST_DEFINE(dmaBulkVideo) {
+	uint32_t rom[0x2000];
+	mTestGBAFillROM(rom, sizeof(rom), 0x30000000);
+	rom[0] = 0xEAFFFFFE; // b .
+	struct mCore* cores[2];
+	_createShimmedCorePair(cores, rom, sizeof(rom));
+	uint32_t endTime[2];
+	size_t i;
+	for (i = 0; i < 2; ++i) {
+		struct GBA* gba = cores[i]->board;
+		struct GBAVideoRenderer* original = gba->video.renderer;
+		struct GBAVideoRenderer renderer = *original;
+		renderer.writeVRAM = _notifyVRAM;
+		renderer.writeVRAMRange = _notifyVRAMRange;
+		renderer.writeOAM = _notifyOAM;
+		renderer.writeOAMRange = _notifyOAMRange;
+		gba->video.renderer = &renderer;
+		memset(_vramNotified, 0, sizeof(_vramNotified));
+		memset(_oamNotified, 0, sizeof(_oamNotified));
+		_rangeNotifications = 0;
+
+		// Forced blank keeps VRAM from stalling, so both transfers can take the bulk path
+		GBAIOWrite(gba, GBA_REG_DISPCNT, 0x0080);
+		GBAIOWrite32(gba, GBA_REG_DMA3SAD_LO, GBA_BASE_ROM0 + 0x100);
+		GBAIOWrite32(gba, GBA_REG_DMA3DAD_LO, GBA_BASE_VRAM + 0x400);
+		GBAIOWrite(gba, GBA_REG_DMA3CNT_LO, 0x800);
+		GBAIOWrite(gba, GBA_REG_DMA3CNT_HI, 0x8000);
+		while (GBADMARegisterIsEnable(gba->memory.dma[3].reg)) {
+			cores[i]->step(cores[i]);
+		}
+		GBAIOWrite32(gba, GBA_REG_DMA3SAD_LO, GBA_BASE_ROM0 + 0x200);
+		GBAIOWrite32(gba, GBA_REG_DMA3DAD_LO, GBA_BASE_OAM);
+		GBAIOWrite(gba, GBA_REG_DMA3CNT_LO, 0x100);
+		GBAIOWrite(gba, GBA_REG_DMA3CNT_HI, 0x8400);
+		while (GBADMARegisterIsEnable(gba->memory.dma[3].reg)) {
+			cores[i]->step(cores[i]);
+		}
+		endTime[i] = mTimingCurrentTime(&gba->timing);
+		gba->video.renderer = original;
+
+		assert_int_equal(cores[i]->busRead16(cores[i], GBA_BASE_VRAM + 0x400), 0x0100);
+		assert_int_equal(cores[i]->busRead16(cores[i], GBA_BASE_VRAM + 0x13FE), 0x3000);
+		assert_int_equal(cores[i]->busRead32(cores[i], GBA_BASE_OAM + 0x3FC), 0x300005FC);
+		// Every halfword that changed has to have been reported, one way or the other
+		uint32_t j;
+		for (j = 0; j < 0x1000; j += 2) {
+			if (cores[i]->busRead16(cores[i], GBA_BASE_VRAM + 0x400 + j)) {
+				assert_true(_vramNotified[(0x400 + j) >> 1]);
+			}
+		}
+		for (j = 0; j < GBA_SIZE_OAM / 2; ++j) {
+			assert_true(_oamNotified[j]);
+		}
+		assert_false(_vramNotified[0x1400 >> 1]);
+		// Only the bulk path reports ranges
+		if (i) {
+			assert_int_equal(_rangeNotifications, 0);
+		} else {
+			assert_true(_rangeNotifications);
+		}
+	}
+	// Taking the bulk path can't change when the transfers end
+	assert_int_equal(endTime[0], endTime[1]);
+
+	mTestGBACoresDestroy(cores, 2);
+}
+
+static void _runEEPROMDMA(struct mCore* core, uint32_t source, uint32_t dest, uint16_t count) {
+	struct GBA* gba = core->board;
+	GBAIOWrite32(gba, GBA_REG_DMA3SAD_LO, source);
+	GBAIOWrite32(gba, GBA_REG_DMA3DAD_LO, dest);
+	GBAIOWrite(gba, GBA_REG_DMA3CNT_LO, count);
+	GBAIOWrite(gba, GBA_REG_DMA3CNT_HI, 0x8000);
+	while (GBADMARegisterIsEnable(gba->memory.dma[3].reg)) {
+		core->step(core);
+	}
+}
+
+M_TEST_DEFINE(dmaBulkEEPROM) {
+	static const uint64_t block = 0x0123456789ABCDEFULL;
+	uint32_t rom[0x2000] = {
+		0xEAFFFFFE, // b .
+	};
+	struct mCore* cores[2];
+	_createShimmedCorePair(cores, rom, sizeof(rom));
+	uint32_t endTime[2];
+	uint32_t settleTime[2];
+	size_t i;
+	for (i = 0; i < 2; ++i) {
+		struct GBA* gba = cores[i]->board;
+		GBASavedataForceType(&gba->memory.savedata, SAVEDATA_EEPROM512);
+
+		// Write command, 6-bit address, 64 bits of data and a stop bit, one bit per unit
+		uint32_t address = GBA_BASE_EWRAM + 0x100;
+		int bit;
+		uint16_t units[81];
+		size_t nUnits = 0;
+		units[nUnits++] = 1;
+		units[nUnits++] = 0;
+		for (bit = 5; bit >= 0; --bit) {
+			units[nUnits++] = (5 >> bit) & 1;
+		}
+		for (bit = 63; bit >= 0; --bit) {
+			units[nUnits++] = (block >> bit) & 1;
+		}
+		units[nUnits++] = 0;
+		size_t j;
+		for (j = 0; j < nUnits; ++j) {
+			cores[i]->busWrite16(cores[i], address + j * 2, units[j]);
+		}
+		_runEEPROMDMA(cores[i], address, 0x0DFFFF00, nUnits);
+		assert_true(mTimingIsScheduled(&gba->timing, &gba->memory.savedata.dust));
+		settleTime[i] = gba->memory.savedata.dust.when - mTimingCurrentTime(&gba->timing);
+		assert_int_equal(gba->memory.savedata.data[5 * 8], 0x01);
+		assert_int_equal(gba->memory.savedata.data[5 * 8 + 7], 0xEF);
+
+		// Read command, address and a stop bit, then 4 junk bits and the 64 bits of data
+		nUnits = 0;
+		units[nUnits++] = 1;
+		units[nUnits++] = 1;
+		for (bit = 5; bit >= 0; --bit) {
+			units[nUnits++] = (5 >> bit) & 1;
+		}
+		units[nUnits++] = 0;
+		for (j = 0; j < nUnits; ++j) {
+			cores[i]->busWrite16(cores[i], address + j * 2, units[j]);
+		}
+		_runEEPROMDMA(cores[i], address, 0x0DFFFF00, nUnits);
+		_runEEPROMDMA(cores[i], 0x0DFFFF00, GBA_BASE_EWRAM + 0x400, 68);
+		endTime[i] = mTimingCurrentTime(&gba->timing);
+		uint64_t readBack = 0;
+		for (j = 4; j < 68; ++j) {
+			readBack = (readBack << 1) | (cores[i]->busRead16(cores[i], GBA_BASE_EWRAM + 0x400 + j * 2) & 1);
+		}
+		assert_true(readBack == block);
+		assert_int_equal(gba->memory.savedata.command, EEPROM_COMMAND_NULL);
+	}
+	// Taking the bulk path can't change when the transfers end, or when the EEPROM is done settling
+	assert_int_equal(endTime[0], endTime[1]);
+	assert_int_equal(settleTime[0], settleTime[1]);
+
+	mTestGBACoresDestroy(cores, 2);
+}
+
+struct CountingWatcher {
+	struct mCoreMemoryWatcher d;
+	int writes;
+};
+
+static void _countWrite(struct mCoreMemoryWatcher* watcher, uint32_t address, int width, uint32_t value) {
+	UNUSED(address);
+	UNUSED(width);
+	UNUSED(value);
+	++((struct CountingWatcher*) watcher)->writes;
+}
+
+static void _runVRAMDMA(struct mCore* core, uint16_t count) {
+	struct GBA* gba = core->board;
+	// Forced blank keeps VRAM from stalling, so only the watcher or stats can hold back the bulk path
+	GBAIOWrite(gba, GBA_REG_DISPCNT, 0x0080);
+	GBAIOWrite32(gba, GBA_REG_DMA3SAD_LO, GBA_BASE_ROM0 + 0x100);
+	GBAIOWrite32(gba, GBA_REG_DMA3DAD_LO, GBA_BASE_VRAM + 0x400);
+	GBAIOWrite(gba, GBA_REG_DMA3CNT_LO, count);
+	GBAIOWrite(gba, GBA_REG_DMA3CNT_HI, 0x8000);
+	while (GBADMARegisterIsEnable(gba->memory.dma[3].reg)) {
+		core->step(core);
+	}
+}
+
+M_TEST_DEFINE(dmaBulkObserved) {
+	uint32_t rom[0x2000];
+	mTestGBAFillROM(rom, sizeof(rom), 0x30000000);
+	rom[0] = 0xEAFFFFFE; // b .
+	struct mCore* core = mTestGBACoreLoad(rom, sizeof(rom), NULL);
+
+	struct CountingWatcher watcher = { .d = { .written = _countWrite } };
+	static const struct mCoreMemoryWatchRange range = { GBA_BASE_VRAM + 0x400, GBA_BASE_VRAM + 0x1400 };
+	assert_true(core->setMemoryWatcher(core, &watcher.d, &range, 1));
+	_runVRAMDMA(core, 0x800);
+	assert_int_equal(watcher.writes, 0x800);
+	core->setMemoryWatcher(core, NULL, NULL, 0);
+
+	assert_true(core->setMemoryStatsEnabled(core, true));
+	_runVRAMDMA(core, 0x100);
+	struct mCoreMemoryStats stats[16];
+	size_t nStats = core->memoryStats(core, stats, 16);
+	size_t i;
+	for (i = 0; i < nStats; ++i) {
+		if (strcmp(stats[i].name, "vram") == 0) {
+			break;
+		}
+	}
+	assert_int_not_equal(i, nStats);
+	assert_int_equal(stats[i].writes, 0x100);
+	core->setMemoryStatsEnabled(core, false);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_SUITE_DEFINE(GBADMA,
+	cmocka_unit_test(dmaBulk),
+	cmocka_unit_test(dmaBulkVideo),
+	cmocka_unit_test(dmaBulkEEPROM),
+	cmocka_unit_test(dmaBulkObserved))
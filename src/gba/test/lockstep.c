@@ -0,0 +1,102 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/gba/core.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/sio/lockstep.h>
+#include <mgba-util/vfs.h>
+
+struct LockstepTest {
+	struct GBASIOLockstepHub hub;
+	struct mCore* cores[MAX_GBAS];
+};
+
+M_TEST_SUITE_SETUP(GBASIOLockstep) {
+	struct LockstepTest* test = calloc(1, sizeof(*test));
+	GBASIOLockstepHubInit(&test->hub);
+	int i;
+	for (i = 0; i < MAX_GBAS; ++i) {
+		struct mCore* core = GBACoreCreate();
+		if (!core || !core->init(core)) {
+			return -1;
+		}
+		mCoreInitConfig(core, NULL);
+		struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+		uint32_t word = 0xEAFFFFFE; // b .
+		vf->write(vf, &word, sizeof(word));
+		if (!core->loadROM(core, vf)) {
+			return -1;
+		}
+		core->reset(core);
+		GBASkipBIOS(core->board);
+		test->cores[i] = core;
+		if (!GBASIOLockstepHubAttachCore(&test->hub, core)) {
+			return -1;
+		}
+	}
+	*state = test;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(GBASIOLockstep) {
+	struct LockstepTest* test = *state;
+	GBASIOLockstepHubDeinit(&test->hub);
+	int i;
+	for (i = 0; i < MAX_GBAS; ++i) {
+		mCoreConfigDeinit(&test->cores[i]->config);
+		test->cores[i]->deinit(test->cores[i]);
+	}
+	free(test);
+	return 0;
+}
+
+M_TEST_DEFINE(attachLimit) {
+	struct LockstepTest* test = *state;
+	struct mCore* core = GBACoreCreate();
+	assert_true(core->init(core));
+	assert_false(GBASIOLockstepHubAttachCore(&test->hub, core));
+	core->deinit(core);
+}
+
+M_TEST_DEFINE(multiplayerTransfer) {
+	struct LockstepTest* test = *state;
+	int i;
+	for (i = 0; i < MAX_GBAS; ++i) {
+		struct GBA* gba = test->cores[i]->board;
+		GBAIOWrite(gba, GBA_REG_RCNT, 0);
+		GBAIOWrite(gba, GBA_REG_SIOCNT, 0x2003);
+		GBAIOWrite(gba, GBA_REG_SIOMLT_SEND, 0x1000 + i);
+	}
+	assert_true(GBASIOLockstepHubRunFrame(&test->hub));
+
+	struct GBA* master = test->cores[0]->board;
+	assert_true(GBASIOMultiplayerIsReady(master->sio.siocnt));
+	GBAIOWrite(master, GBA_REG_SIOCNT, 0x2083);
+	for (i = 0; i < 4; ++i) {
+		assert_true(GBASIOLockstepHubRunFrame(&test->hub));
+	}
+
+	// Every player should end up with what everyone sent, with no one left behind
+	uint32_t frame = test->cores[0]->frameCounter(test->cores[0]);
+	for (i = 0; i < MAX_GBAS; ++i) {
+		struct GBA* gba = test->cores[i]->board;
+		assert_false(GBASIOMultiplayerIsBusy(gba->sio.siocnt));
+		assert_int_equal(GBASIOMultiplayerGetId(gba->sio.siocnt), i);
+		assert_int_equal(gba->memory.io[GBA_REG(SIOMULTI0)], 0x1000);
+		assert_int_equal(gba->memory.io[GBA_REG(SIOMULTI1)], 0x1001);
+		assert_int_equal(gba->memory.io[GBA_REG(SIOMULTI2)], 0x1002);
+		assert_int_equal(gba->memory.io[GBA_REG(SIOMULTI3)], 0x1003);
+		uint32_t playerFrame = test->cores[i]->frameCounter(test->cores[i]);
+		assert_true(playerFrame + 1 >= frame);
+	}
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(GBASIOLockstep,
+	cmocka_unit_test(attachLimit),
+	cmocka_unit_test(multiplayerTransfer))
@@ -0,0 +1,141 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include "gba/test/test-gba.h"
+
+M_TEST_DEFINE(memoryPages) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	uint32_t i;
+	for (i = 0; i < 0x8000; i += 4) {
+		uint32_t word = 0x10000000 | i;
+		vf->write(vf, &word, sizeof(word));
+	}
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+	struct GBA* gba = core->board;
+	struct ARMCore* cpu = core->cpu;
+
+	// Mirrors end up in the same place
+	core->busWrite32(core, GBA_BASE_EWRAM + 0x10, 0x12345678);
+	assert_int_equal(core->busRead32(core, GBA_BASE_EWRAM + GBA_SIZE_EWRAM + 0x10), 0x12345678);
+	core->busWrite16(core, GBA_BASE_IWRAM + GBA_SIZE_IWRAM + 0x12, 0xABCD);
+	assert_int_equal(core->busRead16(core, GBA_BASE_IWRAM + 0x12), 0xABCD);
+	core->busWrite8(core, GBA_BASE_IWRAM + 0x13, 0xEF);
+	assert_int_equal(core->rawRead16(core, GBA_BASE_IWRAM + 0x12, -1), 0xEFCD);
+	assert_int_equal(gba->memory.dirtyPages[GBA_DIRTY_IWRAM_BASE], 1);
+
+	// Unaligned loads still rotate
+	assert_int_equal(core->busRead32(core, GBA_BASE_EWRAM + 0x11), 0x78123456);
+	assert_int_equal(cpu->memory.load16(cpu, GBA_BASE_IWRAM + 0x13, NULL), 0xCD0000EF);
+
+	assert_int_equal(core->busRead32(core, GBA_BASE_ROM0 + 0x1234), 0x10001234);
+	assert_int_equal(core->busRead32(core, GBA_BASE_ROM1 + 0x4320), 0x10004320);
+	assert_int_equal(core->busRead8(core, GBA_BASE_ROM2 + 0x7FFF), 0x10);
+	// Past the end of the ROM is open bus
+	assert_int_equal(core->busRead16(core, GBA_BASE_ROM0 + 0x8000), 0x4000);
+
+	int cycles = 0;
+	cpu->memory.load32(cpu, GBA_BASE_ROM0, &cycles);
+	assert_int_equal(cycles, gba->memory.waitstatesNonseq32[GBA_REGION_ROM0] + 2);
+	cycles = 0;
+	cpu->memory.load16(cpu, GBA_BASE_EWRAM, &cycles);
+	assert_int_equal(cycles, gba->memory.waitstatesNonseq16[GBA_REGION_EWRAM] + 2);
+
+	// Pulling the cartridge has to take its pages with it
+	GBAYankROM(gba);
+	assert_int_equal(core->busRead16(core, GBA_BASE_ROM0 + 0x1234), 0x091A);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_DEFINE(loadStoreMultiple) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	core->reset(core);
+	struct ARMCore* cpu = core->cpu;
+
+	// The first burst fits in one page, the second straddles two and is decoded per register
+	static const uint32_t addresses[] = { GBA_BASE_EWRAM + 0x100, GBA_BASE_EWRAM + GBA_PAGE_SIZE - 8 };
+	int cycles[2] = { 0, 0 };
+	size_t i;
+	int r;
+	for (i = 0; i < 2; ++i) {
+		for (r = 0; r < 4; ++r) {
+			cpu->gprs[r] = 0x11111111 * (r + 1);
+		}
+		GBAStoreMultiple(cpu, addresses[i], 0xF, LSM_IA, &cycles[i]);
+		for (r = 0; r < 4; ++r) {
+			assert_int_equal(core->busRead32(core, addresses[i] + r * 4), 0x11111111 * (r + 1));
+			cpu->gprs[r] = 0;
+		}
+		GBALoadMultiple(cpu, addresses[i], 0xA, LSM_IA, &cycles[i]);
+		assert_int_equal(cpu->gprs[0], 0);
+		assert_int_equal(cpu->gprs[1], 0x11111111);
+		assert_int_equal(cpu->gprs[2], 0);
+		assert_int_equal(cpu->gprs[3], 0x22222222);
+	}
+	assert_int_equal(cycles[0], cycles[1]);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_DEFINE(prefetchModel) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	uint32_t word = 0xEAFFFFFE; // b .
+	vf->write(vf, &word, sizeof(word));
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+	GBASkipBIOS(core->board);
+	struct GBA* gba = core->board;
+	struct ARMCore* cpu = core->cpu;
+	GBAIOWrite(gba, GBA_REG_WAITCNT, 0x4317);
+	assert_int_equal(gba->memory.activeRegion, GBA_REGION_ROM0);
+
+	static const int32_t waits[] = { 1, 5, 24, 40, 100 };
+	int32_t stall[2];
+	size_t i;
+	for (i = 0; i < sizeof(waits) / sizeof(*waits); ++i) {
+		// With nothing prefetched yet, both models agree
+		gba->memory.prefetchModel = GBA_PREFETCH_ACCURATE;
+		gba->memory.lastPrefetchedPc = cpu->gprs[ARM_PC] + 0x100;
+		stall[0] = GBAMemoryStall(cpu, waits[i]);
+		gba->memory.prefetchModel = GBA_PREFETCH_FAST;
+		gba->memory.lastPrefetchedPc = cpu->gprs[ARM_PC] + 0x100;
+		stall[1] = GBAMemoryStall(cpu, waits[i]);
+		assert_int_equal(stall[0], stall[1]);
+		// The fast model doesn't track the prefetcher
+		assert_int_equal(gba->memory.lastPrefetchedPc, cpu->gprs[ARM_PC] + 0x100);
+	}
+
+	// A long wait right after a prefetch gains less in the accurate model
+	gba->memory.prefetchModel = GBA_PREFETCH_ACCURATE;
+	gba->memory.lastPrefetchedPc = cpu->gprs[ARM_PC] + 8;
+	stall[0] = GBAMemoryStall(cpu, 100);
+	gba->memory.prefetchModel = GBA_PREFETCH_FAST;
+	stall[1] = GBAMemoryStall(cpu, 100);
+	assert_true(stall[0] > stall[1]);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_SUITE_DEFINE(GBAMemory,
+	cmocka_unit_test(memoryPages),
+	cmocka_unit_test(loadStoreMultiple),
+	cmocka_unit_test(prefetchModel))
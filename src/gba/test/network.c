@@ -0,0 +1,136 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/gba/core.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/sio/network.h>
+#include <mgba-util/vfs.h>
+
+#define BASE_PORT 47310
+
+struct NetworkTest {
+	struct GBASIONetwork nets[2];
+	struct mCore* cores[2];
+};
+
+M_TEST_SUITE_SETUP(GBASIONetwork) {
+	SocketSubsystemInit();
+	struct NetworkTest* test = calloc(1, sizeof(*test));
+	struct Address loopback = {
+		.version = IPV4,
+		.ipv4 = 0x7F000001
+	};
+	int i;
+	for (i = 0; i < 2; ++i) {
+		struct mCore* core = GBACoreCreate();
+		if (!core || !core->init(core)) {
+			return -1;
+		}
+		mCoreInitConfig(core, NULL);
+		struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+		uint32_t word = 0xEAFFFFFE; // b .
+		vf->write(vf, &word, sizeof(word));
+		if (!core->loadROM(core, vf)) {
+			return -1;
+		}
+		core->reset(core);
+		GBASkipBIOS(core->board);
+		test->cores[i] = core;
+
+		GBASIONetworkCreate(&test->nets[i]);
+		if (!GBASIONetworkOpen(&test->nets[i], BASE_PORT + i, &loopback, BASE_PORT + (i ^ 1), i)) {
+			return -1;
+		}
+		struct GBA* gba = core->board;
+		GBASIOSetDriver(&gba->sio, &test->nets[i].d, SIO_MULTI);
+		GBASIOSetDriver(&gba->sio, &test->nets[i].d, SIO_NORMAL_32);
+	}
+	*state = test;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(GBASIONetwork) {
+	struct NetworkTest* test = *state;
+	int i;
+	for (i = 0; i < 2; ++i) {
+		struct GBA* gba = test->cores[i]->board;
+		GBASIOSetDriver(&gba->sio, NULL, SIO_MULTI);
+		GBASIOSetDriver(&gba->sio, NULL, SIO_NORMAL_32);
+		GBASIONetworkDestroy(&test->nets[i]);
+		mCoreConfigDeinit(&test->cores[i]->config);
+		test->cores[i]->deinit(test->cores[i]);
+	}
+	free(test);
+	SocketSubsystemDeinit();
+	return 0;
+}
+
+static void _runFrames(struct NetworkTest* test, int frames) {
+	int i;
+	for (i = 0; i < frames; ++i) {
+		test->cores[0]->runFrame(test->cores[0]);
+		test->cores[1]->runFrame(test->cores[1]);
+	}
+}
+
+M_TEST_DEFINE(multiplayer) {
+	struct NetworkTest* test = *state;
+	int i;
+	for (i = 0; i < 2; ++i) {
+		struct GBA* gba = test->cores[i]->board;
+		GBAIOWrite(gba, GBA_REG_RCNT, 0);
+		GBAIOWrite(gba, GBA_REG_SIOCNT, 0x2003);
+		GBAIOWrite(gba, GBA_REG_SIOMLT_SEND, 0x1111 * (i + 1));
+	}
+	_runFrames(test, 2);
+	assert_true(GBASIONetworkIsConnected(&test->nets[0]));
+	assert_true(GBASIONetworkIsConnected(&test->nets[1]));
+
+	struct GBA* master = test->cores[0]->board;
+	assert_true(GBASIOMultiplayerIsReady(master->sio.siocnt));
+	GBAIOWrite(master, GBA_REG_SIOCNT, 0x2083);
+	assert_true(GBASIOMultiplayerIsBusy(master->sio.siocnt));
+	_runFrames(test, 2);
+
+	for (i = 0; i < 2; ++i) {
+		struct GBA* gba = test->cores[i]->board;
+		assert_false(GBASIOMultiplayerIsBusy(gba->sio.siocnt));
+		assert_int_equal(GBASIOMultiplayerGetId(gba->sio.siocnt), i);
+		assert_int_equal(gba->memory.io[GBA_REG(SIOMULTI0)], 0x1111);
+		assert_int_equal(gba->memory.io[GBA_REG(SIOMULTI1)], 0x2222);
+		assert_int_equal(gba->memory.io[GBA_REG(SIOMULTI2)], 0xFFFF);
+	}
+}
+
+M_TEST_DEFINE(normal32) {
+	struct NetworkTest* test = *state;
+	struct GBA* master = test->cores[0]->board;
+	struct GBA* slave = test->cores[1]->board;
+	GBAIOWrite(master, GBA_REG_SIOCNT, 0x1001);
+	GBAIOWrite(slave, GBA_REG_SIOCNT, 0x1000);
+	GBAIOWrite(master, GBA_REG_SIODATA32_LO, 0x5678);
+	GBAIOWrite(master, GBA_REG_SIODATA32_HI, 0x1234);
+	GBAIOWrite(slave, GBA_REG_SIODATA32_LO, 0xCDEF);
+	GBAIOWrite(slave, GBA_REG_SIODATA32_HI, 0x89AB);
+	GBAIOWrite(slave, GBA_REG_SIOCNT, 0x1080);
+	GBAIOWrite(master, GBA_REG_SIOCNT, 0x1081);
+	assert_true(GBASIONormalIsStart(master->sio.siocnt));
+	_runFrames(test, 2);
+
+	assert_false(GBASIONormalIsStart(master->sio.siocnt));
+	assert_false(GBASIONormalIsStart(slave->sio.siocnt));
+	assert_int_equal(master->memory.io[GBA_REG(SIODATA32_LO)], 0xCDEF);
+	assert_int_equal(master->memory.io[GBA_REG(SIODATA32_HI)], 0x89AB);
+	assert_int_equal(slave->memory.io[GBA_REG(SIODATA32_LO)], 0x5678);
+	assert_int_equal(slave->memory.io[GBA_REG(SIODATA32_HI)], 0x1234);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(GBASIONetwork,
+	cmocka_unit_test(multiplayer),
+	cmocka_unit_test(normal32))
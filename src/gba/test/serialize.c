@@ -0,0 +1,182 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/gba/core.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba/internal/gba/serialize.h>
+#include <mgba-util/vfs.h>
+
+M_TEST_SUITE_SETUP(GBASerialize) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	core->reset(core);
+	core->busWrite32(core, 0x020000C0, 0xEAFFFFFE);
+	*state = core;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(GBASerialize) {
+	struct mCore* core = *state;
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	return 0;
+}
+
+static void _assertMatches(struct mCore* core, const void* incremental) {
+	// Reserved fields aren't written by saving, so both buffers need to start out the same
+	void* full = calloc(1, core->stateSize(core));
+	assert_true(core->saveState(core, full));
+	assert_memory_equal(incremental, full, core->stateSize(core));
+	free(full);
+}
+
+M_TEST_DEFINE(incrementalMatchesFull) {
+	struct mCore* core = *state;
+	struct GBASerializedState* arena = calloc(1, core->stateSize(core));
+	uint32_t epoch = 0;
+	assert_true(core->saveStateIncremental(core, arena, &epoch));
+	assert_int_not_equal(epoch, 0);
+	_assertMatches(core, arena);
+
+	core->busWrite32(core, GBA_BASE_EWRAM + 0x10000, 0x12345678);
+	core->busWrite16(core, GBA_BASE_EWRAM + 0x3FFFE, 0x1234);
+	core->busWrite8(core, GBA_BASE_IWRAM + 0x4000, 0x56);
+	core->rawWrite8(core, GBA_BASE_IWRAM + 0x7000, -1, 0x78);
+	core->runFrame(core);
+	assert_true(core->saveStateIncremental(core, arena, &epoch));
+	_assertMatches(core, arena);
+	free(arena);
+}
+
+M_TEST_DEFINE(multipleArenas) {
+	struct mCore* core = *state;
+	size_t size = core->stateSize(core);
+	uint8_t* arenaA = calloc(1, size);
+	uint8_t* arenaB = calloc(1, size);
+	uint32_t epochA = 0;
+	uint32_t epochB = 0;
+	assert_true(core->saveStateIncremental(core, arenaA, &epochA));
+	assert_true(core->saveStateIncremental(core, arenaB, &epochB));
+
+	// A write seen by one arena's save must still reach the other arena later
+	core->busWrite32(core, GBA_BASE_EWRAM + 0x2000, 0xDEADBEEF);
+	assert_true(core->saveStateIncremental(core, arenaA, &epochA));
+	_assertMatches(core, arenaA);
+	core->busWrite32(core, GBA_BASE_IWRAM + 0x100, 0xCAFEF00D);
+	assert_true(core->saveStateIncremental(core, arenaB, &epochB));
+	_assertMatches(core, arenaB);
+	assert_true(core->saveStateIncremental(core, arenaA, &epochA));
+	_assertMatches(core, arenaA);
+	free(arenaA);
+	free(arenaB);
+}
+
+M_TEST_DEFINE(loadMarksDirty) {
+	struct mCore* core = *state;
+	size_t size = core->stateSize(core);
+	uint8_t* arena = calloc(1, size);
+	uint8_t* saved = calloc(1, size);
+	uint32_t epoch = 0;
+	core->busWrite32(core, GBA_BASE_EWRAM + 0x8000, 0x11111111);
+	assert_true(core->saveState(core, saved));
+	core->busWrite32(core, GBA_BASE_EWRAM + 0x8000, 0x22222222);
+	assert_true(core->saveStateIncremental(core, arena, &epoch));
+
+	assert_true(core->loadState(core, saved));
+	assert_true(core->saveStateIncremental(core, arena, &epoch));
+	_assertMatches(core, arena);
+	free(arena);
+	free(saved);
+}
+
+static uint8_t _oamNotified[GBA_SIZE_OAM / 2];
+static int _rangeNotifications;
+
+static void _notifyOAM(struct GBAVideoRenderer* renderer, uint32_t oam) {
+	UNUSED(renderer);
+	_oamNotified[oam] = 1;
+}
+
+static void _notifyOAMRange(struct GBAVideoRenderer* renderer, uint32_t oam, uint32_t count) {
+	UNUSED(renderer);
+	memset(&_oamNotified[oam], 1, count);
+	++_rangeNotifications;
+}
+
+static int _paletteNotifications;
+static int _resets;
+
+static void _notifyPalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
+	UNUSED(renderer);
+	UNUSED(address);
+	UNUSED(value);
+	++_paletteNotifications;
+}
+
+static void _notifyReset(struct GBAVideoRenderer* renderer) {
+	UNUSED(renderer);
+	++_resets;
+}
+
+M_TEST_DEFINE(loadStateBulkVideo) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	struct VFile* vf = VFileMemChunk(NULL, 0x8000);
+	uint32_t word = 0xEAFFFFFE; // b .
+	vf->write(vf, &word, sizeof(word));
+	assert_true(core->loadROM(core, vf));
+	core->reset(core);
+	struct GBA* gba = core->board;
+
+	core->busWrite16(core, GBA_BASE_OAM + 0x10, 0x1234);
+	core->busWrite16(core, GBA_BASE_PALETTE_RAM + 0x20, 0x7C1F);
+	void* savedState = malloc(core->stateSize(core));
+	assert_true(core->saveState(core, savedState));
+	core->busWrite16(core, GBA_BASE_OAM + 0x10, 0x4321);
+	core->busWrite16(core, GBA_BASE_PALETTE_RAM + 0x20, 0x03E0);
+
+	struct GBAVideoRenderer* original = gba->video.renderer;
+	struct GBAVideoRenderer renderer = *original;
+	renderer.writeOAM = _notifyOAM;
+	renderer.writeOAMRange = _notifyOAMRange;
+	renderer.writePalette = _notifyPalette;
+	renderer.reset = _notifyReset;
+	gba->video.renderer = &renderer;
+	memset(_oamNotified, 0, sizeof(_oamNotified));
+	_rangeNotifications = 0;
+	_paletteNotifications = 0;
+	_resets = 0;
+
+	assert_true(core->loadState(core, savedState));
+	gba->video.renderer = original;
+
+	assert_int_equal(core->busRead16(core, GBA_BASE_OAM + 0x10), 0x1234);
+	assert_int_equal(core->busRead16(core, GBA_BASE_PALETTE_RAM + 0x20), 0x7C1F);
+	// Memory is picked up by the reset, not replayed one halfword at a time
+	size_t i;
+	for (i = 0; i < GBA_SIZE_OAM / 2; ++i) {
+		assert_false(_oamNotified[i]);
+	}
+	assert_int_equal(_rangeNotifications, 0);
+	assert_int_equal(_paletteNotifications, 0);
+	assert_int_equal(_resets, 1);
+
+	free(savedState);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(GBASerialize,
+	cmocka_unit_test(incrementalMatchesFull),
+	cmocka_unit_test(multipleArenas),
+	cmocka_unit_test(loadMarksDirty),
+	cmocka_unit_test(loadStateBulkVideo))
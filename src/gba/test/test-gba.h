@@ -0,0 +1,116 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_GBA_TEST_GBA_H
+#define M_GBA_TEST_GBA_H
+
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/interface.h>
+#include <mgba/core/rom-image.h>
+#include <mgba/gba/core.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba/internal/gba/video.h>
+#include <mgba-util/hash.h>
+#include <mgba-util/vfs.h>
+
+struct CountingStream {
+	struct mAVStream d;
+	int videoFrames;
+	int repeatFrames;
+	int audioFrames;
+	uint32_t audioHash;
+};
+
+static inline void _countVideoFrame(struct mAVStream* stream, const color_t* buffer, size_t stride) {
+	UNUSED(buffer);
+	UNUSED(stride);
+	++((struct CountingStream*) stream)->videoFrames;
+}
+
+static inline void _countRepeatFrame(struct mAVStream* stream, const color_t* buffer, size_t stride) {
+	UNUSED(buffer);
+	UNUSED(stride);
+	++((struct CountingStream*) stream)->repeatFrames;
+}
+
+static inline void _countAudioFrame(struct mAVStream* stream, int16_t left, int16_t right) {
+	UNUSED(left);
+	UNUSED(right);
+	++((struct CountingStream*) stream)->audioFrames;
+}
+
+static inline void _hashAudioFrame(struct mAVStream* stream, int16_t left, int16_t right) {
+	struct CountingStream* counting = (struct CountingStream*) stream;
+	int16_t sample[2] = { left, right };
+	counting->audioHash = hash32(sample, sizeof(sample), counting->audioHash);
+	++counting->audioFrames;
+}
+
+// Fills a ROM with words holding their own offset, tagged with marker in the top bits
+static inline void mTestGBAFillROM(uint32_t* rom, size_t size, uint32_t marker) {
+	size_t i;
+	for (i = 0; i < size / 4; ++i) {
+		rom[i] = marker | (i * 4);
+	}
+}
+
+// Creates a core running a copy of rom, optionally shared through registry
+static inline struct mCore* mTestGBACoreLoad(const void* rom, size_t size, struct mROMImageRegistry* registry) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	if (registry) {
+		((struct GBA*) core->board)->romRegistry = registry;
+	}
+	assert_true(core->loadROM(core, VFileMemChunk(rom, size)));
+	core->reset(core);
+	return core;
+}
+
+static inline void mTestGBACoresDestroy(struct mCore** cores, size_t nCores) {
+	size_t i;
+	for (i = 0; i < nCores; ++i) {
+		mCoreConfigDeinit(&cores[i]->config);
+		cores[i]->deinit(cores[i]);
+	}
+}
+
+// Creates a core with no ROM that loops forever in EWRAM and draws into buffer, optionally
+// split into bands drawn on separate threads
+static inline struct mCore* mTestGBARenderingCoreCreate(color_t* buffer, int bands) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	if (bands) {
+		mCoreConfigSetIntValue(&core->config, "gba.videoBands", bands);
+	}
+	core->setVideoBuffer(core, buffer, GBA_VIDEO_HORIZONTAL_PIXELS);
+	core->busWrite32(core, GBA_BASE_EWRAM + 0xC0, 0xEAFFFFFE); // Loop forever
+	core->reset(core);
+	core->runFrame(core);
+	return core;
+}
+
+// Fills BG0 with two alternating tiles, drawn in color
+static inline void mTestGBADrawPattern(struct mCore* core, uint16_t color) {
+	core->busWrite16(core, GBA_BASE_PALETTE_RAM + 2, color);
+	unsigned i;
+	for (i = 0; i < 8; ++i) {
+		core->busWrite32(core, GBA_BASE_VRAM + 0x20 + i * 4, 0x01101001 << (i & 3));
+	}
+	for (i = 0; i < 0x400; ++i) {
+		core->busWrite16(core, GBA_BASE_VRAM + 0xF800 + i * 2, (i & 1) + 1);
+	}
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_BG0CNT, 0x1F00);
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_DISPCNT, 0x0100);
+}
+
+#endif
@@ -0,0 +1,54 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/timing.h>
+#include <mgba/internal/gba/timer.h>
+
+#include "gba/test/test-gba.h"
+
+M_TEST_DEFINE(timerCascade) {
+	color_t* buffer = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	struct mCore* core = mTestGBARenderingCoreCreate(buffer, 0);
+	struct GBA* gba = core->board;
+
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_TM0CNT_LO, 0x10000 - 100);
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_TM1CNT_LO, 0x10000 - 16);
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_TM1CNT_HI, 0x00C4);
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_TM2CNT_HI, 0x0084);
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_TM0CNT_HI, 0x0080);
+	int32_t start = mTimingCurrentTime(&gba->timing);
+
+	// Only the overflow that raises an IRQ gets an event
+	assert_true(GBATimerFlagsIsCheckpoint(gba->timers[0].flags));
+	assert_true(mTimingIsScheduled(&gba->timing, &gba->timers[1].event));
+	assert_false(GBATimerFlagsIsCheckpoint(gba->timers[1].flags));
+	assert_false(mTimingIsScheduled(&gba->timing, &gba->timers[2].event));
+
+	while (!(core->busRead16(core, GBA_BASE_IO | GBA_REG_IF) & (1 << GBA_IRQ_TIMER1))) {
+		core->step(core);
+	}
+	int32_t elapsed = mTimingCurrentTime(&gba->timing) - start;
+	assert_in_range(elapsed, 1600, 1620);
+	assert_int_equal(core->busRead16(core, GBA_BASE_IO | GBA_REG_TM2CNT_LO), 1);
+
+	size_t i;
+	for (i = 0; i < 3; ++i) {
+		core->runFrame(core);
+		// Reads are taken from two cycles before they happen
+		int32_t ticks = mTimingCurrentTime(&gba->timing) - 2 - start;
+		assert_int_equal(core->busRead16(core, GBA_BASE_IO | GBA_REG_TM0CNT_LO), 0x10000 - 100 + ticks % 100);
+		assert_int_equal(core->busRead16(core, GBA_BASE_IO | GBA_REG_TM1CNT_LO), 0x10000 - 16 + ticks / 100 % 16);
+		assert_int_equal(core->busRead16(core, GBA_BASE_IO | GBA_REG_TM2CNT_LO), ticks / 1600);
+	}
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(buffer);
+}
+
+M_TEST_SUITE_DEFINE(GBATimer,
+	cmocka_unit_test(timerCascade))
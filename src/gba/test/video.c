@@ -0,0 +1,384 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/av-buffer.h>
+
+#include "gba/test/test-gba.h"
+
+struct BufferStream {
+	struct mAVStream d;
+	struct mAVBuffer* held[4];
+	int posted;
+};
+
+static void _holdVideoBuffer(struct mAVStream* stream, struct mAVBuffer* buffer) {
+	struct BufferStream* buffers = (struct BufferStream*) stream;
+	assert_true(buffers->posted < 4);
+	buffers->held[buffers->posted] = buffer;
+	++buffers->posted;
+}
+
+M_TEST_DEFINE(skipOutput) {
+	struct mCore* core = GBACoreCreate();
+	assert_non_null(core);
+	assert_true(core->init(core));
+	mCoreInitConfig(core, NULL);
+	struct CountingStream stream = {
+		.d = {
+			.postVideoFrame = _countVideoFrame,
+			.postAudioFrame = _countAudioFrame,
+		}
+	};
+	core->setAVStream(core, &stream.d);
+	core->reset(core);
+	core->runFrame(core);
+
+	core->skipVideoFrames(core, 2);
+	core->skipAudioFrames(core, 1);
+	stream.videoFrames = 0;
+	stream.audioFrames = 0;
+	uint32_t frameCounter = core->frameCounter(core);
+	core->runFrame(core);
+	assert_int_equal(core->frameCounter(core), frameCounter + 1);
+	assert_int_equal(stream.videoFrames, 0);
+	assert_int_equal(stream.audioFrames, 0);
+
+	core->runFrame(core);
+	assert_int_equal(stream.videoFrames, 0);
+	assert_int_not_equal(stream.audioFrames, 0);
+
+	core->runFrame(core);
+	assert_int_equal(stream.videoFrames, 1);
+
+	core->setAVStream(core, NULL);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_DEFINE(renderAfterSkip) {
+	color_t* expected = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	color_t* actual = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	struct mCore* reference = mTestGBARenderingCoreCreate(expected, 0);
+	struct mCore* core = mTestGBARenderingCoreCreate(actual, 0);
+
+	// Everything the picture depends on changes while rendering is skipped
+	core->skipVideoFrames(core, 3);
+	mTestGBADrawPattern(reference, 0x001F);
+	mTestGBADrawPattern(core, 0x001F);
+	int i;
+	for (i = 0; i < 2; ++i) {
+		reference->runFrame(reference);
+		core->runFrame(core);
+	}
+	mTestGBADrawPattern(reference, 0x7C00);
+	mTestGBADrawPattern(core, 0x7C00);
+	for (i = 0; i < 2; ++i) {
+		reference->runFrame(reference);
+		core->runFrame(core);
+	}
+	assert_int_not_equal(expected[0], expected[1]);
+	assert_memory_equal(actual, expected, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * sizeof(color_t));
+
+	mCoreConfigDeinit(&reference->config);
+	reference->deinit(reference);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(expected);
+	free(actual);
+}
+
+static void _runToScanline(struct mCore* core, unsigned y) {
+	while (core->busRead16(core, GBA_BASE_IO | GBA_REG_VCOUNT) != y) {
+		core->step(core);
+	}
+}
+
+M_TEST_DEFINE(changedScanlines) {
+	color_t* buffer = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	struct mCore* core = mTestGBARenderingCoreCreate(buffer, 0);
+	uint32_t scanlines[GBA_VIDEO_VERTICAL_PIXELS / 32];
+
+	mTestGBADrawPattern(core, 0x001F);
+	core->runFrame(core);
+	assert_true(core->getChangedScanlines(core, scanlines));
+	core->runFrame(core);
+	assert_false(core->getChangedScanlines(core, scanlines));
+
+	// Scrolling partway down the screen only changes the rows below
+	_runToScanline(core, 100);
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_BG0HOFS, 1);
+	core->runFrame(core);
+	assert_true(core->getChangedScanlines(core, scanlines));
+	assert_int_equal(scanlines[0], 0);
+	assert_int_equal(scanlines[1], 0);
+	assert_int_equal(scanlines[2], 0);
+	assert_int_equal(scanlines[4], 0xFFFFFFFF);
+
+	core->runFrame(core);
+	assert_true(core->getChangedScanlines(core, scanlines));
+	assert_int_equal(scanlines[0], 0xFFFFFFFF);
+	assert_int_equal(scanlines[4], 0);
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(buffer);
+}
+
+#ifndef DISABLE_THREADING
+M_TEST_DEFINE(renderBands) {
+	color_t* expected = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	color_t* actual = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	struct mCore* reference = mTestGBARenderingCoreCreate(expected, 0);
+	struct mCore* core = mTestGBARenderingCoreCreate(actual, 4);
+
+	mTestGBADrawPattern(reference, 0x001F);
+	mTestGBADrawPattern(core, 0x001F);
+	int i;
+	for (i = 0; i < 3; ++i) {
+		// Scroll partway through the second band, so later bands have to pick up the change
+		_runToScanline(reference, 60);
+		_runToScanline(core, 60);
+		reference->busWrite16(reference, GBA_BASE_IO | GBA_REG_BG0HOFS, i + 1);
+		core->busWrite16(core, GBA_BASE_IO | GBA_REG_BG0HOFS, i + 1);
+		reference->runFrame(reference);
+		core->runFrame(core);
+		reference->busWrite16(reference, GBA_BASE_IO | GBA_REG_BG0HOFS, 0);
+		core->busWrite16(core, GBA_BASE_IO | GBA_REG_BG0HOFS, 0);
+		assert_memory_equal(actual, expected, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * sizeof(color_t));
+	}
+	// These lines show the same row of tiles, one from before the scroll and one from after
+	assert_int_not_equal(memcmp(&expected[GBA_VIDEO_HORIZONTAL_PIXELS * 56], &expected[GBA_VIDEO_HORIZONTAL_PIXELS * 64], GBA_VIDEO_HORIZONTAL_PIXELS * sizeof(color_t)), 0);
+
+	mCoreConfigDeinit(&reference->config);
+	reference->deinit(reference);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(expected);
+	free(actual);
+}
+#endif
+
+M_TEST_DEFINE(repeatFrames) {
+	color_t* buffer = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	struct mCore* core = mTestGBARenderingCoreCreate(buffer, 0);
+	struct CountingStream stream = {
+		.d = {
+			.postVideoFrame = _countVideoFrame,
+			.postVideoFrameRepeat = _countRepeatFrame,
+		}
+	};
+	core->setAVStream(core, &stream.d);
+
+	// The first frame a stream sees is never a repeat
+	core->runFrame(core);
+	assert_int_equal(stream.videoFrames, 1);
+	assert_int_equal(stream.repeatFrames, 0);
+
+	core->runFrame(core);
+	core->runFrame(core);
+	assert_int_equal(stream.videoFrames, 1);
+	assert_int_equal(stream.repeatFrames, 2);
+
+	mTestGBADrawPattern(core, 0x001F);
+	core->runFrame(core);
+	assert_int_equal(stream.videoFrames, 2);
+	core->runFrame(core);
+	assert_int_equal(stream.repeatFrames, 3);
+
+	// Changes made while frames are skipped still show up in the next frame posted
+	core->skipVideoFrames(core, 1);
+	core->busWrite16(core, GBA_BASE_PALETTE_RAM + 2, 0x7C00);
+	core->runFrame(core);
+	core->runFrame(core);
+	assert_int_equal(stream.videoFrames, 3);
+	assert_int_equal(stream.repeatFrames, 3);
+
+	core->setAVStream(core, NULL);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(buffer);
+}
+
+M_TEST_DEFINE(videoFormat) {
+	color_t* expected = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	color_t* actual = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	struct mCore* reference = mTestGBARenderingCoreCreate(expected, 0);
+	struct mCore* core = mTestGBARenderingCoreCreate(actual, 0);
+	assert_false(core->setVideoFormat(core, mCOLOR_PAL8));
+	assert_true(core->setVideoFormat(core, mCOLOR_NATIVE_SWAPPED));
+	core->reset(core);
+	core->runFrame(core);
+
+	int i;
+	for (i = 0; i < 2; ++i) {
+		struct mCore* target = i ? core : reference;
+		mTestGBADrawPattern(target, 0x03FF);
+		// Brighten the pattern so blending has to work on the converted colors too
+		target->busWrite16(target, GBA_BASE_IO | GBA_REG_BLDCNT, 0x0081);
+		target->busWrite16(target, GBA_BASE_IO | GBA_REG_BLDY, 6);
+		target->runFrame(target);
+	}
+	assert_int_not_equal(expected[0], expected[1]);
+	for (i = 0; i < GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS; ++i) {
+		assert_int_equal(actual[i], mColorSwapRedBlue(expected[i]));
+	}
+
+	mCoreConfigDeinit(&reference->config);
+	reference->deinit(reference);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(expected);
+	free(actual);
+}
+
+M_TEST_DEFINE(bufferPool) {
+	color_t* expected = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	color_t* buffer = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	struct mCore* reference = mTestGBARenderingCoreCreate(expected, 0);
+	struct mCore* core = mTestGBARenderingCoreCreate(buffer, 0);
+	struct mAVBufferPool pool;
+	mAVBufferPoolInit(&pool, 2, GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS, 0x400);
+	struct BufferStream stream = {
+		.d = {
+			.bufferPool = &pool,
+			.postVideoBuffer = _holdVideoBuffer,
+		}
+	};
+	mTestGBADrawPattern(reference, 0x001F);
+	mTestGBADrawPattern(core, 0x001F);
+	core->setAVStream(core, &stream.d);
+	memset(buffer, 0, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * sizeof(color_t));
+
+	reference->runFrame(reference);
+	core->runFrame(core);
+	assert_int_equal(stream.posted, 1);
+	struct mAVBuffer* first = stream.held[0];
+	assert_int_equal(first->width, GBA_VIDEO_HORIZONTAL_PIXELS);
+	assert_int_equal(first->height, GBA_VIDEO_VERTICAL_PIXELS);
+	assert_true(first->nSamples > 0);
+	assert_memory_equal(first->pixels, expected, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * sizeof(color_t));
+	// Nothing gets drawn into the frontend's buffer while the pool is attached
+	assert_int_equal(buffer[0], 0);
+
+	// Both buffers are taken, so this frame has nowhere to go
+	core->runFrame(core);
+	assert_int_equal(stream.posted, 1);
+	assert_int_equal(pool.dropped, 1);
+
+	uint32_t firstFrame = first->frame;
+	uint64_t firstCycles = first->cycles;
+	mAVBufferUnref(first);
+	core->runFrame(core);
+	assert_int_equal(stream.posted, 2);
+	struct mAVBuffer* second = stream.held[1];
+	assert_ptr_not_equal(second, first);
+	assert_int_equal(second->frame, firstFrame + 2);
+	assert_true(second->cycles > firstCycles);
+	assert_memory_equal(second->pixels, expected, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * sizeof(color_t));
+
+	// Detaching hands the frontend's buffer back
+	core->setAVStream(core, NULL);
+	core->runFrame(core);
+	assert_int_equal(stream.posted, 2);
+	assert_memory_equal(buffer, expected, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * sizeof(color_t));
+
+	mAVBufferUnref(second);
+	mAVBufferPoolDeinit(&pool);
+	mCoreConfigDeinit(&reference->config);
+	reference->deinit(reference);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(expected);
+	free(buffer);
+}
+
+static uint32_t _spriteRandom(uint32_t* seed) {
+	*seed = *seed * 1103515245 + 12345;
+	return *seed >> 8;
+}
+
+// Fills OBJ VRAM, palettes and OAM with sprites of every kind: both color depths, flipped, affine
+// and double size, straddling the screen edges, at all priorities over a background
+static void _drawSpriteScene(struct mCore* core, uint32_t seed) {
+	mTestGBADrawPattern(core, 0x001F);
+	core->busWrite16(core, GBA_BASE_IO | GBA_REG_BG0CNT, 0x1F02);
+	unsigned i;
+	for (i = 0; i < 0x100; ++i) {
+		core->busWrite16(core, GBA_BASE_PALETTE_RAM + 0x200 + i * 2, _spriteRandom(&seed) & 0x7FFF);
+	}
+	for (i = 0; i < 0x8000; i += 4) {
+		// Keep plenty of transparent pixels around
+		uint32_t data = _spriteRandom(&seed) | (_spriteRandom(&seed) << 24);
+		data &= _spriteRandom(&seed) | (_spriteRandom(&seed) << 24);
+		core->busWrite32(core, GBA_BASE_VRAM + 0x10000 + i, data);
+	}
+	for (i = 0; i < 128; ++i) {
+		uint16_t a = (_spriteRandom(&seed) & 0xFF) | (_spriteRandom(&seed) & 0xE300);
+		if ((a & 0x0300) == 0x0200) {
+			// Don't waste too many on disabled sprites
+			a &= ~0x0200;
+		}
+		uint16_t b = _spriteRandom(&seed) & 0xFFFF;
+		uint16_t c = _spriteRandom(&seed) & 0xFFFF;
+		core->busWrite16(core, GBA_BASE_OAM + i * 8, a);
+		core->busWrite16(core, GBA_BASE_OAM + i * 8 + 2, b);
+		core->busWrite16(core, GBA_BASE_OAM + i * 8 + 4, c);
+		// Every fourth halfword is an affine matrix parameter
+		core->busWrite16(core, GBA_BASE_OAM + i * 8 + 6, (_spriteRandom(&seed) & 0x3FF) - 0x180);
+	}
+}
+
+M_TEST_DEFINE(renderSprites) {
+	color_t* buffer = calloc(GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	struct mCore* core = mTestGBARenderingCoreCreate(buffer, 0);
+	static const struct {
+		uint16_t dispcnt;
+		uint16_t bldcnt;
+		uint16_t winout;
+	} configs[] = {
+		{ 0x1140, 0x0000, 0x0000 },
+		{ 0x1100, 0x0150, 0x0000 },
+		{ 0x1140, 0x00D0, 0x0000 },
+		{ 0x9140, 0x0150, 0x1F01 },
+	};
+	// Rendered by the per-pixel sprite loops, before any of them had a vectorized counterpart.
+	// The gba.obj and gba.window CInema tests cover sprites drawn by real games.
+	static const uint32_t expected[] = { 0xD70A8023, 0xE4BB0555, 0x48969F40, 0x0EAE8476 };
+	size_t i;
+	for (i = 0; i < 4; ++i) {
+		_drawSpriteScene(core, i + 1);
+		core->busWrite16(core, GBA_BASE_IO | GBA_REG_DISPCNT, configs[i].dispcnt);
+		core->busWrite16(core, GBA_BASE_IO | GBA_REG_BLDCNT, configs[i].bldcnt);
+		core->busWrite16(core, GBA_BASE_IO | GBA_REG_BLDALPHA, 0x0808);
+		core->busWrite16(core, GBA_BASE_IO | GBA_REG_BLDY, 8);
+		core->busWrite16(core, GBA_BASE_IO | GBA_REG_WININ, 0x1F1F);
+		core->busWrite16(core, GBA_BASE_IO | GBA_REG_WINOUT, configs[i].winout);
+		core->busWrite16(core, GBA_BASE_IO | GBA_REG_MOSAIC, 0x2100);
+		core->runFrame(core);
+#ifndef COLOR_16_BIT
+		assert_int_equal(hash32(buffer, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * sizeof(color_t), 0), expected[i]);
+#else
+		UNUSED(expected);
+#endif
+	}
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(buffer);
+}
+
+M_TEST_SUITE_DEFINE(GBAVideo,
+	cmocka_unit_test(skipOutput),
+	cmocka_unit_test(renderAfterSkip),
+	cmocka_unit_test(changedScanlines),
+#ifndef DISABLE_THREADING
+	cmocka_unit_test(renderBands),
+#endif
+	cmocka_unit_test(repeatFrames),
+	cmocka_unit_test(videoFormat),
+	cmocka_unit_test(bufferPool),
+	cmocka_unit_test(renderSprites))
@@ -10,12 +10,105 @@
 
 #define GBA_REG_TMCNT_LO(X) (GBA_REG_TM0CNT_LO + ((X) << 2))
 
+// Timers that nothing is watching still need to be caught up every so often, or the time since
+// they were last updated would overflow
+#define TIMER_CHECKPOINT_INTERVAL 0x20000000
+
+static bool _timerFeedsFIFO(struct GBA* gba, int timerId) {
+	if (timerId >= 2 || !gba->audio.enable) {
+		return false;
+	}
+	if ((gba->audio.chALeft || gba->audio.chARight) && gba->audio.chATimer == timerId) {
+		return true;
+	}
+	return (gba->audio.chBLeft || gba->audio.chBRight) && gba->audio.chBTimer == timerId;
+}
+
+static int _chainRoot(struct GBA* gba, int timerId) {
+	while (GBATimerFlagsIsCountUp(gba->timers[timerId].flags)) {
+		--timerId;
+	}
+	return timerId;
+}
+
+static uint32_t _advance(uint16_t* value, uint16_t reload, int32_t ticks) {
+	int32_t count = *value + ticks;
+	if (count < 0x10000) {
+		*value = count;
+		return 0;
+	}
+	count -= 0x10000;
+	int32_t period = 0x10000 - reload;
+	*value = reload + count % period;
+	return count / period + 1;
+}
+
+// Returns how many ticks of the chain's first timer it takes for this timer to overflow, or 0 if
+// it never will
+static uint64_t _ticksToOverflow(struct GBA* gba, int timerId) {
+	uint64_t overflows = 1;
+	while (true) {
+		struct GBATimer* timer = &gba->timers[timerId];
+		if (!GBATimerFlagsIsEnable(timer->flags)) {
+			return 0;
+		}
+		// Each overflow after the first takes a full period starting from the reload value
+		uint64_t ticks = (0x10000 - gba->memory.io[GBA_REG_TMCNT_LO(timerId) >> 1]) + (overflows - 1) * (0x10000 - timer->reload);
+		if (!GBATimerFlagsIsCountUp(timer->flags)) {
+			return ticks;
+		}
+		if (ticks > (1ULL << 32)) {
+			// This is far past the checkpoint already, so keep it from overflowing further down
+			ticks = 1ULL << 32;
+		}
+		overflows = ticks;
+		--timerId;
+	}
+}
+
+static void _scheduleTimer(struct GBA* gba, int timerId) {
+	struct GBATimer* timer = &gba->timers[timerId];
+	mTimingDeschedule(&gba->timing, &timer->event);
+	timer->flags = GBATimerFlagsClearCheckpoint(timer->flags);
+	if (!GBATimerFlagsIsEnable(timer->flags)) {
+		return;
+	}
+
+	int root = _chainRoot(gba, timerId);
+	struct GBATimer* rootTimer = &gba->timers[root];
+	int prescaleBits = GBATimerFlagsGetPrescaleBits(rootTimer->flags);
+	if (GBATimerFlagsIsBulk(timer->flags)) {
+		// The event's timestamp is still kept up to date as the next overflow
+		timer->event.when = timer->lastEvent + ((0x10000 - gba->memory.io[GBA_REG_TMCNT_LO(timerId) >> 1]) << prescaleBits);
+		return;
+	}
+
+	// Only overflows that raise an IRQ or feed a FIFO need to happen on time. Everything else,
+	// including counting up, is worked out whenever the registers get read.
+	uint64_t ticks = 0;
+	if (GBATimerFlagsIsDoIrq(timer->flags) || _timerFeedsFIFO(gba, timerId)) {
+		ticks = _ticksToOverflow(gba, timerId);
+	}
+	if (!ticks && root != timerId) {
+		// Whatever the chain starts with is what keeps it up to date
+		return;
+	}
+	int64_t when = (int32_t) (rootTimer->lastEvent - mTimingCurrentTime(&gba->timing));
+	when += ticks << prescaleBits;
+	if (!ticks || when > TIMER_CHECKPOINT_INTERVAL) {
+		when = TIMER_CHECKPOINT_INTERVAL;
+		timer->flags = GBATimerFlagsFillCheckpoint(timer->flags);
+	}
+	mTimingSchedule(&gba->timing, &timer->event, when);
+}
+
 static void GBATimerUpdate(struct GBA* gba, int timerId, uint32_t cyclesLate) {
 	struct GBATimer* timer = &gba->timers[timerId];
-	if (GBATimerFlagsIsCountUp(timer->flags)) {
-		gba->memory.io[GBA_REG_TMCNT_LO(timerId) >> 1] = timer->reload;
-	} else {
-		GBATimerUpdateRegister(gba, timerId, cyclesLate);
+	bool overflowed = !GBATimerFlagsIsCheckpoint(timer->flags);
+	GBATimerUpdateRegister(gba, timerId, cyclesLate);
+	_scheduleTimer(gba, timerId);
+	if (!overflowed) {
+		return;
 	}
 
 	if (GBATimerFlagsIsDoIrq(timer->flags)) {
@@ -31,16 +124,6 @@ static void GBATimerUpdate(struct GBA* gba, int timerId, uint32_t cyclesLate) {
 			GBAAudioSampleFIFO(&gba->audio, 1, cyclesLate);
 		}
 	}
-
-	if (timerId < 3) {
-		struct GBATimer* nextTimer = &gba->timers[timerId + 1];
-		if (GBATimerFlagsIsCountUp(nextTimer->flags) && GBATimerFlagsIsEnable(nextTimer->flags)) {
-			++gba->memory.io[GBA_REG_TMCNT_LO(timerId + 1) >> 1];
-			if (!gba->memory.io[GBA_REG_TMCNT_LO(timerId + 1) >> 1] && GBATimerFlagsIsEnable(nextTimer->flags)) {
-				GBATimerUpdate(gba, timerId + 1, cyclesLate);
-			}
-		}
-	}
 }
 
 static void GBATimerUpdate0(struct mTiming* timing, void* context, uint32_t cyclesLate) {
@@ -84,8 +167,10 @@ void GBATimerInit(struct GBA* gba) {
 }
 
 void GBATimerUpdateRegister(struct GBA* gba, int timer, int32_t cyclesLate) {
+	// Timers counting up are only ever advanced along with the timer that starts their chain
+	timer = _chainRoot(gba, timer);
 	struct GBATimer* currentTimer = &gba->timers[timer];
-	if (!GBATimerFlagsIsEnable(currentTimer->flags) || GBATimerFlagsIsCountUp(currentTimer->flags)) {
+	if (!GBATimerFlagsIsEnable(currentTimer->flags)) {
 		return;
 	}
 
@@ -95,26 +180,39 @@ void GBATimerUpdateRegister(struct GBA* gba, int timer, int32_t cyclesLate) {
 	int32_t tickMask = (1 << prescaleBits) - 1;
 	currentTime &= ~tickMask;
 
-	// Update register
+	if (GBATimerFlagsIsBulk(currentTimer->flags)) {
+		// Overflows that haven't been handled yet need to reach the FIFOs before they get folded in
+		GBATimerRunBulk(gba, currentTime);
+	}
+
+	// Update registers
 	int32_t tickIncrement = currentTime - currentTimer->lastEvent;
+	if (tickIncrement < 0) {
+		// Reads are placed a little in the past, which may be before the last update
+		return;
+	}
 	currentTimer->lastEvent = currentTime;
 	tickIncrement >>= prescaleBits;
-	tickIncrement += gba->memory.io[GBA_REG_TMCNT_LO(timer) >> 1];
-	while (tickIncrement >= 0x10000) {
-		tickIncrement -= 0x10000 - currentTimer->reload;
+	uint32_t overflows = _advance(&gba->memory.io[GBA_REG_TMCNT_LO(timer) >> 1], currentTimer->reload, tickIncrement);
+	_scheduleTimer(gba, timer);
+	for (++timer; timer < 4; ++timer) {
+		struct GBATimer* nextTimer = &gba->timers[timer];
+		if (!GBATimerFlagsIsCountUp(nextTimer->flags) || !GBATimerFlagsIsEnable(nextTimer->flags)) {
+			break;
+		}
+		overflows = _advance(&gba->memory.io[GBA_REG_TMCNT_LO(timer) >> 1], nextTimer->reload, overflows);
+		// An overflow that's due right now still needs its event to run
+		if (!mTimingIsScheduled(&gba->timing, &nextTimer->event) || mTimingUntil(&gba->timing, &nextTimer->event) > 0) {
+			_scheduleTimer(gba, timer);
+		}
 	}
-	gba->memory.io[GBA_REG_TMCNT_LO(timer) >> 1] = tickIncrement;
-
-	// Schedule next update
-	tickIncrement = (0x10000 - tickIncrement) << prescaleBits;
-	currentTime += tickIncrement;
-	currentTime &= ~tickMask;
-	mTimingDeschedule(&gba->timing, &currentTimer->event);
-	mTimingScheduleAbsolute(&gba->timing, &currentTimer->event, currentTime);
 }
 
 void GBATimerWriteTMCNT_LO(struct GBA* gba, int timer, uint16_t reload) {
+	// The old reload value still applies to any overflows that haven't been handled yet
+	GBATimerUpdateRegister(gba, timer, 0);
 	gba->timers[timer].reload = reload;
+	GBATimerUpdateEvents(gba);
 }
 
 void GBATimerWriteTMCNT_HI(struct GBA* gba, int timer, uint16_t control) {
@@ -142,12 +240,63 @@ void GBATimerWriteTMCNT_HI(struct GBA* gba, int timer, uint16_t control) {
 		reschedule = true;
 	}
 
-	if (reschedule) {
-		mTimingDeschedule(&gba->timing, &currentTimer->event);
-		if (GBATimerFlagsIsEnable(currentTimer->flags) && !GBATimerFlagsIsCountUp(currentTimer->flags)) {
-			int32_t tickMask = (1 << prescaleBits) - 1;
-			currentTimer->lastEvent = mTimingCurrentTime(&gba->timing) & ~tickMask;
-			GBATimerUpdateRegister(gba, timer, 0);
+	if (reschedule && GBATimerFlagsIsEnable(currentTimer->flags) && !GBATimerFlagsIsCountUp(currentTimer->flags)) {
+		int32_t tickMask = (1 << prescaleBits) - 1;
+		currentTimer->lastEvent = mTimingCurrentTime(&gba->timing) & ~tickMask;
+	}
+	GBATimerUpdateEvents(gba);
+}
+
+void GBATimerUpdateEvents(struct GBA* gba) {
+	int i;
+	for (i = 0; i < 2; ++i) {
+		struct GBATimer* currentTimer = &gba->timers[i];
+		struct GBATimer* nextTimer = &gba->timers[i + 1];
+
+		// Only the FIFOs may observe the overflows: no IRQs, and no timer counting them up
+		bool bulk = gba->audio.bulkFifo;
+		bulk = bulk && GBATimerFlagsIsEnable(currentTimer->flags) && !GBATimerFlagsIsCountUp(currentTimer->flags);
+		bulk = bulk && !GBATimerFlagsIsDoIrq(currentTimer->flags);
+		bulk = bulk && !(GBATimerFlagsIsEnable(nextTimer->flags) && GBATimerFlagsIsCountUp(nextTimer->flags));
+		if (bulk == GBATimerFlagsIsBulk(currentTimer->flags)) {
+			continue;
+		}
+
+		if (!bulk) {
+			GBATimerRunBulk(gba, mTimingCurrentTime(&gba->timing) - 1);
+		}
+		currentTimer->flags = GBATimerFlagsSetBulk(currentTimer->flags, bulk);
+	}
+
+	for (i = 0; i < 4; ++i) {
+		_scheduleTimer(gba, i);
+	}
+}
+
+void GBATimerRunBulk(struct GBA* gba, int32_t timestamp) {
+	int i;
+	for (i = 0; i < 2; ++i) {
+		struct GBATimer* currentTimer = &gba->timers[i];
+		if (!GBATimerFlagsIsBulk(currentTimer->flags)) {
+			continue;
+		}
+		int32_t period = (0x10000 - currentTimer->reload) << GBATimerFlagsGetPrescaleBits(currentTimer->flags);
+		while ((int32_t) (currentTimer->event.when - timestamp) <= 0) {
+			int32_t when = currentTimer->event.when;
+			if (gba->audio.enable) {
+				if ((gba->audio.chALeft || gba->audio.chARight) && gba->audio.chATimer == i) {
+					GBAAudioSampleFIFOBulk(&gba->audio, 0, when);
+				}
+
+				if ((gba->audio.chBLeft || gba->audio.chBRight) && gba->audio.chBTimer == i) {
+					GBAAudioSampleFIFOBulk(&gba->audio, 1, when);
+				}
+			}
+
+			// This is the same state the overflow event would have left the timer in
+			gba->memory.io[GBA_REG_TMCNT_LO(i) >> 1] = currentTimer->reload;
+			currentTimer->lastEvent = when;
+			currentTimer->event.when = when + period;
 		}
 	}
 }
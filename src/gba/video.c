@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gba/video.h>
 
+#include <mgba/core/perf.h>
 #include <mgba/core/sync.h>
 #include <mgba/core/cache-set.h>
 #include <mgba/internal/arm/macros.h>
@@ -25,6 +26,8 @@ static uint16_t GBAVideoDummyRendererWriteVideoRegister(struct GBAVideoRenderer*
 static void GBAVideoDummyRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address);
 static void GBAVideoDummyRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 static void GBAVideoDummyRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam);
+static void GBAVideoDummyRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t length);
+static void GBAVideoDummyRendererWriteOAMRange(struct GBAVideoRenderer* renderer, uint32_t oam, uint32_t count);
 static void GBAVideoDummyRendererDrawScanline(struct GBAVideoRenderer* renderer, int y);
 static void GBAVideoDummyRendererFinishFrame(struct GBAVideoRenderer* renderer);
 static void GBAVideoDummyRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels);
@@ -56,6 +59,8 @@ void GBAVideoInit(struct GBAVideo* video) {
 	video->renderer = NULL;
 	video->vram = anonymousMemoryMap(GBA_SIZE_VRAM);
 	video->frameskip = 0;
+	memset(video->streamChangedScanlines, 0xFF, sizeof(video->streamChangedScanlines));
+	memset(video->coreChangedScanlines, 0xFF, sizeof(video->coreChangedScanlines));
 	video->event.name = "GBA Video";
 	video->event.callback = NULL;
 	video->event.context = video;
@@ -78,6 +83,7 @@ void GBAVideoReset(struct GBAVideo* video) {
 
 	video->frameCounter = 0;
 	video->frameskipCounter = 0;
+	video->skipFrames = 0;
 	video->shouldStall = 0;
 
 	memset(video->palette, 0, sizeof(video->palette));
@@ -105,6 +111,8 @@ void GBAVideoDummyRendererCreate(struct GBAVideoRenderer* renderer) {
 		.writeVRAM = GBAVideoDummyRendererWriteVRAM,
 		.writePalette = GBAVideoDummyRendererWritePalette,
 		.writeOAM = GBAVideoDummyRendererWriteOAM,
+		.writeVRAMRange = GBAVideoDummyRendererWriteVRAMRange,
+		.writeOAMRange = GBAVideoDummyRendererWriteOAMRange,
 		.drawScanline = GBAVideoDummyRendererDrawScanline,
 		.finishFrame = GBAVideoDummyRendererFinishFrame,
 		.getPixels = GBAVideoDummyRendererGetPixels,
@@ -126,6 +134,7 @@ void GBAVideoAssociateRenderer(struct GBAVideo* video, struct GBAVideoRenderer*
 	renderer->oam = &video->oam;
 	video->renderer->init(video->renderer);
 	video->renderer->reset(video->renderer);
+	memset(renderer->changedScanlines, 0xFF, sizeof(renderer->changedScanlines));
 	renderer->writeVideoRegister(renderer, GBA_REG_DISPCNT, video->p->memory.io[GBA_REG(DISPCNT)]);
 	renderer->writeVideoRegister(renderer, GBA_REG_GREENSWP, video->p->memory.io[GBA_REG(GREENSWP)]);
 	int address;
@@ -171,15 +180,21 @@ void _startHdraw(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 		break;
 	case GBA_VIDEO_VERTICAL_PIXELS:
 		video->p->memory.io[GBA_REG(DISPSTAT)] = GBARegisterDISPSTATFillInVblank(dispstat);
-		if (video->frameskipCounter <= 0) {
+		if (video->frameskipCounter <= 0 && !video->skipFrames) {
+			mTRACE_BEGIN("Finish frame");
 			video->renderer->finishFrame(video->renderer);
+			mTRACE_END();
 		}
 		GBADMARunVblank(video->p, -cyclesLate);
 		if (GBARegisterDISPSTATIsVblankIRQ(dispstat)) {
 			GBARaiseIRQ(video->p, GBA_IRQ_VBLANK, cyclesLate);
 		}
 		GBAFrameEnded(video->p);
-		mCoreSyncPostFrame(video->p->sync);
+		if (video->skipFrames) {
+			--video->skipFrames;
+		} else {
+			mCoreSyncPostFrame(video->p->sync);
+		}
 		--video->frameskipCounter;
 		if (video->frameskipCounter < 0) {
 			video->frameskipCounter = video->frameskip;
@@ -201,8 +216,10 @@ void _startHblank(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	// Begin Hblank
 	GBARegisterDISPSTAT dispstat = video->p->memory.io[GBA_REG(DISPSTAT)];
 	dispstat = GBARegisterDISPSTATFillInHblank(dispstat);
-	if (video->vcount < GBA_VIDEO_VERTICAL_PIXELS && video->frameskipCounter <= 0) {
+	if (video->vcount < GBA_VIDEO_VERTICAL_PIXELS && video->frameskipCounter <= 0 && !video->skipFrames) {
+		mPERF_ENTER(VIDEO);
 		video->renderer->drawScanline(video->renderer, video->vcount);
+		mPERF_LEAVE();
 	}
 
 	if (video->vcount < GBA_VIDEO_VERTICAL_PIXELS) {
@@ -218,6 +235,15 @@ void _startHblank(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	video->p->memory.io[GBA_REG(DISPSTAT)] = dispstat;
 }
 
+void GBAVideoCollectChangedScanlines(struct GBAVideo* video) {
+	size_t i;
+	for (i = 0; i < sizeof(video->renderer->changedScanlines) / sizeof(*video->renderer->changedScanlines); ++i) {
+		video->streamChangedScanlines[i] |= video->renderer->changedScanlines[i];
+		video->coreChangedScanlines[i] |= video->renderer->changedScanlines[i];
+		video->renderer->changedScanlines[i] = 0;
+	}
+}
+
 void GBAVideoWriteDISPSTAT(struct GBAVideo* video, uint16_t value) {
 	video->p->memory.io[GBA_REG(DISPSTAT)] &= 0x7;
 	video->p->memory.io[GBA_REG(DISPSTAT)] |= value;
@@ -299,6 +325,19 @@ static void GBAVideoDummyRendererWriteOAM(struct GBAVideoRenderer* renderer, uin
 	// Nothing to do
 }
 
+static void GBAVideoDummyRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t length) {
+	if (renderer->cache) {
+		mCacheSetWriteVRAMRange(renderer->cache, address, length);
+	}
+}
+
+static void GBAVideoDummyRendererWriteOAMRange(struct GBAVideoRenderer* renderer, uint32_t oam, uint32_t count) {
+	UNUSED(renderer);
+	UNUSED(oam);
+	UNUSED(count);
+	// Nothing to do
+}
+
 static void GBAVideoDummyRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
 	UNUSED(renderer);
 	UNUSED(y);
@@ -306,8 +345,7 @@ static void GBAVideoDummyRendererDrawScanline(struct GBAVideoRenderer* renderer,
 }
 
 static void GBAVideoDummyRendererFinishFrame(struct GBAVideoRenderer* renderer) {
-	UNUSED(renderer);
-	// Nothing to do
+	memset(renderer->changedScanlines, 0xFF, sizeof(renderer->changedScanlines));
 }
 
 static void GBAVideoDummyRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels) {
@@ -340,17 +378,10 @@ void GBAVideoSerialize(const struct GBAVideo* video, struct GBASerializedState*
 }
 
 void GBAVideoDeserialize(struct GBAVideo* video, const struct GBASerializedState* state) {
+	// The renderer is reset at the end, which picks all of these up at once
 	memcpy(video->vram, state->vram, GBA_SIZE_VRAM);
-	uint16_t value;
-	int i;
-	for (i = 0; i < GBA_SIZE_OAM; i += 2) {
-		LOAD_16(value, i, state->oam);
-		GBAStore16(video->p->cpu, GBA_BASE_OAM | i, value, 0);
-	}
-	for (i = 0; i < GBA_SIZE_PALETTE_RAM; i += 2) {
-		LOAD_16(value, i, state->pram);
-		GBAStore16(video->p->cpu, GBA_BASE_PALETTE_RAM | i, value, 0);
-	}
+	memcpy(video->oam.raw, state->oam, GBA_SIZE_OAM);
+	memcpy(video->palette, state->pram, GBA_SIZE_PALETTE_RAM);
 	LOAD_32(video->frameCounter, 0, &state->video.frameCounter);
 
 	video->shouldStall = 0;
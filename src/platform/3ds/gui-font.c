@@ -52,6 +52,7 @@ struct GUIFont* GUIFontCreate(void) {
 }
 
 void GUIFontDestroy(struct GUIFont* font) {
+	GUIFontClearRunCache();
 	free(font->sheets);
 	C3D_TexDelete(&font->icons);
 	free(font);
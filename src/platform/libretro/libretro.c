@@ -23,6 +23,10 @@
 #include <mgba/gba/core.h>
 #include <mgba/gba/interface.h>
 #include <mgba/internal/gba/gba.h>
+#ifdef BUILD_GLES3
+#include <mgba/internal/gba/renderers/gl.h>
+#define LIBRETRO_HW_RENDER
+#endif
 #endif
 #include <mgba-util/memory.h>
 #include <mgba-util/vfs.h>
@@ -41,6 +45,7 @@
 #define VIDEO_WIDTH_MAX  256
 #define VIDEO_HEIGHT_MAX 224
 #define VIDEO_BUFF_SIZE  (VIDEO_WIDTH_MAX * VIDEO_HEIGHT_MAX * sizeof(color_t))
+#define VIDEO_SCALE_MAX  6
 
 static retro_environment_t environCallback;
 static retro_video_refresh_t videoCallback;
@@ -66,6 +71,10 @@ static void _updateRotation(struct mRotationSource* source);
 static int32_t _readTiltX(struct mRotationSource* source);
 static int32_t _readTiltY(struct mRotationSource* source);
 static int32_t _readGyroZ(struct mRotationSource* source);
+#ifdef LIBRETRO_HW_RENDER
+static void _hwRenderContextReset(void);
+static void _hwRenderContextDestroy(void);
+#endif
 
 static struct mCore* core;
 static color_t* outputBuffer = NULL;
@@ -76,6 +85,8 @@ static void* data;
 static size_t dataSize;
 static void* savedata;
 static struct mAVStream stream;
+static bool canDupe;
+static enum retro_pixel_format pixelFormat;
 static bool sensorsInitDone;
 static bool rumbleInitDone;
 static int rumbleUp;
@@ -108,6 +119,12 @@ static bool audioLowPassEnabled = false;
 static int32_t audioLowPassRange = 0;
 static int32_t audioLowPassLeftPrev = 0;
 static int32_t audioLowPassRightPrev = 0;
+#ifdef LIBRETRO_HW_RENDER
+static struct retro_hw_render_callback hwRender;
+static bool hwRenderRequested = false;
+static GLuint hwRenderTex = 0;
+static GLuint hwRenderFbo = 0;
+#endif
 
 static const int keymap[] = {
 	RETRO_DEVICE_ID_JOYPAD_A,
@@ -250,6 +267,120 @@ static void _updateGbPal(void) {
 }
 #endif
 
+#ifdef LIBRETRO_HW_RENDER
+static void _loadVideoScaleSettings(void) {
+	struct retro_variable var = {
+		.key = "mgba_gba_video_scale",
+		.value = 0
+	};
+	if (environCallback(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value) {
+		int scale = strtol(var.value, NULL, 10);
+		if (scale < 1) {
+			scale = 1;
+		} else if (scale > VIDEO_SCALE_MAX) {
+			scale = VIDEO_SCALE_MAX;
+		}
+		mCoreConfigSetIntValue(&core->config, "videoScale", scale);
+	}
+}
+
+static void _updateGeometry(void) {
+	struct retro_system_av_info info;
+	retro_get_system_av_info(&info);
+	environCallback(RETRO_ENVIRONMENT_SET_GEOMETRY, &info.geometry);
+}
+
+static bool _requestHwRender(void) {
+	struct retro_variable var = {
+		.key = "mgba_gba_hw_render",
+		.value = 0
+	};
+	if (!environCallback(RETRO_ENVIRONMENT_GET_VARIABLE, &var) || !var.value || strcmp(var.value, "ON") != 0) {
+		return false;
+	}
+
+	memset(&hwRender, 0, sizeof(hwRender));
+	hwRender.context_reset = _hwRenderContextReset;
+	hwRender.context_destroy = _hwRenderContextDestroy;
+	// The renderer stores scanline 0 in the first row of its output, matching libretro's default origin
+	hwRender.bottom_left_origin = false;
+	hwRender.depth = false;
+	hwRender.stencil = false;
+
+#ifdef BUILD_GL
+	hwRender.context_type = RETRO_HW_CONTEXT_OPENGL_CORE;
+	hwRender.version_major = 3;
+	hwRender.version_minor = 3;
+	if (environCallback(RETRO_ENVIRONMENT_SET_HW_RENDER, &hwRender)) {
+		return true;
+	}
+#endif
+#if !defined(BUILD_GL) || defined(USE_EPOXY)
+	hwRender.context_type = RETRO_HW_CONTEXT_OPENGLES3;
+	hwRender.version_major = 3;
+	hwRender.version_minor = 0;
+	if (environCallback(RETRO_ENVIRONMENT_SET_HW_RENDER, &hwRender)) {
+		return true;
+	}
+#endif
+	if (logCallback) {
+		logCallback(RETRO_LOG_WARN, "Frontend refused an OpenGL 3 context, using the software renderer\n");
+	}
+	return false;
+}
+
+static void _hwRenderContextReset(void) {
+	if (!core) {
+		return;
+	}
+	glGenTextures(1, &hwRenderTex);
+	glBindTexture(GL_TEXTURE_2D, hwRenderTex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Swapping the renderer carries the video state over, so this works mid-game too
+	mCoreConfigSetIntValue(&core->config, "hwaccelVideo", 1);
+	core->setVideoGLTex(core, hwRenderTex);
+	core->reloadConfigOption(core, "hwaccelVideo", NULL);
+
+	// The renderer has allocated the texture by now, so it can be read back through an FBO
+	glGenFramebuffers(1, &hwRenderFbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, hwRenderFbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, hwRenderTex, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	_updateGeometry();
+}
+
+static void _hwRenderContextDestroy(void) {
+	if (core && hwRenderTex) {
+		mCoreConfigSetIntValue(&core->config, "hwaccelVideo", 0);
+		core->setVideoGLTex(core, -1);
+		core->reloadConfigOption(core, "hwaccelVideo", NULL);
+		core->setVideoBuffer(core, outputBuffer, VIDEO_WIDTH_MAX);
+	}
+	if (hwRenderFbo) {
+		glDeleteFramebuffers(1, &hwRenderFbo);
+		hwRenderFbo = 0;
+	}
+	if (hwRenderTex) {
+		glDeleteTextures(1, &hwRenderTex);
+		hwRenderTex = 0;
+	}
+}
+
+static void _hwRenderPresent(unsigned width, unsigned height) {
+	// Copy the frame on the GPU instead of reading it back and handing the frontend a buffer to upload
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, hwRenderFbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint) hwRender.get_current_framebuffer());
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	videoCallback(RETRO_HW_FRAME_BUFFER_VALID, width, height, 0);
+}
+#endif
+
 static void _reloadSettings(void) {
 	struct mCoreOptions opts = {
 		.useBios = true,
@@ -336,6 +467,9 @@ static void _reloadSettings(void) {
 		mCoreConfigSetDefaultIntValue(&core->config, "gba.forceGbp", strcmp(var.value, "ON") == 0);
 	}
 #endif
+#ifdef LIBRETRO_HW_RENDER
+	_loadVideoScaleSettings();
+#endif
 
 	mCoreConfigLoadDefaults(&core->config, &opts);
 	mCoreLoadConfig(core);
@@ -353,6 +487,38 @@ static void _doDeferredSetup(void) {
 	deferredSetup = false;
 }
 
+static bool _useFrontendFramebuffer(struct retro_framebuffer* fb) {
+#ifdef M_CORE_GBA
+	// GB frames can change size partway through when SGB borders turn on, so only GBA renders in place
+	if (core->platform(core) != mPLATFORM_GBA) {
+		return false;
+	}
+#ifdef LIBRETRO_HW_RENDER
+	if (hwRenderTex) {
+		return false;
+	}
+#endif
+	unsigned width, height;
+	core->currentVideoSize(core, &width, &height);
+	memset(fb, 0, sizeof(*fb));
+	fb->width = width;
+	fb->height = height;
+	fb->access_flags = RETRO_MEMORY_ACCESS_WRITE;
+	if (!environCallback(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, fb) || !fb->data) {
+		return false;
+	}
+	if (fb->format != pixelFormat || fb->pitch % BYTES_PER_PIXEL || fb->pitch < width * BYTES_PER_PIXEL) {
+		return false;
+	}
+	// This marks every scanline dirty, since the frontend's buffer may hold anything
+	core->setVideoBuffer(core, fb->data, fb->pitch / BYTES_PER_PIXEL);
+	return true;
+#else
+	UNUSED(fb);
+	return false;
+#endif
+}
+
 unsigned retro_api_version(void) {
 	return RETRO_API_VERSION;
 }
@@ -419,10 +585,17 @@ void retro_get_system_av_info(struct retro_system_av_info* info) {
 	info->geometry.base_height = height;
 
 	core->baseVideoSize(core, &width, &height);
+	info->geometry.aspect_ratio = width / (double) height;
+#ifdef LIBRETRO_HW_RENDER
+	// The frontend sizes its framebuffer from this, so leave room for changing the scale later
+	if (hwRenderRequested) {
+		width *= VIDEO_SCALE_MAX;
+		height *= VIDEO_SCALE_MAX;
+	}
+#endif
 	info->geometry.max_width = width;
 	info->geometry.max_height = height;
 
-	info->geometry.aspect_ratio = width / (double) height;
 	info->timing.fps = core->frequency(core) / (float) core->frameCycles(core);
 	info->timing.sample_rate = SAMPLE_RATE;
 }
@@ -433,14 +606,13 @@ void retro_init(void) {
 #ifdef COLOR_5_6_5
 	fmt = RETRO_PIXEL_FORMAT_RGB565;
 #else
-#warning This pixel format is unsupported. Please use -DCOLOR_16-BIT -DCOLOR_5_6_5
 	fmt = RETRO_PIXEL_FORMAT_0RGB1555;
 #endif
 #else
-#warning This pixel format is unsupported. Please use -DCOLOR_16-BIT -DCOLOR_5_6_5
 	fmt = RETRO_PIXEL_FORMAT_XRGB8888;
 #endif
 	environCallback(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt);
+	pixelFormat = fmt;
 
 	struct retro_input_descriptor inputDescriptors[] = {
 		{ 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_A, "A" },
@@ -460,6 +632,9 @@ void retro_init(void) {
 	environCallback(RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS, &inputDescriptors);
 
 	useBitmasks = environCallback(RETRO_ENVIRONMENT_GET_INPUT_BITMASKS, NULL);
+	if (!environCallback(RETRO_ENVIRONMENT_GET_CAN_DUPE, &canDupe)) {
+		canDupe = false;
+	}
 
 	// TODO: RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME when BIOS booting is supported
 
@@ -567,6 +742,19 @@ void retro_run(void) {
 
 #ifdef M_CORE_GB
 		_updateGbPal();
+#endif
+#ifdef LIBRETRO_HW_RENDER
+		if (hwRenderRequested) {
+			unsigned oldWidth, oldHeight;
+			core->currentVideoSize(core, &oldWidth, &oldHeight);
+			_loadVideoScaleSettings();
+			core->reloadConfigOption(core, "videoScale", NULL);
+			unsigned newWidth, newHeight;
+			core->currentVideoSize(core, &newWidth, &newHeight);
+			if (oldWidth != newWidth || oldHeight != newHeight) {
+				_updateGeometry();
+			}
+		}
 #endif
 	}
 
@@ -606,10 +794,41 @@ void retro_run(void) {
 		}
 	}
 
+	bool videoEnabled = true;
+	int avEnable;
+	if (environCallback(RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE, &avEnable)) {
+		// Run-ahead and netplay replays run frames that are never shown or heard
+		if (!(avEnable & 1)) {
+			videoEnabled = false;
+			core->skipVideoFrames(core, 1);
+		}
+		if (!(avEnable & 2)) {
+			core->skipAudioFrames(core, 1);
+		}
+	}
+	struct retro_framebuffer frontendFb;
+	bool useFrontendFb = videoEnabled && _useFrontendFramebuffer(&frontendFb);
+
 	core->runFrame(core);
 	unsigned width, height;
 	core->currentVideoSize(core, &width, &height);
-	videoCallback(outputBuffer, width, height, BYTES_PER_PIXEL * 256);
+	uint32_t changedScanlines[(VIDEO_HEIGHT_MAX + 31) / 32];
+	if (!videoEnabled) {
+		// The frontend drops the frame anyway, and nothing was rendered
+#ifdef LIBRETRO_HW_RENDER
+	} else if (hwRenderTex) {
+		_hwRenderPresent(width, height);
+#endif
+	} else if (useFrontendFb) {
+		videoCallback(frontendFb.data, width, height, frontendFb.pitch);
+		// The frontend's buffer is only valid until retro_run returns
+		core->setVideoBuffer(core, outputBuffer, VIDEO_WIDTH_MAX);
+	} else if (!core->getChangedScanlines(core, changedScanlines) && canDupe) {
+		// The frontend can show the last frame again without having to copy it
+		videoCallback(NULL, width, height, BYTES_PER_PIXEL * 256);
+	} else {
+		videoCallback(outputBuffer, width, height, BYTES_PER_PIXEL * 256);
+	}
 
 #ifdef M_CORE_GBA
 	if (core->platform(core) == mPLATFORM_GBA) {
@@ -872,6 +1091,9 @@ bool retro_load_game(const struct retro_game_info* game) {
 	outputBuffer = malloc(VIDEO_BUFF_SIZE);
 	memset(outputBuffer, 0xFF, VIDEO_BUFF_SIZE);
 	core->setVideoBuffer(core, outputBuffer, VIDEO_WIDTH_MAX);
+#if !defined(COLOR_16_BIT) || !defined(COLOR_5_6_5)
+	core->setVideoFormat(core, mCOLOR_NATIVE_SWAPPED);
+#endif
 
 	#ifdef M_CORE_GBA
 	/* GBA emulation produces a fairly regular number
@@ -929,6 +1151,11 @@ bool retro_load_game(const struct retro_game_info* game) {
 
 	_reloadSettings();
 	core->loadROM(core, rom);
+#ifdef LIBRETRO_HW_RENDER
+	if (core->platform(core) == mPLATFORM_GBA) {
+		hwRenderRequested = _requestHwRender();
+	}
+#endif
 	deferredSetup = true;
 
 	const char* sysDir = 0;
@@ -998,8 +1225,14 @@ void retro_unload_game(void) {
 	if (!core) {
 		return;
 	}
+#ifdef LIBRETRO_HW_RENDER
+	// Release the GL objects while the context is still current; it may only be destroyed after the core is gone
+	_hwRenderContextDestroy();
+	hwRenderRequested = false;
+#endif
 	mCoreConfigDeinit(&core->config);
 	core->deinit(core);
+	core = NULL;
 	mappedMemoryFree(data, dataSize);
 	data = 0;
 	mappedMemoryFree(savedata, GBA_SIZE_FLASH1M);
@@ -168,6 +168,40 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "ON"
    },
+#ifdef LIBRETRO_HW_RENDER
+   {
+      "mgba_gba_hw_render",
+      "Game Boy Advance Hardware Renderer (Restart)",
+      NULL,
+      "Render Game Boy Advance games with OpenGL 3 or OpenGL ES 3 when the frontend supports it. This skips uploading every frame from the CPU and allows rendering at higher internal resolutions, but may be less accurate than the software renderer.",
+      NULL,
+      "video",
+      {
+         { "OFF", "disabled" },
+         { "ON",  "enabled" },
+         { NULL, NULL },
+      },
+      "OFF"
+   },
+   {
+      "mgba_gba_video_scale",
+      "Game Boy Advance Internal Resolution",
+      NULL,
+      "Scale up the internal resolution of the hardware renderer. Affine and rotated backgrounds and sprites are drawn at the higher resolution. Has no effect with the software renderer.",
+      NULL,
+      "video",
+      {
+         { "1", "1x (240x160)" },
+         { "2", "2x (480x320)" },
+         { "3", "3x (720x480)" },
+         { "4", "4x (960x640)" },
+         { "5", "5x (1200x800)" },
+         { "6", "6x (1440x960)" },
+         { NULL, NULL },
+      },
+      "1"
+   },
+#endif
    {
       "mgba_audio_low_pass_filter",
       "Audio Filter",
@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "gl.h"
 
+#include <mgba-util/image.h>
 #include <mgba-util/math.h>
 
 static const GLint _glVertices[] = {
@@ -280,6 +281,45 @@ void mGLContextPostFrame(struct VideoBackend* v, enum VideoLayer layer, const vo
 #endif
 }
 
+static void mGLContextSetImageRegion(struct VideoBackend* v, enum VideoLayer layer, const struct mRectangle* region, const void* frame) {
+	struct mGLContext* context = (struct mGLContext*) v;
+	if (layer >= VIDEO_LAYER_MAX) {
+		return;
+	}
+	int width = context->imageSizes[layer].width;
+	int height = context->imageSizes[layer].height;
+	if (layer == VIDEO_LAYER_IMAGE || width <= 0 || height <= 0) {
+		mGLContextPostFrame(v, layer, frame);
+		return;
+	}
+
+	// Without GL_UNPACK_ROW_LENGTH on GLES2, upload whole rows so the source stays contiguous
+	int y = region->y;
+	if (y < 0) {
+		y = 0;
+	}
+	if (region->y + region->height < height) {
+		height = region->y + region->height;
+	}
+	height -= y;
+	if (height <= 0) {
+		return;
+	}
+	const uint8_t* rows = (const uint8_t*) frame + y * width * BYTES_PER_PIXEL;
+	glBindTexture(GL_TEXTURE_2D, context->layers[layer]);
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, height, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, rows);
+#else
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, height, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, rows);
+#endif
+#elif defined(__BIG_ENDIAN__)
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, height, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, rows);
+#else
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rows);
+#endif
+}
+
 void mGLContextCreate(struct mGLContext* context) {
 	context->d.init = mGLContextInit;
 	context->d.deinit = mGLContextDeinit;
@@ -291,5 +331,7 @@ void mGLContextCreate(struct mGLContext* context) {
 	context->d.setImageSize = mGLContextSetImageSize;
 	context->d.imageSize = mGLContextImageSize;
 	context->d.setImage = mGLContextPostFrame;
+	context->d.setImageRegion = mGLContextSetImageRegion;
 	context->d.drawFrame = mGLContextDrawFrame;
+	context->d.flush = NULL;
 }
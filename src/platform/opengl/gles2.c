@@ -8,6 +8,7 @@
 #include <mgba/core/log.h>
 #include <mgba-util/configuration.h>
 #include <mgba-util/formatting.h>
+#include <mgba-util/image.h>
 #include <mgba-util/math.h>
 #include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
@@ -551,6 +552,45 @@ void mGLES2ContextPostFrame(struct VideoBackend* v, enum VideoLayer layer, const
 #endif
 }
 
+static void mGLES2ContextSetImageRegion(struct VideoBackend* v, enum VideoLayer layer, const struct mRectangle* region, const void* frame) {
+	struct mGLES2Context* context = (struct mGLES2Context*) v;
+	if (layer >= VIDEO_LAYER_MAX) {
+		return;
+	}
+	int width = context->imageSizes[layer].width;
+	int height = context->imageSizes[layer].height;
+	if (layer == VIDEO_LAYER_IMAGE || width <= 0 || height <= 0) {
+		mGLES2ContextPostFrame(v, layer, frame);
+		return;
+	}
+
+	// Without GL_UNPACK_ROW_LENGTH on GLES2, upload whole rows so the source stays contiguous
+	int y = region->y;
+	if (y < 0) {
+		y = 0;
+	}
+	if (region->y + region->height < height) {
+		height = region->y + region->height;
+	}
+	height -= y;
+	if (height <= 0) {
+		return;
+	}
+	const uint8_t* rows = (const uint8_t*) frame + y * width * BYTES_PER_PIXEL;
+	glBindTexture(GL_TEXTURE_2D, context->tex[layer]);
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, height, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, rows);
+#else
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, height, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, rows);
+#endif
+#elif defined(__BIG_ENDIAN__)
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, height, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, rows);
+#else
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rows);
+#endif
+}
+
 void mGLES2ContextCreate(struct mGLES2Context* context) {
 	context->d.init = mGLES2ContextInit;
 	context->d.deinit = mGLES2ContextDeinit;
@@ -562,7 +602,9 @@ void mGLES2ContextCreate(struct mGLES2Context* context) {
 	context->d.setImageSize = mGLES2ContextSetImageSize;
 	context->d.imageSize = mGLES2ContextImageSize;
 	context->d.setImage = mGLES2ContextPostFrame;
+	context->d.setImageRegion = mGLES2ContextSetImageRegion;
 	context->d.drawFrame = mGLES2ContextDrawFrame;
+	context->d.flush = NULL;
 	context->shaders = 0;
 	context->nShaders = 0;
 }
@@ -17,6 +17,17 @@
 
 #ifndef DISABLE_ANON_MMAP
 #include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__) && !defined(__ANDROID__) && defined(MFD_CLOEXEC)
+#define USE_MEMFD
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#define USE_SHM_OPEN
+#endif
+
+#if defined(USE_MEMFD) || defined(USE_SHM_OPEN)
+#include <fcntl.h>
+#endif
 
 void* anonymousMemoryMap(size_t size) {
 	return mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
@@ -25,6 +36,115 @@ void* anonymousMemoryMap(size_t size) {
 void mappedMemoryFree(void* memory, size_t size) {
 	munmap(memory, size);
 }
+
+#ifdef __linux__
+static uintptr_t _pageSize(void) {
+	static uintptr_t pageSize = 0;
+	if (!pageSize) {
+		pageSize = sysconf(_SC_PAGESIZE);
+	}
+	return pageSize;
+}
+#endif
+
+void mappedMemoryClear(void* memory, size_t size) {
+#ifdef __linux__
+	// Other systems may keep the old contents of pages dropped this way
+	uintptr_t start = (uintptr_t) memory;
+	uintptr_t end = start + size;
+	uintptr_t pageStart = (start + _pageSize() - 1) & ~(_pageSize() - 1);
+	uintptr_t pageEnd = end & ~(_pageSize() - 1);
+	if (pageStart < pageEnd && madvise((void*) pageStart, pageEnd - pageStart, MADV_DONTNEED) == 0) {
+		memset(memory, 0, pageStart - start);
+		memset((void*) pageEnd, 0, end - pageEnd);
+		return;
+	}
+#endif
+	memset(memory, 0, size);
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+#ifdef __linux__
+	uintptr_t start = (uintptr_t) memory;
+	uintptr_t end = start + size;
+	uintptr_t pageStart = start & ~(_pageSize() - 1);
+	size_t pages = (end - pageStart + _pageSize() - 1) / _pageSize();
+	unsigned char vector[256];
+	size_t resident = 0;
+	size_t i;
+	for (i = 0; i < pages; i += sizeof(vector)) {
+		size_t chunk = pages - i < sizeof(vector) ? pages - i : sizeof(vector);
+		uintptr_t chunkStart = pageStart + i * _pageSize();
+		if (mincore((void*) chunkStart, chunk * _pageSize(), vector) != 0) {
+			return size;
+		}
+		size_t j;
+		for (j = 0; j < chunk; ++j) {
+			if (!(vector[j] & 1)) {
+				continue;
+			}
+			uintptr_t page = chunkStart + j * _pageSize();
+			uintptr_t pageEnd = page + _pageSize();
+			resident += (pageEnd < end ? pageEnd : end) - (page > start ? page : start);
+		}
+	}
+	return resident;
+#else
+	UNUSED(memory);
+	return size;
+#endif
+}
+
+#if defined(USE_MEMFD) || defined(USE_SHM_OPEN)
+bool sharedMemoryCreate(struct SharedMemory* memory, size_t size) {
+#ifdef USE_MEMFD
+	int fd = memfd_create("mgba", MFD_CLOEXEC);
+#else
+	char name[32];
+	snprintf(name, sizeof(name), "/mgba-%ld-%p", (long) getpid(), (void*) memory);
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd >= 0) {
+		shm_unlink(name);
+	}
+#endif
+	if (fd < 0) {
+		return false;
+	}
+	if (ftruncate(fd, size) < 0) {
+		close(fd);
+		return false;
+	}
+	void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		close(fd);
+		return false;
+	}
+	memory->data = data;
+	memory->size = size;
+	memory->handle = fd;
+	return true;
+}
+
+void sharedMemoryDestroy(struct SharedMemory* memory) {
+	munmap(memory->data, memory->size);
+	close(memory->handle);
+	memory->data = NULL;
+	memory->size = 0;
+	memory->handle = -1;
+}
+
+void* sharedMemoryMapPrivate(const struct SharedMemory* memory) {
+	void* data = mmap(0, memory->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, memory->handle, 0);
+	if (data == MAP_FAILED) {
+		return NULL;
+	}
+	return data;
+}
+
+void sharedMemoryUnmapPrivate(const struct SharedMemory* memory, void* data) {
+	munmap(data, memory->size);
+}
+#endif
 #else
 void* anonymousMemoryMap(size_t size) {
 	return calloc(1, size);
@@ -34,4 +154,80 @@ void mappedMemoryFree(void* memory, size_t size) {
 	UNUSED(size);
 	free(memory);
 }
+
+void mappedMemoryClear(void* memory, size_t size) {
+	memset(memory, 0, size);
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+	UNUSED(memory);
+	return size;
+}
+#endif
+
+#if (defined(__linux__) && !defined(__ANDROID__)) || defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+bool sharedMemoryCreateNamed(struct SharedMemory* memory, const char* name, size_t size) {
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "/%s", name);
+	int fd = shm_open(path, O_RDWR | O_CREAT, 0600);
+	if (fd < 0) {
+		return false;
+	}
+	if (ftruncate(fd, size) < 0) {
+		close(fd);
+		return false;
+	}
+	void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		close(fd);
+		return false;
+	}
+	memory->data = data;
+	memory->size = size;
+	memory->handle = fd;
+	return true;
+}
+
+void sharedMemoryRemoveNamed(const char* name) {
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "/%s", name);
+	shm_unlink(path);
+}
+#else
+bool sharedMemoryCreateNamed(struct SharedMemory* memory, const char* name, size_t size) {
+	UNUSED(memory);
+	UNUSED(name);
+	UNUSED(size);
+	return false;
+}
+
+void sharedMemoryRemoveNamed(const char* name) {
+	UNUSED(name);
+}
+#endif
+
+#if defined(DISABLE_ANON_MMAP) || !(defined(USE_MEMFD) || defined(USE_SHM_OPEN))
+bool sharedMemoryCreate(struct SharedMemory* memory, size_t size) {
+	UNUSED(memory);
+	UNUSED(size);
+	return false;
+}
+
+void sharedMemoryDestroy(struct SharedMemory* memory) {
+	UNUSED(memory);
+}
+
+void* sharedMemoryMapPrivate(const struct SharedMemory* memory) {
+	UNUSED(memory);
+	return NULL;
+}
+
+void sharedMemoryUnmapPrivate(const struct SharedMemory* memory, void* data) {
+	UNUSED(memory);
+	UNUSED(data);
+}
 #endif
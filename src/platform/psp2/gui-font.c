@@ -31,6 +31,7 @@ struct GUIFont* GUIFontCreate(void) {
 }
 
 void GUIFontDestroy(struct GUIFont* font) {
+	GUIFontClearRunCache();
 	vita2d_free_pgf(font->pgf);
 	vita2d_free_texture(font->icons);
 	free(font);
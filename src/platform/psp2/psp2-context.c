@@ -103,6 +103,7 @@ void mPSP2MapKey(struct mInputMap* map, int pspKey, int key) {
 
 static THREAD_ENTRY _audioThread(void* context) {
 	struct mPSP2AudioContext* audio = (struct mPSP2AudioContext*) context;
+	ThreadSetAffinity(2);
 	uint32_t zeroBuffer[PSP2_SAMPLES] = {0};
 	void* buffer = zeroBuffer;
 	int audioPort = sceAudioOutOpenPort(SCE_AUDIO_OUT_PORT_TYPE_MAIN, PSP2_SAMPLES, 48000, SCE_AUDIO_OUT_MODE_STEREO);
@@ -303,6 +304,8 @@ void mPSP2SetFrameLimiter(struct mGUIRunner* runner, bool limit) {
 }
 
 void mPSP2Setup(struct mGUIRunner* runner) {
+	// Emulation keeps the first core and audio takes the third, leaving the second to threaded video
+	ThreadSetAffinity(0);
 	mCoreConfigSetDefaultIntValue(&runner->config, "threadedVideo", 1);
 	mCoreLoadForeignConfig(runner->core, &runner->config);
 
@@ -30,3 +30,43 @@ void mappedMemoryFree(void* memory, size_t size) {
 		sceKernelFreeMemBlock(uid);
 	}
 }
+
+void mappedMemoryClear(void* memory, size_t size) {
+	memset(memory, 0, size);
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+	UNUSED(memory);
+	return size;
+}
+
+bool sharedMemoryCreate(struct SharedMemory* memory, size_t size) {
+	UNUSED(memory);
+	UNUSED(size);
+	return false;
+}
+
+void sharedMemoryDestroy(struct SharedMemory* memory) {
+	UNUSED(memory);
+}
+
+void* sharedMemoryMapPrivate(const struct SharedMemory* memory) {
+	UNUSED(memory);
+	return NULL;
+}
+
+void sharedMemoryUnmapPrivate(const struct SharedMemory* memory, void* data) {
+	UNUSED(memory);
+	UNUSED(data);
+}
+
+bool sharedMemoryCreateNamed(struct SharedMemory* memory, const char* name, size_t size) {
+	UNUSED(memory);
+	UNUSED(name);
+	UNUSED(size);
+	return false;
+}
+
+void sharedMemoryRemoveNamed(const char* name) {
+	UNUSED(name);
+}
@@ -19,6 +19,8 @@ struct VFileSce {
 	struct VFile d;
 
 	SceUID fd;
+	uint8_t* mapping;
+	size_t mappingSize;
 };
 
 struct VDirEntrySce {
@@ -74,6 +76,8 @@ struct VFile* VFileOpenSce(const char* path, int flags, SceMode mode) {
 		free(vfsce);
 		return 0;
 	}
+	vfsce->mapping = NULL;
+	vfsce->mappingSize = 0;
 
 	vfsce->d.close = _vfsceClose;
 	vfsce->d.seek = _vfsceSeek;
@@ -122,6 +126,8 @@ static void* _vfsceMap(struct VFile* vf, size_t size, int flags) {
 		sceIoLseek(vfsce->fd, 0, SEEK_SET);
 		sceIoRead(vfsce->fd, buffer, size);
 		sceIoLseek(vfsce->fd, cur, SEEK_SET);
+		vfsce->mapping = buffer;
+		vfsce->mappingSize = size;
 	}
 	return buffer;
 }
@@ -133,6 +139,10 @@ static void _vfsceUnmap(struct VFile* vf, void* memory, size_t size) {
 	sceIoWrite(vfsce->fd, memory, size);
 	sceIoLseek(vfsce->fd, cur, SEEK_SET);
 	sceIoSyncByFd(vfsce->fd, 0);
+	if (memory == vfsce->mapping) {
+		vfsce->mapping = NULL;
+		vfsce->mappingSize = 0;
+	}
 	mappedMemoryFree(memory, size);
 }
 
@@ -153,8 +163,12 @@ ssize_t _vfsceSize(struct VFile* vf) {
 bool _vfsceSync(struct VFile* vf, void* buffer, size_t size) {
 	struct VFileSce* vfsce = (struct VFileSce*) vf;
 	if (buffer && size) {
+		SceOff offset = 0;
+		if (vfsce->mapping && (uint8_t*) buffer >= vfsce->mapping && (uint8_t*) buffer < vfsce->mapping + vfsce->mappingSize) {
+			offset = (uint8_t*) buffer - vfsce->mapping;
+		}
 		SceOff cur = sceIoLseek(vfsce->fd, 0, SEEK_CUR);
-		sceIoLseek(vfsce->fd, 0, SEEK_SET);
+		sceIoLseek(vfsce->fd, offset, SEEK_SET);
 		int res = sceIoWrite(vfsce->fd, buffer, size);
 		sceIoLseek(vfsce->fd, cur, SEEK_SET);
 		return res == size;
@@ -36,6 +36,7 @@ void free(void*);
 
 #include <mgba/flags.h>
 
+#include <mgba/core/batch.h>
 #include <mgba/core/blip_buf.h>
 #include <mgba/core/cache-set.h>
 #include <mgba/core/core.h>
@@ -21,6 +21,7 @@ ffi.set_source("mgba._pylib", """
 #define MGBA_EXPORT
 #include <mgba/flags.h>
 #define OPAQUE_THREADING
+#include <mgba/core/batch.h>
 #include <mgba/core/blip_buf.h>
 #include <mgba/core/cache-set.h>
 #include <mgba-util/common.h>
@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include "core.h"
 
+#include <mgba/core/batch.h>
 #include <mgba/core/core.h>
 
 struct mCoreCallbacks* mCorePythonCallbackCreate(void* pyobj) {
@@ -18,3 +19,14 @@ struct mCoreCallbacks* mCorePythonCallbackCreate(void* pyobj) {
 	callbacks->context = pyobj;
 	return callbacks;
 }
+
+struct mCoreBatch* mCorePythonBatchCreate(size_t workers) {
+	struct mCoreBatch* batch = malloc(sizeof(*batch));
+	mCoreBatchInit(batch, workers);
+	return batch;
+}
+
+void mCorePythonBatchDestroy(struct mCoreBatch* batch) {
+	mCoreBatchDeinit(batch);
+	free(batch);
+}
@@ -9,6 +9,10 @@
 
 struct mCoreCallbacks* mCorePythonCallbackCreate(void* pyobj);
 
+struct mCoreBatch;
+struct mCoreBatch* mCorePythonBatchCreate(size_t workers);
+void mCorePythonBatchDestroy(struct mCoreBatch*);
+
 PYEXPORT void _mCorePythonCallbacksVideoFrameStarted(void* user);
 PYEXPORT void _mCorePythonCallbacksVideoFrameEnded(void* user);
 PYEXPORT void _mCorePythonCallbacksCoreCrashed(void* user);
@@ -339,6 +339,28 @@ class Core(object):
         self._core.getGameCode(self._core, code)
         return ffi.string(code, 12).decode("ascii")
 
+    @property
+    def memory_block_names(self):
+        blocks = ffi.new("const struct mCoreMemoryBlock**")
+        count = self._core.listMemoryBlocks(self._core, blocks)
+        return [ffi.string(blocks[0][i].internalName).decode("ascii") for i in range(count)]
+
+    @needs_reset
+    def memory_block(self, name):
+        # Returns a writable buffer over the block itself, so NumPy and friends can use it without copying
+        blocks = ffi.new("const struct mCoreMemoryBlock**")
+        count = self._core.listMemoryBlocks(self._core, blocks)
+        for i in range(count):
+            block = blocks[0][i]
+            if ffi.string(block.internalName).decode("ascii") != name:
+                continue
+            size = ffi.new("size_t*")
+            data = self._core.getMemoryBlock(self._core, block.id, size)
+            if data == ffi.NULL:
+                return None
+            return ffi.buffer(data, size[0])
+        raise KeyError(name)
+
     def add_frame_callback(self, callback):
         self._callbacks.video_frame_ended.append(callback)
 
@@ -32,6 +32,12 @@ class Image:
         png_file.write_close()
         return success
 
+    def to_numpy(self):
+        # Shares memory with the image, so it reflects later frames rendered into it
+        import numpy
+        dtype = numpy.uint16 if ffi.sizeof("color_t") == 2 else numpy.uint32
+        return numpy.frombuffer(ffi.buffer(self.buffer), dtype=dtype).reshape(self.height, self.stride)[:, :self.width]
+
     if 'PImage' in globals():
         def to_pil(self):
             colorspace = "RGBA" if self.alpha else "RGBX"
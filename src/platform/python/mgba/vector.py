@@ -0,0 +1,81 @@
+# Copyright (c) 2013-2026 Jeffrey Pfau
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+from ._pylib import ffi, lib  # pylint: disable=no-name-in-module
+from . import core as mcore
+import numpy
+
+
+class VectorCore(object):
+    def __init__(self, cores, workers=0):
+        self.cores = list(cores)
+        if not self.cores:
+            raise ValueError("At least one core is required")
+        self.width, self.height = self.cores[0].desired_video_dimensions()
+
+        self._batch = ffi.gc(lib.mCorePythonBatchCreate(workers), lib.mCorePythonBatchDestroy)
+        pixels = self.width * self.height
+        # Every core renders straight into its own slice of one array, so all the frames can be
+        # handed out as a single NumPy array without copying
+        self._frames = ffi.new("color_t[]", pixels * len(self.cores))
+        self._keys = ffi.new("uint32_t[]", len(self.cores))
+        for i, core in enumerate(self.cores):
+            if core._protected:
+                raise RuntimeError("Core is protected")
+            if core.desired_video_dimensions() != (self.width, self.height):
+                raise ValueError("All cores must have the same video dimensions")
+            core._core.setVideoBuffer(core._core, self._frames + i * pixels, self.width)
+            if not core._was_reset:
+                core.reset()
+            lib.mCoreBatchAddCore(self._batch, core._core)
+
+        dtype = numpy.uint16 if ffi.sizeof("color_t") == 2 else numpy.uint32
+        self.frames = numpy.frombuffer(ffi.buffer(self._frames), dtype=dtype).reshape(len(self.cores), self.height, self.width)
+        self.keys = numpy.frombuffer(ffi.buffer(self._keys), dtype=numpy.uint32)
+        self._memory = {}
+
+    @classmethod
+    def load_path(cls, path, count, workers=0):
+        cores = []
+        for _ in range(count):
+            core = mcore.load_path(path)
+            if not core:
+                raise RuntimeError("Failed to load {}".format(path))
+            cores.append(core)
+        return cls(cores, workers)
+
+    def __len__(self):
+        return len(self.cores)
+
+    if ffi.sizeof("color_t") == 4:
+        @property
+        def rgb(self):
+            # color_t is stored as R, G, B, X bytes, so this is a view rather than a conversion
+            return self.frames.view(numpy.uint8).reshape(len(self.cores), self.height, self.width, 4)[..., :3]
+
+    def step(self, keys=None, frames=1):
+        if keys is not None:
+            self.keys[:] = keys
+        lib.mCoreBatchSetKeys(self._batch, self._keys)
+        lib.mCoreBatchRunFrames(self._batch, frames)
+        return self.frames
+
+    def reset(self):
+        for core in self.cores:
+            core.reset()
+
+    def memory(self, name):
+        # Blocks live as long as their cores, so the views only need to be made once
+        if name not in self._memory:
+            self._memory[name] = [numpy.frombuffer(core.memory_block(name), dtype=numpy.uint8) for core in self.cores]
+        return self._memory[name]
+
+    def gather(self, name, offset, dtype=numpy.uint8, count=1):
+        dtype = numpy.dtype(dtype)
+        out = numpy.empty((len(self.cores), count), dtype=dtype)
+        end = offset + dtype.itemsize * count
+        for i, block in enumerate(self.memory(name)):
+            out[i] = block[offset:end].view(dtype)
+        return out
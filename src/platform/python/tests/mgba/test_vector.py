@@ -0,0 +1,48 @@
+import pytest
+import os
+
+numpy = pytest.importorskip("numpy")
+
+import mgba.core
+import mgba.vector
+
+ROM = os.path.join(os.path.dirname(__file__), "..", "..", "..", "..", "..", "cinema", "gba", "irq", "keyirq", "test.gba")
+
+
+@pytest.fixture
+def rom():
+    if not os.path.exists(ROM):
+        pytest.skip("Test ROM not found")
+    return ROM
+
+
+def test_vector_shapes(rom):
+    vector = mgba.vector.VectorCore.load_path(rom, 3)
+    assert len(vector) == 3
+    assert vector.frames.shape == (3, 160, 240)
+    assert vector.keys.shape == (3,)
+    frames = vector.step(frames=2)
+    assert frames is vector.frames
+
+
+def test_vector_matches_single(rom):
+    vector = mgba.vector.VectorCore.load_path(rom, 2, workers=1)
+    single = mgba.core.load_path(rom)
+    single.reset()
+    for _ in range(4):
+        vector.step(frames=2)
+        single.run_frame()
+        single.run_frame()
+    expected = numpy.frombuffer(single.memory_block("wram"), dtype=numpy.uint8)
+    for block in vector.memory("wram"):
+        assert numpy.array_equal(block, expected)
+    assert numpy.array_equal(vector.frames[0], vector.frames[1])
+
+
+def test_vector_gather(rom):
+    vector = mgba.vector.VectorCore.load_path(rom, 2)
+    vector.step()
+    vector.memory("wram")[1][0:4] = [1, 2, 3, 4]
+    values = vector.gather("wram", 0, numpy.uint32)
+    assert values.shape == (2, 1)
+    assert values[1, 0] == 0x04030201
@@ -9,6 +9,7 @@
 #include "GBAApp.h"
 
 #include <QHBoxLayout>
+#include <QMutexLocker>
 
 #include <mgba/core/interface.h>
 #ifdef M_CORE_GBA
@@ -47,6 +48,7 @@ int AssetTile::customLocation(const QString&) {
 
 void AssetTile::setController(std::shared_ptr<CoreController> controller) {
 	m_cacheSet = controller->graphicCaches();
+	m_cacheLock = controller->graphicCachesLock();
 	switch (controller->platform()) {
 #ifdef M_CORE_GBA
 	case mPLATFORM_GBA:
@@ -100,6 +102,7 @@ void AssetTile::selectIndex(int index) {
 	if (m_addressWidth == 4 && index >= m_boundary / 2) {
 		dispIndex -= m_boundary / 2;
 	}
+	QMutexLocker locker(m_cacheLock);
 	data = mTileCacheGetTile(tileCache, index, paletteId);
 	m_ui.tileId->setText(QString::number(dispIndex));
 	m_ui.paletteId->setText(QString::number(paletteId));
@@ -132,6 +135,7 @@ void AssetTile::setFlip(bool h, bool v) {
 void AssetTile::selectColor(int index) {
 	const color_t* data;
 	mTileCache* tileCache = m_tileCaches[m_index >= m_boundary];
+	QMutexLocker locker(m_cacheLock);
 	data = mTileCacheGetTile(tileCache, m_index >= m_boundary ? m_index - m_boundary : m_index, m_paletteId);
 	color_t color = data[index];
 	m_ui.color->setColor(0, color);
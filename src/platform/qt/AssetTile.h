@@ -7,6 +7,8 @@
 
 #include "ui_AssetTile.h"
 
+#include <QMutex>
+
 #include <memory>
 
 #include <mgba/core/cache-set.h>
@@ -38,6 +40,7 @@ private:
 	Ui::AssetTile m_ui;
 
 	mCacheSet* m_cacheSet;
+	QMutex* m_cacheLock = nullptr;
 	mTileCache* m_tileCaches[2];
 	int m_paletteId = 0;
 	int m_index = 0;
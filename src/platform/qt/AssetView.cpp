@@ -6,7 +6,10 @@
 #include "AssetView.h"
 
 #include "CoreController.h"
+#include "GBAApp.h"
 
+#include <QMutexLocker>
+#include <QPointer>
 #include <QTimer>
 
 #ifdef M_CORE_GBA
@@ -21,6 +24,9 @@
 
 using namespace QGBA;
 
+static const int ASSET_DEBUG_DATA = CoreController::DEBUG_DATA_IO | CoreController::DEBUG_DATA_PALETTE |
+                                    CoreController::DEBUG_DATA_OAM | CoreController::DEBUG_DATA_VRAM;
+
 AssetView::AssetView(std::shared_ptr<CoreController> controller, QWidget* parent)
 	: QWidget(parent)
 	, m_cacheSet(controller->graphicCaches())
@@ -30,16 +36,27 @@ AssetView::AssetView(std::shared_ptr<CoreController> controller, QWidget* parent
 	m_updateTimer.setInterval(1);
 	connect(&m_updateTimer, &QTimer::timeout, this, static_cast<void(AssetView::*)()>(&AssetView::updateTiles));
 
-	connect(controller.get(), &CoreController::frameAvailable, &m_updateTimer,
+	// Tiles, maps and objects depend on registers as well as on video memory
+	controller->watchDebugData(ASSET_DEBUG_DATA);
+	connect(controller.get(), &CoreController::debugDataChanged, &m_updateTimer,
 	        static_cast<void(QTimer::*)()>(&QTimer::start));
 	connect(controller.get(), &CoreController::stopping, &m_updateTimer, &QTimer::stop);
 }
 
+AssetView::~AssetView() {
+	m_controller->unwatchDebugData(ASSET_DEBUG_DATA);
+}
+
 void AssetView::updateTiles() {
 	updateTiles(false);
 }
 
 void AssetView::updateTiles(bool force) {
+	if (m_jobRunning && !m_synchronous) {
+		m_updateQueued = true;
+		m_queuedForce = m_queuedForce || force;
+		return;
+	}
 	switch (m_controller->platform()) {
 #ifdef M_CORE_GBA
 	case mPLATFORM_GBA:
@@ -56,6 +73,54 @@ void AssetView::updateTiles(bool force) {
 	}
 }
 
+void AssetView::submitCacheJob(std::function<void ()> job, std::function<void ()> apply) {
+	QMutex* lock = m_controller->graphicCachesLock();
+	if (m_synchronous) {
+		{
+			QMutexLocker locker(lock);
+			job();
+		}
+		apply();
+		return;
+	}
+
+	m_jobRunning = true;
+	unsigned generation = m_jobGeneration;
+	QPointer<AssetView> view(this);
+	// The callback holds onto the controller rather than the job so that it's let go of on the GUI
+	// thread, and only after the job is done with the caches
+	std::shared_ptr<CoreController> controller = m_controller;
+	GBAApp::app()->submitWorkerJob([lock, job]() {
+		QMutexLocker locker(lock);
+		job();
+	}, [controller, view, generation, apply]() {
+		if (view) {
+			view->finishCacheJob(generation, apply);
+		}
+	});
+}
+
+void AssetView::finishCacheJob(unsigned generation, const std::function<void ()>& apply) {
+	m_jobRunning = false;
+	// A flush since this job started has already drawn everything it would have
+	if (generation == m_jobGeneration) {
+		apply();
+	}
+	if (m_updateQueued) {
+		bool force = m_queuedForce;
+		m_updateQueued = false;
+		m_queuedForce = false;
+		updateTiles(force);
+	}
+}
+
+void AssetView::flushTiles() {
+	++m_jobGeneration;
+	m_synchronous = true;
+	updateTiles(true);
+	m_synchronous = false;
+}
+
 void AssetView::resizeEvent(QResizeEvent*) {
 	updateTiles(true);
 }
@@ -112,7 +177,11 @@ void AssetView::compositeTile(const void* tBuffer, void* buffer, size_t stride,
 }
 
 QImage AssetView::compositeMap(int map, QVector<mMapCacheEntry>* mapStatus) {
-	mMapCache* mapCache = mMapCacheSetGetPointer(&m_cacheSet->maps, map);
+	return compositeMap(m_cacheSet, map, mapStatus);
+}
+
+QImage AssetView::compositeMap(mCacheSet* cacheSet, int map, QVector<mMapCacheEntry>* mapStatus) {
+	mMapCache* mapCache = mMapCacheSetGetPointer(&cacheSet->maps, map);
 	int tilesW = 1 << mMapCacheSystemInfoGetTilesWide(mapCache->sysConfig);
 	int tilesH = 1 << mMapCacheSystemInfoGetTilesHigh(mapCache->sysConfig);
 	if (mapStatus->size() != tilesW * tilesH) {
@@ -11,6 +11,7 @@
 
 #include <mgba/core/cache-set.h>
 
+#include <functional>
 #include <memory>
 
 struct mMapCacheEntry;
@@ -24,6 +25,7 @@ Q_OBJECT
 
 public:
 	AssetView(std::shared_ptr<CoreController> controller, QWidget* parent = nullptr);
+	~AssetView();
 
 protected slots:
 	void updateTiles();
@@ -54,6 +56,7 @@ protected:
 	};
 
 	static void compositeTile(const void* tile, void* image, size_t stride, size_t x, size_t y, int depth = 8);
+	static QImage compositeMap(mCacheSet*, int map, QVector<mMapCacheEntry>*);
 	QImage compositeMap(int map, QVector<mMapCacheEntry>*);
 	QImage compositeObj(const ObjInfo&);
 
@@ -66,6 +69,13 @@ protected:
 	virtual void updateTilesGB(bool force) = 0;
 #endif
 
+	// Runs job on a worker thread with the cache lock held, then apply back on this thread. One
+	// job runs per view at a time, and updates asked for meanwhile are folded into one more run
+	// afterwards. Jobs must not touch the view, which may be closed before they finish.
+	void submitCacheJob(std::function<void ()> job, std::function<void ()> apply);
+	// Brings the view up to date before returning, e.g. before exporting it
+	void flushTiles();
+
 	void resizeEvent(QResizeEvent*) override;
 	void showEvent(QShowEvent*) override;
 
@@ -77,7 +87,14 @@ private:
 	bool lookupObjGB(int id, struct ObjInfo*);
 #endif
 
+	void finishCacheJob(unsigned generation, const std::function<void ()>& apply);
+
 	QTimer m_updateTimer;
+	bool m_synchronous = false;
+	bool m_jobRunning = false;
+	bool m_updateQueued = false;
+	bool m_queuedForce = false;
+	unsigned m_jobGeneration = 0;
 };
 
 }
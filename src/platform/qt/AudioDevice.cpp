@@ -28,13 +28,16 @@ void AudioDevice::setFormat(const QAudioFormat& format) {
 	}
 	double fauxClock = GBAAudioCalculateRatio(1, m_context->impl->sync.fpsTarget, 1);
 	mCoreSyncLockAudio(&m_context->impl->sync);
-	blip_set_rates(m_context->core->getAudioChannel(m_context->core, 0),
-		           m_context->core->frequency(m_context->core), format.sampleRate() * fauxClock);
-	blip_set_rates(m_context->core->getAudioChannel(m_context->core, 1),
-		           m_context->core->frequency(m_context->core), format.sampleRate() * fauxClock);
+	m_rate = format.sampleRate() * fauxClock;
+	setRate(m_rate);
 	mCoreSyncUnlockAudio(&m_context->impl->sync);
 }
 
+void AudioDevice::setRate(double rate) {
+	blip_set_rates(m_context->core->getAudioChannel(m_context->core, 0), m_context->core->frequency(m_context->core), rate);
+	blip_set_rates(m_context->core->getAudioChannel(m_context->core, 1), m_context->core->frequency(m_context->core), rate);
+}
+
 void AudioDevice::setInput(mCoreThread* input) {
 	m_context = input;
 }
@@ -47,6 +50,11 @@ qint64 AudioDevice::readData(char* data, qint64 maxSize) {
 
 	maxSize /= sizeof(mStereoSample);
 	mCoreSyncLockAudio(&m_context->impl->sync);
+	if (m_context->impl->sync.audioRateControl && m_rate) {
+		setRate(mCoreSyncAdjustAudioRate(&m_context->impl->sync, m_rate,
+		        blip_samples_avail(m_context->core->getAudioChannel(m_context->core, 0)),
+		        m_context->core->getAudioBufferSize(m_context->core)));
+	}
 	int available = std::min<qint64>({
 		blip_samples_avail(m_context->core->getAudioChannel(m_context->core, 0)),
 		maxSize,
@@ -26,7 +26,10 @@ protected:
 	virtual qint64 writeData(const char* data, qint64 maxSize) override;
 
 private:
+	void setRate(double rate);
+
 	mCoreThread* m_context;
+	double m_rate = 0;
 };
 
 }
@@ -33,6 +33,9 @@
 #include <mgba-util/vfs.h>
 
 #define AUTOSAVE_GRANULARITY 600
+// Log messages are delivered at most this often, and only this many at a time
+#define LOG_FLUSH_INTERVAL 50
+#define LOG_FLUSH_MAX 500
 
 using namespace QGBA;
 
@@ -43,8 +46,36 @@ CoreController::CoreController(mCore* core, QObject* parent)
 {
 	m_threadContext.core = core;
 	m_threadContext.userData = this;
+	m_stateWriter = mStateWriterCreate();
 	updateROMInfo();
 
+	// Regions are added in the order of the DebugData bits
+	mDirtyTrackerInit(&m_debugData);
+	switch (core->platform(core)) {
+#ifdef M_CORE_GBA
+	case mPLATFORM_GBA: {
+		GBA* gba = static_cast<GBA*>(core->board);
+		mDirtyTrackerAddRegion(&m_debugData, gba->memory.io, sizeof(gba->memory.io));
+		mDirtyTrackerAddRegion(&m_debugData, gba->video.palette, sizeof(gba->video.palette));
+		mDirtyTrackerAddRegion(&m_debugData, gba->video.oam.raw, sizeof(gba->video.oam.raw));
+		mDirtyTrackerAddRegion(&m_debugData, gba->video.vram, GBA_SIZE_VRAM);
+		break;
+	}
+#endif
+#ifdef M_CORE_GB
+	case mPLATFORM_GB: {
+		GB* gb = static_cast<GB*>(core->board);
+		mDirtyTrackerAddRegion(&m_debugData, gb->memory.io, sizeof(gb->memory.io));
+		mDirtyTrackerAddRegion(&m_debugData, gb->video.palette, sizeof(gb->video.palette));
+		mDirtyTrackerAddRegion(&m_debugData, gb->video.oam.raw, sizeof(gb->video.oam.raw));
+		mDirtyTrackerAddRegion(&m_debugData, gb->video.vram, GB_SIZE_VRAM);
+		break;
+	}
+#endif
+	default:
+		break;
+	}
+
 #ifdef M_CORE_GBA
 	GBASIODolphinCreate(&m_dolphin);
 #endif
@@ -203,12 +234,18 @@ CoreController::CoreController(mCore* core, QObject* parent)
 			QMetaObject::invokeMethod(controller, "statusPosted", Q_ARG(const QString&, message));
 		}
 		message = QString::vasprintf(format, args);
-		QMetaObject::invokeMethod(controller, "logPosted", Q_ARG(int, level), Q_ARG(int, category), Q_ARG(const QString&, message));
+		controller->queueLog(level, category, message);
 		if (level == mLOG_FATAL) {
 			QMetaObject::invokeMethod(controller, "crashed", Q_ARG(const QString&, message));
 		}
 	};
 	m_threadContext.logger.logger = &m_logger;
+
+	m_logTimer.setSingleShot(true);
+	m_logTimer.setInterval(LOG_FLUSH_INTERVAL);
+	connect(&m_logTimer, &QTimer::timeout, this, &CoreController::flushLogs);
+
+	mFrameServerInit(&m_frameServer);
 }
 
 CoreController::~CoreController() {
@@ -217,6 +254,12 @@ CoreController::~CoreController() {
 	disconnect();
 
 	mCoreThreadJoin(&m_threadContext);
+	mStateWriterDestroy(m_stateWriter);
+
+	if (mFrameServerIsOpen(&m_frameServer)) {
+		m_threadContext.core->setAVStream(m_threadContext.core, nullptr);
+		mFrameServerClose(&m_frameServer);
+	}
 
 #ifdef USE_DEBUGGERS
 	mDebuggerDeinit(&m_debugger);
@@ -226,6 +269,11 @@ CoreController::~CoreController() {
 		mCacheSetDeinit(m_cacheSet.get());
 		m_cacheSet.reset();
 	}
+	mDirtyTrackerDeinit(&m_debugData);
+
+	if (TripleBufferCapacity(&m_completeBuffers)) {
+		TripleBufferDeinit(&m_completeBuffers);
+	}
 
 	mCoreConfigDeinit(&m_threadContext.core->config);
 	m_threadContext.core->deinit(m_threadContext.core);
@@ -240,8 +288,8 @@ const color_t* CoreController::drawContext() {
 	if (m_hwaccel) {
 		return nullptr;
 	}
-	QMutexLocker locker(&m_bufferMutex);
-	return reinterpret_cast<const color_t*>(m_completeBuffer.constData());
+	TripleBufferAcquire(&m_completeBuffers);
+	return static_cast<const color_t*>(TripleBufferFront(&m_completeBuffers));
 }
 
 QImage CoreController::getPixels() {
@@ -250,7 +298,8 @@ QImage CoreController::getPixels() {
 	size_t stride = size.width() * BYTES_PER_PIXEL;
 
 	if (!m_hwaccel) {
-		buffer = m_completeBuffer;
+		// Don't acquire a newer frame here, as a display may still be drawing the current one
+		buffer = QByteArray::fromRawData(static_cast<const char*>(TripleBufferFront(&m_completeBuffers)), stride * size.height());
 	} else {
 		Interrupter interrupter(this);
 		const void* pixels;
@@ -296,6 +345,7 @@ void CoreController::loadConfig(ConfigController* config) {
 	m_fastForwardHeldRatio = config->getOption("fastForwardHeldRatio", m_fastForwardRatio).toFloat();
 	m_videoSync = config->getOption("videoSync", m_videoSync).toInt();
 	m_audioSync = config->getOption("audioSync", m_audioSync).toInt();
+	m_framePacing = config->getOption("framePacing", m_framePacing).toInt();
 	m_fpsTarget = config->getOption("fpsTarget").toFloat();
 	m_autosave = config->getOption("autosave", false).toInt();
 	m_autoload = config->getOption("autoload", true).toInt();
@@ -459,17 +509,63 @@ void CoreController::setLogger(LogController* logger) {
 	connect(this, &CoreController::logPosted, m_log, &LogController::postLog);
 }
 
+void CoreController::queueLog(int level, int category, const QString& message) {
+	QMutexLocker locker(&m_logLock);
+	if (m_pendingLogs.size() >= LOG_FLUSH_MAX && !(level & (mLOG_FATAL | mLOG_ERROR))) {
+		++m_suppressedLogs;
+		return;
+	}
+	m_pendingLogs.append({level, category, message});
+	if (m_pendingLogs.size() == 1) {
+		QMetaObject::invokeMethod(&m_logTimer, "start", Qt::QueuedConnection);
+	}
+}
+
+void CoreController::flushLogs() {
+	QList<PendingLog> logs;
+	int suppressed;
+	{
+		QMutexLocker locker(&m_logLock);
+		logs.swap(m_pendingLogs);
+		suppressed = m_suppressedLogs;
+		m_suppressedLogs = 0;
+	}
+	for (const PendingLog& log : logs) {
+		emit logPosted(log.level, log.category, log.message);
+	}
+	if (suppressed) {
+		emit logPosted(mLOG_WARN, _mLOG_CAT_QT, tr("%n message(s) suppressed", nullptr, suppressed));
+	}
+}
+
 void CoreController::start() {
 	QSize size(screenDimensions());
 	m_activeBuffer.resize(size.width() * size.height() * sizeof(color_t));
 	m_activeBuffer.fill(0xFF);
-	m_completeBuffer = m_activeBuffer;
+	if (TripleBufferCapacity(&m_completeBuffers)) {
+		TripleBufferDeinit(&m_completeBuffers);
+	}
+	TripleBufferInit(&m_completeBuffers, m_activeBuffer.size());
+	memcpy(TripleBufferBack(&m_completeBuffers), m_activeBuffer.constData(), m_activeBuffer.size());
+	TripleBufferPublish(&m_completeBuffers);
 
 	m_threadContext.core->setVideoBuffer(m_threadContext.core, reinterpret_cast<color_t*>(m_activeBuffer.data()), size.width());
 
 	if (!m_patched) {
 		mCoreAutoloadPatch(m_threadContext.core);
 	}
+
+	const char* frameServerName = mCoreConfigGetValue(&m_threadContext.core->config, "frameServer");
+	if (frameServerName && !mFrameServerIsOpen(&m_frameServer)) {
+		unsigned width, height;
+		m_threadContext.core->baseVideoSize(m_threadContext.core, &width, &height);
+		if (mFrameServerOpen(&m_frameServer, frameServerName, width, height)) {
+			m_threadContext.core->setAVStream(m_threadContext.core, &m_frameServer.d);
+		} else {
+			LOG(QT, ERROR) << tr("Failed to open frame server %1").arg(QString::fromUtf8(frameServerName));
+		}
+	}
+
 	if (!mCoreThreadStart(&m_threadContext)) {
 		emit failed();
 		emit stopping();
@@ -520,9 +616,11 @@ void CoreController::setSync(bool sync) {
 	if (sync) {
 		m_threadContext.impl->sync.audioWait = m_audioSync;
 		m_threadContext.impl->sync.videoFrameWait = m_videoSync;
+		m_threadContext.impl->sync.framePacing = m_framePacing;
 	} else {
 		m_threadContext.impl->sync.audioWait = false;
 		m_threadContext.impl->sync.videoFrameWait = false;
+		m_threadContext.impl->sync.framePacing = false;
 	}
 }
 
@@ -556,11 +654,8 @@ void CoreController::rewind(int states) {
 	if (!states) {
 		states = INT_MAX;
 	}
-	for (int i = 0; i < states; ++i) {
-		if (!mCoreRewindRestore(&m_threadContext.impl->rewind, m_threadContext.core)) {
-			break;
-		}
-	}
+	mCoreRewindRestoreMany(&m_threadContext.impl->rewind, m_threadContext.core, states);
+	publishDebugData();
 	interrupter.resume();
 	emit frameAvailable();
 	emit rewound();
@@ -644,11 +739,13 @@ void CoreController::loadState(int slot) {
 	mCoreThreadClearCrashed(&m_threadContext);
 	mCoreThreadRunFunction(&m_threadContext, [](mCoreThread* context) {
 		CoreController* controller = static_cast<CoreController*>(context->userData);
+		mStateWriterWait(controller->m_stateWriter);
 		if (!controller->m_backupLoadState.isOpen()) {
 			controller->m_backupLoadState = VFileDevice::openMemory();
 		}
 		mCoreSaveStateNamed(context->core, controller->m_backupLoadState, controller->m_saveStateFlags);
 		if (mCoreLoadState(context->core, controller->m_stateSlot, controller->m_loadStateFlags)) {
+			controller->publishDebugData();
 			emit controller->frameAvailable();
 			emit controller->stateLoaded();
 		}
@@ -664,6 +761,7 @@ void CoreController::loadState(const QString& path, int flags) {
 	mCoreThreadClearCrashed(&m_threadContext);
 	mCoreThreadRunFunction(&m_threadContext, [](mCoreThread* context) {
 		CoreController* controller = static_cast<CoreController*>(context->userData);
+		mStateWriterWait(controller->m_stateWriter);
 		VFile* vf = VFileDevice::open(controller->m_statePath, O_RDONLY);
 		if (!vf) {
 			return;
@@ -673,6 +771,7 @@ void CoreController::loadState(const QString& path, int flags) {
 		}
 		mCoreSaveStateNamed(context->core, controller->m_backupLoadState, controller->m_saveStateFlags);
 		if (mCoreLoadStateNamed(context->core, vf, controller->m_loadStateFlags)) {
+			controller->publishDebugData();
 			emit controller->frameAvailable();
 			emit controller->stateLoaded();
 		}
@@ -702,6 +801,7 @@ void CoreController::loadState(QIODevice* iodev, int flags) {
 		}
 		mCoreSaveStateNamed(context->core, controller->m_backupLoadState, controller->m_saveStateFlags);
 		if (mCoreLoadStateNamed(context->core, vf, controller->m_loadStateFlags)) {
+			controller->publishDebugData();
 			emit controller->frameAvailable();
 			emit controller->stateLoaded();
 		}
@@ -716,13 +816,23 @@ void CoreController::saveState(int slot) {
 	}
 	mCoreThreadRunFunction(&m_threadContext, [](mCoreThread* context) {
 		CoreController* controller = static_cast<CoreController*>(context->userData);
+		mStateWriterWait(controller->m_stateWriter);
 		VFile* vf = mCoreGetState(context->core, controller->m_stateSlot, false);
 		if (vf) {
 			controller->m_backupSaveState.resize(vf->size(vf));
 			vf->read(vf, controller->m_backupSaveState.data(), controller->m_backupSaveState.size());
 			vf->close(vf);
 		}
-		mCoreSaveState(context->core, controller->m_stateSlot, controller->m_saveStateFlags);
+		vf = mCoreGetState(context->core, controller->m_stateSlot, true);
+		if (!vf) {
+			return;
+		}
+		// Slot saves are quick saves, so encode them off the core thread and favor speed
+		mStateWriterSave(controller->m_stateWriter, context->core, vf, controller->m_saveStateFlags | SAVESTATE_QUICK, [](bool success, void* context) {
+			CoreController* controller = static_cast<CoreController*>(context);
+			QString message = success ? tr("State saved") : tr("Failed to save state");
+			QMetaObject::invokeMethod(controller, "statusPosted", Q_ARG(const QString&, message));
+		}, controller);
 	});
 }
 
@@ -781,6 +891,7 @@ void CoreController::loadBackupState() {
 		controller->m_backupLoadState.seek(0);
 		if (mCoreLoadStateNamed(context->core, controller->m_backupLoadState, controller->m_loadStateFlags)) {
 			mLOG(STATUS, INFO, "Undid state load");
+			controller->publishDebugData();
 			controller->frameAvailable();
 			controller->stateLoaded();
 		}
@@ -1133,14 +1244,21 @@ void CoreController::setAVStream(mAVStream* stream) {
 
 void CoreController::clearAVStream() {
 	Interrupter interrupter(this);
-	m_threadContext.core->setAVStream(m_threadContext.core, nullptr);
+	m_threadContext.core->setAVStream(m_threadContext.core, defaultAVStream());
+}
+
+mAVStream* CoreController::defaultAVStream() {
+	if (mFrameServerIsOpen(&m_frameServer)) {
+		return &m_frameServer.d;
+	}
+	return nullptr;
 }
 
 void CoreController::clearOverride() {
 	m_override.reset();
 }
 
-void CoreController::startVideoLog(const QString& path, bool compression) {
+void CoreController::startVideoLog(const QString& path, bool compression, bool audio) {
 	if (m_vl) {
 		return;
 	}
@@ -1149,10 +1267,10 @@ void CoreController::startVideoLog(const QString& path, bool compression) {
 	if (!vf) {
 		return;
 	}
-	startVideoLog(vf, compression);
+	startVideoLog(vf, compression, audio);
 }
 
-void CoreController::startVideoLog(VFile* vf, bool compression) {
+void CoreController::startVideoLog(VFile* vf, bool compression, bool audio) {
 	if (m_vl || !vf) {
 		return;
 	}
@@ -1162,7 +1280,15 @@ void CoreController::startVideoLog(VFile* vf, bool compression) {
 	m_vlVf = vf;
 	mVideoLogContextSetOutput(m_vl, m_vlVf);
 	mVideoLogContextSetCompression(m_vl, compression);
+	mAVStream* stream = nullptr;
+	if (audio) {
+		stream = mVideoLogContextRecordAudio(m_vl);
+	}
 	mVideoLogContextWriteHeader(m_vl, m_threadContext.core);
+	if (stream) {
+		m_threadContext.core->setAVStream(m_threadContext.core, stream);
+		m_vlAudio = true;
+	}
 }
 
 void CoreController::endVideoLog(bool closeVf) {
@@ -1171,6 +1297,10 @@ void CoreController::endVideoLog(bool closeVf) {
 	}
 
 	Interrupter interrupter(this);
+	if (m_vlAudio) {
+		m_threadContext.core->setAVStream(m_threadContext.core, defaultAVStream());
+		m_vlAudio = false;
+	}
 	mVideoLogContextDestroy(m_threadContext.core, m_vl, closeVf);
 	if (closeVf) {
 		m_vlVf = nullptr;
@@ -1232,8 +1362,8 @@ void CoreController::finishFrame() {
 		unsigned width, height;
 		m_threadContext.core->currentVideoSize(m_threadContext.core, &width, &height);
 
-		QMutexLocker locker(&m_bufferMutex);
-		memcpy(m_completeBuffer.data(), m_activeBuffer.constData(), width * height * BYTES_PER_PIXEL);
+		memcpy(TripleBufferBack(&m_completeBuffers), m_activeBuffer.constData(), width * height * BYTES_PER_PIXEL);
+		TripleBufferPublish(&m_completeBuffers);
 	}
 
 	{
@@ -1252,10 +1382,35 @@ void CoreController::finishFrame() {
 		++m_frameCounter;
 	}
 	updateKeys();
+	publishDebugData();
 
 	QMetaObject::invokeMethod(this, "frameAvailable");
 }
 
+void CoreController::watchDebugData(int regions) {
+	for (size_t i = 0; i < m_debugData.nRegions; ++i) {
+		if (regions & (1 << i)) {
+			mDirtyTrackerWatch(&m_debugData, i);
+		}
+	}
+}
+
+void CoreController::unwatchDebugData(int regions) {
+	for (size_t i = 0; i < m_debugData.nRegions; ++i) {
+		if (regions & (1 << i)) {
+			mDirtyTrackerUnwatch(&m_debugData, i);
+		}
+	}
+}
+
+// Must be called from the emulation thread, or while it's interrupted
+void CoreController::publishDebugData() {
+	int changed = mDirtyTrackerUpdate(&m_debugData);
+	if (changed) {
+		QMetaObject::invokeMethod(this, "debugDataChanged", Q_ARG(int, changed));
+	}
+}
+
 void CoreController::updatePlayerSave() {
 	int savePlayerId = m_multiplayer->saveId(this);
 
@@ -1287,6 +1442,8 @@ void CoreController::updateFastForward() {
 			m_threadContext.core->opts.mute = m_fastForwardMute || m_mute;
 		}
 		setSync(false);
+		// Only render as many frames as the display can show
+		mCoreThreadSetFastForward(&m_threadContext, true, m_fpsTarget);
 
 		// If we aren't holding the fast forward button
 		// then use the non "(held)" ratio
@@ -1309,6 +1466,7 @@ void CoreController::updateFastForward() {
 		}
 		mCoreConfigGetBoolValue(&m_threadContext.core->config, "mute", &m_threadContext.core->opts.mute);
 		m_threadContext.impl->sync.fpsTarget = m_fpsTarget;
+		mCoreThreadSetFastForward(&m_threadContext, false, m_fpsTarget);
 		setSync(true);
 	}
 
@@ -11,6 +11,7 @@
 #include <QMutex>
 #include <QObject>
 #include <QSize>
+#include <QTimer>
 
 #include "VFileDevice.h"
 
@@ -21,6 +22,9 @@
 #include <mgba/core/interface.h>
 #include <mgba/core/thread.h>
 #include <mgba/core/cache-set.h>
+#include <mgba/core/dirty-tracker.h>
+#include <mgba/feature/frame-server.h>
+#include <mgba-util/triple-buffer.h>
 
 #ifdef M_CORE_GB
 #include <mgba/internal/gb/sio/printer.h>
@@ -34,6 +38,7 @@
 #endif
 
 struct mCore;
+struct mStateWriter;
 
 namespace QGBA {
 
@@ -54,6 +59,14 @@ public:
 		OPENGL = mCORE_FEATURE_OPENGL,
 	};
 
+	// Regions of emulated memory that debug views can ask to be told about changes to
+	enum DebugData {
+		DEBUG_DATA_IO = 1 << 0,
+		DEBUG_DATA_PALETTE = 1 << 1,
+		DEBUG_DATA_OAM = 1 << 2,
+		DEBUG_DATA_VRAM = 1 << 3,
+	};
+
 	class Interrupter {
 	public:
 		Interrupter();
@@ -83,10 +96,13 @@ public:
 	mCoreThread* thread() { return &m_threadContext; }
 
 	void setPath(const QString& path, const QString& base = {});
+	// Marks patches as already applied, so they aren't autoloaded again on start
+	void setPatched(bool patched) { m_patched = patched; }
 	QString path() const { return m_path; }
 	QString baseDirectory() const { return m_baseDirectory; }
 	QString savePath() const { return m_savePath; }
 
+	// Returns the newest finished frame, which stays intact until the next call; GUI thread only
 	const color_t* drawContext();
 	QImage getPixels();
 
@@ -124,6 +140,8 @@ public:
 #endif
 
 	mCacheSet* graphicCaches();
+	// Asset views update the graphic caches off the GUI thread, so hold this while using them
+	QMutex* graphicCachesLock() { return &m_cacheLock; }
 	int stateSlot() const { return m_stateSlot; }
 
 	void setOverride(std::unique_ptr<Override> override);
@@ -138,6 +156,11 @@ public:
 	void addFrameAction(std::function<void ()> callback);
 	uint64_t frameCounter() const { return m_frameCounter; }
 
+	// Takes a mask of DebugData. debugDataChanged is only emitted for watched regions, at most once
+	// per frame, and not at all while they hold still.
+	void watchDebugData(int regions);
+	void unwatchDebugData(int regions);
+
 public slots:
 	void start();
 	void stop();
@@ -211,8 +234,9 @@ public slots:
 
 	void clearOverride();
 
-	void startVideoLog(const QString& path, bool compression = true);
-	void startVideoLog(VFile* vf, bool compression = true);
+	// Recording audio too makes a log that can be rendered into a video later
+	void startVideoLog(const QString& path, bool compression = true, bool audio = false);
+	void startVideoLog(VFile* vf, bool compression = true, bool audio = false);
 	void endVideoLog(bool closeVf = true);
 
 	void setFramebufferHandle(int fb);
@@ -225,6 +249,7 @@ signals:
 	void crashed(const QString& errorMessage);
 	void failed();
 	void frameAvailable();
+	void debugDataChanged(int regions);
 	void didReset();
 	void stateLoaded();
 	void rewound();
@@ -238,16 +263,22 @@ signals:
 
 	void imagePrinted(const QImage&);
 
+private slots:
+	void flushLogs();
+
 private:
 	void updateKeys();
 	int updateAutofire();
 	void finishFrame();
+	void publishDebugData();
 
 	void updatePlayerSave();
 
 	void updateFastForward();
+	mAVStream* defaultAVStream();
 
 	void updateROMInfo();
+	void queueLog(int level, int category, const QString& message);
 
 	mCoreThread m_threadContext{};
 	struct CoreLogger : public mLogger {
@@ -267,10 +298,13 @@ private:
 	bool m_showResetInfo = false;
 
 	QByteArray m_activeBuffer;
-	QByteArray m_completeBuffer;
+	// Finished frames go from the emulation thread to the GUI thread through here
+	TripleBuffer m_completeBuffers{};
 	bool m_hwaccel = false;
 
 	std::unique_ptr<mCacheSet> m_cacheSet;
+	QMutex m_cacheLock;
+	mDirtyTracker m_debugData;
 	std::unique_ptr<Override> m_override;
 
 	uint64_t m_frameCounter;
@@ -282,7 +316,6 @@ private:
 	QMutex m_actionMutex{QMutex::Recursive};
 #endif
 	int m_moreFrames = -1;
-	QMutex m_bufferMutex;
 
 	int m_activeKeys = 0;
 	int m_removedKeys = 0;
@@ -293,6 +326,7 @@ private:
 	VFileDevice m_backupLoadState;
 	QByteArray m_backupSaveState{nullptr};
 	int m_stateSlot = 1;
+	mStateWriter* m_stateWriter;
 	QString m_statePath;
 	VFile* m_stateVf;
 	int m_loadStateFlags;
@@ -300,6 +334,7 @@ private:
 
 	bool m_audioSync = AUDIO_SYNC;
 	bool m_videoSync = VIDEO_SYNC;
+	bool m_framePacing = false;
 
 	bool m_autosave;
 	bool m_autoload;
@@ -321,6 +356,17 @@ private:
 
 	InputController* m_inputController = nullptr;
 	LogController* m_log = nullptr;
+
+	struct PendingLog {
+		int level;
+		int category;
+		QString message;
+	};
+	// Messages from the emulation thread are handed to the GUI thread in batches
+	QMutex m_logLock;
+	QList<PendingLog> m_pendingLogs;
+	int m_suppressedLogs = 0;
+	QTimer m_logTimer;
 	MultiplayerController* m_multiplayer = nullptr;
 #ifdef M_CORE_GBA
 	GBASIODolphin m_dolphin;
@@ -328,6 +374,10 @@ private:
 
 	mVideoLogContext* m_vl = nullptr;
 	VFile* m_vlVf = nullptr;
+	bool m_vlAudio = false;
+
+	// Stays attached whenever nothing else is recording
+	mFrameServer m_frameServer;
 
 #ifdef M_CORE_GB
 	struct QGBPrinter : public GBPrinter {
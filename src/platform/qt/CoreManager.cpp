@@ -6,6 +6,7 @@
 #include "CoreManager.h"
 
 #include "CoreController.h"
+#include "GBAApp.h"
 #include "LogController.h"
 #include "VFileDevice.h"
 
@@ -29,29 +30,101 @@ void CoreManager::setMultiplayerController(MultiplayerController* multiplayer) {
 	m_multiplayer = multiplayer;
 }
 
+struct CoreManager::PendingLoad {
+	~PendingLoad();
+
+	VFile* vf = nullptr;
+	mCore* core = nullptr;
+	QString path;
+	QString base;
+	QString dir;
+	QString error;
+	bool saveFailed = false;
+	bool patched = false;
+};
+
+CoreManager::PendingLoad::~PendingLoad() {
+	// Only set if the load was abandoned partway through
+	if (vf) {
+		vf->close(vf);
+	}
+	if (core) {
+		core->deinit(core);
+	}
+}
+
 CoreController* CoreManager::loadGame(const QString& path) {
+	QString fname;
+	QString base;
+	QString error;
+	VFile* vf = openGame(path, &fname, &base, &error);
+	if (!error.isEmpty()) {
+		LOG(QT, ERROR) << error;
+	}
+	return loadGame(vf, fname, base);
+}
+
+CoreController* CoreManager::loadGame(VFile* vf, const QString& path, const QString& base) {
+	PendingLoad load;
+	load.vf = vf;
+	load.path = path;
+	load.base = base;
+	identifyGame(&load);
+	if (load.core) {
+		configureCore(load.core);
+		readGame(&load, m_preload, nullptr);
+	}
+	return finishLoad(&load);
+}
+
+std::shared_ptr<CoreManager::LoadProgress> CoreManager::loadGameAsync(const QString& path, QObject* context, LoadCallback callback) {
+	auto progress = std::make_shared<LoadProgress>();
+	auto load = std::make_shared<PendingLoad>();
+	GBAApp::app()->submitWorkerJob([load, path]() {
+		load->vf = openGame(path, &load->path, &load->base, &load->error);
+		identifyGame(load.get());
+	}, context, [this, load, progress, context, callback]() {
+		continueLoad(load, progress, context, callback);
+	});
+	return progress;
+}
+
+std::shared_ptr<CoreManager::LoadProgress> CoreManager::loadGameAsync(VFile* vf, const QString& path, const QString& base, QObject* context, LoadCallback callback) {
+	auto progress = std::make_shared<LoadProgress>();
+	auto load = std::make_shared<PendingLoad>();
+	load->vf = vf;
+	load->path = path;
+	load->base = base;
+	GBAApp::app()->submitWorkerJob([load]() {
+		identifyGame(load.get());
+	}, context, [this, load, progress, context, callback]() {
+		continueLoad(load, progress, context, callback);
+	});
+	return progress;
+}
+
+VFile* CoreManager::openGame(const QString& path, QString* fname, QString* base, QString* error) {
 	QFileInfo info(path);
 	if (!info.isReadable()) {
 		// Open specific file in archive
-		QString fname = info.fileName();
-		QString base = info.path();
-		if (base.endsWith("/") || base.endsWith(QDir::separator())) {
-			base.chop(1);
+		*fname = info.fileName();
+		*base = info.path();
+		if (base->endsWith("/") || base->endsWith(QDir::separator())) {
+			base->chop(1);
 		}
-		VDir* dir = VDirOpenArchive(base.toUtf8().constData());
-		if (dir) {
-			VFile* vf = dir->openFile(dir, fname.toUtf8().constData(), O_RDONLY);
-			if (vf) {
-				struct VFile* vfclone = VFileDevice::openMemory(vf->size(vf));
-				VFileDevice::copyFile(vf, vfclone);
-				vf = vfclone;
-			}
-			dir->close(dir);
-			return loadGame(vf, fname, base);
-		} else {
-			LOG(QT, ERROR) << tr("Failed to open game file: %1").arg(path);
+		VDir* dir = VDirOpenArchive(base->toUtf8().constData());
+		if (!dir) {
+			*error = tr("Failed to open game file: %1").arg(path);
+			return nullptr;
 		}
-		return nullptr;
+		VFile* vf = dir->openFile(dir, fname->toUtf8().constData(), O_RDONLY);
+		if (vf) {
+			struct VFile* vfclone = VFileDevice::openMemory(vf->size(vf));
+			VFileDevice::copyFile(vf, vfclone);
+			vf = vfclone;
+		}
+		dir->close(dir);
+		return vf;
 	}
 	VFile* vf = nullptr;
 	VDir* archive = VDirOpenArchive(path.toUtf8().constData());
@@ -76,53 +149,107 @@ CoreController* CoreManager::loadGame(const QString& path) {
 		// Open bare file
 		vf = VFileOpen(info.canonicalFilePath().toUtf8().constData(), O_RDONLY);
 	}
-	return loadGame(vf, info.fileName(), dir.canonicalPath());
+	*fname = info.fileName();
+	*base = dir.canonicalPath();
+	return vf;
 }
 
-CoreController* CoreManager::loadGame(VFile* vf, const QString& path, const QString& base) {
-	if (!vf) {
-		return nullptr;
+void CoreManager::identifyGame(PendingLoad* load) {
+	if (!load->vf) {
+		return;
 	}
-
-	mCore* core = mCoreFindVF(vf);
-	if (!core) {
-		vf->close(vf);
-		LOG(QT, ERROR) << tr("Could not load game. Are you sure it's in the correct format?");
-		return nullptr;
+	load->core = mCoreFindVF(load->vf);
+	if (!load->core) {
+		load->error = tr("Could not load game. Are you sure it's in the correct format?");
+		return;
 	}
+	load->core->init(load->core);
+	mCoreInitConfig(load->core, nullptr);
+}
 
-	core->init(core);
-	mCoreInitConfig(core, nullptr);
-
+void CoreManager::configureCore(mCore* core) const {
+	// The config can change under us at any time, so this has to happen on the GUI thread
 	if (m_config) {
 		mCoreLoadForeignConfig(core, m_config);
 	}
+}
 
-	if (m_preload) {
-		mCorePreloadVF(core, vf);
+void CoreManager::readGame(PendingLoad* load, bool preload, LoadProgress* progress) {
+	mCore* core = load->core;
+	VFile* vf = load->vf;
+	// The core takes ownership of the file either way
+	load->vf = nullptr;
+	if (progress) {
+		progress->stage.storeRelease(LOAD_READING);
+	}
+	if (preload) {
+		mCorePreloadVFCB(core, vf, [](size_t done, size_t total, void* context) {
+			if (context && total) {
+				static_cast<LoadProgress*>(context)->permille.storeRelease(static_cast<int>(static_cast<qint64>(done) * 1000 / total));
+			}
+		}, progress);
 	} else {
 		core->loadROM(core, vf);
 	}
 
-	QByteArray bytes(path.toUtf8());
+	QByteArray bytes(load->path.toUtf8());
 	separatePath(bytes.constData(), nullptr, core->dirs.baseName, nullptr);
 
-	QFileInfo info(base);
+	QFileInfo info(load->base);
 	if (info.isDir()) {
-		info = QFileInfo(base + "/" + path);
+		info = QFileInfo(load->base + "/" + load->path);
 	}
-	bytes = info.dir().canonicalPath().toUtf8();
+	load->dir = info.dir().canonicalPath();
+	bytes = load->dir.toUtf8();
 	mDirectorySetAttachBase(&core->dirs, VDirOpen(bytes.constData()));
-	if (!mCoreAutoloadSave(core)) {
-		LOG(QT, ERROR) << tr("Failed to open save file; in-game saves cannot be updated. Please ensure the save directory is writable without additional privileges (e.g. UAC on Windows).");
+
+	if (progress) {
+		progress->stage.storeRelease(LOAD_SAVE);
 	}
+	load->saveFailed = !mCoreAutoloadSave(core);
 	mCoreAutoloadCheats(core);
 
-	CoreController* cc = new CoreController(core);
+	if (progress) {
+		progress->stage.storeRelease(LOAD_PATCH);
+	}
+	load->patched = mCoreAutoloadPatch(core);
+}
+
+void CoreManager::continueLoad(std::shared_ptr<PendingLoad> load, std::shared_ptr<LoadProgress> progress, QObject* context, LoadCallback callback) {
+	if (progress->cancelled.loadAcquire() || !load->core) {
+		progress->stage.storeRelease(LOAD_DONE);
+		callback(progress->cancelled.loadAcquire() ? nullptr : finishLoad(load.get()));
+		return;
+	}
+	configureCore(load->core);
+	bool preload = m_preload;
+	GBAApp::app()->submitWorkerJob([load, progress, preload]() {
+		readGame(load.get(), preload, progress.get());
+	}, context, [this, load, progress, callback]() {
+		progress->stage.storeRelease(LOAD_DONE);
+		callback(progress->cancelled.loadAcquire() ? nullptr : finishLoad(load.get()));
+	});
+}
+
+CoreController* CoreManager::finishLoad(PendingLoad* load) {
+	// Errors are only logged here since logging isn't safe off the GUI thread
+	if (!load->error.isEmpty()) {
+		LOG(QT, ERROR) << load->error;
+	}
+	if (!load->core) {
+		return nullptr;
+	}
+	if (load->saveFailed) {
+		LOG(QT, ERROR) << tr("Failed to open save file; in-game saves cannot be updated. Please ensure the save directory is writable without additional privileges (e.g. UAC on Windows).");
+	}
+
+	CoreController* cc = new CoreController(load->core);
+	load->core = nullptr;
+	cc->setPatched(load->patched);
 	if (m_multiplayer) {
 		cc->setMultiplayerController(m_multiplayer);
 	}
-	cc->setPath(path, info.dir().canonicalPath());
+	cc->setPath(load->path, load->dir);
 	emit coreLoaded(cc);
 	return cc;
 }
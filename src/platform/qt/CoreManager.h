@@ -5,10 +5,15 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #pragma once
 
+#include <QAtomicInt>
 #include <QFileInfo>
 #include <QObject>
 #include <QString>
 
+#include <functional>
+#include <memory>
+
+struct mCore;
 struct mCoreConfig;
 struct VFile;
 
@@ -21,10 +26,33 @@ class CoreManager : public QObject {
 Q_OBJECT
 
 public:
+	enum LoadStage {
+		LOAD_OPENING,
+		LOAD_READING,
+		LOAD_SAVE,
+		LOAD_PATCH,
+		LOAD_DONE,
+	};
+
+	// Progress of an asynchronous load, safe to poll from the GUI thread while it runs
+	struct LoadProgress {
+		QAtomicInt stage{LOAD_OPENING};
+		QAtomicInt permille{0};
+		QAtomicInt cancelled{0};
+	};
+
+	typedef std::function<void (CoreController*)> LoadCallback;
+
 	void setConfig(const mCoreConfig*);
 	void setMultiplayerController(MultiplayerController*);
 	void setPreload(bool preload) { m_preload = preload; }
 
+	// The slow parts of these are done on a worker thread. The callback is run on the GUI thread
+	// with the new controller, or null if the load failed or was cancelled, unless context is
+	// destroyed first.
+	std::shared_ptr<LoadProgress> loadGameAsync(const QString& path, QObject* context, LoadCallback callback);
+	std::shared_ptr<LoadProgress> loadGameAsync(VFile* vf, const QString& path, const QString& base, QObject* context, LoadCallback callback);
+
 public slots:
 	CoreController* loadGame(const QString& path);
 	CoreController* loadGame(VFile* vf, const QString& path, const QString& base);
@@ -34,6 +62,15 @@ signals:
 	void coreLoaded(CoreController*);
 
 private:
+	struct PendingLoad;
+
+	static VFile* openGame(const QString& path, QString* fname, QString* base, QString* error);
+	static void identifyGame(PendingLoad*);
+	void configureCore(mCore*) const;
+	static void readGame(PendingLoad*, bool preload, LoadProgress*);
+	void continueLoad(std::shared_ptr<PendingLoad>, std::shared_ptr<LoadProgress>, QObject* context, LoadCallback);
+	CoreController* finishLoad(PendingLoad*);
+
 	const mCoreConfig* m_config = nullptr;
 	MultiplayerController* m_multiplayer = nullptr;
 	bool m_preload = false;
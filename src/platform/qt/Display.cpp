@@ -100,6 +100,9 @@ void QGBA::Display::attach(std::shared_ptr<CoreController> controller) {
 		if (m_showFrameCounter) {
 			m_messagePainter.showFrameCounter(controllerP->frameCounter());
 		}
+		if (m_showFrameTimings) {
+			updateFrameTimings(controllerP);
+		}
 	});
 	connect(controllerP, &CoreController::statusPosted, this, &Display::showMessage);
 	connect(controllerP, &CoreController::didReset, this, &Display::resizeContext);
@@ -113,6 +116,7 @@ void QGBA::Display::configure(ConfigController* config) {
 	filter(opts->resampleVideo);
 	config->updateOption("showOSD");
 	config->updateOption("showFrameCounter");
+	config->updateOption("showFrameTimings");
 	config->updateOption("videoSync");
 #if defined(BUILD_GL) || defined(BUILD_GLES2) || defined(BUILD_GLES3)
 	if (opts->shader && supportsShaders()) {
@@ -163,6 +167,41 @@ void QGBA::Display::showFrameCounter(bool enable) {
 	}
 }
 
+void QGBA::Display::showFrameTimings(bool enable) {
+	m_showFrameTimings = enable;
+	if (!enable) {
+		m_messagePainter.clearFrameTimings();
+	}
+}
+
+void QGBA::Display::updateFrameTimings(CoreController* controller) {
+	// Redoing the summary every frame would make it unreadable, so only refresh a few times a second
+	if (controller->frameCounter() % FRAME_TIMING_INTERVAL) {
+		return;
+	}
+	mCoreFrameTiming timings[FRAME_TIMING_WINDOW];
+	size_t count = mCoreThreadGetFrameTimings(controller->thread(), timings, FRAME_TIMING_WINDOW);
+	if (!count) {
+		return;
+	}
+	mCoreFrameTiming mean;
+	mCoreFrameTiming worst;
+	mCoreFrameTimingSummarize(timings, count, &mean, &worst);
+
+	auto ms = [](uint64_t nsec) {
+		return QString::number(nsec / 1000000.0, 'f', 2);
+	};
+	QStringList lines;
+	lines.append(tr("Frame: %1 ms (max %2)").arg(ms(mean.frameNsec)).arg(ms(worst.frameNsec)));
+	lines.append(tr("Emulation: %1 ms (max %2)").arg(ms(mean.emulationNsec)).arg(ms(worst.emulationNsec)));
+	lines.append(tr("Video wait: %1 ms (max %2)").arg(ms(mean.videoWaitNsec)).arg(ms(worst.videoWaitNsec)));
+	lines.append(tr("Audio wait: %1 ms (max %2)").arg(ms(mean.audioWaitNsec)).arg(ms(worst.audioWaitNsec)));
+	if (worst.presentNsec) {
+		lines.append(tr("Present: %1 ms (max %2)").arg(ms(mean.presentNsec)).arg(ms(worst.presentNsec)));
+	}
+	m_messagePainter.showFrameTimings(lines);
+}
+
 void QGBA::Display::filter(bool filter) {
 	m_filter = filter;
 }
@@ -44,6 +44,7 @@ public:
 	bool isFiltered() const { return m_filter; }
 	bool isShowOSD() const { return m_showOSD; }
 	bool isShowFrameCounter() const { return m_showFrameCounter; }
+	bool isShowFrameTimings() const { return m_showFrameTimings; }
 
 	QPoint normalizedPoint(CoreController*, const QPoint& localRef);
 
@@ -77,6 +78,7 @@ public slots:
 	virtual void interframeBlending(bool enable);
 	virtual void showOSDMessages(bool enable);
 	virtual void showFrameCounter(bool enable);
+	virtual void showFrameTimings(bool enable);
 	virtual void filter(bool filter);
 	virtual void swapInterval(int interval) = 0;
 	virtual void framePosted() = 0;
@@ -95,10 +97,15 @@ protected:
 private:
 	static Driver s_driver;
 	static const int MOUSE_DISAPPEAR_TIMER = 1000;
+	static const int FRAME_TIMING_WINDOW = 60;
+	static const int FRAME_TIMING_INTERVAL = 15;
+
+	void updateFrameTimings(CoreController*);
 
 	MessagePainter m_messagePainter;
 	bool m_showOSD = true;
 	bool m_showFrameCounter = false;
+	bool m_showFrameTimings = false;
 	bool m_lockAspectRatio = false;
 	bool m_lockIntegerScaling = false;
 	bool m_interframeBlending = false;
@@ -8,7 +8,6 @@
 #if defined(BUILD_GL) || defined(BUILD_GLES2) || defined(BUILD_GLES3) || defined(USE_EPOXY)
 
 #include <QApplication>
-#include <QMutexLocker>
 #include <QOpenGLExtraFunctions>
 #include <QOpenGLFunctions>
 #include <QOpenGLPaintDevice>
@@ -493,9 +492,7 @@ PainterGL::PainterGL(QWindow* window, mGLWidget* widget, const QSurfaceFormat& f
 		m_surface = m_window;
 	}
 	m_supportsShaders = m_format.version() >= qMakePair(2, 0);
-	for (auto& buf : m_buffers) {
-		m_free.append(&buf.front());
-	}
+	TripleBufferInit(&m_frames, 0x100000 * sizeof(uint32_t));
 	connect(&m_drawTimer, &QTimer::timeout, this, &PainterGL::draw);
 	m_drawTimer.setSingleShot(true);
 }
@@ -504,6 +501,7 @@ PainterGL::~PainterGL() {
 	if (m_gl) {
 		destroy();
 	}
+	TripleBufferDeinit(&m_frames);
 }
 
 void PainterGL::setThread(QThread* thread) {
@@ -772,7 +770,7 @@ void PainterGL::start() {
 }
 
 void PainterGL::draw() {
-	if (!m_started || m_queue.isEmpty()) {
+	if (!m_started || !m_pendingFrame.loadAcquire()) {
 		return;
 	}
 
@@ -823,6 +821,7 @@ void PainterGL::draw() {
 		m_delayTimer.restart();
 		performDraw();
 		m_backend->swap(m_backend);
+		mCoreThreadFramePresented(m_context->thread());
 	}
 }
 
@@ -891,51 +890,35 @@ void PainterGL::performDraw() {
 }
 
 void PainterGL::enqueue(const uint32_t* backing) {
-	QMutexLocker locker(&m_mutex);
-	uint32_t* buffer = nullptr;
+	// This runs on the GUI thread and never waits on the painter; if the painter falls behind,
+	// frames it didn't get to are simply overwritten by newer ones
 	if (backing) {
-		if (m_free.isEmpty()) {
-			buffer = m_queue.dequeue();
-		} else {
-			buffer = m_free.takeLast();
-		}
-		if (buffer) {
-			QSize size = m_context->screenDimensions();
-			memcpy(buffer, backing, size.width() * size.height() * BYTES_PER_PIXEL);
-		}
+		QSize size = m_context->screenDimensions();
+		memcpy(TripleBufferBack(&m_frames), backing, size.width() * size.height() * BYTES_PER_PIXEL);
+		TripleBufferPublish(&m_frames);
+		m_pendingFrame.storeRelease(FRAME_SOFTWARE);
+	} else {
+		m_pendingFrame.storeRelease(FRAME_HARDWARE);
 	}
-	m_queue.enqueue(buffer);
 }
 
 void PainterGL::dequeue() {
-	QMutexLocker locker(&m_mutex);
-	if (!m_queue.isEmpty()) {
-		uint32_t* buffer = m_queue.dequeue();
-		if (m_buffer) {
-			m_free.append(m_buffer);
-		}
-		m_buffer = buffer;
+	int pending = m_pendingFrame.fetchAndStoreAcquire(FRAME_NONE);
+	if (pending == FRAME_HARDWARE) {
+		m_buffer = nullptr;
+	} else if (pending == FRAME_SOFTWARE && TripleBufferAcquire(&m_frames)) {
+		m_buffer = static_cast<const uint32_t*>(TripleBufferFront(&m_frames));
 	}
 }
 
 void PainterGL::dequeueAll(bool keep) {
-	QMutexLocker locker(&m_mutex);
-	uint32_t* buffer = nullptr;
-	while (!m_queue.isEmpty()) {
-		buffer = m_queue.dequeue();
-		if (keep) {
-			if (m_buffer && buffer) {
-				m_free.append(m_buffer);
-				m_buffer = buffer;
-			}
-		} else if (buffer) {
-			m_free.append(buffer);
-		}
-	}
-	if (m_buffer && !keep) {
-		m_free.append(m_buffer);
-		m_buffer = nullptr;
+	if (keep) {
+		dequeue();
+		return;
 	}
+	m_pendingFrame.storeRelease(FRAME_NONE);
+	TripleBufferAcquire(&m_frames);
+	m_buffer = nullptr;
 }
 
 void PainterGL::setVideoProxy(std::shared_ptr<VideoProxy> proxy) {
@@ -19,7 +19,6 @@
 #include <QAtomicInt>
 #include <QElapsedTimer>
 #include <QHash>
-#include <QList>
 #include <QMouseEvent>
 #include <QOffscreenSurface>
 #include <QOpenGLContext>
@@ -27,17 +26,16 @@
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLWidget>
 #include <QPainter>
-#include <QQueue>
 #include <QThread>
 #include <QTimer>
 
-#include <array>
 #include <memory>
 
 #include "CoreController.h"
 #include "VideoProxy.h"
 
 #include <mgba/feature/video-backend.h>
+#include <mgba-util/triple-buffer.h>
 
 class QOpenGLPaintDevice;
 class QOpenGLWidget;
@@ -201,13 +199,17 @@ private:
 	void dequeueAll(bool keep = false);
 	void recenterLayers();
 
-	std::array<std::array<uint32_t, 0x100000>, 3> m_buffers;
-	QList<uint32_t*> m_free;
-	QQueue<uint32_t*> m_queue;
-	uint32_t* m_buffer = nullptr;
+	enum {
+		FRAME_NONE = 0,
+		FRAME_SOFTWARE,
+		FRAME_HARDWARE,
+	};
+
+	TripleBuffer m_frames;
+	QAtomicInt m_pendingFrame{FRAME_NONE};
+	const uint32_t* m_buffer = nullptr;
 
 	QPainter m_painter;
-	QMutex m_mutex;
 	QWindow* m_window;
 	QSurface* m_surface;
 	QSurfaceFormat m_format;
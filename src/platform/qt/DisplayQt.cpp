@@ -79,15 +79,13 @@ void DisplayQt::filter(bool filter) {
 void DisplayQt::framePosted() {
 	update();
 	const color_t* buffer = m_context->drawContext();
-	if (const_cast<const QImage&>(m_layers[VIDEO_LAYER_IMAGE]).bits() == reinterpret_cast<const uchar*>(buffer)) {
-		return;
-	}
 	m_oldBacking = m_layers[VIDEO_LAYER_IMAGE];
+	// The frame is only held until the next one is drawn, so the layer needs its own copy
 #ifdef COLOR_16_BIT
 #ifdef COLOR_5_6_5
-	m_layers[VIDEO_LAYER_IMAGE] = QImage(reinterpret_cast<const uchar*>(buffer), m_width, m_height, QImage::Format_RGB16);
+	m_layers[VIDEO_LAYER_IMAGE] = QImage(reinterpret_cast<const uchar*>(buffer), m_width, m_height, QImage::Format_RGB16).copy();
 #else
-	m_layers[VIDEO_LAYER_IMAGE] = QImage(reinterpret_cast<const uchar*>(buffer), m_width, m_height, QImage::Format_RGB555);
+	m_layers[VIDEO_LAYER_IMAGE] = QImage(reinterpret_cast<const uchar*>(buffer), m_width, m_height, QImage::Format_RGB555).copy();
 #endif
 #else
 	m_layers[VIDEO_LAYER_IMAGE] = QImage(reinterpret_cast<const uchar*>(buffer), m_width, m_height, QImage::Format_ARGB32);
@@ -155,9 +153,12 @@ void DisplayQt::paintEvent(QPaintEvent*) {
 
 	painter.restore();
 	painter.setOpacity(1);
-	if (isShowOSD() || isShowFrameCounter()) {
+	if (isShowOSD() || isShowFrameCounter() || isShowFrameTimings()) {
 		messagePainter()->paint(&painter);
 	}
+	if (m_context) {
+		mCoreThreadFramePresented(m_context->thread());
+	}
 }
 
 void DisplayQt::redoBounds() {
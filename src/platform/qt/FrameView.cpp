@@ -156,6 +156,7 @@ void FrameView::updateTilesGBA(bool) {
 	m_queue.clear();
 	{
 		CoreController::Interrupter interrupter(m_controller);
+		QMutexLocker cacheLocker(m_controller->graphicCachesLock());
 
 		uint16_t* io = static_cast<GBA*>(m_controller->thread()->core->board)->memory.io;
 		QRgb backdrop = M_RGB5_TO_RGB8(static_cast<GBA*>(m_controller->thread()->core->board)->video.palette[0]);
@@ -118,8 +118,7 @@ void GBAApp::cleanup() {
 
 bool GBAApp::event(QEvent* event) {
 	if (event->type() == QEvent::FileOpen) {
-		CoreController* core = m_manager.loadGame(static_cast<QFileOpenEvent*>(event)->file());
-		m_windows[0]->setController(core, static_cast<QFileOpenEvent*>(event)->file());
+		m_windows[0]->loadGame(static_cast<QFileOpenEvent*>(event)->file());
 		return true;
 	}
 	return QApplication::event(event);
@@ -321,7 +320,7 @@ bool GBAApp::waitOnJob(qint64 jobId, QObject* context, std::function<void ()> ca
 		}
 		callback();
 	});
-	m_workerJobCallbacks.insert(m_nextJob, connection);
+	m_workerJobCallbacks.insert(jobId, connection);
 	return true;
 }
 
@@ -393,6 +392,9 @@ void GBAApp::restartForUpdate() {
 void GBAApp::finishJob(qint64 jobId) {
 	m_workerJobs.remove(jobId);
 	emit jobFinished(jobId);
+	for (auto& job : m_workerJobCallbacks.values(jobId)) {
+		disconnect(job);
+	}
 	m_workerJobCallbacks.remove(jobId);
 }
 
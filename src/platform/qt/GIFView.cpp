@@ -31,33 +31,48 @@ GIFView::GIFView(QWidget* parent)
 
 	FFmpegEncoderInit(&m_encoder);
 	FFmpegEncoderSetAudio(&m_encoder, nullptr, 0);
+	mGIFEncoderInit(&m_gifEncoder);
 }
 
 GIFView::~GIFView() {
 	stopRecording();
 }
 
+mAVStream* GIFView::getStream() {
+	if (mGIFEncoderIsOpen(&m_gifEncoder)) {
+		return &m_gifEncoder.d;
+	}
+	return &m_encoder.d;
+}
+
 void GIFView::setController(std::shared_ptr<CoreController> controller) {
 	connect(controller.get(), &CoreController::stopping, this, &GIFView::stopRecording);
 	connect(this, &GIFView::recordingStarted, controller.get(), &CoreController::setAVStream);
 	connect(this, &GIFView::recordingStopped, controller.get(), &CoreController::clearAVStream, Qt::DirectConnection);
 	QSize size(controller->screenDimensions());
 	FFmpegEncoderSetDimensions(&m_encoder, size.width(), size.height());
+	mGIFEncoderSetDimensions(&m_gifEncoder, size.width(), size.height());
 }
 
 void GIFView::startRecording() {
-	if (m_ui.fmtWebP->isChecked()) {
-		FFmpegEncoderSetContainer(&m_encoder, "webp");
-		FFmpegEncoderSetVideo(&m_encoder, "libwebp_anim", 0, m_ui.frameskip->value());
-	} else if (m_ui.fmtApng->isChecked()) {
-		FFmpegEncoderSetContainer(&m_encoder, "apng");
-		FFmpegEncoderSetVideo(&m_encoder, "apng", 0, m_ui.frameskip->value());
+	bool opened;
+	if (m_ui.fmtGif->isChecked()) {
+		// GIFs are written directly, so the whole clip doesn't have to be buffered to make a palette
+		mGIFEncoderSetFrameskip(&m_gifEncoder, m_ui.frameskip->value());
+		mGIFEncoderSetLooping(&m_gifEncoder, m_ui.loop->isChecked());
+		opened = mGIFEncoderOpen(&m_gifEncoder, m_filename.toUtf8().constData());
 	} else {
-		FFmpegEncoderSetContainer(&m_encoder, "gif");
-		FFmpegEncoderSetVideo(&m_encoder, "gif", 0, m_ui.frameskip->value());
+		if (m_ui.fmtWebP->isChecked()) {
+			FFmpegEncoderSetContainer(&m_encoder, "webp");
+			FFmpegEncoderSetVideo(&m_encoder, "libwebp_anim", 0, m_ui.frameskip->value());
+		} else {
+			FFmpegEncoderSetContainer(&m_encoder, "apng");
+			FFmpegEncoderSetVideo(&m_encoder, "apng", 0, m_ui.frameskip->value());
+		}
+		FFmpegEncoderSetLooping(&m_encoder, m_ui.loop->isChecked());
+		opened = FFmpegEncoderOpen(&m_encoder, m_filename.toUtf8().constData());
 	}
-	FFmpegEncoderSetLooping(&m_encoder, m_ui.loop->isChecked());
-	if (!FFmpegEncoderOpen(&m_encoder, m_filename.toUtf8().constData())) {
+	if (!opened) {
 		LOG(QT, ERROR) << tr("Failed to open output file: %1").arg(m_filename);
 		return;
 	}
@@ -69,12 +84,13 @@ void GIFView::startRecording() {
 	m_ui.fmtApng->setEnabled(false);
 	m_ui.fmtGif->setEnabled(false);
 	m_ui.fmtWebP->setEnabled(false);
-	emit recordingStarted(&m_encoder.d);
+	emit recordingStarted(getStream());
 }
 
 void GIFView::stopRecording() {
 	emit recordingStopped();
 	FFmpegEncoderClose(&m_encoder);
+	mGIFEncoderClose(&m_gifEncoder);
 	m_ui.stop->setEnabled(false);
 	m_ui.start->setEnabled(!m_filename.isEmpty());
 	m_ui.frameskip->setEnabled(true);
@@ -93,7 +109,7 @@ void GIFView::selectFile() {
 
 void GIFView::setFilename(const QString& filename) {
 	m_filename = filename;
-	if (!FFmpegEncoderIsOpen(&m_encoder)) {
+	if (!FFmpegEncoderIsOpen(&m_encoder) && !mGIFEncoderIsOpen(&m_gifEncoder)) {
 		m_ui.start->setEnabled(!filename.isEmpty());
 		if (filename.endsWith(".gif")) {
 			m_ui.fmtGif->setChecked(true);
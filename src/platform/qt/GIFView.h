@@ -13,6 +13,8 @@
 
 #include "ui_GIFView.h"
 
+#include <mgba/feature/gif-encoder.h>
+
 #include "feature/ffmpeg/ffmpeg-encoder.h"
 
 namespace QGBA {
@@ -26,7 +28,7 @@ public:
 	GIFView(QWidget* parent = nullptr);
 	virtual ~GIFView();
 
-	mAVStream* getStream() { return &m_encoder.d; }
+	mAVStream* getStream();
 
 public slots:
 	void setController(std::shared_ptr<CoreController>);
@@ -47,6 +49,7 @@ private:
 	Ui::GIFView m_ui;
 
 	FFmpegEncoder m_encoder;
+	mGIFEncoder m_gifEncoder;
 
 	QString m_filename;
 };
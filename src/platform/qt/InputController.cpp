@@ -82,10 +82,14 @@ InputController::InputController(QWidget* topLevel, QObject* parent)
 	m_image.p = this;
 	m_image.startRequestImage = [](mImageSource* context, unsigned w, unsigned h, int) {
 		InputControllerImage* image = static_cast<InputControllerImage*>(context);
-		image->w = w;
-		image->h = h;
-		if (image->image.isNull()) {
-			image->image.load(":/res/no-cam.png");
+		{
+			QMutexLocker locker(&image->mutex);
+			image->w = w;
+			image->h = h;
+			if (image->image.isNull()) {
+				image->image.load(":/res/no-cam.png");
+			}
+			image->outOfDate = true;
 		}
 #ifdef BUILD_QT_MULTIMEDIA
 		image->p->m_cameraActive = true;
@@ -111,13 +115,15 @@ InputController::InputController(QWidget* topLevel, QObject* parent)
 		{
 			QMutexLocker locker(&image->mutex);
 			if (image->outOfDate) {
-				image->resizedImage = image->image.scaled(image->w, image->h, Qt::KeepAspectRatioByExpanding);
-				image->resizedImage = image->resizedImage.convertToFormat(QImage::Format_RGB16);
+				// Normally the GUI thread has already done this when the image came in
+				image->resizedImage = scaleCamImage(image->image, image->w, image->h);
 				image->outOfDate = false;
 			}
+			// Hold onto our own reference so the GUI thread can swap in a new frame while the core reads this one
+			image->activeImage = image->resizedImage;
 		}
-		size = image->resizedImage.size();
-		const uint16_t* bits = reinterpret_cast<const uint16_t*>(image->resizedImage.constBits());
+		size = image->activeImage.size();
+		const uint16_t* bits = reinterpret_cast<const uint16_t*>(image->activeImage.constBits());
 		if (size.width() > image->w) {
 			bits += (size.width() - image->w) / 2;
 		}
@@ -125,7 +131,7 @@ InputController::InputController(QWidget* topLevel, QObject* parent)
 			bits += ((size.height() - image->h) / 2) * size.width();
 		}
 		*buffer = bits;
-		*stride = image->resizedImage.bytesPerLine() / sizeof(*bits);
+		*stride = image->activeImage.bytesPerLine() / sizeof(*bits);
 		*format = mCOLOR_RGB565;
 	};
 }
@@ -585,10 +591,32 @@ void InputController::setCamImage(const QImage& image) {
 	if (image.isNull()) {
 		return;
 	}
+	int w, h;
+	{
+		QMutexLocker locker(&m_image.mutex);
+		m_image.image = image;
+		w = m_image.w;
+		h = m_image.h;
+	}
+	if (w <= 0 || h <= 0) {
+		QMutexLocker locker(&m_image.mutex);
+		m_image.outOfDate = true;
+		return;
+	}
+	// Scale here instead of when the core asks for the image, so a capture never waits on it
+	QImage resized = scaleCamImage(image, w, h);
 	QMutexLocker locker(&m_image.mutex);
-	m_image.image = image;
-	m_image.resizedImage = QImage();
-	m_image.outOfDate = true;
+	if (m_image.w != w || m_image.h != h) {
+		m_image.outOfDate = true;
+		return;
+	}
+	m_image.resizedImage = resized;
+	m_image.outOfDate = false;
+}
+
+QImage InputController::scaleCamImage(const QImage& image, int w, int h) {
+	QImage resized = image.scaled(w, h, Qt::KeepAspectRatioByExpanding);
+	return resized.convertToFormat(QImage::Format_RGB16);
 }
 
 QList<QPair<QByteArray, QString>> InputController::listCameras() const {
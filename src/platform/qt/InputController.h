@@ -142,6 +142,7 @@ private:
 
 	static int claimPlayer();
 	static void freePlayer(int);
+	static QImage scaleCamImage(const QImage& image, int w, int h);
 
 	std::shared_ptr<Gamepad> gamepad(uint32_t type);
 	QList<std::shared_ptr<Gamepad>> gamepads();
@@ -161,9 +162,11 @@ private:
 		InputController* p;
 		QImage image;
 		QImage resizedImage;
-		bool outOfDate;
+		QImage activeImage;
+		bool outOfDate = true;
 		QMutex mutex;
-		int w, h;
+		int w = 0;
+		int h = 0;
 	} m_image;
 
 #ifdef BUILD_QT_MULTIMEDIA
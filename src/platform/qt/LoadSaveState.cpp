@@ -6,23 +6,33 @@
 #include "LoadSaveState.h"
 
 #include "CoreController.h"
+#include "GBAApp.h"
 #include "input/GamepadAxisEvent.h"
 #include "input/GamepadButtonEvent.h"
 #include "VFileDevice.h"
 #include "utils.h"
 
 #include <QAction>
-#include <QDateTime>
+#include <QCache>
 #include <QKeyEvent>
+#include <QMutexLocker>
 #include <QPainter>
 
 #include <mgba/core/serialize.h>
 #include <mgba/internal/gba/input.h>
-#include <mgba-util/memory.h>
+#include <mgba-util/crc32.h>
 #include <mgba-util/vfs.h>
 
+#include <memory>
+
+#define THUMBNAIL_CACHE_SIZE 64
+
 using namespace QGBA;
 
+// Keyed by the CRC32 of the whole state file, so a slot that gets overwritten never reuses a stale entry
+static QCache<uint32_t, LoadSaveState::StateThumbnail> s_thumbnails(THUMBNAIL_CACHE_SIZE);
+static QMutex s_thumbnailLock;
+
 LoadSaveState::LoadSaveState(std::shared_ptr<CoreController> controller, QWidget* parent)
 	: QWidget(parent)
 	, m_controller(controller)
@@ -177,60 +187,101 @@ bool LoadSaveState::eventFilter(QObject* object, QEvent* event) {
 	return false;
 }
 
-void LoadSaveState::loadState(int slot) {
-	mCoreThread* thread = m_controller->thread();
-	VFile* vf = mCoreGetState(thread->core, slot, 0);
-	if (!vf) {
-		m_slots[slot - 1]->setText(tr("Empty"));
-		return;
+LoadSaveState::StateThumbnail LoadSaveState::decodeThumbnail(VFile* vf, size_t stateSize, QSize dims) {
+	StateThumbnail thumbnail;
+	ssize_t fileSize = vf->size(vf);
+	if (fileSize <= 0) {
+		return thumbnail;
+	}
+	QByteArray contents(fileSize, Qt::Uninitialized);
+	vf->seek(vf, 0, SEEK_SET);
+	if (vf->read(vf, contents.data(), fileSize) != fileSize) {
+		return thumbnail;
+	}
+	uint32_t key = doCrc32(contents.constData(), contents.size());
+	{
+		QMutexLocker locker(&s_thumbnailLock);
+		StateThumbnail* cached = s_thumbnails.object(key);
+		if (cached) {
+			return *cached;
+		}
 	}
 
+	VFile* mem = VFileFromConstMemory(contents.constData(), contents.size());
 	mStateExtdata extdata;
 	mStateExtdataInit(&extdata);
-	void* state = mCoreExtractState(thread->core, vf, &extdata);
-	vf->seek(vf, 0, SEEK_SET);
-	if (!state) {
-		m_slots[slot - 1]->setText(tr("Corrupted"));
-		mStateExtdataDeinit(&extdata);
-		return;
+	// Only the extdata is needed here, so the state itself is never decompressed
+	thumbnail.valid = mCoreExtractExtdata(nullptr, mem, &extdata);
+	if (!thumbnail.valid && static_cast<size_t>(fileSize) >= stateSize) {
+		// Uncompressed states have no header, and their extdata starts right after the state
+		mem->seek(mem, stateSize, SEEK_SET);
+		thumbnail.valid = mStateExtdataDeserialize(&extdata, mem) || static_cast<size_t>(fileSize) == stateSize;
 	}
+	mem->close(mem);
 
-	QDateTime creation;
-	QImage stateImage;
-
-	QSize size = m_controller->screenDimensions();
 	mStateExtdataItem item;
-	if (mStateExtdataGet(&extdata, EXTDATA_SCREENSHOT, &item)) {
-		mStateExtdataItem dims;
-		if (mStateExtdataGet(&extdata, EXTDATA_SCREENSHOT_DIMENSIONS, &dims) && dims.size == sizeof(uint16_t[2])) {
-			size.setWidth(static_cast<uint16_t*>(dims.data)[0]);
-			size.setHeight(static_cast<uint16_t*>(dims.data)[1]);
+	if (thumbnail.valid && mStateExtdataGet(&extdata, EXTDATA_SCREENSHOT, &item)) {
+		mStateExtdataItem size;
+		if (mStateExtdataGet(&extdata, EXTDATA_SCREENSHOT_DIMENSIONS, &size) && size.size == sizeof(uint16_t[2])) {
+			dims.setWidth(static_cast<uint16_t*>(size.data)[0]);
+			dims.setHeight(static_cast<uint16_t*>(size.data)[1]);
 		}
-		if (item.size >= static_cast<int32_t>(size.width() * size.height() * 4)) {
-			stateImage = QImage((uchar*) item.data, size.width(), size.height(), QImage::Format_ARGB32).rgbSwapped();
+		if (item.size >= static_cast<int32_t>(dims.width() * dims.height() * 4)) {
+			thumbnail.image = QImage((uchar*) item.data, dims.width(), dims.height(), QImage::Format_ARGB32).rgbSwapped();
 		}
 	}
 
-	if (mStateExtdataGet(&extdata, EXTDATA_META_TIME, &item) && item.size == sizeof(uint64_t)) {
+	if (thumbnail.valid && mStateExtdataGet(&extdata, EXTDATA_META_TIME, &item) && item.size == sizeof(uint64_t)) {
 		uint64_t creationUsec;
 		LOAD_64LE(creationUsec, 0, item.data);
-		creation = QDateTime::fromMSecsSinceEpoch(creationUsec / 1000LL);
+		thumbnail.creation = QDateTime::fromMSecsSinceEpoch(creationUsec / 1000LL);
+	}
+	mStateExtdataDeinit(&extdata);
+
+	QMutexLocker locker(&s_thumbnailLock);
+	s_thumbnails.insert(key, new StateThumbnail(thumbnail));
+	return thumbnail;
+}
+
+void LoadSaveState::loadState(int slot) {
+	mCoreThread* thread = m_controller->thread();
+	VFile* vf = mCoreGetState(thread->core, slot, 0);
+	if (!vf) {
+		m_slots[slot - 1]->setText(tr("Empty"));
+		return;
+	}
+
+	// Decoding happens on a worker thread; the slot shows a placeholder until it's done
+	m_slots[slot - 1]->setText(tr("Loading..."));
+	size_t stateSize = thread->core->stateSize(thread->core);
+	QSize dims = m_controller->screenDimensions();
+	auto thumbnail = std::make_shared<StateThumbnail>();
+	GBAApp::app()->submitWorkerJob([vf, stateSize, dims, thumbnail]() {
+		*thumbnail = decodeThumbnail(vf, stateSize, dims);
+		vf->close(vf);
+	}, this, [this, slot, thumbnail]() {
+		showState(slot, *thumbnail);
+	});
+}
+
+void LoadSaveState::showState(int slot, const StateThumbnail& thumbnail) {
+	if (!thumbnail.valid) {
+		m_slots[slot - 1]->setText(tr("Corrupted"));
+		return;
 	}
 
-	if (!stateImage.isNull()) {
+	if (!thumbnail.image.isNull()) {
 		QPixmap statePixmap;
-		statePixmap.convertFromImage(stateImage);
+		statePixmap.convertFromImage(thumbnail.image);
 		m_slots[slot - 1]->setIcon(statePixmap);
 	}
-	if (creation.toMSecsSinceEpoch()) {
-		m_slots[slot - 1]->setText(QLocale().toString(creation, QLocale::ShortFormat));
-	} else if (stateImage.isNull()) {
+	if (thumbnail.creation.toMSecsSinceEpoch()) {
+		m_slots[slot - 1]->setText(QLocale().toString(thumbnail.creation, QLocale::ShortFormat));
+	} else if (thumbnail.image.isNull()) {
 		m_slots[slot - 1]->setText(tr("Slot %1").arg(slot));
 	} else {
 		m_slots[slot - 1]->setText(QString());
 	}
-	vf->close(vf);
-	mappedMemoryFree(state, thread->core->stateSize(thread->core));
 }
 
 void LoadSaveState::triggerState(int slot) {
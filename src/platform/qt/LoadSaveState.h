@@ -5,12 +5,16 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #pragma once
 
+#include <QDateTime>
+#include <QImage>
 #include <QWidget>
 
 #include <memory>
 
 #include "ui_LoadSaveState.h"
 
+struct VFile;
+
 namespace QGBA {
 
 class CoreController;
@@ -28,6 +32,12 @@ Q_OBJECT
 public:
 	const static int NUM_SLOTS = 9;
 
+	struct StateThumbnail {
+		QImage image;
+		QDateTime creation;
+		bool valid = false;
+	};
+
 	LoadSaveState(std::shared_ptr<CoreController> controller, QWidget* parent = nullptr);
 
 	void setInputController(InputController* controller);
@@ -48,7 +58,10 @@ protected:
 	virtual void focusInEvent(QFocusEvent*) override;
 
 private:
+	static StateThumbnail decodeThumbnail(VFile* vf, size_t stateSize, QSize dims);
+
 	void loadState(int slot);
+	void showState(int slot, const StateThumbnail& thumbnail);
 	void triggerState(int slot);
 
 	Ui::LoadSaveState m_ui;
@@ -118,7 +118,10 @@ void MapView::selectMap(int map) {
 		return;
 	}
 	m_map = map;
-	m_mapStatus.fill({});
+	{
+		QMutexLocker locker(m_controller->graphicCachesLock());
+		m_mapStatus->fill({});
+	}
 	// Different maps can have different max palette counts; set it to
 	// 0 immediately to avoid tile lookups with state palette IDs break
 	m_ui.tile->setPalette(0);
@@ -127,16 +130,17 @@ void MapView::selectMap(int map) {
 
 void MapView::selectTile(int x, int y) {
 	CoreController::Interrupter interrupter(m_controller);
+	QMutexLocker locker(m_controller->graphicCachesLock());
 	mMapCache* mapCache = mMapCacheSetGetPointer(&m_cacheSet->maps, m_map);
 	int tiles = mMapCacheTileCount(mapCache);
-	if (m_mapStatus.size() != tiles) {
-		m_mapStatus.resize(tiles);
-		m_mapStatus.fill({});
+	if (m_mapStatus->size() != tiles) {
+		m_mapStatus->resize(tiles);
+		m_mapStatus->fill({});
 	}
 	size_t tileCache = mTileCacheSetIndex(&m_cacheSet->tiles, mapCache->tileCache);
 	m_ui.tile->setBoundary(m_boundary, tileCache, tileCache);
 	uint32_t location = mMapCacheTileId(mapCache, x, y);
-	mMapCacheEntry* entry = &m_mapStatus[location];
+	mMapCacheEntry* entry = &(*m_mapStatus)[location];
 	m_ui.tile->selectIndex(entry->tileId + mapCache->tileStart);
 	m_ui.tile->setPalette(mMapCacheEntryFlagsGetPaletteId(entry->flags));
 	m_ui.tile->setFlip(mMapCacheEntryFlagsGetHMirror(entry->flags), mMapCacheEntryFlagsGetVMirror(entry->flags));
@@ -226,6 +230,16 @@ void MapView::updateTilesGBA(bool) {
 			offset = QString("%1, %2").arg(x).arg(y);
 		}
 #endif
+		// Compositing the map can take a while, so it happens on a worker thread
+		auto image = std::make_shared<QImage>();
+		auto apply = [this, image]() {
+			m_rawMap = *image;
+			QPixmap map = QPixmap::fromImage(m_rawMap.convertToFormat(QImage::Format_RGB32));
+			if (m_ui.magnification->value() > 1) {
+				map = map.scaled(map.size() * m_ui.magnification->value());
+			}
+			m_ui.map->setPixmap(map);
+		};
 		if (bitmap >= 0) {
 			mBitmapCache* bitmapCache = mBitmapCacheSetGetPointer(&m_cacheSet->bitmaps, bitmap);
 			int width = mBitmapCacheSystemInfoGetWidth(bitmapCache->sysConfig);
@@ -236,13 +250,16 @@ void MapView::updateTilesGBA(bool) {
 			m_ui.bgInfo->setCustomProperty("priority", priority);
 			m_ui.bgInfo->setCustomProperty("offset", offset);
 			m_ui.bgInfo->setCustomProperty("transform", transform);
-			m_rawMap = QImage(QSize(width, height), QImage::Format_ARGB32);
-			uchar* bgBits = m_rawMap.bits();
-			for (int j = 0; j < height; ++j) {
-				mBitmapCacheCleanRow(bitmapCache, m_bitmapStatus.data(), j);
-				memcpy(static_cast<void*>(&bgBits[width * j * 4]), mBitmapCacheGetRow(bitmapCache, j), width * 4);
-			}
-			m_rawMap = m_rawMap.convertToFormat(QImage::Format_RGB32).rgbSwapped();
+			std::shared_ptr<QVector<mBitmapCacheEntry>> status = m_bitmapStatus;
+			submitCacheJob([bitmapCache, width, height, status, image]() {
+				QImage rawMap(QSize(width, height), QImage::Format_ARGB32);
+				uchar* bgBits = rawMap.bits();
+				for (int j = 0; j < height; ++j) {
+					mBitmapCacheCleanRow(bitmapCache, status->data(), j);
+					memcpy(static_cast<void*>(&bgBits[width * j * 4]), mBitmapCacheGetRow(bitmapCache, j), width * 4);
+				}
+				*image = rawMap.convertToFormat(QImage::Format_RGB32).rgbSwapped();
+			}, apply);
 		} else {
 			mMapCache* mapCache = mMapCacheSetGetPointer(&m_cacheSet->maps, m_map);
 			int tilesW = 1 << mMapCacheSystemInfoGetTilesWide(mapCache->sysConfig);
@@ -257,14 +274,14 @@ void MapView::updateTilesGBA(bool) {
 			m_ui.bgInfo->setCustomProperty("priority", priority);
 			m_ui.bgInfo->setCustomProperty("offset", offset);
 			m_ui.bgInfo->setCustomProperty("transform", transform);
-			m_rawMap = compositeMap(m_map, &m_mapStatus);
+			mCacheSet* cacheSet = m_cacheSet;
+			int map = m_map;
+			std::shared_ptr<QVector<mMapCacheEntry>> status = m_mapStatus;
+			submitCacheJob([cacheSet, map, status, image]() {
+				*image = compositeMap(cacheSet, map, status.get());
+			}, apply);
 		}
 	}
-	QPixmap map = QPixmap::fromImage(m_rawMap.convertToFormat(QImage::Format_RGB32));
-	if (m_ui.magnification->value() > 1) {
-		map = map.scaled(map.size() * m_ui.magnification->value());
-	}
-	m_ui.map->setPixmap(map);
 }
 
 #ifdef M_CORE_GB
@@ -43,8 +43,9 @@ private:
 	Ui::MapView m_ui;
 
 	std::shared_ptr<CoreController> m_controller;
-	QVector<mMapCacheEntry> m_mapStatus;
-	QVector<mBitmapCacheEntry> m_bitmapStatus{512 * 2}; // TODO: Correct size
+	// Shared with the worker jobs that composite the map
+	std::shared_ptr<QVector<mMapCacheEntry>> m_mapStatus = std::make_shared<QVector<mMapCacheEntry>>();
+	std::shared_ptr<QVector<mBitmapCacheEntry>> m_bitmapStatus = std::make_shared<QVector<mBitmapCacheEntry>>(512 * 2); // TODO: Correct size
 	int m_map = 0;
 	QImage m_rawMap;
 	int m_boundary;
@@ -25,6 +25,7 @@ MemoryAccessLogView::MemoryAccessLogView(std::shared_ptr<CoreController> control
 	connect(this, &MemoryAccessLogView::loggingChanged, m_ui.stop, &QWidget::setEnabled);
 	connect(this, &MemoryAccessLogView::loggingChanged, m_ui.filename, &QWidget::setDisabled);
 	connect(this, &MemoryAccessLogView::loggingChanged, m_ui.browse, &QWidget::setDisabled);
+	connect(this, &MemoryAccessLogView::loggingChanged, m_ui.fastPath, &QWidget::setDisabled);
 
 	mCore* core = m_controller->thread()->core;
 	const mCoreMemoryBlock* info;
@@ -74,6 +75,7 @@ void MemoryAccessLogView::start() {
 		return;
 	}
 	mDebuggerAccessLoggerInit(&m_logger);
+	m_logger.fastPath = m_ui.fastPath->isChecked();
 	CoreController::Interrupter interrupter(m_controller);
 	m_controller->attachDebuggerModule(&m_logger.d);
 	if (!mDebuggerAccessLoggerOpen(&m_logger, vf, flags)) {
@@ -23,8 +23,13 @@
 #include <mgba/core/core.h>
 #include <mgba-util/vfs.h>
 
+#include <algorithm>
+
 using namespace QGBA;
 
+// How many refreshes a byte stays highlighted for after it changes
+static const char CHANGE_HIGHLIGHT_REFRESHES = 30;
+
 MemoryModel::MemoryModel(QWidget* parent)
 	: QAbstractScrollArea(parent)
 {
@@ -144,6 +149,11 @@ void MemoryModel::setAlignment(int width) {
 	viewport()->update();
 }
 
+void MemoryModel::refresh() {
+	takeSnapshot(true);
+	viewport()->update();
+}
+
 void MemoryModel::loadTBLFromPath(const QString& path) {
 	VFile* vf = VFileDevice::open(path, O_RDONLY);
 	if (!vf) {
@@ -205,7 +215,7 @@ void MemoryModel::paste() {
 	}
 	QByteArray bytestring(QByteArray::fromHex(string.toLocal8Bit()));
 	deserialize(bytestring);
-	viewport()->update();
+	refresh();
 }
 
 void MemoryModel::save() {
@@ -234,7 +244,7 @@ void MemoryModel::load() {
 	}
 	QByteArray bytestring(infile.readAll());
 	deserialize(bytestring);
-	viewport()->update();
+	refresh();
 }
 
 QByteArray MemoryModel::serialize() {
@@ -350,6 +360,9 @@ void MemoryModel::paintEvent(QPaintEvent*) {
 		                 QString::number(x, 16).toUpper());
 	}
 	int height = (viewport()->size().height() - m_cellHeight) / m_cellHeight;
+	if (m_top * 16 + m_base != m_snapshotStart || std::max(height, 0) * 16 != m_snapshot.size() || m_currentBank != m_snapshotBank) {
+		takeSnapshot(false);
+	}
 	for (int y = 0; y < height; ++y) {
 		int yp = m_cellHeight * y + m_margins.top();
 		if ((y + m_top) * 16U >= m_size) {
@@ -380,10 +393,12 @@ void MemoryModel::paintEvent(QPaintEvent*) {
 						    QPointF(m_cellSize.width() * (x + 1.0) - 2 * m_letterWidth + m_margins.left(), yp));
 						continue;
 					}
+				} else if (snapshotChanged(address, 2)) {
+					painter.setPen(palette.color(QPalette::Link));
 				} else {
 					painter.setPen(palette.color(QPalette::WindowText));
 				}
-				uint16_t b = m_core->rawRead16(m_core, address, m_currentBank);
+				uint16_t b = snapshotRead(address, 2);
 				painter.drawStaticText(
 				    QPointF(m_cellSize.width() * (x + 1.0) - 2 * m_letterWidth + m_margins.left(), yp),
 				    m_staticNumbers[(b >> 8) & 0xFF]);
@@ -408,10 +423,12 @@ void MemoryModel::paintEvent(QPaintEvent*) {
 						    QPointF(m_cellSize.width() * (x + 2.0) - 4 * m_letterWidth + m_margins.left(), yp));
 						continue;
 					}
+				} else if (snapshotChanged(address, 4)) {
+					painter.setPen(palette.color(QPalette::Link));
 				} else {
 					painter.setPen(palette.color(QPalette::WindowText));
 				}
-				uint32_t b = m_core->rawRead32(m_core, address, m_currentBank);
+				uint32_t b = snapshotRead(address, 4);
 				painter.drawStaticText(
 				    QPointF(m_cellSize.width() * (x + 2.0) - 4 * m_letterWidth + m_margins.left(), yp),
 				    m_staticNumbers[(b >> 24) & 0xFF]);
@@ -441,10 +458,12 @@ void MemoryModel::paintEvent(QPaintEvent*) {
 						                QPointF(m_cellSize.width() * (x + 0.5) - m_letterWidth + m_margins.left(), yp));
 						continue;
 					}
+				} else if (snapshotChanged(address, 1)) {
+					painter.setPen(palette.color(QPalette::Link));
 				} else {
 					painter.setPen(palette.color(QPalette::WindowText));
 				}
-				uint8_t b = m_core->rawRead8(m_core, address, m_currentBank);
+				uint8_t b = snapshotRead(address, 1);
 				painter.drawStaticText(QPointF(m_cellSize.width() * (x + 0.5) - m_letterWidth + m_margins.left(), yp),
 				                       m_staticNumbers[b]);
 			}
@@ -456,16 +475,16 @@ void MemoryModel::paintEvent(QPaintEvent*) {
 			uint32_t b;
 			switch (m_align) {
 			case 1:
-				b = m_core->rawRead8(m_core, (y + m_top) * 16 + x + m_base, m_currentBank);
+				b = snapshotRead((y + m_top) * 16 + x + m_base, 1);
 				array.append((char) b);
 				break;
 			case 2:
-				b = m_core->rawRead16(m_core, (y + m_top) * 16 + x + m_base, m_currentBank);
+				b = snapshotRead((y + m_top) * 16 + x + m_base, 2);
 				array.append((char) b);
 				array.append((char) (b >> 8));
 				break;
 			case 4:
-				b = m_core->rawRead32(m_core, (y + m_top) * 16 + x + m_base, m_currentBank);
+				b = snapshotRead((y + m_top) * 16 + x + m_base, 4);
 				array.append((char) b);
 				array.append((char) (b >> 8));
 				array.append((char) (b >> 16));
@@ -630,13 +649,79 @@ void MemoryModel::keyPressEvent(QKeyEvent* event) {
 		}
 		emit selectionChanged(m_selection.first, m_selection.second);
 	}
-	viewport()->update();
+	refresh();
 }
 
 void MemoryModel::boundsCheck() {
 	m_top = clamp(m_top, 0, static_cast<int32_t>(m_size >> 4) + 1 - viewport()->size().height() / m_cellHeight);
 }
 
+void MemoryModel::takeSnapshot(bool markChanges) {
+	int height = (viewport()->size().height() - m_cellHeight) / m_cellHeight;
+	uint32_t start = m_top * 16 + m_base;
+	int length = std::max(height, 0) * 16;
+	QByteArray snapshot(length, 0);
+	int offset = 0;
+	while (m_core && offset < length) {
+		uint32_t address = start + offset;
+		// Copy whole runs straight out of the backing memory where possible. Banked regions and
+		// MMIO go through the core a byte at a time so they read the same as the bus would.
+		const mCoreMemoryBlock* block = mCoreGetMemoryBlockInfo(m_core, address);
+		const uint8_t* mem = nullptr;
+		size_t blockSize = 0;
+		if (block && !block->maxSegment && strcmp(block->internalName, "io") != 0) {
+			mem = static_cast<const uint8_t*>(m_core->getMemoryBlock(m_core, block->id, &blockSize));
+			blockSize = std::min<size_t>(blockSize, block->size);
+		}
+		size_t blockOffset = block ? address - block->start : 0;
+		if (mem && blockOffset < blockSize) {
+			int run = std::min<size_t>(blockSize - blockOffset, length - offset);
+			memcpy(&snapshot.data()[offset], &mem[blockOffset], run);
+			offset += run;
+		} else {
+			snapshot.data()[offset] = m_core->rawRead8(m_core, address, m_currentBank);
+			++offset;
+		}
+	}
+
+	if (markChanges && start == m_snapshotStart && length == m_snapshot.size() && m_currentBank == m_snapshotBank) {
+		for (int i = 0; i < length; ++i) {
+			if (snapshot.at(i) != m_snapshot.at(i)) {
+				m_changed[i] = CHANGE_HIGHLIGHT_REFRESHES;
+			} else if (m_changed.at(i)) {
+				m_changed[i] = m_changed.at(i) - 1;
+			}
+		}
+	} else {
+		m_changed.fill(0, length);
+	}
+	m_snapshot = snapshot;
+	m_snapshotStart = start;
+	m_snapshotBank = m_currentBank;
+}
+
+uint32_t MemoryModel::snapshotRead(uint32_t address, int width) const {
+	uint32_t offset = address - m_snapshotStart;
+	uint32_t value = 0;
+	for (int i = width - 1; i >= 0; --i) {
+		value <<= 8;
+		if (offset + i < static_cast<uint32_t>(m_snapshot.size())) {
+			value |= static_cast<uint8_t>(m_snapshot.at(offset + i));
+		}
+	}
+	return value;
+}
+
+bool MemoryModel::snapshotChanged(uint32_t address, int width) const {
+	uint32_t offset = address - m_snapshotStart;
+	for (int i = 0; i < width; ++i) {
+		if (offset + i < static_cast<uint32_t>(m_changed.size()) && m_changed.at(offset + i)) {
+			return true;
+		}
+	}
+	return false;
+}
+
 bool MemoryModel::isInSelection(uint32_t address) {
 	if (m_selection.first == m_selection.second) {
 		return false;
@@ -43,6 +43,8 @@ public slots:
 	void jumpToAddress(const QString& hex);
 	void jumpToAddress(uint32_t);
 
+	void refresh();
+
 	void loadTBLFromPath(const QString& path);
 	void loadTBL();
 
@@ -65,6 +67,10 @@ protected:
 private:
 	void boundsCheck();
 
+	void takeSnapshot(bool markChanges);
+	uint32_t snapshotRead(uint32_t address, int width) const;
+	bool snapshotChanged(uint32_t address, int width) const;
+
 	bool isInSelection(uint32_t address);
 	bool isEditing(uint32_t address);
 	void drawEditingText(QPainter& painter, const QPointF& origin);
@@ -95,6 +101,11 @@ private:
 	uint32_t m_buffer;
 	int m_bufferedNybbles;
 	int m_currentBank;
+
+	QByteArray m_snapshot;
+	QByteArray m_changed;
+	uint32_t m_snapshotStart = 0;
+	int m_snapshotBank = -1;
 };
 
 }
@@ -9,10 +9,35 @@
 #include <mgba/core/core.h>
 
 #include "CoreController.h"
+#include "GBAApp.h"
 #include "MemoryView.h"
 
+#include <utility>
+
 using namespace QGBA;
 
+// Searches run on a worker thread, so everything they need is kept here instead of on the
+// widget, which may be closed before the search finishes
+struct MemorySearch::SearchJob {
+	SearchJob() { mCoreMemorySearchResultsInit(&results, 0); }
+	~SearchJob() { mCoreMemorySearchResultsDeinit(&results); }
+
+	static bool progress(void* context, size_t done, size_t total);
+
+	mCoreMemorySearchParams params;
+	QByteArray string;
+	bool within = false;
+	mCoreMemorySearchResults results;
+	QAtomicInt permille{0};
+	QAtomicInt cancelled{0};
+};
+
+bool MemorySearch::SearchJob::progress(void* context, size_t done, size_t total) {
+	SearchJob* job = static_cast<SearchJob*>(context);
+	job->permille.storeRelease(total ? done * 1000 / total : 1000);
+	return !job->cancelled.loadAcquire();
+}
+
 MemorySearch::MemorySearch(std::shared_ptr<CoreController> controller, QWidget* parent)
 	: QWidget(parent)
 	, m_controller(controller)
@@ -27,9 +52,15 @@ MemorySearch::MemorySearch(std::shared_ptr<CoreController> controller, QWidget*
 	connect(m_ui.numHex, &QPushButton::clicked, this, &MemorySearch::refresh);
 	connect(m_ui.numDec, &QPushButton::clicked, this, &MemorySearch::refresh);
 	connect(m_ui.viewMem, &QPushButton::clicked, this, &MemorySearch::openMemory);
+
+	m_progressTimer.setInterval(50);
+	connect(&m_progressTimer, &QTimer::timeout, this, &MemorySearch::updateProgress);
 }
 
 MemorySearch::~MemorySearch() {
+	if (m_job) {
+		m_job->cancelled.storeRelease(1);
+	}
 	mCoreMemorySearchResultsDeinit(&m_results);
 }
 
@@ -132,34 +163,77 @@ bool MemorySearch::createParams(mCoreMemorySearchParams* params) {
 }
 
 void MemorySearch::search() {
-	mCoreMemorySearchResultsClear(&m_results);
-
-	mCoreMemorySearchParams params;
-
-	CoreController::Interrupter interrupter(m_controller);
-	mCore* core = m_controller->thread()->core;
-
-	if (createParams(&params)) {
-		mCoreMemorySearch(core, &params, &m_results, LIMIT);
+	auto job = std::make_shared<SearchJob>();
+	if (!createParams(&job->params)) {
+		mCoreMemorySearchResultsClear(&m_results);
+		refresh();
+		return;
 	}
-
-	refresh();
+	startSearch(job);
 }
 
 void MemorySearch::searchWithin() {
-	mCoreMemorySearchParams params;
+	auto job = std::make_shared<SearchJob>();
+	if (!createParams(&job->params)) {
+		refresh();
+		return;
+	}
+	if (m_ui.opUnknown->isChecked()) {
+		job->params.op = mCORE_MEMORY_SEARCH_DELTA_ANY;
+	}
+	job->within = true;
+	mCoreMemorySearchResultsCopy(&job->results, &m_results);
+	startSearch(job);
+}
 
-	CoreController::Interrupter interrupter(m_controller);
-	mCore* core = m_controller->thread()->core;
+void MemorySearch::startSearch(std::shared_ptr<SearchJob> job) {
+	if (m_job) {
+		return;
+	}
+	if (job->params.type != mCORE_MEMORY_SEARCH_INT) {
+		job->string = m_string;
+		job->params.valueStr = job->string.constData();
+	}
+	m_job = job;
+	setSearching(true);
 
-	if (createParams(&params)) {
-		if (m_ui.opUnknown->isChecked()) {
-			params.op = mCORE_MEMORY_SEARCH_DELTA_ANY;
+	std::shared_ptr<CoreController> controller = m_controller;
+	GBAApp::app()->submitWorkerJob([job, controller]() {
+		CoreController::Interrupter interrupter(controller);
+		mCore* core = controller->thread()->core;
+		if (job->within) {
+			mCoreMemorySearchRepeatWithProgress(core, &job->params, &job->results, SearchJob::progress, job.get());
+		} else {
+			mCoreMemorySearchWithProgress(core, &job->params, &job->results, LIMIT, SearchJob::progress, job.get());
+		}
+	}, this, [this, job]() {
+		if (m_job != job) {
+			return;
 		}
-		mCoreMemorySearchRepeat(core, &params, &m_results);
+		m_job.reset();
+		setSearching(false);
+		std::swap(m_results, job->results);
+		refresh();
+	});
+}
+
+void MemorySearch::setSearching(bool searching) {
+	m_ui.search->setEnabled(!searching);
+	m_ui.searchWithin->setEnabled(!searching);
+	m_ui.refresh->setEnabled(!searching);
+	m_ui.progress->setValue(0);
+	m_ui.progress->setVisible(searching);
+	if (searching) {
+		m_progressTimer.start();
+	} else {
+		m_progressTimer.stop();
 	}
+}
 
-	refresh();
+void MemorySearch::updateProgress() {
+	if (m_job) {
+		m_ui.progress->setValue(m_job->permille.loadAcquire());
+	}
 }
 
 void MemorySearch::refresh() {
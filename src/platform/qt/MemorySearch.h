@@ -5,6 +5,8 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #pragma once
 
+#include <QTimer>
+
 #include <memory>
 
 #include "ui_MemorySearch.h"
@@ -31,9 +33,14 @@ public slots:
 
 private slots:
 	void openMemory();
+	void updateProgress();
 
 private:
+	struct SearchJob;
+
 	bool createParams(mCoreMemorySearchParams*);
+	void startSearch(std::shared_ptr<SearchJob>);
+	void setSearching(bool);
 
 	Ui::MemorySearch m_ui;
 
@@ -41,6 +48,9 @@ private:
 
 	mCoreMemorySearchResults m_results;
 	QByteArray m_string;
+
+	std::shared_ptr<SearchJob> m_job;
+	QTimer m_progressTimer;
 };
 
 }
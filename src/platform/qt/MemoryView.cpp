@@ -232,7 +232,7 @@ void MemoryView::setSegment(int segment) {
 }
 
 void MemoryView::update() {
-	m_ui.hexfield->viewport()->update();
+	m_ui.hexfield->refresh();
 	updateStatus();
 }
 
@@ -77,28 +77,42 @@ void MessagePainter::paint(QPainter* painter) {
 	if (!m_message.text().isEmpty()) {
 		painter->drawPixmap(m_local, m_pixmap);
 	}
+	int line = 0;
 	if (m_drawFrameCounter) {
-		QString frame(tr("Frame %1").arg(m_frameCounter));
-		QFontMetrics metrics(m_frameFont);
-		painter->setWorldTransform(m_world);
-		painter->setRenderHint(QPainter::Antialiasing);
-		painter->setFont(m_frameFont);
-		painter->setPen(Qt::black);
+		drawCornerText(painter, tr("Frame %1").arg(m_frameCounter), line);
+		++line;
+	}
+	m_mutex.lock();
+	QStringList frameTimings(m_frameTimings);
+	m_mutex.unlock();
+	for (const QString& timing : frameTimings) {
+		drawCornerText(painter, timing, line);
+		++line;
+	}
+}
+
+void MessagePainter::drawCornerText(QPainter* painter, const QString& text, int line) {
+	QFontMetrics metrics(m_frameFont);
+	painter->save();
+	painter->setWorldTransform(m_world);
+	painter->setRenderHint(QPainter::Antialiasing);
+	painter->setFont(m_frameFont);
+	painter->setPen(Qt::black);
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 11, 0))
-		painter->translate(-metrics.horizontalAdvance(frame), 0);
+	painter->translate(-metrics.horizontalAdvance(text), line * metrics.height());
 #else
-		painter->translate(-metrics.width(frame), 0);
+	painter->translate(-metrics.width(text), line * metrics.height());
 #endif
-		const static int ITERATIONS = 11;
-		for (int i = 0; i < ITERATIONS; ++i) {
-			painter->save();
-			painter->translate(cos(i * 2.0 * M_PI / ITERATIONS) * 0.8, sin(i * 2.0 * M_PI / ITERATIONS) * 0.8);
-			painter->drawText(m_framePoint, frame);
-			painter->restore();
-		}
-		painter->setPen(Qt::white);
-		painter->drawText(m_framePoint, frame);
+	const static int ITERATIONS = 11;
+	for (int i = 0; i < ITERATIONS; ++i) {
+		painter->save();
+		painter->translate(cos(i * 2.0 * M_PI / ITERATIONS) * 0.8, sin(i * 2.0 * M_PI / ITERATIONS) * 0.8);
+		painter->drawText(m_framePoint, text);
+		painter->restore();
 	}
+	painter->setPen(Qt::white);
+	painter->drawText(m_framePoint, text);
+	painter->restore();
 }
 
 void MessagePainter::showMessage(const QString& message) {
@@ -130,3 +144,15 @@ void MessagePainter::clearFrameCounter() {
 	m_drawFrameCounter = false;
 	m_mutex.unlock();
 }
+
+void MessagePainter::showFrameTimings(const QStringList& timings) {
+	m_mutex.lock();
+	m_frameTimings = timings;
+	m_mutex.unlock();
+}
+
+void MessagePainter::clearFrameTimings() {
+	m_mutex.lock();
+	m_frameTimings.clear();
+	m_mutex.unlock();
+}
@@ -9,6 +9,7 @@
 #include <QObject>
 #include <QPixmap>
 #include <QStaticText>
+#include <QStringList>
 #include <QTimer>
 
 namespace QGBA {
@@ -30,14 +31,19 @@ public slots:
 	void showFrameCounter(uint64_t);
 	void clearFrameCounter();
 
+	void showFrameTimings(const QStringList&);
+	void clearFrameTimings();
+
 private:
 	void redraw();
+	void drawCornerText(QPainter* painter, const QString& text, int line);
 
 	QMutex m_mutex;
 	QStaticText m_message;
 	qreal m_scaleFactor = 1;
 	uint64_t m_frameCounter;
 	bool m_drawFrameCounter = false;
+	QStringList m_frameTimings;
 
 	QPoint m_local;
 	QPixmap m_pixmap;
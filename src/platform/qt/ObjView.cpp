@@ -11,6 +11,7 @@
 #include <QAction>
 #include <QClipboard>
 #include <QListWidgetItem>
+#include <QMutexLocker>
 #include <QTimer>
 
 #include "LogController.h"
@@ -99,6 +100,7 @@ void ObjView::translateIndex(int index) {
 
 #ifdef M_CORE_GBA
 void ObjView::updateTilesGBA(bool force) {
+	QMutexLocker locker(m_controller->graphicCachesLock());
 	m_ui.objId->setMaximum(127);
 	const GBA* gba = static_cast<const GBA*>(m_controller->thread()->core->board);
 	const GBAObj* obj = &gba->video.oam.obj[m_objId];
@@ -204,6 +206,7 @@ void ObjView::updateTilesGBA(bool force) {
 
 #ifdef M_CORE_GB
 void ObjView::updateTilesGB(bool force) {
+	QMutexLocker locker(m_controller->graphicCachesLock());
 	m_ui.objId->setMaximum(39);
 	const GB* gb = static_cast<const GB*>(m_controller->thread()->core->board);
 	const GBObj* obj = &gb->video.oam.obj[m_objId];
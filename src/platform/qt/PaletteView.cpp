@@ -30,7 +30,12 @@ PaletteView::PaletteView(std::shared_ptr<CoreController> controller, QWidget* pa
 {
 	m_ui.setupUi(this);
 
-	connect(controller.get(), &CoreController::frameAvailable, this, &PaletteView::updatePalette);
+	controller->watchDebugData(CoreController::DEBUG_DATA_PALETTE);
+	connect(controller.get(), &CoreController::debugDataChanged, this, [this](int regions) {
+		if (regions & CoreController::DEBUG_DATA_PALETTE) {
+			updatePalette();
+		}
+	});
 	m_ui.bgGrid->setDimensions(QSize(16, 16));
 	m_ui.objGrid->setDimensions(QSize(16, 16));
 	int count = 256;
@@ -62,6 +67,10 @@ PaletteView::PaletteView(std::shared_ptr<CoreController> controller, QWidget* pa
 	connect(m_ui.exportOBJ, &QAbstractButton::clicked, [this, count] () { exportPalette(count, count); });
 }
 
+PaletteView::~PaletteView() {
+	m_controller->unwatchDebugData(CoreController::DEBUG_DATA_PALETTE);
+}
+
 void PaletteView::updatePalette() {
 	if (!m_controller->thread() || !m_controller->thread()->core) {
 		return;
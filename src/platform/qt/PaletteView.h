@@ -23,6 +23,7 @@ Q_OBJECT
 
 public:
 	PaletteView(std::shared_ptr<CoreController> controller, QWidget* parent = nullptr);
+	~PaletteView();
 
 public slots:
 	void updatePalette();
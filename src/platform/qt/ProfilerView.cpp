@@ -0,0 +1,105 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "ProfilerView.h"
+
+#include <QMessageBox>
+#include <QTreeWidgetItem>
+
+#include "GBAApp.h"
+#include "VFileDevice.h"
+
+#include <mgba-util/vfs.h>
+
+using namespace QGBA;
+
+ProfilerView::ProfilerView(std::shared_ptr<CoreController> controller, QWidget* parent)
+	: QWidget(parent)
+	, m_controller(controller)
+{
+	m_ui.setupUi(this);
+	m_ui.interval->setValue(mDEBUGGER_PROFILER_DEFAULT_INTERVAL);
+
+	mDebuggerProfilerInit(&m_profiler, m_controller->thread()->core);
+
+	connect(m_ui.start, &QAbstractButton::clicked, this, &ProfilerView::start);
+	connect(m_ui.stop, &QAbstractButton::clicked, this, &ProfilerView::stop);
+	connect(m_ui.save, &QAbstractButton::clicked, this, &ProfilerView::save);
+	connect(this, &ProfilerView::profilingChanged, m_ui.start, &QWidget::setDisabled);
+	connect(this, &ProfilerView::profilingChanged, m_ui.interval, &QWidget::setDisabled);
+	connect(this, &ProfilerView::profilingChanged, m_ui.stop, &QWidget::setEnabled);
+
+	connect(&m_refreshTimer, &QTimer::timeout, this, &ProfilerView::refresh);
+	m_refreshTimer.setInterval(REFRESH_INTERVAL);
+}
+
+ProfilerView::~ProfilerView() {
+	CoreController::Interrupter interrupter(m_controller);
+	mDebuggerProfilerDeinit(&m_profiler);
+}
+
+void ProfilerView::start() {
+	CoreController::Interrupter interrupter(m_controller);
+	mDebuggerProfilerClear(&m_profiler);
+	if (!mDebuggerProfilerStart(&m_profiler, m_ui.interval->value())) {
+		interrupter.resume();
+		QMessageBox::warning(this, tr("Profiler"), tr("Profiling is not supported for this platform."));
+		return;
+	}
+	interrupter.resume();
+
+	m_ui.results->clear();
+	m_ui.save->setEnabled(true);
+	m_refreshTimer.start();
+	emit profilingChanged(true);
+}
+
+void ProfilerView::stop() {
+	CoreController::Interrupter interrupter(m_controller);
+	mDebuggerProfilerStop(&m_profiler);
+	interrupter.resume();
+
+	m_refreshTimer.stop();
+	refresh();
+	emit profilingChanged(false);
+}
+
+void ProfilerView::refresh() {
+	struct mDebuggerProfilerEntry entries[MAX_ENTRIES];
+	CoreController::Interrupter interrupter(m_controller);
+	// Resetting or loading a state drops the sampling event, so put it back if needed
+	mDebuggerProfilerUpdate(&m_profiler);
+	size_t count = mDebuggerProfilerSummarize(&m_profiler, m_controller->thread()->core->symbolTable, entries, MAX_ENTRIES);
+	uint64_t total = m_profiler.samples;
+	interrupter.resume();
+
+	m_ui.samples->setText(tr("%n sample(s)", nullptr, static_cast<int>(total)));
+	m_ui.results->clear();
+	for (size_t i = 0; i < count; ++i) {
+		QTreeWidgetItem* item = new QTreeWidgetItem;
+		item->setText(0, QString("%1%").arg(entries[i].samples * 100.0 / total, 0, 'f', 1));
+		item->setText(1, QString::number(entries[i].samples));
+		item->setText(2, QString::fromUtf8(entries[i].name));
+		m_ui.results->addTopLevelItem(item);
+	}
+}
+
+void ProfilerView::save() {
+	QString filename = GBAApp::app()->getSaveFileName(this, tr("Save profile"), tr("Folded stacks (*.folded *.txt)"));
+	if (filename.isEmpty()) {
+		return;
+	}
+	VFile* vf = VFileDevice::open(filename, O_CREAT | O_TRUNC | O_WRONLY);
+	if (!vf) {
+		return;
+	}
+	CoreController::Interrupter interrupter(m_controller);
+	bool success = mDebuggerProfilerWriteFolded(&m_profiler, m_controller->thread()->core->symbolTable, vf);
+	interrupter.resume();
+	vf->close(vf);
+	if (!success) {
+		QMessageBox::warning(this, tr("Profiler"), tr("Failed to write the profile."));
+	}
+}
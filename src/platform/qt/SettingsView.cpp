@@ -466,6 +466,7 @@ void SettingsView::updateConfig() {
 	saveSetting("sampleRate", m_ui.sampleRate);
 	saveSetting("videoSync", m_ui.videoSync);
 	saveSetting("audioSync", m_ui.audioSync);
+	saveSetting("framePacing", m_ui.framePacing);
 	saveSetting("frameskip", m_ui.frameskip);
 	saveSetting("autofireThreshold", m_ui.autofireThreshold);
 	saveSetting("lockAspectRatio", m_ui.lockAspectRatio);
@@ -473,6 +474,7 @@ void SettingsView::updateConfig() {
 	saveSetting("interframeBlending", m_ui.interframeBlending);
 	saveSetting("showOSD", m_ui.showOSD);
 	saveSetting("showFrameCounter", m_ui.showFrameCounter);
+	saveSetting("showFrameTimings", m_ui.showFrameTimings);
 	saveSetting("showResetInfo", m_ui.showResetInfo);
 	saveSetting("volume", m_ui.volume);
 	saveSetting("mute", m_ui.mute);
@@ -694,6 +696,7 @@ void SettingsView::reloadConfig() {
 	loadSetting("sampleRate", m_ui.sampleRate);
 	loadSetting("videoSync", m_ui.videoSync);
 	loadSetting("audioSync", m_ui.audioSync);
+	loadSetting("framePacing", m_ui.framePacing);
 	loadSetting("frameskip", m_ui.frameskip);
 	loadSetting("fpsTarget", m_ui.fpsTarget);
 	loadSetting("autofireThreshold", m_ui.autofireThreshold);
@@ -702,6 +705,7 @@ void SettingsView::reloadConfig() {
 	loadSetting("interframeBlending", m_ui.interframeBlending);
 	loadSetting("showOSD", m_ui.showOSD, true);
 	loadSetting("showFrameCounter", m_ui.showFrameCounter);
+	loadSetting("showFrameTimings", m_ui.showFrameTimings);
 	loadSetting("showResetInfo", m_ui.showResetInfo);
 	loadSetting("volume", m_ui.volume, 0x100);
 	loadSetting("mute", m_ui.mute, false);
@@ -69,6 +69,24 @@ void TilePainter::setTile(int index, const color_t* data) {
 	update(r);
 }
 
+void TilePainter::setTiles(const QVector<unsigned>& indices, const color_t* data) {
+	if (indices.isEmpty()) {
+		return;
+	}
+	// Draw the whole batch with one painter, as setting one up per tile adds up quickly
+	QPainter painter(&m_backing);
+	int w = width() / m_size;
+	QRegion dirty;
+	for (int i = 0; i < indices.size(); ++i) {
+		int index = indices[i];
+		QRect r(index % w * m_size, index / w * m_size, m_size, m_size);
+		QImage tile(reinterpret_cast<const uchar*>(&data[i * 64]), 8, 8, QImage::Format_ARGB32);
+		painter.drawImage(r, tile.convertToFormat(QImage::Format_RGB32).rgbSwapped());
+		dirty += r;
+	}
+	update(dirty);
+}
+
 void TilePainter::setTileCount(int tiles) {
 	m_tileCount = tiles;
 	if (sizePolicy().horizontalPolicy() != QSizePolicy::Fixed) {
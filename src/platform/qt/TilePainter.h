@@ -24,6 +24,7 @@ public:
 public slots:
 	void clearTile(int index);
 	void setTile(int index, const color_t*);
+	void setTiles(const QVector<unsigned>& indices, const color_t*);
 	void setTileCount(int tiles);
 	void setTileMagnification(int mag);
 
@@ -128,6 +128,7 @@ TileView::TileView(std::shared_ptr<CoreController> controller, QWidget* parent)
 
 #ifdef M_CORE_GBA
 void TileView::updateTilesGBA(bool force) {
+	QVector<TileRange> ranges;
 	if (m_ui.palette256->isChecked()) {
 		if (m_ui.tilesBg->isChecked()) {
 			m_ui.tiles->setTileCount(1024);
@@ -136,30 +137,13 @@ void TileView::updateTilesGBA(bool force) {
 		} else {
 			m_ui.tiles->setTileCount(1536);
 		}
-		mTileCache* cache;
-		int objOffset = 1024;
+		unsigned objOffset = 1024;
 		if (!m_ui.tilesObj->isChecked()) {
 			objOffset = 0;
-			cache = mTileCacheSetGetPointer(&m_cacheSet->tiles, 1);
-			for (int i = 0; i < 1024; ++i) {
-				const color_t* data = mTileCacheGetTileIfDirty(cache, &m_tileStatus[16 * i], i, 0);
-				if (data) {
-					m_ui.tiles->setTile(i, data);
-				} else if (force) {
-					m_ui.tiles->setTile(i, mTileCacheGetTile(cache, i, 0));
-				}
-			}
+			ranges.append({mTileCacheSetGetPointer(&m_cacheSet->tiles, 1), 16, 0, 0, 0, 1024, 0});
 		}
 		if (!m_ui.tilesBg->isChecked()) {
-			cache = mTileCacheSetGetPointer(&m_cacheSet->tiles, 3);
-			for (int i = 1024; i < 1536; ++i) {
-				const color_t* data = mTileCacheGetTileIfDirty(cache, &m_tileStatus[16 * i], i - 1024, 0);
-				if (data) {
-					m_ui.tiles->setTile(i - objOffset, data);
-				} else if (force) {
-					m_ui.tiles->setTile(i - objOffset, mTileCacheGetTile(cache, i - 1024, 0));
-				}
-			}
+			ranges.append({mTileCacheSetGetPointer(&m_cacheSet->tiles, 3), 16, 1024, 1024 - objOffset, 0, 512, 0});
 		}
 	} else {
 		if (m_ui.tilesBg->isChecked()) {
@@ -169,52 +153,57 @@ void TileView::updateTilesGBA(bool force) {
 		} else {
 			m_ui.tiles->setTileCount(3072);
 		}
-		mTileCache* cache;
-		int objOffset = 2048;
+		unsigned objOffset = 2048;
+		unsigned paletteId = m_paletteId;
 		if (!m_ui.tilesObj->isChecked()) {
 			objOffset = 0;
-			cache = mTileCacheSetGetPointer(&m_cacheSet->tiles, 0);
-			for (int i = 0; i < 2048; ++i) {
-				const color_t* data = mTileCacheGetTileIfDirty(cache, &m_tileStatus[16 * i], i, m_paletteId);
-				if (data) {
-					m_ui.tiles->setTile(i, data);
-				} else if (force) {
-					m_ui.tiles->setTile(i, mTileCacheGetTile(cache, i, m_paletteId));
-				}
-			}
+			ranges.append({mTileCacheSetGetPointer(&m_cacheSet->tiles, 0), 16, 0, 0, 0, 2048, paletteId});
 		}
 		if (!m_ui.tilesBg->isChecked()) {
-			cache = mTileCacheSetGetPointer(&m_cacheSet->tiles, 2);
-			for (int i = 2048; i < 3072; ++i) {
-				const color_t* data = mTileCacheGetTileIfDirty(cache, &m_tileStatus[16 * i], i - 2048, m_paletteId);
-				if (data) {
-					m_ui.tiles->setTile(i - objOffset, data);
-				} else if (force) {
-					m_ui.tiles->setTile(i - objOffset, mTileCacheGetTile(cache, i - 2048, m_paletteId));
-				}
-			}
+			ranges.append({mTileCacheSetGetPointer(&m_cacheSet->tiles, 2), 16, 2048, 2048 - objOffset, 0, 1024, paletteId});
 		}
 	}
+	updateTileRanges(ranges, force);
 }
 #endif
 
 #ifdef M_CORE_GB
 void TileView::updateTilesGB(bool force) {
 	const GB* gb = static_cast<const GB*>(m_controller->thread()->core->board);
-	int count = gb->model >= GB_MODEL_CGB ? 1024 : 512;
+	unsigned count = gb->model >= GB_MODEL_CGB ? 1024 : 512;
 	m_ui.tiles->setTileCount(count);
-	mTileCache* cache = mTileCacheSetGetPointer(&m_cacheSet->tiles, 0);
-	for (int i = 0; i < count; ++i) {
-		const color_t* data = mTileCacheGetTileIfDirty(cache, &m_tileStatus[8 * i], i, m_paletteId);
-		if (data) {
-			m_ui.tiles->setTile(i, data);
-		} else if (force) {
-			m_ui.tiles->setTile(i, mTileCacheGetTile(cache, i, m_paletteId));
-		}
-	}
+	QVector<TileRange> ranges;
+	ranges.append({mTileCacheSetGetPointer(&m_cacheSet->tiles, 0), 8, 0, 0, 0, count, static_cast<unsigned>(m_paletteId)});
+	updateTileRanges(ranges, force);
 }
 #endif
 
+void TileView::updateTileRanges(const QVector<TileRange>& ranges, bool force) {
+	struct TileBatch {
+		QVector<unsigned> indices;
+		QVector<color_t> pixels;
+	};
+	std::shared_ptr<QVector<mTileCacheEntry>> status = m_tileStatus;
+	auto batch = std::make_shared<TileBatch>();
+	submitCacheJob([ranges, status, batch, force]() {
+		for (const TileRange& range : ranges) {
+			int offset = batch->indices.size();
+			batch->indices.resize(offset + range.count);
+			batch->pixels.resize((offset + range.count) * 64);
+			size_t copied = mTileCacheCopyDirtyTiles(range.cache, &(*status)[range.entryIndex * range.entryStride], range.entryStride,
+			                                         range.start, range.count, range.paletteId, force,
+			                                         &batch->indices[offset], &batch->pixels[offset * 64]);
+			for (size_t i = 0; i < copied; ++i) {
+				batch->indices[offset + i] = batch->indices[offset + i] - range.start + range.displayIndex;
+			}
+			batch->indices.resize(offset + copied);
+			batch->pixels.resize((offset + copied) * 64);
+		}
+	}, [this, batch]() {
+		m_ui.tiles->setTiles(batch->indices, batch->pixels.constData());
+	});
+}
+
 void TileView::updatePalette(int palette) {
 	m_paletteId = palette;
 	m_ui.tile->setPalette(palette);
@@ -228,7 +217,7 @@ void TileView::exportTiles() {
 		return;
 	}
 	CoreController::Interrupter interrupter(m_controller);
-	updateTiles(false);
+	flushTiles();
 	QPixmap pixmap(m_ui.tiles->backing());
 	pixmap.save(filename, "PNG");
 }
@@ -240,19 +229,19 @@ void TileView::exportTile() {
 		return;
 	}
 	CoreController::Interrupter interrupter(m_controller);
-	updateTiles(false);
+	flushTiles();
 	QImage image(m_ui.tile->activeTile());
 	image.save(filename, "PNG");
 }
 
 void TileView::copyTiles() {
 	CoreController::Interrupter interrupter(m_controller);
-	updateTiles(false);
+	flushTiles();
 	GBAApp::app()->clipboard()->setPixmap(m_ui.tiles->backing());
 }
 
 void TileView::copyTile() {
 	CoreController::Interrupter interrupter(m_controller);
-	updateTiles(false);
+	flushTiles();
 	GBAApp::app()->clipboard()->setImage(m_ui.tile->activeTile());
 }
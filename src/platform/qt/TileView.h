@@ -29,17 +29,29 @@ public slots:
 	void copyTile();
 
 private:
+	struct TileRange {
+		mTileCache* cache;
+		int entryStride;
+		int entryIndex;
+		unsigned displayIndex;
+		unsigned start;
+		unsigned count;
+		unsigned paletteId;
+	};
+
 #ifdef M_CORE_GBA
 	void updateTilesGBA(bool force) override;
 #endif
 #ifdef M_CORE_GB
 	void updateTilesGB(bool force) override;
 #endif
+	void updateTileRanges(const QVector<TileRange>& ranges, bool force);
 
 	Ui::TileView m_ui;
 
 	std::shared_ptr<CoreController> m_controller;
-	mTileCacheEntry m_tileStatus[3072 * 32] = {}; // TODO: Correct size
+	// Shared with the worker jobs that regenerate tiles
+	std::shared_ptr<QVector<mTileCacheEntry>> m_tileStatus = std::make_shared<QVector<mTileCacheEntry>>(3072 * 32); // TODO: Correct size
 	int m_paletteId = 0;
 };
 
@@ -11,6 +11,7 @@
 #include <QMessageBox>
 #include <QMimeData>
 #include <QPainter>
+#include <QProgressDialog>
 #include <QScreen>
 #include <QWindow>
 
@@ -52,6 +53,7 @@
 #include "PaletteView.h"
 #include "PlacementControl.h"
 #include "PrinterView.h"
+#include "ProfilerView.h"
 #include "ReportView.h"
 #include "ROMInfo.h"
 #include "SaveConverter.h"
@@ -144,7 +146,7 @@ Window::Window(CoreManager* manager, ConfigController* config, int playerId, QWi
 		VFile* output = m_libraryView->selectedVFile();
 		if (output) {
 			QPair<QString, QString> path = m_libraryView->selectedPath();
-			setController(m_manager->loadGame(output, path.second, path.first), path.first + "/" + path.second);
+			loadGame(output, path.second, path.first);
 		}
 	});
 #endif
@@ -237,7 +239,7 @@ void Window::argumentsPassed() {
 	}
 
 	if (args->fname) {
-		setController(m_manager->loadGame(args->fname), args->fname);
+		loadGame(args->fname);
 	}
 
 	if (m_config->graphicsOpts()->fullscreen) {
@@ -332,10 +334,61 @@ QString Window::getFiltersArchive() const {
 	return filters.join(";;");
 }
 
+void Window::loadGame(const QString& path) {
+	showLoadProgress(m_manager->loadGameAsync(path, this, [this, path](CoreController* controller) {
+		setController(controller, path);
+	}));
+}
+
+void Window::loadGame(VFile* vf, const QString& path, const QString& base) {
+	QString fname = base + "/" + path;
+	showLoadProgress(m_manager->loadGameAsync(vf, path, base, this, [this, fname](CoreController* controller) {
+		setController(controller, fname);
+	}));
+}
+
+void Window::showLoadProgress(std::shared_ptr<CoreManager::LoadProgress> progress) {
+	// Most loads finish before the minimum duration is up, so this only shows up for slow ones
+	QProgressDialog* dialog = new QProgressDialog(tr("Opening game..."), tr("Cancel"), 0, 0, this);
+	dialog->setAttribute(Qt::WA_DeleteOnClose);
+	dialog->setAutoClose(false);
+	dialog->setAutoReset(false);
+	dialog->setMinimumDuration(500);
+	connect(dialog, &QProgressDialog::canceled, [progress]() {
+		progress->cancelled.storeRelease(1);
+	});
+
+	QTimer* timer = new QTimer(dialog);
+	timer->setInterval(50);
+	connect(timer, &QTimer::timeout, dialog, [dialog, progress]() {
+		switch (progress->stage.loadAcquire()) {
+		case CoreManager::LOAD_OPENING:
+			break;
+		case CoreManager::LOAD_READING:
+			dialog->setLabelText(tr("Reading game..."));
+			dialog->setRange(0, 1000);
+			dialog->setValue(progress->permille.loadAcquire());
+			break;
+		case CoreManager::LOAD_SAVE:
+			dialog->setLabelText(tr("Loading save..."));
+			dialog->setRange(0, 0);
+			break;
+		case CoreManager::LOAD_PATCH:
+			dialog->setLabelText(tr("Applying patches..."));
+			dialog->setRange(0, 0);
+			break;
+		case CoreManager::LOAD_DONE:
+			dialog->close();
+			break;
+		}
+	});
+	timer->start();
+}
+
 void Window::selectROM() {
 	QString filename = GBAApp::app()->getOpenFileName(this, tr("Select ROM"), romFilters(true));
 	if (!filename.isEmpty()) {
-		setController(m_manager->loadGame(filename), filename);
+		loadGame(filename);
 	}
 }
 
@@ -358,7 +411,7 @@ void Window::selectROMInArchive() {
 		VFile* output = archiveInspector->selectedVFile();
 		QPair<QString, QString> path = archiveInspector->selectedPath();
 		if (output) {
-			setController(m_manager->loadGame(output, path.second, path.first), path.first + "/" + path.second);
+			loadGame(output, path.second, path.first);
 		}
 		archiveInspector->close();
 	});
@@ -558,6 +611,13 @@ void Window::startVideoLog() {
 	}
 }
 
+void Window::startRenderLog() {
+	QString filename = GBAApp::app()->getSaveFileName(this, tr("Select video log"), tr("Video logs (*.mvl)"));
+	if (!filename.isEmpty()) {
+		m_controller->startVideoLog(filename, true, true);
+	}
+}
+
 template <typename T, typename... A>
 std::function<void()> Window::openTView(A... arg) {
 	return [=]() {
@@ -813,7 +873,7 @@ void Window::dropEvent(QDropEvent* event) {
 		return;
 	}
 	event->accept();
-	setController(m_manager->loadGame(url.toLocalFile()), url.toLocalFile());
+	loadGame(url.toLocalFile());
 }
 
 void Window::enterFullScreen() {
@@ -1634,6 +1694,10 @@ void Window::setupMenu(QMenuBar* menubar) {
 	addGameAction(tr("Record A/V..."), "recordOutput", openNamedControllerTView<VideoView>(&m_videoView), "av");
 	addGameAction(tr("Record GIF/WebP/APNG..."), "recordGIF", openNamedControllerTView<GIFView>(&m_gifView), "av");
 #endif
+	addGameAction(tr("Record for later rendering..."), "recordRenderLog", this, &Window::startRenderLog, "av");
+	addGameAction(tr("Stop recording for later rendering"), "stopRenderLog", [this]() {
+		m_controller->endVideoLog();
+	}, "av");
 
 	m_actions.addSeparator("av");
 	m_actions.addMenu(tr("Video layers"), "videoLayers", "av");
@@ -1709,6 +1773,7 @@ void Window::setupMenu(QMenuBar* menubar) {
 
 #ifdef USE_DEBUGGERS
 	addGameAction(tr("Log memory &accesses..."), "memoryAccessView", openControllerTView<MemoryAccessLogView>(), "tools");
+	addGameAction(tr("&Profile..."), "profilerView", openControllerTView<ProfilerView>(), "tools");
 #endif
 
 #if defined(USE_FFMPEG) && defined(M_CORE_GBA)
@@ -1801,6 +1866,11 @@ void Window::setupOptions() {
 		reloadConfig();
 	}, this);
 
+	ConfigOption* framePacing = m_config->addOption("framePacing");
+	framePacing->connect([this](const QVariant&) {
+		reloadConfig();
+	}, this);
+
 	ConfigOption* skipBios = m_config->addOption("skipBios");
 	skipBios->connect([this](const QVariant&) {
 		reloadConfig();
@@ -1851,6 +1921,16 @@ void Window::setupOptions() {
 		reloadConfig();
 	}, this);
 
+	ConfigOption* rewindBufferMemory = m_config->addOption("rewindBufferMemory");
+	rewindBufferMemory->connect([this](const QVariant&) {
+		reloadConfig();
+	}, this);
+
+	ConfigOption* rewindSpeed = m_config->addOption("rewindSpeed");
+	rewindSpeed->connect([this](const QVariant&) {
+		reloadConfig();
+	}, this);
+
 	ConfigOption* allowOpposingDirections = m_config->addOption("allowOpposingDirections");
 	allowOpposingDirections->connect([this](const QVariant&) {
 		reloadConfig();
@@ -1897,6 +1977,13 @@ void Window::setupOptions() {
 		}
 	}, this);
 
+	ConfigOption* showFrameTimings = m_config->addOption("showFrameTimings");
+	showFrameTimings->connect([this](const QVariant& value) {
+		if (m_display) {
+			m_display->showFrameTimings(value.toBool());
+		}
+	}, this);
+
 	ConfigOption* showResetInfo = m_config->addOption("showResetInfo");
 	showResetInfo->connect([this](const QVariant& value) {
 		if (m_controller) {
@@ -1962,7 +2049,7 @@ void Window::updateMRU() {
 	for (const QString& file : m_mruFiles) {
 		QString displayName(QDir::toNativeSeparators(file).replace("&", "&&"));
 		m_actions.addAction(displayName, QString("mru.%1").arg(QString::number(i)), [this, file]() {
-			setController(m_manager->loadGame(file), file);
+			loadGame(file);
 		}, "mru", QString("Ctrl+%1").arg(i));
 		++i;
 	}
@@ -2165,6 +2252,7 @@ void Window::setController(CoreController* controller, const QString& fname) {
 	m_controller->loadConfig(m_config);
 	m_config->updateOption("showOSD");
 	m_config->updateOption("showFrameCounter");
+	m_config->updateOption("showFrameTimings");
 	m_config->updateOption("showResetInfo");
 	m_controller->start();
 
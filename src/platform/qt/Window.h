@@ -19,6 +19,7 @@
 #include <mgba/core/thread.h>
 
 #include "ActionMapper.h"
+#include "CoreManager.h"
 #include "InputController.h"
 #include "LoadSaveState.h"
 #include "LogController.h"
@@ -32,7 +33,6 @@ namespace QGBA {
 class AudioProcessor;
 class ConfigController;
 class CoreController;
-class CoreManager;
 class DebuggerConsoleController;
 class Display;
 class DolphinConnector;
@@ -76,6 +76,8 @@ signals:
 
 public slots:
 	void setController(CoreController* controller, const QString& fname);
+	void loadGame(const QString& path);
+	void loadGame(VFile* vf, const QString& path, const QString& base);
 	void selectROM();
 	void bootBIOS();
 #ifdef USE_SQLITE3
@@ -107,6 +109,7 @@ public slots:
 	void openSettingsWindow(SettingsView::Page);
 
 	void startVideoLog();
+	void startRenderLog();
 
 #ifdef USE_DEBUGGERS
 	void consoleOpen();
@@ -163,6 +166,7 @@ private:
 
 	void setupMenu(QMenuBar*);
 	void setupOptions();
+	void showLoadProgress(std::shared_ptr<CoreManager::LoadProgress>);
 	void openStateWindow(LoadSave);
 
 	void attachWidget(QWidget* widget);
@@ -177,11 +177,15 @@ void mSDLGLCommonRunloop(struct mSDLRenderer* renderer, void* user) {
 			v->setLayerDimensions(v, VIDEO_LAYER_IMAGE, &dims);
 		}
 
-		if (mCoreSyncWaitFrameStart(&context->impl->sync)) {
+		bool newFrame = mCoreSyncWaitFrameStart(&context->impl->sync);
+		if (newFrame) {
 			v->setImage(v, VIDEO_LAYER_IMAGE, renderer->outputBuffer);
 		}
 		mCoreSyncWaitFrameEnd(&context->impl->sync);
 		v->drawFrame(v);
 		v->swap(v);
+		if (newFrame) {
+			mCoreThreadFramePresented(context);
+		}
 	}
 }
@@ -18,11 +18,14 @@
 #include <mgba/core/core.h>
 #include <mgba/core/config.h>
 #include <mgba/core/input.h>
+#include <mgba/core/perf.h>
 #include <mgba/core/serialize.h>
 #include <mgba/core/thread.h>
 #include <mgba/internal/gba/input.h>
 
 #include <mgba/feature/commandline.h>
+#include <mgba/feature/frame-server.h>
+#include <mgba-util/threading.h>
 #include <mgba-util/vfs.h>
 
 #include <SDL.h>
@@ -44,6 +47,15 @@ static void _loadState(struct mCoreThread* thread) {
 	mCoreLoadStateNamed(thread->core, _state, SAVESTATE_RTC);
 }
 
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _openAudio(void* context) {
+	ThreadSetName("Audio Open");
+	mSDLOpenAudio(context);
+	mStartupTraceMark("Open audio device");
+	THREAD_EXIT(0);
+}
+#endif
+
 int main(int argc, char** argv) {
 #ifdef _WIN32
 	AttachConsole(ATTACH_PARENT_PROCESS);
@@ -88,6 +100,7 @@ int main(int argc, char** argv) {
 		mArgumentsDeinit(&args);
 		return 1;
 	}
+	mStartupTraceMark("Initialize SDL");
 
 	renderer.core = mCoreFind(args.fname);
 	if (!renderer.core) {
@@ -116,6 +129,7 @@ int main(int argc, char** argv) {
 	mCoreConfigSetDefaultIntValue(&renderer.core->config, "logToStdout", true);
 	mCoreConfigLoadDefaults(&renderer.core->config, &opts);
 	mCoreLoadConfig(renderer.core);
+	mStartupTraceMark("Create core");
 
 	renderer.viewportWidth = renderer.core->opts.width;
 	renderer.viewportHeight = renderer.core->opts.height;
@@ -125,6 +139,7 @@ int main(int argc, char** argv) {
 	renderer.lockAspectRatio = renderer.core->opts.lockAspectRatio;
 	renderer.lockIntegerScaling = renderer.core->opts.lockIntegerScaling;
 	renderer.interframeBlending = renderer.core->opts.interframeBlending;
+	mCoreConfigGetBoolValue(&renderer.core->config, "colorCorrection", &renderer.colorCorrection);
 	renderer.filter = renderer.core->opts.resampleVideo;
 
 #ifdef BUILD_GL
@@ -151,6 +166,7 @@ int main(int argc, char** argv) {
 		renderer.core->deinit(renderer.core);
 		return 1;
 	}
+	mStartupTraceMark("Create renderer");
 
 	renderer.player.bindings = &renderer.core->inputMap;
 	mSDLInitBindingsGBA(&renderer.core->inputMap);
@@ -206,19 +222,28 @@ int mSDLRun(struct mSDLRenderer* renderer, struct mArguments* args) {
 	struct mCoreThread thread = {
 		.core = renderer->core
 	};
+
+	// Opening the audio device can take a while, and doesn't depend on anything but the config
+	renderer->audio.samples = renderer->core->opts.audioBuffers;
+	renderer->audio.sampleRate = 44100;
+#ifndef DISABLE_THREADING
+	Thread audioThread;
+	ThreadCreate(&audioThread, _openAudio, &renderer->audio);
+#endif
+
 	if (!mCoreLoadFile(renderer->core, args->fname)) {
+#ifndef DISABLE_THREADING
+		ThreadJoin(&audioThread);
+#endif
 		return 1;
 	}
+	mStartupTraceMark("Load ROM");
 	mCoreAutoloadSave(renderer->core);
 	mArgumentsApplyFileLoads(args, renderer->core);
+	mStartupTraceMark("Load save and patches");
 #ifdef ENABLE_SCRIPTING
-	struct mScriptBridge* bridge = mScriptBridgeCreate();
-#ifdef ENABLE_PYTHON
-	mPythonSetup(bridge);
-#endif
-#ifdef USE_DEBUGGERS
-	CLIDebuggerScriptEngineInstall(bridge);
-#endif
+	// The debugger is the only thing here that uses scripting, and setting it up isn't free
+	struct mScriptBridge* bridge = NULL;
 #endif
 
 #ifdef USE_DEBUGGERS
@@ -230,6 +255,11 @@ int mSDLRun(struct mSDLRenderer* renderer, struct mArguments* args) {
 		mDebuggerAttach(&debugger, renderer->core);
 		mDebuggerEnter(&debugger, DEBUGGER_ENTER_MANUAL, NULL);
 #ifdef ENABLE_SCRIPTING
+		bridge = mScriptBridgeCreate();
+#ifdef ENABLE_PYTHON
+		mPythonSetup(bridge);
+#endif
+		CLIDebuggerScriptEngineInstall(bridge);
 		mScriptBridgeSetDebugger(bridge, &debugger);
 #endif
 	} else {
@@ -237,11 +267,27 @@ int mSDLRun(struct mSDLRenderer* renderer, struct mArguments* args) {
 	}
 #endif
 
-	renderer->audio.samples = renderer->core->opts.audioBuffers;
-	renderer->audio.sampleRate = 44100;
+	// Other processes can read frames straight out of shared memory, e.g. with -C frameServer=mgba
+	struct mFrameServer frameServer;
+	mFrameServerInit(&frameServer);
+	const char* frameServerName = mCoreConfigGetValue(&renderer->core->config, "frameServer");
+	if (frameServerName) {
+		unsigned width, height;
+		renderer->core->baseVideoSize(renderer->core, &width, &height);
+		if (mFrameServerOpen(&frameServer, frameServerName, width, height)) {
+			renderer->core->setAVStream(renderer->core, &frameServer.d);
+		} else {
+			printf("Could not open frame server %s\n", frameServerName);
+		}
+	}
+
 	thread.logger.logger = &_logger.d;
 
 	bool didFail = !mCoreThreadStart(&thread);
+	mStartupTraceMark("Start core thread");
+#ifndef DISABLE_THREADING
+	ThreadJoin(&audioThread);
+#endif
 
 	if (!didFail) {
 #if SDL_VERSION_ATLEAST(2, 0, 0)
@@ -285,10 +331,16 @@ int mSDLRun(struct mSDLRenderer* renderer, struct mArguments* args) {
 	} else {
 		printf("Could not run game. Are you sure the file exists and is a compatible game?\n");
 	}
+	if (mFrameServerIsOpen(&frameServer)) {
+		renderer->core->setAVStream(renderer->core, NULL);
+		mFrameServerClose(&frameServer);
+	}
 	renderer->core->unloadROM(renderer->core);
 
 #ifdef ENABLE_SCRIPTING
-	mScriptBridgeDestroy(bridge);
+	if (bridge) {
+		mScriptBridgeDestroy(bridge);
+	}
 #endif
 
 #ifdef USE_DEBUGGERS
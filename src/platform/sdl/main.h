@@ -13,6 +13,8 @@ CXX_GUARD_START
 #include "sdl-audio.h"
 #include "sdl-events.h"
 
+#include <mgba-util/image/post-process.h>
+
 #ifdef BUILD_GL
 #include "gl-common.h"
 #include "platform/opengl/gl.h"
@@ -67,8 +69,14 @@ struct mSDLRenderer {
 	bool lockAspectRatio;
 	bool lockIntegerScaling;
 	bool interframeBlending;
+	bool colorCorrection;
 	bool filter;
 
+	// Used by the software renderer, which has no shaders to do this in. The core draws into
+	// postProcessBuffer instead, and the processed frame goes to outputBuffer.
+	struct mPostProcess postProcess;
+	color_t* postProcessBuffer;
+
 #ifdef BUILD_GL
 	struct mGLContext gl;
 #endif
@@ -6,6 +6,7 @@
 #include "sdl-audio.h"
 
 #include <mgba/core/core.h>
+#include <mgba/core/interface.h>
 #include <mgba/core/thread.h>
 #include <mgba/internal/gba/audio.h>
 #include <mgba/internal/gba/gba.h>
@@ -18,7 +19,31 @@ mLOG_DEFINE_CATEGORY(SDL_AUDIO, "SDL Audio", "platform.sdl.audio");
 
 static void _mSDLAudioCallback(void* context, Uint8* data, int len);
 
-bool mSDLInitAudio(struct mSDLAudio* context, struct mCoreThread* threadContext) {
+static double _mSDLAudioRate(const struct mSDLAudio* context) {
+	double fauxClock = 1;
+	if (context->sync && context->sync->fpsTarget > 0) {
+		fauxClock = GBAAudioCalculateRatio(1, context->sync->fpsTarget, 1);
+	}
+	return context->obtainedSpec.freq * fauxClock;
+}
+
+static void _mSDLAudioSetRate(struct mSDLAudio* context, double rate) {
+	int32_t clockRate = context->core->frequency(context->core);
+	double blipRate = rate;
+	if (context->resampler.kernel) {
+		// The core's buffers stay at its native rate and the resampler takes it from there
+		blipRate = context->core->audioSampleRate(context->core);
+		mAudioResamplerSetRates(&context->resampler, blipRate, rate);
+	}
+	blip_set_rates(context->core->getAudioChannel(context->core, 0), clockRate, blipRate);
+	blip_set_rates(context->core->getAudioChannel(context->core, 1), clockRate, blipRate);
+	context->rate = rate;
+}
+
+bool mSDLOpenAudio(struct mSDLAudio* context) {
+	if (context->deviceOpen) {
+		return true;
+	}
 #if defined(_WIN32) && SDL_VERSION_ATLEAST(2, 0, 8)
 	if (!getenv("SDL_AUDIODRIVER")) {
 		_putenv_s("SDL_AUDIODRIVER", "directsound");
@@ -43,6 +68,15 @@ bool mSDLInitAudio(struct mSDLAudio* context, struct mCoreThread* threadContext)
 	if (SDL_OpenAudio(&context->desiredSpec, &context->obtainedSpec) < 0) {
 #endif
 		mLOG(SDL_AUDIO, ERROR, "Could not open SDL sound system");
+		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		return false;
+	}
+	context->deviceOpen = true;
+	return true;
+}
+
+bool mSDLInitAudio(struct mSDLAudio* context, struct mCoreThread* threadContext) {
+	if (!mSDLOpenAudio(context)) {
 		return false;
 	}
 	context->core = 0;
@@ -51,6 +85,23 @@ bool mSDLInitAudio(struct mSDLAudio* context, struct mCoreThread* threadContext)
 		context->core = threadContext->core;
 		context->sync = &threadContext->impl->sync;
 
+		// Samples are handed over through a ring so the callback never waits on the emulation thread
+		if (!context->ring.data) {
+			RingFIFOInit(&context->ring, context->obtainedSpec.samples * 2 * sizeof(struct mStereoSample));
+		}
+		RingFIFOClear(&context->ring);
+		if (context->core->opts.audioResampler && context->core->audioSampleRate && !context->resampler.kernel) {
+			mAudioResamplerInit(&context->resampler, context->core->opts.audioResampler, context->obtainedSpec.samples);
+		}
+		if (context->resampler.kernel) {
+			mAudioResamplerClear(&context->resampler);
+		}
+		mCoreSyncLockAudio(context->sync);
+		_mSDLAudioSetRate(context, _mSDLAudioRate(context));
+		context->sync->audioRing = &context->ring;
+		context->sync->audioResampler = context->resampler.kernel ? &context->resampler : NULL;
+		mCoreSyncUnlockAudio(context->sync);
+
 #if SDL_VERSION_ATLEAST(2, 0, 0)
 		SDL_PauseAudioDevice(context->deviceId, 0);
 #else
@@ -62,15 +113,23 @@ bool mSDLInitAudio(struct mSDLAudio* context, struct mCoreThread* threadContext)
 }
 
 void mSDLDeinitAudio(struct mSDLAudio* context) {
-	UNUSED(context);
+	if (context->deviceOpen) {
 #if SDL_VERSION_ATLEAST(2, 0, 0)
-	SDL_PauseAudioDevice(context->deviceId, 1);
-	SDL_CloseAudioDevice(context->deviceId);
+		SDL_PauseAudioDevice(context->deviceId, 1);
+		SDL_CloseAudioDevice(context->deviceId);
 #else
-	SDL_PauseAudio(1);
-	SDL_CloseAudio();
+		SDL_PauseAudio(1);
+		SDL_CloseAudio();
 #endif
-	SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		context->deviceOpen = false;
+	}
+	if (context->ring.data) {
+		RingFIFODeinit(&context->ring);
+	}
+	if (context->resampler.kernel) {
+		mAudioResamplerDeinit(&context->resampler);
+	}
 }
 
 void mSDLPauseAudio(struct mSDLAudio* context) {
@@ -93,41 +152,43 @@ void mSDLResumeAudio(struct mSDLAudio* context) {
 
 static void _mSDLAudioCallback(void* context, Uint8* data, int len) {
 	struct mSDLAudio* audioContext = context;
-	if (!context || !audioContext->core) {
+	if (!context || !audioContext->core || !audioContext->sync) {
 		memset(data, 0, len);
 		return;
 	}
-	blip_t* left = NULL;
-	blip_t* right = NULL;
-	int32_t clockRate = GBA_ARM7TDMI_FREQUENCY;
-	if (audioContext->core) {
-		left = audioContext->core->getAudioChannel(audioContext->core, 0);
-		right = audioContext->core->getAudioChannel(audioContext->core, 1);
-		clockRate = audioContext->core->frequency(audioContext->core);
+	double rate = mCoreSyncAdjustAudioRate(audioContext->sync, _mSDLAudioRate(audioContext),
+	                                       RingFIFOSize(&audioContext->ring), RingFIFOCapacity(&audioContext->ring));
+	// Changing rates touches the core's buffers, but it's rare enough to put off while the core is busy
+	if (rate != audioContext->rate && !MutexTryLock(&audioContext->sync->audioBufferMutex)) {
+		_mSDLAudioSetRate(audioContext, rate);
+		MutexUnlock(&audioContext->sync->audioBufferMutex);
 	}
-	double fauxClock = 1;
-	if (audioContext->sync) {
-		if (audioContext->sync->fpsTarget > 0) {
-			fauxClock = GBAAudioCalculateRatio(1, audioContext->sync->fpsTarget, 1);
+
+	int channels = audioContext->obtainedSpec.channels;
+	size_t frames = len / (2 * channels);
+	size_t available;
+	if (channels == 2) {
+		available = mCoreSyncReadAudio(audioContext->sync, (struct mStereoSample*) data, frames);
+	} else {
+		struct mStereoSample samples[256];
+		size_t count = 0;
+		for (available = 0; available < frames; available += count) {
+			count = frames - available;
+			if (count > sizeof(samples) / sizeof(*samples)) {
+				count = sizeof(samples) / sizeof(*samples);
+			}
+			count = mCoreSyncReadAudio(audioContext->sync, samples, count);
+			if (!count) {
+				break;
+			}
+			size_t i;
+			for (i = 0; i < count; ++i) {
+				((short*) data)[available + i] = samples[i].left;
+			}
 		}
-		mCoreSyncLockAudio(audioContext->sync);
-	}
-	blip_set_rates(left, clockRate, audioContext->obtainedSpec.freq * fauxClock);
-	blip_set_rates(right, clockRate, audioContext->obtainedSpec.freq * fauxClock);
-	len /= 2 * audioContext->obtainedSpec.channels;
-	int available = blip_samples_avail(left);
-	if (available > len) {
-		available = len;
-	}
-	blip_read_samples(left, (short*) data, available, audioContext->obtainedSpec.channels == 2);
-	if (audioContext->obtainedSpec.channels == 2) {
-		blip_read_samples(right, ((short*) data) + 1, available, 1);
 	}
 
-	if (audioContext->sync) {
-		mCoreSyncConsumeAudio(audioContext->sync);
-	}
-	if (available < len) {
-		memset(((short*) data) + audioContext->obtainedSpec.channels * available, 0, (len - available) * audioContext->obtainedSpec.channels * sizeof(short));
+	if (available < frames) {
+		memset(((short*) data) + channels * available, 0, (frames - available) * channels * sizeof(short));
 	}
 }
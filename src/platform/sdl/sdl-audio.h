@@ -10,7 +10,9 @@
 
 CXX_GUARD_START
 
+#include <mgba/core/audio-resampler.h>
 #include <mgba/core/log.h>
+#include <mgba-util/ring-fifo.h>
 
 #include <SDL.h>
 // Altivec sometimes defines this
@@ -35,12 +37,19 @@ struct mSDLAudio {
 #if SDL_VERSION_ATLEAST(2, 0, 0)
 	SDL_AudioDeviceID deviceId;
 #endif
+	bool deviceOpen;
 
 	struct mCore* core;
 	struct mCoreSync* sync;
+	struct RingFIFO ring;
+	struct mAudioResampler resampler;
+	double rate;
 };
 
 struct mCoreThread;
+// Opens the device without touching the core, so it can be done while the core is still starting.
+// The device stays paused until mSDLInitAudio, which opens it itself if this hasn't been called.
+bool mSDLOpenAudio(struct mSDLAudio* context);
 bool mSDLInitAudio(struct mSDLAudio* context, struct mCoreThread*);
 void mSDLDeinitAudio(struct mSDLAudio* context);
 void mSDLPauseAudio(struct mSDLAudio* context);
@@ -461,6 +461,21 @@ static void _pauseAfterFrame(struct mCoreThread* context) {
 	mCoreThreadPauseFromThread(context);
 }
 
+static void _mSDLLogFrameTimings(struct mCoreThread* context) {
+	struct mCoreFrameTiming timings[mCORE_THREAD_FRAME_TIMINGS];
+	size_t count = mCoreThreadGetFrameTimings(context, timings, mCORE_THREAD_FRAME_TIMINGS);
+	if (!count) {
+		return;
+	}
+	struct mCoreFrameTiming mean;
+	struct mCoreFrameTiming worst;
+	mCoreFrameTimingSummarize(timings, count, &mean, &worst);
+	mLOG(SDL_EVENTS, INFO, "Last %" PRIz "u frames (avg/max ms): frame %.2f/%.2f, emulation %.2f/%.2f, video wait %.2f/%.2f, audio wait %.2f/%.2f, present %.2f/%.2f",
+	     count, mean.frameNsec / 1e6, worst.frameNsec / 1e6, mean.emulationNsec / 1e6, worst.emulationNsec / 1e6,
+	     mean.videoWaitNsec / 1e6, worst.videoWaitNsec / 1e6, mean.audioWaitNsec / 1e6, worst.audioWaitNsec / 1e6,
+	     mean.presentNsec / 1e6, worst.presentNsec / 1e6);
+}
+
 static void _mSDLHandleKeypress(struct mCoreThread* context, struct mSDLPlayer* sdlContext, const struct SDL_KeyboardEvent* event) {
 	int key = -1;
 	if (!(event->keysym.mod & ~(KMOD_NUM | KMOD_CAPS))) {
@@ -528,6 +543,9 @@ static void _mSDLHandleKeypress(struct mCoreThread* context, struct mSDLPlayer*
 				case SDLK_r:
 					mCoreThreadReset(context);
 					break;
+				case SDLK_t:
+					_mSDLLogFrameTimings(context);
+					break;
 				default:
 					break;
 				}
@@ -74,7 +74,8 @@ void mSDLSWRunloop(struct mSDLRenderer* renderer, void* user) {
 			mSDLHandleEvent(context, &renderer->player, &event);
 		}
 
-		if (mCoreSyncWaitFrameStart(&context->impl->sync)) {
+		bool newFrame = mCoreSyncWaitFrameStart(&context->impl->sync);
+		if (newFrame) {
 #ifdef USE_PIXMAN
 			if (renderer->ratio > 1) {
 				pixman_image_composite32(PIXMAN_OP_SRC, renderer->pix, 0, renderer->screenpix,
@@ -91,6 +92,9 @@ void mSDLSWRunloop(struct mSDLRenderer* renderer, void* user) {
 			SDL_LockSurface(surface);
 		}
 		mCoreSyncWaitFrameEnd(&context->impl->sync);
+		if (newFrame) {
+			mCoreThreadFramePresented(context);
+		}
 	}
 }
 
@@ -8,6 +8,7 @@
 #include <mgba/core/core.h>
 #include <mgba/core/thread.h>
 #include <mgba/core/version.h>
+#include <mgba-util/image/post-process.h>
 
 static bool mSDLSWInit(struct mSDLRenderer* renderer);
 static void mSDLSWRunloop(struct mSDLRenderer* renderer, void* user);
@@ -36,9 +37,27 @@ bool mSDLSWInit(struct mSDLRenderer* renderer) {
 	renderer->sdlTex = SDL_CreateTexture(renderer->sdlRenderer, SDL_PIXELFORMAT_ABGR8888, SDL_TEXTUREACCESS_STREAMING, width, height);
 #endif
 
-	int stride;
-	SDL_LockTexture(renderer->sdlTex, 0, (void**) &renderer->outputBuffer, &stride);
-	renderer->core->setVideoBuffer(renderer->core, renderer->outputBuffer, stride / BYTES_PER_PIXEL);
+	mPostProcessInit(&renderer->postProcess);
+	mPostProcessSetDimensions(&renderer->postProcess, width, height);
+	mPostProcessSetInterframeBlending(&renderer->postProcess, renderer->interframeBlending);
+	if (renderer->colorCorrection) {
+		if (renderer->core->platform(renderer->core) == mPLATFORM_GBA) {
+			mPostProcessSetColorCorrection(&renderer->postProcess, &mCOLOR_CORRECTION_GBA);
+		} else {
+			mPostProcessSetColorCorrection(&renderer->postProcess, &mCOLOR_CORRECTION_GBC);
+		}
+	}
+
+	if (mPostProcessIsActive(&renderer->postProcess)) {
+		// The texture is only locked long enough to copy each processed frame in
+		renderer->postProcessBuffer = malloc(width * height * BYTES_PER_PIXEL);
+		renderer->core->setVideoBuffer(renderer->core, renderer->postProcessBuffer, width);
+	} else {
+		int stride;
+		renderer->postProcessBuffer = NULL;
+		SDL_LockTexture(renderer->sdlTex, 0, (void**) &renderer->outputBuffer, &stride);
+		renderer->core->setVideoBuffer(renderer->core, renderer->outputBuffer, stride / BYTES_PER_PIXEL);
+	}
 
 	return true;
 }
@@ -52,19 +71,31 @@ void mSDLSWRunloop(struct mSDLRenderer* renderer, void* user) {
 			mSDLHandleEvent(context, &renderer->player, &event);
 		}
 
-		if (mCoreSyncWaitFrameStart(&context->impl->sync)) {
+		bool newFrame = mCoreSyncWaitFrameStart(&context->impl->sync);
+		if (newFrame) {
+			int stride;
+			if (renderer->postProcessBuffer) {
+				SDL_LockTexture(renderer->sdlTex, 0, (void**) &renderer->outputBuffer, &stride);
+				mPostProcessRun(&renderer->postProcess, renderer->outputBuffer, stride / BYTES_PER_PIXEL, renderer->postProcessBuffer, renderer->postProcess.width);
+			}
 			SDL_UnlockTexture(renderer->sdlTex);
 			SDL_RenderCopy(renderer->sdlRenderer, renderer->sdlTex, 0, 0);
 			SDL_RenderPresent(renderer->sdlRenderer);
-			int stride;
-			SDL_LockTexture(renderer->sdlTex, 0, (void**) &renderer->outputBuffer, &stride);
-			renderer->core->setVideoBuffer(renderer->core, renderer->outputBuffer, stride / BYTES_PER_PIXEL);
+			if (!renderer->postProcessBuffer) {
+				SDL_LockTexture(renderer->sdlTex, 0, (void**) &renderer->outputBuffer, &stride);
+				renderer->core->setVideoBuffer(renderer->core, renderer->outputBuffer, stride / BYTES_PER_PIXEL);
+			}
 		}
 		mCoreSyncWaitFrameEnd(&context->impl->sync);
+		if (newFrame) {
+			mCoreThreadFramePresented(context);
+		}
 	}
 }
 
 void mSDLSWDeinit(struct mSDLRenderer* renderer) {
+	mPostProcessDeinit(&renderer->postProcess);
+	free(renderer->postProcessBuffer);
 	if (renderer->ratio > 1) {
 		free(renderer->outputBuffer);
 	}
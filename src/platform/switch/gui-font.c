@@ -258,6 +258,7 @@ struct GUIFont* GUIFontCreate(void) {
 }
 
 void GUIFontDestroy(struct GUIFont* font) {
+	GUIFontClearRunCache();
 	glDeleteBuffers(1, &font->vbo);
 	glDeleteBuffers(1, &font->originVbo);
 	glDeleteBuffers(1, &font->glyphVbo);
@@ -10,6 +10,7 @@
 #include <mgba/feature/commandline.h>
 #include <mgba/feature/video-logger.h>
 
+#include <mgba-util/crc32.h>
 #include <mgba-util/image/png-io.h>
 #include <mgba-util/string.h>
 #include <mgba-util/table.h>
@@ -37,10 +38,14 @@
 #define MAX_TEST 200
 #define MAX_JOBS 128
 #define LOG_THRESHOLD 1000000
+#define CACHE_MAGIC 0x4943694D
+// Only the color channels are compared; the fourth byte is ignored
+#define RGB_MASK 0x00FFFFFF
 
 static const struct option longOpts[] = {
 	{ "4up",        no_argument, 0, '4' },
 	{ "base",       required_argument, 0, 'b' },
+	{ "cache",      required_argument, 0, 'c' },
 	{ "diffs",      no_argument, 0, 'd' },
 	{ "help",       no_argument, 0, 'h' },
 	{ "jobs",       required_argument, 0, 'j' },
@@ -55,7 +60,7 @@ static const struct option longOpts[] = {
 	{ 0, 0, 0, 0 }
 };
 
-static const char shortOpts[] = "4b:dhj:no:qRrvx";
+static const char shortOpts[] = "4b:c:dhj:no:qRrvx";
 
 enum CInemaStatus {
 	CI_PASS,
@@ -82,6 +87,7 @@ struct CInemaTest {
 	unsigned totalFrames;
 	uint64_t totalDistance;
 	uint64_t totalPixels;
+	unsigned expectedFrames;
 	jmp_buf errorCtx;
 };
 
@@ -113,6 +119,7 @@ static bool showVersion = false;
 static bool showUsage = false;
 static char base[PATH_MAX] = {0};
 static char outdir[PATH_MAX] = {'.'};
+static char cachedir[PATH_MAX] = {0};
 static bool dryRun = false;
 static bool diffs = false;
 static bool is4Up = false;
@@ -123,8 +130,11 @@ static int verbosity = 0;
 static struct Table configTree;
 static Mutex configMutex;
 
+static Mutex cacheMutex;
+
 static int jobs = 1;
 static size_t jobIndex = 0;
+static struct CInemaTest** jobOrder = NULL;
 static Mutex jobMutex;
 static Thread jobThreads[MAX_JOBS];
 static int jobStatus;
@@ -253,6 +263,9 @@ static bool parseCInemaArgs(int argc, char* const* argv) {
 			strlcpy(base, optarg, sizeof(base));
 			// TODO: Verify path exists
 			break;
+		case 'c':
+			strlcpy(cachedir, optarg, sizeof(cachedir));
+			break;
 		case 'd':
 			diffs = true;
 			break;
@@ -299,8 +312,9 @@ static bool parseCInemaArgs(int argc, char* const* argv) {
 }
 
 static void usageCInema(const char* arg0) {
-	printf("usage: %s [-dhnqrRv] [-j JOBS] [-b BASE] [-o DIR] [--version] [test...]\n", arg0);
+	printf("usage: %s [-dhnqrRv] [-j JOBS] [-b BASE] [-c DIR] [-o DIR] [--version] [test...]\n", arg0);
 	puts("  -b, --base BASE            Path to the CInema base directory");
+	puts("  -c, --cache DIR            Cache decoded baselines in DIR between runs");
 	puts("  -d, --diffs                Output image diffs from failures");
 	puts("  -h, --help                 Print this usage and exit");
 	puts("  -j, --jobs JOBS            Run a number of jobs in parallel");
@@ -362,6 +376,17 @@ static bool collectTests(struct CInemaTestList* tests, const char* path) {
 	return true;
 }
 
+static int _compareExpectedFrames(const void* a, const void* b) {
+	const struct CInemaTest* ta = *(const struct CInemaTest* const*) a;
+	const struct CInemaTest* tb = *(const struct CInemaTest* const*) b;
+
+	if (ta->expectedFrames != tb->expectedFrames) {
+		return ta->expectedFrames < tb->expectedFrames ? 1 : -1;
+	}
+	// Keep ties in name order
+	return ta < tb ? -1 : ta > tb;
+}
+
 static int _compareNames(const void* a, const void* b) {
 	const struct CInemaTest* ta = a;
 	const struct CInemaTest* tb = b;
@@ -613,6 +638,79 @@ bool CInemaTestInit(struct CInemaTest* test, const char* directory, const char*
 	return true;
 }
 
+// Cache entries are a small header followed by the decoded pixels, named
+// after the CRC32 and size of the PNG they were decoded from
+static void _cachePath(struct VFile* vf, char* path, size_t size) {
+	size_t fileSize = vf->size(vf);
+	uint32_t crc = fileCrc32(vf, fileSize);
+	vf->seek(vf, 0, SEEK_SET);
+	snprintf(path, size, "%s" PATH_SEP "%08X-%08" PRIz "X.bin", cachedir, crc, fileSize);
+}
+
+static bool _loadCachedBaseline(const char* path, struct CInemaImage* image) {
+	struct VFile* vf = VFileOpen(path, O_RDONLY);
+	if (!vf) {
+		return false;
+	}
+	uint32_t header[3];
+	uint32_t magic;
+	uint32_t width;
+	uint32_t height;
+	if (vf->read(vf, header, sizeof(header)) != sizeof(header)) {
+		vf->close(vf);
+		return false;
+	}
+	LOAD_32LE(magic, 0, header);
+	LOAD_32LE(width, 4, header);
+	LOAD_32LE(height, 8, header);
+	if (magic != CACHE_MAGIC || width != image->width || height != image->height) {
+		vf->close(vf);
+		return false;
+	}
+	ssize_t size = width * height * BYTES_PER_PIXEL;
+	image->data = malloc(size);
+	if (!image->data || vf->read(vf, image->data, size) != size) {
+		free(image->data);
+		image->data = NULL;
+		vf->close(vf);
+		return false;
+	}
+	vf->close(vf);
+	image->stride = width;
+	return true;
+}
+
+static void _writeCachedBaseline(const char* path, const struct CInemaImage* image) {
+	char tmpPath[PATH_MAX];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+	uint32_t header[3];
+	STORE_32LE(CACHE_MAGIC, 0, header);
+	STORE_32LE(image->width, 4, header);
+	STORE_32LE(image->height, 8, header);
+	ssize_t size = image->width * image->height * BYTES_PER_PIXEL;
+
+	// Write under a temporary name so other jobs never see a partial entry
+	MutexLock(&cacheMutex);
+	struct VFile* vf = VFileOpen(tmpPath, O_CREAT | O_TRUNC | O_WRONLY);
+	if (!vf) {
+		MutexUnlock(&cacheMutex);
+		CIerr(2, "Could not open cache file %s\n", tmpPath);
+		return;
+	}
+	bool ok = vf->write(vf, header, sizeof(header)) == sizeof(header) && vf->write(vf, image->data, size) == size;
+	vf->close(vf);
+	if (ok) {
+#ifdef _WIN32
+		MoveFileEx(tmpPath, path, MOVEFILE_REPLACE_EXISTING);
+#else
+		rename(tmpPath, path);
+#endif
+	} else {
+		remove(tmpPath);
+	}
+	MutexUnlock(&cacheMutex);
+}
+
 static bool _loadBaselinePNG(struct VDir* dir, const char* type, struct CInemaImage* image, size_t frame, enum CInemaStatus* status) {
 	char baselineName[32];
 	snprintf(baselineName, sizeof(baselineName), "%s_%04" PRIz "u.png", type, frame);
@@ -624,6 +722,15 @@ static bool _loadBaselinePNG(struct VDir* dir, const char* type, struct CInemaIm
 		return false;
 	}
 
+	char cachePath[PATH_MAX];
+	if (cachedir[0]) {
+		_cachePath(baselineVF, cachePath, sizeof(cachePath));
+		if (_loadCachedBaseline(cachePath, image)) {
+			baselineVF->close(baselineVF);
+			return true;
+		}
+	}
+
 	png_structp png = PNGReadOpen(baselineVF, 0);
 	png_infop info = png_create_info_struct(png);
 	png_infop end = png_create_info_struct(png);
@@ -664,6 +771,9 @@ static bool _loadBaselinePNG(struct VDir* dir, const char* type, struct CInemaIm
 	PNGReadClose(png, info, end);
 	baselineVF->close(baselineVF);
 	image->stride = pwidth;
+	if (cachedir[0]) {
+		_writeCachedBaseline(cachePath, image);
+	}
 	return true;
 }
 
@@ -792,7 +902,36 @@ static bool _updateInput(struct mCore* core, size_t frame, const char** input) {
 	return true;
 }
 
+static bool _imagesMatch(const struct CInemaImage* restrict image, const struct CInemaImage* restrict expected) {
+	const uint32_t* testPixels = image->data;
+	const uint32_t* expectPixels = expected->data;
+	size_t y;
+	for (y = 0; y < image->height; ++y) {
+		// No early exit within a row, so the compiler can vectorize this
+		uint32_t diff = 0;
+		size_t x;
+		for (x = 0; x < image->width; ++x) {
+			diff |= testPixels[x] ^ expectPixels[x];
+		}
+		if (diff & RGB_MASK) {
+			return false;
+		}
+		testPixels += image->stride;
+		expectPixels += expected->stride;
+	}
+	return true;
+}
+
 static bool _compareImages(struct CInemaTest* restrict test, const struct CInemaImage* restrict image, const struct CInemaImage* restrict expected, int* restrict max, uint8_t** restrict outdiff) {
+	if (_imagesMatch(image, expected)) {
+		return true;
+	}
+	if (!outdiff && verbosity < 2) {
+		// Nothing will look at the per-pixel statistics
+		test->status = CI_FAIL;
+		return false;
+	}
+
 	const uint8_t* testPixels = image->data;
 	const uint8_t* expectPixels = expected->data;
 	uint8_t* diff = NULL;
@@ -996,6 +1135,18 @@ static void _replayBaseline(struct CInemaTest* test, struct FFmpegEncoder* encod
 }
 #endif
 
+static void _estimateFrames(struct CInemaTest* test) {
+	unsigned ignore = 0;
+	unsigned limit = 3600;
+	unsigned skip = 0;
+	MutexLock(&configMutex);
+	CInemaConfigGetUInt(&configTree, test->name, "ignore", &ignore);
+	CInemaConfigGetUInt(&configTree, test->name, "frames", &limit);
+	CInemaConfigGetUInt(&configTree, test->name, "skip", &skip);
+	MutexUnlock(&configMutex);
+	test->expectedFrames = ignore ? 0 : limit + skip;
+}
+
 void CInemaTestRun(struct CInemaTest* test) {
 	unsigned ignore = 0;
 	MutexLock(&configMutex);
@@ -1282,9 +1433,8 @@ void CInemaTestRun(struct CInemaTest* test) {
 	dir->close(dir);
 }
 
-static bool CInemaTask(struct CInemaTestList* tests, size_t i) {
+static bool CInemaTask(struct CInemaTest* test) {
 	bool success = true;
-	struct CInemaTest* test = CInemaTestListGetPointer(tests, i);
 	if (dryRun) {
 		CIlog(-1, "%s\n", test->name);
 	} else {
@@ -1326,7 +1476,7 @@ static bool CInemaTask(struct CInemaTestList* tests, size_t i) {
 }
 
 static THREAD_ENTRY CInemaJob(void* context) {
-	struct CInemaTestList* tests = context;
+	size_t nTests = *(size_t*) context;
 	struct CInemaLogStream stream;
 	StringListInit(&stream.out.lines, 0);
 	StringListInit(&stream.out.partial, 0);
@@ -1343,10 +1493,10 @@ static THREAD_ENTRY CInemaJob(void* context) {
 		i = jobIndex;
 		++jobIndex;
 		MutexUnlock(&jobMutex);
-		if (i >= CInemaTestListSize(tests)) {
+		if (i >= nTests) {
 			break;
 		}
-		if (!CInemaTask(tests, i)) {
+		if (!CInemaTask(jobOrder[i])) {
 			success = false;
 		}
 		CIflush(&stream.out, stdout);
@@ -1493,13 +1643,21 @@ int main(int argc, char** argv) {
 
 	HashTableInit(&configTree, 0, free);
 	MutexInit(&configMutex);
+	MutexInit(&cacheMutex);
+	if (cachedir[0]) {
+#ifndef _WIN32
+		mkdir(cachedir, 0777);
+#else
+		mkdir(cachedir);
+#endif
+	}
 	ThreadLocalInitKey(&currentTest);
 	ThreadLocalSetKey(currentTest, NULL);
 
 	if (jobs == 1) {
 		size_t i;
 		for (i = 0; i < CInemaTestListSize(&tests); ++i) {
-			bool success = CInemaTask(&tests, i);
+			bool success = CInemaTask(CInemaTestListGetPointer(&tests, i));
 			if (!success) {
 				status = 1;
 			}
@@ -1508,6 +1666,17 @@ int main(int argc, char** argv) {
 		MutexInit(&jobMutex);
 		int i;
 
+		// Start the longest tests first so one slow test doesn't end up
+		// running alone after everything else has finished
+		size_t nTests = CInemaTestListSize(&tests);
+		jobOrder = calloc(nTests, sizeof(*jobOrder));
+		size_t j;
+		for (j = 0; j < nTests; ++j) {
+			jobOrder[j] = CInemaTestListGetPointer(&tests, j);
+			_estimateFrames(jobOrder[j]);
+		}
+		qsort(jobOrder, nTests, sizeof(*jobOrder), _compareExpectedFrames);
+
 #if defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200112L
 		struct sigaction sa = {
 			.sa_flags = SA_SIGINFO,
@@ -1522,7 +1691,7 @@ int main(int argc, char** argv) {
 #endif
 
 		for (i = 0; i < jobs; ++i) {
-			ThreadCreate(&jobThreads[i], CInemaJob, &tests);
+			ThreadCreate(&jobThreads[i], CInemaJob, &nTests);
 		}
 		for (i = 0; i < jobs; ++i) {
 			ThreadJoin(&jobThreads[i]);
@@ -1536,9 +1705,12 @@ int main(int argc, char** argv) {
 #endif
 
 		MutexDeinit(&jobMutex);
+		free(jobOrder);
+		jobOrder = NULL;
 		status = jobStatus;
 	}
 
+	MutexDeinit(&cacheMutex);
 	MutexDeinit(&configMutex);
 	HashTableEnumerate(&configTree, _unloadConfigTree, NULL);
 	HashTableDeinit(&configTree);
@@ -19,8 +19,9 @@
 
 #include <errno.h>
 #include <signal.h>
+#include <stdio.h>
 
-#define FUZZ_OPTIONS "F:M:NO:S:V:"
+#define FUZZ_OPTIONS "F:I:M:NO:P:S:T:V:"
 #define FUZZ_USAGE \
 	"Additional options:\n" \
 	"  -F FRAMES        Run for the specified number of FRAMES before exiting\n" \
@@ -28,6 +29,15 @@
 	"  -O OFFSET        Offset to apply savestate overlay\n" \
 	"  -V FILE          Overlay a second savestate over the loaded savestate\n" \
 	"  -M FILE          Attach a memory access log file\n" \
+	"  -T TARGET        What the fuzz input is: rom (default), state or keys\n" \
+	"  -I FILE          Read the fuzz input from FILE instead of stdin\n" \
+	"  -P ITERATIONS    Run up to ITERATIONS inputs in one process\n" \
+
+enum FuzzTarget {
+	FUZZ_TARGET_ROM = 0,
+	FUZZ_TARGET_STATE,
+	FUZZ_TARGET_KEYS,
+};
 
 struct FuzzOpts {
 	bool noVideo;
@@ -35,9 +45,17 @@ struct FuzzOpts {
 	size_t overlayOffset;
 	char* ssOverlay;
 	char* accessLog;
+	enum FuzzTarget target;
+	char* input;
+	unsigned iterations;
 };
 
+#ifdef __AFL_FUZZ_TESTCASE_LEN
+__AFL_FUZZ_INIT();
+#endif
+
 static void _fuzzRunloop(struct mCore* core, int frames);
+static void _fuzzPersistent(struct mCore* core, const struct FuzzOpts* opts, const char* fname);
 static void _fuzzShutdown(int signal);
 static bool _parseFuzzOpts(struct mSubParser* parser, int option, const char* arg);
 
@@ -46,7 +64,7 @@ static bool _dispatchExiting = false;
 int main(int argc, char** argv) {
 	signal(SIGINT, _fuzzShutdown);
 
-	struct FuzzOpts fuzzOpts = { false, 0, 0, 0 };
+	struct FuzzOpts fuzzOpts = { false, 0, 0, 0, 0, FUZZ_TARGET_ROM, 0, 0 };
 	struct mSubParser subparser = {
 		.usage = FUZZ_USAGE,
 		.parse = _parseFuzzOpts,
@@ -92,7 +110,10 @@ int main(int argc, char** argv) {
 #endif
 
 #ifdef __AFL_HAVE_MANUAL_CONTROL
-	__AFL_INIT();
+	// Other targets start the fork server once the core has booted
+	if (fuzzOpts.target == FUZZ_TARGET_ROM && !fuzzOpts.iterations) {
+		__AFL_INIT();
+	}
 #endif
 
 	bool cleanExit = true;
@@ -156,7 +177,12 @@ int main(int argc, char** argv) {
 	blip_set_rates(core->getAudioChannel(core, 0), core->frequency(core), 0x8000);
 	blip_set_rates(core->getAudioChannel(core, 1), core->frequency(core), 0x8000);
 
-	_fuzzRunloop(core, fuzzOpts.frames);
+	if (fuzzOpts.target == FUZZ_TARGET_ROM && !fuzzOpts.iterations) {
+		_fuzzRunloop(core, fuzzOpts.frames);
+	} else {
+		_fuzzPersistent(core, &fuzzOpts, args.fname);
+	}
+	free(fuzzOpts.input);
 
 	if (hasDebugger) {
 		core->detachDebugger(core);
@@ -193,6 +219,132 @@ static void _fuzzRunloop(struct mCore* core, int frames) {
 	} while (frames > 0 && !_dispatchExiting);
 }
 
+static uint8_t* _fuzzReadInput(const char* path, size_t* size) {
+	uint8_t* input = NULL;
+	if (path) {
+		struct VFile* vf = VFileOpen(path, O_RDONLY);
+		if (!vf) {
+			return NULL;
+		}
+		ssize_t fileSize = vf->size(vf);
+		if (fileSize >= 0) {
+			input = malloc(fileSize ? fileSize : 1);
+			*size = vf->read(vf, input, fileSize);
+		}
+		vf->close(vf);
+		return input;
+	}
+
+	size_t capacity = 0x1000;
+	*size = 0;
+	input = malloc(capacity);
+	size_t read;
+	while ((read = fread(&input[*size], 1, capacity - *size, stdin)) > 0) {
+		*size += read;
+		if (*size == capacity) {
+			capacity *= 2;
+			input = realloc(input, capacity);
+		}
+	}
+	return input;
+}
+
+static void _fuzzIteration(struct mCore* core, const struct FuzzOpts* opts, const void* pristine, const uint8_t* input, size_t size) {
+	switch (opts->target) {
+	case FUZZ_TARGET_ROM: {
+		struct VFile* rom = VFileMemChunk(input, size);
+		core->unloadROM(core);
+		if (!core->loadROM(core, rom)) {
+			rom->close(rom);
+			return;
+		}
+		core->reset(core);
+		_fuzzRunloop(core, opts->frames);
+		break;
+	}
+	case FUZZ_TARGET_STATE: {
+		core->loadState(core, pristine);
+		struct VFile* vf = VFileFromConstMemory(input, size);
+		bool loaded = mCoreLoadStateNamed(core, vf, SAVESTATE_ALL);
+		vf->close(vf);
+		if (loaded) {
+			_fuzzRunloop(core, opts->frames);
+		}
+		break;
+	}
+	case FUZZ_TARGET_KEYS: {
+		// Each 16-bit little-endian word is the key state for one frame
+		core->loadState(core, pristine);
+		size_t frame;
+		for (frame = 0; frame < size / 2 && !_dispatchExiting; ++frame) {
+			if (opts->frames > 0 && frame >= (size_t) opts->frames) {
+				break;
+			}
+			core->setKeys(core, input[frame * 2] | (input[frame * 2 + 1] << 8));
+			core->runFrame(core);
+			blip_clear(core->getAudioChannel(core, 0));
+			blip_clear(core->getAudioChannel(core, 1));
+		}
+		break;
+	}
+	}
+}
+
+static bool _fuzzLoop(const struct FuzzOpts* opts, unsigned* iteration) {
+	if (_dispatchExiting) {
+		return false;
+	}
+#ifdef __AFL_LOOP
+	UNUSED(iteration);
+	return __AFL_LOOP(opts->iterations ? opts->iterations : 1);
+#else
+	++*iteration;
+	return *iteration <= opts->iterations || *iteration == 1;
+#endif
+}
+
+// Booting a core is far more expensive than a frame or two of emulation, so
+// instead of a process per input the core is kept and rolled back to a
+// pristine snapshot before each one. Under AFL, the fork server starts from
+// that snapshot and inputs come from shared memory when it is available.
+static void _fuzzPersistent(struct mCore* core, const struct FuzzOpts* opts, const char* fname) {
+	size_t stateSize = core->stateSize(core);
+	void* pristine = anonymousMemoryMap(stateSize);
+	core->saveState(core, pristine);
+
+	const char* inputPath = opts->input;
+	if (!inputPath && opts->target == FUZZ_TARGET_ROM) {
+		inputPath = fname;
+	}
+
+#ifdef __AFL_HAVE_MANUAL_CONTROL
+	__AFL_INIT();
+#endif
+
+	unsigned iteration = 0;
+	while (_fuzzLoop(opts, &iteration)) {
+		size_t size = 0;
+#ifdef __AFL_FUZZ_TESTCASE_LEN
+		const uint8_t* input = __AFL_FUZZ_TESTCASE_BUF;
+		size = __AFL_FUZZ_TESTCASE_LEN;
+		_fuzzIteration(core, opts, pristine, input, size);
+#else
+		uint8_t* input = _fuzzReadInput(inputPath, &size);
+		if (!input) {
+			break;
+		}
+		_fuzzIteration(core, opts, pristine, input, size);
+		free(input);
+		if (!inputPath) {
+			// stdin can only be read once
+			break;
+		}
+#endif
+	}
+
+	mappedMemoryFree(pristine, stateSize);
+}
+
 static void _fuzzShutdown(int signal) {
 	UNUSED(signal);
 	_dispatchExiting = true;
@@ -205,6 +357,9 @@ static bool _parseFuzzOpts(struct mSubParser* parser, int option, const char* ar
 	case 'F':
 		opts->frames = strtoul(arg, 0, 10);
 		return !errno;
+	case 'I':
+		opts->input = strdup(arg);
+		return true;
 	case 'M':
 		opts->accessLog = strdup(arg);
 		return true;
@@ -214,6 +369,20 @@ static bool _parseFuzzOpts(struct mSubParser* parser, int option, const char* ar
 	case 'O':
 		opts->overlayOffset = strtoul(arg, 0, 10);
 		return !errno;
+	case 'P':
+		opts->iterations = strtoul(arg, 0, 10);
+		return !errno;
+	case 'T':
+		if (strcasecmp(arg, "rom") == 0) {
+			opts->target = FUZZ_TARGET_ROM;
+		} else if (strcasecmp(arg, "state") == 0) {
+			opts->target = FUZZ_TARGET_STATE;
+		} else if (strcasecmp(arg, "keys") == 0) {
+			opts->target = FUZZ_TARGET_KEYS;
+		} else {
+			return false;
+		}
+		return true;
 	case 'V':
 		opts->ssOverlay = strdup(arg);
 		return true;
@@ -7,13 +7,18 @@
 #include <mgba/core/cheats.h>
 #include <mgba/core/config.h>
 #include <mgba/core/core.h>
+#include <mgba/core/perf.h>
 #include <mgba/core/serialize.h>
 #include <mgba/gb/core.h>
 #include <mgba/gba/core.h>
+#ifdef ENABLE_ARM_OPCODE_STATS
+#include <mgba/internal/arm/arm.h>
+#endif
 
 #include <mgba/feature/commandline.h>
 #include <mgba-util/socket.h>
 #include <mgba-util/string.h>
+#include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 
 #ifdef __3DS__
@@ -42,40 +47,66 @@ size_t romBufferSize;
 #include <inttypes.h>
 #include <sys/time.h>
 
-#define PERF_OPTIONS "DF:L:NPS:T"
+#define PERF_OPTIONS "ADF:I:JL:NPS:T"
 #define PERF_USAGE \
 	"Benchmark options:\n" \
 	"  -F FRAMES        Run for the specified number of FRAMES before exiting\n" \
 	"  -N               Disable video rendering entirely\n" \
+	"  -A               Disable audio generation entirely\n" \
 	"  -T               Use threaded video rendering\n" \
 	"  -P               CSV output, useful for parsing\n" \
+	"  -J               JSON output, including a per-subsystem time breakdown\n" \
+	"                   when built with ENABLE_PERF_TIMERS\n" \
 	"  -S SEC           Run for SEC in-game seconds before exiting\n" \
 	"  -L FILE          Load a savestate when starting the test\n" \
+	"  -I FILE          Play back an input movie; runs for its length unless\n" \
+	"                   -F or -S is given\n" \
 	"  -D               Act as a server"
 
 struct PerfOpts {
 	bool noVideo;
 	bool threadedVideo;
 	bool csv;
+	bool json;
 	unsigned duration;
 	unsigned frames;
 	char* savestate;
+	char* input;
 	bool server;
+	bool noAudio;
+};
+
+// Input movies are lists of "frame:keys" entries (as in CInema configs),
+// separated by commas or newlines, with keys in hex. An entry without a frame
+// number applies to the frame after the previous entry, so a file of one key
+// mask per line is a per-frame movie. Keys are held until the next entry.
+struct PerfInput {
+	uint32_t frame;
+	uint32_t keys;
 };
 
+DECLARE_VECTOR(PerfInputList, struct PerfInput);
+DEFINE_VECTOR(PerfInputList, struct PerfInput);
+
 #ifdef __SWITCH__
 TimeType __nx_time_type = TimeType_LocalSystemClock;
 #endif
 
 static void _mPerfRunloop(struct mCore* context, int* frames, bool quiet);
+static void _mPerfPrintJSON(const char* gameCode, int frames, uint64_t duration, const char* rendererName, const struct mPerfCounter* counters);
 static void _mPerfShutdown(int signal);
 static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* arg);
+static bool _loadInput(struct VFile* vf);
 static void _log(struct mLogger*, int, enum mLogLevel, const char*, va_list);
 static bool _mPerfRunCore(const char* fname, const struct mArguments*, const struct PerfOpts*);
 static bool _mPerfRunServer(const struct mArguments*, const struct PerfOpts*);
+#ifdef ENABLE_ARM_OPCODE_STATS
+static void _mPerfPrintOpcodeStats(void);
+#endif
 
 static bool _dispatchExiting = false;
 static struct VFile* _savestate = 0;
+static struct PerfInputList _input;
 static void* _outputBuffer = NULL;
 static Socket _socket = INVALID_SOCKET;
 static Socket _server = INVALID_SOCKET;
@@ -122,7 +153,7 @@ int main(int argc, char** argv) {
 	struct mLogger logger = { .log = _log };
 	mLogSetDefaultLogger(&logger);
 
-	struct PerfOpts perfOpts = { false, false, false, 0, 0, 0, false };
+	struct PerfOpts perfOpts = { false, false, false, false, 0, 0, 0, 0, false, false };
 	struct mSubParser subparser = {
 		.usage = PERF_USAGE,
 		.parse = _parsePerfOpts,
@@ -130,6 +161,8 @@ int main(int argc, char** argv) {
 		.opts = &perfOpts
 	};
 
+	PerfInputListInit(&_input, 0);
+
 	struct mArguments args = {};
 	bool parsed = mArgumentsParse(&args, argc, argv, &subparser, 1);
 	if (!args.fname && !perfOpts.server) {
@@ -151,8 +184,23 @@ int main(int argc, char** argv) {
 		free(perfOpts.savestate);
 	}
 
+	if (perfOpts.input) {
+		struct VFile* vf = VFileOpen(perfOpts.input, O_RDONLY);
+		bool loaded = vf && _loadInput(vf);
+		if (vf) {
+			vf->close(vf);
+		}
+		if (!loaded) {
+			fprintf(stderr, "Could not load input movie %s\n", perfOpts.input);
+			free(perfOpts.input);
+			didFail = 1;
+			goto cleanup;
+		}
+		free(perfOpts.input);
+	}
+
 	_outputBuffer = malloc(256 * 256 * 4);
-	if (perfOpts.csv) {
+	if (perfOpts.csv && !perfOpts.json) {
 		puts("game_code,frames,duration,renderer");
 #ifdef __SWITCH__
 		consoleUpdate(NULL);
@@ -165,12 +213,16 @@ int main(int argc, char** argv) {
 	} else {
 		didFail = !_mPerfRunCore(args.fname, &args, &perfOpts);
 	}
+#ifdef ENABLE_ARM_OPCODE_STATS
+	_mPerfPrintOpcodeStats();
+#endif
 	free(_outputBuffer);
 
+	cleanup:
 	if (_savestate) {
 		_savestate->close(_savestate);
 	}
-	cleanup:
+	PerfInputListDeinit(&_input);
 	mArgumentsDeinit(&args);
 
 #ifdef __3DS__
@@ -217,6 +269,9 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 	mCoreConfigMap(&core->config, &opts);
 	opts.audioSync = false;
 	opts.videoSync = false;
+	if (perfOpts->noAudio) {
+		opts.disableAudio = true;
+	}
 	mArgumentsApply(args, NULL, 0, &core->config);
 	mCoreConfigLoadDefaults(&core->config, &opts);
 	mCoreConfigSetDefaultValue(&core->config, "idleOptimization", "detect");
@@ -233,10 +288,16 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 	if (!frames) {
 		frames = perfOpts->duration * 60;
 	}
+	if (!frames && PerfInputListSize(&_input)) {
+		frames = PerfInputListGetPointer(&_input, PerfInputListSize(&_input) - 1)->frame + 1;
+	}
 	struct timeval tv;
 	gettimeofday(&tv, 0);
 	uint64_t start = 1000000LL * tv.tv_sec + tv.tv_usec;
-	_mPerfRunloop(core, &frames, perfOpts->csv);
+	mPerfTimersReset();
+	_mPerfRunloop(core, &frames, perfOpts->csv || perfOpts->json);
+	struct mPerfCounter counters[mPERF_MAX];
+	mPerfTimersCollect(counters);
 	gettimeofday(&tv, 0);
 	uint64_t end = 1000000LL * tv.tv_sec + tv.tv_usec;
 	uint64_t duration = end - start;
@@ -246,16 +307,18 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 	core->deinit(core);
 
 	float scaledFrames = frames * 1000000.f;
-	if (perfOpts->csv) {
+	const char* rendererName;
+	if (perfOpts->noVideo) {
+		rendererName = "none";
+	} else if (perfOpts->threadedVideo) {
+		rendererName = "threaded-software";
+	} else {
+		rendererName = "software";
+	}
+	if (perfOpts->json) {
+		_mPerfPrintJSON(gameCode, frames, duration, rendererName, counters);
+	} else if (perfOpts->csv) {
 		char buffer[256];
-		const char* rendererName;
-		if (perfOpts->noVideo) {
-			rendererName = "none";
-		} else if (perfOpts->threadedVideo) {
-			rendererName = "threaded-software";
-		} else {
-			rendererName = "software";
-		}
 		snprintf(buffer, sizeof(buffer), "%s,%i,%" PRIu64 ",%s\n", gameCode, frames, duration, rendererName);
 		printf("%s", buffer);
 		if (_socket != INVALID_SOCKET) {
@@ -271,13 +334,64 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 	return true;
 }
 
+// One object per line, so runs from server mode can be streamed
+static void _mPerfPrintJSON(const char* gameCode, int frames, uint64_t duration, const char* rendererName, const struct mPerfCounter* counters) {
+	char buffer[1024];
+	size_t length = snprintf(buffer, sizeof(buffer), "{\"game_code\":\"%s\",\"frames\":%i,\"duration\":%" PRIu64 ",\"renderer\":\"%s\"", gameCode, frames, duration, rendererName);
+#ifdef ENABLE_PERF_TIMERS
+	length += snprintf(&buffer[length], sizeof(buffer) - length, ",\"sections\":{");
+	int i;
+	for (i = 0; i < mPERF_MAX && length < sizeof(buffer); ++i) {
+		length += snprintf(&buffer[length], sizeof(buffer) - length, "%s\"%s\":{\"usec\":%" PRIu64 ",\"entries\":%" PRIu64 "}",
+		                   i ? "," : "", mPerfSectionName(i), counters[i].nsec / 1000, counters[i].entries);
+	}
+	if (length < sizeof(buffer)) {
+		length += snprintf(&buffer[length], sizeof(buffer) - length, "}");
+	}
+#else
+	UNUSED(counters);
+#endif
+	if (length < sizeof(buffer)) {
+		snprintf(&buffer[length], sizeof(buffer) - length, "}\n");
+	}
+	printf("%s", buffer);
+	if (_socket != INVALID_SOCKET) {
+		SocketSend(_socket, buffer, strlen(buffer));
+	}
+}
+
+#ifdef ENABLE_ARM_OPCODE_STATS
+static void _mPerfPrintOpcodeStats(void) {
+	size_t i;
+	for (i = 0; i < 0x1000; ++i) {
+		if (ARMOpcodeStats[i]) {
+			fprintf(stderr, "arm,0x%03zX,%" PRIu64 "\n", i, ARMOpcodeStats[i]);
+		}
+	}
+	for (i = 0; i < 0x400; ++i) {
+		if (ThumbOpcodeStats[i]) {
+			fprintf(stderr, "thumb,0x%03zX,%" PRIu64 "\n", i, ThumbOpcodeStats[i]);
+		}
+	}
+}
+#endif
+
 static void _mPerfRunloop(struct mCore* core, int* frames, bool quiet) {
 	struct timeval lastEcho;
 	gettimeofday(&lastEcho, 0);
 	int duration = *frames;
 	*frames = 0;
 	int lastFrames = 0;
+	size_t nextInput = 0;
+	size_t nInputs = PerfInputListSize(&_input);
 	while (!_dispatchExiting) {
+		if (nextInput < nInputs) {
+			const struct PerfInput* input = PerfInputListGetConstPointer(&_input, nextInput);
+			if (input->frame == (uint32_t) *frames) {
+				core->setKeys(core, input->keys);
+				++nextInput;
+			}
+		}
 		core->runFrame(core);
 		++*frames;
 		++lastFrames;
@@ -325,7 +439,7 @@ static bool _mPerfRunServer(const struct mArguments* args, const struct PerfOpts
 		SocketSubsystemDeinit();
 		return false;
 	}
-	if (perfOpts->csv) {
+	if (perfOpts->csv && !perfOpts->json) {
 		const char* header = "game_code,frames,duration,renderer\n";
 		SocketSend(_socket, header, strlen(header));
 	}
@@ -363,6 +477,9 @@ static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* ar
 	struct PerfOpts* opts = parser->opts;
 	errno = 0;
 	switch (option) {
+	case 'A':
+		opts->noAudio = true;
+		return true;
 	case 'D':
 		opts->server = true;
 		return true;
@@ -372,6 +489,9 @@ static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* ar
 	case 'N':
 		opts->noVideo = true;
 		return true;
+	case 'J':
+		opts->json = true;
+		return true;
 	case 'P':
 		opts->csv = true;
 		return true;
@@ -381,6 +501,9 @@ static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* ar
 	case 'T':
 		opts->threadedVideo = true;
 		return true;
+	case 'I':
+		opts->input = strdup(arg);
+		return true;
 	case 'L':
 		opts->savestate = strdup(arg);
 		return true;
@@ -389,6 +512,60 @@ static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* ar
 	}
 }
 
+static bool _loadInput(struct VFile* vf) {
+	ssize_t size = vf->size(vf);
+	if (size < 0) {
+		return false;
+	}
+	char* movie = malloc(size + 1);
+	if (vf->read(vf, movie, size) != size) {
+		free(movie);
+		return false;
+	}
+	movie[size] = '\0';
+
+	uint32_t frame = 0;
+	bool first = true;
+	bool ok = true;
+	char* entry = movie;
+	while (ok) {
+		while (*entry == ',' || isspace((unsigned char) *entry)) {
+			++entry;
+		}
+		if (*entry == '#') {
+			entry += strcspn(entry, "\n");
+			continue;
+		}
+		if (!*entry) {
+			break;
+		}
+		char* end;
+		uint32_t keys = strtoul(entry, &end, 16);
+		if (*end == ':') {
+			// Frame numbers are decimal, unlike the keys
+			uint32_t next = strtoul(entry, &end, 10);
+			if (end == entry || *end != ':' || (!first && next <= frame)) {
+				ok = false;
+				break;
+			}
+			frame = next;
+			entry = end + 1;
+			keys = strtoul(entry, &end, 16);
+		} else if (!first) {
+			++frame;
+		}
+		if (end == entry || (*end && *end != ',' && !isspace((unsigned char) *end))) {
+			ok = false;
+			break;
+		}
+		first = false;
+		entry = end;
+		*PerfInputListAppend(&_input) = (struct PerfInput) { frame, keys };
+	}
+	free(movie);
+	return ok;
+}
+
 static void _log(struct mLogger* log, int category, enum mLogLevel level, const char* format, va_list args) {
 	UNUSED(log);
 	UNUSED(category);
@@ -0,0 +1,415 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/core/log.h>
+#include <mgba/core/version.h>
+#include <mgba/feature/video-logger.h>
+
+#include <mgba-util/string.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vfs.h>
+
+#include "feature/ffmpeg/ffmpeg-encoder.h"
+
+#ifdef _MSC_VER
+#include <mgba-util/platform/windows/getopt.h>
+#else
+#include <getopt.h>
+#endif
+
+#include <inttypes.h>
+#include <signal.h>
+#include <stdlib.h>
+
+#define MAX_JOBS 128
+#define AUDIO_READ_SAMPLES 0x400
+
+static const struct option longOpts[] = {
+	{ "acodec",    required_argument, 0, 'a' },
+	{ "abr",       required_argument, 0, 'A' },
+	{ "container", required_argument, 0, 'c' },
+	{ "extension", required_argument, 0, 'e' },
+	{ "help",      no_argument, 0, 'h' },
+	{ "jobs",      required_argument, 0, 'j' },
+	{ "output",    required_argument, 0, 'o' },
+	{ "scale",     required_argument, 0, 's' },
+	{ "vcodec",    required_argument, 0, 'v' },
+	{ "vbr",       required_argument, 0, 'V' },
+	{ "hwaccel",   no_argument, 0, 'H' },
+	{ "version",   no_argument, 0, '\0' },
+	{ 0, 0, 0, 0 }
+};
+
+static const char shortOpts[] = "a:A:c:e:hHj:o:s:v:V:";
+
+struct RenderOpts {
+	const char* acodec;
+	unsigned abr;
+	const char* vcodec;
+	int vbr;
+	const char* container;
+	const char* extension;
+	const char* output;
+	unsigned scale;
+	bool hardware;
+	int jobs;
+};
+
+struct RenderJobs {
+	char* const* inputs;
+	size_t nInputs;
+	size_t next;
+	bool failed;
+	Mutex mutex;
+};
+
+static struct RenderOpts opts = {
+	.acodec = "flac",
+	.abr = 0,
+	.vcodec = "libx264",
+	.vbr = 0,
+	.container = "matroska",
+	.extension = "mkv",
+	.output = NULL,
+	.scale = 1,
+	.hardware = false,
+	.jobs = 1,
+};
+
+static bool showUsage = false;
+static bool showVersion = false;
+static volatile bool _dispatchExiting = false;
+
+static void _renderShutdown(int signal) {
+	UNUSED(signal);
+	_dispatchExiting = true;
+}
+
+static void _log(struct mLogger* log, int category, enum mLogLevel level, const char* format, va_list args) {
+	UNUSED(log);
+	if (level > mLOG_ERROR) {
+		return;
+	}
+	fprintf(stderr, "%s: ", mLogCategoryName(category));
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+}
+
+static bool _parseRenderArgs(int argc, char* const* argv) {
+	int ch;
+	int index = 0;
+	while ((ch = getopt_long(argc, argv, shortOpts, longOpts, &index)) != -1) {
+		const struct option* opt = &longOpts[index];
+		switch (ch) {
+		case '\0':
+			if (strcmp(opt->name, "version") == 0) {
+				showVersion = true;
+			} else {
+				return false;
+			}
+			break;
+		case 'a':
+			opts.acodec = strcmp(optarg, "none") == 0 ? NULL : optarg;
+			break;
+		case 'A':
+			opts.abr = strtoul(optarg, NULL, 0) * 1024;
+			break;
+		case 'c':
+			opts.container = optarg;
+			break;
+		case 'e':
+			opts.extension = optarg;
+			break;
+		case 'h':
+			showUsage = true;
+			break;
+		case 'H':
+			opts.hardware = true;
+			break;
+		case 'j':
+			opts.jobs = atoi(optarg);
+			if (opts.jobs > MAX_JOBS) {
+				opts.jobs = MAX_JOBS;
+			}
+			if (opts.jobs < 1) {
+				opts.jobs = 1;
+			}
+			break;
+		case 'o':
+			opts.output = optarg;
+			break;
+		case 's':
+			opts.scale = strtoul(optarg, NULL, 0);
+			if (opts.scale < 1) {
+				opts.scale = 1;
+			}
+			break;
+		case 'v':
+			opts.vcodec = optarg;
+			break;
+		case 'V':
+			// Negative values are passed through as CRF, so they aren't scaled
+			opts.vbr = atoi(optarg);
+			if (opts.vbr > 0) {
+				opts.vbr *= 1024;
+			}
+			break;
+		default:
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void _usageRender(const char* arg0) {
+	printf("usage: %s [-hH] [-j JOBS] [-s SCALE] [-v VCODEC] [-V VBR] [-a ACODEC] [-A ABR] [-c CONTAINER] [-e EXT] [-o OUTPUT] [--version] log...\n", arg0);
+	puts("Renders video logs recorded for later rendering, along with their audio");
+	puts("  -a, --acodec ACODEC        Audio codec, or \"none\" (default: flac)");
+	puts("  -A, --abr ABR              Audio bitrate in kbps");
+	puts("  -c, --container CONTAINER  Container format (default: matroska)");
+	puts("  -e, --extension EXT        Extension for output files (default: mkv)");
+	puts("  -h, --help                 Print this usage and exit");
+	puts("  -H, --hwaccel              Use a hardware video encoder if one is available");
+	puts("  -j, --jobs JOBS            Render a number of logs in parallel");
+	puts("  -o, --output OUTPUT        Output file, if only one log is given");
+	puts("  -s, --scale SCALE          Scale the output by an integer factor");
+	puts("  -v, --vcodec VCODEC        Video codec (default: libx264)");
+	puts("  -V, --vbr VBR              Video bitrate in kbps, or negative for CRF");
+	puts("  --version                  Print version and exit");
+}
+
+static bool _postAudio(struct FFmpegEncoder* encoder, struct mVideoLogContext* log, int channel, unsigned* sampleRate, size_t maxSamples, size_t* posted) {
+	struct mStereoSample samples[AUDIO_READ_SAMPLES];
+	if (maxSamples > AUDIO_READ_SAMPLES) {
+		maxSamples = AUDIO_READ_SAMPLES;
+	}
+	unsigned rate;
+	size_t read = mVideoLogContextReadAudio(log, channel, samples, maxSamples, &rate);
+	if (!read || !rate) {
+		return false;
+	}
+	if (rate != *sampleRate) {
+		encoder->d.audioRateChanged(&encoder->d, rate);
+		*sampleRate = rate;
+	}
+	size_t i;
+	for (i = 0; i < read; ++i) {
+		encoder->d.postAudioFrame(&encoder->d, samples[i].left, samples[i].right);
+	}
+	*posted = read;
+	return true;
+}
+
+static bool _renderLog(const char* input, const char* output) {
+	struct VFile* vf = VFileOpen(input, O_RDONLY);
+	if (!vf) {
+		fprintf(stderr, "Could not open %s\n", input);
+		return false;
+	}
+	struct mCore* core = mVideoLogCoreFind(vf);
+	if (!core) {
+		fprintf(stderr, "%s is not a video log\n", input);
+		vf->close(vf);
+		return false;
+	}
+	if (!core->init(core)) {
+		core->deinit(core);
+		vf->close(vf);
+		return false;
+	}
+	mCoreInitConfig(core, NULL);
+
+	unsigned width;
+	unsigned height;
+	core->baseVideoSize(core, &width, &height);
+	color_t* buffer = calloc(width * height, BYTES_PER_PIXEL);
+	core->setVideoBuffer(core, buffer, width);
+	if (!core->loadROM(core, vf)) {
+		fprintf(stderr, "Could not load %s\n", input);
+		vf->close(vf);
+		mCoreConfigDeinit(&core->config);
+		core->deinit(core);
+		free(buffer);
+		return false;
+	}
+	core->reset(core);
+	core->currentVideoSize(core, &width, &height);
+
+	// The player core doesn't make any sound, so the audio is read straight out of the log
+	struct mVideoLogContext* audioLog = mVideoLogContextCreate(NULL);
+	struct VFile* audioVf = VFileOpen(input, O_RDONLY);
+	int audioChannel = -1;
+	if (audioVf && mVideoLogContextLoad(audioLog, audioVf)) {
+		audioChannel = mVideoLogContextFindChannel(audioLog, mVL_CHANNEL_AUDIO);
+	}
+
+	struct FFmpegEncoder encoder;
+	FFmpegEncoderInit(&encoder);
+	bool success = true;
+	if (!FFmpegEncoderSetAudio(&encoder, audioChannel >= 0 ? opts.acodec : NULL, opts.abr)) {
+		fprintf(stderr, "Unsupported audio codec %s\n", opts.acodec);
+		success = false;
+	}
+	if (!FFmpegEncoderSetVideo(&encoder, opts.vcodec, opts.vbr, 0)) {
+		fprintf(stderr, "Unsupported video codec %s\n", opts.vcodec);
+		success = false;
+	}
+	if (!FFmpegEncoderSetContainer(&encoder, opts.container)) {
+		fprintf(stderr, "Unsupported container %s\n", opts.container);
+		success = false;
+	}
+	FFmpegEncoderSetDimensions(&encoder, width * opts.scale, height * opts.scale);
+	FFmpegEncoderSetInputFrameRate(&encoder, core->frameCycles(core), core->frequency(core));
+	FFmpegEncoderSetHardwareAcceleration(&encoder, opts.hardware);
+	if (success && !FFmpegEncoderOpen(&encoder, output)) {
+		fprintf(stderr, "Could not open %s for writing\n", output);
+		success = false;
+	}
+
+	if (success) {
+		encoder.d.videoDimensionsChanged(&encoder.d, width, height);
+
+		uint64_t frameCycles = core->frameCycles(core);
+		uint64_t frequency = core->frequency(core);
+		uint64_t frames = 0;
+		uint64_t audioCycles = 0;
+		unsigned sampleRate = 0;
+		bool audioDone = audioChannel < 0;
+		uint32_t lastFrame = core->frameCounter(core);
+		while (!_dispatchExiting) {
+			core->runFrame(core);
+			uint32_t frame = core->frameCounter(core);
+			if (frame <= lastFrame) {
+				// The player goes back to the beginning when it reaches the end
+				break;
+			}
+			lastFrame = frame;
+			encoder.d.postVideoFrame(&encoder.d, buffer, width);
+			++frames;
+
+			// Keep the audio lined up with the frames so it doesn't pile up in the muxer
+			while (!audioDone && audioCycles < frames * frameCycles) {
+				size_t wanted = 1;
+				if (sampleRate) {
+					wanted += (frames * frameCycles - audioCycles) * sampleRate / frequency;
+				}
+				size_t posted;
+				if (!_postAudio(&encoder, audioLog, audioChannel, &sampleRate, wanted, &posted)) {
+					audioDone = true;
+					break;
+				}
+				audioCycles += posted * frequency / sampleRate;
+			}
+		}
+		// Anything recorded past the last frame still goes in
+		size_t posted;
+		while (!audioDone && !_dispatchExiting) {
+			audioDone = !_postAudio(&encoder, audioLog, audioChannel, &sampleRate, AUDIO_READ_SAMPLES, &posted);
+		}
+		FFmpegEncoderClose(&encoder);
+		printf("Rendered %" PRIu64 " frames from %s to %s\n", frames, input, output);
+	}
+
+	mVideoLogContextDestroy(NULL, audioLog, true);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(buffer);
+	return success;
+}
+
+static bool _renderInput(const char* input) {
+	if (opts.output) {
+		return _renderLog(input, opts.output);
+	}
+	char dirname[PATH_MAX];
+	char basename[PATH_MAX];
+	char output[PATH_MAX];
+	separatePath(input, dirname, basename, NULL);
+	if (dirname[0]) {
+		snprintf(output, sizeof(output), "%s" PATH_SEP "%s.%s", dirname, basename, opts.extension);
+	} else {
+		snprintf(output, sizeof(output), "%s.%s", basename, opts.extension);
+	}
+	return _renderLog(input, output);
+}
+
+static void _runJobs(struct RenderJobs* jobs) {
+	while (!_dispatchExiting) {
+		MutexLock(&jobs->mutex);
+		size_t index = jobs->next;
+		++jobs->next;
+		MutexUnlock(&jobs->mutex);
+		if (index >= jobs->nInputs) {
+			break;
+		}
+		if (!_renderInput(jobs->inputs[index])) {
+			MutexLock(&jobs->mutex);
+			jobs->failed = true;
+			MutexUnlock(&jobs->mutex);
+		}
+	}
+}
+
+static THREAD_ENTRY _renderJob(void* context) {
+	ThreadSetName("Render Job");
+	_runJobs(context);
+	THREAD_EXIT(0);
+}
+
+int main(int argc, char** argv) {
+	signal(SIGINT, _renderShutdown);
+
+	const char* arg0 = argv[0];
+	if (!_parseRenderArgs(argc, argv)) {
+		_usageRender(arg0);
+		return 1;
+	}
+	if (showVersion) {
+		version(arg0);
+		return 0;
+	}
+	argc -= optind;
+	argv += optind;
+	if (showUsage || argc < 1) {
+		_usageRender(arg0);
+		return !showUsage;
+	}
+	if (opts.output && argc > 1) {
+		fprintf(stderr, "An output file can only be given for a single log\n");
+		return 1;
+	}
+
+	struct mLogger logger = { .log = _log };
+	mLogSetDefaultLogger(&logger);
+	av_log_set_level(AV_LOG_ERROR);
+
+	struct RenderJobs jobs = {
+		.inputs = argv,
+		.nInputs = argc,
+		.next = 0,
+		.failed = false,
+	};
+	MutexInit(&jobs.mutex);
+	if (opts.jobs > argc) {
+		opts.jobs = argc;
+	}
+	if (opts.jobs == 1) {
+		_runJobs(&jobs);
+	} else {
+		Thread threads[MAX_JOBS];
+		int i;
+		for (i = 0; i < opts.jobs; ++i) {
+			ThreadCreate(&threads[i], _renderJob, &jobs);
+		}
+		for (i = 0; i < opts.jobs; ++i) {
+			ThreadJoin(&threads[i]);
+		}
+	}
+	MutexDeinit(&jobs.mutex);
+	return jobs.failed || _dispatchExiting;
+}
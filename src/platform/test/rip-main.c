@@ -0,0 +1,320 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/blip_buf.h>
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/core/log.h>
+#include <mgba/core/perf.h>
+#include <mgba/core/serialize.h>
+#include <mgba/feature/commandline.h>
+
+#include <mgba-util/string.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
+#include <mgba-util/vfs.h>
+
+#include <signal.h>
+
+#define RIP_OPTIONS "j:L:o:r:T:"
+#define RIP_USAGE \
+	"Ripping options:\n" \
+	"  -j JOBS          How many tracks to rip at once (default: 4)\n" \
+	"  -L SECONDS       Length of each track (default: 180)\n" \
+	"  -o DIR           Directory to write the WAV files to (default: current directory)\n" \
+	"  -r RATE          Output sample rate (default: 48000)\n" \
+	"  -T STATE         Savestate a track starts from; repeat for each track. Without any,\n" \
+	"                   a single track is ripped from boot, or from the state given by -t"
+
+#define WAV_HEADER_SIZE 44
+#define SAMPLES_PER_WRITE 0x400
+
+struct RipOpts {
+	const char* outdir;
+	unsigned jobs;
+	unsigned length;
+	unsigned rate;
+	struct StringList tracks;
+};
+
+struct RipContext {
+	const struct mArguments* args;
+	const struct RipOpts* opts;
+	int nextTrack;
+	int failures;
+};
+
+static bool _parseRipOpts(struct mSubParser* parser, int option, const char* arg);
+static void _ripShutdown(int signal);
+
+static volatile bool _dispatchExiting = false;
+static struct mStandardLogger _logger;
+
+static void _ripShutdown(int signal) {
+	UNUSED(signal);
+	_dispatchExiting = true;
+}
+
+static bool _parseRipOpts(struct mSubParser* parser, int option, const char* arg) {
+	struct RipOpts* opts = parser->opts;
+	switch (option) {
+	case 'j':
+		opts->jobs = strtoul(arg, NULL, 0);
+		return opts->jobs > 0;
+	case 'L':
+		opts->length = strtoul(arg, NULL, 0);
+		return opts->length > 0;
+	case 'o':
+		opts->outdir = arg;
+		return true;
+	case 'r':
+		opts->rate = strtoul(arg, NULL, 0);
+		return opts->rate > 0;
+	case 'T':
+		*StringListAppend(&opts->tracks) = strdup(arg);
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void _writeWavHeader(struct VFile* vf, unsigned rate, uint32_t dataSize) {
+	uint8_t header[WAV_HEADER_SIZE];
+	memcpy(&header[0], "RIFF", 4);
+	STORE_32LE(dataSize + WAV_HEADER_SIZE - 8, 4, header);
+	memcpy(&header[8], "WAVEfmt ", 8);
+	STORE_32LE(16, 16, header);
+	STORE_16LE(1, 20, header); // PCM
+	STORE_16LE(2, 22, header); // Stereo
+	STORE_32LE(rate, 24, header);
+	STORE_32LE(rate * 4, 28, header);
+	STORE_16LE(4, 32, header);
+	STORE_16LE(16, 34, header);
+	memcpy(&header[36], "data", 4);
+	STORE_32LE(dataSize, 40, header);
+	vf->seek(vf, 0, SEEK_SET);
+	vf->write(vf, header, sizeof(header));
+}
+
+static uint32_t _drainAudio(struct mCore* core, struct VFile* vf) {
+	struct blip_t* left = core->getAudioChannel(core, 0);
+	struct blip_t* right = core->getAudioChannel(core, 1);
+	int16_t samples[SAMPLES_PER_WRITE * 2];
+	uint32_t written = 0;
+	int available;
+	while ((available = blip_samples_avail(left)) > 0) {
+		if (available > SAMPLES_PER_WRITE) {
+			available = SAMPLES_PER_WRITE;
+		}
+		blip_read_samples(left, &samples[0], available, true);
+		blip_read_samples(right, &samples[1], available, true);
+		int i;
+		for (i = 0; i < available * 2; ++i) {
+			STORE_16LE(samples[i], i * 2, samples);
+		}
+		ssize_t size = vf->write(vf, samples, available * 4);
+		if (size > 0) {
+			written += size;
+		}
+	}
+	return written;
+}
+
+static bool _outputPath(const struct RipOpts* opts, const char* source, char* path, size_t size) {
+	char basename[PATH_MAX];
+	separatePath(source, NULL, basename, NULL);
+	int length = snprintf(path, size, "%s%c%s.wav", opts->outdir, PATH_SEP[0], basename);
+	return length >= 0 && (size_t) length < size;
+}
+
+static bool _ripTrack(struct RipContext* context, const char* state) {
+	const struct mArguments* args = context->args;
+	const struct RipOpts* opts = context->opts;
+	const char* source = state ? state : args->fname;
+	char path[PATH_MAX];
+	if (!_outputPath(opts, source, path, sizeof(path))) {
+		fprintf(stderr, "Output path for %s is too long\n", source);
+		return false;
+	}
+	struct mCore* core = mCoreFind(args->fname);
+	if (!core) {
+		fprintf(stderr, "Could not find a core for %s\n", args->fname);
+		return false;
+	}
+	bool success = false;
+	struct VFile* vf = NULL;
+
+	// No video buffer is ever set, so the core keeps its dummy renderer and draws nothing
+	core->init(core);
+	mCoreInitConfig(core, "rip");
+	mCoreConfigLoad(&core->config);
+	mArgumentsApply(args, NULL, 0, &core->config);
+	mCoreConfigSetDefaultValue(&core->config, "idleOptimization", "detect");
+	mCoreLoadConfig(core);
+	if (!mCoreLoadFile(core, args->fname)) {
+		fprintf(stderr, "Could not load %s\n", args->fname);
+		goto cleanup;
+	}
+	core->reset(core);
+	mArgumentsApplyFileLoads(args, core);
+	if (state) {
+		struct VFile* savestate = VFileOpen(state, O_RDONLY);
+		bool loaded = savestate && mCoreLoadStateNamed(core, savestate, SAVESTATE_RTC);
+		if (savestate) {
+			savestate->close(savestate);
+		}
+		if (!loaded) {
+			fprintf(stderr, "Could not load %s\n", state);
+			goto cleanup;
+		}
+	}
+	blip_set_rates(core->getAudioChannel(core, 0), core->frequency(core), opts->rate);
+	blip_set_rates(core->getAudioChannel(core, 1), core->frequency(core), opts->rate);
+
+	vf = VFileOpen(path, O_CREAT | O_TRUNC | O_RDWR);
+	if (!vf) {
+		fprintf(stderr, "Could not create %s\n", path);
+		goto cleanup;
+	}
+	// The sizes are filled in once the track is done, so the samples can be streamed out as they come
+	_writeWavHeader(vf, opts->rate, 0);
+
+	uint64_t start = mPerfTimestamp();
+	uint64_t frames = (uint64_t) opts->length * core->frequency(core) / core->frameCycles(core);
+	uint32_t dataSize = 0;
+	for (; frames && !_dispatchExiting; --frames) {
+		core->runFrame(core);
+		dataSize += _drainAudio(core, vf);
+	}
+	_writeWavHeader(vf, opts->rate, dataSize);
+	success = !_dispatchExiting;
+	if (success) {
+		printf("%s: %u seconds in %.2f seconds\n", path, opts->length, (mPerfTimestamp() - start) / 1e9);
+	}
+
+cleanup:
+	if (vf) {
+		vf->close(vf);
+	}
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	return success;
+}
+
+static void _ripTracks(struct RipContext* context) {
+	size_t nTracks = StringListSize(&context->opts->tracks);
+	while (!_dispatchExiting) {
+		const char* state = NULL;
+		if (nTracks) {
+			size_t track = ATOMIC_ADD(context->nextTrack, 1) - 1;
+			if (track >= nTracks) {
+				break;
+			}
+			state = *StringListGetConstPointer(&context->opts->tracks, track);
+		} else if (ATOMIC_ADD(context->nextTrack, 1) > 1) {
+			break;
+		} else {
+			state = context->args->savestate;
+		}
+		if (!_ripTrack(context, state)) {
+			ATOMIC_ADD(context->failures, 1);
+		}
+	}
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _ripThread(void* context) {
+	ThreadSetName("Rip Worker");
+	_ripTracks(context);
+	THREAD_EXIT(0);
+}
+#endif
+
+int main(int argc, char * argv[]) {
+	signal(SIGINT, _ripShutdown);
+
+	struct RipOpts ripOpts = {
+		.outdir = ".",
+		.jobs = 4,
+		.length = 180,
+		.rate = 48000,
+	};
+	StringListInit(&ripOpts.tracks, 0);
+	struct mSubParser subparser = {
+		.usage = RIP_USAGE,
+		.parse = _parseRipOpts,
+		.extraOptions = RIP_OPTIONS,
+		.opts = &ripOpts
+	};
+
+	int status = 1;
+	struct mArguments args;
+	bool parsed = mArgumentsParse(&args, argc, argv, &subparser, 1);
+	if (!args.fname) {
+		parsed = false;
+	}
+	if (!parsed || args.showHelp) {
+		usage(argv[0], NULL, NULL, &subparser, 1);
+		status = !parsed;
+		goto cleanup;
+	}
+	if (args.showVersion) {
+		version(argv[0]);
+		status = 0;
+		goto cleanup;
+	}
+
+	// Tracks run on their own threads, so there's one logger for all of them
+	struct mCoreConfig config;
+	mCoreConfigInit(&config, "rip");
+	mArgumentsApply(&args, NULL, 0, &config);
+	mStandardLoggerInit(&_logger);
+	mStandardLoggerConfig(&_logger, &config);
+	mLogSetDefaultLogger(&_logger.d);
+	mCoreConfigDeinit(&config);
+
+	struct RipContext context = {
+		.args = &args,
+		.opts = &ripOpts,
+	};
+#ifndef DISABLE_THREADING
+	size_t nTracks = StringListSize(&ripOpts.tracks);
+	size_t nThreads = ripOpts.jobs;
+	if (nThreads > nTracks) {
+		nThreads = nTracks;
+	}
+	Thread* threads = NULL;
+	if (nThreads > 1) {
+		// The main thread rips tracks too
+		--nThreads;
+		threads = calloc(nThreads, sizeof(*threads));
+		size_t i;
+		for (i = 0; i < nThreads; ++i) {
+			ThreadCreate(&threads[i], _ripThread, &context);
+		}
+	}
+	_ripTracks(&context);
+	if (threads) {
+		size_t i;
+		for (i = 0; i < nThreads; ++i) {
+			ThreadJoin(&threads[i]);
+		}
+		free(threads);
+	}
+#else
+	_ripTracks(&context);
+#endif
+	status = context.failures || _dispatchExiting;
+	mStandardLoggerDeinit(&_logger);
+
+cleanup:
+	mArgumentsDeinit(&args);
+	size_t i;
+	for (i = 0; i < StringListSize(&ripOpts.tracks); ++i) {
+		free(*StringListGetPointer(&ripOpts.tracks, i));
+	}
+	StringListDeinit(&ripOpts.tracks);
+	return status;
+}
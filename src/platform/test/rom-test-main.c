@@ -1,4 +1,4 @@
-/* Copyright (c) 2013-2023 Jeffrey Pfau
+/* Copyright (c) 2013-2026 Jeffrey Pfau
 *  Copyright (c) 2022 Felix Jones
 *
 * This Source Code Form is subject to the terms of the Mozilla Public
@@ -10,6 +10,8 @@
 #include <mgba/core/core.h>
 #include <mgba/core/log.h>
 #include <mgba/core/serialize.h>
+#include <mgba/core/timing.h>
+#include <mgba/core/version.h>
 #include <mgba/debugger/debugger.h>
 #ifdef M_CORE_GBA
 #include <mgba/internal/gba/gba.h>
@@ -19,125 +21,162 @@
 #endif
 
 #include <mgba/feature/commandline.h>
+#include <mgba-util/configuration.h>
+#include <mgba-util/crc32.h>
+#include <mgba-util/string.h>
+#include <mgba-util/threading.h>
 #include <mgba-util/vfs.h>
 
 #include <errno.h>
 #include <signal.h>
 
-#define ROM_TEST_OPTIONS "S:R:"
+#define ROM_TEST_OPTIONS "S:R:j:L:T:"
 #define ROM_TEST_USAGE \
 	"Additional options:\n" \
 	"  -S SWI           Run until specified SWI call before exiting\n" \
 	"  -R REGISTER      General purpose register to return as exit code\n" \
+	"  -T CYCLES        Give up on a test after this many emulated cycles\n" \
+	"\n" \
+	"Suite options:\n" \
+	"  -L LIST          Run every test ROM listed in LIST, one path per line, instead of a single ROM\n" \
+	"  -j JOBS          How many test ROMs to run at once (default: 4)\n" \
+	"  --junit FILE     Write the suite's results to FILE as JUnit XML\n" \
+	"  --json FILE      Write the suite's results to FILE as JSON\n" \
+	"  --cache FILE     Reuse results from FILE for ROMs this build has already run, and save new ones there"
+
+enum RomTestResult {
+	ROM_TEST_PENDING = 0,
+	ROM_TEST_PASS,
+	ROM_TEST_FAIL,
+	ROM_TEST_TIMEOUT,
+	ROM_TEST_ERROR,
+};
 
 struct RomTestOpts {
 	int exitSwiImmediate;
 	char* returnCodeRegister;
+	uint64_t timeout;
+	const char* suite;
+	unsigned jobs;
+	const char* junit;
+	const char* json;
+	const char* cache;
+};
+
+struct RomTest {
+	char* path;
+	struct mCore* core;
+	struct mCoreCallbacks callbacks;
+#ifdef M_CORE_GBA
+	void (*armSwi16)(struct ARMCore* cpu, int immediate);
+	void (*armSwi32)(struct ARMCore* cpu, int immediate);
+#endif
+	bool exiting;
+
+	enum RomTestResult result;
+	int exitCode;
+	uint64_t cycles;
+	double seconds;
+	uint32_t crc32;
+	bool cached;
+};
+
+struct RomTestSuite {
+	const struct mArguments* args;
+	struct RomTest* tests;
+	size_t nTests;
+	int nextTest;
+};
+
+static const struct mOption _romTestLongOpts[] = {
+	{ "junit", true, '\0' },
+	{ "json", true, '\0' },
+	{ "cache", true, '\0' },
+	{ 0, 0, 0 }
+};
+
+static const char* const _resultNames[] = {
+	[ROM_TEST_PENDING] = "pending",
+	[ROM_TEST_PASS] = "pass",
+	[ROM_TEST_FAIL] = "fail",
+	[ROM_TEST_TIMEOUT] = "timeout",
+	[ROM_TEST_ERROR] = "error",
 };
 
 static void _romTestShutdown(int signal);
 static bool _parseRomTestOpts(struct mSubParser* parser, int option, const char* arg);
+static bool _parseLongRomTestOpts(struct mSubParser* parser, const char* option, const char* arg);
 static bool _parseSwi(const char* regStr, int* oSwi);
 
-static bool _romTestCheckResiger(void);
-
-static struct mCore* core;
+static bool _romTestCheckResiger(struct mCore* core);
+static bool _romTestLoad(struct RomTest* test, const struct mArguments* args, const char* configName);
+static void _romTestRun(struct RomTest* test);
+static void _romTestUnload(struct RomTest* test);
+static int _runSuite(const struct mArguments* args, const struct RomTestOpts* opts);
 
-static bool _dispatchExiting = false;
-static int _exitCode = 0;
+static volatile bool _dispatchExiting = false;
 static struct mStandardLogger _logger;
 
 static void _romTestCallback(void* context);
 #ifdef M_CORE_GBA
 static void _romTestSwi16(struct ARMCore* cpu, int immediate);
 static void _romTestSwi32(struct ARMCore* cpu, int immediate);
+#endif
 
+// These are only written before any test starts
 static int _exitSwiImmediate;
 static char* _returnCodeRegister;
-
-void (*_armSwi16)(struct ARMCore* cpu, int immediate);
-void (*_armSwi32)(struct ARMCore* cpu, int immediate);
-#endif
+static uint64_t _timeout;
 
 int main(int argc, char * argv[]) {
 	signal(SIGINT, _romTestShutdown);
 
-	struct RomTestOpts romTestOpts = { 3, NULL };
+	struct RomTestOpts romTestOpts = { 3, NULL, .jobs = 4 };
 	struct mSubParser subparser = {
 		.usage = ROM_TEST_USAGE,
 		.parse = _parseRomTestOpts,
+		.parseLong = _parseLongRomTestOpts,
 		.extraOptions = ROM_TEST_OPTIONS,
+		.longOptions = _romTestLongOpts,
 		.opts = &romTestOpts
 	};
 
 	struct mArguments args;
 	bool parsed = mArgumentsParse(&args, argc, argv, &subparser, 1);
-	if (!args.fname) {
+	if (!args.fname == !romTestOpts.suite) {
 		parsed = false;
 	}
 	if (!parsed || args.showHelp) {
 		usage(argv[0], NULL, NULL, &subparser, 1);
+		mArgumentsDeinit(&args);
+		free(romTestOpts.returnCodeRegister);
 		return !parsed;
 	}
 	if (args.showVersion) {
 		version(argv[0]);
+		mArgumentsDeinit(&args);
+		free(romTestOpts.returnCodeRegister);
 		return 0;
 	}
-	core = mCoreFind(args.fname);
-	if (!core) {
-		return 1;
-	}
-	core->init(core);
-	mCoreInitConfig(core, "romTest");
-	mArgumentsApply(&args, NULL, 0, &core->config);
-
-	mCoreConfigSetDefaultValue(&core->config, "idleOptimization", "remove");
-	mCoreConfigSetDefaultIntValue(&core->config, "logToStdout", true);
-
-	mStandardLoggerInit(&_logger);
-	mStandardLoggerConfig(&_logger, &core->config);
-	mLogSetDefaultLogger(&_logger.d);
-
-	bool cleanExit = false;
-	struct mCoreCallbacks callbacks = {0};
-
+	_exitSwiImmediate = romTestOpts.exitSwiImmediate;
 	_returnCodeRegister = romTestOpts.returnCodeRegister;
-	if (!_romTestCheckResiger()) {
-		goto loadError;
-	}
-
-	switch (core->platform(core)) {
-#ifdef M_CORE_GBA
-	case mPLATFORM_GBA:
-		((struct GBA*) core->board)->hardCrash = false;
-		_exitSwiImmediate = romTestOpts.exitSwiImmediate;
+	_timeout = romTestOpts.timeout;
 
-		if (_exitSwiImmediate == 3) {
-			// Hook into SWI 3 (shutdown)
-			callbacks.shutdown = _romTestCallback;
-			core->addCoreCallbacks(core, &callbacks);
-		} else {
-			// Custom SWI hooks
-			_armSwi16 = ((struct GBA*) core->board)->cpu->irqh.swi16;
-			((struct GBA*) core->board)->cpu->irqh.swi16 = _romTestSwi16;
-			_armSwi32 = ((struct GBA*) core->board)->cpu->irqh.swi32;
-			((struct GBA*) core->board)->cpu->irqh.swi32 = _romTestSwi32;
-		}
-		break;
-#endif
-#ifdef M_CORE_GB
-	case mPLATFORM_GB:
-		callbacks.shutdown = _romTestCallback;
-		core->addCoreCallbacks(core, &callbacks);
-		break;
-#endif
-	default:
-		goto loadError;
+	if (romTestOpts.suite) {
+		int status = _runSuite(&args, &romTestOpts);
+		mArgumentsDeinit(&args);
+		free(_returnCodeRegister);
+		return status;
 	}
 
-	if (!mCoreLoadFile(core, args.fname)) {
+	bool cleanExit = false;
+	struct RomTest test = {
+		.path = args.fname,
+	};
+	if (!_romTestLoad(&test, &args, "romTest")) {
 		goto loadError;
 	}
+	struct mCore* core = test.core;
 
 #ifdef USE_DEBUGGERS
 	struct mDebugger debugger;
@@ -169,12 +208,10 @@ int main(int argc, char * argv[]) {
 	if (hasDebugger) {
 		do {
 			mDebuggerRun(&debugger);
-		} while (!_dispatchExiting && debugger.state != DEBUGGER_SHUTDOWN);
+		} while (!_dispatchExiting && !test.exiting && debugger.state != DEBUGGER_SHUTDOWN);
 	} else
 #endif
-	do {
-		core->runLoop(core);
-	} while (!_dispatchExiting);
+	_romTestRun(&test);
 
 	core->unloadROM(core);
 
@@ -184,18 +221,15 @@ int main(int argc, char * argv[]) {
 		mDebuggerDeinit(&debugger);
 	}
 #endif
-	cleanExit = true;
+	cleanExit = test.result != ROM_TEST_TIMEOUT;
 
 loadError:
+	_romTestUnload(&test);
 	mArgumentsDeinit(&args);
 	mStandardLoggerDeinit(&_logger);
-	mCoreConfigDeinit(&core->config);
-	core->deinit(core);
-	if (_returnCodeRegister) {
-		free(_returnCodeRegister);
-	}
+	free(_returnCodeRegister);
 
-	return cleanExit ? _exitCode : 1;
+	return cleanExit ? test.exitCode : 1;
 }
 
 static void _romTestShutdown(int signal) {
@@ -203,7 +237,7 @@ static void _romTestShutdown(int signal) {
 	_dispatchExiting = true;
 }
 
-static bool _romTestCheckResiger(void) {
+static bool _romTestCheckResiger(struct mCore* core) {
 	if (!_returnCodeRegister) {
 		return true;
 	}
@@ -249,38 +283,466 @@ static bool _romTestCheckResiger(void) {
 	return true;
 }
 
-static void _romTestCallback(void* context) {
-	UNUSED(context);
+// Creates the core for test->path and hooks up the exit conditions; test->core is left set even
+// if this fails, so that _romTestUnload can clean it up
+static bool _romTestLoad(struct RomTest* test, const struct mArguments* args, const char* configName) {
+	struct mCore* core = mCoreFind(test->path);
+	if (!core) {
+		return false;
+	}
+	test->core = core;
+	core->init(core);
+	mCoreInitConfig(core, configName);
+	mArgumentsApply(args, NULL, 0, &core->config);
+
+	mCoreConfigSetDefaultValue(&core->config, "idleOptimization", "remove");
+	if (!_logger.d.log) {
+		// Running a single ROM, so its config decides where logging goes
+		mCoreConfigSetDefaultIntValue(&core->config, "logToStdout", true);
+		mStandardLoggerInit(&_logger);
+		mStandardLoggerConfig(&_logger, &core->config);
+		mLogSetDefaultLogger(&_logger.d);
+	}
+
+	if (!_romTestCheckResiger(core)) {
+		return false;
+	}
+
+	test->callbacks.context = test;
+	switch (core->platform(core)) {
+#ifdef M_CORE_GBA
+	case mPLATFORM_GBA:
+		((struct GBA*) core->board)->hardCrash = false;
+
+		if (_exitSwiImmediate == 3) {
+			// Hook into SWI 3 (shutdown)
+			test->callbacks.shutdown = _romTestCallback;
+		} else {
+			// Custom SWI hooks
+			test->armSwi16 = ((struct GBA*) core->board)->cpu->irqh.swi16;
+			((struct GBA*) core->board)->cpu->irqh.swi16 = _romTestSwi16;
+			test->armSwi32 = ((struct GBA*) core->board)->cpu->irqh.swi32;
+			((struct GBA*) core->board)->cpu->irqh.swi32 = _romTestSwi32;
+		}
+		break;
+#endif
+#ifdef M_CORE_GB
+	case mPLATFORM_GB:
+		test->callbacks.shutdown = _romTestCallback;
+		break;
+#endif
+	default:
+		return false;
+	}
+	// The SWI hooks find their test through these callbacks, so they're added even without a shutdown hook
+	core->addCoreCallbacks(core, &test->callbacks);
+
+	return mCoreLoadFile(core, test->path);
+}
+
+static void _romTestRun(struct RomTest* test) {
+	struct mCore* core = test->core;
+	do {
+		core->runLoop(core);
+		test->cycles = mTimingGlobalTime(core->timing);
+		if (_timeout && test->cycles >= _timeout && !test->exiting) {
+			test->result = ROM_TEST_TIMEOUT;
+			return;
+		}
+	} while (!_dispatchExiting && !test->exiting);
+	if (test->exiting) {
+		test->result = test->exitCode ? ROM_TEST_FAIL : ROM_TEST_PASS;
+	} else {
+		test->result = ROM_TEST_ERROR;
+	}
+}
+
+static void _romTestUnload(struct RomTest* test) {
+	struct mCore* core = test->core;
+	if (!core) {
+		return;
+	}
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	test->core = NULL;
+}
+
+static void _romTestExit(struct RomTest* test) {
 	if (_returnCodeRegister) {
-		core->readRegister(core, _returnCodeRegister, &_exitCode);
+		test->core->readRegister(test->core, _returnCodeRegister, &test->exitCode);
 	}
-	_dispatchExiting = true;
+	test->exiting = true;
+}
+
+static void _romTestCallback(void* context) {
+	_romTestExit(context);
 }
 
 #ifdef M_CORE_GBA
+static struct RomTest* _romTestForCpu(struct ARMCore* cpu) {
+	struct GBA* gba = (struct GBA*) cpu->master;
+	return mCoreCallbacksListGetPointer(&gba->coreCallbacks, 0)->context;
+}
+
 static void _romTestSwi16(struct ARMCore* cpu, int immediate) {
+	struct RomTest* test = _romTestForCpu(cpu);
 	if (immediate == _exitSwiImmediate) {
-		if (_returnCodeRegister) {
-			core->readRegister(core, _returnCodeRegister, &_exitCode);
-		}
-		_dispatchExiting = true;
+		_romTestExit(test);
 		return;
 	}
-	_armSwi16(cpu, immediate);
+	test->armSwi16(cpu, immediate);
 }
 
 static void _romTestSwi32(struct ARMCore* cpu, int immediate) {
+	struct RomTest* test = _romTestForCpu(cpu);
 	if (immediate == _exitSwiImmediate) {
-		if (_returnCodeRegister) {
-			core->readRegister(core, _returnCodeRegister, &_exitCode);
-		}
-		_dispatchExiting = true;
+		_romTestExit(test);
 		return;
 	}
-	_armSwi32(cpu, immediate);
+	test->armSwi32(cpu, immediate);
 }
 #endif
 
+static bool _loadSuite(struct RomTestSuite* suite, const char* listPath) {
+	struct VFile* vf = VFileOpen(listPath, O_RDONLY);
+	if (!vf) {
+		return false;
+	}
+	char dirname[PATH_MAX];
+	separatePath(listPath, dirname, NULL, NULL);
+
+	size_t capacity = 0;
+	char line[PATH_MAX];
+	while (vf->readline(vf, line, sizeof(line)) > 0) {
+		size_t len = strlen(line);
+		while (len && isspace((unsigned char) line[len - 1])) {
+			line[--len] = '\0';
+		}
+		if (!len || line[0] == '#') {
+			continue;
+		}
+		if (suite->nTests == capacity) {
+			capacity = capacity ? capacity * 2 : 64;
+			suite->tests = realloc(suite->tests, capacity * sizeof(*suite->tests));
+		}
+		struct RomTest* test = &suite->tests[suite->nTests];
+		memset(test, 0, sizeof(*test));
+		if (line[0] == '/' || strchr(line, ':')) {
+			test->path = strdup(line);
+		} else {
+			// Relative paths are relative to the list, not to wherever the suite is run from
+			size_t size = strlen(dirname) + len + 2;
+			test->path = malloc(size);
+			snprintf(test->path, size, "%s" PATH_SEP "%s", dirname, line);
+		}
+		++suite->nTests;
+	}
+	vf->close(vf);
+	return true;
+}
+
+static void _cacheKey(const struct RomTest* test, char* key, size_t size) {
+	snprintf(key, size, "%08X.%i.%s.%" PRIu64, test->crc32, _exitSwiImmediate, _returnCodeRegister ? _returnCodeRegister : "", _timeout);
+}
+
+static bool _romTestHash(struct RomTest* test) {
+	struct VFile* vf = VFileOpen(test->path, O_RDONLY);
+	if (!vf) {
+		return false;
+	}
+	test->crc32 = fileCrc32(vf, vf->size(vf));
+	vf->close(vf);
+	return true;
+}
+
+static void _applyCache(struct RomTestSuite* suite, const struct Configuration* cache) {
+	size_t i;
+	for (i = 0; i < suite->nTests; ++i) {
+		struct RomTest* test = &suite->tests[i];
+		if (!_romTestHash(test)) {
+			continue;
+		}
+		char key[128];
+		_cacheKey(test, key, sizeof(key));
+		const char* value = ConfigurationGetValue(cache, gitCommit, key);
+		if (!value) {
+			continue;
+		}
+		unsigned long long cycles;
+		if (sscanf(value, "pass %llu", &cycles) == 1) {
+			test->result = ROM_TEST_PASS;
+		} else if (sscanf(value, "fail %i %llu", &test->exitCode, &cycles) == 2) {
+			test->result = ROM_TEST_FAIL;
+		} else if (sscanf(value, "timeout %llu", &cycles) == 1) {
+			test->result = ROM_TEST_TIMEOUT;
+		} else {
+			continue;
+		}
+		test->cycles = cycles;
+		test->cached = true;
+	}
+}
+
+static void _saveCache(const struct RomTestSuite* suite, const char* path) {
+	// Only this build's results are kept, so the cache doesn't grow with every build
+	struct Configuration cache;
+	ConfigurationInit(&cache);
+	size_t i;
+	for (i = 0; i < suite->nTests; ++i) {
+		const struct RomTest* test = &suite->tests[i];
+		char key[128];
+		char value[64];
+		switch (test->result) {
+		case ROM_TEST_PASS:
+			snprintf(value, sizeof(value), "pass %" PRIu64, test->cycles);
+			break;
+		case ROM_TEST_FAIL:
+			snprintf(value, sizeof(value), "fail %i %" PRIu64, test->exitCode, test->cycles);
+			break;
+		case ROM_TEST_TIMEOUT:
+			snprintf(value, sizeof(value), "timeout %" PRIu64, test->cycles);
+			break;
+		default:
+			continue;
+		}
+		_cacheKey(test, key, sizeof(key));
+		ConfigurationSetValue(&cache, gitCommit, key, value);
+	}
+	ConfigurationWrite(&cache, path);
+	ConfigurationDeinit(&cache);
+}
+
+static void _runSuiteTests(struct RomTestSuite* suite) {
+	while (!_dispatchExiting) {
+		size_t index = ATOMIC_ADD(suite->nextTest, 1) - 1;
+		if (index >= suite->nTests) {
+			break;
+		}
+		struct RomTest* test = &suite->tests[index];
+		if (test->cached) {
+			continue;
+		}
+		struct timeval start;
+		struct timeval end;
+		gettimeofday(&start, 0);
+		if (_romTestLoad(test, suite->args, "romTest")) {
+			test->core->reset(test->core);
+			_romTestRun(test);
+			test->core->unloadROM(test->core);
+		} else {
+			test->result = ROM_TEST_ERROR;
+		}
+		_romTestUnload(test);
+		gettimeofday(&end, 0);
+		test->seconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+	}
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _romTestThread(void* context) {
+	ThreadSetName("ROM Test Worker");
+	_runSuiteTests(context);
+	THREAD_EXIT(0);
+}
+#endif
+
+static void _writeXMLString(FILE* out, const char* string) {
+	for (; *string; ++string) {
+		switch (*string) {
+		case '<':
+			fputs("&lt;", out);
+			break;
+		case '>':
+			fputs("&gt;", out);
+			break;
+		case '&':
+			fputs("&amp;", out);
+			break;
+		case '"':
+			fputs("&quot;", out);
+			break;
+		default:
+			fputc(*string, out);
+			break;
+		}
+	}
+}
+
+static void _writeJSONString(FILE* out, const char* string) {
+	fputc('"', out);
+	for (; *string; ++string) {
+		if (*string == '"' || *string == '\\') {
+			fprintf(out, "\\%c", *string);
+		} else if ((unsigned char) *string < 0x20) {
+			fprintf(out, "\\u%04x", *string);
+		} else {
+			fputc(*string, out);
+		}
+	}
+	fputc('"', out);
+}
+
+static bool _writeJUnit(const struct RomTestSuite* suite, const char* path, const size_t* counts) {
+	FILE* out = fopen(path, "w");
+	if (!out) {
+		return false;
+	}
+	double seconds = 0;
+	size_t i;
+	for (i = 0; i < suite->nTests; ++i) {
+		seconds += suite->tests[i].seconds;
+	}
+	fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n", out);
+	fprintf(out, "\t<testsuite name=\"mgba-rom-test\" tests=\"%" PRIz "u\" failures=\"%" PRIz "u\" errors=\"%" PRIz "u\" skipped=\"%" PRIz "u\" time=\"%.3f\">\n",
+	        suite->nTests, counts[ROM_TEST_FAIL] + counts[ROM_TEST_TIMEOUT], counts[ROM_TEST_ERROR], counts[ROM_TEST_PENDING], seconds);
+	for (i = 0; i < suite->nTests; ++i) {
+		const struct RomTest* test = &suite->tests[i];
+		fputs("\t\t<testcase name=\"", out);
+		_writeXMLString(out, test->path);
+		fprintf(out, "\" classname=\"mgba-rom-test\" time=\"%.3f\"", test->seconds);
+		switch (test->result) {
+		case ROM_TEST_PASS:
+			fputs("/>\n", out);
+			continue;
+		case ROM_TEST_PENDING:
+			fputs("><skipped/>", out);
+			break;
+		case ROM_TEST_FAIL:
+			fprintf(out, "><failure message=\"Exit code %i\"/>", test->exitCode);
+			break;
+		case ROM_TEST_TIMEOUT:
+			fprintf(out, "><failure message=\"Timed out after %" PRIu64 " cycles\"/>", test->cycles);
+			break;
+		case ROM_TEST_ERROR:
+			fputs("><error message=\"Could not run ROM\"/>", out);
+			break;
+		}
+		fputs("</testcase>\n", out);
+	}
+	fputs("\t</testsuite>\n</testsuites>\n", out);
+	fclose(out);
+	return true;
+}
+
+static bool _writeJSON(const struct RomTestSuite* suite, const char* path, const size_t* counts) {
+	FILE* out = fopen(path, "w");
+	if (!out) {
+		return false;
+	}
+	fputs("{\n\t\"build\": ", out);
+	_writeJSONString(out, gitCommit);
+	fputs(",\n\t\"tests\": [", out);
+	size_t i;
+	for (i = 0; i < suite->nTests; ++i) {
+		const struct RomTest* test = &suite->tests[i];
+		fputs(i ? ",\n\t\t{\"rom\": " : "\n\t\t{\"rom\": ", out);
+		_writeJSONString(out, test->path);
+		fprintf(out, ", \"result\": \"%s\", \"exitCode\": %i, \"cycles\": %" PRIu64 ", \"time\": %.3f, \"cached\": %s}",
+		        _resultNames[test->result], test->exitCode, test->cycles, test->seconds, test->cached ? "true" : "false");
+	}
+	fprintf(out, "\n\t],\n\t\"passed\": %" PRIz "u,\n\t\"failed\": %" PRIz "u,\n\t\"timedOut\": %" PRIz "u,\n\t\"errors\": %" PRIz "u\n}\n",
+	        counts[ROM_TEST_PASS], counts[ROM_TEST_FAIL], counts[ROM_TEST_TIMEOUT], counts[ROM_TEST_ERROR]);
+	fclose(out);
+	return true;
+}
+
+static int _runSuite(const struct mArguments* args, const struct RomTestOpts* opts) {
+	struct RomTestSuite suite = {
+		.args = args,
+	};
+	if (!_loadSuite(&suite, opts->suite)) {
+		fprintf(stderr, "Could not read test list %s\n", opts->suite);
+		return 1;
+	}
+
+	// Tests run on their own threads, so there's one logger for all of them
+	struct mCoreConfig config;
+	mCoreConfigInit(&config, "romTest");
+	mArgumentsApply(args, NULL, 0, &config);
+	mStandardLoggerInit(&_logger);
+	mStandardLoggerConfig(&_logger, &config);
+	mLogSetDefaultLogger(&_logger.d);
+	mCoreConfigDeinit(&config);
+
+	struct Configuration cache;
+	ConfigurationInit(&cache);
+	if (opts->cache) {
+		ConfigurationRead(&cache, opts->cache);
+		_applyCache(&suite, &cache);
+	}
+
+#ifndef DISABLE_THREADING
+	size_t nThreads = opts->jobs;
+	if (nThreads > suite.nTests) {
+		nThreads = suite.nTests;
+	}
+	Thread* threads = NULL;
+	if (nThreads > 1) {
+		// The main thread runs tests too
+		--nThreads;
+		threads = calloc(nThreads, sizeof(*threads));
+		size_t i;
+		for (i = 0; i < nThreads; ++i) {
+			ThreadCreate(&threads[i], _romTestThread, &suite);
+		}
+	}
+	_runSuiteTests(&suite);
+	if (threads) {
+		size_t i;
+		for (i = 0; i < nThreads; ++i) {
+			ThreadJoin(&threads[i]);
+		}
+		free(threads);
+	}
+#else
+	_runSuiteTests(&suite);
+#endif
+
+	size_t counts[ROM_TEST_ERROR + 1] = {0};
+	size_t i;
+	for (i = 0; i < suite.nTests; ++i) {
+		const struct RomTest* test = &suite.tests[i];
+		++counts[test->result];
+		switch (test->result) {
+		case ROM_TEST_PENDING:
+			continue;
+		case ROM_TEST_FAIL:
+			printf("FAIL    %s (exit code %i)", test->path, test->exitCode);
+			break;
+		default:
+			printf("%-7s %s", test->result == ROM_TEST_PASS ? "PASS" : test->result == ROM_TEST_TIMEOUT ? "TIMEOUT" : "ERROR", test->path);
+			break;
+		}
+		puts(test->cached ? " (cached)" : "");
+	}
+	printf("%" PRIz "u passed, %" PRIz "u failed, %" PRIz "u timed out, %" PRIz "u errors\n",
+	       counts[ROM_TEST_PASS], counts[ROM_TEST_FAIL], counts[ROM_TEST_TIMEOUT], counts[ROM_TEST_ERROR]);
+
+	bool ok = true;
+	if (opts->junit && !_writeJUnit(&suite, opts->junit, counts)) {
+		fprintf(stderr, "Could not write %s\n", opts->junit);
+		ok = false;
+	}
+	if (opts->json && !_writeJSON(&suite, opts->json, counts)) {
+		fprintf(stderr, "Could not write %s\n", opts->json);
+		ok = false;
+	}
+	if (opts->cache) {
+		_saveCache(&suite, opts->cache);
+	}
+	ConfigurationDeinit(&cache);
+
+	if (counts[ROM_TEST_PASS] != suite.nTests) {
+		ok = false;
+	}
+	for (i = 0; i < suite.nTests; ++i) {
+		free(suite.tests[i].path);
+	}
+	free(suite.tests);
+	mStandardLoggerDeinit(&_logger);
+	return !ok;
+}
+
 static bool _parseRomTestOpts(struct mSubParser* parser, int option, const char* arg) {
 	struct RomTestOpts* opts = parser->opts;
 	errno = 0;
@@ -288,13 +750,40 @@ static bool _parseRomTestOpts(struct mSubParser* parser, int option, const char*
 	case 'S':
 		return _parseSwi(arg, &opts->exitSwiImmediate);
 	case 'R':
+		free(opts->returnCodeRegister);
 		opts->returnCodeRegister = strdup(arg);
 		return true;
+	case 'T':
+		opts->timeout = strtoull(arg, NULL, 0);
+		return !errno;
+	case 'L':
+		opts->suite = arg;
+		return true;
+	case 'j':
+		opts->jobs = strtoul(arg, NULL, 0);
+		return opts->jobs > 0;
 	default:
 		return false;
 	}
 }
 
+static bool _parseLongRomTestOpts(struct mSubParser* parser, const char* option, const char* arg) {
+	struct RomTestOpts* opts = parser->opts;
+	if (strcmp(option, "junit") == 0) {
+		opts->junit = arg;
+		return true;
+	}
+	if (strcmp(option, "json") == 0) {
+		opts->json = arg;
+		return true;
+	}
+	if (strcmp(option, "cache") == 0) {
+		opts->cache = arg;
+		return true;
+	}
+	return false;
+}
+
 static bool _parseSwi(const char* swiStr, int* oSwi) {
 	char* parseEnd;
 	long swi = strtol(swiStr, &parseEnd, 0);
@@ -0,0 +1,576 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/batch.h>
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/core/log.h>
+#include <mgba/core/serialize.h>
+#include <mgba/feature/commandline.h>
+
+#include <mgba-util/socket.h>
+#include <mgba-util/vector.h>
+#include <mgba-util/vfs.h>
+
+#include <signal.h>
+
+#define SERVE_OPTIONS "j:P:"
+#define SERVE_USAGE \
+	"Server options:\n" \
+	"  -j WORKERS       Threads that run sessions alongside the main one (default: 3)\n" \
+	"  -P PORT          Port to listen on (default: 7217)"
+
+#define HEADER_SIZE 12
+#define RECV_CHUNK 0x10000
+#define MAX_PAYLOAD 0x4000000
+#define MAX_READ 0x100000
+
+// Every message, in either direction, starts with a header of little-endian fields: the payload
+// size (32 bits), a tag (32 bits), the opcode or status (16 bits) and the session (16 bits).
+// Responses carry the tag and session of the request they answer, and a status of 0 on success.
+// Clients can send any number of requests without waiting for responses. A connection's requests
+// are handled in order, except that one waiting on a step only holds up requests for the same
+// session; steps waiting at the same time are run together across the batch workers.
+enum ServeOpcode {
+	// Payload: path to the ROM. The response's session is the new session.
+	SERVE_OP_OPEN = 1,
+	SERVE_OP_CLOSE = 2,
+	// Payload: a savestate, as returned by SERVE_OP_SAVE_STATE
+	SERVE_OP_LOAD_STATE = 3,
+	// Response payload: a savestate
+	SERVE_OP_SAVE_STATE = 4,
+	// Payload: frames (32 bits), keys (32 bits). Response payload: frame counter (32 bits).
+	SERVE_OP_STEP = 5,
+	// Payload: address (32 bits), size (32 bits), segment (32 bits, -1 for the mapped one).
+	// Response payload: the bytes read.
+	SERVE_OP_READ = 6,
+	// Response payload: width (16 bits), height (16 bits), then the last frame's pixels, in the
+	// build's native color format
+	SERVE_OP_FRAME = 7,
+};
+
+enum ServeStatus {
+	SERVE_OK = 0,
+	SERVE_BAD_REQUEST = 1,
+	SERVE_NO_SESSION = 2,
+	SERVE_FAILED = 3,
+};
+
+struct ServeConnection {
+	Socket socket;
+	uint8_t* buffer;
+	size_t size;
+	size_t capacity;
+	bool closed;
+};
+
+struct ServeSession {
+	struct mCore* core;
+	struct ServeConnection* owner;
+	color_t* videoBuffer;
+	unsigned stride;
+
+	// A step is waiting for the batch while frames is nonzero
+	unsigned frames;
+	uint32_t keys;
+	uint32_t tag;
+};
+
+DECLARE_VECTOR(ServeConnectionList, struct ServeConnection*);
+DEFINE_VECTOR(ServeConnectionList, struct ServeConnection*);
+DECLARE_VECTOR(ServeSessionList, struct ServeSession*);
+DEFINE_VECTOR(ServeSessionList, struct ServeSession*);
+
+struct ServeOpts {
+	unsigned workers;
+	int port;
+};
+
+struct ServeContext {
+	const struct mArguments* args;
+	Socket server;
+	struct ServeConnectionList connections;
+	// A session's ID is its index plus one; closed sessions leave a NULL behind
+	struct ServeSessionList sessions;
+	struct mCoreBatch batch;
+};
+
+static bool _parseServeOpts(struct mSubParser* parser, int option, const char* arg);
+static void _serveShutdown(int signal);
+
+static volatile bool _dispatchExiting = false;
+static struct mStandardLogger _logger;
+
+static void _serveShutdown(int signal) {
+	UNUSED(signal);
+	_dispatchExiting = true;
+}
+
+static bool _parseServeOpts(struct mSubParser* parser, int option, const char* arg) {
+	struct ServeOpts* opts = parser->opts;
+	switch (option) {
+	case 'j':
+		opts->workers = strtoul(arg, NULL, 0);
+		return true;
+	case 'P':
+		opts->port = strtol(arg, NULL, 0);
+		return opts->port > 0 && opts->port < 0x10000;
+	default:
+		return false;
+	}
+}
+
+static bool _sendAll(struct ServeConnection* conn, const void* data, size_t size) {
+	const uint8_t* bytes = data;
+	while (size) {
+		ssize_t sent = SocketSend(conn->socket, bytes, size);
+		if (sent <= 0) {
+			conn->closed = true;
+			return false;
+		}
+		bytes += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+static void _respond(struct ServeConnection* conn, uint32_t tag, enum ServeStatus status, uint16_t session, const void* payload, size_t size) {
+	if (conn->closed) {
+		return;
+	}
+	uint8_t header[HEADER_SIZE];
+	STORE_32LE(size, 0, header);
+	STORE_32LE(tag, 4, header);
+	STORE_16LE(status, 8, header);
+	STORE_16LE(session, 10, header);
+	if (_sendAll(conn, header, sizeof(header)) && size) {
+		_sendAll(conn, payload, size);
+	}
+}
+
+static struct ServeSession* _getSession(struct ServeContext* context, struct ServeConnection* conn, uint16_t id) {
+	if (!id || id > ServeSessionListSize(&context->sessions)) {
+		return NULL;
+	}
+	struct ServeSession* session = *ServeSessionListGetPointer(&context->sessions, id - 1);
+	if (!session || session->owner != conn) {
+		return NULL;
+	}
+	return session;
+}
+
+static void _closeSession(struct ServeContext* context, size_t index) {
+	struct ServeSession* session = *ServeSessionListGetPointer(&context->sessions, index);
+	mCoreConfigDeinit(&session->core->config);
+	session->core->deinit(session->core);
+	free(session->videoBuffer);
+	free(session);
+	*ServeSessionListGetPointer(&context->sessions, index) = NULL;
+}
+
+static uint16_t _openSession(struct ServeContext* context, struct ServeConnection* conn, const uint8_t* payload, size_t size) {
+	char path[PATH_MAX];
+	if (!size || size >= sizeof(path)) {
+		return 0;
+	}
+	memcpy(path, payload, size);
+	path[size] = '\0';
+
+	size_t index;
+	for (index = 0; index < ServeSessionListSize(&context->sessions); ++index) {
+		if (!*ServeSessionListGetPointer(&context->sessions, index)) {
+			break;
+		}
+	}
+	if (index >= 0xFFFF) {
+		return 0;
+	}
+
+	struct mCore* core = mCoreFind(path);
+	if (!core) {
+		return 0;
+	}
+	core->init(core);
+	mCoreInitConfig(core, "serve");
+	mArgumentsApply(context->args, NULL, 0, &core->config);
+	mCoreConfigSetDefaultValue(&core->config, "idleOptimization", "detect");
+	mCoreLoadConfig(core);
+
+	struct ServeSession* session = calloc(1, sizeof(*session));
+	session->core = core;
+	session->owner = conn;
+	unsigned height;
+	core->baseVideoSize(core, &session->stride, &height);
+	session->videoBuffer = calloc(session->stride * height, BYTES_PER_PIXEL);
+	core->setVideoBuffer(core, session->videoBuffer, session->stride);
+	if (!mCoreLoadFile(core, path)) {
+		mCoreConfigDeinit(&core->config);
+		core->deinit(core);
+		free(session->videoBuffer);
+		free(session);
+		return 0;
+	}
+	core->reset(core);
+
+	if (index == ServeSessionListSize(&context->sessions)) {
+		ServeSessionListAppend(&context->sessions);
+	}
+	*ServeSessionListGetPointer(&context->sessions, index) = session;
+	return index + 1;
+}
+
+static void _readMemory(struct ServeConnection* conn, uint32_t tag, uint16_t id, struct ServeSession* session, const uint8_t* payload, size_t size) {
+	if (size != 12) {
+		_respond(conn, tag, SERVE_BAD_REQUEST, id, NULL, 0);
+		return;
+	}
+	uint32_t address;
+	uint32_t length;
+	int32_t segment;
+	LOAD_32LE(address, 0, payload);
+	LOAD_32LE(length, 4, payload);
+	LOAD_32LE(segment, 8, payload);
+	if (length > MAX_READ) {
+		_respond(conn, tag, SERVE_BAD_REQUEST, id, NULL, 0);
+		return;
+	}
+	uint8_t* bytes = malloc(length ? length : 1);
+	uint32_t i;
+	for (i = 0; i < length; ++i) {
+		bytes[i] = session->core->rawRead8(session->core, address + i, segment);
+	}
+	_respond(conn, tag, SERVE_OK, id, bytes, length);
+	free(bytes);
+}
+
+static void _sendFrame(struct ServeConnection* conn, uint32_t tag, uint16_t id, struct ServeSession* session) {
+	unsigned width;
+	unsigned height;
+	session->core->currentVideoSize(session->core, &width, &height);
+	size_t rowSize = width * BYTES_PER_PIXEL;
+	size_t size = 4 + rowSize * height;
+	uint8_t* frame = malloc(size);
+	STORE_16LE(width, 0, frame);
+	STORE_16LE(height, 2, frame);
+	unsigned y;
+	for (y = 0; y < height; ++y) {
+		memcpy(&frame[4 + rowSize * y], &session->videoBuffer[session->stride * y], rowSize);
+	}
+	_respond(conn, tag, SERVE_OK, id, frame, size);
+	free(frame);
+}
+
+static void _saveState(struct ServeConnection* conn, uint32_t tag, uint16_t id, struct ServeSession* session) {
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	if (!mCoreSaveStateNamed(session->core, vf, SAVESTATE_SAVEDATA | SAVESTATE_RTC)) {
+		vf->close(vf);
+		_respond(conn, tag, SERVE_FAILED, id, NULL, 0);
+		return;
+	}
+	size_t size = vf->size(vf);
+	void* state = vf->map(vf, size, MAP_READ);
+	_respond(conn, tag, SERVE_OK, id, state, size);
+	vf->unmap(vf, state, size);
+	vf->close(vf);
+}
+
+// Returns false if the request has to wait for a step of its session to finish first
+static bool _handleRequest(struct ServeContext* context, struct ServeConnection* conn, const uint8_t* request) {
+	uint32_t size;
+	uint32_t tag;
+	uint16_t op;
+	uint16_t id;
+	LOAD_32LE(size, 0, request);
+	LOAD_32LE(tag, 4, request);
+	LOAD_16LE(op, 8, request);
+	LOAD_16LE(id, 10, request);
+	const uint8_t* payload = &request[HEADER_SIZE];
+
+	if (op == SERVE_OP_OPEN) {
+		id = _openSession(context, conn, payload, size);
+		_respond(conn, tag, id ? SERVE_OK : SERVE_FAILED, id, NULL, 0);
+		return true;
+	}
+
+	struct ServeSession* session = _getSession(context, conn, id);
+	if (!session) {
+		_respond(conn, tag, SERVE_NO_SESSION, id, NULL, 0);
+		return true;
+	}
+	if (session->frames) {
+		return false;
+	}
+
+	struct VFile* vf;
+	bool success;
+	switch (op) {
+	case SERVE_OP_CLOSE:
+		_closeSession(context, id - 1);
+		_respond(conn, tag, SERVE_OK, id, NULL, 0);
+		break;
+	case SERVE_OP_LOAD_STATE:
+		vf = VFileFromConstMemory(payload, size);
+		success = mCoreLoadStateNamed(session->core, vf, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
+		vf->close(vf);
+		_respond(conn, tag, success ? SERVE_OK : SERVE_FAILED, id, NULL, 0);
+		break;
+	case SERVE_OP_SAVE_STATE:
+		_saveState(conn, tag, id, session);
+		break;
+	case SERVE_OP_STEP:
+		if (size != 8) {
+			_respond(conn, tag, SERVE_BAD_REQUEST, id, NULL, 0);
+			break;
+		}
+		LOAD_32LE(session->frames, 0, payload);
+		LOAD_32LE(session->keys, 4, payload);
+		session->tag = tag;
+		if (!session->frames) {
+			uint8_t counter[4];
+			STORE_32LE(session->core->frameCounter(session->core), 0, counter);
+			_respond(conn, tag, SERVE_OK, id, counter, sizeof(counter));
+		}
+		break;
+	case SERVE_OP_READ:
+		_readMemory(conn, tag, id, session, payload, size);
+		break;
+	case SERVE_OP_FRAME:
+		_sendFrame(conn, tag, id, session);
+		break;
+	default:
+		_respond(conn, tag, SERVE_BAD_REQUEST, id, NULL, 0);
+		break;
+	}
+	return true;
+}
+
+static void _handleRequests(struct ServeContext* context, struct ServeConnection* conn) {
+	size_t offset = 0;
+	while (!conn->closed && conn->size - offset >= HEADER_SIZE) {
+		uint32_t size;
+		LOAD_32LE(size, offset, conn->buffer);
+		if (size > MAX_PAYLOAD) {
+			conn->closed = true;
+			break;
+		}
+		if (conn->size - offset < HEADER_SIZE + size) {
+			break;
+		}
+		if (!_handleRequest(context, conn, &conn->buffer[offset])) {
+			break;
+		}
+		offset += HEADER_SIZE + size;
+	}
+	if (offset) {
+		memmove(conn->buffer, &conn->buffer[offset], conn->size - offset);
+		conn->size -= offset;
+	}
+}
+
+static bool _runSteps(struct ServeContext* context) {
+	bool ran = false;
+	size_t nSessions = ServeSessionListSize(&context->sessions);
+	while (true) {
+		// Steps for the same number of frames are run together; most clients use the same count
+		unsigned frames = 0;
+		size_t i;
+		mCoreBatchClear(&context->batch);
+		for (i = 0; i < nSessions; ++i) {
+			struct ServeSession* session = *ServeSessionListGetPointer(&context->sessions, i);
+			if (!session || !session->frames || (frames && session->frames != frames)) {
+				continue;
+			}
+			frames = session->frames;
+			session->core->setKeys(session->core, session->keys);
+			mCoreBatchAddCore(&context->batch, session->core);
+		}
+		if (!frames) {
+			break;
+		}
+		mCoreBatchRunFrames(&context->batch, frames);
+		ran = true;
+		for (i = 0; i < nSessions; ++i) {
+			struct ServeSession* session = *ServeSessionListGetPointer(&context->sessions, i);
+			if (!session || session->frames != frames) {
+				continue;
+			}
+			session->frames = 0;
+			uint8_t counter[4];
+			STORE_32LE(session->core->frameCounter(session->core), 0, counter);
+			_respond(session->owner, session->tag, SERVE_OK, i + 1, counter, sizeof(counter));
+		}
+	}
+	return ran;
+}
+
+static void _receive(struct ServeConnection* conn) {
+	if (conn->capacity - conn->size < RECV_CHUNK) {
+		conn->capacity = conn->size + RECV_CHUNK;
+		conn->buffer = realloc(conn->buffer, conn->capacity);
+	}
+	ssize_t received = SocketRecv(conn->socket, &conn->buffer[conn->size], RECV_CHUNK);
+	if (received <= 0) {
+		conn->closed = true;
+		return;
+	}
+	conn->size += received;
+}
+
+static void _accept(struct ServeContext* context) {
+	Socket socket = SocketAccept(context->server, NULL);
+	if (SOCKET_FAILED(socket)) {
+		return;
+	}
+	SocketSetTCPPush(socket, 1);
+	struct ServeConnection* conn = calloc(1, sizeof(*conn));
+	conn->socket = socket;
+	*ServeConnectionListAppend(&context->connections) = conn;
+}
+
+static void _reapConnections(struct ServeContext* context) {
+	size_t i;
+	for (i = 0; i < ServeConnectionListSize(&context->connections);) {
+		struct ServeConnection* conn = *ServeConnectionListGetPointer(&context->connections, i);
+		if (!conn->closed) {
+			++i;
+			continue;
+		}
+		size_t j;
+		for (j = 0; j < ServeSessionListSize(&context->sessions); ++j) {
+			struct ServeSession* session = *ServeSessionListGetPointer(&context->sessions, j);
+			if (session && session->owner == conn) {
+				_closeSession(context, j);
+			}
+		}
+		SocketClose(conn->socket);
+		free(conn->buffer);
+		free(conn);
+		ServeConnectionListShift(&context->connections, i, 1);
+	}
+}
+
+static void _serve(struct ServeContext* context) {
+	Socket* reads = NULL;
+	size_t nReads = 0;
+	while (!_dispatchExiting) {
+		size_t nConnections = ServeConnectionListSize(&context->connections);
+		if (nReads < nConnections + 1) {
+			nReads = nConnections + 1;
+			reads = realloc(reads, nReads * sizeof(*reads));
+		}
+		reads[0] = context->server;
+		size_t i;
+		for (i = 0; i < nConnections; ++i) {
+			reads[i + 1] = (*ServeConnectionListGetPointer(&context->connections, i))->socket;
+		}
+		// Wake up now and then to check whether we've been asked to quit
+		if (SocketPoll(nConnections + 1, reads, NULL, NULL, 1000) <= 0) {
+			continue;
+		}
+		for (i = 0; i < nConnections + 1 && !SOCKET_FAILED(reads[i]); ++i) {
+			if (reads[i] == context->server) {
+				_accept(context);
+				continue;
+			}
+			size_t j;
+			for (j = 0; j < nConnections; ++j) {
+				struct ServeConnection* conn = *ServeConnectionListGetPointer(&context->connections, j);
+				if (conn->socket == reads[i]) {
+					_receive(conn);
+					break;
+				}
+			}
+		}
+		_reapConnections(context);
+
+		// Finishing a round of steps can unblock requests that were waiting on it
+		do {
+			for (i = 0; i < ServeConnectionListSize(&context->connections); ++i) {
+				_handleRequests(context, *ServeConnectionListGetPointer(&context->connections, i));
+			}
+		} while (_runSteps(context));
+		_reapConnections(context);
+	}
+	free(reads);
+}
+
+int main(int argc, char * argv[]) {
+	signal(SIGINT, _serveShutdown);
+#ifdef SIGPIPE
+	// Clients that hang up are noticed when sending to them fails
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	struct ServeOpts serveOpts = {
+		.workers = 3,
+		.port = 7217,
+	};
+	struct mSubParser subparser = {
+		.usage = SERVE_USAGE,
+		.parse = _parseServeOpts,
+		.extraOptions = SERVE_OPTIONS,
+		.opts = &serveOpts
+	};
+
+	int status = 1;
+	struct mArguments args;
+	bool parsed = mArgumentsParse(&args, argc, argv, &subparser, 1);
+	if (!parsed || args.showHelp) {
+		usage(argv[0], NULL, NULL, &subparser, 1);
+		status = !parsed;
+		goto cleanup;
+	}
+	if (args.showVersion) {
+		version(argv[0]);
+		status = 0;
+		goto cleanup;
+	}
+
+	// Sessions run on the batch workers, so there's one logger for all of them
+	struct mCoreConfig config;
+	mCoreConfigInit(&config, "serve");
+	mArgumentsApply(&args, NULL, 0, &config);
+	mStandardLoggerInit(&_logger);
+	mStandardLoggerConfig(&_logger, &config);
+	mLogSetDefaultLogger(&_logger.d);
+	mCoreConfigDeinit(&config);
+
+	SocketSubsystemInit();
+	struct ServeContext context = {
+		.args = &args,
+	};
+	context.server = SocketOpenTCP(serveOpts.port, NULL);
+	if (SOCKET_FAILED(context.server) || SOCKET_FAILED(SocketListen(context.server, 16))) {
+		fprintf(stderr, "Could not listen on port %i\n", serveOpts.port);
+		if (!SOCKET_FAILED(context.server)) {
+			SocketClose(context.server);
+		}
+		SocketSubsystemDeinit();
+		mStandardLoggerDeinit(&_logger);
+		goto cleanup;
+	}
+	ServeConnectionListInit(&context.connections, 0);
+	ServeSessionListInit(&context.sessions, 0);
+	mCoreBatchInit(&context.batch, serveOpts.workers);
+
+	_serve(&context);
+
+	size_t i;
+	for (i = 0; i < ServeConnectionListSize(&context.connections); ++i) {
+		(*ServeConnectionListGetPointer(&context.connections, i))->closed = true;
+	}
+	_reapConnections(&context);
+	mCoreBatchDeinit(&context.batch);
+	ServeSessionListDeinit(&context.sessions);
+	ServeConnectionListDeinit(&context.connections);
+	SocketClose(context.server);
+	SocketSubsystemDeinit();
+	mStandardLoggerDeinit(&_logger);
+	status = 0;
+
+cleanup:
+	mArgumentsDeinit(&args);
+	return status;
+}
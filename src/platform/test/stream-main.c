@@ -0,0 +1,368 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/core/log.h>
+#include <mgba/core/perf.h>
+#include <mgba/core/serialize.h>
+#include <mgba/feature/commandline.h>
+
+#include <mgba-util/socket.h>
+#include <mgba-util/vfs.h>
+
+#include "feature/ffmpeg/ffmpeg-encoder.h"
+
+#include <signal.h>
+
+#define STREAM_OPTIONS "a:A:F:Ho:P:S:v:V:"
+#define STREAM_USAGE \
+	"Streaming options:\n" \
+	"  -a ACODEC        Audio codec, or \"none\" (default: aac)\n" \
+	"  -A ABR           Audio bitrate in kbps (default: 128)\n" \
+	"  -F FORMAT        Container format (default: guessed from the URL)\n" \
+	"  -H               Use a hardware video encoder if one is available\n" \
+	"  -o URL           Where to stream to, e.g. rtmp://host/app/key or srt://host:port\n" \
+	"  -P PORT          TCP port to take input from (default: 5000)\n" \
+	"  -S SCALE         Scale the output by an integer factor (default: 1)\n" \
+	"  -v VCODEC        Video codec (default: libx264)\n" \
+	"  -V VBR           Video bitrate in kbps (default: 2000)\n" \
+	"\n" \
+	"Input clients send the held keys as 16-bit little-endian masks, one per change."
+
+#define DEFAULT_INPUT_PORT 5000
+// If emulation falls this far behind, it starts over from now instead of rushing to catch up
+#define MAX_FRAMES_BEHIND 4
+
+struct StreamOpts {
+	const char* acodec;
+	unsigned abr;
+	const char* vcodec;
+	int vbr;
+	const char* container;
+	const char* url;
+	unsigned scale;
+	bool hardware;
+	int inputPort;
+};
+
+struct StreamInput {
+	Socket server;
+	Socket client;
+	uint8_t pending[2];
+	size_t pendingSize;
+	uint16_t keys;
+};
+
+static bool _parseStreamOpts(struct mSubParser* parser, int option, const char* arg);
+static void _streamShutdown(int signal);
+
+static volatile bool _dispatchExiting = false;
+static struct mStandardLogger _logger;
+
+static void _streamShutdown(int signal) {
+	UNUSED(signal);
+	_dispatchExiting = true;
+}
+
+static bool _parseStreamOpts(struct mSubParser* parser, int option, const char* arg) {
+	struct StreamOpts* opts = parser->opts;
+	switch (option) {
+	case 'a':
+		opts->acodec = strcmp(arg, "none") == 0 ? NULL : arg;
+		return true;
+	case 'A':
+		opts->abr = strtoul(arg, NULL, 0) * 1024;
+		return true;
+	case 'F':
+		opts->container = arg;
+		return true;
+	case 'H':
+		opts->hardware = true;
+		return true;
+	case 'o':
+		opts->url = arg;
+		return true;
+	case 'P':
+		opts->inputPort = atoi(arg);
+		return opts->inputPort > 0 && opts->inputPort < 0x10000;
+	case 'S':
+		opts->scale = strtoul(arg, NULL, 0);
+		if (opts->scale < 1) {
+			opts->scale = 1;
+		}
+		return true;
+	case 'v':
+		opts->vcodec = arg;
+		return true;
+	case 'V':
+		opts->vbr = atoi(arg) * 1024;
+		return opts->vbr > 0;
+	default:
+		return false;
+	}
+}
+
+static const char* _guessContainer(const char* url) {
+	static const struct {
+		const char* scheme;
+		const char* container;
+	} containers[] = {
+		{ "rtmp://", "flv" },
+		{ "rtmps://", "flv" },
+		{ "srt://", "mpegts" },
+		{ "udp://", "mpegts" },
+		{ "tcp://", "mpegts" },
+		{ "rtsp://", "rtsp" },
+	};
+	size_t i;
+	for (i = 0; i < sizeof(containers) / sizeof(*containers); ++i) {
+		if (strncmp(url, containers[i].scheme, strlen(containers[i].scheme)) == 0) {
+			return containers[i].container;
+		}
+	}
+	return NULL;
+}
+
+static void _inputAccept(struct StreamInput* input) {
+	Socket client = SocketAccept(input->server, NULL);
+	if (SOCKET_FAILED(client)) {
+		return;
+	}
+	// Only the newest client gets to play
+	if (!SOCKET_FAILED(input->client)) {
+		SocketClose(input->client);
+	}
+	SocketSetBlocking(client, false);
+	SocketSetTCPPush(client, 1);
+	input->client = client;
+	input->pendingSize = 0;
+	input->keys = 0;
+}
+
+static void _inputRead(struct StreamInput* input) {
+	uint8_t buffer[64];
+	ssize_t size = SocketRecv(input->client, buffer, sizeof(buffer));
+	if (size == 0 || (size < 0 && !SocketWouldBlock())) {
+		// Don't leave keys held down after the client goes away
+		SocketClose(input->client);
+		input->client = INVALID_SOCKET;
+		input->keys = 0;
+		return;
+	}
+	ssize_t i;
+	for (i = 0; i < size; ++i) {
+		input->pending[input->pendingSize] = buffer[i];
+		++input->pendingSize;
+		if (input->pendingSize == sizeof(input->pending)) {
+			LOAD_16LE(input->keys, 0, input->pending);
+			input->pendingSize = 0;
+		}
+	}
+}
+
+// Waits for input until the deadline, so new keys are picked up the moment they arrive
+static void _inputWait(struct StreamInput* input, uint64_t deadline) {
+	while (true) {
+		uint64_t now = mPerfTimestamp();
+		int64_t timeout = 0;
+		if (deadline > now) {
+			timeout = (deadline - now) / 1000000;
+		}
+		Socket reads[2] = { input->server, input->client };
+		if (SocketPoll(SOCKET_FAILED(input->client) ? 1 : 2, reads, NULL, NULL, timeout) <= 0) {
+			return;
+		}
+		size_t i;
+		for (i = 0; i < 2 && !SOCKET_FAILED(reads[i]); ++i) {
+			if (reads[i] == input->server) {
+				_inputAccept(input);
+			} else if (reads[i] == input->client) {
+				_inputRead(input);
+			}
+		}
+		if (!timeout) {
+			return;
+		}
+	}
+}
+
+static bool _configureEncoder(struct FFmpegEncoder* encoder, const struct StreamOpts* opts, struct mCore* core, const char* url) {
+	const char* container = opts->container;
+	if (!container) {
+		container = _guessContainer(url);
+		if (!container) {
+			fprintf(stderr, "Could not tell what format to use for %s\n", url);
+			return false;
+		}
+	}
+	if (!FFmpegEncoderSetAudio(encoder, opts->acodec, opts->abr)) {
+		fprintf(stderr, "Unsupported audio codec %s\n", opts->acodec);
+		return false;
+	}
+	if (!FFmpegEncoderSetVideo(encoder, opts->vcodec, opts->vbr, 0)) {
+		fprintf(stderr, "Unsupported video codec %s\n", opts->vcodec);
+		return false;
+	}
+	if (!FFmpegEncoderSetContainer(encoder, container)) {
+		fprintf(stderr, "Unsupported container %s\n", container);
+		return false;
+	}
+	unsigned width;
+	unsigned height;
+	core->currentVideoSize(core, &width, &height);
+	FFmpegEncoderSetDimensions(encoder, width * opts->scale, height * opts->scale);
+	FFmpegEncoderSetInputFrameRate(encoder, core->frameCycles(core), core->frequency(core));
+	FFmpegEncoderSetHardwareAcceleration(encoder, opts->hardware);
+	FFmpegEncoderSetLowLatency(encoder, true);
+	// A frame that can't be encoded in time is better dropped than late, and emulation can't stall
+	FFmpegEncoderSetQueue(encoder, 1, FFMPEG_QUEUE_DROP);
+	if (!FFmpegEncoderOpen(encoder, url)) {
+		fprintf(stderr, "Could not start streaming to %s\n", url);
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char * argv[]) {
+	signal(SIGINT, _streamShutdown);
+#ifndef _WIN32
+	// A viewer disconnecting shouldn't take the whole stream down
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	struct StreamOpts streamOpts = {
+		.acodec = "aac",
+		.abr = 128 * 1024,
+		.vcodec = "libx264",
+		.vbr = 2000 * 1024,
+		.container = NULL,
+		.url = NULL,
+		.scale = 1,
+		.hardware = false,
+		.inputPort = DEFAULT_INPUT_PORT,
+	};
+	struct mSubParser subparser = {
+		.usage = STREAM_USAGE,
+		.parse = _parseStreamOpts,
+		.extraOptions = STREAM_OPTIONS,
+		.opts = &streamOpts
+	};
+
+	struct mArguments args;
+	bool parsed = mArgumentsParse(&args, argc, argv, &subparser, 1);
+	const char* url = streamOpts.url;
+	if (!args.fname || !url) {
+		parsed = false;
+	}
+	if (!parsed || args.showHelp) {
+		usage(argv[0], NULL, NULL, &subparser, 1);
+		mArgumentsDeinit(&args);
+		return !parsed;
+	}
+	if (args.showVersion) {
+		version(argv[0]);
+		mArgumentsDeinit(&args);
+		return 0;
+	}
+
+	struct mCore* core = mCoreFind(args.fname);
+	if (!core) {
+		fprintf(stderr, "Could not find a core for %s\n", args.fname);
+		mArgumentsDeinit(&args);
+		return 1;
+	}
+	core->init(core);
+	mCoreInitConfig(core, "stream");
+	mArgumentsApply(&args, NULL, 0, &core->config);
+	mCoreConfigSetDefaultIntValue(&core->config, "logToStdout", true);
+
+	mStandardLoggerInit(&_logger);
+	mStandardLoggerConfig(&_logger, &core->config);
+	mLogSetDefaultLogger(&_logger.d);
+
+	int status = 1;
+	struct StreamInput input = {
+		.server = INVALID_SOCKET,
+		.client = INVALID_SOCKET,
+	};
+	struct FFmpegEncoder encoder;
+	FFmpegEncoderInit(&encoder);
+	color_t* buffer = NULL;
+
+	SocketSubsystemInit();
+	if (!mCoreLoadFile(core, args.fname)) {
+		fprintf(stderr, "Could not load %s\n", args.fname);
+		goto cleanup;
+	}
+
+	unsigned width;
+	unsigned height;
+	core->baseVideoSize(core, &width, &height);
+	buffer = calloc(width * height, BYTES_PER_PIXEL);
+	core->setVideoBuffer(core, buffer, width);
+	core->reset(core);
+	mArgumentsApplyFileLoads(&args, core);
+	if (args.savestate) {
+		struct VFile* savestate = VFileOpen(args.savestate, O_RDONLY);
+		if (savestate) {
+			mCoreLoadStateNamed(core, savestate, 0);
+			savestate->close(savestate);
+		}
+	}
+
+	input.server = SocketOpenTCP(streamOpts.inputPort, NULL);
+	if (SOCKET_FAILED(input.server) || SOCKET_FAILED(SocketListen(input.server, 1))) {
+		fprintf(stderr, "Could not listen for input on port %i\n", streamOpts.inputPort);
+		goto cleanup;
+	}
+
+	if (!_configureEncoder(&encoder, &streamOpts, core, url)) {
+		goto cleanup;
+	}
+	core->setAVStream(core, &encoder.d);
+
+	uint64_t frameNsec = core->frameCycles(core) * 1000000000ULL / core->frequency(core);
+	uint64_t start = mPerfTimestamp();
+	uint64_t frames = 0;
+	while (!_dispatchExiting) {
+		// Keys are applied right before each frame, so input is never more than a frame old
+		core->setKeys(core, input.keys);
+		core->runFrame(core);
+		++frames;
+
+		uint64_t deadline = start + frames * frameNsec;
+		if (mPerfTimestamp() > deadline + MAX_FRAMES_BEHIND * frameNsec) {
+			start = mPerfTimestamp();
+			frames = 0;
+			deadline = start;
+		}
+		_inputWait(&input, deadline);
+	}
+
+	core->setAVStream(core, NULL);
+	struct FFmpegEncoderQueueStats stats;
+	FFmpegEncoderGetQueueStats(&encoder, &stats);
+	if (stats.dropped) {
+		fprintf(stderr, "Dropped %llu frames that couldn't be encoded in time\n", (unsigned long long) stats.dropped);
+	}
+	status = 0;
+
+cleanup:
+	FFmpegEncoderClose(&encoder);
+	if (!SOCKET_FAILED(input.client)) {
+		SocketClose(input.client);
+	}
+	if (!SOCKET_FAILED(input.server)) {
+		SocketClose(input.server);
+	}
+	SocketSubsystemDeinit();
+	mArgumentsDeinit(&args);
+	mStandardLoggerDeinit(&_logger);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(buffer);
+	return status;
+}
@@ -47,6 +47,7 @@ struct GUIFont* GUIFontCreate(void) {
 }
 
 void GUIFontDestroy(struct GUIFont* font) {
+	GUIFontClearRunCache();
 	TPL_CloseTPLFile(&font->tdf);
 	TPL_CloseTPLFile(&font->iconsTdf);
 	free(font);
@@ -16,3 +16,68 @@ void mappedMemoryFree(void* memory, size_t size) {
 	// size is not useful here because we're freeing the memory, not decommitting it
 	VirtualFree(memory, 0, MEM_RELEASE);
 }
+
+void mappedMemoryClear(void* memory, size_t size) {
+	memset(memory, 0, size);
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+	UNUSED(memory);
+	return size;
+}
+
+bool sharedMemoryCreate(struct SharedMemory* memory, size_t size) {
+	HANDLE handle = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD) ((uint64_t) size >> 32), (DWORD) size, NULL);
+	if (!handle) {
+		return false;
+	}
+	void* data = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!data) {
+		CloseHandle(handle);
+		return false;
+	}
+	memory->data = data;
+	memory->size = size;
+	memory->handle = (intptr_t) handle;
+	return true;
+}
+
+void sharedMemoryDestroy(struct SharedMemory* memory) {
+	UnmapViewOfFile(memory->data);
+	CloseHandle((HANDLE) memory->handle);
+	memory->data = NULL;
+	memory->size = 0;
+	memory->handle = 0;
+}
+
+void* sharedMemoryMapPrivate(const struct SharedMemory* memory) {
+	return MapViewOfFile((HANDLE) memory->handle, FILE_MAP_COPY, 0, 0, memory->size);
+}
+
+void sharedMemoryUnmapPrivate(const struct SharedMemory* memory, void* data) {
+	UNUSED(memory);
+	UnmapViewOfFile(data);
+}
+
+bool sharedMemoryCreateNamed(struct SharedMemory* memory, const char* name, size_t size) {
+	char path[MAX_PATH];
+	snprintf(path, sizeof(path), "Local\\%s", name);
+	HANDLE handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD) ((uint64_t) size >> 32), (DWORD) size, path);
+	if (!handle) {
+		return false;
+	}
+	void* data = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!data) {
+		CloseHandle(handle);
+		return false;
+	}
+	memory->data = data;
+	memory->size = size;
+	memory->handle = (intptr_t) handle;
+	return true;
+}
+
+void sharedMemoryRemoveNamed(const char* name) {
+	// The name goes away along with the last handle to it
+	UNUSED(name);
+}
@@ -100,6 +100,9 @@ static void _mScriptCanvasUpdate(struct mScriptCanvasContext* canvas) {
 	for (i = 0; i < VIDEO_LAYER_OVERLAY_COUNT; ++i) {
 		mScriptCanvasLayerUpdate(&canvas->overlays[i]);
 	}
+	if (canvas->backend && canvas->backend->flush) {
+		canvas->backend->flush(canvas->backend);
+	}
 }
 
 static unsigned _mScriptCanvasWidth(struct mScriptCanvasContext* canvas) {
@@ -180,6 +183,9 @@ static void mScriptCanvasLayerDestroy(struct mScriptCanvasLayer* layer) {
 	if (layer->backend) {
 		layer->backend->setLayerDimensions(layer->backend, layer->layer, &frame);
 		layer->backend->setImageSize(layer->backend, layer->layer, 0, 0);
+		if (layer->backend->flush) {
+			layer->backend->flush(layer->backend);
+		}
 	}
 	mImageDestroy(layer->image);
 	layer->image = NULL;
@@ -207,10 +213,13 @@ static void mScriptCanvasLayerUpdate(struct mScriptCanvasLayer* layer) {
 		backend->setLayerDimensions(backend, layer->layer, &frame);
 		layer->dimsDirty = false;
 	}
-	if (layer->contentsDirty) {
+	if (layer->contentsDirty || !backend->setImageRegion) {
 		backend->setImage(backend, layer->layer, layer->image->data);
 		layer->contentsDirty = false;
+	} else if (layer->image->dirty.width > 0 && layer->image->dirty.height > 0) {
+		backend->setImageRegion(backend, layer->layer, &layer->image->dirty, layer->image->data);
 	}
+	mImageClearDirty(layer->image);
 	layer->dirty = false;
 }
 
@@ -223,7 +232,10 @@ static void mScriptCanvasLayerSetPosition(struct mScriptCanvasLayer* layer, int3
 }
 
 static void mScriptCanvasLayerInvalidate(struct mScriptCanvasLayer* layer) {
-	layer->contentsDirty = true;
+	// Drawing through the image tracks what changed, so only fall back to a full upload if nothing did
+	if (!layer->image || layer->image->dirty.width <= 0 || layer->image->dirty.height <= 0) {
+		layer->contentsDirty = true;
+	}
 	layer->dirty = true;
 }
 
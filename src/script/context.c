@@ -30,6 +30,10 @@ static BOOL CALLBACK _createTLS(PINIT_ONCE once, PVOID param, PVOID* context) {
 #endif
 
 #define KEY_NAME_MAX 128
+#define FRAME_POOL_MAX 16
+
+DEFINE_VECTOR(mScriptFramePool, struct mScriptFrame*);
+DEFINE_VECTOR(mScriptCallbackEventList, struct mScriptCallbackEventInfo*);
 
 struct mScriptFileInfo {
 	const char* name;
@@ -39,11 +43,36 @@ struct mScriptFileInfo {
 
 struct mScriptCallbackInfo {
 	struct mScriptValue* fn;
-	const char* callback;
+	struct mScriptCallbackEventInfo* event;
 	uint32_t id;
 	bool oneshot;
 };
 
+DECLARE_VECTOR(mScriptCallbackInfoList, struct mScriptCallbackInfo*);
+DEFINE_VECTOR(mScriptCallbackInfoList, struct mScriptCallbackInfo*);
+
+struct mScriptCallbackEventInfo {
+	const char* name;
+	uint32_t id;
+	// Kept in registration order and only changed on add or remove, so triggering is a flat walk
+	struct mScriptCallbackInfoList subscribers;
+	int dispatching;
+	bool dirty;
+};
+
+static const char* const _builtinEvents[mSCRIPT_CALLBACK_MAX] = {
+	[mSCRIPT_CALLBACK_FRAME] = "frame",
+	[mSCRIPT_CALLBACK_CRASHED] = "crashed",
+	[mSCRIPT_CALLBACK_SLEEP] = "sleep",
+	[mSCRIPT_CALLBACK_STOP] = "stop",
+	[mSCRIPT_CALLBACK_KEYS_READ] = "keysRead",
+	[mSCRIPT_CALLBACK_SAVEDATA_UPDATED] = "savedataUpdated",
+	[mSCRIPT_CALLBACK_ALARM] = "alarm",
+	[mSCRIPT_CALLBACK_START] = "start",
+	[mSCRIPT_CALLBACK_RESET] = "reset",
+	[mSCRIPT_CALLBACK_SHUTDOWN] = "shutdown",
+};
+
 static void _engineContextDestroy(void* ctx) {
 	struct mScriptEngineContext* context = ctx;
 	context->destroy(context);
@@ -79,19 +108,48 @@ static void _contextFindForFile(const char* key, void* value, void* user) {
 	}
 }
 
-static void _freeTable(void* data) {
-	struct Table* table = data;
-
+static struct mScriptCallbackEventInfo* _internEvent(struct mScriptContext* context, const char* callback) {
+	struct mScriptCallbackEventInfo* event = HashTableLookup(&context->callbacks, callback);
+	if (event) {
+		return event;
+	}
+	event = calloc(1, sizeof(*event));
+	mScriptCallbackInfoListInit(&event->subscribers, 0);
+	HashTableInsert(&context->callbacks, callback, event);
+	// Steal the string from the table key, since it's guaranteed to outlive this struct
 	struct TableIterator iter;
-	if (TableIteratorStart(table, &iter)) {
-		do {
-			struct mScriptCallbackInfo* info = TableIteratorGetValue(table, &iter);
-			mScriptValueDeref(info->fn);
-		} while (TableIteratorNext(table, &iter));
+	HashTableIteratorLookup(&context->callbacks, &iter, callback);
+	event->name = HashTableIteratorGetKey(&context->callbacks, &iter);
+	*mScriptCallbackEventListAppend(&context->callbackEvents) = event;
+	event->id = mScriptCallbackEventListSize(&context->callbackEvents);
+	return event;
+}
+
+static void _compactEvent(struct mScriptCallbackEventInfo* event) {
+	size_t i;
+	for (i = 0; i < mScriptCallbackInfoListSize(&event->subscribers);) {
+		struct mScriptCallbackInfo* info = *mScriptCallbackInfoListGetPointer(&event->subscribers, i);
+		if (info->fn) {
+			++i;
+			continue;
+		}
+		free(info);
+		mScriptCallbackInfoListShift(&event->subscribers, i, 1);
 	}
+	event->dirty = false;
+}
 
-	TableDeinit(table);
-	free(table);
+static void _freeEvent(struct mScriptCallbackEventInfo* event) {
+	size_t i;
+	for (i = 0; i < mScriptCallbackInfoListSize(&event->subscribers); ++i) {
+		struct mScriptCallbackInfo* info = *mScriptCallbackInfoListGetPointer(&event->subscribers, i);
+		if (info->fn) {
+			mScriptValueDeref(info->fn);
+		}
+		free(info);
+	}
+	mScriptCallbackInfoListDeinit(&event->subscribers);
+	free(event);
 }
 
 void mScriptContextInit(struct mScriptContext* context) {
@@ -105,12 +163,18 @@ void mScriptContextInit(struct mScriptContext* context) {
 	mScriptListInit(&context->refPool, 0);
 	TableInit(&context->weakrefs, 0, (void (*)(void*)) mScriptValueDeref);
 	context->nextWeakref = 1;
-	HashTableInit(&context->callbacks, 0, _freeTable);
-	TableInit(&context->callbackId, 0, free);
+	HashTableInit(&context->callbacks, 0, NULL);
+	TableInit(&context->callbackId, 0, NULL);
 	context->nextCallbackId = 1;
+	mScriptCallbackEventListInit(&context->callbackEvents, mSCRIPT_CALLBACK_MAX);
+	size_t i;
+	for (i = mSCRIPT_CALLBACK_NONE + 1; i < mSCRIPT_CALLBACK_MAX; ++i) {
+		_internEvent(context, _builtinEvents[i]);
+	}
 	context->constants = NULL;
 	HashTableInit(&context->docstrings, 0, NULL);
 	context->threadDepth = 0;
+	mScriptFramePoolInit(&context->framePool, 0);
 }
 
 void mScriptContextDeinit(struct mScriptContext* context) {
@@ -118,10 +182,45 @@ void mScriptContextDeinit(struct mScriptContext* context) {
 	mScriptContextDrainPool(context);
 	HashTableDeinit(&context->weakrefs);
 	mScriptListDeinit(&context->refPool);
+	size_t i;
+	for (i = 0; i < mScriptCallbackEventListSize(&context->callbackEvents); ++i) {
+		_freeEvent(*mScriptCallbackEventListGetPointer(&context->callbackEvents, i));
+	}
+	mScriptCallbackEventListDeinit(&context->callbackEvents);
 	HashTableDeinit(&context->callbacks);
 	TableDeinit(&context->callbackId);
 	HashTableDeinit(&context->engines);
 	HashTableDeinit(&context->docstrings);
+	for (i = 0; i < mScriptFramePoolSize(&context->framePool); ++i) {
+		struct mScriptFrame* frame = *mScriptFramePoolGetPointer(&context->framePool, i);
+		mScriptFrameDeinit(frame);
+		free(frame);
+	}
+	mScriptFramePoolDeinit(&context->framePool);
+}
+
+struct mScriptFrame* mScriptContextAcquireFrame(struct mScriptContext* context) {
+	size_t size = mScriptFramePoolSize(&context->framePool);
+	if (size) {
+		struct mScriptFrame* frame = *mScriptFramePoolGetPointer(&context->framePool, size - 1);
+		mScriptFramePoolResize(&context->framePool, -1);
+		return frame;
+	}
+	struct mScriptFrame* frame = malloc(sizeof(*frame));
+	mScriptFrameInit(frame);
+	return frame;
+}
+
+void mScriptContextReleaseFrame(struct mScriptContext* context, struct mScriptFrame* frame) {
+	if (mScriptFramePoolSize(&context->framePool) >= FRAME_POOL_MAX) {
+		mScriptFrameDeinit(frame);
+		free(frame);
+		return;
+	}
+	// Like mScriptFrameDeinit, this leaves the values themselves to the caller
+	mScriptListClear(&frame->arguments);
+	mScriptListClear(&frame->returnValues);
+	*mScriptFramePoolAppend(&context->framePool) = frame;
 }
 
 void mScriptContextFillPool(struct mScriptContext* context, struct mScriptValue* value) {
@@ -247,41 +346,56 @@ void mScriptContextDisownWeakref(struct mScriptContext* context, uint32_t weakre
 	poolEntry->refs = mSCRIPT_VALUE_UNREF;
 }
 
-void mScriptContextTriggerCallback(struct mScriptContext* context, const char* callback, struct mScriptList* args) {
-	struct Table* table = HashTableLookup(&context->callbacks, callback);
-	if (!table) {
-		return;
-	}
-	struct TableIterator iter;
-	if (!TableIteratorStart(table, &iter)) {
+static void _triggerEvent(struct mScriptContext* context, struct mScriptCallbackEventInfo* event, struct mScriptList* args) {
+	// Callbacks added while dispatching won't run until the next trigger
+	size_t count = mScriptCallbackInfoListSize(&event->subscribers);
+	if (!count) {
 		return;
 	}
-
-	struct UInt32List oneshots;
-	UInt32ListInit(&oneshots, 0);
-	do {
-		struct mScriptFrame frame;
-		struct mScriptCallbackInfo* info = TableIteratorGetValue(table, &iter);
+	++event->dispatching;
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		struct mScriptCallbackInfo* info = *mScriptCallbackInfoListGetPointer(&event->subscribers, i);
+		if (!info->fn) {
+			continue;
+		}
 		struct mScriptValue* fn = mScriptContextAccessWeakref(context, info->fn);
 		if (fn) {
-			mScriptFrameInit(&frame);
+			struct mScriptFrame* frame = mScriptContextAcquireFrame(context);
 			if (args) {
-				mScriptListCopy(&frame.arguments, args);
+				mScriptListCopy(&frame->arguments, args);
 			}
-			mScriptContextInvoke(context, fn, &frame);
-			mScriptFrameDeinit(&frame);
+			mScriptContextInvoke(context, fn, frame);
+			mScriptContextReleaseFrame(context, frame);
 		}
 
 		if (info->oneshot) {
-			*UInt32ListAppend(&oneshots) = info->id;
+			mScriptContextRemoveCallback(context, info->id);
 		}
-	} while (TableIteratorNext(table, &iter));
+	}
+	--event->dispatching;
+	if (!event->dispatching && event->dirty) {
+		_compactEvent(event);
+	}
+}
 
-	size_t i;
-	for (i = 0; i < UInt32ListSize(&oneshots); ++i) {
-		mScriptContextRemoveCallback(context, *UInt32ListGetPointer(&oneshots, i));
+uint32_t mScriptContextGetCallbackEvent(struct mScriptContext* context, const char* callback) {
+	return _internEvent(context, callback)->id;
+}
+
+void mScriptContextTriggerCallbackEvent(struct mScriptContext* context, uint32_t event, struct mScriptList* args) {
+	if (event == mSCRIPT_CALLBACK_NONE || event > mScriptCallbackEventListSize(&context->callbackEvents)) {
+		return;
+	}
+	_triggerEvent(context, *mScriptCallbackEventListGetPointer(&context->callbackEvents, event - 1), args);
+}
+
+void mScriptContextTriggerCallback(struct mScriptContext* context, const char* callback, struct mScriptList* args) {
+	struct mScriptCallbackEventInfo* event = HashTableLookup(&context->callbacks, callback);
+	if (!event) {
+		return;
 	}
-	UInt32ListDeinit(&oneshots);
+	_triggerEvent(context, event, args);
 }
 
 static uint32_t mScriptContextAddCallbackInternal(struct mScriptContext* context, const char* callback, struct mScriptValue* fn, bool oneshot) {
@@ -296,17 +410,8 @@ static uint32_t mScriptContextAddCallbackInternal(struct mScriptContext* context
 	} else if (fn->type->base != mSCRIPT_TYPE_FUNCTION) {
 		return 0;
 	}
-	struct Table* table = HashTableLookup(&context->callbacks, callback);
-	if (!table) {
-		table = calloc(1, sizeof(*table));
-		TableInit(table, 0, NULL);
-		HashTableInsert(&context->callbacks, callback, table);
-	}
 	struct mScriptCallbackInfo* info = malloc(sizeof(*info));
-	// Steal the string from the table key, since it's guaranteed to outlive this struct
-	struct TableIterator iter;
-	HashTableIteratorLookup(&context->callbacks, &iter, callback);
-	info->callback = HashTableIteratorGetKey(&context->callbacks, &iter);
+	info->event = _internEvent(context, callback);
 	info->oneshot = oneshot;
 	if (fn->type->base == mSCRIPT_TYPE_WRAPPER) {
 		fn = mScriptValueUnwrap(fn);
@@ -316,14 +421,14 @@ static uint32_t mScriptContextAddCallbackInternal(struct mScriptContext* context
 	while (true) {
 		uint32_t id = context->nextCallbackId;
 		++context->nextCallbackId;
-		if (TableLookup(&context->callbackId, id)) {
+		if (!id || TableLookup(&context->callbackId, id)) {
 			continue;
 		}
 		TableInsert(&context->callbackId, id, info);
 		info->id = id;
 		break;
 	}
-	TableInsert(table, info->id, info);
+	*mScriptCallbackInfoListAppend(&info->event->subscribers) = info;
 	return info->id;
 }
 
@@ -340,13 +445,17 @@ void mScriptContextRemoveCallback(struct mScriptContext* context, uint32_t cbid)
 	if (!info) {
 		return;
 	}
-	struct Table* table = HashTableLookup(&context->callbacks, info->callback);
-	if (!table) {
-		return;
-	}
-	mScriptValueDeref(info->fn);
-	TableRemove(table, cbid);
 	TableRemove(&context->callbackId, cbid);
+	mScriptValueDeref(info->fn);
+	info->fn = NULL;
+
+	// Removing entries mid-dispatch would shift the ones that haven't run yet, so defer it
+	struct mScriptCallbackEventInfo* event = info->event;
+	if (event->dispatching) {
+		event->dirty = true;
+	} else {
+		_compactEvent(event);
+	}
 }
 
 void mScriptContextExportConstants(struct mScriptContext* context, const char* nspace, struct mScriptKVPair* constants) {
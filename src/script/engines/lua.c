@@ -5,15 +5,20 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/script/lua.h>
 
+#include <mgba/core/config.h>
 #include <mgba/internal/script/socket.h>
 #include <mgba/script/context.h>
 #include <mgba/script/macros.h>
 #include <mgba/script/types.h>
+#include <mgba-util/crc32.h>
+#include <mgba-util/hash.h>
 #include <mgba-util/string.h>
+#include <mgba-util/vfs.h>
 
 #include <lualib.h>
 #include <lauxlib.h>
 
+#include <sys/stat.h>
 #ifdef _WIN32
 #include <windows.h>
 #endif
@@ -87,13 +92,41 @@ static const char* _socketLuaSource =
 	"    if status == 0 then return 1 end\n"
 	"    return nil, socket.ERRORS[status] or ('error#' .. status)\n"
 	"  end,\n"
+	"  _watched = {},\n"
+	"  _watch = function(sock)\n"
+	"    _socket.set:watch(sock._s)\n"
+	"    socket._watched[sock] = true\n"
+	"    if not socket._onframecb then\n"
+	"      socket._onframecb = callbacks:add('frame', socket._poll)\n"
+	"    end\n"
+	"  end,\n"
+	"  _unwatch = function(sock)\n"
+	"    _socket.set:unwatch(sock._s)\n"
+	"    socket._watched[sock] = nil\n"
+	"    if socket._onframecb and not next(socket._watched) then\n"
+	"      callbacks:remove(socket._onframecb)\n"
+	"      socket._onframecb = nil\n"
+	"    end\n"
+	"  end,\n"
+	"  _poll = function()\n"
+	"    if _socket.set:poll(0) == 0 then return end\n"
+	"    local ready = {}\n"
+	"    for sock in pairs(socket._watched) do\n"
+	"      if sock._s.events ~= 0 then ready[#ready + 1] = sock end\n"
+	"    end\n"
+	"    for _, sock in ipairs(ready) do\n"
+	"      if sock._s.events < 0 then\n"
+	"        local _, err = socket._wrap(sock._s.error)\n"
+	"        sock:_dispatch('error', err)\n"
+	"      elseif sock._s.events > 0 then\n"
+	"        sock:_dispatch('received')\n"
+	"      end\n"
+	"    end\n"
+	"  end,\n"
 	"  _mt = {\n"
 	"    __index = {\n"
 	"      close = function(self)\n"
-	"        if self._onframecb then\n"
-	"          callbacks:remove(self._onframecb)\n"
-	"          self._onframecb = nil\n"
-	"        end\n"
+	"        socket._unwatch(self)\n"
 	"        self._callbacks = {}\n"
 	"        return self._s:close()\n"
 	"      end,\n"
@@ -126,7 +159,7 @@ static const char* _socketLuaSource =
 	"    __index = {\n"
 	"      _hook = function(self, status)\n"
 	"        if status == 0 then\n"
-	"          self._onframecb = callbacks:add('frame', function() self:poll() end)\n"
+	"          socket._watch(self)\n"
 	"        end\n"
 	"        return socket._wrap(status)\n"
 	"      end,\n"
@@ -326,6 +359,7 @@ struct mScriptEngineContextLua {
 	lua_State* lua;
 	int func;
 	int require;
+	int methods;
 	char* lastError;
 };
 
@@ -415,6 +449,9 @@ struct mScriptEngineContext* _luaCreate(struct mScriptEngine2* engine, struct mS
 	lua_getglobal(luaContext->lua, "require");
 	luaContext->require = luaL_ref(luaContext->lua, LUA_REGISTRYINDEX);
 
+	lua_newtable(luaContext->lua);
+	luaContext->methods = luaL_ref(luaContext->lua, LUA_REGISTRYINDEX);
+
 	lua_pushliteral(luaContext->lua, "log");
 	lua_pushcclosure(luaContext->lua, _luaPrintShim, 1);
 	lua_setglobal(luaContext->lua, "print");
@@ -902,6 +939,160 @@ static const char* _reader(lua_State* lua, void* context, size_t* size) {
 	return reader->block;
 }
 
+static int _luaLoadSource(lua_State* lua, const char* chunkname, struct VFile* vf) {
+	struct mScriptEngineLuaReader data = {
+		.vf = vf
+	};
+#if LUA_VERSION_NUM >= 502
+	return lua_load(lua, _reader, &data, chunkname, "t");
+#else
+	return lua_load(lua, _reader, &data, chunkname);
+#endif
+}
+
+#if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
+#define BYTECODE_MAGIC 0x4342554C
+#define BYTECODE_HEADER_SIZE 20
+#define BYTECODE_SOURCE_MAX 0x4000000
+
+// Bytecode is only compatible within a release, not just within a version
+#ifdef LUA_VERSION_RELEASE_NUM
+#define BYTECODE_VERSION LUA_VERSION_RELEASE_NUM
+#else
+#define BYTECODE_VERSION LUA_VERSION_NUM
+#endif
+
+void mScriptEngineLuaGetBytecodePath(const char* script, char* out) {
+	mCoreConfigDirectory(out, PATH_MAX);
+
+	strncat(out, PATH_SEP "bytecode" PATH_SEP, PATH_MAX - 1);
+#ifdef _WIN32
+	WCHAR wout[MAX_PATH];
+	MultiByteToWideChar(CP_UTF8, 0, out, -1, wout, MAX_PATH);
+	CreateDirectoryW(wout, NULL);
+#else
+	mkdir(out, 0755);
+#endif
+
+	char suffix[16];
+	snprintf(suffix, sizeof(suffix), "%08X.luac", hash32(script, strlen(script), 0));
+	strncat(out, suffix, PATH_MAX - 1);
+}
+
+static int _writer(lua_State* lua, const void* buffer, size_t size, void* context) {
+	UNUSED(lua);
+	struct VFile* vf = context;
+	return vf->write(vf, buffer, size) != (ssize_t) size;
+}
+
+static bool _luaCheckBytecode(struct VFile* vf, const char* path, uint32_t sourceSize, uint32_t sourceCrc32) {
+	uint32_t header[BYTECODE_HEADER_SIZE / 4];
+	if (vf->read(vf, header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint32_t crc;
+	uint32_t pathLength;
+	LOAD_32LE(magic, 0, header);
+	LOAD_32LE(version, 4, header);
+	LOAD_32LE(size, 8, header);
+	LOAD_32LE(crc, 12, header);
+	LOAD_32LE(pathLength, 16, header);
+	if (magic != BYTECODE_MAGIC || version != BYTECODE_VERSION || size != sourceSize || crc != sourceCrc32) {
+		return false;
+	}
+	// The file name is just a hash of the path, so make sure it's the same script
+	char cachedPath[PATH_MAX];
+	if (pathLength != strlen(path) || pathLength > sizeof(cachedPath)) {
+		return false;
+	}
+	if (vf->read(vf, cachedPath, pathLength) != (ssize_t) pathLength) {
+		return false;
+	}
+	return memcmp(cachedPath, path, pathLength) == 0;
+}
+
+static void _luaWriteBytecode(lua_State* lua, const char* cachePath, const char* path, uint32_t sourceSize, uint32_t sourceCrc32) {
+	struct VFile* vf = VFileOpen(cachePath, O_WRONLY | O_CREAT | O_TRUNC);
+	if (!vf) {
+		return;
+	}
+	uint32_t header[BYTECODE_HEADER_SIZE / 4];
+	uint32_t pathLength = strlen(path);
+	STORE_32LE(BYTECODE_MAGIC, 0, header);
+	STORE_32LE(BYTECODE_VERSION, 4, header);
+	STORE_32LE(sourceSize, 8, header);
+	STORE_32LE(sourceCrc32, 12, header);
+	STORE_32LE(pathLength, 16, header);
+	bool ok = vf->write(vf, header, sizeof(header)) == sizeof(header);
+	ok = ok && vf->write(vf, path, pathLength) == (ssize_t) pathLength;
+	// Debug info is kept so errors still have line numbers
+#if LUA_VERSION_NUM >= 503
+	ok = ok && !lua_dump(lua, _writer, vf, 0);
+#else
+	ok = ok && !lua_dump(lua, _writer, vf);
+#endif
+	vf->close(vf);
+	if (!ok) {
+		remove(cachePath);
+	}
+}
+
+static int _luaLoadCached(lua_State* lua, const char* chunkname, struct VFile* vf) {
+	const char* path = &chunkname[1];
+	ssize_t size = vf->size(vf);
+	if (size < 0 || size > BYTECODE_SOURCE_MAX) {
+		return _luaLoadSource(lua, chunkname, vf);
+	}
+	char* source = malloc(size + 1);
+	if (vf->read(vf, source, size) != size) {
+		free(source);
+		vf->seek(vf, 0, SEEK_SET);
+		return _luaLoadSource(lua, chunkname, vf);
+	}
+	// There's no portable way to get an mtime through a VFile, so the contents are the key
+	uint32_t crc = doCrc32(source, size);
+
+	char cachePath[PATH_MAX];
+	mScriptEngineLuaGetBytecodePath(path, cachePath);
+	struct VFile* cache = VFileOpen(cachePath, O_RDONLY);
+	if (cache) {
+		int ret = -1;
+		if (_luaCheckBytecode(cache, path, size, crc)) {
+			struct mScriptEngineLuaReader data = {
+				.vf = cache
+			};
+#if LUA_VERSION_NUM >= 502
+			ret = lua_load(lua, _reader, &data, chunkname, "b");
+#else
+			ret = lua_load(lua, _reader, &data, chunkname);
+#endif
+			if (ret != LUA_OK) {
+				lua_pop(lua, 1);
+			}
+		}
+		cache->close(cache);
+		if (ret == LUA_OK) {
+			free(source);
+			return ret;
+		}
+	}
+
+#if LUA_VERSION_NUM >= 502
+	int ret = luaL_loadbufferx(lua, source, size, chunkname, "t");
+#else
+	int ret = luaL_loadbuffer(lua, source, size, chunkname);
+#endif
+	if (ret == LUA_OK) {
+		_luaWriteBytecode(lua, cachePath, path, size, crc);
+	}
+	free(source);
+	return ret;
+}
+#endif
+
 void _luaError(struct mScriptEngineContextLua* luaContext) {
 	struct mScriptValue* console = mScriptContextGetGlobal(luaContext->d.context, "console");
 	struct mScriptValue error = {0};
@@ -928,9 +1119,6 @@ void _luaError(struct mScriptEngineContextLua* luaContext) {
 
 bool _luaLoad(struct mScriptEngineContext* ctx, const char* filename, struct VFile* vf) {
 	struct mScriptEngineContextLua* luaContext = (struct mScriptEngineContextLua*) ctx;
-	struct mScriptEngineLuaReader data = {
-		.vf = vf
-	};
 	if (luaContext->lastError) {
 		free(luaContext->lastError);
 		luaContext->lastError = NULL;
@@ -963,10 +1151,16 @@ bool _luaLoad(struct mScriptEngineContext* ctx, const char* filename, struct VFi
 		}
 		filename = name;
 	}
-#if LUA_VERSION_NUM >= 502
-	int ret = lua_load(luaContext->lua, _reader, &data, filename, "t");
+	int ret;
+#if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
+	// Scripts loaded from files get their compiled form cached
+	if (name[0] == '@') {
+		ret = _luaLoadCached(luaContext->lua, name, vf);
+	} else {
+		ret = _luaLoadSource(luaContext->lua, filename, vf);
+	}
 #else
-	int ret = lua_load(luaContext->lua, _reader, &data, filename);
+	ret = _luaLoadSource(luaContext->lua, filename, vf);
 #endif
 	switch (ret) {
 	case LUA_OK:
@@ -1050,12 +1244,45 @@ bool _luaPushFrame(struct mScriptEngineContextLua* luaContext, struct mScriptLis
 	return ok;
 }
 
+static bool _luaPopScalar(struct mScriptEngineContextLua* luaContext, struct mScriptList* frame) {
+	// Numbers and booleans are copied straight into the frame instead of being allocated and unwrapped
+	struct mScriptValue* tail;
+	switch (lua_type(luaContext->lua, -1)) {
+	case LUA_TNUMBER:
+		tail = mScriptListAppend(frame);
+#if LUA_VERSION_NUM >= 503
+		if (lua_isinteger(luaContext->lua, -1)) {
+			tail->type = mSCRIPT_TYPE_MS_S64;
+			tail->value.s64 = lua_tointeger(luaContext->lua, -1);
+			break;
+		}
+#endif
+		tail->type = mSCRIPT_TYPE_MS_F64;
+		tail->value.f64 = lua_tonumber(luaContext->lua, -1);
+		break;
+	case LUA_TBOOLEAN:
+		tail = mScriptListAppend(frame);
+		tail->type = mSCRIPT_TYPE_MS_BOOL;
+		tail->value.u32 = lua_toboolean(luaContext->lua, -1);
+		break;
+	default:
+		return false;
+	}
+	tail->refs = mSCRIPT_VALUE_UNREF;
+	tail->flags = 0;
+	lua_pop(luaContext->lua, 1);
+	return true;
+}
+
 bool _luaPopFrame(struct mScriptEngineContextLua* luaContext, struct mScriptList* frame) {
 	int count = lua_gettop(luaContext->lua);
 	bool ok = true;
 	if (frame) {
 		int i;
 		for (i = 0; i < count; ++i) {
+			if (_luaPopScalar(luaContext, frame)) {
+				continue;
+			}
 			struct mScriptValue* value = _luaCoerce(luaContext, true);
 			if (!value) {
 				ok = false;
@@ -1193,28 +1420,27 @@ static struct mScriptEngineContextLua* _luaGetContext(lua_State* lua) {
 
 int _luaThunk(lua_State* lua) {
 	struct mScriptEngineContextLua* luaContext = _luaGetContext(lua);
-	struct mScriptFrame frame;
-	mScriptFrameInit(&frame);
-	if (!_luaPopFrame(luaContext, &frame.arguments)) {
-		_freeFrame(&frame.arguments);
+	struct mScriptFrame* frame = mScriptContextAcquireFrame(luaContext->d.context);
+	if (!_luaPopFrame(luaContext, &frame->arguments)) {
+		_freeFrame(&frame->arguments);
 		mScriptContextDrainPool(luaContext->d.context);
-		mScriptFrameDeinit(&frame);
+		mScriptContextReleaseFrame(luaContext->d.context, frame);
 		luaL_traceback(lua, lua, "Error calling function (translating arguments into runtime)", 1);
 		return lua_error(lua);
 	}
 
 	struct mScriptValue* fn = lua_touserdata(lua, lua_upvalueindex(1));
-	_autofreeFrame(luaContext->d.context, &frame.arguments);
-	if (!fn || !mScriptContextInvoke(luaContext->d.context, fn, &frame)) {
+	_autofreeFrame(luaContext->d.context, &frame->arguments);
+	if (!fn || !mScriptContextInvoke(luaContext->d.context, fn, frame)) {
 		mScriptContextDrainPool(luaContext->d.context);
-		mScriptFrameDeinit(&frame);
+		mScriptContextReleaseFrame(luaContext->d.context, frame);
 		luaL_traceback(lua, lua, "Error calling function (invoking failed)", 1);
 		return lua_error(lua);
 	}
 
-	bool ok = _luaPushFrame(luaContext, &frame.returnValues);
+	bool ok = _luaPushFrame(luaContext, &frame->returnValues);
 	mScriptContextDrainPool(luaContext->d.context);
-	mScriptFrameDeinit(&frame);
+	mScriptContextReleaseFrame(luaContext->d.context, frame);
 	if (!ok) {
 		luaL_traceback(lua, lua, "Error calling function (translating return values from runtime)", 1);
 		return lua_error(lua);
@@ -1223,6 +1449,22 @@ int _luaThunk(lua_State* lua) {
 	return lua_gettop(luaContext->lua);
 }
 
+// Leaves the table of cached method wrappers for this type on top of the stack
+static void _luaPushMethodCache(struct mScriptEngineContextLua* luaContext, const struct mScriptType* type) {
+	lua_State* lua = luaContext->lua;
+	lua_rawgeti(lua, LUA_REGISTRYINDEX, luaContext->methods);
+	lua_pushlightuserdata(lua, (void*) type);
+	lua_rawget(lua, -2);
+	if (lua_isnil(lua, -1)) {
+		lua_pop(lua, 1);
+		lua_newtable(lua);
+		lua_pushlightuserdata(lua, (void*) type);
+		lua_pushvalue(lua, -2);
+		lua_rawset(lua, -4);
+	}
+	lua_remove(lua, -2);
+}
+
 int _luaGetObject(lua_State* lua) {
 	struct mScriptEngineContextLua* luaContext = _luaGetContext(lua);
 	char key[MAX_KEY_SIZE];
@@ -1236,15 +1478,28 @@ int _luaGetObject(lua_State* lua) {
 		return lua_error(lua);
 	}
 	strlcpy(key, keyPtr, sizeof(key));
-	lua_pop(lua, 2);
 
 	obj = mScriptContextAccessWeakref(luaContext->d.context, obj);
 	if (!obj) {
+		lua_pop(lua, 2);
 		luaL_traceback(lua, lua, "Invalid object", 1);
 		return lua_error(lua);
 	}
+	if (obj->type->base == mSCRIPT_TYPE_WRAPPER) {
+		obj = mScriptValueUnwrap(obj);
+	}
+
+	// Methods are the same for every instance of a type, so their wrappers only need to be made once
+	_luaPushMethodCache(luaContext, obj->type);
+	lua_pushvalue(lua, -2);
+	lua_rawget(lua, -2);
+	if (!lua_isnil(lua, -1)) {
+		return 1;
+	}
+	lua_pop(lua, 1);
 
 	if (!mScriptObjectGet(obj, key, &val)) {
+		lua_pop(lua, 3);
 		char error[MAX_KEY_SIZE + 16];
 		snprintf(error, sizeof(error), "Invalid key '%s'", key);
 		luaL_traceback(lua, lua, "Invalid key", 1);
@@ -1252,9 +1507,21 @@ int _luaGetObject(lua_State* lua) {
 	}
 
 	if (!_luaWrap(luaContext, &val)) {
+		lua_pop(lua, 3);
 		luaL_traceback(lua, lua, "Error translating value from runtime", 1);
 		return lua_error(lua);
 	}
+
+	// Only members declared on the class can be cached, since the getter can return anything
+	const struct mScriptClassMember* member = NULL;
+	if (obj->type->base == mSCRIPT_TYPE_OBJECT && obj->type->details.cls) {
+		member = HashTableLookup(&obj->type->details.cls->instanceMembers, key);
+	}
+	if (member && member->type->base == mSCRIPT_TYPE_FUNCTION) {
+		lua_pushvalue(lua, -3);
+		lua_pushvalue(lua, -2);
+		lua_rawset(lua, -4);
+	}
 	return 1;
 }
 
@@ -9,16 +9,35 @@
 
 #include <mgba/internal/script/socket.h>
 #include <mgba/script/macros.h>
+#include <mgba-util/math.h>
 #include <mgba-util/socket.h>
+#include <mgba-util/vector.h>
+
+struct mScriptSocketSet;
 
 struct mScriptSocket {
 	Socket socket;
 	struct Address address;
 	int32_t error;
 	uint16_t port;
+	// Filled in by mScriptSocketSet.poll: 1 if data can be read, -1 if an error occurred
+	int32_t events;
+	struct mScriptSocketSet* set;
 };
 mSCRIPT_DECLARE_STRUCT(mScriptSocket);
 
+DECLARE_VECTOR(mScriptSocketList, struct mScriptSocket*);
+DEFINE_VECTOR(mScriptSocketList, struct mScriptSocket*);
+
+struct mScriptSocketSet {
+	struct mScriptSocketList sockets;
+	// SocketPoll overwrites the lists it's given, so they're rebuilt from here each time
+	Socket* reads;
+	Socket* errors;
+	size_t capacity;
+};
+mSCRIPT_DECLARE_STRUCT(mScriptSocketSet);
+
 static const struct _mScriptSocketErrorMapping {
 	int32_t nativeError;
 	enum mSocketErrorCode mappedError;
@@ -104,9 +123,15 @@ struct mScriptValue* _mScriptSocketCreate() {
 	return result;
 }
 
+static void _mScriptSocketSetUnwatch(struct mScriptSocketSet* set, struct mScriptSocket* ssock);
+
 void _mScriptSocketClose(struct mScriptSocket* ssock) {
+	if (ssock->set) {
+		_mScriptSocketSetUnwatch(ssock->set, ssock);
+	}
 	if (!SOCKET_FAILED(ssock->socket)) {
 		SocketClose(ssock->socket);
+		ssock->socket = INVALID_SOCKET;
 	}
 }
 
@@ -196,6 +221,100 @@ uint32_t _mScriptSocketSelectOne(struct mScriptSocket* ssock, int64_t timeoutMil
 	return 1;
 }
 
+static void _mScriptSocketSetWatch(struct mScriptSocketSet* set, struct mScriptSocket* ssock) {
+	if (ssock->set == set) {
+		return;
+	}
+	if (ssock->set) {
+		_mScriptSocketSetUnwatch(ssock->set, ssock);
+	}
+	*mScriptSocketListAppend(&set->sockets) = ssock;
+	ssock->set = set;
+	ssock->events = 0;
+}
+
+static void _mScriptSocketSetUnwatch(struct mScriptSocketSet* set, struct mScriptSocket* ssock) {
+	if (ssock->set != set) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < mScriptSocketListSize(&set->sockets); ++i) {
+		if (*mScriptSocketListGetPointer(&set->sockets, i) == ssock) {
+			mScriptSocketListShift(&set->sockets, i, 1);
+			break;
+		}
+	}
+	ssock->set = NULL;
+	ssock->events = 0;
+}
+
+static bool _mScriptSocketFind(const Socket* sockets, size_t nSockets, Socket socket) {
+	size_t i;
+	// SocketPoll puts everything that's ready at the front
+	for (i = 0; i < nSockets && !SOCKET_FAILED(sockets[i]); ++i) {
+		if (sockets[i] == socket) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Checks every watched socket with a single call, instead of one per socket
+static int32_t _mScriptSocketSetPoll(struct mScriptSocketSet* set, int64_t timeoutMillis) {
+	size_t nSockets = mScriptSocketListSize(&set->sockets);
+	if (nSockets > set->capacity) {
+		set->capacity = toPow2(nSockets);
+		set->reads = realloc(set->reads, set->capacity * sizeof(Socket));
+		set->errors = realloc(set->errors, set->capacity * sizeof(Socket));
+	}
+	size_t nOpen = 0;
+	size_t i;
+	for (i = 0; i < nSockets; ++i) {
+		struct mScriptSocket* ssock = *mScriptSocketListGetPointer(&set->sockets, i);
+		ssock->events = 0;
+		if (!SOCKET_FAILED(ssock->socket)) {
+			set->reads[nOpen] = ssock->socket;
+			set->errors[nOpen] = ssock->socket;
+			++nOpen;
+		}
+	}
+	if (!nOpen) {
+		return 0;
+	}
+	if (!SocketPoll(nOpen, set->reads, NULL, set->errors, timeoutMillis)) {
+		return 0;
+	}
+
+	int32_t ready = 0;
+	for (i = 0; i < nSockets; ++i) {
+		struct mScriptSocket* ssock = *mScriptSocketListGetPointer(&set->sockets, i);
+		if (SOCKET_FAILED(ssock->socket)) {
+			continue;
+		}
+		if (_mScriptSocketFind(set->errors, nOpen, ssock->socket)) {
+			_mScriptSocketSetError(ssock, SocketError());
+			ssock->events = -1;
+		} else if (_mScriptSocketFind(set->reads, nOpen, ssock->socket)) {
+			ssock->events = 1;
+		} else {
+			continue;
+		}
+		++ready;
+	}
+	return ready;
+}
+
+static void _mScriptSocketSetDeinit(struct mScriptSocketSet* set) {
+	size_t i;
+	for (i = 0; i < mScriptSocketListSize(&set->sockets); ++i) {
+		struct mScriptSocket* ssock = *mScriptSocketListGetPointer(&set->sockets, i);
+		ssock->set = NULL;
+	}
+	mScriptSocketListDeinit(&set->sockets);
+	free(set->reads);
+	free(set->errors);
+}
+
 mSCRIPT_BIND_FUNCTION(mScriptSocketCreate_Binding, W(mScriptSocket), _mScriptSocketCreate, 0);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptSocket, close, _mScriptSocketClose, 0);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSocket, W(mScriptSocket), accept, _mScriptSocketAccept, 0);
@@ -251,6 +370,31 @@ mSCRIPT_DEFINE_STRUCT(mScriptSocket)
 		"One of the C.SOCKERR constants describing the last error on the socket."
 	)
 	mSCRIPT_DEFINE_STRUCT_MEMBER(mScriptSocket, S32, error)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"The result of the last struct::SocketSet.poll that included this socket: "
+		"1 if data is available to be read, -1 if an error has occurred, or 0 otherwise."
+	)
+	mSCRIPT_DEFINE_STRUCT_MEMBER(mScriptSocket, S32, events)
+mSCRIPT_DEFINE_END;
+
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptSocketSet, watch, _mScriptSocketSetWatch, 1, S(mScriptSocket), socket);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptSocketSet, unwatch, _mScriptSocketSetUnwatch, 1, S(mScriptSocket), socket);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSocketSet, S32, poll, _mScriptSocketSetPoll, 1, S64, timeoutMillis);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptSocketSet, _deinit, _mScriptSocketSetDeinit, 0);
+
+mSCRIPT_DEFINE_STRUCT(mScriptSocketSet)
+	mSCRIPT_DEFINE_INTERNAL
+	mSCRIPT_DEFINE_CLASS_DOCSTRING("An internal set of sockets that can all be checked for events at once.")
+	mSCRIPT_DEFINE_STRUCT_DEINIT(mScriptSocketSet)
+	mSCRIPT_DEFINE_DOCSTRING("Adds a socket to the set. A socket can only be in one set at a time.")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSocketSet, watch)
+	mSCRIPT_DEFINE_DOCSTRING("Removes a socket from the set. Closing a socket also removes it.")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSocketSet, unwatch)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Checks every socket in the set and updates their struct::Socket.events members. "
+		"Returns the number of sockets that have events."
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSocketSet, poll)
 mSCRIPT_DEFINE_END;
 
 mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptSocket, listen)
@@ -259,12 +403,19 @@ mSCRIPT_DEFINE_DEFAULTS_END;
 
 
 void mScriptContextAttachSocket(struct mScriptContext* context) {
+	struct mScriptValue* set = mScriptValueAlloc(mSCRIPT_TYPE_MS_S(mScriptSocketSet));
+	set->value.opaque = calloc(1, sizeof(struct mScriptSocketSet));
+	mScriptSocketListInit(&((struct mScriptSocketSet*) set->value.opaque)->sockets, 0);
+	set->flags = mSCRIPT_VALUE_FLAG_FREE_BUFFER;
+
 	mScriptContextExportNamespace(context, "_socket", (struct mScriptKVPair[]) {
 		mSCRIPT_KV_PAIR(create, &mScriptSocketCreate_Binding),
+		mSCRIPT_KV_PAIR(set, set),
 		mSCRIPT_KV_SENTINEL
 	});
 	mScriptContextSetDocstring(context, "_socket", "Basic TCP sockets library");
 	mScriptContextSetDocstring(context, "_socket.create", "Creates a new socket object");
+	mScriptContextSetDocstring(context, "_socket.set", "The set of sockets that are checked for events every frame");
 	mScriptContextExportConstants(context, "SOCKERR", (struct mScriptKVPair[]) {
 		mSCRIPT_CONSTANT_PAIR(mSCRIPT_SOCKERR, UNKNOWN_ERROR),
 		mSCRIPT_CONSTANT_PAIR(mSCRIPT_SOCKERR, OK),
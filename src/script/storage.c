@@ -6,22 +6,43 @@
 #include <mgba/script/storage.h>
 
 #include <mgba/core/config.h>
+#include <mgba-util/threading.h>
 #include <mgba-util/vfs.h>
 
 #include <json.h>
 #include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
 
 #define STORAGE_LEN_MAX 64
 
+struct mScriptStorageContext;
 struct mScriptStorageBucket {
+	struct mScriptStorageContext* storage;
 	char* name;
 	struct mScriptValue* root;
 	bool autoflush;
 	bool dirty;
 };
 
+struct mScriptStorageWrite {
+	char* path;
+	char* data;
+	size_t size;
+};
+
 struct mScriptStorageContext {
 	struct Table buckets;
+
+	// Serialized buckets waiting on the writer thread, keyed by bucket name.
+	// Flushing a bucket again before it's written replaces the older copy.
+	struct Table pendingWrites;
+	Thread writer;
+	Mutex writeMutex;
+	Condition writeCond;
+	bool writing;
+	bool exiting;
 };
 
 void mScriptStorageBucketDeinit(void*);
@@ -77,7 +98,10 @@ mSCRIPT_DEFINE_STRUCT(mScriptStorageBucket)
 	mSCRIPT_DEFINE_STRUCT_DEFAULT_GET(mScriptStorageBucket)
 	mSCRIPT_DEFINE_DOCSTRING("Reload the state of the bucket from disk")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptStorageBucket, reload)
-	mSCRIPT_DEFINE_DOCSTRING("Flush the bucket to disk manually")
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Flush the bucket to disk manually. The file is written in the background; this returns "
+		"false only if the bucket couldn't be serialized"
+	)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptStorageBucket, flush)
 	mSCRIPT_DEFINE_DOCSTRING(
 		"Enable or disable the automatic flushing of this bucket. This is good for ensuring buckets "
@@ -279,38 +303,145 @@ bool mScriptStorageToJson(struct mScriptValue* value, struct json_object** out)
 #define JSON_C_TO_STRING_PRETTY_TAB 0
 #endif
 
-static bool _mScriptStorageBucketFlushVF(struct mScriptStorageBucket* bucket, struct VFile* vf) {
+static char* _mScriptStorageBucketSerialize(struct mScriptStorageBucket* bucket, size_t* size) {
 	struct json_object* rootObj;
-	bool ok = mScriptStorageToJson(bucket->root, &rootObj);
-	if (!ok) {
-		vf->close(vf);
-		return false;
+	if (!mScriptStorageToJson(bucket->root, &rootObj)) {
+		return NULL;
 	}
 
 	const char* json = json_object_to_json_string_ext(rootObj, JSON_C_TO_STRING_PRETTY | JSON_C_TO_STRING_PRETTY_TAB);
-	if (!json) {
-		json_object_put(rootObj);
+	char* data = NULL;
+	if (json) {
+		*size = strlen(json);
+		data = malloc(*size);
+		memcpy(data, json, *size);
+	}
+	json_object_put(rootObj);
+	return data;
+}
+
+static bool _mScriptStorageBucketFlushVF(struct mScriptStorageBucket* bucket, struct VFile* vf) {
+	size_t size;
+	char* data = _mScriptStorageBucketSerialize(bucket, &size);
+	if (!data) {
 		vf->close(vf);
 		return false;
 	}
 
-	vf->write(vf, json, strlen(json));
+	vf->write(vf, data, size);
 	vf->close(vf);
+	free(data);
 
 	bucket->dirty = false;
-
-	json_object_put(rootObj);
 	return true;
 }
 
-bool mScriptStorageBucketFlush(struct mScriptStorageBucket* bucket) {
-	char path[PATH_MAX];
-	mScriptStorageGetBucketPath(bucket->name, path);
-	struct VFile* vf = VFileOpen(path, O_WRONLY | O_CREAT | O_TRUNC);
+static bool _mScriptStorageWriteAtomic(const char* path, const char* data, size_t size) {
+	// Write next to the bucket and swap it in, so a crash mid-write can't truncate the old copy
+	char tmpPath[PATH_MAX];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+	struct VFile* vf = VFileOpen(tmpPath, O_WRONLY | O_CREAT | O_TRUNC);
 	if (!vf) {
 		return false;
 	}
-	return _mScriptStorageBucketFlushVF(bucket, vf);
+	bool ok = vf->write(vf, data, size) == (ssize_t) size;
+	vf->close(vf);
+	if (ok) {
+#ifdef _WIN32
+		wchar_t wTmpPath[PATH_MAX];
+		wchar_t wPath[PATH_MAX];
+		MultiByteToWideChar(CP_UTF8, 0, tmpPath, -1, wTmpPath, sizeof(wTmpPath) / sizeof(*wTmpPath));
+		MultiByteToWideChar(CP_UTF8, 0, path, -1, wPath, sizeof(wPath) / sizeof(*wPath));
+		ok = MoveFileExW(wTmpPath, wPath, MOVEFILE_REPLACE_EXISTING);
+#else
+		ok = rename(tmpPath, path) == 0;
+#endif
+	}
+	if (!ok) {
+		remove(tmpPath);
+	}
+	return ok;
+}
+
+static void _mScriptStorageWriteFree(void* data) {
+	struct mScriptStorageWrite* write = data;
+	free(write->path);
+	free(write->data);
+	free(write);
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _mScriptStorageWriterThread(void* context) {
+	struct mScriptStorageContext* storage = context;
+	ThreadSetName("Storage Writer");
+
+	MutexLock(&storage->writeMutex);
+	while (true) {
+		struct TableIterator iter;
+		if (!HashTableIteratorStart(&storage->pendingWrites, &iter)) {
+			if (storage->exiting) {
+				break;
+			}
+			ConditionWait(&storage->writeCond, &storage->writeMutex);
+			continue;
+		}
+		char* name = strdup(HashTableIteratorGetKey(&storage->pendingWrites, &iter));
+		struct mScriptStorageWrite* pending = HashTableIteratorGetValue(&storage->pendingWrites, &iter);
+		struct mScriptStorageWrite write = *pending;
+		pending->path = NULL;
+		pending->data = NULL;
+		HashTableRemove(&storage->pendingWrites, name);
+		free(name);
+		storage->writing = true;
+		MutexUnlock(&storage->writeMutex);
+
+		if (!_mScriptStorageWriteAtomic(write.path, write.data, write.size)) {
+			mLOG(SCRIPT, WARN, "Failed to write storage bucket to %s", write.path);
+		}
+		free(write.path);
+		free(write.data);
+
+		MutexLock(&storage->writeMutex);
+		storage->writing = false;
+		ConditionWake(&storage->writeCond);
+	}
+	MutexUnlock(&storage->writeMutex);
+	THREAD_EXIT(0);
+}
+#endif
+
+static void _mScriptStorageWaitForWrites(struct mScriptStorageContext* storage) {
+	MutexLock(&storage->writeMutex);
+	while (storage->writing || HashTableSize(&storage->pendingWrites)) {
+		ConditionWait(&storage->writeCond, &storage->writeMutex);
+	}
+	MutexUnlock(&storage->writeMutex);
+}
+
+bool mScriptStorageBucketFlush(struct mScriptStorageBucket* bucket) {
+	struct mScriptStorageWrite* write = calloc(1, sizeof(*write));
+	write->data = _mScriptStorageBucketSerialize(bucket, &write->size);
+	if (!write->data) {
+		free(write);
+		return false;
+	}
+	char path[PATH_MAX];
+	mScriptStorageGetBucketPath(bucket->name, path);
+	write->path = strdup(path);
+	bucket->dirty = false;
+
+#ifdef DISABLE_THREADING
+	bool ok = _mScriptStorageWriteAtomic(write->path, write->data, write->size);
+	_mScriptStorageWriteFree(write);
+	return ok;
+#else
+	struct mScriptStorageContext* storage = bucket->storage;
+	MutexLock(&storage->writeMutex);
+	HashTableInsert(&storage->pendingWrites, bucket->name, write);
+	ConditionWake(&storage->writeCond);
+	MutexUnlock(&storage->writeMutex);
+	return true;
+#endif
 }
 
 void mScriptStorageBucketEnableAutoFlush(struct mScriptStorageBucket* bucket, bool enable) {
@@ -325,10 +456,21 @@ bool mScriptStorageSaveBucketVF(struct mScriptContext* context, const char* buck
 	}
 	struct mScriptStorageContext* storage = value->value.opaque;
 	struct mScriptStorageBucket* bucket = mScriptStorageGetBucket(storage, bucketName);
+	if (!bucket) {
+		vf->close(vf);
+		return false;
+	}
+	// Don't let an older queued flush land on top of this one
+	_mScriptStorageWaitForWrites(storage);
 	return _mScriptStorageBucketFlushVF(bucket, vf);
 }
 
 bool mScriptStorageSaveBucket(struct mScriptContext* context, const char* bucketName) {
+	struct mScriptValue* value = mScriptContextGetGlobal(context, "storage");
+	if (value) {
+		// A queued flush would otherwise swap its own file in over this one
+		_mScriptStorageWaitForWrites(value->value.opaque);
+	}
 	char path[PATH_MAX];
 	mScriptStorageGetBucketPath(bucketName, path);
 	struct VFile* vf = VFileOpen(path, O_WRONLY | O_CREAT | O_TRUNC);
@@ -421,6 +563,7 @@ static struct mScriptValue* _mScriptStorageLoadJson(struct VFile* vf) {
 }
 
 bool mScriptStorageBucketReload(struct mScriptStorageBucket* bucket) {
+	_mScriptStorageWaitForWrites(bucket->storage);
 	char path[PATH_MAX];
 	mScriptStorageGetBucketPath(bucket->name, path);
 	struct VFile* vf = VFileOpen(path, O_RDONLY);
@@ -478,6 +621,12 @@ void mScriptContextAttachStorage(struct mScriptContext* context) {
 	value->value.opaque = storage;
 
 	HashTableInit(&storage->buckets, 0, mScriptStorageBucketDeinit);
+	HashTableInit(&storage->pendingWrites, 0, _mScriptStorageWriteFree);
+	MutexInit(&storage->writeMutex);
+	ConditionInit(&storage->writeCond);
+#ifndef DISABLE_THREADING
+	ThreadCreate(&storage->writer, _mScriptStorageWriterThread, storage);
+#endif
 
 	mScriptContextSetGlobal(context, "storage", value);
 	mScriptContextSetDocstring(context, "storage", "Singleton instance of struct::mScriptStorageContext");
@@ -493,7 +642,19 @@ void mScriptStorageFlushAll(struct mScriptContext* context) {
 }
 
 void mScriptStorageContextDeinit(struct mScriptStorageContext* storage) {
+	// Dirty buckets queue their last flush here, which the writer drains before exiting
 	HashTableDeinit(&storage->buckets);
+
+	MutexLock(&storage->writeMutex);
+	storage->exiting = true;
+	ConditionWake(&storage->writeCond);
+	MutexUnlock(&storage->writeMutex);
+#ifndef DISABLE_THREADING
+	ThreadJoin(&storage->writer);
+#endif
+	HashTableDeinit(&storage->pendingWrites);
+	ConditionDeinit(&storage->writeCond);
+	MutexDeinit(&storage->writeMutex);
 }
 
 void mScriptStorageContextFlushAll(struct mScriptStorageContext* storage) {
@@ -501,7 +662,7 @@ void mScriptStorageContextFlushAll(struct mScriptStorageContext* storage) {
 	if (HashTableIteratorStart(&storage->buckets, &iter)) {
 		do {
 			struct mScriptStorageBucket* bucket = HashTableIteratorGetValue(&storage->buckets, &iter);
-			if (bucket->autoflush) {
+			if (bucket->autoflush && bucket->dirty) {
 				mScriptStorageBucketFlush(bucket);
 			}
 		} while (HashTableIteratorNext(&storage->buckets, &iter));
@@ -537,6 +698,7 @@ struct mScriptStorageBucket* mScriptStorageGetBucket(struct mScriptStorageContex
 	}
 
 	bucket = calloc(1, sizeof(*bucket));
+	bucket->storage = storage;
 	bucket->name = strdup(name);
 	bucket->autoflush = true;
 	if (!mScriptStorageBucketReload(bucket)) {
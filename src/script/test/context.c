@@ -7,6 +7,22 @@
 
 #include <mgba/script.h>
 
+static int callbackTotal;
+static struct mScriptContext* removeContext;
+static uint32_t removeId;
+
+static void addToTotal(int32_t amount) {
+	callbackTotal += amount;
+}
+
+static void removeCallback(int32_t amount) {
+	UNUSED(amount);
+	mScriptContextRemoveCallback(removeContext, removeId);
+}
+
+mSCRIPT_BIND_VOID_FUNCTION(boundAddToTotal, addToTotal, 1, S32, amount);
+mSCRIPT_BIND_VOID_FUNCTION(boundRemoveCallback, removeCallback, 1, S32, amount);
+
 M_TEST_DEFINE(weakrefBasic) {
 	struct mScriptContext context;
 	mScriptContextInit(&context);
@@ -94,8 +110,76 @@ M_TEST_DEFINE(disownWeakref) {
 	mScriptContextDeinit(&context);
 }
 
+M_TEST_DEFINE(framePool) {
+	struct mScriptContext context;
+	mScriptContextInit(&context);
+
+	struct mScriptFrame* frame = mScriptContextAcquireFrame(&context);
+	assert_non_null(frame);
+	assert_int_equal(mScriptListSize(&frame->arguments), 0);
+	assert_int_equal(mScriptListSize(&frame->returnValues), 0);
+	mSCRIPT_PUSH(&frame->arguments, S32, 1);
+	mSCRIPT_PUSH(&frame->returnValues, S32, 2);
+
+	struct mScriptFrame* nested = mScriptContextAcquireFrame(&context);
+	assert_ptr_not_equal(frame, nested);
+	mScriptContextReleaseFrame(&context, nested);
+	mScriptContextReleaseFrame(&context, frame);
+
+	struct mScriptFrame* reused = mScriptContextAcquireFrame(&context);
+	assert_ptr_equal(reused, frame);
+	assert_int_equal(mScriptListSize(&reused->arguments), 0);
+	assert_int_equal(mScriptListSize(&reused->returnValues), 0);
+	mScriptContextReleaseFrame(&context, reused);
+
+	mScriptContextDeinit(&context);
+}
+
+M_TEST_DEFINE(callbackEvents) {
+	struct mScriptContext context;
+	mScriptContextInit(&context);
+	callbackTotal = 0;
+
+	assert_int_equal(mScriptContextGetCallbackEvent(&context, "frame"), mSCRIPT_CALLBACK_FRAME);
+	uint32_t custom = mScriptContextGetCallbackEvent(&context, "custom");
+	assert_int_equal(custom, mSCRIPT_CALLBACK_MAX);
+	assert_int_equal(mScriptContextGetCallbackEvent(&context, "custom"), custom);
+
+	struct mScriptList args;
+	mScriptListInit(&args, 1);
+	mSCRIPT_PUSH(&args, S32, 1);
+
+	uint32_t cbid = mScriptContextAddCallback(&context, "frame", &boundAddToTotal);
+	assert_int_not_equal(cbid, 0);
+	assert_int_not_equal(mScriptContextAddOneshot(&context, "frame", &boundAddToTotal), 0);
+
+	mScriptContextTriggerCallbackEvent(&context, mSCRIPT_CALLBACK_FRAME, &args);
+	assert_int_equal(callbackTotal, 2);
+	mScriptContextTriggerCallback(&context, "frame", &args);
+	assert_int_equal(callbackTotal, 3);
+	mScriptContextTriggerCallbackEvent(&context, custom, &args);
+	mScriptContextTriggerCallbackEvent(&context, mSCRIPT_CALLBACK_NONE, &args);
+	mScriptContextTriggerCallbackEvent(&context, custom + 1, &args);
+	assert_int_equal(callbackTotal, 3);
+
+	// Removing a callback that hasn't run yet from inside dispatch must skip it
+	removeContext = &context;
+	mScriptContextAddCallback(&context, "frame", &boundRemoveCallback);
+	removeId = mScriptContextAddCallback(&context, "frame", &boundAddToTotal);
+	mScriptContextTriggerCallbackEvent(&context, mSCRIPT_CALLBACK_FRAME, &args);
+	assert_int_equal(callbackTotal, 4);
+	mScriptContextRemoveCallback(&context, cbid);
+	mScriptContextTriggerCallbackEvent(&context, mSCRIPT_CALLBACK_FRAME, &args);
+	assert_int_equal(callbackTotal, 4);
+
+	mScriptListDeinit(&args);
+	mScriptContextDeinit(&context);
+}
+
 M_TEST_SUITE_DEFINE(mScript,
 	cmocka_unit_test(weakrefBasic),
 	cmocka_unit_test(drainPool),
 	cmocka_unit_test(disownWeakref),
+	cmocka_unit_test(framePool),
+	cmocka_unit_test(callbackEvents),
 )
@@ -648,6 +648,51 @@ M_TEST_DEFINE(globalStructMethods) {
 	mScriptContextDeinit(&context);
 }
 
+M_TEST_DEFINE(methodCache) {
+	SETUP_LUA;
+
+	struct Test s1 = {
+		.i = 1,
+		.ifn0 = testI0,
+	};
+	struct Test s2 = {
+		.i = 5,
+		.ifn0 = testI0,
+	};
+
+	struct mScriptValue a;
+	struct mScriptValue b;
+	struct mScriptValue* val;
+
+	// The second lookup of the method is cached, but it must still be called on the right instance
+	LOAD_PROGRAM("b = a:ifn0() + a.i * 10");
+
+	a = mSCRIPT_MAKE_S(Test, &s1);
+	assert_true(lua->setGlobal(lua, "a", &a));
+	assert_true(lua->run(lua));
+	b = mSCRIPT_MAKE_S32(11);
+	val = lua->getGlobal(lua, "b");
+	assert_non_null(val);
+	assert_true(b.type->equal(&b, val));
+	mScriptValueDeref(val);
+
+	a = mSCRIPT_MAKE_S(Test, &s2);
+	assert_true(lua->setGlobal(lua, "a", &a));
+	assert_true(lua->run(lua));
+	b = mSCRIPT_MAKE_S32(55);
+	val = lua->getGlobal(lua, "b");
+	assert_non_null(val);
+	assert_true(b.type->equal(&b, val));
+	mScriptValueDeref(val);
+
+	// Const instances are a different type, so they don't share the cache
+	a = mSCRIPT_MAKE_CS(Test, &s1);
+	assert_true(lua->setGlobal(lua, "a", &a));
+	assert_false(lua->run(lua));
+
+	mScriptContextDeinit(&context);
+}
+
 M_TEST_DEFINE(errorReporting) {
 	SETUP_LUA;
 
@@ -849,6 +894,60 @@ M_TEST_DEFINE(tableConvert) {
 	mScriptContextDeinit(&context);
 }
 
+#define LOAD_CACHED_PROGRAM(PATH, PROG) \
+	do { \
+		struct VFile* vf = VFileFromConstMemory(PROG, strlen(PROG)); \
+		assert_true(lua->load(lua, PATH, vf)); \
+		vf->close(vf); \
+		assert_true(lua->run(lua)); \
+	} while(0)
+
+M_TEST_DEFINE(bytecodeCache) {
+	const char* path = "xtest" PATH_SEP "cached.lua";
+	char cachePath[PATH_MAX];
+	mScriptEngineLuaGetBytecodePath(path, cachePath);
+	remove(cachePath);
+
+	SETUP_LUA;
+	struct mScriptValue a = mSCRIPT_MAKE_S32(1);
+	struct mScriptValue* val;
+
+	LOAD_CACHED_PROGRAM(path, "a = 1");
+	val = lua->getGlobal(lua, "a");
+	assert_non_null(val);
+	assert_true(a.type->equal(&a, val));
+	mScriptValueDeref(val);
+	mScriptContextDeinit(&context);
+
+	struct VFile* vf = VFileOpen(cachePath, O_RDONLY);
+	assert_non_null(vf);
+	assert_true(vf->size(vf) > (ssize_t) strlen(path));
+	vf->close(vf);
+
+	// Second load comes from the cache
+	mScriptContextInit(&context);
+	lua = mScriptContextRegisterEngine(&context, mSCRIPT_ENGINE_LUA);
+	LOAD_CACHED_PROGRAM(path, "a = 1");
+	val = lua->getGlobal(lua, "a");
+	assert_non_null(val);
+	assert_true(a.type->equal(&a, val));
+	mScriptValueDeref(val);
+	mScriptContextDeinit(&context);
+
+	// Changed source is recompiled, not loaded from the stale cache
+	mScriptContextInit(&context);
+	lua = mScriptContextRegisterEngine(&context, mSCRIPT_ENGINE_LUA);
+	LOAD_CACHED_PROGRAM(path, "a = 2");
+	a = mSCRIPT_MAKE_S32(2);
+	val = lua->getGlobal(lua, "a");
+	assert_non_null(val);
+	assert_true(a.type->equal(&a, val));
+	mScriptValueDeref(val);
+	mScriptContextDeinit(&context);
+
+	remove(cachePath);
+}
+
 M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptLua,
 	cmocka_unit_test(create),
 	cmocka_unit_test(loadGood),
@@ -864,6 +963,7 @@ M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptLua,
 	cmocka_unit_test(globalStructFieldGet),
 	cmocka_unit_test(globalStructFieldSet),
 	cmocka_unit_test(globalStructMethods),
+	cmocka_unit_test(methodCache),
 	cmocka_unit_test(errorReporting),
 	cmocka_unit_test(tableLookup),
 	cmocka_unit_test(tableIterate),
@@ -871,4 +971,5 @@ M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptLua,
 	cmocka_unit_test(linkedList),
 	cmocka_unit_test(listConvert),
 	cmocka_unit_test(tableConvert),
+	cmocka_unit_test(bytecodeCache),
 )
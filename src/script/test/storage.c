@@ -170,6 +170,24 @@ M_TEST_DEFINE(invalidObject) {
 	mScriptContextDeinit(&context);
 }
 
+M_TEST_DEFINE(flushReload) {
+	SETUP_LUA;
+
+	TEST_PROGRAM("bucket = storage:getBucket('xtest')");
+	TEST_PROGRAM("bucket.a = 1");
+	TEST_PROGRAM("assert(bucket:flush())");
+	TEST_PROGRAM("bucket.a = 2");
+	TEST_PROGRAM("assert(bucket:reload())");
+	TEST_PROGRAM("assert(bucket.a == 1)");
+
+	char tmpPath[PATH_MAX + 4];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", bucketPath);
+	struct VFile* vf = VFileOpen(tmpPath, O_RDONLY);
+	assert_null(vf);
+
+	mScriptContextDeinit(&context);
+}
+
 M_TEST_DEFINE(serializeInt) {
 	SETUP_LUA;
 
@@ -561,6 +579,7 @@ M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptStorage,
 	cmocka_unit_test(basicTable),
 	cmocka_unit_test(nullByteString),
 	cmocka_unit_test(invalidObject),
+	cmocka_unit_test(flushReload),
 	cmocka_unit_test(structured),
 	cmocka_unit_test(serializeInt),
 	cmocka_unit_test(serializeFloat),
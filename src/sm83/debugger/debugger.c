@@ -25,10 +25,27 @@ static struct mBreakpoint* _lookupBreakpoint(struct mBreakpointList* breakpoints
 	return NULL;
 }
 
+static inline bool _checkBreakpointFilter(const struct SM83Debugger* debugger, uint16_t address) {
+	return debugger->breakpointFilter[address >> 5] & (1U << (address & 0x1F));
+}
+
+static void _markBreakpointFilter(struct SM83Debugger* debugger, uint16_t address) {
+	debugger->breakpointFilter[address >> 5] |= 1U << (address & 0x1F);
+}
+
+static void _updateBreakpointFilter(struct SM83Debugger* debugger) {
+	memset(debugger->breakpointFilter, 0, sizeof(debugger->breakpointFilter));
+	size_t i;
+	for (i = 0; i < mBreakpointListSize(&debugger->breakpoints); ++i) {
+		_markBreakpointFilter(debugger, mBreakpointListGetPointer(&debugger->breakpoints, i)->address);
+	}
+}
+
 static void _destroyBreakpoint(struct mDebugger* debugger, struct mBreakpoint* breakpoint) {
 	if (breakpoint->condition) {
 		parseFree(breakpoint->condition);
 	}
+	parseProgramFree(breakpoint->compiledCondition);
 	TableRemove(&debugger->pointOwner, breakpoint->id);
 }
 
@@ -36,11 +53,15 @@ static void _destroyWatchpoint(struct mDebugger* debugger, struct mWatchpoint* w
 	if (watchpoint->condition) {
 		parseFree(watchpoint->condition);
 	}
+	parseProgramFree(watchpoint->compiledCondition);
 	TableRemove(&debugger->pointOwner, watchpoint->id);
 }
 
 static void SM83DebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 	struct SM83Debugger* debugger = (struct SM83Debugger*) d;
+	if (!_checkBreakpointFilter(debugger, debugger->cpu->pc)) {
+		return;
+	}
 	struct mBreakpoint* breakpoint = _lookupBreakpoint(&debugger->breakpoints, debugger->cpu);
 	if (!breakpoint) {
 		return;
@@ -48,7 +69,13 @@ static void SM83DebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 	if (breakpoint->condition) {
 		int32_t value;
 		int segment;
-		if (!mDebuggerEvaluateParseTree(d->p, breakpoint->condition, &value, &segment) || !(value || segment >= 0)) {
+		bool ok;
+		if (breakpoint->compiledCondition) {
+			ok = mDebuggerEvaluateParseProgram(d->p, breakpoint->compiledCondition, &value, &segment);
+		} else {
+			ok = mDebuggerEvaluateParseTree(d->p, breakpoint->condition, &value, &segment);
+		}
+		if (!ok || !(value || segment >= 0)) {
 			return;
 		}
 	}
@@ -75,6 +102,7 @@ static void SM83DebuggerCheckBreakpoints(struct mDebuggerPlatform*);
 static bool SM83DebuggerHasBreakpoints(struct mDebuggerPlatform*);
 static void SM83DebuggerTrace(struct mDebuggerPlatform*, char* out, size_t* length);
 static void SM83DebuggerNextInstructionInfo(struct mDebuggerPlatform* d, struct mDebuggerInstructionInfo* info);
+static void SM83DebuggerTraceState(struct mDebuggerPlatform* d, struct mDebuggerTraceState* state);
 
 struct mDebuggerPlatform* SM83DebuggerPlatformCreate(void) {
 	struct SM83Debugger* platform = malloc(sizeof(struct SM83Debugger));
@@ -93,6 +121,8 @@ struct mDebuggerPlatform* SM83DebuggerPlatformCreate(void) {
 	platform->d.setStackTraceMode = NULL;
 	platform->d.updateStackTrace = NULL;
 	platform->d.nextInstructionInfo = SM83DebuggerNextInstructionInfo;
+	platform->d.traceState = SM83DebuggerTraceState;
+	platform->d.setAccessHook = NULL;
 	platform->printStatus = NULL;
 	return &platform->d;
 }
@@ -102,6 +132,7 @@ void SM83DebuggerInit(void* cpu, struct mDebuggerPlatform* platform) {
 	debugger->cpu = cpu;
 	debugger->originalMemory = debugger->cpu->memory;
 	mBreakpointListInit(&debugger->breakpoints, 0);
+	memset(debugger->breakpointFilter, 0, sizeof(debugger->breakpointFilter));
 	mWatchpointListInit(&debugger->watchpoints, 0);
 	debugger->nextId = 1;
 }
@@ -133,7 +164,9 @@ static ssize_t SM83DebuggerSetBreakpoint(struct mDebuggerPlatform* d, struct mDe
 	struct mBreakpoint* breakpoint = mBreakpointListAppend(&debugger->breakpoints);
 	*breakpoint = *info;
 	breakpoint->id = debugger->nextId;
+	breakpoint->compiledCondition = info->condition ? mDebuggerCompileParseTree(d->p, info->condition) : NULL;
 	TableInsert(&debugger->d.p->pointOwner, breakpoint->id, owner);
+	_markBreakpointFilter(debugger, breakpoint->address);
 	++debugger->nextId;
 	return breakpoint->id;
 }
@@ -148,6 +181,7 @@ static bool SM83DebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t id)
 		if (breakpoint->id == id) {
 			_destroyBreakpoint(debugger->d.p, breakpoint);
 			mBreakpointListShift(breakpoints, i, 1);
+			_updateBreakpointFilter(debugger);
 			return true;
 		}
 	}
@@ -180,6 +214,7 @@ static ssize_t SM83DebuggerSetWatchpoint(struct mDebuggerPlatform* d, struct mDe
 	struct mWatchpoint* watchpoint = mWatchpointListAppend(&debugger->watchpoints);
 	*watchpoint = *info;
 	watchpoint->id = debugger->nextId;
+	watchpoint->compiledCondition = info->condition ? mDebuggerCompileParseTree(d->p, info->condition) : NULL;
 	TableInsert(&debugger->d.p->pointOwner, watchpoint->id, owner);
 	++debugger->nextId;
 	return watchpoint->id;
@@ -247,6 +282,31 @@ static void SM83DebuggerTrace(struct mDebuggerPlatform* d, char* out, size_t* le
 		               cpu->sp, cpu->memory.currentSegment(cpu, cpu->pc), cpu->pc, disassembly);
 }
 
+static void SM83DebuggerTraceState(struct mDebuggerPlatform* d, struct mDebuggerTraceState* state) {
+	struct SM83Debugger* debugger = (struct SM83Debugger*) d;
+	struct SM83Core* cpu = debugger->cpu;
+	struct mCore* core = debugger->d.p->core;
+
+	struct SM83InstructionInfo info = {{0}};
+	uint16_t address = cpu->pc;
+	size_t bytesRemaining;
+	state->address = address;
+	state->opcode = 0;
+	for (bytesRemaining = 1; bytesRemaining && address - cpu->pc < 4; --bytesRemaining) {
+		uint8_t instruction = core->rawRead8(core, address, -1);
+		state->opcode |= instruction << ((address - cpu->pc) * 8);
+		++address;
+		bytesRemaining += SM83Decode(instruction, &info);
+	}
+	state->registers[0] = cpu->af;
+	state->registers[1] = cpu->bc;
+	state->registers[2] = cpu->de;
+	state->registers[3] = cpu->hl;
+	state->registers[4] = cpu->sp;
+	state->registers[5] = cpu->pc;
+	state->nRegisters = 6;
+}
+
 static void SM83DebuggerNextInstructionInfo(struct mDebuggerPlatform* d, struct mDebuggerInstructionInfo* info) {
 	struct SM83Debugger* debugger = (struct SM83Debugger*) d;
 	info->address = debugger->cpu->pc;
@@ -48,7 +48,13 @@ static void _checkWatchpoints(struct SM83Debugger* debugger, uint16_t address, e
 			if (watchpoint->condition) {
 				int32_t value;
 				int segment;
-				if (!mDebuggerEvaluateParseTree(debugger->d.p, watchpoint->condition, &value, &segment) || !(value || segment >= 0)) {
+				bool ok;
+				if (watchpoint->compiledCondition) {
+					ok = mDebuggerEvaluateParseProgram(debugger->d.p, watchpoint->compiledCondition, &value, &segment);
+				} else {
+					ok = mDebuggerEvaluateParseTree(debugger->d.p, watchpoint->condition, &value, &segment);
+				}
+				if (!ok || !(value || segment >= 0)) {
 					continue;
 				}
 			}
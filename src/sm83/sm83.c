@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/sm83/sm83.h>
 
+#include <mgba/core/perf.h>
 #include <mgba/internal/sm83/isa-sm83.h>
 
 void SM83Init(struct SM83Core* cpu) {
@@ -102,6 +103,10 @@ static void _SM83InstructionIRQ(struct SM83Core* cpu) {
 	cpu->instruction = _SM83InstructionIRQDelay;
 }
 
+#if defined(__GNUC__) || defined(__clang__)
+#define SM83_THREADED_DISPATCH
+#endif
+
 static void _SM83Step(struct SM83Core* cpu) {
 	cpu->cycles += cpu->tMultiplier;
 	enum SM83ExecutionState state = cpu->executionState;
@@ -148,9 +153,8 @@ static void _SM83Step(struct SM83Core* cpu) {
 	}
 }
 
-static inline bool _SM83TickInternal(struct SM83Core* cpu) {
+static inline bool _SM83TickFinish(struct SM83Core* cpu) {
 	bool running = true;
-	_SM83Step(cpu);
 	int t = cpu->tMultiplier;
 	if (cpu->cycles + t * 2 >= cpu->nextEvent) {
 		if (cpu->cycles >= cpu->nextEvent) {
@@ -176,6 +180,11 @@ static inline bool _SM83TickInternal(struct SM83Core* cpu) {
 	return running;
 }
 
+static inline bool _SM83TickInternal(struct SM83Core* cpu) {
+	_SM83Step(cpu);
+	return _SM83TickFinish(cpu);
+}
+
 void SM83Tick(struct SM83Core* cpu) {
 	while (cpu->cycles >= cpu->nextEvent) {
 		cpu->irqh.processEvents(cpu);
@@ -186,8 +195,77 @@ void SM83Tick(struct SM83Core* cpu) {
 	}
 }
 
+#ifdef SM83_THREADED_DISPATCH
+void SM83Run(struct SM83Core* cpu) {
+	// This is _SM83Step with each state jumping straight to its handler. It has to live here, since
+	// functions with computed gotos never get inlined.
+	static const void* const states[SM83_CORE_HALT_BUG + 1] = {
+		&&idle, &&idle, &&idle, &&fetch,
+		&&idle, &&idle, &&idle, &&memoryLoad,
+		&&idle, &&idle, &&idle, &&memoryStore,
+		&&idle, &&idle, &&idle, &&readPc,
+		&&idle, &&idle, &&idle, &&stall,
+		&&idle, &&idle, &&idle, &&idle, // SM83_CORE_OP2
+		&&idle, &&idle, &&idle, &&haltBug,
+	};
+	bool running = true;
+	mPERF_ENTER(CPU);
+	while (running || cpu->executionState != SM83_CORE_FETCH) {
+		if (cpu->cycles >= cpu->nextEvent) {
+			cpu->irqh.processEvents(cpu);
+			running = false;
+			continue;
+		}
+		cpu->cycles += cpu->tMultiplier;
+		enum SM83ExecutionState state = cpu->executionState;
+		cpu->executionState = SM83_CORE_IDLE_0;
+		if ((unsigned) state > SM83_CORE_HALT_BUG) {
+			goto idle;
+		}
+		goto *states[state];
+
+	fetch:
+		if (cpu->irqPending) {
+			goto irq;
+		}
+		cpu->bus = cpu->memory.cpuLoad8(cpu, cpu->pc);
+		cpu->instruction = _sm83InstructionTable[cpu->bus];
+		++cpu->pc;
+		goto idle;
+	memoryLoad:
+		cpu->bus = cpu->memory.load8(cpu, cpu->index);
+		goto idle;
+	memoryStore:
+		cpu->memory.store8(cpu, cpu->index, cpu->bus);
+		goto idle;
+	readPc:
+		cpu->bus = cpu->memory.cpuLoad8(cpu, cpu->pc);
+		++cpu->pc;
+		goto idle;
+	stall:
+		cpu->instruction = _sm83InstructionTable[0]; // NOP
+		goto idle;
+	haltBug:
+		if (cpu->irqPending) {
+			goto irq;
+		}
+		cpu->bus = cpu->memory.cpuLoad8(cpu, cpu->pc);
+		cpu->instruction = _sm83InstructionTable[cpu->bus];
+		goto idle;
+	irq:
+		cpu->index = cpu->sp;
+		cpu->irqPending = false;
+		cpu->instruction = _SM83InstructionIRQ;
+		cpu->irqh.setInterrupts(cpu, false);
+	idle:
+		running = _SM83TickFinish(cpu) && running;
+	}
+	mPERF_LEAVE();
+}
+#else
 void SM83Run(struct SM83Core* cpu) {
 	bool running = true;
+	mPERF_ENTER(CPU);
 	while (running || cpu->executionState != SM83_CORE_FETCH) {
 		if (cpu->cycles < cpu->nextEvent) {
 			running = _SM83TickInternal(cpu) && running;
@@ -196,4 +274,6 @@ void SM83Run(struct SM83Core* cpu) {
 			running = false;
 		}
 	}
+	mPERF_LEAVE();
 }
+#endif
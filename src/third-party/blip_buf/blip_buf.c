@@ -22,6 +22,14 @@ Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA */
 	#include "blargg_test.h"
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define BLIP_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define BLIP_NEON 1
+#endif
+
 /* Equivalent to ULONG_MAX >= 0xFFFFFFFF00000000.
 Avoids constants that don't fit in 32 bits. */
 #if ULONG_MAX/0xFFFFFFFF > 0xFFFFFFFF
@@ -125,6 +133,20 @@ blip_t* blip_new( int size )
 	return m;
 }
 
+blip_t* blip_resize( blip_t* m, int size )
+{
+	blip_t* resized;
+	assert( size >= 0 );
+	
+	resized = (blip_t*) realloc( m, sizeof *m + (size + buf_extra) * sizeof (buf_t) );
+	if ( resized )
+	{
+		resized->size = size;
+		blip_clear( resized );
+	}
+	return resized;
+}
+
 void blip_delete( blip_t* m )
 {
 	if ( m != NULL )
@@ -286,6 +308,44 @@ static short const bl_step [phase_count + 1] [half_width] =
 {    0,   43, -115,  350, -488, 1136, -914, 5861}
 };
 
+#if defined(BLIP_SSE2)
+static __m128i reverse_epi16( __m128i v )
+{
+	v = _mm_shufflelo_epi16( v, _MM_SHUFFLE( 0, 1, 2, 3 ) );
+	v = _mm_shufflehi_epi16( v, _MM_SHUFFLE( 0, 1, 2, 3 ) );
+	return _mm_shuffle_epi32( v, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+}
+
+/* Adds a*delta + b*delta2 for each of eight taps to out [0] through out [7].
+Only exact when both deltas fit in 16 bits. */
+static void add_taps( buf_t* out, __m128i a, __m128i b, __m128i deltas )
+{
+	__m128i* o = (__m128i*) out;
+	__m128i lo = _mm_madd_epi16( _mm_unpacklo_epi16( a, b ), deltas );
+	__m128i hi = _mm_madd_epi16( _mm_unpackhi_epi16( a, b ), deltas );
+	_mm_storeu_si128( o,     _mm_add_epi32( _mm_loadu_si128( o ),     lo ) );
+	_mm_storeu_si128( o + 1, _mm_add_epi32( _mm_loadu_si128( o + 1 ), hi ) );
+}
+#elif defined(BLIP_NEON)
+static int16x8_t reverse_s16( int16x8_t v )
+{
+	v = vrev64q_s16( v );
+	return vcombine_s16( vget_high_s16( v ), vget_low_s16( v ) );
+}
+
+/* Adds a*delta + b*delta2 for each of eight taps to out [0] through out [7] */
+static void add_taps( buf_t* out, int16x8_t a, int16x8_t b, int delta, int delta2 )
+{
+	int32_t* o = (int32_t*) out;
+	int32x4_t lo = vmulq_n_s32( vmovl_s16( vget_low_s16( a ) ), delta );
+	int32x4_t hi = vmulq_n_s32( vmovl_s16( vget_high_s16( a ) ), delta );
+	lo = vmlaq_n_s32( lo, vmovl_s16( vget_low_s16( b ) ), delta2 );
+	hi = vmlaq_n_s32( hi, vmovl_s16( vget_high_s16( b ) ), delta2 );
+	vst1q_s32( o,     vaddq_s32( vld1q_s32( o ),     lo ) );
+	vst1q_s32( o + 4, vaddq_s32( vld1q_s32( o + 4 ), hi ) );
+}
+#endif
+
 /* Shifting by pre_shift allows calculation using unsigned int rather than
 possibly-wider fixed_t. On 32-bit platforms, this is likely more efficient.
 And by having pre_shift 32, a 32-bit platform can easily do the shift by
@@ -308,6 +368,27 @@ void blip_add_delta( blip_t* m, unsigned time, int delta )
 	/* Fails if buffer size was exceeded */
 	assert( out <= &SAMPLES( m ) [m->size + end_frame_extra] );
 	
+	/* Rows of bl_step are contiguous, so in + half_width is the next phase and
+	rev - half_width is the previous one. The vector paths produce exactly the
+	same sums as the scalar code below. */
+#if defined(BLIP_SSE2)
+	if ( (short) delta == delta && (short) delta2 == delta2 )
+	{
+		/* One pmaddwd per four taps computes in*delta + in2*delta2 */
+		__m128i const deltas = _mm_set1_epi32( (int) ((unsigned) delta2 << 16 | (delta & 0xFFFF)) );
+		add_taps( out, _mm_loadu_si128( (__m128i const*) in ),
+				_mm_loadu_si128( (__m128i const*) (in + half_width) ), deltas );
+		add_taps( out + half_width, reverse_epi16( _mm_loadu_si128( (__m128i const*) rev ) ),
+				reverse_epi16( _mm_loadu_si128( (__m128i const*) (rev - half_width) ) ), deltas );
+		return;
+	}
+#elif defined(BLIP_NEON)
+	add_taps( out, vld1q_s16( in ), vld1q_s16( in + half_width ), delta, delta2 );
+	add_taps( out + half_width, reverse_s16( vld1q_s16( rev ) ),
+			reverse_s16( vld1q_s16( rev - half_width ) ), delta, delta2 );
+	return;
+#endif
+	
 	out [0] += in[0]*delta + in[half_width+0]*delta2;
 	out [1] += in[1]*delta + in[half_width+1]*delta2;
 	out [2] += in[2]*delta + in[half_width+2]*delta2;
@@ -0,0 +1,46 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/library.h>
+#include <mgba/internal/gba/overrides.h>
+#include <mgba-util/configuration.h>
+
+int main(int argc, char* argv[]) {
+	if (argc < 3 || argc > 4) {
+		fprintf(stderr, "usage: %s DATABASE OVERRIDES [MIN-CONFIDENCE]\n", argv[0]);
+		return 1;
+	}
+	unsigned minConfidence = 1;
+	if (argc == 4) {
+		char* end;
+		minConfidence = strtoul(argv[3], &end, 10);
+		if (!end || *end) {
+			fprintf(stderr, "Invalid confidence: %s\n", argv[3]);
+			return 1;
+		}
+	}
+
+	struct mLibrary* library = mLibraryLoad(argv[1]);
+	if (!library) {
+		fprintf(stderr, "Couldn't open database: %s\n", argv[1]);
+		return 2;
+	}
+
+	struct Configuration overrides;
+	ConfigurationInit(&overrides);
+	// Merge into the existing overrides, if there are any
+	ConfigurationRead(&overrides, argv[2]);
+	size_t written = GBAOverrideExportIdleLoops(&overrides, library, minConfidence);
+	mLibraryDestroy(library);
+
+	if (!ConfigurationWrite(&overrides, argv[2])) {
+		fprintf(stderr, "Couldn't write overrides: %s\n", argv[2]);
+		ConfigurationDeinit(&overrides);
+		return 3;
+	}
+	ConfigurationDeinit(&overrides);
+	printf("Exported %" PRIz "u idle loops\n", written);
+	return 0;
+}
@@ -0,0 +1,58 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/debugger/trace-recorder.h>
+#include <mgba-util/vfs.h>
+
+int main(int argc, char* argv[]) {
+	if (argc < 2 || argc > 4) {
+		fprintf(stderr, "usage: %s TRACE [FIRST [COUNT]]\n", argv[0]);
+		return 1;
+	}
+	uint64_t first = 0;
+	uint64_t count = UINT64_MAX;
+	if (argc > 2) {
+		char* end;
+		first = strtoull(argv[2], &end, 10);
+		if (!end || *end) {
+			fprintf(stderr, "Invalid start: %s\n", argv[2]);
+			return 1;
+		}
+	}
+	if (argc > 3) {
+		char* end;
+		count = strtoull(argv[3], &end, 10);
+		if (!end || *end) {
+			fprintf(stderr, "Invalid count: %s\n", argv[3]);
+			return 1;
+		}
+	}
+
+	struct VFile* vf = VFileOpen(argv[1], O_RDONLY);
+	if (!vf) {
+		fprintf(stderr, "Couldn't open trace: %s\n", argv[1]);
+		return 2;
+	}
+	struct mDebuggerTraceReader reader;
+	if (!mDebuggerTraceReaderOpen(&reader, vf)) {
+		fprintf(stderr, "Not a valid trace: %s\n", argv[1]);
+		vf->close(vf);
+		return 2;
+	}
+
+	char line[512];
+	while (count && mDebuggerTraceReaderNext(&reader)) {
+		// Records only hold changed registers, so earlier records still have to be decoded
+		if (reader.index <= first) {
+			continue;
+		}
+		size_t length = sizeof(line);
+		mDebuggerTraceReaderFormat(&reader, line, &length);
+		printf("%" PRIu64 ": %s\n", reader.index - 1, line);
+		--count;
+	}
+	mDebuggerTraceReaderClose(&reader);
+	return 0;
+}
@@ -97,86 +97,179 @@ void Convolve1DPad0PackedS32(const int32_t* restrict src, int32_t* restrict dst,
 	}
 }
 
-void Convolve2DClampPacked8(const uint8_t* restrict src, uint8_t* restrict dst, size_t width, size_t height, size_t stride, const struct ConvolutionKernel* restrict kernel) {
-	if (kernel->rank != 2) {
-		return;
+static bool _separate(const struct ConvolutionKernel* kernel, float* rowWeights, float* colWeights) {
+	size_t kw = kernel->dims[0];
+	size_t kh = kernel->dims[1];
+	size_t pivot = 0;
+	float max = 0.f;
+	size_t i;
+	for (i = 0; i < kw * kh; ++i) {
+		if (fabsf(kernel->kernel[i]) > max) {
+			max = fabsf(kernel->kernel[i]);
+			pivot = i;
+		}
 	}
-	size_t kx2 = kernel->dims[0] / 2;
-	size_t ky2 = kernel->dims[1] / 2;
-	size_t y;
+	if (max == 0.f) {
+		return false;
+	}
+	size_t px = pivot % kw;
+	size_t py = pivot / kw;
+	size_t x, y;
+	for (x = 0; x < kw; ++x) {
+		rowWeights[x] = kernel->kernel[py * kw + x] / kernel->kernel[pivot];
+	}
+	for (y = 0; y < kh; ++y) {
+		colWeights[y] = kernel->kernel[y * kw + px];
+	}
+	// A kernel is separable if it is exactly the outer product of one of its rows and one of its columns
+	for (y = 0; y < kh; ++y) {
+		for (x = 0; x < kw; ++x) {
+			if (fabsf(kernel->kernel[y * kw + x] - colWeights[y] * rowWeights[x]) > max * 1e-6f) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void _padRow(const uint8_t* restrict irow, uint8_t* restrict padded, size_t width, size_t channels, size_t kw) {
+	// Replicate the edge pixels so the inner loops never need to clamp
+	size_t kx2 = kw / 2;
+	size_t i;
+	for (i = 0; i < width + kw - 1; ++i) {
+		size_t cx = 0;
+		if (i > kx2) {
+			cx = i - kx2;
+		}
+		if (cx >= width) {
+			cx = width - 1;
+		}
+		memcpy(&padded[i * channels], &irow[cx * channels], channels);
+	}
+}
+
+static const uint8_t* _clampRow(const uint8_t* src, size_t y, size_t ky, size_t ky2, size_t height, size_t stride) {
+	size_t cy = 0;
+	if (y + ky > ky2) {
+		cy = y + ky - ky2;
+	}
+	if (cy >= height) {
+		cy = height - 1;
+	}
+	return &src[cy * stride];
+}
+
+static void _convolve2DSeparable(const uint8_t* restrict src, uint8_t* restrict dst, size_t width, size_t height, size_t stride, size_t channels, size_t kw, size_t kh, const float* rowWeights, const float* colWeights) {
+	size_t rowSize = width * channels;
+	size_t ky2 = kh / 2;
+	uint8_t* padded = malloc((width + kw - 1) * channels);
+	float* horizontal = malloc(sizeof(float) * rowSize * height);
+	float* acc = malloc(sizeof(float) * rowSize);
+	size_t x, y, k;
 	for (y = 0; y < height; ++y) {
-		uint8_t* orow = &dst[y * stride];
-		size_t x;
-		for (x = 0; x < width; ++x) {
-			float sum = 0.f;
-			size_t ky;
-			for (ky = 0; ky < kernel->dims[1]; ++ky) {
-				size_t cy = 0;
-				if (y + ky > ky2) {
-					cy = y + ky - ky2;
-				}
-				if (cy >= height) {
-					cy = height - 1;
-				}
-				const uint8_t* irow = &src[cy * stride];
-				size_t kx;
-				for (kx = 0; kx < kernel->dims[0]; ++kx) {
-					size_t cx = 0;
-					if (x + kx > kx2) {
-						cx = x + kx - kx2;
-					}
-					if (cx >= width) {
-						cx = width - 1;
-					}
-					sum += irow[cx] * kernel->kernel[ky * kernel->dims[0] + kx];
-				}
+		float* hrow = &horizontal[y * rowSize];
+		_padRow(&src[y * stride], padded, width, channels, kw);
+		for (x = 0; x < rowSize; ++x) {
+			hrow[x] = 0.f;
+		}
+		for (k = 0; k < kw; ++k) {
+			float weight = rowWeights[k];
+			if (weight == 0.f) {
+				continue;
 			}
-			*orow = sum;
-			++orow;
+			const uint8_t* in = &padded[k * channels];
+			for (x = 0; x < rowSize; ++x) {
+				hrow[x] += in[x] * weight;
+			}
+		}
+	}
+	for (y = 0; y < height; ++y) {
+		for (x = 0; x < rowSize; ++x) {
+			acc[x] = 0.f;
+		}
+		for (k = 0; k < kh; ++k) {
+			float weight = colWeights[k];
+			if (weight == 0.f) {
+				continue;
+			}
+			size_t cy = 0;
+			if (y + k > ky2) {
+				cy = y + k - ky2;
+			}
+			if (cy >= height) {
+				cy = height - 1;
+			}
+			const float* in = &horizontal[cy * rowSize];
+			for (x = 0; x < rowSize; ++x) {
+				acc[x] += in[x] * weight;
+			}
+		}
+		uint8_t* orow = &dst[y * stride];
+		for (x = 0; x < rowSize; ++x) {
+			orow[x] = acc[x];
 		}
 	}
+	free(acc);
+	free(horizontal);
+	free(padded);
 }
 
-void Convolve2DClampChannels8(const uint8_t* restrict src, uint8_t* restrict dst, size_t width, size_t height, size_t stride, size_t channels, const struct ConvolutionKernel* restrict kernel) {
-	if (kernel->rank != 2) {
+static void _convolve2DClamp(const uint8_t* restrict src, uint8_t* restrict dst, size_t width, size_t height, size_t stride, size_t channels, const struct ConvolutionKernel* restrict kernel) {
+	if (kernel->rank != 2 || !width || !height) {
 		return;
 	}
-	size_t kx2 = kernel->dims[0] / 2;
-	size_t ky2 = kernel->dims[1] / 2;
-	size_t y;
+	size_t kw = kernel->dims[0];
+	size_t kh = kernel->dims[1];
+	size_t ky2 = kh / 2;
+	size_t rowSize = width * channels;
+
+	float* rowWeights = malloc(sizeof(float) * kw);
+	float* colWeights = malloc(sizeof(float) * kh);
+	if (kw > 1 && kh > 1 && _separate(kernel, rowWeights, colWeights)) {
+		_convolve2DSeparable(src, dst, width, height, stride, channels, kw, kh, rowWeights, colWeights);
+		free(rowWeights);
+		free(colWeights);
+		return;
+	}
+	free(rowWeights);
+	free(colWeights);
+
+	// Accumulate a whole output row per kernel element. Each pixel still sums its terms in the
+	// same order as a per-pixel loop, but the innermost loop is now contiguous and vectorizable.
+	uint8_t* padded = malloc((width + kw - 1) * channels);
+	float* acc = malloc(sizeof(float) * rowSize);
+	size_t x, y, kx, ky;
 	for (y = 0; y < height; ++y) {
-		uint8_t* orow = &dst[y * stride];
-		size_t x;
-		for (x = 0; x < width; ++x) {
-			size_t c;
-			for (c = 0; c < channels; ++c) {
-				float sum = 0.f;
-				size_t ky;
-				for (ky = 0; ky < kernel->dims[1]; ++ky) {
-					size_t cy = 0;
-					if (y + ky > ky2) {
-						cy = y + ky - ky2;
-					}
-					if (cy >= height) {
-						cy = height - 1;
-					}
-					const uint8_t* irow = &src[cy * stride];
-					size_t kx;
-					for (kx = 0; kx < kernel->dims[0]; ++kx) {
-						size_t cx = 0;
-						if (x + kx > kx2) {
-							cx = x + kx - kx2;
-						}
-						if (cx >= width) {
-							cx = width - 1;
-						}
-						cx *= channels;
-						sum += irow[cx + c] * kernel->kernel[ky * kernel->dims[0] + kx];
-					}
+		for (x = 0; x < rowSize; ++x) {
+			acc[x] = 0.f;
+		}
+		for (ky = 0; ky < kh; ++ky) {
+			const float* krow = &kernel->kernel[ky * kw];
+			_padRow(_clampRow(src, y, ky, ky2, height, stride), padded, width, channels, kw);
+			for (kx = 0; kx < kw; ++kx) {
+				float weight = krow[kx];
+				if (weight == 0.f) {
+					continue;
+				}
+				const uint8_t* in = &padded[kx * channels];
+				for (x = 0; x < rowSize; ++x) {
+					acc[x] += in[x] * weight;
 				}
-				*orow = sum;
-				++orow;
 			}
 		}
+		uint8_t* orow = &dst[y * stride];
+		for (x = 0; x < rowSize; ++x) {
+			orow[x] = acc[x];
+		}
 	}
+	free(acc);
+	free(padded);
+}
+
+void Convolve2DClampPacked8(const uint8_t* restrict src, uint8_t* restrict dst, size_t width, size_t height, size_t stride, const struct ConvolutionKernel* restrict kernel) {
+	_convolve2DClamp(src, dst, width, height, stride, 1, kernel);
+}
+
+void Convolve2DClampChannels8(const uint8_t* restrict src, uint8_t* restrict dst, size_t width, size_t height, size_t stride, size_t channels, const struct ConvolutionKernel* restrict kernel) {
+	_convolve2DClamp(src, dst, width, height, stride, channels, kernel);
 }
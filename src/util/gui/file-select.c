@@ -12,15 +12,28 @@
 
 #include <stdlib.h>
 
-#define ITERATION_SIZE 5
-#define SCANNING_THRESHOLD_1 50
+// How many entries are read, and how many files opened, per frame while the list is shown
+#define LISTING_BUDGET 50
 #ifdef __3DS__
 // 3DS is slooooow at opening files
-#define SCANNING_THRESHOLD_2 10
+#define FILTERING_BUDGET 2
 #else
-#define SCANNING_THRESHOLD_2 50
+#define FILTERING_BUDGET 10
 #endif
 
+struct GUIFileBrowser {
+	struct GUIMenu d;
+	struct VDir* dir;
+	bool listing;
+	// Every file before this index has already passed filterContents
+	size_t checked;
+	const char* preselect;
+	// Where the cursor goes once the listing is done, unless it's been moved by then
+	size_t restoreIndex;
+	bool (*filterName)(const char* name);
+	bool (*filterContents)(struct VFile*);
+};
+
 static void _cleanFiles(struct GUIMenuItemList* currentFiles) {
 	size_t size = GUIMenuItemListSize(currentFiles);
 	size_t i;
@@ -44,132 +57,169 @@ static void _upDirectory(char* currentPath) {
 	end[1] = '\0';
 }
 
-static int _strpcmp(const void* a, const void* b) {
-	return strcasecmp(((const struct GUIMenuItem*) a)->title, ((const struct GUIMenuItem*) b)->title);
+static void _closeDirectory(struct GUIFileBrowser* browser) {
+	if (browser->dir) {
+		browser->dir->close(browser->dir);
+		browser->dir = NULL;
+	}
+	browser->listing = false;
 }
 
-static bool _refreshDirectory(struct GUIParams* params, const char* currentPath, struct GUIMenuItemList* currentFiles, bool (*filterName)(const char* name), bool (*filterContents)(struct VFile*), const char* preselect) {
-	_cleanFiles(currentFiles);
-
-	struct VDir* dir = VDirOpen(currentPath);
+static bool _openDirectory(struct GUIFileBrowser* browser, const char* path, const char* preselect) {
+	struct VDir* dir = VDirOpen(path);
 	if (!dir) {
 		return false;
 	}
-	*GUIMenuItemListAppend(currentFiles) = (struct GUIMenuItem) { .title = "(Up)" };
-	size_t i = 0;
-	size_t items = 0;
-	struct VDirEntry* de;
-	while ((de = dir->listNext(dir))) {
-		++i;
-		if (!(i % SCANNING_THRESHOLD_1)) {
-			uint32_t input = 0;
-			GUIPollInput(params, &input, 0);
-			if (input & (1 << GUI_INPUT_CANCEL)) {
-				dir->close(dir);
-				return false;
-			}
+	_closeDirectory(browser);
+	_cleanFiles(&browser->d.items);
+	*GUIMenuItemListAppend(&browser->d.items) = (struct GUIMenuItem) { .title = "(Up)" };
+	browser->d.index = 0;
+	browser->dir = dir;
+	browser->listing = true;
+	browser->checked = 1;
+	browser->preselect = preselect;
+	browser->restoreIndex = 0;
+	return true;
+}
 
-			params->drawStart();
-			if (params->guiPrepare) {
-				params->guiPrepare();
-			}
-			GUIFontPrintf(params->font, 0, GUIFontHeight(params->font), GUI_ALIGN_LEFT, 0xFFFFFFFF, "(scanning for items: %"PRIz"u)", i);
-			GUIFontPrintf(params->font, 0, GUIFontHeight(params->font) * 2, GUI_ALIGN_LEFT, 0xFFFFFFFF, "%s", currentPath);
-			if (params->guiFinish) {
-				params->guiFinish();
+static void _insertFile(struct GUIFileBrowser* browser, char* name, unsigned type) {
+	struct GUIMenuItemList* items = &browser->d.items;
+	// Entries are kept sorted as they arrive, so the list can be shown before it's complete
+	size_t low = 1;
+	size_t high = GUIMenuItemListSize(items);
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		if (strcasecmp(GUIMenuItemListGetPointer(items, mid)->title, name) <= 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	struct GUIMenuItem* item;
+	if (low < GUIMenuItemListSize(items)) {
+		GUIMenuItemListUnshift(items, low, 1);
+		item = GUIMenuItemListGetPointer(items, low);
+	} else {
+		item = GUIMenuItemListAppend(items);
+	}
+	*item = (struct GUIMenuItem) { .title = name, .data = GUI_V_U(type) };
+	if (browser->preselect && strncmp(name, browser->preselect, PATH_MAX) == 0) {
+		browser->d.index = low;
+	} else if (browser->d.index >= low) {
+		++browser->d.index;
+	}
+}
+
+static void _removeFile(struct GUIFileBrowser* browser, size_t index) {
+	struct GUIMenuItemList* items = &browser->d.items;
+	free((char*) GUIMenuItemListGetPointer(items, index)->title);
+	GUIMenuItemListShift(items, index, 1);
+	if (browser->d.index > index || browser->d.index >= GUIMenuItemListSize(items)) {
+		--browser->d.index;
+	}
+}
+
+static bool _checkFile(struct GUIFileBrowser* browser, size_t index) {
+	const struct GUIMenuItem* item = GUIMenuItemListGetConstPointer(&browser->d.items, index);
+	if (!browser->filterContents || !GUIVariantCompareUInt(item->data, VFS_FILE)) {
+		return true;
+	}
+	struct VFile* vf = browser->dir->openFile(browser->dir, item->title, O_RDONLY);
+	if (!vf) {
+		return false;
+	}
+	bool passed = browser->filterContents(vf);
+	vf->close(vf);
+	return passed;
+}
+
+static void _listEntries(struct GUIFileBrowser* browser) {
+	int budget;
+	for (budget = LISTING_BUDGET; budget; --budget) {
+		struct VDirEntry* de = browser->dir->listNext(browser->dir);
+		if (!de) {
+			browser->listing = false;
+			if (!browser->d.index && browser->restoreIndex < GUIMenuItemListSize(&browser->d.items)) {
+				browser->d.index = browser->restoreIndex;
 			}
-			params->drawEnd();
+			return;
 		}
 		const char* name = de->name(de);
 		if (name[0] == '.') {
 			continue;
 		}
+		char* title;
 		if (de->type(de) == VFS_DIRECTORY) {
 			size_t len = strlen(name) + 2;
-			char* n2 = malloc(len);
-			snprintf(n2, len, "%s/", name);
-			name = n2;
-		} else if (filterName && !filterName(name)) {
+			title = malloc(len);
+			snprintf(title, len, "%s/", name);
+		} else if (browser->filterName && !browser->filterName(name)) {
 			continue;
 		} else {
-			name = strdup(name);
+			title = strdup(name);
 		}
-		*GUIMenuItemListAppend(currentFiles) = (struct GUIMenuItem) { .title = name, .data = GUI_V_U(de->type(de)) };
-		++items;
-	}
-	qsort(GUIMenuItemListGetPointer(currentFiles, 1), GUIMenuItemListSize(currentFiles) - 1, sizeof(struct GUIMenuItem), _strpcmp);
-	if (preselect || filterContents) {
-		i = 0;
-		size_t item = 0;
-		while (item < GUIMenuItemListSize(currentFiles)) {
-			++i;
-			// If we're not filtering the contents, this loop is fast, so there's no need to show updates
-			if (filterContents && !(i % SCANNING_THRESHOLD_2)) {
-				uint32_t input = 0;
-				GUIPollInput(params, &input, 0);
-				if (input & (1 << GUI_INPUT_CANCEL)) {
-					dir->close(dir);
-					return false;
-				}
-
-				params->drawStart();
-				if (params->guiPrepare) {
-					params->guiPrepare();
-				}
-				GUIFontPrintf(params->font, 0, GUIFontHeight(params->font), GUI_ALIGN_LEFT, 0xFFFFFFFF, "(scanning item %"PRIz"u of %"PRIz"u)", i, items);
-				GUIFontPrintf(params->font, 0, GUIFontHeight(params->font) * 2, GUI_ALIGN_LEFT, 0xFFFFFFFF, "%s", currentPath);
-				if (params->guiFinish) {
-					params->guiFinish();
-				}
-				params->drawEnd();
-			}
-			struct GUIMenuItem* testItem = GUIMenuItemListGetPointer(currentFiles, item);
-			if (!GUIVariantCompareUInt(testItem->data, VFS_FILE)) {
-				++item;
-				continue;
-			}
-			bool failed = false;
-			if (filterContents) {
-				struct VFile* vf = dir->openFile(dir, testItem->title, O_RDONLY);
-				if (!vf) {
-					failed = true;
-				} else {
-					if (!filterContents(vf)) {
-						failed = true;
-					}
-					vf->close(vf);
-				}
-			}
+		_insertFile(browser, title, de->type(de));
+	}
+}
 
-			if (failed) {
-				free((char*) testItem->title);
-				GUIMenuItemListShift(currentFiles, item, 1);
-			} else {
-				if (preselect && strncmp(testItem->title, preselect, PATH_MAX) == 0) {
-					params->fileIndex = item;
-				}
-				++item;
-			}
+static void _filterEntries(struct GUIFileBrowser* browser) {
+	int budget = FILTERING_BUDGET;
+	while (budget && browser->checked < GUIMenuItemListSize(&browser->d.items)) {
+		const struct GUIMenuItem* item = GUIMenuItemListGetConstPointer(&browser->d.items, browser->checked);
+		if (!GUIVariantCompareUInt(item->data, VFS_FILE)) {
+			++browser->checked;
+			continue;
+		}
+		--budget;
+		if (_checkFile(browser, browser->checked)) {
+			++browser->checked;
+		} else {
+			_removeFile(browser, browser->checked);
 		}
 	}
-	dir->close(dir);
+	if (browser->checked >= GUIMenuItemListSize(&browser->d.items)) {
+		_closeDirectory(browser);
+	}
+}
 
-	return true;
+static void _updateDirectory(struct GUIMenu* menu) {
+	struct GUIFileBrowser* browser = (struct GUIFileBrowser*) menu;
+	if (!browser->dir) {
+		return;
+	}
+	// Contents are only checked once the listing is done, since checking is what's slow
+	if (browser->listing) {
+		_listEntries(browser);
+	} else if (browser->filterContents) {
+		_filterEntries(browser);
+	} else {
+		_closeDirectory(browser);
+	}
 }
 
 bool GUISelectFile(struct GUIParams* params, char* outPath, size_t outLen, bool (*filterName)(const char* name), bool (*filterContents)(struct VFile*), const char* preselect) {
-	struct GUIMenu menu = {
-		.title = "Select file",
-		.subtitle = params->currentPath,
+	struct GUIFileBrowser browser = {
+		.d = {
+			.title = "Select file",
+			.subtitle = params->currentPath,
+			.update = _updateDirectory,
+		},
+		.filterName = filterName,
+		.filterContents = filterContents,
 	};
-	GUIMenuItemListInit(&menu.items, 0);
-	_refreshDirectory(params, params->currentPath, &menu.items, filterName, filterContents, preselect);
-	menu.index = params->fileIndex;
+	GUIMenuItemListInit(&browser.d.items, 0);
+	bool selected = false;
+	if (!_openDirectory(&browser, params->currentPath, preselect)) {
+		*GUIMenuItemListAppend(&browser.d.items) = (struct GUIMenuItem) { .title = "(Up)" };
+	}
+	if (!preselect) {
+		browser.restoreIndex = params->fileIndex;
+	}
 
 	while (true) {
 		struct GUIMenuItem* item;
-		enum GUIMenuExitReason reason = GUIShowMenu(params, &menu, &item);
-		params->fileIndex = menu.index;
+		enum GUIMenuExitReason reason = GUIShowMenu(params, &browser.d, &item);
+		params->fileIndex = browser.d.index;
 		if (reason == GUI_MENU_EXIT_CANCEL) {
 			break;
 		}
@@ -179,10 +229,15 @@ bool GUISelectFile(struct GUIParams* params, char* outPath, size_t outLen, bool
 					continue;
 				}
 				_upDirectory(params->currentPath);
-				if (!_refreshDirectory(params, params->currentPath, &menu.items, filterName, filterContents, NULL)) {
+				if (!_openDirectory(&browser, params->currentPath, NULL)) {
 					break;
 				}
 			} else {
+				if (browser.dir && params->fileIndex >= browser.checked && !_checkFile(&browser, params->fileIndex)) {
+					// It hasn't been scanned yet, and it turns out not to be usable
+					_removeFile(&browser, params->fileIndex);
+					continue;
+				}
 				size_t len = strlen(params->currentPath);
 				const char* sep = PATH_SEP;
 				if (!len || params->currentPath[len - 1] == *sep) {
@@ -190,38 +245,28 @@ bool GUISelectFile(struct GUIParams* params, char* outPath, size_t outLen, bool
 				}
 				snprintf(outPath, outLen, "%s%s%s", params->currentPath, sep, item->title);
 
-				struct GUIMenuItemList newFiles;
-				GUIMenuItemListInit(&newFiles, 0);
-				if (!_refreshDirectory(params, outPath, &newFiles, filterName, filterContents, NULL)) {
-					_cleanFiles(&newFiles);
-					GUIMenuItemListDeinit(&newFiles);
-					_cleanFiles(&menu.items);
-					GUIMenuItemListDeinit(&menu.items);
-					return true;
-				} else {
-					_cleanFiles(&menu.items);
-					GUIMenuItemListDeinit(&menu.items);
-					menu.items = newFiles;
-					strlcpy(params->currentPath, outPath, PATH_MAX);
+				if (!_openDirectory(&browser, outPath, NULL)) {
+					selected = true;
+					break;
 				}
+				strlcpy(params->currentPath, outPath, PATH_MAX);
 			}
 			params->fileIndex = 0;
-			menu.index = 0;
 		}
 		if (reason == GUI_MENU_EXIT_BACK) {
 			if (strncmp(params->currentPath, params->basePath, PATH_MAX) == 0) {
 				break;
 			}
 			_upDirectory(params->currentPath);
-			if (!_refreshDirectory(params, params->currentPath, &menu.items, filterName, filterContents, NULL)) {
+			if (!_openDirectory(&browser, params->currentPath, NULL)) {
 				break;
 			}
 			params->fileIndex = 0;
-			menu.index = 0;
 		}
 	}
 
-	_cleanFiles(&menu.items);
-	GUIMenuItemListDeinit(&menu.items);
-	return false;
+	_closeDirectory(&browser);
+	_cleanFiles(&browser.d.items);
+	GUIMenuItemListDeinit(&browser.d.items);
+	return selected;
 }
@@ -5,8 +5,29 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba-util/gui/font.h>
 
+#include <mgba-util/hash.h>
 #include <mgba-util/string.h>
 
+#define RUN_CACHE_SIZE 64
+
+struct GUIFontRunGlyph {
+	uint32_t glyph;
+	int x;
+	bool icon;
+};
+
+// A string laid out once, so that drawing it again doesn't need to decode it or look up any widths
+struct GUIFontRun {
+	const struct GUIFont* font;
+	uint32_t hash;
+	char* text;
+	unsigned width;
+	size_t nGlyphs;
+	struct GUIFontRunGlyph* glyphs;
+};
+
+static struct GUIFontRun _runCache[RUN_CACHE_SIZE];
+
 unsigned GUIFontSpanWidth(const struct GUIFont* font, const char* text) {
 	size_t len = strlen(text);
 	return GUIFontSpanCountWidth(font, text, len);
@@ -30,27 +51,27 @@ unsigned GUIFontSpanCountWidth(const struct GUIFont* font, const char* text, siz
 	return width;
 }
 
-void GUIFontPrint(struct GUIFont* font, int x, int y, enum GUIAlignment align, uint32_t color, const char* text) {
-	switch (align & GUI_ALIGN_HCENTER) {
-	case GUI_ALIGN_HCENTER:
-		x -= GUIFontSpanWidth(font, text) / 2;
-		break;
-	case GUI_ALIGN_RIGHT:
-		x -= GUIFontSpanWidth(font, text);
-		break;
-	default:
-		break;
-	}
-	size_t len = strlen(text);
+static void _freeRun(struct GUIFontRun* run) {
+	free(run->text);
+	free(run->glyphs);
+	memset(run, 0, sizeof(*run));
+}
+
+static void _layoutRun(struct GUIFontRun* run, const struct GUIFont* font, const char* text, size_t len) {
+	// A run never has more glyphs than the string has bytes
+	run->glyphs = malloc(sizeof(*run->glyphs) * (len ? len : 1));
+	run->nGlyphs = 0;
+	int x = 0;
 	while (len) {
 		uint32_t c = utf8Char(&text, &len);
 		bool icon = false;
 		switch (c) {
 		case 1:
 			c = utf8Char(&text, &len);
-			if (c < GUI_ICON_MAX) {
-				icon = true;
+			if (c >= GUI_ICON_MAX) {
+				continue;
 			}
+			icon = true;
 			break;
 		case 0x2190:
 		case 0x2191:
@@ -80,16 +101,66 @@ void GUIFontPrint(struct GUIFont* font, int x, int y, enum GUIAlignment align, u
 			icon = true;
 			break;
 		default:
-			GUIFontDrawGlyph(font, x, y, color, c);
-			x += GUIFontGlyphWidth(font, c);
 			break;
 		}
 
+		struct GUIFontRunGlyph* glyph = &run->glyphs[run->nGlyphs];
+		++run->nGlyphs;
+		glyph->glyph = c;
+		glyph->x = x;
+		glyph->icon = icon;
 		if (icon) {
-			GUIFontDrawIcon(font, x, y, GUI_ALIGN_BOTTOM, GUI_ORIENT_0, color, c);
 			unsigned w;
 			GUIFontIconMetrics(font, c, &w, 0);
 			x += w;
+		} else {
+			x += GUIFontGlyphWidth(font, c);
+		}
+	}
+	run->width = x;
+}
+
+static const struct GUIFontRun* _lookupRun(const struct GUIFont* font, const char* text) {
+	size_t len = strlen(text);
+	uint32_t hash = hash32(text, len, 0);
+	struct GUIFontRun* run = &_runCache[hash % RUN_CACHE_SIZE];
+	if (run->text && run->font == font && run->hash == hash && strcmp(run->text, text) == 0) {
+		return run;
+	}
+	_freeRun(run);
+	run->font = font;
+	run->hash = hash;
+	run->text = strdup(text);
+	_layoutRun(run, font, text, len);
+	return run;
+}
+
+void GUIFontClearRunCache(void) {
+	size_t i;
+	for (i = 0; i < RUN_CACHE_SIZE; ++i) {
+		_freeRun(&_runCache[i]);
+	}
+}
+
+void GUIFontPrint(struct GUIFont* font, int x, int y, enum GUIAlignment align, uint32_t color, const char* text) {
+	const struct GUIFontRun* run = _lookupRun(font, text);
+	switch (align & GUI_ALIGN_HCENTER) {
+	case GUI_ALIGN_HCENTER:
+		x -= run->width / 2;
+		break;
+	case GUI_ALIGN_RIGHT:
+		x -= run->width;
+		break;
+	default:
+		break;
+	}
+	size_t i;
+	for (i = 0; i < run->nGlyphs; ++i) {
+		const struct GUIFontRunGlyph* glyph = &run->glyphs[i];
+		if (glyph->icon) {
+			GUIFontDrawIcon(font, x + glyph->x, y, GUI_ALIGN_BOTTOM, GUI_ORIENT_0, color, glyph->glyph);
+		} else {
+			GUIFontDrawGlyph(font, x + glyph->x, y, color, glyph->glyph);
 		}
 	}
 }
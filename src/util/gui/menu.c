@@ -274,6 +274,9 @@ static void GUIMenuDraw(struct GUIParams* params, const struct GUIMenu* menu, co
 }
 
 enum GUIMenuExitReason GUIMenuRun(struct GUIParams* params, struct GUIMenu* menu, struct GUIMenuState* state) {
+	if (menu->update) {
+		menu->update(menu);
+	}
 	enum GUIMenuExitReason reason = GUIMenuPollInput(params, menu, state);
 	if (reason != GUI_MENU_CONTINUE) {
 		return reason;
@@ -106,3 +106,88 @@ uint32_t hash32(const void* key, size_t len, uint32_t seed) {
 
 	return h1;
 } 
+
+// The 64-bit hash follows XXH64 by Yann Collet, which is under the BSD 2-clause license.
+// Only the algorithm is used here; the code below is independent of the reference implementation.
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static FORCE_INLINE uint64_t rotl64(uint64_t x, int r) {
+	return (x << r) | (x >> (64 - r));
+}
+
+static FORCE_INLINE uint64_t round64(uint64_t acc, uint64_t input) {
+	acc += input * PRIME64_2;
+	acc = rotl64(acc, 31);
+	return acc * PRIME64_1;
+}
+
+static FORCE_INLINE uint64_t merge64(uint64_t h, uint64_t acc) {
+	h ^= round64(0, acc);
+	return h * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t hash64(const void* key, size_t len, uint64_t seed) {
+	const uint8_t* data = key;
+	const uint8_t* end = data + len;
+	uint64_t h;
+	uint64_t k;
+	uint32_t k32;
+
+	if (len >= 32) {
+		// Four independent lanes keep several multiplies in flight at once
+		uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+		uint64_t v2 = seed + PRIME64_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - PRIME64_1;
+		const uint8_t* limit = end - 32;
+		do {
+			LOAD_64LE(k, 0, data);
+			v1 = round64(v1, k);
+			LOAD_64LE(k, 8, data);
+			v2 = round64(v2, k);
+			LOAD_64LE(k, 16, data);
+			v3 = round64(v3, k);
+			LOAD_64LE(k, 24, data);
+			v4 = round64(v4, k);
+			data += 32;
+		} while (data <= limit);
+
+		h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+		h = merge64(h, v1);
+		h = merge64(h, v2);
+		h = merge64(h, v3);
+		h = merge64(h, v4);
+	} else {
+		h = seed + PRIME64_5;
+	}
+
+	h += len;
+
+	for (; data + 8 <= end; data += 8) {
+		LOAD_64LE(k, 0, data);
+		h ^= round64(0, k);
+		h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+	}
+	if (data + 4 <= end) {
+		LOAD_32LE(k32, 0, data);
+		h ^= k32 * PRIME64_1;
+		h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+		data += 4;
+	}
+	for (; data < end; ++data) {
+		h ^= *data * PRIME64_5;
+		h = rotl64(h, 11) * PRIME64_1;
+	}
+
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
@@ -42,6 +42,124 @@
 	memcpy((void*) (DST), &_color, (DEPTH)); \
 } while (0);
 
+#define CONVERT_ROW(NAME, SRC_T, DST_T, EXPR) \
+	static void NAME(void* dst, const void* src, size_t count) { \
+		DST_T* out = dst; \
+		const SRC_T* in = src; \
+		size_t i; \
+		for (i = 0; i < count; ++i) { \
+			uint32_t c = in[i]; \
+			out[i] = (EXPR); \
+		} \
+	}
+
+#define EXPAND5(C, SHIFT) (((((C) >> (SHIFT)) & 0x1F) * 0x21) >> 2)
+#define EXPAND6(C, SHIFT) (((((C) >> (SHIFT)) & 0x3F) * 0x41) >> 4)
+
+// These are written as straight-line loops with no per-pixel branches so the compiler can vectorize them
+CONVERT_ROW(_convertRowSetAlpha, uint32_t, uint32_t, c | 0xFF000000)
+CONVERT_ROW(_convertRowSwap8, uint32_t, uint32_t, (c & 0xFF00FF00) | ((c >> 16) & 0xFF) | ((c & 0xFF) << 16))
+CONVERT_ROW(_convertRowSwap8SetAlpha, uint32_t, uint32_t, 0xFF000000 | (c & 0x0000FF00) | ((c >> 16) & 0xFF) | ((c & 0xFF) << 16))
+CONVERT_ROW(_convertRowRGB565ToARGB8, uint16_t, uint32_t, 0xFF000000 | (EXPAND5(c, 11) << 16) | (EXPAND6(c, 5) << 8) | EXPAND5(c, 0))
+CONVERT_ROW(_convertRowRGB565ToABGR8, uint16_t, uint32_t, 0xFF000000 | (EXPAND5(c, 0) << 16) | (EXPAND6(c, 5) << 8) | EXPAND5(c, 11))
+CONVERT_ROW(_convertRowRGB5ToARGB8, uint16_t, uint32_t, 0xFF000000 | (EXPAND5(c, 10) << 16) | (EXPAND5(c, 5) << 8) | EXPAND5(c, 0))
+CONVERT_ROW(_convertRowRGB5ToABGR8, uint16_t, uint32_t, 0xFF000000 | (EXPAND5(c, 0) << 16) | (EXPAND5(c, 5) << 8) | EXPAND5(c, 10))
+CONVERT_ROW(_convertRowARGB8ToRGB565, uint32_t, uint16_t, ((c >> 8) & 0xF800) | ((c >> 5) & 0x07E0) | ((c >> 3) & 0x001F))
+CONVERT_ROW(_convertRowARGB8ToBGR565, uint32_t, uint16_t, ((c & 0xF8) << 8) | ((c >> 5) & 0x07E0) | ((c >> 19) & 0x001F))
+CONVERT_ROW(_convertRowARGB8ToRGB5, uint32_t, uint16_t, ((c >> 9) & 0x7C00) | ((c >> 6) & 0x03E0) | ((c >> 3) & 0x001F))
+CONVERT_ROW(_convertRowARGB8ToBGR5, uint32_t, uint16_t, ((c & 0xF8) << 7) | ((c >> 6) & 0x03E0) | ((c >> 19) & 0x001F))
+
+#undef EXPAND5
+#undef EXPAND6
+#undef CONVERT_ROW
+
+typedef void (*_convertRowFunction)(void* dst, const void* src, size_t count);
+
+static const struct {
+	enum mColorFormat from;
+	enum mColorFormat to;
+	_convertRowFunction convert;
+} _rowConverters[] = {
+	{ mCOLOR_ARGB8, mCOLOR_XRGB8, _convertRowSetAlpha },
+	{ mCOLOR_XRGB8, mCOLOR_ARGB8, _convertRowSetAlpha },
+	{ mCOLOR_ABGR8, mCOLOR_XBGR8, _convertRowSetAlpha },
+	{ mCOLOR_XBGR8, mCOLOR_ABGR8, _convertRowSetAlpha },
+	{ mCOLOR_ARGB8, mCOLOR_ABGR8, _convertRowSwap8 },
+	{ mCOLOR_ABGR8, mCOLOR_ARGB8, _convertRowSwap8 },
+	{ mCOLOR_ARGB8, mCOLOR_XBGR8, _convertRowSwap8SetAlpha },
+	{ mCOLOR_XRGB8, mCOLOR_ABGR8, _convertRowSwap8SetAlpha },
+	{ mCOLOR_XRGB8, mCOLOR_XBGR8, _convertRowSwap8SetAlpha },
+	{ mCOLOR_ABGR8, mCOLOR_XRGB8, _convertRowSwap8SetAlpha },
+	{ mCOLOR_XBGR8, mCOLOR_ARGB8, _convertRowSwap8SetAlpha },
+	{ mCOLOR_XBGR8, mCOLOR_XRGB8, _convertRowSwap8SetAlpha },
+	{ mCOLOR_RGB565, mCOLOR_ARGB8, _convertRowRGB565ToARGB8 },
+	{ mCOLOR_RGB565, mCOLOR_XRGB8, _convertRowRGB565ToARGB8 },
+	{ mCOLOR_RGB565, mCOLOR_ABGR8, _convertRowRGB565ToABGR8 },
+	{ mCOLOR_RGB565, mCOLOR_XBGR8, _convertRowRGB565ToABGR8 },
+	{ mCOLOR_BGR565, mCOLOR_ARGB8, _convertRowRGB565ToABGR8 },
+	{ mCOLOR_BGR565, mCOLOR_XRGB8, _convertRowRGB565ToABGR8 },
+	{ mCOLOR_BGR565, mCOLOR_ABGR8, _convertRowRGB565ToARGB8 },
+	{ mCOLOR_BGR565, mCOLOR_XBGR8, _convertRowRGB565ToARGB8 },
+	{ mCOLOR_RGB5, mCOLOR_ARGB8, _convertRowRGB5ToARGB8 },
+	{ mCOLOR_RGB5, mCOLOR_XRGB8, _convertRowRGB5ToARGB8 },
+	{ mCOLOR_RGB5, mCOLOR_ABGR8, _convertRowRGB5ToABGR8 },
+	{ mCOLOR_RGB5, mCOLOR_XBGR8, _convertRowRGB5ToABGR8 },
+	{ mCOLOR_BGR5, mCOLOR_ARGB8, _convertRowRGB5ToABGR8 },
+	{ mCOLOR_BGR5, mCOLOR_XRGB8, _convertRowRGB5ToABGR8 },
+	{ mCOLOR_BGR5, mCOLOR_ABGR8, _convertRowRGB5ToARGB8 },
+	{ mCOLOR_BGR5, mCOLOR_XBGR8, _convertRowRGB5ToARGB8 },
+	{ mCOLOR_ARGB8, mCOLOR_RGB565, _convertRowARGB8ToRGB565 },
+	{ mCOLOR_XRGB8, mCOLOR_RGB565, _convertRowARGB8ToRGB565 },
+	{ mCOLOR_ABGR8, mCOLOR_BGR565, _convertRowARGB8ToRGB565 },
+	{ mCOLOR_XBGR8, mCOLOR_BGR565, _convertRowARGB8ToRGB565 },
+	{ mCOLOR_ARGB8, mCOLOR_BGR565, _convertRowARGB8ToBGR565 },
+	{ mCOLOR_XRGB8, mCOLOR_BGR565, _convertRowARGB8ToBGR565 },
+	{ mCOLOR_ABGR8, mCOLOR_RGB565, _convertRowARGB8ToBGR565 },
+	{ mCOLOR_XBGR8, mCOLOR_RGB565, _convertRowARGB8ToBGR565 },
+	{ mCOLOR_ARGB8, mCOLOR_RGB5, _convertRowARGB8ToRGB5 },
+	{ mCOLOR_XRGB8, mCOLOR_RGB5, _convertRowARGB8ToRGB5 },
+	{ mCOLOR_ABGR8, mCOLOR_BGR5, _convertRowARGB8ToRGB5 },
+	{ mCOLOR_XBGR8, mCOLOR_BGR5, _convertRowARGB8ToRGB5 },
+	{ mCOLOR_ARGB8, mCOLOR_BGR5, _convertRowARGB8ToBGR5 },
+	{ mCOLOR_XRGB8, mCOLOR_BGR5, _convertRowARGB8ToBGR5 },
+	{ mCOLOR_ABGR8, mCOLOR_RGB5, _convertRowARGB8ToBGR5 },
+	{ mCOLOR_XBGR8, mCOLOR_RGB5, _convertRowARGB8ToBGR5 },
+};
+
+static _convertRowFunction _findRowConverter(enum mColorFormat from, enum mColorFormat to) {
+	size_t i;
+	for (i = 0; i < sizeof(_rowConverters) / sizeof(*_rowConverters); ++i) {
+		if (_rowConverters[i].from == from && _rowConverters[i].to == to) {
+			return _rowConverters[i].convert;
+		}
+	}
+	return NULL;
+}
+
+void mColorConvertRow(void* dst, enum mColorFormat to, const void* src, enum mColorFormat from, size_t count) {
+	if (from == to) {
+		memmove(dst, src, count * mColorFormatBytes(from));
+		return;
+	}
+	_convertRowFunction convert = _findRowConverter(from, to);
+	if (convert) {
+		convert(dst, src, count);
+		return;
+	}
+
+	unsigned srcDepth = mColorFormatBytes(from);
+	unsigned dstDepth = mColorFormatBytes(to);
+	uintptr_t srcPixel = (uintptr_t) src;
+	uintptr_t dstPixel = (uintptr_t) dst;
+	size_t x;
+	for (x = 0; x < count; ++x, srcPixel += srcDepth, dstPixel += dstDepth) {
+		uint32_t color;
+		GET_PIXEL(color, srcPixel, srcDepth);
+		color = mColorConvert(color, from, to);
+		PUT_PIXEL(color, dstPixel, dstDepth);
+	}
+}
+
 struct mImage* mImageCreate(unsigned width, unsigned height, enum mColorFormat format) {
 	return mImageCreateWithStride(width, height, width, format);
 }
@@ -229,9 +347,12 @@ struct mImage* mImageConvertToFormat(const struct mImage* image, enum mColorForm
 	newImage->stride = image->width;
 	newImage->data = malloc(image->width * image->height * newImage->depth);
 
-	// TODO: Implement more specializations, e.g. alpha narrowing/widening, channel swapping
 	size_t x, y;
 	for (y = 0; y < newImage->height; ++y) {
+		if (image->format != mCOLOR_PAL8) {
+			mColorConvertRow(ROW(newImage, y), format, ROW(image, y), image->format, newImage->width);
+			continue;
+		}
 		uintptr_t src = (uintptr_t) ROW(image, y);
 		uintptr_t dst = (uintptr_t) ROW(newImage, y);
 		for (x = 0; x < newImage->width; ++x, src += image->depth, dst += newImage->depth) {
@@ -346,6 +467,7 @@ void mImageSetPixelRaw(struct mImage* image, unsigned x, unsigned y, uint32_t co
 	if (x >= image->width || y >= image->height) {
 		return;
 	}
+	mImageMarkDirty(image, x, y, 1, 1);
 	void* pixel = PIXEL(image, x, y);
 	switch (image->depth) {
 	case 1:
@@ -375,6 +497,33 @@ void mImageSetPixel(struct mImage* image, unsigned x, unsigned y, uint32_t color
 	mImageSetPixelRaw(image, x, y, mColorConvert(color, mCOLOR_ARGB8, image->format));
 }
 
+void mImageMarkDirty(struct mImage* image, int x, int y, int width, int height) {
+	struct mRectangle rect = {
+		.x = x,
+		.y = y,
+		.width = width,
+		.height = height
+	};
+	struct mRectangle bounds = {
+		.x = 0,
+		.y = 0,
+		.width = image->width,
+		.height = image->height
+	};
+	if (!mRectangleIntersection(&rect, &bounds)) {
+		return;
+	}
+	if (image->dirty.width <= 0 || image->dirty.height <= 0) {
+		image->dirty = rect;
+	} else {
+		mRectangleUnion(&image->dirty, &rect);
+	}
+}
+
+void mImageClearDirty(struct mImage* image) {
+	memset(&image->dirty, 0, sizeof(image->dirty));
+}
+
 void mImageSetPaletteSize(struct mImage* image, unsigned count) {
 	if (image->format != mCOLOR_PAL8) {
 		return;
@@ -437,8 +586,13 @@ void mImageBlit(struct mImage* image, const struct mImage* source, int x, int y)
 	}
 
 	COMPOSITE_BOUNDS_INIT;
+	mImageMarkDirty(image, srcRect.x, srcRect.y, srcRect.width, srcRect.height);
 
 	for (y = 0; y < srcRect.height; ++y) {
+		if (source->format != mCOLOR_PAL8) {
+			mColorConvertRow(PIXEL(image, dstStartX, dstStartY + y), image->format, PIXEL(source, srcStartX, srcStartY + y), source->format, srcRect.width);
+			continue;
+		}
 		uintptr_t srcPixel = (uintptr_t) PIXEL(source, srcStartX, srcStartY + y);
 		uintptr_t dstPixel = (uintptr_t) PIXEL(image, dstStartX, dstStartY + y);
 		for (x = 0; x < srcRect.width; ++x, srcPixel += source->depth, dstPixel += image->depth) {
@@ -462,6 +616,7 @@ void mImageComposite(struct mImage* image, const struct mImage* source, int x, i
 	}
 
 	COMPOSITE_BOUNDS_INIT;
+	mImageMarkDirty(image, srcRect.x, srcRect.y, srcRect.width, srcRect.height);
 
 	for (y = 0; y < srcRect.height; ++y) {
 		uintptr_t srcPixel = (uintptr_t) PIXEL(source, srcStartX, srcStartY + y);
@@ -499,6 +654,7 @@ void mImageCompositeWithAlpha(struct mImage* image, const struct mImage* source,
 	}
 
 	COMPOSITE_BOUNDS_INIT;
+	mImageMarkDirty(image, srcRect.x, srcRect.y, srcRect.width, srcRect.height);
 
 	int fixedAlpha = alpha * 0x200;
 
@@ -570,6 +726,7 @@ static void mPainterDrawPixel(struct mPainter* painter, unsigned x, unsigned y,
 
 static void mPainterFillRectangle(struct mPainter* painter, int x, int y, int width, int height) {
 	FILL_BOUNDS_INIT(x, y, width, height);
+	mImageMarkDirty(painter->backing, srcRect.x, srcRect.y, srcRect.width, srcRect.height);
 
 	if (!painter->blend || painter->fillColor >= 0xFF000000) {
 		uint32_t color = mColorConvert(painter->fillColor, mCOLOR_ARGB8, painter->backing->format);
@@ -1024,3 +1181,18 @@ uint32_t mImageColorConvert(uint32_t color, const struct mImage* from, enum mCol
 	}
 	return mColorConvert(color, mCOLOR_ARGB8, to);
 }
+
+bool mColorTableFrom555(color_t* table, enum mColorFormat format) {
+	if (format != mCOLOR_NATIVE && format != mCOLOR_NATIVE_SWAPPED) {
+		return false;
+	}
+	unsigned i;
+	for (i = 0; i < M_COLOR_TABLE_555_SIZE; ++i) {
+		color_t color = mColorFrom555(i);
+		if (format != mCOLOR_NATIVE) {
+			color = mColorSwapRedBlue(color);
+		}
+		table[i] = color;
+	}
+	return true;
+}
@@ -0,0 +1,195 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba-util/image/post-process.h>
+
+#include <math.h>
+
+#define COLOR_TABLE_SIZE 0x8000
+
+const struct mColorCorrection mCOLOR_CORRECTION_GBA = {
+	.matrix = {
+		1.f,    0.196f, 0.f,
+		0.039f, 0.902f, 0.118f,
+		0.196f, 0.039f, 0.863f,
+	},
+	.inputGamma = 4.f,
+	.outputGamma = 2.2f,
+	.brightness = 0.91f,
+};
+
+const struct mColorCorrection mCOLOR_CORRECTION_GBC = {
+	.matrix = {
+		0.8125f, 0.125f, 0.0625f,
+		0.f,     0.75f,  0.25f,
+		0.1875f, 0.125f, 0.6875f,
+	},
+	.inputGamma = 1.f,
+	.outputGamma = 1.f,
+	.brightness = 1.f,
+};
+
+void mPostProcessInit(struct mPostProcess* post) {
+	memset(post, 0, sizeof(*post));
+}
+
+void mPostProcessDeinit(struct mPostProcess* post) {
+	free(post->colorTable);
+	free(post->lastFrame);
+	post->colorTable = NULL;
+	post->lastFrame = NULL;
+}
+
+void mPostProcessSetDimensions(struct mPostProcess* post, unsigned width, unsigned height) {
+	if (post->width == width && post->height == height) {
+		return;
+	}
+	post->width = width;
+	post->height = height;
+	free(post->lastFrame);
+	post->lastFrame = NULL;
+	post->hasLastFrame = false;
+	if (post->interframeBlending) {
+		post->lastFrame = calloc(width * height, sizeof(color_t));
+	}
+}
+
+void mPostProcessSetInterframeBlending(struct mPostProcess* post, bool enable) {
+	post->interframeBlending = enable;
+	post->hasLastFrame = false;
+	if (!enable) {
+		free(post->lastFrame);
+		post->lastFrame = NULL;
+	} else if (!post->lastFrame && post->width && post->height) {
+		post->lastFrame = calloc(post->width * post->height, sizeof(color_t));
+	}
+}
+
+static unsigned _quantize(float value, unsigned max) {
+	if (value <= 0.f) {
+		return 0;
+	}
+	if (value >= 1.f) {
+		return max;
+	}
+	return value * max + 0.5f;
+}
+
+void mPostProcessSetColorCorrection(struct mPostProcess* post, const struct mColorCorrection* correction) {
+	if (!correction) {
+		free(post->colorTable);
+		post->colorTable = NULL;
+		return;
+	}
+	if (!post->colorTable) {
+		post->colorTable = malloc(COLOR_TABLE_SIZE * sizeof(color_t));
+	}
+
+	// Working out the curve for every 15-bit color up front leaves a single lookup per pixel
+	float linear[32];
+	int i;
+	for (i = 0; i < 32; ++i) {
+		linear[i] = powf(i / 31.f, correction->inputGamma);
+	}
+	const float* m = correction->matrix;
+	float outputExponent = 1.f / correction->outputGamma;
+	for (i = 0; i < COLOR_TABLE_SIZE; ++i) {
+		float r = linear[i & 0x1F];
+		float g = linear[(i >> 5) & 0x1F];
+		float b = linear[(i >> 10) & 0x1F];
+		float outR = powf(fmaxf(m[0] * r + m[1] * g + m[2] * b, 0.f), outputExponent) * correction->brightness;
+		float outG = powf(fmaxf(m[3] * r + m[4] * g + m[5] * b, 0.f), outputExponent) * correction->brightness;
+		float outB = powf(fmaxf(m[6] * r + m[7] * g + m[8] * b, 0.f), outputExponent) * correction->brightness;
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+		post->colorTable[i] = (_quantize(outR, 0x1F) << 11) | (_quantize(outG, 0x3F) << 5) | _quantize(outB, 0x1F);
+#else
+		post->colorTable[i] = _quantize(outR, 0x1F) | (_quantize(outG, 0x1F) << 5) | (_quantize(outB, 0x1F) << 10);
+#endif
+#else
+		post->colorTable[i] = _quantize(outR, 0xFF) | (_quantize(outG, 0xFF) << 8) | (_quantize(outB, 0xFF) << 16);
+#endif
+	}
+}
+
+bool mPostProcessIsActive(const struct mPostProcess* post) {
+	return post->colorTable || post->interframeBlending;
+}
+
+static inline color_t _average(color_t a, color_t b) {
+	// Averaging every channel at once this way has no carries between them, and it is simple
+	// enough for the compiler to turn the loop below into vector code
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+	return (a & b) + (((a ^ b) & 0xF7DE) >> 1);
+#else
+	return (a & b) + (((a ^ b) & 0x7BDE) >> 1);
+#endif
+#else
+	return (a & b) + (((a ^ b) & 0xFEFEFEFE) >> 1);
+#endif
+}
+
+static inline unsigned _tableIndex(color_t color) {
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+	return (color >> 11) | ((color >> 1) & 0x03E0) | ((color & 0x1F) << 10);
+#else
+	return color & 0x7FFF;
+#endif
+#else
+	return ((color >> 3) & 0x001F) | ((color >> 6) & 0x03E0) | ((color >> 9) & 0x7C00);
+#endif
+}
+
+static void _blendRow(color_t* output, const color_t* source, color_t* last, unsigned width) {
+	unsigned x;
+	for (x = 0; x < width; ++x) {
+		color_t color = source[x];
+		output[x] = _average(color, last[x]);
+		last[x] = color;
+	}
+}
+
+static void _correctRow(color_t* output, const color_t* source, const color_t* table, unsigned width) {
+	unsigned x;
+	for (x = 0; x < width; ++x) {
+		color_t color = source[x];
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+		output[x] = table[_tableIndex(color)];
+#else
+		output[x] = table[_tableIndex(color)] | (color & 0x8000);
+#endif
+#else
+		output[x] = table[_tableIndex(color)] | (color & 0xFF000000);
+#endif
+	}
+}
+
+void mPostProcessRun(struct mPostProcess* post, color_t* output, size_t outputStride, const color_t* source, size_t sourceStride) {
+	bool blend = post->interframeBlending && post->lastFrame;
+	unsigned y;
+	for (y = 0; y < post->height; ++y) {
+		color_t* outputRow = &output[y * outputStride];
+		const color_t* sourceRow = &source[y * sourceStride];
+		color_t* lastRow = blend ? &post->lastFrame[y * post->width] : NULL;
+		if (blend && !post->hasLastFrame) {
+			// The first frame has nothing to blend with
+			memcpy(lastRow, sourceRow, post->width * sizeof(color_t));
+		} else if (blend) {
+			_blendRow(outputRow, sourceRow, lastRow, post->width);
+			sourceRow = outputRow;
+		}
+		if (post->colorTable) {
+			_correctRow(outputRow, sourceRow, post->colorTable, post->width);
+		} else if (sourceRow != outputRow) {
+			memcpy(outputRow, sourceRow, post->width * sizeof(color_t));
+		}
+	}
+	if (blend) {
+		post->hasLastFrame = true;
+	}
+}
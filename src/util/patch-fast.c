@@ -5,6 +5,8 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba-util/patch/fast.h>
 
+#define PATCH_FAST_SKIP_BLOCK 64
+
 DEFINE_VECTOR(PatchFastExtents, struct PatchFastExtent);
 
 size_t _fastOutputSize(struct Patch* patch, size_t inSize);
@@ -14,12 +16,31 @@ void initPatchFast(struct PatchFast* patch) {
 	PatchFastExtentsInit(&patch->extents, 32);
 	patch->d.outputSize = _fastOutputSize;
 	patch->d.applyPatch = _fastApplyPatch;
+	patch->d.inPlace = false;
 }
 
 void deinitPatchFast(struct PatchFast* patch) {
 	PatchFastExtentsDeinit(&patch->extents);
 }
 
+static size_t _skipUnchanged(const uint32_t* restrict iptr, const uint32_t* restrict optr, size_t size) {
+	// Unchanged data makes up most of a savestate, so scan it in blocks the compiler can vectorize
+	size_t off;
+	for (off = 0; off + PATCH_FAST_SKIP_BLOCK <= size; off += PATCH_FAST_SKIP_BLOCK) {
+		uint32_t diff = 0;
+		size_t i;
+		for (i = 0; i < PATCH_FAST_SKIP_BLOCK / 4; ++i) {
+			diff |= iptr[i] ^ optr[i];
+		}
+		if (diff) {
+			break;
+		}
+		iptr += PATCH_FAST_SKIP_BLOCK / 4;
+		optr += PATCH_FAST_SKIP_BLOCK / 4;
+	}
+	return off;
+}
+
 bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void* restrict out, size_t size) {
 	PatchFastExtentsClear(&patch->extents);
 	const uint32_t* iptr = in;
@@ -28,6 +49,15 @@ bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void*
 	struct PatchFastExtent* extent = NULL;
 	size_t off;
 	for (off = 0; off < (size & ~15); off += 16) {
+		if (!extent) {
+			size_t skip = _skipUnchanged(iptr, optr, (size & ~15) - off);
+			off += skip;
+			iptr += skip / 4;
+			optr += skip / 4;
+			if (off >= (size & ~15)) {
+				break;
+			}
+		}
 		uint32_t a = iptr[0] ^ optr[0];
 		uint32_t b = iptr[1] ^ optr[1];
 		uint32_t c = iptr[2] ^ optr[2];
@@ -58,8 +88,8 @@ bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void*
 		extent->length = extentOff * 4;
 		extent = NULL;
 	}
-	const uint32_t* iptr8 = iptr;
-	const uint32_t* optr8 = optr;
+	const uint8_t* iptr8 = (const uint8_t*) iptr;
+	const uint8_t* optr8 = (const uint8_t*) optr;
 	for (; off < size; ++off) {
 		uint8_t a = iptr8[0] ^ optr8[0];
 		++iptr8;
@@ -68,6 +98,7 @@ bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void*
 			if (!extent) {
 				extent = PatchFastExtentsAppend(&patch->extents);
 				extent->offset = off;
+				extentOff = 0;
 			}
 			((uint8_t*) extent->extent)[extentOff] = a;
 			++extentOff;
@@ -104,8 +135,8 @@ bool _fastApplyPatch(struct Patch* p, const void* in, size_t inSize, void* out,
 			return false;
 		}
 		memcpy(optr, iptr, extent->offset - lastWritten);
-		optr = (uint32_t*) out + extent->offset / 4;
-		iptr = (uint32_t*) in + extent->offset / 4;
+		optr = (uint32_t*) ((uint8_t*) out + extent->offset);
+		iptr = (const uint32_t*) ((const uint8_t*) in + extent->offset);
 		uint32_t* eptr = extent->extent;
 		size_t off;
 		for (off = 0; off < (extent->length & ~15); off += 16) {
@@ -117,13 +148,18 @@ bool _fastApplyPatch(struct Patch* p, const void* in, size_t inSize, void* out,
 			iptr += 4;
 			eptr += 4;
 		}
+		uint8_t* optr8 = (uint8_t*) optr;
+		const uint8_t* iptr8 = (const uint8_t*) iptr;
+		const uint8_t* eptr8 = (const uint8_t*) eptr;
 		for (; off < extent->length; ++off) {
-			*(uint8_t*) optr = *(uint8_t*) iptr ^ *(uint8_t*) eptr;
-			++optr;
-			++iptr;
-			++eptr;
+			*optr8 = *iptr8 ^ *eptr8;
+			++optr8;
+			++iptr8;
+			++eptr8;
 		}
 		lastWritten = extent->offset + off;
+		optr = (uint32_t*) optr8;
+		iptr = (const uint32_t*) iptr8;
 	}
 	memcpy(optr, iptr, outSize - lastWritten);
 	return true;
@@ -34,6 +34,7 @@ bool loadPatchIPS(struct Patch* patch) {
 
 	patch->outputSize = _IPSOutputSize;
 	patch->applyPatch = _IPSApplyPatch;
+	patch->inPlace = true;
 	return true;
 }
 
@@ -44,50 +45,52 @@ size_t _IPSOutputSize(struct Patch* patch, size_t inSize) {
 }
 
 bool _IPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize) {
-	if (patch->vf->seek(patch->vf, 5, SEEK_SET) != 5) {
+	// Records are tiny, so parse them straight out of a mapping instead of reading each one
+	size_t patchSize = patch->vf->size(patch->vf);
+	const uint8_t* data = patch->vf->map(patch->vf, patchSize, MAP_READ);
+	if (!data) {
 		return false;
 	}
-	memcpy(out, in, inSize > outSize ? outSize : inSize);
+	if (out != in) {
+		memcpy(out, in, inSize > outSize ? outSize : inSize);
+	}
 	uint8_t* buf = out;
 
-	while (true) {
-		uint32_t offset = 0;
-		uint16_t size = 0;
-
-		if (patch->vf->read(patch->vf, &offset, 3) != 3) {
-			return false;
-		}
-
-		if (offset == 0x464F45) {
-			return true;
+	bool success = false;
+	size_t cursor = 5;
+	while (cursor + 3 <= patchSize) {
+		uint32_t offset = (data[cursor] << 16) | (data[cursor + 1] << 8) | data[cursor + 2];
+		cursor += 3;
+		if (offset == 0x454F46) {
+			success = true;
+			break;
 		}
 
-		offset = (offset >> 16) | (offset & 0xFF00) | ((offset << 16) & 0xFF0000);
-		if (patch->vf->read(patch->vf, &size, 2) != 2) {
-			return false;
+		if (cursor + 2 > patchSize) {
+			break;
 		}
+		size_t size = (data[cursor] << 8) | data[cursor + 1];
+		cursor += 2;
 		if (!size) {
 			// RLE chunk
-			if (patch->vf->read(patch->vf, &size, 2) != 2) {
-				return false;
-			}
-			size = (size >> 8) | (size << 8);
-			uint8_t byte;
-			if (patch->vf->read(patch->vf, &byte, 1) != 1) {
-				return false;
+			if (cursor + 3 > patchSize) {
+				break;
 			}
+			size = (data[cursor] << 8) | data[cursor + 1];
+			uint8_t byte = data[cursor + 2];
+			cursor += 3;
 			if (offset + size > outSize) {
-				return false;
+				break;
 			}
 			memset(&buf[offset], byte, size);
 		} else {
-			size = (size >> 8) | (size << 8);
-			if (offset + size > outSize) {
-				return false;
-			}
-			if (patch->vf->read(patch->vf, &buf[offset], size) != size) {
-				return false;
+			if (offset + size > outSize || cursor + size > patchSize) {
+				break;
 			}
+			memcpy(&buf[offset], &data[cursor], size);
+			cursor += size;
 		}
 	}
+	patch->vf->unmap(patch->vf, (void*) data, patchSize);
+	return success;
 }
@@ -5,7 +5,6 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba-util/patch/ips.h>
 
-#include <mgba-util/circle-buffer.h>
 #include <mgba-util/crc32.h>
 #include <mgba-util/patch.h>
 #include <mgba-util/vfs.h>
@@ -13,9 +12,7 @@
 enum {
 	IN_CHECKSUM = -12,
 	OUT_CHECKSUM = -8,
-	PATCH_CHECKSUM = -4,
-
-	BUFFER_SIZE = 128
+	PATCH_CHECKSUM = -4
 };
 
 static size_t _UPSOutputSize(struct Patch* patch, size_t inSize);
@@ -23,7 +20,8 @@ static size_t _UPSOutputSize(struct Patch* patch, size_t inSize);
 static bool _UPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize);
 static bool _BPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize);
 
-static size_t _decodeLength(struct VFile* vf, struct CircleBuffer* buffer);
+static size_t _decodeLength(struct VFile* vf);
+static size_t _decodeBufferLength(const uint8_t* data, size_t size, size_t* cursor);
 
 bool loadPatchUPS(struct Patch* patch) {
 	patch->vf->seek(patch->vf, 0, SEEK_SET);
@@ -35,8 +33,10 @@ bool loadPatchUPS(struct Patch* patch) {
 
 	if (memcmp(buffer, "UPS1", 4) == 0) {
 		patch->applyPatch = _UPSApplyPatch;
+		patch->inPlace = true;
 	} else if (memcmp(buffer, "BPS1", 4) == 0) {
 		patch->applyPatch = _BPSApplyPatch;
+		patch->inPlace = false;
 	} else {
 		return false;
 	}
@@ -61,66 +61,62 @@ bool loadPatchUPS(struct Patch* patch) {
 size_t _UPSOutputSize(struct Patch* patch, size_t inSize) {
 	UNUSED(inSize);
 	patch->vf->seek(patch->vf, 4, SEEK_SET);
-	if (_decodeLength(patch->vf, NULL) != inSize) {
+	if (_decodeLength(patch->vf) != inSize) {
 		return 0;
 	}
-	return _decodeLength(patch->vf, NULL);
+	return _decodeLength(patch->vf);
 }
 
 bool _UPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize) {
 	// TODO: Input checksum
 
 	size_t filesize = patch->vf->size(patch->vf);
-	patch->vf->seek(patch->vf, 4, SEEK_SET);
-	_decodeLength(patch->vf, NULL); // Discard input size
-	if (_decodeLength(patch->vf, NULL) != outSize) {
+	const uint8_t* data = patch->vf->map(patch->vf, filesize, MAP_READ);
+	if (!data) {
+		return false;
+	}
+	size_t end = filesize + IN_CHECKSUM;
+	size_t cursor = 4;
+	_decodeBufferLength(data, end, &cursor); // Discard input size
+	if (_decodeBufferLength(data, end, &cursor) != outSize) {
+		patch->vf->unmap(patch->vf, (void*) data, filesize);
 		return false;
 	}
 
-	struct CircleBuffer buffer;
-	memcpy(out, in, inSize > outSize ? outSize : inSize);
+	if (out != in) {
+		memcpy(out, in, inSize > outSize ? outSize : inSize);
+	}
 
+	bool success = true;
 	size_t offset = 0;
-	size_t alreadyRead = 0;
 	uint8_t* buf = out;
-	CircleBufferInit(&buffer, BUFFER_SIZE);
-	while (alreadyRead < filesize + IN_CHECKSUM) {
-		offset += _decodeLength(patch->vf, &buffer);
-		int8_t byte;
-
-		while (true) {
-			if (!CircleBufferSize(&buffer)) {
-				uint8_t block[BUFFER_SIZE];
-				ssize_t read = patch->vf->read(patch->vf, block, sizeof(block));
-				if (read < 1) {
-					CircleBufferDeinit(&buffer);
-					return false;
-				}
-				CircleBufferWrite(&buffer, block, read);
-			}
-			CircleBufferRead8(&buffer, &byte);
-			if (!byte) {
-				break;
-			}
-			if (offset >= outSize) {
-				CircleBufferDeinit(&buffer);
-				return false;
-			}
-			buf[offset] ^= byte;
-			++offset;
+	while (cursor < end) {
+		offset += _decodeBufferLength(data, end, &cursor);
+		const uint8_t* hunk = &data[cursor];
+		const uint8_t* terminator = memchr(hunk, 0, end - cursor);
+		if (!terminator) {
+			success = false;
+			break;
+		}
+		size_t length = terminator - hunk;
+		if (offset > outSize || length > outSize - offset) {
+			success = false;
+			break;
+		}
+		size_t i;
+		for (i = 0; i < length; ++i) {
+			buf[offset + i] ^= hunk[i];
 		}
-		++offset;
-		alreadyRead = patch->vf->seek(patch->vf, 0, SEEK_CUR) - CircleBufferSize(&buffer);
+		offset += length + 1;
+		cursor += length + 1;
 	}
-	CircleBufferDeinit(&buffer);
 
 	uint32_t goodCrc32;
-	patch->vf->seek(patch->vf, OUT_CHECKSUM, SEEK_END);
-	if (patch->vf->read(patch->vf, &goodCrc32, 4) != 4) {
+	LOAD_32LE(goodCrc32, filesize + OUT_CHECKSUM, data);
+	patch->vf->unmap(patch->vf, (void*) data, filesize);
+	if (!success) {
 		return false;
 	}
-
-	patch->vf->seek(patch->vf, 0, SEEK_SET);
 	if (doCrc32(out, outSize) != goodCrc32) {
 		return false;
 	}
@@ -128,68 +124,75 @@ bool _UPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* ou
 }
 
 bool _BPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* out, size_t outSize) {
-	patch->vf->seek(patch->vf, IN_CHECKSUM, SEEK_END);
+	size_t filesize = patch->vf->size(patch->vf);
+	if (inSize > SSIZE_MAX || outSize > SSIZE_MAX) {
+		return false;
+	}
+	const uint8_t* data = patch->vf->map(patch->vf, filesize, MAP_READ);
+	if (!data) {
+		return false;
+	}
 	uint32_t expectedInChecksum;
 	uint32_t expectedOutChecksum;
-	patch->vf->read(patch->vf, &expectedInChecksum, sizeof(expectedInChecksum));
-	patch->vf->read(patch->vf, &expectedOutChecksum, sizeof(expectedOutChecksum));
+	LOAD_32LE(expectedInChecksum, filesize + IN_CHECKSUM, data);
+	LOAD_32LE(expectedOutChecksum, filesize + OUT_CHECKSUM, data);
 
 	uint32_t inputChecksum = doCrc32(in, inSize);
 	uint32_t outputChecksum = 0;
 
-	if (inputChecksum != expectedInChecksum) {
-		return false;
-	}
-
-	ssize_t filesize = patch->vf->size(patch->vf);
-	patch->vf->seek(patch->vf, 4, SEEK_SET);
-	_decodeLength(patch->vf, NULL); // Discard input size
-	if (_decodeLength(patch->vf, NULL) != outSize) {
-		return false;
-	}
-	if (inSize > SSIZE_MAX || outSize > SSIZE_MAX) {
-		return false;
-	}
-	size_t metadataLength = _decodeLength(patch->vf, NULL);
-	patch->vf->seek(patch->vf, metadataLength, SEEK_CUR); // Skip metadata
+	size_t end = filesize + IN_CHECKSUM;
+	size_t cursor = 4;
+	_decodeBufferLength(data, end, &cursor); // Discard input size
+	bool success = inputChecksum == expectedInChecksum && _decodeBufferLength(data, end, &cursor) == outSize;
+	size_t metadataLength = _decodeBufferLength(data, end, &cursor);
+	cursor += metadataLength; // Skip metadata
 	size_t writeLocation = 0;
 	ssize_t readSourceLocation = 0;
 	ssize_t readTargetLocation = 0;
 	size_t readOffset;
 	uint8_t* writeBuffer = out;
 	const uint8_t* readBuffer = in;
-	while (patch->vf->seek(patch->vf, 0, SEEK_CUR) < filesize + IN_CHECKSUM) {
-		size_t command = _decodeLength(patch->vf, NULL);
+	while (success && cursor < end) {
+		size_t command = _decodeBufferLength(data, end, &cursor);
 		size_t length = (command >> 2) + 1;
 		if (writeLocation + length > outSize) {
-			return false;
+			success = false;
+			break;
 		}
 		size_t i;
 		switch (command & 0x3) {
 		case 0x0:
 			// SourceRead
+			if (writeLocation + length > inSize) {
+				success = false;
+				break;
+			}
 			memmove(&writeBuffer[writeLocation], &readBuffer[writeLocation], length);
 			outputChecksum = crc32(outputChecksum, &writeBuffer[writeLocation], length);
 			writeLocation += length;
 			break;
 		case 0x1:
 			// TargetRead
-			if (patch->vf->read(patch->vf, &writeBuffer[writeLocation], length) != (ssize_t) length) {
-				return false;
+			if (length > end - cursor) {
+				success = false;
+				break;
 			}
+			memcpy(&writeBuffer[writeLocation], &data[cursor], length);
+			cursor += length;
 			outputChecksum = crc32(outputChecksum, &writeBuffer[writeLocation], length);
 			writeLocation += length;
 			break;
 		case 0x2:
 			// SourceCopy
-			readOffset = _decodeLength(patch->vf, NULL);
+			readOffset = _decodeBufferLength(data, end, &cursor);
 			if (readOffset & 1) {
 				readSourceLocation -= readOffset >> 1;
 			} else {
 				readSourceLocation += readOffset >> 1;
 			}
-			if (readSourceLocation < 0 || readSourceLocation > (ssize_t) inSize) {
-				return false;
+			if (readSourceLocation < 0 || readSourceLocation + length > inSize) {
+				success = false;
+				break;
 			}
 			memmove(&writeBuffer[writeLocation], &readBuffer[readSourceLocation], length);
 			outputChecksum = crc32(outputChecksum, &writeBuffer[writeLocation], length);
@@ -198,14 +201,15 @@ bool _BPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* ou
 			break;
 		case 0x3:
 			// TargetCopy
-			readOffset = _decodeLength(patch->vf, NULL);
+			readOffset = _decodeBufferLength(data, end, &cursor);
 			if (readOffset & 1) {
 				readTargetLocation -= readOffset >> 1;
 			} else {
 				readTargetLocation += readOffset >> 1;
 			}
-			if (readTargetLocation < 0 || readTargetLocation > (ssize_t) outSize) {
-				return false;
+			if (readTargetLocation < 0 || readTargetLocation + length > outSize) {
+				success = false;
+				break;
 			}
 			for (i = 0; i < length; ++i) {
 				// This needs to be bytewise as it can overlap
@@ -217,31 +221,20 @@ bool _BPSApplyPatch(struct Patch* patch, const void* in, size_t inSize, void* ou
 			break;
 		}
 	}
-	if (expectedOutChecksum != outputChecksum) {
+	patch->vf->unmap(patch->vf, (void*) data, filesize);
+	if (!success || expectedOutChecksum != outputChecksum) {
 		return false;
 	}
 	return true;
 }
 
-size_t _decodeLength(struct VFile* vf, struct CircleBuffer* buffer) {
+size_t _decodeLength(struct VFile* vf) {
 	size_t shift = 1;
 	size_t value = 0;
 	uint8_t byte;
 	while (true) {
-		if (buffer) {
-			if (!CircleBufferSize(buffer)) {
-				uint8_t block[BUFFER_SIZE];
-				ssize_t read = vf->read(vf, block, sizeof(block));
-				if (read < 1) {
-					return false;
-				}
-				CircleBufferWrite(buffer, block, read);
-			}
-			CircleBufferRead8(buffer, (int8_t*) &byte);
-		} else {
-			if (vf->read(vf, &byte, 1) != 1) {
-				break;
-			}
+		if (vf->read(vf, &byte, 1) != 1) {
+			break;
 		}
 		value += (byte & 0x7f) * shift;
 		if (byte & 0x80) {
@@ -252,3 +245,19 @@ size_t _decodeLength(struct VFile* vf, struct CircleBuffer* buffer) {
 	}
 	return value;
 }
+
+size_t _decodeBufferLength(const uint8_t* data, size_t size, size_t* cursor) {
+	size_t shift = 1;
+	size_t value = 0;
+	while (*cursor < size) {
+		uint8_t byte = data[*cursor];
+		++*cursor;
+		value += (byte & 0x7f) * shift;
+		if (byte & 0x80) {
+			break;
+		}
+		shift <<= 7;
+		value += shift;
+	}
+	return value;
+}
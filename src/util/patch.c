@@ -21,5 +21,6 @@ bool loadPatch(struct VFile* vf, struct Patch* patch) {
 
 	patch->outputSize = 0;
 	patch->applyPatch = 0;
+	patch->inPlace = false;
 	return false;
 }
@@ -9,20 +9,26 @@
 #include <mgba-util/math.h>
 #include <mgba-util/string.h>
 
-#define LIST_INITIAL_SIZE 4
 #define TABLE_INITIAL_SIZE 8
-#define REBALANCE_THRESHOLD 4
-
-#define TABLE_COMPARATOR(LIST, INDEX) LIST->list[(INDEX)].key == key
-#define HASH_TABLE_STRNCMP_COMPARATOR(LIST, INDEX) LIST->list[(INDEX)].key == hash && strncmp(LIST->list[(INDEX)].stringKey, key, LIST->list[(INDEX)].keylen) == 0
-#define HASH_TABLE_MEMCMP_COMPARATOR(LIST, INDEX) LIST->list[(INDEX)].key == hash && LIST->list[(INDEX)].keylen == keylen && memcmp(LIST->list[(INDEX)].stringKey, key, LIST->list[(INDEX)].keylen) == 0
-#define HASH_TABLE_CUSTOM_COMPARATOR(LIST, INDEX) LIST->list[(INDEX)].key == hash && table->fn.equal(LIST->list[(INDEX)].stringKey, key)
-
-#define TABLE_LOOKUP_START(COMPARATOR, LIST) \
-	size_t i; \
-	for (i = 0; i < LIST->nEntries; ++i) { \
-		if (COMPARATOR(LIST, i)) { \
-			struct TableTuple* lookupResult = &LIST->list[i]; \
+#define TABLE_MAX_LOAD(SIZE) ((SIZE) - (SIZE) / 8)
+
+#define TABLE_COMPARATOR(TUPLES, INDEX) TUPLES[(INDEX)].key == key
+#define HASH_TABLE_STRNCMP_COMPARATOR(TUPLES, INDEX) TUPLES[(INDEX)].key == hash && strncmp(TUPLES[(INDEX)].stringKey, key, TUPLES[(INDEX)].keylen) == 0
+#define HASH_TABLE_MEMCMP_COMPARATOR(TUPLES, INDEX) TUPLES[(INDEX)].key == hash && TUPLES[(INDEX)].keylen == keylen && memcmp(TUPLES[(INDEX)].stringKey, key, TUPLES[(INDEX)].keylen) == 0
+#define HASH_TABLE_CUSTOM_COMPARATOR(TUPLES, INDEX) TUPLES[(INDEX)].key == hash && table->fn.equal(TUPLES[(INDEX)].stringKey, key)
+
+// Entries are stored inline in a single open-addressed array using Robin Hood
+// linear probing. An entry's distance is one more than how far it sits from its
+// home slot, with 0 marking an empty slot. Insertion evicts any entry that is
+// closer to home than the one being placed, so a probe can stop as soon as it
+// reaches a slot whose distance is smaller than the distance probed so far.
+#define TABLE_LOOKUP_START(COMPARATOR, TABLE, HASH) \
+	size_t mask = (TABLE)->tableSize - 1; \
+	size_t i = (HASH) & mask; \
+	uint32_t distance; \
+	for (distance = 1; distance <= (TABLE)->table[i].distance; ++distance, i = (i + 1) & mask) { \
+		if (COMPARATOR((TABLE)->table, i)) { \
+			struct TableTuple* lookupResult = &(TABLE)->table[i]; \
 			UNUSED(lookupResult);
 
 #define TABLE_LOOKUP_END \
@@ -32,79 +38,108 @@
 
 struct TableTuple {
 	uint32_t key;
+	uint32_t distance;
 	char* stringKey;
 	size_t keylen;
 	void* value;
 };
 
-struct TableList {
-	struct TableTuple* list;
-	size_t nEntries;
-	size_t listSize;
-};
-
-void HashTableInsertBinaryMoveKey(struct Table* table, void* key, size_t keylen, void* value);
+static inline uint32_t _hashKey(const struct Table* table, const void* key, size_t keylen) {
+	if (table->fn.hash) {
+		return table->fn.hash(key, keylen, table->seed);
+	}
+	return hash32(key, keylen, table->seed);
+}
 
-static inline const struct TableList* _getConstList(const struct Table* table, uint32_t key) {
-	uint32_t entry = key & (table->tableSize - 1);
-	return &table->table[entry];
+static void _placeTuple(struct Table* table, struct TableTuple tuple) {
+	size_t mask = table->tableSize - 1;
+	size_t i = tuple.key & mask;
+	tuple.distance = 1;
+	while (table->table[i].distance) {
+		if (table->table[i].distance < tuple.distance) {
+			struct TableTuple displaced = table->table[i];
+			table->table[i] = tuple;
+			tuple = displaced;
+		}
+		i = (i + 1) & mask;
+		++tuple.distance;
+	}
+	table->table[i] = tuple;
 }
 
-static inline struct TableList* _getList(struct Table* table, uint32_t key) {
-	uint32_t entry = key & (table->tableSize - 1);
-	return &table->table[entry];
+static void _resize(struct Table* table, size_t newSize) {
+	struct TableTuple* oldTable = table->table;
+	size_t oldSize = table->tableSize;
+	table->table = calloc(newSize, sizeof(struct TableTuple));
+	table->tableSize = newSize;
+	size_t i;
+	for (i = 0; i < oldSize; ++i) {
+		if (oldTable[i].distance) {
+			_placeTuple(table, oldTable[i]);
+		}
+	}
+	free(oldTable);
 }
 
-static struct TableList* _resizeAsNeeded(struct Table* table, struct TableList* list, uint32_t key) {
-	UNUSED(table);
-	UNUSED(key);
-	// TODO: Expand table if needed
-	if (list->nEntries + 1 == list->listSize) {
-		list->listSize *= 2;
-		list->list = realloc(list->list, list->listSize * sizeof(struct TableTuple));
+static void _insertTuple(struct Table* table, uint32_t key, char* stringKey, size_t keylen, void* value) {
+	if (table->size + 1 > TABLE_MAX_LOAD(table->tableSize)) {
+		_resize(table, table->tableSize * 2);
 	}
-	return list;
+	struct TableTuple tuple = {
+		.key = key,
+		.stringKey = stringKey,
+		.keylen = keylen,
+		.value = value,
+	};
+	_placeTuple(table, tuple);
+	++table->size;
 }
 
-static void _removeItemFromList(struct Table* table, struct TableList* list, size_t item) {
-	--list->nEntries;
-	--table->size;
+static void _freeTuple(struct Table* table, struct TableTuple* tuple) {
 	if (table->fn.deref) {
-		table->fn.deref(list->list[item].stringKey);
+		table->fn.deref(tuple->stringKey);
 	} else {
-		free(list->list[item].stringKey);
+		free(tuple->stringKey);
 	}
 	if (table->fn.deinitializer) {
-		table->fn.deinitializer(list->list[item].value);
+		table->fn.deinitializer(tuple->value);
 	}
-	if (item != list->nEntries) {
-		list->list[item] = list->list[list->nEntries];
+}
+
+static void _removeSlot(struct Table* table, size_t slot) {
+	size_t mask = table->tableSize - 1;
+	_freeTuple(table, &table->table[slot]);
+	--table->size;
+
+	// Shift the rest of the run back by one so no tombstones are needed
+	size_t next = (slot + 1) & mask;
+	while (table->table[next].distance > 1) {
+		table->table[slot] = table->table[next];
+		--table->table[slot].distance;
+		slot = next;
+		next = (next + 1) & mask;
 	}
+	memset(&table->table[slot], 0, sizeof(struct TableTuple));
 }
 
-static void _rebalance(struct Table* table) {
-	struct Table newTable;
-	TableInit(&newTable, table->tableSize * REBALANCE_THRESHOLD, NULL);
-	memcpy(&newTable.fn, &table->fn, sizeof(newTable.fn));
-	newTable.seed = table->seed * 134775813 + 1;
+static void _clear(struct Table* table) {
 	size_t i;
 	for (i = 0; i < table->tableSize; ++i) {
-		struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			if (!table->fn.equal) {
-				HashTableInsertBinaryMoveKey(&newTable, list->list[j].stringKey, list->list[j].keylen, list->list[j].value);
-			} else {
-				HashTableInsertCustom(&newTable, list->list[j].stringKey, list->list[j].value);
-				table->fn.deref(list->list[j].stringKey);
-			}
+		if (table->table[i].distance) {
+			_freeTuple(table, &table->table[i]);
 		}
-		free(list->list);
 	}
-	free(table->table);
-	table->tableSize = newTable.tableSize;
-	table->table = newTable.table;
-	table->seed = newTable.seed;
+	memset(table->table, 0, table->tableSize * sizeof(struct TableTuple));
+	table->size = 0;
+}
+
+static size_t _nextOccupied(const struct Table* table, size_t slot) {
+	for (; slot < table->tableSize; ++slot) {
+		if (table->table[slot].distance) {
+			break;
+		}
+	}
+	return slot;
 }
 
 void TableInit(struct Table* table, size_t initialSize, void (*deinitializer)(void*)) {
@@ -114,72 +149,30 @@ void TableInit(struct Table* table, size_t initialSize, void (*deinitializer)(vo
 		initialSize = toPow2(initialSize);
 	}
 	table->tableSize = initialSize;
-	table->table = calloc(table->tableSize, sizeof(struct TableList));
+	table->table = calloc(table->tableSize, sizeof(struct TableTuple));
 	table->size = 0;
 	table->fn = (struct TableFunctions) {
 		.deinitializer = deinitializer
 	};
 	table->seed = 0;
-
-	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		table->table[i].listSize = LIST_INITIAL_SIZE;
-		table->table[i].nEntries = 0;
-		table->table[i].list = calloc(LIST_INITIAL_SIZE, sizeof(struct TableTuple));
-	}
 }
 
 void TableDeinit(struct Table* table) {
-	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			if (table->fn.deref) {
-				table->fn.deref(list->list[j].stringKey);
-			} else {
-				free(list->list[j].stringKey);
-			}
-			if (table->fn.deinitializer) {
-				table->fn.deinitializer(list->list[j].value);
-			}
-		}
-		free(list->list);
-	}
+	_clear(table);
 	free(table->table);
 	table->table = 0;
 	table->tableSize = 0;
 }
 
 void* TableLookup(const struct Table* table, uint32_t key) {
-	const struct TableList* list = _getConstList(table, key);
-	TABLE_LOOKUP_START(TABLE_COMPARATOR, list) {
+	TABLE_LOOKUP_START(TABLE_COMPARATOR, table, key) {
 		return lookupResult->value;
 	} TABLE_LOOKUP_END;
 	return 0;
 }
 
 void TableInsert(struct Table* table, uint32_t key, void* value) {
-	struct TableList* list = _getList(table, key);
-	if (table->size >= table->tableSize * REBALANCE_THRESHOLD) {
-		struct Table newTable;
-		TableInit(&newTable, table->tableSize * REBALANCE_THRESHOLD, NULL);
-		memcpy(&newTable.fn, &table->fn, sizeof(newTable.fn));
-		size_t i;
-		for (i = 0; i < table->tableSize; ++i) {
-			struct TableList* list = &table->table[i];
-			size_t j;
-			for (j = 0; j < list->nEntries; ++j) {
-				TableInsert(&newTable, list->list[j].key, list->list[j].value);
-			}
-			free(list->list);
-		}
-		free(table->table);
-		table->tableSize = newTable.tableSize;
-		table->table = newTable.table;
-		list = _getList(table, key);
-	}
-	TABLE_LOOKUP_START(TABLE_COMPARATOR, list) {
+	TABLE_LOOKUP_START(TABLE_COMPARATOR, table, key) {
 		if (value != lookupResult->value) {
 			if (table->fn.deinitializer) {
 				table->fn.deinitializer(lookupResult->value);
@@ -188,45 +181,24 @@ void TableInsert(struct Table* table, uint32_t key, void* value) {
 		}
 		return;
 	} TABLE_LOOKUP_END;
-	list = _resizeAsNeeded(table, list, key);
-	list->list[list->nEntries].key = key;
-	list->list[list->nEntries].stringKey = 0;
-	list->list[list->nEntries].value = value;
-	++list->nEntries;
-	++table->size;
+	_insertTuple(table, key, NULL, 0, value);
 }
 
 void TableRemove(struct Table* table, uint32_t key) {
-	struct TableList* list = _getList(table, key);
-	TABLE_LOOKUP_START(TABLE_COMPARATOR, list) {
-		_removeItemFromList(table, list, i); // TODO: Move i out of the macro
+	TABLE_LOOKUP_START(TABLE_COMPARATOR, table, key) {
+		_removeSlot(table, i);
 	} TABLE_LOOKUP_END;
 }
 
 void TableClear(struct Table* table) {
-	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		struct TableList* list = &table->table[i];
-		if (table->fn.deinitializer) {
-			size_t j;
-			for (j = 0; j < list->nEntries; ++j) {
-				table->fn.deinitializer(list->list[j].value);
-			}
-		}
-		free(list->list);
-		list->listSize = LIST_INITIAL_SIZE;
-		list->nEntries = 0;
-		list->list = calloc(LIST_INITIAL_SIZE, sizeof(struct TableTuple));
-	}
+	_clear(table);
 }
 
 void TableEnumerate(const struct Table* table, void (*handler)(uint32_t key, void* value, void* user), void* user) {
 	size_t i;
 	for (i = 0; i < table->tableSize; ++i) {
-		const struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			handler(list->list[j].key, list->list[j].value, user);
+		if (table->table[i].distance) {
+			handler(table->table[i].key, table->table[i].value, user);
 		}
 	}
 }
@@ -236,46 +208,26 @@ size_t TableSize(const struct Table* table) {
 }
 
 bool TableIteratorStart(const struct Table* table, struct TableIterator* iter) {
-	iter->entry = 0;
-	for (iter->bucket = 0; iter->bucket < table->tableSize; ++iter->bucket) {
-		if (table->table[iter->bucket].nEntries) {
-			break;
-		}
-	}
-	return iter->bucket < table->tableSize;
+	iter->slot = _nextOccupied(table, 0);
+	return iter->slot < table->tableSize;
 }
 
 bool TableIteratorNext(const struct Table* table, struct TableIterator* iter) {
-	if (iter->entry + 1 < table->table[iter->bucket].nEntries) {
-		++iter->entry;
-		return true;
-	}
-	if (iter->bucket + 1 < table->tableSize) {
-		iter->entry = 0;
-		for (++iter->bucket; iter->bucket < table->tableSize; ++iter->bucket) {
-			if (table->table[iter->bucket].nEntries) {
-				break;
-			}
-		}
-		return iter->bucket < table->tableSize;
-	}
-	return false;
+	iter->slot = _nextOccupied(table, iter->slot + 1);
+	return iter->slot < table->tableSize;
 }
 
 uint32_t TableIteratorGetKey(const struct Table* table, const struct TableIterator* iter) {
-	return table->table[iter->bucket].list[iter->entry].key;
+	return table->table[iter->slot].key;
 }
 
 void* TableIteratorGetValue(const struct Table* table, const struct TableIterator* iter) {
-	return table->table[iter->bucket].list[iter->entry].value;
+	return table->table[iter->slot].value;
 }
 
 bool TableIteratorLookup(const struct Table* table, struct TableIterator* iter, uint32_t key) {
-	uint32_t bucket = key & (table->tableSize - 1);
-	const struct TableList* list = &table->table[bucket];
-	TABLE_LOOKUP_START(TABLE_COMPARATOR, list) {
-		iter->bucket = bucket;
-		iter->entry = i;
+	TABLE_LOOKUP_START(TABLE_COMPARATOR, table, key) {
+		iter->slot = i;
 		return true;
 	} TABLE_LOOKUP_END;
 	return false;
@@ -296,28 +248,16 @@ void HashTableDeinit(struct Table* table) {
 }
 
 void* HashTableLookup(const struct Table* table, const char* key) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, strlen(key), table->seed);
-	} else {
-		hash = hash32(key, strlen(key), table->seed);
-	}
-	const struct TableList* list = _getConstList(table, hash);
-	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, list) {
+	uint32_t hash = _hashKey(table, key, strlen(key));
+	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, table, hash) {
 		return lookupResult->value;
 	} TABLE_LOOKUP_END;
 	return 0;
 }
 
 void* HashTableLookupBinary(const struct Table* table, const void* key, size_t keylen) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, keylen, table->seed);
-	} else {
-		hash = hash32(key, keylen, table->seed);
-	}
-	const struct TableList* list = _getConstList(table, hash);
-	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, list) {
+	uint32_t hash = _hashKey(table, key, keylen);
+	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, table, hash) {
 		return lookupResult->value;
 	} TABLE_LOOKUP_END;
 	return 0;
@@ -325,31 +265,16 @@ void* HashTableLookupBinary(const struct Table* table, const void* key, size_t k
 
 void* HashTableLookupCustom(const struct Table* table, void* key) {
 	uint32_t hash = table->fn.hash(key, 0, table->seed);
-	const struct TableList* list = _getConstList(table, hash);
-	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, list) {
+	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, table, hash) {
 		return lookupResult->value;
 	} TABLE_LOOKUP_END;
 	return 0;
 }
 
 void HashTableInsert(struct Table* table, const char* key, void* value) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, strlen(key), table->seed);
-	} else {
-		hash = hash32(key, strlen(key), table->seed);
-	}
-	struct TableList* list = _getList(table, hash);
-	if (table->size >= table->tableSize * REBALANCE_THRESHOLD) {
-		_rebalance(table);
-		if (table->fn.hash) {
-			hash = table->fn.hash(key, strlen(key), table->seed);
-		} else {
-			hash = hash32(key, strlen(key), table->seed);
-		}
-		list = _getList(table, hash);
-	}
-	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, list) {
+	size_t keylen = strlen(key);
+	uint32_t hash = _hashKey(table, key, keylen);
+	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, table, hash) {
 		if (value != lookupResult->value) {
 			if (table->fn.deinitializer) {
 				table->fn.deinitializer(lookupResult->value);
@@ -358,33 +283,12 @@ void HashTableInsert(struct Table* table, const char* key, void* value) {
 		}
 		return;
 	} TABLE_LOOKUP_END;
-	list = _resizeAsNeeded(table, list, hash);
-	list->list[list->nEntries].key = hash;
-	list->list[list->nEntries].stringKey = strdup(key);
-	list->list[list->nEntries].keylen = strlen(key);
-	list->list[list->nEntries].value = value;
-	++list->nEntries;
-	++table->size;
+	_insertTuple(table, hash, strdup(key), keylen, value);
 }
 
 void HashTableInsertBinary(struct Table* table, const void* key, size_t keylen, void* value) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, keylen, table->seed);
-	} else {
-		hash = hash32(key, keylen, table->seed);
-	}
-	struct TableList* list = _getList(table, hash);
-	if (table->size >= table->tableSize * REBALANCE_THRESHOLD) {
-		_rebalance(table);
-		if (table->fn.hash) {
-			hash = table->fn.hash(key, keylen, table->seed);
-		} else {
-			hash = hash32(key, keylen, table->seed);
-		}
-		list = _getList(table, hash);
-	}
-	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, list) {
+	uint32_t hash = _hashKey(table, key, keylen);
+	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, table, hash) {
 		if (value != lookupResult->value) {
 			if (table->fn.deinitializer) {
 				table->fn.deinitializer(lookupResult->value);
@@ -393,60 +297,14 @@ void HashTableInsertBinary(struct Table* table, const void* key, size_t keylen,
 		}
 		return;
 	} TABLE_LOOKUP_END;
-	list = _resizeAsNeeded(table, list, hash);
-	list->list[list->nEntries].key = hash;
-	list->list[list->nEntries].stringKey = malloc(keylen);
-	memcpy(list->list[list->nEntries].stringKey, key, keylen);
-	list->list[list->nEntries].keylen = keylen;
-	list->list[list->nEntries].value = value;
-	++list->nEntries;
-	++table->size;
+	char* keyCopy = malloc(keylen);
+	memcpy(keyCopy, key, keylen);
+	_insertTuple(table, hash, keyCopy, keylen, value);
 }
 
 void HashTableInsertCustom(struct Table* table, void* key, void* value) {
 	uint32_t hash = table->fn.hash(key, 0, table->seed);
-	struct TableList* list = _getList(table, hash);
-	if (table->size >= table->tableSize * REBALANCE_THRESHOLD) {
-		_rebalance(table);
-		hash = table->fn.hash(key, 0, table->seed);
-		list = _getList(table, hash);
-	}
-	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, list) {
-		if (value != lookupResult->value) {
-			if (table->fn.deinitializer) {
-				table->fn.deinitializer(lookupResult->value);
-			}
-			lookupResult->value = value;
-		}
-		return;
-	} TABLE_LOOKUP_END;
-	list = _resizeAsNeeded(table, list, hash);
-	list->list[list->nEntries].key = hash;
-	list->list[list->nEntries].stringKey = table->fn.ref(key);
-	list->list[list->nEntries].keylen = 0;
-	list->list[list->nEntries].value = value;
-	++list->nEntries;
-	++table->size;
-}
-
-void HashTableInsertBinaryMoveKey(struct Table* table, void* key, size_t keylen, void* value) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, keylen, table->seed);
-	} else {
-		hash = hash32(key, keylen, table->seed);
-	}
-	struct TableList* list = _getList(table, hash);
-	if (table->size >= table->tableSize * REBALANCE_THRESHOLD) {
-		_rebalance(table);
-		if (table->fn.hash) {
-			hash = table->fn.hash(key, keylen, table->seed);
-		} else {
-			hash = hash32(key, keylen, table->seed);
-		}
-		list = _getList(table, hash);
-	}
-	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, list) {
+	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, table, hash) {
 		if (value != lookupResult->value) {
 			if (table->fn.deinitializer) {
 				table->fn.deinitializer(lookupResult->value);
@@ -455,79 +313,39 @@ void HashTableInsertBinaryMoveKey(struct Table* table, void* key, size_t keylen,
 		}
 		return;
 	} TABLE_LOOKUP_END;
-	list = _resizeAsNeeded(table, list, hash);
-	list->list[list->nEntries].key = hash;
-	list->list[list->nEntries].stringKey = key;
-	list->list[list->nEntries].keylen = keylen;
-	list->list[list->nEntries].value = value;
-	++list->nEntries;
-	++table->size;
+	_insertTuple(table, hash, table->fn.ref(key), 0, value);
 }
 
 void HashTableRemove(struct Table* table, const char* key) {
-	uint32_t hash;
-
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, strlen(key), table->seed);
-	} else {
-		hash = hash32(key, strlen(key), table->seed);
-	}
-	struct TableList* list = _getList(table, hash);
-	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, list) {
-		_removeItemFromList(table, list, i); // TODO: Move i out of the macro
+	uint32_t hash = _hashKey(table, key, strlen(key));
+	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, table, hash) {
+		_removeSlot(table, i);
 	} TABLE_LOOKUP_END;
 }
 
 void HashTableRemoveBinary(struct Table* table, const void* key, size_t keylen) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, keylen, table->seed);
-	} else {
-		hash = hash32(key, keylen, table->seed);
-	}
-	struct TableList* list = _getList(table, hash);
-	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, list) {
-		_removeItemFromList(table, list, i); // TODO: Move i out of the macro
+	uint32_t hash = _hashKey(table, key, keylen);
+	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, table, hash) {
+		_removeSlot(table, i);
 	} TABLE_LOOKUP_END;
 }
 
 void HashTableRemoveCustom(struct Table* table, void* key) {
 	uint32_t hash = table->fn.hash(key, 0, table->seed);
-	struct TableList* list = _getList(table, hash);
-	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, list) {
-		_removeItemFromList(table, list, i); // TODO: Move i out of the macro
+	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, table, hash) {
+		_removeSlot(table, i);
 	} TABLE_LOOKUP_END;
 }
 
 void HashTableClear(struct Table* table) {
-	size_t i;
-	for (i = 0; i < table->tableSize; ++i) {
-		struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			if (table->fn.deinitializer) {
-				table->fn.deinitializer(list->list[j].value);
-			}
-			if (table->fn.deref) {
-				table->fn.deref(list->list[j].stringKey);
-			} else {
-				free(list->list[j].stringKey);
-			}
-		}
-		free(list->list);
-		list->listSize = LIST_INITIAL_SIZE;
-		list->nEntries = 0;
-		list->list = calloc(LIST_INITIAL_SIZE, sizeof(struct TableTuple));
-	}
+	_clear(table);
 }
 
 void HashTableEnumerate(const struct Table* table, void (*handler)(const char* key, void* value, void* user), void* user) {
 	size_t i;
 	for (i = 0; i < table->tableSize; ++i) {
-		const struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			handler(list->list[j].stringKey, list->list[j].value, user);
+		if (table->table[i].distance) {
+			handler(table->table[i].stringKey, table->table[i].value, user);
 		}
 	}
 }
@@ -535,10 +353,8 @@ void HashTableEnumerate(const struct Table* table, void (*handler)(const char* k
 void HashTableEnumerateBinary(const struct Table* table, void (*handler)(const char* key, size_t keylen, void* value, void* user), void* user) {
 	size_t i;
 	for (i = 0; i < table->tableSize; ++i) {
-		const struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			handler(list->list[j].stringKey, list->list[j].keylen, list->list[j].value, user);
+		if (table->table[i].distance) {
+			handler(table->table[i].stringKey, table->table[i].keylen, table->table[i].value, user);
 		}
 	}
 }
@@ -546,27 +362,20 @@ void HashTableEnumerateBinary(const struct Table* table, void (*handler)(const c
 void HashTableEnumerateCustom(const struct Table* table, void (*handler)(void* key, void* value, void* user), void* user) {
 	size_t i;
 	for (i = 0; i < table->tableSize; ++i) {
-		const struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			handler((char*) list->list[j].stringKey, list->list[j].value, user);
+		if (table->table[i].distance) {
+			handler((char*) table->table[i].stringKey, table->table[i].value, user);
 		}
 	}
 }
 
 const char* HashTableSearch(const struct Table* table, bool (*predicate)(const char* key, const void* value, const void* user), const void* user) {
 	size_t i;
-	const char* result = NULL;
 	for (i = 0; i < table->tableSize; ++i) {
-		const struct TableList* list = &table->table[i];
-		size_t j;
-		for (j = 0; j < list->nEntries; ++j) {
-			if (predicate(list->list[j].stringKey, list->list[j].value, user)) {
-				return list->list[j].stringKey;
-			}
+		if (table->table[i].distance && predicate(table->table[i].stringKey, table->table[i].value, user)) {
+			return table->table[i].stringKey;
 		}
 	}
-	return result;
+	return NULL;
 }
 
 static bool HashTableRefEqual(const char* key, const void* value, const void* user) {
@@ -616,19 +425,19 @@ bool HashTableIteratorNext(const struct Table* table, struct TableIterator* iter
 }
 
 const char* HashTableIteratorGetKey(const struct Table* table, const struct TableIterator* iter) {
-	return table->table[iter->bucket].list[iter->entry].stringKey;
+	return table->table[iter->slot].stringKey;
 }
 
 const void* HashTableIteratorGetBinaryKey(const struct Table* table, const struct TableIterator* iter) {
-	return table->table[iter->bucket].list[iter->entry].stringKey;
+	return table->table[iter->slot].stringKey;
 }
 
 size_t HashTableIteratorGetBinaryKeyLen(const struct Table* table, const struct TableIterator* iter) {
-	return table->table[iter->bucket].list[iter->entry].keylen;
+	return table->table[iter->slot].keylen;
 }
 
 void* HashTableIteratorGetCustomKey(const struct Table* table, const struct TableIterator* iter) {
-	return (char*) table->table[iter->bucket].list[iter->entry].stringKey;
+	return (char*) table->table[iter->slot].stringKey;
 }
 
 void* HashTableIteratorGetValue(const struct Table* table, const struct TableIterator* iter) {
@@ -636,34 +445,18 @@ void* HashTableIteratorGetValue(const struct Table* table, const struct TableIte
 }
 
 bool HashTableIteratorLookup(const struct Table* table, struct TableIterator* iter, const char* key) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, strlen(key), table->seed);
-	} else {
-		hash = hash32(key, strlen(key), table->seed);
-	}
-	uint32_t bucket = hash & (table->tableSize - 1);
-	const struct TableList* list = &table->table[bucket];
-	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, list) {
-		iter->bucket = bucket;
-		iter->entry = i;
+	uint32_t hash = _hashKey(table, key, strlen(key));
+	TABLE_LOOKUP_START(HASH_TABLE_STRNCMP_COMPARATOR, table, hash) {
+		iter->slot = i;
 		return true;
 	} TABLE_LOOKUP_END;
 	return false;
 }
 
 bool HashTableIteratorLookupBinary(const struct Table* table, struct TableIterator* iter, const void* key, size_t keylen) {
-	uint32_t hash;
-	if (table->fn.hash) {
-		hash = table->fn.hash(key, keylen, table->seed);
-	} else {
-		hash = hash32(key, keylen, table->seed);
-	}
-	uint32_t bucket = hash & (table->tableSize - 1);
-	const struct TableList* list = &table->table[bucket];
-	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, list) {
-		iter->bucket = bucket;
-		iter->entry = i;
+	uint32_t hash = _hashKey(table, key, keylen);
+	TABLE_LOOKUP_START(HASH_TABLE_MEMCMP_COMPARATOR, table, hash) {
+		iter->slot = i;
 		return true;
 	} TABLE_LOOKUP_END;
 	return false;
@@ -671,11 +464,8 @@ bool HashTableIteratorLookupBinary(const struct Table* table, struct TableIterat
 
 bool HashTableIteratorLookupCustom(const struct Table* table, struct TableIterator* iter, void* key) {
 	uint32_t hash = table->fn.hash(key, 0, table->seed);
-	uint32_t bucket = hash & (table->tableSize - 1);
-	const struct TableList* list = &table->table[bucket];
-	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, list) {
-		iter->bucket = bucket;
-		iter->entry = i;
+	TABLE_LOOKUP_START(HASH_TABLE_CUSTOM_COMPARATOR, table, hash) {
+		iter->slot = i;
 		return true;
 	} TABLE_LOOKUP_END;
 	return false;
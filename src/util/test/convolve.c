@@ -0,0 +1,113 @@
+/* Copyright (c) 2013-2023 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/convolve.h>
+
+static void _naiveConvolve(const uint8_t* src, uint8_t* dst, size_t width, size_t height, size_t stride, size_t channels, const struct ConvolutionKernel* kernel) {
+	size_t kx2 = kernel->dims[0] / 2;
+	size_t ky2 = kernel->dims[1] / 2;
+	size_t x, y, c;
+	for (y = 0; y < height; ++y) {
+		for (x = 0; x < width; ++x) {
+			for (c = 0; c < channels; ++c) {
+				float sum = 0.f;
+				size_t kx, ky;
+				for (ky = 0; ky < kernel->dims[1]; ++ky) {
+					size_t cy = y + ky > ky2 ? y + ky - ky2 : 0;
+					if (cy >= height) {
+						cy = height - 1;
+					}
+					for (kx = 0; kx < kernel->dims[0]; ++kx) {
+						size_t cx = x + kx > kx2 ? x + kx - kx2 : 0;
+						if (cx >= width) {
+							cx = width - 1;
+						}
+						sum += src[cy * stride + cx * channels + c] * kernel->kernel[ky * kernel->dims[0] + kx];
+					}
+				}
+				dst[y * stride + x * channels + c] = sum;
+			}
+		}
+	}
+}
+
+static void _fillNoise(uint8_t* buffer, size_t size) {
+	uint32_t seed = 1;
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		seed = seed * 1664525 + 1013904223;
+		buffer[i] = seed >> 24;
+	}
+}
+
+M_TEST_DEFINE(radialPacked) {
+	static uint8_t src[37 * 23];
+	static uint8_t dst[37 * 23];
+	static uint8_t expected[37 * 23];
+	_fillNoise(src, sizeof(src));
+
+	size_t dims[] = { 7, 5 };
+	struct ConvolutionKernel kern;
+	ConvolutionKernelCreate(&kern, 2, dims);
+	ConvolutionKernelFillRadial(&kern, true);
+	Convolve2DClampPacked8(src, dst, 37, 23, 37, &kern);
+	_naiveConvolve(src, expected, 37, 23, 37, 1, &kern);
+	ConvolutionKernelDestroy(&kern);
+
+	assert_memory_equal(dst, expected, sizeof(dst));
+}
+
+M_TEST_DEFINE(circleChannels) {
+	static uint8_t src[40 * 3 * 19];
+	static uint8_t dst[40 * 3 * 19];
+	static uint8_t expected[40 * 3 * 19];
+	_fillNoise(src, sizeof(src));
+
+	size_t dims[] = { 6, 9 };
+	struct ConvolutionKernel kern;
+	ConvolutionKernelCreate(&kern, 2, dims);
+	ConvolutionKernelFillCircle(&kern, true);
+	Convolve2DClampChannels8(src, dst, 40, 19, 40 * 3, 3, &kern);
+	_naiveConvolve(src, expected, 40, 19, 40 * 3, 3, &kern);
+	ConvolutionKernelDestroy(&kern);
+
+	assert_memory_equal(dst, expected, sizeof(dst));
+}
+
+M_TEST_DEFINE(separableChannels) {
+	static uint8_t src[31 * 2 * 17];
+	static uint8_t dst[31 * 2 * 17];
+	static uint8_t expected[31 * 2 * 17];
+	_fillNoise(src, sizeof(src));
+
+	static const float rows[] = { 1.f, 4.f, 6.f, 4.f, 1.f };
+	static const float cols[] = { 1.f, 2.f, 1.f };
+	size_t dims[] = { 5, 3 };
+	struct ConvolutionKernel kern;
+	ConvolutionKernelCreate(&kern, 2, dims);
+	size_t x, y;
+	for (y = 0; y < 3; ++y) {
+		for (x = 0; x < 5; ++x) {
+			kern.kernel[y * 5 + x] = rows[x] * cols[y] / 64.f;
+		}
+	}
+	Convolve2DClampChannels8(src, dst, 31, 17, 31 * 2, 2, &kern);
+	_naiveConvolve(src, expected, 31, 17, 31 * 2, 2, &kern);
+	ConvolutionKernelDestroy(&kern);
+
+	// Separating the kernel reorders the floating point math, so allow for off-by-one truncation
+	size_t i;
+	for (i = 0; i < sizeof(dst); ++i) {
+		assert_in_range(dst[i], expected[i] ? expected[i] - 1 : 0, expected[i] + 1);
+	}
+}
+
+M_TEST_SUITE_DEFINE(Convolve,
+	cmocka_unit_test(radialPacked),
+	cmocka_unit_test(circleChannels),
+	cmocka_unit_test(separableChannels),
+)
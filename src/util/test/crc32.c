@@ -0,0 +1,58 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/crc32.h>
+
+static uint32_t _bitwiseCrc32(uint32_t crc, const uint8_t* buf, size_t size) {
+	crc = ~crc;
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		crc ^= buf[i];
+		int bit;
+		for (bit = 0; bit < 8; ++bit) {
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+		}
+	}
+	return ~crc;
+}
+
+M_TEST_DEFINE(checkValue) {
+	assert_int_equal(doCrc32("123456789", 9), 0xCBF43926);
+	assert_int_equal(doCrc32("", 0), 0);
+}
+
+M_TEST_DEFINE(unalignedLengths) {
+	uint8_t buffer[80];
+	size_t i;
+	for (i = 0; i < sizeof(buffer); ++i) {
+		buffer[i] = i * 73 + 11;
+	}
+	size_t offset, length;
+	for (offset = 0; offset < 8; ++offset) {
+		for (length = 0; length + offset <= sizeof(buffer); ++length) {
+			assert_int_equal(crc32(0x12345678, &buffer[offset], length), _bitwiseCrc32(0x12345678, &buffer[offset], length));
+		}
+	}
+}
+
+M_TEST_DEFINE(incremental) {
+	uint8_t buffer[1000];
+	size_t i;
+	for (i = 0; i < sizeof(buffer); ++i) {
+		buffer[i] = i ^ (i >> 3);
+	}
+	uint32_t crc = crc32(0, buffer, 13);
+	crc = crc32(crc, &buffer[13], 500);
+	crc = crc32(crc, &buffer[513], sizeof(buffer) - 513);
+	assert_int_equal(crc, doCrc32(buffer, sizeof(buffer)));
+}
+
+M_TEST_SUITE_DEFINE(Crc32,
+	cmocka_unit_test(checkValue),
+	cmocka_unit_test(unalignedLengths),
+	cmocka_unit_test(incremental),
+)
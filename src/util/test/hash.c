@@ -0,0 +1,44 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/hash.h>
+
+M_TEST_DEFINE(hash64Value) {
+	// Reference XXH64 values
+	assert_true(hash64("", 0, 0) == 0xEF46DB3751D8E999ULL);
+	assert_true(hash64("a", 1, 0) == 0xD24EC4F1A98C6E5BULL);
+	assert_true(hash64("abc", 3, 0) == 0x44BC2CF5AD770999ULL);
+	assert_true(hash64("abc", 3, 1) == 0xBEA9CA8199328908ULL);
+
+	uint8_t buffer[100];
+	size_t i;
+	for (i = 0; i < sizeof(buffer); ++i) {
+		buffer[i] = i;
+	}
+	assert_true(hash64(buffer, sizeof(buffer), 0) == 0x6AC1E58032166597ULL);
+	assert_true(hash64(buffer, sizeof(buffer), 1) == 0x3D19A3A2098A7023ULL);
+}
+
+M_TEST_DEFINE(hash64Unaligned) {
+	uint8_t buffer[80];
+	uint8_t copy[80];
+	size_t i;
+	for (i = 0; i < sizeof(buffer); ++i) {
+		buffer[i] = i * 73 + 11;
+	}
+	size_t offset, length;
+	for (offset = 1; offset < 8; ++offset) {
+		for (length = 0; length + offset <= sizeof(buffer); ++length) {
+			memcpy(copy, &buffer[offset], length);
+			assert_true(hash64(&buffer[offset], length, 7) == hash64(copy, length, 7));
+		}
+	}
+}
+
+M_TEST_SUITE_DEFINE(Hash,
+	cmocka_unit_test(hash64Value),
+	cmocka_unit_test(hash64Unaligned))
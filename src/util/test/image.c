@@ -2038,6 +2038,90 @@ M_TEST_DEFINE(painterDrawCircleInvalid) {
 	mImageDestroy(image);
 }
 
+M_TEST_DEFINE(convertRow) {
+	static const enum mColorFormat formats[] = {
+		mCOLOR_XBGR8, mCOLOR_XRGB8, mCOLOR_BGRX8, mCOLOR_RGBX8,
+		mCOLOR_ABGR8, mCOLOR_ARGB8, mCOLOR_BGRA8, mCOLOR_RGBA8,
+		mCOLOR_RGB5, mCOLOR_BGR5, mCOLOR_RGB565, mCOLOR_BGR565,
+		mCOLOR_ARGB5, mCOLOR_ABGR5, mCOLOR_RGBA5, mCOLOR_BGRA5,
+	};
+	uint32_t* src32 = malloc(0x10000 * sizeof(*src32));
+	uint16_t* src16 = malloc(0x10000 * sizeof(*src16));
+	uint32_t* dst32 = malloc(0x10000 * sizeof(*dst32));
+	uint16_t* dst16 = malloc(0x10000 * sizeof(*dst16));
+	uint32_t seed = 1;
+	size_t i, from, to;
+	for (i = 0; i < 0x10000; ++i) {
+		seed = seed * 1664525 + 1013904223;
+		src32[i] = seed;
+		src16[i] = i;
+	}
+
+	for (from = 0; from < sizeof(formats) / sizeof(*formats); ++from) {
+		const void* src = mColorFormatBytes(formats[from]) == 4 ? (void*) src32 : (void*) src16;
+		for (to = 0; to < sizeof(formats) / sizeof(*formats); ++to) {
+			mColorConvertRow(mColorFormatBytes(formats[to]) == 4 ? (void*) dst32 : (void*) dst16, formats[to], src, formats[from], 0x10000);
+			for (i = 0; i < 0x10000; ++i) {
+				uint32_t color = mColorFormatBytes(formats[from]) == 4 ? src32[i] : src16[i];
+				uint32_t converted = mColorFormatBytes(formats[to]) == 4 ? dst32[i] : dst16[i];
+				assert_int_equal(converted, mColorConvert(color, formats[from], formats[to]));
+			}
+		}
+	}
+
+	free(src32);
+	free(src16);
+	free(dst32);
+	free(dst16);
+}
+
+M_TEST_DEFINE(dirtyTracking) {
+	struct mImage* image = mImageCreate(8, 8, mCOLOR_ARGB8);
+	struct mImage* source = mImageCreate(4, 4, mCOLOR_ARGB8);
+	assert_int_equal(image->dirty.width, 0);
+	assert_int_equal(image->dirty.height, 0);
+
+	mImageSetPixel(image, 2, 3, 0xFFFFFFFF);
+	assert_int_equal(image->dirty.x, 2);
+	assert_int_equal(image->dirty.y, 3);
+	assert_int_equal(image->dirty.width, 1);
+	assert_int_equal(image->dirty.height, 1);
+
+	mImageSetPixel(image, 8, 8, 0xFFFFFFFF);
+	assert_int_equal(image->dirty.width, 1);
+	assert_int_equal(image->dirty.height, 1);
+
+	mImageBlit(image, source, 6, 5);
+	assert_int_equal(image->dirty.x, 2);
+	assert_int_equal(image->dirty.y, 3);
+	assert_int_equal(image->dirty.width, 6);
+	assert_int_equal(image->dirty.height, 5);
+
+	mImageClearDirty(image);
+	assert_int_equal(image->dirty.width, 0);
+	assert_int_equal(image->dirty.height, 0);
+
+	mImageComposite(image, source, -2, -1);
+	assert_int_equal(image->dirty.x, 0);
+	assert_int_equal(image->dirty.y, 0);
+	assert_int_equal(image->dirty.width, 2);
+	assert_int_equal(image->dirty.height, 3);
+
+	mImageClearDirty(image);
+	struct mPainter painter;
+	mPainterInit(&painter, image);
+	painter.fill = true;
+	painter.strokeWidth = 0;
+	mPainterDrawRectangle(&painter, 1, 6, 3, 4);
+	assert_int_equal(image->dirty.x, 1);
+	assert_int_equal(image->dirty.y, 6);
+	assert_int_equal(image->dirty.width, 3);
+	assert_int_equal(image->dirty.height, 2);
+
+	mImageDestroy(source);
+	mImageDestroy(image);
+}
+
 #undef COMPARE3X
 #undef COMPARE3
 #undef COMPARE4X
@@ -2083,4 +2167,6 @@ M_TEST_SUITE_DEFINE(Image,
 	cmocka_unit_test(painterDrawCircleOffset),
 	cmocka_unit_test(painterDrawCircleBlend),
 	cmocka_unit_test(painterDrawCircleInvalid),
+	cmocka_unit_test(convertRow),
+	cmocka_unit_test(dirtyTracking),
 )
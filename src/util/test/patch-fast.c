@@ -0,0 +1,121 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/patch/fast.h>
+
+#define BUFFER_SIZE 0x10000
+
+static void _roundTrip(uint8_t* in, uint8_t* out, size_t size) {
+	struct PatchFast patch;
+	initPatchFast(&patch);
+	uint8_t* result = malloc(size);
+	memset(result, 0xA5, size);
+	assert_true(diffPatchFast(&patch, in, out, size));
+	assert_true(patch.d.applyPatch(&patch.d, in, size, result, size));
+	assert_memory_equal(result, out, size);
+
+	// Patches are symmetric, so applying the same one to the output gets the input back
+	assert_true(patch.d.applyPatch(&patch.d, out, size, result, size));
+	assert_memory_equal(result, in, size);
+	free(result);
+	deinitPatchFast(&patch);
+}
+
+static uint32_t* _randomBuffer(size_t size, unsigned seed) {
+	uint32_t* buffer = malloc(size);
+	size_t i;
+	for (i = 0; i < size / 4; ++i) {
+		seed = seed * 1103515245 + 12345;
+		buffer[i] = seed;
+	}
+	return buffer;
+}
+
+M_TEST_DEFINE(identical) {
+	uint32_t* in = _randomBuffer(BUFFER_SIZE, 1);
+	struct PatchFast patch;
+	initPatchFast(&patch);
+	assert_true(diffPatchFast(&patch, in, in, BUFFER_SIZE));
+	assert_int_equal(PatchFastExtentsSize(&patch.extents), 0);
+	deinitPatchFast(&patch);
+	_roundTrip((uint8_t*) in, (uint8_t*) in, BUFFER_SIZE);
+	free(in);
+}
+
+M_TEST_DEFINE(sparse) {
+	uint32_t* in = _randomBuffer(BUFFER_SIZE, 2);
+	uint8_t* out = malloc(BUFFER_SIZE);
+	memcpy(out, in, BUFFER_SIZE);
+	out[0] ^= 1;
+	out[63] ^= 1;
+	out[64] ^= 1;
+	out[0x1234] ^= 0x80;
+	out[BUFFER_SIZE - 1] ^= 0x10;
+
+	struct PatchFast patch;
+	initPatchFast(&patch);
+	assert_true(diffPatchFast(&patch, in, out, BUFFER_SIZE));
+	assert_int_equal(PatchFastExtentsSize(&patch.extents), 4);
+	assert_int_equal(PatchFastExtentsGetPointer(&patch.extents, 0)->offset, 0);
+	assert_int_equal(PatchFastExtentsGetPointer(&patch.extents, 1)->offset, 48);
+	assert_int_equal(PatchFastExtentsGetPointer(&patch.extents, 1)->length, 32);
+	assert_int_equal(PatchFastExtentsGetPointer(&patch.extents, 2)->offset, 0x1230);
+	assert_int_equal(PatchFastExtentsGetPointer(&patch.extents, 3)->offset, BUFFER_SIZE - 16);
+	deinitPatchFast(&patch);
+
+	_roundTrip((uint8_t*) in, out, BUFFER_SIZE);
+	free(in);
+	free(out);
+}
+
+M_TEST_DEFINE(dense) {
+	uint32_t* in = _randomBuffer(BUFFER_SIZE, 3);
+	uint32_t* out = _randomBuffer(BUFFER_SIZE, 4);
+
+	struct PatchFast patch;
+	initPatchFast(&patch);
+	assert_true(diffPatchFast(&patch, in, out, BUFFER_SIZE));
+	assert_int_equal(PatchFastExtentsSize(&patch.extents), BUFFER_SIZE / (PATCH_FAST_EXTENT * 4));
+	deinitPatchFast(&patch);
+
+	_roundTrip((uint8_t*) in, (uint8_t*) out, BUFFER_SIZE);
+	free(in);
+	free(out);
+}
+
+M_TEST_DEFINE(unalignedTail) {
+	size_t size = BUFFER_SIZE - 5;
+	uint32_t* in = _randomBuffer(BUFFER_SIZE, 5);
+	uint8_t* out = malloc(BUFFER_SIZE);
+	memcpy(out, in, BUFFER_SIZE);
+	out[size - 16] ^= 1;
+	out[size - 4] ^= 2;
+	out[size - 3] ^= 2;
+	out[size - 1] ^= 4;
+	_roundTrip((uint8_t*) in, out, size);
+	free(in);
+	free(out);
+}
+
+M_TEST_DEFINE(sizeMismatch) {
+	uint32_t* in = _randomBuffer(BUFFER_SIZE, 6);
+	uint8_t* out = malloc(BUFFER_SIZE);
+	struct PatchFast patch;
+	initPatchFast(&patch);
+	assert_true(diffPatchFast(&patch, in, in, BUFFER_SIZE));
+	assert_false(patch.d.applyPatch(&patch.d, in, BUFFER_SIZE, out, BUFFER_SIZE - 16));
+	deinitPatchFast(&patch);
+	free(in);
+	free(out);
+}
+
+M_TEST_SUITE_DEFINE(PatchFast,
+	cmocka_unit_test(identical),
+	cmocka_unit_test(sparse),
+	cmocka_unit_test(dense),
+	cmocka_unit_test(unalignedTail),
+	cmocka_unit_test(sizeMismatch))
@@ -0,0 +1,130 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/patch.h>
+#include <mgba-util/vfs.h>
+
+#define ROM_SIZE 64
+
+static const uint8_t _ips[] = {
+	'P', 'A', 'T', 'C', 'H',
+	0x00, 0x00, 0x04, 0x00, 0x02, 'A', 'B',
+	0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x04, 0xEE,
+	'E', 'O', 'F',
+};
+
+static const uint8_t _ipsOutOfBounds[] = {
+	'P', 'A', 'T', 'C', 'H',
+	0x00, 0x00, 0x3F, 0x00, 0x02, 'A', 'B',
+	'E', 'O', 'F',
+};
+
+static const uint8_t _ups[] = {
+	0x55, 0x50, 0x53, 0x31, 0xC0, 0xC0, 0x84, 0x45, 0x47, 0x00, 0x89, 0xFE,
+	0xFF, 0xFC, 0xFD, 0x00, 0x8C, 0xCE, 0x0E, 0x10, 0x49, 0x72, 0x7F, 0x4B,
+	0x8D, 0x2B, 0xD5, 0xFE,
+};
+
+static const uint8_t _bps[] = {
+	0x42, 0x50, 0x53, 0x31, 0xC0, 0xC0, 0x80, 0x8C, 0x85, 0x41, 0x42, 0xA6,
+	0x8C, 0x81, 0xEE, 0x8B, 0xA0, 0x2C, 0x80, 0x8C, 0xCE, 0x0E, 0x10, 0x49,
+	0x72, 0x7F, 0x4B, 0x4E, 0xCF, 0x13, 0x14,
+};
+
+static void _makeRom(uint8_t* in, uint8_t* expected) {
+	size_t i;
+	for (i = 0; i < ROM_SIZE; ++i) {
+		in[i] = i;
+	}
+	memcpy(expected, in, ROM_SIZE);
+	memcpy(&expected[4], "AB", 2);
+	memset(&expected[16], 0xEE, 4);
+}
+
+static void _apply(const uint8_t* data, size_t size, bool inPlace) {
+	uint8_t in[ROM_SIZE];
+	uint8_t expected[ROM_SIZE];
+	uint8_t out[ROM_SIZE];
+	_makeRom(in, expected);
+	memset(out, 0xA5, sizeof(out));
+
+	struct VFile* vf = VFileFromConstMemory(data, size);
+	struct Patch patch;
+	assert_true(loadPatch(vf, &patch));
+	assert_int_equal(patch.inPlace, inPlace);
+	assert_true(patch.applyPatch(&patch, in, ROM_SIZE, out, ROM_SIZE));
+	assert_memory_equal(out, expected, ROM_SIZE);
+
+	if (inPlace) {
+		assert_true(patch.applyPatch(&patch, in, ROM_SIZE, in, ROM_SIZE));
+		assert_memory_equal(in, expected, ROM_SIZE);
+	}
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(ips) {
+	_apply(_ips, sizeof(_ips), true);
+}
+
+M_TEST_DEFINE(ipsOutOfBounds) {
+	uint8_t in[ROM_SIZE];
+	uint8_t expected[ROM_SIZE];
+	uint8_t out[ROM_SIZE];
+	_makeRom(in, expected);
+
+	struct VFile* vf = VFileFromConstMemory(_ipsOutOfBounds, sizeof(_ipsOutOfBounds));
+	struct Patch patch;
+	assert_true(loadPatch(vf, &patch));
+	assert_false(patch.applyPatch(&patch, in, ROM_SIZE, out, ROM_SIZE));
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(ups) {
+	_apply(_ups, sizeof(_ups), true);
+}
+
+M_TEST_DEFINE(upsBadChecksum) {
+	uint8_t in[ROM_SIZE];
+	uint8_t expected[ROM_SIZE];
+	uint8_t out[ROM_SIZE];
+	_makeRom(in, expected);
+	// The patch itself is intact, but the input isn't the ROM it was made for
+	in[32] ^= 0xFF;
+
+	struct VFile* vf = VFileFromConstMemory(_ups, sizeof(_ups));
+	struct Patch patch;
+	assert_true(loadPatch(vf, &patch));
+	assert_false(patch.applyPatch(&patch, in, ROM_SIZE, out, ROM_SIZE));
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(bps) {
+	_apply(_bps, sizeof(_bps), false);
+}
+
+M_TEST_DEFINE(bpsBadInput) {
+	uint8_t in[ROM_SIZE];
+	uint8_t expected[ROM_SIZE];
+	uint8_t out[ROM_SIZE];
+	_makeRom(in, expected);
+	in[0] ^= 0xFF;
+
+	struct VFile* vf = VFileFromConstMemory(_bps, sizeof(_bps));
+	struct Patch patch;
+	assert_true(loadPatch(vf, &patch));
+	assert_false(patch.applyPatch(&patch, in, ROM_SIZE, out, ROM_SIZE));
+	vf->close(vf);
+}
+
+M_TEST_SUITE_DEFINE(Patch,
+	cmocka_unit_test(ips),
+	cmocka_unit_test(ipsOutOfBounds),
+	cmocka_unit_test(ups),
+	cmocka_unit_test(upsBadChecksum),
+	cmocka_unit_test(bps),
+	cmocka_unit_test(bpsBadInput),
+)
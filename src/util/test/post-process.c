@@ -0,0 +1,148 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/image/post-process.h>
+
+#define WIDTH 4
+#define HEIGHT 2
+#define STRIDE 6
+
+static const struct mColorCorrection identity = {
+	.matrix = {
+		1.f, 0.f, 0.f,
+		0.f, 1.f, 0.f,
+		0.f, 0.f, 1.f,
+	},
+	.inputGamma = 1.f,
+	.outputGamma = 1.f,
+	.brightness = 1.f,
+};
+
+static void _fill(color_t* pixels, uint16_t base) {
+	size_t i;
+	for (i = 0; i < STRIDE * HEIGHT; ++i) {
+		pixels[i] = mColorFrom555((base + i * 0x421) & 0x7FFF);
+	}
+}
+
+M_TEST_DEFINE(inactive) {
+	struct mPostProcess post;
+	mPostProcessInit(&post);
+	mPostProcessSetDimensions(&post, WIDTH, HEIGHT);
+	assert_false(mPostProcessIsActive(&post));
+
+	color_t pixels[STRIDE * HEIGHT];
+	color_t expected[STRIDE * HEIGHT];
+	_fill(pixels, 0x1234);
+	memcpy(expected, pixels, sizeof(pixels));
+	color_t output[STRIDE * HEIGHT] = {0};
+	mPostProcessRun(&post, output, STRIDE, pixels, STRIDE);
+	assert_memory_equal(pixels, expected, sizeof(pixels));
+	size_t i;
+	for (i = 0; i < HEIGHT; ++i) {
+		assert_memory_equal(&output[i * STRIDE], &pixels[i * STRIDE], WIDTH * sizeof(color_t));
+		assert_int_equal(output[i * STRIDE + WIDTH], 0);
+	}
+	mPostProcessDeinit(&post);
+}
+
+M_TEST_DEFINE(identityCorrection) {
+	struct mPostProcess post;
+	mPostProcessInit(&post);
+	mPostProcessSetDimensions(&post, WIDTH, HEIGHT);
+	mPostProcessSetColorCorrection(&post, &identity);
+	assert_true(mPostProcessIsActive(&post));
+
+	color_t pixels[STRIDE * HEIGHT];
+	color_t output[STRIDE * HEIGHT] = {0};
+	_fill(pixels, 0x0C63);
+	mPostProcessRun(&post, output, STRIDE, pixels, STRIDE);
+
+	size_t i;
+	for (i = 0; i < WIDTH; ++i) {
+		color_t original = pixels[i];
+		color_t corrected = output[i];
+#ifdef COLOR_16_BIT
+		assert_int_equal(corrected, original);
+#else
+		// Channels come out at full 8-bit precision rather than with the low bits copied down
+		assert_int_equal(corrected & 0xF8F8F8, original & 0xF8F8F8);
+#endif
+	}
+	// Anything past the width is left alone
+	assert_int_equal(output[WIDTH], 0);
+
+	mPostProcessSetColorCorrection(&post, NULL);
+	assert_false(mPostProcessIsActive(&post));
+	mPostProcessDeinit(&post);
+}
+
+M_TEST_DEFINE(gbaCorrection) {
+	struct mPostProcess post;
+	mPostProcessInit(&post);
+	mPostProcessSetDimensions(&post, 1, 1);
+	mPostProcessSetColorCorrection(&post, &mCOLOR_CORRECTION_GBA);
+
+	color_t black = mColorFrom555(0);
+	mPostProcessRun(&post, &black, 1, &black, 1);
+	assert_int_equal(black & M_COLOR_WHITE, 0);
+
+	// The GBA screen is darker than a modern one, so white shouldn't stay fully white
+	color_t white = mColorFrom555(0x7FFF);
+	mPostProcessRun(&post, &white, 1, &white, 1);
+	assert_int_not_equal(white & M_COLOR_WHITE, M_COLOR_WHITE);
+	mPostProcessDeinit(&post);
+}
+
+M_TEST_DEFINE(blending) {
+	struct mPostProcess post;
+	mPostProcessInit(&post);
+	mPostProcessSetInterframeBlending(&post, true);
+	mPostProcessSetDimensions(&post, WIDTH, HEIGHT);
+	assert_true(mPostProcessIsActive(&post));
+
+	color_t black[STRIDE * HEIGHT];
+	color_t white[STRIDE * HEIGHT];
+	size_t i;
+	for (i = 0; i < STRIDE * HEIGHT; ++i) {
+		black[i] = mColorFrom555(0);
+		white[i] = mColorFrom555(0x7FFF);
+	}
+
+	// The first frame has nothing to blend with
+	mPostProcessRun(&post, black, STRIDE, black, STRIDE);
+	assert_int_equal(black[0], mColorFrom555(0));
+
+	mPostProcessRun(&post, white, STRIDE, white, STRIDE);
+	for (i = 0; i < HEIGHT; ++i) {
+		color_t blended = white[i * STRIDE];
+		assert_int_not_equal(blended, mColorFrom555(0));
+		assert_int_not_equal(blended, mColorFrom555(0x7FFF));
+		assert_int_equal(white[i * STRIDE + WIDTH - 1], blended);
+		assert_int_equal(white[i * STRIDE + WIDTH], mColorFrom555(0x7FFF));
+	}
+
+	// Frames are blended with the previous frame as it was, not as it was shown
+	for (i = 0; i < STRIDE * HEIGHT; ++i) {
+		white[i] = mColorFrom555(0x7FFF);
+	}
+	mPostProcessRun(&post, white, STRIDE, white, STRIDE);
+	assert_int_equal(white[0], mColorFrom555(0x7FFF));
+
+	// Changing size starts over
+	mPostProcessSetDimensions(&post, WIDTH - 1, HEIGHT);
+	black[0] = mColorFrom555(0);
+	mPostProcessRun(&post, black, STRIDE, black, STRIDE);
+	assert_int_equal(black[0], mColorFrom555(0));
+	mPostProcessDeinit(&post);
+}
+
+M_TEST_SUITE_DEFINE(PostProcess,
+	cmocka_unit_test(inactive),
+	cmocka_unit_test(identityCorrection),
+	cmocka_unit_test(gbaCorrection),
+	cmocka_unit_test(blending))
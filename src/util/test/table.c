@@ -72,6 +72,40 @@ M_TEST_DEFINE(iteratorLookup) {
 	TableDeinit(&table);
 }
 
+M_TEST_DEFINE(removal) {
+	struct Table table;
+	TableInit(&table, 0, NULL);
+
+	size_t i;
+	for (i = 0; i < 5000; ++i) {
+		TableInsert(&table, i * 4, (void*) (i + 1));
+	}
+	for (i = 0; i < 5000; i += 2) {
+		TableRemove(&table, i * 4);
+	}
+	assert_int_equal(TableSize(&table), 2500);
+
+	for (i = 0; i < 5000; ++i) {
+		if (i & 1) {
+			assert_int_equal(i + 1, (size_t) TableLookup(&table, i * 4));
+		} else {
+			assert_null(TableLookup(&table, i * 4));
+		}
+	}
+
+	TableClear(&table);
+	assert_int_equal(TableSize(&table), 0);
+	for (i = 0; i < 5000; ++i) {
+		assert_null(TableLookup(&table, i * 4));
+	}
+
+	TableInsert(&table, 4, (void*) 1);
+	assert_int_equal(1, (size_t) TableLookup(&table, 4));
+	assert_int_equal(TableSize(&table), 1);
+
+	TableDeinit(&table);
+}
+
 M_TEST_DEFINE(hash) {
 	struct Table table;
 	HashTableInit(&table, 0, NULL);
@@ -92,6 +126,36 @@ M_TEST_DEFINE(hash) {
 	HashTableDeinit(&table);
 }
 
+M_TEST_DEFINE(hashRemove) {
+	struct Table table;
+	HashTableInit(&table, 0, NULL);
+
+	size_t i;
+	for (i = 0; i < 5000; ++i) {
+		char buffer[16];
+		snprintf(buffer, sizeof(buffer), "%"PRIz"i", i);
+		HashTableInsert(&table, buffer, (void*) (i + 1));
+	}
+	for (i = 0; i < 5000; i += 3) {
+		char buffer[16];
+		snprintf(buffer, sizeof(buffer), "%"PRIz"i", i);
+		HashTableRemove(&table, buffer);
+	}
+	assert_int_equal(HashTableSize(&table), 3333);
+
+	for (i = 0; i < 5000; ++i) {
+		char buffer[16];
+		snprintf(buffer, sizeof(buffer), "%"PRIz"i", i);
+		if (i % 3) {
+			assert_int_equal(i + 1, (size_t) HashTableLookup(&table, buffer));
+		} else {
+			assert_null(HashTableLookup(&table, buffer));
+		}
+	}
+
+	HashTableDeinit(&table);
+}
+
 M_TEST_DEFINE(hashIterator) {
 	struct Table table;
 	struct TableIterator iter;
@@ -152,7 +216,9 @@ M_TEST_SUITE_DEFINE(Table,
 	cmocka_unit_test(basic),
 	cmocka_unit_test(iterator),
 	cmocka_unit_test(iteratorLookup),
+	cmocka_unit_test(removal),
 	cmocka_unit_test(hash),
+	cmocka_unit_test(hashRemove),
 	cmocka_unit_test(hashIterator),
 	cmocka_unit_test(hashIteratorLookup),
 )
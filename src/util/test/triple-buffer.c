@@ -0,0 +1,112 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/threading.h>
+#include <mgba-util/triple-buffer.h>
+
+M_TEST_DEFINE(empty) {
+	struct TripleBuffer buffer;
+	TripleBufferInit(&buffer, sizeof(int));
+	assert_int_equal(TripleBufferCapacity(&buffer), sizeof(int));
+	assert_false(TripleBufferAcquire(&buffer));
+	assert_non_null(TripleBufferFront(&buffer));
+	assert_ptr_not_equal(TripleBufferFront(&buffer), TripleBufferBack(&buffer));
+	TripleBufferDeinit(&buffer);
+}
+
+M_TEST_DEFINE(publish) {
+	struct TripleBuffer buffer;
+	TripleBufferInit(&buffer, sizeof(int));
+	*(int*) TripleBufferBack(&buffer) = 1;
+	TripleBufferPublish(&buffer);
+	assert_true(TripleBufferAcquire(&buffer));
+	assert_int_equal(*(const int*) TripleBufferFront(&buffer), 1);
+	assert_false(TripleBufferAcquire(&buffer));
+	assert_int_equal(*(const int*) TripleBufferFront(&buffer), 1);
+	TripleBufferDeinit(&buffer);
+}
+
+M_TEST_DEFINE(newestWins) {
+	struct TripleBuffer buffer;
+	TripleBufferInit(&buffer, sizeof(int));
+	int i;
+	for (i = 1; i <= 5; ++i) {
+		*(int*) TripleBufferBack(&buffer) = i;
+		TripleBufferPublish(&buffer);
+	}
+	assert_true(TripleBufferAcquire(&buffer));
+	assert_int_equal(*(const int*) TripleBufferFront(&buffer), 5);
+	assert_false(TripleBufferAcquire(&buffer));
+	TripleBufferDeinit(&buffer);
+}
+
+M_TEST_DEFINE(frontIsStable) {
+	struct TripleBuffer buffer;
+	TripleBufferInit(&buffer, sizeof(int));
+	*(int*) TripleBufferBack(&buffer) = 1;
+	TripleBufferPublish(&buffer);
+	assert_true(TripleBufferAcquire(&buffer));
+	const int* front = TripleBufferFront(&buffer);
+
+	// The producer must never be handed the buffer the consumer is reading
+	int i;
+	for (i = 2; i < 10; ++i) {
+		assert_ptr_not_equal(TripleBufferBack(&buffer), front);
+		*(int*) TripleBufferBack(&buffer) = i;
+		TripleBufferPublish(&buffer);
+	}
+	assert_int_equal(*front, 1);
+	assert_true(TripleBufferAcquire(&buffer));
+	assert_int_equal(*(const int*) TripleBufferFront(&buffer), 9);
+	TripleBufferDeinit(&buffer);
+}
+
+#ifndef DISABLE_THREADING
+#define THREADED_FRAMES 100000
+
+static THREAD_ENTRY _produce(void* context) {
+	struct TripleBuffer* buffer = context;
+	int i;
+	for (i = 1; i <= THREADED_FRAMES; ++i) {
+		int* frame = TripleBufferBack(buffer);
+		frame[0] = i;
+		frame[1] = -i;
+		TripleBufferPublish(buffer);
+	}
+	THREAD_EXIT(0);
+}
+
+M_TEST_DEFINE(threaded) {
+	struct TripleBuffer buffer;
+	TripleBufferInit(&buffer, sizeof(int) * 2);
+	Thread thread;
+	ThreadCreate(&thread, _produce, &buffer);
+
+	int last = 0;
+	while (last < THREADED_FRAMES) {
+		if (!TripleBufferAcquire(&buffer)) {
+			continue;
+		}
+		const int* frame = TripleBufferFront(&buffer);
+		// Frames must arrive whole and never go backwards
+		assert_int_equal(frame[0], -frame[1]);
+		assert_true(frame[0] > last);
+		last = frame[0];
+	}
+	ThreadJoin(&thread);
+	TripleBufferDeinit(&buffer);
+}
+#endif
+
+M_TEST_SUITE_DEFINE(TripleBuffer,
+#ifndef DISABLE_THREADING
+	cmocka_unit_test(threaded),
+#endif
+	cmocka_unit_test(empty),
+	cmocka_unit_test(publish),
+	cmocka_unit_test(newestWins),
+	cmocka_unit_test(frontIsStable))
@@ -0,0 +1,145 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/vfs.h>
+
+#define TEST_7Z "vfs-lzma-test.7z"
+
+// Three solid blocks: LZMA holding first.bin and second.bin, LZMA2 holding
+// third.txt, and an uncompressed copy block holding stored.txt
+static const uint8_t _archive[] = {
+	0x37, 0x7A, 0xBC, 0xAF, 0x27, 0x1C, 0x00, 0x04, 0x06, 0x08, 0x82, 0xB4, 0xE3, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0xA0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xAB, 0x75, 0x48, 0xA8,
+	0x00, 0x00, 0x00, 0x52, 0xB8, 0x0F, 0xC2, 0x5B, 0x88, 0xF0, 0x1C, 0x5E, 0x85, 0x42, 0x23, 0xC8,
+	0x6E, 0xF9, 0x6A, 0x69, 0xAD, 0x24, 0x47, 0xA2, 0x2E, 0x1E, 0x0D, 0xED, 0x62, 0xEE, 0xD8, 0x3B,
+	0x7A, 0xE3, 0x18, 0xE2, 0x80, 0xFE, 0xFC, 0xA4, 0x5B, 0x1E, 0xD9, 0xBC, 0x7D, 0x36, 0x7B, 0xA5,
+	0x55, 0x30, 0x26, 0xA2, 0xF1, 0x75, 0x22, 0xC2, 0xE4, 0x9D, 0x26, 0x7D, 0x58, 0x23, 0xD7, 0x8B,
+	0xCB, 0x98, 0x5E, 0x3A, 0x51, 0xC9, 0xDF, 0x2C, 0x0C, 0xDA, 0xA0, 0xFC, 0x50, 0x44, 0x0E, 0xAA,
+	0x57, 0x82, 0x6B, 0xA5, 0xC1, 0x86, 0x71, 0x05, 0x7D, 0x52, 0xE3, 0x14, 0x69, 0x8F, 0xA0, 0x1D,
+	0x84, 0x95, 0x3B, 0x47, 0x15, 0xCC, 0x0A, 0x12, 0x93, 0x33, 0x01, 0xC4, 0xDD, 0x13, 0x0A, 0x9E,
+	0x8F, 0x23, 0x8E, 0x1C, 0xB0, 0x30, 0x07, 0x61, 0xC6, 0x59, 0xF2, 0xB5, 0x03, 0x0C, 0xE2, 0x7B,
+	0xEA, 0xF8, 0xDF, 0x78, 0xCF, 0x60, 0xF3, 0x0B, 0xEE, 0x48, 0x40, 0x5B, 0x49, 0x11, 0x5B, 0x21,
+	0x6B, 0xFD, 0xD2, 0xA4, 0x9F, 0x7A, 0x08, 0x8E, 0xB0, 0x39, 0x59, 0xF2, 0xCE, 0x44, 0x2C, 0xF4,
+	0x1B, 0x4D, 0xF0, 0x7A, 0x28, 0xCC, 0x50, 0xF9, 0xD7, 0xEE, 0xB9, 0x92, 0xFE, 0xAB, 0x09, 0x6B,
+	0x6D, 0x2C, 0x40, 0x41, 0x0D, 0x86, 0xDE, 0xAE, 0xFF, 0xFF, 0xC5, 0x7C, 0x00, 0x00, 0xE0, 0x03,
+	0x3F, 0x00, 0x17, 0x5D, 0x00, 0x24, 0x19, 0x49, 0x98, 0x6F, 0x16, 0x02, 0x8C, 0xE8, 0xE6, 0x5B,
+	0xB1, 0x47, 0x7E, 0x91, 0x5A, 0x3F, 0xE1, 0x89, 0x06, 0x98, 0x8A, 0x80, 0x00, 0x73, 0x74, 0x6F,
+	0x72, 0x65, 0x64, 0x01, 0x04, 0x06, 0x00, 0x03, 0x09, 0x80, 0xBE, 0x1F, 0x06, 0x00, 0x07, 0x0B,
+	0x03, 0x00, 0x01, 0x23, 0x03, 0x01, 0x01, 0x05, 0x5D, 0x00, 0x00, 0x10, 0x00, 0x01, 0x21, 0x21,
+	0x01, 0x10, 0x01, 0x01, 0x00, 0x0C, 0xA0, 0x00, 0x83, 0x40, 0x06, 0x00, 0x08, 0x0D, 0x02, 0x01,
+	0x01, 0x09, 0x90, 0x00, 0x0A, 0x01, 0x39, 0xE4, 0x12, 0xF4, 0x44, 0xEF, 0x56, 0x68, 0xA8, 0x20,
+	0x1A, 0xE8, 0x0B, 0xF9, 0x43, 0x56, 0x00, 0x00, 0x05, 0x04, 0x11, 0x55, 0x00, 0x66, 0x00, 0x69,
+	0x00, 0x72, 0x00, 0x73, 0x00, 0x74, 0x00, 0x2E, 0x00, 0x62, 0x00, 0x69, 0x00, 0x6E, 0x00, 0x00,
+	0x00, 0x73, 0x00, 0x65, 0x00, 0x63, 0x00, 0x6F, 0x00, 0x6E, 0x00, 0x64, 0x00, 0x2E, 0x00, 0x62,
+	0x00, 0x69, 0x00, 0x6E, 0x00, 0x00, 0x00, 0x74, 0x00, 0x68, 0x00, 0x69, 0x00, 0x72, 0x00, 0x64,
+	0x00, 0x2E, 0x00, 0x74, 0x00, 0x78, 0x00, 0x74, 0x00, 0x00, 0x00, 0x73, 0x00, 0x74, 0x00, 0x6F,
+	0x00, 0x72, 0x00, 0x65, 0x00, 0x64, 0x00, 0x2E, 0x00, 0x74, 0x00, 0x78, 0x00, 0x74, 0x00, 0x00,
+	0x00, 0x00, 0x00,
+};
+
+static uint8_t _first(size_t i) {
+	return (i * i) & 0xFF;
+}
+
+M_TEST_SUITE_SETUP(VFSLzma) {
+	struct VFile* vf = VFileOpen(TEST_7Z, O_WRONLY | O_CREAT | O_TRUNC);
+	if (!vf) {
+		return 1;
+	}
+	vf->write(vf, _archive, sizeof(_archive));
+	vf->close(vf);
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(VFSLzma) {
+	remove(TEST_7Z);
+	return 0;
+}
+
+M_TEST_DEFINE(list) {
+	struct VDir* vd = VDirOpen7z(TEST_7Z, 0);
+	assert_non_null(vd);
+
+	static const char* const names[] = { "first.bin", "second.bin", "third.txt", "stored.txt" };
+	size_t i;
+	for (i = 0; i < sizeof(names) / sizeof(*names); ++i) {
+		struct VDirEntry* de = vd->listNext(vd);
+		assert_non_null(de);
+		assert_string_equal(de->name(de), names[i]);
+	}
+	assert_null(vd->listNext(vd));
+	assert_null(vd->openFile(vd, "missing", O_RDONLY));
+
+	vd->close(vd);
+}
+
+M_TEST_DEFINE(openOutOfOrder) {
+	struct VDir* vd = VDirOpen7z(TEST_7Z, 0);
+	assert_non_null(vd);
+
+	// Opening the second file in a block first forces the earlier one to be decoded along the way
+	struct VFile* second = vd->openFile(vd, "second.bin", O_RDONLY);
+	assert_non_null(second);
+	assert_int_equal(second->size(second), 4096);
+	const uint8_t* data = second->map(second, 4096, MAP_READ);
+	assert_non_null(data);
+	assert_memory_equal(data, "mGBA", 4);
+	assert_memory_equal(&data[4092], "mGBA", 4);
+
+	struct VFile* first = vd->openFile(vd, "first.bin", O_RDONLY);
+	assert_non_null(first);
+	assert_int_equal(first->size(first), 4096);
+	data = first->map(first, 4096, MAP_READ);
+	assert_non_null(data);
+	size_t i;
+	for (i = 0; i < 4096; ++i) {
+		assert_int_equal(data[i], _first(i));
+	}
+
+	struct VFile* third = vd->openFile(vd, "third.txt", O_RDONLY);
+	assert_non_null(third);
+	char line[16] = {0};
+	assert_int_equal(third->seek(third, 13, SEEK_SET), 13);
+	assert_int_equal(third->read(third, line, 13), 13);
+	assert_string_equal(line, "Hello, world\n");
+
+	struct VFile* stored = vd->openFile(vd, "stored.txt", O_RDONLY);
+	assert_non_null(stored);
+	memset(line, 0, sizeof(line));
+	assert_int_equal(stored->read(stored, line, sizeof(line)), 6);
+	assert_string_equal(line, "stored");
+
+	stored->close(stored);
+	third->close(third);
+	first->close(first);
+	second->close(second);
+	vd->close(vd);
+}
+
+M_TEST_DEFINE(reopen) {
+	struct VDir* vd = VDirOpen7z(TEST_7Z, 0);
+	assert_non_null(vd);
+
+	int pass;
+	for (pass = 0; pass < 3; ++pass) {
+		struct VFile* vf = vd->openFile(vd, pass & 1 ? "third.txt" : "first.bin", O_RDONLY);
+		assert_non_null(vf);
+		uint8_t byte;
+		assert_int_equal(vf->seek(vf, -1, SEEK_END), vf->size(vf) - 1);
+		assert_int_equal(vf->read(vf, &byte, 1), 1);
+		assert_int_equal(byte, pass & 1 ? '\n' : _first(4095));
+		vf->close(vf);
+	}
+
+	vd->close(vd);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(VFSLzma,
+	cmocka_unit_test(list),
+	cmocka_unit_test(openOutOfOrder),
+	cmocka_unit_test(reopen),
+)
@@ -0,0 +1,171 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/vfs.h>
+
+#define TEST_ZIP "vfs-zip-test.zip"
+#define LARGE_SIZE 0x40000
+
+static uint8_t _large(size_t i) {
+	return (i * 7) ^ (i >> 9);
+}
+
+M_TEST_SUITE_SETUP(VFSZip) {
+	struct VDir* vd = VDirOpenZip(TEST_ZIP, O_WRONLY | O_CREAT | O_TRUNC);
+	if (!vd) {
+		return 1;
+	}
+	uint8_t* large = malloc(LARGE_SIZE);
+	size_t i;
+	for (i = 0; i < LARGE_SIZE; ++i) {
+		large[i] = _large(i);
+	}
+	struct VFile* vf = vd->openFile(vd, "large.bin", O_WRONLY);
+	vf->write(vf, large, LARGE_SIZE);
+	vf->close(vf);
+	free(large);
+
+	vf = vd->openFile(vd, "small.txt", O_WRONLY);
+	vf->write(vf, "Hello, world", 12);
+	vf->close(vf);
+
+	vf = vd->openFile(vd, "dir/empty", O_WRONLY);
+	vf->close(vf);
+
+	vd->close(vd);
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(VFSZip) {
+	remove(TEST_ZIP);
+	return 0;
+}
+
+M_TEST_DEFINE(list) {
+	struct VDir* vd = VDirOpenZip(TEST_ZIP, O_RDONLY);
+	assert_non_null(vd);
+
+	int pass;
+	for (pass = 0; pass < 2; ++pass) {
+		struct VDirEntry* de = vd->listNext(vd);
+		assert_non_null(de);
+		assert_string_equal(de->name(de), "large.bin");
+		de = vd->listNext(vd);
+		assert_non_null(de);
+		assert_string_equal(de->name(de), "small.txt");
+		de = vd->listNext(vd);
+		assert_non_null(de);
+		assert_string_equal(de->name(de), "dir/empty");
+		assert_null(vd->listNext(vd));
+		vd->rewind(vd);
+	}
+
+	assert_null(vd->openFile(vd, "missing", O_RDONLY));
+	vd->close(vd);
+}
+
+M_TEST_DEFINE(readSeek) {
+	struct VDir* vd = VDirOpenZip(TEST_ZIP, O_RDONLY);
+	assert_non_null(vd);
+	struct VFile* vf = vd->openFile(vd, "large.bin", O_RDONLY);
+	assert_non_null(vf);
+	assert_int_equal(vf->size(vf), LARGE_SIZE);
+
+	uint8_t buffer[16];
+	static const off_t offsets[] = { 0x100, 0x20, 0x30000, 0x2FFF0, 0x10, LARGE_SIZE - 8 };
+	size_t i;
+	for (i = 0; i < sizeof(offsets) / sizeof(*offsets); ++i) {
+		assert_int_equal(vf->seek(vf, offsets[i], SEEK_SET), offsets[i]);
+		ssize_t size = vf->read(vf, buffer, sizeof(buffer));
+		if (offsets[i] + (off_t) sizeof(buffer) > LARGE_SIZE) {
+			assert_int_equal(size, LARGE_SIZE - offsets[i]);
+		} else {
+			assert_int_equal(size, sizeof(buffer));
+		}
+		ssize_t j;
+		for (j = 0; j < size; ++j) {
+			assert_int_equal(buffer[j], _large(offsets[i] + j));
+		}
+	}
+	assert_int_equal(vf->read(vf, buffer, sizeof(buffer)), 0);
+
+	vf->close(vf);
+	vd->close(vd);
+}
+
+M_TEST_DEFINE(interleaved) {
+	struct VDir* vd = VDirOpenZip(TEST_ZIP, O_RDONLY);
+	assert_non_null(vd);
+	struct VFile* large = vd->openFile(vd, "large.bin", O_RDONLY);
+	assert_non_null(large);
+	struct VFile* small = vd->openFile(vd, "small.txt", O_RDONLY);
+	assert_non_null(small);
+
+	uint8_t buffer[5];
+	size_t offset = 0;
+	int i;
+	for (i = 0; i < 4; ++i) {
+		assert_int_equal(large->read(large, buffer, sizeof(buffer)), sizeof(buffer));
+		size_t j;
+		for (j = 0; j < sizeof(buffer); ++j) {
+			assert_int_equal(buffer[j], _large(offset + j));
+		}
+		offset += sizeof(buffer);
+		if (i < 2) {
+			assert_int_equal(small->read(small, buffer, sizeof(buffer)), sizeof(buffer));
+			assert_memory_equal(buffer, &"Hello, world"[i * sizeof(buffer)], sizeof(buffer));
+		}
+	}
+
+	small->close(small);
+	large->close(large);
+	vd->close(vd);
+}
+
+M_TEST_DEFINE(map) {
+	struct VDir* vd = VDirOpenZip(TEST_ZIP, O_RDONLY);
+	assert_non_null(vd);
+
+	int pass;
+	for (pass = 0; pass < 2; ++pass) {
+		struct VFile* vf = vd->openFile(vd, "large.bin", O_RDONLY);
+		assert_non_null(vf);
+		const uint8_t* data = vf->map(vf, LARGE_SIZE, MAP_READ);
+		assert_non_null(data);
+		size_t i;
+		for (i = 0; i < LARGE_SIZE; ++i) {
+			if (data[i] != _large(i)) {
+				fail();
+			}
+		}
+		vf->unmap(vf, (void*) data, LARGE_SIZE);
+
+		uint8_t* padded = vf->map(vf, LARGE_SIZE * 2, MAP_READ | MAP_WRITE);
+		assert_non_null(padded);
+		assert_int_equal(padded[LARGE_SIZE - 1], _large(LARGE_SIZE - 1));
+		assert_int_equal(padded[LARGE_SIZE], 0);
+		padded[0] = ~_large(0);
+		vf->unmap(vf, padded, LARGE_SIZE * 2);
+		vf->close(vf);
+	}
+
+	struct VFile* vf = vd->openFile(vd, "dir/empty", O_RDONLY);
+	assert_non_null(vf);
+	assert_int_equal(vf->size(vf), 0);
+	uint8_t byte;
+	assert_int_equal(vf->read(vf, &byte, 1), 0);
+	vf->close(vf);
+
+	vd->close(vd);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(VFSZip,
+	cmocka_unit_test(list),
+	cmocka_unit_test(readSeek),
+	cmocka_unit_test(interleaved),
+	cmocka_unit_test(map),
+)
@@ -145,6 +145,33 @@ M_TEST_DEFINE(mapMemChunk) {
 	vf->close(vf);
 }
 
+#if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
+M_TEST_DEFINE(syncRange) {
+	static const char path[] = "vfs-sync-test.bin";
+	struct VFile* vf = VFileOpen(path, O_RDWR | O_CREAT | O_TRUNC);
+	assert_non_null(vf);
+	uint8_t bytes[0x3000];
+	memset(bytes, 0xFF, sizeof(bytes));
+	assert_int_equal(vf->write(vf, bytes, sizeof(bytes)), sizeof(bytes));
+	uint8_t* mapped = vf->map(vf, sizeof(bytes), MAP_WRITE);
+	assert_non_null(mapped);
+
+	memcpy(&mapped[0x2345], "sync", 4);
+	assert_true(vf->sync(vf, &mapped[0x2345], 4));
+
+	struct VFile* check = VFileOpen(path, O_RDONLY);
+	assert_non_null(check);
+	check->seek(check, 0x2345, SEEK_SET);
+	assert_int_equal(check->read(check, bytes, 4), 4);
+	assert_memory_equal(bytes, "sync", 4);
+	check->close(check);
+
+	vf->unmap(vf, mapped, sizeof(bytes));
+	vf->close(vf);
+	remove(path);
+}
+#endif
+
 M_TEST_SUITE_DEFINE(VFS,
 #if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
 	cmocka_unit_test(openNullPathR),
@@ -164,4 +191,8 @@ M_TEST_SUITE_DEFINE(VFS,
 	cmocka_unit_test(resizeMemChunk),
 	cmocka_unit_test(mapMem),
 	cmocka_unit_test(mapConstMem),
-	cmocka_unit_test(mapMemChunk))
+	cmocka_unit_test(mapMemChunk),
+#if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
+	cmocka_unit_test(syncRange),
+#endif
+)
@@ -0,0 +1,70 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba-util/triple-buffer.h>
+
+#include <mgba-util/memory.h>
+
+#define INDEX_MASK 3
+#define FRESH 4
+
+static int _exchangeMiddle(struct TripleBuffer* buffer, int value) {
+	int old;
+	ATOMIC_LOAD(old, buffer->middle);
+	while (!ATOMIC_CMPXCHG(buffer->middle, old, value));
+	return old;
+}
+
+void TripleBufferInit(struct TripleBuffer* buffer, size_t size) {
+	size_t i;
+	for (i = 0; i < 3; ++i) {
+		buffer->buffers[i] = anonymousMemoryMap(size);
+	}
+	buffer->size = size;
+	TripleBufferClear(buffer);
+}
+
+void TripleBufferDeinit(struct TripleBuffer* buffer) {
+	size_t i;
+	for (i = 0; i < 3; ++i) {
+		mappedMemoryFree(buffer->buffers[i], buffer->size);
+		buffer->buffers[i] = NULL;
+	}
+	buffer->size = 0;
+}
+
+size_t TripleBufferCapacity(const struct TripleBuffer* buffer) {
+	return buffer->size;
+}
+
+void TripleBufferClear(struct TripleBuffer* buffer) {
+	buffer->back = 0;
+	buffer->front = 1;
+	ATOMIC_STORE(buffer->middle, 2);
+}
+
+void* TripleBufferBack(struct TripleBuffer* buffer) {
+	return buffer->buffers[buffer->back];
+}
+
+void TripleBufferPublish(struct TripleBuffer* buffer) {
+	// If the consumer hasn't picked up the previous buffer yet, it gets dropped and reused
+	buffer->back = _exchangeMiddle(buffer, buffer->back | FRESH) & INDEX_MASK;
+}
+
+bool TripleBufferAcquire(struct TripleBuffer* buffer) {
+	int middle;
+	ATOMIC_LOAD(middle, buffer->middle);
+	if (!(middle & FRESH)) {
+		return false;
+	}
+	// Only the consumer clears the fresh bit, so it can't have gone away since the check
+	buffer->front = _exchangeMiddle(buffer, buffer->front) & INDEX_MASK;
+	return true;
+}
+
+const void* TripleBufferFront(const struct TripleBuffer* buffer) {
+	return buffer->buffers[buffer->front];
+}
@@ -35,6 +35,8 @@ struct VFileFD {
 	struct HandleMappingList handles;
 #elif !defined(_POSIX_MAPPED_FILES)
 	bool writable;
+	uint8_t* mapping;
+	size_t mappingSize;
 #endif
 };
 
@@ -94,6 +96,8 @@ struct VFile* VFileFromFD(int fd) {
 	HandleMappingListInit(&vfd->handles, 4);
 #elif !defined(_POSIX_MAPPED_FILES)
 	vfd->writable = false;
+	vfd->mapping = NULL;
+	vfd->mappingSize = 0;
 #endif
 
 	return &vfd->d;
@@ -214,6 +218,8 @@ static void* _vfdMap(struct VFile* vf, size_t size, int flags) {
 	lseek(vfd->fd, 0, SEEK_SET);
 	read(vfd->fd, mem, size);
 	lseek(vfd->fd, pos, SEEK_SET);
+	vfd->mapping = mem;
+	vfd->mappingSize = size;
 	return mem;
 }
 
@@ -225,6 +231,10 @@ static void _vfdUnmap(struct VFile* vf, void* memory, size_t size) {
 		write(vfd->fd, memory, size);
 		lseek(vfd->fd, pos, SEEK_SET);
 	}
+	if (memory == vfd->mapping) {
+		vfd->mapping = NULL;
+		vfd->mappingSize = 0;
+	}
 	mappedMemoryFree(memory, size);
 }
 #endif
@@ -255,10 +265,16 @@ static bool _vfdSync(struct VFile* vf, void* buffer, size_t size) {
 #endif
 	if (buffer && size) {
 #ifdef _POSIX_MAPPED_FILES
-		return msync(buffer, size, MS_ASYNC) == 0;
+		// msync needs a page-aligned address, but only part of the mapping may have been passed
+		uintptr_t start = (uintptr_t) buffer & ~((uintptr_t) sysconf(_SC_PAGESIZE) - 1);
+		return msync((void*) start, size + ((uintptr_t) buffer - start), MS_ASYNC) == 0;
 #else
+		off_t offset = 0;
+		if (vfd->mapping && (uint8_t*) buffer >= vfd->mapping && (uint8_t*) buffer < vfd->mapping + vfd->mappingSize) {
+			offset = (uint8_t*) buffer - vfd->mapping;
+		}
 		off_t pos = lseek(vfd->fd, 0, SEEK_CUR);
-		lseek(vfd->fd, 0, SEEK_SET);
+		lseek(vfd->fd, offset, SEEK_SET);
 		ssize_t res = write(vfd->fd, buffer, size);
 		lseek(vfd->fd, pos, SEEK_SET);
 		if (res < 0) {
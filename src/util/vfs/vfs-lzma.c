@@ -17,8 +17,14 @@
 #include "third-party/lzma/7zCrc.h"
 #include "third-party/lzma/7zFile.h"
 #include "third-party/lzma/7zVersion.h"
+#include "third-party/lzma/Lzma2Dec.h"
+#include "third-party/lzma/LzmaDec.h"
 
 #define BUFFER_SIZE 0x2000
+#define INPUT_CHUNK_SIZE 0x40000
+
+#define METHOD_LZMA 0x30101
+#define METHOD_LZMA2 0x21
 
 struct VDirEntry7z {
 	struct VDirEntry d;
@@ -33,6 +39,24 @@ struct VDir7zAlloc {
 	struct Table allocs;
 };
 
+// A decoded (or partially decoded) solid block, shared by every file opened from it.
+// Blocks made of a single LZMA or LZMA2 coder are decoded incrementally, only as
+// far as the furthest file that has been opened so far.
+struct VDir7zBlock {
+	struct VDir7z* vd;
+	UInt32 index;
+	Byte* buffer;
+	size_t size;
+	size_t decoded;
+	size_t refs;
+
+	UInt32 method;
+	CLzmaDec lzma;
+	CLzma2Dec lzma2;
+	UInt64 inPos;
+	UInt64 inRemaining;
+};
+
 struct VDir7z {
 	struct VDir d;
 	struct VDirEntry7z dirent;
@@ -42,16 +66,19 @@ struct VDir7z {
 	CSzArEx db;
 	struct VDir7zAlloc allocImp;
 	ISzAlloc allocTempImp;
+
+	struct Table blocks;
+	struct VDir7zBlock* cachedBlock;
 };
 
 struct VFile7z {
 	struct VFile d;
 
 	struct VDir7z* vd;
+	struct VDir7zBlock* block;
 
 	size_t offset;
 
-	Byte* outBuffer;
 	size_t bufferOffset;
 	size_t size;
 };
@@ -85,21 +112,21 @@ static void* _vd7zAlloc(ISzAllocPtr p, size_t size) {
 		address = malloc(size);
 	}
 	if (address) {
-		TableInsert(&alloc->allocs, (uintptr_t) address >> 2, (void*) size);
+		HashTableInsertBinary(&alloc->allocs, &address, sizeof(address), (void*) size);
 	}
 	return address;
 }
 
 static void _vd7zFree(ISzAllocPtr p, void* address) {
 	struct VDir7zAlloc* alloc = (struct VDir7zAlloc*) p;
-	size_t size = (size_t) TableLookup(&alloc->allocs, (uintptr_t) address >> 2);
+	size_t size = (size_t) HashTableLookupBinary(&alloc->allocs, &address, sizeof(address));
 	if (size) {
 		if (size >= 0x10000) {
 			mappedMemoryFree(address, size);
 		} else {
 			free(address);
 		}
-		TableRemove(&alloc->allocs, (uintptr_t) address >> 2);
+		HashTableRemoveBinary(&alloc->allocs, &address, sizeof(address));
 	}
 }
 
@@ -113,6 +140,163 @@ static void _vd7zFreeTemp(ISzAllocPtr p, void* address) {
 	free(address);
 }
 
+static void _vd7zBlockFinishStream(struct VDir7zBlock* block) {
+	switch (block->method) {
+	case METHOD_LZMA:
+		LzmaDec_FreeProbs(&block->lzma, &block->vd->allocImp.d);
+		break;
+	case METHOD_LZMA2:
+		Lzma2Dec_FreeProbs(&block->lzma2, &block->vd->allocImp.d);
+		break;
+	}
+	block->method = 0;
+}
+
+static void _vd7zBlockDeinit(void* value) {
+	struct VDir7zBlock* block = value;
+	_vd7zBlockFinishStream(block);
+	if (block->buffer) {
+		IAlloc_Free(&block->vd->allocImp.d, block->buffer);
+	}
+	free(block);
+}
+
+static bool _vd7zBlockStartStream(struct VDir7z* vd, struct VDir7zBlock* block) {
+	const CSzAr* ar = &vd->db.db;
+	const Byte* data = ar->CodersData + ar->FoCodersOffsets[block->index];
+	CSzData sd = {
+		.Data = data,
+		.Size = ar->FoCodersOffsets[block->index + 1] - ar->FoCodersOffsets[block->index]
+	};
+	CSzFolder folder;
+	if (SzGetNextFolderItem(&folder, &sd) != SZ_OK || folder.NumCoders != 1 || folder.NumPackStreams != 1) {
+		return false;
+	}
+	const CSzCoderInfo* coder = &folder.Coders[0];
+	const Byte* props = data + coder->PropsOffset;
+	switch (coder->MethodID) {
+	case METHOD_LZMA:
+		LzmaDec_Construct(&block->lzma);
+		if (LzmaDec_AllocateProbs(&block->lzma, props, coder->PropsSize, &vd->allocImp.d) != SZ_OK) {
+			return false;
+		}
+		block->lzma.dic = block->buffer;
+		block->lzma.dicBufSize = block->size;
+		LzmaDec_Init(&block->lzma);
+		break;
+	case METHOD_LZMA2:
+		Lzma2Dec_Construct(&block->lzma2);
+		if (coder->PropsSize != 1 || Lzma2Dec_AllocateProbs(&block->lzma2, props[0], &vd->allocImp.d) != SZ_OK) {
+			return false;
+		}
+		block->lzma2.decoder.dic = block->buffer;
+		block->lzma2.decoder.dicBufSize = block->size;
+		Lzma2Dec_Init(&block->lzma2);
+		break;
+	default:
+		return false;
+	}
+
+	UInt32 packStream = ar->FoStartPackStreamIndex[block->index];
+	block->method = coder->MethodID;
+	block->inPos = vd->db.dataPos + ar->PackPositions[packStream];
+	block->inRemaining = ar->PackPositions[packStream + 1] - ar->PackPositions[packStream];
+	return true;
+}
+
+static struct VDir7zBlock* _vd7zGetBlock(struct VDir7z* vd, UInt32 index) {
+	struct VDir7zBlock* block = TableLookup(&vd->blocks, index);
+	if (block) {
+		++block->refs;
+		return block;
+	}
+
+	UInt64 size = SzAr_GetFolderUnpackSize(&vd->db.db, index);
+	if (size != (size_t) size) {
+		return NULL;
+	}
+	block = calloc(1, sizeof(*block));
+	block->vd = vd;
+	block->index = index;
+	block->size = size;
+	if (size) {
+		block->buffer = IAlloc_Alloc(&vd->allocImp.d, size);
+		if (!block->buffer) {
+			free(block);
+			return NULL;
+		}
+	}
+
+	if (!_vd7zBlockStartStream(vd, block)) {
+		// Filters and multi-coder chains can't be stopped partway, so decode everything up front
+		if (SzAr_DecodeFolder(&vd->db.db, index, &vd->lookStream.vt, vd->db.dataPos, block->buffer, block->size, &vd->allocTempImp) != SZ_OK) {
+			_vd7zBlockDeinit(block);
+			return NULL;
+		}
+		block->decoded = block->size;
+	}
+	block->refs = 1;
+	TableInsert(&vd->blocks, index, block);
+	return block;
+}
+
+static void _vd7zReleaseBlock(struct VDir7z* vd, struct VDir7zBlock* block) {
+	if (--block->refs) {
+		return;
+	}
+	// Keep the most recently released block around, since the next file
+	// opened is usually the next one in the same block
+	if (vd->cachedBlock && vd->cachedBlock != block && !vd->cachedBlock->refs) {
+		TableRemove(&vd->blocks, vd->cachedBlock->index);
+	}
+	vd->cachedBlock = block;
+}
+
+static bool _vd7zDecodeBlock(struct VDir7z* vd, struct VDir7zBlock* block, size_t target) {
+	if (block->decoded >= target) {
+		return true;
+	}
+	if (!block->method || LookInStream_SeekTo(&vd->lookStream.vt, block->inPos) != SZ_OK) {
+		return false;
+	}
+
+	while (block->decoded < target) {
+		const void* inBuf = NULL;
+		size_t lookahead = INPUT_CHUNK_SIZE;
+		if (lookahead > block->inRemaining) {
+			lookahead = block->inRemaining;
+		}
+		if (ILookInStream_Look(&vd->lookStream.vt, &inBuf, &lookahead) != SZ_OK) {
+			return false;
+		}
+
+		SizeT inProcessed = lookahead;
+		size_t decoded = block->decoded;
+		ELzmaStatus status;
+		SRes res;
+		if (block->method == METHOD_LZMA) {
+			res = LzmaDec_DecodeToDic(&block->lzma, target, inBuf, &inProcessed, LZMA_FINISH_ANY, &status);
+			block->decoded = block->lzma.dicPos;
+		} else {
+			res = Lzma2Dec_DecodeToDic(&block->lzma2, target, inBuf, &inProcessed, LZMA_FINISH_ANY, &status);
+			block->decoded = block->lzma2.decoder.dicPos;
+		}
+		block->inPos += inProcessed;
+		block->inRemaining -= inProcessed;
+		if (res != SZ_OK || ILookInStream_Skip(&vd->lookStream.vt, inProcessed) != SZ_OK) {
+			return false;
+		}
+		if (inProcessed == 0 && decoded == block->decoded) {
+			return false;
+		}
+	}
+
+	if (block->decoded == block->size) {
+		_vd7zBlockFinishStream(block);
+	}
+	return true;
+}
+
 struct VDir* VDirOpen7z(const char* path, int flags) {
 	if (flags & O_WRONLY || flags & O_CREAT) {
 		return 0;
@@ -128,7 +312,7 @@ struct VDir* VDirOpen7z(const char* path, int flags) {
 
 	vd->allocImp.d.Alloc = _vd7zAlloc;
 	vd->allocImp.d.Free = _vd7zFree;
-	TableInit(&vd->allocImp.allocs, 0, NULL);
+	HashTableInit(&vd->allocImp.allocs, 0, NULL);
 
 	vd->allocTempImp.Alloc = _vd7zAllocTemp;
 	vd->allocTempImp.Free = _vd7zFreeTemp;
@@ -150,11 +334,14 @@ struct VDir* VDirOpen7z(const char* path, int flags) {
 		SzArEx_Free(&vd->db, &vd->allocImp.d);
 		File_Close(&vd->archiveStream.file);
 		free(vd->lookStream.buf);
-		TableDeinit(&vd->allocImp.allocs);
+		HashTableDeinit(&vd->allocImp.allocs);
 		free(vd);
 		return 0;
 	}
 
+	TableInit(&vd->blocks, 0, _vd7zBlockDeinit);
+	vd->cachedBlock = NULL;
+
 	vd->dirent.index = -1;
 	vd->dirent.utf8 = 0;
 	vd->dirent.vd = vd;
@@ -173,7 +360,9 @@ struct VDir* VDirOpen7z(const char* path, int flags) {
 
 bool _vf7zClose(struct VFile* vf) {
 	struct VFile7z* vf7z = (struct VFile7z*) vf;
-	IAlloc_Free(&vf7z->vd->allocImp.d, vf7z->outBuffer);
+	if (vf7z->block) {
+		_vd7zReleaseBlock(vf7z->vd, vf7z->block);
+	}
 	free(vf7z);
 	return true;
 }
@@ -216,8 +405,11 @@ ssize_t _vf7zRead(struct VFile* vf, void* buffer, size_t size) {
 	if (size + vf7z->offset >= vf7z->size) {
 		size = vf7z->size - vf7z->offset;
 	}
+	if (!size) {
+		return 0;
+	}
 
-	memcpy(buffer, vf7z->outBuffer + vf7z->offset + vf7z->bufferOffset, size);
+	memcpy(buffer, vf7z->block->buffer + vf7z->offset + vf7z->bufferOffset, size);
 	vf7z->offset += size;
 	return size;
 }
@@ -234,11 +426,11 @@ void* _vf7zMap(struct VFile* vf, size_t size, int flags) {
 	struct VFile7z* vf7z = (struct VFile7z*) vf;
 
 	UNUSED(flags);
-	if (size > vf7z->size) {
+	if (size > vf7z->size || !vf7z->block) {
 		return 0;
 	}
 
-	return vf7z->outBuffer + vf7z->bufferOffset;
+	return vf7z->block->buffer + vf7z->bufferOffset;
 }
 
 void _vf7zUnmap(struct VFile* vf, void* memory, size_t size) {
@@ -260,13 +452,14 @@ ssize_t _vf7zSize(struct VFile* vf) {
 
 bool _vd7zClose(struct VDir* vd) {
 	struct VDir7z* vd7z = (struct VDir7z*) vd;
+	TableDeinit(&vd7z->blocks);
 	SzArEx_Free(&vd7z->db, &vd7z->allocImp.d);
 	File_Close(&vd7z->archiveStream.file);
 
 	free(vd7z->lookStream.buf);
 	free(vd7z->dirent.utf8);
 	vd7z->dirent.utf8 = 0;
-	TableDeinit(&vd7z->allocImp.allocs);
+	HashTableDeinit(&vd7z->allocImp.allocs);
 
 	free(vd7z);
 	return true;
@@ -330,19 +523,28 @@ struct VFile* _vd7zOpenFile(struct VDir* vd, const char* path, int mode) {
 
 	struct VFile7z* vf = malloc(sizeof(struct VFile7z));
 	vf->vd = vd7z;
-
-	size_t outBufferSize;
-	UInt32 blockIndex;
-
-	vf->outBuffer = 0;
-	SRes res = SzArEx_Extract(&vd7z->db, &vd7z->lookStream.vt, i, &blockIndex,
-		&vf->outBuffer, &outBufferSize,
-		&vf->bufferOffset, &vf->size,
-		&vd7z->allocImp.d, &vd7z->allocTempImp);
-
-	if (res != SZ_OK) {
-		free(vf);
-		return 0;
+	vf->block = NULL;
+	vf->bufferOffset = 0;
+	vf->size = SzArEx_GetFileSize(&vd7z->db, i);
+
+	UInt32 blockIndex = vd7z->db.FileToFolder[i];
+	if (blockIndex != (UInt32) -1) {
+		vf->block = _vd7zGetBlock(vd7z, blockIndex);
+		if (!vf->block) {
+			free(vf);
+			return 0;
+		}
+		vf->bufferOffset = vd7z->db.UnpackPositions[i] - vd7z->db.UnpackPositions[vd7z->db.FolderToFile[blockIndex]];
+		if (vf->bufferOffset + vf->size > vf->block->size || !_vd7zDecodeBlock(vd7z, vf->block, vf->bufferOffset + vf->size)) {
+			_vd7zReleaseBlock(vd7z, vf->block);
+			free(vf);
+			return 0;
+		}
+		if (SzBitWithVals_Check(&vd7z->db.CRCs, i) && CrcCalc(vf->block->buffer + vf->bufferOffset, vf->size) != vd7z->db.CRCs.Vals[i]) {
+			_vd7zReleaseBlock(vd7z, vf->block);
+			free(vf);
+			return 0;
+		}
 	}
 
 	vf->d.close = _vf7zClose;
@@ -45,13 +45,32 @@ enum {
 #include <minizip/zip.h>
 #include <minizip/unzip.h>
 #include <mgba-util/memory.h>
+#include <mgba-util/table.h>
+#include <mgba-util/vector.h>
+
+#if defined(_POSIX_MAPPED_FILES) && !defined(USE_VFS_FILE) && !defined(USE_VFS_3DS) && !defined(PSP2)
+#define ZIP_MAP_STORED
+#endif
+
+struct VZipEntry {
+	char* name;
+	unz64_file_pos pos;
+	size_t fileSize;
+	size_t compressedSize;
+	int method;
+	bool encrypted;
+	uint8_t* data;
+	bool mapped;
+	size_t refs;
+	uint64_t lastUse;
+};
+
+DECLARE_VECTOR(VZipEntryList, struct VZipEntry);
+DEFINE_VECTOR(VZipEntryList, struct VZipEntry);
 
 struct VDirEntryZip {
 	struct VDirEntry d;
-	char name[PATH_MAX];
-	size_t fileSize;
-	unzFile uz;
-	zipFile z;
+	const char* name;
 };
 
 struct VDirZip {
@@ -59,17 +78,39 @@ struct VDirZip {
 	unzFile uz;
 	zipFile z;
 	struct VDirEntryZip dirent;
-	bool atStart;
+	struct VZipEntryList entries;
+	struct Table index;
+	size_t listIndex;
+	struct VFileZip* active;
+	size_t cacheSize;
+	uint64_t useCounter;
+	struct VFile* archive;
+#ifdef ZIP_MAP_STORED
+	uint8_t* archiveMap;
+	size_t archiveSize;
+#endif
 };
 
 struct VFileZip {
 	struct VFile d;
-	unzFile uz;
+	struct VDirZip* vdz;
+	struct VZipEntry* entry;
 	zipFile z;
+	bool inMemory;
+	size_t offset;
 	void* buffer;
 	size_t bufferSize;
 	size_t fileSize;
 };
+
+enum {
+	// Inflated entries that are no longer open are kept around until the
+	// total exceeds this many bytes
+	ZIP_CACHE_SIZE = 0x4000000,
+	// Seeking backwards past this point in a compressed entry inflates the
+	// whole entry into the cache instead of restarting the stream
+	ZIP_REWIND_THRESHOLD = 0x10000,
+};
 #endif
 
 static bool _vfzClose(struct VFile* vf);
@@ -94,7 +135,6 @@ static enum VFSType _vdezType(struct VDirEntry* vde);
 
 #ifndef USE_LIBZIP
 static voidpf _vfmzOpen(voidpf opaque, const char* filename, int mode) {
-	UNUSED(opaque);
 	int flags = 0;
 	switch (mode & ZLIB_FILEFUNC_MODE_READWRITEFILTER) {
 	case ZLIB_FILEFUNC_MODE_READ:
@@ -113,7 +153,11 @@ static voidpf _vfmzOpen(voidpf opaque, const char* filename, int mode) {
 			flags |= O_TRUNC;
 		}
 	}
-	return VFileOpen(filename, flags);
+	struct VFile* vf = VFileOpen(filename, flags);
+	if (opaque) {
+		*(struct VFile**) opaque = vf;
+	}
+	return vf;
 }
 
 static uLong _vfmzRead(voidpf opaque, voidpf stream, void* buf, uLong size) {
@@ -139,7 +183,7 @@ static uLong _vfmzWrite(voidpf opaque, voidpf stream, const void* buf, uLong siz
 int _vfmzClose(voidpf opaque, voidpf stream) {
 	UNUSED(opaque);
 	struct VFile* vf = stream;
-	return vf->close(vf);
+	return vf->close(vf) ? 0 : -1;
 }
 
 int _vfmzError(voidpf opaque, voidpf stream) {
@@ -159,6 +203,45 @@ long _vfmzSeek(voidpf opaque, voidpf stream, uLong offset, int origin) {
 	struct VFile* vf = stream;
 	return vf->seek(vf, offset, origin) < 0;
 }
+
+static void _vdzBuildIndex(struct VDirZip* vdz) {
+	VZipEntryListInit(&vdz->entries, 0);
+	HashTableInit(&vdz->index, 0, NULL);
+	if (!vdz->uz) {
+		return;
+	}
+
+	unz_global_info64 global;
+	if (unzGetGlobalInfo64(vdz->uz, &global) == UNZ_OK) {
+		VZipEntryListEnsureCapacity(&vdz->entries, global.number_entry);
+	}
+
+	int status;
+	for (status = unzGoToFirstFile(vdz->uz); status == UNZ_OK; status = unzGoToNextFile(vdz->uz)) {
+		unz_file_info64 info;
+		char name[PATH_MAX];
+		if (unzGetCurrentFileInfo64(vdz->uz, &info, name, sizeof(name), 0, 0, 0, 0) != UNZ_OK) {
+			break;
+		}
+		struct VZipEntry* entry = VZipEntryListAppend(&vdz->entries);
+		memset(entry, 0, sizeof(*entry));
+		entry->name = strdup(name);
+		unzGetFilePos64(vdz->uz, &entry->pos);
+		entry->fileSize = info.uncompressed_size;
+		entry->compressedSize = info.compressed_size;
+		entry->method = info.compression_method;
+		entry->encrypted = info.flag & 1;
+	}
+
+	// Entries aren't added after this point, so pointers into the list stay valid
+	size_t i;
+	for (i = 0; i < VZipEntryListSize(&vdz->entries); ++i) {
+		struct VZipEntry* entry = VZipEntryListGetPointer(&vdz->entries, i);
+		if (!HashTableLookup(&vdz->index, entry->name)) {
+			HashTableInsert(&vdz->index, entry->name, entry);
+		}
+	}
+}
 #endif
 
 struct VDir* VDirOpenZip(const char* path, int flags) {
@@ -172,8 +255,9 @@ struct VDir* VDirOpenZip(const char* path, int flags) {
 		.zseek_file = _vfmzSeek,
 		.zclose_file = _vfmzClose,
 		.zerror_file = _vfmzError,
-		.opaque = 0
 	};
+	struct VFile* archive = NULL;
+	ops.opaque = &archive;
 	unzFile uz = NULL;
 	zipFile z = NULL;
 
@@ -224,18 +308,27 @@ struct VDir* VDirOpenZip(const char* path, int flags) {
 #ifdef USE_LIBZIP
 	vd->write = !!(flags & O_WRONLY);
 #else
-	vd->atStart = true;
 	vd->uz = uz;
+	vd->archive = archive;
+	vd->listIndex = 0;
+	vd->active = NULL;
+	vd->cacheSize = 0;
+	vd->useCounter = 0;
+#ifdef ZIP_MAP_STORED
+	vd->archiveMap = NULL;
+	vd->archiveSize = 0;
+#endif
+	_vdzBuildIndex(vd);
 #endif
 
 	vd->dirent.d.name = _vdezName;
 	vd->dirent.d.type = _vdezType;
 #ifdef USE_LIBZIP
 	vd->dirent.index = -1;
+	vd->dirent.z = z;
 #else
-	vd->dirent.uz = uz;
+	vd->dirent.name = NULL;
 #endif
-	vd->dirent.z = z;
 
 	return &vd->d;
 }
@@ -527,10 +620,186 @@ static enum VFSType _vdezType(struct VDirEntry* vde) {
 	return VFS_FILE;
 }
 #else
+static void _vdzEvict(struct VDirZip* vdz, size_t needed) {
+	while (vdz->cacheSize + needed > ZIP_CACHE_SIZE) {
+		struct VZipEntry* oldest = NULL;
+		size_t i;
+		for (i = 0; i < VZipEntryListSize(&vdz->entries); ++i) {
+			struct VZipEntry* entry = VZipEntryListGetPointer(&vdz->entries, i);
+			if (!entry->data || entry->mapped || entry->refs) {
+				continue;
+			}
+			if (!oldest || entry->lastUse < oldest->lastUse) {
+				oldest = entry;
+			}
+		}
+		if (!oldest) {
+			break;
+		}
+		mappedMemoryFree(oldest->data, oldest->fileSize);
+		oldest->data = NULL;
+		vdz->cacheSize -= oldest->fileSize;
+	}
+}
+
+static void _vdzDeactivate(struct VDirZip* vdz) {
+	if (vdz->active) {
+		unzCloseCurrentFile(vdz->uz);
+		vdz->active = NULL;
+	}
+}
+
+static bool _vdzCacheEntry(struct VDirZip* vdz, struct VZipEntry* entry) {
+	if (entry->data) {
+		return true;
+	}
+	_vdzEvict(vdz, entry->fileSize);
+	uint8_t* data = anonymousMemoryMap(entry->fileSize);
+	if (!data) {
+		return false;
+	}
+
+	_vdzDeactivate(vdz);
+	if (unzGoToFilePos64(vdz->uz, &entry->pos) != UNZ_OK || unzOpenCurrentFile(vdz->uz) != UNZ_OK) {
+		mappedMemoryFree(data, entry->fileSize);
+		return false;
+	}
+	size_t total = 0;
+	while (total < entry->fileSize) {
+		size_t toRead = entry->fileSize - total;
+		if (toRead > 0x40000000) {
+			toRead = 0x40000000;
+		}
+		int read = unzReadCurrentFile(vdz->uz, &data[total], toRead);
+		if (read <= 0) {
+			break;
+		}
+		total += read;
+	}
+	unzCloseCurrentFile(vdz->uz);
+	if (total != entry->fileSize) {
+		mappedMemoryFree(data, entry->fileSize);
+		return false;
+	}
+
+	entry->data = data;
+	vdz->cacheSize += entry->fileSize;
+	return true;
+}
+
+#ifdef ZIP_MAP_STORED
+static void _vdzMapStored(struct VDirZip* vdz, struct VZipEntry* entry) {
+	if (entry->method != 0 || entry->encrypted || entry->compressedSize != entry->fileSize || !vdz->archive) {
+		return;
+	}
+	if (!vdz->archiveMap) {
+		ssize_t size = vdz->archive->size(vdz->archive);
+		if (size <= 0) {
+			return;
+		}
+		vdz->archiveMap = vdz->archive->map(vdz->archive, size, MAP_READ);
+		if (!vdz->archiveMap) {
+			return;
+		}
+		vdz->archiveSize = size;
+	}
+
+	// The data offset depends on the local header, which isn't in the central directory
+	_vdzDeactivate(vdz);
+	if (unzGoToFilePos64(vdz->uz, &entry->pos) != UNZ_OK || unzOpenCurrentFile(vdz->uz) != UNZ_OK) {
+		return;
+	}
+	ZPOS64_T offset = unzGetCurrentFileZStreamPos64(vdz->uz);
+	unzCloseCurrentFile(vdz->uz);
+	if (!offset || offset > vdz->archiveSize || entry->fileSize > vdz->archiveSize - offset) {
+		return;
+	}
+	entry->data = &vdz->archiveMap[offset];
+	entry->mapped = true;
+}
+#endif
+
+static struct VZipEntry* _vdzFindEntry(struct VDirZip* vdz, const char* path) {
+	struct VZipEntry* entry = HashTableLookup(&vdz->index, path);
+	if (entry) {
+		return entry;
+	}
+
+	// Fall back to minizip's lookup for the platforms where it ignores case
+	_vdzDeactivate(vdz);
+	if (unzLocateFile(vdz->uz, path, 0) != UNZ_OK) {
+		return NULL;
+	}
+	unz64_file_pos pos;
+	if (unzGetFilePos64(vdz->uz, &pos) != UNZ_OK) {
+		return NULL;
+	}
+	size_t i;
+	for (i = 0; i < VZipEntryListSize(&vdz->entries); ++i) {
+		entry = VZipEntryListGetPointer(&vdz->entries, i);
+		if (entry->pos.pos_in_zip_directory == pos.pos_in_zip_directory) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static bool _vfzActivate(struct VFileZip* vfz) {
+	struct VDirZip* vdz = vfz->vdz;
+	if (vdz->active == vfz) {
+		return true;
+	}
+	_vdzDeactivate(vdz);
+	if (unzGoToFilePos64(vdz->uz, &vfz->entry->pos) != UNZ_OK || unzOpenCurrentFile(vdz->uz) != UNZ_OK) {
+		return false;
+	}
+	vdz->active = vfz;
+
+	// Another file was reading from the archive, so catch back up to where this one left off
+	size_t currentPos = 0;
+	while (currentPos < vfz->offset) {
+		char tempBuf[1024];
+		size_t toRead = sizeof(tempBuf);
+		if (toRead > vfz->offset - currentPos) {
+			toRead = vfz->offset - currentPos;
+		}
+		int read = unzReadCurrentFile(vdz->uz, tempBuf, toRead);
+		if (read <= 0) {
+			_vdzDeactivate(vdz);
+			return false;
+		}
+		currentPos += read;
+	}
+	return true;
+}
+
+static bool _vfzLoad(struct VFileZip* vfz) {
+	if (vfz->inMemory) {
+		return true;
+	}
+	struct VDirZip* vdz = vfz->vdz;
+	struct VZipEntry* entry = vfz->entry;
+	if (entry->fileSize && !_vdzCacheEntry(vdz, entry)) {
+		return false;
+	}
+	if (vdz->active == vfz) {
+		_vdzDeactivate(vdz);
+	}
+	++entry->refs;
+	entry->lastUse = ++vdz->useCounter;
+	vfz->inMemory = true;
+	return true;
+}
+
 bool _vfzClose(struct VFile* vf) {
 	struct VFileZip* vfz = (struct VFileZip*) vf;
-	if (vfz->uz) {
-		unzCloseCurrentFile(vfz->uz);
+	if (vfz->entry) {
+		if (vfz->inMemory) {
+			--vfz->entry->refs;
+		}
+		if (vfz->vdz->active == vfz) {
+			_vdzDeactivate(vfz->vdz);
+		}
 	}
 	if (vfz->z) {
 		zipCloseFileInZip(vfz->z);
@@ -544,18 +813,17 @@ bool _vfzClose(struct VFile* vf) {
 
 off_t _vfzSeek(struct VFile* vf, off_t offset, int whence) {
 	struct VFileZip* vfz = (struct VFileZip*) vf;
-	if (!vfz->uz) {
+	if (!vfz->entry) {
 		return -1;
 	}
 
-	int64_t currentPos = unztell64(vfz->uz);
 	int64_t pos;
 	switch (whence) {
 	case SEEK_SET:
 		pos = 0;
 		break;
 	case SEEK_CUR:
-		pos = unztell64(vfz->uz);
+		pos = vfz->offset;
 		break;
 	case SEEK_END:
 		pos = vfz->fileSize;
@@ -568,30 +836,62 @@ off_t _vfzSeek(struct VFile* vf, off_t offset, int whence) {
 		return -1;
 	}
 	pos += offset;
-	if (currentPos > pos) {
-		unzCloseCurrentFile(vfz->uz);
-		unzOpenCurrentFile(vfz->uz);
-		currentPos = 0;
+	if (vfz->inMemory) {
+		vfz->offset = pos;
+		return pos;
+	}
+	if ((size_t) pos < vfz->offset) {
+		if (pos >= ZIP_REWIND_THRESHOLD && _vfzLoad(vfz)) {
+			vfz->offset = pos;
+			return pos;
+		}
+		if (vfz->vdz->active == vfz) {
+			_vdzDeactivate(vfz->vdz);
+		}
+		vfz->offset = 0;
 	}
-	while (currentPos < pos) {
+	if (!_vfzActivate(vfz)) {
+		return -1;
+	}
+	while (vfz->offset < (size_t) pos) {
 		char tempBuf[1024];
 		ssize_t toRead = sizeof(tempBuf);
-		if (toRead > pos - currentPos) {
-			toRead = pos - currentPos;
+		if (toRead > pos - (int64_t) vfz->offset) {
+			toRead = pos - vfz->offset;
 		}
 		ssize_t read = vf->read(vf, tempBuf, toRead);
 		if (read < toRead) {
 			return -1;
 		}
-		currentPos += read;
 	}
 
-	return unztell64(vfz->uz);
+	return vfz->offset;
 }
 
 ssize_t _vfzRead(struct VFile* vf, void* buffer, size_t size) {
 	struct VFileZip* vfz = (struct VFileZip*) vf;
-	return unzReadCurrentFile(vfz->uz, buffer, size);
+	if (!vfz->entry) {
+		return -1;
+	}
+	if (vfz->inMemory) {
+		if (vfz->offset >= vfz->fileSize) {
+			return 0;
+		}
+		if (size > vfz->fileSize - vfz->offset) {
+			size = vfz->fileSize - vfz->offset;
+		}
+		memcpy(buffer, &vfz->entry->data[vfz->offset], size);
+		vfz->offset += size;
+		return size;
+	}
+	if (!_vfzActivate(vfz)) {
+		return -1;
+	}
+	int read = unzReadCurrentFile(vfz->vdz->uz, buffer, size);
+	if (read > 0) {
+		vfz->offset += read;
+	}
+	return read;
 }
 
 ssize_t _vfzWrite(struct VFile* vf, const void* buffer, size_t size) {
@@ -605,27 +905,26 @@ ssize_t _vfzWrite(struct VFile* vf, const void* buffer, size_t size) {
 
 void* _vfzMap(struct VFile* vf, size_t size, int flags) {
 	struct VFileZip* vfz = (struct VFileZip*) vf;
-
-	// TODO
-	UNUSED(flags);
-
-	off_t pos = vf->seek(vf, 0, SEEK_CUR);
-	if (pos < 0) {
+	if (!vfz->entry || !_vfzLoad(vfz)) {
 		return 0;
 	}
 
+	// Read-only mappings can share the cached or memory-mapped contents directly
+	if (!(flags & MAP_WRITE) && size <= vfz->fileSize && vfz->entry->data) {
+		return vfz->entry->data;
+	}
+
 	vfz->buffer = anonymousMemoryMap(size);
 	if (!vfz->buffer) {
 		return 0;
 	}
-
-	unzCloseCurrentFile(vfz->uz);
-	unzOpenCurrentFile(vfz->uz);
-	vf->read(vf, vfz->buffer, size);
-	unzCloseCurrentFile(vfz->uz);
-	unzOpenCurrentFile(vfz->uz);
-	vf->seek(vf, pos, SEEK_SET);
-
+	size_t toCopy = size;
+	if (toCopy > vfz->fileSize) {
+		toCopy = vfz->fileSize;
+	}
+	if (toCopy) {
+		memcpy(vfz->buffer, vfz->entry->data, toCopy);
+	}
 	vfz->bufferSize = size;
 
 	return vfz->buffer;
@@ -655,6 +954,22 @@ ssize_t _vfzSize(struct VFile* vf) {
 
 bool _vdzClose(struct VDir* vd) {
 	struct VDirZip* vdz = (struct VDirZip*) vd;
+	_vdzDeactivate(vdz);
+	size_t i;
+	for (i = 0; i < VZipEntryListSize(&vdz->entries); ++i) {
+		struct VZipEntry* entry = VZipEntryListGetPointer(&vdz->entries, i);
+		if (entry->data && !entry->mapped) {
+			mappedMemoryFree(entry->data, entry->fileSize);
+		}
+		free(entry->name);
+	}
+	VZipEntryListDeinit(&vdz->entries);
+	HashTableDeinit(&vdz->index);
+#ifdef ZIP_MAP_STORED
+	if (vdz->archiveMap) {
+		vdz->archive->unmap(vdz->archive, vdz->archiveMap, vdz->archiveSize);
+	}
+#endif
 	if (vdz->uz && unzClose(vdz->uz) < 0) {
 		return false;
 	}
@@ -667,29 +982,20 @@ bool _vdzClose(struct VDir* vd) {
 
 void _vdzRewind(struct VDir* vd) {
 	struct VDirZip* vdz = (struct VDirZip*) vd;
-	vdz->atStart = unzGoToFirstFile(vdz->uz) == UNZ_OK;
+	vdz->listIndex = 0;
 }
 
 struct VDirEntry* _vdzListNext(struct VDir* vd) {
 	struct VDirZip* vdz = (struct VDirZip*) vd;
-	if (!vdz->atStart) {
-		if (unzGoToNextFile(vdz->uz) == UNZ_END_OF_LIST_OF_FILE) {
-			return 0;
-		}
-	} else {
-		vdz->atStart = false;
-	}
-	unz_file_info64 info;
-	int status = unzGetCurrentFileInfo64(vdz->uz, &info, vdz->dirent.name, sizeof(vdz->dirent.name), 0, 0, 0, 0);
-	if (status < 0) {
+	if (vdz->listIndex >= VZipEntryListSize(&vdz->entries)) {
 		return 0;
 	}
-	vdz->dirent.fileSize = info.uncompressed_size;
+	vdz->dirent.name = VZipEntryListGetPointer(&vdz->entries, vdz->listIndex)->name;
+	++vdz->listIndex;
 	return &vdz->dirent.d;
 }
 
 struct VFile* _vdzOpenFile(struct VDir* vd, const char* path, int mode) {
-	UNUSED(mode);
 	struct VDirZip* vdz = (struct VDirZip*) vd;
 
 	if ((mode & O_ACCMODE) == O_RDWR) {
@@ -697,18 +1003,13 @@ struct VFile* _vdzOpenFile(struct VDir* vd, const char* path, int mode) {
 		return 0;
 	}
 
-	unz_file_info64 info = {0};
+	struct VZipEntry* entry = NULL;
 	if ((mode & O_ACCMODE) == O_RDONLY) {
-		if (unzLocateFile(vdz->uz, path, 0) != UNZ_OK) {
-			return 0;
-		}
-
-		if (unzOpenCurrentFile(vdz->uz) < 0) {
+		if (!vdz->uz) {
 			return 0;
 		}
-
-		int status = unzGetCurrentFileInfo64(vdz->uz, &info, 0, 0, 0, 0, 0, 0);
-		if (status < 0) {
+		entry = _vdzFindEntry(vdz, path);
+		if (!entry) {
 			return 0;
 		}
 	} else {
@@ -718,11 +1019,13 @@ struct VFile* _vdzOpenFile(struct VDir* vd, const char* path, int mode) {
 	}
 
 	struct VFileZip* vfz = calloc(1, sizeof(struct VFileZip));
-	vfz->uz = vdz->uz;
+	vfz->vdz = vdz;
+	vfz->entry = entry;
 	vfz->z = vdz->z;
+	vfz->inMemory = false;
+	vfz->offset = 0;
 	vfz->buffer = 0;
 	vfz->bufferSize = 0;
-	vfz->fileSize = info.uncompressed_size;
 
 	vfz->d.close = _vfzClose;
 	vfz->d.seek = _vfzSeek;
@@ -735,6 +1038,22 @@ struct VFile* _vdzOpenFile(struct VDir* vd, const char* path, int mode) {
 	vfz->d.size = _vfzSize;
 	vfz->d.sync = _vfzSync;
 
+	if (entry) {
+		vfz->z = NULL;
+		vfz->fileSize = entry->fileSize;
+#ifdef ZIP_MAP_STORED
+		if (!entry->data) {
+			_vdzMapStored(vdz, entry);
+		}
+#endif
+		if (entry->data || !entry->fileSize) {
+			_vfzLoad(vfz);
+		} else if (!_vfzActivate(vfz)) {
+			free(vfz);
+			return 0;
+		}
+	}
+
 	return &vfz->d;
 }
 
@@ -2,32 +2,53 @@
 from __future__ import print_function
 import argparse
 import csv
+import math
 import os
 import shlex
 import signal
 import socket
 import subprocess
 import sys
+import threading
 import time
 
+try:
+    from configparser import ConfigParser
+except ImportError:
+    from ConfigParser import SafeConfigParser as ConfigParser
+
+ROM_EXTENSIONS = ('.gba', '.zip', '.gbc', '.gb')
+
 class PerfTest(object):
     EXECUTABLE = 'mgba-perf'
 
-    def __init__(self, rom, renderer='software'):
+    def __init__(self, rom, renderer='software', savestate=None, movie=None, title=None):
         self.rom = rom
         self.renderer = renderer
+        self.savestate = savestate
+        self.movie = movie
+        self.title = title or rom
         self.results = None
-        self.name = 'Perf Test: {}'.format(rom)
+        self.name = 'Perf Test: {}'.format(self.title)
 
     def get_args(self):
         return []
 
+    def fps(self):
+        if not self.results:
+            return None
+        return int(self.results['frames']) * 1000000 / float(self.results['duration'])
+
     def wait(self, proc):
         pass
 
     def run(self, cwd):
         args = [os.path.join(os.getcwd(), self.EXECUTABLE), '-P']
         args.extend(self.get_args())
+        if self.savestate:
+            args.extend(['-L', self.savestate])
+        if self.movie:
+            args.extend(['-I', self.movie])
         if not self.renderer:
             args.append('-N')
         elif self.renderer == 'threaded-software':
@@ -51,20 +72,20 @@ class PerfTest(object):
         self.results = next(reader)
 
 class WallClockTest(PerfTest):
-    def __init__(self, rom, duration, renderer='software'):
-        super(WallClockTest, self).__init__(rom, renderer)
+    def __init__(self, rom, duration, renderer='software', **kwargs):
+        super(WallClockTest, self).__init__(rom, renderer, **kwargs)
         self.duration = duration
-        self.name = 'Wall-Clock Test ({} seconds, {} renderer): {}'.format(duration, renderer, rom)
+        self.name = 'Wall-Clock Test ({} seconds, {} renderer): {}'.format(duration, renderer, self.title)
 
     def wait(self, proc):
         time.sleep(self.duration)
         proc.send_signal(signal.SIGINT)
 
 class GameClockTest(PerfTest):
-    def __init__(self, rom, frames, renderer='software'):
-        super(GameClockTest, self).__init__(rom, renderer)
+    def __init__(self, rom, frames, renderer='software', **kwargs):
+        super(GameClockTest, self).__init__(rom, renderer, **kwargs)
         self.frames = frames
-        self.name = 'Game-Clock Test ({} frames, {} renderer): {}'.format(frames, renderer, rom)
+        self.name = 'Game-Clock Test ({} frames, {} renderer): {}'.format(frames, renderer, self.title)
 
     def get_args(self):
         return ['-F', str(self.frames)]
@@ -142,12 +163,13 @@ class PerfServer(object):
         self.socket = None
 
 class Suite(object):
-    def __init__(self, cwd, wall=None, game=None, renderer='software'):
+    def __init__(self, cwd, wall=None, game=None, renderer='software', repeat=1):
         self.cwd = cwd
         self.tests = []
         self.wall = wall
         self.game = game
         self.renderer = renderer
+        self.repeat = repeat
         self.server = None
 
     def set_server(self, server):
@@ -156,19 +178,85 @@ class Suite(object):
     def collect_tests(self):
         roms = []
         for f in os.listdir(self.cwd):
-            if f.endswith('.gba') or f.endswith('.zip') or f.endswith('.gbc') or f.endswith('.gb'):
+            if f.endswith(ROM_EXTENSIONS):
                 roms.append(f)
         roms.sort()
         for rom in roms:
             self.add_tests(rom)
 
-    def add_tests(self, rom):
-        if self.wall:
-            self.tests.append(WallClockTest(rom, self.wall, renderer=self.renderer))
-        if self.game:
-            self.tests.append(GameClockTest(rom, self.game, renderer=self.renderer))
+    def collect_manifest(self, manifest):
+        if os.path.isdir(manifest):
+            self._collect_tree(manifest)
+        else:
+            self._collect_ini(manifest)
+
+    def _collect_ini(self, manifest):
+        # One section per title: rom=, savestate=, input= and frames=, with paths
+        # relative to the manifest. [DEFAULT] applies to every section.
+        root = os.path.dirname(os.path.abspath(manifest))
+        config = ConfigParser()
+        config.read(manifest)
+        for title in config.sections():
+            rom = os.path.join(root, config.get(title, 'rom'))
+            savestate = None
+            if config.has_option(title, 'savestate'):
+                savestate = os.path.join(root, config.get(title, 'savestate'))
+            movie = None
+            if config.has_option(title, 'input'):
+                movie = os.path.join(root, config.get(title, 'input'))
+            frames = None
+            if config.has_option(title, 'frames'):
+                frames = config.getint(title, 'frames')
+            self.add_tests(rom, frames=frames, savestate=savestate, movie=movie, title=title)
 
-    def run(self):
+    def _collect_tree(self, root):
+        # Cinema-style tree: every directory holding a ROM is a title. A perf.ini
+        # with a [perf] section sets frames=, savestate= and input= for its
+        # directory and everything below it; otherwise a <rom>.ss0 and <rom>.input
+        # next to the ROM are used.
+        root = os.path.abspath(root)
+        settings = {root: {}}
+        for path, dirs, files in os.walk(root):
+            dirs.sort()
+            config = dict(settings.get(os.path.dirname(path), {}))
+            if 'perf.ini' in files:
+                parser = ConfigParser()
+                parser.read(os.path.join(path, 'perf.ini'))
+                if parser.has_section('perf'):
+                    for key, value in parser.items('perf'):
+                        if key in ('savestate', 'input'):
+                            value = os.path.join(path, value)
+                        config[key] = value
+            settings[path] = config
+            roms = sorted(f for f in files if f.endswith(ROM_EXTENSIONS))
+            for rom in roms:
+                title = os.path.relpath(path, root)
+                if len(roms) > 1 or title == '.':
+                    title = os.path.normpath(os.path.join(title, rom))
+                base = os.path.join(path, os.path.splitext(rom)[0])
+                savestate = config.get('savestate')
+                if not savestate and os.path.exists(base + '.ss0'):
+                    savestate = base + '.ss0'
+                movie = config.get('input')
+                if not movie and os.path.exists(base + '.input'):
+                    movie = base + '.input'
+                frames = None
+                if 'frames' in config:
+                    frames = int(config['frames'])
+                self.add_tests(os.path.join(path, rom), frames=frames, savestate=savestate, movie=movie, title=title)
+
+    def add_tests(self, rom, frames=None, savestate=None, movie=None, title=None):
+        frames = frames or self.game
+        kwargs = {'renderer': self.renderer, 'savestate': savestate, 'movie': movie, 'title': title}
+        for _ in range(self.repeat):
+            if self.wall:
+                self.tests.append(WallClockTest(rom, self.wall, **kwargs))
+            if frames:
+                self.tests.append(GameClockTest(rom, frames, **kwargs))
+
+    def run(self, jobs=1):
+        if jobs > 1 and not self.server:
+            return self._run_parallel(jobs)
         results = []
         sock = None
         for test in self.tests:
@@ -177,6 +265,7 @@ class Suite(object):
             if self.server:
                 self.server.run(test)
                 last_result = self.server.results[-1]
+                test.results = last_result
             else:
                 try:
                     test.run(self.cwd)
@@ -193,6 +282,93 @@ class Suite(object):
             results.extend(self.server.results)
         return results
 
+    def _run_parallel(self, jobs):
+        # Each test is still its own mgba-perf process; the workers only keep
+        # up to |jobs| of them running at once.
+        pending = list(self.tests)
+        lock = threading.Lock()
+
+        def worker():
+            while True:
+                with lock:
+                    if not pending:
+                        return
+                    test = pending.pop(0)
+                    print('Running test {}'.format(test.name), file=sys.stderr)
+                test.run(self.cwd)
+                if test.results:
+                    with lock:
+                        print('{:.2f} fps: {}'.format(test.fps(), test.name), file=sys.stderr)
+
+        threads = [threading.Thread(target=worker) for _ in range(jobs)]
+        for thread in threads:
+            thread.daemon = True
+            thread.start()
+        try:
+            for thread in threads:
+                while thread.is_alive():
+                    thread.join(0.1)
+        except KeyboardInterrupt:
+            print('Interrupted, returning early...', file=sys.stderr)
+            with lock:
+                del pending[:]
+        return [test.results for test in self.tests if test.results]
+
+    def summarize(self):
+        names = []
+        samples = {}
+        for test in self.tests:
+            if test.name not in samples:
+                names.append(test.name)
+                samples[test.name] = []
+            fps = test.fps()
+            if fps is not None:
+                samples[test.name].append(fps)
+        summary = []
+        for name in names:
+            fps = samples[name]
+            row = {'name': name, 'runs': len(fps), 'fps': '', 'stdev': '', 'min': '', 'max': ''}
+            if fps:
+                mean = sum(fps) / len(fps)
+                stdev = 0.0
+                if len(fps) > 1:
+                    stdev = math.sqrt(sum((x - mean) ** 2 for x in fps) / (len(fps) - 1))
+                row.update({'fps': '{:.2f}'.format(mean), 'stdev': '{:.2f}'.format(stdev),
+                            'min': '{:.2f}'.format(min(fps)), 'max': '{:.2f}'.format(max(fps))})
+            summary.append(row)
+        return summary
+
+SUMMARY_FIELDS = ['name', 'runs', 'fps', 'stdev', 'min', 'max']
+
+def compare_baseline(summary, baseline_path, threshold):
+    with open(baseline_path) as f:
+        baseline = dict((row['name'], row) for row in csv.DictReader(f))
+    regressions = 0
+    for row in summary:
+        row['baseline'] = ''
+        row['delta'] = ''
+        if row['name'] not in baseline or not baseline[row['name']]['fps']:
+            continue
+        base = float(baseline[row['name']]['fps'])
+        row['baseline'] = '{:.2f}'.format(base)
+        if not row['fps']:
+            # A title that used to run but no longer produces results is the
+            # worst kind of regression
+            row['delta'] = 'failed'
+            regressions += 1
+            continue
+        delta = (float(row['fps']) - base) * 100 / base
+        row['delta'] = '{:+.1f}%'.format(delta)
+        if delta < -threshold:
+            regressions += 1
+    return regressions
+
+def print_summary(summary, fout):
+    fields = [f for f in SUMMARY_FIELDS + ['baseline', 'delta'] if f in summary[0]]
+    for row in summary:
+        print(row['name'], file=fout)
+        print('    ' + ', '.join('{}: {}'.format(f, row[f]) for f in fields[1:]), file=fout)
+
 if __name__ == '__main__':
     parser = argparse.ArgumentParser()
     parser.add_argument('-w', '--wall-time', type=float, default=0, metavar='TIME', help='wall-clock time')
@@ -203,28 +379,57 @@ if __name__ == '__main__':
     parser.add_argument('-S', '--server-command', metavar='COMMAND', help='command to launch server')
     parser.add_argument('-o', '--out', metavar='FILE', help='output file path')
     parser.add_argument('-r', '--root', metavar='PATH', type=str, default='/perfroms', help='root path for server mode')
-    parser.add_argument('directory', help='directory containing ROM files')
+    parser.add_argument('-m', '--manifest', metavar='PATH', help='manifest file or directory tree of titles to run')
+    parser.add_argument('-j', '--jobs', type=int, default=1, metavar='N', help='number of tests to run at once')
+    parser.add_argument('-n', '--repeat', type=int, default=1, metavar='N', help='number of runs per test')
+    parser.add_argument('-b', '--baseline', metavar='FILE', help='compare against a baseline summary')
+    parser.add_argument('-t', '--threshold', type=float, default=5, metavar='PERCENT', help='slowdown that counts as a regression')
+    parser.add_argument('--save-baseline', metavar='FILE', help='write the summary as a new baseline')
+    parser.add_argument('directory', nargs='?', help='directory containing ROM files')
     args = parser.parse_args()
+    if not args.directory and not args.manifest:
+        parser.error('a directory or a manifest is required')
 
     renderer = 'software'
     if args.disable_renderer:
         renderer = None
     elif args.threaded_renderer:
         renderer = 'threaded-software'
-    s = Suite(args.directory, wall=args.wall_time, game=args.game_frames, renderer=renderer)
+    s = Suite(args.directory or os.getcwd(), wall=args.wall_time, game=args.game_frames, renderer=renderer, repeat=args.repeat)
     if args.server:
         if args.server_command:
             server = PerfServer(args.server, args.root, args.server_command)
         else:
             server = PerfServer(args.server, args.root)
         s.set_server(server)
-    s.collect_tests()
-    results = s.run()
-    fout = sys.stdout
-    if args.out:
-        fout = open(args.out, 'w')
-    writer = csv.DictWriter(fout, results[0].keys())
-    writer.writeheader()
-    writer.writerows(results)
-    if fout is not sys.stdout:
-        fout.close()
+    if args.manifest:
+        s.collect_manifest(args.manifest)
+    else:
+        s.collect_tests()
+    results = s.run(jobs=args.jobs)
+    if results:
+        fout = sys.stdout
+        if args.out:
+            fout = open(args.out, 'w')
+        writer = csv.DictWriter(fout, results[0].keys())
+        writer.writeheader()
+        writer.writerows(results)
+        if fout is not sys.stdout:
+            fout.close()
+
+    summary = s.summarize()
+    if not summary:
+        sys.exit(0)
+    if args.save_baseline:
+        with open(args.save_baseline, 'w') as f:
+            writer = csv.DictWriter(f, SUMMARY_FIELDS)
+            writer.writeheader()
+            writer.writerows(summary)
+    regressions = 0
+    if args.baseline:
+        regressions = compare_baseline(summary, args.baseline, args.threshold)
+    if args.repeat > 1 or args.baseline:
+        print_summary(summary, sys.stderr)
+    if regressions:
+        print('{} regression(s) beyond {}%'.format(regressions, args.threshold), file=sys.stderr)
+        sys.exit(1)